@@ -0,0 +1,129 @@
+/**
+*
+* @file dunereco/AnaUtils/DUNEAnaActiveVolume.cxx
+*
+* @brief Flat copy of the TPC boxes of the geometry for fast containment tests
+*/
+
+#include "dunereco/AnaUtils/DUNEAnaActiveVolume.h"
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+/// The relative tolerance geo::GeometryCore applies when locating the TPC of a position (its default PositionEpsilon)
+constexpr double kPositionWiggle = 1. + 1.e-4;
+
+/// Maximum number of grid cells along one axis
+constexpr unsigned int kMaxCellsPerAxis = 64;
+}
+
+namespace dune_ana
+{
+
+DUNEAnaActiveVolume::DUNEAnaActiveVolume(const geo::GeometryCore &geometry)
+{
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        m_envelope.m_min[axis] = std::numeric_limits<double>::max();
+        m_envelope.m_max[axis] = std::numeric_limits<double>::lowest();
+        m_grid.m_min[axis] = std::numeric_limits<double>::max();
+        m_grid.m_max[axis] = std::numeric_limits<double>::lowest();
+    }
+
+    for (auto const& tpc : geometry.Iterate<geo::TPCGeo>())
+    {
+        const double tpcMin[3] = {tpc.MinX(), tpc.MinY(), tpc.MinZ()};
+        const double tpcMax[3] = {tpc.MaxX(), tpc.MaxY(), tpc.MaxZ()};
+
+        Box box;
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            // Same widening as geo::BoxBoundedGeo::CoordinateContained
+            box.m_min[axis] = tpcMin[axis] > 0. ? tpcMin[axis] / kPositionWiggle : tpcMin[axis] * kPositionWiggle;
+            box.m_max[axis] = tpcMax[axis] < 0. ? tpcMax[axis] / kPositionWiggle : tpcMax[axis] * kPositionWiggle;
+
+            m_envelope.m_min[axis] = std::min(m_envelope.m_min[axis], tpcMin[axis]);
+            m_envelope.m_max[axis] = std::max(m_envelope.m_max[axis], tpcMax[axis]);
+            m_grid.m_min[axis] = std::min(m_grid.m_min[axis], box.m_min[axis]);
+            m_grid.m_max[axis] = std::max(m_grid.m_max[axis], box.m_max[axis]);
+        }
+        m_tpcs.push_back(box);
+    }
+
+    // Roughly two cells per TPC along each axis
+    const unsigned int nCellsPerAxis(std::min(kMaxCellsPerAxis, std::max(1u, static_cast<unsigned int>(2. * std::cbrt(m_tpcs.size())))));
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        const double extent(m_tpcs.empty() ? 0. : m_grid.m_max[axis] - m_grid.m_min[axis]);
+        m_nCells[axis] = extent > 0. ? nCellsPerAxis : 1;
+        m_cellSize[axis] = extent > 0. ? extent / m_nCells[axis] : 1.;
+    }
+
+    m_cells.resize(m_nCells[0] * m_nCells[1] * m_nCells[2]);
+    for (unsigned int iTPC = 0; iTPC < m_tpcs.size(); ++iTPC)
+    {
+        const Box &box(m_tpcs[iTPC]);
+        unsigned int first[3], last[3];
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            first[axis] = this->CellIndex(axis, box.m_min[axis]);
+            last[axis] = this->CellIndex(axis, box.m_max[axis]);
+        }
+
+        for (unsigned int i = first[0]; i <= last[0]; ++i)
+            for (unsigned int j = first[1]; j <= last[1]; ++j)
+                for (unsigned int k = first[2]; k <= last[2]; ++k)
+                    m_cells[(i * m_nCells[1] + j) * m_nCells[2] + k].push_back(iTPC);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+const DUNEAnaActiveVolume &DUNEAnaActiveVolume::Get()
+{
+    static const DUNEAnaActiveVolume activeVolume(*art::ServiceHandle<geo::Geometry const>());
+    return activeVolume;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+int DUNEAnaActiveVolume::FindTPC(const double x, const double y, const double z) const
+{
+    const double position[3] = {x, y, z};
+    unsigned int cell[3];
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        // Also rejects NaN
+        if (!(position[axis] >= m_grid.m_min[axis] && position[axis] <= m_grid.m_max[axis]))
+            return -1;
+
+        cell[axis] = this->CellIndex(axis, position[axis]);
+    }
+
+    for (const unsigned int iTPC : m_cells[(cell[0] * m_nCells[1] + cell[1]) * m_nCells[2] + cell[2]])
+    {
+        const Box &box(m_tpcs[iTPC]);
+        if (x >= box.m_min[0] && x <= box.m_max[0] && y >= box.m_min[1] && y <= box.m_max[1] && z >= box.m_min[2] && z <= box.m_max[2])
+            return iTPC;
+    }
+
+    return -1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int DUNEAnaActiveVolume::CellIndex(const unsigned int axis, const double coordinate) const
+{
+    const double cell(std::floor((coordinate - m_grid.m_min[axis]) / m_cellSize[axis]));
+    return static_cast<unsigned int>(std::min(std::max(cell, 0.), static_cast<double>(m_nCells[axis] - 1)));
+}
+
+} // namespace dune_ana
@@ -0,0 +1,92 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaActiveVolume.h
+ *
+ * @brief Flat copy of the TPC boxes of the geometry for fast containment tests
+*/
+
+#ifndef DUNE_ANA_ACTIVE_VOLUME_H
+#define DUNE_ANA_ACTIVE_VOLUME_H
+
+#include <vector>
+
+namespace geo
+{
+class GeometryCore;
+}
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaActiveVolume class
+ *
+ * The TPC boxes are read once and kept as a plain array, together with their envelope and a uniform grid
+ * listing the boxes that overlap each cell. FindTPC gives the same TPC as geo::GeometryCore::FindTPCAtPosition
+ * for positions inside a cryostat (including its relative position tolerance) but only tests the few boxes of one cell.
+ *
+*/
+class DUNEAnaActiveVolume
+{
+public:
+    /**
+    * @brief Build the boxes and the grid
+    *
+    * @param geometry the detector geometry
+    */
+    explicit DUNEAnaActiveVolume(const geo::GeometryCore &geometry);
+
+    /**
+    * @brief Get the instance for the geometry service, built on first use and shared by every caller of the job
+    *
+    * @return the active volume
+    */
+    static const DUNEAnaActiveVolume &Get();
+
+    /**
+    * @brief Find the TPC holding a position
+    *
+    * @param x the x position
+    * @param y the y position
+    * @param z the z position
+    *
+    * @return the index of the TPC in geometry iteration order, -1 if the position is in no TPC
+    */
+    int FindTPC(const double x, const double y, const double z) const;
+
+    /**
+    * @brief Whether a position is in any TPC
+    */
+    bool IsInsideTPC(const double x, const double y, const double z) const { return this->FindTPC(x, y, z) >= 0; }
+
+    /// The envelope of all the TPCs
+    double MinX() const { return m_envelope.m_min[0]; }
+    double MaxX() const { return m_envelope.m_max[0]; }
+    double MinY() const { return m_envelope.m_min[1]; }
+    double MaxY() const { return m_envelope.m_max[1]; }
+    double MinZ() const { return m_envelope.m_min[2]; }
+    double MaxZ() const { return m_envelope.m_max[2]; }
+
+private:
+    struct Box
+    {
+        double m_min[3];
+        double m_max[3];
+    };
+
+    /**
+    * @brief Get the grid cell of a coordinate, clamped to the grid
+    */
+    unsigned int CellIndex(const unsigned int axis, const double coordinate) const;
+
+    std::vector<Box> m_tpcs;                          ///< the TPC boxes widened by the geometry position tolerance
+    Box m_envelope;                                   ///< the envelope of the TPC boxes, without tolerance
+    Box m_grid;                                       ///< the envelope of the widened boxes, covered by the grid
+    unsigned int m_nCells[3];                         ///< the number of grid cells along each axis
+    double m_cellSize[3];                             ///< the cell size along each axis
+    std::vector<std::vector<unsigned int>> m_cells;   ///< the boxes overlapping each cell, in TPC order
+};
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_ACTIVE_VOLUME_H
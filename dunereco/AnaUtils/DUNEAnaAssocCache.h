@@ -0,0 +1,118 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaAssocCache.h
+ *
+ * @brief Event scoped cache of the associations used by the DUNEAna utilities
+*/
+
+#ifndef DUNE_ANA_ASSOC_CACHE_H
+#define DUNE_ANA_ASSOC_CACHE_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <typeindex>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaAssocCache class holding one art::FindManyP per (product type, label, assoc label)
+ *
+ * Each art::FindManyP is built over the full product collection the first time it is requested
+ * and then reused for every later lookup in the same event. The cache is emptied as soon as a
+ * different event is seen. Each thread keeps its own cache so no locking is needed. The lookups
+ * are handed out as shared pointers: a task TBB runs on the same thread while the caller waits
+ * may move the cache on to another event, and the caller's lookup has to outlive that.
+ *
+*/
+class DUNEAnaAssocCache
+{
+public:
+    /**
+     * @brief Get the associations from the products with the given label to objects of type T
+     *
+     * @param evt the current event
+     * @param products handle to the product collection the associations start from
+     * @param label the label of the product collection
+     * @param assocLabel the label of the associations
+     *
+     * @return the cached art::FindManyP, shared with the cache
+     */
+    template <typename T, typename U> static std::shared_ptr<const art::FindManyP<T>> Get(const art::Event &evt, const art::Handle<std::vector<U>> &products,
+        const std::string &label, const std::string &assocLabel);
+
+    /**
+     * @brief Drop all cached associations
+     */
+    static void Clear();
+
+private:
+    /// (associated type, product type, label, assoc label)
+    typedef std::tuple<std::type_index, std::type_index, std::string, std::string> Key;
+
+    struct Entry
+    {
+        const void *m_products;                 ///< The product collection the associations were built for
+        std::shared_ptr<const void> m_findMany;  ///< The type erased art::FindManyP
+    };
+
+    struct Store
+    {
+        art::EventID m_eventID;
+        std::map<Key, Entry> m_entries;
+    };
+
+    static Store &GetStore();
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T, typename U> std::shared_ptr<const art::FindManyP<T>> DUNEAnaAssocCache::Get(const art::Event &evt, const art::Handle<std::vector<U>> &products,
+    const std::string &label, const std::string &assocLabel)
+{
+    Store &store = GetStore();
+    if (store.m_eventID != evt.id())
+    {
+        store.m_entries.clear();
+        store.m_eventID = evt.id();
+    }
+
+    // The product pointer also catches different events that happen to share an event ID
+    const Key key(std::type_index(typeid(T)), std::type_index(typeid(U)), label, assocLabel);
+    const void *pProducts = products.product();
+    auto iter = store.m_entries.find(key);
+    if (iter == store.m_entries.end() || iter->second.m_products != pProducts)
+    {
+        Entry entry{pProducts, std::make_shared<const art::FindManyP<T>>(products, evt, assocLabel)};
+        iter = store.m_entries.insert_or_assign(key, std::move(entry)).first;
+    }
+
+    return std::static_pointer_cast<const art::FindManyP<T>>(iter->second.m_findMany);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaAssocCache::Clear()
+{
+    GetStore().m_entries.clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline DUNEAnaAssocCache::Store &DUNEAnaAssocCache::GetStore()
+{
+    thread_local Store store;
+    return store;
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_ASSOC_CACHE_H
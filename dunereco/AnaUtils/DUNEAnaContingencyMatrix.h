@@ -0,0 +1,227 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaContingencyMatrix.h
+ *
+ * @brief Sparse matrix of what the true particles share with the reconstructed objects of one event
+*/
+
+#ifndef DUNE_ANA_CONTINGENCY_MATRIX_H
+#define DUNE_ANA_CONTINGENCY_MATRIX_H
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaContingencyMatrix class accumulating, for each pair of true particle ID and reconstructed object index, the
+ *        weight (number of hits, energy, ...) they share
+ *
+ * The matrix is filled in one pass over the hits of the reconstructed objects, and the totals of the true particles in one
+ * pass over the hits of the event, since the reconstructed objects need not cover all of them. Every completeness, purity
+ * and efficiency of the event is then read from the matrix. Only the pairs that share something are stored.
+ *
+*/
+class DUNEAnaContingencyMatrix
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param nReco the number of reconstructed objects, indexed from 0
+     */
+    explicit DUNEAnaContingencyMatrix(const size_t nReco);
+
+    /**
+     * @brief Add a weight shared by a true particle and a reconstructed object
+     *
+     * @param trueID the true particle ID
+     * @param recoIndex the index of the reconstructed object
+     * @param weight the weight
+     */
+    void Fill(const int trueID, const size_t recoIndex, const double weight = 1.);
+
+    /**
+     * @brief Add to the total weight of a true particle in the event
+     *
+     * @param trueID the true particle ID
+     * @param weight the weight
+     */
+    void FillTrue(const int trueID, const double weight = 1.);
+
+    /**
+     * @brief Get the number of reconstructed objects
+     *
+     * @return the number of reconstructed objects
+     */
+    size_t NReco() const;
+
+    /**
+     * @brief Get the weight shared by a true particle and a reconstructed object
+     *
+     * @param trueID the true particle ID
+     * @param recoIndex the index of the reconstructed object
+     *
+     * @return the shared weight
+     */
+    double Shared(const int trueID, const size_t recoIndex) const;
+
+    /**
+     * @brief Get the weights a reconstructed object shares with each true particle
+     *
+     * @param recoIndex the index of the reconstructed object
+     *
+     * @return the weights, by true particle ID
+     */
+    const std::map<int, double> &Row(const size_t recoIndex) const;
+
+    /**
+     * @brief Get the total weight of a true particle in the event
+     *
+     * @param trueID the true particle ID
+     *
+     * @return the total weight
+     */
+    double TrueTotal(const int trueID) const;
+
+    /**
+     * @brief Get the total weight a reconstructed object shares with any true particle
+     *
+     * @param recoIndex the index of the reconstructed object
+     *
+     * @return the total weight
+     */
+    double RecoTotal(const size_t recoIndex) const;
+
+    /**
+     * @brief Get the true particle sharing the most with a reconstructed object, the lowest ID on a tie
+     *
+     * @param recoIndex the index of the reconstructed object
+     *
+     * @return the true particle ID and the shared weight, an ID of 0 if the object shares nothing
+     */
+    std::pair<int, double> BestTrue(const size_t recoIndex) const;
+
+    /**
+     * @brief Get the fraction of the weight of a true particle that is in a reconstructed object
+     *
+     * @param trueID the true particle ID
+     * @param recoIndex the index of the reconstructed object
+     *
+     * @return the completeness, 0 for a true particle without weight
+     */
+    double Completeness(const int trueID, const size_t recoIndex) const;
+
+    /**
+     * @brief Get the fraction of the weight of a reconstructed object that comes from a true particle
+     *
+     * @param trueID the true particle ID
+     * @param recoIndex the index of the reconstructed object
+     *
+     * @return the purity, 0 for a reconstructed object without weight
+     */
+    double Purity(const int trueID, const size_t recoIndex) const;
+
+private:
+    std::vector<std::map<int, double>> m_shared;     ///< The shared weights of each reconstructed object, by true particle ID
+    std::vector<double> m_recoTotals;                ///< The total weight of each reconstructed object
+    std::unordered_map<int, double> m_trueTotals;    ///< The total weight of each true particle
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline DUNEAnaContingencyMatrix::DUNEAnaContingencyMatrix(const size_t nReco) :
+    m_shared(nReco),
+    m_recoTotals(nReco, 0.)
+{
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaContingencyMatrix::Fill(const int trueID, const size_t recoIndex, const double weight)
+{
+    m_shared.at(recoIndex)[trueID] += weight;
+    m_recoTotals[recoIndex] += weight;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaContingencyMatrix::FillTrue(const int trueID, const double weight)
+{
+    m_trueTotals[trueID] += weight;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline size_t DUNEAnaContingencyMatrix::NReco() const
+{
+    return m_shared.size();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaContingencyMatrix::Shared(const int trueID, const size_t recoIndex) const
+{
+    const std::map<int, double> &row(m_shared.at(recoIndex));
+    const auto iter(row.find(trueID));
+    return (iter == row.end()) ? 0. : iter->second;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::map<int, double> &DUNEAnaContingencyMatrix::Row(const size_t recoIndex) const
+{
+    return m_shared.at(recoIndex);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaContingencyMatrix::TrueTotal(const int trueID) const
+{
+    const auto iter(m_trueTotals.find(trueID));
+    return (iter == m_trueTotals.end()) ? 0. : iter->second;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaContingencyMatrix::RecoTotal(const size_t recoIndex) const
+{
+    return m_recoTotals.at(recoIndex);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::pair<int, double> DUNEAnaContingencyMatrix::BestTrue(const size_t recoIndex) const
+{
+    std::pair<int, double> best(0, 0.);
+    for (const auto &entry : m_shared.at(recoIndex))
+    {
+        if (entry.second > best.second)
+            best = entry;
+    }
+
+    return best;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaContingencyMatrix::Completeness(const int trueID, const size_t recoIndex) const
+{
+    const double total(this->TrueTotal(trueID));
+    return (total > 0.) ? this->Shared(trueID, recoIndex) / total : 0.;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaContingencyMatrix::Purity(const int trueID, const size_t recoIndex) const
+{
+    const double total(this->RecoTotal(recoIndex));
+    return (total > 0.) ? this->Shared(trueID, recoIndex) / total : 0.;
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_CONTINGENCY_MATRIX_H
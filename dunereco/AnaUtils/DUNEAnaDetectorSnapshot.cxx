@@ -0,0 +1,76 @@
+/**
+*
+* @file dunereco/AnaUtils/DUNEAnaDetectorSnapshot.cxx
+*
+* @brief Flat copy of the clocks, detector properties and plane geometry of one event for per-hit and per-tick loops
+*/
+
+#include "dunereco/AnaUtils/DUNEAnaDetectorSnapshot.h"
+
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/PlaneGeo.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+#include "lardataalg/DetectorInfo/DetectorClocksData.h"
+#include "lardataalg/DetectorInfo/DetectorPropertiesData.h"
+
+namespace
+{
+/// Largest tick period over lifetime for which the fourth order series of the exponential is exact to double precision
+constexpr double kMaxInterpolatedLifetimePerTick = 1.e-3;
+}
+
+namespace dune_ana
+{
+
+DUNEAnaDetectorSnapshot::DUNEAnaDetectorSnapshot(const detinfo::DetectorClocksData &clockData,
+    const detinfo::DetectorPropertiesData &detProp) :
+    m_tickPeriod(clockData.TPCClock().TickPeriod()),
+    m_triggerOffset(trigger_offset(clockData)),
+    m_triggerTime(clockData.TriggerTime()),
+    m_electronLifetime(detProp.ElectronLifetime()),
+    m_driftVelocity(detProp.DriftVelocity()),
+    m_samplingRateInNs(sampling_rate(clockData)),
+    m_electronLifetimeInNs(detProp.ElectronLifetime()*1.e3),
+    m_lifetimePerTick(m_tickPeriod / m_electronLifetime),
+    m_interpolateLifetime(std::fabs(m_lifetimePerTick) < kMaxInterpolatedLifetimePerTick)
+{
+    const unsigned int nTicks(detProp.NumberTimeSamples());
+    m_lifetimeTable.resize(nTicks);
+    m_tickZeroLifetimeTable.resize(nTicks);
+
+    // The same expressions as the exponentials of the fallbacks, so looked up and computed values agree
+    for (unsigned int tick = 0; tick < nTicks; ++tick)
+    {
+        m_lifetimeTable[tick] = this->LifetimeCorrection(static_cast<double>(tick), m_triggerTime);
+        m_tickZeroLifetimeTable[tick] = std::exp((m_samplingRateInNs*static_cast<double>(tick)) / m_electronLifetimeInNs);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaDetectorSnapshot::DUNEAnaDetectorSnapshot(const geo::GeometryCore &geometry, const detinfo::DetectorClocksData &clockData,
+    const detinfo::DetectorPropertiesData &detProp) :
+    DUNEAnaDetectorSnapshot(clockData, detProp)
+{
+    for (auto const& tpc : geometry.Iterate<geo::TPCGeo>())
+    {
+        const geo::TPCID &tpcID(tpc.ID());
+        while (m_cryostatFirstTPC.size() <= tpcID.Cryostat)
+            m_cryostatFirstTPC.push_back(m_tpcFirstPlane.size());
+
+        m_tpcFirstPlane.push_back(m_planes.size());
+        for (unsigned int iPlane = 0; iPlane < tpc.Nplanes(); ++iPlane)
+        {
+            const geo::PlaneGeo &plane(tpc.Plane(iPlane));
+
+            Plane planeData;
+            planeData.m_xTicksOffset = detProp.GetXTicksOffset(iPlane, tpcID.TPC, tpcID.Cryostat);
+            planeData.m_xTicksCoefficient = detProp.GetXTicksCoefficient(tpcID.TPC, tpcID.Cryostat);
+            planeData.m_x = plane.GetCenter().X();
+            planeData.m_wirePitch = plane.WirePitch();
+            m_planes.push_back(planeData);
+        }
+    }
+}
+
+} // namespace dune_ana
@@ -0,0 +1,260 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaDetectorSnapshot.h
+ *
+ * @brief Flat copy of the clocks, detector properties and plane geometry of one event for per-hit and per-tick loops
+*/
+
+#ifndef DUNE_ANA_DETECTOR_SNAPSHOT_H
+#define DUNE_ANA_DETECTOR_SNAPSHOT_H
+
+#include <cmath>
+#include <vector>
+
+namespace detinfo
+{
+class DetectorClocksData;
+class DetectorPropertiesData;
+}
+
+namespace geo
+{
+class GeometryCore;
+}
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaDetectorSnapshot class
+ *
+ * The tick period, trigger offset, trigger time, electron lifetime and drift velocity of an event are read once,
+ * together with the x ticks offset, x ticks coefficient, x position and wire pitch of every plane, and kept as plain
+ * numbers. ConvertTicksToX and LifetimeCorrection do the same arithmetic as detinfo::DetectorPropertiesData::ConvertTicksToX
+ * and DUNEAnaHitUtils::LifetimeCorrection, so they give the same values. The lifetime corrections of the whole ticks of
+ * the readout window are tabulated, which replaces the exponential of the per-tick loops over wire signals by a lookup.
+ * A snapshot is made for one event and handed by const reference to the code run on it.
+ *
+*/
+class DUNEAnaDetectorSnapshot
+{
+public:
+    /**
+    * @brief Constructor, without the planes
+    *
+    * @param clockData the detector clocks of the event
+    * @param detProp the detector properties of the event
+    */
+    DUNEAnaDetectorSnapshot(const detinfo::DetectorClocksData &clockData, const detinfo::DetectorPropertiesData &detProp);
+
+    /**
+    * @brief Constructor
+    *
+    * @param geometry the detector geometry
+    * @param clockData the detector clocks of the event
+    * @param detProp the detector properties of the event
+    */
+    DUNEAnaDetectorSnapshot(const geo::GeometryCore &geometry, const detinfo::DetectorClocksData &clockData,
+        const detinfo::DetectorPropertiesData &detProp);
+
+    /// The tick period of the TPC clock in micro seconds
+    double TickPeriod() const { return m_tickPeriod; }
+    /// The trigger offset in ticks
+    double TriggerOffset() const { return m_triggerOffset; }
+    /// The trigger time in micro seconds
+    double TriggerTime() const { return m_triggerTime; }
+    /// The electron lifetime in micro seconds
+    double ElectronLifetime() const { return m_electronLifetime; }
+    /// The drift velocity in cm per micro second
+    double DriftVelocity() const { return m_driftVelocity; }
+
+    /**
+    * @brief Whether the planes were read, only then are the plane functions available
+    */
+    bool HasPlanes() const { return !m_planes.empty(); }
+
+    /**
+    * @brief Convert a time to a drift coordinate, as detinfo::DetectorPropertiesData::ConvertTicksToX
+    *
+    * @param ticks the time in ticks
+    * @param plane the plane
+    * @param tpc the tpc
+    * @param cryostat the cryostat
+    *
+    * @return the x position
+    */
+    double ConvertTicksToX(const double ticks, const unsigned int plane, const unsigned int tpc, const unsigned int cryostat) const;
+
+    /**
+    * @brief Get the x position of a plane
+    */
+    double PlaneX(const unsigned int plane, const unsigned int tpc, const unsigned int cryostat) const;
+
+    /**
+    * @brief Get the wire pitch of a plane
+    */
+    double WirePitch(const unsigned int plane, const unsigned int tpc, const unsigned int cryostat) const;
+
+    /**
+    * @brief Get the lifetime correction for a particular time, with the trigger time as t0
+    *
+    * @param timeInTicks the time in ticks, looked up in the table for whole ticks of the readout window
+    *
+    * @return the charge normalisation correction
+    */
+    double LifetimeCorrection(const double timeInTicks) const;
+
+    /**
+    * @brief Get the lifetime correction for a particular time
+    *
+    * @param timeInTicks the time in ticks
+    * @param t0InMicroS the t0 time in micro seconds
+    *
+    * @return the charge normalisation correction
+    */
+    double LifetimeCorrection(const double timeInTicks, const double t0InMicroS) const;
+
+    /**
+    * @brief Get the lifetime correction for a particular time, with the trigger time as t0, from the table for any time
+    *        of the readout window
+    *
+    * The correction of the whole tick below the time is scaled by the exponential of the fraction of a tick, which is
+    * summed as a short series. That series is exact to double precision while a tick is much shorter than the lifetime,
+    * otherwise, and outside the readout window, the exponential is computed.
+    *
+    * @param timeInTicks the time in ticks
+    *
+    * @return the charge normalisation correction, equal to LifetimeCorrection up to rounding
+    */
+    double InterpolatedLifetimeCorrection(const double timeInTicks) const;
+
+    /**
+    * @brief Get the lifetime correction for a drift time counted from tick zero, without trigger offset or t0,
+    *        as used by the RegCNN pixel maps
+    *
+    * @param timeInTicks the time in ticks, looked up in the table for whole ticks of the readout window
+    *
+    * @return the charge normalisation correction
+    */
+    double TickZeroLifetimeCorrection(const double timeInTicks) const;
+
+private:
+    struct Plane
+    {
+        double m_xTicksOffset;          ///< the x ticks offset
+        double m_xTicksCoefficient;     ///< the x ticks coefficient, signed by the drift direction
+        double m_x;                     ///< the x position of the plane centre
+        double m_wirePitch;             ///< the wire pitch
+    };
+
+    /**
+    * @brief Get a plane, which must exist
+    */
+    const Plane &GetPlane(const unsigned int plane, const unsigned int tpc, const unsigned int cryostat) const;
+
+    /**
+    * @brief Get the table index of a whole tick, -1 if the time is not a whole tick of the table
+    */
+    int TableIndex(const double timeInTicks) const;
+
+    double m_tickPeriod;                                ///< the tick period in micro seconds
+    double m_triggerOffset;                             ///< the trigger offset in ticks
+    double m_triggerTime;                               ///< the trigger time in micro seconds
+    double m_electronLifetime;                          ///< the electron lifetime in micro seconds
+    double m_driftVelocity;                             ///< the drift velocity
+    double m_samplingRateInNs;                          ///< the tick period in nano seconds
+    double m_electronLifetimeInNs;                      ///< the electron lifetime in nano seconds
+    double m_lifetimePerTick;                           ///< the tick period over the lifetime
+    bool m_interpolateLifetime;                         ///< whether the series of InterpolatedLifetimeCorrection is exact
+
+    std::vector<unsigned int> m_cryostatFirstTPC;       ///< the index of the first tpc of each cryostat
+    std::vector<unsigned int> m_tpcFirstPlane;          ///< the index of the first plane of each tpc
+    std::vector<Plane> m_planes;                        ///< the planes, in geometry iteration order
+
+    std::vector<double> m_lifetimeTable;                ///< LifetimeCorrection of each whole tick
+    std::vector<double> m_tickZeroLifetimeTable;        ///< TickZeroLifetimeCorrection of each whole tick
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline const DUNEAnaDetectorSnapshot::Plane &DUNEAnaDetectorSnapshot::GetPlane(const unsigned int plane, const unsigned int tpc,
+    const unsigned int cryostat) const
+{
+    return m_planes[m_tpcFirstPlane[m_cryostatFirstTPC[cryostat] + tpc] + plane];
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::ConvertTicksToX(const double ticks, const unsigned int plane, const unsigned int tpc,
+    const unsigned int cryostat) const
+{
+    const Plane &planeData(this->GetPlane(plane, tpc, cryostat));
+    return (ticks - planeData.m_xTicksOffset) * planeData.m_xTicksCoefficient;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::PlaneX(const unsigned int plane, const unsigned int tpc, const unsigned int cryostat) const
+{
+    return this->GetPlane(plane, tpc, cryostat).m_x;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::WirePitch(const unsigned int plane, const unsigned int tpc, const unsigned int cryostat) const
+{
+    return this->GetPlane(plane, tpc, cryostat).m_wirePitch;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline int DUNEAnaDetectorSnapshot::TableIndex(const double timeInTicks) const
+{
+    if (!(timeInTicks >= 0.) || timeInTicks >= static_cast<double>(m_lifetimeTable.size()))
+        return -1;
+
+    const int index(static_cast<int>(timeInTicks));
+    return static_cast<double>(index) == timeInTicks ? index : -1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::LifetimeCorrection(const double timeInTicks) const
+{
+    const int index(this->TableIndex(timeInTicks));
+    return index >= 0 ? m_lifetimeTable[index] : this->LifetimeCorrection(timeInTicks, m_triggerTime);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::LifetimeCorrection(const double timeInTicks, const double t0InMicroS) const
+{
+    const double timeCorrectedForT0((timeInTicks - m_triggerOffset)*m_tickPeriod - t0InMicroS);
+    return std::exp(timeCorrectedForT0/m_electronLifetime);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::InterpolatedLifetimeCorrection(const double timeInTicks) const
+{
+    if (!m_interpolateLifetime || !(timeInTicks >= 0.) || timeInTicks >= static_cast<double>(m_lifetimeTable.size()))
+        return this->LifetimeCorrection(timeInTicks, m_triggerTime);
+
+    const unsigned int tick(static_cast<unsigned int>(timeInTicks));
+    const double x((timeInTicks - static_cast<double>(tick)) * m_lifetimePerTick);
+
+    // exp(x) to fourth order, the remainder is below x^5/120
+    return m_lifetimeTable[tick] * (1. + x*(1. + x*(0.5 + x*(1./6. + x*(1./24.)))));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline double DUNEAnaDetectorSnapshot::TickZeroLifetimeCorrection(const double timeInTicks) const
+{
+    const int index(this->TableIndex(timeInTicks));
+    return index >= 0 ? m_tickZeroLifetimeTable[index] : std::exp((m_samplingRateInNs*timeInTicks) / m_electronLifetimeInNs);
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_DETECTOR_SNAPSHOT_H
@@ -6,6 +6,8 @@
 */
 
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaAssocCache.h"
+#include "dunereco/AnaUtils/DUNEAnaPFParticleHierarchy.h"
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
 
 #include "cetlib_except/exception.h"
@@ -18,6 +20,7 @@
 #include "lardataobj/RecoBase/Vertex.h"
 #include "lardataobj/RecoBase/Slice.h"
 #include "lardataobj/RecoBase/PFParticle.h"
+#include "lardataobj/AnalysisBase/T0.h"
 
 #include "dunereco/CVN/func/Result.h"
 #include "dunereco/TrackPID/products/CTPResult.h"
@@ -128,45 +131,58 @@ std::vector<art::Ptr<recob::PFParticle>> DUNEAnaEventUtils::GetClearCosmics(cons
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
 
-art::Ptr<recob::PFParticle> DUNEAnaEventUtils::GetNeutrino(const art::Event &evt, const std::string &label)
+std::vector<art::Ptr<recob::PFParticle>> DUNEAnaEventUtils::GetInterestingPFParticles(const art::Event &evt, const std::string &label, const std::string &t0Label)
 {
-    if (!HasNeutrino(evt,label))
-    {
-        throw cet::exception("DUNEAna") << "DUNEAnaEventUtils::GetNeutrino --- No neutrino found";
-    }
-    
-    art::Ptr<recob::PFParticle> pNeutrino;
-    std::vector<art::Ptr<recob::PFParticle>> particles = DUNEAnaEventUtils::GetPFParticles(evt,label);
-    for (art::Ptr<recob::PFParticle> pParticle : particles)
+    const auto pHierarchy = DUNEAnaPFParticleHierarchy::Get(evt,label);
+    const DUNEAnaPFParticleHierarchy &hierarchy = *pHierarchy;
+    std::shared_ptr<const art::FindManyP<anab::T0>> pParticleT0s;
+    if (!t0Label.empty())
+        pParticleT0s = DUNEAnaAssocCache::Get<anab::T0>(evt,evt.getHandle<std::vector<recob::PFParticle>>(label),label,t0Label);
+
+    // Each primary is decided once, the first time one of its particles is seen
+    enum class Decision : char {kUndecided, kKeep, kDrop};
+    std::vector<Decision> decisions(hierarchy.NParticles(), Decision::kUndecided);
+
+    std::vector<art::Ptr<recob::PFParticle>> theseParticles;
+    for (std::size_t iPart = 0; iPart < hierarchy.NParticles(); ++iPart)
     {
-        if (DUNEAnaPFParticleUtils::IsNeutrino(pParticle))
+        const std::size_t primary(hierarchy.GetPrimaryIndex(iPart));
+        if (primary == DUNEAnaPFParticleHierarchy::kInvalidIndex)
+            continue;
+
+        if (decisions[primary] == Decision::kUndecided)
         {
-            pNeutrino = pParticle;
-            break; 
+            const art::Ptr<recob::PFParticle> pPrimary(hierarchy.GetParticle(primary));
+            const bool keep(!DUNEAnaPFParticleUtils::IsClearCosmic(pPrimary, evt, label) && (!pParticleT0s || !pParticleT0s->at(pPrimary.key()).empty()));
+            decisions[primary] = keep ? Decision::kKeep : Decision::kDrop;
         }
+
+        if (decisions[primary] == Decision::kKeep)
+            theseParticles.push_back(hierarchy.GetParticle(iPart));
     }
-    return pNeutrino;
+
+    return theseParticles;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
 
-bool DUNEAnaEventUtils::HasNeutrino(const art::Event &evt, const std::string &label)
+art::Ptr<recob::PFParticle> DUNEAnaEventUtils::GetNeutrino(const art::Event &evt, const std::string &label)
 {
-    bool hasNeutrino = false;
-    std::vector<art::Ptr<recob::PFParticle>> particles = DUNEAnaEventUtils::GetPFParticles(evt,label);
-    for (art::Ptr<recob::PFParticle> pParticle : particles)
+    const auto pHierarchy = DUNEAnaPFParticleHierarchy::Get(evt,label);
+    const DUNEAnaPFParticleHierarchy &hierarchy = *pHierarchy;
+    if (hierarchy.GetPrimaryNeutrinos().empty())
     {
-        if(!pParticle->IsPrimary())
-        {
-            continue;
-        }
-        if (DUNEAnaPFParticleUtils::IsNeutrino(pParticle))
-        {
-            hasNeutrino = true;
-            break;
-        }
+        throw cet::exception("DUNEAna") << "DUNEAnaEventUtils::GetNeutrino --- No neutrino found";
     }
-    return hasNeutrino;
+
+    return hierarchy.GetParticle(hierarchy.GetPrimaryNeutrinos().front());
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+bool DUNEAnaEventUtils::HasNeutrino(const art::Event &evt, const std::string &label)
+{
+    return !DUNEAnaPFParticleHierarchy::Get(evt,label)->GetPrimaryNeutrinos().empty();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
@@ -178,10 +194,59 @@ std::vector<art::Ptr<cvn::Result>> DUNEAnaEventUtils::GetCVNResults(const art::E
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
 
+std::vector<art::Ptr<cvn::CompactResult>> DUNEAnaEventUtils::GetCVNCompactResults(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductVector<cvn::CompactResult>(evt,label);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
 std::vector<art::Ptr<ctp::CTPResult>> DUNEAnaEventUtils::GetSquIDResults(const art::Event &evt, const std::string &label)
 {
     return DUNEAnaEventUtils::GetProductVector<ctp::CTPResult>(evt,label);
 }
 
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaProductView<recob::PFParticle> DUNEAnaEventUtils::GetPFParticleView(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductView<recob::PFParticle>(evt,label);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaProductView<recob::Hit> DUNEAnaEventUtils::GetHitView(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductView<recob::Hit>(evt,label);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaProductView<recob::Wire> DUNEAnaEventUtils::GetWireView(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductView<recob::Wire>(evt,label);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaProductView<recob::SpacePoint> DUNEAnaEventUtils::GetSpacePointView(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductView<recob::SpacePoint>(evt,label);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaProductView<simb::MCTruth> DUNEAnaEventUtils::GetMCTruthView(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductView<simb::MCTruth>(evt,label);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaProductView<simb::MCParticle> DUNEAnaEventUtils::GetMCParticleView(const art::Event &evt, const std::string &label)
+{
+    return DUNEAnaEventUtils::GetProductView<simb::MCParticle>(evt,label);
+}
+
 } // namespace dune_ana
 
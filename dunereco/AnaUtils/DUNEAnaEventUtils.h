@@ -10,8 +10,10 @@
 
 #include "art/Framework/Principal/Event.h"
 
+#include "dunereco/AnaUtils/DUNEAnaProductView.h"
 #include "dunereco/AnaUtils/DUNEAnaUtilsBase.h"
 #include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CompactResult.h"
 #include "dunereco/TrackPID/products/CTPResult.h"
 
 #include "lardataobj/RecoBase/Hit.h"
@@ -150,6 +152,18 @@ public:
     */
     static std::vector<art::Ptr<recob::PFParticle>> GetClearCosmics(const art::Event &evt, const std::string &label);
 
+    /**
+    * @brief Get the particles worth running the expensive algorithms on: those whose primary is not a clear cosmic ray
+    *        and, if asked for, has a T0. Whole hierarchies (slices) are kept or dropped together
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the particle producer
+    * @param t0Label is the label of the particle to T0 associations, none are needed if empty
+    *
+    * @return vector of art::Ptrs to the particles, in collection order
+    */
+    static std::vector<art::Ptr<recob::PFParticle>> GetInterestingPFParticles(const art::Event &evt, const std::string &label, const std::string &t0Label = "");
+
     /**
     * @brief Get the neutrino from the event
     *
@@ -180,6 +194,16 @@ public:
     */
     static std::vector<art::Ptr<cvn::Result>> GetCVNResults(const art::Event &evt, const std::string &label);
 
+    /**
+    * @brief Get the half precision CVN result objects from the event
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the cvn evaluator
+    *
+    * @return vector of art::Ptrs to compact CVN result objects
+    */
+    static std::vector<art::Ptr<cvn::CompactResult>> GetCVNCompactResults(const art::Event &evt, const std::string &label);
+
     /**
     * @brief Get the SquID track PID result objects from the event
     *
@@ -190,6 +214,66 @@ public:
     */
     static std::vector<art::Ptr<ctp::CTPResult>> GetSquIDResults(const art::Event &evt, const std::string &label);
 
+    /**
+    * @brief Get a view of the particles in the event, without making a vector of art::Ptrs as GetPFParticles does
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the particle producer
+    *
+    * @return view of the particles, empty if they are not found
+    */
+    static DUNEAnaProductView<recob::PFParticle> GetPFParticleView(const art::Event &evt, const std::string &label);
+
+    /**
+    * @brief Get a view of the hits in the event, without making a vector of art::Ptrs as GetHits does
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the hit producer
+    *
+    * @return view of the hits, empty if they are not found
+    */
+    static DUNEAnaProductView<recob::Hit> GetHitView(const art::Event &evt, const std::string &label);
+
+    /**
+    * @brief Get a view of the wires in the event, without making a vector of art::Ptrs as GetWires does
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the wire producer
+    *
+    * @return view of the wires, empty if they are not found
+    */
+    static DUNEAnaProductView<recob::Wire> GetWireView(const art::Event &evt, const std::string &label);
+
+    /**
+    * @brief Get a view of the spacepoints in the event, without making a vector of art::Ptrs as GetSpacePoints does
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the spacepoint producer
+    *
+    * @return view of the spacepoints, empty if they are not found
+    */
+    static DUNEAnaProductView<recob::SpacePoint> GetSpacePointView(const art::Event &evt, const std::string &label);
+
+    /**
+    * @brief Get a view of the MC truths in the event, without making a vector of art::Ptrs as GetMCTruths does
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the MC truth producer
+    *
+    * @return view of the MC truths, empty if they are not found
+    */
+    static DUNEAnaProductView<simb::MCTruth> GetMCTruthView(const art::Event &evt, const std::string &label);
+
+    /**
+    * @brief Get a view of the MC particles in the event, without making a vector of art::Ptrs as GetMCParticles does
+    *
+    * @param evt is the underlying art event
+    * @param label is the label for the MC particle producer
+    *
+    * @return view of the MC particles, empty if they are not found
+    */
+    static DUNEAnaProductView<simb::MCParticle> GetMCParticleView(const art::Event &evt, const std::string &label);
+
 
 };
 
@@ -0,0 +1,315 @@
+/**
+*
+* @file dunereco/AnaUtils/DUNEAnaGeometryCache.cxx
+*
+* @brief Binary file of tables derived from the geometry alone, shared by the jobs of a node through read-only mappings
+*/
+
+#include "dunereco/AnaUtils/DUNEAnaGeometryCache.h"
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr char kMagic[8] = {'D', 'U', 'N', 'E', 'G', 'E', 'O', 'C'};
+/// Bump when the layout of the file or of any section changes
+constexpr uint32_t kVersion = 2;
+constexpr size_t kNameSize = 64;
+constexpr size_t kAlignment = 64;
+
+struct FileHeader
+{
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_nSections;
+    uint64_t m_geometryHash;
+    uint64_t m_reserved;
+};
+
+struct SectionEntry
+{
+    char m_name[kNameSize];
+    uint64_t m_offset;
+    uint64_t m_bytes;
+    uint64_t m_checksum;
+};
+
+/// FNV-1a, stable across jobs and builds
+uint64_t Hash(const char *data, size_t bytes, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t HashValue(const T &value, uint64_t hash)
+{
+    return Hash(reinterpret_cast<const char *>(&value), sizeof(T), hash);
+}
+
+/// The wire numbering and the channels come from the sorting and the channel map of the job, not from the GDML file, so
+/// the first, middle and last wire of every plane are hashed with their positions and channels
+uint64_t LayoutHash(const geo::GeometryCore &geometry, uint64_t hash)
+{
+    hash = HashValue(geometry.Nchannels(), hash);
+    for (unsigned int cryostat = 0; cryostat < geometry.Ncryostats(); ++cryostat)
+    {
+        const geo::CryostatID cryostatID(cryostat);
+        for (unsigned int tpc = 0; tpc < geometry.NTPC(cryostatID); ++tpc)
+        {
+            const geo::TPCID tpcID(cryostatID, tpc);
+            for (unsigned int plane = 0; plane < geometry.Nplanes(tpcID); ++plane)
+            {
+                const geo::PlaneID planeID(tpcID, plane);
+                const unsigned int nWires(geometry.Nwires(planeID));
+                hash = HashValue(nWires, hash);
+                if (nWires == 0)
+                    continue;
+
+                for (const unsigned int wire : {0u, nWires / 2, nWires - 1})
+                {
+                    const geo::WireID wireID(planeID, wire);
+                    const geo::Point_t center(geometry.WireIDToWireGeo(wireID).GetCenter());
+                    hash = HashValue(center.X(), hash);
+                    hash = HashValue(center.Y(), hash);
+                    hash = HashValue(center.Z(), hash);
+                    hash = HashValue(geometry.PlaneWireToChannel(wireID), hash);
+                }
+            }
+        }
+    }
+    return hash;
+}
+
+uint64_t GeometryHash(const geo::GeometryCore &geometry)
+{
+    uint64_t hash(Hash(geometry.DetectorName().data(), geometry.DetectorName().size()));
+
+    std::ifstream gdml(geometry.GDMLFile(), std::ios::binary);
+    if (!gdml)
+        return LayoutHash(geometry, Hash(geometry.GDMLFile().data(), geometry.GDMLFile().size(), hash));
+
+    std::vector<char> buffer(1 << 20);
+    while (gdml)
+    {
+        gdml.read(buffer.data(), buffer.size());
+        hash = Hash(buffer.data(), gdml.gcount(), hash);
+    }
+    return LayoutHash(geometry, hash);
+}
+} // namespace
+
+namespace dune_ana
+{
+
+DUNEAnaGeometryCache *DUNEAnaGeometryCache::Get(const std::string &directory)
+{
+    if (directory.empty())
+        return nullptr;
+
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<DUNEAnaGeometryCache>> caches;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<DUNEAnaGeometryCache> &cache(caches[directory]);
+    if (!cache)
+        cache = std::make_unique<DUNEAnaGeometryCache>(directory, *art::ServiceHandle<geo::Geometry const>());
+    return cache.get();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaGeometryCache::DUNEAnaGeometryCache(const std::string &directory, const geo::GeometryCore &geometry) :
+    m_geometryHash(GeometryHash(geometry))
+{
+    std::ostringstream path;
+    path << directory << "/dunereco_geometry_" << std::hex << std::setw(16) << std::setfill('0') << m_geometryHash << ".cache";
+    m_path = path.str();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (this->MapFile())
+        mf::LogInfo("DUNEAnaGeometryCache") << "Mapped " << m_sections.size() << " sections of " << m_path;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaGeometryCache::~DUNEAnaGeometryCache()
+{
+    for (const auto &mapping : m_mappings)
+        ::munmap(mapping.first, mapping.second);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+bool DUNEAnaGeometryCache::MapFile()
+{
+    const int fd(::open(m_path.c_str(), O_RDONLY));
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FileHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size(status.st_size);
+    void *mapping(::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    const char *base(static_cast<const char *>(mapping));
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    bool valid(std::memcmp(header.m_magic, kMagic, sizeof(kMagic)) == 0 && header.m_version == kVersion &&
+        header.m_geometryHash == m_geometryHash && sizeof(FileHeader) + header.m_nSections * sizeof(SectionEntry) <= size);
+
+    std::map<std::string, Section> sections;
+    for (uint32_t iSection = 0; valid && iSection < header.m_nSections; ++iSection)
+    {
+        SectionEntry entry;
+        std::memcpy(&entry, base + sizeof(FileHeader) + iSection * sizeof(SectionEntry), sizeof(entry));
+        entry.m_name[kNameSize - 1] = '\0';
+        valid = entry.m_offset <= size && entry.m_bytes <= size - entry.m_offset &&
+            Hash(base + entry.m_offset, entry.m_bytes) == entry.m_checksum;
+        sections[entry.m_name] = Section{base + entry.m_offset, static_cast<size_t>(entry.m_bytes)};
+    }
+
+    if (!valid)
+    {
+        mf::LogWarning("DUNEAnaGeometryCache") << m_path << " is not a valid cache of this geometry and format, it will be replaced";
+        ::munmap(mapping, size);
+        return false;
+    }
+
+    m_mappings.emplace_back(mapping, size);
+    m_sections.swap(sections);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+const void *DUNEAnaGeometryCache::FindBytes(const std::string &name, size_t &bytes) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto iter(m_sections.find(name));
+    if (iter == m_sections.end())
+        return nullptr;
+
+    bytes = iter->second.m_bytes;
+    return iter->second.m_data;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+void DUNEAnaGeometryCache::AddBytes(const std::string &name, const void *data, size_t bytes)
+{
+    if (name.size() >= kNameSize)
+    {
+        mf::LogWarning("DUNEAnaGeometryCache") << "Section name " << name << " is too long, it is not cached";
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Other jobs may have added sections since the file was mapped
+    this->MapFile();
+
+    std::map<std::string, Section> sections(m_sections);
+    sections[name] = Section{static_cast<const char *>(data), bytes};
+
+    FileHeader header;
+    std::memcpy(header.m_magic, kMagic, sizeof(kMagic));
+    header.m_version = kVersion;
+    header.m_nSections = sections.size();
+    header.m_geometryHash = m_geometryHash;
+    header.m_reserved = 0;
+
+    std::vector<SectionEntry> entries;
+    uint64_t offset(sizeof(FileHeader) + sections.size() * sizeof(SectionEntry));
+    for (const auto &section : sections)
+    {
+        offset = (offset + kAlignment - 1) / kAlignment * kAlignment;
+        SectionEntry entry;
+        std::memset(entry.m_name, 0, kNameSize);
+        std::memcpy(entry.m_name, section.first.data(), section.first.size());
+        entry.m_offset = offset;
+        entry.m_bytes = section.second.m_bytes;
+        entry.m_checksum = Hash(section.second.m_data, section.second.m_bytes);
+        entries.push_back(entry);
+        offset += section.second.m_bytes;
+    }
+
+    // Written next to the file and renamed over it, so no job ever maps a partial file. The temporary name is unique
+    // also between the nodes sharing the directory
+    std::string temporary(m_path + ".tmp.XXXXXX");
+    const int fd(::mkstemp(&temporary[0]));
+    if (fd < 0)
+    {
+        mf::LogWarning("DUNEAnaGeometryCache") << "Could not create a file next to " << m_path << ", " << name << " is not cached";
+        return;
+    }
+    // Readable by the jobs of other users, as the final file
+    ::fchmod(fd, 0644);
+    ::close(fd);
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(SectionEntry));
+
+        uint64_t position(sizeof(FileHeader) + entries.size() * sizeof(SectionEntry));
+        const char padding[kAlignment] = {};
+        size_t iEntry(0);
+        for (const auto &section : sections)
+        {
+            const SectionEntry &entry(entries[iEntry++]);
+            file.write(padding, entry.m_offset - position);
+            file.write(section.second.m_data, section.second.m_bytes);
+            position = entry.m_offset + entry.m_bytes;
+        }
+
+        if (!file)
+        {
+            mf::LogWarning("DUNEAnaGeometryCache") << "Could not write " << temporary << ", " << name << " is not cached";
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), m_path.c_str()) != 0)
+    {
+        mf::LogWarning("DUNEAnaGeometryCache") << "Could not rename " << temporary << " to " << m_path << ", " << name << " is not cached";
+        std::remove(temporary.c_str());
+        return;
+    }
+
+    this->MapFile();
+    mf::LogInfo("DUNEAnaGeometryCache") << "Added " << name << " (" << bytes << " bytes) to " << m_path;
+}
+
+} // namespace dune_ana
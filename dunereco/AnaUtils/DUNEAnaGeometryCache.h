@@ -0,0 +1,136 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaGeometryCache.h
+ *
+ * @brief Binary file of tables derived from the geometry alone, shared by the jobs of a node through read-only mappings
+*/
+
+#ifndef DUNE_ANA_GEOMETRY_CACHE_H
+#define DUNE_ANA_GEOMETRY_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace geo
+{
+class GeometryCore;
+}
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaGeometryCache class
+ *
+ * The file holds named sections of plain data, e.g. lookup tables built by walking every wire of the detector. It is
+ * named after a hash of the GDML file, the detector name and the wire numbering and channels of the geometry, which
+ * follow the sorting and channel map of the job, so a changed geometry gets a new file. It carries a format version and
+ * a checksum of each section, and a file that does not match is replaced. The first job that builds a section adds it, by writing a new file next to the old one and
+ * renaming it over, and later jobs map the file read-only instead of building the section again. Jobs that still map
+ * an older file keep reading it, and the pages of the file are shared by all the jobs of a node.
+ *
+*/
+class DUNEAnaGeometryCache
+{
+public:
+    /**
+    * @brief Get the cache of the geometry service in a directory, opened on first use and shared by every caller of the job
+    *
+    * @param directory the directory of the cache files, empty for no cache
+    *
+    * @return the cache, nullptr if directory is empty
+    */
+    static DUNEAnaGeometryCache *Get(const std::string &directory);
+
+    /**
+    * @brief Constructor, maps the file of the geometry if there is one
+    *
+    * @param directory the directory of the cache files
+    * @param geometry the detector geometry
+    */
+    DUNEAnaGeometryCache(const std::string &directory, const geo::GeometryCore &geometry);
+
+    ~DUNEAnaGeometryCache();
+
+    DUNEAnaGeometryCache(const DUNEAnaGeometryCache &) = delete;
+    DUNEAnaGeometryCache &operator=(const DUNEAnaGeometryCache &) = delete;
+
+    /**
+    * @brief Find a section
+    *
+    * @param name the name of the section
+    * @param data set to the mapped section, valid until the cache is destroyed
+    * @param n set to the number of values of the section
+    *
+    * @return whether the section is cached with a whole number of values
+    */
+    template <typename T>
+    bool Find(const std::string &name, const T *&data, size_t &n) const;
+
+    /**
+    * @brief Add a section to the file, replacing one of the same name
+    *
+    * @param name the name of the section
+    * @param data the values
+    * @param n the number of values
+    */
+    template <typename T>
+    void Add(const std::string &name, const T *data, size_t n);
+
+    /// The cache file
+    const std::string &Path() const { return m_path; }
+
+private:
+    struct Section
+    {
+        const char *m_data;
+        size_t m_bytes;
+    };
+
+    /**
+    * @brief Map the current file, replacing the sections found so far. Needs m_mutex
+    *
+    * @return whether a file of this geometry and format was mapped
+    */
+    bool MapFile();
+
+    const void *FindBytes(const std::string &name, size_t &bytes) const;
+    void AddBytes(const std::string &name, const void *data, size_t bytes);
+
+    std::string m_path;                         ///< the cache file of the geometry
+    uint64_t m_geometryHash;                    ///< hash of the GDML file, detector name, wire numbering and channels
+    mutable std::mutex m_mutex;                 ///< guards the sections and the mappings
+    std::map<std::string, Section> m_sections;  ///< the sections of the last mapped file
+    std::vector<std::pair<void *, size_t>> m_mappings; ///< every file mapped so far, kept for the sections handed out
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline bool DUNEAnaGeometryCache::Find(const std::string &name, const T *&data, size_t &n) const
+{
+    size_t bytes(0);
+    const void *section(this->FindBytes(name, bytes));
+    if (!section || bytes % sizeof(T) != 0)
+        return false;
+
+    data = static_cast<const T *>(section);
+    n = bytes / sizeof(T);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline void DUNEAnaGeometryCache::Add(const std::string &name, const T *data, size_t n)
+{
+    this->AddBytes(name, data, n * sizeof(T));
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_GEOMETRY_CACHE_H
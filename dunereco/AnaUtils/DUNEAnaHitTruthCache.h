@@ -0,0 +1,174 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaHitTruthCache.h
+ *
+ * @brief Cache of the BackTracker TrackIDEs of hits, shared by the truth matching code of one event
+*/
+
+#ifndef DUNE_ANA_HIT_TRUTH_CACHE_H
+#define DUNE_ANA_HIT_TRUTH_CACHE_H
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "lardataalg/DetectorInfo/DetectorClocksData.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "larsim/MCCheater/BackTrackerService.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaHitTruthCache class holding the TrackIDEs of each hit, as given by BackTrackerService::HitToTrackIDEs
+ *
+ * The TrackIDEs of a hit are backtracked once, the first time they are asked for, and shared by every
+ * later lookup. Fill backtracks a whole hit collection up front, so that code looking the hits up later,
+ * possibly from several threads, only reads the cache. A cache is made for one event, with the clocks of
+ * that event, and is handed to all the truth matching code run on it.
+ *
+ * The BackTrackerService is a legacy service and is not thread safe, so the backtracking itself is always
+ * done on the calling thread.
+ *
+*/
+class DUNEAnaHitTruthCache
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param clockData the detector clocks of the event
+     */
+    explicit DUNEAnaHitTruthCache(const detinfo::DetectorClocksData &clockData);
+
+    /**
+     * @brief Backtrack all hits of the collection that are not cached yet
+     *
+     * @param hits the hits
+     */
+    void Fill(const std::vector<art::Ptr<recob::Hit>> &hits);
+
+    /**
+     * @brief Backtrack all hits of the collections that are not cached yet, such as the hits of each spacepoint
+     *
+     * @param hitLists the hit collections, which may share hits
+     */
+    void Fill(const std::vector<std::vector<art::Ptr<recob::Hit>>> &hitLists);
+
+    /**
+     * @brief Get the TrackIDEs of a hit, backtracking it if needed
+     *
+     * @param hit the hit, which must stay alive as long as the cache
+     *
+     * @return the TrackIDEs
+     */
+    const std::vector<sim::TrackIDE> &GetTrackIDEs(const recob::Hit &hit);
+
+    /**
+     * @brief Get the TrackIDEs of a hit, backtracking it if needed
+     *
+     * @param pHit the hit
+     *
+     * @return the TrackIDEs
+     */
+    const std::vector<sim::TrackIDE> &GetTrackIDEs(const art::Ptr<recob::Hit> &pHit);
+
+private:
+    typedef std::vector<std::pair<const recob::Hit *, std::vector<sim::TrackIDE> *>> MissingList;
+
+    /**
+     * @brief Make empty entries for the hits that are not cached yet and list them
+     *
+     * @param hits the hits
+     * @param missing the list to extend
+     */
+    void AddMissing(const std::vector<art::Ptr<recob::Hit>> &hits, MissingList &missing);
+
+    /**
+     * @brief Backtrack the listed hits
+     *
+     * @param missing the hits and their entries
+     */
+    void Backtrack(const MissingList &missing) const;
+
+    detinfo::DetectorClocksData m_clockData;                                       ///< The clocks of the event
+    std::unordered_map<const recob::Hit *, std::vector<sim::TrackIDE>> m_trackIDEs; ///< The TrackIDEs of each hit
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline DUNEAnaHitTruthCache::DUNEAnaHitTruthCache(const detinfo::DetectorClocksData &clockData) :
+    m_clockData(clockData)
+{
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaHitTruthCache::Fill(const std::vector<art::Ptr<recob::Hit>> &hits)
+{
+    MissingList missing;
+    this->AddMissing(hits, missing);
+    this->Backtrack(missing);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaHitTruthCache::Fill(const std::vector<std::vector<art::Ptr<recob::Hit>>> &hitLists)
+{
+    MissingList missing;
+    for (const std::vector<art::Ptr<recob::Hit>> &hits : hitLists)
+        this->AddMissing(hits, missing);
+    this->Backtrack(missing);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaHitTruthCache::AddMissing(const std::vector<art::Ptr<recob::Hit>> &hits, MissingList &missing)
+{
+    // Each hit shared by several collections is only listed once
+    for (const art::Ptr<recob::Hit> &pHit : hits)
+    {
+        auto inserted = m_trackIDEs.emplace(pHit.get(), std::vector<sim::TrackIDE>());
+        if (inserted.second)
+            missing.emplace_back(pHit.get(), &inserted.first->second);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline void DUNEAnaHitTruthCache::Backtrack(const MissingList &missing) const
+{
+    if (missing.empty())
+        return;
+
+    art::ServiceHandle<cheat::BackTrackerService> bt;
+    for (const auto &entry : missing)
+        *entry.second = bt->HitToTrackIDEs(m_clockData, *entry.first);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<sim::TrackIDE> &DUNEAnaHitTruthCache::GetTrackIDEs(const recob::Hit &hit)
+{
+    auto iter = m_trackIDEs.find(&hit);
+    if (iter == m_trackIDEs.end())
+    {
+        art::ServiceHandle<cheat::BackTrackerService> bt;
+        iter = m_trackIDEs.emplace(&hit, bt->HitToTrackIDEs(m_clockData, hit)).first;
+    }
+
+    return iter->second;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<sim::TrackIDE> &DUNEAnaHitTruthCache::GetTrackIDEs(const art::Ptr<recob::Hit> &pHit)
+{
+    return this->GetTrackIDEs(*pHit);
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_HIT_TRUTH_CACHE_H
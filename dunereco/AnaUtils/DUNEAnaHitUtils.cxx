@@ -41,6 +41,59 @@ std::vector<art::Ptr<recob::Hit>> DUNEAnaHitUtils::GetHitsOnPlane(const std::vec
 
 }
 
+std::vector<std::vector<art::Ptr<recob::Hit>>> DUNEAnaHitUtils::GetHitsByPlane(const std::vector<art::Ptr<recob::Hit>> &hits,
+    const unsigned int nPlanes)
+{
+    std::vector<geo::PlaneID::PlaneID_t> planes;
+    planes.reserve(hits.size());
+    std::vector<std::size_t> nHitsOnPlane(nPlanes, 0);
+    for (const art::Ptr<recob::Hit> &hit : hits)
+    {
+        planes.push_back(hit->WireID().Plane);
+        if (planes.back() < nPlanes)
+            ++nHitsOnPlane[planes.back()];
+    }
+
+    std::vector<std::vector<art::Ptr<recob::Hit>>> hitsByPlane(nPlanes);
+    for (unsigned int plane = 0; plane < nPlanes; ++plane)
+        hitsByPlane[plane].reserve(nHitsOnPlane[plane]);
+
+    for (std::size_t iHit = 0; iHit < hits.size(); ++iHit)
+        if (planes[iHit] < nPlanes)
+            hitsByPlane[planes[iHit]].push_back(hits[iHit]);
+
+    return hitsByPlane;
+}
+
+std::vector<art::Ptr<recob::Hit>> DUNEAnaHitUtils::GetHitsOnPlane(const DUNEAnaProductView<recob::Hit> &hits, 
+    const geo::PlaneID::PlaneID_t planeID)
+{
+    std::vector<art::Ptr<recob::Hit>> hitsOnPlane;
+    for (std::size_t iHit = 0; iHit < hits.size(); ++iHit)
+        if (hits[iHit].WireID().Plane==planeID)
+            hitsOnPlane.emplace_back(hits.Ptr(iHit));
+    return hitsOnPlane;
+}
+
+std::vector<art::Ptr<recob::Hit>> DUNEAnaHitUtils::GetHitsOnPlane(const DUNEAnaProductView<recob::Hit> &hits, 
+    const dune::HitIndex &index, const geo::PlaneID::PlaneID_t planeID)
+{
+    std::vector<art::Ptr<recob::Hit>> hitsOnPlane;
+    if (index.NHits() != hits.size())
+        throw cet::exception("DUNEAna") << "DUNEAnaHitUtils::GetHitsOnPlane: the index has " << index.NHits()
+            << " hits, the view " << hits.size();
+
+    for (unsigned int cryostat = 0; cryostat < index.NCryostats(); ++cryostat)
+    {
+        for (unsigned int tpc = 0; tpc < index.NTPCs(); ++tpc)
+        {
+            for (const unsigned int key : index.HitsOnPlane(geo::PlaneID(cryostat, tpc, planeID)))
+                hitsOnPlane.emplace_back(hits.Ptr(key));
+        }
+    }
+    return hitsOnPlane;
+}
+
 double DUNEAnaHitUtils::LifetimeCorrection(detinfo::DetectorClocksData const& clockData,
                                            detinfo::DetectorPropertiesData const& detProp,
                                            const art::Ptr<recob::Hit> &pHit)
@@ -66,9 +119,61 @@ double DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(detinfo::DetectorClocksD
                                                         detinfo::DetectorPropertiesData const& detProp,
                                                         const std::vector<art::Ptr<recob::Hit> > &hits)
 {
-    double totalHitCharge(0);
+    const std::vector<HitCharge> charges(DUNEAnaHitUtils::GetHitCharges(hits));
+    return DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, charges.data(), charges.size());
+}
+
+double DUNEAnaHitUtils::LifetimeCorrection(const DUNEAnaDetectorSnapshot &snapshot, const art::Ptr<recob::Hit> &pHit)
+{
+    return snapshot.LifetimeCorrection(pHit->PeakTime());
+}
+
+double DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(const DUNEAnaDetectorSnapshot &snapshot,
+                                                        const std::vector<art::Ptr<recob::Hit> > &hits)
+{
+    const std::vector<HitCharge> charges(DUNEAnaHitUtils::GetHitCharges(hits));
+    return DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(snapshot, charges.data(), charges.size());
+}
+
+std::vector<DUNEAnaHitUtils::HitCharge> DUNEAnaHitUtils::GetHitCharges(const std::vector<art::Ptr<recob::Hit> > &hits)
+{
+    std::vector<HitCharge> charges(hits.size());
     for (unsigned int iHit = 0; iHit < hits.size(); iHit++)
-        totalHitCharge += hits[iHit]->Integral() * DUNEAnaHitUtils::LifetimeCorrection(clockData, detProp, hits[iHit]);
+    {
+        charges[iHit].m_integral = hits[iHit]->Integral();
+        charges[iHit].m_peakTime = hits[iHit]->PeakTime();
+    }
+
+    return charges;
+}
+
+double DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(detinfo::DetectorClocksData const& clockData,
+                                                        detinfo::DetectorPropertiesData const& detProp,
+                                                        const HitCharge *pCharges, const size_t nHits)
+{
+    // The same arithmetic as LifetimeCorrection, with the clocks and properties read once for the batch
+    const double tpcSamplingRateInMicroS(clockData.TPCClock().TickPeriod());
+    const double tpcTriggerOffsetInTicks(trigger_offset(clockData));
+    const double t0InMicroS(clockData.TriggerTime());
+    const double tauLifetime(detProp.ElectronLifetime());
+
+    double totalHitCharge(0);
+    for (size_t iHit = 0; iHit < nHits; iHit++)
+    {
+        const double timeInTicks(pCharges[iHit].m_peakTime);
+        const double timeCorrectedForT0((timeInTicks - tpcTriggerOffsetInTicks)*tpcSamplingRateInMicroS - t0InMicroS);
+        totalHitCharge += pCharges[iHit].m_integral * std::exp(timeCorrectedForT0/tauLifetime);
+    }
+
+    return totalHitCharge;
+}
+
+double DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(const DUNEAnaDetectorSnapshot &snapshot,
+                                                        const HitCharge *pCharges, const size_t nHits)
+{
+    double totalHitCharge(0);
+    for (size_t iHit = 0; iHit < nHits; iHit++)
+        totalHitCharge += pCharges[iHit].m_integral * snapshot.InterpolatedLifetimeCorrection(pCharges[iHit].m_peakTime);
 
     return totalHitCharge;
 }
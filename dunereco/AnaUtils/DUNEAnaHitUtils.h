@@ -18,7 +18,9 @@
 //LARSOFT
 #include "lardataobj/RecoBase/Hit.h"
 //DUNE
+#include "dunereco/AnaUtils/DUNEAnaDetectorSnapshot.h"
 #include "dunereco/AnaUtils/DUNEAnaUtilsBase.h"
+#include "dunereco/HitFinderDUNE/products/HitIndex.h"
 
 namespace dune_ana
 {
@@ -30,6 +32,15 @@ namespace dune_ana
 class DUNEAnaHitUtils:DUNEAnaUtilsBase
 {
 public:
+    /**
+    * @brief  the integral and peak time of a hit, the input of the batched charge sums
+    */
+    struct HitCharge
+    {
+        float m_integral;   ///< the hit integral
+        float m_peakTime;   ///< the hit peak time in ticks
+    };
+
     /**
     * @brief  Get the space points associated with the hit.
     *
@@ -54,6 +65,40 @@ public:
     static std::vector<art::Ptr<recob::Hit>> GetHitsOnPlane(const std::vector<art::Ptr<recob::Hit>> &hits, 
         const geo::PlaneID::PlaneID_t planeID);
 
+    /**
+    * @brief  Split hits by plane in a single pass, counting the hits of each plane first
+    *
+    * @param  hits the hit vector to be split
+    * @param  nPlanes the number of planes, hits on higher planes are dropped
+    *
+    * @return the hits on each plane, in the order of the input vector, as GetHitsOnPlane gives them
+    */
+    static std::vector<std::vector<art::Ptr<recob::Hit>>> GetHitsByPlane(const std::vector<art::Ptr<recob::Hit>> &hits,
+        const unsigned int nPlanes = 3);
+
+    /**
+    * @brief  Get all hits on a specific plane, making art::Ptrs for those hits only
+    *
+    * @param  hits the view of the event hits to be searched for hits on a specific plane
+    * @param  planeID the requested plane number
+    * 
+    * @return the hit vector containing hits on a specific plane
+    */
+    static std::vector<art::Ptr<recob::Hit>> GetHitsOnPlane(const DUNEAnaProductView<recob::Hit> &hits, 
+        const geo::PlaneID::PlaneID_t planeID);
+
+    /**
+    * @brief  Get all hits on a specific plane from the index of the hits, without going over the other hits
+    *
+    * @param  hits the view of the event hits the index was made from
+    * @param  index the HitIndexMaker index of the hits
+    * @param  planeID the requested plane number
+    * 
+    * @return the hit vector containing hits on a specific plane, by cryostat and TPC then by peak time
+    */
+    static std::vector<art::Ptr<recob::Hit>> GetHitsOnPlane(const DUNEAnaProductView<recob::Hit> &hits, 
+        const dune::HitIndex &index, const geo::PlaneID::PlaneID_t planeID);
+
     /**
     * @brief  get the lifetime correction for a hit, assumes the detector properties GetTriggerOffset is T0
     *
@@ -87,6 +132,60 @@ public:
     static double LifetimeCorrectedTotalHitCharge(detinfo::DetectorClocksData const& clockData,
                                                   detinfo::DetectorPropertiesData const& detProp,
                                                   const std::vector<art::Ptr<recob::Hit> > &hits);
+
+    /**
+    * @brief  get the lifetime correction for a hit from a snapshot of the event, assumes the trigger time is T0
+    *
+    * @param  snapshot the detector snapshot of the event
+    * @param  phit is the hit
+    *
+    * @return the charge normalisation correction
+    */
+    static double LifetimeCorrection(const DUNEAnaDetectorSnapshot &snapshot, const art::Ptr<recob::Hit> &pHit);
+
+    /**
+    * @brief  get the total hit charge, corrected for lifetime with a snapshot of the event
+    *
+    * @param  snapshot the detector snapshot of the event
+    * @param  hits the vector of hits to be summed over
+    *
+    * @return the lifetime corrected total hit charge
+    */
+    static double LifetimeCorrectedTotalHitCharge(const DUNEAnaDetectorSnapshot &snapshot,
+                                                  const std::vector<art::Ptr<recob::Hit> > &hits);
+
+    /**
+    * @brief  copy the integrals and peak times of hits to a contiguous array
+    *
+    * @param  hits the hits
+    *
+    * @return the integral and peak time of each hit
+    */
+    static std::vector<HitCharge> GetHitCharges(const std::vector<art::Ptr<recob::Hit> > &hits);
+
+    /**
+    * @brief  get the total charge of a batch of hits, corrected for lifetime, assumes the trigger time is T0
+    *
+    * @param  pCharges the integral and peak time of each hit
+    * @param  nHits the number of hits
+    *
+    * @return the lifetime corrected total hit charge
+    */
+    static double LifetimeCorrectedTotalHitCharge(detinfo::DetectorClocksData const& clockData,
+                                                  detinfo::DetectorPropertiesData const& detProp,
+                                                  const HitCharge *pCharges, const size_t nHits);
+
+    /**
+    * @brief  get the total charge of a batch of hits, corrected for lifetime with the table of a snapshot of the event
+    *
+    * @param  snapshot the detector snapshot of the event
+    * @param  pCharges the integral and peak time of each hit
+    * @param  nHits the number of hits
+    *
+    * @return the lifetime corrected total hit charge
+    */
+    static double LifetimeCorrectedTotalHitCharge(const DUNEAnaDetectorSnapshot &snapshot,
+                                                  const HitCharge *pCharges, const size_t nHits);
 };
 
 } // namespace dune_ana
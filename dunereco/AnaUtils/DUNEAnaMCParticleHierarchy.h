@@ -0,0 +1,196 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaMCParticleHierarchy.h
+ *
+ * @brief Index of the true particle hierarchy of an event, built once and queried in constant time
+*/
+
+#ifndef DUNE_ANA_MCPARTICLE_HIERARCHY_H
+#define DUNE_ANA_MCPARTICLE_HIERARCHY_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+
+#include "larsim/MCCheater/ParticleInventoryService.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaMCParticleHierarchy class indexing the mother links of the particles of a sim::ParticleList
+ *
+ * The particles are addressed by their index in the list, in track ID order. The mother of every particle, the
+ * primary at the top of its hierarchy and its depth below that primary are worked out in one pass, so walking up
+ * the hierarchy needs no more lookups in the list. A particle whose mother is not in the list, as when the
+ * simulation dropped it, is treated as a primary. The class is header only so that the CVN utilities, which the
+ * AnaUtils library depends on, can use it too.
+ *
+*/
+class DUNEAnaMCParticleHierarchy
+{
+public:
+    /// Index returned when there is no such particle
+    static constexpr std::size_t kInvalidIndex = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Constructor
+     *
+     * @param particles the list of true particles, the entries without a particle are skipped
+     */
+    explicit DUNEAnaMCParticleHierarchy(const sim::ParticleList &particles);
+
+    /**
+     * @brief Get the hierarchy of the particles of the ParticleInventoryService, built the first time it is asked for in an event
+     *
+     * @param evt is the underlying art event
+     *
+     * @return the hierarchy, shared with the per-thread cache that drops it when a different event is seen
+     */
+    static std::shared_ptr<const DUNEAnaMCParticleHierarchy> Get(const art::Event &evt);
+
+    std::size_t NParticles() const { return m_particles.size(); }
+
+    /**
+     * @brief Get the index of the particle with the given track ID, kInvalidIndex if there is none
+     */
+    std::size_t GetIndex(const int trackID) const;
+
+    /**
+     * @brief Get a particle
+     */
+    const simb::MCParticle &GetParticle(const std::size_t index) const { return *m_particles.at(index); }
+
+    /**
+     * @brief Get the index of the mother, kInvalidIndex for primaries
+     */
+    std::size_t GetMotherIndex(const std::size_t index) const { return m_mother.at(index); }
+
+    /**
+     * @brief Get the index of the primary particle at the top of the hierarchy
+     */
+    std::size_t GetPrimaryIndex(const std::size_t index) const { return m_primary.at(index); }
+
+    /**
+     * @brief Get the number of steps below the primary particle, 0 for primaries
+     */
+    unsigned int GetDepth(const std::size_t index) const { return m_depth.at(index); }
+
+private:
+    std::unordered_map<int, std::size_t> m_trackIDToIndex;
+    std::vector<const simb::MCParticle *> m_particles;
+    std::vector<std::size_t> m_mother;
+    std::vector<std::size_t> m_primary;
+    std::vector<unsigned int> m_depth;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline DUNEAnaMCParticleHierarchy::DUNEAnaMCParticleHierarchy(const sim::ParticleList &particles)
+{
+    m_particles.reserve(particles.size());
+    m_trackIDToIndex.reserve(particles.size());
+    for (const auto &entry : particles)
+    {
+        if (!entry.second)
+            continue;
+
+        m_trackIDToIndex[entry.first] = m_particles.size();
+        m_particles.push_back(entry.second);
+    }
+
+    const std::size_t nParticles(m_particles.size());
+    m_mother.assign(nParticles, kInvalidIndex);
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+    {
+        if (m_particles[iPart]->Mother() != 0)
+            m_mother[iPart] = this->GetIndex(m_particles[iPart]->Mother());
+    }
+
+    // Resolve each particle by walking up to the first particle already resolved, then filling in the
+    // walked path on the way back down, so every particle is walked over once. Mothers need not come
+    // first in the list
+    m_primary.assign(nParticles, kInvalidIndex);
+    m_depth.assign(nParticles, 0);
+    std::vector<std::size_t> path;
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+    {
+        std::size_t index(iPart);
+        while ((m_primary[index] == kInvalidIndex) && (path.size() <= nParticles))
+        {
+            path.push_back(index);
+            if (m_mother[index] == kInvalidIndex)
+            {
+                m_primary[index] = index;
+                path.pop_back();
+                break;
+            }
+            index = m_mother[index];
+        }
+
+        // A loop of mother links, which the simulation should never make, leaves the particle as its own primary
+        if (path.size() > nParticles)
+        {
+            for (const std::size_t looped : path)
+                m_primary[looped] = looped;
+            path.clear();
+            continue;
+        }
+
+        while (!path.empty())
+        {
+            const std::size_t daughter(path.back());
+            m_primary[daughter] = m_primary[m_mother[daughter]];
+            m_depth[daughter] = m_depth[m_mother[daughter]] + 1;
+            path.pop_back();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::shared_ptr<const DUNEAnaMCParticleHierarchy> DUNEAnaMCParticleHierarchy::Get(const art::Event &evt)
+{
+    struct Store
+    {
+        art::EventID m_eventID;
+        std::size_t m_nParticles = 0;
+        std::shared_ptr<const DUNEAnaMCParticleHierarchy> m_hierarchy;
+    };
+
+    // As for DUNEAnaAssocCache, each thread keeps its own hierarchy so no locking is needed, and
+    // callers share ownership so a nested task moving the store on to another event cannot pull it away
+    thread_local Store store;
+
+    art::ServiceHandle<cheat::ParticleInventoryService> pi;
+    const sim::ParticleList &particles(pi->ParticleList());
+
+    // The size of the list also catches different events that happen to share an event ID
+    if (!store.m_hierarchy || (store.m_eventID != evt.id()) || (store.m_nParticles != particles.size()))
+    {
+        store.m_eventID = evt.id();
+        store.m_nParticles = particles.size();
+        store.m_hierarchy = std::make_shared<const DUNEAnaMCParticleHierarchy>(particles);
+    }
+
+    return store.m_hierarchy;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::size_t DUNEAnaMCParticleHierarchy::GetIndex(const int trackID) const
+{
+    auto iter = m_trackIDToIndex.find(trackID);
+    return iter == m_trackIDToIndex.end() ? kInvalidIndex : iter->second;
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_MCPARTICLE_HIERARCHY_H
@@ -0,0 +1,155 @@
+/**
+*
+* @file dunereco/AnaUtils/DUNEAnaPFParticleHierarchy.cxx
+*
+* @brief Index of the PFParticle hierarchy of an event, built once and queried in constant time
+*/
+
+#include "dunereco/AnaUtils/DUNEAnaPFParticleHierarchy.h"
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+
+namespace dune_ana
+{
+
+DUNEAnaPFParticleHierarchy::DUNEAnaPFParticleHierarchy(const art::Handle<std::vector<recob::PFParticle>> &particles) :
+    m_handle(particles)
+{
+    const std::size_t nParticles(particles.isValid() ? particles->size() : 0);
+
+    m_idToIndex.reserve(nParticles);
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+        m_idToIndex[(*particles)[iPart].Self()] = iPart;
+
+    // Parents without a particle in the collection are treated as primaries
+    m_parent.assign(nParticles, kInvalidIndex);
+    m_childBegin.assign(nParticles + 1, 0);
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+    {
+        const recob::PFParticle &particle((*particles)[iPart]);
+        if (particle.IsPrimary())
+            continue;
+
+        m_parent[iPart] = this->GetIndex(particle.Parent());
+        if (m_parent[iPart] != kInvalidIndex)
+            ++m_childBegin[m_parent[iPart] + 1];
+    }
+
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+        m_childBegin[iPart + 1] += m_childBegin[iPart];
+
+    // Filling in collection order keeps the children of each parent in that order too
+    m_children.resize(m_childBegin[nParticles]);
+    std::vector<std::size_t> fill(m_childBegin.begin(), m_childBegin.end() - 1);
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+        if (m_parent[iPart] != kInvalidIndex)
+            m_children[fill[m_parent[iPart]]++] = iPart;
+
+    // Walk down from the primaries, so the particles need not come parents first. Particles in a
+    // loop of parent links are never reached and keep kInvalidIndex as their primary
+    m_depth.assign(nParticles, 0);
+    m_primary.assign(nParticles, kInvalidIndex);
+    std::vector<std::size_t> queue;
+    queue.reserve(nParticles);
+    for (std::size_t iPart = 0; iPart < nParticles; ++iPart)
+    {
+        if (m_parent[iPart] != kInvalidIndex)
+            continue;
+
+        m_primary[iPart] = iPart;
+        queue.push_back(iPart);
+
+        const int pdg((*particles)[iPart].PdgCode());
+        if ((std::abs(pdg) == 12) || (std::abs(pdg) == 14) || (std::abs(pdg) == 16))
+            m_neutrinos.push_back(iPart);
+    }
+
+    for (std::size_t iQueue = 0; iQueue < queue.size(); ++iQueue)
+    {
+        const std::size_t parent(queue[iQueue]);
+        for (const std::size_t *pChild = this->ChildrenBegin(parent); pChild != this->ChildrenEnd(parent); ++pChild)
+        {
+            m_depth[*pChild] = m_depth[parent] + 1;
+            m_primary[*pChild] = m_primary[parent];
+            queue.push_back(*pChild);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const DUNEAnaPFParticleHierarchy> DUNEAnaPFParticleHierarchy::Get(const art::Event &evt, const std::string &label)
+{
+    struct Entry
+    {
+        const void *m_products;
+        std::shared_ptr<const DUNEAnaPFParticleHierarchy> m_hierarchy;
+    };
+    struct Store
+    {
+        art::EventID m_eventID;
+        std::map<std::string, Entry> m_entries;
+    };
+
+    // As for DUNEAnaAssocCache, each thread keeps its own hierarchies so no locking is needed, and
+    // callers share ownership so a nested task moving the store on to another event cannot pull them away
+    thread_local Store store;
+    if (store.m_eventID != evt.id())
+    {
+        store.m_entries.clear();
+        store.m_eventID = evt.id();
+    }
+
+    auto particles = evt.getHandle<std::vector<recob::PFParticle>>(label);
+    if (!particles.isValid())
+        mf::LogError("DUNEAna") << " Failed to find product with label " << label << " ... returning empty hierarchy" << std::endl;
+
+    // The product pointer also catches different events that happen to share an event ID
+    const void *pProducts = particles.isValid() ? particles.product() : nullptr;
+    Entry &entry = store.m_entries[label];
+    if (!entry.m_hierarchy || entry.m_products != pProducts)
+    {
+        entry.m_products = pProducts;
+        entry.m_hierarchy = std::make_shared<const DUNEAnaPFParticleHierarchy>(particles);
+    }
+
+    return entry.m_hierarchy;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t DUNEAnaPFParticleHierarchy::GetIndex(const std::size_t id) const
+{
+    auto iter = m_idToIndex.find(id);
+    return iter == m_idToIndex.end() ? kInvalidIndex : iter->second;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<art::Ptr<recob::PFParticle>> DUNEAnaPFParticleHierarchy::GetChildParticles(const std::size_t index) const
+{
+    std::vector<art::Ptr<recob::PFParticle>> children;
+    children.reserve(this->NChildren(index));
+    for (const std::size_t *pChild = this->ChildrenBegin(index); pChild != this->ChildrenEnd(index); ++pChild)
+        children.emplace_back(m_handle, *pChild);
+
+    return children;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t DUNEAnaPFParticleHierarchy::GetNeutrinoIndex(const std::size_t index) const
+{
+    const std::size_t primary(m_primary.at(index));
+    if (primary == kInvalidIndex)
+        return kInvalidIndex;
+
+    const int pdg((*m_handle)[primary].PdgCode());
+    return ((std::abs(pdg) == 12) || (std::abs(pdg) == 14) || (std::abs(pdg) == 16)) ? primary : kInvalidIndex;
+}
+
+} // namespace dune_ana
@@ -0,0 +1,127 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaPFParticleHierarchy.h
+ *
+ * @brief Index of the PFParticle hierarchy of an event, built once and queried in constant time
+*/
+
+#ifndef DUNE_ANA_PFPARTICLE_HIERARCHY_H
+#define DUNE_ANA_PFPARTICLE_HIERARCHY_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+
+#include "lardataobj/RecoBase/PFParticle.h"
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaPFParticleHierarchy class indexing the parent/child links of a PFParticle collection
+ *
+ * The particles are addressed by their index in the collection, the key of their art::Ptr. The links in
+ * the collection use the particle IDs, recob::PFParticle::Self, so these are mapped to indices once. The
+ * children of every particle are kept in one flat array, in collection order, with an offset per parent.
+ * The depth below the primary particle and the primary neutrino at the top of the hierarchy are worked
+ * out for every particle in the same pass.
+ *
+*/
+class DUNEAnaPFParticleHierarchy
+{
+public:
+    /// Index returned when there is no such particle
+    static constexpr std::size_t kInvalidIndex = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Constructor
+     *
+     * @param particles handle to the PFParticle collection, an invalid handle gives an empty hierarchy
+     */
+    explicit DUNEAnaPFParticleHierarchy(const art::Handle<std::vector<recob::PFParticle>> &particles);
+
+    /**
+     * @brief Get the hierarchy of the PFParticles with the given label, built the first time it is asked for in an event
+     *
+     * @param evt is the underlying art event
+     * @param label is the label for the PFParticle producer
+     *
+     * @return the hierarchy, shared with the per-thread cache that drops it when a different event is seen
+     */
+    static std::shared_ptr<const DUNEAnaPFParticleHierarchy> Get(const art::Event &evt, const std::string &label);
+
+    std::size_t NParticles() const { return m_parent.size(); }
+
+    /**
+     * @brief Get the index of the particle with the given ID, kInvalidIndex if there is none
+     */
+    std::size_t GetIndex(const std::size_t id) const;
+
+    /**
+     * @brief Get the index of the parent, kInvalidIndex for primaries
+     */
+    std::size_t GetParentIndex(const std::size_t index) const { return m_parent.at(index); }
+
+    /**
+     * @brief Get the number of children of a particle
+     */
+    std::size_t NChildren(const std::size_t index) const { return m_childBegin.at(index + 1) - m_childBegin.at(index); }
+
+    /**
+     * @brief Get the indices of the children of a particle, begin and end of a range in collection order
+     */
+    const std::size_t *ChildrenBegin(const std::size_t index) const { return m_children.data() + m_childBegin.at(index); }
+    const std::size_t *ChildrenEnd(const std::size_t index) const { return m_children.data() + m_childBegin.at(index + 1); }
+
+    /**
+     * @brief Get the art::Ptrs to the children of a particle
+     */
+    std::vector<art::Ptr<recob::PFParticle>> GetChildParticles(const std::size_t index) const;
+
+    /**
+     * @brief Get the number of steps below the primary particle, 0 for primaries
+     */
+    unsigned int GetDepth(const std::size_t index) const { return m_depth.at(index); }
+
+    /**
+     * @brief Get the index of the primary particle at the top of the hierarchy
+     */
+    std::size_t GetPrimaryIndex(const std::size_t index) const { return m_primary.at(index); }
+
+    /**
+     * @brief Get the index of the primary neutrino at the top of the hierarchy, kInvalidIndex if the primary is not a neutrino
+     */
+    std::size_t GetNeutrinoIndex(const std::size_t index) const;
+
+    /**
+     * @brief Get the indices of the primary neutrinos, in collection order
+     */
+    const std::vector<std::size_t> &GetPrimaryNeutrinos() const { return m_neutrinos; }
+
+    /**
+     * @brief Get the art::Ptr to a particle
+     */
+    art::Ptr<recob::PFParticle> GetParticle(const std::size_t index) const { return art::Ptr<recob::PFParticle>(m_handle, index); }
+
+private:
+    art::Handle<std::vector<recob::PFParticle>> m_handle;
+    std::unordered_map<std::size_t, std::size_t> m_idToIndex;
+    std::vector<std::size_t> m_parent;
+    std::vector<std::size_t> m_childBegin;   ///< Offsets into m_children, one per particle plus the end
+    std::vector<std::size_t> m_children;
+    std::vector<unsigned int> m_depth;
+    std::vector<std::size_t> m_primary;
+    std::vector<std::size_t> m_neutrinos;
+};
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_PFPARTICLE_HIERARCHY_H
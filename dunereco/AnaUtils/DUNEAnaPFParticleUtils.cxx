@@ -6,6 +6,7 @@
 */
 
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaPFParticleHierarchy.h"
 
 #include "cetlib_except/exception.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -42,27 +43,13 @@ std::vector<art::Ptr<anab::CosmicTag>> DUNEAnaPFParticleUtils::GetCosmicTag(cons
 
 std::vector<art::Ptr<recob::PFParticle>> DUNEAnaPFParticleUtils::GetChildParticles(const art::Ptr<recob::PFParticle> &pParticle, const art::Event &evt, const std::string &label)
 {
-    auto theseParticles = evt.getHandle<std::vector<recob::PFParticle>>(label);
-    bool success = theseParticles.isValid();
-    
-    if (!success)
-    {   
-        mf::LogError("LArPandora") << " Failed to find product with label " << label << " ... returning empty vector" << std::endl;
+    // The hierarchy is indexed once per event, rather than the collection scanned for each parent
+    const auto pHierarchy = DUNEAnaPFParticleHierarchy::Get(evt,label);
+    const DUNEAnaPFParticleHierarchy &hierarchy = *pHierarchy;
+    if (pParticle.key() >= hierarchy.NParticles())
         return std::vector<art::Ptr<recob::PFParticle>>();
-    }
-    
-    std::vector<art::Ptr<recob::PFParticle>> children;
-
-    for (unsigned int iPart = 0; iPart < theseParticles->size(); ++iPart)
-    {     
-        if (theseParticles->at(iPart).Parent() == pParticle.key())
-        {
-            art::Ptr<recob::PFParticle> pChild(theseParticles,iPart);
-            children.push_back(pChild);
-        }
-    }
 
-    return children;
+    return hierarchy.GetChildParticles(pParticle.key());
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
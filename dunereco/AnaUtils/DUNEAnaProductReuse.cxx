@@ -0,0 +1,106 @@
+/**
+*
+* @file dunereco/AnaUtils/DUNEAnaProductReuse.cxx
+*
+* @brief Reuse of the products a producer already made in an earlier pass over the same files
+*/
+
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
+
+#include "fhiclcpp/ParameterSetRegistry.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+namespace
+{
+/// The parameters steering the reuse, which never have to match
+const std::vector<std::string> kReuseKeys = {"ReuseExisting", "ReuseProcess", "ReuseMatch", "ReuseModelKeys"};
+} // namespace
+
+namespace dune_ana
+{
+
+DUNEAnaProductReuse::DUNEAnaProductReuse(const fhicl::ParameterSet &pset) :
+    m_enabled(pset.get<bool>("ReuseExisting", false)),
+    m_moduleLabel(pset.get<std::string>("module_label", "")),
+    m_process(pset.get<std::string>("ReuseProcess", "")),
+    m_modelOnly(false),
+    m_modelKeys(pset.get<std::vector<std::string>>("ReuseModelKeys", {}))
+{
+    const std::string match(pset.get<std::string>("ReuseMatch", "ParameterSet"));
+    if (match == "Model")
+        m_modelOnly = true;
+    else if (match != "ParameterSet")
+        throw cet::exception("DUNEAnaProductReuse") << "Unknown ReuseMatch " << match << ", use ParameterSet or Model";
+
+    if (m_modelOnly && m_modelKeys.empty())
+        throw cet::exception("DUNEAnaProductReuse") << "ReuseMatch Model needs the ReuseModelKeys naming the model parameters";
+
+    if (m_enabled && m_moduleLabel.empty())
+        throw cet::exception("DUNEAnaProductReuse") << "ReuseExisting needs the module_label of the configuration";
+
+    m_reducedID = this->Reduce(pset).id();
+
+    if (m_enabled)
+    {
+        mf::LogInfo("DUNEAnaProductReuse") << m_moduleLabel << " reuses the products of "
+                                           << (m_process.empty() ? "the latest process" : m_process)
+                                           << " made with the same " << (m_modelOnly ? "model" : "configuration");
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+bool DUNEAnaProductReuse::MatchesAny(const std::set<fhicl::ParameterSetID> &psetIDs) const
+{
+    for (const fhicl::ParameterSetID &psetID : psetIDs)
+    {
+        fhicl::ParameterSet pset;
+        if (fhicl::ParameterSetRegistry::get(psetID, pset) && this->Reduce(pset).id() == m_reducedID)
+            return true;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+bool DUNEAnaProductReuse::SameInputs(const art::Event &evt, const std::vector<art::ProductID> &parents) const
+{
+    for (const InputCheck &check : m_inputChecks)
+    {
+        if (!check(evt, parents))
+            return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+fhicl::ParameterSet DUNEAnaProductReuse::Reduce(const fhicl::ParameterSet &pset) const
+{
+    if (!m_modelOnly)
+    {
+        fhicl::ParameterSet reduced(pset);
+        for (const std::string &key : kReuseKeys)
+            reduced.erase(key);
+        return reduced;
+    }
+
+    // The model parameters are stored under their position, so dotted keys of nested tables can be named
+    fhicl::ParameterSet reduced;
+    for (size_t i = 0; i < m_modelKeys.size(); ++i)
+    {
+        const std::string &key(m_modelKeys[i]);
+        const std::string name("key" + std::to_string(i));
+        if (!pset.has_key(key))
+            reduced.put(name, std::string("<absent>"));
+        else if (pset.is_key_to_table(key))
+            reduced.put(name, pset.get<fhicl::ParameterSet>(key));
+        else if (pset.is_key_to_sequence(key))
+            reduced.put(name, pset.get<std::vector<std::string>>(key));
+        else
+            reduced.put(name, pset.get<std::string>(key));
+    }
+    return reduced;
+}
+
+} // namespace dune_ana
@@ -0,0 +1,224 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaProductReuse.h
+ *
+ * @brief Reuse of the products a producer already made in an earlier pass over the same files
+*/
+
+#ifndef DUNE_ANA_PRODUCT_REUSE_H
+#define DUNE_ANA_PRODUCT_REUSE_H
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Provenance.h"
+#include "canvas/Persistency/Common/Assns.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Utilities/InputTag.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "fhiclcpp/ParameterSetID.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaProductReuse class forwarding the products of an earlier pass of a producer instead of recomputing them
+ *
+ * With ReuseExisting set, a producer first looks in the event for the products of its own module label made by an
+ * earlier process (ReuseProcess, or the latest one when empty). A product is reused when the configuration of the
+ * module that made it matches the current one:
+ *   - ReuseMatch "ParameterSet": the whole module configuration, apart from the Reuse* parameters themselves
+ *   - ReuseMatch "Model": only the parameters named in ReuseModelKeys, e.g. the model files and their handler tables
+ * The reused products are copied into the current process, and the associations are rebuilt to point at the copies.
+ *
+ * A matching configuration says nothing about the inputs, so the producer also names the products it reads with
+ * AddInput. A product is only reused when each of them is, by ProductID, one of its parents. An input made again in
+ * the current process, or taken from a different process than before, therefore always gets the products recomputed.
+ * Only the inputs named are checked: products reached through associations or services, and anything the earlier
+ * pass read without recording it as a parent, are not.
+ *
+*/
+class DUNEAnaProductReuse
+{
+public:
+    /**
+     * @brief Read the Reuse* parameters of the module configuration
+     *
+     * @param  pset the module configuration
+     */
+    explicit DUNEAnaProductReuse(const fhicl::ParameterSet &pset);
+
+    /**
+     * @brief Whether reuse was asked for
+     */
+    bool Enabled() const { return m_enabled; }
+
+    /**
+     * @brief Name a product of type I the producer reads, which has to be a parent of the products to reuse
+     *
+     * @param  tag the input tag the producer reads it with
+     */
+    template <typename I>
+    void AddInput(const art::InputTag &tag);
+
+    /**
+     * @brief Whether the event holds a product of type T with a matching configuration
+     *
+     * @param  evt the art event
+     * @param  instance the product instance name
+     */
+    template <typename T>
+    bool Matches(const art::Event &evt, const std::string &instance = "") const;
+
+    /**
+     * @brief Copy the matching product of type T into the current process, throws if there is none
+     *
+     * @param  evt the art event
+     * @param  instance the product instance name
+     */
+    template <typename T>
+    void Forward(art::Event &evt, const std::string &instance = "") const;
+
+    /**
+     * @brief Copy the associations between A and B, pointing the ends that were in the product of type P,
+     *        forwarded first, at its copy
+     *
+     * @param  evt the art event
+     * @param  instance the product instance name of both the associations and P
+     */
+    template <typename A, typename B, typename P>
+    void ForwardAssns(art::Event &evt, const std::string &instance = "") const;
+
+private:
+    template <typename T>
+    art::Handle<T> Find(const art::Event &evt, const std::string &instance) const;
+
+    template <typename T>
+    static art::Ptr<T> Remap(const art::Ptr<T> &ptr, const art::ProductID &oldID, const art::ProductID &newID,
+        const art::EDProductGetter *pGetter);
+
+    /**
+     * @brief Whether one of the configurations of the modules that made a product matches the current one
+     */
+    bool MatchesAny(const std::set<fhicl::ParameterSetID> &psetIDs) const;
+
+    /**
+     * @brief Whether the reused product, made by the module configuration, was made from the inputs the event holds now
+     */
+    template <typename T>
+    bool Reusable(const art::Event &evt, const art::Handle<T> &handle) const;
+
+    /**
+     * @brief Whether every input named with AddInput is among the parents of a product
+     */
+    bool SameInputs(const art::Event &evt, const std::vector<art::ProductID> &parents) const;
+
+    typedef std::function<bool(const art::Event &, const std::vector<art::ProductID> &)> InputCheck;
+
+    /**
+     * @brief The part of a module configuration that has to match
+     */
+    fhicl::ParameterSet Reduce(const fhicl::ParameterSet &pset) const;
+
+    bool                     m_enabled;     ///< Whether to reuse at all
+    std::string              m_moduleLabel; ///< The label of the products to reuse
+    std::string              m_process;     ///< The process that made them, empty for the latest
+    bool                     m_modelOnly;   ///< Match only the m_modelKeys
+    std::vector<std::string> m_modelKeys;   ///< The parameters identifying the model
+    fhicl::ParameterSetID    m_reducedID;   ///< The ID of the reduced current configuration
+    std::vector<InputCheck>  m_inputChecks; ///< One per input named with AddInput
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename I>
+void DUNEAnaProductReuse::AddInput(const art::InputTag &tag)
+{
+    m_inputChecks.push_back([tag](const art::Event &evt, const std::vector<art::ProductID> &parents) {
+        const art::Handle<I> handle(evt.getHandle<I>(tag));
+        return handle.isValid() && std::find(parents.begin(), parents.end(), handle.id()) != parents.end();
+    });
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+bool DUNEAnaProductReuse::Matches(const art::Event &evt, const std::string &instance) const
+{
+    if (!m_enabled)
+        return false;
+
+    return this->Reusable(evt, this->Find<T>(evt, instance));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+void DUNEAnaProductReuse::Forward(art::Event &evt, const std::string &instance) const
+{
+    const art::Handle<T> handle(this->Find<T>(evt, instance));
+    if (!this->Reusable(evt, handle))
+        throw cet::exception("DUNEAnaProductReuse") << "No product of " << m_moduleLabel << ":" << instance
+                                                    << " with a matching configuration and inputs to reuse";
+
+    evt.put(std::make_unique<T>(*handle), instance);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename A, typename B, typename P>
+void DUNEAnaProductReuse::ForwardAssns(art::Event &evt, const std::string &instance) const
+{
+    const art::Handle<art::Assns<A, B>> assnsHandle(this->Find<art::Assns<A, B>>(evt, instance));
+    const art::Handle<P> productHandle(this->Find<P>(evt, instance));
+    if (!assnsHandle.isValid() || !productHandle.isValid())
+        throw cet::exception("DUNEAnaProductReuse") << "No associations of " << m_moduleLabel << ":" << instance
+                                                    << " to reuse";
+
+    const art::ProductID oldID(productHandle.id());
+    const art::ProductID newID(evt.getProductID<P>(instance));
+    const art::EDProductGetter *pGetter(evt.productGetter(newID));
+
+    auto assns(std::make_unique<art::Assns<A, B>>());
+    for (const auto &assn : *assnsHandle)
+        assns->addSingle(Remap(assn.first, oldID, newID, pGetter), Remap(assn.second, oldID, newID, pGetter));
+
+    evt.put(std::move(assns), instance);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+bool DUNEAnaProductReuse::Reusable(const art::Event &evt, const art::Handle<T> &handle) const
+{
+    return handle.isValid() && this->MatchesAny(handle.provenance()->psetIDs()) &&
+        this->SameInputs(evt, handle.provenance()->parents());
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+art::Handle<T> DUNEAnaProductReuse::Find(const art::Event &evt, const std::string &instance) const
+{
+    return evt.getHandle<T>(art::InputTag(m_moduleLabel, instance, m_process));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+art::Ptr<T> DUNEAnaProductReuse::Remap(const art::Ptr<T> &ptr, const art::ProductID &oldID, const art::ProductID &newID,
+    const art::EDProductGetter *pGetter)
+{
+    return ptr.id() == oldID ? art::Ptr<T>(newID, ptr.key(), pGetter) : ptr;
+}
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_PRODUCT_REUSE_H
@@ -0,0 +1,137 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaProductView.h
+ *
+ * @brief Read only view of a product collection in the event, without a copy
+*/
+
+#ifndef DUNE_ANA_PRODUCT_VIEW_H
+#define DUNE_ANA_PRODUCT_VIEW_H
+
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief DUNEAnaProductView class giving direct access to the objects of a product collection
+ *
+ * The view only holds the art::Handle, so getting one costs nothing however large the collection is.
+ * Iterating it gives const references to the objects themselves, and art::Ptrs are only made for the
+ * objects that ask for one, either one at a time with Ptr or lazily through Ptrs. A view of a product
+ * that could not be found is empty.
+ *
+*/
+template <typename T>
+class DUNEAnaProductView
+{
+public:
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    /**
+     * @brief Range over the collection yielding an art::Ptr for each object as it is reached
+     */
+    class PtrRange
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef art::Ptr<T> value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef void pointer;
+            typedef art::Ptr<T> reference;
+
+            const_iterator(const art::Handle<std::vector<T>> *pHandle, std::size_t index) : m_pHandle(pHandle), m_index(index) {}
+
+            art::Ptr<T> operator*() const { return art::Ptr<T>(*m_pHandle, m_index); }
+            art::Ptr<T> operator[](difference_type n) const { return art::Ptr<T>(*m_pHandle, m_index + n); }
+            const_iterator &operator++() { ++m_index; return *this; }
+            const_iterator operator++(int) { const_iterator old(*this); ++m_index; return old; }
+            const_iterator &operator--() { --m_index; return *this; }
+            const_iterator operator--(int) { const_iterator old(*this); --m_index; return old; }
+            const_iterator &operator+=(difference_type n) { m_index += n; return *this; }
+            const_iterator &operator-=(difference_type n) { m_index -= n; return *this; }
+            const_iterator operator+(difference_type n) const { return const_iterator(m_pHandle, m_index + n); }
+            const_iterator operator-(difference_type n) const { return const_iterator(m_pHandle, m_index - n); }
+            difference_type operator-(const const_iterator &other) const { return difference_type(m_index) - difference_type(other.m_index); }
+            bool operator==(const const_iterator &other) const { return m_index == other.m_index; }
+            bool operator!=(const const_iterator &other) const { return m_index != other.m_index; }
+            bool operator<(const const_iterator &other) const { return m_index < other.m_index; }
+
+        private:
+            const art::Handle<std::vector<T>> *m_pHandle;
+            std::size_t m_index;
+        };
+
+        PtrRange(const art::Handle<std::vector<T>> &handle, std::size_t size) : m_handle(handle), m_size(size) {}
+
+        const_iterator begin() const { return const_iterator(&m_handle, 0); }
+        const_iterator end() const { return const_iterator(&m_handle, m_size); }
+        std::size_t size() const { return m_size; }
+
+    private:
+        const art::Handle<std::vector<T>> &m_handle;
+        std::size_t m_size;
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param handle the handle of the collection, may be invalid
+     */
+    explicit DUNEAnaProductView(const art::Handle<std::vector<T>> &handle) : m_handle(handle) {}
+
+    /**
+     * @brief Whether the product was found
+     */
+    bool isValid() const { return m_handle.isValid(); }
+
+    std::size_t size() const { return this->isValid() ? m_handle->size() : 0; }
+    bool empty() const { return this->size() == 0; }
+
+    const_iterator begin() const { return this->isValid() ? m_handle->cbegin() : const_iterator(); }
+    const_iterator end() const { return this->isValid() ? m_handle->cend() : const_iterator(); }
+
+    const T &operator[](std::size_t index) const { return (*m_handle)[index]; }
+
+    /**
+     * @brief Get the art::Ptr to one object
+     *
+     * @param index the index of the object in the collection
+     *
+     * @return the art::Ptr
+     */
+    art::Ptr<T> Ptr(std::size_t index) const { return art::Ptr<T>(m_handle, index); }
+
+    /**
+     * @brief Get a range making the art::Ptrs on the fly. It must not outlive the view
+     */
+    PtrRange Ptrs() const { return PtrRange(m_handle, this->size()); }
+
+    /**
+     * @brief Get the art::Ptrs to every object, as the vector returning getters do
+     */
+    std::vector<art::Ptr<T>> PtrVector() const
+    {
+        std::vector<art::Ptr<T>> ptrs;
+        if (this->isValid())
+            art::fill_ptr_vector(ptrs, m_handle);
+        return ptrs;
+    }
+
+    const art::Handle<std::vector<T>> &GetHandle() const { return m_handle; }
+
+private:
+    art::Handle<std::vector<T>> m_handle;
+};
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_PRODUCT_VIEW_H
@@ -13,6 +13,9 @@
 #include "canvas/Persistency/Common/FindManyP.h"
 #include "canvas/Persistency/Common/Ptr.h"
 
+#include "dunereco/AnaUtils/DUNEAnaAssocCache.h"
+#include "dunereco/AnaUtils/DUNEAnaProductView.h"
+
 #include <string>
 #include <vector>
 
@@ -27,6 +30,7 @@ class DUNEAnaUtilsBase
 {
 protected:
     template <typename T> static std::vector<art::Ptr<T>> GetProductVector(const art::Event &evt, const std::string &label);
+    template <typename T> static DUNEAnaProductView<T> GetProductView(const art::Event &evt, const std::string &label);
     template <typename T, typename U> static std::vector<art::Ptr<T>> GetAssocProductVector(const art::Ptr<U> &part, const art::Event &evt, const std::string &label, const std::string &assocLabel);
     template <typename T, typename U> static art::Ptr<T> GetAssocProduct(const art::Ptr<U> &part, const art::Event &evt, const std::string &label, const std::string &assocLabel); 
 };
@@ -50,6 +54,17 @@ template <typename T> std::vector<art::Ptr<T>> DUNEAnaUtilsBase::GetProductVecto
     return productVector;
 }
 
+// Implementation of the template function to get a view of the products in the event
+template <typename T> DUNEAnaProductView<T> DUNEAnaUtilsBase::GetProductView(const art::Event &evt, const std::string &label)
+{
+    auto theseProds = evt.getHandle<std::vector<T>>(label);
+
+    if (!theseProds.isValid())
+        mf::LogError("DUNEAna") << " Failed to find product with label " << label << " ... returning empty view" << std::endl;
+
+    return DUNEAnaProductView<T>(theseProds);
+}
+
 // Implementation of the template function to get the associated products from the event
 template <typename T, typename U> std::vector<art::Ptr<T>> DUNEAnaUtilsBase::GetAssocProductVector(const art::Ptr<U> &pProd, const art::Event &evt, const std::string &label, const std::string &assocLabel)
 {
@@ -62,9 +77,10 @@ template <typename T, typename U> std::vector<art::Ptr<T>> DUNEAnaUtilsBase::Get
         return std::vector<art::Ptr<T>>();
     }
 
-    const art::FindManyP<T> findParticleAssocs(products,evt,assocLabel);
+    // The associations for the whole collection are only built once per event
+    const auto findParticleAssocs = DUNEAnaAssocCache::Get<T>(evt,products,label,assocLabel);
 
-    return findParticleAssocs.at(pProd.key());
+    return findParticleAssocs->at(pProd.key());
 }
 
 // Implementation of the template function to get the associated product from the event
@@ -0,0 +1,69 @@
+/**
+ *
+ * @file dunereco/AnaUtils/DUNEAnaVector.h
+ *
+ * @brief Plain 2D and 3D vectors for the inner loops of the geometric algorithms
+*/
+
+#ifndef DUNE_ANA_VECTOR_H
+#define DUNE_ANA_VECTOR_H
+
+#include "TVector2.h"
+#include "TVector3.h"
+
+#include <cmath>
+
+namespace dune_ana
+{
+/**
+ *
+ * @brief Vec2 and Vec3 aggregates of doubles
+ *
+ * Unlike TVector2 and TVector3 they carry no TObject base or virtual table, so they are passed in registers, their
+ * arithmetic inlines and loops over arrays of them vectorise. The conversions to and from the ROOT vectors are meant
+ * for the public interfaces only.
+ *
+*/
+struct Vec2
+{
+    double x;
+    double y;
+
+    static Vec2 From(const TVector2 &v) { return {v.X(), v.Y()}; }
+    TVector2 ToROOT() const { return TVector2(x, y); }
+
+    constexpr Vec2 operator+(const Vec2 &o) const { return {x + o.x, y + o.y}; }
+    constexpr Vec2 operator-(const Vec2 &o) const { return {x - o.x, y - o.y}; }
+    constexpr Vec2 operator*(const double s) const { return {x * s, y * s}; }
+    constexpr double Dot(const Vec2 &o) const { return x * o.x + y * o.y; }
+    constexpr double Mag2() const { return this->Dot(*this); }
+    double Mag() const { return std::sqrt(this->Mag2()); }
+};
+
+struct Vec3
+{
+    double x;
+    double y;
+    double z;
+
+    static Vec3 From(const TVector3 &v) { return {v.X(), v.Y(), v.Z()}; }
+    TVector3 ToROOT() const { return TVector3(x, y, z); }
+
+    constexpr Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+    constexpr Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+    constexpr Vec3 operator*(const double s) const { return {x * s, y * s, z * s}; }
+    constexpr double Dot(const Vec3 &o) const { return x * o.x + y * o.y + z * o.z; }
+    constexpr Vec3 Cross(const Vec3 &o) const { return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+    constexpr double Mag2() const { return this->Dot(*this); }
+    double Mag() const { return std::sqrt(this->Mag2()); }
+};
+
+/**
+ * @brief The squared distance between two points
+ */
+constexpr double Dist2(const Vec2 &a, const Vec2 &b) { return (a - b).Mag2(); }
+constexpr double Dist2(const Vec3 &a, const Vec3 &b) { return (a - b).Mag2(); }
+
+} // namespace dune_ana
+
+#endif // DUNE_ANA_VECTOR_H
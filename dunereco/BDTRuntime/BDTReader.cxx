@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       BDTReader
+////
+//// TMVA::Reader interface on top of the compiled BDT forests.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/BDTRuntime/BDTReader.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+#include "cetlib_except/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+bdt::BDTReader::BDTReader(bool useCompiled, const std::string & options, bool verbose) :
+    fUseCompiled(useCompiled),
+    fOptions(options),
+    fVerbose(verbose)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void bdt::BDTReader::AddVariable(const std::string & expression, Float_t * value)
+{
+    fExpressions.push_back(expression);
+    fValues.push_back(value);
+    fBuffer.resize(fValues.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void bdt::BDTReader::BookMVA(const std::string & methodTag, const std::string & weightFile)
+{
+    if (fUseCompiled)
+    {
+        try
+        {
+            std::unique_ptr<CompiledBDT> forest = std::make_unique<CompiledBDT>(weightFile);
+
+            // TMVA also requires the inputs to be bound in the order of the file
+            if (forest->VariableNames() != fExpressions)
+            {
+                throw cet::exception("BDTReader") << "The " << fExpressions.size() << " bound variables do not match the "
+                                                  << forest->NVariables() << " variables of " << weightFile;
+            }
+
+            mf::LogInfo("BDTReader") << "Method " << methodTag << " from " << weightFile << " compiled to a forest of "
+                                     << forest->NTrees() << " trees";
+            fCompiled.push_back(CompiledMethod{methodTag, std::move(forest)});
+            return;
+        }
+        catch (const cet::exception & e)
+        {
+            mf::LogWarning("BDTReader") << "Falling back to TMVA::Reader for " << methodTag << ": " << e.what();
+        }
+    }
+
+    if (!fReader)
+    {
+        fReader = std::make_unique<TMVA::Reader>(fOptions, fVerbose);
+        for (unsigned int v = 0; v < fValues.size(); ++v) { fReader->AddVariable(fExpressions[v], fValues[v]); }
+    }
+    fReader->BookMVA(methodTag, weightFile);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+Double_t bdt::BDTReader::EvaluateMVA(const std::string & methodTag)
+{
+    DUNE_PROF_SCOPE("bdt::BDTReader::EvaluateMVA");
+    const CompiledBDT * forest = GetCompiledBDT(methodTag);
+    if (!forest)
+    {
+        if (!fReader)
+        {
+            throw cet::exception("BDTReader") << "Method " << methodTag << " has not been booked";
+        }
+        return fReader->EvaluateMVA(methodTag);
+    }
+
+    for (unsigned int v = 0; v < fValues.size(); ++v) { fBuffer[v] = *fValues[v]; }
+    const double score = forest->Evaluate(fBuffer.data());
+    if (score == -999.)
+    {
+        mf::LogError("BDTReader") << "NaN input to " << methodTag << " --> returning MVA value -999";
+    }
+    return score;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void bdt::BDTReader::EvaluateMVA(const std::string & methodTag, Float_t * bound, unsigned int blockSize,
+                                 const Float_t * samples, unsigned int nSamples, Double_t * scores)
+{
+    DUNE_PROF_SCOPE("bdt::BDTReader::EvaluateMVA(batch)");
+    std::vector<unsigned int> offsets(fValues.size());
+    for (unsigned int v = 0; v < fValues.size(); ++v)
+    {
+        if (fValues[v] < bound || fValues[v] >= bound + blockSize)
+        {
+            throw cet::exception("BDTReader") << "Variable " << fExpressions[v] << " is not bound into the block of the samples";
+        }
+        offsets[v] = fValues[v] - bound;
+    }
+
+    const CompiledBDT * forest = GetCompiledBDT(methodTag);
+    if (!forest)
+    {
+        if (!fReader)
+        {
+            throw cet::exception("BDTReader") << "Method " << methodTag << " has not been booked";
+        }
+        for (unsigned int s = 0; s < nSamples; ++s)
+        {
+            for (unsigned int v = 0; v < fValues.size(); ++v) { *fValues[v] = samples[s*blockSize + offsets[v]]; }
+            scores[s] = fReader->EvaluateMVA(methodTag);
+        }
+        return;
+    }
+
+    // Gather the inputs of all samples in file order and walk the forest once for them
+    std::vector<float> rows(static_cast<std::size_t>(nSamples)*fValues.size());
+    for (unsigned int s = 0; s < nSamples; ++s)
+    {
+        for (unsigned int v = 0; v < fValues.size(); ++v) { rows[s*fValues.size() + v] = samples[s*blockSize + offsets[v]]; }
+    }
+    forest->Evaluate(rows.data(), nSamples, scores);
+
+    for (unsigned int s = 0; s < nSamples; ++s)
+    {
+        if (scores[s] == -999.)
+        {
+            mf::LogError("BDTReader") << "NaN input to " << methodTag << " --> returning MVA value -999";
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool bdt::BDTReader::IsCompiled(const std::string & methodTag) const
+{
+    return GetCompiledBDT(methodTag) != nullptr;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const bdt::CompiledBDT * bdt::BDTReader::GetCompiledBDT(const std::string & methodTag) const
+{
+    for (const CompiledMethod & method : fCompiled)
+    {
+        if (method.tag == methodTag) { return method.forest.get(); }
+    }
+    return nullptr;
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       BDTReader
+////
+//// Drop-in replacement for the TMVA::Reader calls of the dunereco BDT users
+//// (AddVariable, BookMVA, EvaluateMVA). Gradient boosted BDTs are evaluated with
+//// a CompiledBDT, any other method, or every method if the compiled mode is
+//// switched off, goes through a TMVA::Reader as before.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BDT_BDT_READER_H
+#define BDT_BDT_READER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TMVA/Reader.h"
+
+#include "dunereco/BDTRuntime/CompiledBDT.h"
+
+namespace bdt
+{
+
+class BDTReader
+{
+public:
+    /// options and verbose are passed on to the TMVA::Reader fallback
+    BDTReader(bool useCompiled = true, const std::string & options = "", bool verbose = false);
+
+    /// Bind an input, in the order of the weights file as for TMVA::Reader
+    void AddVariable(const std::string & expression, Float_t * value);
+
+    /// Load the method from the weights file
+    void BookMVA(const std::string & methodTag, const std::string & weightFile);
+
+    /// Score of the currently bound input values
+    Double_t EvaluateMVA(const std::string & methodTag);
+
+    /// Scores of nSamples input sets in one call. The variables must all have
+    /// been bound into the block of blockSize values starting at bound, and
+    /// samples holds nSamples copies of that block, one after the other. The
+    /// TMVA fallback copies each sample into the bound block in turn
+    void EvaluateMVA(const std::string & methodTag, Float_t * bound, unsigned int blockSize,
+                     const Float_t * samples, unsigned int nSamples, Double_t * scores);
+
+    /// True if the method is evaluated by the compiled forest
+    bool IsCompiled(const std::string & methodTag) const;
+
+    /// Compiled forest of the method, nullptr if it runs through TMVA. Can be
+    /// used to score many samples with one call
+    const CompiledBDT * GetCompiledBDT(const std::string & methodTag) const;
+
+private:
+    struct CompiledMethod
+    {
+        std::string tag;
+        std::unique_ptr<CompiledBDT> forest;
+    };
+
+    bool fUseCompiled;
+    std::string fOptions;
+    bool fVerbose;
+
+    std::vector<std::string> fExpressions;
+    std::vector<Float_t*> fValues;
+    std::vector<float> fBuffer;  ///< gathered inputs in file order
+
+    std::vector<CompiledMethod> fCompiled;
+    std::unique_ptr<TMVA::Reader> fReader;  ///< only created for methods that can not be compiled
+};
+
+} // namespace bdt
+
+#endif
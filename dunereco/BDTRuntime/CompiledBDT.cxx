@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       CompiledBDT
+////
+//// Gradient boosted decision forest flattened from a TMVA BDTG weights file.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/BDTRuntime/CompiledBDT.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "TXMLEngine.h"
+
+#include "cetlib_except/exception.h"
+
+namespace
+{
+    const char * GetAttr(TXMLEngine & xml, XMLNodePointer_t node, const char * name, const std::string & weightFile)
+    {
+        const char * value = xml.GetAttr(node, name);
+        if (!value)
+        {
+            throw cet::exception("CompiledBDT") << "Attribute " << name << " missing from node "
+                                                << xml.GetNodeName(node) << " in " << weightFile;
+        }
+        return value;
+    }
+
+    /// First child element with the given name, nullptr if there is none
+    XMLNodePointer_t GetChild(TXMLEngine & xml, XMLNodePointer_t node, const char * name)
+    {
+        for (XMLNodePointer_t child = xml.GetChild(node); child; child = xml.GetNext(child))
+        {
+            if (std::strcmp(xml.GetNodeName(child), name) == 0) { return child; }
+        }
+        return nullptr;
+    }
+
+    /// Frees the parsed document on every way out of the constructor
+    struct DocGuard
+    {
+        TXMLEngine & xml;
+        XMLDocPointer_t doc;
+        ~DocGuard() { if (doc) { xml.FreeDoc(doc); } }
+    };
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bdt::CompiledBDT::CompiledBDT(const std::string & weightFile)
+{
+    TXMLEngine xml;
+    xml.SetSkipComments(true);
+    DocGuard guard{xml, xml.ParseFile(weightFile.c_str())};
+    if (!guard.doc)
+    {
+        throw cet::exception("CompiledBDT") << "Unable to parse weights file " << weightFile;
+    }
+
+    XMLNodePointer_t setup = xml.DocGetRootElement(guard.doc);
+    const std::string method = GetAttr(xml, setup, "Method", weightFile);
+    if (method.compare(0, 5, "BDT::") != 0)
+    {
+        throw cet::exception("CompiledBDT") << "Method " << method << " in " << weightFile << " is not a BDT";
+    }
+
+    // Gradient boosted classification, the only case the score formula below is valid for
+    XMLNodePointer_t info = GetChild(xml, setup, "GeneralInfo");
+    XMLNodePointer_t options = GetChild(xml, setup, "Options");
+    if (!info || !options)
+    {
+        throw cet::exception("CompiledBDT") << "GeneralInfo or Options missing from " << weightFile;
+    }
+    std::string analysisType, boostType;
+    for (XMLNodePointer_t node = xml.GetChild(info); node; node = xml.GetNext(node))
+    {
+        const char * name = xml.GetAttr(node, "name");
+        if (name && std::strcmp(name, "AnalysisType") == 0) { analysisType = GetAttr(xml, node, "value", weightFile); }
+    }
+    for (XMLNodePointer_t node = xml.GetChild(options); node; node = xml.GetNext(node))
+    {
+        const char * name = xml.GetAttr(node, "name");
+        const char * content = xml.GetNodeContent(node);
+        if (name && content && std::strcmp(name, "BoostType") == 0) { boostType = content; }
+    }
+    if (analysisType != "Classification" || boostType != "Grad")
+    {
+        throw cet::exception("CompiledBDT") << "Only gradient boosted classification is supported, " << weightFile
+                                            << " has analysis type " << analysisType << " and boost type " << boostType;
+    }
+
+    XMLNodePointer_t transformations = GetChild(xml, setup, "Transformations");
+    if (transformations && std::atoi(GetAttr(xml, transformations, "NTransformations", weightFile)) != 0)
+    {
+        throw cet::exception("CompiledBDT") << "Variable transformations in " << weightFile << " are not supported";
+    }
+
+    XMLNodePointer_t variables = GetChild(xml, setup, "Variables");
+    if (!variables)
+    {
+        throw cet::exception("CompiledBDT") << "Variables missing from " << weightFile;
+    }
+    fVariableNames.resize(std::atoi(GetAttr(xml, variables, "NVar", weightFile)));
+    for (XMLNodePointer_t node = xml.GetChild(variables); node; node = xml.GetNext(node))
+    {
+        const unsigned int index = std::atoi(GetAttr(xml, node, "VarIndex", weightFile));
+        if (index >= fVariableNames.size())
+        {
+            throw cet::exception("CompiledBDT") << "Variable index " << index << " out of range in " << weightFile;
+        }
+        fVariableNames[index] = GetAttr(xml, node, "Expression", weightFile);
+    }
+
+    XMLNodePointer_t weights = GetChild(xml, setup, "Weights");
+    if (!weights)
+    {
+        throw cet::exception("CompiledBDT") << "Weights missing from " << weightFile;
+    }
+    fRoots.reserve(std::atoi(GetAttr(xml, weights, "NTrees", weightFile)));
+    for (XMLNodePointer_t tree = xml.GetChild(weights); tree; tree = xml.GetNext(tree))
+    {
+        XMLNodePointer_t root = GetChild(xml, tree, "Node");
+        if (!root)
+        {
+            throw cet::exception("CompiledBDT") << "Empty tree in " << weightFile;
+        }
+        fRoots.push_back(fNodes.size());
+        fNodes.emplace_back();
+        ReadNode(xml, root, fRoots.back(), weightFile);
+    }
+    if (fRoots.empty())
+    {
+        throw cet::exception("CompiledBDT") << "No trees in " << weightFile;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void bdt::CompiledBDT::ReadNode(TXMLEngine & xml, void * xmlNode, uint32_t n, const std::string & weightFile)
+{
+    if (std::atoi(GetAttr(xml, xmlNode, "NCoef", weightFile)) != 0)
+    {
+        throw cet::exception("CompiledBDT") << "Fisher cuts in " << weightFile << " are not supported";
+    }
+
+    // TMVA keeps cuts and responses as Float_t, strtof rounds the same way
+    if (std::atoi(GetAttr(xml, xmlNode, "nType", weightFile)) != 0)
+    {
+        fNodes[n] = Node{std::strtof(GetAttr(xml, xmlNode, "res", weightFile), nullptr), -1, 0, 0};
+        return;
+    }
+
+    XMLNodePointer_t leftNode = nullptr, rightNode = nullptr;
+    for (XMLNodePointer_t child = xml.GetChild(xmlNode); child; child = xml.GetNext(child))
+    {
+        const char * pos = GetAttr(xml, child, "pos", weightFile);
+        if (pos[0] == 'l') { leftNode = child; }
+        else if (pos[0] == 'r') { rightNode = child; }
+    }
+    const int var = std::atoi(GetAttr(xml, xmlNode, "IVar", weightFile));
+    if (!leftNode || !rightNode || var < 0 || var >= static_cast<int>(fVariableNames.size()))
+    {
+        throw cet::exception("CompiledBDT") << "Malformed intermediate node in " << weightFile;
+    }
+
+    const uint32_t left = fNodes.size();
+    fNodes.resize(left + 2);
+    fNodes[n] = Node{std::strtof(GetAttr(xml, xmlNode, "Cut", weightFile), nullptr), var, left,
+                     std::atoi(GetAttr(xml, xmlNode, "cType", weightFile)) == 0 ? 1u : 0u};
+
+    ReadNode(xml, leftNode, left, weightFile);
+    ReadNode(xml, rightNode, left + 1, weightFile);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double bdt::CompiledBDT::Transform(double sum)
+{
+    // As TMVA::MethodBDT::GetGradBoostMVA
+    return 2.0 / (1.0 + std::exp(-2.0 * sum)) - 1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double bdt::CompiledBDT::Evaluate(const float * values) const
+{
+    const unsigned int nVars = fVariableNames.size();
+    for (unsigned int v = 0; v < nVars; ++v)
+    {
+        if (std::isnan(values[v])) { return -999.; }
+    }
+
+    // Same summation order as TMVA, so the scores agree to the last bit
+    double sum = 0.;
+    for (const uint32_t root : fRoots) { sum += TreeResponse(root, values); }
+
+    return Transform(sum);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void bdt::CompiledBDT::Evaluate(const float * values, unsigned int nSamples, double * scores) const
+{
+    DUNE_PROF_SCOPE("bdt::CompiledBDT::Evaluate(batch)");
+    DUNE_PROF_COUNT("bdt::CompiledBDT::Evaluate(batch) samples", nSamples);
+    const unsigned int nVars = fVariableNames.size();
+    std::fill(scores, scores + nSamples, 0.);
+
+    // Tree by tree, so each tree is pulled into the cache once for the whole batch
+    for (const uint32_t root : fRoots)
+    {
+        for (unsigned int s = 0; s < nSamples; ++s) { scores[s] += TreeResponse(root, values + s * nVars); }
+    }
+
+    for (unsigned int s = 0; s < nSamples; ++s)
+    {
+        const float * sample = values + s * nVars;
+        const bool hasNaN = std::any_of(sample, sample + nVars, [](float v){ return std::isnan(v); });
+        scores[s] = hasNaN ? -999. : Transform(scores[s]);
+    }
+}
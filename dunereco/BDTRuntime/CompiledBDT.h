@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       CompiledBDT
+////
+//// Gradient boosted decision forest read once from a TMVA BDTG weights file and
+//// flattened into a node array. Evaluation walks the array with one compare per
+//// level and gives the same score as TMVA::Reader::EvaluateMVA, without the
+//// XML trees, the virtual node classes or the TMVA::Event copy of every call.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BDT_COMPILED_BDT_H
+#define BDT_COMPILED_BDT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TXMLEngine;
+
+namespace bdt
+{
+
+class CompiledBDT
+{
+public:
+    /// Read and flatten the forest. Throws cet::exception if the file can not be
+    /// read or the method is not supported: only BDTs with gradient boosting,
+    /// no variable transformations and plain cuts (no Fisher cuts) are
+    CompiledBDT(const std::string & weightFile);
+
+    /// Input variables in the order of the weights file
+    const std::vector<std::string> & VariableNames() const { return fVariableNames; }
+    unsigned int NVariables() const { return fVariableNames.size(); }
+    unsigned int NTrees() const { return fRoots.size(); }
+
+    /// Score of one sample, values holds NVariables() inputs in file order.
+    /// Returns -999 if any input is NaN, as TMVA does
+    double Evaluate(const float * values) const;
+
+    /// Scores of nSamples samples stored row-major in values
+    void Evaluate(const float * values, unsigned int nSamples, double * scores) const;
+
+private:
+    struct Node
+    {
+        float value;      ///< cut for an intermediate node, response for a leaf
+        int32_t var;      ///< index of the cut variable, -1 for a leaf
+        uint32_t left;    ///< index of the left daughter, the right one follows it
+        uint32_t invert;  ///< 1 if the cut selects the left daughter (cType 0)
+    };
+
+    /// Fill node n from the XML node and append its daughters, recursively
+    void ReadNode(TXMLEngine & xml, void * xmlNode, uint32_t n, const std::string & weightFile);
+
+    /// Walk one tree and return the response of the leaf
+    float TreeResponse(uint32_t root, const float * values) const;
+
+    /// Turn the summed responses into the classifier output
+    static double Transform(double sum);
+
+    std::vector<std::string> fVariableNames;
+    std::vector<Node> fNodes;
+    std::vector<uint32_t> fRoots;
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline float CompiledBDT::TreeResponse(uint32_t root, const float * values) const
+{
+    const Node * nodes = fNodes.data();
+    uint32_t n = root;
+    while (nodes[n].var >= 0)
+    {
+        const Node & node = nodes[n];
+        const uint32_t right = (values[node.var] >= node.value) ^ node.invert;
+        n = node.left + right;
+    }
+    return nodes[n].value;
+}
+
+} // namespace bdt
+
+#endif
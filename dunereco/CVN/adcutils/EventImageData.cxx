@@ -41,6 +41,8 @@
 #include <cmath>
 #include <fstream>
 
+#include "tbb/parallel_for.h"
+
 #include "TFile.h"
 #include "TTree.h"
 #include "TH2C.h" // ADC map
@@ -49,13 +51,14 @@
 
 
 nnet::EventImageData::EventImageData(size_t w, size_t d, bool saveDep) :
+    fNWires(w), fNDrifts(d),
     fVtxX(-9999), fVtxY(-9999),
     fProjX(-9999), fProjY(-9999),
     fSaveDep(saveDep)
 {
-    fAdc.resize(w, std::vector<float>(d, 0));
-    if (saveDep) { fDeposit.resize(w, std::vector<float>(d, 0)); }
-    fPdg.resize(w, std::vector<int>(d, 0));
+    fAdc.resize(w * d, 0);
+    if (saveDep) { fDeposit.resize(w * d, 0); }
+    fPdg.resize(w * d, 0);
 }
 
 
@@ -71,55 +74,55 @@ void nnet::EventImageData::setProjXY(const TrainingDataAlg & dataAlg, float x, f
 void nnet::EventImageData::addTpc(const TrainingDataAlg & dataAlg, size_t gw, bool flipw, size_t gd, bool flipd)
 {
   float zero = dataAlg.ZeroLevel();
-  for (size_t w = 0; w < dataAlg.NWires(); ++w)
+  size_t nwires = dataAlg.NWires();
+  size_t drift_size = dataAlg.NScaledDrifts();
+
+  // last drift index of the neutrino vertex on each wire, -1 if not there
+  std::vector<int> vtxDrift(nwires, -1);
+
+  // each wire writes only its own row, so the wires can be filled in parallel
+  tbb::parallel_for(size_t(0), nwires, [&](size_t w)
   {
-      size_t drift_size = dataAlg.NScaledDrifts();
-      std::vector<float> & dstAdc = fAdc[gw + w];
-      std::vector<float> & dstDep = fDeposit[gw + w];
-      std::vector<int> & dstPdg = fPdg[gw + w];
-      const float* srcAdc = 0;
-      const float* srcDep = 0;
-      const int* srcPdg = 0;
-      if (flipw)
-      {
-          srcAdc = dataAlg.wireData(dataAlg.NWires() - w - 1).data();
-          srcDep = dataAlg.wireEdep(dataAlg.NWires() - w - 1).data();
-          srcPdg = dataAlg.wirePdg(dataAlg.NWires() - w - 1).data();
-      }
-      else
-      {
-          srcAdc = dataAlg.wireData(w).data();
-          srcDep = dataAlg.wireEdep(w).data();
-          srcPdg = dataAlg.wirePdg(w).data();
-      }
+      size_t srcw = flipw ? nwires - w - 1 : w;
+      float* dstAdc = fAdc.data() + (gw + w) * fNDrifts + gd;
+      int* dstPdg = fPdg.data() + (gw + w) * fNDrifts + gd;
+      const float* srcAdc = dataAlg.wireData(srcw).data();
+      const int* srcPdg = dataAlg.wirePdg(srcw).data();
       if (flipd)
       {
-          for (size_t d = 0; d < drift_size; ++d) { dstAdc[gd + d] += srcAdc[drift_size - d - 1] - zero; }
-          if (fSaveDep) { for (size_t d = 0; d < drift_size; ++d) { dstDep[gd + d] += srcDep[drift_size - d - 1]; } }
-          for (size_t d = 0; d < drift_size; ++d)
+          for (size_t d = 0; d < drift_size; ++d) { dstAdc[d] += srcAdc[drift_size - d - 1] - zero; }
+          if (fSaveDep)
           {
-              int code = srcPdg[drift_size - d - 1];
-              int best_pdg = code & nnet::TrainingDataAlg::kPdgMask;
-              int vtx_flags = (dstPdg[gd + d] | code) & nnet::TrainingDataAlg::kVtxMask;
-              dstPdg[gd + d] = vtx_flags | best_pdg; // now just overwrite pdg and keep all vtx flags
-              
-              if (code & nnet::TrainingDataAlg::kNuPri) { fVtxX = gw + w; fVtxY = gd + d; } // dstAdc[gd + d] = 127; }
+              float* dstDep = fDeposit.data() + (gw + w) * fNDrifts + gd;
+              const float* srcDep = dataAlg.wireEdep(srcw).data();
+              for (size_t d = 0; d < drift_size; ++d) { dstDep[d] += srcDep[drift_size - d - 1]; }
           }
       }
       else
       {
-          for (size_t d = 0; d < drift_size; ++d) { dstAdc[gd + d] += srcAdc[d] - zero; }
-          if (fSaveDep) { for (size_t d = 0; d < drift_size; ++d) { dstDep[gd + d] += srcDep[d]; } }
-          for (size_t d = 0; d < drift_size; ++d)
+          for (size_t d = 0; d < drift_size; ++d) { dstAdc[d] += srcAdc[d] - zero; }
+          if (fSaveDep)
           {
-              int code = srcPdg[d];
-              int best_pdg = code & nnet::TrainingDataAlg::kPdgMask;
-              int vtx_flags = (dstPdg[gd + d] | code) & nnet::TrainingDataAlg::kVtxMask;
-              dstPdg[gd + d] = vtx_flags | best_pdg; // now just overwrite pdg and keep all vtx flags
-
-              if (code & nnet::TrainingDataAlg::kNuPri) { fVtxX = gw + w; fVtxY = gd + d; } // dstAdc[gd + d] = 127; }
+              float* dstDep = fDeposit.data() + (gw + w) * fNDrifts + gd;
+              const float* srcDep = dataAlg.wireEdep(srcw).data();
+              for (size_t d = 0; d < drift_size; ++d) { dstDep[d] += srcDep[d]; }
           }
       }
+      for (size_t d = 0; d < drift_size; ++d)
+      {
+          int code = flipd ? srcPdg[drift_size - d - 1] : srcPdg[d];
+          int best_pdg = code & nnet::TrainingDataAlg::kPdgMask;
+          int vtx_flags = (dstPdg[d] | code) & nnet::TrainingDataAlg::kVtxMask;
+          dstPdg[d] = vtx_flags | best_pdg; // now just overwrite pdg and keep all vtx flags
+
+          if (code & nnet::TrainingDataAlg::kNuPri) { vtxDrift[w] = d; }
+      }
+  });
+
+  // the vertex is the last one found in wire and drift order
+  for (size_t w = 0; w < nwires; ++w)
+  {
+      if (vtxDrift[w] >= 0) { fVtxX = gw + w; fVtxY = gd + vtxDrift[w]; }
   }
 }
 
@@ -130,17 +133,19 @@ bool nnet::EventImageData::findCrop(size_t max_area_cut, unsigned int & w0, unsi
 
   w0 = 0;
   size_t cut = 0;
-  while (w0 < fAdc.size())
+  while (w0 < fNWires)
   {
-      for (auto const d : fAdc[w0]) { if (d > adcThr) cut++; }
+      const float* adc = wireAdc(w0);
+      for (size_t d = 0; d < fNDrifts; ++d) { if (adc[d] > adcThr) cut++; }
       if (cut < max_cut) w0++;
       else break;
   }
-  w1 = fAdc.size() - 1;
+  w1 = fNWires - 1;
   cut = 0;
   while (w1 > w0)
   {
-      for (auto const d : fAdc[w1]) { if (d > adcThr) cut++; }
+      const float* adc = wireAdc(w1);
+      for (size_t d = 0; d < fNDrifts; ++d) { if (adc[d] > adcThr) cut++; }
       if (cut < max_cut) w1--;
       else break;
   }
@@ -148,17 +153,17 @@ bool nnet::EventImageData::findCrop(size_t max_area_cut, unsigned int & w0, unsi
 
   d0 = 0;
   cut = 0;
-  while (d0 < fAdc.front().size())
+  while (d0 < fNDrifts)
   {
-      for (size_t i = w0; i < w1; ++i) { if (fAdc[i][d0] > adcThr) cut++; }
+      for (size_t i = w0; i < w1; ++i) { if (fAdc[i * fNDrifts + d0] > adcThr) cut++; }
       if (cut < max_cut) d0++;
       else break;
   }
-  d1 = fAdc.front().size() - 1;
+  d1 = fNDrifts - 1;
   cut = 0;
   while (d1 > d0)
   {
-      for (size_t i = w0; i < w1; ++i) { if (fAdc[i][d1] > adcThr) cut++; }
+      for (size_t i = w0; i < w1; ++i) { if (fAdc[i * fNDrifts + d1] > adcThr) cut++; }
       if (cut < max_cut) d1--;
       else break;
   }
@@ -170,13 +175,13 @@ bool nnet::EventImageData::findCrop(size_t max_area_cut, unsigned int & w0, unsi
       if (w0 < margin) w0 = 0;
       else w0 -= margin;
 
-      if (w1 > fAdc.size() - margin) w1 = fAdc.size();
+      if (w1 > fNWires - margin) w1 = fNWires;
       else w1 += margin;
       
       if (d0 < margin) d0 = 0;
       else d0 -= margin;
       
-      if (d1 > fAdc.front().size() - margin) d1 = fAdc.front().size();
+      if (d1 > fNDrifts - margin) d1 = fNDrifts;
       else d1 += margin;
       
       return true;
@@ -30,17 +30,22 @@ namespace nnet
   public:
     EventImageData(size_t w, size_t d, bool saveDep);
 
+    // the wires of the tpc are filled in parallel
     void addTpc(const TrainingDataAlg & dataAlg, size_t gw, bool flipw, size_t gd, bool flipd);
     bool findCrop(size_t max_area_cut, unsigned int & w0, unsigned int & w1, unsigned int & d0, unsigned int & d1) const;
 
-    const std::vector< std::vector<float> > & adcData(void) const { return fAdc; }
-    const std::vector<float> & wireAdc(size_t widx) const { return fAdc[widx]; }
+    size_t nWires(void) const { return fNWires; }
+    size_t nDrifts(void) const { return fNDrifts; }
 
-    const std::vector< std::vector<float> > & depData(void) const { return fDeposit; }
-    const std::vector<float> & wireDep(size_t widx) const { return fDeposit[widx]; }
+    // images are row-major [wire][drift] buffers, nDrifts() values per wire
+    const std::vector<float> & adcData(void) const { return fAdc; }
+    const float * wireAdc(size_t widx) const { return fAdc.data() + widx * fNDrifts; }
 
-    const std::vector< std::vector<int> > & pdgData(void) const { return fPdg; }
-    const std::vector<int> & wirePdg(size_t widx) const { return fPdg[widx]; }
+    const std::vector<float> & depData(void) const { return fDeposit; }
+    const float * wireDep(size_t widx) const { return fDeposit.data() + widx * fNDrifts; }
+
+    const std::vector<int> & pdgData(void) const { return fPdg; }
+    const int * wirePdg(size_t widx) const { return fPdg.data() + widx * fNDrifts; }
 
     void setProjXY(const TrainingDataAlg & dataAlg, float x, float y, size_t gw, bool flipw, size_t gd, bool flipd);
     float getProjX(void) const { return fProjX; }
@@ -50,8 +55,9 @@ namespace nnet
     int getVtxY(void) const { return fVtxY; }
 
   private:
-    std::vector< std::vector<float> > fAdc, fDeposit;
-    std::vector< std::vector<int> > fPdg;
+    size_t fNWires, fNDrifts;
+    std::vector<float> fAdc, fDeposit;
+    std::vector<int> fPdg;
     int fVtxX, fVtxY;
     float fProjX, fProjY;
     bool fSaveDep;
@@ -15,6 +15,7 @@
 #define SPMultiTpcDump_Module
 
 #include "dunereco/CVN/adcutils/EventImageData.h"
+#include "dunereco/CVN/func/ZlibShardWriter.h"
 
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/GeometryCore.h"
@@ -43,6 +44,7 @@
 #include <string>
 #include <cmath>
 #include <fstream>
+#include <memory>
 #include <tuple>
 
 #include "TFile.h"
@@ -54,6 +56,33 @@
 namespace nnet
 {
 
+  // Cropped [wire][drift] window of a row-major image, as the bytes of an NPY (v1.0) array
+  template <typename T>
+  std::vector<unsigned char> makeNpy(const char* descr, const T* image, size_t ndrifts,
+                                     unsigned int w0, unsigned int w1, unsigned int d0, unsigned int d1)
+  {
+    std::ostringstream dict;
+    dict << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': (" << (w1 - w0) << ", " << (d1 - d0) << "), }";
+    std::string header = dict.str();
+    header.append(63 - (10 + header.size()) % 64, ' '); // the data starts 64 byte aligned
+    header.push_back('\n');
+
+    std::vector<unsigned char> npy;
+    npy.reserve(10 + header.size() + (w1 - w0) * (d1 - d0) * sizeof(T));
+    const unsigned char magic[8] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+    npy.insert(npy.end(), magic, magic + 8);
+    npy.push_back(header.size() & 0xff);
+    npy.push_back(header.size() >> 8);
+    npy.insert(npy.end(), header.begin(), header.end());
+
+    for (size_t w = w0; w < w1; ++w)
+    {
+        const unsigned char* row = reinterpret_cast<const unsigned char*>(image + w * ndrifts + d0);
+        npy.insert(npy.end(), row, row + (d1 - d0) * sizeof(T));
+    }
+    return npy;
+  }
+
   struct NUVTX
   {
   	int interaction;
@@ -77,12 +106,16 @@ namespace nnet
 		fhicl::Atom<double> FidVolCut { Name("FidVolCut"), Comment("Take events with vertex inside this cut on volume.") };
 		fhicl::Atom<bool> SaveDepositMap { Name("SaveDepositMap"), Comment("Save projections of the true energy depositions.") };
 		fhicl::Atom<bool> SavePdgMap { Name("SavePdgMap"), Comment("Save vertex info and PDG codes map.") };
+		fhicl::Atom<unsigned long> ShardSize { Name("ShardSize"), Comment("Write the images as zlib compressed NPY arrays in tar shards of about this many MB instead of TH2 histograms, 0 for histograms."), 0 };
+		fhicl::Atom<std::string> OutputDir { Name("OutputDir"), Comment("Directory of the shards."), "." };
+		fhicl::Atom<std::string> ShardPrefix { Name("ShardPrefix"), Comment("File name prefix of the shards."), "adc" };
     };
     using Parameters = art::EDAnalyzer::Table<Config>;
 
     explicit SPMultiTpcDump(Parameters const& config);
     
     void beginJob() override;
+    void endJob() override;
 
     void analyze(const art::Event& event) override;
 
@@ -109,6 +142,10 @@ namespace nnet
 	int fSubRun;    ///< number of the sub-run being processed
 	
 	bool fSaveDepositMap, fSavePdgMap;
+
+	unsigned long fShardSize;
+	std::string fOutputDir, fShardPrefix;
+	std::unique_ptr<cvn::ZlibShardWriter> fShardWriter;
 		
 	double fFidVolCut;
 	
@@ -127,6 +164,9 @@ namespace nnet
 	fGenieGenLabel(config().GenModuleLabel()),
 	fSaveDepositMap(config().SaveDepositMap()),
 	fSavePdgMap(config().SavePdgMap()),
+	fShardSize(config().ShardSize()),
+	fOutputDir(config().OutputDir()),
+	fShardPrefix(config().ShardPrefix()),
 	fFidVolCut(config().FidVolCut())
   {
     fGeometry = &*(art::ServiceHandle<geo::Geometry>());
@@ -153,6 +193,19 @@ namespace nnet
 		fTree2D->Branch("fPixY", &fPixY, "fPixY/I");
 		fTree2D->Branch("fPosX", &fPosX, "fPosX/F");
 		fTree2D->Branch("fPosY", &fPosY, "fPosY/F");
+
+		if (fShardSize > 0)
+		{
+			fShardWriter = std::make_unique<cvn::ZlibShardWriter>(fOutputDir,
+				fShardPrefix + "_h" + std::to_string(time(0)), fShardSize << 20);
+		}
+  }
+
+  //-----------------------------------------------------------------------
+  void SPMultiTpcDump::endJob()
+  {
+		// Flush the queued images and close the last shard
+		if (fShardWriter) { fShardWriter->Close(); }
   }
   
   //-----------------------------------------------------------------------
@@ -336,39 +389,69 @@ namespace nnet
 		std::ostringstream ss1;
    		ss1 << os.str() << "_plane_" << p; // TH2's name
 
-		art::ServiceHandle<art::TFileService> tfs;
-   		TH2C* rawHist = tfs->make<TH2C>((ss1.str() + "_raw").c_str(), "ADC",
-                    (int)(w1 - w0), (double)w0, (double)w1, (int)(d1 - d0), (double)d0, (double)d1);
-   		
    		float zero = fTrainingDataAlg.ZeroLevel();
-        for (size_t w = w0; w < w1; ++w)
-        {
-            auto const & raw = fullimg.wireAdc(w);
-            for (size_t d = d0; d < d1; ++d)
-            {
-                rawHist->Fill(w, d, (char)(raw[d] + zero));
-            }
+   		if (fShardWriter)
+   		{
+   		    // npy arrays of the cropped window, <key>.adc.gz, <key>.deposit.gz and <key>.pdg.gz
+   		    std::ostringstream info;
+   		    info << w0 << std::endl << w1 << std::endl << d0 << std::endl << d1 << std::endl;
+
+   		    // ADC as 1-byte values, the same as the TH2C content
+   		    std::vector<char> adc;
+   		    adc.reserve((w1 - w0) * (d1 - d0));
+   		    for (size_t w = w0; w < w1; ++w)
+   		    {
+   		        auto const raw = fullimg.wireAdc(w);
+   		        for (size_t d = d0; d < d1; ++d) { adc.push_back((char)(raw[d] + zero)); }
+   		    }
+   		    fShardWriter->Write(ss1.str() + ".adc",
+   		        makeNpy("|i1", adc.data(), d1 - d0, 0, w1 - w0, 0, d1 - d0), info.str());
+   		    if (fSaveDepositMap)
+   		    {
+   		        fShardWriter->Write(ss1.str() + ".deposit",
+   		            makeNpy("<f4", fullimg.depData().data(), fullimg.nDrifts(), w0, w1, d0, d1), info.str());
+   		    }
+   		    if (fSavePdgMap)
+   		    {
+   		        fShardWriter->Write(ss1.str() + ".pdg",
+   		            makeNpy("<i4", fullimg.pdgData().data(), fullimg.nDrifts(), w0, w1, d0, d1), info.str());
+   		    }
    		}
-
-   		if (fSaveDepositMap)
+   		else
    		{
-       		TH2F* depHist = tfs->make<TH2F>((ss1.str() + "_deposit").c_str(), "Deposit",
-                    (int)(w1 - w0), (double)w0, (double)w1, (int)(d1 - d0), (double)d0, (double)d1);
+    		art::ServiceHandle<art::TFileService> tfs;
+       		TH2C* rawHist = tfs->make<TH2C>((ss1.str() + "_raw").c_str(), "ADC",
+                        (int)(w1 - w0), (double)w0, (double)w1, (int)(d1 - d0), (double)d0, (double)d1);
+   		
             for (size_t w = w0; w < w1; ++w)
             {
-                auto const & edep = fullimg.wireDep(w);
-                for (size_t d = d0; d < d1; ++d) { depHist->Fill(w, d, edep[d]); }
+                auto const raw = fullimg.wireAdc(w);
+                for (size_t d = d0; d < d1; ++d)
+                {
+                    rawHist->Fill(w, d, (char)(raw[d] + zero));
+                }
        		}
-       	}
 
-       	if (fSavePdgMap)
-       	{
-   		TH2I* pdgHist = tfs->make<TH2I>((ss1.str() + "_pdg").c_str(), "PDG",
-                    (int)(w1 - w0), (double)w0, (double)w1, (int)(d1 - d0), (double)d0, (double)d1);
-            for (size_t w = w0; w < w1; ++w)
-            {
-                auto const & pdg = fullimg.wirePdg(w);
-                for (size_t d = d0; d < d1; ++d) { pdgHist->Fill(w, d, pdg[d]); }
+       		if (fSaveDepositMap)
+       		{
+           		TH2F* depHist = tfs->make<TH2F>((ss1.str() + "_deposit").c_str(), "Deposit",
+                        (int)(w1 - w0), (double)w0, (double)w1, (int)(d1 - d0), (double)d0, (double)d1);
+                for (size_t w = w0; w < w1; ++w)
+                {
+                    auto const edep = fullimg.wireDep(w);
+                    for (size_t d = d0; d < d1; ++d) { depHist->Fill(w, d, edep[d]); }
+           		}
+           	}
+
+           	if (fSavePdgMap)
+           	{
+       		TH2I* pdgHist = tfs->make<TH2I>((ss1.str() + "_pdg").c_str(), "PDG",
+                        (int)(w1 - w0), (double)w0, (double)w1, (int)(d1 - d0), (double)d0, (double)d1);
+                for (size_t w = w0; w < w1; ++w)
+                {
+                    auto const pdg = fullimg.wirePdg(w);
+                    for (size_t d = d0; d < d1; ++d) { pdgHist->Fill(w, d, pdg[d]); }
+           		}
        		}
    		}
 
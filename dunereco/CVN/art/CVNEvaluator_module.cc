@@ -1,6 +1,8 @@
 ////////////////////////////////////////////////////////////////////////
 // \file    CVNEvaluator_module.cc
-// \brief   Producer module creating CVN neural net results
+// \brief   Producer module creating CVN neural net results, shared
+//          between the schedules with the network calls serialized
+//          in the TFNetHandler
 // \author  Alexander Radovic - a.radovic@gmail.com
 //          Saul Alonso Monsalve - saul.alonso.monsalve@cern.ch
 ////////////////////////////////////////////////////////////////////////
@@ -10,7 +12,7 @@
 #include <sstream>
 
 // Framework includes
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art_root_io/TFileDirectory.h"
@@ -21,8 +23,11 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "canvas/Persistency/Common/Assns.h"
 #include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Utilities/Exception.h"
 
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
 #include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CompactResult.h"
 #include "dunereco/CVN/func/PixelMap.h"
 //#include "dunereco/CVN/art/CaffeNetHandler.h"
 #include "dunereco/CVN/art/TFNetHandler.h"
@@ -31,14 +36,14 @@
 
 namespace cvn {
 
-  class CVNEvaluator : public art::EDProducer {
+  class CVNEvaluator : public art::SharedProducer {
   public:
-    explicit CVNEvaluator(fhicl::ParameterSet const& pset);
+    explicit CVNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
     ~CVNEvaluator();
 
-    void produce(art::Event& evt);
-    void beginJob();
-    void endJob();
+    void produce(art::Event& evt, art::ProcessingFrame const&) override;
+    void beginJob(art::ProcessingFrame const&) override;
+    void endJob(art::ProcessingFrame const&) override;
 
 
 
@@ -60,6 +65,18 @@ namespace cvn {
     /// If there are multiple pixel maps per event can we use them?
     bool fMultiplePMs;
 
+    /// Which of the full and the half precision results to write
+    bool fWriteResult;
+    bool fWriteCompactResult;
+
+    /// Write Result::Skipped for events without a pixel map, e.g. those
+    /// failing the mapper preselection, instead of no result
+    bool fWriteSkippedResult;
+
+    /// Forwards the results of an earlier pass made with the same
+    /// configuration instead of running the network again
+    dune_ana::DUNEAnaProductReuse fReuse;
+
     unsigned int fTotal;
     unsigned int fCorrect;
     unsigned int fFullyCorrect;
@@ -77,16 +94,25 @@ namespace cvn {
   };
 
   //.......................................................................
-  CVNEvaluator::CVNEvaluator(fhicl::ParameterSet const& pset): EDProducer{pset},
+  CVNEvaluator::CVNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&): SharedProducer{pset},
     fPixelMapInput (pset.get<std::string>         ("PixelMapInput")),
     fResultLabel (pset.get<std::string>         ("ResultLabel")),
     fCVNType     (pset.get<std::string>         ("CVNType")),
     //fCaffeHandler       (pset.get<fhicl::ParameterSet> ("CaffeNetHandler")),
     fTFHandler       (pset.get<fhicl::ParameterSet> ("TFNetHandler")),
     //fNOutput       (fCaffeHandler.NOutput()),
-    fMultiplePMs (pset.get<bool> ("MultiplePMs"))
+    fMultiplePMs (pset.get<bool> ("MultiplePMs")),
+    fWriteResult (pset.get<bool> ("WriteResult", true)),
+    fWriteCompactResult (pset.get<bool> ("WriteCompactResult", false)),
+    fWriteSkippedResult (pset.get<bool> ("WriteSkippedResult", false)),
+    fReuse (pset)
   {
-    produces< std::vector<cvn::Result>   >(fResultLabel);
+    fReuse.AddInput< std::vector<cvn::PixelMap> >(art::InputTag(fPixelMapInput, fPixelMapInput));
+
+    if(fWriteResult)
+      produces< std::vector<cvn::Result>   >(fResultLabel);
+    if(fWriteCompactResult)
+      produces< std::vector<cvn::CompactResult> >(fResultLabel);
     fTotal = 0;
     fCorrect = 0;
     fFullyCorrect = 0;
@@ -100,6 +126,8 @@ namespace cvn {
 
     fTotNumuBins = {0,0,0};
     fSelNumuBins = {0,0,0};
+
+    async<art::InEvent>();
   }
   //......................................................................
   CVNEvaluator::~CVNEvaluator()
@@ -110,11 +138,11 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNEvaluator::beginJob()
+  void CVNEvaluator::beginJob(art::ProcessingFrame const&)
   {  }
 
   //......................................................................
-  void CVNEvaluator::endJob()
+  void CVNEvaluator::endJob(art::ProcessingFrame const&)
   {
     /*
     float tot = static_cast<float>(fTotal);
@@ -132,12 +160,24 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNEvaluator::produce(art::Event& evt)
+  void CVNEvaluator::produce(art::Event& evt, art::ProcessingFrame const&)
   {
+    // Results of an earlier pass with the same configuration are forwarded
+    if(fReuse.Enabled() &&
+       (!fWriteResult || fReuse.Matches< std::vector<Result> >(evt, fResultLabel)) &&
+       (!fWriteCompactResult || fReuse.Matches< std::vector<CompactResult> >(evt, fResultLabel))){
+      if(fWriteResult)
+        fReuse.Forward< std::vector<Result> >(evt, fResultLabel);
+      if(fWriteCompactResult)
+        fReuse.Forward< std::vector<CompactResult> >(evt, fResultLabel);
+      return;
+    }
 
     /// Define containers for the things we're going to produce
     std::unique_ptr< std::vector<Result> >
                                   resultCol(new std::vector<Result>);
+    std::unique_ptr< std::vector<CompactResult> >
+                                  compactResultCol(new std::vector<CompactResult>);
 
     /// Load in the pixel maps
     std::vector< art::Ptr< cvn::PixelMap > > pixelmaplist;
@@ -159,12 +199,40 @@ namespace cvn {
       }
     }*/
     if(fCVNType == "TF" || fCVNType == "Tensorflow" || fCVNType == "TensorFlow"){
+      // No map, e.g. an event failing the mapper preselection, costs no inference
+      if(pixelmaplist.empty() && fWriteSkippedResult){
+        if(fWriteCompactResult)
+          compactResultCol->emplace_back(Result::Skipped());
+        if(fWriteResult)
+          resultCol->push_back(Result::Skipped());
+      }
+
       // If we have a pixel map then use the TF interface to give us a prediction
       if(pixelmaplist.size() > 0){
         
-        std::vector< std::vector<float> > networkOutput = fTFHandler.Predict(*pixelmaplist[0]);
+        // Classify other pixel maps if they exist, evaluating all maps of the
+        // event together so the network is run once per batch
+        std::vector<const cvn::PixelMap*> pms;
+        pms.push_back(pixelmaplist[0].get());
+        if(fMultiplePMs){
+          for(unsigned int p = 1; p < pixelmaplist.size(); ++p){
+            pms.push_back(pixelmaplist[p].get());
+          }
+        }
+
         // cvn::Result can now take a vector of floats and works out the number of outputs
-        resultCol->emplace_back(networkOutput);
+        for(auto const& networkOutput : fTFHandler.PredictBatch(pms)){
+          if(fWriteCompactResult){
+            if(!CompactResult::HasLayout(networkOutput)){
+              throw art::Exception(art::errors::Configuration)
+                << "CVNEvaluator: WriteCompactResult needs the multi-output network, the network has "
+                << networkOutput.size() << " outputs";
+            }
+            compactResultCol->emplace_back(networkOutput);
+          }
+          if(fWriteResult)
+            resultCol->emplace_back(networkOutput);
+        }
 
         /*
         for(auto const& resaux: (*resultCol))
@@ -205,14 +273,6 @@ namespace cvn {
         }
         */
 
-        // Classify other pixel maps if they exist
-        if(fMultiplePMs){
-          for(unsigned int p = 1; p < pixelmaplist.size(); ++p){
-            std::vector< std::vector<float> > output = fTFHandler.Predict(*pixelmaplist[p]);
-            resultCol->emplace_back(output);
-          }
-        }
-
       }
     }
     else{
@@ -316,7 +376,10 @@ namespace cvn {
     }
 */ // End of truth level debug code
 
-    evt.put(std::move(resultCol), fResultLabel);
+    if(fWriteResult)
+      evt.put(std::move(resultCol), fResultLabel);
+    if(fWriteCompactResult)
+      evt.put(std::move(compactResultCol), fResultLabel);
 
   }
 
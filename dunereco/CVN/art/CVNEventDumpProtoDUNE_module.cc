@@ -7,6 +7,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // ROOT includes
@@ -27,6 +28,8 @@
 
 #include "canvas/Persistency/Common/Ptr.h"
 
+#include "dunereco/CVN/func/AsyncDumpWriter.h"
+#include "dunereco/CVN/func/DenseMapBranches.h"
 #include "dunereco/CVN/func/TrainingData.h"
 #include "dunereco/CVN/func/InteractionType.h"
 #include "dunereco/CVN/func/PixelMap.h"
@@ -52,6 +55,17 @@ namespace cvn {
 
     TrainingData* fTrain;
     TTree*        fTrainTree;
+    DenseMapBranches fDenseMap; ///< The dense PE vectors the tree readers expect
+
+    // Writer thread filling the tree in a file of its own, if AsyncDump.OutputFile is set
+    std::string  fAsyncFile;
+    unsigned int fAsyncQueueDepth;
+    int          fAsyncCompression;
+    std::unique_ptr<AsyncDumpWriter> fAsyncWriter;
+    unsigned int fAsyncNPixel; ///< Pixels per map, fixed by the first one written
+
+    /// Queue the record for the writer thread, opening the file with the first one
+    void WriteAsync(const TrainingData& train);
 
     /// Function to extract TH2 from PixelMap and write to TFile
     void WriteMapTH2(const art::Event& evt, int slice, const PixelMap& pm);
@@ -74,6 +88,10 @@ namespace cvn {
   {
     fPixelMapInput  = pset.get<std::string>("PixelMapInput");
     fWriteMapTH2    = pset.get<bool>       ("WriteMapTH2");
+    const fhicl::ParameterSet asyncDump = pset.get<fhicl::ParameterSet>("AsyncDump", fhicl::ParameterSet());
+    fAsyncFile        = asyncDump.get<std::string>("OutputFile", "");
+    fAsyncQueueDepth  = asyncDump.get<unsigned int>("QueueDepth", 16);
+    fAsyncCompression = asyncDump.get<int>("Compression", -1);
   }
 
   //......................................................................
@@ -81,10 +99,14 @@ namespace cvn {
   {
 
 
+    // The asynchronous writer makes its tree with the first record
+    if(!fAsyncFile.empty()) return;
+
     art::ServiceHandle<art::TFileService> tfs;
 
     fTrainTree = tfs->make<TTree>("CVNTrainTree", "Training records");
     fTrainTree->Branch("train", "cvn::TrainingData", &fTrain);
+    fDenseMap.Book(fTrainTree);
 
 
   }
@@ -92,7 +114,7 @@ namespace cvn {
   //......................................................................
   void CVNEventDumpProtoDUNE::endJob()
   {
-
+    if(fAsyncWriter) fAsyncWriter->Close();
   }
 
   //......................................................................
@@ -115,8 +137,12 @@ namespace cvn {
 
       // Create the training data and add it to the tree
       TrainingData train(interaction, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, *pixelmaplist[p]);
-      fTrain = &train;
-      fTrainTree->Fill();
+      if(fAsyncFile.empty()){
+        fTrain = &train;
+        fDenseMap.Set(train.fPMap);
+        fTrainTree->Fill();
+      }
+      else WriteAsync(train);
 
       // Make a plot of the pixel map if required
       if (fWriteMapTH2) WriteMapTH2(evt, p, train.fPMap);
@@ -127,6 +153,27 @@ namespace cvn {
 
   //----------------------------------------------------------------------
 
+  void CVNEventDumpProtoDUNE::WriteAsync(const TrainingData& train)
+  {
+    const unsigned int nPixel = train.fPMap.NInput();
+    if(!fAsyncWriter){
+      fAsyncNPixel = nPixel;
+      fAsyncWriter = std::make_unique<AsyncDumpWriter>(fAsyncFile, "CVNTrainTree",
+                                                       TrainingData::DumpRecordLayout(nPixel),
+                                                       fAsyncQueueDepth, fAsyncCompression);
+    }
+    // The branches have a fixed size
+    if(nPixel != fAsyncNPixel){
+      mf::LogWarning("CVNEventDumpProtoDUNE") << "Skipping a pixel map of " << nPixel << " pixels, "
+                                              << fAsyncFile << " holds maps of " << fAsyncNPixel;
+      return;
+    }
+
+    DumpRecord record = fAsyncWriter->NewRecord();
+    train.FillDumpRecord(record);
+    fAsyncWriter->Write(std::move(record));
+  }
+
 
 
   void CVNEventDumpProtoDUNE::WriteMapTH2(const art::Event& evt, int slice, const PixelMap& pm)
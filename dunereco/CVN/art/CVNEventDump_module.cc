@@ -8,6 +8,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // ROOT includes
@@ -33,6 +34,8 @@
 #include "nusimdata/SimulationBase/MCTruth.h"
 
 #include "dunereco/CVN/func/AssignLabels.h"
+#include "dunereco/CVN/func/AsyncDumpWriter.h"
+#include "dunereco/CVN/func/DenseMapBranches.h"
 #include "dunereco/CVN/func/TrainingData.h"
 #include "dunereco/CVN/func/InteractionType.h"
 #include "dunereco/CVN/func/PixelMap.h"
@@ -68,10 +71,22 @@ namespace cvn {
     bool        fApplyFidVol;
     bool        fUseTopology;
     unsigned int fTopologyHits; // Number of hits for a track to be considered detectable 
+    std::string fTopologyLabelsLabel; // Labels from CVNTopologyLabels, empty to calculate them here
                                    // for topology definitions.
 
     TrainingData* fTrain;
     TTree*        fTrainTree;
+    DenseMapBranches fDenseMap; ///< The dense PE vectors the tree readers expect
+
+    // Writer thread filling the tree in a file of its own, if AsyncDump.OutputFile is set
+    std::string  fAsyncFile;
+    unsigned int fAsyncQueueDepth;
+    int          fAsyncCompression;
+    std::unique_ptr<AsyncDumpWriter> fAsyncWriter;
+    unsigned int fAsyncNPixel; ///< Pixels per map, fixed by the first one written
+
+    /// Queue the record for the writer thread, opening the file with the first one
+    void WriteAsync(const TrainingData& train);
 
     /// Function to extract TH2 from PixelMap and write to TFile
     void WriteMapTH2(const art::Event& evt, int slice, const PixelMap& pm);
@@ -96,6 +111,10 @@ namespace cvn {
     fPixelMapInput  = pset.get<std::string>("PixelMapInput");
     fGenieGenModuleLabel  = pset.get<std::string>("GenieGenModuleLabel");
     fWriteMapTH2    = pset.get<bool>       ("WriteMapTH2");
+    const fhicl::ParameterSet asyncDump = pset.get<fhicl::ParameterSet>("AsyncDump", fhicl::ParameterSet());
+    fAsyncFile        = asyncDump.get<std::string>("OutputFile", "");
+    fAsyncQueueDepth  = asyncDump.get<unsigned int>("QueueDepth", 16);
+    fAsyncCompression = asyncDump.get<int>("Compression", -1);
     fApplyFidVol    = pset.get<bool>("ApplyFidVol");
     fEnergyNueLabel = pset.get<std::string> ("EnergyNueLabel");  
     fEnergyNumuLabel = pset.get<std::string> ("EnergyNumuLabel");
@@ -104,6 +123,7 @@ namespace cvn {
     fGetEventWeight = pset.get<bool> ("GetEventWeight");
     fUseTopology  = pset.get<bool>("UseTopology");
     fTopologyHits = pset.get<unsigned int>("TopologyHitsCut");    
+    fTopologyLabelsLabel = pset.get<std::string>("TopologyLabelsLabel", "");
   }
 
   //......................................................................
@@ -111,10 +131,14 @@ namespace cvn {
   {
 
 
+    // The asynchronous writer makes its tree with the first record
+    if(!fAsyncFile.empty()) return;
+
     art::ServiceHandle<art::TFileService> tfs;
 
     fTrainTree = tfs->make<TTree>("CVNTrainTree", "Training records");
     fTrainTree->Branch("train", "cvn::TrainingData", &fTrain);
+    fDenseMap.Book(fTrainTree);
 
 
   }
@@ -122,7 +146,7 @@ namespace cvn {
   //......................................................................
   void CVNEventDump::endJob()
   {
-
+    if(fAsyncWriter) fAsyncWriter->Close();
   }
 
   //......................................................................
@@ -159,7 +183,7 @@ namespace cvn {
 
     interaction = labels.GetInteractionType(truthN);
     if(fUseTopology){
-      labels.GetTopology(truth,fTopologyHits);
+      labels.GetTopology(evt,fTopologyLabelsLabel,truth,fTopologyHits);
 //      labels.PrintTopology();
     }
     float nuEnergy = 0;
@@ -225,8 +249,12 @@ namespace cvn {
     if(fUseTopology){
       train.SetTopologyInformation(topPDG, nprot, npion, npi0, nneut, toptype, toptypealt);
     }
-    fTrain = &train;
-    fTrainTree->Fill();
+    if(fAsyncFile.empty()){
+      fTrain = &train;
+      fDenseMap.Set(train.fPMap);
+      fTrainTree->Fill();
+    }
+    else WriteAsync(train);
 
     // Make a plot of the pixel map if required
     if (fWriteMapTH2) WriteMapTH2(evt, 0, train.fPMap);
@@ -235,6 +263,27 @@ namespace cvn {
 
   //----------------------------------------------------------------------
 
+  void CVNEventDump::WriteAsync(const TrainingData& train)
+  {
+    const unsigned int nPixel = train.fPMap.NInput();
+    if(!fAsyncWriter){
+      fAsyncNPixel = nPixel;
+      fAsyncWriter = std::make_unique<AsyncDumpWriter>(fAsyncFile, "CVNTrainTree",
+                                                       TrainingData::DumpRecordLayout(nPixel),
+                                                       fAsyncQueueDepth, fAsyncCompression);
+    }
+    // The branches have a fixed size
+    if(nPixel != fAsyncNPixel){
+      mf::LogWarning("CVNEventDump") << "Skipping a pixel map of " << nPixel << " pixels, "
+                                     << fAsyncFile << " holds maps of " << fAsyncNPixel;
+      return;
+    }
+
+    DumpRecord record = fAsyncWriter->NewRecord();
+    train.FillDumpRecord(record);
+    fAsyncWriter->Write(std::move(record));
+  }
+
 
 
   void CVNEventDump::WriteMapTH2(const art::Event& evt, int slice, const PixelMap& pm)
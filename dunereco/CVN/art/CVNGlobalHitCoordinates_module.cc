@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////
+// \file    CVNGlobalHitCoordinates_module.cc
+// \brief   Producer module for the global wire, plane and time of the hits
+//          shared by the CVN pixel map makers
+////////////////////////////////////////////////////////////////////////
+
+// Framework includes
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "canvas/Persistency/Common/Ptr.h"
+
+// LArSoft includes
+#include "lardataobj/RecoBase/Hit.h"
+
+#include "dunereco/CVN/art/PixelMapProducer.h"
+#include "dunereco/CVN/func/GlobalHitCoordinates.h"
+
+namespace cvn {
+
+  class CVNGlobalHitCoordinates : public art::EDProducer {
+  public:
+    explicit CVNGlobalHitCoordinates(fhicl::ParameterSet const& pset);
+
+    void produce(art::Event& evt);
+
+  private:
+    /// Module label of the hits
+    std::string    fHitsModuleLabel;
+
+    /// Unwrapping of the pixel maps that use the coordinates
+    // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
+    unsigned short fUnwrappedPixelMap;
+
+    /// Use the ProtoDUNE wire numbering
+    bool fProtoDUNE;
+
+    /// PixelMapProducer does the conversion for us
+    PixelMapProducer fProducer;
+
+  };
+
+  //.......................................................................
+  CVNGlobalHitCoordinates::CVNGlobalHitCoordinates(fhicl::ParameterSet const& pset): EDProducer{pset},
+  fHitsModuleLabel  (pset.get<std::string>    ("HitsModuleLabel")),
+  fUnwrappedPixelMap(pset.get<unsigned short> ("UnwrappedPixelMap")),
+  fProtoDUNE        (pset.get<bool>           ("ProtoDUNE", false))
+  {
+    fProducer.SetUnwrapped(fUnwrappedPixelMap);
+    fProducer.SetGeometryCache(pset.get<std::string> ("GeometryCacheDir", ""));
+    if(fProtoDUNE) fProducer.SetProtoDUNE();
+
+    produces< cvn::GlobalHitCoordinates >();
+  }
+
+  //......................................................................
+  void CVNGlobalHitCoordinates::produce(art::Event& evt)
+  {
+    std::vector< art::Ptr< recob::Hit > > hitlist;
+    auto hitListHandle = evt.getHandle< std::vector< recob::Hit > >(fHitsModuleLabel);
+    if (hitListHandle)
+      art::fill_ptr_vector(hitlist, hitListHandle);
+
+    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
+    evt.put(std::make_unique<cvn::GlobalHitCoordinates>(fProducer.CreateGlobalHitCoordinates(detProp, hitlist)));
+  }
+
+  //----------------------------------------------------------------------
+
+DEFINE_ART_MODULE(cvn::CVNGlobalHitCoordinates)
+} // end namespace cvn
+////////////////////////////////////////////////////////////////////////
@@ -29,11 +29,14 @@
 #include "lardataobj/RecoBase/Shower.h"
 
 #include "dunereco/CVN/art/PixelMapProducer.h"
+#include "dunereco/CVN/func/GlobalHitCoordinates.h"
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/TrainingData.h"
 
 #include "dunereco/CVN/func/CVNProtoDUNEUtils.h"
 
+#include "tbb/parallel_for.h"
+
 namespace cvn {
 
   class CVNMapperProtoDUNE : public art::EDProducer {
@@ -51,6 +54,10 @@ namespace cvn {
     /// Module label for input hits
     std::string    fHitsModuleLabel;
 
+    /// Module label of the shared global hit coordinates of the whole event
+    /// hits, empty to work them out here
+    std::string    fGlobalHitCoordinatesLabel;
+
     /// Module label for input particles
     std::string    fParticleModuleLabel;
 
@@ -92,6 +99,12 @@ namespace cvn {
     /// For protoDUNE vertex finding, we only want the beam slice
     bool fUseBeamSliceOnly;
 
+    /// Make the track and shower pixel maps in parallel
+    bool fParallelMaps;
+
+    /// Leave the pixel truth out of the maps, e.g. for data
+    bool fRecoOnly;
+
     /// PixelMapProducer does the work for us
     PixelMapProducer fProducer;
 
@@ -102,6 +115,7 @@ namespace cvn {
   //.......................................................................
   CVNMapperProtoDUNE::CVNMapperProtoDUNE(fhicl::ParameterSet const& pset): EDProducer{pset},
   fHitsModuleLabel  (pset.get<std::string>    ("HitsModuleLabel")),
+  fGlobalHitCoordinatesLabel(pset.get<std::string> ("GlobalHitCoordinatesLabel", "")),
   fParticleModuleLabel  (pset.get<std::string>    ("ParticleModuleLabel")),
   fTrackLabel  (pset.get<std::string>    ("TrackLabel")),
   fShowerLabel  (pset.get<std::string>    ("ShowerLabel")),
@@ -114,6 +128,8 @@ namespace cvn {
   fTrackLengthCut(pset.get<unsigned short> ("TrackLengthCut")),
   fUseWholeEvent(pset.get<bool> ("UseWholeEvent")),
   fUseBeamSliceOnly(pset.get<bool> ("UseBeamSliceOnly")),
+  fParallelMaps(pset.get<bool> ("ParallelMaps", false)),
+  fRecoOnly(pset.get<bool> ("RecoOnly", false)),
   fProducer      (fWireLength, fTdcWidth, fTimeResolution)
   {
 
@@ -148,7 +164,9 @@ namespace cvn {
     // Use unwrapped pixel maps if requested
     // For protoDUNE unwrapped if > 0
     fProducer.SetUnwrapped(fUnwrappedPixelMap);
+    fProducer.SetGeometryCache(pset.get<std::string> ("GeometryCacheDir", ""));
     fProducer.SetProtoDUNE();
+    fProducer.SetRecoOnly(fRecoOnly);
 
     // Use the whole event just like we would for the FD
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
@@ -162,14 +180,20 @@ namespace cvn {
       std::cout << "nhits: " << nhits << std::endl; // REMOVE 
  
       if(nhits>fMinClusterHits){
-        PixelMap pm = fProducer.CreateMap(detProp, hitlist);
-        pmCol->push_back(pm);
+        if(!fGlobalHitCoordinatesLabel.empty()){
+          auto const& coordinates = *evt.getValidHandle<cvn::GlobalHitCoordinates>(fGlobalHitCoordinatesLabel);
+          pmCol->push_back(fProducer.CreateMap(hitlist, coordinates));
+        }
+        else{
+          PixelMap pm = fProducer.CreateMap(detProp, hitlist);
+          pmCol->push_back(pm);
+        }
       }
     }
     else if(fUseBeamSliceOnly){
       // We want to make a pixel map for just APA3. We can pad out to 500 pixels in the wire number
       // The best way to do this is to get the Pandora beam slice
-      cvn::CVNProtoDUNEUtils pfpUtil;
+      cvn::CVNProtoDUNEUtils pfpUtil(evt,fParticleModuleLabel);
       const unsigned int beamSlice = pfpUtil.GetBeamSlice(evt,fParticleModuleLabel);
       if(beamSlice < 500){
         const std::vector<const recob::Hit*> sliceHits = pfpUtil.GetRecoSliceHits(beamSlice,evt,fParticleModuleLabel);
@@ -188,31 +212,44 @@ namespace cvn {
   
       std::cout << "Event contains " << allTracks->size() << " tracks and " << allShowers->size() << " showers" << std::endl;
   
-      // Iterate over the tracks and showers making a PixelMap for each 
+      // Collect the tracks and showers that get a PixelMap
+      std::vector<const std::vector<art::Ptr<recob::Hit> >*> clusters;
       for(unsigned int t = 0; t < allTracks->size(); ++t){
   
-        std::vector<art::Ptr<recob::Hit> > trackHits = findTrackHits.at(t);
+        const std::vector<art::Ptr<recob::Hit> > &trackHits = findTrackHits.at(t);
         if(trackHits.size()>fMinClusterHits && (*allTracks)[t].Length() > fTrackLengthCut){
-  //        std::cout << "Making PixelMap number " << pmCol->size() + 1 << " with " << trackHits.size() << " hits" << std::endl; 
-  
-          PixelMap pm = fProducer.CreateMap(detProp, trackHits);
-          pmCol->push_back(pm);
+          clusters.push_back(&trackHits);
         }
   
       }
   
       for(unsigned int s = 0; s < allShowers->size(); ++s){
   
-        std::vector<art::Ptr<recob::Hit> > showerHits = findShowerHits.at(s);
+        const std::vector<art::Ptr<recob::Hit> > &showerHits = findShowerHits.at(s);
         if(showerHits.size()>fMinClusterHits){
-          PixelMap pm = fProducer.CreateMap(detProp, showerHits);
-          pmCol->push_back(pm);
+          clusters.push_back(&showerHits);
+        }
+      }
+
+      // The maps are independent, so they can be made in parallel. They
+      // keep the track then shower order either way
+      pmCol->resize(clusters.size());
+      if(fParallelMaps){
+        tbb::parallel_for(size_t(0), clusters.size(), [&](size_t c){
+          (*pmCol)[c] = fProducer.CreateMap(detProp, *clusters[c]);
+        });
+      }
+      else{
+        for(size_t c = 0; c < clusters.size(); ++c){
+          (*pmCol)[c] = fProducer.CreateMap(detProp, *clusters[c]);
         }
       }
     }
 
     std::cout << "Made " << pmCol->size() << " pixel maps for this event" << std::endl;
     
+    // Only the sparse form of the maps is written to file
+    for(PixelMap& pm : *pmCol) pm.Compact();
     evt.put(std::move(pmCol), fClusterPMLabel);
 
   }
@@ -121,6 +121,7 @@ namespace cvn {
     // Use unwrapped pixel maps if requested
     // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
     fProducer.SetUnwrapped(fUnwrappedPixelMap);
+    fProducer.SetGeometryCache(pset.get<std::string> ("GeometryCacheDir", ""));
 
     std::vector< art::Ptr< sim::SimChannel > > hitlist;
     auto hitListHandle = evt.getHandle< std::vector< sim::SimChannel > >(fHitsModuleLabel);
@@ -138,6 +139,8 @@ namespace cvn {
     pm.SetTotHits(nhits);
     if(nhits > fMinClusterHits)
       pmCol->push_back(pm);
+    // Only the sparse form of the maps is written to file
+    for(PixelMap& pm : *pmCol) pm.Compact();
     evt.put(std::move(pmCol), fClusterPMLabel);
     //std::cout<<"Map Complete!"<<std::endl;
   }
@@ -1,6 +1,7 @@
 ////////////////////////////////////////////////////////////////////////
 // \file    CVNMapper_module.cc
-// \brief   Producer module for creating CVN PixelMap objects
+// \brief   Producer module for creating CVN PixelMap objects, shared
+//          between the schedules
 // \author  Alexander Radovic - a.radovic@gmail.com
 ////////////////////////////////////////////////////////////////////////
 
@@ -9,7 +10,7 @@
 #include <sstream>
 
 // Framework includes
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art_root_io/TFileDirectory.h"
@@ -25,6 +26,8 @@
 #include "lardataobj/RecoBase/Hit.h"
 
 #include "dunereco/CVN/art/PixelMapProducer.h"
+#include "dunereco/CVN/func/EventPreselection.h"
+#include "dunereco/CVN/func/GlobalHitCoordinates.h"
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/TrainingData.h"
 
@@ -33,14 +36,14 @@
 
 namespace cvn {
 
-  class CVNMapper : public art::EDProducer {
+  class CVNMapper : public art::SharedProducer {
   public:
-    explicit CVNMapper(fhicl::ParameterSet const& pset);
+    explicit CVNMapper(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
     ~CVNMapper();
 
-    void produce(art::Event& evt);
-    void beginJob();
-    void endJob();
+    void produce(art::Event& evt, art::ProcessingFrame const&) override;
+    void beginJob(art::ProcessingFrame const&) override;
+    void endJob(art::ProcessingFrame const&) override;
 
 
 
@@ -48,6 +51,10 @@ namespace cvn {
     /// Module lablel for input clusters
     std::string    fHitsModuleLabel;
 
+    /// Module label of the shared global hit coordinates, empty to work
+    /// them out here
+    std::string    fGlobalHitCoordinatesLabel;
+
     /// Instance lablel for cluster pixelmaps
     std::string    fClusterPMLabel;
 
@@ -71,27 +78,45 @@ namespace cvn {
     // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
     unsigned short fUnwrappedPixelMap;
 
-    /// PixelMapProducer does the work for us
+    /// Leave the pixel truth out of the maps, e.g. for data
+    bool fRecoOnly;
+
+    /// PixelMapProducer does the work for us, configured once so the events
+    /// can share it
     PixelMapProducer fProducer;
 
+    /// Events failing these cuts get no pixel map
+    EventPreselection fPreselection;
+
   };
 
 
 
   //.......................................................................
-  CVNMapper::CVNMapper(fhicl::ParameterSet const& pset): EDProducer{pset},
+  CVNMapper::CVNMapper(fhicl::ParameterSet const& pset, art::ProcessingFrame const&): SharedProducer{pset},
   fHitsModuleLabel  (pset.get<std::string>    ("HitsModuleLabel")),
+  fGlobalHitCoordinatesLabel(pset.get<std::string> ("GlobalHitCoordinatesLabel", "")),
   fClusterPMLabel(pset.get<std::string>    ("ClusterPMLabel")),
   fMinClusterHits(pset.get<unsigned short> ("MinClusterHits")),
   fTdcWidth     (pset.get<unsigned short> ("TdcWidth")),
   fWireLength   (pset.get<unsigned short> ("WireLength")),
   fTimeResolution   (pset.get<unsigned short> ("TimeResolution")),
   fUnwrappedPixelMap(pset.get<unsigned short> ("UnwrappedPixelMap")),
-  fProducer      (fWireLength, fTdcWidth, fTimeResolution)
+  fRecoOnly(pset.get<bool> ("RecoOnly", false)),
+  fProducer      (fWireLength, fTdcWidth, fTimeResolution),
+  fPreselection  (pset.get<fhicl::ParameterSet> ("Preselection", fhicl::ParameterSet()))
   {
+    // Use unwrapped pixel maps if requested
+    // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
+    fProducer.SetUnwrapped(fUnwrappedPixelMap);
+    fProducer.SetGeometryCache(pset.get<std::string> ("GeometryCacheDir", ""));
+    fProducer.SetRecoOnly(fRecoOnly);
+    fProducer.SetRegionOfInterest(pset.get<unsigned int> ("RegionOfInterestWires", 0),
+                                  pset.get<std::vector<bool>> ("RegionOfInterestReverseViews", {false, true, false}));
 
     produces< std::vector<cvn::PixelMap>   >(fClusterPMLabel);
 
+    async<art::InEvent>();
   }
 
   //......................................................................
@@ -103,21 +128,20 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNMapper::beginJob()
+  void CVNMapper::beginJob(art::ProcessingFrame const&)
   {  }
 
   //......................................................................
-  void CVNMapper::endJob()
+  void CVNMapper::endJob(art::ProcessingFrame const&)
   {
+    if (fPreselection.Enabled())
+      mf::LogInfo("CVNMapper") << "Preselection: " << fPreselection.NPassed() << " events mapped, "
+                               << fPreselection.NFailed() << " skipped";
   }
 
   //......................................................................
-  void CVNMapper::produce(art::Event& evt)
+  void CVNMapper::produce(art::Event& evt, art::ProcessingFrame const&)
   {
-    // Use unwrapped pixel maps if requested
-    // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
-    fProducer.SetUnwrapped(fUnwrappedPixelMap);
-
     std::vector< art::Ptr< recob::Hit > > hitlist;
     auto hitListHandle = evt.getHandle< std::vector< recob::Hit > >(fHitsModuleLabel);
     if (hitListHandle)
@@ -128,12 +152,23 @@ namespace cvn {
     std::unique_ptr< std::vector<cvn::PixelMap> >
       pmCol(new std::vector<cvn::PixelMap>);
 
-    if (nhits > fMinClusterHits) {
-      auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
-      PixelMap pm = fProducer.CreateMap(detProp, hitlist);
+    // Events failing the preselection are left without a map, so the
+    // evaluators skip them too
+    if (nhits > fMinClusterHits && fPreselection.Pass(evt, hitlist)) {
+      PixelMap pm;
+      if (!fGlobalHitCoordinatesLabel.empty()) {
+        auto const& coordinates = *evt.getValidHandle<cvn::GlobalHitCoordinates>(fGlobalHitCoordinatesLabel);
+        pm = fProducer.CreateMap(hitlist, coordinates);
+      }
+      else {
+        auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
+        pm = fProducer.CreateMap(detProp, hitlist);
+      }
       pm.SetTotHits(nhits);
       pmCol->push_back(pm);
     }
+    // Only the sparse form of the maps is written to file
+    for(PixelMap& pm : *pmCol) pm.Compact();
     evt.put(std::move(pmCol), fClusterPMLabel);
     //std::cout<<"Map Complete!"<<std::endl;
   }
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////
+// \file    CVNONNXEvaluator_module.cc
+// \brief   Producer module creating CVN neural net results with a network
+//          exported to .onnx, run by ONNX Runtime
+////////////////////////////////////////////////////////////////////////
+
+// C/C++ includes
+#include <memory>
+#include <vector>
+
+// Framework includes
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Utilities/Exception.h"
+
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
+#include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CompactResult.h"
+#include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/art/ONNXNetHandler.h"
+
+namespace cvn {
+
+  /// The products of CVNEvaluator, with the network run by ONNX Runtime
+  class CVNONNXEvaluator : public art::EDProducer {
+  public:
+    explicit CVNONNXEvaluator(fhicl::ParameterSet const& pset);
+
+    void produce(art::Event& evt) override;
+
+  private:
+
+    /// Module label for input pixel maps
+    std::string fPixelMapInput;
+    std::string fResultLabel;
+
+    cvn::ONNXNetHandler fONNXHandler;
+
+    /// If there are multiple pixel maps per event can we use them?
+    bool fMultiplePMs;
+
+    /// Which of the full and the half precision results to write
+    bool fWriteResult;
+    bool fWriteCompactResult;
+
+    /// Forwards the results of an earlier pass made with the same
+    /// configuration instead of running the network again
+    dune_ana::DUNEAnaProductReuse fReuse;
+  };
+
+  //.......................................................................
+  CVNONNXEvaluator::CVNONNXEvaluator(fhicl::ParameterSet const& pset): EDProducer{pset},
+    fPixelMapInput (pset.get<std::string>         ("PixelMapInput")),
+    fResultLabel (pset.get<std::string>         ("ResultLabel")),
+    fONNXHandler       (pset.get<fhicl::ParameterSet> ("ONNXNetHandler")),
+    fMultiplePMs (pset.get<bool> ("MultiplePMs")),
+    fWriteResult (pset.get<bool> ("WriteResult", true)),
+    fWriteCompactResult (pset.get<bool> ("WriteCompactResult", false)),
+    fReuse (pset)
+  {
+    fReuse.AddInput< std::vector<cvn::PixelMap> >(art::InputTag(fPixelMapInput, fPixelMapInput));
+
+    if(fWriteResult)
+      produces< std::vector<cvn::Result>   >(fResultLabel);
+    if(fWriteCompactResult)
+      produces< std::vector<cvn::CompactResult> >(fResultLabel);
+  }
+
+  //......................................................................
+  void CVNONNXEvaluator::produce(art::Event& evt)
+  {
+    // Results of an earlier pass with the same configuration are forwarded
+    if(fReuse.Enabled() &&
+       (!fWriteResult || fReuse.Matches< std::vector<Result> >(evt, fResultLabel)) &&
+       (!fWriteCompactResult || fReuse.Matches< std::vector<CompactResult> >(evt, fResultLabel))){
+      if(fWriteResult)
+        fReuse.Forward< std::vector<Result> >(evt, fResultLabel);
+      if(fWriteCompactResult)
+        fReuse.Forward< std::vector<CompactResult> >(evt, fResultLabel);
+      return;
+    }
+
+    auto resultCol = std::make_unique< std::vector<Result> >();
+    auto compactResultCol = std::make_unique< std::vector<CompactResult> >();
+
+    /// Load in the pixel maps
+    std::vector< art::Ptr< cvn::PixelMap > > pixelmaplist;
+    art::InputTag itag1(fPixelMapInput, fPixelMapInput);
+    auto pixelmapListHandle = evt.getHandle< std::vector< cvn::PixelMap > >(itag1);
+    if (pixelmapListHandle)
+      art::fill_ptr_vector(pixelmaplist, pixelmapListHandle);
+
+    if(pixelmaplist.size() > 0){
+      std::vector<const cvn::PixelMap*> pms;
+      pms.push_back(pixelmaplist[0].get());
+      if(fMultiplePMs){
+        for(unsigned int p = 1; p < pixelmaplist.size(); ++p){
+          pms.push_back(pixelmaplist[p].get());
+        }
+      }
+
+      for(auto const& networkOutput : fONNXHandler.PredictBatch(pms)){
+        if(fWriteCompactResult){
+          if(!CompactResult::HasLayout(networkOutput)){
+            throw art::Exception(art::errors::Configuration)
+              << "CVNONNXEvaluator: WriteCompactResult needs the multi-output network, the network has "
+              << networkOutput.size() << " outputs";
+          }
+          compactResultCol->emplace_back(networkOutput);
+        }
+        if(fWriteResult)
+          resultCol->emplace_back(networkOutput);
+      }
+    }
+
+    if(fWriteResult)
+      evt.put(std::move(resultCol), fResultLabel);
+    if(fWriteCompactResult)
+      evt.put(std::move(compactResultCol), fResultLabel);
+  }
+
+  DEFINE_ART_MODULE(cvn::CVNONNXEvaluator)
+}
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////
+// \file    CVNSharedEvaluator_module.cc
+// \brief   Producer module creating CVN neural net results, running the
+//          network from a request queue of the InferenceService so the
+//          pixel maps of all the schedules are classified in shared batches
+////////////////////////////////////////////////////////////////////////
+
+// C/C++ includes
+#include <future>
+#include <memory>
+#include <vector>
+
+// Framework includes
+#include "art/Framework/Core/SharedProducer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Utilities/Exception.h"
+
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
+#include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CompactResult.h"
+#include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/art/TFNetHandler.h"
+#include "dunereco/InferenceService/InferenceService.h"
+
+namespace cvn {
+
+  /// The products of CVNEvaluator, as a shared module calling the network
+  /// through the InferenceService
+  class CVNSharedEvaluator : public art::SharedProducer {
+  public:
+    using Output = std::vector< std::vector<float> >;
+
+    explicit CVNSharedEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
+
+    void produce(art::Event& evt, art::ProcessingFrame const&) override;
+
+  private:
+
+    /// Module label for input pixel maps
+    std::string fPixelMapInput;
+    std::string fResultLabel;
+
+    /// Only used from the queue workers
+    cvn::TFNetHandler fTFHandler;
+
+    /// Request queue of the network
+    std::shared_ptr< infer::BatchQueue<PixelMap, Output> > fQueue;
+
+    /// If there are multiple pixel maps per event can we use them?
+    bool fMultiplePMs;
+
+    /// Which of the full and the half precision results to write
+    bool fWriteResult;
+    bool fWriteCompactResult;
+
+    /// Forwards the results of an earlier pass made with the same
+    /// configuration instead of running the network again
+    dune_ana::DUNEAnaProductReuse fReuse;
+  };
+
+  //.......................................................................
+  CVNSharedEvaluator::CVNSharedEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&):
+    SharedProducer{pset},
+    fPixelMapInput (pset.get<std::string>         ("PixelMapInput")),
+    fResultLabel (pset.get<std::string>         ("ResultLabel")),
+    fTFHandler       (pset.get<fhicl::ParameterSet> ("TFNetHandler")),
+    fMultiplePMs (pset.get<bool> ("MultiplePMs")),
+    fWriteResult (pset.get<bool> ("WriteResult", true)),
+    fWriteCompactResult (pset.get<bool> ("WriteCompactResult", false)),
+    fReuse (pset)
+  {
+    // The queue is named after the module unless several modules share the network
+    const std::string queueName = pset.get<std::string>("QueueName", pset.get<std::string>("module_label"));
+    fQueue = art::ServiceHandle<dune::InferenceService>()->GetQueue<PixelMap, Output>(queueName,
+      [this](const std::vector<const PixelMap*>& pms){ return fTFHandler.PredictBatch(pms); });
+
+    fReuse.AddInput< std::vector<cvn::PixelMap> >(art::InputTag(fPixelMapInput, fPixelMapInput));
+
+    if(fWriteResult)
+      produces< std::vector<cvn::Result>   >(fResultLabel);
+    if(fWriteCompactResult)
+      produces< std::vector<cvn::CompactResult> >(fResultLabel);
+
+    async<art::InEvent>();
+  }
+
+  //......................................................................
+  void CVNSharedEvaluator::produce(art::Event& evt, art::ProcessingFrame const&)
+  {
+    // Results of an earlier pass with the same configuration are forwarded
+    if(fReuse.Enabled() &&
+       (!fWriteResult || fReuse.Matches< std::vector<Result> >(evt, fResultLabel)) &&
+       (!fWriteCompactResult || fReuse.Matches< std::vector<CompactResult> >(evt, fResultLabel))){
+      if(fWriteResult)
+        fReuse.Forward< std::vector<Result> >(evt, fResultLabel);
+      if(fWriteCompactResult)
+        fReuse.Forward< std::vector<CompactResult> >(evt, fResultLabel);
+      return;
+    }
+
+    auto resultCol = std::make_unique< std::vector<Result> >();
+    auto compactResultCol = std::make_unique< std::vector<CompactResult> >();
+
+    /// Load in the pixel maps
+    std::vector< art::Ptr< cvn::PixelMap > > pixelmaplist;
+    art::InputTag itag1(fPixelMapInput, fPixelMapInput);
+    auto pixelmapListHandle = evt.getHandle< std::vector< cvn::PixelMap > >(itag1);
+    if (pixelmapListHandle)
+      art::fill_ptr_vector(pixelmaplist, pixelmapListHandle);
+
+    if(pixelmaplist.size() > 0){
+      std::vector<const cvn::PixelMap*> pms;
+      pms.push_back(pixelmaplist[0].get());
+      if(fMultiplePMs){
+        for(unsigned int p = 1; p < pixelmaplist.size(); ++p){
+          pms.push_back(pixelmaplist[p].get());
+        }
+      }
+
+      // The pixel maps stay in the event until the future is ready
+      std::future< std::vector<Output> > networkOutputs = fQueue->Submit(pms);
+
+      for(auto const& networkOutput : networkOutputs.get()){
+        if(fWriteCompactResult){
+          if(!CompactResult::HasLayout(networkOutput)){
+            throw art::Exception(art::errors::Configuration)
+              << "CVNSharedEvaluator: WriteCompactResult needs the multi-output network, the network has "
+              << networkOutput.size() << " outputs";
+          }
+          compactResultCol->emplace_back(networkOutput);
+        }
+        if(fWriteResult)
+          resultCol->emplace_back(networkOutput);
+      }
+    }
+
+    if(fWriteResult)
+      evt.put(std::move(resultCol), fResultLabel);
+    if(fWriteCompactResult)
+      evt.put(std::move(compactResultCol), fResultLabel);
+  }
+
+  DEFINE_ART_MODULE(cvn::CVNSharedEvaluator)
+}
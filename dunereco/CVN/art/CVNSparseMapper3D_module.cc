@@ -45,6 +45,7 @@ namespace cvn {
     std::string    fSPModuleLabel;   ///< Module label for reconstructed spacepoints
     std::string    fPixelMapLabel;   ///< Instance label for spacepoint pixelmaps
     unsigned short fMinSP;           ///< Minimum number of spacepoints to be converted to pixel map
+    float          fVoxelSize;       ///< Side of the voxels merging spacepoints (cm), 0 for one pixel per hit
     PixelMapProducer fProducer;      ///< PixelMapProducer does the heavy lifting
 
   };
@@ -56,6 +57,7 @@ namespace cvn {
   fSPModuleLabel(pset.get<std::string>      ("SpacePointModuleLabel")),
   fPixelMapLabel(pset.get<std::string>      ("PixelMapLabel")),
   fMinSP(pset.get<unsigned short>           ("MinSP")),
+  fVoxelSize(pset.get<float>                ("VoxelSize", 0.)),
   fProducer()
   {
     produces< std::vector<cvn::SparsePixelMap> >(fPixelMapLabel);
@@ -100,10 +102,13 @@ namespace cvn {
 
     if (nsp > fMinSP) {
       auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
-      SparsePixelMap map = fProducer.CreateSparseMap3D(clockData, splist, sp2Hit);
-      pmCol->push_back(map);
+      SparsePixelMap map = fVoxelSize > 0.
+        ? fProducer.CreateVoxelMap3D(clockData, splist, sp2Hit, fVoxelSize)
+        : fProducer.CreateSparseMap3D(clockData, splist, sp2Hit);
       mf::LogInfo("CVNSparseMapper3D") << "Created sparse pixel map from "
-        << nsp << " spacepoints and " << map.GetNPixels(0) << " hits.";
+        << nsp << " spacepoints and " << map.GetNPixels(0)
+        << (fVoxelSize > 0. ? " voxels." : " hits.");
+      pmCol->push_back(std::move(map));
     }
 
     evt.put(std::move(pmCol), fPixelMapLabel);
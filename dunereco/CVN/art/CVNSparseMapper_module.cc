@@ -59,6 +59,7 @@ namespace cvn {
   fIncludePixelTruth(pset.get<bool>         ("IncludePixelTruth")),
   fProducer()
   {
+    fProducer.SetGeometryCache(pset.get<std::string> ("GeometryCacheDir", ""));
 
     produces< std::vector<cvn::SparsePixelMap> >(fClusterPMLabel);
 
@@ -19,17 +19,56 @@
 #include "canvas/Persistency/Common/Ptr.h"
 
 // CVN includes
+#include "dunereco/CVN/func/FeatureEncoding.h"
 #include "dunereco/CVN/func/SparsePixelMap.h"
 
 // ROOT includes
+#include "Compression.h"
 #include "TFile.h"
+#include "TNamed.h"
 #include "TTree.h"
 
+#include <memory>
+
 // Boost includes
 #include <boost/uuid/uuid.hpp>            // uuid class
 #include <boost/uuid/uuid_generators.hpp> // generators
 #include <boost/uuid/uuid_io.hpp>         // streaming
 
+namespace {
+
+  /// Flatten per-pixel vectors into one value array, with the values of
+  /// pixel i at [offsets[i], offsets[i+1])
+  template <typename T>
+  void Flatten(const std::vector<std::vector<T>>& in, std::vector<T>& values,
+    std::vector<unsigned int>& offsets) {
+    values.clear();
+    offsets.clear();
+    offsets.reserve(in.size() + 1);
+    offsets.push_back(0);
+    for (const std::vector<T>& pixel : in) {
+      values.insert(values.end(), pixel.begin(), pixel.end());
+      offsets.push_back(values.size());
+    }
+  }
+
+  /// Flatten per-pixel values into their storage type, encode(value, j)
+  /// giving the stored value of the j-th value of a pixel
+  template <typename T, typename Encode>
+  void FlattenEncoded(const std::vector<std::vector<float>>& in, std::vector<T>& values,
+    std::vector<unsigned int>& offsets, Encode encode) {
+    values.clear();
+    offsets.clear();
+    offsets.reserve(in.size() + 1);
+    offsets.push_back(0);
+    for (const std::vector<float>& pixel : in) {
+      for (size_t j = 0; j < pixel.size(); ++j) values.push_back(encode(pixel[j], j));
+      offsets.push_back(values.size());
+    }
+  }
+
+}
+
 namespace cvn {
 
   class CVNSparseROOT : public art::EDAnalyzer {
@@ -54,6 +93,12 @@ namespace cvn {
     std::string fOutputName; ///< ROOT output filename
     std::string fTreeName; ///< ROOt tree name
     bool        fIncludeGroundTruth; ///< Whether to include per-pixel ground truth
+    bool        fFlatten; ///< Write offsets and flat value arrays instead of nested vectors
+    std::string fCompressionAlgorithm; ///< zlib, lzma, lz4 or zstd, empty for the ROOT default
+    int         fCompressionLevel; ///< Compression level, negative for the ROOT default
+    Long64_t    fAutoFlush; ///< TTree::SetAutoFlush argument
+    int         fBasketSize; ///< Basket size of every branch
+    std::unique_ptr<FeatureEncoder> fEncoder; ///< Storage types of the flattened coordinates and features
 
     std::vector<std::vector<float>> fCoordinates; ///< Pixel coordinates
     std::vector<std::vector<float>> fFeatures; ///< Pixel features
@@ -62,6 +107,23 @@ namespace cvn {
     std::vector<std::vector<float>> fPixelEnergies; ///< Pixel energy
     std::vector<std::vector<std::string>> fProcesses; // Physical process that creates the particle 
 
+    // Flattened layout, one value array and one offset array per branch
+    std::vector<float> fFlatCoordinates;
+    std::vector<unsigned int> fCoordinateOffsets;
+    std::vector<float> fFlatFeatures;
+    std::vector<unsigned int> fFeatureOffsets;
+    std::vector<short> fCoordinates16; ///< Flat coordinates of CoordinateType int16
+    std::vector<int> fCoordinates32; ///< Flat coordinates of CoordinateType int32
+    std::vector<unsigned short> fFeatures16; ///< Flat feature bits of FeatureType float16 or bfloat16
+    std::vector<int> fFlatPixelPDG;
+    std::vector<unsigned int> fPixelPDGOffsets;
+    std::vector<int> fFlatPixelTrackID;
+    std::vector<unsigned int> fPixelTrackIDOffsets;
+    std::vector<float> fFlatPixelEnergies;
+    std::vector<unsigned int> fPixelEnergyOffsets;
+    std::vector<std::string> fFlatProcesses;
+    std::vector<unsigned int> fProcessOffsets;
+
     std::vector<unsigned int> fEvent; ///< Event numbers
     unsigned int fView; ///< View numbers
 
@@ -85,6 +147,25 @@ namespace cvn {
     fTreeName           = p.get<std::string>("TreeName");
     fIncludeGroundTruth = p.get<bool>("IncludeGroundTruth");
     fCacheSize          = p.get<size_t>("CacheSize");
+    fFlatten            = p.get<bool>("Flatten", false);
+    fCompressionAlgorithm = p.get<std::string>("CompressionAlgorithm", "");
+    fCompressionLevel   = p.get<int>("CompressionLevel", -1);
+    fAutoFlush          = p.get<Long64_t>("AutoFlush", -30000000);
+    fBasketSize         = p.get<int>("BasketSize", 32000);
+
+    if (!fCompressionAlgorithm.empty() && fCompressionAlgorithm != "zlib" &&
+        fCompressionAlgorithm != "lzma" && fCompressionAlgorithm != "lz4" &&
+        fCompressionAlgorithm != "zstd") {
+      throw art::Exception(art::errors::Configuration)
+        << "Unknown CompressionAlgorithm " << fCompressionAlgorithm
+        << ", expected zlib, lzma, lz4 or zstd" << std::endl;
+    }
+
+    fEncoder = std::make_unique<FeatureEncoder>(ReadEncodingConfig(p));
+    if (!fFlatten && !fEncoder->IsFloat32()) {
+      throw art::Exception(art::errors::Configuration)
+        << "FeatureType and CoordinateType other than float32 need Flatten" << std::endl;
+    }
 
   } // cvn::CVNSparseROOT::reconfigure
 
@@ -109,6 +190,44 @@ namespace cvn {
     if (maps.empty()) return;
 
     for (unsigned int it = 0; it < maps[0]->GetViews(); ++it) {
+      fEvent = std::vector<unsigned int>({e.id().run(), e.id().subRun(), e.id().event()});
+      fView = it;
+
+      if (fFlatten) {
+        const EncodingConfig& encoding = fEncoder->Config();
+        FeatureEncoder& encoder = *fEncoder;
+        if (encoding.coordinates == CoordinateType::kInt16) {
+          FlattenEncoded(maps[0]->GetCoordinates(it), fCoordinates16, fCoordinateOffsets,
+            [&encoder](float value, size_t) { return (short)encoder.EncodeCoordinate(value); });
+        }
+        else if (encoding.coordinates == CoordinateType::kInt32) {
+          FlattenEncoded(maps[0]->GetCoordinates(it), fCoordinates32, fCoordinateOffsets,
+            [&encoder](float value, size_t) { return (int)encoder.EncodeCoordinate(value); });
+        }
+        else {
+          Flatten(maps[0]->GetCoordinates(it), fFlatCoordinates, fCoordinateOffsets);
+        }
+        if (encoding.features != FeatureType::kFloat32) {
+          FlattenEncoded(maps[0]->GetFeatures(it), fFeatures16, fFeatureOffsets,
+            [&encoder](float value, size_t j) { return encoder.EncodeFeature(value, j); });
+        }
+        else if (!encoding.featureScales.empty()) {
+          FlattenEncoded(maps[0]->GetFeatures(it), fFlatFeatures, fFeatureOffsets,
+            [&encoder](float value, size_t j) { return value / encoder.FeatureScale(j); });
+        }
+        else {
+          Flatten(maps[0]->GetFeatures(it), fFlatFeatures, fFeatureOffsets);
+        }
+        if (fIncludeGroundTruth) {
+          Flatten(maps[0]->GetPixelPDGs(it), fFlatPixelPDG, fPixelPDGOffsets);
+          Flatten(maps[0]->GetPixelTrackIDs(it), fFlatPixelTrackID, fPixelTrackIDOffsets);
+          Flatten(maps[0]->GetPixelEnergies(it), fFlatPixelEnergies, fPixelEnergyOffsets);
+          Flatten(maps[0]->GetProcesses(it), fFlatProcesses, fProcessOffsets);
+        }
+        fTree->Fill();
+        continue;
+      }
+
       fCoordinates = maps[0]->GetCoordinates(it);
       fFeatures = maps[0]->GetFeatures(it);
       if (fIncludeGroundTruth) {
@@ -117,8 +236,6 @@ namespace cvn {
         fPixelEnergies = maps[0]->GetPixelEnergies(it);
         fProcesses     = maps[0]->GetProcesses(it);
       }
-      fEvent = std::vector<unsigned int>({e.id().run(), e.id().subRun(), e.id().event()});
-      fView = it;
       fTree->Fill();
     }
 
@@ -134,18 +251,74 @@ namespace cvn {
     fileName << fOutputName << "_" << uuid << ".root";
     fFile = TFile::Open(fileName.str().c_str(), "recreate");
 
+    if (!fCompressionAlgorithm.empty() || fCompressionLevel >= 0) {
+      // Without a level use the recommended one of each algorithm
+      ROOT::RCompressionSetting::EAlgorithm::EValues algorithm =
+        ROOT::RCompressionSetting::EAlgorithm::kUseGlobal;
+      int level = ROOT::RCompressionSetting::ELevel::kDefaultZLIB;
+      if (fCompressionAlgorithm == "zlib") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kZLIB;
+      }
+      else if (fCompressionAlgorithm == "lzma") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZMA;
+        level = ROOT::RCompressionSetting::ELevel::kDefaultLZMA;
+      }
+      else if (fCompressionAlgorithm == "lz4") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZ4;
+        level = ROOT::RCompressionSetting::ELevel::kDefaultLZ4;
+      }
+      else if (fCompressionAlgorithm == "zstd") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kZSTD;
+        level = ROOT::RCompressionSetting::ELevel::kDefaultZSTD;
+      }
+      if (fCompressionLevel >= 0) level = fCompressionLevel;
+      fFile->SetCompressionSettings(ROOT::CompressionSettings(algorithm, level));
+    }
+
     fTree = new TTree(fTreeName.c_str(), fTreeName.c_str());
     fTree->SetCacheSize(fCacheSize);
-    fTree->Branch("Coordinates", &fCoordinates);
-    fTree->Branch("Features", &fFeatures);
-    if (fIncludeGroundTruth) {
-      fTree->Branch("PixelPDG", &fPixelPDG);
-      fTree->Branch("PixelTrackID", &fPixelTrackID);
-      fTree->Branch("PixelEnergy", &fPixelEnergies);
-      fTree->Branch("Process", &fProcesses);
+    fTree->SetAutoFlush(fAutoFlush);
+    if (fFlatten) {
+      // Flat arrays stream as plain basic type vectors, which both ROOT
+      // and uproot read without the nested vector streamer
+      // Integer coordinates and 16 bit features take the branch names of
+      // the float ones, the Encoding object of the file gives their types
+      const EncodingConfig& encoding = fEncoder->Config();
+      if (encoding.coordinates == CoordinateType::kInt16)
+        fTree->Branch("Coordinates", &fCoordinates16, fBasketSize);
+      else if (encoding.coordinates == CoordinateType::kInt32)
+        fTree->Branch("Coordinates", &fCoordinates32, fBasketSize);
+      else
+        fTree->Branch("Coordinates", &fFlatCoordinates, fBasketSize);
+      fTree->Branch("CoordinateOffsets", &fCoordinateOffsets, fBasketSize);
+      if (encoding.features != FeatureType::kFloat32)
+        fTree->Branch("Features", &fFeatures16, fBasketSize);
+      else
+        fTree->Branch("Features", &fFlatFeatures, fBasketSize);
+      fTree->Branch("FeatureOffsets", &fFeatureOffsets, fBasketSize);
+      if (fIncludeGroundTruth) {
+        fTree->Branch("PixelPDG", &fFlatPixelPDG, fBasketSize);
+        fTree->Branch("PixelPDGOffsets", &fPixelPDGOffsets, fBasketSize);
+        fTree->Branch("PixelTrackID", &fFlatPixelTrackID, fBasketSize);
+        fTree->Branch("PixelTrackIDOffsets", &fPixelTrackIDOffsets, fBasketSize);
+        fTree->Branch("PixelEnergy", &fFlatPixelEnergies, fBasketSize);
+        fTree->Branch("PixelEnergyOffsets", &fPixelEnergyOffsets, fBasketSize);
+        fTree->Branch("Process", &fFlatProcesses, fBasketSize);
+        fTree->Branch("ProcessOffsets", &fProcessOffsets, fBasketSize);
+      }
+    }
+    else {
+      fTree->Branch("Coordinates", &fCoordinates, fBasketSize);
+      fTree->Branch("Features", &fFeatures, fBasketSize);
+      if (fIncludeGroundTruth) {
+        fTree->Branch("PixelPDG", &fPixelPDG, fBasketSize);
+        fTree->Branch("PixelTrackID", &fPixelTrackID, fBasketSize);
+        fTree->Branch("PixelEnergy", &fPixelEnergies, fBasketSize);
+        fTree->Branch("Process", &fProcesses, fBasketSize);
+      }
     }
-    fTree->Branch("Event", &fEvent);
-    fTree->Branch("View", &fView);
+    fTree->Branch("Event", &fEvent, fBasketSize);
+    fTree->Branch("View", &fView, fBasketSize);
 
   } // function CVNSparseROOT::beginSubRun
 
@@ -153,6 +326,17 @@ namespace cvn {
   void CVNSparseROOT::endSubRun(art::SubRun const& sr) {
 
     fFile->WriteTObject(fTree, fTreeName.c_str());
+    if (fFlatten) {
+      // Storage types and scales, "<feature type> <coordinate type>
+      // <coordinate scale> <n> <feature scales>", feature columns past the
+      // listed ones have scale 1
+      TNamed encoding("Encoding", fEncoder->Describe(fEncoder->Config().featureScales.size()).c_str());
+      fFile->WriteTObject(&encoding, "Encoding");
+    }
+    if (fEncoder->Saturated() > 0) {
+      mf::LogWarning("CVNSparseROOT") << fEncoder->Saturated()
+        << " values were clamped to the range of their storage type";
+    }
     delete fFile;
 
   } // cvn::CVNSparseROOT::endSubRun
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////
+// \file    CVNTopologyLabels_module.cc
+// \brief   Producer module for the topology labels of the neutrino
+//          interactions, shared by the CVN training data makers
+////////////////////////////////////////////////////////////////////////
+
+// Framework includes
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "canvas/Persistency/Common/Ptr.h"
+
+#include "nusimdata/SimulationBase/MCTruth.h"
+
+#include "dunereco/CVN/func/AssignLabels.h"
+#include "dunereco/CVN/func/TopologyLabels.h"
+
+namespace cvn {
+
+  class CVNTopologyLabels : public art::EDProducer {
+  public:
+    explicit CVNTopologyLabels(fhicl::ParameterSet const& pset);
+
+    void produce(art::Event& evt);
+
+  private:
+    /// Module label of the generator truth
+    std::string  fGenieGenModuleLabel;
+
+    /// Minimum number of SimIDEs for a final state particle to be counted
+    unsigned int fTopologyHitsCut;
+
+  };
+
+  //.......................................................................
+  CVNTopologyLabels::CVNTopologyLabels(fhicl::ParameterSet const& pset): EDProducer{pset},
+  fGenieGenModuleLabel(pset.get<std::string> ("GenieGenModuleLabel")),
+  fTopologyHitsCut    (pset.get<unsigned int>("TopologyHitsCut"))
+  {
+    produces< std::vector<cvn::TopologyLabels> >();
+  }
+
+  //......................................................................
+  void CVNTopologyLabels::produce(art::Event& evt)
+  {
+    std::vector<art::Ptr<simb::MCTruth>> mctruth_list;
+    auto h_mctruth = evt.getHandle<std::vector<simb::MCTruth>>(fGenieGenModuleLabel);
+    if (h_mctruth)
+      art::fill_ptr_vector(mctruth_list, h_mctruth);
+
+    // One entry for each MCTruth, in the same order
+    auto topologies = std::make_unique<std::vector<cvn::TopologyLabels>>();
+    topologies->reserve(mctruth_list.size());
+    for (const art::Ptr<simb::MCTruth>& mctruth : mctruth_list) {
+      AssignLabels labels;
+      labels.GetTopology(mctruth, fTopologyHitsCut);
+      topologies->push_back(labels.GetTopologyLabels(fTopologyHitsCut));
+    }
+
+    evt.put(std::move(topologies));
+  }
+
+  //----------------------------------------------------------------------
+
+DEFINE_ART_MODULE(cvn::CVNTopologyLabels)
+} // end namespace cvn
+////////////////////////////////////////////////////////////////////////
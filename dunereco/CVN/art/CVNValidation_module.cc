@@ -1,12 +1,16 @@
 ////////////////////////////////////////////////////////////////////////
 // \file    CVNValidation_module.cc
 // \brief   Analyzer module to make some standard validation plots
-//          of the CVN performance
+//          of the CVN performance. The confusion matrices and the
+//          efficiency and purity against energy are accumulated with
+//          atomic counters, so the module is shared between schedules
 // \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
 ////////////////////////////////////////////////////////////////////////
 
 // C/C++ includes
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // ROOT includes
@@ -15,7 +19,7 @@
 #include "TVector3.h"
 
 // Framework includes
-#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/SharedAnalyzer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Principal/SubRun.h"
@@ -25,38 +29,55 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art/Framework/Core/ModuleMacros.h"
+#include "art/Utilities/SharedResource.h"
 
 // LArSoft includes
 #include "nusimdata/SimulationBase/MCNeutrino.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 
+#include "dunereco/CVN/func/CompactResult.h"
 #include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/ValidationAccumulator.h"
 
 #include "dunereco/FDSensOpt/FDSensOptData/EnergyRecoOutput.h"
 
 
 namespace cvn {
-  class CVNValidation : public art::EDAnalyzer {
+  class CVNValidation : public art::SharedAnalyzer {
   public:
 
-    explicit CVNValidation(fhicl::ParameterSet const& pset);
+    explicit CVNValidation(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
     ~CVNValidation();
 
-    void analyze(const art::Event& evt) override;
+    void analyze(const art::Event& evt, art::ProcessingFrame const&) override;
     void reconfigure(const fhicl::ParameterSet& pset);
-    void beginJob() override;
-    void endJob() override;
+    void beginJob(art::ProcessingFrame const&) override;
+    void endJob(art::ProcessingFrame const&) override;
 
   private:
 
-    // std::string fResultLabel;
+    /// Predicted flavour of the first result, or kNotClassified when there
+    /// is none or the event was skipped by the preselection
+    unsigned int PredictedFlavour(const art::Event& evt) const;
+
+    /// CVNEvaluator results, empty to only fill the truth tree
+    std::string fResultLabel;
+    /// Read the std::vector<cvn::CompactResult> of the results instead
+    bool fUseCompactResult;
     std::string fTruthLabel;
+    /// Fill the per event tree, which serializes the module
+    bool fWriteTree;
+    /// Compact summary of the counts written at the end of the job, empty
+    /// for none. Summaries of several jobs are added with cvnMergeValidation
+    std::string fSummaryFile;
     // std::string fNumuEnergyLabel;
     // std::string fNueEnergyLabel;
 
     TTree*        fValidTree;
 
+    std::unique_ptr<ValidationAccumulator> fAccumulator;
+
     /// Tree branch variables
     /// Neutrino flavour probabilities
     // float fNumuProb;
@@ -79,10 +100,16 @@ namespace cvn {
   };
 
   //.......................................................................
-  CVNValidation::CVNValidation(fhicl::ParameterSet const& pset)
-    : EDAnalyzer(pset)
+  CVNValidation::CVNValidation(fhicl::ParameterSet const& pset, art::ProcessingFrame const&)
+    : SharedAnalyzer(pset),
+      fValidTree(nullptr)
   {
     this->reconfigure(pset);
+
+    if(fWriteTree)
+      serialize<art::InEvent>(art::SharedResource<art::TFileService>);
+    else
+      async<art::InEvent>();
   }
 
   //......................................................................
@@ -92,15 +119,22 @@ namespace cvn {
   //......................................................................
   void CVNValidation::reconfigure(const fhicl::ParameterSet& pset)
   {
-    // fResultLabel  = pset.get<std::string>("CVNResultLabel");
+    fResultLabel  = pset.get<std::string>("CVNResultLabel", "");
+    fUseCompactResult = pset.get<bool>("UseCompactResult", false);
     fTruthLabel  = pset.get<std::string>("TruthLabel");
+    fWriteTree   = pset.get<bool>("WriteTree", true);
+    fSummaryFile = pset.get<std::string>("SummaryFile", "");
+    if(!fResultLabel.empty())
+      fAccumulator = std::make_unique<ValidationAccumulator>
+        (pset.get<unsigned int>("EnergyBins", 20), pset.get<float>("MaxEnergy", 10.));
     // fNumuEnergyLabel = pset.get<std::string> ("NumuEnergyLabel");
     // fNueEnergyLabel = pset.get<std::string> ("NueEnergyLabel");
   }
 
   //......................................................................
-  void CVNValidation::beginJob()
+  void CVNValidation::beginJob(art::ProcessingFrame const&)
   {
+    if(!fWriteTree) return;
 
     art::ServiceHandle<art::TFileService> tfs;
 
@@ -122,26 +156,62 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNValidation::endJob()
+  void CVNValidation::endJob(art::ProcessingFrame const&)
   {
+    if(!fAccumulator) return;
 
+    std::ostringstream summary;
+    fAccumulator->Print(summary);
+    mf::LogInfo("CVNValidation") << summary.str();
+
+    if(!fSummaryFile.empty()) fAccumulator->Write(fSummaryFile);
   }
 
   //......................................................................
-  void CVNValidation::analyze(const art::Event& evt)
+  unsigned int CVNValidation::PredictedFlavour(const art::Event& evt) const
   {
+    if(fUseCompactResult){
+      auto cvnResults = evt.getHandle<std::vector<cvn::CompactResult>>(fResultLabel);
+      // A skipped event has every value set to -1
+      if(!cvnResults || cvnResults->empty() || cvnResults->front().GetNumuProbability() < 0.)
+        return ValidationAccumulator::kNotClassified;
+      return cvnResults->front().PredictedFlavour();
+    }
 
-    // Get the CVN results
-    // auto cvnResults = evt.getValidHandle<std::vector<cvn::Result>>(fResultLabel);
-    // if(!cvnResults.isValid()) return;
-    // if(cvnResults->size()==0) return;
+    auto cvnResults = evt.getHandle<std::vector<cvn::Result>>(fResultLabel);
+    if(!cvnResults || cvnResults->empty() || cvnResults->front().IsSkipped())
+      return ValidationAccumulator::kNotClassified;
+    return cvnResults->front().PredictedFlavour();
+  }
+
+  //......................................................................
+  void CVNValidation::analyze(const art::Event& evt, art::ProcessingFrame const&)
+  {
 
     // Get the truth information
     auto truthInfo = evt.getValidHandle<std::vector<simb::MCTruth>>(fTruthLabel);
     if(!truthInfo.isValid()) return;
     if(truthInfo->size()==0) return;
     if(!truthInfo->at(0).NeutrinoSet()) return;
-    simb::MCNeutrino true_neutrino = truthInfo->at(0).GetNeutrino();
+    const simb::MCNeutrino& true_neutrino = truthInfo->at(0).GetNeutrino();
+
+    // Count the event in the confusion matrix of its true energy
+    if(fAccumulator){
+      TFFlavour trueFlavour = kFlavNC;
+      bool known = true;
+      if(true_neutrino.CCNC() == simb::kCC){
+        switch(std::abs(true_neutrino.Nu().PdgCode())){
+          case 12: trueFlavour = kFlavNueCC;   break;
+          case 14: trueFlavour = kFlavNumuCC;  break;
+          case 16: trueFlavour = kFlavNutauCC; break;
+          default: known = false;
+        }
+      }
+      if(known)
+        fAccumulator->Fill(trueFlavour, PredictedFlavour(evt), true_neutrino.Nu().E());
+    }
+
+    if(!fWriteTree) return;
 
     // Get the energy results
     // auto numuEnergy = evt.getValidHandle<dune::EnergyRecoOutput>(fNumuEnergyLabel);
@@ -8,6 +8,9 @@
 
 // C/C++ includes
 #include <iostream>
+#include <ctime>
+#include <memory>
+#include <sstream>
 #include "boost/filesystem.hpp"
 
 // Framework includes
@@ -26,9 +29,10 @@
 #include "dunereco/CVN/func/AssignLabels.h"
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/CVNImageUtils.h"
-
-// Compression
-#include "zlib.h"
+#include "dunereco/CVN/func/ImageCodec.h"
+#include "dunereco/CVN/func/ZlibShardWriter.h"
+#include "dunereco/CVN/func/ScratchBuffers.h"
+#include "dunereco/Profiling/ProfScope.h"
 
 namespace fs = boost::filesystem;
 
@@ -41,6 +45,7 @@ namespace cvn {
     ~CVNZlibMakerProtoDUNE();
 
     void beginJob() override;
+    void endJob() override;
     void analyze(const art::Event& evt) override;
     void reconfigure(const fhicl::ParameterSet& pset);
 
@@ -69,9 +74,23 @@ namespace cvn {
 
     std::string fLArG4ModuleLabel;
 
+    /// Pack the output into tar shards of this many MB, 0 writes two files per event
+    unsigned long fShardSize;
+    std::string fShardPrefix;
+    unsigned int fShardQueueDepth;
+
+    /// zlib, zstd or lz4, see ImageCodec
+    CodecConfig fCodecConfig;
+    std::unique_ptr<ImageCodec> fCodec;
+
     std::string out_dir;
+    std::unique_ptr<ZlibShardWriter> fShardWriter;
+
+    /// Image and compression buffers kept between events when writing files
+    std::vector<unsigned char> fPixelArray;
+    std::vector<unsigned char> fCompressed;
 
-    void write_files(const PrimaryTrainingInfo &primary, const art::Ptr<cvn::PixelMap> pm, unsigned int n) const;
+    void write_files(const PrimaryTrainingInfo &primary, const art::Ptr<cvn::PixelMap> pm, unsigned int n);
 
   };
 
@@ -94,6 +113,13 @@ namespace cvn {
     fSetLog = pset.get<bool>("SetLog");
     fReverseViews = pset.get<std::vector<bool>>("ReverseViews");
     fLArG4ModuleLabel = pset.get<std::string>("LArG4ModuleLabel");
+
+    fShardSize = pset.get<unsigned long>("ShardSize", 0);
+    fShardPrefix = pset.get<std::string>("ShardPrefix", "cvn");
+    fShardQueueDepth = pset.get<unsigned int>("ShardQueueDepth", 64);
+
+    fCodecConfig = ReadCodecConfig(pset);
+    fCodec = std::make_unique<ImageCodec>(fCodecConfig);
   }
 
   //......................................................................
@@ -126,6 +152,17 @@ namespace cvn {
         << "Output directory " << out_dir << " does not exist!" << std::endl;
 
     // std::cout << "Writing files to output directory " << out_dir << std::endl;
+
+    if (fShardSize > 0)
+      fShardWriter = std::make_unique<ZlibShardWriter>(out_dir, fShardPrefix + "_h" + std::to_string(time(0)),
+        fShardSize << 20, fShardQueueDepth, fCodecConfig);
+  }
+
+  //......................................................................
+  void CVNZlibMakerProtoDUNE::endJob()
+  {
+    // Flush the queued records and close the last shard
+    if (fShardWriter) fShardWriter->Close();
   }
 
   //......................................................................
@@ -176,36 +213,48 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNZlibMakerProtoDUNE::write_files(const PrimaryTrainingInfo &primary, const art::Ptr<cvn::PixelMap> pm, unsigned int n) const
+  void CVNZlibMakerProtoDUNE::write_files(const PrimaryTrainingInfo &primary, const art::Ptr<cvn::PixelMap> pm, unsigned int n)
   {
     CVNImageUtils image_utils;
-    std::vector<unsigned char> pixel_array(3 * pm->NWire() * pm->NTdc());
+    // The shard writer recycles the buffers it has written, the files are
+    // written from the module's own buffers
+    const ulong src_len = 3 * pm->NWire() * pm->NTdc(); // pixelArray length
+    std::vector<unsigned char> shard_array;
+    if (fShardWriter) shard_array = fShardWriter->Buffer(src_len);
+    else if (ResetScratch(fPixelArray, src_len, (unsigned char)0))
+      DUNE_PROF_COUNT("cvn::CVNZlibMakerProtoDUNE scratch allocations", 1);
+    std::vector<unsigned char> &pixel_array = fShardWriter ? shard_array : fPixelArray;
 
     image_utils.DisableRegionSelection();
     image_utils.SetLogScale(fSetLog);
     image_utils.SetViewReversal(fReverseViews);
     image_utils.ConvertPixelMapToPixelArray(*(pm.get()),pixel_array);
 
-    ulong src_len = 3 * pm->NWire() * pm->NTdc(); // pixelArray length
-    ulong dest_len = compressBound(src_len);     // calculate size of the compressed data               
-    char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
-
-    int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &pixel_array[0], src_len);
-
-    // Buffer error
-
-    if (res == Z_BUF_ERROR)
-      std::cout << "Buffer too small!" << std::endl;
+    // Truth information for the info file
+    std::ostringstream info;
+    info << primary.vertex.X() << std::endl;
+    info << primary.vertex.Y() << std::endl;
+    info << primary.vertex.Z() << std::endl;
+    info << primary.energy << std::endl;
+    info << primary.interaction << std::endl;
+    info << primary.pdgCode << std::endl;
+
+    // Compression and writing happen on the shard writer thread
+    if (fShardWriter) {
+      fShardWriter->Write("cvn_event_" + std::to_string(n), std::move(pixel_array), info.str());
+      return;
+    }
 
-    // Memory error
-    else if (res ==  Z_MEM_ERROR)
-      std::cout << "Not enough memory for compression!" << std::endl;
+    const size_t capacity = fCompressed.capacity(); // the codec grows the compression buffer if needed
+    ulong dest_len = fCodec->Compress(pixel_array.data(), src_len, fCompressed);
+    if (fCompressed.capacity() != capacity)
+      DUNE_PROF_COUNT("cvn::CVNZlibMakerProtoDUNE scratch allocations", 1);
 
     // Compression ok 
-    else {
+    if (dest_len > 0) {
 
       // Create output files 
-      std::string image_file_name = out_dir + "/cvn_event_" + std::to_string(n) + ".gz";
+      std::string image_file_name = out_dir + "/cvn_event_" + std::to_string(n) + fCodec->Extension();
       std::string info_file_name = out_dir + "/cvn_event_" + std::to_string(n) + ".info";
 
       std::ofstream image_file (image_file_name, std::ofstream::binary);
@@ -215,18 +264,13 @@ namespace cvn {
 
         // Write compressed data to file
 
-        image_file.write(ostream, dest_len);
+        image_file.write(reinterpret_cast<const char*>(fCompressed.data()), dest_len);
 
         image_file.close(); // close file
 
         // Write truth information
         
-        info_file << primary.vertex.X() << std::endl;
-        info_file << primary.vertex.Y() << std::endl;
-        info_file << primary.vertex.Z() << std::endl;
-        info_file << primary.energy << std::endl;
-        info_file << primary.interaction << std::endl;
-        info_file << primary.pdgCode << std::endl;
+        info_file << info.str();
         info_file.close(); // close file
       }
       else {
@@ -244,8 +288,6 @@ namespace cvn {
             << "Unable to open file " << info_file_name << "!" << std::endl;
       }
     }
-    
-    free(ostream);  // free allocated memory
 
   } // cvn::CVNZlibMakerProtoDUNE::write_files
 
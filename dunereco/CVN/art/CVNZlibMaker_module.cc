@@ -9,6 +9,9 @@
 // C/C++ includes
 #include <iostream>
 #include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <sstream>
 
 #include "boost/filesystem.hpp"
 #include "art/Framework/Principal/Event.h"
@@ -43,9 +46,11 @@
 #include "dunereco/CVN/func/InteractionType.h"
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/ImageCodec.h"
+#include "dunereco/CVN/func/ZlibShardWriter.h"
+#include "dunereco/CVN/func/ScratchBuffers.h"
+#include "dunereco/Profiling/ProfScope.h"
 
-// Compression
-#include "zlib.h"
 #include "math.h"
 
 #include "TH1.h"
@@ -62,6 +67,7 @@ namespace cvn {
     ~CVNZlibMaker();
 
     void beginJob() override;
+    void endJob() override;
     void endSubRun(art::SubRun const &sr) override;
     void analyze(const art::Event& evt) override;
     void reconfigure(const fhicl::ParameterSet& pset);
@@ -76,6 +82,8 @@ namespace cvn {
     bool fIsVD;
     std::vector<bool> fReverseViews;
     unsigned int fTopologyHitsCut;
+    /// Labels from CVNTopologyLabels, empty to calculate the topology here
+    std::string fTopologyLabelsLabel;
 
     std::string fGenieGenModuleLabel;
     std::string fLArG4ModuleLabel;
@@ -86,9 +94,26 @@ namespace cvn {
     unsigned int fPlaneLimit;
     unsigned int fTDCLimit;
 
+    /// Pack the output into tar shards of this many MB, 0 writes two files per event
+    unsigned long fShardSize;
+    std::string fShardPrefix;
+    unsigned int fShardQueueDepth;
+
+    /// zlib, zstd or lz4, see ImageCodec
+    CodecConfig fCodecConfig;
+    std::unique_ptr<ImageCodec> fCodec;
+
     std::string out_dir;
+    std::unique_ptr<ZlibShardWriter> fShardWriter;
+
+    /// Image and compression buffers kept between events when writing files
+    std::vector<unsigned char> fPixelArray;
+    std::vector<unsigned char> fCompressed;
+
+    /// Configured once, holds the charge lookup of the image conversion
+    CVNImageUtils fImageUtils;
 
-    void write_files(TrainingData td, unsigned int n, std::string evtid);
+    void write_files(const TrainingData& td, const PixelMap& pm, unsigned int n, const std::string& evtid);
 
     TH1D* hPOT;
     double fPOT;
@@ -117,6 +142,7 @@ namespace cvn {
     fIsVD = pset.get<bool>("IsVD");
     fReverseViews = pset.get<std::vector<bool>>("ReverseViews");
     fTopologyHitsCut = pset.get<unsigned int>("TopologyHitsCut");
+    fTopologyLabelsLabel = pset.get<std::string>("TopologyLabelsLabel", "");
 
     fGenieGenModuleLabel = pset.get<std::string>("GenieGenModuleLabel");
     fLArG4ModuleLabel = pset.get<std::string>("LArG4ModuleLabel");
@@ -126,6 +152,17 @@ namespace cvn {
 
     fPlaneLimit = pset.get<unsigned int>("PlaneLimit");
     fTDCLimit = pset.get<unsigned int>("TDCLimit");
+
+    fShardSize = pset.get<unsigned long>("ShardSize", 0);
+    fShardPrefix = pset.get<std::string>("ShardPrefix", "cvn");
+    fShardQueueDepth = pset.get<unsigned int>("ShardQueueDepth", 64);
+
+    fCodecConfig = ReadCodecConfig(pset);
+    fCodec = std::make_unique<ImageCodec>(fCodecConfig);
+
+    fImageUtils.SetImageSize(fPlaneLimit, fTDCLimit, 3);
+    fImageUtils.SetLogScale(fSetLog);
+    fImageUtils.SetViewReversal(fReverseViews);
   }
 
   //......................................................................
@@ -228,6 +265,17 @@ namespace cvn {
     // std::cout << "Writing files to output directory " << out_dir << std::endl;
 
     hPOT = tfs->make<TH1D>("TotalPOT", "Total POT;; POT", 1, 0, 1);
+
+    if (fShardSize > 0)
+      fShardWriter = std::make_unique<ZlibShardWriter>(out_dir, fShardPrefix + "_h" + std::to_string(time(0)),
+        fShardSize << 20, fShardQueueDepth, fCodecConfig);
+  }
+
+  //......................................................................
+  void CVNZlibMaker::endJob()
+  {
+    // Flush the queued records and close the last shard
+    if (fShardWriter) fShardWriter->Close();
   }
 
   //......................................................................
@@ -279,7 +327,7 @@ namespace cvn {
     AssignLabels labels;
 
     interaction = labels.GetInteractionType(true_neutrino);
-    labels.GetTopology(mctruth, fTopologyHitsCut);
+    labels.GetTopology(evt, fTopologyLabelsLabel, mctruth, fTopologyHitsCut);
 
     // True lepton and neutrino energies
     float nu_energy = true_neutrino.Nu().E();
@@ -341,9 +389,11 @@ namespace cvn {
     }
 
 
+    // The pixel map is read from the event product, not copied into the
+    // training data
     TrainingData train(interaction, nu_energy, lep_energy, lepangle,
       reco_nue_energy, reco_numu_energy, reco_nutau_energy,
-      event_weight, *pixelmaps[0]);
+      event_weight, PixelMap());
 
     int pdg        = labels.GetPDG();
     int n_proton   = labels.GetNProtons();
@@ -357,41 +407,70 @@ namespace cvn {
       n_pi0, n_neutron, toptype, toptypealt);
 
     std::string evtid = "r"+std::to_string(evt.run())+"_s"+std::to_string(evt.subRun())+"_e"+std::to_string(evt.event())+"_h"+std::to_string(time(0));
-    this->write_files(train, evt.event(), evtid);
+    this->write_files(train, *pixelmaps[0], evt.event(), evtid);
   }
 
   //......................................................................
-  void CVNZlibMaker::write_files(TrainingData td, unsigned int n, std::string evtid)
+  void CVNZlibMaker::write_files(const TrainingData& td, const PixelMap& pm, unsigned int n, const std::string& evtid)
   {
     // cropped from 2880 x 500 to 500 x 500 here
-    std::vector<unsigned char> pixel_array(3 * fPlaneLimit * fTDCLimit);
+    // The shard writer recycles the buffers it has written, the files are
+    // written from the module's own buffers
+    const ulong src_len = 3 * fPlaneLimit * fTDCLimit; // pixelArray length
+    std::vector<unsigned char> shard_array;
+    if (fShardWriter) shard_array = fShardWriter->Buffer(src_len);
+    else if (ResetScratch(fPixelArray, src_len, (unsigned char)0))
+      DUNE_PROF_COUNT("cvn::CVNZlibMaker scratch allocations", 1);
+    std::vector<unsigned char> &pixel_array = fShardWriter ? shard_array : fPixelArray;
+
+    fImageUtils.ConvertPixelMapToPixelArray(pm, pixel_array);
 
-    CVNImageUtils image_utils(fPlaneLimit, fTDCLimit, 3);
-    image_utils.SetPixelMapSize(td.fPMap.NWire(), td.fPMap.NTdc());
-    image_utils.SetLogScale(fSetLog);
-    image_utils.SetViewReversal(fReverseViews);
-    image_utils.ConvertPixelMapToPixelArray(td.fPMap, pixel_array);
+    // Records for the info file
 
-    ulong src_len = 3 * fPlaneLimit * fTDCLimit; // pixelArray length
-    ulong dest_len = compressBound(src_len);     // calculate size of the compressed data
-    char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
+    std::ostringstream info;
 
-    int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &pixel_array[0], src_len);
+    // Category
 
-    // Buffer error
+    info << td.fInt << std::endl;
 
-    if (res == Z_BUF_ERROR)
-      std::cout << "Buffer too small!" << std::endl;
+    // Energy
 
-    // Memory error
-    else if (res ==  Z_MEM_ERROR)
-      std::cout << "Not enough memory for compression!" << std::endl;
+    info << td.fNuEnergy << std::endl;
+    info << td.fLepEnergy << std::endl;
+    info << td.fRecoNueEnergy << std::endl;
+    info << td.fRecoNumuEnergy << std::endl;
+    info << td.fRecoNutauEnergy << std::endl;
+    info << td.fEventWeight << std::endl;
+
+    // Topology
+
+    info << td.fNuPDG << std::endl;
+    info << td.fNProton << std::endl;
+    info << td.fNPion << std::endl;
+    info << td.fNPizero << std::endl;
+    info << td.fNNeutron << std::endl;
+
+    info << td.fTopologyType << std::endl;
+    info << td.fTopologyTypeAlt << std::endl;
+    info << pm.GetTotHits() << std::endl;
+    info << td.fLepAngle << std::endl;
+
+    // Compression and writing happen on the shard writer thread
+    if (fShardWriter) {
+      fShardWriter->Write("event_" + evtid, std::move(pixel_array), info.str());
+      return;
+    }
+
+    const size_t capacity = fCompressed.capacity(); // the codec grows the compression buffer if needed
+    ulong dest_len = fCodec->Compress(pixel_array.data(), src_len, fCompressed);
+    if (fCompressed.capacity() != capacity)
+      DUNE_PROF_COUNT("cvn::CVNZlibMaker scratch allocations", 1);
 
     // Compression ok
-    else {
+    if (dest_len > 0) {
 
       // Create output files
-      std::string image_file_name = out_dir + "/event_" + evtid + ".gz";
+      std::string image_file_name = out_dir + "/event_" + evtid + fCodec->Extension();
       std::string info_file_name = out_dir + "/event_" +  evtid + ".info";
 
       std::ofstream image_file (image_file_name, std::ofstream::binary);
@@ -401,37 +480,13 @@ namespace cvn {
 
         // Write compressed data to file
 
-        image_file.write(ostream, dest_len);
+        image_file.write(reinterpret_cast<const char*>(fCompressed.data()), dest_len);
 
         image_file.close(); // close file
 
         // Write records to file
 
-        // Category
-
-        info_file << td.fInt << std::endl;
-
-        // Energy
-
-        info_file << td.fNuEnergy << std::endl;
-        info_file << td.fLepEnergy << std::endl;
-        info_file << td.fRecoNueEnergy << std::endl;
-        info_file << td.fRecoNumuEnergy << std::endl;
-        info_file << td.fRecoNutauEnergy << std::endl;
-        info_file << td.fEventWeight << std::endl;
-
-        // Topology
-
-        info_file << td.fNuPDG << std::endl;
-        info_file << td.fNProton << std::endl;
-        info_file << td.fNPion << std::endl;
-        info_file << td.fNPizero << std::endl;
-        info_file << td.fNNeutron << std::endl;
-
-        info_file << td.fTopologyType << std::endl;
-        info_file << td.fTopologyTypeAlt << std::endl;
-        info_file << td.fPMap.GetTotHits() << std::endl;
-        info_file << td.fLepAngle << std::endl;
+        info_file << info.str();
 
         info_file.close(); // close file
       }
@@ -451,8 +506,6 @@ namespace cvn {
       }
     }
 
-    free(ostream);  // free allocated memory
-
   } // cvn::CVNZlibMaker::write_files
 
 DEFINE_ART_MODULE(cvn::CVNZlibMaker)
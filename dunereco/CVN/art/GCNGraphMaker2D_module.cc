@@ -97,15 +97,16 @@ namespace cvn {
       std::vector<cvn::GCNGraph> graphs2D = graphUtil.ExtractGraphsFromPixelMap(pixelMaps->at(0),fChargeThreshold);
 
       // For each of the graphs we want to add a number of neighbours feature
-      for(cvn::GCNGraph g : graphs2D){
+      for(cvn::GCNGraph &g : graphs2D){
         std::map<unsigned int, unsigned int> neighbourMap = graphUtil.Get2DGraphNeighbourMap(g,fNeighbourPixels);
         std::cout << "Built graph with " << g.GetNumberOfNodes() << " nodes" << std::endl;
+        std::vector<float> neighbours(g.GetNumberOfNodes());
         for(unsigned int n = 0; n < g.GetNumberOfNodes(); ++n){
-          cvn::GCNGraphNode &node = g.GetNodeEditable(n);
-          node.AddFeature(neighbourMap.at(n));
+          neighbours[n] = neighbourMap.at(n);
         }
+        g.AddFeature(neighbours);
         // Add the graph to the output vector
-        graphs->push_back(g);
+        graphs->push_back(std::move(g));
       } 
       
     }
@@ -5,6 +5,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 // C/C++ includes
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -17,15 +18,22 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "canvas/Persistency/Common/Assns.h"
+#include "canvas/Persistency/Common/FindManyP.h"
 #include "canvas/Persistency/Common/Ptr.h"
 
 // LArSoft includes
+#include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/GCNFeatureUtils.h"
+#include "dunereco/CVN/func/SpacePointGrid.h"
 
 #include "dunereco/CVN/func/CVNProtoDUNEUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaHitTruthCache.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+#include "tbb/parallel_for.h"
 
 namespace cvn {
 
@@ -65,6 +73,14 @@ namespace cvn {
 
       // Use hits not energy for truth matching
       bool fUseHitsForTruthMatching;
+
+      // Compute the node features of each graph in parallel
+      bool fParallelNodes;
+      dune::numa::PlacementConfig fPlacement;
+
+      // Store the edges between nodes closer than fEdgeRadius with the graph
+      bool fSaveEdges;
+      float fEdgeRadius;
   };
 
 
@@ -79,7 +95,11 @@ namespace cvn {
   fSliceLabel      (pset.get<std::string>("SliceModuleLabel")),
   fParticleLabel   (pset.get<std::string>("ParticleModuleLabel")),
   fUseEM           (pset.get<bool>("UseEM",true)),
-  fUseHitsForTruthMatching (pset.get<bool>("UseHitsForTruthMatching",true))
+  fUseHitsForTruthMatching (pset.get<bool>("UseHitsForTruthMatching",true)),
+  fParallelNodes   (pset.get<bool>("ParallelNodes",false)),
+  fPlacement       (dune::numa::PlacementFromPSet(pset)),
+  fSaveEdges       (pset.get<bool>("SaveEdges",false)),
+  fEdgeRadius      (pset.get<float>("EdgeRadius",3.0))
   {
 
     produces< std::vector<cvn::GCNGraph> >();
@@ -113,10 +133,17 @@ namespace cvn {
     //    std::cout << "GCNGraphMakerProtoDUNE: checking if we have enough space points (" << pointList.size() << " / " << fMinClusterHits << ")" << std::endl;
     // Vector for all of the space points
     // Get the space points from the event
+    // The space points and their hits are fetched once for all of the features
     std::vector<art::Ptr<recob::SpacePoint>> allSpacePoints;
+    std::vector<std::vector<art::Ptr<recob::Hit>>> sp2Hit;
     auto spacePointHandle = evt.getHandle<std::vector<recob::SpacePoint>>(fSpacePointLabel);
     if (spacePointHandle){
       art::fill_ptr_vector(allSpacePoints, spacePointHandle);
+      art::FindManyP<recob::Hit> fmp(spacePointHandle, evt, fSpacePointLabel);
+      sp2Hit.resize(allSpacePoints.size());
+      for (size_t spIdx = 0; spIdx < sp2Hit.size(); ++spIdx) {
+        sp2Hit[spIdx] = fmp.at(spIdx);
+      }
     }
 
     // Graph space points for each slice we want to consider
@@ -126,15 +153,21 @@ namespace cvn {
     cvn::GCNFeatureUtils graphUtil;
 
     // We can calculate the number of neighbours for each space point with some radius
-    // Store the number of neighbours for each spacepoint ID, for each slice. If we
+    // Store the number of neighbours for each spacepoint, for each slice. If we
     // only want the beam slice, or all of the slices together, this will have one
-    // element
-    std::map<unsigned int,std::vector<std::map<int,unsigned int>>> neighbourMap;
+    // element. The counts are indexed by the position of the space point in the
+    // slice, following the order of allGraphSpacePoints
+    std::map<unsigned int,std::vector<std::vector<unsigned int>>> neighbourMap;
+    // Spatial index for each slice, shared by all of the neighbour searches
+    std::map<unsigned int,cvn::SpacePointGrid> sliceGrids;
+    float maxNeighbourRadius = 0.;
+    for(const float r : fNeighbourRadii) maxNeighbourRadius = std::max(maxNeighbourRadius, r);
 
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
     if(fUseAllSlices || fUseBeamSliceOnly){
-      // We need to get a vector of space points from the beam slice
-      cvn::CVNProtoDUNEUtils pfpUtil;
+      // We need to get a vector of space points from the beam slice. Bound to the event, the
+      // slice, metadata and space point associations are only looked up once
+      cvn::CVNProtoDUNEUtils pfpUtil(evt,fParticleLabel);
 
       const unsigned short beamSliceIndex = pfpUtil.GetBeamSlice(evt,fParticleLabel);
       if(beamSliceIndex > 500 && fUseBeamSliceOnly){
@@ -160,21 +193,22 @@ namespace cvn {
           }
         }
         allGraphSpacePoints[sliceID] = sliceSpacePoints;
-        neighbourMap.insert(std::make_pair(sliceID,graphUtil.GetNeighboursForRadii(evt,fNeighbourRadii,sliceSpacePoints)));
+        std::vector<art::Ptr<recob::SpacePoint>> slicePointVec;
+        for(const auto &sp : sliceSpacePoints) slicePointVec.push_back(sp.second);
+        const cvn::SpacePointGrid &grid = sliceGrids.emplace(sliceID, cvn::SpacePointGrid(slicePointVec, maxNeighbourRadius)).first->second;
+        neighbourMap.insert(std::make_pair(sliceID,grid.CountNeighbours(fNeighbourRadii)));
       }
     }
     else{
-      std::vector<art::Ptr<recob::SpacePoint>> eventSpacePoints;
-      spacePointHandle = evt.getHandle<std::vector<recob::SpacePoint>>(fSpacePointLabel);
-      if (spacePointHandle){
-        art::fill_ptr_vector(eventSpacePoints, spacePointHandle);
-      }
       //Convert this vector to a map
       std::map<unsigned int,art::Ptr<recob::SpacePoint>> mapVec;
-      for(art::Ptr<recob::SpacePoint> p : eventSpacePoints){
+      for(art::Ptr<recob::SpacePoint> p : allSpacePoints){
         mapVec.insert(std::make_pair(p->ID(),p));
       }
-      neighbourMap.insert(std::make_pair(0,graphUtil.GetNeighboursForRadii(evt,fNeighbourRadii,eventSpacePoints)));
+      std::vector<art::Ptr<recob::SpacePoint>> orderedPoints;
+      for(const auto &sp : mapVec) orderedPoints.push_back(sp.second);
+      const cvn::SpacePointGrid &grid = sliceGrids.emplace(0, cvn::SpacePointGrid(orderedPoints, maxNeighbourRadius)).first->second;
+      neighbourMap.insert(std::make_pair(0,grid.CountNeighbours(fNeighbourRadii)));
       allGraphSpacePoints.insert(std::make_pair(0,mapVec));
     }
 
@@ -182,62 +216,86 @@ namespace cvn {
     std::cout << "Found all neighbours for " << neighbourMap.size() << " slices, building graphs..." << std::endl;
 
     // Function is linear in number of points so just do it once
-    std::map<unsigned int,float> chargeMap = graphUtil.GetSpacePointChargeMap(evt,fSpacePointLabel);
-
-    // Mean hit RMS for each spacepoint
-    std::map<unsigned int, float> hitRMSMap = graphUtil.GetSpacePointMeanHitRMSMap(evt,fSpacePointLabel);
+    // The arrays are indexed like allSpacePoints, so by the key of the space point Ptrs
+    const std::vector<float> charges = graphUtil.GetSpacePointFeatures(allSpacePoints, sp2Hit, false).charge;
 
     // The true particle PDG code is needed for training node classifiers
-    std::map<unsigned int,int> trueIDMap = graphUtil.GetTruePDG(clockData, evt, fSpacePointLabel, !fUseEM, fUseHitsForTruthMatching);
+    dune_ana::DUNEAnaHitTruthCache truthCache(clockData);
+    truthCache.Fill(sp2Hit);
+    const std::vector<int> truePDGCodes = graphUtil.GetTruePDGs(truthCache, allSpacePoints, sp2Hit, !fUseEM, fUseHitsForTruthMatching);
 
     // Now we want to produce a graph for each one of the slices
-    for(const std::pair<unsigned int,std::map<unsigned int,art::Ptr<recob::SpacePoint>>> sps : allGraphSpacePoints){
+    for(const std::pair<const unsigned int,std::map<unsigned int,art::Ptr<recob::SpacePoint>>> &sps : allGraphSpacePoints){
       if(sps.second.size() >= fMinClusterHits){
        
-        cvn::GCNGraph newGraph;
-
-        std::map<int,std::pair<int,int>> twoNearest = graphUtil.GetTwoNearestNeighbours(evt,sps.second);
+        const cvn::SpacePointGrid &grid = sliceGrids.at(sps.first);
+        const std::vector<std::pair<int,int>> twoNearest = grid.TwoNearestNeighbours();
+        const std::vector<std::vector<unsigned int>> &sliceNeighbours = neighbourMap.at(sps.first);
 
         std::cout << "Constructing graph for slice " << sps.first << " with " << sps.second.size() << " nodes." << std::endl;
-        for(const std::pair<unsigned int,art::Ptr<recob::SpacePoint>> sp : sps.second){
-  
+
+        // The nodes follow the order of the slice space points
+        std::vector<art::Ptr<recob::SpacePoint>> nodePoints;
+        nodePoints.reserve(sps.second.size());
+        for(const auto &sp : sps.second) nodePoints.push_back(sp.second);
+
+        // Neighbour counts for each radius, charge, dot product and angle
+        const unsigned int nNodes = nodePoints.size();
+        const unsigned int nFeatures = fNeighbourRadii.size() + 3;
+        std::vector<float> positions(3*nNodes), features(nFeatures*nNodes), truePDGs(nNodes);
+
+        auto fillNode = [&](size_t spIndex){
+          const art::Ptr<recob::SpacePoint> &sp = nodePoints[spIndex];
+
           // Get the position
-          std::vector<float> position;
-          // Why does this use an array... we want a vector in any case
-          const double *pos = sp.second->XYZ();
-          for(unsigned int p = 0; p < 3; ++p) position.push_back(pos[p]);
-  
-          // Calculate some features
-          std::vector<float> features;
-  
+          const double *pos = sp->XYZ();
+          for(unsigned int p = 0; p < 3; ++p) positions[3*spIndex + p] = pos[p];
+
+          float *nodeFeatures = &features[nFeatures*spIndex];
+          unsigned int f = 0;
+
           // The neighbour map gives us our first feature(s)
           for(unsigned int m = 0; m < fNeighbourRadii.size(); ++m){
-            features.push_back(neighbourMap.at(sps.first)[m].at(sp.second->ID()));
+            nodeFeatures[f++] = sliceNeighbours[m][spIndex];
           }
-  
+
           // How about charge?
-          features.push_back(chargeMap.at(sp.second->ID()));
-  
-          // Now the hit width
-//          features.push_back(hitRMSMap.at(sp.second->ID()));
+          nodeFeatures[f++] = charges[sp.key()];
+
+          // Now the hit width, see GCNFeatureUtils::GetSpacePointFeatures
+//          nodeFeatures[f++] = hitRMSMap.at(sp->ID());
 
           // Angle and dot product between node and its two nearest neighbours
           float angle = -999.;
           float dotProduct = -999.;
-          int n1ID = twoNearest[sp.second->ID()].first;
-          int n2ID = twoNearest[sp.second->ID()].second;
-          const recob::SpacePoint n1 = *(sps.second.at(n1ID).get());
-          const recob::SpacePoint n2 = *(sps.second.at(n2ID).get());
-          graphUtil.GetAngleAndDotProduct(*(sp.second.get()),n1,n2,dotProduct,angle);
-          features.push_back(dotProduct);
-          features.push_back(angle);
-  
+          const int n1Index = twoNearest[spIndex].first;
+          const int n2Index = twoNearest[spIndex].second;
+          const recob::SpacePoint &n1 = *(grid.GetSpacePoint(n1Index).get());
+          const recob::SpacePoint &n2 = *(grid.GetSpacePoint(n2Index).get());
+          graphUtil.GetAngleAndDotProduct(*(sp.get()),n1,n2,dotProduct,angle);
+          nodeFeatures[f++] = dotProduct;
+          nodeFeatures[f++] = angle;
+
           // We set the "ground truth" as the particle PDG code in this case
-          std::vector<float> truePDG;
-          truePDG.push_back(static_cast<float>(trueIDMap.at(sp.second->ID())));
-          newGraph.AddNode(position,features,truePDG);
-//          if(abs(trueIDMap.at(sp.second->ID())) != 13) std::cout << "Adding node " << sp.second->ID() << " with neighbours " << n1ID << " and " << n2ID << " and PDG = " << truePDG[0] << std::endl;
+          truePDGs[spIndex] = static_cast<float>(truePDGCodes[sp.key()]);
+        };
+
+        // Each node only reads the shared maps and writes its own rows
+        if(fParallelNodes){
+          dune::numa::Execute(fPlacement, [&]{ tbb::parallel_for(size_t(0), size_t(nNodes), fillNode); });
         }
+        else{
+          for(size_t spIndex = 0; spIndex < nNodes; ++spIndex) fillNode(spIndex);
+        }
+
+        cvn::GCNGraph newGraph;
+        newGraph.Reserve(nNodes, 3, nFeatures, 1);
+        for(unsigned int n = 0; n < nNodes; ++n){
+          newGraph.AddNode(&positions[3*n], &features[nFeatures*n], &truePDGs[n]);
+        }
+
+        // The slice grid holds the node space points in node order
+        if(fSaveEdges) graphUtil.SetRadiusEdges(newGraph, grid, fEdgeRadius);
   
         std::cout << "GCNGraphMakerProtoDUNE: produced GCNGraph object with " << newGraph.GetNumberOfNodes() << " nodes" << std::endl;
   
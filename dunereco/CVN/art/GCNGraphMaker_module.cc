@@ -28,6 +28,8 @@
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/GCNParticleFlow.h"
 #include "dunereco/CVN/func/GCNFeatureUtils.h"
+#include "dunereco/CVN/func/SpacePointGrid.h"
+#include "dunereco/AnaUtils/DUNEAnaHitTruthCache.h"
 
 namespace cvn {
 
@@ -69,6 +71,10 @@ namespace cvn {
     /// Whether to save particle hierarchy for particle flow ground truth
     bool fSaveParticleFlow;
 
+    /// Store the edges between nodes closer than fEdgeRadius with the graph
+    bool fSaveEdges;
+    float fEdgeRadius;
+
   };
 
   //.......................................................................
@@ -84,7 +90,9 @@ namespace cvn {
   fUseNodeDeghostingGroundTruth(pset.get<bool>("UseNodeDeghostingGroundTruth")),
   fTruthRadius(pset.get<float>("TruthRadius")),
   fUseNodeDirectionGroundTruth(pset.get<bool>("UseNodeDirectionGroundTruth")),
-  fSaveParticleFlow(pset.get<bool>("SaveParticleFlow"))
+  fSaveParticleFlow(pset.get<bool>("SaveParticleFlow")),
+  fSaveEdges(pset.get<bool>("SaveEdges", false)),
+  fEdgeRadius(pset.get<float>("EdgeRadius", 3.0))
 
   {
     produces< std::vector<cvn::GCNGraph>   >();
@@ -146,19 +154,19 @@ namespace cvn {
       // Store the number of neighbours for each spacepoint ID
       // const std::map<int, unsigned int> neighbourMap = graphUtil.GetAllNeighbours(evt, fNeighbourRadius, fSpacePointModuleLabel);
 
-      // Get the charge and true ID for each spacepoint
-      auto chargeMap = graphUtil.GetSpacePointChargeMap(spacePoints, sp2Hit);
-      std::unique_ptr<std::map<unsigned int, int> const> trueIDMap{nullptr};
+      // The true ID and the ground truth share one backtracking of the hits
+      dune_ana::DUNEAnaHitTruthCache truthCache(clockData);
+      if (fSaveTrueParticle || fUseNodeDeghostingGroundTruth) truthCache.Fill(sp2Hit);
+
+      // Get the charge, 2D hit features if requested and true ID for each
+      // spacepoint, indexed like the spacepoints
+      const cvn::GCNFeatureUtils::SpacePointFeatures spFeatures =
+        graphUtil.GetSpacePointFeatures(spacePoints, sp2Hit, fInclude2DFeatures);
+      std::vector<int> trueIDs;
       if (fSaveTrueParticle) {
-        trueIDMap = std::make_unique<std::map<unsigned int, int>>(graphUtil.GetTrueG4ID(clockData, spacePoints, sp2Hit));
+        trueIDs = graphUtil.GetTrueG4IDs(truthCache, spacePoints, sp2Hit, false);
       } 
 
-      // Get 2D hit features if requested
-      std::map<unsigned int, std::vector<float>> hitMap;
-      if (fInclude2DFeatures) {
-        hitMap = graphUtil.Get2DFeatures(spacePoints, sp2Hit);
-      }
-
       // Get ground truth if requested
       if (fUseNodeDirectionGroundTruth && !fUseNodeDeghostingGroundTruth) {
         throw art::Exception(art::errors::LogicError)
@@ -168,11 +176,12 @@ namespace cvn {
       std::vector<std::vector<float>>* nodeDirectionGroundTruth = nullptr;
       if (fUseNodeDirectionGroundTruth) nodeDirectionGroundTruth = new std::vector<std::vector<float>>();
       if (fUseNodeDeghostingGroundTruth) {
-        nodeDeghostingGroundTruth = graphUtil.GetNodeGroundTruth(clockData, spacePoints,
+        nodeDeghostingGroundTruth = graphUtil.GetNodeGroundTruth(truthCache, spacePoints,
           sp2Hit, fTruthRadius, nodeDirectionGroundTruth);
       }
 
       std::set<unsigned int> trueParticles;
+      std::vector<art::Ptr<recob::SpacePoint>> nodeSpacePoints;
       for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
         const art::Ptr<recob::SpacePoint> sp = spacePoints[spIdx];
         // Do we only want collection plane spacepoints?
@@ -201,16 +210,17 @@ namespace cvn {
         // The neighbour map gives us our first feature
         // features.push_back(neighbourMap.at(sp->ID()));
         // Now charge and true ID
-        features.push_back(chargeMap.at(sp->ID()));
+        features.push_back(spFeatures.charge[spIdx]);
 
         if (fInclude2DFeatures) {
-          features.insert(features.end(), hitMap.at(sp->ID()).begin(), hitMap.at(sp->ID()).end());
+          const float *hits2D = &spFeatures.hits2D[9*spIdx];
+          features.insert(features.end(), hits2D, hits2D + 9);
         }
 
         // Now ground truth info
         if (fSaveTrueParticle) {
-          truth.push_back(trueIDMap->at(sp->ID()));
-          trueParticles.insert(abs(trueIDMap->at(sp->ID())));
+          truth.push_back(trueIDs[spIdx]);
+          trueParticles.insert(abs(trueIDs[spIdx]));
         }
 
         // Add deghosting ground truth if requested
@@ -225,10 +235,17 @@ namespace cvn {
 
         // Add a node with the requested features & ground truth
         newGraph.AddNode(position, features, truth);
+        if (fSaveEdges) nodeSpacePoints.push_back(sp);
+      }
+
+      if (fSaveEdges) {
+        const cvn::SpacePointGrid grid(nodeSpacePoints, fEdgeRadius);
+        graphUtil.SetRadiusEdges(newGraph, grid, fEdgeRadius);
       }
 
       if (fSaveParticleFlow) {
-        gpf->push_back(graphUtil.GetParticleFlowMap(trueParticles));
+        gpf->push_back(graphUtil.GetParticleFlowMap(trueParticles,
+          *dune_ana::DUNEAnaMCParticleHierarchy::Get(evt)));
       }
 
       mf::LogInfo("GCNGraphMaker") << "Produced GCNGraph object with "
@@ -19,8 +19,14 @@
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/GCNFeatureUtils.h"
+#include "dunereco/CVN/func/FeatureEncoding.h"
 
 #include "hep_hpc/hdf5/make_ntuple.hpp"
+#include "hep_hpc/hdf5/PropertyList.hpp"
+
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
 
 // Boost includes
 #include <boost/uuid/uuid.hpp>            // uuid class
@@ -36,8 +42,52 @@ using std::setfill;
 using std::setw;
 
 using hep_hpc::hdf5::Column;
+using hep_hpc::hdf5::PropertyList;
+using hep_hpc::hdf5::make_column;
 using hep_hpc::hdf5::make_scalar_column;
 
+namespace {
+
+  /// Node table of the "blocks" layout, whose position and feature arrays
+  /// have the storage types of the encoder
+  class NodeTable {
+  public:
+    virtual ~NodeTable() {}
+    virtual void Insert(cvn::FeatureEncoder& encoder, const float* pos,
+      const float* feat, const float* truth) = 0;
+  };
+
+  template <typename P, typename F>
+  class TypedNodeTable : public NodeTable {
+  public:
+    using NtupleType = hep_hpc::hdf5::Ntuple<Column<P, 1>, Column<F, 1>, Column<float, 1>>;
+
+    TypedNodeTable(NtupleType* ntuple, unsigned int nCoordinates, unsigned int nFeatures)
+      : fNtuple(ntuple), fPosition(nCoordinates), fFeatures(nFeatures) {}
+
+    void Insert(cvn::FeatureEncoder& encoder, const float* pos,
+      const float* feat, const float* truth) override {
+      const P* position = nullptr;
+      if constexpr (std::is_same_v<P, float>) position = pos;
+      else {
+        for (size_t i = 0; i < fPosition.size(); ++i) fPosition[i] = encoder.EncodeCoordinate(pos[i]);
+        position = fPosition.data();
+      }
+      for (size_t i = 0; i < fFeatures.size(); ++i) {
+        if constexpr (std::is_same_v<F, float>) fFeatures[i] = feat[i] / encoder.FeatureScale(i);
+        else fFeatures[i] = encoder.EncodeFeature(feat[i], i);
+      }
+      fNtuple->insert(position, fFeatures.data(), truth);
+    }
+
+  private:
+    std::unique_ptr<NtupleType> fNtuple;
+    std::vector<P> fPosition;
+    std::vector<F> fFeatures;
+  };
+
+}
+
 namespace cvn {
 
   class GCNH5 : public art::EDAnalyzer {
@@ -58,12 +108,35 @@ namespace cvn {
 
   private:
 
+    /// Dataset creation properties carrying the configured compression filter
+    PropertyList CreationProperties() const;
+    /// Scalar column with the configured chunking and compression. Without
+    /// either it keeps the hep_hpc default chunking of the original tables
+    template <typename T> Column<T, 1> ScalarColumn(string const& name) const;
+    /// Chunk size when one must be given, for the array columns and the
+    /// compressed scalar columns
+    size_t ChunkRows() const { return fChunkSize ? fChunkSize : 1024; }
+    /// Open the per-node block tables, sized from the first graph
+    void MakeBlockNtuples(GCNGraph const& graph);
+    /// Node table with positions of type P and features of type F
+    template <typename P, typename F> void MakeNodeTable();
+    /// Open the edge table, sized from the first graph with edges
+    void MakeEdgeNtuple(GCNGraph const& graph);
+
     string fGraphModuleLabel;   ///< Name of graph producer module
     string fGraphInstanceLabel; ///< Name of graph instance
     string fTruthLabel;         ///< Name of truth producer module
     string fOutputName;         ///< Output filename
     bool fSaveEventTruth;       ///< Whether to save event-level truth information
     bool fSaveParticleTruth;    ///< Whether to include particle truth information
+    string fLayout;             ///< "columns" for one scalar row per node, "blocks" for one array row per node
+    size_t fChunkSize;          ///< HDF5 chunk size in rows, 0 for the default
+    size_t fWriteBatch;         ///< Rows buffered by each ntuple before writing
+    string fCompression;        ///< "none", "deflate", "lz4" or "blosc"
+    unsigned int fCompressionLevel; ///< Level passed to deflate and blosc
+    bool fSaveEdges;            ///< Whether to write the edges of graphs that have them
+    string fCampaign;           ///< Production campaign, empty for one uniquely named file per job
+    int fRank;                  ///< Rank of this job within the campaign
 
     hep_hpc::hdf5::File fFile;  ///< Output HDF5 file
     hep_hpc::hdf5::Ntuple<Column<int, 1>,
@@ -78,7 +151,35 @@ namespace cvn {
                           Column<float, 1>,
                           Column<float, 1>,
                           Column<int, 1>,
-                          Column<int, 1>>* fGraphNtuple; ///< graph ntuple
+                          Column<int, 1>>* fGraphNtuple = nullptr; ///< graph ntuple
+
+    std::unique_ptr<FeatureEncoder> fEncoder; ///< Storage types of the "blocks" node arrays
+    std::unique_ptr<NodeTable> fNodeTable; ///< Node ntuple, "blocks" layout
+
+    hep_hpc::hdf5::Ntuple<Column<string, 1>,
+                          Column<int, 1>,
+                          Column<string, 1>,
+                          Column<float, 1>>* fEncodingNtuple = nullptr; ///< Storage type and scale of each node array element
+
+    hep_hpc::hdf5::Ntuple<Column<int, 1>,
+                          Column<int, 1>,
+                          Column<int, 1>,
+                          Column<int, 1>,
+                          Column<int, 1>>* fGraphIndexNtuple = nullptr; ///< Node range of each graph, "blocks" layout
+
+    unsigned int fNCoordinates; ///< Node array sizes of the "blocks" layout
+    unsigned int fNFeatures;
+    unsigned int fNTruth;
+    int fNodeCount;             ///< Nodes written to the current file
+
+    hep_hpc::hdf5::Ntuple<Column<int, 1>,
+                          Column<int, 1>,
+                          Column<int, 1>,
+                          Column<int, 1>,
+                          Column<int, 1>,
+                          Column<float, 1>>* fEdgeNtuple = nullptr; ///< Edge ntuple, one row per edge
+
+    unsigned int fNEdgeFeatures; ///< Edge array size
 
     hep_hpc::hdf5::Ntuple<Column<int, 1>,
                           Column<int, 1>,
@@ -88,7 +189,7 @@ namespace cvn {
                           Column<float, 1>,
                           Column<float, 1>,
                           Column<float, 1>,
-                          Column<float, 1>>* fEventNtuple; ///< Event ntuple
+                          Column<float, 1>>* fEventNtuple = nullptr; ///< Event ntuple
 
     hep_hpc::hdf5::Ntuple<Column<int, 1>,
                           Column<int, 1>,
@@ -104,7 +205,7 @@ namespace cvn {
                           Column<float, 1>,
                           Column<float, 1>,
                           Column<string, 1>,
-                          Column<string, 1>>* fParticleNtuple; ///< Particle ntuple
+                          Column<string, 1>>* fParticleNtuple = nullptr; ///< Particle ntuple
 
   };
 
@@ -121,9 +222,146 @@ namespace cvn {
     fOutputName         = p.get<string>("OutputName");
     fSaveEventTruth     = p.get<bool>("SaveEventTruth");
     fSaveParticleTruth  = p.get<bool>("SaveParticleTruth");
+    fLayout             = p.get<string>("Layout", "columns");
+    fChunkSize          = p.get<size_t>("ChunkSize", 0);
+    fWriteBatch         = p.get<size_t>("WriteBatch", 1000);
+    fCompression        = p.get<string>("Compression", "none");
+    fCompressionLevel   = p.get<unsigned int>("CompressionLevel", 4);
+    fSaveEdges          = p.get<bool>("SaveEdges", false);
+    fCampaign           = p.get<string>("Campaign", "");
+    fRank               = p.get<int>("Rank", -1);
+
+    // Jobs launched as the ranks of mpirun, srun or aprun find their rank
+    // in the environment
+    if (fRank < 0) {
+      fRank = 0;
+      for (const char* var : {"PMI_RANK", "OMPI_COMM_WORLD_RANK", "PMIX_RANK", "SLURM_PROCID", "ALPS_APP_PE"}) {
+        if (const char* value = std::getenv(var)) {
+          fRank = std::atoi(value);
+          break;
+        }
+      }
+    }
+
+    if (fLayout != "columns" && fLayout != "blocks")
+      throw art::Exception(art::errors::Configuration)
+        << "Unknown Layout " << fLayout << ", expected columns or blocks" << endl;
+
+    fEncoder = std::make_unique<FeatureEncoder>(ReadEncodingConfig(p));
+    if (fLayout == "columns" && !fEncoder->IsFloat32())
+      throw art::Exception(art::errors::Configuration)
+        << "FeatureType and CoordinateType other than float32 need the blocks layout" << endl;
+
+    if (fCompression != "none" && fCompression != "deflate" &&
+        fCompression != "lz4" && fCompression != "blosc")
+      throw art::Exception(art::errors::Configuration)
+        << "Unknown Compression " << fCompression
+        << ", expected none, deflate, lz4 or blosc" << endl;
 
   } // cvn::GCNH5::reconfigure
 
+  PropertyList GCNH5::CreationProperties() const {
+
+    PropertyList plist{H5P_DATASET_CREATE};
+
+    if (fCompression == "deflate") {
+      plist(&H5Pset_shuffle)(&H5Pset_deflate, fCompressionLevel);
+    }
+    // LZ4 and Blosc are the registered HDF5 plugin filters 32004 and 32001.
+    // They are optional, so the data is written uncompressed if the plugin
+    // can't be found through HDF5_PLUGIN_PATH
+    else if (fCompression == "lz4") {
+      plist(&H5Pset_filter, H5Z_filter_t(32004), H5Z_FLAG_OPTIONAL, size_t(0), nullptr);
+    }
+    else if (fCompression == "blosc") {
+      // The first four values are filled in by the filter, then the level,
+      // byte shuffle on and the blosclz compressor
+      const unsigned int cdValues[7] = {0, 0, 0, 0, fCompressionLevel, 1, 0};
+      plist(&H5Pset_filter, H5Z_filter_t(32001), H5Z_FLAG_OPTIONAL, size_t(7), cdValues);
+    }
+
+    return plist;
+
+  } // cvn::GCNH5::CreationProperties
+
+  template <typename T> Column<T, 1> GCNH5::ScalarColumn(string const& name) const {
+    if (fChunkSize == 0 && fCompression == "none") return make_scalar_column<T>(name);
+    return make_scalar_column<T>(name, ChunkRows(), CreationProperties());
+  }
+
+  void GCNH5::MakeBlockNtuples(GCNGraph const& graph) {
+
+    fNCoordinates = graph.GetNumberOfNodeCoordinates();
+    fNFeatures = graph.GetNumberOfNodeFeatures();
+    fNTruth = graph.GetNumberOfNodeGroundTruth();
+
+    // Each row holds one node, and the nodes of a graph are consecutive rows.
+    // 16 bit features are stored as their raw bits, to be viewed as
+    // numpy float16 or bfloat16 as the encoding table says
+    const EncodingConfig& encoding = fEncoder->Config();
+    const bool halfFeatures = encoding.features != FeatureType::kFloat32;
+    if (encoding.coordinates == CoordinateType::kInt16) {
+      if (halfFeatures) this->MakeNodeTable<int16_t, uint16_t>();
+      else this->MakeNodeTable<int16_t, float>();
+    }
+    else if (encoding.coordinates == CoordinateType::kInt32) {
+      if (halfFeatures) this->MakeNodeTable<int32_t, uint16_t>();
+      else this->MakeNodeTable<int32_t, float>();
+    }
+    else {
+      if (halfFeatures) this->MakeNodeTable<float, uint16_t>();
+      else this->MakeNodeTable<float, float>();
+    }
+
+    // A value is restored as stored value times scale
+    fEncodingNtuple = new hep_hpc::hdf5::Ntuple(
+      make_ntuple({fFile, "encoding_table", fWriteBatch},
+      ScalarColumn<string>("array"),
+      ScalarColumn<int>("index"),
+      ScalarColumn<string>("type"),
+      ScalarColumn<float>("scale")));
+    for (unsigned int i = 0; i < fNCoordinates; ++i)
+      fEncodingNtuple->insert("position", (int)i, CoordinateTypeName(encoding.coordinates), encoding.coordinateScale);
+    for (unsigned int i = 0; i < fNFeatures; ++i)
+      fEncodingNtuple->insert("features", (int)i, FeatureTypeName(encoding.features), fEncoder->FeatureScale(i));
+
+    fGraphIndexNtuple = new hep_hpc::hdf5::Ntuple(
+      make_ntuple({fFile, "graph_index", fWriteBatch},
+      ScalarColumn<int>("run"),
+      ScalarColumn<int>("subrun"),
+      ScalarColumn<int>("event"),
+      ScalarColumn<int>("first_node"),
+      ScalarColumn<int>("n_nodes")));
+
+  } // cvn::GCNH5::MakeBlockNtuples
+
+  template <typename P, typename F> void GCNH5::MakeNodeTable() {
+
+    fNodeTable = std::make_unique<TypedNodeTable<P, F>>(new hep_hpc::hdf5::Ntuple(
+      make_ntuple({fFile, "node_table", fWriteBatch},
+      make_column<P>("position", fNCoordinates, ChunkRows(), CreationProperties()),
+      make_column<F>("features", fNFeatures, ChunkRows(), CreationProperties()),
+      make_column<float>("true_id", fNTruth, ChunkRows(), CreationProperties()))),
+      fNCoordinates, fNFeatures);
+
+  } // cvn::GCNH5::MakeNodeTable
+
+  void GCNH5::MakeEdgeNtuple(GCNGraph const& graph) {
+
+    fNEdgeFeatures = graph.GetNumberOfEdgeFeatures();
+
+    // Source and target are node indices within the graph of the event
+    fEdgeNtuple = new hep_hpc::hdf5::Ntuple(
+      make_ntuple({fFile, "edge_table", fWriteBatch},
+      ScalarColumn<int>("run"),
+      ScalarColumn<int>("subrun"),
+      ScalarColumn<int>("event"),
+      ScalarColumn<int>("source"),
+      ScalarColumn<int>("target"),
+      make_column<float>("features", fNEdgeFeatures, ChunkRows(), CreationProperties())));
+
+  } // cvn::GCNH5::MakeEdgeNtuple
+
   void GCNH5::analyze(art::Event const& e) {
 
     // Get the graphVector
@@ -148,16 +386,56 @@ namespace cvn {
     int subrun = e.id().subRun();
     int event = e.id().event();
 
-    for (size_t itNode = 0; itNode < graphVector[0]->GetNumberOfNodes(); ++itNode) {
-      GCNGraphNode node = graphVector[0]->GetNode(itNode);
+    if (fLayout == "blocks") {
+      const GCNGraph& graph = *graphVector[0];
+      if (graph.GetNumberOfNodes() > 0) {
+        if (!fNodeTable) this->MakeBlockNtuples(graph);
+
+        if (graph.GetNumberOfNodeCoordinates() != fNCoordinates
+          || graph.GetNumberOfNodeFeatures() != fNFeatures
+          || graph.GetNumberOfNodeGroundTruth() != fNTruth)
+          throw art::Exception(art::errors::LogicError)
+            << "All graph nodes must have the same number of coordinates,"
+            << " features and truth values for the blocks layout" << endl;
+
+        fGraphIndexNtuple->insert(run, subrun, event, fNodeCount, (int)graph.GetNumberOfNodes());
+
+        for (size_t itNode = 0; itNode < graph.GetNumberOfNodes(); ++itNode) {
+          fNodeTable->Insert(*fEncoder, graph.GetNodePosition(itNode), graph.GetNodeFeatures(itNode),
+            graph.GetNodeGroundTruth(itNode));
+        }
+        fNodeCount += graph.GetNumberOfNodes();
+      }
+    }
+    else {
+      for (size_t itNode = 0; itNode < graphVector[0]->GetNumberOfNodes(); ++itNode) {
+        const float* pos = graphVector[0]->GetNodePosition(itNode);
+        const float* feat = graphVector[0]->GetNodeFeatures(itNode);
+        const float* truth = graphVector[0]->GetNodeGroundTruth(itNode);
+
+        fGraphNtuple->insert(run, subrun, event, (int)round(abs(pos[0])),
+          pos[1], pos[2], feat[0], feat[1], feat[4], feat[2], feat[3],
+          (int)feat[5], truth[0]); 
+      }
+    }
 
-      vector<float> pos = node.GetPosition();
-      vector<float> feat = node.GetFeatures();
-      vector<float> truth = node.GetGroundTruth();
+    // Edges, in node order
+    const GCNGraph& edgeGraph = *graphVector[0];
+    if (fSaveEdges && edgeGraph.GetNumberOfEdges() > 0) {
+      if (!fEdgeNtuple) this->MakeEdgeNtuple(edgeGraph);
 
-      fGraphNtuple->insert(run, subrun, event, (int)round(abs(pos[0])),
-        pos[1], pos[2], feat[0], feat[1], feat[4], feat[2], feat[3],
-        (int)feat[5], truth[0]); 
+      if (edgeGraph.GetNumberOfEdgeFeatures() != fNEdgeFeatures)
+        throw art::Exception(art::errors::LogicError)
+          << "All graph edges must have the same number of features" << endl;
+
+      const std::vector<unsigned int>& offsets = edgeGraph.GetEdgeOffsets();
+      const std::vector<unsigned int>& targets = edgeGraph.GetEdgeTargets();
+      for (size_t itNode = 0; itNode + 1 < offsets.size(); ++itNode) {
+        for (unsigned int itEdge = offsets[itNode]; itEdge < offsets[itNode+1]; ++itEdge) {
+          fEdgeNtuple->insert(run, subrun, event, (int)itNode, (int)targets[itEdge],
+            edgeGraph.GetEdgeFeatures(itEdge));
+        }
+      }
     }
 
     // Event truth
@@ -184,7 +462,8 @@ namespace cvn {
 
     // // Particle tree
     if (fSaveParticleTruth) {
-      std::vector<ptruth> ptree = GCNFeatureUtils::GetParticleTree(graphVector[0].get());
+      std::vector<ptruth> ptree = GCNFeatureUtils::GetParticleTree(graphVector[0].get(),
+        *dune_ana::DUNEAnaMCParticleHierarchy::Get(e));
       for (auto p : ptree) {
         fParticleNtuple->insert(run, subrun, event,
           std::get<0>(p), std::get<1>(p), std::get<2>(p),
@@ -198,69 +477,93 @@ namespace cvn {
 
   void GCNH5::beginSubRun(art::SubRun const& sr) {
 
-    // Open HDF5 output
-    boost::uuids::random_generator generator;
-    boost::uuids::uuid uuid = generator();
+    // Open HDF5 output. The files of a campaign are named by rank so that
+    // cvnH5Campaign can stitch them into one file in rank order
     std::ostringstream fileName;
     fileName << fOutputName << "_r" << setfill('0') << setw(5) << sr.run()
-      << "_r" << setfill('0') << setw(5) << sr.subRun() << "_" << uuid
-      << ".h5";
+      << "_r" << setfill('0') << setw(5) << sr.subRun() << "_";
+    if (fCampaign.empty()) {
+      boost::uuids::random_generator generator;
+      fileName << generator();
+    }
+    else {
+      fileName << fCampaign << "_rank" << setfill('0') << setw(5) << fRank;
+    }
+    fileName << ".h5";
 
     fFile = hep_hpc::hdf5::File(fileName.str(), H5F_ACC_TRUNC);
 
-    fGraphNtuple = new hep_hpc::hdf5::Ntuple(
-      make_ntuple({fFile, "graph_table", 1000},
-      make_scalar_column<int>("run"),
-      make_scalar_column<int>("subrun"),
-      make_scalar_column<int>("event"),
-      make_scalar_column<int>("plane"),
-      make_scalar_column<float>("wire"),
-      make_scalar_column<float>("time"),
-      make_scalar_column<float>("integral"),
-      make_scalar_column<float>("rms"),
-      make_scalar_column<int>("rawplane"),
-      make_scalar_column<float>("rawwire"),
-      make_scalar_column<float>("rawtime"),
-      make_scalar_column<int>("tpc"),
-      make_scalar_column<int>("true_id")));
+    // The "blocks" tables are opened with the first graph, which tells
+    // us the size of the node arrays
+    fNodeCount = 0;
+
+    if (fLayout == "columns") {
+      fGraphNtuple = new hep_hpc::hdf5::Ntuple(
+        make_ntuple({fFile, "graph_table", fWriteBatch},
+        ScalarColumn<int>("run"),
+        ScalarColumn<int>("subrun"),
+        ScalarColumn<int>("event"),
+        ScalarColumn<int>("plane"),
+        ScalarColumn<float>("wire"),
+        ScalarColumn<float>("time"),
+        ScalarColumn<float>("integral"),
+        ScalarColumn<float>("rms"),
+        ScalarColumn<int>("rawplane"),
+        ScalarColumn<float>("rawwire"),
+        ScalarColumn<float>("rawtime"),
+        ScalarColumn<int>("tpc"),
+        ScalarColumn<int>("true_id")));
+    }
 
     if (fSaveEventTruth) {
       fEventNtuple = new hep_hpc::hdf5::Ntuple(
-        make_ntuple({fFile, "event_table", 1000},
-        make_scalar_column<int>("run"),
-        make_scalar_column<int>("subrun"),
-        make_scalar_column<int>("event"),
-        make_scalar_column<int>("is_cc"),
-        make_scalar_column<float>("nu_energy"),
-        make_scalar_column<float>("lep_energy"),
-        make_scalar_column<float>("nu_dir_x"),
-        make_scalar_column<float>("nu_dir_y"),
-        make_scalar_column<float>("nu_dir_z")));
+        make_ntuple({fFile, "event_table", fWriteBatch},
+        ScalarColumn<int>("run"),
+        ScalarColumn<int>("subrun"),
+        ScalarColumn<int>("event"),
+        ScalarColumn<int>("is_cc"),
+        ScalarColumn<float>("nu_energy"),
+        ScalarColumn<float>("lep_energy"),
+        ScalarColumn<float>("nu_dir_x"),
+        ScalarColumn<float>("nu_dir_y"),
+        ScalarColumn<float>("nu_dir_z")));
     }
 
     if (fSaveParticleTruth) {
       fParticleNtuple = new hep_hpc::hdf5::Ntuple(
-        make_ntuple({fFile, "particle_table", 1000},
-        make_scalar_column<int>("run"),
-        make_scalar_column<int>("subrun"),
-        make_scalar_column<int>("event"),
-        make_scalar_column<int>("id"),
-        make_scalar_column<int>("type"),
-        make_scalar_column<int>("parent_id"),
-        make_scalar_column<float>("momentum"),
-        make_scalar_column<float>("start_x"),
-        make_scalar_column<float>("start_y"),
-        make_scalar_column<float>("start_z"),
-        make_scalar_column<float>("end_x"),
-        make_scalar_column<float>("end_y"),
-        make_scalar_column<float>("end_z"),
-        make_scalar_column<string>("start_process"),
-        make_scalar_column<string>("end_process")));
+        make_ntuple({fFile, "particle_table", fWriteBatch},
+        ScalarColumn<int>("run"),
+        ScalarColumn<int>("subrun"),
+        ScalarColumn<int>("event"),
+        ScalarColumn<int>("id"),
+        ScalarColumn<int>("type"),
+        ScalarColumn<int>("parent_id"),
+        ScalarColumn<float>("momentum"),
+        ScalarColumn<float>("start_x"),
+        ScalarColumn<float>("start_y"),
+        ScalarColumn<float>("start_z"),
+        ScalarColumn<float>("end_x"),
+        ScalarColumn<float>("end_y"),
+        ScalarColumn<float>("end_z"),
+        ScalarColumn<string>("start_process"),
+        ScalarColumn<string>("end_process")));
     }
   }
 
   void GCNH5::endSubRun(art::SubRun const& sr) {
+    if (fEncoder->Saturated() > 0)
+      mf::LogWarning("GCNH5") << fEncoder->Saturated()
+        << " node values were clamped to the range of their storage type";
+
     delete fGraphNtuple;
+    fNodeTable.reset();
+    delete fEncodingNtuple;
+    delete fGraphIndexNtuple;
+    delete fEdgeNtuple;
+    fGraphNtuple = nullptr;
+    fEncodingNtuple = nullptr;
+    fGraphIndexNtuple = nullptr;
+    fEdgeNtuple = nullptr;
     if (fSaveEventTruth) delete fEventNtuple;
     if (fSaveParticleTruth) delete fParticleNtuple;
     fFile.close();
@@ -20,6 +20,7 @@
 
 #include "lardataobj/RecoBase/Hit.h"
 #include "dunereco/CVN/func/GCNGraph.h"
+#include "dunereco/CVN/func/GCNFeatureUtils.h"
 #include "dunereco/CVN/art/PixelMapProducer.h"
 #include "larsim/MCCheater/BackTrackerService.h"
 
@@ -44,6 +45,10 @@ namespace cvn {
   private:
 
     std::string fHitModuleLabel;
+    /// Store the edges between hits of a plane within fEdgeWireRange wires and fEdgeTimeRange ticks
+    bool fSaveEdges;
+    float fEdgeWireRange;
+    float fEdgeTimeRange;
 
   };
 
@@ -59,6 +64,9 @@ namespace cvn {
   void GCNHitGraphMaker::configure(fhicl::ParameterSet const& p)
   {
     fHitModuleLabel = p.get<std::string>("HitModuleLabel");
+    fSaveEdges = p.get<bool>("SaveEdges", false);
+    fEdgeWireRange = p.get<float>("EdgeWireRange", 2.);
+    fEdgeTimeRange = p.get<float>("EdgeTimeRange", 20.);
   }
 
   void GCNHitGraphMaker::produce(art::Event& e)
@@ -77,11 +85,17 @@ namespace cvn {
 
     // Helper classes and services
     cvn::PixelMapProducer pixelUtil;
-    art::ServiceHandle<cheat::BackTrackerService> bt;
 
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(e);
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(e, clockData);
 
+    // Backtrack all hits at once
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(hits);
+
+    // Position (plane, wire, time), six features and the true particle
+    graphs->at(0).Reserve(hits.size(), 3, 6, 1);
+
     // Loop over hits
     for (art::Ptr<recob::Hit> hit : hits) {
 
@@ -97,7 +111,7 @@ namespace cvn {
         hit->PeakTime(), (float)wireid.Plane, (float)wireid.TPC};
 
       // Get true particle
-      std::vector<sim::TrackIDE> ides = bt->HitToTrackIDEs(clockData, hit);
+      const std::vector<sim::TrackIDE>& ides = truth.GetTrackIDEs(hit);
       if (ides.size() == 0) continue; // skip hits with no truth
       float trueID = abs(std::max_element(ides.begin(), ides.end(), [](const sim::TrackIDE &lhs,
         const sim::TrackIDE &rhs) { return lhs.energy < rhs.energy; })->trackID);
@@ -111,6 +125,11 @@ namespace cvn {
       //   << " and true ID " << trueID << std::endl;
     } // for hit
 
+    if (fSaveEdges) {
+      cvn::GCNFeatureUtils graphUtil;
+      graphUtil.SetHitEdges(graphs->at(0), fEdgeWireRange, fEdgeTimeRange);
+    }
+
     e.put(std::move(graphs));
 
   }
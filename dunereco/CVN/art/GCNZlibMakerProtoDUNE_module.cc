@@ -8,6 +8,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include "boost/filesystem.hpp"
 
@@ -26,9 +27,7 @@
 // CVN includes
 #include "dunereco/CVN/func/AssignLabels.h"
 #include "dunereco/CVN/func/GCNGraph.h"
-
-// Compression
-#include "zlib.h"
+#include "dunereco/CVN/func/ImageCodec.h"
 
 namespace fs = boost::filesystem;
 
@@ -52,8 +51,14 @@ namespace cvn {
 
     std::string fLArG4ModuleLabel;
 
+    /// zlib, zstd or lz4, see ImageCodec
+    std::unique_ptr<ImageCodec> fCodec;
+
     std::string out_dir;
 
+    std::vector<float> fGraphVector; ///< Linearised graph
+    std::vector<unsigned char> fCompressed; ///< Compressed graph
+
   };
 
   //......................................................................
@@ -75,6 +80,8 @@ namespace cvn {
     fTopologyHitsCut = pset.get<unsigned int>("TopologyHitsCut");
 
     fLArG4ModuleLabel = pset.get<std::string>("LArG4ModuleLabel");
+
+    fCodec = std::make_unique<ImageCodec>(ReadCodecConfig(pset));
   }
 
   //......................................................................
@@ -146,26 +153,19 @@ namespace cvn {
       // Now write the zlib file using this information
       // We need to extract all of the information into a single vector to write
       // into the compressed file format
-      const std::vector<float> vectorToWrite = graph->ConvertGraphToVector();
+      // The buffers are kept between graphs
+      std::vector<float>& vectorToWrite = fGraphVector;
+      graph->ConvertGraphToVector(vectorToWrite);
  
       ulong src_len = vectorToWrite.size() *sizeof(float);
-      ulong dest_len = compressBound(src_len);     // calculate size of the compressed data               
-      char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
-
-      int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &vectorToWrite[0], src_len);
+      ulong dest_len = fCodec->Compress(reinterpret_cast<const unsigned char*>(vectorToWrite.data()), src_len, fCompressed);
 
-      // Buffer error
-      if (res == Z_BUF_ERROR)
-        std::cout << "Buffer too small!" << std::endl;
-      // Memory error
-      else if (res ==  Z_MEM_ERROR)
-        std::cout << "Not enough memory for compression!" << std::endl;
       // Compression ok 
-      else {
+      if (dest_len > 0) {
 
         // Create output files 
         std::stringstream image_file_name; 
-        image_file_name << out_dir << "/gcn_event_" << evt.event() << "_" << counter << ".gz";
+        image_file_name << out_dir << "/gcn_event_" << evt.event() << "_" << counter << fCodec->Extension();
         std::stringstream info_file_name;
         info_file_name  << out_dir << "/gcn_event_" << evt.event() << "_" << counter << ".info";
 
@@ -175,7 +175,7 @@ namespace cvn {
         if(image_file.is_open() && info_file.is_open()) {
 
           // Write the graph to the file and close it
-          image_file.write(ostream, dest_len);
+          image_file.write(reinterpret_cast<const char*>(fCompressed.data()), dest_len);
           image_file.close(); // close file
 
           // Write the auxillary information to the text file
@@ -188,7 +188,7 @@ namespace cvn {
 
           // Number of nodes and node features is needed for unpacking
           info_file << graph->GetNumberOfNodes() << std::endl;
-          info_file << graph->GetNode(0).GetNumberOfFeatures() << std::endl;
+          info_file << graph->GetNumberOfNodeFeatures() << std::endl;
 
           info_file.close(); // close file
         }
@@ -208,7 +208,6 @@ namespace cvn {
         }
       }
       ++counter; 
-      free(ostream);  // free allocated memory
     }
   }
     
@@ -8,6 +8,8 @@
 
 // C/C++ includes
 #include <iostream>
+#include <ctime>
+#include <memory>
 #include <sstream>
 #include "boost/filesystem.hpp"
 
@@ -17,6 +19,7 @@
 #include "art/Framework/Principal/Event.h"
 #include "canvas/Persistency/Common/Ptr.h"
 #include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 // Data products
 #include "nusimdata/SimulationBase/MCTruth.h"
@@ -26,9 +29,9 @@
 #include "dunereco/CVN/func/AssignLabels.h"
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/InteractionType.h"
-
-// Compression
-#include "zlib.h"
+#include "dunereco/CVN/func/FeatureEncoding.h"
+#include "dunereco/CVN/func/ImageCodec.h"
+#include "dunereco/CVN/func/ZlibShardWriter.h"
 
 namespace fs = boost::filesystem;
 
@@ -41,22 +44,53 @@ namespace cvn {
     ~GCNZlibMaker();
 
     void beginJob() override;
+    void endJob() override;
     void analyze(const art::Event& evt) override;
     void reconfigure(const fhicl::ParameterSet& pset);
 
   private:
 
+    /// Write the edge list of a graph as <key>.edges.gz (or the codec's
+    /// extension), next to its image
+    void WriteEdges(const cvn::GCNGraph& graph, const std::string& key);
+
+    /// Fill fEncoded with the node blocks of a graph in their storage types
+    void EncodeGraph(const cvn::GCNGraph& graph);
+
     std::string fOutputDir;
     std::string fGraphLabel;
     unsigned int fTopologyHitsCut;
+    /// Labels from CVNTopologyLabels, empty to calculate the topology here
+    std::string fTopologyLabelsLabel;
 
     std::string fGenieGenModuleLabel;
     std::string fEnergyNueLabel;
     std::string fEnergyNumuLabel;
     std::string fEnergyNutauLabel;
 
+    /// Pack the output into tar shards of this many MB, 0 writes two files per event
+    unsigned long fShardSize;
+    std::string fShardPrefix;
+    unsigned int fShardQueueDepth;
+
+    /// Also write the edges of graphs that have them
+    bool fSaveEdges;
+
+    /// zlib, zstd or lz4, see ImageCodec
+    CodecConfig fCodecConfig;
+    std::unique_ptr<ImageCodec> fCodec;
+
+    /// Storage types of the node coordinates and features, see FeatureEncoding
+    std::unique_ptr<FeatureEncoder> fEncoder;
+
     std::string out_dir;
 
+    std::vector<float> fGraphVector; ///< Linearised graph
+    std::vector<float> fEdgeVector;  ///< Linearised edges
+    std::vector<unsigned char> fCompressed; ///< Compressed graph
+    std::vector<unsigned char> fEncoded; ///< Graph in the storage types
+    std::unique_ptr<ZlibShardWriter> fShardWriter;
+
   };
 
   //......................................................................
@@ -76,11 +110,78 @@ namespace cvn {
     fOutputDir = pset.get<std::string>("OutputDir", "");
     fGraphLabel = pset.get<std::string>("GraphLabel");
     fTopologyHitsCut = pset.get<unsigned int>("TopologyHitsCut");
+    fTopologyLabelsLabel = pset.get<std::string>("TopologyLabelsLabel", "");
 
     fGenieGenModuleLabel = pset.get<std::string>("GenieGenModuleLabel");
     fEnergyNueLabel = pset.get<std::string>("EnergyNueLabel");
     fEnergyNumuLabel = pset.get<std::string>("EnergyNumuLabel");
     fEnergyNutauLabel = pset.get<std::string>("EnergyNutauLabel");
+
+    fShardSize = pset.get<unsigned long>("ShardSize", 0);
+    fShardPrefix = pset.get<std::string>("ShardPrefix", "gcn");
+    fShardQueueDepth = pset.get<unsigned int>("ShardQueueDepth", 64);
+    fSaveEdges = pset.get<bool>("SaveEdges", false);
+
+    fCodecConfig = ReadCodecConfig(pset);
+    fCodec = std::make_unique<ImageCodec>(fCodecConfig);
+    fEncoder = std::make_unique<FeatureEncoder>(ReadEncodingConfig(pset));
+  }
+
+  //......................................................................
+  void GCNZlibMaker::EncodeGraph(const cvn::GCNGraph& graph)
+  {
+    // With reduced storage types the record holds one block each of the
+    // coordinates, the features and the float32 ground truth of all nodes,
+    // so every block is a plain array of one type
+    const unsigned int nNodes = graph.GetNumberOfNodes();
+    const unsigned int nCoordinates = graph.GetNumberOfNodeCoordinates();
+    const unsigned int nFeatures = graph.GetNumberOfNodeFeatures();
+    const unsigned int nTruth = graph.GetNumberOfNodeGroundTruth();
+
+    fEncoded.clear();
+    for (unsigned int n = 0; n < nNodes; ++n)
+      fEncoder->EncodeCoordinates(graph.GetNodePosition(n), nCoordinates, fEncoded);
+    for (unsigned int n = 0; n < nNodes; ++n)
+      fEncoder->EncodeFeatures(graph.GetNodeFeatures(n), nFeatures, nFeatures, fEncoded);
+    for (unsigned int n = 0; n < nNodes; ++n) {
+      const unsigned char* truth = reinterpret_cast<const unsigned char*>(graph.GetNodeGroundTruth(n));
+      fEncoded.insert(fEncoded.end(), truth, truth + nTruth*sizeof(float));
+    }
+  }
+
+  //......................................................................
+  void GCNZlibMaker::WriteEdges(const cvn::GCNGraph& graph, const std::string& key)
+  {
+    // One row of (source, target, edge features) per edge
+    graph.ConvertEdgesToVector(fEdgeVector);
+
+    std::stringstream info;
+    info << graph.GetNumberOfEdges() << std::endl;
+    info << graph.GetNumberOfEdgeFeatures() << std::endl;
+
+    // In a shard the edges become the edges.gz and edges.info members of the record
+    if (fShardWriter) {
+      const unsigned char* bytes = reinterpret_cast<const unsigned char*>(fEdgeVector.data());
+      std::vector<unsigned char> raw(bytes, bytes + fEdgeVector.size()*sizeof(float));
+      fShardWriter->Write(key + ".edges", std::move(raw), info.str());
+      return;
+    }
+
+    ulong src_len = fEdgeVector.size() *sizeof(float);
+    ulong dest_len = fCodec->Compress(reinterpret_cast<const unsigned char*>(fEdgeVector.data()), src_len, fCompressed);
+    // The info file already announces the edges, so a graph without them would be unreadable
+    if (dest_len == 0)
+      throw art::Exception(art::errors::FileWriteError)
+        << "Failed to compress the edges of " << key << "!" << std::endl;
+
+    std::stringstream edge_file_name;
+    edge_file_name << out_dir << "/" << key << ".edges" << fCodec->Extension();
+    std::ofstream edge_file (edge_file_name.str(), std::ofstream::binary);
+    if (!edge_file.is_open())
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to open file " << edge_file_name.str() << "!" << std::endl;
+    edge_file.write(reinterpret_cast<const char*>(fCompressed.data()), dest_len);
+    edge_file.close();
   }
 
   //......................................................................
@@ -98,6 +199,21 @@ namespace cvn {
         << "Output directory " << out_dir << " does not exist!" << std::endl;
 
     // std::cout << "Writing files to output directory " << out_dir << std::endl;
+
+    if (fShardSize > 0)
+      fShardWriter = std::make_unique<ZlibShardWriter>(out_dir, fShardPrefix + "_h" + std::to_string(time(0)),
+        fShardSize << 20, fShardQueueDepth, fCodecConfig);
+  }
+
+  //......................................................................
+  void GCNZlibMaker::endJob()
+  {
+    if (fEncoder->Saturated() > 0)
+      mf::LogWarning("GCNZlibMaker") << fEncoder->Saturated()
+        << " values were clamped to the range of their storage type";
+
+    // Flush the queued records and close the last shard
+    if (fShardWriter) fShardWriter->Close();
   }
 
   //......................................................................
@@ -130,7 +246,7 @@ namespace cvn {
     AssignLabels labels;
 
     interaction = labels.GetInteractionType(true_neutrino);
-    labels.GetTopology(mctruth, fTopologyHitsCut);
+    labels.GetTopology(evt, fTopologyLabelsLabel, mctruth, fTopologyHitsCut);
 
     // True lepton and neutrino energies
     float nu_energy = true_neutrino.Nu().E();
@@ -178,31 +294,74 @@ namespace cvn {
       // Now write the zlib file using this information
       // We need to extract all of the information into a single vector to write
       // into the compressed file format
-      const std::vector<float> vectorToWrite = g->ConvertGraphToVector();
+      // The buffers are kept between graphs
+      std::vector<float>& vectorToWrite = fGraphVector;
+      const bool encoded = !fEncoder->IsFloat32();
+      if (encoded) EncodeGraph(*g);
+      else g->ConvertGraphToVector(vectorToWrite);
+      const unsigned char* bytesToWrite = encoded ? fEncoded.data()
+        : reinterpret_cast<const unsigned char*>(vectorToWrite.data());
+      const ulong src_len = encoded ? fEncoded.size() : vectorToWrite.size()*sizeof(float);
+
+      std::stringstream modifier;
+      if(graphs.size() > 1){
+        modifier << "_" << i;
+      }
+
+      // The auxillary information for the text file
+      std::stringstream info;
+      info << interaction << std::endl; // Interaction type first
+
+      // True and reconstructed energy variables
+      info << nu_energy << std::endl;
+      info << lep_energy << std::endl;
+      info << reco_nue_energy << std::endl;
+      info << reco_numu_energy << std::endl;
+      info << reco_nutau_energy << std::endl;
+      info << event_weight << std::endl;
+
+      info << labels.GetPDG() << std::endl;
+      info << labels.GetNProtons() << std::endl;
+      info << labels.GetNPions() << std::endl;
+      info << labels.GetNPizeros() << std::endl;
+      info << labels.GetNNeutrons() << std::endl;
+      info << labels.GetTopologyType() << std::endl;
+      info << labels.GetTopologyTypeAlt() << std::endl;
+
+      // Number of nodes and node features is needed for unpacking
+      info << g->GetNumberOfNodes() << std::endl;
+      info << g->GetNumberOfNodeCoordinates() << std::endl;
+      info << g->GetNumberOfNodeFeatures() << std::endl;
+
+      // The edge counts follow, when the edges are written
+      std::stringstream key;
+      key << "event_" << evt.event() << modifier.str();
+      const bool writeEdges = fSaveEdges && g->GetNumberOfEdges() > 0;
+      if (writeEdges) {
+        info << g->GetNumberOfEdges() << std::endl;
+        info << g->GetNumberOfEdgeFeatures() << std::endl;
+      }
+
+      // Reduced storage types are marked by a keyed line, the edges stay float32
+      if (encoded)
+        info << "encoding " << fEncoder->Describe(g->GetNumberOfNodeFeatures()) << std::endl;
+
+      // Compression and writing happen on the shard writer thread
+      if (fShardWriter) {
+        std::vector<unsigned char> raw(bytesToWrite, bytesToWrite + src_len);
+        fShardWriter->Write(key.str(), std::move(raw), info.str());
+        if (writeEdges) WriteEdges(*g, key.str());
+        continue;
+      }
    
-      ulong src_len = vectorToWrite.size() *sizeof(float);
-      ulong dest_len = compressBound(src_len);     // calculate size of the compressed data               
-      char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
-  
-      int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &vectorToWrite[0], src_len);
-  
-      // Buffer error
-      if (res == Z_BUF_ERROR)
-        std::cout << "Buffer too small!" << std::endl;
-      // Memory error
-      else if (res ==  Z_MEM_ERROR)
-        std::cout << "Not enough memory for compression!" << std::endl;
+      ulong dest_len = fCodec->Compress(bytesToWrite, src_len, fCompressed);
+
       // Compression ok 
-      else {
+      if (dest_len > 0) {
 
-        std::stringstream modifier;
-        if(graphs.size() > 1){
-          modifier << "_" << i;
-        }
-  
         // Create output files 
         std::stringstream image_file_name; 
-        image_file_name << out_dir << "/event_" << evt.event() << modifier.str() << ".gz";
+        image_file_name << out_dir << "/event_" << evt.event() << modifier.str() << fCodec->Extension();
         std::stringstream info_file_name;
         info_file_name << out_dir << "/event_" << evt.event() << modifier.str() << ".info";
   
@@ -212,34 +371,14 @@ namespace cvn {
         if(image_file.is_open() && info_file.is_open()) {
   
           // Write the graph to the file and close it
-          image_file.write(ostream, dest_len);
+          image_file.write(reinterpret_cast<const char*>(fCompressed.data()), dest_len);
           image_file.close(); // close file
   
           // Write the auxillary information to the text file
-          info_file << interaction << std::endl; // Interaction type first
-  
-          // True and reconstructed energy variables
-          info_file << nu_energy << std::endl;
-          info_file << lep_energy << std::endl;
-          info_file << reco_nue_energy << std::endl;
-          info_file << reco_numu_energy << std::endl;
-          info_file << reco_nutau_energy << std::endl;
-          info_file << event_weight << std::endl;
-  
-          info_file << labels.GetPDG() << std::endl;
-          info_file << labels.GetNProtons() << std::endl;
-          info_file << labels.GetNPions() << std::endl;
-          info_file << labels.GetNPizeros() << std::endl;
-          info_file << labels.GetNNeutrons() << std::endl;
-          info_file << labels.GetTopologyType() << std::endl;
-          info_file << labels.GetTopologyTypeAlt() << std::endl;
-  
-          // Number of nodes and node features is needed for unpacking
-          info_file << g->GetNumberOfNodes() << std::endl;
-          info_file << g->GetNumberOfNodeCoordinates() << std::endl;
-          info_file << g->GetNumberOfNodeFeatures() << std::endl;
-  
+          info_file << info.str();
           info_file.close(); // close file
+
+          if (writeEdges) WriteEdges(*g, key.str());
         }
         else {
   
@@ -256,8 +395,6 @@ namespace cvn {
               << "Unable to open file " << info_file_name.str() << "!" << std::endl;
         }
       }
-      free(ostream);  // free allocated memory
-      ostream = nullptr;
     }
     
     return;
@@ -0,0 +1,623 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    GlobalWireMapper.cxx
+/// \brief   Global unwrapped wire, plane and time of the DUNE geometries,
+///          shared by the CVN and RegCNN pixel map producers
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "dunereco/CVN/art/GlobalWireMapper.h"
+#include "dunereco/AnaUtils/DUNEAnaGeometryCache.h"
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "larcore/Geometry/Geometry.h"
+
+namespace cvn
+{
+
+  GlobalWireMapper::GlobalWireMapper():
+    GlobalWireMapper(Options())
+  {
+  }
+
+  GlobalWireMapper::GlobalWireMapper(const Options& options):
+    fOptions(options),
+    fCache(nullptr)
+  {
+    fGeometry = &*(art::ServiceHandle<geo::Geometry>());
+
+    // The detector name comparisons are done once here instead of per hit
+    const std::string name = fGeometry->DetectorName();
+    if (name == "dune10kt_v1") fDetector = kDet10kt;
+    else if (name.find("1x2x6") != std::string::npos) fDetector = kDet1x2x6;
+    else if (name.find("dunevd10kt_3view") != std::string::npos) fDetector = kDetVD3View;
+    else if (name.find("protodune") != std::string::npos) fDetector = kDetProtoDUNE;
+    else fDetector = kDetUnknown;
+
+    const geo::CryostatID cryoID(0);
+    fNTPCs = fGeometry->NTPC(cryoID);
+    fNPlanes = 0;
+    for (unsigned int tpc = 0; tpc < fNTPCs; ++tpc)
+      fNPlanes = std::max(fNPlanes, fGeometry->Nplanes(geo::TPCID(cryoID, tpc)));
+
+    if (fDetector == kDetVD3View)
+      _cacheIntercepts();
+  }
+
+  void GlobalWireMapper::SetCacheDirectory(const std::string& directory)
+  {
+    fCache = dune_ana::DUNEAnaGeometryCache::Get(directory);
+  }
+
+  GlobalWireMapper::WireMapping GlobalWireMapper::DenseMapping(unsigned short unwrapped, bool protoDUNE) const
+  {
+    if (protoDUNE) return kMapProtoDUNE;
+    if (unwrapped == 1) {
+      // Jeremy: Autodetect geometry for DUNE 10kt module. Is this a bad idea??
+      if (fDetector == kDet10kt) return kMap10ktTDC;
+      if (fDetector == kDetVD3View) return kMapVD3View;
+      // Default to 1x2x6. Should probably specifically name this function as such
+      return kMapDUNETDC;
+    }
+    // Old method that has problems with the APA crossers, kept for old times' sake
+    if (unwrapped == 2) return kMapDUNE;
+    return kMapNone;
+  }
+
+  bool GlobalWireMapper::Map(detinfo::DetectorPropertiesData const& detProp, WireMapping mapping,
+                             unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+                             unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
+  {
+    globalWire = localWire;
+    globalPlane = plane;
+    globalTDC = localTDC;
+
+    switch (mapping) {
+      case kMapDUNE:
+        GetDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
+        break;
+      case kMapDUNETDC:
+        GetDUNEGlobalWireTDC(detProp, localWire, localTDC, plane, tpc, globalWire, globalPlane, globalTDC);
+        break;
+      case kMap10ktTDC:
+        if (tpc%6 == 0 or tpc%6 == 5) return false; // Skip dummy TPCs in 10kt module
+        GetDUNE10ktGlobalWireTDC(detProp, localWire, localTDC, plane, tpc, globalWire, globalPlane, globalTDC);
+        break;
+      case kMapVD3View:
+        GetDUNEVertDrift3ViewGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
+        break;
+      case kMapProtoDUNE:
+        GetProtoDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+
+  GlobalWireMapper::GlobalWireLUT GlobalWireMapper::Table(detinfo::DetectorPropertiesData const& detProp,
+                                                          WireMapping mapping)
+  {
+    std::lock_guard<std::mutex> lock(fWireLUTMutex);
+    GlobalWireTable& table = fWireTables[mapping];
+    const bool needsDrift = (mapping == kMapDUNETDC || mapping == kMap10ktTDC);
+    const double driftVel = needsDrift ? detProp.DriftVelocity() : 0.;
+
+    unsigned int globalWire, globalPlane;
+    double globalTDC;
+
+    if (!table.built && !_loadTable(mapping, table)) {
+      table.first.assign(fNTPCs*fNPlanes + 1, 0);
+      table.skipTPC.assign(fNTPCs, false);
+      table.ownedWire.clear();
+      table.ownedPlane.clear();
+      for (unsigned int tpc = 0; tpc < fNTPCs; ++tpc) {
+        const geo::TPCID tpcID(0, tpc);
+        const unsigned int nPlanes = fGeometry->Nplanes(tpcID);
+        for (unsigned int plane = 0; plane < fNPlanes; ++plane) {
+          const unsigned int index = tpc*fNPlanes + plane;
+          table.first[index] = table.ownedWire.size();
+          if (plane >= nPlanes) continue;
+          const unsigned int nWires = fGeometry->Nwires(geo::PlaneID(tpcID, plane));
+          for (unsigned int w = 0; w < nWires; ++w) {
+            if (!Map(detProp, mapping, w, 0., plane, tpc, globalWire, globalPlane, globalTDC)) {
+              table.skipTPC[tpc] = true;
+              break;
+            }
+            table.ownedWire.push_back(globalWire);
+            table.ownedPlane.push_back(globalPlane);
+          }
+        }
+      }
+      table.first[fNTPCs*fNPlanes] = table.ownedWire.size();
+      table.wire = table.ownedWire.data();
+      table.plane = table.ownedPlane.data();
+      table.built = true;
+      _storeTable(mapping, table);
+    }
+
+    // All the time conversions are linear in the local time, so two points
+    // give the slope and offset of each TPC. A new drift velocity gets a
+    // table of its own, and the tables already handed out stay valid
+    std::shared_ptr<const GlobalTDCTable>& times = fTDCTables[mapping][driftVel];
+    if (!times) {
+      auto newTimes = std::make_shared<GlobalTDCTable>();
+      newTimes->tdcSign.assign(fNTPCs, 1.);
+      newTimes->tdcOffset.assign(fNTPCs, 0.);
+      for (unsigned int tpc = 0; tpc < fNTPCs; ++tpc) {
+        if (!needsDrift || table.skipTPC[tpc]) continue;
+        double tdc0, tdc1;
+        Map(detProp, mapping, 0, 0., 0, tpc, globalWire, globalPlane, tdc0);
+        Map(detProp, mapping, 0, 1., 0, tpc, globalWire, globalPlane, tdc1);
+        newTimes->tdcSign[tpc] = tdc1 - tdc0;
+        newTimes->tdcOffset[tpc] = tdc0;
+      }
+      times = std::move(newTimes);
+    }
+
+    GlobalWireLUT lut;
+    lut.wires = &table;
+    lut.times = times;
+    return lut;
+  }
+
+  bool GlobalWireMapper::Lookup(detinfo::DetectorPropertiesData const& detProp, WireMapping mapping,
+                                const GlobalWireLUT& lut, const geo::WireID& wireid, double localTDC,
+                                unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
+  {
+    const GlobalWireTable& table = *lut.wires;
+    const unsigned int tpc = wireid.TPC;
+    if (tpc < fNTPCs && wireid.Plane < fNPlanes) {
+      if (table.skipTPC[tpc]) return false;
+      const unsigned int index = tpc*fNPlanes + wireid.Plane;
+      const unsigned int entry = table.first[index] + wireid.Wire;
+      if (entry < table.first[index + 1]) {
+        globalWire = table.wire[entry];
+        globalPlane = table.plane[entry];
+        globalTDC = lut.times->tdcOffset[tpc] + lut.times->tdcSign[tpc]*localTDC;
+        return true;
+      }
+    }
+    // Anything outside the table goes through the full calculation
+    return Map(detProp, mapping, wireid.Wire, localTDC, wireid.Plane, tpc, globalWire, globalPlane, globalTDC);
+  }
+
+  std::string GlobalWireMapper::_tableName(WireMapping mapping) const
+  {
+    // The options change the unwrapping, so each variant has its own table
+    return "cvn::GlobalWireMapper/" + std::to_string(mapping) + "/" +
+      std::to_string(fOptions.upperInductionOffset) + std::to_string(fOptions.wholeTickDrift) + "/";
+  }
+
+  bool GlobalWireMapper::_loadTable(WireMapping mapping, GlobalWireTable& table) const
+  {
+    if (!fCache) return false;
+
+    const std::string name = _tableName(mapping);
+    const unsigned int* first;
+    const unsigned int* wire;
+    const unsigned short* plane;
+    const unsigned char* skip;
+    size_t nFirst, nWire, nPlane, nSkip;
+    if (!fCache->Find(name + "first", first, nFirst) || !fCache->Find(name + "wire", wire, nWire) ||
+        !fCache->Find(name + "plane", plane, nPlane) || !fCache->Find(name + "skip", skip, nSkip))
+      return false;
+    if (nFirst != fNTPCs*fNPlanes + 1 || nSkip != fNTPCs || nWire != first[nFirst - 1] || nPlane != nWire)
+      return false;
+
+    // The wires and planes are read in place from the mapped file
+    table.first.assign(first, first + nFirst);
+    table.skipTPC.assign(skip, skip + nSkip);
+    table.wire = wire;
+    table.plane = plane;
+    table.built = true;
+    return true;
+  }
+
+  void GlobalWireMapper::_storeTable(WireMapping mapping, const GlobalWireTable& table) const
+  {
+    if (!fCache) return;
+
+    const std::string name = _tableName(mapping);
+    const std::vector<unsigned char> skip(table.skipTPC.begin(), table.skipTPC.end());
+    fCache->Add(name + "first", table.first.data(), table.first.size());
+    fCache->Add(name + "wire", table.ownedWire.data(), table.ownedWire.size());
+    fCache->Add(name + "plane", table.ownedPlane.data(), table.ownedPlane.size());
+    fCache->Add(name + "skip", skip.data(), skip.size());
+  }
+
+  void GlobalWireMapper::_driftTicks(detinfo::DetectorPropertiesData const& detProp, const geo::TPCGeo& tpcgeom,
+                                     double& driftSize, double& apaSize) const
+  {
+    double driftLen = tpcgeom.DriftDistance();
+    double apaLen = tpcgeom.Width() - tpcgeom.ActiveWidth();
+    double driftVel = detProp.DriftVelocity();
+    driftSize = (driftLen / driftVel) * 2; // Time in ticks to cross a TPC
+    apaSize   = 4*(apaLen / driftVel) * 2; // Width of the whole APA in TDC
+    if (fOptions.wholeTickDrift) {
+      driftSize = (unsigned int)driftSize;
+      apaSize   = (unsigned int)apaSize;
+    }
+  }
+
+  double GlobalWireMapper::_getIntercept(geo::WireID wireid) const
+  {
+    const geo::WireGeo* pwire = fGeometry->WirePtr(wireid);
+    geo::Point_t center = pwire->GetCenter();
+    double slope = 0.;
+    if(!pwire->isVertical()) slope = pwire->TanThetaZ();
+    
+    double intercept = center.Y() - slope*center.Z();
+    if(wireid.Plane == 2) intercept = 0.;
+    
+    return intercept;
+  }
+
+  void GlobalWireMapper::_cacheIntercepts(){
+   
+    // double spacing = 0.847;
+    for(int plane = 0; plane < 2; plane++){
+      
+      int nCRM_row = 6;
+      int nCRM_col = 6;
+      bool is8x6 = fGeometry->DetectorName().find("8x6") != std::string::npos;
+      if(is8x6)
+        nCRM_col = 8;
+      
+      geo::WireID wstart = geo::WireID(0, 0, plane,0);
+      geo::WireID wstartplus1 = geo::WireID(0, 0, plane, 1);
+      double wstart_intercept = _getIntercept(wstart);
+      double wstartplus1_intercept = _getIntercept(wstartplus1);
+      if(plane == 0)
+        fSpacing0 = std::abs(wstartplus1_intercept - wstart_intercept);
+      else
+        fSpacing1 = std::abs(wstartplus1_intercept - wstart_intercept);
+
+      bool is3view30deg = fGeometry->DetectorName().find("30deg") != std::string::npos;
+      
+      for(int diag_tpc = 0; diag_tpc < nCRM_row; diag_tpc++){
+        
+        int tpc = (plane == 0 || !is3view30deg) ? (nCRM_col+1)*diag_tpc : (nCRM_col-1)*(nCRM_row-diag_tpc);
+        geo::PlaneID const planeID(0, tpc, plane);
+        unsigned int nWiresTPC = fGeometry->Nwires(planeID);
+     
+        geo::WireID start = geo::WireID(planeID, 0);
+        geo::WireID end = geo::WireID(planeID, nWiresTPC-1);
+
+        double start_intercept = _getIntercept(start);
+        double end_intercept = _getIntercept(end);
+        if(plane == 0){
+          fVDPlane0.push_back(start_intercept);
+          fVDPlane0.push_back(end_intercept);
+        }
+        else if (is3view30deg){
+          fVDPlane1.push_back(end_intercept);
+          fVDPlane1.push_back(start_intercept);
+        }
+        else{
+          fVDPlane1.push_back(start_intercept);
+          fVDPlane1.push_back(end_intercept);
+        }
+      }
+
+    }
+  }
+
+  void GlobalWireMapper::GetDUNEGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const
+  {
+    unsigned int nWiresTPC = 400;
+
+    globalWire = localWire;
+    globalPlane = 0;
+
+    // Collection plane has more wires
+    if(plane == 2){
+      nWiresTPC=480;
+      globalPlane = 2;
+    }
+
+    // Workspace geometry has two drift regions
+    //                  |-----|-----| /  /
+    //      y ^         |  3  |  2  |/  /
+    //        | -| z    |-----|-----|  /
+    //        | /       |  1  |  0  | /
+    //  x <---|/        |-----|-----|/
+    //
+
+    int tpcMod4 = tpc%4;
+
+    // Induction views depend on the drift direction
+    if(plane < 2){
+      // For drift in negative x direction keep U and V as defined.
+      if(tpcMod4 == 0 || tpcMod4 == 3){
+        globalPlane = plane;
+      }
+      // For drift in positive x direction, swap U and V.
+      else{
+        if(plane == 0) globalPlane = 1;
+        else globalPlane = 0;
+      }
+    }
+
+    if(globalPlane != 1){
+      globalWire += (tpc/4)*nWiresTPC;
+    }
+    else{
+      globalWire += ((23-tpc)/4)*nWiresTPC;
+    }
+
+  }
+
+  // Based on Robert's code in adcutils
+  void GlobalWireMapper::GetDUNEGlobalWireTDC(detinfo::DetectorPropertiesData const& detProp,
+                                              unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+                                             unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
+  {
+
+    unsigned int nWiresTPC = 400;
+    unsigned int wireGap = 4;
+    auto const& tpcgeom = fGeometry->TPC(geo::TPCID{0, tpc});
+    double drift_size, apa_size;
+    _driftTicks(detProp, tpcgeom, drift_size, apa_size);
+
+    globalWire = 0;
+    globalPlane = 0;
+//    int dir = fGeometry->TPC(tpc,0).DetectDriftDirection();
+
+    // Collection plane has more wires
+    if(plane == 2){
+      nWiresTPC = 480;
+      wireGap = 5;
+      globalPlane = 2;
+    }
+
+    bool includeZGap = true;
+    if(includeZGap) nWiresTPC += wireGap;
+
+    // Workspace geometry has two drift regions
+    //                  |-----|-----| /  /
+    //      y ^         |  3  |  2  |/  /
+    //        | -| z    |-----|-----|  /
+    //        | /       |  1  |  0  | /
+    //  x <---|/        |-----|-----|/
+    //
+    int tpcMod4 = tpc%4;
+    if (fOptions.upperInductionOffset) {
+      // Induction views depend on the drift direction
+      if (plane < 2 and tpc%2 == 1) globalPlane = !plane;
+      else globalPlane = plane;
+
+      int offset = 752; // Offset between upper and lower modules in induction views, from Robert & Dorota's code
+      // Second induction plane gets offset from the back of the TPC
+      if (globalPlane != 1) globalWire += (tpc/4)*nWiresTPC;
+      else globalWire += ((23-tpc)/4)*nWiresTPC;
+      // Reverse wires and add offset for upper modules in induction views
+      // Nitish : what's the difference between Nwires here and nWiresTPC?
+      if (tpcMod4 > 1 and globalPlane < 2) globalWire += fGeometry->Nwires(geo::PlaneID(0, tpc, globalPlane)) + offset - localWire;
+      else globalWire += localWire;
+    }
+    else {
+      // Induction views depend on the drift direction
+      if (plane < 2 and tpcMod4 > 0 and tpcMod4 < 3) globalPlane = !plane;
+      else globalPlane = plane;
+
+      int offset = 0; // Offset between upper and lower modules in induction views
+      // Second induction plane gets offset from the back of the TPC
+      if (globalPlane != 1) globalWire += (tpc/4)*nWiresTPC + (tpcMod4 > 1)*offset + localWire;
+      else globalWire += ((23-tpc)/4)*nWiresTPC + (tpcMod4 > 1)*offset + localWire;
+    }
+
+    if(tpcMod4 == 0 || tpcMod4 == 2){
+      globalTDC = drift_size - localTDC;
+    }
+    else{
+      globalTDC = localTDC + drift_size + apa_size;
+    }
+  }
+
+  void GlobalWireMapper::GetDUNE10ktGlobalWireTDC(detinfo::DetectorPropertiesData const& detProp,
+                                                  unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+                                                  unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
+  {
+    unsigned int nWiresTPC = 400;
+    unsigned int wireGap = 4;
+    auto const& tpcgeom = fGeometry->TPC(geo::TPCID{0, tpc});
+    double drift_size, apa_size;
+    _driftTicks(detProp, tpcgeom, drift_size, apa_size);
+
+
+    globalWire = 0;
+    globalPlane = 0;
+
+    // Collection plane has more wires
+    if(plane == 2){
+      nWiresTPC = 480;
+      wireGap = 5;
+      globalPlane = 2;
+    }
+
+    bool includeZGap = true;
+    if(includeZGap) nWiresTPC += wireGap;
+
+    // 10kt has four real TPCs and two dummies in each slice
+    //
+    //                 |--|-----|-----|-----|-----|--| /  /
+    //      y ^        |11| 10  |  9  |  8  |  7  | 6|/  /
+    //        | -| z   |--|-----|-----|-----|-----|--|  /
+    //        | /      | 5|  4  |  3  |  2  |  1  | 0| /
+    //  x <---|/       |--|-----|-----|-----|-----|--|/
+    //                     ^  wires  ^ ^  wires  ^
+    //
+    // We already filtered out the dummies, so we can assume 0->3 as follows:
+    //
+    //                 |-----|-----|-----|-----| /  /
+    //      y ^        |  7  |  6  |  5  |  4  |/  /
+    //        | -| z   |-----|-----|-----|-----|  /
+    //        | /      |  3  |  2  |  1  |  0  | /
+    //  x <---|/       |-----|-----|-----|-----|/
+    //                  ^  wires  ^ ^  wires  ^
+    //
+
+    size_t tpc_x = (tpc%6) - 1;   // x coordinate in 0->4 range
+    size_t tpc_xy = (tpc%12) - 1; // xy coordinate as 0->3 & 6->9 (converted from 1->4, 7->10)
+    if (tpc_xy > 3) tpc_xy -= 2;  // now subtract 2 so it's in the 0->7 range
+
+    // Induction views depend on the drift direction
+    if (plane < 2 and tpc%2 == 1) globalPlane = !plane;
+    else globalPlane = plane;
+
+    int offset = 752; // Offset between upper and lower modules in induction views, from Robert & Dorota's code
+    // Second induction plane gets offset from the back of the TPC
+    if (globalPlane != 1) globalWire += (tpc/12)*nWiresTPC;
+    else globalWire += ((300-tpc)/12)*nWiresTPC;
+    // Reverse wires and add offset for upper modules in induction views
+    if (tpc_xy > 3 and globalPlane < 2) globalWire += fGeometry->Nwires(geo::PlaneID{tpcgeom.ID(), globalPlane}) + offset - localWire;
+    else globalWire += localWire;
+
+    if (tpc_x % 2 == 0) globalTDC = localTDC;
+    else globalTDC = (2*drift_size) - localTDC;
+    if (tpc_x > 1) globalTDC += 2 * (drift_size + apa_size);
+
+  } // function GlobalWireMapper::GetDUNE10ktGlobalWireTDC
+
+  // Special case for ProtoDUNE where we want to extract single particles to mimic CCQE interactions. The output pixel maps should be the same as the workspace
+  // but we need different treatment of the wire numbering
+  void GlobalWireMapper::GetProtoDUNEGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const
+  { 
+    unsigned int nWiresTPC = 400;
+    
+    globalWire = localWire;
+    globalPlane = 0;
+    
+    // Collection plane has more wires
+    if(plane == 2){
+      nWiresTPC=480;
+      globalPlane = 2;
+    }
+    
+    // ProtoDUNE has a central CPA so times are fine
+    // It (annoyingly) has two dummy TPCs on the sides
+    //                  
+    //      y ^       |-|-----|-----|-|   /
+    //        | -| z  | |     |     | |  /
+    //        | /     |3|  2  |  1  |0| /
+    //  x <---|/      |-|-----|-----|-|/
+    //
+    
+    int tpcMod4 = tpc%4;
+    // tpcMod4: 1 for -ve drift, 2 for +ve drift
+    // Induction views depend on the drift direction
+    if(plane < 2){
+      // For drift in negative x direction keep U and V as defined.
+      if(tpcMod4 == 1){
+        globalPlane = plane;
+      }
+      // For drift in positive x direction, swap U and V.
+      else{
+        if(plane == 0) globalPlane = 1;
+        else globalPlane = 0;
+      }
+    }
+    
+    if(globalPlane != 1){
+      globalWire += (tpc/4)*nWiresTPC;
+    }
+    else{
+      globalWire += ((12-tpc)/4)*nWiresTPC;
+    }
+  
+  } // function GlobalWireMapper::GetProtoDUNEGlobalWire
+
+  // Special case for ProtoDUNE where we want to extract single particles to mimic CCQE interactions. The output pixel maps should be the same as the workspace
+  // but we need different treatment of the wire numbering
+  void GlobalWireMapper::GetProtoDUNEGlobalWireTDC(unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+    unsigned int& globalWire, double& globalTDC, unsigned int& globalPlane) const
+  {
+    // We can just use the existing function to get the global wire & plane
+ //   GetProtoDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
+    GetDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
+    // Implement additional mirroring here?
+
+  } // function GetProtoDUNEGlobalWireTDC
+  
+  void GlobalWireMapper::GetDUNEVertDrift3ViewGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const
+  {
+    // Preliminary function for VD Geometries
+    
+    int nCRM_row = 6;
+    int nCRM_col = 6;
+    bool is8x6 = fGeometry->DetectorName().find("8x6") != std::string::npos;
+    if(is8x6)
+      nCRM_col = 8;
+    // spacing between y-intercepts of parallel wires in a given plane. 
+    double spacing = 0.847; 
+    
+    globalPlane = plane;
+    geo::PlaneID const planeID{0, tpc, globalPlane};
+    unsigned int nWiresTPC = fGeometry->Nwires(planeID);
+    bool is3view30deg = fGeometry->DetectorName().find("30deg") != std::string::npos;
+    
+    if(globalPlane < 2){
+      
+      geo::WireID wire_id = geo::WireID(planeID, localWire);
+      double wire_intercept = _getIntercept(wire_id);
+   
+      double low_bound = 0., upper_bound = 0.; 
+      int start, end, diag_tpc;
+      // get wires on diagonal CRMs and their intercepts which bound the current wire's intercept 
+      if(globalPlane == 0){
+        start = std::lower_bound(fVDPlane0.begin(), fVDPlane0.end(), wire_intercept) - fVDPlane0.begin() - 1;
+        end = std::upper_bound(fVDPlane0.begin(), fVDPlane0.end(), wire_intercept) - fVDPlane0.begin();
+        
+        low_bound = fVDPlane0[start];
+        if(end < (int) fVDPlane0.size())
+          upper_bound = fVDPlane0[end];
+        diag_tpc = (start/2);
+        spacing = fSpacing0;
+      }
+      else if (is3view30deg){
+        end = std::lower_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin() - 1;
+        start = std::upper_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin();
+       
+        if(end > 0)
+          low_bound = fVDPlane1[end];
+        upper_bound = fVDPlane1[start];
+        diag_tpc = (nCRM_row-(end/2) - 1);
+        if(end < 0) 
+          diag_tpc = nCRM_row - 1;
+        spacing = fSpacing1;
+      }
+      else{
+        int tpc_y = tpc % nCRM_col;
+        globalWire = localWire + tpc_y*nWiresTPC;
+        
+        start = std::lower_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin() - 1;
+        end = std::upper_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin();
+        
+        low_bound = fVDPlane1[start];
+        if(end < (int) fVDPlane1.size())
+          upper_bound = fVDPlane1[end];
+        diag_tpc = (start/2);
+      }
+      // if the intercept of the wire is in between two diagonal CRMs, assign it to the diagonal CRM its closest to 
+      if((((start % 2)^globalPlane && is3view30deg) || (globalPlane == 0 && !is3view30deg && (start % 2 == 1))) && (diag_tpc < nCRM_row-1)){
+        int diag_idx = diag_tpc + !globalPlane;
+        globalWire = (wire_intercept > (low_bound+upper_bound)*0.5) ? (nWiresTPC-1)*diag_idx + !globalPlane : (nWiresTPC-1)*diag_idx + globalPlane;
+      }
+      // otherwise assign it to the closest wire within the same CRM
+      else if(is3view30deg || (globalPlane == 0 && !is3view30deg && (start %2 == 0))){
+        int diag_idx = diag_tpc;
+        int offset = globalPlane ? std::round((upper_bound - wire_intercept)/spacing) : std::round((wire_intercept-low_bound)/spacing);
+        globalWire = (nWiresTPC-1)*diag_idx + offset + 1;
+        
+      }
+    }
+    else{
+      int tpc_z = tpc/nCRM_col;
+      globalWire = localWire + tpc_z*nWiresTPC;
+    }
+  }
+
+} // namespace cvn
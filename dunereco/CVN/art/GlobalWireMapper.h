@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    GlobalWireMapper.h
+/// \brief   Global unwrapped wire, plane and time of the DUNE geometries,
+///          shared by the CVN and RegCNN pixel map producers
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_GLOBALWIREMAPPER_H
+#define CVN_GLOBALWIREMAPPER_H
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+
+namespace dune_ana
+{
+  class DUNEAnaGeometryCache;
+}
+
+namespace cvn
+{
+  /// Conversion of local wires and ticks to the global unwrapped
+  /// coordinates of the pixel maps. The detector is resolved once from the
+  /// geometry name, and each conversion has a lookup table over all wires
+  /// of the first cryostat, built on first use
+  ///
+  /// Lookups can be made from several threads at once
+  class GlobalWireMapper
+  {
+  public:
+
+    /// Detector geometries with their own wire unwrapping
+    typedef enum DetectorType
+    {
+      kDetUnknown,
+      kDet1x2x6,
+      kDet10kt,
+      kDetVD3View,
+      kDetProtoDUNE
+    } DetectorType;
+
+    /// The global wire and time conversions, one lookup table each
+    typedef enum WireMapping
+    {
+      kMapNone,     ///< Local wire and time
+      kMapDUNE,     ///< GetDUNEGlobalWire
+      kMapDUNETDC,  ///< GetDUNEGlobalWireTDC
+      kMap10ktTDC,  ///< GetDUNE10ktGlobalWireTDC
+      kMapVD3View,  ///< GetDUNEVertDrift3ViewGlobalWire
+      kMapProtoDUNE,///< GetProtoDUNEGlobalWire
+      kNMaps
+    } WireMapping;
+
+    /// Variants of the unwrapping the producers were trained with
+    struct Options
+    {
+      /// 1x2x6 workspace: reverse the induction wires of the upper TPCs
+      /// behind a 752 wire offset, as the wire and SimChannel maps do,
+      /// rather than numbering them on from the lower TPCs
+      bool upperInductionOffset = false;
+      /// Drift and APA crossing times truncated to whole ticks, RegCNN
+      /// keeps them exact
+      bool wholeTickDrift = true;
+    };
+
+    GlobalWireMapper();
+    explicit GlobalWireMapper(const Options& options);
+
+    DetectorType Detector() const {return fDetector;};
+    geo::GeometryCore const* Geometry() const {return fGeometry;};
+
+    /// Share the wire tables with other jobs through the geometry cache
+    /// files of a directory, empty for no sharing
+    void SetCacheDirectory(const std::string& directory);
+
+    /// Mapping of the dense pixel maps for the unwrapping mode of the
+    /// producers (0 local, 1 with times, 2 wires only)
+    WireMapping DenseMapping(unsigned short unwrapped, bool protoDUNE) const;
+
+    /// Global wire and plane for every (tpc, plane, local wire) of one
+    /// mapping. Filled once under fWireLUTMutex and never changed after
+    struct GlobalWireTable
+    {
+      bool built = false;
+      std::vector<unsigned int> first;     ///< First entry of each tpc*fNPlanes + plane
+      const unsigned int* wire = nullptr;  ///< Global wire of each entry
+      const unsigned short* plane = nullptr; ///< Global plane of each entry
+      std::vector<unsigned int> ownedWire; ///< Storage of wire and plane when
+      std::vector<unsigned short> ownedPlane; ///< they are not in the cache file
+      std::vector<bool> skipTPC;           ///< Hits on these TPCs are dropped
+    };
+
+    /// Linear time conversion of each TPC of one mapping at one drift velocity
+    struct GlobalTDCTable
+    {
+      std::vector<double> tdcSign;         ///< globalTDC = tdcOffset + tdcSign*localTDC
+      std::vector<double> tdcOffset;
+    };
+
+    /// The tables of one mapping for one drift velocity. Neither is modified
+    /// once handed out, so a GlobalWireLUT can be used without locking
+    /// while other threads ask for other drift velocities
+    struct GlobalWireLUT
+    {
+      const GlobalWireTable* wires = nullptr;
+      std::shared_ptr<const GlobalTDCTable> times;
+    };
+
+    /// Get the lookup tables of a mapping, building the wires on first use
+    /// and the times on first use of each drift velocity
+    GlobalWireLUT Table(detinfo::DetectorPropertiesData const& detProp, WireMapping mapping);
+    /// Table lookup of a wire, false if its signals are dropped
+    bool Lookup(detinfo::DetectorPropertiesData const& detProp, WireMapping mapping,
+                const GlobalWireLUT& lut, const geo::WireID& wireid, double localTDC,
+                unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const;
+    /// Apply a mapping through the Get* functions, false if the wire is dropped
+    bool Map(detinfo::DetectorPropertiesData const& detProp, WireMapping mapping,
+             unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+             unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const;
+
+    /// Function to convert to a global unwrapped wire number
+    void GetDUNEGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const;
+    void GetDUNEGlobalWireTDC(detinfo::DetectorPropertiesData const& detProp,
+                              unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+                              unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const;
+
+    void GetDUNE10ktGlobalWireTDC(detinfo::DetectorPropertiesData const& detProp,
+                                  unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+                                  unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const;
+    void GetProtoDUNEGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const;
+    void GetProtoDUNEGlobalWireTDC(unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
+                                   unsigned int& globalWire, double& globalTDC, unsigned int& globalPlane) const;
+    // preliminary vert drift 3 view studies
+    void GetDUNEVertDrift3ViewGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const;
+
+  private:
+    Options fOptions;
+    geo::GeometryCore const* fGeometry;
+    DetectorType fDetector;   ///< Detector resolved from the geometry name
+    unsigned int fNTPCs;      ///< TPCs in the first cryostat
+    unsigned int fNPlanes;    ///< Maximum number of planes in a TPC
+
+    std::vector<double> fVDPlane0;
+    std::vector<double> fVDPlane1;
+    double fSpacing0, fSpacing1;
+    // std::vector<int> fPlane0GapWires;
+    // std::vector<int> fPlane1GapWires;
+
+    dune_ana::DUNEAnaGeometryCache* fCache; ///< Shared wire tables, may be null
+    std::array<GlobalWireTable, kNMaps> fWireTables;
+    /// Time conversions of each mapping by drift velocity
+    std::array<std::map<double, std::shared_ptr<const GlobalTDCTable>>, kNMaps> fTDCTables;
+    std::mutex fWireLUTMutex; ///< Guards building the lookup tables
+
+    double _getIntercept(geo::WireID wireid) const;
+    void _cacheIntercepts();
+    /// Take the wire table of a mapping from the cache file, false if absent
+    bool _loadTable(WireMapping mapping, GlobalWireTable& table) const;
+    void _storeTable(WireMapping mapping, const GlobalWireTable& table) const;
+    std::string _tableName(WireMapping mapping) const;
+    /// Ticks to drift across a TPC and to cross an APA
+    void _driftTicks(detinfo::DetectorPropertiesData const& detProp, const geo::TPCGeo& tpcgeom,
+                     double& driftSize, double& apaSize) const;
+  };
+
+}
+
+#endif  // CVN_GLOBALWIREMAPPER_H
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ONNXNetHandler.cxx
+/// \brief   ONNXNetHandler for CVN, runs a network exported to .onnx
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <string>
+#include "cetlib/getenv.h"
+
+#include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/CVN/art/ONNXNetHandler.h"
+#include "dunereco/CVN/func/CVNImageUtils.h"
+
+#include "dunereco/TFRuntime/TFBatching.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+namespace cvn
+{
+
+  ONNXNetHandler::ONNXNetHandler(const fhicl::ParameterSet& pset):
+    fLibPath(cet::getenv(pset.get<std::string>("LibPath", ""), std::nothrow)),
+    fONNXModel(fLibPath+"/"+pset.get<std::string>("ONNXModel")),
+    fUseLogChargeScale(pset.get<bool>("ChargeLogScale")),
+    fImageWires(pset.get<unsigned int>("NImageWires")),
+    fImageTDCs(pset.get<unsigned int>("NImageTDCs")),
+    fReverseViews(pset.get<std::vector<bool> >("ReverseViews")),
+    fMaxBatchSize(pset.get<unsigned int>("MaxBatchSize", 0))
+  {
+    onnxrt::SessionConfig config;
+    config.optimizationLevel = pset.get<std::string>("OptimizationLevel", config.optimizationLevel);
+    config.intraOpThreads = pset.get<int>("IntraOpThreads", config.intraOpThreads);
+    config.interOpThreads = pset.get<int>("InterOpThreads", config.interOpThreads);
+    config.executionProvider = pset.get<std::string>("ExecutionProvider", config.executionProvider);
+    config.deviceId = pset.get<int>("DeviceId", config.deviceId);
+
+    mf::LogInfo("ONNXNetHandler") << "Loading network: " << fONNXModel << std::endl;
+    fSession = onnxrt::SessionRegistry::Instance().Get(fONNXModel, config);
+    if (!fSession){
+      throw art::Exception(art::errors::Configuration) << "ONNX model not found or incorrect: " << fONNXModel;
+    }
+    if (fSession->InputNames().size() != 1 && fSession->InputNames().size() != 3){
+      throw art::Exception(art::errors::Configuration) << "ONNX model " << fONNXModel << " has "
+        << fSession->InputNames().size() << " inputs, CVN gives 1 or 3";
+    }
+    mf::LogInfo("ONNXNetHandler") << "Running on " << fSession->Provider() << std::endl;
+  }
+
+  std::vector< std::vector<float> > ONNXNetHandler::Predict(const PixelMap& pm)
+  {
+    return PredictBatch({&pm}).front();
+  }
+
+  std::vector< std::vector< std::vector<float> > > ONNXNetHandler::PredictBatch(const std::vector<const PixelMap*>& pms)
+  {
+    DUNE_PROF_SCOPE("cvn::ONNXNetHandler::Predict");
+    DUNE_PROF_COUNT("cvn::ONNXNetHandler::Predict images", pms.size());
+    std::vector< std::vector< std::vector< float > > > allResults;
+    allResults.reserve(pms.size());
+
+    CVNImageUtils imageUtils(fImageWires,fImageTDCs, 3);
+    imageUtils.SetViewReversal(fReverseViews);
+    imageUtils.SetImageSize(fImageWires,fImageTDCs,3);
+    imageUtils.SetLogScale(fUseLogChargeScale);
+
+    const int64_t wires = fImageWires;
+    const int64_t tdcs = fImageTDCs;
+    const size_t viewSize = fImageWires * fImageTDCs;
+    const std::vector<std::string>& inputNames = fSession->InputNames();
+    const bool splitViews = inputNames.size() == 3;
+
+    tf::ForEachBatch(pms.size(), fMaxBatchSize, [&](size_t first, size_t last)
+    {
+      // All views of all images in one buffer, view major for split inputs
+      const int64_t samples = last - first;
+      const size_t batchViewSize = samples * viewSize;
+      fInputBuffer.resize(batchViewSize * 3);
+      for (int64_t s = 0; s < samples; ++s)
+      {
+        const PixelMap& pm = *pms[first + s];
+        if (splitViews){
+          std::vector<float*> viewBuffers;
+          for (unsigned int v = 0; v < 3; ++v)
+            viewBuffers.push_back(fInputBuffer.data() + v * batchViewSize + s * viewSize);
+          imageUtils.ConvertPixelMapToViewBuffers(pm, viewBuffers);
+        }
+        else {
+          imageUtils.ConvertPixelMapToBuffer(pm, fInputBuffer.data() + s * viewSize * 3);
+        }
+      }
+
+      std::vector<onnxrt::Input> inputs;
+      if (splitViews){
+        for (unsigned int v = 0; v < 3; ++v)
+          inputs.push_back({inputNames[v], {samples, wires, tdcs, 1}, fInputBuffer.data() + v * batchViewSize});
+      }
+      else {
+        inputs.push_back({inputNames[0], {samples, wires, tdcs, 3}, fInputBuffer.data()});
+      }
+
+      // One output per head, each (samples, head size)
+      const std::vector<onnxrt::Output> outputs = fSession->Run(inputs);
+      for (int64_t s = 0; s < samples; ++s)
+      {
+        std::vector< std::vector<float> > result;
+        for (auto const& output : outputs)
+        {
+          if (output.shape.empty() || output.shape[0] != samples){
+            throw art::Exception(art::errors::Unknown) << "ONNX output " << output.name
+              << " is not batched over the " << samples << " images";
+          }
+          const size_t headSize = output.values.size() / samples;
+          result.emplace_back(output.values.begin() + s * headSize, output.values.begin() + (s + 1) * headSize);
+        }
+        allResults.push_back(std::move(result));
+      }
+    });
+
+    return allResults;
+  }
+
+}
@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ONNXNetHandler.h
+/// \brief   ONNXNetHandler for CVN, runs a network exported to .onnx
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_ONNXNETHANDLER_H
+#define CVN_ONNXNETHANDLER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dunereco/CVN/func/PixelMap.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "dunereco/ONNXRuntime/ORTSessionRegistry.h"
+
+namespace cvn
+{
+
+  /// Same inputs and outputs as TFNetHandler, for the CVN network exported
+  /// from Tensorflow with its NHWC input layout. A single input model takes
+  /// the three views as channels, a three input model one view per input.
+  /// Every model output is one head of the result
+  class ONNXNetHandler
+  {
+  public:
+
+    /// Constructor which takes a pset with ONNXModel and the image fields
+    ONNXNetHandler(const fhicl::ParameterSet& pset);
+
+    /// Return prediction arrays for PixelMap
+    std::vector< std::vector<float> > Predict(const PixelMap& pm);
+
+    /// Return prediction arrays for each PixelMap, packing the maps into
+    /// batches of at most fMaxBatchSize images per network call
+    std::vector< std::vector< std::vector<float> > > PredictBatch(const std::vector<const PixelMap*>& pms);
+
+  private:
+
+    std::string  fLibPath;  ///< Library path (typically dune_pardata...)
+    std::string  fONNXModel;  ///< location of the .onnx file in the above path
+    bool         fUseLogChargeScale;  ///< Is the charge using a log scale?
+    unsigned int fImageWires;  ///< Number of wires for the network to classify
+    unsigned int fImageTDCs;   ///< Number of tdcs for the network to classify
+    std::vector<bool> fReverseViews; ///< Do we need to reverse any views?
+    unsigned int fMaxBatchSize; ///< Maximum number of images per network call (0 = no limit)
+    std::shared_ptr<onnxrt::SharedSession> fSession; ///< ONNX Runtime session
+    std::vector<float> fInputBuffer; ///< Input images, reused between calls
+
+  };
+
+}
+
+#endif  // CVN_ONNXNETHANDLER_H
@@ -11,10 +11,14 @@
 #include  <ostream>
 #include  <list>
 #include  <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <numeric>
+#include <utility>
 
 #include "dunereco/CVN/art/PixelMapProducer.h"
 #include "dunereco/CVN/func/AssignLabels.h"
+#include "dunereco/Profiling/ProfScope.h"
 #include "TVector2.h"
 #include "TH2D.h"
 #include "lardataobj/RecoBase/Hit.h"
@@ -26,6 +30,23 @@
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
 
+namespace
+{
+  /// Per thread global hit coordinates of the cluster being mapped, kept
+  /// between events so the maps are made without growing them again
+  struct HitScratch
+  {
+    std::vector<unsigned int> wires, planes;
+    std::vector<double> tdcs, pes;
+  };
+
+  HitScratch& Scratch()
+  {
+    thread_local HitScratch scratch;
+    return scratch;
+  }
+}
+
 namespace cvn
 {
 
@@ -34,19 +55,23 @@ namespace cvn
     fNTdc(nTdc),
     fTRes(tRes),
     fUnwrapped(2),
-    fProtoDUNE(false)
+    fProtoDUNE(false),
+    fRecoOnly(false),
+    fROIWires(0)
   {
+  }
 
-    fGeometry = &*(art::ServiceHandle<geo::Geometry>());  
-    if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos)
-      _cacheIntercepts();
+  PixelMapProducer::PixelMapProducer():
+    fUnwrapped(2),
+    fProtoDUNE(false),
+    fRecoOnly(false),
+    fROIWires(0)
+  {
   }
 
-  PixelMapProducer::PixelMapProducer()
+  PixelMapProducer::WireMapping PixelMapProducer::_denseMapping() const
   {
-    fGeometry = &*(art::ServiceHandle<geo::Geometry>());  
-    if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos)
-      _cacheIntercepts();
+    return fMapper.DenseMapping(fUnwrapped, fProtoDUNE);
   }
 
   PixelMap PixelMapProducer::CreateMap(detinfo::DetectorPropertiesData const& detProp,
@@ -62,14 +87,12 @@ namespace cvn
   PixelMap PixelMapProducer::CreateMap(detinfo::DetectorPropertiesData const& detProp,
                                        const std::vector<const recob::Hit* >& cluster)
   {
-    if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos){
-      fVDPlane0.clear();
-      fVDPlane1.clear();
-      _cacheIntercepts();
-    }
-    
-    Boundary bound = DefineBoundary(detProp, cluster);
-    return CreateMapGivenBoundary(detProp, cluster, bound);
+    DUNE_PROF_SCOPE("cvn::PixelMapProducer::CreateMap");
+    DUNE_PROF_COUNT("cvn::PixelMapProducer::CreateMap hits", cluster.size());
+    // The global coordinates are worked out once for the boundary and the map
+    HitScratch& hits = Scratch();
+    _globalHits(detProp, cluster, hits.wires, hits.planes, hits.tdcs, hits.pes);
+    return _fillMap(hits.wires, hits.planes, hits.tdcs, hits.pes);
   }
 
   PixelMap PixelMapProducer::CreateMapGivenBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -77,124 +100,178 @@ namespace cvn
       const Boundary& bound)
   {
 
-    PixelMap pm(fNWire, fNTdc, bound);
+    PixelMap pm(fNWire, fNTdc, bound, !fRecoOnly);
+
+    HitScratch& hits = Scratch();
+    _globalHits(detProp, cluster, hits.wires, hits.planes, hits.tdcs, hits.pes);
+    pm.AddHits(hits.wires, hits.tdcs, hits.planes, hits.pes);
+    return pm;
+  }
+
+  GlobalHitCoordinates PixelMapProducer::CreateGlobalHitCoordinates(detinfo::DetectorPropertiesData const& detProp,
+                                                                    const std::vector< art::Ptr< recob::Hit > >& hits)
+  {
+    DUNE_PROF_SCOPE("cvn::PixelMapProducer::CreateGlobalHitCoordinates");
+    const WireMapping mapping = _denseMapping();
+    const GlobalWireMapper::GlobalWireLUT lut = fMapper.Table(detProp, mapping);
+
+    unsigned int nKeys = 0;
+    for(const art::Ptr<recob::Hit>& hit : hits)
+      nKeys = std::max<unsigned int>(nKeys, hit.key() + 1);
+
+    GlobalHitCoordinates coordinates(mapping, nKeys);
+    for(const art::Ptr<recob::Hit>& hit : hits)
+    {
+      double globalTDC;
+      unsigned int globalWire, globalPlane;
+      if(!fMapper.Lookup(detProp, mapping, lut, hit->WireID(), hit->PeakTime(), globalWire, globalPlane, globalTDC)) continue;
+      coordinates.Set(hit.key(), globalWire, globalPlane, globalTDC);
+    }
+    return coordinates;
+  }
+
+  PixelMap PixelMapProducer::CreateMap(const std::vector< art::Ptr< recob::Hit > >& cluster,
+                                       const GlobalHitCoordinates& coordinates)
+  {
+    DUNE_PROF_SCOPE("cvn::PixelMapProducer::CreateMap");
+    DUNE_PROF_COUNT("cvn::PixelMapProducer::CreateMap hits", cluster.size());
+    if(coordinates.Mapping() != _denseMapping())
+      throw art::Exception(art::errors::Configuration)
+        << "PixelMapProducer: the global hit coordinates were made with wire mapping "
+        << coordinates.Mapping() << ", these pixel maps use " << _denseMapping() << "\n";
+
+    HitScratch& hits = Scratch();
+    _clearHits(cluster.size(), hits.wires, hits.planes, hits.tdcs, hits.pes);
+
+    for(const art::Ptr<recob::Hit>& hit : cluster)
+    {
+      if(!coordinates.IsValid(hit.key())) continue;
+      hits.wires.push_back(coordinates.Wire(hit.key()));
+      hits.planes.push_back(coordinates.Plane(hit.key()));
+      hits.tdcs.push_back(coordinates.TDC(hit.key()));
+      hits.pes.push_back(hit->Integral());
+    }
+    return _fillMap(hits.wires, hits.planes, hits.tdcs, hits.pes);
+  }
+
+  void PixelMapProducer::_globalHits(detinfo::DetectorPropertiesData const& detProp,
+                                     const std::vector<const recob::Hit*>& cluster,
+                                     std::vector<unsigned int>& wires, std::vector<unsigned int>& planes,
+                                     std::vector<double>& tdcs, std::vector<double>& pes)
+  {
+    const WireMapping mapping = _denseMapping();
+    const GlobalWireMapper::GlobalWireLUT lut = fMapper.Table(detProp, mapping);
+
+    _clearHits(cluster.size(), wires, planes, tdcs, pes);
 
     for(size_t iHit = 0; iHit < cluster.size(); ++iHit)
     {
 
       geo::WireID wireid     = cluster[iHit]->WireID();
-      double temptdc         = cluster[iHit]->PeakTime();
-      unsigned int tempWire  = wireid.Wire;
-      unsigned int tempPlane = wireid.Plane;
-      // Leigh: Simple modification to unwrap the collection view wire plane
-      if(!fProtoDUNE){
-        if(fUnwrapped == 1){
-          // Jeremy: Autodetect geometry for DUNE 10kt module. Is this a bad idea??
-          if (fGeometry->DetectorName() == "dune10kt_v1") {
-            if (wireid.TPC%6 == 0 or wireid.TPC%6 == 5) continue; // Skip dummy TPCs in 10kt module
-            GetDUNE10ktGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),
-              wireid.Plane,wireid.TPC,tempWire,tempPlane,temptdc);
-          }
-          else if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos){
-            GetDUNEVertDrift3ViewGlobalWire(wireid.Wire, wireid.Plane,wireid.TPC,tempWire,tempPlane);
-          }
-          // Default to 1x2x6. Should probably specifically name this function as such
-          else {
-            GetDUNEGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),
-              wireid.Plane,wireid.TPC,tempWire,tempPlane,temptdc);
-          }
-        }
-        else if(fUnwrapped == 2){
-          // Old method that has problems with the APA crossers, kept for old times' sake
-          GetDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,tempWire,tempPlane);
-        }
-      }
-      else{
-        GetProtoDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,tempWire,tempPlane);
-      }
-      const double pe  = cluster[iHit]->Integral();
-      const unsigned int wire = tempWire;
-      const unsigned int wirePlane = tempPlane;
-      const double tdc = temptdc;
-      pm.Add(wire, tdc, wirePlane, pe);
+      double temptdc;
+      unsigned int tempWire, tempPlane;
+      if(!fMapper.Lookup(detProp, mapping, lut, wireid, cluster[iHit]->PeakTime(), tempWire, tempPlane, temptdc)) continue;
+
+      wires.push_back(tempWire);
+      planes.push_back(tempPlane);
+      tdcs.push_back(temptdc);
+      pes.push_back(cluster[iHit]->Integral());
 
     }
-    return pm;
   }
 
-  std::ostream& operator<<(std::ostream& os, const PixelMapProducer& p)
+  void PixelMapProducer::_clearHits(size_t nHits, std::vector<unsigned int>& wires, std::vector<unsigned int>& planes,
+                                    std::vector<double>& tdcs, std::vector<double>& pes) const
   {
-    os << "PixelMapProducer: "
-      << p.NTdc()  <<" tdcs X  " <<  p.NWire() << " wires";
-    return os;
+    // The vectors are reused between events, count the times they have to grow
+    if(nHits > wires.capacity())
+      DUNE_PROF_COUNT("cvn::PixelMapProducer scratch allocations", 1);
+
+    wires.clear();
+    planes.clear();
+    tdcs.clear();
+    pes.clear();
+    wires.reserve(nHits);
+    planes.reserve(nHits);
+    tdcs.reserve(nHits);
+    pes.reserve(nHits);
   }
 
-  double PixelMapProducer::_getIntercept(geo::WireID wireid) const
+  void PixelMapProducer::SetRegionOfInterest(unsigned int nWires, const std::vector<bool>& reverseViews)
   {
-    const geo::WireGeo* pwire = fGeometry->WirePtr(wireid);
-    geo::Point_t center = pwire->GetCenter();
-    double slope = 0.;
-    if(!pwire->isVertical()) slope = pwire->TanThetaZ();
-    
-    double intercept = center.Y() - slope*center.Z();
-    if(wireid.Plane == 2) intercept = 0.;
-    
-    return intercept;
+    if(nWires > 0 && reverseViews.size() != 3)
+      throw art::Exception(art::errors::Configuration)
+        << "PixelMapProducer: the region of interest needs the reversal of 3 views, not "
+        << reverseViews.size() << "\n";
+
+    // A region as large as the map is the map
+    fROIWires = nWires < fNWire ? nWires : 0;
+    fROIReverse = reverseViews;
+    fROIUtils.SetImageSize(fROIWires, fNTdc, 3);
   }
 
-  void PixelMapProducer::_cacheIntercepts(){
-   
-    // double spacing = 0.847;
-    for(int plane = 0; plane < 2; plane++){
-      
-      int nCRM_row = 6;
-      int nCRM_col = 6;
-      bool is8x6 = fGeometry->DetectorName().find("8x6") != std::string::npos;
-      if(is8x6)
-        nCRM_col = 8;
-      
-      geo::WireID wstart = geo::WireID(0, 0, plane,0);
-      geo::WireID wstartplus1 = geo::WireID(0, 0, plane, 1);
-      double wstart_intercept = _getIntercept(wstart);
-      double wstartplus1_intercept = _getIntercept(wstartplus1);
-      if(plane == 0)
-        fSpacing0 = std::abs(wstartplus1_intercept - wstart_intercept);
-      else
-        fSpacing1 = std::abs(wstartplus1_intercept - wstart_intercept);
-
-      bool is3view30deg = fGeometry->DetectorName().find("30deg") != std::string::npos;
-      
-      for(int diag_tpc = 0; diag_tpc < nCRM_row; diag_tpc++){
-        
-        int tpc = (plane == 0 || !is3view30deg) ? (nCRM_col+1)*diag_tpc : (nCRM_col-1)*(nCRM_row-diag_tpc);
-        geo::PlaneID const planeID(0, tpc, plane);
-        unsigned int nWiresTPC = fGeometry->Nwires(planeID);
-     
-        geo::WireID start = geo::WireID(planeID, 0);
-        geo::WireID end = geo::WireID(planeID, nWiresTPC-1);
-
-        double start_intercept = _getIntercept(start);
-        double end_intercept = _getIntercept(end);
-        if(plane == 0){
-          fVDPlane0.push_back(start_intercept);
-          fVDPlane0.push_back(end_intercept);
-        }
-        else if (is3view30deg){
-          fVDPlane1.push_back(end_intercept);
-          fVDPlane1.push_back(start_intercept);
-        }
-        else{
-          fVDPlane1.push_back(start_intercept);
-          fVDPlane1.push_back(end_intercept);
-        }
-      }
+  void PixelMapProducer::_regionOfInterest(const std::vector<unsigned int>& wires, const std::vector<unsigned int>& planes,
+                                           const std::vector<double>& tdcs, const std::vector<double>& pes,
+                                           const Boundary& bound, int firstWire[3]) const
+  {
+    // The coarse level of the pyramid: the charge of each wire of the full
+    // map, summed over its time window, with the wires in image order
+    std::vector<float> wireCharges[3];
+    for(unsigned int view = 0; view < 3; ++view) wireCharges[view].assign(fNWire, 0.f);
+    for(size_t iHit = 0; iHit < wires.size(); ++iHit)
+    {
+      const unsigned int view = planes[iHit];
+      if(view > 2 || !bound.IsWithin(wires[iHit], tdcs[iHit], view)) continue;
+      const unsigned int wire = wires[iHit] - bound.FirstWire(view);
+      wireCharges[view][fROIReverse[view] ? fNWire - wire - 1 : wire] += pes[iHit];
+    }
 
+    for(unsigned int view = 0; view < 3; ++view)
+    {
+      unsigned int minWire, maxWire;
+      fROIUtils.GetMinMaxWires(wireCharges[view], minWire, maxWire);
+      // The image of a reversed view starts from the last wire of the region
+      firstWire[view] = bound.FirstWire(view) + (fROIReverse[view] ? fNWire - minWire - fROIWires : minWire);
     }
   }
 
+  PixelMap PixelMapProducer::_fillMap(const std::vector<unsigned int>& wires, const std::vector<unsigned int>& planes,
+                                      const std::vector<double>& tdcs, const std::vector<double>& pes)
+  {
+    const Boundary bound = _boundary(wires, planes, tdcs);
+    if(fROIWires == 0)
+    {
+      PixelMap pm(fNWire, fNTdc, bound, !fRecoOnly);
+      pm.AddHits(wires, tdcs, planes, pes);
+      return pm;
+    }
+
+    // The fine level only covers the wires the image is made of
+    int firstWire[3];
+    _regionOfInterest(wires, planes, tdcs, pes, bound, firstWire);
+    PixelMap pm(fROIWires, fNTdc, Boundary(bound, fROIWires, firstWire[0], firstWire[1], firstWire[2]), !fRecoOnly);
+    pm.AddHits(wires, tdcs, planes, pes);
+    return pm;
+  }
+
+  std::ostream& operator<<(std::ostream& os, const PixelMapProducer& p)
+  {
+    os << "PixelMapProducer: "
+      << p.NTdc()  <<" tdcs X  " <<  p.NWire() << " wires";
+    return os;
+  }
+
   Boundary PixelMapProducer::DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
                                             const std::vector< const recob::Hit*>& cluster)
   {
+    HitScratch& hits = Scratch();
+    _globalHits(detProp, cluster, hits.wires, hits.planes, hits.tdcs, hits.pes);
+    return _boundary(hits.wires, hits.planes, hits.tdcs);
+  }
+
+  Boundary PixelMapProducer::_boundary(const std::vector<unsigned int>& wires, const std::vector<unsigned int>& planes,
+                                       const std::vector<double>& tdcs) const
+  {
 
     std::vector<double> time_0;
     std::vector<double> time_1;
@@ -206,33 +283,11 @@ namespace cvn
     std::vector<int> wire_2;
     
 
-    for(size_t iHit = 0; iHit < cluster.size(); ++iHit)
+    for(size_t iHit = 0; iHit < wires.size(); ++iHit)
     {
-      geo::WireID wireid = cluster[iHit]->WireID();
-      
-      unsigned int globalWire = wireid.Wire;
-      unsigned int globalPlane = wireid.Plane;
-      double globalTime = cluster[iHit]->PeakTime();
-      if(!fProtoDUNE){
-        if(fUnwrapped == 1) {
-          if (fGeometry->DetectorName() == "dune10kt_v1") {
-            if (wireid.TPC%6 == 0 or wireid.TPC%6 == 5) continue; // Skip dummy TPCs in 10kt module
-            GetDUNE10ktGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),wireid.Plane,wireid.TPC,globalWire,globalPlane,globalTime);
-          }
-          else if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos){
-            GetDUNEVertDrift3ViewGlobalWire(wireid.Wire, wireid.Plane,wireid.TPC,globalWire,globalPlane);
-          }
-          else {
-            GetDUNEGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),wireid.Plane,wireid.TPC,globalWire,globalPlane,globalTime);
-          }
-        }
-        else if(fUnwrapped == 2){
-          GetDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,globalWire,globalPlane);
-        }
-      }
-      else{
-        GetProtoDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,globalWire,globalPlane);
-      }
+      const unsigned int globalWire = wires[iHit];
+      const unsigned int globalPlane = planes[iHit];
+      const double globalTime = tdcs[iHit];
 
       if(globalPlane==0){
         time_0.push_back(globalTime);
@@ -288,330 +343,50 @@ namespace cvn
 
   void PixelMapProducer::GetDUNEGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const
   {
-    unsigned int nWiresTPC = 400;
-
-    globalWire = localWire;
-    globalPlane = 0;
-
-    // Collection plane has more wires
-    if(plane == 2){
-      nWiresTPC=480;
-      globalPlane = 2;
-    }
-
-    // Workspace geometry has two drift regions
-    //                  |-----|-----| /  /
-    //      y ^         |  3  |  2  |/  /
-    //        | -| z    |-----|-----|  /
-    //        | /       |  1  |  0  | /
-    //  x <---|/        |-----|-----|/
-    //
-
-    int tpcMod4 = tpc%4;
-
-    // Induction views depend on the drift direction
-    if(plane < 2){
-      // For drift in negative x direction keep U and V as defined.
-      if(tpcMod4 == 0 || tpcMod4 == 3){
-        globalPlane = plane;
-      }
-      // For drift in positive x direction, swap U and V.
-      else{
-        if(plane == 0) globalPlane = 1;
-        else globalPlane = 0;
-      }
-    }
-
-    if(globalPlane != 1){
-      globalWire += (tpc/4)*nWiresTPC;
-    }
-    else{
-      globalWire += ((23-tpc)/4)*nWiresTPC;
-    }
-
+    fMapper.GetDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
   }
 
-  // Based on Robert's code in adcutils
   void PixelMapProducer::GetDUNEGlobalWireTDC(detinfo::DetectorPropertiesData const& detProp,
                                               unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
-                                             unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
+                                              unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
   {
-
-    unsigned int nWiresTPC = 400;
-    unsigned int wireGap = 4;
-    auto const& tpcgeom = fGeometry->TPC(geo::TPCID{0, tpc});
-    double driftLen = tpcgeom.DriftDistance();
-    double apaLen = tpcgeom.Width() - tpcgeom.ActiveWidth();
-    double driftVel = detProp.DriftVelocity();
-    unsigned int drift_size = (driftLen / driftVel) * 2; // Time in ticks to cross a TPC 
-    unsigned int apa_size   = 4*(apaLen / driftVel) * 2; // Width of the whole APA in TDC
-
-    globalWire = 0;
-    globalPlane = 0;
-//    int dir = fGeometry->TPC(tpc,0).DetectDriftDirection();
-
-    // Collection plane has more wires
-    if(plane == 2){
-      nWiresTPC = 480;
-      wireGap = 5;
-      globalPlane = 2;
-    }
-
-    bool includeZGap = true;
-    if(includeZGap) nWiresTPC += wireGap;
-
-    // Workspace geometry has two drift regions
-    //                  |-----|-----| /  /
-    //      y ^         |  3  |  2  |/  /
-    //        | -| z    |-----|-----|  /
-    //        | /       |  1  |  0  | /
-    //  x <---|/        |-----|-----|/
-    //
-    int tpcMod4 = tpc%4;
-    // Induction views depend on the drift direction
-    // if (plane < 2 and tpc%2 == 1) globalPlane = !plane;
-    if (plane < 2 and tpcMod4 > 0 and tpcMod4 < 3) globalPlane = !plane;
-    else globalPlane = plane;
-
-    // int offset = 752; // Offset between upper and lower modules in induction views, from Robert & Dorota's code
-    int offset = 0; // Offset between upper and lower modules in induction views, from Robert & Dorota's code
-    // Second induction plane gets offset from the back of the TPC
-    // if (globalPlane != 1) globalWire += (tpc/4)*nWiresTPC;
-    // else globalWire += ((23-tpc)/4)*nWiresTPC;
-    if (globalPlane != 1) globalWire += (tpc/4)*nWiresTPC + (tpcMod4 > 1)*offset + localWire;
-    else globalWire += ((23-tpc)/4)*nWiresTPC + (tpcMod4 > 1)*offset + localWire;
-    // Reverse wires and add offset for upper modules in induction views
-    // Nitish : what's the difference between Nwires here and nWiresTPC?
-    // if (tpcMod4 > 1 and globalPlane < 2) globalWire += fGeometry->Nwires(globalPlane, tpc, 0) + offset - localWire;
-    // else globalWire += localWire;
-
-    if(tpcMod4 == 0 || tpcMod4 == 2){
-      globalTDC = drift_size - localTDC;
-    }
-    else{
-      globalTDC = localTDC + drift_size + apa_size;
-    }
+    fMapper.GetDUNEGlobalWireTDC(detProp, localWire, localTDC, plane, tpc, globalWire, globalPlane, globalTDC);
   }
 
   void PixelMapProducer::GetDUNE10ktGlobalWireTDC(detinfo::DetectorPropertiesData const& detProp,
                                                   unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
                                                   unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
   {
-    unsigned int nWiresTPC = 400;
-    unsigned int wireGap = 4;
-    auto const& tpcgeom = fGeometry->TPC(geo::TPCID{0, tpc});
-    double driftLen = tpcgeom.DriftDistance();
-    double apaLen = tpcgeom.Width() - tpcgeom.ActiveWidth();
-    double driftVel = detProp.DriftVelocity();
-    unsigned int drift_size = (driftLen / driftVel) * 2; // Time in ticks to cross a TPC 
-    unsigned int apa_size   = 4*(apaLen / driftVel) * 2; // Width of the whole APA in TDC
-
-
-    globalWire = 0;
-    globalPlane = 0;
-
-    // Collection plane has more wires
-    if(plane == 2){
-      nWiresTPC = 480;
-      wireGap = 5;
-      globalPlane = 2;
-    }
+    fMapper.GetDUNE10ktGlobalWireTDC(detProp, localWire, localTDC, plane, tpc, globalWire, globalPlane, globalTDC);
+  }
 
-    bool includeZGap = true;
-    if(includeZGap) nWiresTPC += wireGap;
-
-    // 10kt has four real TPCs and two dummies in each slice
-    //
-    //                 |--|-----|-----|-----|-----|--| /  /
-    //      y ^        |11| 10  |  9  |  8  |  7  | 6|/  /
-    //        | -| z   |--|-----|-----|-----|-----|--|  /
-    //        | /      | 5|  4  |  3  |  2  |  1  | 0| /
-    //  x <---|/       |--|-----|-----|-----|-----|--|/
-    //                     ^  wires  ^ ^  wires  ^
-    //
-    // We already filtered out the dummies, so we can assume 0->3 as follows:
-    //
-    //                 |-----|-----|-----|-----| /  /
-    //      y ^        |  7  |  6  |  5  |  4  |/  /
-    //        | -| z   |-----|-----|-----|-----|  /
-    //        | /      |  3  |  2  |  1  |  0  | /
-    //  x <---|/       |-----|-----|-----|-----|/
-    //                  ^  wires  ^ ^  wires  ^
-    //
-
-    size_t tpc_x = (tpc%6) - 1;   // x coordinate in 0->4 range
-    size_t tpc_xy = (tpc%12) - 1; // xy coordinate as 0->3 & 6->9 (converted from 1->4, 7->10)
-    if (tpc_xy > 3) tpc_xy -= 2;  // now subtract 2 so it's in the 0->7 range
-
-    // Induction views depend on the drift direction
-    if (plane < 2 and tpc%2 == 1) globalPlane = !plane;
-    else globalPlane = plane;
-
-    int offset = 752; // Offset between upper and lower modules in induction views, from Robert & Dorota's code
-    // Second induction plane gets offset from the back of the TPC
-    if (globalPlane != 1) globalWire += (tpc/12)*nWiresTPC;
-    else globalWire += ((300-tpc)/12)*nWiresTPC;
-    // Reverse wires and add offset for upper modules in induction views
-    if (tpc_xy > 3 and globalPlane < 2) globalWire += fGeometry->Nwires(geo::PlaneID{tpcgeom.ID(), globalPlane}) + offset - localWire;
-    else globalWire += localWire;
-
-    if (tpc_x % 2 == 0) globalTDC = localTDC;
-    else globalTDC = (2*drift_size) - localTDC;
-    if (tpc_x > 1) globalTDC += 2 * (drift_size + apa_size);
-
-  } // function PixelMapProducer::GetDUNE10ktGlobalWireTDC
-
-  // Special case for ProtoDUNE where we want to extract single particles to mimic CCQE interactions. The output pixel maps should be the same as the workspace
-  // but we need different treatment of the wire numbering
   void PixelMapProducer::GetProtoDUNEGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const
-  { 
-    unsigned int nWiresTPC = 400;
-    
-    globalWire = localWire;
-    globalPlane = 0;
-    
-    // Collection plane has more wires
-    if(plane == 2){
-      nWiresTPC=480;
-      globalPlane = 2;
-    }
-    
-    // ProtoDUNE has a central CPA so times are fine
-    // It (annoyingly) has two dummy TPCs on the sides
-    //                  
-    //      y ^       |-|-----|-----|-|   /
-    //        | -| z  | |     |     | |  /
-    //        | /     |3|  2  |  1  |0| /
-    //  x <---|/      |-|-----|-----|-|/
-    //
-    
-    int tpcMod4 = tpc%4;
-    // tpcMod4: 1 for -ve drift, 2 for +ve drift
-    // Induction views depend on the drift direction
-    if(plane < 2){
-      // For drift in negative x direction keep U and V as defined.
-      if(tpcMod4 == 1){
-        globalPlane = plane;
-      }
-      // For drift in positive x direction, swap U and V.
-      else{
-        if(plane == 0) globalPlane = 1;
-        else globalPlane = 0;
-      }
-    }
-    
-    if(globalPlane != 1){
-      globalWire += (tpc/4)*nWiresTPC;
-    }
-    else{
-      globalWire += ((12-tpc)/4)*nWiresTPC;
-    }
-  
-  } // function PixelMapProducer::GetProtoDUNEGlobalWire
+  {
+    fMapper.GetProtoDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
+  }
 
-  // Special case for ProtoDUNE where we want to extract single particles to mimic CCQE interactions. The output pixel maps should be the same as the workspace
-  // but we need different treatment of the wire numbering
   void PixelMapProducer::GetProtoDUNEGlobalWireTDC(unsigned int localWire, double localTDC, unsigned int plane, unsigned int tpc,
-    unsigned int& globalWire, double& globalTDC, unsigned int& globalPlane) const
+                                                   unsigned int& globalWire, double& globalTDC, unsigned int& globalPlane) const
   {
-    // We can just use the existing function to get the global wire & plane
- //   GetProtoDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
-    GetDUNEGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
-    // Implement additional mirroring here?
+    fMapper.GetProtoDUNEGlobalWireTDC(localWire, localTDC, plane, tpc, globalWire, globalTDC, globalPlane);
+  }
 
-  } // function GetProtoDUNEGlobalWireTDC
-  
   void PixelMapProducer::GetDUNEVertDrift3ViewGlobalWire(unsigned int localWire, unsigned int plane, unsigned int tpc, unsigned int& globalWire, unsigned int& globalPlane) const
   {
-    // Preliminary function for VD Geometries
-    
-    int nCRM_row = 6;
-    int nCRM_col = 6;
-    bool is8x6 = fGeometry->DetectorName().find("8x6") != std::string::npos;
-    if(is8x6)
-      nCRM_col = 8;
-    // spacing between y-intercepts of parallel wires in a given plane. 
-    double spacing = 0.847; 
-    
-    globalPlane = plane;
-    geo::PlaneID const planeID{0, tpc, globalPlane};
-    unsigned int nWiresTPC = fGeometry->Nwires(planeID);
-    bool is3view30deg = fGeometry->DetectorName().find("30deg") != std::string::npos;
-    
-    if(globalPlane < 2){
-      
-      geo::WireID wire_id = geo::WireID(planeID, localWire);
-      double wire_intercept = _getIntercept(wire_id);
-   
-      double low_bound = 0., upper_bound = 0.; 
-      int start, end, diag_tpc;
-      // get wires on diagonal CRMs and their intercepts which bound the current wire's intercept 
-      if(globalPlane == 0){
-        start = std::lower_bound(fVDPlane0.begin(), fVDPlane0.end(), wire_intercept) - fVDPlane0.begin() - 1;
-        end = std::upper_bound(fVDPlane0.begin(), fVDPlane0.end(), wire_intercept) - fVDPlane0.begin();
-        
-        low_bound = fVDPlane0[start];
-        if(end < (int) fVDPlane0.size())
-          upper_bound = fVDPlane0[end];
-        diag_tpc = (start/2);
-        spacing = fSpacing0;
-      }
-      else if (is3view30deg){
-        end = std::lower_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin() - 1;
-        start = std::upper_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin();
-       
-        if(end > 0)
-          low_bound = fVDPlane1[end];
-        upper_bound = fVDPlane1[start];
-        diag_tpc = (nCRM_row-(end/2) - 1);
-        if(end < 0) 
-          diag_tpc = nCRM_row - 1;
-        spacing = fSpacing1;
-      }
-      else{
-        int tpc_y = tpc % nCRM_col;
-        globalWire = localWire + tpc_y*nWiresTPC;
-        
-        start = std::lower_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin() - 1;
-        end = std::upper_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin();
-        
-        low_bound = fVDPlane1[start];
-        if(end < (int) fVDPlane1.size())
-          upper_bound = fVDPlane1[end];
-        diag_tpc = (start/2);
-      }
-      // if the intercept of the wire is in between two diagonal CRMs, assign it to the diagonal CRM its closest to 
-      if((((start % 2)^globalPlane && is3view30deg) || (globalPlane == 0 && !is3view30deg && (start % 2 == 1))) && (diag_tpc < nCRM_row-1)){
-        int diag_idx = diag_tpc + !globalPlane;
-        globalWire = (wire_intercept > (low_bound+upper_bound)*0.5) ? (nWiresTPC-1)*diag_idx + !globalPlane : (nWiresTPC-1)*diag_idx + globalPlane;
-      }
-      // otherwise assign it to the closest wire within the same CRM
-      else if(is3view30deg || (globalPlane == 0 && !is3view30deg && (start %2 == 0))){
-        int diag_idx = diag_tpc;
-        int offset = globalPlane ? std::round((upper_bound - wire_intercept)/spacing) : std::round((wire_intercept-low_bound)/spacing);
-        globalWire = (nWiresTPC-1)*diag_idx + offset + 1;
-        
-      }
-    }
-    else{
-      int tpc_z = tpc/nCRM_col;
-      globalWire = localWire + tpc_z*nWiresTPC;
-    }
+    fMapper.GetDUNEVertDrift3ViewGlobalWire(localWire, plane, tpc, globalWire, globalPlane);
   }
 
-  void PixelMapProducer::GetHitTruth(detinfo::DetectorClocksData const& clockData,
+  void PixelMapProducer::GetHitTruth(dune_ana::DUNEAnaHitTruthCache& truth,
                                      art::Ptr<recob::Hit>& hit, std::vector<int>& pdgs,
     std::vector<int>& tracks, std::vector<float>& energy, std::vector<std::string>& process) {
 
-    // BackTracker and ParticleInventory
-    art::ServiceHandle<cheat::BackTrackerService> bt;
+    // ParticleInventory
     art::ServiceHandle<cheat::ParticleInventoryService> pi;
 
     // Get true particle and PDG responsible for this hit
-    std::vector<sim::TrackIDE> IDEs = bt->HitToTrackIDEs(clockData, hit);
-    for (sim::TrackIDE & k : IDEs) {
+    for (const sim::TrackIDE & k : truth.GetTrackIDEs(hit)) {
       tracks.push_back(k.trackID); // add track ID
-      simb::MCParticle p = pi->TrackIdToParticle(k.trackID);
+      const simb::MCParticle& p = pi->TrackIdToParticle(k.trackID);
       process.push_back(p.Process()); // add G4 process string
     
       // Manually check to see if we have a Michel electron here
@@ -639,48 +414,66 @@ namespace cvn
     // 3-dimensional coordinates (wire, time TPC) and 3 views
     SparsePixelMap map(3, 3, usePixelTruth);
 
-    art::ServiceHandle<cheat::BackTrackerService> bt;
-    art::ServiceHandle<cheat::ParticleInventoryService> pi;
-    
+    // Backtrack the whole cluster at once
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    if (usePixelTruth) truth.Fill(cluster);
+
+    WireMapping mapping;
+    const DetectorType detector = fMapper.Detector();
+    if (detector == GlobalWireMapper::kDet1x2x6) mapping = GlobalWireMapper::kMapDUNETDC;
+    else if (detector == GlobalWireMapper::kDet10kt) mapping = GlobalWireMapper::kMap10ktTDC;
+    // ProtoDUNE uses the workspace wire numbering and local times
+    else if (detector == GlobalWireMapper::kDetProtoDUNE) mapping = GlobalWireMapper::kMapDUNE;
+    else throw art::Exception(art::errors::UnimplementedFeature)
+      << "Geometry " << fMapper.Geometry()->DetectorName() << " not implemented "
+      << "in CreateSparseMap." << std::endl;
+    const GlobalWireMapper::GlobalWireLUT lut = fMapper.Table(detProp, mapping);
+
+    // Map all hits first, so that each view is allocated once
+    std::vector<unsigned int> hits, wires, planes;
+    std::vector<double> times;
+    hits.reserve(cluster.size());
+    wires.reserve(cluster.size());
+    planes.reserve(cluster.size());
+    times.reserve(cluster.size());
+    std::vector<size_t> nPixels(3, 0);
+
     for(size_t iHit = 0; iHit < cluster.size(); ++iHit) {
 
       geo::WireID wireid       = cluster[iHit]->WireID();
-      double globalTime        = cluster[iHit]->PeakTime();
-      unsigned int globalWire  = wireid.Wire;
-      unsigned int globalPlane = wireid.Plane;
+      double globalTime;
+      unsigned int globalWire, globalPlane;
+      if (!fMapper.Lookup(detProp, mapping, lut, wireid, cluster[iHit]->PeakTime(),
+        globalWire, globalPlane, globalTime)) continue;
+
+      hits.push_back(iHit);
+      wires.push_back(globalWire);
+      planes.push_back(usePixelTruth ? globalPlane : 0);
+      times.push_back(globalTime);
+      if (planes.back() < 3) ++nPixels[planes.back()];
+    } // for iHit
 
-      if (fGeometry->DetectorName().find("1x2x6") != std::string::npos) {
-        GetDUNEGlobalWireTDC(detProp, wireid.Wire, cluster[iHit]->PeakTime(),
-          wireid.Plane, wireid.TPC, globalWire, globalPlane, globalTime);
-      }
-      else if (fGeometry->DetectorName() == "dune10kt_v1") {
-        if (wireid.TPC%6 == 0 or wireid.TPC%6 == 5) continue;
-        GetDUNE10ktGlobalWireTDC(detProp, wireid.Wire, cluster[iHit]->PeakTime(),
-          wireid.Plane, wireid.TPC, globalWire, globalPlane, globalTime);
-      }
-      else if (fGeometry->DetectorName().find("protodune") != std::string::npos) {
-        GetProtoDUNEGlobalWireTDC(wireid.Wire, cluster[iHit]->PeakTime(),
-          wireid.Plane, wireid.TPC, globalWire, globalTime, globalPlane);
-      }
-      else throw art::Exception(art::errors::UnimplementedFeature)
-        << "Geometry " << fGeometry->DetectorName() << " not implemented "
-        << "in CreateSparseMap." << std::endl;
+    for (unsigned int view = 0; view < 3; ++view) map.Reserve(view, nPixels[view]);
+
+    for(size_t i = 0; i < hits.size(); ++i) {
 
-      std::vector<float> coordinates = { (float)globalWire, (float)globalTime, (float)wireid.TPC };
+      art::Ptr<recob::Hit>& hit = cluster[hits[i]];
+      std::vector<float> coordinates = { (float)wires[i], (float)times[i], (float)hit->WireID().TPC };
 
       if (usePixelTruth) {
         // Get true information for this hit
         std::vector<int> pdgs, tracks;
         std::vector<float> energy;
         std::vector<std::string> process;
-        GetHitTruth(clockData, cluster[iHit], pdgs, tracks, energy, process);
-        map.AddHit(globalPlane, coordinates, {cluster[iHit]->Integral()}, pdgs, tracks, energy, process); 
+        GetHitTruth(truth, hit, pdgs, tracks, energy, process);
+        map.AddHit(planes[i], std::move(coordinates), {hit->Integral()},
+          std::move(pdgs), std::move(tracks), std::move(energy), std::move(process)); 
       } // if PixelTuth 
 
       else {
-        map.AddHit(0, coordinates, {cluster[iHit]->Integral()});
+        map.AddHit(0, std::move(coordinates), {hit->Integral()});
       }
-    } // for iHit
+    } // for i
 
     return map;
 
@@ -694,8 +487,14 @@ namespace cvn
     // 3D coordinates (x,y,z) and a single 3D view
     SparsePixelMap map(3, 1, true);
 
-    art::ServiceHandle<cheat::BackTrackerService> bt;
-    art::ServiceHandle<cheat::ParticleInventoryService> pi;
+    // Hits are shared between spacepoints, backtrack each of them only once
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(hit);
+
+    // Each hit adds one pixel
+    size_t nPixels = 0;
+    for (const std::vector<art::Ptr<recob::Hit>>& spHits : hit) nPixels += spHits.size();
+    map.Reserve(0, nPixels);
 
     for (size_t iSP = 0; iSP < sp.size(); ++iSP) { // Loop over spacepoints
 
@@ -710,7 +509,7 @@ namespace cvn
 
       for (size_t iH = 0; iH < hit[iSP].size(); ++iH) { // Loop over this spacepoint's hits
         features[hit[iSP][iH]->View()] += hit[iSP][iH]->Integral(); // Add hit integral to corresponding view's features
-        GetHitTruth(clockData, hit[iSP][iH], pdgs, tracks, energy, process);
+        GetHitTruth(truth, hit[iSP][iH], pdgs, tracks, energy, process);
         map.AddHit(0, coordinates, features, pdgs, tracks, energy, process); 
       } // for hit iH
     } // for spacepoint iSP
@@ -719,4 +518,99 @@ namespace cvn
 
   } // function PixelMapProducer::CreateSparseMap
 
+  SparsePixelMap PixelMapProducer::CreateVoxelMap3D(
+    detinfo::DetectorClocksData const& clockData,
+    std::vector<art::Ptr<recob::SpacePoint>>& sp,
+    std::vector<std::vector<art::Ptr<recob::Hit>>>& hit,
+    float voxelSize) {
+
+    if (!(voxelSize > 0.))
+      throw art::Exception(art::errors::Configuration)
+        << "CVN voxel maps need a positive voxel size, not " << voxelSize << std::endl;
+
+    struct Voxel {
+      std::array<int, 3> index;
+      std::vector<art::Ptr<recob::Hit>> hits;
+    };
+    std::vector<Voxel> voxels;
+    voxels.reserve(sp.size());
+
+    // Open addressing table of voxel positions, at most half full since there
+    // are never more voxels than spacepoints, so the memory is bounded by
+    // the number of spacepoints whatever the extent of the event
+    size_t capacity = 1;
+    while (capacity < 2 * sp.size()) capacity <<= 1;
+    std::vector<int> table(capacity, -1);
+    const size_t mask = capacity - 1;
+
+    for (size_t iSP = 0; iSP < sp.size(); ++iSP) {
+      const double *pos = sp[iSP]->XYZ();
+      std::array<int, 3> index;
+      for (size_t p = 0; p < 3; ++p) index[p] = std::floor(pos[p] / voxelSize);
+
+      uint64_t key = 0;
+      for (int i : index) key = (key ^ static_cast<uint32_t>(i)) * 0x9E3779B97F4A7C15ull;
+      size_t slot = (key >> 32) & mask;
+      while (table[slot] >= 0 && voxels[table[slot]].index != index) slot = (slot + 1) & mask;
+      if (table[slot] < 0) {
+        table[slot] = voxels.size();
+        voxels.push_back({index, {}});
+      }
+
+      // Spacepoints of the same voxel share hits, keep each hit once
+      std::vector<art::Ptr<recob::Hit>>& voxelHits = voxels[table[slot]].hits;
+      for (const art::Ptr<recob::Hit>& h : hit[iSP])
+        if (std::find(voxelHits.begin(), voxelHits.end(), h) == voxelHits.end())
+          voxelHits.push_back(h);
+    } // for spacepoint iSP
+
+    std::sort(voxels.begin(), voxels.end(),
+      [](const Voxel& a, const Voxel& b) { return a.index < b.index; });
+
+    // 3D coordinates (x,y,z) and a single 3D view
+    SparsePixelMap map(3, 1, !fRecoOnly);
+    map.Reserve(0, voxels.size());
+
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    if (!fRecoOnly) truth.Fill(hit);
+
+    for (Voxel& voxel : voxels) {
+      std::vector<float> coordinates(voxel.index.begin(), voxel.index.end());
+      std::vector<float> features(3, 0.); // charge on each plane
+      for (const art::Ptr<recob::Hit>& h : voxel.hits) features[h->View()] += h->Integral();
+
+      if (fRecoOnly) {
+        map.AddHit(0, std::move(coordinates), std::move(features));
+        continue;
+      }
+
+      // Deposits of the same particle in several hits add up
+      std::vector<int> pdgs, tracks;
+      std::vector<float> energy;
+      std::vector<std::string> process;
+      for (art::Ptr<recob::Hit>& h : voxel.hits) {
+        std::vector<int> hitPdgs, hitTracks;
+        std::vector<float> hitEnergy;
+        std::vector<std::string> hitProcess;
+        GetHitTruth(truth, h, hitPdgs, hitTracks, hitEnergy, hitProcess);
+        for (size_t i = 0; i < hitTracks.size(); ++i) {
+          auto it = std::find(tracks.begin(), tracks.end(), hitTracks[i]);
+          if (it != tracks.end()) {
+            energy[it - tracks.begin()] += hitEnergy[i];
+            continue;
+          }
+          pdgs.push_back(hitPdgs[i]);
+          tracks.push_back(hitTracks[i]);
+          energy.push_back(hitEnergy[i]);
+          process.push_back(std::move(hitProcess[i]));
+        }
+      } // for hit
+      map.AddHit(0, std::move(coordinates), std::move(features),
+        std::move(pdgs), std::move(tracks), std::move(energy), std::move(process));
+    } // for voxel
+
+    return map;
+
+  } // function PixelMapProducer::CreateVoxelMap3D
+
 } // namespace cvn
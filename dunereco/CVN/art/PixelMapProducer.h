@@ -17,6 +17,10 @@
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/SparsePixelMap.h"
 #include "dunereco/CVN/func/Boundary.h"
+#include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/GlobalHitCoordinates.h"
+#include "dunereco/CVN/art/GlobalWireMapper.h"
+#include "dunereco/AnaUtils/DUNEAnaHitTruthCache.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
 
@@ -27,14 +31,32 @@
 namespace cvn
 {
   /// Producer algorithm for PixelMap, input to CVN neural net
+  ///
+  /// Once configured, CreateMap can be called from several threads at once
   class PixelMapProducer
   {
   public:
+
+    /// Detector geometries and global wire conversions of the shared mapper
+    typedef GlobalWireMapper::DetectorType DetectorType;
+    typedef GlobalWireMapper::WireMapping WireMapping;
+
     PixelMapProducer(unsigned int nWire, unsigned int nTdc, double tRes);
     PixelMapProducer();
 
     void SetUnwrapped(unsigned short unwrap){fUnwrapped = unwrap;};
     void SetProtoDUNE(){fProtoDUNE = true;};
+    /// Share the global wire tables through the geometry cache files of a
+    /// directory, empty for none
+    void SetGeometryCache(const std::string& directory){fMapper.SetCacheDirectory(directory);};
+    /// Make pixel maps without the purity and label vectors
+    void SetRecoOnly(bool recoOnly){fRecoOnly = recoOnly;};
+    /// Make the dense pixel maps as a pyramid: the summed charge of each wire
+    /// of the full map locates the nWires wires CVNImageUtils would select
+    /// for an image of that width, with the given view reversal, and only
+    /// those wires are mapped at full resolution. The time window is kept
+    /// whole. 0 maps all wires
+    void SetRegionOfInterest(unsigned int nWires, const std::vector<bool>& reverseViews);
 
     /// Get boundaries for pixel map representation of cluster
     Boundary DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -59,6 +81,7 @@ namespace cvn
     unsigned int NWire() const {return fNWire;};
     unsigned int NTdc() const {return fNTdc;};
     double TRes() const {return fTRes;};
+    DetectorType Detector() const {return fMapper.Detector();};
 
     PixelMap CreateMap(detinfo::DetectorPropertiesData const& detProp,
                        const std::vector< art::Ptr< recob::Hit > >& slice);
@@ -69,8 +92,18 @@ namespace cvn
                                     const std::vector< const recob::Hit* >& cluster,
                                     const Boundary& bound);
 
+    /// Global coordinates of all hits of a collection, with the mapping of
+    /// the dense pixel maps, to be shared by the makers run on these hits
+    GlobalHitCoordinates CreateGlobalHitCoordinates(detinfo::DetectorPropertiesData const& detProp,
+                                                    const std::vector< art::Ptr< recob::Hit > >& hits);
+    /// Pixel map of hits whose global coordinates are already known. The
+    /// coordinates must be of the collection of the hits, made with the
+    /// same unwrapping as this producer
+    PixelMap CreateMap(const std::vector< art::Ptr< recob::Hit > >& slice,
+                       const GlobalHitCoordinates& coordinates);
+
     /// Create sparse pixel map for SCN applications
-    void GetHitTruth(detinfo::DetectorClocksData const& clockData,
+    void GetHitTruth(dune_ana::DUNEAnaHitTruthCache& truth,
                      art::Ptr<recob::Hit>& hit, std::vector<int>& pdgs, std::vector<int>& tracks,
       std::vector<float>& energies, std::vector<std::string>& processes);
     SparsePixelMap CreateSparseMap2D(detinfo::DetectorClocksData const& clockData,
@@ -78,6 +111,14 @@ namespace cvn
                                      std::vector< art::Ptr< recob::Hit> >& cluster, bool usePixelTruth=false);
     SparsePixelMap CreateSparseMap3D(detinfo::DetectorClocksData const& clockData,
                                      std::vector< art::Ptr< recob::SpacePoint> >& sp, std::vector<std::vector<art::Ptr<recob::Hit>>>& hit);
+    /// Sparse 3D map of spacepoints merged into cubic voxels of side
+    /// voxelSize (cm). Each voxel counts the charge and truth of every hit
+    /// of its spacepoints once, and the coordinates are the integer voxel
+    /// indices in (x, y, z) order, so the pixels come out sorted
+    SparsePixelMap CreateVoxelMap3D(detinfo::DetectorClocksData const& clockData,
+                                    std::vector< art::Ptr< recob::SpacePoint> >& sp,
+                                    std::vector<std::vector<art::Ptr<recob::Hit>>>& hit,
+                                    float voxelSize);
 
   private:
     unsigned int      fNWire;  ///< Number of wires, length for pixel maps
@@ -85,16 +126,33 @@ namespace cvn
     double            fTRes;   ///< Timing resolution for pixel map
     unsigned short    fUnwrapped; ///< Use unwrapped pixel maps?
     bool              fProtoDUNE; ///< Do we want to use this for particle extraction from protoDUNE?
-
-    geo::GeometryCore const* fGeometry;
-    std::vector<double> fVDPlane0;
-    std::vector<double> fVDPlane1;
-    double fSpacing0, fSpacing1;
-    // std::vector<int> fPlane0GapWires;
-    // std::vector<int> fPlane1GapWires;
-
-    double _getIntercept(geo::WireID wireid) const;
-    void _cacheIntercepts();
+    bool              fRecoOnly;  ///< Leave out the pixel truth
+    unsigned int      fROIWires;  ///< Wires of the region of interest, 0 for the full map
+    std::vector<bool> fROIReverse; ///< View reversal of the region selection
+    CVNImageUtils     fROIUtils;  ///< Region selection of the images
+
+    GlobalWireMapper  fMapper;    ///< Global wire conversions and their lookup tables
+
+    /// Mapping used for the dense pixel maps, sparse maps use the detector directly
+    WireMapping _denseMapping() const;
+    /// Global coordinates and charge of the hits kept by the dense mapping
+    void _globalHits(detinfo::DetectorPropertiesData const& detProp,
+                     const std::vector< const recob::Hit* >& cluster,
+                     std::vector<unsigned int>& wires, std::vector<unsigned int>& planes,
+                     std::vector<double>& tdcs, std::vector<double>& pes);
+    /// Boundary of hits given in global coordinates
+    Boundary _boundary(const std::vector<unsigned int>& wires, const std::vector<unsigned int>& planes,
+                       const std::vector<double>& tdcs) const;
+    /// Empty the hit coordinate vectors for a cluster of nHits hits, keeping their storage
+    void _clearHits(size_t nHits, std::vector<unsigned int>& wires, std::vector<unsigned int>& planes,
+                    std::vector<double>& tdcs, std::vector<double>& pes) const;
+    /// First wire of the region of interest of each view of a full map
+    void _regionOfInterest(const std::vector<unsigned int>& wires, const std::vector<unsigned int>& planes,
+                           const std::vector<double>& tdcs, const std::vector<double>& pes,
+                           const Boundary& bound, int firstWire[3]) const;
+    /// Pixel map of hits given in global coordinates
+    PixelMap _fillMap(const std::vector<unsigned int>& wires, const std::vector<unsigned int>& planes,
+                      const std::vector<double>& tdcs, const std::vector<double>& pes);
   };
 
 }
@@ -17,6 +17,7 @@
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/SparsePixelMap.h"
 #include "dunereco/CVN/func/Boundary.h"
+#include "dunereco/CVN/art/GlobalWireMapper.h"
 #include "lardataobj/Simulation/SimChannel.h"
 
 #include "larcorealg/Geometry/GeometryCore.h"
@@ -34,6 +35,9 @@ namespace cvn
 
     void SetUnwrapped(unsigned short unwrap){fUnwrapped = unwrap;};
     void SetProtoDUNE(){fProtoDUNE = true;};
+    /// Share the global wire tables through the geometry cache files of a
+    /// directory, empty for none
+    void SetGeometryCache(const std::string& directory){fMapper.SetCacheDirectory(directory);};
 
     /// Get boundaries for pixel map representation of cluster
     Boundary DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -81,15 +85,7 @@ namespace cvn
 
     unsigned int fTotHits;  ///<How many ROIs above threshold?
 
-    geo::GeometryCore const* fGeometry;
-    std::vector<double> fVDPlane0;
-    std::vector<double> fVDPlane1;
-    double fSpacing0, fSpacing1;
-    // std::vector<int> fPlane0GapWires;
-    // std::vector<int> fPlane1GapWires;
-
-    double _getIntercept(geo::WireID wireid) const;
-    void _cacheIntercepts();
+    GlobalWireMapper fMapper; ///< Global wire conversions and their lookup tables
   };
 
 }
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    SparseTorchNetHandler.cxx
+/// \brief   SparseTorchNetHandler for CVN, runs a sparse convolution
+///          network exported to TorchScript on SparsePixelMaps
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include "cetlib/getenv.h"
+
+#include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/CVN/art/SparseTorchNetHandler.h"
+
+#include "dunereco/TFRuntime/TFBatching.h"
+#include "dunereco/Profiling/ProfScope.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+namespace cvn
+{
+
+  SparseTorchNetHandler::SparseTorchNetHandler(const fhicl::ParameterSet& pset):
+    fLibPath(cet::getenv(pset.get<std::string>("LibPath", ""), std::nothrow)),
+    fTorchModel(fLibPath+"/"+pset.get<std::string>("TorchModel")),
+    fDim(pset.get<unsigned int>("Dim", 2)),
+    fViews(pset.get<unsigned int>("Views", 3)),
+    fNFeatures(pset.get<unsigned int>("NFeatures", 1)),
+    fBatchIndexLast(pset.get<bool>("BatchIndexLast", false)),
+    fMaxBatchSize(pset.get<unsigned int>("MaxBatchSize", 0))
+  {
+    torchrt::ModuleOptions options;
+    options.device = pset.get<std::string>("Device", options.device);
+    const torchrt::ThreadConfig threads{pset.get<int>("IntraOpThreads", 1), pset.get<int>("InterOpThreads", 1),
+                                        dune::numa::ResolveNode(dune::numa::PlacementFromPSet(pset))};
+
+    mf::LogInfo("SparseTorchNetHandler") << "Loading network: " << fTorchModel << std::endl;
+    fModule = torchrt::ModuleRegistry::Instance().Get(fTorchModel, options, threads);
+    if (!fModule){
+      throw art::Exception(art::errors::Configuration) << "TorchScript model not found or incorrect: " << fTorchModel;
+    }
+  }
+
+  std::vector<torch::jit::IValue> SparseTorchNetHandler::BuildInputs(const std::vector<const SparsePixelMap*>& pms,
+                                                                     size_t first, size_t last) const
+  {
+    const int64_t columns = fDim + 1;
+    const int64_t batchColumn = fBatchIndexLast ? fDim : 0;
+    const int64_t coordOffset = fBatchIndexLast ? 0 : 1;
+
+    std::vector<torch::jit::IValue> inputs;
+    for (unsigned int v = 0; v < fViews; ++v)
+    {
+      int64_t nPixels = 0;
+      for (size_t s = first; s < last; ++s) nPixels += pms[s]->GetNPixels(v);
+
+      at::Tensor coords = torch::empty({nPixels, columns}, torch::kInt64);
+      at::Tensor feats = torch::empty({nPixels, (int64_t)fNFeatures}, torch::kFloat);
+      int64_t* coordData = coords.data_ptr<int64_t>();
+      float* featData = feats.data_ptr<float>();
+
+      for (size_t s = first; s < last; ++s)
+      {
+        const std::vector<std::vector<float>>& pixelCoords = pms[s]->GetCoordinates(v);
+        const std::vector<std::vector<float>>& pixelFeats = pms[s]->GetFeatures(v);
+        for (size_t p = 0; p < pixelCoords.size(); ++p)
+        {
+          if (pixelFeats[p].size() != fNFeatures){
+            throw art::Exception(art::errors::Configuration) << "SparseTorchNetHandler: the network takes "
+              << fNFeatures << " features per pixel, the map has " << pixelFeats[p].size();
+          }
+          coordData[batchColumn] = s - first;
+          for (unsigned int d = 0; d < fDim; ++d)
+            coordData[coordOffset + d] = std::lround(pixelCoords[p][d]);
+          std::copy(pixelFeats[p].begin(), pixelFeats[p].end(), featData);
+          coordData += columns;
+          featData += fNFeatures;
+        }
+      }
+
+      // Filled on the CPU, then moved to the device and precision of the module
+      inputs.emplace_back(coords.to(fModule->Device()));
+      inputs.emplace_back(feats.to(fModule->Device(), fModule->Options().dtype));
+    }
+    return inputs;
+  }
+
+  std::vector< std::vector<float> > SparseTorchNetHandler::Predict(const SparsePixelMap& pm)
+  {
+    return PredictBatch({&pm}).front();
+  }
+
+  std::vector< std::vector< std::vector<float> > > SparseTorchNetHandler::PredictBatch(const std::vector<const SparsePixelMap*>& pms)
+  {
+    DUNE_PROF_SCOPE("cvn::SparseTorchNetHandler::Predict");
+    DUNE_PROF_COUNT("cvn::SparseTorchNetHandler::Predict maps", pms.size());
+    std::vector< std::vector< std::vector< float > > > allResults;
+    allResults.reserve(pms.size());
+
+    for (const SparsePixelMap* pm : pms){
+      if (pm->GetDim() != fDim || pm->GetViews() != fViews){
+        throw art::Exception(art::errors::Configuration) << "SparseTorchNetHandler: the network takes maps of "
+          << fViews << " views of dimension " << fDim << ", not " << pm->GetViews() << " of dimension " << pm->GetDim();
+      }
+    }
+
+    torch::NoGradGuard noGrad;
+    tf::ForEachBatch(pms.size(), fMaxBatchSize, [&](size_t first, size_t last)
+    {
+      const int64_t samples = last - first;
+      const torch::jit::IValue output = fModule->Forward(BuildInputs(pms, first, last));
+
+      // One tensor per head, each (samples, head size)
+      std::vector<at::Tensor> heads;
+      if (output.isTuple()){
+        for (auto const& element : output.toTuple()->elements())
+          heads.push_back(element.toTensor());
+      }
+      else if (output.isTensorList()){
+        for (at::Tensor head : output.toTensorVector())
+          heads.push_back(head);
+      }
+      else {
+        heads.push_back(output.toTensor());
+      }
+
+      for (at::Tensor& head : heads){
+        head = head.to(torch::kCPU, torch::kFloat).contiguous();
+        if (head.dim() == 0 || head.size(0) != samples){
+          throw art::Exception(art::errors::Unknown) << "SparseTorchNetHandler: network output is not batched over the "
+            << samples << " maps";
+        }
+      }
+
+      for (int64_t s = 0; s < samples; ++s)
+      {
+        std::vector< std::vector<float> > result;
+        for (auto const& head : heads)
+        {
+          const int64_t headSize = head.numel() / samples;
+          const float* values = head.data_ptr<float>() + s * headSize;
+          result.emplace_back(values, values + headSize);
+        }
+        allResults.push_back(std::move(result));
+      }
+    });
+
+    return allResults;
+  }
+
+}
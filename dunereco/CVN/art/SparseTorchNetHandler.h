@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    SparseTorchNetHandler.h
+/// \brief   SparseTorchNetHandler for CVN, runs a sparse convolution
+///          network exported to TorchScript on SparsePixelMaps
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_SPARSETORCHNETHANDLER_H
+#define CVN_SPARSETORCHNETHANDLER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <torch/script.h>
+
+#include "dunereco/CVN/func/SparsePixelMap.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "dunereco/TorchRuntime/TorchModuleRegistry.h"
+
+namespace cvn
+{
+
+  /// Runs a submanifold sparse convolution CVN (SparseConvNet or
+  /// MinkowskiEngine, exported to TorchScript) on the active pixels of
+  /// SparsePixelMaps, so the cost follows the number of hit pixels rather
+  /// than the dense image size. The module takes two tensors per view, in
+  /// view order: the integer coordinates of the pixels, (pixels, 1 + dim)
+  /// with the index of the map in the batch as the first column (the last
+  /// with BatchIndexLast, as SparseConvNet wants), and their features,
+  /// (pixels, features). It returns one tensor per head, (maps, head size),
+  /// as a tuple or a list, or a single tensor for a single head
+  class SparseTorchNetHandler
+  {
+  public:
+
+    /// Constructor which takes a pset with TorchModel and the map fields
+    SparseTorchNetHandler(const fhicl::ParameterSet& pset);
+
+    /// Return prediction arrays for SparsePixelMap
+    std::vector< std::vector<float> > Predict(const SparsePixelMap& pm);
+
+    /// Return prediction arrays for each SparsePixelMap, packing the maps
+    /// into batches of at most fMaxBatchSize maps per network call
+    std::vector< std::vector< std::vector<float> > > PredictBatch(const std::vector<const SparsePixelMap*>& pms);
+
+  private:
+
+    /// Coordinate and feature tensors of the maps [first, last)
+    std::vector<torch::jit::IValue> BuildInputs(const std::vector<const SparsePixelMap*>& pms, size_t first, size_t last) const;
+
+    std::string  fLibPath;  ///< Library path (typically dune_pardata...)
+    std::string  fTorchModel;  ///< location of the TorchScript file in the above path
+    unsigned int fDim;       ///< Coordinates per pixel of the maps
+    unsigned int fViews;     ///< Views of the maps
+    unsigned int fNFeatures; ///< Features per pixel the network takes
+    bool         fBatchIndexLast; ///< Batch index after the coordinates rather than before
+    unsigned int fMaxBatchSize; ///< Maximum number of maps per network call (0 = no limit)
+    std::shared_ptr<torchrt::SharedModule> fModule; ///< TorchScript module, shared by the job
+
+  };
+
+}
+
+#endif  // CVN_SPARSETORCHNETHANDLER_H
@@ -6,6 +6,8 @@
 ///          Saul Alonso Monsalve - saul.alonso.monsalve@cern.ch
 ////////////////////////////////////////////////////////////////////////
 
+#include  <algorithm>
+#include  <chrono>
 #include  <iostream>
 #include  <string>
 #include "cetlib/getenv.h"
@@ -15,6 +17,18 @@
 
 #include "dunereco/CVN/art/TFNetHandler.h"
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/CompactResult.h"
+#include "dunereco/CVN/func/Result.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+
+#include "dunereco/TFRuntime/TFBatching.h"
+#include "dunereco/Profiling/ProfScope.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+#ifdef DUNERECO_WITH_TRITON
+#include "dunereco/TritonRuntime/TritonRemoteModel.h"
+#endif
 
 namespace cvn
 {
@@ -27,26 +41,134 @@ namespace cvn
     fUseLogChargeScale(pset.get<bool>("ChargeLogScale")),
     fImageWires(pset.get<unsigned int>("NImageWires")),
     fImageTDCs(pset.get<unsigned int>("NImageTDCs")),
-    fReverseViews(pset.get<std::vector<bool> >("ReverseViews"))
+    fReverseViews(pset.get<std::vector<bool> >("ReverseViews")),
+    fMaxBatchSize(pset.get<unsigned int>("MaxBatchSize", 0)),
+    // Saved model bundles keep the Tensorflow thread defaults unless configured
+    fThreads{pset.get<int>("InterOpThreads", fUseBundle ? 0 : 1),
+             pset.get<int>("IntraOpThreads", fUseBundle ? 0 : 1),
+             pset.get<bool>("UseGlobalThreadPool", false),
+             dune::numa::ResolveNode(dune::numa::PlacementFromPSet(pset))},
+    fNInputs(pset.get<int>("NInputs")),
+    fNOutputs(pset.get<int>("NOutputs")),
+    fLazyLoad(pset.get<bool>("LazyLoad", true)),
+    fRemoteBatchSize(fMaxBatchSize),
+    fRemoteFallback(true),
+    fCascadeOutputs(pset.get<std::vector<size_t> >("CascadeOutputs", {})),
+    fCascadeGateOutput(pset.get<size_t>("CascadeGateOutput", TFMultioutputs::flavour)),
+    fCascadeGateClasses(pset.get<std::vector<size_t> >("CascadeGateClasses", {})),
+    fCascadeThreshold(pset.get<float>("CascadeThreshold", 0.))
   {
+    // The outputs that are not run are filled in the standard multi-output
+    // layout, and only the graph can fetch a subset of its outputs
+    if (!fCascadeOutputs.empty()){
+        if (fUseBundle || fNOutputs != (int)CompactResult::kNHeads){
+            throw art::Exception(art::errors::Configuration)
+              << "TFNetHandler: CascadeOutputs needs a graph with the " << CompactResult::kNHeads << " standard outputs";
+        }
+        for (size_t o : fCascadeOutputs){
+            if (o >= CompactResult::kNHeads){
+                throw art::Exception(art::errors::Configuration) << "TFNetHandler: no output " << o << " for CascadeOutputs";
+            }
+        }
+        if (std::find(fCascadeOutputs.begin(), fCascadeOutputs.end(), fCascadeGateOutput) == fCascadeOutputs.end()){
+            throw art::Exception(art::errors::Configuration)
+              << "TFNetHandler: CascadeGateOutput " << fCascadeGateOutput << " must be one of the CascadeOutputs";
+        }
+        const size_t gateSize = CompactResult::kHeadOffset[fCascadeGateOutput + 1] - CompactResult::kHeadOffset[fCascadeGateOutput];
+        for (size_t c : fCascadeGateClasses){
+            if (c >= gateSize){
+                throw art::Exception(art::errors::Configuration)
+                  << "TFNetHandler: output " << fCascadeGateOutput << " has no class " << c << " for CascadeGateClasses";
+            }
+        }
+    }
 
-    // Construct the TF Graph object. The empty vector {} is used since the protobuf
-    // file gives the names of the output layer nodes
-    if (!fUseBundle){ 
-        mf::LogInfo("TFNetHandler") << "Loading network: " << fTFProtoBuf << std::endl;
-        fTFGraph = tf::Graph::create(fTFProtoBuf.c_str(),{},pset.get<int>("NInputs"),pset.get<int>("NOutputs"));
-        if (!fTFGraph){
-            art::Exception(art::errors::Unknown) << "Tensorflow model not found or incorrect";
+    const std::string device = pset.get<std::string>("Device", "default");
+    if (!tf::ParsePlacement(device, fDevice.placement)){
+        throw art::Exception(art::errors::Configuration)
+          << "TFNetHandler: Device must be default, cpu or gpu, not " << device;
+    }
+    fDevice.visibleGPUs = pset.get<std::string>("VisibleGPUs", "");
+    fDevice.gpuMemoryFraction = pset.get<double>("GPUMemoryFraction", 0.);
+
+    // The cascade settings change the outputs of the same images, so they are part of the key
+    const std::string cacheFile = pset.get<std::string>("OutputCache", "");
+    if (!cacheFile.empty()){
+        std::string tag = "TFNetHandler";
+        if (!fCascadeOutputs.empty()){
+            tag += " cascade";
+            for (size_t o : fCascadeOutputs) tag += " " + std::to_string(o);
+            tag += " gate " + std::to_string(fCascadeGateOutput);
+            for (size_t c : fCascadeGateClasses) tag += " " + std::to_string(c);
+            tag += " threshold " + std::to_string(fCascadeThreshold);
         }
+        fOutputCache = tf::OutputCache::Open(cacheFile, fUseBundle ? fTFBundleFile : fTFProtoBuf, tag);
     }
-    
-    else {
-	fTFBundle = Bundle::create(fTFBundleFile.c_str(),{},pset.get<int>("NInputs"),pset.get<int>("NOutputs")); 
-        if (!fTFBundle){
-            art::Exception(art::errors::Unknown) << "Tensorflow model not found or incorrect";
+
+    // The network is loaded on first use, so jobs that see no pixel maps, or
+    // whose requests all go to an inference server, never pay for it
+    if (!fLazyLoad) LoadNetwork();
+
+    // Optional inference server, the local session is kept as the fallback
+    if (pset.has_key("TritonServer")){
+        const fhicl::ParameterSet server = pset.get<fhicl::ParameterSet>("TritonServer");
+#ifdef DUNERECO_WITH_TRITON
+        fRemoteInputs = server.get<std::vector<std::string> >("InputNames");
+        fRemoteOutputs = server.get<std::vector<std::string> >("OutputNames");
+        fRemoteBatchSize = server.get<unsigned int>("MaxBatchSize", fMaxBatchSize);
+        fRemoteFallback = server.get<bool>("Fallback", true);
+        const size_t nInputs = (!fUseBundle && fNInputs > 1) ? 3 : 1;
+        if (fRemoteInputs.size() != nInputs){
+            throw art::Exception(art::errors::Configuration)
+              << "TFNetHandler: TritonServer.InputNames needs " << nInputs << " names, not " << fRemoteInputs.size();
+        }
+        const tritonrt::RemoteConfig config = tritonrt::ReadRemoteConfig(server);
+        fRemote = tritonrt::RemoteModel::Create(config);
+        if (!fRemote){
+            if (!fRemoteFallback){
+                throw art::Exception(art::errors::Configuration)
+                  << "TFNetHandler: model " << config.modelName << " not available on " << config.url;
+            }
+            mf::LogWarning("TFNetHandler") << "Inference server not available, running locally" << std::endl;
         }
+#else
+        throw art::Exception(art::errors::Configuration)
+          << "TFNetHandler: TritonServer is set but dunereco was built without the Triton client";
+#endif
+    }
+
+    // Optional tuning of the batch size, capped by the configured one
+    if (pset.has_key("BatchTuning")){
+        const fhicl::ParameterSet tuning = pset.get<fhicl::ParameterSet>("BatchTuning");
+        fBatchTuner = std::make_unique<tf::BatchTuner>("TFNetHandler " + (fUseBundle ? fTFBundleFile : fTFProtoBuf),
+                                                       tuning.get<std::vector<size_t> >("Candidates", {}),
+                                                       fRemote ? fRemoteBatchSize : fMaxBatchSize,
+                                                       tuning.get<unsigned int>("TuneCalls", 20),
+                                                       tuning.get<double>("MaxLatency", 0.));
+    }
+  }
+
+  TFNetHandler::~TFNetHandler() = default;
+
+  void TFNetHandler::LoadNetwork()
+  {
+    std::call_once(fLoadOnce, [this]()
+    {
+      // Construct the TF Graph object. The empty vector {} is used since the protobuf
+      // file gives the names of the output layer nodes
+      if (!fUseBundle){
+          mf::LogInfo("TFNetHandler") << "Loading network: " << fTFProtoBuf << std::endl;
+          fTFGraph = tf::Graph::create(fTFProtoBuf.c_str(),{},fNInputs,fNOutputs,fThreads,fDevice);
+      }
+      else {
+          mf::LogInfo("TFNetHandler") << "Loading bundle: " << fTFBundleFile << std::endl;
+          fTFBundle = Bundle::create(fTFBundleFile.c_str(),{},fNInputs,fNOutputs,fThreads,fDevice);
+      }
+    });
+    if (!fTFGraph && !fTFBundle){
+        throw art::Exception(art::errors::Configuration) << "TFNetHandler: Tensorflow model not found or incorrect: "
+          << (fUseBundle ? fTFBundleFile : fTFProtoBuf);
     }
-   
   }
 
   // Check the network outputs
@@ -77,56 +199,263 @@ namespace cvn
     return;
   }
 
-  std::vector< std::vector<float> > TFNetHandler::Predict(const PixelMap& pm)
+  // Gather the given images of a batch into new input tensors
+  std::vector< tensorflow::Tensor > gatherSamples(const std::vector< tensorflow::Tensor >& inputs, const std::vector<size_t>& samples)
+  {
+    if ((long long int)samples.size() == inputs[0].dim_size(0)) return inputs;
+
+    std::vector< tensorflow::Tensor > gathered;
+    for (auto const & input : inputs){
+        std::vector< tensorflow::Tensor > slices;
+        for (size_t s : samples)
+            slices.push_back(input.Slice(s, s + 1));
+        tensorflow::Tensor gatheredInput;
+        if (!tensorflow::tensor::Concat(slices, &gatheredInput).ok()){
+            throw art::Exception(art::errors::Unknown) << "TFNetHandler: could not gather " << samples.size() << " images of the batch";
+        }
+        gathered.push_back(std::move(gatheredInput));
+    }
+    return gathered;
+  }
+
+  std::vector< tensorflow::Tensor > TFNetHandler::BuildInputTensors(const std::vector<const PixelMap*>& pms, size_t first, size_t last) const
   {
-    ///====
     CVNImageUtils imageUtils(fImageWires,fImageTDCs, 3);
     // Configure the image utility
     imageUtils.SetViewReversal(fReverseViews);
     imageUtils.SetImageSize(fImageWires,fImageTDCs,3);
     imageUtils.SetLogScale(fUseLogChargeScale);
-    imageUtils.SetPixelMapSize(pm.NWire(), pm.NTdc());
 
-    ImageVectorF thisImage;
-    imageUtils.ConvertPixelMapToImageVectorF(pm,thisImage);
-    std::vector<ImageVectorF> vecForTF;
+    const long long int samples = last - first;
+    const long long int wires = fImageWires;
+    const long long int tdcs = fImageTDCs;
+    const size_t viewSize = fImageWires * fImageTDCs;
+
+    // Multi-input networks take one tensor per view
+    std::vector< tensorflow::Tensor > inputs;
+    const bool splitViews = !fUseBundle && fNInputs > 1;
+    if (splitViews){
+        for (unsigned int v = 0; v < 3; ++v)
+            inputs.emplace_back(tensorflow::DT_FLOAT, tensorflow::TensorShape({ samples, wires, tdcs, 1 }));
+    }
+    else {
+        inputs.emplace_back(tensorflow::DT_FLOAT, tensorflow::TensorShape({ samples, wires, tdcs, 3 }));
+    }
 
-    vecForTF.push_back(thisImage);
-    
-    bool status = false;
-    int counter = 0;
+    for (long long int s = 0; s < samples; ++s)
+    {
+      const PixelMap& pm = *pms[first + s];
+      if (splitViews){
+          std::vector<float*> viewBuffers;
+          for (auto & input : inputs)
+              viewBuffers.push_back(input.flat<float>().data() + s * viewSize);
+          imageUtils.ConvertPixelMapToViewBuffers(pm, viewBuffers);
+      }
+      else {
+          imageUtils.ConvertPixelMapToBuffer(pm, inputs[0].flat<float>().data() + s * viewSize * 3);
+      }
+    }
+
+    return inputs;
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::RunNetwork(const std::vector< tensorflow::Tensor >& inputs)
+  {
+    LoadNetwork();
     std::vector< std::vector< std::vector< float > > > cvnResults; // shape(samples, #outputs, output_size)
+    std::lock_guard<std::mutex> lock(fRunMutex);
     if (fUseBundle){
-        cvnResults = fTFBundle->run(fTFBundleFile.c_str(),vecForTF);
+        cvnResults = fTFBundle->run(inputs[0]);
     }
     else {
-        do{ // do until it gets a correct result
-            // std::cout << "Number of CVN result vectors " << cvnResults.size() << " with " << cvnResults[0].size() << " categories" << std::endl;
-            cvnResults = fTFGraph->run(vecForTF);
-            status = check(cvnResults[0]);
-            //std::cout << "Status: " << status << std::endl;
-            counter++;
-            if(counter==10){
-                std::cout << "Error, CVN never outputing a correct result. Filling result with zeros.";
-                std::cout << std::endl;
-                fillEmpty(cvnResults[0]);
-                break;
-            }
-        }while(status == false);
-    } 
-    std::cout << "Classifier summary: ";
-    std::cout << std::endl;
-    int output_index = 0;
-    for(auto const & output : cvnResults[0])
+        cvnResults = fTFGraph->run(inputs);
+    }
+    if ((long long int)cvnResults.size() != inputs[0].dim_size(0)){
+        throw art::Exception(art::errors::Unknown) << "Tensorflow returned " << cvnResults.size()
+          << " results for " << inputs[0].dim_size(0) << " images";
+    }
+    return cvnResults;
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::RunOutputs(const std::vector< tensorflow::Tensor >& inputs,
+                                                                           const std::vector<size_t>& outputs)
+  {
+    LoadNetwork();
+    std::vector< std::vector< std::vector< float > > > cvnResults; // shape(samples, outputs.size(), output_size)
     {
-      std::cout << "Output " << output_index++ << ": ";
-      for(auto const v : output)
-          std::cout << v << ", ";
-      std::cout << std::endl;
+      std::lock_guard<std::mutex> lock(fRunMutex);
+      cvnResults = fTFGraph->run(inputs, outputs);
+    }
+    if ((long long int)cvnResults.size() != inputs[0].dim_size(0)){
+        throw art::Exception(art::errors::Unknown) << "Tensorflow returned " << cvnResults.size()
+          << " results for " << inputs[0].dim_size(0) << " images";
+    }
+    return cvnResults;
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::RunCascade(const std::vector< tensorflow::Tensor >& inputs)
+  {
+    const size_t samples = inputs[0].dim_size(0);
+
+    // Every output starts as -1, as for a skipped event
+    std::vector< std::vector< std::vector< float > > > cvnResults(samples, Result::Skipped().fOutput);
+
+    std::vector< std::vector< std::vector< float > > > first = RunOutputs(inputs, fCascadeOutputs);
+    std::vector<size_t> passed;
+    for (size_t s = 0; s < samples; ++s){
+        for (size_t o = 0; o < fCascadeOutputs.size(); ++o)
+            cvnResults[s][fCascadeOutputs[o]] = std::move(first[s][o]);
+
+        // No gate classes means the whole output, so every image passes a threshold up to 1
+        const std::vector<float>& gate = cvnResults[s][fCascadeGateOutput];
+        float score = 0.;
+        if (fCascadeGateClasses.empty()){
+            for (float v : gate) score += v;
+        }
+        else {
+            for (size_t c : fCascadeGateClasses) score += gate[c];
+        }
+        if (score >= fCascadeThreshold) passed.push_back(s);
     }
-    std::cout << std::endl;
 
-    return cvnResults[0];
+    std::vector<size_t> rest;
+    for (size_t o = 0; o < CompactResult::kNHeads; ++o){
+        if (std::find(fCascadeOutputs.begin(), fCascadeOutputs.end(), o) == fCascadeOutputs.end())
+            rest.push_back(o);
+    }
+    if (passed.empty() || rest.empty()) return cvnResults;
+
+    // Only the images that passed go through the rest of the graph
+    std::vector< std::vector< std::vector< float > > > second = RunOutputs(gatherSamples(inputs, passed), rest);
+    for (size_t p = 0; p < passed.size(); ++p){
+        for (size_t o = 0; o < rest.size(); ++o)
+            cvnResults[passed[p]][rest[o]] = std::move(second[p][o]);
+    }
+
+    return cvnResults;
+  }
+
+  bool TFNetHandler::RunRemote(const std::vector< tensorflow::Tensor >& inputs,
+                               std::vector< std::vector< std::vector<float> > >& results)
+  {
+#ifdef DUNERECO_WITH_TRITON
+    if (!fRemote || !fRemote->Available()) return false;
+
+    std::vector<tritonrt::Input> remoteInputs;
+    for (size_t i = 0; i < inputs.size(); ++i){
+        std::vector<int64_t> shape;
+        for (int d = 0; d < inputs[i].dims(); ++d)
+            shape.push_back(inputs[i].dim_size(d));
+        remoteInputs.push_back({fRemoteInputs[i], shape, inputs[i].flat<float>().data()});
+    }
+
+    std::vector<tritonrt::Output> remoteOutputs;
+    if (!fRemote->Infer(remoteInputs, fRemoteOutputs, remoteOutputs)) return false;
+
+    std::vector< std::vector< std::vector<float> > > samples = tritonrt::SplitSamples(remoteOutputs);
+    if ((long long int)samples.size() != inputs[0].dim_size(0)){
+        mf::LogWarning("TFNetHandler") << "Inference server returned " << samples.size()
+          << " results for " << inputs[0].dim_size(0) << " images" << std::endl;
+        return false;
+    }
+    results = std::move(samples);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::RunBatch(const std::vector< tensorflow::Tensor >& inputs)
+  {
+    std::vector< std::vector< std::vector< float > > > cvnResults;
+    const bool remote = fCascadeOutputs.empty() && RunRemote(inputs, cvnResults);
+    if (!fCascadeOutputs.empty()){
+        cvnResults = RunCascade(inputs);
+    }
+    else if (!remote){
+        if (fRemote && !fRemoteFallback){
+            throw art::Exception(art::errors::Unknown) << "TFNetHandler: inference server request failed";
+        }
+        cvnResults = RunNetwork(inputs);
+    }
+    if (fUseBundle || remote) return cvnResults;
+
+    for (size_t s = 0; s < cvnResults.size(); ++s)
+    {
+      int counter = 1;
+      while (!check(cvnResults[s])){ // do until it gets a correct result
+          if(counter==10){
+              std::cout << "Error, CVN never outputing a correct result. Filling result with zeros.";
+              std::cout << std::endl;
+              fillEmpty(cvnResults[s]);
+              break;
+          }
+          std::vector< tensorflow::Tensor > single;
+          for (auto const & input : inputs)
+              single.push_back(tensorflow::tensor::DeepCopy(input.Slice(s, s + 1)));
+          cvnResults[s] = RunNetwork(single).front();
+          counter++;
+      }
+    }
+    return cvnResults;
+  }
+
+  std::vector< std::vector<float> > TFNetHandler::Predict(const PixelMap& pm)
+  {
+    return PredictBatch({&pm}).front();
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::PredictBatch(const std::vector<const PixelMap*>& pms)
+  {
+    DUNE_PROF_SCOPE("cvn::TFNetHandler::Predict");
+    DUNE_PROF_COUNT("cvn::TFNetHandler::Predict images", pms.size());
+    std::vector< std::vector< std::vector< float > > > allResults;
+    allResults.reserve(pms.size());
+
+    const size_t batchSize = fBatchTuner ? fBatchTuner->NextBatchSize() : (fRemote ? fRemoteBatchSize : fMaxBatchSize);
+    tf::ForEachBatch(pms.size(), batchSize, [&](size_t first, size_t last)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      std::vector< tensorflow::Tensor > inputs = BuildInputTensors(pms, first, last);
+      std::vector< std::vector< std::vector< float > > > cvnResults;
+      if (fOutputCache){
+          // Only the images not seen before are run, and outputs given up on are not kept
+          cvnResults = fOutputCache->GetOrCompute(fOutputCache->SampleKeys(inputs),
+            [&](const std::vector<size_t>& missed){ return RunBatch(gatherSamples(inputs, missed)); },
+            [](const std::vector< std::vector<float> >& outputs){
+                for (auto const & output : outputs)
+                    for (float v : output)
+                        if (v != -3.0) return true;
+                return false;
+            });
+      }
+      else {
+          cvnResults = RunBatch(inputs);
+      }
+      if (fBatchTuner){
+          const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+          fBatchTuner->Record(batchSize, last - first, elapsed.count());
+      }
+
+      for (size_t s = 0; s < cvnResults.size(); ++s)
+      {
+        std::cout << "Classifier summary: ";
+        std::cout << std::endl;
+        int output_index = 0;
+        for(auto const & output : cvnResults[s])
+        {
+          std::cout << "Output " << output_index++ << ": ";
+          for(auto const v : output)
+              std::cout << v << ", ";
+          std::cout << std::endl;
+        }
+        std::cout << std::endl;
+
+        allResults.push_back(std::move(cvnResults[s]));
+      }
+    });
+
+    return allResults;
   }
 
   /*
@@ -9,12 +9,20 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/InteractionType.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "dunereco/CVN/tf/tf_graph.h"
 #include "dunereco/CVN/tf/tf_bundle.h"
+#include "dunereco/TFRuntime/TFBatchTuner.h"
+#include "dunereco/TFRuntime/TFOutputCache.h"
+
+namespace tritonrt
+{
+  class RemoteModel;
+}
 
 namespace cvn
 {
@@ -26,6 +34,7 @@ namespace cvn
 
     /// Constructor which takes a pset with DeployProto and ModelFile fields
     TFNetHandler(const fhicl::ParameterSet& pset);
+    ~TFNetHandler();
 
     /// Number of outputs in neural net
     int NOutput() const;
@@ -36,11 +45,40 @@ namespace cvn
     /// Return prediction arrays for PixelMap
     std::vector< std::vector<float> > Predict(const PixelMap& pm);
 
+    /// Return prediction arrays for each PixelMap, packing the maps into
+    /// batches of at most fMaxBatchSize images per network call
+    std::vector< std::vector< std::vector<float> > > PredictBatch(const std::vector<const PixelMap*>& pms);
+
     /// Return four element vector with summed numu, nue, nutau and NC elements
     std::vector<float> PredictFlavour(const PixelMap& pm);
 
   private:
 
+    /// Write the PixelMaps [first, last) straight into the network input tensors
+    std::vector< tensorflow::Tensor > BuildInputTensors(const std::vector<const PixelMap*>& pms, size_t first, size_t last) const;
+
+    /// Load the graph or bundle on the first call, throws if it can't be loaded
+    void LoadNetwork();
+
+    /// Run the graph or bundle on a set of input tensors
+    std::vector< std::vector< std::vector<float> > > RunNetwork(const std::vector< tensorflow::Tensor >& inputs);
+
+    /// Run the graph on a set of input tensors, fetching only the given outputs
+    std::vector< std::vector< std::vector<float> > > RunOutputs(const std::vector< tensorflow::Tensor >& inputs,
+                                                                 const std::vector<size_t>& outputs);
+
+    /// Run the cascade outputs for every image, then the others only for the
+    /// images passing the gate. The outputs not run are filled with -1
+    std::vector< std::vector< std::vector<float> > > RunCascade(const std::vector< tensorflow::Tensor >& inputs);
+
+    /// Run one batch of input tensors on the server or the local session,
+    /// retrying the images whose outputs fail the sanity check
+    std::vector< std::vector< std::vector<float> > > RunBatch(const std::vector< tensorflow::Tensor >& inputs);
+
+    /// Send a set of input tensors to the inference server. Returns false,
+    /// with results untouched, if the request failed
+    bool RunRemote(const std::vector< tensorflow::Tensor >& inputs, std::vector< std::vector< std::vector<float> > >& results);
+
     std::string  fLibPath;  ///< Library path (typically dune_pardata...)
     std::string  fTFProtoBuf;  ///< location of the tf .pb file in the above path
     std::string  fTFBundleFile;  /// location of the tf saved model folder
@@ -49,8 +87,27 @@ namespace cvn
     unsigned int fImageWires;  ///< Number of wires for the network to classify
     unsigned int fImageTDCs;   ///< Number of tdcs for the network to classify
     std::vector<bool> fReverseViews; ///< Do we need to reverse any views?
+    unsigned int fMaxBatchSize; ///< Maximum number of images per network call (0 = no limit)
+    tf::ThreadConfig fThreads; ///< Tensorflow session threading
+    tf::DeviceConfig fDevice;  ///< Tensorflow session device placement
     std::unique_ptr<tf::Graph> fTFGraph; ///< Tensorflow graph
     std::unique_ptr<Bundle> fTFBundle; ///< Tensorflow bundle
+    int          fNInputs;  ///< Number of network input tensors
+    int          fNOutputs; ///< Number of network outputs
+    bool         fLazyLoad; ///< Load the network on first use rather than in the constructor
+    std::once_flag fLoadOnce; ///< The network is loaded by a single caller
+    std::mutex   fRunMutex; ///< One network call at a time when the handler is shared between events
+    std::unique_ptr<tritonrt::RemoteModel> fRemote; ///< Inference server client, if one is configured and reachable
+    std::vector<std::string> fRemoteInputs;  ///< Input names of the served model, one per input tensor
+    std::vector<std::string> fRemoteOutputs; ///< Output names of the served model, in the order of the graph outputs
+    unsigned int fRemoteBatchSize; ///< Maximum number of images per request (0 = no limit)
+    bool fRemoteFallback; ///< Run the local session when a request fails, else throw
+    std::vector<size_t> fCascadeOutputs; ///< Outputs run for every image, empty to run all outputs together
+    size_t       fCascadeGateOutput;  ///< Output whose scores gate the other outputs
+    std::vector<size_t> fCascadeGateClasses; ///< Classes of the gate output summed into the gate score
+    float        fCascadeThreshold;   ///< Minimum gate score for the other outputs to be run
+    std::unique_ptr<tf::OutputCache> fOutputCache; ///< Outputs of inputs already seen, if a cache file is configured
+    std::unique_ptr<tf::BatchTuner> fBatchTuner; ///< Picks the batch size during the first calls, if configured
 
   };
 
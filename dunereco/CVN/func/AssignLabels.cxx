@@ -5,6 +5,7 @@
 #include "dunereco/CVN/func/TrainingData.h"
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
+#include "lardataobj/Simulation/SimChannel.h"
 
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
@@ -12,6 +13,9 @@
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace cvn
 {
@@ -162,11 +166,12 @@ namespace cvn
     art::ServiceHandle<cheat::BackTrackerService> backTrack;
     art::ServiceHandle<cheat::ParticleInventoryService> partService;
 
-    // Loop over all of the particles
-//    for(unsigned int p = 0; p < nParticle; ++p){
+    // First select the final state particles of the neutrino and the tracks
+    // whose SimIDEs count towards each of them
+    std::vector<std::pair<int,std::vector<int>>> candidates;
+    std::unordered_map<int,unsigned int> nSimIDEs;
     for(auto const thisPart : partService->MCTruthToParticles_Ps(truth)){
 
-//      const simb::MCParticle& part = truth.GetParticle(p);
       const simb::MCParticle& part = *thisPart;
 
       int pdg = part.PdgCode();
@@ -191,34 +196,49 @@ namespace cvn
         continue;
       }
 
-      // Find how many SimIDEs the track has
-      unsigned int nSimIDE = backTrack->TrackIdToSimIDEs_Ps(part.TrackId()).size();
+      // Only the particles we count can pass the cut
+      if(abs(pdg) != 111 && abs(pdg) != 211 && abs(pdg) != 2112 && abs(pdg) != 2212){
+        continue;
+      }
 
-      // Check if we have more than 100 MeV of kinetic energy
-      // float ke = part.E() - part.Mass();
-      //    if( ke < 0.0){
-      //      continue;
-      //    }
+      std::vector<int> tracks(1, part.TrackId());
 
       // Special case for pi-zeros since it is the decay photons and their pair produced electrons that deposit energy
       if(pdg == 111 || pdg == 2112){
-//        unsigned int nDummyHits = GetNeutralDaughterHitsRecursive(part);
-//        std::cout << "New method of neutral daughters for " << pdg << " = " << nDummyHits << std::endl;
         // Decay photons
         for(int d = 0; d < part.NumberDaughters(); ++d){
-          nSimIDE += backTrack->TrackIdToSimIDEs_Ps(part.Daughter(d)).size();
+          tracks.push_back(part.Daughter(d));
+        }
+      }
+
+      for(const int track : tracks) nSimIDEs.emplace(track, 0);
+      candidates.emplace_back(pdg, std::move(tracks));
+    }
+
+    // Count the SimIDEs of all of the tracks in one pass over the SimChannels,
+    // matching on the absolute track ID as TrackIdToSimIDEs_Ps does
+    if(nTopologyHits > 0 && !candidates.empty()){
+      for(const art::Ptr<sim::SimChannel> &channel : backTrack->SimChannels()){
+        for(const auto &tdcIDEs : channel->TDCIDEMap()){
+          for(const sim::IDE &ide : tdcIDEs.second){
+            auto count = nSimIDEs.find(abs(ide.trackID));
+            if(count != nSimIDEs.end()) ++count->second;
+          }
         }
-//        std::cout << "Old method of neutral daughters for " << pdg << " = " << nSimIDE << std::endl;
       }
+    }
+
+    for(const auto &candidate : candidates){
+
+      unsigned int nSimIDE = 0;
+      for(const int track : candidate.second) nSimIDE += nSimIDEs.at(track);
 
       // Do we pass the number of hits cut?
       if(nSimIDE < nTopologyHits){
         continue;
       }
 
-//      std::cout << "Final state particle " << pdg << " with ke " << ke << " GeV, " << nSimIDE << " true hits and " << part.NumberDaughters() << " daughters" << std::endl;
-
-      switch(abs(pdg)){
+      switch(abs(candidate.first)){
         case 111 : ++nPizero;  break;
         case 211 : ++nPion;    break;
         case 2112: ++nNeutron; break;
@@ -263,6 +283,51 @@ namespace cvn
 
   }
 
+  void AssignLabels::GetTopology(art::Event const& evt, const std::string& topologyLabel,
+                                 const art::Ptr<simb::MCTruth> truth, unsigned int nTopologyHits){
+
+    if(topologyLabel.empty()){
+      GetTopology(truth, nTopologyHits);
+      return;
+    }
+
+    // The stored labels follow the order of the MCTruth collection
+    auto topologyHandle = evt.getValidHandle<std::vector<TopologyLabels>>(topologyLabel);
+    if(truth.key() >= topologyHandle->size()){
+      throw art::Exception(art::errors::ProductNotFound)
+        << "No topology labels from " << topologyLabel << " for MCTruth " << truth.key();
+    }
+
+    const TopologyLabels &topology = topologyHandle->at(truth.key());
+    if(topology.fTopologyHitsCut != nTopologyHits){
+      throw art::Exception(art::errors::Configuration)
+        << "Topology labels from " << topologyLabel << " were made with TopologyHitsCut "
+        << topology.fTopologyHitsCut << ", not " << nTopologyHits;
+    }
+    SetTopology(topology);
+  }
+
+  void AssignLabels::SetTopology(const TopologyLabels& topology){
+    pdgCode = topology.fPDG;
+    tauMode = topology.fTauMode;
+    nProton = topology.fNProton;
+    nPion = topology.fNPion;
+    nPizero = topology.fNPizero;
+    nNeutron = topology.fNNeutron;
+  }
+
+  TopologyLabels AssignLabels::GetTopologyLabels(unsigned int nTopologyHits) const{
+    TopologyLabels topology;
+    topology.fTopologyHitsCut = nTopologyHits;
+    topology.fPDG = pdgCode;
+    topology.fTauMode = tauMode;
+    topology.fNProton = nProton;
+    topology.fNPion = nPion;
+    topology.fNPizero = nPizero;
+    topology.fNNeutron = nNeutron;
+    return topology;
+  }
+
   void AssignLabels::PrintTopology(){
 
     std::cout << "== Topology Information ==" << std::endl;
@@ -7,9 +7,11 @@
 #ifndef CVN_ASSIGNLABELS_H
 #define CVN_ASSIGNLABELS_H
 
+#include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 
 #include "dunereco/CVN/func/InteractionType.h"
+#include "dunereco/CVN/func/TopologyLabels.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
 
@@ -30,6 +32,12 @@ namespace cvn
 
     // Use the topology information
     void GetTopology(const art::Ptr<simb::MCTruth> truth, unsigned int nTopologyHits);
+    // As above, but take the labels stored by CVNTopologyLabels when topologyLabel is set
+    void GetTopology(art::Event const& evt, const std::string& topologyLabel,
+                     const art::Ptr<simb::MCTruth> truth, unsigned int nTopologyHits);
+    // Take the topology information from an earlier GetTopology
+    void SetTopology(const TopologyLabels& topology);
+    TopologyLabels GetTopologyLabels(unsigned int nTopologyHits) const;
     void PrintTopology();
     unsigned short GetNProtons()  { return nProton;  };
     unsigned short GetNPions()    { return nPion;    };
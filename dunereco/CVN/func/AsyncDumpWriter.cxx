@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    AsyncDumpWriter.cxx
+/// \brief   Writes training records to a TTree on a background thread
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/CVN/func/AsyncDumpWriter.h"
+
+namespace cvn
+{
+
+  AsyncDumpWriter::AsyncDumpWriter(const std::string &fileName, const std::string &treeName,
+                                   const DumpLayout &layout, unsigned int queueDepth,
+                                   int compression):
+  fFileName(fileName), fTreeName(treeName), fLayout(layout), fNFloats(0), fNInts(0),
+  fQueueDepth(std::max(queueDepth, 1u)), fCompression(compression), fDone(false), fClosed(false), fTree(nullptr)
+  {
+    for(const DumpBranch &branch : fLayout){
+      if(branch.size == 0 || (branch.type != 'F' && branch.type != 'I'))
+        throw art::Exception(art::errors::Configuration)
+          << "AsyncDumpWriter: branch " << branch.name << " needs a size and type F or I" << std::endl;
+      size_t &n = (branch.type == 'F') ? fNFloats : fNInts;
+      fOffsets.push_back(n);
+      n += branch.size;
+    }
+
+    // The writer thread uses ROOT alongside the event loop
+    ROOT::EnableThreadSafety();
+    fThread = std::thread(&AsyncDumpWriter::Run, this);
+  }
+
+  AsyncDumpWriter::~AsyncDumpWriter()
+  {
+    try{
+      Close();
+    }
+    catch(const std::exception &e){
+      mf::LogError("AsyncDumpWriter") << e.what();
+    }
+  }
+
+  size_t AsyncDumpWriter::Offset(const std::string &name) const
+  {
+    for(size_t b = 0; b < fLayout.size(); ++b){
+      if(fLayout[b].name == name) return fOffsets[b];
+    }
+    throw art::Exception(art::errors::LogicError)
+      << "AsyncDumpWriter: no branch " << name << " in the layout of " << fTreeName << std::endl;
+  }
+
+  DumpRecord AsyncDumpWriter::NewRecord()
+  {
+    DumpRecord record;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if(!fFree.empty()){
+        record = std::move(fFree.back());
+        fFree.pop_back();
+      }
+    }
+    record.floats.assign(fNFloats, 0.f);
+    record.ints.assign(fNInts, 0);
+    return record;
+  }
+
+  void AsyncDumpWriter::Write(DumpRecord &&record)
+  {
+    if(record.floats.size() != fNFloats || record.ints.size() != fNInts)
+      throw art::Exception(art::errors::LogicError)
+        << "AsyncDumpWriter: record does not match the layout of " << fTreeName << std::endl;
+
+    std::unique_lock<std::mutex> lock(fMutex);
+    fDequeued.wait(lock, [this]{ return fQueue.size() < fQueueDepth || !fError.empty(); });
+    CheckError();
+    if(fDone)
+      throw art::Exception(art::errors::LogicError)
+        << "AsyncDumpWriter: Write called after Close" << std::endl;
+
+    fQueue.push_back(std::move(record));
+    fQueued.notify_one();
+  }
+
+  void AsyncDumpWriter::Close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if(fClosed) return;
+      fClosed = true;
+      fDone = true;
+    }
+    fQueued.notify_one();
+    if(fThread.joinable()) fThread.join();
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    CheckError();
+  }
+
+  void AsyncDumpWriter::Run()
+  {
+    try{
+      OpenFile();
+    }
+    catch(const std::exception &e){
+      std::lock_guard<std::mutex> lock(fMutex);
+      fError = e.what();
+      fQueue.clear();
+      fDequeued.notify_all();
+      return;
+    }
+
+    while(true){
+      DumpRecord record;
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fQueued.wait(lock, [this]{ return !fQueue.empty() || fDone; });
+        if(fQueue.empty()) break;
+        record = std::move(fQueue.front());
+        fQueue.pop_front();
+      }
+      fDequeued.notify_one();
+
+      // The branches point into fEntry, so the record is copied rather than swapped in
+      std::copy(record.floats.begin(), record.floats.end(), fEntry.floats.begin());
+      std::copy(record.ints.begin(), record.ints.end(), fEntry.ints.begin());
+      const int bytes = fTree->Fill();
+
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if(bytes < 0){
+          fError = "Unable to fill " + fTreeName + " in " + fFileName;
+          fQueue.clear();
+          fDequeued.notify_all();
+          break;
+        }
+        if(fFree.size() <= fQueueDepth) fFree.push_back(std::move(record));
+      }
+    }
+
+    // Also after a failed Fill, so the entries already filled are kept
+    try{
+      CloseFile();
+    }
+    catch(const std::exception &e){
+      std::lock_guard<std::mutex> lock(fMutex);
+      if(fError.empty()) fError = e.what();
+    }
+  }
+
+  void AsyncDumpWriter::OpenFile()
+  {
+    fFile.reset(TFile::Open(fFileName.c_str(), "RECREATE"));
+    if(!fFile || fFile->IsZombie())
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to open file " << fFileName << "!" << std::endl;
+    if(fCompression >= 0) fFile->SetCompressionSettings(fCompression);
+
+    fFile->cd();
+    fTree = new TTree(fTreeName.c_str(), "Training records");
+    fTree->SetDirectory(fFile.get());
+
+    fEntry.floats.assign(fNFloats, 0.f);
+    fEntry.ints.assign(fNInts, 0);
+    for(size_t b = 0; b < fLayout.size(); ++b){
+      const DumpBranch &branch = fLayout[b];
+      std::string leaves = branch.name;
+      if(branch.size > 1) leaves += "[" + std::to_string(branch.size) + "]";
+      leaves += std::string("/") + branch.type;
+      void *address = (branch.type == 'F') ? static_cast<void*>(fEntry.floats.data() + fOffsets[b])
+                                           : static_cast<void*>(fEntry.ints.data() + fOffsets[b]);
+      fTree->Branch(branch.name.c_str(), address, leaves.c_str());
+    }
+  }
+
+  void AsyncDumpWriter::CloseFile()
+  {
+    // The tree is owned by the file
+    fFile->cd();
+    fTree->Write();
+    fTree = nullptr;
+    fFile->Close();
+    fFile.reset();
+  }
+
+  void AsyncDumpWriter::CheckError() const
+  {
+    if(!fError.empty())
+      throw art::Exception(art::errors::FileWriteError)
+        << "AsyncDumpWriter: " << fError << std::endl;
+  }
+
+}
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    AsyncDumpWriter.h
+/// \brief   Writes training records to a TTree on a background thread
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_ASYNCDUMPWRITER_H
+#define CVN_ASYNCDUMPWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TFile;
+class TTree;
+
+namespace cvn
+{
+
+  /// One fixed-size branch of a dump tree: size values of type 'F' (float)
+  /// or 'I' (int), written as a scalar when size is 1 and as name[size]
+  /// otherwise
+  struct DumpBranch
+  {
+    std::string name;
+    char type;
+    unsigned int size;
+  };
+
+  typedef std::vector<DumpBranch> DumpLayout;
+
+  /// The values of one tree entry, all the float branches of the layout one
+  /// after the other in floats and the int branches in ints
+  struct DumpRecord
+  {
+    std::vector<float> floats;
+    std::vector<int> ints;
+  };
+
+  /// Writes the records of the event dumpers (CVNEventDump, RegCNNEventDump)
+  /// to a tree of fixed-size branches in a file of its own. Filling the tree,
+  /// which streams and compresses the baskets, runs on a writer thread and
+  /// the event loop only queues. The TFileService file stays with the event
+  /// loop, as ROOT files cannot be written from two threads
+  class AsyncDumpWriter
+  {
+  public:
+
+    /// At most queueDepth records wait for the writer before Write blocks.
+    /// compression is in the ROOT convention, algorithm*100 + level, and
+    /// negative keeps the file default
+    AsyncDumpWriter(const std::string &fileName, const std::string &treeName,
+                    const DumpLayout &layout, unsigned int queueDepth = 16,
+                    int compression = -1);
+    ~AsyncDumpWriter();
+
+    /// Position of a branch in the floats or the ints of a record. Throws
+    /// if the layout has no branch of that name
+    size_t Offset(const std::string &name) const;
+
+    /// Zero filled record sized for the layout. The records already written
+    /// are recycled, so the event loop stops allocating
+    DumpRecord NewRecord();
+
+    /// Queue a record for the tree. Throws if the writer failed on an
+    /// earlier record
+    void Write(DumpRecord &&record);
+
+    /// Write everything queued, then the tree, and close the file. Only the
+    /// first call does anything, so a writer error is thrown once
+    void Close();
+
+  private:
+
+    /// Body of the writer thread
+    void Run();
+    void OpenFile();
+    void CloseFile();
+    /// Throw the error recorded by the writer thread, if any. Needs fMutex
+    void CheckError() const;
+
+    std::string fFileName;
+    std::string fTreeName;
+    DumpLayout fLayout;
+    std::vector<size_t> fOffsets; ///< Of each branch, in floats or ints
+    size_t fNFloats;
+    size_t fNInts;
+    unsigned int fQueueDepth;
+    int fCompression;
+
+    std::mutex fMutex;
+    std::condition_variable fQueued;
+    std::condition_variable fDequeued;
+    std::deque<DumpRecord> fQueue;
+    std::vector<DumpRecord> fFree;
+    bool fDone;
+    bool fClosed;
+    std::string fError;
+    std::thread fThread;
+
+    // Only touched by the writer thread
+    std::unique_ptr<TFile> fFile;
+    TTree *fTree;
+    DumpRecord fEntry; ///< The branch buffers
+  };
+
+}
+
+#endif  // CVN_ASYNCDUMPWRITER_H
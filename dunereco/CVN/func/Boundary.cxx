@@ -42,7 +42,27 @@ namespace cvn
     assert(fLastWire[2] - fFirstWire[2] == nWire - 1);
   }
 
-  bool Boundary::IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view)
+  Boundary::Boundary(const Boundary& bound,
+                     const int& nWire,
+                     const int& minWireX,
+                     const int& minWireY,
+                     const int& minWireZ):
+    fFirstWire{minWireX,
+      minWireY,
+      minWireZ},
+    fLastWire{minWireX + nWire - 1,
+        minWireY + nWire - 1,
+        minWireZ + nWire - 1},
+    fFirstTDC{bound.fFirstTDC[0],
+        bound.fFirstTDC[1],
+        bound.fFirstTDC[2]},
+    fLastTDC{bound.fLastTDC[0],
+        bound.fLastTDC[1],
+        bound.fLastTDC[2]}
+  {
+  }
+
+  bool Boundary::IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view) const
   {
     bool inWireRcvne = (int) wire >= fFirstWire[view] && (int) wire <= fLastWire[view];
     bool inTDCRcvne = (double) cell >= fFirstTDC[view] &&
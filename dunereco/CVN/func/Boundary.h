@@ -37,9 +37,16 @@ namespace cvn
              const double& centerTDCY,
              const double& centerTDCZ);
 
+    /// Boundary with the time window of bound and nWire wires from the
+    /// given minimum wires, a region of a larger map
+    Boundary(const Boundary& bound, const int& nWire,
+             const int& minWireX,
+             const int& minWireY,
+             const int& minWireZ);
+
     Boundary(){};
 
-    bool IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view);
+    bool IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view) const;
 
     int FirstWire(const unsigned int& view) const {return fFirstWire[view];};
     int LastWire(const unsigned int& view) const {return fLastWire[view];};
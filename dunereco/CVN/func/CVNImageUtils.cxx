@@ -1,7 +1,32 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <iostream>
 
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/ScratchBuffers.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+namespace
+{
+  /// Per thread temporaries of the conversions. The image utilities are
+  /// usually made for each event or batch, so the buffers can't live in them
+  struct ImageScratch
+  {
+    std::vector<float> wireCharges;
+    std::vector<float> tdcCharges;
+    cvn::ViewVector views[3];
+    cvn::ViewVectorF viewsF[3];
+  };
+
+  ImageScratch& Scratch()
+  {
+    thread_local ImageScratch scratch;
+    return scratch;
+  }
+}
 
 cvn::CVNImageUtils::CVNImageUtils(){
   // Set a default image size
@@ -12,6 +37,7 @@ cvn::CVNImageUtils::CVNImageUtils(){
 
   fUseLogScale = false;
   fDisableRegionSelection = false;
+  FillChargeLookup();
 }
 
 cvn::CVNImageUtils::CVNImageUtils(unsigned int nWires, unsigned int nTDCs, unsigned int nViews){
@@ -19,6 +45,7 @@ cvn::CVNImageUtils::CVNImageUtils(unsigned int nWires, unsigned int nTDCs, unsig
   SetPixelMapSize(2880,500);
   fUseLogScale = false;
   fDisableRegionSelection = false;
+  FillChargeLookup();
 }
 
 cvn::CVNImageUtils::~CVNImageUtils(){
@@ -33,12 +60,12 @@ void cvn::CVNImageUtils::EnableRegionSelection(){
   fDisableRegionSelection = false;
 }
 
-unsigned char cvn::CVNImageUtils::ConvertChargeToChar(float charge){
+float cvn::CVNImageUtils::ScaleCharge(float charge, bool useLog){
 
   float peCorrChunk;
   float truncateCorr;
   float centreScale = 0.7;
-  if(fUseLogScale){
+  if(useLog){
     float scaleFrac=(log(charge)/log(1000));
     truncateCorr= ceil(centreScale*scaleFrac*255.0);
       }
@@ -46,8 +73,40 @@ unsigned char cvn::CVNImageUtils::ConvertChargeToChar(float charge){
     peCorrChunk = (1000.) / 255.0;
     truncateCorr = ceil((charge)/(peCorrChunk));
   }
-  if (truncateCorr > 255) return (unsigned char)255;
-  else return (unsigned char)truncateCorr;
+  return truncateCorr;
+
+}
+
+void cvn::CVNImageUtils::FillChargeLookup(){
+
+  // The scaling rises with the charge, so the smallest charge giving each
+  // output value can be found by bisection. Positive floats are ordered
+  // like their bit patterns, which makes the result exact
+  const uint32_t infBits = 0x7f800000;
+  fChargeThresholds[0] = -INFINITY;
+  for(unsigned int k = 1; k < fChargeThresholds.size(); ++k){
+    uint32_t low = 0, high = infBits;
+    while(low < high){
+      const uint32_t mid = low + (high - low)/2;
+      float charge;
+      std::memcpy(&charge, &mid, sizeof(charge));
+      if(ScaleCharge(charge, fUseLogScale) >= k) high = mid;
+      else low = mid + 1;
+    }
+    std::memcpy(&fChargeThresholds[k], &low, sizeof(float));
+  }
+
+}
+
+unsigned char cvn::CVNImageUtils::ConvertChargeToChar(float charge) const{
+
+  // Branchless search for the largest value whose threshold is reached.
+  // Values below one, including the log of empty pixels, give zero
+  unsigned int value = 0;
+  for(unsigned int step = 128; step > 0; step >>= 1){
+    value += (charge >= fChargeThresholds[value + step]) ? step : 0;
+  }
+  return (unsigned char)value;
 
 }
 
@@ -72,7 +131,9 @@ void cvn::CVNImageUtils::SetViewReversal(std::vector<bool> reverseViews){
 }
 
 void cvn::CVNImageUtils::SetLogScale(bool setLog){
+  if(setLog == fUseLogScale) return;
   fUseLogScale = setLog;
+  FillChargeLookup();
 }
 
 void cvn::CVNImageUtils::SetPixelMapSize(unsigned int nWires, unsigned int nTDCs){
@@ -82,44 +143,24 @@ void cvn::CVNImageUtils::SetPixelMapSize(unsigned int nWires, unsigned int nTDCs
 
 void cvn::CVNImageUtils::ConvertPixelMapToPixelArray(const PixelMap &pm, std::vector<unsigned char> &pix){
 
-  SetPixelMapSize(pm.fNWire,pm.fNTdc);
+  DUNE_PROF_SCOPE("cvn::CVNImageUtils::ConvertPixelMapToPixelArray");
 
-  // Strip out the charge vectors and use these
-  std::vector<float> v0pe = pm.fPEX;
-  std::vector<float> v1pe = pm.fPEY;
-  std::vector<float> v2pe = pm.fPEZ;
+  SetPixelMapSize(pm.fNWire,pm.fNTdc);
 
-  ConvertChargeVectorsToPixelArray(v0pe,v1pe,v2pe,pix);
+  // Use the charge vectors directly, they are not modified
+  ConvertChargeVectorsToPixelArray(pm.fPEX,pm.fPEY,pm.fPEZ,pix);
 
 }
 
 
-void cvn::CVNImageUtils::ConvertChargeVectorsToPixelArray(std::vector<float> &v0pe, std::vector<float> &v1pe,
-                                                          std::vector<float> &v2pe, std::vector<unsigned char> &pix){
-
-  // Get the vectors
-  cvn::ViewVector view0;
-  cvn::ViewVector view1;
-  cvn::ViewVector view2;
-  ConvertChargeVectorsToViewVectors(v0pe, v1pe, v2pe, view0, view1, view2); 
+void cvn::CVNImageUtils::ConvertChargeVectorsToPixelArray(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                                          const std::vector<float> &v2pe, std::vector<unsigned char> &pix){
 
-  // Actually write the values to the pixel array
-  for (unsigned int view = 0; view < fNViews; ++view){
-    for (unsigned int wire = 0; wire < fNWires; ++wire){
-      for (unsigned int time = 0; time < fNTDCs; ++time){
-
-        unsigned char val = 0;
-        // Get the index for the pixel map
-        if(view == 0 ){ val = view0[wire][time]; }
-        if(view == 1 ){ val = view1[wire][time]; }
-        if(view == 2 ){ val = view2[wire][time]; }
-
-        // Get the index for the final image
-        unsigned int i = time + fNTDCs * (wire + fNWires * view);
-        pix[i] = val;
-  
-      }
-    }
+  // The pixel array is built with indices i = time + fNTDCs * (wire + fNWires * view)
+  const std::vector<float>* peVecs[3] = {&v0pe, &v1pe, &v2pe};
+  const unsigned int viewSize = fNWires * fNTDCs;
+  for (unsigned int view = 0; view < fNViews && view < 3; ++view){
+    FillViewBuffer(*peVecs[view], fViewReverse[view], pix.data() + view * viewSize, fNTDCs, 1);
   }
 
   return;
@@ -128,195 +169,192 @@ void cvn::CVNImageUtils::ConvertChargeVectorsToPixelArray(std::vector<float> &v0
 
 void cvn::CVNImageUtils::ConvertPixelMapToImageVector(const cvn::PixelMap &pm, cvn::ImageVector &imageVec){
 
-  SetPixelMapSize(pm.fNWire,pm.fNTdc);
+  DUNE_PROF_SCOPE("cvn::CVNImageUtils::ConvertPixelMapToImageVector");
 
-  // Strip out the charge vectors and use these
-  std::vector<float> v0pe = pm.fPEX;
-  std::vector<float> v1pe = pm.fPEY;
-  std::vector<float> v2pe = pm.fPEZ;
+  SetPixelMapSize(pm.fNWire,pm.fNTdc);
 
-  ConvertChargeVectorsToImageVector(v0pe, v1pe, v2pe, imageVec);
+  ConvertChargeVectorsToImageVector(pm.fPEX, pm.fPEY, pm.fPEZ, imageVec);
 }
 
 void cvn::CVNImageUtils::ConvertPixelMapToImageVectorF(const cvn::PixelMap &pm, cvn::ImageVectorF &imageVec){
 
-  SetPixelMapSize(pm.fNWire,pm.fNTdc);
+  DUNE_PROF_SCOPE("cvn::CVNImageUtils::ConvertPixelMapToImageVectorF");
 
-  // Strip out the charge vectors and use these
-  std::vector<float> v0pe = pm.fPEX;
-  std::vector<float> v1pe = pm.fPEY;
-  std::vector<float> v2pe = pm.fPEZ;
+  SetPixelMapSize(pm.fNWire,pm.fNTdc);
 
-  ConvertChargeVectorsToImageVectorF(v0pe, v1pe, v2pe, imageVec);
+  ConvertChargeVectorsToImageVectorF(pm.fPEX, pm.fPEY, pm.fPEZ, imageVec);
 }
 
-void cvn::CVNImageUtils::ConvertChargeVectorsToImageVector(std::vector<float> &v0pe, std::vector<float> &v1pe,
-                                                           std::vector<float> &v2pe, cvn::ImageVector &imageVec){
-
-  cvn::ViewVector view0;
-  cvn::ViewVector view1;
-  cvn::ViewVector view2;
+void cvn::CVNImageUtils::ConvertChargeVectorsToImageVector(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                                           const std::vector<float> &v2pe, cvn::ImageVector &imageVec){
 
-  ConvertChargeVectorsToViewVectors(v0pe, v1pe, v2pe, view0, view1, view2);
+  cvn::ViewVector *views = Scratch().views;
 
-  cvn::ImageVector newImage = BuildImageVector(view0,view1,view2);
+  ConvertChargeVectorsToViewVectors(v0pe, v1pe, v2pe, views[0], views[1], views[2]);
 
-  imageVec = newImage;
+  imageVec = BuildImageVector(views[0],views[1],views[2]);
 }
 
-void cvn::CVNImageUtils::ConvertChargeVectorsToImageVectorF(std::vector<float> &v0pe, std::vector<float> &v1pe,
-                                                           std::vector<float> &v2pe, cvn::ImageVectorF &imageVec){
-
-  cvn::ViewVector view0;
-  cvn::ViewVector view1;
-  cvn::ViewVector view2;
+void cvn::CVNImageUtils::ConvertChargeVectorsToImageVectorF(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                                           const std::vector<float> &v2pe, cvn::ImageVectorF &imageVec){
 
-  ConvertChargeVectorsToViewVectors(v0pe, v1pe, v2pe, view0, view1, view2);
+  // The views are written as floats straight away
+  cvn::ViewVectorF *views = Scratch().viewsF;
 
-  // Convert the ViewVector to ViewVectorF
-  cvn::ViewVectorF floatView0 = ConvertViewVecToViewVecF(view0);
-  cvn::ViewVectorF floatView1 = ConvertViewVecToViewVecF(view1);
-  cvn::ViewVectorF floatView2 = ConvertViewVecToViewVecF(view2);
+  ConvertChargeVectorsToViewVectors(v0pe, v1pe, v2pe, views[0], views[1], views[2]);
 
-  cvn::ImageVectorF newImage = BuildImageVectorF(floatView0,floatView1,floatView2);
-
-  imageVec = newImage;
+  imageVec = BuildImageVectorF(views[0],views[1],views[2]);
 }
 
 
-void cvn::CVNImageUtils::ConvertChargeVectorsToViewVectors(std::vector<float> &v0pe, std::vector<float> &v1pe, std::vector<float> &v2pe,
-                                       cvn::ViewVector& view0, cvn::ViewVector& view1, cvn::ViewVector& view2){
+template <typename T>
+void cvn::CVNImageUtils::ConvertChargeVectorsToViewVectors(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                                           const std::vector<float> &v2pe,
+                                                           std::vector<std::vector<T> >& view0, std::vector<std::vector<T> >& view1,
+                                                           std::vector<std::vector<T> >& view2){
 
-  // Reverse requested views
-  if(fViewReverse[0]) ReverseView(v0pe);
-  if(fViewReverse[1]) ReverseView(v1pe);
-  if(fViewReverse[2]) ReverseView(v2pe);
+  const std::vector<float>* peVecs[3] = {&v0pe, &v1pe, &v2pe};
+  std::vector<std::vector<T> >* views[3] = {&view0, &view1, &view2};
 
-  // Get the integrated charge for each wire
-  std::vector< std::vector<float> > wireCharges;
-  for (unsigned int view = 0; view < fNViews; ++view){
+  for (unsigned int view = 0; view < fNViews && view < 3; ++view){
 
-    std::vector<float> tempChargeVec;
-    for (unsigned int wire = 0; wire < fPixelMapWires; ++wire){
+    // The output image consists of a rectangular region of the pixel map
+    unsigned int startWire, endWire, startTDC, endTDC;
+    GetViewRegion(*peVecs[view], fViewReverse[view], startWire, endWire, startTDC, endTDC);
 
-      float totCharge = 0;
-      for (unsigned int time = 0; time < fPixelMapTDCs; ++time){
-        float val = 0.;
-        unsigned int element = time + fPixelMapTDCs * wire;
-        if(view == 0 ){ val = v0pe[element]; }
-        if(view == 1 ){ val = v1pe[element]; }
-        if(view == 2 ){ val = v2pe[element]; }
-        totCharge += val;
-      }
-      tempChargeVec.push_back(totCharge);
+    // Write the values for each wire of the region, the ends are included
+    std::vector<std::vector<T> > &viewChargeVec = *views[view];
+    // The vectors of the previous call are reused
+    viewChargeVec.resize(endWire - startWire + 1);
+    for (std::vector<T> &wireVec : viewChargeVec){
+      if (ResetScratch(wireVec, endTDC - startTDC + 1))
+        DUNE_PROF_COUNT("cvn::CVNImageUtils scratch allocations", 1);
+    }
+    for (unsigned int wire = startWire; wire <= endWire; ++wire){
+      ConvertWire(*peVecs[view], fViewReverse[view], wire, startTDC, endTDC - startTDC + 1,
+                  viewChargeVec[wire - startWire].data(), 1);
     }
-    wireCharges.push_back(tempChargeVec);
   }
 
-  // Get the integrated charge for each tdc
-  std::vector< std::vector<float> > tdcCharges;
-  for (unsigned int view = 0; view < fNViews; ++view){
+  return;
 
-    std::vector<float> tempChargeVec;
-    for (unsigned int time = 0; time < fPixelMapTDCs; ++time){
+}
 
+void cvn::CVNImageUtils::ConvertPixelArrayToImageVectorF(const std::vector<unsigned char> &pixelArray, cvn::ImageVectorF &imageVec){
 
-      float totCharge = 0;
-      for (unsigned int wire = 0; wire < fPixelMapWires; ++wire){
+  // The pixel arrays is built with indices i = tdc + nTDCs(wire + nWires*view)
 
-        float val = 0.;
-        unsigned int element = time + fPixelMapTDCs * wire;
-        if(view == 0 ){ val = v0pe[element]; }
-        if(view == 1 ){ val = v1pe[element]; }
-        if(view == 2 ){ val = v2pe[element]; }
-        totCharge += val;
-      }
-      tempChargeVec.push_back(totCharge);
+  cvn::ViewVectorF *views = Scratch().viewsF;
+ 
+  for(unsigned int v = 0; v < fNViews && v < 3; ++v){
+    views[v].resize(fNWires);
+    for(unsigned int w = 0; w < fNWires; ++w){
+      const unsigned char *wire = pixelArray.data() + fNTDCs*(w + fNWires*v);
+      views[v][w].assign(wire, wire + fNTDCs);
     }
-    tdcCharges.push_back(tempChargeVec);
   }
 
-  // The output image consists of a rectangular region of the pixel map
-  // We want to find the start and end wires for each view
-  std::vector<unsigned int> imageStartWire(3,0);
-  std::vector<unsigned int> imageEndWire(3,0);
-  // And the same for TDCs
-  std::vector<unsigned int> imageStartTDC(3,0);
-  std::vector<unsigned int> imageEndTDC(3,0);
-
-  if(!fDisableRegionSelection){
-    // Do a rough vertex-based selection of the region for each view
-    for(unsigned int view = 0; view < wireCharges.size(); ++view){
-      GetMinMaxWires(wireCharges[view],imageStartWire[view],imageEndWire[view]);
-      GetMinMaxTDCs(tdcCharges[view],imageStartTDC[view],imageEndTDC[view]);
+  imageVec = BuildImageVectorF(views[0],views[1],views[2]);
 
-    }
-  }
-  else{
-    // Just use the number of wires and TDCs as the maximum values if we want to
-    // use a fixed range of wires and TDC for protoDUNE's APA 3
-    for(unsigned int i = 0; i < imageStartWire.size(); ++i){
-      imageStartWire[i] = 0;
-      imageEndWire[i] = fNWires;
-      imageStartTDC[i] = 0;
-      imageEndTDC[i] = fNTDCs;
-    }
-  }
+}
 
-  // Write the values to the three vectors
-  for (unsigned int view = 0; view < fNViews; ++view){
-    cvn::ViewVector viewChargeVec;
-    for (unsigned int wire = imageStartWire[view]; wire <= imageEndWire[view]; ++wire){
-      std::vector<unsigned char> wireTDCVec;
-      for (unsigned int time = imageStartTDC[view]; time <= imageEndTDC[view]; ++time){
-
-        // Get the index for the pixel map
-        unsigned int element = time + fPixelMapTDCs * wire;
-
-        // We have to convert to char and then convert back to a float
-        unsigned char val = 0;
-        if(view == 0){ val = ConvertChargeToChar(v0pe[element]); }
-        if(view == 1){ val = ConvertChargeToChar(v1pe[element]); }
-        if(view == 2){ val = ConvertChargeToChar(v2pe[element]); }
-        wireTDCVec.push_back(val);
-      }
-      viewChargeVec.push_back(wireTDCVec);
+void cvn::CVNImageUtils::ConvertPixelMapToBuffer(const PixelMap &pm, float *buffer){
+
+  DUNE_PROF_SCOPE("cvn::CVNImageUtils::ConvertPixelMapToBuffer");
+
+  SetPixelMapSize(pm.fNWire,pm.fNTdc);
+
+  // Tensorflow wants things in the arrangement <wires, TDCs, views>
+  FillViewBuffer(pm.fPEX, fViewReverse[0], buffer,     fNTDCs * fNViews, fNViews);
+  FillViewBuffer(pm.fPEY, fViewReverse[1], buffer + 1, fNTDCs * fNViews, fNViews);
+  FillViewBuffer(pm.fPEZ, fViewReverse[2], buffer + 2, fNTDCs * fNViews, fNViews);
+}
+
+void cvn::CVNImageUtils::ConvertPixelMapToViewBuffers(const PixelMap &pm, const std::vector<float*> &viewBuffers){
+
+  DUNE_PROF_SCOPE("cvn::CVNImageUtils::ConvertPixelMapToViewBuffers");
+
+  SetPixelMapSize(pm.fNWire,pm.fNTdc);
+
+  FillViewBuffer(pm.fPEX, fViewReverse[0], viewBuffers[0], fNTDCs, 1);
+  FillViewBuffer(pm.fPEY, fViewReverse[1], viewBuffers[1], fNTDCs, 1);
+  FillViewBuffer(pm.fPEZ, fViewReverse[2], viewBuffers[2], fNTDCs, 1);
+}
+
+void cvn::CVNImageUtils::GetViewRegion(const std::vector<float> &peVec, bool reverse, unsigned int &startWire,
+                                       unsigned int &endWire, unsigned int &startTDC, unsigned int &endTDC){
+
+  // Just use the number of wires and TDCs as the maximum values if we want to
+  // use a fixed range of wires and TDC for protoDUNE's APA 3
+  startWire = 0;
+  endWire = fNWires;
+  startTDC = 0;
+  endTDC = fNTDCs;
+  if(fDisableRegionSelection) return;
+
+  // Get the integrated charge for each wire and tdc in the (possibly reversed) view
+  std::vector<float> &wireCharges = Scratch().wireCharges;
+  std::vector<float> &tdcCharges = Scratch().tdcCharges;
+  const bool wiresGrow = ResetScratch(wireCharges, fPixelMapWires, 0.f);
+  if (ResetScratch(tdcCharges, fPixelMapTDCs, 0.f) || wiresGrow)
+    DUNE_PROF_COUNT("cvn::CVNImageUtils scratch allocations", 1);
+  for (unsigned int wire = 0; wire < fPixelMapWires; ++wire){
+    const unsigned int srcWire = reverse ? fPixelMapWires - wire - 1 : wire;
+    const float *wireCharge = peVec.data() + fPixelMapTDCs * srcWire;
+    float totCharge = 0.;
+    for (unsigned int time = 0; time < fPixelMapTDCs; ++time){
+      totCharge += wireCharge[time];
+      tdcCharges[time] += wireCharge[time];
     }
-    if(view == 0) view0 = viewChargeVec;
-    if(view == 1) view1 = viewChargeVec;
-    if(view == 2) view2 = viewChargeVec;
+    wireCharges[wire] = totCharge;
   }
 
-  return;
+  // Do a rough vertex-based selection of the region
+  GetMinMaxWires(wireCharges,startWire,endWire);
+  GetMinMaxTDCs(tdcCharges,startTDC,endTDC);
 
 }
 
-void cvn::CVNImageUtils::ConvertPixelArrayToImageVectorF(const std::vector<unsigned char> &pixelArray, cvn::ImageVectorF &imageVec){
+template <typename T>
+void cvn::CVNImageUtils::ConvertWire(const std::vector<float> &peVec, bool reverse, unsigned int wire,
+                                     unsigned int startTDC, unsigned int nTDCs, T *out, unsigned int tdcStride) const{
 
-  // The pixel arrays is built with indices i = tdc + nTDCs(wire + nWires*view)
+  // Number of tdcs inside the pixel map, the rest is padded with zeros
+  unsigned int nInside = 0;
+  if(wire < fPixelMapWires && startTDC < fPixelMapTDCs){
+    nInside = std::min(nTDCs, fPixelMapTDCs - startTDC);
+  }
 
-  cvn::ViewVectorF view0; 
-  cvn::ViewVectorF view1; 
-  cvn::ViewVectorF view2;
- 
-  for(unsigned int v = 0; v < fNViews; ++v){
-    for(unsigned int w = 0; w < fNWires; ++w){
-      std::vector<float> wireVec;
-      for(unsigned int t = 0; t < fNTDCs; ++t){
-        unsigned int index = t + fNTDCs*(w + fNWires*v);
-        wireVec.push_back(pixelArray[index]);
-      }
-      if(v==0) view0.push_back(wireVec);
-      if(v==1) view1.push_back(wireVec);
-      if(v==2) view2.push_back(wireVec);
+  if(nInside > 0){
+    const unsigned int srcWire = reverse ? fPixelMapWires - wire - 1 : wire;
+    const float *charges = peVec.data() + fPixelMapTDCs * srcWire + startTDC;
+    for (unsigned int t = 0; t < nInside; ++t){
+      // We have to convert to char and then convert back to a float
+      out[t * tdcStride] = static_cast<T>(ConvertChargeToChar(charges[t]));
     }
   }
+  for (unsigned int t = nInside; t < nTDCs; ++t){
+    out[t * tdcStride] = 0;
+  }
+
+}
+
+template <typename T>
+void cvn::CVNImageUtils::FillViewBuffer(const std::vector<float> &peVec, bool reverse, T *out,
+                                        unsigned int wireStride, unsigned int tdcStride){
 
-  imageVec = BuildImageVectorF(view0,view1,view2);
+  // The output image consists of a rectangular region of the pixel map
+  unsigned int startWire, endWire, startTDC, endTDC;
+  GetViewRegion(peVec, reverse, startWire, endWire, startTDC, endTDC);
+
+  // Write the scaled charges, padding with zeros outside the pixel map
+  for (unsigned int w = 0; w < fNWires; ++w){
+    ConvertWire(peVec, reverse, startWire + w, startTDC, fNTDCs, out + w * wireStride, tdcStride);
+  }
 
 }
 
-void cvn::CVNImageUtils::GetMinMaxWires(std::vector<float> &wireCharges, unsigned int &minWire, unsigned int &maxWire){
+void cvn::CVNImageUtils::GetMinMaxWires(const std::vector<float> &wireCharges, unsigned int &minWire, unsigned int &maxWire) const{
 
   minWire = 0;
   maxWire = fNWires;
@@ -360,7 +398,7 @@ void cvn::CVNImageUtils::GetMinMaxWires(std::vector<float> &wireCharges, unsigne
 
 }
 
-void cvn::CVNImageUtils::GetMinMaxTDCs(std::vector<float> &tdcCharges, unsigned int &minTDC, unsigned int &maxTDC){
+void cvn::CVNImageUtils::GetMinMaxTDCs(const std::vector<float> &tdcCharges, unsigned int &minTDC, unsigned int &maxTDC){
 
   minTDC = 0;
   maxTDC = fNTDCs;
@@ -406,100 +444,62 @@ void cvn::CVNImageUtils::GetMinMaxTDCs(std::vector<float> &tdcCharges, unsigned
 
 }
 
-void cvn::CVNImageUtils::ReverseView(std::vector<float> &peVec){
-
-  std::vector<float> vecCopy(peVec.size(),0.); 
-
-  for (unsigned int w = 0; w < fPixelMapWires; ++w)
-  {
-    // Get our new plane number
-    unsigned int newPlane = fPixelMapWires - w - 1;
-
-    for (unsigned int t = 0; t < fPixelMapTDCs; ++t)
-    {
-      float val = peVec[t + fPixelMapTDCs * w];
-      vecCopy[t + fPixelMapTDCs * newPlane] = val;
-    }
-  }
-
-  // Copy the values back into the original vector
-  for(unsigned int e = 0; e < peVec.size(); ++e){
-    float val = vecCopy[e];
-    peVec[e] = val;
-  }
-
-}
-
-cvn::ViewVectorF cvn::CVNImageUtils::ConvertViewVecToViewVecF(cvn::ViewVector view){
+cvn::ViewVectorF cvn::CVNImageUtils::ConvertViewVecToViewVecF(const cvn::ViewVector &view) const{
 
   cvn::ViewVectorF newVec; 
+  newVec.reserve(view.size());
   for(size_t w = 0; w < view.size(); ++w){
-    std::vector<float> thisWire;
-    for(size_t t = 0; t < view[w].size(); ++t){
-      float chargeSC = static_cast<float>(view[w][t]);
-      thisWire.push_back(chargeSC);
-    }
-    newVec.push_back(thisWire);
+    newVec.emplace_back(view[w].begin(), view[w].end());
   }
   return newVec;
 }
 
-cvn::ImageVectorF cvn::CVNImageUtils::ConvertImageVecToImageVecF(cvn::ImageVector image){
+cvn::ImageVectorF cvn::CVNImageUtils::ConvertImageVecToImageVecF(const cvn::ImageVector &image) const{
 
   cvn::ImageVectorF newImage; 
+  newImage.reserve(image.size());
   for(size_t w = 0; w < image.size(); ++w){
     cvn::ViewVectorF thisWire;
+    thisWire.reserve(image[w].size());
     for(size_t t = 0; t < image[w].size(); ++t){
-      std::vector<float> thisTime;
-      for(size_t v = 0; v < image[w][t].size(); ++v){
-        float chargeSC = static_cast<float>(image[w][t][v]);
-        thisTime.push_back(chargeSC);
-      }
-      thisWire.push_back(thisTime);
+      thisWire.emplace_back(image[w][t].begin(), image[w][t].end());
     }
-    newImage.push_back(thisWire);
+    newImage.push_back(std::move(thisWire));
   }
   return newImage;
 }
 
-cvn::ImageVector cvn::CVNImageUtils::BuildImageVector(cvn::ViewVector v0, cvn::ViewVector v1, cvn::ViewVector v2){
+cvn::ImageVector cvn::CVNImageUtils::BuildImageVector(const cvn::ViewVector &v0, const cvn::ViewVector &v1,
+                                                      const cvn::ViewVector &v2) const{
 
   // Tensorflow wants things in the arrangement <wires, TDCs, views>
-  cvn::ImageVector image;
+  cvn::ImageVector image(v0.size());
   for(unsigned int w = 0; w < v0.size(); ++w){
-    std::vector<std::vector<unsigned char> > wireVec;
+    std::vector<std::vector<unsigned char> > &wireVec = image[w];
+    wireVec.reserve(v0[0].size());
     for(unsigned int t = 0; t < v0[0].size(); ++t){
-      std::vector<unsigned char> timeVec;
-      timeVec.push_back(v0[w][t]);
-      timeVec.push_back(v1[w][t]);
-      timeVec.push_back(v2[w][t]);
-      wireVec.push_back(timeVec);
+      wireVec.push_back({v0[w][t], v1[w][t], v2[w][t]});
     } // Loop over tdcs
-    image.push_back(wireVec);
   } // Loop over wires
   
   return image;
 
 }
 
-cvn::ImageVectorF cvn::CVNImageUtils::BuildImageVectorF(cvn::ViewVectorF v0, cvn::ViewVectorF v1, cvn::ViewVectorF v2){
+cvn::ImageVectorF cvn::CVNImageUtils::BuildImageVectorF(const cvn::ViewVectorF &v0, const cvn::ViewVectorF &v1,
+                                                        const cvn::ViewVectorF &v2) const{
 
   // Tensorflow wants things in the arrangement <wires, TDCs, views>
-  cvn::ImageVectorF image;
+  cvn::ImageVectorF image(v0.size());
   for(unsigned int w = 0; w < v0.size(); ++w){
-    std::vector<std::vector<float> > wireVec;
+    std::vector<std::vector<float> > &wireVec = image[w];
+    wireVec.reserve(v0[0].size());
     for(unsigned int t = 0; t < v0[0].size(); ++t){
-      std::vector<float> timeVec;
-      timeVec.push_back(v0[w][t]);
-      timeVec.push_back(v1[w][t]);
-      timeVec.push_back(v2[w][t]);
-      wireVec.push_back(timeVec);
+      wireVec.push_back({v0[w][t], v1[w][t], v2[w][t]});
     } // Loop over tdcs
-    image.push_back(wireVec);
   } // Loop over wires
   
   
 
   return image;
 }
-
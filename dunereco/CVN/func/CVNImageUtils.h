@@ -7,6 +7,7 @@
 #ifndef CVN_IMAGE_UTILS_H
 #define CVN_IMAGE_UTILS_H
 
+#include <array>
 #include <vector>
 
 #include "dunereco/CVN/func/PixelMap.h"
@@ -34,7 +35,7 @@ namespace cvn
     void EnableRegionSelection();
 
     /// Convert the hit charge into the range 0 to 255 required by the CVN
-    unsigned char ConvertChargeToChar(float charge);
+    unsigned char ConvertChargeToChar(float charge) const;
 
     /// Set up the image size that we want to have
     void SetImageSize(unsigned int nWires, unsigned int nTDCs, unsigned int nViews);
@@ -54,8 +55,8 @@ namespace cvn
 
     /// Convert three vectors (sorted in the same way as the vectors in the PixelMap object) 
     /// into a single pixel array with an image size nWire x nTDC
-    void ConvertChargeVectorsToPixelArray(std::vector<float> &v0pe, std::vector<float> &v1pe,
-                                          std::vector<float> &v2pe, std::vector<unsigned char> &pix);  
+    void ConvertChargeVectorsToPixelArray(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                          const std::vector<float> &v2pe, std::vector<unsigned char> &pix);  
 
     /// Convert a pixel map into an image vector (contains all three views)
     void ConvertPixelMapToImageVector(const PixelMap &pm, ImageVector &imageVec);
@@ -64,40 +65,71 @@ namespace cvn
     void ConvertPixelMapToImageVectorF(const PixelMap &pm, ImageVectorF &imageVec);
 
     /// Convert three adc vectors into an image vector (contains all three views)
-    void ConvertChargeVectorsToImageVector(std::vector<float> &v0pe, std::vector<float> &v1pe,
-                                           std::vector<float> &v2pe, ImageVector &imageVec);  
+    void ConvertChargeVectorsToImageVector(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                           const std::vector<float> &v2pe, ImageVector &imageVec);  
 
     /// Float version of conversion for convenience of TF interface
-    void ConvertChargeVectorsToImageVectorF(std::vector<float> &v0pe, std::vector<float> &v1pe,
-                                           std::vector<float> &v2pe, ImageVectorF &imageVec);  
+    void ConvertChargeVectorsToImageVectorF(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                           const std::vector<float> &v2pe, ImageVectorF &imageVec);  
 
     /// Convert a pixel array into a ImageVectorF
     void ConvertPixelArrayToImageVectorF(const std::vector<unsigned char> &pixelArray, ImageVectorF &imageVec);
 
+    /// Write a pixel map directly into a contiguous nWire x nTDC x nViews float buffer
+    /// (the layout of one sample of a NHWC tensor). Region selection, view reversal
+    /// and charge scaling are applied in a single pass without intermediate vectors.
+    void ConvertPixelMapToBuffer(const PixelMap &pm, float *buffer);
+
+    /// As above, but write each view into its own nWire x nTDC buffer
+    void ConvertPixelMapToViewBuffers(const PixelMap &pm, const std::vector<float*> &viewBuffers);
+
+    /// Get the minimum and maximum wires from the pixel map needed to make the
+    /// image, given the summed charge of each (possibly reversed) map wire
+    void GetMinMaxWires(const std::vector<float> &wireCharges, unsigned int &minWire, unsigned int &maxWire) const;
+
   private:
 
     /// Base function for conversion of the Pixel Map to our required output format
-    void ConvertChargeVectorsToViewVectors(std::vector<float> &v0pe, std::vector<float> &v1pe, std::vector<float> &v2pe,
-                                  ViewVector& view0, ViewVector& view1, ViewVector& view2);
+    template <typename T>
+    void ConvertChargeVectorsToViewVectors(const std::vector<float> &v0pe, const std::vector<float> &v1pe,
+                                           const std::vector<float> &v2pe,
+                                           std::vector<std::vector<T> >& view0, std::vector<std::vector<T> >& view1,
+                                           std::vector<std::vector<T> >& view2);
+
+    /// Find the image region of one (possibly reversed) view. The wire and tdc
+    /// charges are summed in a single pass over the pixel map
+    void GetViewRegion(const std::vector<float> &peVec, bool reverse, unsigned int &startWire,
+                       unsigned int &endWire, unsigned int &startTDC, unsigned int &endTDC);
+
+    /// Fill one view of the image into out[wire * wireStride + tdc * tdcStride]
+    template <typename T>
+    void FillViewBuffer(const std::vector<float> &peVec, bool reverse, T *out,
+                        unsigned int wireStride, unsigned int tdcStride);
+
+    /// Convert nTDCs charges of one image wire, starting at startTDC, padding
+    /// with zeros outside the pixel map
+    template <typename T>
+    void ConvertWire(const std::vector<float> &peVec, bool reverse, unsigned int wire,
+                     unsigned int startTDC, unsigned int nTDCs, T *out, unsigned int tdcStride) const;
 
     /// Make the image vector from the view vectors
-    ImageVector BuildImageVector(ViewVector v0, ViewVector v1, ViewVector v2);
-    ImageVectorF BuildImageVectorF(ViewVectorF v0, ViewVectorF v1, ViewVectorF v2);
-
-    /// Get the minimum and maximum wires from the pixel map needed to make the image
-    void GetMinMaxWires(std::vector<float> &wireCharges, unsigned int &minWire, unsigned int &maxWire); 
+    ImageVector BuildImageVector(const ViewVector &v0, const ViewVector &v1, const ViewVector &v2) const;
+    ImageVectorF BuildImageVectorF(const ViewVectorF &v0, const ViewVectorF &v1, const ViewVectorF &v2) const;
 
     /// Get the minimum and maximum tdcs from the pixel map needed to make the image
-    void GetMinMaxTDCs(std::vector<float> &tdcCharges, unsigned int &minTDC, unsigned int &maxTDC); 
-
-    /// Funtion to actually reverse the view
-    void ReverseView(std::vector<float> &peVec);
+    void GetMinMaxTDCs(const std::vector<float> &tdcCharges, unsigned int &minTDC, unsigned int &maxTDC); 
 
     /// Convert a ViewVector into a ViewVectorF
-    ViewVectorF ConvertViewVecToViewVecF(ViewVector view);
+    ViewVectorF ConvertViewVecToViewVecF(const ViewVector &view) const;
 
     /// Convert a ImageVector into a ImageVectorF
-    ImageVectorF ConvertImageVecToImageVecF(ImageVector image);
+    ImageVectorF ConvertImageVecToImageVecF(const ImageVector &image) const;
+
+    /// The charge scaling before rounding, used to build the lookup table
+    static float ScaleCharge(float charge, bool useLog);
+
+    /// Work out the charge thresholds of each of the 256 output values
+    void FillChargeLookup();
 
     /// Number of views of each event
     unsigned int fNViews;
@@ -121,6 +153,10 @@ namespace cvn
     /// Use a log scale for charge?
     bool fUseLogScale;
 
+    /// fChargeThresholds[k] is the smallest charge that converts to at
+    /// least k, so a conversion is a search of this table
+    std::array<float, 256> fChargeThresholds;
+
   };
 
 }
@@ -5,7 +5,11 @@
 #include "canvas/Persistency/Common/FindManyP.h"
 #include "canvas/Persistency/Common/FindOneP.h"
 
-cvn::CVNProtoDUNEUtils::CVNProtoDUNEUtils(){
+cvn::CVNProtoDUNEUtils::CVNProtoDUNEUtils() : fEvent(nullptr){
+
+}
+
+cvn::CVNProtoDUNEUtils::CVNProtoDUNEUtils(art::Event const &evt, const std::string &particleLabel) : fEvent(&evt), fLabel(particleLabel){
 
 }
 
@@ -13,6 +17,12 @@ cvn::CVNProtoDUNEUtils::~CVNProtoDUNEUtils(){
 
 }
 
+bool cvn::CVNProtoDUNEUtils::IsBound(art::Event const &evt, const std::string &label) const{
+
+  return fEvent == &evt && fLabel == label;
+
+}
+
 // Get the hits from a given reco slice
 const std::vector<const recob::Hit*> cvn::CVNProtoDUNEUtils::GetRecoSliceHits(const recob::Slice &slice, art::Event const &evt, const std::string sliceModule) const{
 
@@ -23,6 +33,8 @@ const std::vector<const recob::Hit*> cvn::CVNProtoDUNEUtils::GetRecoSliceHits(co
 // Get the reco hits but using the slice id instead
 const std::vector<const recob::Hit*> cvn::CVNProtoDUNEUtils::GetRecoSliceHits(const unsigned int sliceID, art::Event const &evt, const std::string sliceModule) const{
 
+  if(IsBound(evt,sliceModule)) return SliceHitCache().at(sliceID);
+
   auto recoSlices = evt.getValidHandle<std::vector<recob::Slice> >(sliceModule);
   art::FindManyP<recob::Hit> findHits(recoSlices,evt,sliceModule);
   std::vector<art::Ptr<recob::Hit>> inputHits = findHits.at(sliceID);
@@ -45,11 +57,19 @@ const std::map<unsigned int, std::vector<const recob::Hit*>> cvn::CVNProtoDUNEUt
   auto recoSlices = evt.getValidHandle<std::vector<recob::Slice> >(sliceModule);
   std::map<unsigned int, std::vector<const recob::Hit*>> hitMap;
 
+  // Without a bound event the associations are only looked up once here too
+  std::unique_ptr<art::FindManyP<recob::Hit>> findHits;
+  if(!IsBound(evt,sliceModule)) findHits = std::make_unique<art::FindManyP<recob::Hit>>(recoSlices,evt,sliceModule);
+
   for(auto const &slice : *recoSlices){
 
-    const std::vector<const recob::Hit*> constvec = GetRecoSliceHits(slice.ID(),evt,sliceModule);
-    for(auto const h : constvec){
-      hitMap[slice.ID()].push_back(h);
+    std::vector<const recob::Hit*> &sliceHits = hitMap[slice.ID()];
+    if(findHits){
+      for(const art::Ptr<recob::Hit> &hit : findHits->at(slice.ID())) sliceHits.push_back(hit.get());
+    }
+    else{
+      const std::vector<const recob::Hit*> &cached = SliceHitCache().at(slice.ID());
+      sliceHits.insert(sliceHits.end(),cached.begin(),cached.end());
     }
 
   }
@@ -78,6 +98,11 @@ unsigned short cvn::CVNProtoDUNEUtils::GetBeamSlice(art::Event const &evt, const
 // Return a map of primary particles grouped by their reconstructed slice. Useful for finding slices with multiple particles
 const std::map<unsigned int,std::vector<const recob::PFParticle*>> cvn::CVNProtoDUNEUtils::GetPFParticleSliceMap(art::Event const &evt, const std::string particleLabel) const{
 
+  if(IsBound(evt,particleLabel)){
+    if(!fPrimarySliceMap) fPrimarySliceMap = std::make_unique<const std::map<unsigned int,std::vector<const recob::PFParticle*>>>(SliceMapHelper(evt,particleLabel,true));
+    return *fPrimarySliceMap;
+  }
+
   return SliceMapHelper(evt,particleLabel,true);
 
 }
@@ -85,6 +110,11 @@ const std::map<unsigned int,std::vector<const recob::PFParticle*>> cvn::CVNProto
 // Return a map of all particles grouped by their reconstructed slice. 
 const std::map<unsigned int,std::vector<const recob::PFParticle*>> cvn::CVNProtoDUNEUtils::GetAllPFParticleSliceMap(art::Event const &evt, const std::string particleLabel) const{
 
+  if(IsBound(evt,particleLabel)){
+    if(!fAllSliceMap) fAllSliceMap = std::make_unique<const std::map<unsigned int,std::vector<const recob::PFParticle*>>>(SliceMapHelper(evt,particleLabel,false));
+    return *fAllSliceMap;
+  }
+
   return SliceMapHelper(evt,particleLabel,false);
 
 }
@@ -117,6 +147,8 @@ const std::map<unsigned int,std::vector<const recob::PFParticle*>> cvn::CVNProto
 // Get the space points associated to the PFParticle
 const std::vector<const recob::SpacePoint*> cvn::CVNProtoDUNEUtils::GetPFParticleSpacePoints(const recob::PFParticle &particle, art::Event const &evt, const std::string particleLabel) const{
 
+  if(IsBound(evt,particleLabel)) return SpacePointCache().at(particle.Self());
+
   // Get the particles and their associations
   auto particles = evt.getValidHandle<std::vector<recob::PFParticle>>(particleLabel);
   const art::FindManyP<recob::SpacePoint> findSpacePoints(particles,evt,particleLabel);
@@ -134,6 +166,11 @@ const std::vector<const recob::SpacePoint*> cvn::CVNProtoDUNEUtils::GetPFParticl
 // Get the reconstructed slice associated with a particle
 const recob::Slice* cvn::CVNProtoDUNEUtils::GetPFParticleSlice(const recob::PFParticle &particle, art::Event const &evt, const std::string particleLabel) const{
 
+  if(IsBound(evt,particleLabel)){
+    SliceIndexCache();
+    return fSlices->at(particle.Self());
+  }
+
   // Perhaps we should use the associations to do this? 
   auto pfParticles = evt.getValidHandle<std::vector<recob::PFParticle>>(particleLabel);
   const art::FindOneP<recob::Slice> findSlice(pfParticles,evt,particleLabel);
@@ -146,6 +183,8 @@ const recob::Slice* cvn::CVNProtoDUNEUtils::GetPFParticleSlice(const recob::PFPa
 // Get the reconstructed slice associated with a particle
 unsigned short cvn::CVNProtoDUNEUtils::GetPFParticleSliceIndex(const recob::PFParticle &particle, art::Event const &evt, const std::string particleLabel) const{
 
+  if(IsBound(evt,particleLabel)) return SliceIndexCache().at(particle.Self());
+
   // Try to use slices if we can
   try{
     const recob::Slice* slice = GetPFParticleSlice(particle,evt,particleLabel);
@@ -167,6 +206,9 @@ unsigned short cvn::CVNProtoDUNEUtils::GetPFParticleSliceIndex(const recob::PFPa
 }
 
 const std::map<std::string,float> cvn::CVNProtoDUNEUtils::GetPFParticleMetaData(const recob::PFParticle &particle, art::Event const &evt, const std::string particleLabel) const {
+
+  if(IsBound(evt,particleLabel)) return MetaDataCache().at(particle.Self());
+
   // Get the particles
   auto pfParticles = evt.getValidHandle<std::vector<recob::PFParticle>>(particleLabel);
   // And their meta data
@@ -179,6 +221,13 @@ const std::map<std::string,float> cvn::CVNProtoDUNEUtils::GetPFParticleMetaData(
 
 // Use the pandora metadata to tell us if this is a beam particle or not
 bool cvn::CVNProtoDUNEUtils::IsBeamParticle(const recob::PFParticle &particle, art::Event const &evt, const std::string particleLabel) const{
+
+  // Only look the key up, the bound metadata need not be copied
+  if(IsBound(evt,particleLabel)){
+    const std::map<std::string,float> &mdMap = MetaDataCache().at(particle.Self());
+    return mdMap.find("IsTestBeam") != mdMap.end();
+  }
+
   std::map<std::string,float> mdMap = GetPFParticleMetaData(particle,evt,particleLabel);
   if(mdMap.find("IsTestBeam") != mdMap.end()){
     return true;
@@ -187,3 +236,93 @@ bool cvn::CVNProtoDUNEUtils::IsBeamParticle(const recob::PFParticle &particle, a
     return false;
   }
 }
+
+// The metadata of every particle of the bound event. Particles without metadata get an empty map
+const std::vector<std::map<std::string,float>>& cvn::CVNProtoDUNEUtils::MetaDataCache() const{
+
+  if(!fMetaData){
+    auto pfParticles = fEvent->getValidHandle<std::vector<recob::PFParticle>>(fLabel);
+    const art::FindManyP<larpandoraobj::PFParticleMetadata> findMetaData(pfParticles,*fEvent,fLabel);
+
+    auto metaData = std::make_unique<std::vector<std::map<std::string,float>>>(pfParticles->size());
+    for(unsigned int p = 0; p < pfParticles->size(); ++p){
+      const std::vector<art::Ptr<larpandoraobj::PFParticleMetadata>> &particleMetaData = findMetaData.at(p);
+      if(!particleMetaData.empty()) (*metaData)[p] = particleMetaData.front()->GetPropertiesMap();
+    }
+    fMetaData = std::move(metaData);
+  }
+
+  return *fMetaData;
+
+}
+
+// The slice of every particle of the bound event, from the slice associations where they
+// exist and from the pandora metadata otherwise
+const std::vector<unsigned short>& cvn::CVNProtoDUNEUtils::SliceIndexCache() const{
+
+  if(!fSliceIndices){
+    auto pfParticles = fEvent->getValidHandle<std::vector<recob::PFParticle>>(fLabel);
+
+    auto slices = std::make_unique<std::vector<const recob::Slice*>>(pfParticles->size(),nullptr);
+    try{
+      const art::FindOneP<recob::Slice> findSlice(pfParticles,*fEvent,fLabel);
+      for(unsigned int p = 0; p < pfParticles->size(); ++p) (*slices)[p] = findSlice.at(p).get();
+    }
+    catch(...){
+      // No slice associations, every particle falls back on the metadata
+    }
+
+    auto indices = std::make_unique<std::vector<unsigned short>>(pfParticles->size(),9999);
+    for(unsigned int p = 0; p < pfParticles->size(); ++p){
+      if((*slices)[p]){
+        (*indices)[p] = (*slices)[p]->ID();
+        continue;
+      }
+      const std::map<std::string,float> &mdMap = MetaDataCache().at(p);
+      auto search = mdMap.find("SliceIndex");
+      if(search != mdMap.end()) (*indices)[p] = static_cast<unsigned short>(search->second);
+    }
+
+    fSlices = std::move(slices);
+    fSliceIndices = std::move(indices);
+  }
+
+  return *fSliceIndices;
+
+}
+
+// The space points of every particle of the bound event
+const std::vector<std::vector<const recob::SpacePoint*>>& cvn::CVNProtoDUNEUtils::SpacePointCache() const{
+
+  if(!fSpacePoints){
+    auto pfParticles = fEvent->getValidHandle<std::vector<recob::PFParticle>>(fLabel);
+    const art::FindManyP<recob::SpacePoint> findSpacePoints(pfParticles,*fEvent,fLabel);
+
+    auto spacePoints = std::make_unique<std::vector<std::vector<const recob::SpacePoint*>>>(pfParticles->size());
+    for(unsigned int p = 0; p < pfParticles->size(); ++p){
+      for(const art::Ptr<recob::SpacePoint> &sp : findSpacePoints.at(p)) (*spacePoints)[p].push_back(sp.get());
+    }
+    fSpacePoints = std::move(spacePoints);
+  }
+
+  return *fSpacePoints;
+
+}
+
+// The hits of every slice of the bound event
+const std::vector<std::vector<const recob::Hit*>>& cvn::CVNProtoDUNEUtils::SliceHitCache() const{
+
+  if(!fSliceHits){
+    auto recoSlices = fEvent->getValidHandle<std::vector<recob::Slice>>(fLabel);
+    const art::FindManyP<recob::Hit> findHits(recoSlices,*fEvent,fLabel);
+
+    auto sliceHits = std::make_unique<std::vector<std::vector<const recob::Hit*>>>(recoSlices->size());
+    for(unsigned int s = 0; s < recoSlices->size(); ++s){
+      for(const art::Ptr<recob::Hit> &hit : findHits.at(s)) (*sliceHits)[s].push_back(hit.get());
+    }
+    fSliceHits = std::move(sliceHits);
+  }
+
+  return *fSliceHits;
+
+}
@@ -7,11 +7,17 @@
 //    particles and slices for ProtoDUNE events
 //  - Had to copy some of these from protoduneana to avoid
 //    having a circular dependency 
+//  - Constructed for an event and particle label, the slice,
+//    metadata, space point and slice hit lookups for that event
+//    are built once, on first use, and then served from memory
 //
 // Leigh Whitehead - leigh.howard.whitehead@cern.ch
 ///////////////////////////////////////////////////////////////
 
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/Slice.h"
@@ -28,6 +34,10 @@ namespace cvn {
   public:
 
     CVNProtoDUNEUtils();
+    /// Bind to one event. Calls for this event and particle (or slice)
+    /// label are served from maps built once, others are looked up as usual.
+    /// The event must outlive the instance
+    CVNProtoDUNEUtils(art::Event const &evt, const std::string &particleLabel);
     ~CVNProtoDUNEUtils();
 
     /*** ---------- Slice functions ---------- ***/
@@ -71,6 +81,26 @@ namespace cvn {
 
     /// Get the metadata associated to a PFParticle from pandora
     const std::map<std::string,float> GetPFParticleMetaData(const recob::PFParticle &particle, art::Event const &evt, const std::string particleLabel) const;
+
+    /// Whether the lookup can be served from the maps of the bound event
+    bool IsBound(art::Event const &evt, const std::string &label) const;
+
+    /// Builders of the maps of the bound event, each indexed by particle (or slice) position
+    const std::vector<std::map<std::string,float>>& MetaDataCache() const;
+    const std::vector<unsigned short>& SliceIndexCache() const;
+    const std::vector<std::vector<const recob::SpacePoint*>>& SpacePointCache() const;
+    const std::vector<std::vector<const recob::Hit*>>& SliceHitCache() const;
+
+    art::Event const *fEvent;
+    std::string fLabel;
+
+    mutable std::unique_ptr<const std::vector<std::map<std::string,float>>> fMetaData;
+    mutable std::unique_ptr<const std::vector<const recob::Slice*>> fSlices;
+    mutable std::unique_ptr<const std::vector<unsigned short>> fSliceIndices;
+    mutable std::unique_ptr<const std::vector<std::vector<const recob::SpacePoint*>>> fSpacePoints;
+    mutable std::unique_ptr<const std::vector<std::vector<const recob::Hit*>>> fSliceHits;
+    mutable std::unique_ptr<const std::map<unsigned int,std::vector<const recob::PFParticle*>>> fPrimarySliceMap;
+    mutable std::unique_ptr<const std::map<unsigned int,std::vector<const recob::PFParticle*>>> fAllSliceMap;
   };
 
 }
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    CompactResult.cxx
+/// \brief   Fixed layout, half precision copy of a multi-output CVN Result
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+#include "dunereco/CVN/func/CompactResult.h"
+#include "canvas/Utilities/Exception.h"
+
+namespace cvn
+{
+
+  CompactResult::CompactResult()
+  {
+    std::fill(fValues, fValues + kNValues, 0);
+  }
+
+  CompactResult::CompactResult(const Result& result):
+    CompactResult(result.fOutput)
+  {}
+
+  CompactResult::CompactResult(const std::vector< std::vector<float> >& output)
+  {
+    if(!HasLayout(output)){
+      throw art::Exception(art::errors::LogicError)
+        << "CompactResult: the CVN output has " << output.size()
+        << " heads, not the " << kNHeads << " heads of the multi-output network";
+    }
+
+    for(unsigned int head = 0; head < kNHeads; ++head){
+      for(unsigned int entry = 0; entry < output[head].size(); ++entry){
+        fValues[kHeadOffset[head] + entry] = FloatToHalf(output[head][entry]);
+      }
+    }
+  }
+
+  bool CompactResult::HasLayout(const std::vector< std::vector<float> >& output)
+  {
+    if(output.size() != kNHeads) return false;
+    for(unsigned int head = 0; head < kNHeads; ++head){
+      if(output[head].size() != kHeadOffset[head + 1] - kHeadOffset[head]) return false;
+    }
+    return true;
+  }
+
+  std::vector< std::vector<float> > CompactResult::Output() const
+  {
+    std::vector< std::vector<float> > output(kNHeads);
+    for(unsigned int head = 0; head < kNHeads; ++head){
+      for(unsigned int i = kHeadOffset[head]; i < kHeadOffset[head + 1]; ++i){
+        output[head].push_back(HalfToFloat(fValues[i]));
+      }
+    }
+    return output;
+  }
+
+  unsigned int CompactResult::ArgMax(unsigned int head) const
+  {
+    // Largest value of the head, the first one on ties as std::max_element
+    unsigned int best = 0;
+    float bestValue = HalfToFloat(fValues[kHeadOffset[head]]);
+    for(unsigned int entry = 1; kHeadOffset[head] + entry < kHeadOffset[head + 1]; ++entry){
+      const float value = HalfToFloat(fValues[kHeadOffset[head] + entry]);
+      if(bestValue < value){
+        best = entry;
+        bestValue = value;
+      }
+    }
+    return best;
+  }
+
+  TFIsAntineutrino CompactResult::PredictedIsAntineutrino() const
+  {
+    return static_cast<TFIsAntineutrino>((int)round(this->GetIsAntineutrinoProbability()));
+  }
+}
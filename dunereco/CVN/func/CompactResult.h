@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    CompactResult.h
+/// \brief   Fixed layout, half precision copy of a multi-output CVN Result
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_COMPACTRESULT_H
+#define CVN_COMPACTRESULT_H
+
+#include <cstdint>
+#include <vector>
+#include "dunereco/CVN/func/HalfFloat.h"
+#include "dunereco/CVN/func/InteractionType.h"
+#include "dunereco/CVN/func/Result.h"
+
+namespace cvn
+{
+  /// The softmax heads of the multi-output network, one after the other in
+  /// one fixed size array of IEEE half precision values. The offset of every
+  /// head is a compile time constant, so an accessor is a single load and
+  /// conversion, and the product is 50 bytes per slice with no nested
+  /// vectors. Half precision keeps a relative precision of 2^-11, so the
+  /// probabilities agree with those of the Result to better than 5e-4.
+  /// Only networks with the head sizes of TFMultioutputs fit, HasLayout
+  /// tells whether a Result does.
+  class CompactResult
+  {
+  public:
+    /// Offset of each head in the value array, in TFMultioutputs order,
+    /// with the is_antineutrino score followed by six four way softmaxes
+    static constexpr unsigned int kNHeads = 7;
+    static constexpr unsigned int kHeadOffset[kNHeads + 1] = {0, 1, 5, 9, 13, 17, 21, 25};
+    static constexpr unsigned int kNValues = kHeadOffset[kNHeads];
+
+    /// Copy of the multi-output result, which must have the layout
+    explicit CompactResult(const Result& result);
+    explicit CompactResult(const std::vector< std::vector<float> >& output);
+    CompactResult();
+
+    /// Whether the network output has the head sizes of this layout
+    static bool HasLayout(const std::vector< std::vector<float> >& output);
+    static bool HasLayout(const Result& result) { return HasLayout(result.fOutput); }
+
+    /// Value of one entry of a head
+    float Value(unsigned int head, unsigned int entry) const
+    { return HalfToFloat(fValues[kHeadOffset[head] + entry]); }
+
+    /// The full multi-output, as Result::fOutput
+    std::vector< std::vector<float> > Output() const;
+
+    /// Index of maximum value in a head
+    unsigned int ArgMax(unsigned int head) const;
+
+    TFIsAntineutrino   PredictedIsAntineutrino() const;
+    TFFlavour          PredictedFlavour() const
+    { return static_cast<TFFlavour>(ArgMax(TFMultioutputs::flavour)); }
+    TFInteraction      PredictedInteraction() const
+    { return static_cast<TFInteraction>(ArgMax(TFMultioutputs::interaction)); }
+    TFTopologyProtons  PredictedProtons() const
+    { return static_cast<TFTopologyProtons>(ArgMax(TFMultioutputs::protons)); }
+    TFTopologyPions    PredictedPions() const
+    { return static_cast<TFTopologyPions>(ArgMax(TFMultioutputs::pions)); }
+    TFTopologyPizeros  PredictedPizeros() const
+    { return static_cast<TFTopologyPizeros>(ArgMax(TFMultioutputs::pizeros)); }
+    TFTopologyNeutrons PredictedNeutrons() const
+    { return static_cast<TFTopologyNeutrons>(ArgMax(TFMultioutputs::neutrons)); }
+
+    /// The probabilities, as the Result accessors of a multi-output network
+    float GetIsAntineutrinoProbability() const { return Get<TFMultioutputs::is_antineutrino, 0>(); }
+
+    float GetNumuProbability()  const { return Get<TFMultioutputs::flavour, TFFlavour::kFlavNumuCC>(); }
+    float GetNueProbability()   const { return Get<TFMultioutputs::flavour, TFFlavour::kFlavNueCC>(); }
+    float GetNutauProbability() const { return Get<TFMultioutputs::flavour, TFFlavour::kFlavNutauCC>(); }
+    float GetNCProbability()    const { return Get<TFMultioutputs::flavour, TFFlavour::kFlavNC>(); }
+
+    float GetQEProbability()    const { return Get<TFMultioutputs::interaction, TFInteraction::kInteQECC>(); }
+    float GetResProbability()   const { return Get<TFMultioutputs::interaction, TFInteraction::kInteResCC>(); }
+    float GetDISProbability()   const { return Get<TFMultioutputs::interaction, TFInteraction::kInteDISCC>(); }
+    float GetOtherProbability() const { return Get<TFMultioutputs::interaction, TFInteraction::kInteOtherCC>(); }
+
+    float Get0protonsProbability() const { return Get<TFMultioutputs::protons, TFTopologyProtons::kTop0proton>(); }
+    float Get1protonsProbability() const { return Get<TFMultioutputs::protons, TFTopologyProtons::kTop1proton>(); }
+    float Get2protonsProbability() const { return Get<TFMultioutputs::protons, TFTopologyProtons::kTop2proton>(); }
+    float GetNprotonsProbability() const { return Get<TFMultioutputs::protons, TFTopologyProtons::kTopNproton>(); }
+
+    float Get0pionsProbability() const { return Get<TFMultioutputs::pions, TFTopologyPions::kTop0pion>(); }
+    float Get1pionsProbability() const { return Get<TFMultioutputs::pions, TFTopologyPions::kTop1pion>(); }
+    float Get2pionsProbability() const { return Get<TFMultioutputs::pions, TFTopologyPions::kTop2pion>(); }
+    float GetNpionsProbability() const { return Get<TFMultioutputs::pions, TFTopologyPions::kTopNpion>(); }
+
+    float Get0pizerosProbability() const { return Get<TFMultioutputs::pizeros, TFTopologyPizeros::kTop0pizero>(); }
+    float Get1pizerosProbability() const { return Get<TFMultioutputs::pizeros, TFTopologyPizeros::kTop1pizero>(); }
+    float Get2pizerosProbability() const { return Get<TFMultioutputs::pizeros, TFTopologyPizeros::kTop2pizero>(); }
+    float GetNpizerosProbability() const { return Get<TFMultioutputs::pizeros, TFTopologyPizeros::kTopNpizero>(); }
+
+    float Get0neutronsProbability() const { return Get<TFMultioutputs::neutrons, TFTopologyNeutrons::kTop0neutron>(); }
+    float Get1neutronsProbability() const { return Get<TFMultioutputs::neutrons, TFTopologyNeutrons::kTop1neutron>(); }
+    float Get2neutronsProbability() const { return Get<TFMultioutputs::neutrons, TFTopologyNeutrons::kTop2neutron>(); }
+    float GetNneutronsProbability() const { return Get<TFMultioutputs::neutrons, TFTopologyNeutrons::kTopNneutron>(); }
+
+    uint16_t fValues[kNValues];  ///< All heads, in half precision
+
+  private:
+    template <unsigned int head, unsigned int entry>
+    float Get() const
+    {
+      static_assert(head < kNHeads && kHeadOffset[head] + entry < kHeadOffset[head + 1], "No such CVN output");
+      return HalfToFloat(fValues[kHeadOffset[head] + entry]);
+    }
+  };
+
+}
+
+#endif  // CVN_COMPACTRESULT_H
@@ -0,0 +1,30 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    DenseMapBranches.cxx
+/// \brief   Dense pixel map branches of the CVN training trees
+////////////////////////////////////////////////////////////////////////
+
+#include "TTree.h"
+
+#include "dunereco/CVN/func/DenseMapBranches.h"
+#include "dunereco/CVN/func/PixelMap.h"
+
+namespace cvn
+{
+
+  void DenseMapBranches::Book(TTree* tree)
+  {
+    tree->Branch("fPMap.fPE",  &fPE);
+    tree->Branch("fPMap.fPEX", &fPEX);
+    tree->Branch("fPMap.fPEY", &fPEY);
+    tree->Branch("fPMap.fPEZ", &fPEZ);
+  }
+
+  void DenseMapBranches::Set(const PixelMap& pm)
+  {
+    fPE  = pm.fPE;
+    fPEX = pm.fPEX;
+    fPEY = pm.fPEY;
+    fPEZ = pm.fPEZ;
+  }
+
+}
@@ -0,0 +1,43 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    DenseMapBranches.h
+/// \brief   Dense pixel map branches of the CVN training trees
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_DENSEMAPBRANCHES_H
+#define CVN_DENSEMAPBRANCHES_H
+
+#include <vector>
+
+class TTree;
+
+namespace cvn
+{
+
+  class PixelMap;
+
+  /// PixelMap only writes its sparse members, so the split TrainingData
+  /// branch of a training tree has no fPMap.fPE, fPEX, fPEY or fPEZ. The
+  /// readers of the trees (cvnCreateDB, cvnCreateZlibImages, Analyze.C)
+  /// take those with SetBranchAddress, where no ioread rule runs, so the
+  /// dumpers write the dense vectors as branches of the same names
+  class DenseMapBranches
+  {
+  public:
+
+    /// Add the branches to a tree holding a split "train" branch
+    void Book(TTree* tree);
+
+    /// Copy the vectors of the map about to be filled
+    void Set(const PixelMap& pm);
+
+  private:
+
+    std::vector<float> fPE;
+    std::vector<float> fPEX;
+    std::vector<float> fPEY;
+    std::vector<float> fPEZ;
+  };
+
+}
+
+#endif  // CVN_DENSEMAPBRANCHES_H
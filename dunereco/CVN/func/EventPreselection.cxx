@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    EventPreselection.cxx
+/// \brief   Cheap cuts deciding whether an event is worth a CVN pixel map
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Principal/Event.h"
+#include "canvas/Utilities/Exception.h"
+#include "lardataobj/RecoBase/Vertex.h"
+
+#include "dunereco/CVN/func/EventPreselection.h"
+#include "dunereco/HitFinderDUNE/HitCounting.h"
+
+namespace cvn
+{
+
+  EventPreselection::EventPreselection(const fhicl::ParameterSet& pset):
+  fEnable       (pset.get<bool>("Enable", false)),
+  fMinHits      (pset.get<unsigned int>("MinHits", 0)),
+  fMaxHits      (pset.get<unsigned int>("MaxHits", 0)),
+  fMaxHitsPerTPC(pset.get<bool>("MaxHitsPerTPC", false)),
+  fMinCharge    (pset.get<float>("MinCharge", 0.)),
+  fVertexLabel  (pset.get<std::string>("VertexLabel", "")),
+  fFiducialMin  (pset.get< std::vector<double> >("FiducialMin", {-310., -550., 50.})),
+  fFiducialMax  (pset.get< std::vector<double> >("FiducialMax", {310., 550., 1244.})),
+  fNPassed(0),
+  fNFailed(0)
+  {
+    if(fFiducialMin.size() != 3 || fFiducialMax.size() != 3)
+      throw art::Exception(art::errors::Configuration)
+        << "EventPreselection: FiducialMin and FiducialMax need x, y and z" << std::endl;
+  }
+
+  bool EventPreselection::Pass(const art::Event& evt, const std::vector< art::Ptr<recob::Hit> >& hits)
+  {
+    if(!fEnable) return true;
+
+    // The hit cuts first, they need nothing from the event
+    const bool pass = PassHits(hits) && PassVertex(evt);
+    if(pass) ++fNPassed;
+    else ++fNFailed;
+    return pass;
+  }
+
+  bool EventPreselection::PassHits(const std::vector< art::Ptr<recob::Hit> >& hits) const
+  {
+    if(hits.size() < fMinHits) return false;
+    if(fMaxHits > 0 && !hit::WithinHitLimit(hits, fMaxHits, fMaxHitsPerTPC)) return false;
+
+    if(fMinCharge > 0.){
+      float charge = 0.;
+      for(const art::Ptr<recob::Hit>& hit : hits){
+        charge += hit->Integral();
+        if(charge >= fMinCharge) return true;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  bool EventPreselection::PassVertex(const art::Event& evt) const
+  {
+    if(fVertexLabel.empty()) return true;
+
+    auto vertices = evt.getHandle< std::vector<recob::Vertex> >(fVertexLabel);
+    if(!vertices) return false;
+
+    for(const recob::Vertex& vertex : *vertices){
+      const recob::Vertex::Point_t position = vertex.position();
+      if(position.X() > fFiducialMin[0] && position.X() < fFiducialMax[0] &&
+         position.Y() > fFiducialMin[1] && position.Y() < fFiducialMax[1] &&
+         position.Z() > fFiducialMin[2] && position.Z() < fFiducialMax[2])
+        return true;
+    }
+    return false;
+  }
+
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    EventPreselection.h
+/// \brief   Cheap cuts deciding whether an event is worth a CVN pixel map
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_EVENTPRESELECTION_H
+#define CVN_EVENTPRESELECTION_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "canvas/Persistency/Common/Ptr.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "lardataobj/RecoBase/Hit.h"
+
+namespace art
+{
+  class Event;
+}
+
+namespace cvn
+{
+
+  /// Cuts on the hit count, the summed hit charge and the containment of
+  /// the reco vertex, applied before an event is mapped and evaluated so
+  /// that noise and low activity cosmic events don't cost network time.
+  /// The upper hit limit is the cut of NumberOfHitsFilter. Disabled unless
+  /// configured with Enable: true
+  class EventPreselection
+  {
+  public:
+
+    /// Reads Enable, MinHits, MaxHits, MaxHitsPerTPC, MinCharge,
+    /// VertexLabel, FiducialMin and FiducialMax, see CVNMapper.fcl
+    explicit EventPreselection(const fhicl::ParameterSet& pset = fhicl::ParameterSet());
+
+    bool Enabled() const { return fEnable; }
+
+    /// Whether the event passes, always true when disabled. Events without
+    /// a vertex fail the containment cut. Can be called for several events
+    /// at once
+    bool Pass(const art::Event& evt, const std::vector< art::Ptr<recob::Hit> >& hits);
+
+    unsigned int NPassed() const { return fNPassed; }
+    unsigned int NFailed() const { return fNFailed; }
+
+  private:
+
+    bool PassHits(const std::vector< art::Ptr<recob::Hit> >& hits) const;
+    bool PassVertex(const art::Event& evt) const;
+
+    bool fEnable;
+    unsigned int fMinHits;
+    unsigned int fMaxHits;      ///< 0 for no limit
+    bool fMaxHitsPerTPC;
+    float fMinCharge;           ///< Summed hit integral
+    std::string fVertexLabel;   ///< Empty for no containment cut
+    std::vector<double> fFiducialMin;
+    std::vector<double> fFiducialMax;
+
+    std::atomic<unsigned int> fNPassed;
+    std::atomic<unsigned int> fNFailed;
+  };
+
+}
+
+#endif  // CVN_EVENTPRESELECTION_H
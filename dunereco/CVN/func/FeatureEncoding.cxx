@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    FeatureEncoding.cxx
+/// \brief   Reduced precision storage of the CVN, GCN and CTP training records
+////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include "canvas/Utilities/Exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "dunereco/CVN/func/FeatureEncoding.h"
+
+namespace
+{
+  uint32_t FloatBits(float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  float BitsFloat(uint32_t bits)
+  {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  template <typename T>
+  void Append(T value, std::vector<unsigned char> &out)
+  {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+  }
+}
+
+namespace cvn
+{
+
+  EncodingConfig ReadEncodingConfig(const fhicl::ParameterSet &pset)
+  {
+    EncodingConfig config;
+
+    const std::string features = pset.get<std::string>("FeatureType", "float32");
+    if(features == "float32") config.features = FeatureType::kFloat32;
+    else if(features == "float16") config.features = FeatureType::kFloat16;
+    else if(features == "bfloat16") config.features = FeatureType::kBFloat16;
+    else
+      throw art::Exception(art::errors::Configuration)
+        << "Unknown FeatureType " << features << ", expected float32, float16 or bfloat16" << std::endl;
+
+    const std::string coordinates = pset.get<std::string>("CoordinateType", "float32");
+    if(coordinates == "float32") config.coordinates = CoordinateType::kFloat32;
+    else if(coordinates == "int16") config.coordinates = CoordinateType::kInt16;
+    else if(coordinates == "int32") config.coordinates = CoordinateType::kInt32;
+    else
+      throw art::Exception(art::errors::Configuration)
+        << "Unknown CoordinateType " << coordinates << ", expected float32, int16 or int32" << std::endl;
+
+    config.coordinateScale = pset.get<float>("CoordinateScale", config.coordinateScale);
+    config.featureScales = pset.get<std::vector<float>>("FeatureScales", config.featureScales);
+
+    if(!(config.coordinateScale > 0.f))
+      throw art::Exception(art::errors::Configuration)
+        << "CoordinateScale must be positive, not " << config.coordinateScale << std::endl;
+    for(const float scale : config.featureScales){
+      if(!(scale > 0.f))
+        throw art::Exception(art::errors::Configuration)
+          << "FeatureScales must be positive, not " << scale << std::endl;
+    }
+
+    return config;
+  }
+
+  std::string FeatureTypeName(FeatureType type)
+  {
+    switch(type){
+      case FeatureType::kFloat16: return "float16";
+      case FeatureType::kBFloat16: return "bfloat16";
+      default: return "float32";
+    }
+  }
+
+  std::string CoordinateTypeName(CoordinateType type)
+  {
+    switch(type){
+      case CoordinateType::kInt16: return "int16";
+      case CoordinateType::kInt32: return "int32";
+      default: return "float32";
+    }
+  }
+
+  unsigned int FeatureBytes(FeatureType type)
+  {
+    return type == FeatureType::kFloat32 ? 4 : 2;
+  }
+
+  unsigned int CoordinateBytes(CoordinateType type)
+  {
+    return type == CoordinateType::kInt16 ? 2 : 4;
+  }
+
+  uint16_t FloatToBFloat16(float value)
+  {
+    const uint32_t bits = FloatBits(value);
+    if((bits & 0x7fffffff) > 0x7f800000) return static_cast<uint16_t>((bits >> 16) | 0x40);
+    if((bits & 0x7fffffff) == 0x7f800000) return static_cast<uint16_t>(bits >> 16);
+
+    const uint32_t rounded = bits + 0x7fff + ((bits >> 16) & 1);
+    // A finite value rounding up to infinity saturates
+    if((rounded & 0x7f800000) == 0x7f800000) return static_cast<uint16_t>(((bits >> 16) & 0x8000) | 0x7f7f);
+    return static_cast<uint16_t>(rounded >> 16);
+  }
+
+  float BFloat16ToFloat(uint16_t bits)
+  {
+    return BitsFloat(static_cast<uint32_t>(bits) << 16);
+  }
+
+  FeatureEncoder::FeatureEncoder(const EncodingConfig &config):
+  fConfig(config),
+  fSaturated(0)
+  {
+  }
+
+  bool FeatureEncoder::IsFloat32() const
+  {
+    return fConfig.features == FeatureType::kFloat32 && fConfig.coordinates == CoordinateType::kFloat32;
+  }
+
+  float FeatureEncoder::FeatureScale(size_t column) const
+  {
+    return column < fConfig.featureScales.size() ? fConfig.featureScales[column] : 1.f;
+  }
+
+  uint16_t FeatureEncoder::EncodeFeature(float value, size_t column)
+  {
+    const float scaled = value / FeatureScale(column);
+    if(fConfig.features == FeatureType::kBFloat16){
+      if(std::abs(scaled) > std::numeric_limits<float>::max() * (1.f - 1.f/256.f)) ++fSaturated;
+      return FloatToBFloat16(scaled);
+    }
+    if(std::abs(scaled) > kMaxHalf) ++fSaturated;
+    return FloatToHalf(scaled);
+  }
+
+  int32_t FeatureEncoder::EncodeCoordinate(float value)
+  {
+    const double scaled = std::nearbyint(static_cast<double>(value) / fConfig.coordinateScale);
+    const double low = fConfig.coordinates == CoordinateType::kInt16 ?
+      std::numeric_limits<int16_t>::min() : std::numeric_limits<int32_t>::min();
+    const double high = fConfig.coordinates == CoordinateType::kInt16 ?
+      std::numeric_limits<int16_t>::max() : std::numeric_limits<int32_t>::max();
+    if(scaled < low || scaled > high || std::isnan(scaled)){
+      ++fSaturated;
+      return static_cast<int32_t>(scaled > high ? high : low);
+    }
+    return static_cast<int32_t>(scaled);
+  }
+
+  void FeatureEncoder::EncodeFeatures(const float *values, size_t n, size_t nColumns,
+                                      std::vector<unsigned char> &out)
+  {
+    out.reserve(out.size() + n*FeatureBytes(fConfig.features));
+    for(size_t i = 0; i < n; ++i){
+      if(fConfig.features == FeatureType::kFloat32) Append(values[i] / FeatureScale(i % nColumns), out);
+      else Append(EncodeFeature(values[i], i % nColumns), out);
+    }
+  }
+
+  void FeatureEncoder::EncodeCoordinates(const float *values, size_t n, std::vector<unsigned char> &out)
+  {
+    out.reserve(out.size() + n*CoordinateBytes(fConfig.coordinates));
+    for(size_t i = 0; i < n; ++i){
+      if(fConfig.coordinates == CoordinateType::kFloat32) Append(values[i], out);
+      else if(fConfig.coordinates == CoordinateType::kInt16) Append(static_cast<int16_t>(EncodeCoordinate(values[i])), out);
+      else Append(EncodeCoordinate(values[i]), out);
+    }
+  }
+
+  std::string FeatureEncoder::Describe(size_t nFeatureColumns) const
+  {
+    std::ostringstream description;
+    description << FeatureTypeName(fConfig.features) << " " << CoordinateTypeName(fConfig.coordinates)
+                << " " << fConfig.coordinateScale << " " << nFeatureColumns;
+    for(size_t column = 0; column < nFeatureColumns; ++column)
+      description << " " << FeatureScale(column);
+    return description.str();
+  }
+
+}
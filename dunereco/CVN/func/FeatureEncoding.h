@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    FeatureEncoding.h
+/// \brief   Reduced precision storage of the CVN, GCN and CTP training records
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_FEATUREENCODING_H
+#define CVN_FEATUREENCODING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dunereco/CVN/func/HalfFloat.h"
+
+namespace fhicl
+{
+  class ParameterSet;
+}
+
+namespace cvn
+{
+
+  /// Storage type of the feature columns
+  enum class FeatureType { kFloat32, kFloat16, kBFloat16 };
+
+  /// Storage type of the coordinate columns
+  enum class CoordinateType { kFloat32, kInt16, kInt32 };
+
+  struct EncodingConfig
+  {
+    FeatureType features = FeatureType::kFloat32;
+    CoordinateType coordinates = CoordinateType::kFloat32;
+    float coordinateScale = 1.f;      ///< coordinate step of the integer types, 1 for wire and tdc indices
+    std::vector<float> featureScales; ///< divisor of each feature column before the cast, empty for all 1
+  };
+
+  /// Read FeatureType ("float32", "float16" or "bfloat16"), CoordinateType
+  /// ("float32", "int16" or "int32"), CoordinateScale and FeatureScales, the
+  /// defaults keep float32. Throws for unknown types or non-positive scales
+  EncodingConfig ReadEncodingConfig(const fhicl::ParameterSet &pset);
+
+  std::string FeatureTypeName(FeatureType type);
+  std::string CoordinateTypeName(CoordinateType type);
+  /// Bytes of one stored value
+  unsigned int FeatureBytes(FeatureType type);
+  unsigned int CoordinateBytes(CoordinateType type);
+
+  /// bfloat16 conversions, rounding to nearest even. Finite values beyond
+  /// the range saturate to the largest finite value, as FloatToHalf does
+  uint16_t FloatToBFloat16(float value);
+  float BFloat16ToFloat(uint16_t bits);
+
+  /// Casts the columns of the training records to their storage type.
+  /// A feature of column c is stored as value / featureScales[c], a
+  /// coordinate as round(value / coordinateScale), so the reader restores
+  /// them by multiplying with the scale written next to the data. Values
+  /// outside the range of their type are clamped and counted.
+  /// Not thread safe, every writer owns its encoder
+  class FeatureEncoder
+  {
+  public:
+
+    explicit FeatureEncoder(const EncodingConfig &config = EncodingConfig());
+
+    const EncodingConfig &Config() const { return fConfig; }
+    /// Both types are float32, the records are written as before
+    bool IsFloat32() const;
+
+    /// Scale of a feature column, 1 past the configured ones
+    float FeatureScale(size_t column) const;
+
+    /// Stored bits of one feature, for the 16 bit types
+    uint16_t EncodeFeature(float value, size_t column);
+    /// Stored value of one coordinate, for the integer types
+    int32_t EncodeCoordinate(float value);
+
+    /// Append the stored bytes of n values of rows with nColumns columns,
+    /// value i belonging to column i % nColumns
+    void EncodeFeatures(const float *values, size_t n, size_t nColumns, std::vector<unsigned char> &out);
+    void EncodeCoordinates(const float *values, size_t n, std::vector<unsigned char> &out);
+
+    /// Values clamped to the range of their type so far
+    unsigned long Saturated() const { return fSaturated; }
+
+    /// Text description of the encoding for the info and index files,
+    /// "<feature type> <coordinate type> <coordinate scale> <n> <n feature scales>"
+    std::string Describe(size_t nFeatureColumns) const;
+
+  private:
+
+    EncodingConfig fConfig;
+    unsigned long fSaturated;
+  };
+
+}
+
+#endif  // CVN_FEATUREENCODING_H
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+#include <tuple>
 #include <vector>
 #include <iostream>
 #include <ctime>
@@ -12,10 +15,13 @@
 #include "lardataobj/RecoBase/PFParticle.h"
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/GCNGraphNode.h"
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SpacePointGrid.h"
+#include "dunereco/Profiling/ProfScope.h"
 
 #include "TVector3.h"
 
@@ -49,12 +55,19 @@ namespace cvn
 
     // Get the backtracker, then find the TrackIDE with the largest energy
     // deposit and return it
-    art::ServiceHandle<cheat::BackTrackerService> bt;
-    auto ides = bt->HitToTrackIDEs(clockData, hit);
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    return GetTrackIDFromHit(truth, hit);
+
+  } // function GCNFeatureUtils::GetTrackIDFromHit
+
+  int GCNFeatureUtils::GetTrackIDFromHit(dune_ana::DUNEAnaHitTruthCache& truth,
+                                         const recob::Hit& hit) const {
+
+    const std::vector<sim::TrackIDE>& ides = truth.GetTrackIDEs(hit);
     if (ides.empty()) return std::numeric_limits<int>::max(); // Return invalid number if no true tracks
     int id = 0;
     float energy = -1;
-    for (auto ide : ides) {
+    for (const sim::TrackIDE& ide : ides) {
       if (ide.energy > energy) {
         energy = ide.energy;
         id = ide.trackID;
@@ -64,8 +77,8 @@ namespace cvn
 
   } // function GCNFeatureUtils::GetTrackIDFromHit
 
-  pair<unsigned int, float> GCNFeatureUtils::GetClosestApproach(const SpacePoint sp,
-    const MCParticle p) const {
+  pair<unsigned int, float> GCNFeatureUtils::GetClosestApproach(const SpacePoint& sp,
+    const MCParticle& p) const {
 
     // Spacepoint 3D position
     geoalgo::Point_t spPos(sp.XYZ()[0], sp.XYZ()[1], sp.XYZ()[2]);
@@ -73,7 +86,7 @@ namespace cvn
     // Loop over trajectory segments and find point of closest approach
     unsigned int id = std::numeric_limits<unsigned int>::max();
     float dist = std::numeric_limits<float>::max();
-    simb::MCTrajectory traj = p.Trajectory();
+    const simb::MCTrajectory& traj = p.Trajectory();
     for (size_t it = 1; it < traj.size(); ++it) {
       geoalgo::Point_t p1(TVector3(traj.Position(it-1).Vect()));
       geoalgo::Point_t p2(TVector3(traj.Position(it).Vect()));
@@ -119,32 +132,7 @@ namespace cvn
 
   std::map<int,unsigned int> GCNFeatureUtils::GetAllNeighbours(art::Event const &evt, const float rangeCut, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
 
-    map<int,unsigned int> neighbourMap;
-
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      neighbourMap[sp0->ID()] = 0;
-
-      for(const Ptr<SpacePoint> sp1 : sps){
-
-        if(sp0->ID() == sp1->ID()) continue;
-
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-
-        if(dist < rangeCut){
-          ++neighbourMap[sp0->ID()];
-        }
-      }
-    }
-    return neighbourMap;
+    return GetNeighboursForRadii(evt, std::vector<float>(1, rangeCut), sps).front();
   } // function GetAllNeighbours
 
   // Sometimes we might want to know the number of neighbours within various radii
@@ -169,32 +157,18 @@ namespace cvn
 
   std::vector<std::map<int,unsigned int>> GCNFeatureUtils::GetNeighboursForRadii(art::Event const &evt,
     const std::vector<float>& rangeCuts, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
-    std::vector<std::map<int,unsigned int>> result;
-    // Initialise a map for each range cut value
-    for(unsigned int m = 0; m < rangeCuts.size(); ++m){
-      result.push_back(map<int,unsigned int>());
-    }
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      for(auto &m : result){
-        m[sp0->ID()] = 0;
-      }
-      for(const Ptr<SpacePoint> sp1 : sps){
-        if(sp0->ID() == sp1->ID()) continue;
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-        // Fill the maps if we satify the criteria
-        for(unsigned int r = 0; r < rangeCuts.size(); ++r){
-          if(dist < rangeCuts[r]){
-            result[r][sp0->ID()] = result[r][sp0->ID()] + 1;
-          }
-        }
+    DUNE_PROF_SCOPE("cvn::GCNFeatureUtils::GetNeighboursForRadii");
+    DUNE_PROF_COUNT("cvn::GCNFeatureUtils::GetNeighboursForRadii space points", sps.size());
+    // Voxels the size of the largest radius mean only adjacent voxels are searched
+    float maxCut = 0.;
+    for(const float cut : rangeCuts) maxCut = std::max(maxCut, cut);
+    const SpacePointGrid grid(sps, maxCut);
+    const std::vector<std::vector<unsigned int>> counts = grid.CountNeighbours(rangeCuts);
+
+    std::vector<std::map<int,unsigned int>> result(rangeCuts.size());
+    for(unsigned int r = 0; r < rangeCuts.size(); ++r){
+      for(unsigned int i = 0; i < sps.size(); ++i){
+        result[r][sps[i]->ID()] = counts[r][i];
       }
     }
     return result;
@@ -212,29 +186,13 @@ namespace cvn
 
   std::map<int,int> GCNFeatureUtils::GetNearestNeighbours(art::Event const &evt,
     const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
+    DUNE_PROF_SCOPE("cvn::GCNFeatureUtils::GetNearestNeighbours");
+    const SpacePointGrid grid(sps);
+    const std::vector<int> nearest = grid.NearestNeighbours();
     std::map<int,int> closestID;
-    std::map<int,float> closestDistance;
-    // Now loop over all of the space points and simultaneously fill our maps
-    // Get the space points from the event and make the map
-    for(const Ptr<SpacePoint> sp0 : sps){
+    for(unsigned int i = 0; i < sps.size(); ++i){
       // We want an entry even if it ends up being zero
-      closestID[sp0->ID()] = 0;
-      closestDistance[sp0->ID()] = 99999;
-      for(const Ptr<SpacePoint> sp1 : sps){
-        if(sp0->ID() == sp1->ID()) continue;
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-        if(dist < closestDistance[sp0->ID()]){
-          closestDistance[sp0->ID()] = dist;
-          closestID[sp0->ID()] = sp1->ID();
-        }
-      }
+      closestID[sps[i]->ID()] = (nearest[i] < 0) ? 0 : sps[nearest[i]]->ID();
     }
     return closestID;
   }
@@ -262,44 +220,14 @@ namespace cvn
 
   std::map<int,std::pair<int,int>> GCNFeatureUtils::GetTwoNearestNeighbours(art::Event const &evt,
     const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
-    std::map<int,int> closestID;
-    std::map<int,int> secondID;
-    // Now loop over all of the space points and simultaneously fill our maps
-    // Get the space points from the event and make the map
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      int thisSP = sp0->ID();
-      int closest = -1;
-      int second = -1;
-      float closestDist = 99999;
-      float secondDist = 99999;
-      for(const Ptr<SpacePoint> sp1 : sps){
-        if(thisSP == sp1->ID()) continue;
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-        if(dist < closestDist){
-          secondDist = closestDist;
-          closestDist = dist;
-          second = closest;
-          closest = sp1->ID();
-        }
-        else if(dist < secondDist){
-          secondDist = dist;
-          second = sp1->ID();
-        }
-      }
-      closestID.insert(std::make_pair(thisSP,closest));
-      secondID.insert(std::make_pair(thisSP,second));
-    }
+    DUNE_PROF_SCOPE("cvn::GCNFeatureUtils::GetTwoNearestNeighbours");
+    const SpacePointGrid grid(sps);
+    const std::vector<std::pair<int,int>> nearest = grid.TwoNearestNeighbours();
     map<int,pair<int,int>> finalMap;
-    for(unsigned int m = 0; m < closestID.size(); ++m){
-      finalMap[m] = std::make_pair(closestID[m],secondID[m]);
+    for(unsigned int i = 0; i < sps.size(); ++i){
+      const int closest = (nearest[i].first < 0) ? -1 : sps[nearest[i].first]->ID();
+      const int second = (nearest[i].second < 0) ? -1 : sps[nearest[i].second]->ID();
+      finalMap[sps[i]->ID()] = std::make_pair(closest,second);
     }
     return finalMap;
   }
@@ -317,42 +245,210 @@ namespace cvn
     return;
   }
 
-  // Use the association between space points and hits to return a charge
-  std::map<unsigned int, float> GCNFeatureUtils::GetSpacePointChargeMap(
+  // Radius graph edges with geometric edge features, so they need not be found again before training
+  void GCNFeatureUtils::SetRadiusEdges(cvn::GCNGraph &graph, const cvn::SpacePointGrid &grid, const float radius) const{
+    DUNE_PROF_SCOPE("cvn::GCNFeatureUtils::SetRadiusEdges");
+    if(grid.GetNumberOfPoints() != graph.GetNumberOfNodes()){
+      throw art::Exception(art::errors::LogicError)
+        << "GCNFeatureUtils::SetRadiusEdges(): the grid has " << grid.GetNumberOfPoints()
+        << " space points for " << graph.GetNumberOfNodes() << " nodes";
+    }
+
+    std::vector<unsigned int> offsets, targets;
+    grid.RadiusNeighbours(radius, offsets, targets);
+    const std::vector<int> nearest = grid.NearestNeighbours();
+
+    const unsigned int nEdgeFeatures = 3;
+    std::vector<float> features;
+    features.reserve(nEdgeFeatures*targets.size());
+    for(unsigned int n = 0; n < grid.GetNumberOfPoints(); ++n){
+      const SpacePoint &base = *grid.GetSpacePoint(n);
+      for(unsigned int e = offsets[n]; e < offsets[n+1]; ++e){
+        const SpacePoint &target = *grid.GetSpacePoint(targets[e]);
+        // Any node with an edge has a nearest neighbour
+        float dotProduct = -999.;
+        float angle = -999.;
+        GetAngleAndDotProduct(base, *grid.GetSpacePoint(nearest[n]), target, dotProduct, angle);
+        features.push_back((TVector3(target.XYZ()) - TVector3(base.XYZ())).Mag());
+        features.push_back(dotProduct);
+        features.push_back(angle);
+      }
+    }
+
+    graph.SetEdges(offsets, targets, features, nEdgeFeatures);
+  }
+
+  // Same plane neighbourhood edges of a hit graph, from a per plane (wire, time) cell index
+  void GCNFeatureUtils::SetHitEdges(cvn::GCNGraph &graph, const float wireRange, const float timeRange) const{
+    DUNE_PROF_SCOPE("cvn::GCNFeatureUtils::SetHitEdges");
+    if(!(wireRange > 0.) || !(timeRange > 0.)){
+      throw art::Exception(art::errors::Configuration)
+        << "GCNFeatureUtils::SetHitEdges(): need positive wire and time ranges, not "
+        << wireRange << " and " << timeRange;
+    }
+
+    // Cell of each node, and the nodes sorted by cell
+    struct Cell { long plane, wire, time; };
+    const unsigned int nNodes = graph.GetNumberOfNodes();
+    std::vector<Cell> cells(nNodes);
+    for(unsigned int n = 0; n < nNodes; ++n){
+      const float *pos = graph.GetNodePosition(n);
+      cells[n] = {std::lround(pos[0]), static_cast<long>(std::floor(pos[1]/wireRange)),
+        static_cast<long>(std::floor(pos[2]/timeRange))};
+    }
+    auto cellLess = [](const Cell &a, const Cell &b){
+      return std::tie(a.plane, a.wire, a.time) < std::tie(b.plane, b.wire, b.time);
+    };
+    std::vector<unsigned int> order(nNodes);
+    for(unsigned int n = 0; n < nNodes; ++n) order[n] = n;
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){
+      return cellLess(cells[a], cells[b]) || (!cellLess(cells[b], cells[a]) && a < b);
+    });
+    std::vector<Cell> sortedCells(nNodes);
+    for(unsigned int i = 0; i < nNodes; ++i) sortedCells[i] = cells[order[i]];
+
+    const unsigned int nEdgeFeatures = 2;
+    std::vector<unsigned int> offsets(1, 0), targets, neighbours;
+    std::vector<float> features;
+    for(unsigned int n = 0; n < nNodes; ++n){
+      const float *pos = graph.GetNodePosition(n);
+      neighbours.clear();
+      // The neighbours are in this cell or the ones next to it
+      for(long dw = -1; dw <= 1; ++dw){
+        for(long dt = -1; dt <= 1; ++dt){
+          const Cell cell = {cells[n].plane, cells[n].wire + dw, cells[n].time + dt};
+          const auto range = std::equal_range(sortedCells.begin(), sortedCells.end(), cell, cellLess);
+          for(auto it = range.first; it != range.second; ++it){
+            const unsigned int m = order[it - sortedCells.begin()];
+            if(m == n) continue;
+            const float *other = graph.GetNodePosition(m);
+            if(std::abs(other[1] - pos[1]) <= wireRange && std::abs(other[2] - pos[2]) <= timeRange)
+              neighbours.push_back(m);
+          }
+        }
+      }
+      std::sort(neighbours.begin(), neighbours.end());
+      for(const unsigned int m : neighbours){
+        const float *other = graph.GetNodePosition(m);
+        targets.push_back(m);
+        features.push_back(other[1] - pos[1]);
+        features.push_back(other[2] - pos[2]);
+      }
+      offsets.push_back(targets.size());
+    }
+
+    graph.SetEdges(offsets, targets, features, nEdgeFeatures);
+  }
+
+  namespace {
+    /// Space points of a module and their hits, for the functions that take a label
+    void GetSpacePointsAndHits(art::Event const &evt, const std::string &spLabel,
+      vector<Ptr<SpacePoint>> &spacePoints, vector<vector<Ptr<Hit>>> &sp2Hit){
+      auto spacePointHandle = evt.getHandle<vector<SpacePoint>>(spLabel);
+      if (!spacePointHandle) {
+        throw art::Exception(art::errors::LogicError)
+          << "Could not find spacepoints with module label "
+          << spLabel << "!";
+      }
+      art::fill_ptr_vector(spacePoints, spacePointHandle);
+      art::FindManyP<Hit> fmp(spacePointHandle, evt, spLabel);
+      sp2Hit.resize(spacePoints.size());
+      for (size_t spIdx = 0; spIdx < sp2Hit.size(); ++spIdx) {
+        sp2Hit[spIdx] = fmp.at(spIdx);
+      } // for spacepoint
+    }
+
+    /// Track ID with the largest sum of its weights. Equal sums go to the
+    /// lowest ID as an unsigned number, as the std::map this replaces did
+    template <typename T>
+    int MaxContributor(const vector<pair<int,T>> &contributions){
+      if (contributions.empty()) return 0;
+      auto best = contributions.begin();
+      for (auto it = contributions.begin(); it != contributions.end(); ++it) {
+        if (it->second > best->second || (it->second == best->second &&
+          static_cast<unsigned int>(it->first) < static_cast<unsigned int>(best->first))) best = it;
+      }
+      return best->first;
+    }
+
+    template <typename T>
+    void AddContribution(vector<pair<int,T>> &contributions, int id, T weight){
+      for (auto &c : contributions) {
+        if (c.first == id) { c.second += weight; return; }
+      }
+      contributions.emplace_back(id, weight);
+    }
+
+    /// Map keyed by space point ID from values indexed like the space points
+    template <typename T>
+    map<unsigned int, T> ToIDMap(vector<Ptr<SpacePoint>> const& spacePoints, vector<T> values){
+      map<unsigned int, T> ret;
+      for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
+        ret[spacePoints[spIdx]->ID()] = std::move(values[spIdx]);
+      }
+      return ret;
+    }
+  }
+
+  // Charge, hit width and optionally 2D features of every space point from one pass over its hits
+  GCNFeatureUtils::SpacePointFeatures GCNFeatureUtils::GetSpacePointFeatures(
     std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
-    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, bool include2D) const {
 
-    map<unsigned int, float> ret;
+    // The 2D features are a size-nine float vector for each spacepoint
+    // containing wire, time and charge for each of the associated hits.
+    // These features assume each spacepoint has a maximum of one hit
+    // associated from each plane, and will throw an exception if it finds a
+    // spacepoint derived from more than one hit on the same plane. Be warned!
 
-    for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
+    SpacePointFeatures ret;
+    const size_t nSP = spacePoints.size();
+    ret.charge.resize(nSP);
+    ret.meanHitRMS.resize(nSP);
+    if (include2D) ret.hits2D.assign(9*nSP, 0.);
+
+    for (size_t spIdx = 0; spIdx < nSP; ++spIdx) {
       float charge = 0.0;
-      for (Ptr<Hit> hit : sp2Hit[spIdx]) {
+      float chargeRMS = 0.0;
+      for (Ptr<Hit> const& hit : sp2Hit[spIdx]) {
         charge += hit->Integral();
-      }
-      ret[spacePoints[spIdx]->ID()] = charge;
-    }
+        chargeRMS += hit->RMS();
+        if (!include2D) continue;
+        float *feat = &ret.hits2D[9*spIdx + 3*hit->WireID().Plane];
+        // Throw an error if this plane's info has already been filled
+        if (feat[2] != 0) {
+          std::ostringstream err;
+          err << "2D features for plane " << hit->WireID().Plane << " have already been "
+          << "filled.";
+          throw std::runtime_error(err.str());
+        }
+        feat[0] = hit->WireID().Wire;
+        feat[1] = hit->PeakTime();
+        feat[2] = hit->Integral();
+      } // for hit
+      ret.charge[spIdx] = charge;
+      ret.meanHitRMS[spIdx] = chargeRMS / static_cast<float>(sp2Hit[spIdx].size());
+    } // for spacepoint
 
     return ret;
 
+  } // function GetSpacePointFeatures
+
+  // Use the association between space points and hits to return a charge
+  std::map<unsigned int, float> GCNFeatureUtils::GetSpacePointChargeMap(
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
+
+    return ToIDMap(spacePoints, GetSpacePointFeatures(spacePoints, sp2Hit, false).charge);
+
   } // function GetSpacePointChargeMap
 
   std::map<unsigned int, float> GCNFeatureUtils::GetSpacePointChargeMap(
     art::Event const &evt, const std::string &spLabel) const {
 
     vector<Ptr<SpacePoint>> spacePoints;
-    auto spacePointHandle = evt.getHandle<vector<SpacePoint>>(spLabel);
-    if (!spacePointHandle) {
-      throw art::Exception(art::errors::LogicError)
-        << "Could not find spacepoints with module label "
-        << spLabel << "!";
-    }
-    art::fill_ptr_vector(spacePoints, spacePointHandle);
-    art::FindManyP<Hit> fmp(spacePointHandle, evt, spLabel);
-    vector<vector<Ptr<Hit>>> sp2Hit(spacePoints.size());
-    for (size_t spIdx = 0; spIdx < sp2Hit.size(); ++spIdx) {
-      sp2Hit[spIdx] = fmp.at(spIdx);
-    } // for spacepoint
-
+    vector<vector<Ptr<Hit>>> sp2Hit;
+    GetSpacePointsAndHits(evt, spLabel, spacePoints, sp2Hit);
     return GetSpacePointChargeMap(spacePoints, sp2Hit);
 
   } // function GetSpacePointChargeMap
@@ -360,50 +456,56 @@ namespace cvn
   std::map<unsigned int, float> GCNFeatureUtils::GetSpacePointMeanHitRMSMap(
     art::Event const &evt, const std::string &spLabel) const {
 
-    map<unsigned int, float> ret;
+    vector<Ptr<SpacePoint>> spacePoints;
+    vector<vector<Ptr<Hit>>> sp2Hit;
+    GetSpacePointsAndHits(evt, spLabel, spacePoints, sp2Hit);
+    return ToIDMap(spacePoints, GetSpacePointFeatures(spacePoints, sp2Hit, false).meanHitRMS);
 
-    // Get the hits associated to the space points
-    auto allSP = evt.getValidHandle<vector<SpacePoint>>(spLabel);
-    const art::FindManyP<Hit> sp2Hit(allSP, evt, spLabel);
+  } // function GetSpacePointMeanHitRMSMap
 
-    for (size_t itSP = 0; itSP < allSP->size(); ++itSP) {
-      const SpacePoint& sp = allSP->at(itSP);
-      float chargeRMS = 0.0;
-      const vector<Ptr<Hit>> spHits = sp2Hit.at(itSP);
-      unsigned int nHits = spHits.size();
-      for (auto const hit : spHits) {
-        chargeRMS += hit->RMS();
+  // True G4 ID of every space point, by the energy or the number of hits of each particle
+  std::vector<int> GCNFeatureUtils::GetTrueG4IDs(
+    dune_ana::DUNEAnaHitTruthCache& truth,
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, bool useHits) const {
+
+    vector<int> ret(spacePoints.size());
+    vector<pair<int,float>> trueParticles;
+    vector<pair<int,unsigned int>> trueParticleHits;
+
+    for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
+      // Use the backtracker to find the G4 IDs associated with these hits
+      trueParticles.clear();
+      trueParticleHits.clear();
+      for (art::Ptr<recob::Hit> const& hit : sp2Hit[spIdx]) {
+        for (auto const& ide : truth.GetTrackIDEs(hit)) {
+          if (useHits) AddContribution(trueParticleHits, ide.trackID, 1u);
+          else AddContribution(trueParticles, ide.trackID, ide.energy);
+        }
       }
-      ret[sp.ID()] = chargeRMS / static_cast<float>(nHits);
+      ret[spIdx] = useHits ? MaxContributor(trueParticleHits) : MaxContributor(trueParticles);
     }
-
     return ret;
 
-  } // function GetSpacePointMeanHitRMSMap
+  } // function GetTrueG4IDs
 
   std::map<unsigned int, int> GCNFeatureUtils::GetTrueG4ID(
     detinfo::DetectorClocksData const& clockData,
     std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
     std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
 
-    ServiceHandle<BackTrackerService> bt;
-    map<unsigned int, int> ret;
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(sp2Hit);
+    return GetTrueG4ID(truth, spacePoints, sp2Hit);
 
-    for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
-      // Use the backtracker to find the G4 IDs associated with these hits
-      std::map<unsigned int, float> trueParticles;
-      for (art::Ptr<recob::Hit> hit : sp2Hit[spIdx]) {
-        auto ides = bt->HitToTrackIDEs(clockData, hit);
-        for (auto ide : ides) {
-          int id = ide.trackID;
-          if (trueParticles.count(id)) trueParticles[id] += ide.energy;
-          else trueParticles[id] = ide.energy;
-        }
-      }
-      ret[spacePoints[spIdx]->ID()] = std::max_element(trueParticles.begin(), trueParticles.end(), [](const pair<unsigned int, float> &lhs,
-        const pair<unsigned int, float> &rhs) { return lhs.second < rhs.second; })->first;
-    }
-    return ret;
+  } // function GetTrueG4ID
+
+  std::map<unsigned int, int> GCNFeatureUtils::GetTrueG4ID(
+    dune_ana::DUNEAnaHitTruthCache& truth,
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
+
+    return ToIDMap(spacePoints, GetTrueG4IDs(truth, spacePoints, sp2Hit, false));
 
   } // function GetTrueG4ID
 
@@ -412,19 +514,8 @@ namespace cvn
     art::Event const &evt, const std::string &spLabel) const {
 
     vector<Ptr<SpacePoint>> spacePoints;
-    auto spacePointHandle = evt.getHandle<vector<SpacePoint>>(spLabel);
-    if (!spacePointHandle) {
-
-      throw art::Exception(art::errors::LogicError)
-        << "Could not find spacepoints with module label "
-        << spLabel << "!";
-    }
-    art::fill_ptr_vector(spacePoints, spacePointHandle);
-    art::FindManyP<Hit> fmp(spacePointHandle, evt, spLabel);
-    vector<vector<Ptr<Hit>>> sp2Hit(spacePoints.size());
-    for (size_t spIdx = 0; spIdx < sp2Hit.size(); ++spIdx) {
-      sp2Hit[spIdx] = fmp.at(spIdx);
-    } // for spacepoint
+    vector<vector<Ptr<Hit>>> sp2Hit;
+    GetSpacePointsAndHits(evt, spLabel, spacePoints, sp2Hit);
     return GetTrueG4ID(clockData, spacePoints, sp2Hit);
 
   } // function GetTrueG4ID
@@ -434,24 +525,18 @@ namespace cvn
     std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
     std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
 
-    ServiceHandle<BackTrackerService> bt;
-    map<unsigned int, int> ret;
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(sp2Hit);
+    return GetTrueG4IDFromHits(truth, spacePoints, sp2Hit);
 
-    for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
-      // Use the backtracker to find the G4 IDs associated with these hits
-      std::map<unsigned int, unsigned int> trueParticleHits;
-      for (art::Ptr<recob::Hit> hit : sp2Hit[spIdx]) {
-        auto ides = bt->HitToTrackIDEs(clockData, hit);
-        for (auto ide : ides) {
-          int id = ide.trackID;
-          if (trueParticleHits.count(id)) trueParticleHits[id] += 1;
-          else trueParticleHits[id] = 1;
-        }
-      }
-      ret[spacePoints[spIdx]->ID()] = std::max_element(trueParticleHits.begin(), trueParticleHits.end(), [](const pair<unsigned int, unsigned> &lhs,
-        const pair<unsigned int, unsigned int> &rhs) { return lhs.second < rhs.second; })->first;
-    }
-    return ret;
+  } // function GetTrueG4IDFromHits
+
+  std::map<unsigned int, int> GCNFeatureUtils::GetTrueG4IDFromHits(
+    dune_ana::DUNEAnaHitTruthCache& truth,
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
+
+    return ToIDMap(spacePoints, GetTrueG4IDs(truth, spacePoints, sp2Hit, true));
 
   } // function GetTrueG4IDFromHits
 
@@ -460,81 +545,64 @@ namespace cvn
     art::Event const &evt, const std::string &spLabel) const {
 
     vector<Ptr<SpacePoint>> spacePoints;
-    auto spacePointHandle = evt.getHandle<vector<SpacePoint>>(spLabel);
-    if (!spacePointHandle) {
-
-      throw art::Exception(art::errors::LogicError)
-        << "Could not find spacepoints with module label "
-        << spLabel << "!";
-    }
-    art::fill_ptr_vector(spacePoints, spacePointHandle);
-    art::FindManyP<Hit> fmp(spacePointHandle, evt, spLabel);
-    vector<vector<Ptr<Hit>>> sp2Hit(spacePoints.size());
-    for (size_t spIdx = 0; spIdx < sp2Hit.size(); ++spIdx) {
-      sp2Hit[spIdx] = fmp.at(spIdx);
-    } // for spacepoint
+    vector<vector<Ptr<Hit>>> sp2Hit;
+    GetSpacePointsAndHits(evt, spLabel, spacePoints, sp2Hit);
     return GetTrueG4IDFromHits(clockData, spacePoints, sp2Hit);
 
   } // function GetTrueG4IDFromHits
 
+  // True PDG code of every space point, indexed like the space points
+  std::vector<int> GCNFeatureUtils::GetTruePDGs(
+    dune_ana::DUNEAnaHitTruthCache& truth,
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, bool useAbsoluteTrackID, bool useHits) const {
+
+    vector<int> pdgs = GetTrueG4IDs(truth, spacePoints, sp2Hit, useHits);
+
+    ServiceHandle<ParticleInventoryService> pi;
+
+    // Now we need to get the true pdg code for each GEANT track ID
+    for (size_t spIdx = 0; spIdx < pdgs.size(); ++spIdx) {
+      int &id = pdgs[spIdx];
+      if(id == 0) mf::LogDebug("GCNFeatureUtils") << "Getting particle with ID " << id << " for space point " << spacePoints[spIdx]->ID();
+      else if(useAbsoluteTrackID || id >= 0) id = pi->TrackIdToParticle_P(abs(id))->PdgCode();
+      else id = 11; // Dummy value to flag EM activity
+    }
+
+    return pdgs;
+  } // function GetTruePDGs
+
   std::map<unsigned int, int> GCNFeatureUtils::GetTruePDG(
     detinfo::DetectorClocksData const& clockData,
     art::Event const& evt, const std::string &spLabel, bool useAbsoluteTrackID, bool useHits) const {
 
-    std::map<unsigned int, int> idMap;
-    if(useHits) idMap  = GetTrueG4IDFromHits(clockData, evt,spLabel);
-    else idMap = GetTrueG4ID(clockData, evt,spLabel);
+    vector<Ptr<SpacePoint>> spacePoints;
+    vector<vector<Ptr<Hit>>> sp2Hit;
+    GetSpacePointsAndHits(evt, spLabel, spacePoints, sp2Hit);
 
-    map<unsigned int,int> pdgMap;
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(sp2Hit);
+    return GetTruePDG(truth, spacePoints, sp2Hit, useAbsoluteTrackID, useHits);
 
-    ServiceHandle<ParticleInventoryService> pi;
+  } // function GetTruePDG
 
-    // Now we need to get the true pdg code for each GEANT track ID in the map
-    for(const pair<unsigned int, int> m : idMap){
-      int pdg = 0;
-      if(m.second == 0) std::cout << "Getting particle with ID " << m.second << " for space point " << m.first << std::endl;
-      else{
-        int trackID = m.second;
-        if(useAbsoluteTrackID || trackID >= 0){
-          trackID = abs(trackID);
-          pdg = pi->TrackIdToParticle_P(trackID)->PdgCode();
-        }
-        else pdg = 11; // Dummy value to flag EM activity
-      }
-      pdgMap.insert(std::make_pair(m.first,pdg));
-    }
+  std::map<unsigned int, int> GCNFeatureUtils::GetTruePDG(
+    dune_ana::DUNEAnaHitTruthCache& truth,
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, bool useAbsoluteTrackID, bool useHits) const {
 
-    return pdgMap;
-  } // function GetTrueG4ID
+    return ToIDMap(spacePoints, GetTruePDGs(truth, spacePoints, sp2Hit, useAbsoluteTrackID, useHits));
+
+  } // function GetTruePDG
 
   std::map<unsigned int, std::vector<float>> GCNFeatureUtils::Get2DFeatures(
     std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
     std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const {
 
-    // For each spacepoint, we want a size-nine float vector containing wire,
-    // time and charge for each of the associated hits. These features assume
-    // each spacepoint has a maximum of one hit associated from each plane,
-    // and will throw an exception if it finds a spacepoint derived from
-    // more than one hit on the same plane. Be warned!
-
+    const vector<float> hits2D = GetSpacePointFeatures(spacePoints, sp2Hit, true).hits2D;
     map<unsigned int, vector<float>> ret;
     for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
-      vector<float> feat(9, 0.);
-      // Loop over hits
-      for (Ptr<Hit> hit : sp2Hit[spIdx]) {
-        int offset = 3 * hit->WireID().Plane;
-        // Throw an error if this plane's info has already been filled
-        if (feat[offset+2] != 0) {
-          std::ostringstream err;
-          err << "2D features for plane " << hit->WireID().Plane << " have already been "
-          << "filled.";
-          throw std::runtime_error(err.str());
-        }
-        feat[offset] = hit->WireID().Wire;
-        feat[offset+1] = hit->PeakTime();
-        feat[offset+2] = hit->Integral();
-      } // for hit
-      ret[spacePoints[spIdx]->ID()] = feat;
+      ret[spacePoints[spIdx]->ID()].assign(&hits2D[9*spIdx], &hits2D[9*spIdx] + 9);
     } // for spacepoint
     return ret;
 
@@ -545,26 +613,24 @@ namespace cvn
 
     // Each pixel map has three vectors of length (nWires*nTDCs)
     // Each value is the hit charge, and we will make GCNGraph for each view
-    vector<vector<float>> allViews;
-    allViews.push_back(pm.fPEX);
-    allViews.push_back(pm.fPEY);
-    allViews.push_back(pm.fPEZ);
+    const vector<float>* allViews[3] = {&pm.fPEX, &pm.fPEY, &pm.fPEZ};
 
     const unsigned int nWires = pm.fNWire;
     const unsigned int nTDCs = pm.fNTdc;
 
     vector<GCNGraph> outputGraphs;
 
-    for(unsigned int v = 0; v < allViews.size(); ++v){
+    for(unsigned int v = 0; v < 3; ++v){
 
       GCNGraph newGraph;
+      const vector<float>& view = *allViews[v];
 
       for(unsigned int w = 0; w < nWires; ++w){
 
         for(unsigned int t = 0; t < nTDCs; ++t){
 
           const unsigned int index = w*nTDCs + t;
-          const float charge = allViews[v][index];
+          const float charge = view[index];
 
           // If the charge is very small then ignore this pixel
           if(charge < chargeThreshold) continue;
@@ -574,8 +640,7 @@ namespace cvn
           // and the charge
           vector<float> features = {charge};
 
-          GCNGraphNode newNode(pos,features);
-          newGraph.AddNode(newNode);
+          newGraph.AddNode(pos,features);
         } // loop over TDCs
       } // loop over wires
       outputGraphs.push_back(newGraph);
@@ -587,53 +652,63 @@ namespace cvn
   std::map<unsigned int,unsigned int> GCNFeatureUtils::Get2DGraphNeighbourMap(const GCNGraph &g, const unsigned int npixel) const{
 
     map<unsigned int,unsigned int> neighbourMap;
+    const unsigned int nNodes = g.GetNumberOfNodes();
+    if(nNodes == 0) return neighbourMap;
+
+    // Count the nodes of the box around each node
+    // In this example npixel = 2.
+    //
+    // |---|---|---|---|---|---|---|
+    // |   |   |   |   |   |   |   |
+    // |---|---|---|---|---|---|---|
+    // |   | x | x | x | x | x |   |
+    // |---|---|---|---|---|---|---|
+    // |   | x | x | x | x | x |   |
+    // |---|---|---|---|---|---|---|
+    // |   | x | x |n1 | x | x |   | t
+    // |---|---|---|---|---|---|---|
+    // |   | x | x | x | x | x |   |
+    // |---|---|---|---|---|---|---|
+    // |   | x | x | x | x | x |   |
+    // |---|---|---|---|---|---|---|
+    // |   |   |   |   |   |   |   |
+    // |---|---|---|---|---|---|---|
+    //               w
+    //
+    // from a summed-area table of the node counts on the (wire, tdc) grid,
+    // so each box is four lookups instead of a pass over all the nodes.
+    // The box is cut at the edges of the grid.
+    vector<unsigned int> wires(nNodes), tdcs(nNodes);
+    unsigned int nWires = 0, nTDCs = 0;
+    for(unsigned int n = 0; n < nNodes; ++n){
+      const float *pos = g.GetNodePosition(n);
+      wires[n] = static_cast<unsigned int>(pos[0]);
+      tdcs[n] = static_cast<unsigned int>(pos[1]);
+      nWires = std::max(nWires, wires[n] + 1);
+      nTDCs = std::max(nTDCs, tdcs[n] + 1);
+    }
 
-    // Loop over the nodes and get the wire and tdc
-    for(unsigned int n1 = 0; n1 < g.GetNumberOfNodes(); ++n1){
-
-      neighbourMap[n1] = 0;
-      const GCNGraphNode &node1 = g.GetNode(n1);
-      const unsigned int w1 = static_cast<unsigned int>(node1.GetPosition()[0]);
-      const unsigned int t1 = static_cast<unsigned int>(node1.GetPosition()[1]);
-
-      // Loop over the nodes again to compare w,t coordinates
-      for(unsigned int n2 = 0; n2 < g.GetNumberOfNodes(); ++n2){
-
-        if(n1 == n2) continue;
-
-        const GCNGraphNode &node2 = g.GetNode(n2);
-        const unsigned int w2 = static_cast<unsigned int>(node2.GetPosition()[0]);
-        const unsigned int t2 = static_cast<unsigned int>(node2.GetPosition()[1]);
-
-        // Check if the box around the node for neighbours
-        // In this example npixel = 2.
-        //
-        // |---|---|---|---|---|---|---|
-        // |   |   |   |   |   |   |   |
-        // |---|---|---|---|---|---|---|
-        // |   | x | x | x | x | x |   |
-        // |---|---|---|---|---|---|---|
-        // |   | x | x | x | x | x |   |
-        // |---|---|---|---|---|---|---|
-        // |   | x | x |n1 | x | x |   | t
-        // |---|---|---|---|---|---|---|
-        // |   | x | x | x | x | x |   |
-        // |---|---|---|---|---|---|---|
-        // |   | x | x | x | x | x |   |
-        // |---|---|---|---|---|---|---|
-        // |   |   |   |   |   |   |   |
-        // |---|---|---|---|---|---|---|
-        //               w
-
-        if(w2 <= w1 + npixel && w2 >= w1 - npixel){
-          if(t2 <= t1 + npixel && t2 >= t1 - npixel){
-            neighbourMap[n1]++;
-          }
-        }
-
+    // sum[(w+1)*(nTDCs+1) + t+1] is the number of nodes with wire <= w and tdc <= t
+    const unsigned int stride = nTDCs + 1;
+    vector<unsigned int> sum((nWires + 1) * stride, 0);
+    for(unsigned int n = 0; n < nNodes; ++n) ++sum[(wires[n] + 1) * stride + tdcs[n] + 1];
+    for(unsigned int w = 1; w <= nWires; ++w){
+      for(unsigned int t = 1; t <= nTDCs; ++t){
+        sum[w * stride + t] += sum[(w - 1) * stride + t] + sum[w * stride + t - 1] - sum[(w - 1) * stride + t - 1];
       }
     }
 
+    for(unsigned int n = 0; n < nNodes; ++n){
+      const unsigned int wLow = wires[n] > npixel ? wires[n] - npixel : 0;
+      const unsigned int tLow = tdcs[n] > npixel ? tdcs[n] - npixel : 0;
+      const unsigned int wHigh = std::min(wires[n] + npixel, nWires - 1) + 1;
+      const unsigned int tHigh = std::min(tdcs[n] + npixel, nTDCs - 1) + 1;
+      const unsigned int inBox = sum[wHigh * stride + tHigh] - sum[wLow * stride + tHigh]
+                               - sum[wHigh * stride + tLow] + sum[wLow * stride + tLow];
+      // The node itself is in its box
+      neighbourMap.emplace_hint(neighbourMap.end(), n, inBox - 1);
+    }
+
     return neighbourMap;
 
   }
@@ -644,8 +719,19 @@ namespace cvn
     std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, float distCut,
     std::vector<std::vector<float>>* dirTruth) const{
 
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(sp2Hit);
+    return GetNodeGroundTruth(truth, spacePoints, sp2Hit, distCut, dirTruth);
+
+  } // function GCNFeatureUtils::GetNodeGroundTruth
+
+  std::vector<float> GCNFeatureUtils::GetNodeGroundTruth(
+    dune_ana::DUNEAnaHitTruthCache& truth,
+    std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+    std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, float distCut,
+    std::vector<std::vector<float>>* dirTruth) const{
+
     // Fetch cheat services
-    ServiceHandle<BackTrackerService> bt;
     ServiceHandle<ParticleInventoryService> pi;
 
     vector<float> ret(spacePoints.size(), -1);
@@ -687,7 +773,7 @@ namespace cvn
       int trueParticleID = std::numeric_limits<int>::max();
       bool firstHit = true;
       for (art::Ptr<recob::Hit> hit : sp2Hit[spIdx]) {
-        int trueID = GetTrackIDFromHit(clockData, *hit);
+        int trueID = GetTrackIDFromHit(truth, *hit);
         if (trueID == std::numeric_limits<int>::max()) {
           ++nNoHit;
           done = true;
@@ -713,7 +799,7 @@ namespace cvn
       }
 
       // Get the true particle, and find the closest MC trajectory point to spacepoint
-      MCParticle p = pi->TrackIdToParticle(abs(trueParticleID));
+      const MCParticle& p = pi->TrackIdToParticle(abs(trueParticleID));
       pair<unsigned int, float> closest = GetClosestApproach(*sp, p);
       dist.push_back(std::make_pair(spIdx, closest.second));
       trueIDs[spIdx] = abs(trueParticleID);
@@ -758,7 +844,7 @@ namespace cvn
     for (size_t spIdx = 0; spIdx < spacePoints.size(); ++spIdx) {
       // If this was a true node & we're storing direction, store it!
       if (ret[spIdx] && dirTruth) {
-        MCParticle p = pi->TrackIdToParticle(trueIDs[spIdx]);
+        const MCParticle& p = pi->TrackIdToParticle(trueIDs[spIdx]);
         TVector3 dir = p.Trajectory().Momentum(closestTrajPoint[spIdx]).Vect().Unit();
         for (size_t it = 0; it < 3; ++it) {
           dirTruth->at(spIdx).push_back(dir[it]);
@@ -779,43 +865,54 @@ namespace cvn
   } // function GCNFeatureUtils::GetNodeGroundTruth
 
   std::map<unsigned int, unsigned int> GCNFeatureUtils::GetParticleFlowMap(
-    const std::set<unsigned int>& particles) const {
+    const std::set<unsigned int>& particles,
+    const dune_ana::DUNEAnaMCParticleHierarchy& hierarchy) const {
 
-    ServiceHandle<ParticleInventoryService> pi;
     map<unsigned int, unsigned int> ret;
     for (int p : particles) {
       if (p == 0) continue; // No parent for the event primary
-      ret[p] = pi->TrackIdToParticle(abs(p)).Mother();
+      const size_t index = hierarchy.GetIndex(abs(p));
+      if (index == dune_ana::DUNEAnaMCParticleHierarchy::kInvalidIndex) {
+        throw art::Exception(art::errors::NotFound) << "No true particle with track ID " << abs(p);
+      }
+      ret[p] = hierarchy.GetParticle(index).Mother();
     }
     return ret;
 
   } // function GCNFeatureUtils::GetParticleFlowMap
 
   vector<ptruth> GCNFeatureUtils::GetParticleTree(
-    const cvn::GCNGraph* g) {
-
-    ServiceHandle<ParticleInventoryService> pi;
+    const cvn::GCNGraph* g,
+    const dune_ana::DUNEAnaMCParticleHierarchy& hierarchy) {
 
     set<int> trackIDs;
     for (unsigned int i = 0; i < g->GetNumberOfNodes(); ++i) {
-      trackIDs.insert(g->GetNode(i).GetGroundTruth()[0]);
+      trackIDs.insert(g->GetNodeGroundTruth(i)[0]);
     }
 
-    set<int> allIDs = trackIDs; // Copy original so we can safely modify it
+    // Indices of the particles in the hierarchy, by track ID
+    map<int, size_t> allIDs;
 
     vector<ptruth> ret;
 
-    // Add invisible particles to hierarchy
+    // Add invisible particles to hierarchy. The walk up stops at the first
+    // ancestor already added, since its own ancestors are added with it
     for (int id : trackIDs) {
-      const MCParticle* p = pi->TrackIdToParticle_P(abs(id));
-      while (p->Mother() != 0) {
-        allIDs.insert(abs(p->Mother()));
-        p = pi->TrackIdToParticle_P(abs(p->Mother()));
+      size_t index = hierarchy.GetIndex(abs(id));
+      if (index == dune_ana::DUNEAnaMCParticleHierarchy::kInvalidIndex) {
+        throw art::Exception(art::errors::NotFound) << "No true particle with track ID " << abs(id);
+      }
+      if (!allIDs.emplace(id, index).second) continue;
+      index = hierarchy.GetMotherIndex(index);
+      while (index != dune_ana::DUNEAnaMCParticleHierarchy::kInvalidIndex &&
+             allIDs.emplace(abs(hierarchy.GetParticle(index).TrackId()), index).second) {
+        index = hierarchy.GetMotherIndex(index);
       }
     }
 
-    for (int id : allIDs) {
-      const MCParticle* p = pi->TrackIdToParticle_P(abs(id));
+    for (const auto& idAndIndex : allIDs) {
+      const int id = idAndIndex.first;
+      const MCParticle* p = &hierarchy.GetParticle(idAndIndex.second);
 
       ret.push_back(std::make_tuple(abs(id), p->PdgCode(), p->Mother(),
         p->P(), p->Vx(), p->Vy(), p->Vz(), p->EndX(), p->EndY(), p->EndZ(),
@@ -26,6 +26,9 @@ namespace detinfo {
 
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SpacePointGrid.h"
+#include "dunereco/AnaUtils/DUNEAnaHitTruthCache.h"
+#include "dunereco/AnaUtils/DUNEAnaMCParticleHierarchy.h"
 
 namespace cvn
 {
@@ -41,8 +44,9 @@ namespace cvn
 
     /// Get primary true G4 ID for hit
     int GetTrackIDFromHit(detinfo::DetectorClocksData const& clockData, const recob::Hit&) const;
+    int GetTrackIDFromHit(dune_ana::DUNEAnaHitTruthCache& truth, const recob::Hit&) const;
     /// Get closest trajectory point for true particle given reconstructed spacepoint
-    std::pair<unsigned int, float> GetClosestApproach(const recob::SpacePoint sp, const simb::MCParticle p) const;
+    std::pair<unsigned int, float> GetClosestApproach(const recob::SpacePoint& sp, const simb::MCParticle& p) const;
 
     /// Get the number of neighbours within rangeCut cm of this space point
     unsigned int GetSpacePointNeighbours(const recob::SpacePoint &sp, art::Event const &evt, const float rangeCut, const std::string &spLabel) const;
@@ -53,6 +57,8 @@ namespace cvn
     std::map<int,unsigned int> GetAllNeighbours(art::Event const &evt, const float rangeCut, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const;
 
     /// Gets the number of nearest neigbours for each space point for a vector of cut values. Much more efficient that using the above functions multiple times.
+    /// These map versions use a SpacePointGrid internally; when several searches are needed for the same
+    /// points, build a SpacePointGrid once and use its flat vector results directly.
     std::vector<std::map<int,unsigned int>> GetNeighboursForRadii(art::Event const &evt, const std::vector<float>& rangeCuts, const std::string &spLabel) const;
     std::vector<std::map<int,unsigned int>> GetNeighboursForRadii(art::Event const &evt, const std::vector<float>& rangeCuts, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const;
     std::vector<std::map<int,unsigned int>> GetNeighboursForRadii(art::Event const &evt, const std::vector<float>& rangeCuts, const std::map<unsigned int,art::Ptr<recob::SpacePoint>> &sps) const;
@@ -69,6 +75,39 @@ namespace cvn
     /// Get the angle and the dot product between the vector from the base node to its neighbours
     void GetAngleAndDotProduct(const recob::SpacePoint &baseNode, const recob::SpacePoint &n1, const recob::SpacePoint &n2, float &dotProduct, float &angle) const;
 
+    /// Connect every node to the nodes closer than radius. The grid must hold the space points of the graph
+    /// nodes, in node order. Each edge gets three features: its length, and the dot product and angle between
+    /// the edge and the vector from the source node to its nearest neighbour
+    void SetRadiusEdges(cvn::GCNGraph &graph, const cvn::SpacePointGrid &grid, const float radius) const;
+
+    /// Connect every node of a hit graph, with (plane, wire, time) positions, to the nodes of the same plane
+    /// within wireRange wires and timeRange ticks. The hits are binned in (wire, time) cells of that size per
+    /// plane, so only the neighbouring cells are searched. Each edge gets two features: its wire and time
+    /// differences
+    void SetHitEdges(cvn::GCNGraph &graph, const float wireRange, const float timeRange) const;
+
+    /// Per space point features, indexed like the space point vector
+    struct SpacePointFeatures {
+      std::vector<float> charge;      ///< Sum of the hit integrals
+      std::vector<float> meanHitRMS;  ///< Mean RMS of the hits
+      std::vector<float> hits2D;      ///< Wire, time and charge of the hit on each plane, nine per space point
+    };
+    /// Get the features of every space point from one pass over the hits. The 2D features are only filled
+    /// if include2D is set, and throw if a space point has two hits on a plane
+    SpacePointFeatures GetSpacePointFeatures(std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+                                             std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit,
+                                             bool include2D) const;
+    /// Get the true G4 ID of every space point, indexed like the space point vector, by the energy or the
+    /// number of hits (useHits) of each particle. 0 for a space point without any truth
+    std::vector<int> GetTrueG4IDs(dune_ana::DUNEAnaHitTruthCache& truth,
+                                  std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+                                  std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, bool useHits) const;
+    /// Get the true pdg code of every space point, indexed like the space point vector
+    std::vector<int> GetTruePDGs(dune_ana::DUNEAnaHitTruthCache& truth,
+                                 std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+                                 std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit,
+                                 bool useAbsoluteTrackID, bool useHits) const;
+
     /// Use the association between space points and hits to return a charge
     std::map<unsigned int, float> GetSpacePointChargeMap(std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
                                                          std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const;
@@ -83,6 +122,10 @@ namespace cvn
                                             std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const;
     std::map<unsigned int, int> GetTrueG4ID(detinfo::DetectorClocksData const& clockData,
                                             art::Event const& evt, const std::string &spLabel) const;
+    /// As above, reading the TrackIDEs of the hits from a truth cache shared with the caller
+    std::map<unsigned int, int> GetTrueG4ID(dune_ana::DUNEAnaHitTruthCache& truth,
+                                            std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+                                            std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const;
     /// Get the true G4 ID for each spacepoint using energy matching
     std::map<unsigned int, int> GetTrueG4IDFromHits(
       detinfo::DetectorClocksData const& clockData,
@@ -91,11 +134,19 @@ namespace cvn
     std::map<unsigned int, int> GetTrueG4IDFromHits(
       detinfo::DetectorClocksData const& clockData,
       art::Event const& evt, const std::string &spLabel) const;
+    std::map<unsigned int, int> GetTrueG4IDFromHits(
+      dune_ana::DUNEAnaHitTruthCache& truth,
+      std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+      std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit) const;
 
     /// Get the true pdg code for each spacepoint
     std::map<unsigned int, int> GetTruePDG(
       detinfo::DetectorClocksData const& clockData,
       art::Event const& evt, const std::string &spLabel, bool useAbsoluteTrackID, bool useHits) const;
+    std::map<unsigned int, int> GetTruePDG(
+      dune_ana::DUNEAnaHitTruthCache& truth,
+      std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+      std::vector<std::vector<art::Ptr<recob::Hit>>> const& sp2Hit, bool useAbsoluteTrackID, bool useHits) const;
     /// Get 2D hit features for a given spacepoint
     std::map<unsigned int, std::vector<float>> Get2DFeatures(
       std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
@@ -112,10 +163,18 @@ namespace cvn
                                           std::vector<std::vector<art::Ptr<recob::Hit>>> const& spToHit,
                                           float distCut,
                                           std::vector<std::vector<float>>* dirTruth=nullptr) const;
+    std::vector<float> GetNodeGroundTruth(dune_ana::DUNEAnaHitTruthCache& truth,
+                                          std::vector<art::Ptr<recob::SpacePoint>> const& spacePoints,
+                                          std::vector<std::vector<art::Ptr<recob::Hit>>> const& spToHit,
+                                          float distCut,
+                                          std::vector<std::vector<float>>* dirTruth=nullptr) const;
     /// Get hierarchy map from set of particles
-    std::map<unsigned int, unsigned int> GetParticleFlowMap(const std::set<unsigned int>& particles) const;
+    std::map<unsigned int, unsigned int> GetParticleFlowMap(const std::set<unsigned int>& particles,
+                                                            const dune_ana::DUNEAnaMCParticleHierarchy& hierarchy) const;
 
-    static std::vector<ptruth> GetParticleTree(const cvn::GCNGraph* g);
+    /// Get the true particles of the graph nodes and all of their ancestors
+    static std::vector<ptruth> GetParticleTree(const cvn::GCNGraph* g,
+                                               const dune_ana::DUNEAnaMCParticleHierarchy& hierarchy);
 
   private:
 
@@ -4,119 +4,204 @@
 /// \author  Leigh H. Whitehead - leigh.howard.whitehead@cern.ch
 ///////////////////////////////////////////////////////////////////////
 
-#include <cassert>
 #include <iostream>
 #include <ostream>
+#include "cetlib_except/exception.h"
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/GCNGraphNode.h"
 
 namespace cvn
 {
 
-  GCNGraph::GCNGraph()
+  GCNGraph::GCNGraph():
+  fNNodes(0), fNCoordinates(0), fNFeatures(0), fNTruth(0), fNEdgeFeatures(0)
   {}
 
-  GCNGraph::GCNGraph(std::vector<GCNGraphNode> nodes):
-  fNodes(nodes)
+  GCNGraph::GCNGraph(const std::vector<GCNGraphNode>& nodes):
+  GCNGraph()
   {
-
+    if(!nodes.empty()){
+      Reserve(nodes.size(), nodes[0].GetPosition().size(), nodes[0].GetFeatures().size(),
+        nodes[0].GetGroundTruth().size());
+    }
+    for(const GCNGraphNode &node : nodes){
+      this->AddNode(node);
+    }
   }
 
-  GCNGraph::GCNGraph(std::vector<std::vector<float>> positions,std::vector<std::vector<float>> features)
+  GCNGraph::GCNGraph(const std::vector<std::vector<float>>& positions, const std::vector<std::vector<float>>& features):
+  GCNGraph()
   {
     if(positions.size() != features.size()){
-      std::cerr << "The number of nodes must be the same for the position and feature vectors" << std::endl;
-      assert(0);
+      throw cet::exception("GCNGraph") << "The number of nodes must be the same for the position and feature vectors";
     }
     for(unsigned int n = 0; n < positions.size(); ++n){
       this->AddNode(positions.at(n),features.at(n));
     }
   }
 
+  void GCNGraph::Reserve(unsigned int nNodes, unsigned int nCoordinates, unsigned int nFeatures, unsigned int nTruth){
+    CheckStrides(nCoordinates, nFeatures, nTruth);
+    fPositions.reserve(nNodes*fNCoordinates);
+    fFeatures.reserve(nNodes*fNFeatures);
+    fGroundTruth.reserve(nNodes*fNTruth);
+  }
+
+  void GCNGraph::CheckStrides(unsigned int nCoordinates, unsigned int nFeatures, unsigned int nTruth){
+    if(fNNodes == 0 && fPositions.empty() && fFeatures.empty() && fGroundTruth.empty()){
+      fNCoordinates = nCoordinates;
+      fNFeatures = nFeatures;
+      fNTruth = nTruth;
+    }
+    if(nCoordinates != fNCoordinates || nFeatures != fNFeatures || nTruth != fNTruth){
+      throw cet::exception("GCNGraph") << "All nodes must have " << fNCoordinates << " coordinates, "
+                                        << fNFeatures << " features and " << fNTruth << " ground truth values";
+    }
+  }
+
   // Add a new node
-  void GCNGraph::AddNode(std::vector<float> position, std::vector<float> features){
-    GCNGraphNode newNode(position,features);
-    AddNode(newNode);
+  void GCNGraph::AddNode(const std::vector<float>& position, const std::vector<float>& features){
+    CheckStrides(position.size(), features.size(), 0);
+    AddNode(position.data(), features.data());
   }
 
   // Add a new node
-  void GCNGraph::AddNode(std::vector<float> position, std::vector<float> features,
-    std::vector<float> groundTruth){
-    GCNGraphNode newNode(position,features,groundTruth);
-    AddNode(newNode);
+  void GCNGraph::AddNode(const std::vector<float>& position, const std::vector<float>& features,
+    const std::vector<float>& groundTruth){
+    CheckStrides(position.size(), features.size(), groundTruth.size());
+    AddNode(position.data(), features.data(), groundTruth.data());
   }
 
-  void GCNGraph::AddNode(cvn::GCNGraphNode node){
-    fNodes.push_back(node);
+  void GCNGraph::AddNode(const GCNGraphNode& node){
+    AddNode(node.GetPosition(), node.GetFeatures(), node.GetGroundTruth());
+  }
+
+  void GCNGraph::AddNode(const float* position, const float* features, const float* groundTruth){
+    fPositions.insert(fPositions.end(), position, position + fNCoordinates);
+    fFeatures.insert(fFeatures.end(), features, features + fNFeatures);
+    if(fNTruth > 0){
+      if(groundTruth == nullptr){
+        throw cet::exception("GCNGraph") << "AddNode(): the graph needs " << fNTruth << " ground truth values per node";
+      }
+      fGroundTruth.insert(fGroundTruth.end(), groundTruth, groundTruth + fNTruth);
+    }
+    ++fNNodes;
+  }
+
+  // Append a feature to all nodes, this changes the feature stride
+  void GCNGraph::AddFeature(const std::vector<float>& nodeValues){
+    if(nodeValues.size() != fNNodes){
+      throw cet::exception("GCNGraph") << "AddFeature(): need one value for each of the " << fNNodes << " nodes";
+    }
+
+    std::vector<float> features;
+    features.reserve(fNNodes*(fNFeatures + 1));
+    for(unsigned int n = 0; n < fNNodes; ++n){
+      const float *nodeFeatures = fFeatures.data() + n*fNFeatures;
+      features.insert(features.end(), nodeFeatures, nodeFeatures + fNFeatures);
+      features.push_back(nodeValues[n]);
+    }
+    fFeatures.swap(features);
+    ++fNFeatures;
   }
 
   // Get the number of nodes
   const unsigned int GCNGraph::GetNumberOfNodes() const{
-    return fNodes.size();
+    return fNNodes;
   }
 
   // Access nodes
-  const GCNGraphNode& GCNGraph::GetNode(const unsigned int index) const{
-    if(this->GetNumberOfNodes() == 0){
-      std::cerr << "GCNGraph::GetNode(): Can't access node with index " << index << std::endl;
-      assert(0);
+  const GCNGraphNode GCNGraph::GetNode(const unsigned int index) const{
+    if(index >= fNNodes){
+      throw cet::exception("GCNGraph") << "GetNode(): Can't access node with index " << index;
     }
 
-    return fNodes.at(index);
+    const float *pos = GetNodePosition(index);
+    const float *feat = GetNodeFeatures(index);
+    const float *truth = GetNodeGroundTruth(index);
+    return GCNGraphNode(std::vector<float>(pos, pos + fNCoordinates),
+      std::vector<float>(feat, feat + fNFeatures), std::vector<float>(truth, truth + fNTruth));
   }
 
-  GCNGraphNode& GCNGraph::GetNodeEditable(const unsigned int index){
-    if(this->GetNumberOfNodes() == 0){
-      std::cerr << "GCNGraph::GetNode(): Can't access node with index " << index << std::endl;
-      assert(0);
+  const float* GCNGraph::GetNodePosition(const unsigned int index) const{
+    return fPositions.data() + index*fNCoordinates;
+  }
+
+  const float* GCNGraph::GetNodeFeatures(const unsigned int index) const{
+    return fFeatures.data() + index*fNFeatures;
+  }
+
+  const float* GCNGraph::GetNodeGroundTruth(const unsigned int index) const{
+    return fGroundTruth.data() + index*fNTruth;
+  }
+
+  void GCNGraph::SetEdges(const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& targets){
+    if(offsets.size() != fNNodes + 1 || offsets.back() != targets.size()){
+      throw cet::exception("GCNGraph") << "SetEdges(): need " << fNNodes + 1 << " offsets ending at the number of targets";
     }
+    for(unsigned int n = 0; n < fNNodes; ++n){
+      if(offsets[n] > offsets[n+1])
+        throw cet::exception("GCNGraph") << "SetEdges(): the offsets of node " << n << " decrease";
+    }
+    for(const unsigned int target : targets){
+      if(target >= fNNodes)
+        throw cet::exception("GCNGraph") << "SetEdges(): edge target " << target << " is not one of the " << fNNodes << " nodes";
+    }
+    fEdgeOffsets = offsets;
+    fEdgeTargets = targets;
+    fNEdgeFeatures = 0;
+    fEdgeFeatures.clear();
+  }
 
-    return fNodes.at(index);
+  void GCNGraph::SetEdges(const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& targets,
+    const std::vector<float>& features, unsigned int nFeatures){
+    if(features.size() != targets.size()*nFeatures){
+      throw cet::exception("GCNGraph") << "SetEdges(): need " << nFeatures << " features for each of the "
+                                        << targets.size() << " edges";
+    }
+    SetEdges(offsets, targets);
+    fNEdgeFeatures = nFeatures;
+    fEdgeFeatures = features;
   }
 
   // Return minimum and maximum coordinate values
   const std::vector<std::pair<float,float>> GCNGraph::GetMinMaxPositions() const{
 
-    std::pair<float,float> dummyPair = std::make_pair(1.e6,-1.e6);
     std::vector<std::pair<float,float>> minMaxVals;
 
-    if(fNodes.size() == 0){
+    if(fNNodes == 0){
       std::cerr << "No nodes found in the graph, returning empty vector" << std::endl;
       return minMaxVals;
     }
 
-    // Initialise the vector of pairs for the number of coordinates
-    for(unsigned int i = 0; i < GetNumberOfNodeCoordinates(); ++i){
-      minMaxVals.push_back(dummyPair);
+    for(unsigned int p = 0; p < fNCoordinates; ++p){
+      minMaxVals.push_back(GetCoordinateMinMax(p));
     }
 
-    for(GCNGraphNode node : fNodes){
-      std::vector<float> nodePos = node.GetPosition();
-      for(unsigned int p = 0; p < nodePos.size(); ++p){
-        if(nodePos[p] < minMaxVals[p].first) minMaxVals[p].first = nodePos[p];
-        if(nodePos[p] > minMaxVals[p].second) minMaxVals[p].second = nodePos[p];
-      }
-    }
- 
     return minMaxVals;
-
   }
 
+  // The graph is an art product and may be read by several threads, so the
+  // ranges are worked out on each call rather than cached in the graph
   const std::pair<float,float> GCNGraph::GetCoordinateMinMax(unsigned int coord) const{
-    if(coord > fNodes.size()){
-      std::cerr << "Node index is out of bounds" << std::endl;
-      assert(0);
+    if(coord >= fNCoordinates){
+      throw cet::exception("GCNGraph") << "Coordinate index " << coord << " is out of bounds";
     }
-    return this->GetMinMaxPositions()[coord];
+
+    std::pair<float,float> minMax = std::make_pair(1.e6,-1.e6);
+    for(unsigned int n = 0; n < fNNodes; ++n){
+      const float pos = fPositions[n*fNCoordinates + coord];
+      if(pos < minMax.first) minMax.first = pos;
+      if(pos > minMax.second) minMax.second = pos;
+    }
+    return minMax;
   }
 
   // Return spacial extent of the graph in all coordinates
   const std::vector<float> GCNGraph::GetSpacialExtent() const{
 
-    std::vector<std::pair<float,float>> minMaxVals = this->GetMinMaxPositions();
-
     std::vector<float> extent;
-    for(std::pair<float,float> pair : minMaxVals){
+    for(const std::pair<float,float> &pair : this->GetMinMaxPositions()){
       extent.push_back(pair.second - pair.first);
     }
 
@@ -124,11 +209,8 @@ namespace cvn
   }
 
   const float GCNGraph::GetCoordinateSpacialExtent(unsigned int coord) const{
-    if(coord > fNodes.size()){
-      std::cerr << "Node index is out of bounds" << std::endl;
-      assert(0);
-    }
-    return this->GetSpacialExtent()[coord];
+    const std::pair<float,float> minMax = this->GetCoordinateMinMax(coord);
+    return minMax.second - minMax.first;
   }
 
   // This function returns a vector of the format for a graph 
@@ -138,41 +220,70 @@ namespace cvn
   const std::vector<float> GCNGraph::ConvertGraphToVector() const{
 
     std::vector<float> nodeVector;
+    ConvertGraphToVector(nodeVector);
+    return nodeVector; 
+  }
 
-    for(const GCNGraphNode &node : fNodes){
+  void GCNGraph::ConvertGraphToVector(std::vector<float> &nodeVector) const{
+
+    nodeVector.clear();
+    nodeVector.reserve(fPositions.size() + fFeatures.size() + fGroundTruth.size());
+
+    for(unsigned int n = 0; n < fNNodes; ++n){
       // First add the position components
-      for(const float pos : node.GetPosition()){
-        nodeVector.push_back(pos);
-      }
+      const float *pos = GetNodePosition(n);
+      nodeVector.insert(nodeVector.end(), pos, pos + fNCoordinates);
       // Now add the features
-      for(const float feat : node.GetFeatures()){
-        nodeVector.push_back(feat);
-      }
+      const float *feat = GetNodeFeatures(n);
+      nodeVector.insert(nodeVector.end(), feat, feat + fNFeatures);
       // Now add the ground truth
-      for (const float truth : node.GetGroundTruth()) {
-        nodeVector.push_back(truth);
-      }
+      const float *truth = GetNodeGroundTruth(n);
+      nodeVector.insert(nodeVector.end(), truth, truth + fNTruth);
     }
+  }
 
-    return nodeVector; 
+  // The edges as rows of (source, target, edge_feature0, ... ,edge_featureK),
+  // grouped by source node
+  void GCNGraph::ConvertEdgesToVector(std::vector<float> &edgeVector) const{
+
+    edgeVector.clear();
+    edgeVector.reserve(fEdgeTargets.size()*(2 + fNEdgeFeatures));
+
+    for(unsigned int n = 0; n + 1 < fEdgeOffsets.size(); ++n){
+      for(unsigned int e = fEdgeOffsets[n]; e < fEdgeOffsets[n+1]; ++e){
+        edgeVector.push_back(n);
+        edgeVector.push_back(fEdgeTargets[e]);
+        const float *feat = GetEdgeFeatures(e);
+        edgeVector.insert(edgeVector.end(), feat, feat + fNEdgeFeatures);
+      }
+    }
   }
 
   // Return the number of coordinates for each node
   const unsigned int GCNGraph::GetNumberOfNodeCoordinates() const{
-    if(fNodes.size() == 0){
+    if(fNNodes == 0){
       std::cerr << "Graph has no nodes, returning 0" << std::endl;
       return 0;
     }
-    else return fNodes[0].GetNumberOfCoordinates();
+    else return fNCoordinates;
   }
 
   // Return the number of features for each node
   const unsigned int GCNGraph::GetNumberOfNodeFeatures() const{
-    if(fNodes.size() == 0){
+    if(fNNodes == 0){
+      std::cerr << "Graph has no nodes, returning 0" << std::endl;
+      return 0;
+    }
+    else return fNFeatures;
+  }
+
+  // Return the number of ground truth values for each node
+  const unsigned int GCNGraph::GetNumberOfNodeGroundTruth() const{
+    if(fNNodes == 0){
       std::cerr << "Graph has no nodes, returning 0" << std::endl;
       return 0;
     }
-    else return fNodes[0].GetNumberOfFeatures();
+    else return fNTruth;
   }
 
   std::ostream& operator<<(std::ostream& os, const GCNGraph& m)
@@ -15,6 +15,14 @@ namespace cvn
 {
 
   /// GCNGraph, basic input for the GCN
+  ///
+  /// The nodes are stored as three row-major matrices, [node][coordinate],
+  /// [node][feature] and [node][truth], each with a fixed stride taken from
+  /// the first node. The matrices can be handed to a tensor (e.g. from_blob
+  /// with shape {nodes, stride}) without copying. Optional edges are kept in
+  /// CSR form: the neighbours of node i are
+  /// targets[offsets[i]] ... targets[offsets[i+1]-1], and the edges may
+  /// carry a row-major [edge][feature] matrix in the same order
   class GCNGraph
   {
   public:
@@ -22,26 +30,57 @@ namespace cvn
     /// Default constructor
     GCNGraph();
     /// Constructor with position and feature vectors
-    GCNGraph(std::vector<std::vector<float>> positions, std::vector<std::vector<float>> features);
+    GCNGraph(const std::vector<std::vector<float>>& positions, const std::vector<std::vector<float>>& features);
     /// Construct graph from a vector of GCNGraphNodes
-    GCNGraph(std::vector<GCNGraphNode> nodes);
+    GCNGraph(const std::vector<GCNGraphNode>& nodes);
     /// Destructor
     ~GCNGraph(){};
 
-    /// Add a new node
-    void AddNode(std::vector<float> position, std::vector<float> features);
-    void AddNode(std::vector<float> position, std::vector<float> features,
-      std::vector<float> groundTruth);
-    void AddNode(GCNGraphNode node);
-    
+    /// Set the node strides and reserve space for a number of nodes
+    void Reserve(unsigned int nNodes, unsigned int nCoordinates, unsigned int nFeatures, unsigned int nTruth = 0);
+
+    /// Add a new node. All nodes must have the same number of coordinates,
+    /// features and truth values
+    void AddNode(const std::vector<float>& position, const std::vector<float>& features);
+    void AddNode(const std::vector<float>& position, const std::vector<float>& features,
+      const std::vector<float>& groundTruth);
+    void AddNode(const GCNGraphNode& node);
+    /// Add a node from arrays with the strides of the graph
+    void AddNode(const float* position, const float* features, const float* groundTruth = nullptr);
+
+    /// Append one feature to every node, nodeValues holds one value per node
+    void AddFeature(const std::vector<float>& nodeValues);
+
     /// Get the number of nodes
     const unsigned int GetNumberOfNodes() const;
 
-    /// Access nodes
-    const GCNGraphNode& GetNode(const unsigned int index) const;
-    GCNGraphNode& GetNodeEditable(const unsigned int index);
-
-    /// Return minimum and maximum position coordinate values 
+    /// Access nodes. This copies the node, use the array accessors below
+    /// in loops
+    const GCNGraphNode GetNode(const unsigned int index) const;
+
+    /// Pointers to the values of a single node
+    const float* GetNodePosition(const unsigned int index) const;
+    const float* GetNodeFeatures(const unsigned int index) const;
+    const float* GetNodeGroundTruth(const unsigned int index) const;
+
+    /// The node matrices, row-major with one row per node
+    const std::vector<float>& GetPositions() const { return fPositions; }
+    const std::vector<float>& GetFeatures() const { return fFeatures; }
+    const std::vector<float>& GetGroundTruth() const { return fGroundTruth; }
+
+    /// Set the edges in CSR form, offsets has one entry per node plus one
+    void SetEdges(const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& targets);
+    const std::vector<unsigned int>& GetEdgeOffsets() const { return fEdgeOffsets; }
+    const std::vector<unsigned int>& GetEdgeTargets() const { return fEdgeTargets; }
+    const unsigned int GetNumberOfEdges() const { return fEdgeTargets.size(); }
+    /// Set the edges with nFeatures values per edge, in the order of targets
+    void SetEdges(const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& targets,
+      const std::vector<float>& features, unsigned int nFeatures);
+    const std::vector<float>& GetEdgeFeatures() const { return fEdgeFeatures; }
+    const float* GetEdgeFeatures(const unsigned int index) const { return fEdgeFeatures.data() + index*fNEdgeFeatures; }
+    const unsigned int GetNumberOfEdgeFeatures() const { return fNEdgeFeatures; }
+
+    /// Return minimum and maximum position coordinate values
     const std::vector<std::pair<float,float>> GetMinMaxPositions() const;
     const std::pair<float,float> GetCoordinateMinMax(unsigned int index) const;
 
@@ -51,6 +90,10 @@ namespace cvn
 
     /// Function to linearise the graph to a vector for zlib file creation
     const std::vector<float> ConvertGraphToVector() const;
+    /// Linearise the graph into an existing vector, reusing its memory
+    void ConvertGraphToVector(std::vector<float>& nodeVector) const;
+    /// Linearise the edges as (source, target, features) rows
+    void ConvertEdgesToVector(std::vector<float>& edgeVector) const;
 
     /// Return the number of coordinates for each node
     const unsigned int GetNumberOfNodeCoordinates() const;
@@ -58,10 +101,27 @@ namespace cvn
     /// Return the number of features for each node
     const unsigned int GetNumberOfNodeFeatures() const;
 
+    /// Return the number of ground truth values for each node
+    const unsigned int GetNumberOfNodeGroundTruth() const;
+
   private:
 
-    /// Store the nodes
-    std::vector<GCNGraphNode> fNodes;
+    /// Set the strides from the first node, check them for the others
+    void CheckStrides(unsigned int nCoordinates, unsigned int nFeatures, unsigned int nTruth);
+
+    unsigned int fNNodes;       ///< Number of nodes
+    unsigned int fNCoordinates; ///< Coordinates per node
+    unsigned int fNFeatures;    ///< Features per node
+    unsigned int fNTruth;       ///< Ground truth values per node
+
+    std::vector<float> fPositions;   ///< Row-major, [node][coordinate]
+    std::vector<float> fFeatures;    ///< Row-major, [node][feature]
+    std::vector<float> fGroundTruth; ///< Row-major, [node][truth]
+
+    std::vector<unsigned int> fEdgeOffsets; ///< CSR offsets, empty without edges
+    std::vector<unsigned int> fEdgeTargets; ///< CSR neighbour indices
+    unsigned int fNEdgeFeatures;            ///< Features per edge
+    std::vector<float> fEdgeFeatures;       ///< Row-major, [edge][feature]
 
   };
 
@@ -32,19 +32,19 @@ namespace cvn
   }
 
   /// Get the node position
-  const std::vector<float> GCNGraphNode::GetPosition() const
+  const std::vector<float>& GCNGraphNode::GetPosition() const
   {
     return fPosition;
   }
 
   /// Get the node features
-  const std::vector<float> GCNGraphNode::GetFeatures() const
+  const std::vector<float>& GCNGraphNode::GetFeatures() const
   {
     return fFeatures;
   }
 
   /// Get the node truth
-  const std::vector<float> GCNGraphNode::GetGroundTruth() const
+  const std::vector<float>& GCNGraphNode::GetGroundTruth() const
   {
     return fGroundTruth;
   }
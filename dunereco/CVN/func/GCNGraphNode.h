@@ -28,9 +28,9 @@ namespace cvn
 		~GCNGraphNode(){};
 		
 		/// Get the node position, features or ground truth
-		const std::vector<float> GetPosition() const;
-		const std::vector<float> GetFeatures() const;
-		const std::vector<float> GetGroundTruth() const;
+		const std::vector<float>& GetPosition() const;
+		const std::vector<float>& GetFeatures() const;
+		const std::vector<float>& GetGroundTruth() const;
 
 		/// Add a node position coordinate
 		void AddPositionCoordinate(float pos);
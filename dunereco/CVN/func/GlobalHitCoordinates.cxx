@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    GlobalHitCoordinates.cxx
+/// \brief   Global wire, plane and time of the hits of one collection
+////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/CVN/func/GlobalHitCoordinates.h"
+
+namespace cvn
+{
+
+  GlobalHitCoordinates::GlobalHitCoordinates(int mapping, unsigned int nHits):
+    fMapping(mapping),
+    fWire(nHits, 0),
+    fPlane(nHits, kInvalid),
+    fTDC(nHits, 0.)
+  {
+  }
+
+  GlobalHitCoordinates::GlobalHitCoordinates():
+    fMapping(0)
+  {
+  }
+
+  void GlobalHitCoordinates::Set(unsigned int hit, unsigned int wire, unsigned int plane, double tdc)
+  {
+    fWire[hit] = wire;
+    fPlane[hit] = plane;
+    fTDC[hit] = tdc;
+  }
+
+}
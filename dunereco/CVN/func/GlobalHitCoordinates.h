@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    GlobalHitCoordinates.h
+/// \brief   Global wire, plane and time of the hits of one collection
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_GLOBALHITCOORDINATES_H
+#define CVN_GLOBALHITCOORDINATES_H
+
+#include <vector>
+
+namespace cvn
+{
+
+  /// Unwrapped global wire, plane and TDC of every hit of a hit collection,
+  /// indexed by the key of the hit in its collection. Made once per event
+  /// so that the pixel map makers run on the same hits share the geometry
+  /// conversion. Hits dropped by the conversion are flagged as invalid.
+  class GlobalHitCoordinates
+  {
+  public:
+    GlobalHitCoordinates(int mapping, unsigned int nHits);
+    GlobalHitCoordinates();
+
+    /// Global wire conversion used, a GlobalWireMapper::WireMapping
+    int Mapping() const { return fMapping; };
+    unsigned int NHits() const { return fWire.size(); };
+
+    void Set(unsigned int hit, unsigned int wire, unsigned int plane, double tdc);
+
+    bool IsValid(unsigned int hit) const { return hit < fPlane.size() && fPlane[hit] != kInvalid; };
+    unsigned int Wire(unsigned int hit) const { return fWire[hit]; };
+    unsigned int Plane(unsigned int hit) const { return fPlane[hit]; };
+    double TDC(unsigned int hit) const { return fTDC[hit]; };
+
+    static const unsigned short kInvalid = 0xffff;
+
+    int fMapping;                       ///< Global wire conversion used
+    std::vector<unsigned int> fWire;    ///< Global wire of each hit
+    std::vector<unsigned short> fPlane; ///< Global plane of each hit, kInvalid if dropped
+    std::vector<double> fTDC;           ///< Global time of each hit
+  };
+
+}
+
+#endif // CVN_GLOBALHITCOORDINATES_H
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    HalfFloat.cxx
+/// \brief   IEEE half precision conversions shared by the CVN products
+///          and the training record encoders
+////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/CVN/func/HalfFloat.h"
+
+namespace cvn
+{
+
+  uint16_t FloatToHalf(float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7fffffff;
+
+    // Infinity and NaN, keeping NaNs quiet
+    if(bits >= 0x7f800000) return sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00);
+    // 65520 and above would round to infinity
+    if(bits >= 0x477ff000) return sign | 0x7bff;
+
+    uint32_t half, remainder, halfway;
+    if(bits >= 0x38800000){
+      // Normal half: rebias the exponent and drop 13 bits of mantissa
+      bits -= 0x38000000;
+      half = bits >> 13;
+      remainder = bits & 0x1fff;
+      halfway = 0x1000;
+    }
+    else{
+      // Subnormal half, multiples of 2^-24, below 2^-25 rounds to zero
+      if(bits < 0x33000000) return sign;
+      const uint32_t exponent = bits >> 23;
+      const uint32_t mantissa = (bits & 0x7fffff) | 0x800000;
+      const uint32_t shift = 126 - exponent;
+      half = mantissa >> shift;
+      remainder = mantissa & ((1u << shift) - 1);
+      halfway = 1u << (shift - 1);
+    }
+
+    // Round to nearest even, a carry into the exponent is still correct
+    if(remainder > halfway || (remainder == halfway && (half & 1))) ++half;
+    return sign | half;
+  }
+
+}
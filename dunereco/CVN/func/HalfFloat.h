@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    HalfFloat.h
+/// \brief   IEEE half precision conversions shared by the CVN products
+///          and the training record encoders
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_HALFFLOAT_H
+#define CVN_HALFFLOAT_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace cvn
+{
+
+  /// Largest finite half precision value
+  constexpr float kMaxHalf = 65504.f;
+
+  /// Float to IEEE binary16, rounding to nearest even. Finite values that
+  /// would round beyond kMaxHalf saturate to +-kMaxHalf, infinities stay
+  /// infinite and NaNs become quiet NaNs
+  uint16_t FloatToHalf(float value);
+
+  /// IEEE binary16 to float, exact for every half
+  inline float HalfToFloat(uint16_t half)
+  {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+
+    // Subnormal halves are multiples of 2^-24, exact as floats
+    if(exponent == 0){
+      const float value = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+      return sign ? -value : value;
+    }
+
+    uint32_t bits = sign | (mantissa << 13);
+    if(exponent == 0x1f) bits |= 0x7f800000;
+    else bits |= (exponent + 112) << 23;
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+}
+
+#endif  // CVN_HALFFLOAT_H
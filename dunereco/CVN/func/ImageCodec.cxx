@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ImageCodec.cxx
+/// \brief   Compression of the CVN and GCN training records
+////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+#include <iterator>
+
+#include "canvas/Utilities/Exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/CVN/func/ImageCodec.h"
+
+// Compression
+#include "zlib.h"
+#ifdef DUNERECO_WITH_ZSTD
+#include "zstd.h"
+#include "zdict.h"
+#endif
+#ifdef DUNERECO_WITH_LZ4
+#include "lz4frame.h"
+#endif
+
+namespace cvn
+{
+
+  CodecConfig ReadCodecConfig(const fhicl::ParameterSet &pset)
+  {
+    CodecConfig config;
+    config.name = pset.get<std::string>("Codec", config.name);
+    config.level = pset.get<int>("CompressionLevel", config.level);
+    config.dictionary = pset.get<std::string>("ZstdDictionary", config.dictionary);
+    return config;
+  }
+
+  struct ImageCodec::ZstdState
+  {
+#ifdef DUNERECO_WITH_ZSTD
+    ZSTD_CCtx *context = nullptr;
+    ZSTD_CDict *dictionary = nullptr;
+
+    ~ZstdState()
+    {
+      ZSTD_freeCDict(dictionary);
+      ZSTD_freeCCtx(context);
+    }
+#endif
+  };
+
+  ImageCodec::ImageCodec(const CodecConfig &config):
+  fConfig(config)
+  {
+    if(fConfig.name != "zstd" && !fConfig.dictionary.empty())
+      throw art::Exception(art::errors::Configuration)
+        << "ImageCodec: a dictionary is only used by zstd, not " << fConfig.name << std::endl;
+
+    if(fConfig.name == "zlib"){
+      if(fConfig.level < 0 || fConfig.level > 9)
+        throw art::Exception(art::errors::Configuration)
+          << "ImageCodec: zlib level " << fConfig.level << " is not in 0-9" << std::endl;
+    }
+    else if(fConfig.name == "zstd"){
+#ifdef DUNERECO_WITH_ZSTD
+      fZstd = std::make_unique<ZstdState>();
+      fZstd->context = ZSTD_createCCtx();
+      if(!fConfig.dictionary.empty()){
+        std::ifstream file(fConfig.dictionary, std::ifstream::binary);
+        if(!file.is_open())
+          throw art::Exception(art::errors::Configuration)
+            << "ImageCodec: unable to open zstd dictionary " << fConfig.dictionary << std::endl;
+        const std::vector<char> dictionary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const int level = fConfig.level != 0 ? fConfig.level : ZSTD_CLEVEL_DEFAULT;
+        fZstd->dictionary = ZSTD_createCDict(dictionary.data(), dictionary.size(), level);
+        if(!fZstd->dictionary)
+          throw art::Exception(art::errors::Configuration)
+            << "ImageCodec: " << fConfig.dictionary << " is not a zstd dictionary" << std::endl;
+      }
+#else
+      throw art::Exception(art::errors::Configuration)
+        << "ImageCodec: dunereco was built without zstd" << std::endl;
+#endif
+    }
+    else if(fConfig.name == "lz4"){
+#ifndef DUNERECO_WITH_LZ4
+      throw art::Exception(art::errors::Configuration)
+        << "ImageCodec: dunereco was built without LZ4" << std::endl;
+#endif
+    }
+    else
+      throw art::Exception(art::errors::Configuration)
+        << "ImageCodec: unknown codec " << fConfig.name << ", use zlib, zstd or lz4" << std::endl;
+  }
+
+  ImageCodec::~ImageCodec()
+  {
+  }
+
+  std::string ImageCodec::Extension() const
+  {
+    if(fConfig.name == "zstd") return ".zst";
+    if(fConfig.name == "lz4") return ".lz4";
+    return ".gz";
+  }
+
+  unsigned long ImageCodec::Compress(const unsigned char *data, unsigned long size,
+                                     std::vector<unsigned char> &out)
+  {
+#ifdef DUNERECO_WITH_ZSTD
+    if(fZstd){
+      const size_t bound = ZSTD_compressBound(size);
+      if(out.size() < bound) out.resize(bound);
+
+      const size_t res = fZstd->dictionary ?
+        ZSTD_compress_usingCDict(fZstd->context, out.data(), out.size(), data, size, fZstd->dictionary) :
+        ZSTD_compressCCtx(fZstd->context, out.data(), out.size(), data, size,
+                          fConfig.level != 0 ? fConfig.level : ZSTD_CLEVEL_DEFAULT);
+      if(ZSTD_isError(res)){
+        mf::LogError("ImageCodec") << "zstd compression failed: " << ZSTD_getErrorName(res);
+        return 0;
+      }
+      return res;
+    }
+#endif
+
+#ifdef DUNERECO_WITH_LZ4
+    if(fConfig.name == "lz4"){
+      LZ4F_preferences_t preferences = LZ4F_INIT_PREFERENCES;
+      preferences.compressionLevel = fConfig.level;
+      preferences.frameInfo.contentSize = size;
+
+      const size_t bound = LZ4F_compressFrameBound(size, &preferences);
+      if(out.size() < bound) out.resize(bound);
+
+      const size_t res = LZ4F_compressFrame(out.data(), out.size(), data, size, &preferences);
+      if(LZ4F_isError(res)){
+        mf::LogError("ImageCodec") << "LZ4 compression failed: " << LZ4F_getErrorName(res);
+        return 0;
+      }
+      return res;
+    }
+#endif
+
+    ulong dest_len = compressBound(size);     // calculate size of the compressed data
+    if(out.size() < dest_len) out.resize(dest_len);
+
+    int res = compress2(out.data(), &dest_len, data, size,
+                        fConfig.level != 0 ? fConfig.level : Z_DEFAULT_COMPRESSION);
+
+    if(res != Z_OK){
+      mf::LogError("ImageCodec") << "zlib compression failed: "
+                                 << (res == Z_BUF_ERROR ? "buffer too small" :
+                                     res == Z_MEM_ERROR ? "not enough memory" : "error " + std::to_string(res));
+      return 0;
+    }
+    return dest_len;
+  }
+
+  void ImageCodec::TrainZstdDictionary(const std::vector< std::vector<unsigned char> > &samples,
+                                       unsigned long maxSize, const std::string &file)
+  {
+#ifdef DUNERECO_WITH_ZSTD
+    // ZDICT wants the samples back to back
+    std::vector<unsigned char> buffer;
+    std::vector<size_t> sizes;
+    for(const std::vector<unsigned char> &sample : samples){
+      buffer.insert(buffer.end(), sample.begin(), sample.end());
+      sizes.push_back(sample.size());
+    }
+
+    std::vector<unsigned char> dictionary(maxSize);
+    const size_t res = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(),
+                                             buffer.data(), sizes.data(), sizes.size());
+    if(ZDICT_isError(res))
+      throw art::Exception(art::errors::LogicError)
+        << "ImageCodec: zstd dictionary training on " << samples.size() << " images failed: "
+        << ZDICT_getErrorName(res) << std::endl;
+
+    std::ofstream out(file, std::ofstream::binary);
+    out.write(reinterpret_cast<const char*>(dictionary.data()), res);
+    if(!out)
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to write to file " << file << "!" << std::endl;
+#else
+    (void)samples; (void)maxSize;
+    throw art::Exception(art::errors::Configuration)
+      << "ImageCodec: dunereco was built without zstd, cannot write " << file << std::endl;
+#endif
+  }
+
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ImageCodec.h
+/// \brief   Compression of the CVN and GCN training records
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_IMAGECODEC_H
+#define CVN_IMAGECODEC_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fhicl
+{
+  class ParameterSet;
+}
+
+namespace cvn
+{
+
+  struct CodecConfig
+  {
+    std::string name = "zlib"; ///< "zlib", "zstd" or "lz4"
+    int level = 0;             ///< compression level, 0 uses the codec's default
+    std::string dictionary;    ///< "zstd": dictionary file from TrainZstdDictionary, "" for none
+  };
+
+  /// Read Codec, CompressionLevel and ZstdDictionary, the defaults write zlib
+  CodecConfig ReadCodecConfig(const fhicl::ParameterSet &pset);
+
+  /// Compresses the raw training images. zlib keeps the .gz files the
+  /// training scripts always read, zstd and LZ4 trade a little size for
+  /// much faster compression and decompression. The codec is marked by the
+  /// file extension (.gz, .zst or .lz4), both zstd and LZ4 write standard
+  /// frames so the python zstandard and lz4.frame modules read them.
+  /// Not thread safe, every writer thread owns its codec
+  class ImageCodec
+  {
+  public:
+
+    /// Throws if the codec is unknown, not built in, or its dictionary
+    /// cannot be read
+    explicit ImageCodec(const CodecConfig &config = CodecConfig());
+    ~ImageCodec();
+
+    ImageCodec(const ImageCodec &) = delete;
+    ImageCodec &operator=(const ImageCodec &) = delete;
+
+    /// Compress size bytes into out, which only grows. Returns the
+    /// compressed size, 0 if the compression failed
+    unsigned long Compress(const unsigned char *data, unsigned long size,
+                           std::vector<unsigned char> &out);
+
+    const std::string &Name() const { return fConfig.name; }
+    /// File extension marking the codec, including the dot
+    std::string Extension() const;
+
+    /// Train a zstd dictionary of at most maxSize bytes on sample images and
+    /// write it to file. Small images compress much better with it, but the
+    /// same file is needed to read them back. Throws if zstd is not built in
+    /// or the training fails
+    static void TrainZstdDictionary(const std::vector< std::vector<unsigned char> > &samples,
+                                    unsigned long maxSize, const std::string &file);
+
+  private:
+
+    struct ZstdState;
+
+    CodecConfig fConfig;
+    std::unique_ptr<ZstdState> fZstd;
+  };
+
+}
+
+#endif  // CVN_IMAGECODEC_H
@@ -5,31 +5,37 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <ostream>
+#include <stdexcept>
 #include "dunereco/CVN/func/PixelMap.h"
 
 namespace cvn
 {
 
   PixelMap::PixelMap(unsigned int nWire, unsigned int nTdc,
-                     const Boundary& bound):
+                     const Boundary& bound, bool withTruth):
   fNWire(nWire),
   fNTdc(nTdc),
   fPE(nWire*nTdc),
   fPEX(nWire*nTdc),
   fPEY(nWire*nTdc),
   fPEZ(nWire*nTdc),
-  fPur(nWire*nTdc),
-  fPurX(nWire*nTdc),
-  fPurY(nWire*nTdc),
-  fPurZ(nWire*nTdc),
-  fLab(nWire*nTdc),
-  fLabX(nWire*nTdc),
-  fLabY(nWire*nTdc),
-  fLabZ(nWire*nTdc),
+  fPur(withTruth ? nWire*nTdc : 0),
+  fPurX(withTruth ? nWire*nTdc : 0),
+  fPurY(withTruth ? nWire*nTdc : 0),
+  fPurZ(withTruth ? nWire*nTdc : 0),
+  fLab(withTruth ? nWire*nTdc : 0),
+  fLabX(withTruth ? nWire*nTdc : 0),
+  fLabY(withTruth ? nWire*nTdc : 0),
+  fLabZ(withTruth ? nWire*nTdc : 0),
   fBound(bound)
-  { fTotHits = 0; }
+  {
+    fTotHits = 0;
+    CacheBoundary();
+  }
 
   void PixelMap::FillInputVector(float* input) const
   {
@@ -43,35 +49,65 @@ namespace cvn
   }
 
 
+  void PixelMap::CacheBoundary()
+  {
+    for(unsigned int view = 0; view < 3; ++view){
+      fViewFirstWire[view] = fBound.FirstWire(view);
+      fViewLastWire[view] = fBound.LastWire(view);
+      fViewFirstTDC[view] = fBound.FirstTDC(view);
+      fViewLastTDC[view] = fBound.LastTDC(view);
+      fViewTDCStep[view] = (fViewLastTDC[view] - fViewFirstTDC[view]) / double(fNTdc);
+    }
+  }
+
   void PixelMap::Add(const unsigned int& wire, const double& tdc, const unsigned int& view, const double& pe)
   {
-    const HitType label = kEmptyHit;
-    const double purity=0.0;
-    if(fBound.IsWithin(wire, tdc, view)){
-      fPE[GlobalToIndex(wire,tdc, view)] += pe;
-      fLab[GlobalToIndex(wire,tdc, view)] = label;
-      fPur[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      if(view==0){
-	fPEX[GlobalToIndexSingle(wire,tdc, view)] += pe;//Why +=?
-	fLabX[GlobalToIndexSingle(wire,tdc, view)] = label;
-	fPurX[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      }
-      if(view==1){
-	fPEY[GlobalToIndexSingle(wire,tdc, view)] += pe;
-	fLabY[GlobalToIndexSingle(wire,tdc, view)] = label;
-	fPurY[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      }
-     if(view==2){
-	fPEZ[GlobalToIndexSingle(wire,tdc, view)] += pe;
-	fLabZ[GlobalToIndexSingle(wire,tdc, view)] = label;
-	fPurZ[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      }
-   }
+    if(view > 2 || !IsWithinMap(wire, tdc, view)) return;
+
+    // Both index functions give the same index, only work it out once
+    const unsigned int index = IndexInMap(wire, tdc, view);
+    assert(index < fPE.size());
+
+    fPE[index] += pe;
+    std::vector<float>& viewPE = view == 0 ? fPEX : (view == 1 ? fPEY : fPEZ);
+    viewPE[index] += pe;
+
+    if(HasTruth()){
+      // Hits added without truth get an empty label and no purity
+      std::vector<HitType>& viewLab = view == 0 ? fLabX : (view == 1 ? fLabY : fLabZ);
+      std::vector<float>& viewPur = view == 0 ? fPurX : (view == 1 ? fPurY : fPurZ);
+      fLab[index] = kEmptyHit;
+      fPur[index] = 0.;
+      viewLab[index] = kEmptyHit;
+      viewPur[index] = 0.;
+    }
+  }
+
+  void PixelMap::AddHits(const std::vector<unsigned int>& wires, const std::vector<double>& tdcs,
+                         const std::vector<unsigned int>& views, const std::vector<double>& pes)
+  {
+    assert(wires.size() == tdcs.size() && wires.size() == views.size() && wires.size() == pes.size());
+
+    if(HasTruth()){
+      for(size_t i = 0; i < wires.size(); ++i) Add(wires[i], tdcs[i], views[i], pes[i]);
+      return;
+    }
+
+    // Without truth only the charge is filled, in a loop free of other work
+    float* viewPE[3] = {fPEX.data(), fPEY.data(), fPEZ.data()};
+    float* pe = fPE.data();
+    for(size_t i = 0; i < wires.size(); ++i){
+      const unsigned int view = views[i];
+      if(view > 2 || !IsWithinMap(wires[i], tdcs[i], view)) continue;
+      const unsigned int index = IndexInMap(wires[i], tdcs[i], view);
+      pe[index] += pes[i];
+      viewPE[view][index] += pes[i];
+    }
   }
 
   unsigned int  PixelMap::GlobalToIndex(const unsigned int& wire,
                                         const double& tdc,
-                                        const unsigned int& view)
+                                        const unsigned int& view) const
   {
 
     unsigned int internalWire =  wire - fBound.FirstWire(view);
@@ -79,7 +115,7 @@ namespace cvn
     double upperTL=fBound.LastTDC(view);
     double lowerTL=fBound.FirstTDC(view);
     double timestep=(upperTL-lowerTL)/double(fNTdc);
-    double roundChannel=round((tdc-lowerTL)/timestep);
+    double roundChannel=std::round((tdc-lowerTL)/timestep);
 
     unsigned int internalTdc  =  roundChannel;
 
@@ -101,7 +137,7 @@ namespace cvn
 
   unsigned int  PixelMap::GlobalToIndexSingle(const unsigned int& wire,
                                               const double& tdc,
-                                              const unsigned int& view)
+                                              const unsigned int& view) const
 
   {
 
@@ -110,7 +146,7 @@ namespace cvn
     double upperTL=fBound.LastTDC(view);
     double lowerTL=fBound.FirstTDC(view);
     double timestep=(upperTL-lowerTL)/double(fNTdc);
-    double roundChannel=round((tdc-lowerTL)/timestep);
+    double roundChannel=std::round((tdc-lowerTL)/timestep);
 
     unsigned int internalTdc  =  roundChannel;
 
@@ -190,6 +226,9 @@ namespace cvn
     TH2F* hist = new TH2F("PixelMap", ";Wire;Tdc", fNWire, 0, fNWire,
                                                     fNTdc*3, 0, fNTdc*3);
 
+    // Maps made without truth give an empty histogram
+    if(!HasTruth()) return hist;
+
     for(unsigned int iWire = 0; iWire < fNWire; ++iWire)
     {
       for(unsigned int iTdc = 0; iTdc < fNTdc; ++iTdc)
@@ -233,6 +272,76 @@ namespace cvn
     return hist;
   }
 
+  void PixelMap::Compact()
+  {
+    const unsigned int maxLocal = std::numeric_limits<unsigned short>::max();
+    if(fNWire > maxLocal || fNTdc > maxLocal)
+      throw std::length_error("PixelMap::Compact: map too large for 16 bit pixel indices");
+
+    const std::vector<float>*   pes[4]  = {&fPE,  &fPEX,  &fPEY,  &fPEZ};
+    const std::vector<float>*   purs[4] = {&fPur, &fPurX, &fPurY, &fPurZ};
+    const std::vector<HitType>* labs[4] = {&fLab, &fLabX, &fLabY, &fLabZ};
+
+    fSparseTruth = HasTruth();
+    fSparseEnd.clear();
+    fSparseWire.clear();
+    fSparseTdc.clear();
+    fSparsePE.clear();
+    fSparsePur.clear();
+    fSparseLab.clear();
+
+    for(unsigned int block = 0; block < 4; ++block)
+    {
+      const std::vector<float>& pe = *pes[block];
+      for(unsigned int index = 0; index < pe.size(); ++index)
+      {
+        // Unfilled truth is purity 0 and the value initialised label
+        const bool empty = pe[index] == 0 &&
+          (!fSparseTruth || ((*purs[block])[index] == 0 && (*labs[block])[index] == HitType()));
+        if(empty) continue;
+
+        fSparseWire.push_back(index / fNTdc);
+        fSparseTdc.push_back(index % fNTdc);
+        fSparsePE.push_back(pe[index]);
+        if(fSparseTruth){
+          fSparsePur.push_back((*purs[block])[index]);
+          fSparseLab.push_back((*labs[block])[index]);
+        }
+      }
+      fSparseEnd.push_back(fSparsePE.size());
+    }
+  }
+
+  void PixelMap::ExpandSparse()
+  {
+    const unsigned int nPixel = fNWire * fNTdc;
+    const unsigned int nTruth = fSparseTruth ? nPixel : 0;
+
+    std::vector<float>*   pes[4]  = {&fPE,  &fPEX,  &fPEY,  &fPEZ};
+    std::vector<float>*   purs[4] = {&fPur, &fPurX, &fPurY, &fPurZ};
+    std::vector<HitType>* labs[4] = {&fLab, &fLabX, &fLabY, &fLabZ};
+
+    unsigned int begin = 0;
+    for(unsigned int block = 0; block < 4; ++block)
+    {
+      pes[block]->assign(nPixel, 0.);
+      purs[block]->assign(nTruth, 0.);
+      labs[block]->assign(nTruth, HitType());
+
+      const unsigned int end = block < fSparseEnd.size() ? fSparseEnd[block] : begin;
+      for(unsigned int i = begin; i < end; ++i)
+      {
+        const unsigned int index = LocalToIndex(fSparseWire[i], fSparseTdc[i]);
+        (*pes[block])[index] = fSparsePE[i];
+        if(fSparseTruth){
+          (*purs[block])[index] = fSparsePur[i];
+          (*labs[block])[index] = static_cast<HitType>(fSparseLab[i]);
+        }
+      }
+      begin = end;
+    }
+  }
+
   std::ostream& operator<<(std::ostream& os, const PixelMap& m)
   {
     os << "PixelMap with " << m.NPixel() << " pixels, "
@@ -7,6 +7,7 @@
 #ifndef CVN_PIXELMAP_H
 #define CVN_PIXELMAP_H
 
+#include <cmath>
 #include <ostream>
 #include <vector>
 
@@ -22,7 +23,9 @@ namespace cvn
   class PixelMap
   {
   public:
-    PixelMap(unsigned int nWire, unsigned int nTdc, const Boundary& bound);
+    /// Without truth the purity and label vectors are left empty, which
+    /// is all that is needed when running on data
+    PixelMap(unsigned int nWire, unsigned int nTdc, const Boundary& bound, bool withTruth = true);
     PixelMap(){ fTotHits = 0; };
 
     /// Length in wires
@@ -35,7 +38,10 @@ namespace cvn
     unsigned int NPixel() const {return fPE.size();};
 
     /// Map boundary
-    Boundary Bound() const {return fBound;};
+    const Boundary& Bound() const {return fBound;};
+
+    /// Does the map hold purity and truth labels?
+    bool HasTruth() const {return !fLab.empty();};
 
     /// Number of inputs for the neural net
     unsigned int NInput() const {return NPixel();};
@@ -46,12 +52,39 @@ namespace cvn
     /// Could be expanded later to add to overflow accordingly.
     void Add(const unsigned int& wire, const double& tdc,  const unsigned int& view, const double& pe);
 
+    /// Add many hits given as parallel arrays, the same as calling Add for each.
+    /// The hits are added in the order given: sorting them by pixel, or by
+    /// blocks of pixels, first costs more than the scattered writes it saves,
+    /// which are small next to allocating the map (see
+    /// PixelMapProducer::SetRegionOfInterest to make the map smaller)
+    void AddHits(const std::vector<unsigned int>& wires, const std::vector<double>& tdcs,
+                 const std::vector<unsigned int>& views, const std::vector<double>& pes);
+
+    /// Is the hit inside the map? Only valid for maps made with the boundary
+    /// constructor, which caches the boundary of each view
+    bool IsWithinMap(unsigned int wire, double tdc, unsigned int view) const
+    {
+      return (int)wire >= fViewFirstWire[view] && (int)wire <= fViewLastWire[view] &&
+             tdc >= fViewFirstTDC[view] && tdc <= fViewLastTDC[view];
+    }
+
+    /// Index in the fPE vector of a hit inside the map, same as GlobalToIndex.
+    /// The map sizes stay runtime values: with the size fixed at compile
+    /// time the fill loop is no faster, as the tdc division and the writes
+    /// cost more than the multiply and modulo by fNTdc
+    unsigned int IndexInMap(unsigned int wire, double tdc, unsigned int view) const
+    {
+      const unsigned int internalWire = wire - fViewFirstWire[view];
+      const unsigned int internalTdc = std::round((tdc - fViewFirstTDC[view]) / fViewTDCStep[view]);
+      return internalWire * fNTdc + internalTdc % fNTdc;
+    }
+
 
     /// Take global wire, tdc (detector) and return index in fPE vector
     unsigned int GlobalToIndex(const unsigned int& wire,
                                const double& tdc,
                                const unsigned int& view)
-      ;
+      const;
 
     /// Take local wire, tdc (within map) and return index in fPE vector
     unsigned int LocalToIndex(const unsigned int& wire,
@@ -62,7 +95,7 @@ namespace cvn
     unsigned int GlobalToIndexSingle(const unsigned int& wire,
                                      const double& tdc,
                                      const unsigned int& view)
-;
+      const;
 
     void SetTotHits(unsigned int tothits){ fTotHits = tothits; } 
     unsigned int GetTotHits(){ return fTotHits; } 
@@ -75,16 +108,24 @@ namespace cvn
     TH2F* ToLabTH2() const;
     TH2F* SingleViewToTH2(const unsigned int& view) const;
 
+    /// Fill the sparse members that are written to file from the dense
+    /// vectors. Call once the map is complete, before putting it into the
+    /// event; reading a file fills the dense vectors again with ExpandSparse
+    void Compact();
+
+    /// Rebuild the dense vectors from the sparse members
+    void ExpandSparse();
+
     unsigned int      fNWire;  ///< Number of wires, length of pixel map
     unsigned int      fNTdc;   ///< Number of tdcs, width of pixel map
     std::vector<float>   fPE;   ///< Vector of PE measurements for pixels
     std::vector<float>   fPEX;  ///< Vector of X PE measurements for pixels
     std::vector<float>   fPEY;  ///< Vector of Y PE measurements for pixels
     std::vector<float>   fPEZ;  ///< Vector of Y PE measurements for pixels
-    std::vector<double>  fPur;  ///< Vector of purity for pixels
-    std::vector<double>  fPurX; ///< Vector of X purity for pixels
-    std::vector<double>  fPurY; ///< Vector of Y purity for pixels
-    std::vector<double>  fPurZ; ///< Vector of Y purity for pixels
+    std::vector<float>   fPur;  ///< Vector of purity for pixels
+    std::vector<float>   fPurX; ///< Vector of X purity for pixels
+    std::vector<float>   fPurY; ///< Vector of Y purity for pixels
+    std::vector<float>   fPurZ; ///< Vector of Y purity for pixels
     std::vector<HitType> fLab;  ///< Vector of Truth labels for pixels
     std::vector<HitType> fLabX; ///< Vector of X Truth labels for pixels
     std::vector<HitType> fLabY; ///< Vector of Y Truth labels for pixels
@@ -93,6 +134,28 @@ namespace cvn
 
     Boundary          fBound;    //< Boundary of pixel map
 
+    // Only the sparse members below are persistent, the dense vectors above
+    // are transient. Each block of PE, X, Y and Z pixels keeps the pixels that
+    // are not empty in that vector, in index order.
+    std::vector<unsigned int>   fSparseEnd;  ///< End of the PE, X, Y and Z blocks
+    std::vector<unsigned short> fSparseWire; ///< Local wire of each stored pixel
+    std::vector<unsigned short> fSparseTdc;  ///< Local tdc of each stored pixel
+    std::vector<float>          fSparsePE;   ///< PE of each stored pixel
+    bool                        fSparseTruth = false; ///< Was the map made with truth?
+    std::vector<float>          fSparsePur;  ///< Purity of each stored pixel, empty without truth
+    std::vector<unsigned char>  fSparseLab;  ///< HitType of each stored pixel, empty without truth
+
+  private:
+    /// Cache the boundary of each view for IsWithinMap and IndexInMap
+    void CacheBoundary();
+
+    // Transient copies of the boundary, so that filling does not go through it
+    int    fViewFirstWire[3] = {0, 0, 0};    ///< First wire of each view
+    int    fViewLastWire[3] = {-1, -1, -1};  ///< Last wire of each view
+    double fViewFirstTDC[3] = {0., 0., 0.};  ///< First tdc of each view
+    double fViewLastTDC[3] = {-1., -1., -1.}; ///< Last tdc of each view
+    double fViewTDCStep[3] = {1., 1., 1.};   ///< Tdc range of one pixel in each view
+
   };
 
   std::ostream& operator<<(std::ostream& os, const PixelMap& m);
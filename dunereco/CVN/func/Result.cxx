@@ -12,6 +12,7 @@
 #include <algorithm>
 
 #include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CompactResult.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 namespace cvn
@@ -35,6 +36,19 @@ namespace cvn
   fOutput()
   {}
 
+  Result Result::Skipped()
+  {
+    std::vector< std::vector<float> > output(CompactResult::kNHeads);
+    for(unsigned int head = 0; head < CompactResult::kNHeads; ++head)
+      output[head].assign(CompactResult::kHeadOffset[head + 1] - CompactResult::kHeadOffset[head], -1.f);
+    return Result(output);
+  }
+
+  bool Result::IsSkipped() const
+  {
+    return !fOutput.empty() && !fOutput[0].empty() && fOutput[0][0] < 0.f;
+  }
+
   unsigned int Result::ArgMax(int output_n) const
   {
     // Get the max element iterator and convert to vector index
@@ -24,6 +24,13 @@ namespace cvn
     //Result(const float* output, unsigned int& nOutputs, const float* features, unsigned int& nFeatures);
     Result();
 
+    /// Result of an event skipped by the preselection: the multi-output
+    /// layout with every value -1, so the accessors return -1
+    static Result Skipped();
+
+    /// Whether this is the result of a skipped event
+    bool IsSkipped() const;
+
     /// Index of maximum value in vector
     unsigned int ArgMax(int output_n) const;
 
@@ -0,0 +1,52 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ScratchBuffers.cxx
+/// \brief   Buffers kept between events by the CVN mappers and writers
+////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/CVN/func/ScratchBuffers.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+namespace cvn
+{
+
+  BufferPool::BufferPool(unsigned int maxFree):
+  fMaxFree(maxFree), fNAcquired(0), fNAllocated(0)
+  {
+  }
+
+  std::vector<unsigned char> BufferPool::Acquire(size_t size)
+  {
+    std::vector<unsigned char> buffer;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      ++fNAcquired;
+      if(!fFree.empty()){
+        buffer = std::move(fFree.back());
+        fFree.pop_back();
+      }
+      if(size > buffer.capacity()) ++fNAllocated;
+    }
+    if(ResetScratch(buffer, size, (unsigned char)0))
+      DUNE_PROF_COUNT("cvn::BufferPool allocations", 1);
+    return buffer;
+  }
+
+  void BufferPool::Release(std::vector<unsigned char> &&buffer)
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if(fFree.size() < fMaxFree) fFree.push_back(std::move(buffer));
+  }
+
+  unsigned long BufferPool::NAcquired() const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fNAcquired;
+  }
+
+  unsigned long BufferPool::NAllocated() const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fNAllocated;
+  }
+
+}
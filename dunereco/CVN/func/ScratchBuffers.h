@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ScratchBuffers.h
+/// \brief   Buffers kept between events by the CVN mappers and writers
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_SCRATCHBUFFERS_H
+#define CVN_SCRATCHBUFFERS_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace cvn
+{
+
+  /// Set a scratch vector kept between calls to n copies of value, reusing
+  /// its storage. Returns true if the storage had to grow (a heap allocation),
+  /// so the callers can count them in the profiling registry
+  template <typename T>
+  bool ResetScratch(std::vector<T> &scratch, size_t n, const T &value = T())
+  {
+    const bool grows = n > scratch.capacity();
+    scratch.assign(n, value);
+    return grows;
+  }
+
+  /// Pool of byte buffers handed from the event loop to a consumer and back,
+  /// e.g. the raw images queued for the zlib shard writer. Once the pool has
+  /// as many buffers as are in flight, Acquire no longer allocates. Thread safe
+  class BufferPool
+  {
+  public:
+
+    /// At most maxFree released buffers are kept, the others are freed
+    explicit BufferPool(unsigned int maxFree = 16);
+
+    /// A zero filled buffer of the given size, recycled when one is free
+    std::vector<unsigned char> Acquire(size_t size);
+
+    /// Give a buffer back to the pool once its contents are not needed
+    void Release(std::vector<unsigned char> &&buffer);
+
+    unsigned long NAcquired() const;
+    unsigned long NAllocated() const; ///< Acquires that had to allocate
+
+  private:
+
+    unsigned int fMaxFree;
+    mutable std::mutex fMutex;
+    std::vector< std::vector<unsigned char> > fFree;
+    unsigned long fNAcquired;
+    unsigned long fNAllocated;
+  };
+
+}
+
+#endif  // CVN_SCRATCHBUFFERS_H
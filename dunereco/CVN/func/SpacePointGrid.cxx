@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    SpacePointGrid.cxx
+/// \brief   Uniform voxel grid for neighbour searches between space points
+/// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+#include "dunereco/CVN/func/SpacePointGrid.h"
+
+namespace cvn
+{
+
+  SpacePointGrid::SpacePointGrid(const std::vector<art::Ptr<recob::SpacePoint>> &sps, float cellSize):
+  fSpacePoints(sps), fCellSize(cellSize), fMin{0., 0., 0.}, fNCells{1, 1, 1}
+  {
+    const unsigned int nPoints = fSpacePoints.size();
+    if(nPoints == 0) return;
+
+    fPositions.reserve(3*nPoints);
+    double max[3] = {0., 0., 0.};
+    for(unsigned int i = 0; i < nPoints; ++i){
+      const double *pos = fSpacePoints[i]->XYZ();
+      for(unsigned int a = 0; a < 3; ++a){
+        fPositions.push_back(pos[a]);
+        if(i == 0 || pos[a] < fMin[a]) fMin[a] = pos[a];
+        if(i == 0 || pos[a] > max[a]) max[a] = pos[a];
+      }
+    }
+
+    // Without a preferred size aim for roughly one point per voxel
+    if(fCellSize <= 0.){
+      double volume = 1.;
+      for(unsigned int a = 0; a < 3; ++a) volume *= std::max(max[a] - fMin[a], 1.);
+      fCellSize = std::max(std::cbrt(volume / nPoints), 0.1);
+    }
+
+    for(unsigned int a = 0; a < 3; ++a){
+      fNCells[a] = static_cast<int>(std::floor((max[a] - fMin[a]) / fCellSize)) + 1;
+    }
+
+    // Sort the points by voxel, keeping the input order within each voxel
+    std::vector<int64_t> keys(nPoints);
+    for(unsigned int i = 0; i < nPoints; ++i){
+      keys[i] = CellKey(CellCoordinate(i, 0), CellCoordinate(i, 1), CellCoordinate(i, 2));
+    }
+    fOrder.resize(nPoints);
+    for(unsigned int i = 0; i < nPoints; ++i) fOrder[i] = i;
+    std::stable_sort(fOrder.begin(), fOrder.end(),
+      [&keys](unsigned int a, unsigned int b){ return keys[a] < keys[b]; });
+
+    fCells.reserve(nPoints);
+    unsigned int begin = 0;
+    for(unsigned int o = 1; o <= nPoints; ++o){
+      if(o == nPoints || keys[fOrder[o]] != keys[fOrder[begin]]){
+        fCells.emplace(keys[fOrder[begin]], std::make_pair(begin, o));
+        begin = o;
+      }
+    }
+  }
+
+  std::vector<std::vector<unsigned int>> SpacePointGrid::CountNeighbours(const std::vector<float> &radii) const{
+
+    const unsigned int nPoints = fSpacePoints.size();
+    std::vector<std::vector<unsigned int>> result(radii.size(), std::vector<unsigned int>(nPoints, 0));
+    if(nPoints == 0 || radii.empty()) return result;
+
+    const float maxRadius = *std::max_element(radii.begin(), radii.end());
+    if(maxRadius <= 0.) return result;
+    const int reach = static_cast<int>(std::ceil(maxRadius / fCellSize));
+
+    // Visit each occupied voxel once and compare its points against the
+    // points of all voxels within reach, filling every radius together
+    std::vector<std::pair<unsigned int,unsigned int>> nearby;
+    for(const auto &cell : fCells){
+      const unsigned int first = fOrder[cell.second.first];
+      const int cx = CellCoordinate(first, 0);
+      const int cy = CellCoordinate(first, 1);
+      const int cz = CellCoordinate(first, 2);
+
+      nearby.clear();
+      for(int ix = cx - reach; ix <= cx + reach; ++ix){
+        for(int iy = cy - reach; iy <= cy + reach; ++iy){
+          for(int iz = cz - reach; iz <= cz + reach; ++iz){
+            const std::pair<unsigned int,unsigned int> range = CellRange(ix, iy, iz);
+            if(range.first != range.second) nearby.push_back(range);
+          }
+        }
+      }
+
+      for(unsigned int o = cell.second.first; o < cell.second.second; ++o){
+        const unsigned int i = fOrder[o];
+        for(const auto &range : nearby){
+          for(unsigned int p = range.first; p < range.second; ++p){
+            const unsigned int j = fOrder[p];
+            if(i == j) continue;
+            const float dist = Distance(i, j);
+            if(dist >= maxRadius) continue;
+            for(unsigned int r = 0; r < radii.size(); ++r){
+              if(dist < radii[r]) ++result[r][i];
+            }
+          }
+        }
+      }
+    }
+    return result;
+  }
+
+  std::vector<int> SpacePointGrid::NearestNeighbours() const{
+    std::vector<int> result(fSpacePoints.size(), -1);
+    for(unsigned int i = 0; i < fSpacePoints.size(); ++i){
+      int index = -1;
+      float dist = 99999;
+      FindNearest(i, 1, &index, &dist);
+      result[i] = index;
+    }
+    return result;
+  }
+
+  std::vector<std::pair<int,int>> SpacePointGrid::TwoNearestNeighbours() const{
+    std::vector<std::pair<int,int>> result(fSpacePoints.size(), std::make_pair(-1, -1));
+    for(unsigned int i = 0; i < fSpacePoints.size(); ++i){
+      int index[2] = {-1, -1};
+      float dist[2] = {99999, 99999};
+      FindNearest(i, 2, index, dist);
+      result[i] = std::make_pair(index[0], index[1]);
+    }
+    return result;
+  }
+
+  void SpacePointGrid::RadiusNeighbours(float radius, std::vector<unsigned int> &offsets,
+                                        std::vector<unsigned int> &targets) const{
+
+    const unsigned int nPoints = fSpacePoints.size();
+    offsets.assign(nPoints + 1, 0);
+    targets.clear();
+    if(nPoints == 0 || radius <= 0.) return;
+    const int reach = static_cast<int>(std::ceil(radius / fCellSize));
+
+    for(unsigned int i = 0; i < nPoints; ++i){
+      const int cx = CellCoordinate(i, 0);
+      const int cy = CellCoordinate(i, 1);
+      const int cz = CellCoordinate(i, 2);
+
+      const unsigned int begin = targets.size();
+      for(int ix = cx - reach; ix <= cx + reach; ++ix){
+        for(int iy = cy - reach; iy <= cy + reach; ++iy){
+          for(int iz = cz - reach; iz <= cz + reach; ++iz){
+            const std::pair<unsigned int,unsigned int> range = CellRange(ix, iy, iz);
+            for(unsigned int p = range.first; p < range.second; ++p){
+              const unsigned int j = fOrder[p];
+              if(i != j && Distance(i, j) < radius) targets.push_back(j);
+            }
+          }
+        }
+      }
+      std::sort(targets.begin() + begin, targets.end());
+      offsets[i+1] = targets.size();
+    }
+  }
+
+  void SpacePointGrid::FindNearest(unsigned int i, unsigned int nMax, int *index, float *dist) const{
+
+    const int c[3] = {CellCoordinate(i, 0), CellCoordinate(i, 1), CellCoordinate(i, 2)};
+    int maxRing = 0;
+    for(unsigned int a = 0; a < 3; ++a){
+      maxRing = std::max(maxRing, std::max(c[a], fNCells[a] - 1 - c[a]));
+    }
+
+    // Grow shells of voxels around the point. Everything outside shell k is
+    // at least k cell sizes away, so stop once the candidates are closer.
+    // Ties are resolved towards the lower index, as a linear scan would do
+    for(int k = 0; k <= maxRing; ++k){
+      for(int dx = -k; dx <= k; ++dx){
+        for(int dy = -k; dy <= k; ++dy){
+          const bool onShell = (std::abs(dx) == k || std::abs(dy) == k);
+          const int dzStep = (onShell || k == 0) ? 1 : 2*k;
+          for(int dz = -k; dz <= k; dz += dzStep){
+            const std::pair<unsigned int,unsigned int> range = CellRange(c[0] + dx, c[1] + dy, c[2] + dz);
+            for(unsigned int p = range.first; p < range.second; ++p){
+              const int j = fOrder[p];
+              if(j == static_cast<int>(i)) continue;
+              const float d = Distance(i, j);
+              for(unsigned int n = 0; n < nMax; ++n){
+                if(d < dist[n] || (d == dist[n] && index[n] >= 0 && j < index[n])){
+                  for(unsigned int m = nMax - 1; m > n; --m){
+                    dist[m] = dist[m-1];
+                    index[m] = index[m-1];
+                  }
+                  dist[n] = d;
+                  index[n] = j;
+                  break;
+                }
+              }
+            }
+          }
+        }
+      }
+      if(index[nMax-1] >= 0 && dist[nMax-1] < k*fCellSize) break;
+    }
+  }
+
+  float SpacePointGrid::Distance(unsigned int i, unsigned int j) const{
+    const double *p0 = &fPositions[3*i];
+    const double *p1 = &fPositions[3*j];
+    const float dx = p1[0] - p0[0];
+    const float dy = p1[1] - p0[1];
+    const float dz = p1[2] - p0[2];
+    return sqrt(dx*dx + dy*dy + dz*dz);
+  }
+
+  int SpacePointGrid::CellCoordinate(unsigned int i, unsigned int a) const{
+    const int c = static_cast<int>(std::floor((fPositions[3*i + a] - fMin[a]) / fCellSize));
+    return std::min(std::max(c, 0), fNCells[a] - 1);
+  }
+
+  int64_t SpacePointGrid::CellKey(int ix, int iy, int iz) const{
+    return ix + static_cast<int64_t>(fNCells[0]) * (iy + static_cast<int64_t>(fNCells[1]) * iz);
+  }
+
+  std::pair<unsigned int,unsigned int> SpacePointGrid::CellRange(int ix, int iy, int iz) const{
+    if(ix < 0 || iy < 0 || iz < 0 || ix >= fNCells[0] || iy >= fNCells[1] || iz >= fNCells[2]){
+      return std::make_pair(0u, 0u);
+    }
+    const auto it = fCells.find(CellKey(ix, iy, iz));
+    if(it == fCells.end()) return std::make_pair(0u, 0u);
+    return it->second;
+  }
+
+}
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    SpacePointGrid.h
+/// \brief   Uniform voxel grid for neighbour searches between space points
+/// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_SPACEPOINTGRID_H
+#define CVN_SPACEPOINTGRID_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "canvas/Persistency/Common/Ptr.h"
+#include "lardataobj/RecoBase/SpacePoint.h"
+
+namespace cvn
+{
+
+  /// Spatial index over a set of space points. The points are hashed into
+  /// cubic voxels once and every neighbour query only visits nearby voxels.
+  /// All results are flat vectors indexed by the position of the space point
+  /// in the input vector, and other points are referred to by that index too.
+  class SpacePointGrid
+  {
+  public:
+
+    /// Build the grid. A cellSize <= 0 picks one from the point density
+    SpacePointGrid(const std::vector<art::Ptr<recob::SpacePoint>> &sps, float cellSize = 0.);
+
+    /// Number of space points in the grid
+    unsigned int GetNumberOfPoints() const { return fSpacePoints.size(); }
+    /// Access the space point at a given index
+    const art::Ptr<recob::SpacePoint>& GetSpacePoint(unsigned int index) const { return fSpacePoints.at(index); }
+
+    /// Number of other points closer than each of the radii, for every point.
+    /// Returned as [radius][point] and filled in a single pass over the grid
+    std::vector<std::vector<unsigned int>> CountNeighbours(const std::vector<float> &radii) const;
+
+    /// Index of the nearest other point for every point, -1 if there is none
+    std::vector<int> NearestNeighbours() const;
+
+    /// Indices of the two nearest other points for every point, -1 if missing
+    std::vector<std::pair<int,int>> TwoNearestNeighbours() const;
+
+    /// All other points closer than radius, in CSR form: the neighbours of
+    /// point i are targets[offsets[i]] ... targets[offsets[i+1]-1], by index
+    void RadiusNeighbours(float radius, std::vector<unsigned int> &offsets,
+                          std::vector<unsigned int> &targets) const;
+
+  private:
+
+    /// Find the closest nMax (at most two) points to point i
+    void FindNearest(unsigned int i, unsigned int nMax, int *index, float *dist) const;
+    /// Distance between two points, calculated as in GCNFeatureUtils
+    float Distance(unsigned int i, unsigned int j) const;
+    /// Voxel coordinate of point i along axis a
+    int CellCoordinate(unsigned int i, unsigned int a) const;
+    /// Key of the voxel with the given coordinates
+    int64_t CellKey(int ix, int iy, int iz) const;
+    /// Range of fOrder entries contained in a voxel, empty if not occupied
+    std::pair<unsigned int,unsigned int> CellRange(int ix, int iy, int iz) const;
+
+    std::vector<art::Ptr<recob::SpacePoint>> fSpacePoints;
+    /// Flat (x, y, z) positions of the points
+    std::vector<double> fPositions;
+    /// Point indices sorted by voxel
+    std::vector<unsigned int> fOrder;
+    /// Occupied voxels and their [begin, end) range in fOrder
+    std::unordered_map<int64_t,std::pair<unsigned int,unsigned int>> fCells;
+
+    float fCellSize;
+    double fMin[3];
+    int fNCells[3];
+  };
+
+}
+
+#endif  // CVN_SPACEPOINTGRID_H
@@ -5,6 +5,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include  <iostream>
+#include  <utility>
 #include "dunereco/CVN/func/SparsePixelMap.h"
 #include "canvas/Utilities/Exception.h"
 
@@ -25,6 +26,18 @@ namespace cvn {
     }
   }
 
+  void SparsePixelMap::Reserve(unsigned int view, size_t nPixels) {
+
+    fCoordinates[view].reserve(nPixels);
+    fFeatures[view].reserve(nPixels);
+    if (fUsePixelTruth) {
+      fPixelPDGs[view].reserve(nPixels);
+      fPixelTrackIDs[view].reserve(nPixels);
+      fPixelEnergies[view].reserve(nPixels);
+      fProcesses[view].reserve(nPixels);
+    }
+  }
+
   /// Default AddHit implementation, which just adds pixel value and coordinates
   void SparsePixelMap::AddHit(unsigned int view, std::vector<float> coordinates,
     std::vector<float> features) {
@@ -41,8 +54,8 @@ namespace cvn {
         << "track ID when calling AddHit.";
     }
 
-    fCoordinates[view].push_back(coordinates);
-    fFeatures[view].push_back(features);
+    fCoordinates[view].push_back(std::move(coordinates));
+    fFeatures[view].push_back(std::move(features));
   }
 
   /// AddHit function that includes per-pixel truth labelling for segmentation
@@ -62,12 +75,12 @@ namespace cvn {
         << "pixel PDG, track ID and Energy";
     }
 
-    fCoordinates[view].push_back(coordinates);
-    fFeatures[view].push_back(features);
-    fPixelPDGs[view].push_back(pdgs);
-    fPixelTrackIDs[view].push_back(tracks);
-    fPixelEnergies[view].push_back(energies);
-    fProcesses[view].push_back(processes);
+    fCoordinates[view].push_back(std::move(coordinates));
+    fFeatures[view].push_back(std::move(features));
+    fPixelPDGs[view].push_back(std::move(pdgs));
+    fPixelTrackIDs[view].push_back(std::move(tracks));
+    fPixelEnergies[view].push_back(std::move(energies));
+    fProcesses[view].push_back(std::move(processes));
 
   }
 
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 
 namespace cvn
@@ -18,6 +19,11 @@ namespace cvn
     SparsePixelMap() {};
     ~SparsePixelMap() {};
 
+    /// Reserve space for the pixels of a view, ahead of a run of AddHit calls
+    void Reserve(unsigned int view, size_t nPixels);
+
+    // The vectors are taken by value and moved into the map, so callers can
+    // move their temporaries in without copying them
     void AddHit(unsigned int view, std::vector<float> coordinates, std::vector<float> features);
     void AddHit(unsigned int view, std::vector<float> coordinates, std::vector<float> features, std::vector<int> pdgs, 
       std::vector<int> tracks, std::vector<float> energies, std::vector<std::string> processes);
@@ -26,32 +32,37 @@ namespace cvn
     std::vector<unsigned int> GetNPixels() const;
     unsigned int GetNPixels(size_t view) const { return fFeatures[view].size(); };
 
-    std::vector<std::vector<std::vector<float>>> GetCoordinates() const { return fCoordinates; };
-    std::vector<std::vector<float>> GetCoordinates(size_t view) const { return fCoordinates[view]; };
+    // The accessors return references to the stored maps, copy them if they
+    // need to outlive the map
+    const std::vector<std::vector<std::vector<float>>>& GetCoordinates() const { return fCoordinates; }
+    const std::vector<std::vector<float>>& GetCoordinates(size_t view) const { return fCoordinates[view]; }
 
-    std::vector<std::vector<std::vector<float>>> GetFeatures() const { return fFeatures; };
-    std::vector<std::vector<float>> GetFeatures(size_t view) const { return fFeatures[view]; };
+    const std::vector<std::vector<std::vector<float>>>& GetFeatures() const { return fFeatures; }
+    const std::vector<std::vector<float>>& GetFeatures(size_t view) const { return fFeatures[view]; }
 
-    std::vector<std::vector<std::vector<int>>> GetPixelPDGs() const { return fPixelPDGs; };
-    std::vector<std::vector<int>> GetPixelPDGs(size_t view) const { return fPixelPDGs[view]; };
+    const std::vector<std::vector<std::vector<int>>>& GetPixelPDGs() const { return fPixelPDGs; }
+    const std::vector<std::vector<int>>& GetPixelPDGs(size_t view) const { return fPixelPDGs[view]; }
 
-    std::vector<std::vector<std::vector<int>>> GetPixelTrackIDs() const {return fPixelTrackIDs; };
-    std::vector<std::vector<int>> GetPixelTrackIDs(size_t view) const {return fPixelTrackIDs[view]; }; 
+    const std::vector<std::vector<std::vector<int>>>& GetPixelTrackIDs() const { return fPixelTrackIDs; }
+    const std::vector<std::vector<int>>& GetPixelTrackIDs(size_t view) const { return fPixelTrackIDs[view]; } 
 
-    std::vector<std::vector<std::vector<float>>> GetPixelEnergies() const {return fPixelEnergies; };
-    std::vector<std::vector<float>> GetPixelEnergies(size_t view) const {return fPixelEnergies[view]; }; 
+    const std::vector<std::vector<std::vector<float>>>& GetPixelEnergies() const { return fPixelEnergies; }
+    const std::vector<std::vector<float>>& GetPixelEnergies(size_t view) const { return fPixelEnergies[view]; } 
 
-    std::vector<std::vector<std::vector<std::string>>> GetProcesses() const { return fProcesses; };
-    std::vector<std::vector<std::string>> GetProcesses(size_t view) const { return fProcesses[view]; };
+    const std::vector<std::vector<std::vector<std::string>>>& GetProcesses() const { return fProcesses; }
+    const std::vector<std::vector<std::string>>& GetProcesses(size_t view) const { return fProcesses[view]; }
 
 
 
   private:
 
     template <class T>
-    std::vector<T> FlattenVector(std::vector<std::vector<T>> vec) const {
+    std::vector<T> FlattenVector(const std::vector<std::vector<T>>& vec) const {
+      size_t size = 0;
+      for (const auto& it : vec) size += it.size();
       std::vector<T> ret;
-      for (auto it : vec) {
+      ret.reserve(size);
+      for (const auto& it : vec) {
         ret.insert(ret.end(), it.begin(), it.end());
       }
       return ret;
@@ -0,0 +1,34 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    TopologyLabels.h
+/// \brief   Final state particle counts and flavour of a neutrino interaction
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_TOPOLOGYLABELS_H
+#define CVN_TOPOLOGYLABELS_H
+
+namespace cvn
+{
+
+  /// The topology information found by AssignLabels::GetTopology for one
+  /// MCTruth, with the hit cut it was made with. Stored in the event so that
+  /// the training data makers of a job can share one calculation.
+  class TopologyLabels
+  {
+  public:
+    TopologyLabels():
+    fTopologyHitsCut(0), fPDG(0), fTauMode(0),
+    fNProton(0), fNPion(0), fNPizero(0), fNNeutron(0)
+    {};
+
+    unsigned int fTopologyHitsCut; ///< Minimum SimIDEs for a particle to be counted
+    short fPDG;                    ///< Neutrino PDG code, 1 for NC
+    unsigned short fTauMode;       ///< TauType of nutau interactions
+    unsigned short fNProton;
+    unsigned short fNPion;         ///< Charged pions
+    unsigned short fNPizero;
+    unsigned short fNNeutron;
+  };
+
+}
+
+#endif // CVN_TOPOLOGYLABELS_H
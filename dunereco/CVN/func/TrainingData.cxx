@@ -6,7 +6,10 @@
 
 //#include "art/Framework/Services/Registry/ServiceHandle.h"
 
+#include <utility>
+
 #include "dunereco/CVN/func/TrainingData.h"
+#include "dunereco/CVN/func/AsyncDumpWriter.h"
 //#include "MCCheater/BackTracker.h"
 
 namespace cvn
@@ -36,6 +39,30 @@ namespace cvn
   fPMap(pMap)
   {  }
 
+  TrainingData::TrainingData(const InteractionType& interaction,
+                             float nuEnergy, float lepEnergy, float lepAngle,
+                             float nueEnergy, float numuEnergy,
+                             float nutauEnergy, float weight,
+                             PixelMap&& pMap):
+  fInt(interaction),
+  fNuEnergy(nuEnergy),
+  fLepEnergy(lepEnergy),
+  fLepAngle(lepAngle),
+  fRecoNueEnergy(nueEnergy),
+  fRecoNumuEnergy(numuEnergy),
+  fRecoNutauEnergy(nutauEnergy),
+  fEventWeight(weight),
+  fUseTopology(false),
+  fNuPDG(0),
+  fNProton(-1),
+  fNPion(-1),
+  fNPizero(-1),
+  fNNeutron(-1),
+  fTopologyType(-1),
+  fTopologyTypeAlt(-1),
+  fPMap(std::move(pMap))
+  {  }
+
 
   void TrainingData::FillOutputVector(float* output) const
   {
@@ -62,5 +89,38 @@ namespace cvn
 
   }
 
+  DumpLayout TrainingData::DumpRecordLayout(unsigned int nPixel)
+  {
+    return {{"nuEnergy", 'F', 1}, {"lepEnergy", 'F', 1}, {"lepAngle", 'F', 1},
+            {"recoNueEnergy", 'F', 1}, {"recoNumuEnergy", 'F', 1}, {"recoNutauEnergy", 'F', 1},
+            {"eventWeight", 'F', 1}, {"pixels", 'F', nPixel},
+            {"interaction", 'I', 1}, {"nuPDG", 'I', 1}, {"nProton", 'I', 1}, {"nPion", 'I', 1},
+            {"nPizero", 'I', 1}, {"nNeutron", 'I', 1}, {"topologyType", 'I', 1}, {"topologyTypeAlt", 'I', 1}};
+  }
+
+  void TrainingData::FillDumpRecord(DumpRecord& record) const
+  {
+    // In the order of DumpRecordLayout
+    float* floats = record.floats.data();
+    floats[0] = fNuEnergy;
+    floats[1] = fLepEnergy;
+    floats[2] = fLepAngle;
+    floats[3] = fRecoNueEnergy;
+    floats[4] = fRecoNumuEnergy;
+    floats[5] = fRecoNutauEnergy;
+    floats[6] = fEventWeight;
+    fPMap.FillInputVector(floats + 7);
+
+    int* ints = record.ints.data();
+    ints[0] = fInt;
+    ints[1] = fNuPDG;
+    ints[2] = fNProton;
+    ints[3] = fNPion;
+    ints[4] = fNPizero;
+    ints[5] = fNNeutron;
+    ints[6] = fTopologyType;
+    ints[7] = fTopologyTypeAlt;
+  }
+
 } // end namespace cvn
 ////////////////////////////////////////////////////////////////////////
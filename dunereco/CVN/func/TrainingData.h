@@ -7,12 +7,19 @@
 #ifndef CVN_TRAININGDATA_H
 #define CVN_TRAININGDATA_H
 
+#include <vector>
+
 #include "dunereco/CVN/func/InteractionType.h"
 #include "dunereco/CVN/func/AssignLabels.h"
 
 namespace cvn
 {
 
+  // From AsyncDumpWriter.h, kept out of the dictionary headers
+  struct DumpBranch;
+  struct DumpRecord;
+  typedef std::vector<DumpBranch> DumpLayout;
+
 
   /// \brief   The TrainingData objects contains a PixelMap and the
   ///          output class type, and any other bit that goes into the ANN
@@ -27,6 +34,12 @@ namespace cvn
                  float nueEnergy, float numuEnergy,
                  float nutauEnergy, float weight,
                  const PixelMap& pMap);
+    /// As above, taking over the pixel map instead of copying it
+    TrainingData(const InteractionType& interaction,
+                 float nuEnergy, float lepEnergy, float lepAngle,
+                 float nueEnergy, float numuEnergy,
+                 float nutauEnergy, float weight,
+                 PixelMap&& pMap);
 
     unsigned int NOutput() const {return (unsigned int)kNIntType;};
 
@@ -38,6 +51,14 @@ namespace cvn
                                 int npizero, int nneutron, int toptype,
                                 int toptypealt);
 
+    /// Branches of the records written with an AsyncDumpWriter, for pixel
+    /// maps of nPixel pixels: the energies and weight, the pixels, then the
+    /// interaction type and topology
+    static DumpLayout DumpRecordLayout(unsigned int nPixel);
+
+    /// Fill a record of DumpRecordLayout(fPMap.NInput())
+    void FillDumpRecord(DumpRecord& record) const;
+
     InteractionType  fInt;     ///< Class of the event
     float    fNuEnergy;        ///< True energy of neutrino event
     float    fLepEnergy;       ///< True energy of outgoing lepton
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ValidationAccumulator.cxx
+/// \brief   Streaming confusion matrices of the CVN flavour prediction
+/// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "canvas/Utilities/Exception.h"
+
+#include "dunereco/CVN/func/ValidationAccumulator.h"
+
+namespace cvn
+{
+
+  namespace
+  {
+    /// First word of a summary, followed by the format version
+    const std::string kMagic = "CVNValidationSummary";
+    const unsigned int kVersion = 1;
+
+    const char* const kClassNames[ValidationAccumulator::kNPredicted] =
+      {"numuCC", "nueCC", "nutauCC", "NC", "none"};
+  }
+
+  ValidationAccumulator::ValidationAccumulator(unsigned int nBins, float maxEnergy)
+    : fNBins(nBins), fMaxEnergy(maxEnergy)
+  {
+    if(fNBins == 0 || !(fMaxEnergy > 0.))
+      throw art::Exception(art::errors::Configuration)
+        << "CVN validation needs at least one energy bin and a positive maximum energy" << std::endl;
+
+    Allocate();
+  }
+
+  ValidationAccumulator::ValidationAccumulator(std::istream& in)
+    : fNBins(0), fMaxEnergy(0.)
+  {
+    std::string magic;
+    unsigned int version = 0;
+    in >> magic >> version >> fNBins >> fMaxEnergy;
+    if(!in || magic != kMagic || version != kVersion || fNBins == 0)
+      throw art::Exception(art::errors::DataCorruption)
+        << "Not a CVN validation summary of version " << kVersion << std::endl;
+
+    Allocate();
+
+    unsigned int trueClass, predicted, bin;
+    uint64_t count;
+    while(in >> trueClass >> predicted >> bin >> count)
+    {
+      if(trueClass >= kNClasses || predicted >= kNPredicted || bin > fNBins)
+        throw art::Exception(art::errors::DataCorruption)
+          << "CVN validation summary has a cell out of range" << std::endl;
+      fCounts[Index(trueClass, predicted, bin)] += count;
+    }
+
+    if(!in.eof())
+      throw art::Exception(art::errors::DataCorruption)
+        << "CVN validation summary could not be parsed" << std::endl;
+  }
+
+  void ValidationAccumulator::Allocate()
+  {
+    fCounts.reset(new std::atomic<uint64_t>[Size()]);
+    for(unsigned int i = 0; i < Size(); ++i) fCounts[i] = 0;
+  }
+
+  unsigned int ValidationAccumulator::Bin(float energy) const
+  {
+    if(!(energy >= 0.)) return 0;
+    if(energy >= fMaxEnergy) return fNBins;
+    return std::min(fNBins - 1, static_cast<unsigned int>(energy / fMaxEnergy * fNBins));
+  }
+
+  void ValidationAccumulator::Fill(TFFlavour trueFlavour, unsigned int predicted, float energy)
+  {
+    if(predicted > kNotClassified) predicted = kNotClassified;
+    fCounts[Index(trueFlavour, predicted, Bin(energy))].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void ValidationAccumulator::Add(const ValidationAccumulator& other)
+  {
+    if(other.fNBins != fNBins || other.fMaxEnergy != fMaxEnergy)
+      throw art::Exception(art::errors::LogicError)
+        << "Can not add CVN validation summaries with " << other.fNBins << " bins up to "
+        << other.fMaxEnergy << " GeV and " << fNBins << " bins up to " << fMaxEnergy
+        << " GeV" << std::endl;
+
+    for(unsigned int i = 0; i < Size(); ++i)
+      fCounts[i].fetch_add(other.fCounts[i].load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+  }
+
+  uint64_t ValidationAccumulator::Sum(unsigned int trueClass, unsigned int predicted,
+                                      unsigned int bin) const
+  {
+    if(bin != kAllBins) return Count(trueClass, predicted, bin);
+
+    uint64_t sum = 0;
+    for(unsigned int b = 0; b <= fNBins; ++b) sum += Count(trueClass, predicted, b);
+    return sum;
+  }
+
+  uint64_t ValidationAccumulator::Count(unsigned int trueClass, unsigned int predicted) const
+  {
+    return Sum(trueClass, predicted, kAllBins);
+  }
+
+  float ValidationAccumulator::Efficiency(unsigned int cls, unsigned int bin) const
+  {
+    uint64_t total = 0;
+    for(unsigned int p = 0; p < kNPredicted; ++p) total += Sum(cls, p, bin);
+    if(total == 0) return -1.;
+    return static_cast<float>(Sum(cls, cls, bin)) / total;
+  }
+
+  float ValidationAccumulator::Purity(unsigned int cls, unsigned int bin) const
+  {
+    uint64_t total = 0;
+    for(unsigned int t = 0; t < kNClasses; ++t) total += Sum(t, cls, bin);
+    if(total == 0) return -1.;
+    return static_cast<float>(Sum(cls, cls, bin)) / total;
+  }
+
+  void ValidationAccumulator::Write(std::ostream& out) const
+  {
+    out << kMagic << " " << kVersion << " " << fNBins << " "
+        << std::setprecision(std::numeric_limits<float>::max_digits10) << fMaxEnergy << "\n";
+    for(unsigned int t = 0; t < kNClasses; ++t)
+      for(unsigned int p = 0; p < kNPredicted; ++p)
+        for(unsigned int b = 0; b <= fNBins; ++b)
+        {
+          const uint64_t count = Count(t, p, b);
+          if(count) out << t << " " << p << " " << b << " " << count << "\n";
+        }
+  }
+
+  void ValidationAccumulator::Write(const std::string& path) const
+  {
+    std::ofstream out(path);
+    Write(out);
+    out.close();
+    if(!out)
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to write to file " << path << "!" << std::endl;
+  }
+
+  void ValidationAccumulator::Print(std::ostream& out) const
+  {
+    out << "CVN flavour confusion matrix, true (rows) against predicted (columns)\n"
+        << std::setw(10) << "";
+    for(unsigned int p = 0; p < kNPredicted; ++p) out << std::setw(12) << kClassNames[p];
+    out << "\n";
+    for(unsigned int t = 0; t < kNClasses; ++t)
+    {
+      out << std::setw(10) << kClassNames[t];
+      for(unsigned int p = 0; p < kNPredicted; ++p) out << std::setw(12) << Count(t, p);
+      out << "\n";
+    }
+
+    const float width = fMaxEnergy / fNBins;
+    out << "\nEfficiency / purity against true energy (GeV), -1 for an empty bin\n"
+        << std::setw(16) << "";
+    for(unsigned int c = 0; c < kNClasses; ++c) out << std::setw(18) << kClassNames[c];
+    out << "\n" << std::fixed << std::setprecision(3);
+    for(unsigned int b = 0; b <= fNBins + 1; ++b)
+    {
+      const unsigned int bin = b <= fNBins ? b : kAllBins;
+      if(bin == kAllBins)
+        out << std::setw(16) << "all";
+      else if(bin == fNBins)
+        out << std::setw(9) << fMaxEnergy << std::setw(7) << "-";
+      else
+        out << std::setw(8) << b * width << "-" << std::setw(7) << (b + 1) * width;
+      for(unsigned int c = 0; c < kNClasses; ++c)
+        out << std::setw(9) << Efficiency(c, bin) << std::setw(9) << Purity(c, bin);
+      out << "\n";
+    }
+    out << std::defaultfloat;
+  }
+
+}
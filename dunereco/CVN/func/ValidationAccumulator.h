@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ValidationAccumulator.h
+/// \brief   Streaming confusion matrices of the CVN flavour prediction
+/// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_VALIDATIONACCUMULATOR_H
+#define CVN_VALIDATIONACCUMULATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "dunereco/CVN/func/InteractionType.h"
+
+namespace cvn
+{
+
+  /// Counts events by true flavour, predicted flavour and true neutrino
+  /// energy in one fixed size array of atomic counters, so the analyzer can
+  /// fill it from any number of threads without a lock and never keeps the
+  /// events themselves. Efficiencies and purities in every energy bin follow
+  /// from the counts, and the counts of several threads or jobs add up, so
+  /// the summaries of a whole production can be merged afterwards.
+  class ValidationAccumulator
+  {
+  public:
+
+    /// True and predicted classes, the four TFFlavour values
+    static constexpr unsigned int kNClasses = 4;
+    /// Extra predicted class for events without a result or skipped by the
+    /// preselection, so they count against the efficiency
+    static constexpr unsigned int kNotClassified = kNClasses;
+    static constexpr unsigned int kNPredicted = kNClasses + 1;
+
+    /// nBins equal bins of true energy in [0, maxEnergy) GeV, followed by
+    /// an overflow bin
+    ValidationAccumulator(unsigned int nBins, float maxEnergy);
+
+    /// Read a summary written by Write. Throws if it can not be parsed
+    explicit ValidationAccumulator(std::istream& in);
+
+    ValidationAccumulator(const ValidationAccumulator&) = delete;
+    ValidationAccumulator& operator=(const ValidationAccumulator&) = delete;
+
+    /// Count one event. Thread safe
+    void Fill(TFFlavour trueFlavour, unsigned int predicted, float energy);
+
+    /// Add the counts of another accumulator with the same binning.
+    /// Throws if the binning differs
+    void Add(const ValidationAccumulator& other);
+
+    unsigned int NBins() const { return fNBins; }
+    float MaxEnergy() const { return fMaxEnergy; }
+    /// Energy bin of a true energy, NBins() for the overflow
+    unsigned int Bin(float energy) const;
+
+    /// Events in one cell, bin NBins() is the overflow
+    uint64_t Count(unsigned int trueClass, unsigned int predicted, unsigned int bin) const
+    { return fCounts[Index(trueClass, predicted, bin)].load(std::memory_order_relaxed); }
+    /// Events in one cell summed over all energies
+    uint64_t Count(unsigned int trueClass, unsigned int predicted) const;
+
+    /// Fraction of the true events of a class in a bin that are predicted as
+    /// that class, -1 without any true events. Bin kAllBins sums the bins
+    float Efficiency(unsigned int cls, unsigned int bin) const;
+    /// Fraction of the events predicted as a class in a bin that truly are
+    /// that class, -1 without any predicted events
+    float Purity(unsigned int cls, unsigned int bin) const;
+    static constexpr unsigned int kAllBins = ~0u;
+
+    /// Write the compact text summary. Only non-empty cells are written
+    void Write(std::ostream& out) const;
+    /// Write the summary to a file. Throws if the file can not be written
+    void Write(const std::string& path) const;
+
+    /// Print the confusion matrix and the efficiency and purity per bin
+    void Print(std::ostream& out) const;
+
+  private:
+
+    unsigned int Index(unsigned int trueClass, unsigned int predicted, unsigned int bin) const
+    { return (trueClass * kNPredicted + predicted) * (fNBins + 1) + bin; }
+    unsigned int Size() const { return kNClasses * kNPredicted * (fNBins + 1); }
+    void Allocate();
+    /// Counts over the bin, or over all bins for kAllBins
+    uint64_t Sum(unsigned int trueClass, unsigned int predicted, unsigned int bin) const;
+
+    unsigned int fNBins;
+    float fMaxEnergy;
+    std::unique_ptr<std::atomic<uint64_t>[]> fCounts;
+  };
+
+}
+
+#endif  // CVN_VALIDATIONACCUMULATOR_H
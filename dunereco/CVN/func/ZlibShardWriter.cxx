@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ZlibShardWriter.cxx
+/// \brief   Packs compressed training records into tar shards
+/// \author  Jeremy Hewes - jhewes15@fnal.gov
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/CVN/func/ZlibShardWriter.h"
+
+namespace cvn
+{
+
+  ZlibShardWriter::ZlibShardWriter(const std::string &outDir, const std::string &prefix,
+                                   unsigned long shardSize, unsigned int queueDepth,
+                                   const CodecConfig &codec):
+  fOutDir(outDir), fPrefix(prefix), fShardSize(shardSize), fQueueDepth(std::max(queueDepth, 1u)),
+  fDone(false), fClosed(false), fPool(fQueueDepth + 1), fNShards(0), fShardBytes(0), fCodec(codec)
+  {
+    fThread = std::thread(&ZlibShardWriter::Run, this);
+  }
+
+  ZlibShardWriter::~ZlibShardWriter()
+  {
+    try{
+      Close();
+    }
+    catch(const std::exception &e){
+      mf::LogError("ZlibShardWriter") << e.what();
+    }
+  }
+
+  void ZlibShardWriter::Write(const std::string &key, std::vector<unsigned char> &&raw, std::string &&info)
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fDequeued.wait(lock, [this]{ return fQueue.size() < fQueueDepth || !fError.empty(); });
+    CheckError();
+    if(fDone)
+      throw art::Exception(art::errors::LogicError)
+        << "ZlibShardWriter: Write called after Close" << std::endl;
+
+    fQueue.push_back(Record{key, std::move(raw), std::move(info)});
+    fQueued.notify_one();
+  }
+
+  void ZlibShardWriter::Close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if(fClosed) return;
+      fClosed = true;
+      fDone = true;
+    }
+    fQueued.notify_one();
+    if(fThread.joinable()) fThread.join();
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    CheckError();
+  }
+
+  void ZlibShardWriter::Run()
+  {
+    while(true){
+      Record record;
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fQueued.wait(lock, [this]{ return !fQueue.empty() || fDone; });
+        if(fQueue.empty()) break;
+        record = std::move(fQueue.front());
+        fQueue.pop_front();
+      }
+      fDequeued.notify_one();
+
+      try{
+        WriteRecord(record);
+        fPool.Release(std::move(record.raw));
+      }
+      catch(const std::exception &e){
+        // A failed write may end the shard inside a member, which must not look like a valid archive
+        const std::string abandoned = AbandonShard();
+        std::lock_guard<std::mutex> lock(fMutex);
+        fError = e.what() + abandoned;
+        fQueue.clear();
+        fDequeued.notify_all();
+        return;
+      }
+    }
+
+    try{
+      CloseShard();
+    }
+    catch(const std::exception &e){
+      const std::string abandoned = AbandonShard();
+      std::lock_guard<std::mutex> lock(fMutex);
+      fError = e.what() + abandoned;
+    }
+  }
+
+  void ZlibShardWriter::WriteRecord(const Record &record)
+  {
+    // The compression buffer is kept between records
+    const unsigned long dest_len = fCodec.Compress(record.raw.data(), record.raw.size(), fCompressed);
+    if(dest_len == 0)
+      throw art::Exception(art::errors::FileWriteError)
+        << "Unable to compress record " << record.key << " for " << fShardName << "!" << std::endl;
+
+    if(!fShard.is_open()) OpenShard();
+
+    // Both members of a record always go into the same shard
+    WriteMember(record.key + fCodec.Extension(), reinterpret_cast<const char*>(fCompressed.data()), dest_len);
+    WriteMember(record.key + ".info", record.info.data(), record.info.size());
+
+    if(!fShard)
+      throw art::Exception(art::errors::FileWriteError)
+        << "Unable to write to file " << fShardName << "!" << std::endl;
+
+    if(fShardBytes >= fShardSize) CloseShard();
+  }
+
+  void ZlibShardWriter::WriteMember(const std::string &name, const char *data, unsigned long size)
+  {
+    // POSIX ustar header
+    char header[512];
+    std::memset(header, 0, sizeof(header));
+
+    if(name.size() >= 100)
+      throw art::Exception(art::errors::LogicError)
+        << "Tar member name " << name << " is too long!" << std::endl;
+
+    std::memcpy(header, name.data(), name.size());
+    std::snprintf(header + 100, 8, "%07o", 0644);
+    std::snprintf(header + 108, 8, "%07o", 0);
+    std::snprintf(header + 116, 8, "%07o", 0);
+    std::snprintf(header + 124, 12, "%011lo", size);
+    std::snprintf(header + 136, 12, "%011lo", static_cast<unsigned long>(time(0)));
+    header[156] = '0';
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+
+    // The checksum is calculated with its own field set to spaces
+    std::memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for(unsigned int i = 0; i < sizeof(header); ++i) checksum += static_cast<unsigned char>(header[i]);
+    std::snprintf(header + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+
+    static const char padding[512] = {};
+    const unsigned long padded = (512 - size % 512) % 512;
+
+    fShard.write(header, sizeof(header));
+    fShard.write(data, size);
+    fShard.write(padding, padded);
+    fShardBytes += sizeof(header) + size + padded;
+  }
+
+  void ZlibShardWriter::OpenShard()
+  {
+    char index[16];
+    std::snprintf(index, sizeof(index), "%06u", fNShards);
+    fShardName = fOutDir + "/" + fPrefix + "_" + index + ".tar";
+
+    fShard.open(fShardName, std::ofstream::binary);
+    if(!fShard.is_open()){
+      // Nothing was written, so there is nothing to discard
+      fShard.clear();
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to open file " << fShardName << "!" << std::endl;
+    }
+
+    ++fNShards;
+    fShardBytes = 0;
+  }
+
+  void ZlibShardWriter::CloseShard()
+  {
+    if(!fShard.is_open()) return;
+
+    // A tar archive ends with two empty blocks
+    static const char eof[1024] = {};
+    fShard.write(eof, sizeof(eof));
+    fShard.close();
+
+    if(!fShard)
+      throw art::Exception(art::errors::FileWriteError)
+        << "Unable to write to file " << fShardName << "!" << std::endl;
+  }
+
+  std::string ZlibShardWriter::AbandonShard()
+  {
+    // A shard closed without error is complete and stays
+    if(!fShard.is_open() && fShard) return "";
+
+    // While the stream is good the records in it are whole, so it is closed as a valid archive
+    if(fShard){
+      try{
+        CloseShard();
+        return " (" + fShardName + " was closed after the last complete record)";
+      }
+      catch(const std::exception &){
+      }
+    }
+
+    fShard.close();
+    fShard.clear();
+    if(std::remove(fShardName.c_str()) != 0) return " (the incomplete " + fShardName + " could not be removed)";
+    return " (the incomplete " + fShardName + " was removed)";
+  }
+
+  void ZlibShardWriter::CheckError() const
+  {
+    if(!fError.empty())
+      throw art::Exception(art::errors::FileWriteError)
+        << "ZlibShardWriter: " << fError << std::endl;
+  }
+
+}
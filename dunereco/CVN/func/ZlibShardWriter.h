@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ZlibShardWriter.h
+/// \brief   Packs compressed training records into tar shards
+/// \author  Jeremy Hewes - jhewes15@fnal.gov
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_ZLIBSHARDWRITER_H
+#define CVN_ZLIBSHARDWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dunereco/CVN/func/ImageCodec.h"
+#include "dunereco/CVN/func/ScratchBuffers.h"
+
+namespace cvn
+{
+
+  /// Writes the training records of the zlib makers into a few large tar
+  /// shards instead of a .gz and a .info file per record. Each record is
+  /// stored as the two tar members <key>.gz and <key>.info, which is the
+  /// WebDataset layout, so the shards can be read with tarfile or webdataset.
+  /// With zstd or LZ4 the image member is <key>.zst or <key>.lz4 instead.
+  /// Compression and I/O run on a writer thread, the event loop only queues.
+  class ZlibShardWriter
+  {
+  public:
+
+    /// Shards are written as <outDir>/<prefix>_<NNNNNN>.tar and a new one is
+    /// started once a shard holds at least shardSize bytes. At most
+    /// queueDepth records wait for the writer before Write blocks
+    ZlibShardWriter(const std::string &outDir, const std::string &prefix,
+                    unsigned long shardSize, unsigned int queueDepth = 64,
+                    const CodecConfig &codec = CodecConfig());
+    ~ZlibShardWriter();
+
+    /// Queue a record, the raw image is compressed on the writer thread.
+    /// Throws if the writer failed on an earlier record. After a failure
+    /// the shard being written is ended and no further records are taken
+    void Write(const std::string &key, std::vector<unsigned char> &&raw, std::string &&info);
+
+    /// Zero filled raw image buffer for the next Write. The buffers of the
+    /// written records are recycled, so the event loop stops allocating
+    std::vector<unsigned char> Buffer(size_t size) { return fPool.Acquire(size); }
+
+    /// Pool of the raw image buffers
+    const BufferPool &Pool() const { return fPool; }
+
+    /// Flush everything queued and close the current shard. Only the first
+    /// call does anything, so a writer error is thrown once
+    void Close();
+
+  private:
+
+    struct Record
+    {
+      std::string key;
+      std::vector<unsigned char> raw;
+      std::string info;
+    };
+
+    /// Body of the writer thread
+    void Run();
+    /// Compress and append one record to the current shard
+    void WriteRecord(const Record &record);
+    /// Append a single tar member
+    void WriteMember(const std::string &name, const char *data, unsigned long size);
+    void OpenShard();
+    void CloseShard();
+    /// End the shard being written after an error: closed if the stream is
+    /// still good, deleted otherwise. Returns a note for the error message,
+    /// empty if no shard was open
+    std::string AbandonShard();
+    /// Throw the error recorded by the writer thread, if any. Needs fMutex
+    void CheckError() const;
+
+    std::string fOutDir;
+    std::string fPrefix;
+    unsigned long fShardSize;
+    unsigned int fQueueDepth;
+
+    std::mutex fMutex;
+    std::condition_variable fQueued;
+    std::condition_variable fDequeued;
+    std::deque<Record> fQueue;
+    bool fDone;
+    bool fClosed;
+    std::string fError;
+    std::thread fThread;
+    BufferPool fPool;
+
+    // Only touched by the writer thread
+    std::ofstream fShard;
+    std::string fShardName;
+    unsigned int fNShards;
+    unsigned long fShardBytes;
+    ImageCodec fCodec;
+    std::vector<unsigned char> fCompressed;
+  };
+
+}
+
+#endif  // CVN_ZLIBSHARDWRITER_H
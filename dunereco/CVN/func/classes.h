@@ -6,6 +6,9 @@
 #include "dunereco/CVN/func/GCNGraphNode.h"
 #include "dunereco/CVN/func/GCNParticleFlow.h"
 #include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CompactResult.h"
+#include "dunereco/CVN/func/GlobalHitCoordinates.h"
+#include "dunereco/CVN/func/TopologyLabels.h"
 #include "lardataobj/RecoBase/Cluster.h"
 
 #include "canvas/Persistency/Common/Assns.h"
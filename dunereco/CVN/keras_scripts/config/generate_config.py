@@ -17,7 +17,9 @@ config['images']     = {'views':'3',
                         'planes':'500',
                         'cells':'500',
                         'standardize':'False',
-                        'path':'/scratch/cvn/datasetRaw'}
+                        'path':'/scratch/cvn/datasetRaw',
+                        'codec':'zlib',
+                        'dictionary':''}
 
 config['dataset']    = {'uniform':'False',
                         'path':'/scratch/cvn/dataset',
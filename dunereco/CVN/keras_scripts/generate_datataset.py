@@ -16,7 +16,11 @@ import logging
 import sys
 import time
 import random
-import zlib
+import os
+
+sys.path.append(os.path.join(sys.path[0], 'modules'))
+
+from data_generator import decompressor
 
 from sklearn.utils import class_weight
 from collections import Counter
@@ -47,6 +51,8 @@ IMAGES_PATH = config['images']['path']
 VIEWS = int(config['images']['views'])
 PLANES = int(config['images']['planes'])
 CELLS = int(config['images']['cells'])
+CODEC = config['images'].get('codec', 'zlib')
+DICTIONARY = config['images'].get('dictionary', '')
 
 # dataset
 
@@ -120,6 +126,8 @@ count_empty_events = 0
 count_less_10nonzero_views = 0
 count_less_10nonzero_events = 0
 
+decompress = decompressor(CODEC, DICTIONARY)
+
 for images_path in glob.iglob(IMAGES_PATH + '/*'):
 
     count_train, count_val, count_test = (0, 0, 0)
@@ -134,7 +142,7 @@ for images_path in glob.iglob(IMAGES_PATH + '/*'):
 
     for imagefile in files:
         #print imagefile
-        ID = imagefile.split("/")[-1][:-3] 
+        ID = imagefile.split("/")[-1].rsplit('.', 1)[0]
         infofile = images_path + '/info/' + ID + '.info'
 
         #print infofile
@@ -188,7 +196,7 @@ for images_path in glob.iglob(IMAGES_PATH + '/*'):
         random_value = np.random.uniform(0,1)
 
         with open(imagefile, 'rb') as image_file:
-            pixels = np.fromstring(zlib.decompress(image_file.read()), dtype=np.uint8, sep='').reshape(VIEWS, PLANES, CELLS)
+            pixels = np.fromstring(decompress(image_file.read()), dtype=np.uint8, sep='').reshape(VIEWS, PLANES, CELLS)
 
             #pixels = np.load(self.images_path + '/' + labels[ID] + '/' + ID + '.npy')
 
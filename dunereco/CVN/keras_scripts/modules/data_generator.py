@@ -10,6 +10,34 @@ import numpy as np
 import zlib
 from string import digits
 
+'''
+File extension of the images written with each codec (the Codec parameter
+of the zlib makers and cvnCreateZlibImages)
+'''
+EXTENSIONS = {'zlib': '.gz', 'zstd': '.zst', 'lz4': '.lz4'}
+
+'''
+Returns the function decompressing the images written with the given codec.
+The zstandard and lz4 modules are only needed for their codecs. Images
+written with a zstd dictionary need the same dictionary file.
+'''
+def decompressor(codec='zlib', dictionary=None):
+    'Image decompression function of a codec'
+
+    if codec == 'zlib':
+        return zlib.decompress
+    if codec == 'zstd':
+        import zstandard
+        dict_data = None
+        if dictionary:
+            with open(dictionary, 'rb') as dictionary_file:
+                dict_data = zstandard.ZstdCompressionDict(dictionary_file.read())
+        return zstandard.ZstdDecompressor(dict_data=dict_data).decompress
+    if codec == 'lz4':
+        import lz4.frame
+        return lz4.frame.decompress
+    raise ValueError('unknown codec ' + codec + ', use zlib, zstd or lz4')
+
 class DataGenerator(object):
 
     'Generates data for Keras'
@@ -18,7 +46,8 @@ class DataGenerator(object):
     Initialization function of the class
     '''
     def __init__(self, cells=500, planes=500, views=3, batch_size=32, branches=True, 
-                 outputs=7, standardize=True, images_path = '/', shuffle=True, test_values=[]):
+                 outputs=7, standardize=True, images_path = '/', shuffle=True, test_values=[],
+                 codec='zlib', dictionary=None):
         'Initialization'
         self.cells = cells
         self.planes = planes
@@ -30,6 +59,8 @@ class DataGenerator(object):
         self.standardize = standardize
         self.shuffle = shuffle
         self.test_values = test_values
+        self.extension = EXTENSIONS[codec]
+        self.decompress = decompressor(codec, dictionary)
  
     '''
     Goes through the dataset and outputs one batch at a time.
@@ -106,8 +137,8 @@ class DataGenerator(object):
         # Generate data
         for i, ID in enumerate(list_IDs_temp):
             # Decompress image into pixel NumPy tensor
-            with open(self.images_path + '/' + ID.split('.')[0].lstrip('a') + '/images/' + ID + '.gz', 'rb') as image_file:
-                pixels = np.fromstring(zlib.decompress(image_file.read()), dtype=np.uint8, sep='').reshape(self.views, self.planes, self.cells)
+            with open(self.images_path + '/' + ID.split('.')[0].lstrip('a') + '/images/' + ID + self.extension, 'rb') as image_file:
+                pixels = np.fromstring(self.decompress(image_file.read()), dtype=np.uint8, sep='').reshape(self.views, self.planes, self.cells)
             #pixels = np.load(self.images_path + '/' + labels[ID] + '/' + ID + '.npy')
 
             if self.standardize:
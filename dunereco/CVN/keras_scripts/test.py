@@ -61,6 +61,8 @@ VIEWS = int(config['images']['views'])
 PLANES = int(config['images']['planes'])
 CELLS = int(config['images']['cells'])
 STANDARDIZE = ast.literal_eval(config['images']['standardize'])
+CODEC = config['images'].get('codec', 'zlib')
+DICTIONARY = config['images'].get('dictionary', '')
 
 # dataset
 
@@ -102,7 +104,9 @@ TEST_PARAMS = {'planes':PLANES,
                'images_path':IMAGES_PATH,
                'standardize':STANDARDIZE,
                'shuffle':SHUFFLE,
-               'test_values':test_values}
+               'test_values':test_values,
+               'codec':CODEC,
+               'dictionary':DICTIONARY}
 
 
 '''
@@ -72,6 +72,8 @@ VIEWS = int(config['images']['views'])
 PLANES = int(config['images']['planes'])
 CELLS = int(config['images']['cells'])
 STANDARDIZE = ast.literal_eval(config['images']['standardize'])
+CODEC = config['images'].get('codec', 'zlib')
+DICTIONARY = config['images'].get('dictionary', '')
 
 # dataset
 
@@ -126,7 +128,9 @@ TRAIN_PARAMS = {'planes':PLANES,
                 'outputs': OUTPUTS,
                 'images_path':IMAGES_PATH,
                 'standardize':STANDARDIZE,
-                'shuffle':SHUFFLE}
+                'shuffle':SHUFFLE,
+                'codec':CODEC,
+                'dictionary':DICTIONARY}
 
 # validation params
 
@@ -138,7 +142,9 @@ VALIDATION_PARAMS = {'planes':PLANES,
                      'outputs': OUTPUTS,
                      'images_path':IMAGES_PATH,
                      'standardize':STANDARDIZE,
-                     'shuffle':SHUFFLE}
+                     'shuffle':SHUFFLE,
+                     'codec':CODEC,
+                     'dictionary':DICTIONARY}
 
 
 '''
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    DBReader.h
+/// \brief   Read-only sequential scans of the CVN training databases
+/// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_DBREADER_H
+#define CVN_DBREADER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <leveldb/cache.h>
+#include <leveldb/db.h>
+#include <lmdb.h>
+
+namespace cvn
+{
+
+  /// Scans the LevelDB or LMDB databases written by cvnCreateDB without
+  /// copying the records. LMDB records are handed out as pointers into the
+  /// memory map. LevelDB records are handed out as the iterator's slices,
+  /// read with fill_cache off so a scan does not evict the block cache. The
+  /// key space can be split into ranges of about equal numbers of records,
+  /// each scanned by its own thread, which is safe for both backends: every
+  /// range has its own LevelDB iterator or LMDB read transaction.
+  ///
+  /// The visitor is called as visit(range, key, keySize, value, valueSize)
+  /// and returns false to stop its range. The pointers are only valid for the
+  /// duration of the call.
+  class DBReader
+  {
+  public:
+
+    enum Backend { kLevelDB, kLMDB };
+
+    /// Open a database read-only. blockCacheMB sets the LevelDB block cache,
+    /// 0 for the LevelDB default
+    DBReader(const std::string& path, Backend backend, size_t blockCacheMB = 0);
+    ~DBReader();
+
+    DBReader(const DBReader&) = delete;
+    DBReader& operator=(const DBReader&) = delete;
+
+    /// Visit the records with first <= key < last in key order, an empty
+    /// bound is open. Returns the number of records visited
+    template <typename Visitor>
+    size_t Scan(Visitor&& visit, const std::string& first = "",
+                const std::string& last = "", unsigned int range = 0) const;
+
+    /// Keys splitting the database into nRanges ranges of about equal
+    /// numbers of records, nRanges + 1 bounds with open ends. Walks the keys
+    /// once; for LMDB only the key pages are touched, a LevelDB iterator
+    /// also reads the blocks of the values
+    std::vector<std::string> Bounds(unsigned int nRanges) const;
+
+    /// Scan the ranges of Bounds(nThreads) on nThreads threads. The visitor
+    /// gets the range index, so it can fill per range accumulators. Returns
+    /// the number of records visited
+    template <typename Visitor>
+    size_t ParallelScan(unsigned int nThreads, Visitor&& visit) const;
+
+  private:
+
+    Backend fBackend;
+
+    std::unique_ptr<leveldb::Cache> fCache;
+    std::unique_ptr<leveldb::DB> fLevelDB;
+
+    MDB_env* fEnv;
+    MDB_dbi fDbi;
+  };
+
+  //......................................................................
+  inline DBReader::DBReader(const std::string& path, Backend backend, size_t blockCacheMB)
+    : fBackend(backend), fEnv(nullptr), fDbi(0)
+  {
+    if (fBackend == kLevelDB) {
+      leveldb::Options options;
+      options.create_if_missing = false;
+      if (blockCacheMB > 0) {
+        fCache.reset(leveldb::NewLRUCache(blockCacheMB << 20));
+        options.block_cache = fCache.get();
+      }
+
+      leveldb::DB* db = nullptr;
+      const leveldb::Status status = leveldb::DB::Open(options, path, &db);
+      if (!status.ok())
+        throw std::runtime_error("Problem opening the database " + path + ": " + status.ToString());
+      fLevelDB.reset(db);
+      return;
+    }
+
+    // Readers of a finished database need no lock file, and one read
+    // transaction per range may live on any thread
+    MDB_txn* txn = nullptr;
+    if (mdb_env_create(&fEnv) != MDB_SUCCESS ||
+        mdb_env_set_maxreaders(fEnv, 1024) != MDB_SUCCESS ||
+        mdb_env_open(fEnv, path.c_str(), MDB_RDONLY | MDB_NOLOCK | MDB_NOTLS, 0664) != MDB_SUCCESS ||
+        mdb_txn_begin(fEnv, nullptr, MDB_RDONLY, &txn) != MDB_SUCCESS ||
+        mdb_dbi_open(txn, nullptr, 0, &fDbi) != MDB_SUCCESS) {
+      if (txn) mdb_txn_abort(txn);
+      if (fEnv) mdb_env_close(fEnv);
+      throw std::runtime_error("Problem opening the database " + path);
+    }
+    mdb_txn_abort(txn);
+  }
+
+  //......................................................................
+  inline DBReader::~DBReader()
+  {
+    if (fEnv) mdb_env_close(fEnv);
+    // The database must go before the cache it uses
+    fLevelDB.reset();
+  }
+
+  //......................................................................
+  template <typename Visitor>
+  size_t DBReader::Scan(Visitor&& visit, const std::string& first,
+                        const std::string& last, unsigned int range) const
+  {
+    size_t n = 0;
+
+    if (fBackend == kLevelDB) {
+      leveldb::ReadOptions options;
+      options.fill_cache = false;
+      std::unique_ptr<leveldb::Iterator> it(fLevelDB->NewIterator(options));
+
+      if (first.empty()) it->SeekToFirst();
+      else it->Seek(first);
+      for (; it->Valid(); it->Next()) {
+        const leveldb::Slice key = it->key();
+        if (!last.empty() && key.compare(last) >= 0) break;
+        const leveldb::Slice value = it->value();
+        ++n;
+        if (!visit(range, key.data(), key.size(), value.data(), value.size())) break;
+      }
+      if (!it->status().ok())
+        throw std::runtime_error("Problem reading the database: " + it->status().ToString());
+      return n;
+    }
+
+    MDB_txn* txn = nullptr;
+    MDB_cursor* cursor = nullptr;
+    if (mdb_txn_begin(fEnv, nullptr, MDB_RDONLY, &txn) != MDB_SUCCESS ||
+        mdb_cursor_open(txn, fDbi, &cursor) != MDB_SUCCESS) {
+      if (txn) mdb_txn_abort(txn);
+      throw std::runtime_error("Problem starting a read of the database");
+    }
+
+    MDB_val key, value;
+    if (!first.empty()) {
+      key.mv_size = first.size();
+      key.mv_data = const_cast<char*>(first.data());
+    }
+    int rc = mdb_cursor_get(cursor, &key, &value, first.empty() ? MDB_FIRST : MDB_SET_RANGE);
+    for (; rc == MDB_SUCCESS; rc = mdb_cursor_get(cursor, &key, &value, MDB_NEXT)) {
+      const char* keyData = static_cast<const char*>(key.mv_data);
+      if (!last.empty() && std::string_view(keyData, key.mv_size) >= last) break;
+      ++n;
+      if (!visit(range, keyData, key.mv_size, static_cast<const char*>(value.mv_data), value.mv_size)) break;
+    }
+
+    mdb_cursor_close(cursor);
+    mdb_txn_abort(txn);
+    return n;
+  }
+
+  //......................................................................
+  inline std::vector<std::string> DBReader::Bounds(unsigned int nRanges) const
+  {
+    nRanges = std::max(nRanges, 1u);
+
+    std::vector<std::string> keys;
+    Scan([&keys](unsigned int, const char* key, size_t keySize, const char*, size_t) {
+        keys.emplace_back(key, keySize);
+        return true;
+      });
+
+    std::vector<std::string> bounds(1);
+    for (unsigned int r = 1; r < nRanges && !keys.empty(); ++r) {
+      const std::string& bound = keys[keys.size() * r / nRanges];
+      if (bound != bounds.back()) bounds.push_back(bound);
+    }
+    bounds.emplace_back();
+    return bounds;
+  }
+
+  //......................................................................
+  template <typename Visitor>
+  size_t DBReader::ParallelScan(unsigned int nThreads, Visitor&& visit) const
+  {
+    const std::vector<std::string> bounds = Bounds(nThreads);
+    const unsigned int nRanges = bounds.size() - 1;
+    if (nRanges == 1) return Scan(visit);
+
+    std::vector<size_t> counts(nRanges, 0);
+    std::vector<std::exception_ptr> errors(nRanges);
+    std::vector<std::thread> threads;
+    for (unsigned int r = 0; r < nRanges; ++r) {
+      threads.emplace_back([&, r] {
+          try { counts[r] = Scan(visit, bounds[r], bounds[r + 1], r); }
+          catch (...) { errors[r] = std::current_exception(); }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    for (const std::exception_ptr& error : errors)
+      if (error) std::rethrow_exception(error);
+
+    size_t n = 0;
+    for (size_t count : counts) n += count;
+    return n;
+  }
+
+} // namespace cvn
+
+#endif  // CVN_DBREADER_H
@@ -4,6 +4,11 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 // Boost, for program options
 #include "boost/program_options/options_description.hpp"
@@ -74,6 +79,8 @@ public:
     fWriteSync (pset.get<bool>("WriteSync")),
     fMaxKeyLength (pset.get<unsigned int>("MaxKeyLength")),
     fWriteBufferSize (pset.get<unsigned int>("WriteBufferSize")),
+    fWriteBatchSize (pset.get<unsigned int>("WriteBatchSize", 1000)),
+    fWriteQueueDepth (pset.get<unsigned int>("WriteQueueDepth", 4096)),
     fLabeling (pset.get<std::string>("Labeling")),
     fUseGeV (pset.get<bool>("UseGeV")),
     fWriteRegressionHDF5 (pset.get<bool>("WriteRegressionHDF5")),
@@ -110,6 +117,10 @@ public:
   bool          fWriteSync;
   unsigned int  fMaxKeyLength;
   unsigned int  fWriteBufferSize;
+  /// Number of datums committed in each LevelDB write batch or LMDB transaction
+  unsigned int  fWriteBatchSize;
+  /// Number of serialised datums that can wait for the writer thread
+  unsigned int  fWriteQueueDepth;
 
   std::string   fLabeling;
   unsigned int  fLabelingMode;
@@ -131,26 +142,56 @@ public:
   std::vector<bool> fReverseViews;
 };
 
+/// Output database. Put only queues the serialised datum, a writer thread
+/// commits them in batches of WriteBatchSize. Put blocks when WriteQueueDepth
+/// datums are waiting, and the time spent blocked is reported at the end so
+/// the batch size can be tuned for the storage in use.
 class OutputDB {
 public:
   OutputDB(std::string sample, const Config& config);
   ~OutputDB();
 
-  void Put(std::string &serializeKey, std::string  &serializeString);
+  void Put(std::string serializeKey, std::string serializeString);
 
 private:
+  /// Writer thread, commits the queue batch by batch
+  void Write();
+  void Commit(std::vector<std::pair<std::string, std::string> >& batch);
+
+  std::string fSample;
+
   leveldb::DB* fLevelDB;
   leveldb::WriteOptions fWriteOptions;
 
   MDB_env *mdb_env;
   MDB_dbi mdb_dbi;
   MDB_val mdb_key, mdb_data;
-  MDB_txn *mdb_txn;
-  
+
+  unsigned int fBatchSize;
+  unsigned int fQueueDepth;
+
+  std::mutex fMutex;
+  std::condition_variable fQueued;
+  std::condition_variable fDequeued;
+  std::deque<std::pair<std::string, std::string> > fQueue;
+  bool fDone;
+  std::thread fWriter;
+
+  // Backpressure metrics
+  unsigned long fNPut;
+  unsigned long fNBlockedPut;
+  unsigned long fMaxQueued;
+  double fBlockedSeconds;
+  unsigned long fNBatches;
+  double fCommitSeconds;
 };
 
 OutputDB::OutputDB(std::string sample, const Config& config) :
-  fLevelDB(0),  mdb_env(0), mdb_txn(0) {
+  fSample(sample), fLevelDB(0),  mdb_env(0),
+  fBatchSize(std::max(config.fWriteBatchSize, 1u)),
+  fQueueDepth(std::max(config.fWriteQueueDepth, 1u)), fDone(false),
+  fNPut(0), fNBlockedPut(0), fMaxQueued(0), fBlockedSeconds(0.),
+  fNBatches(0), fCommitSeconds(0.) {
 
   std::string outputDir;
   if (sample=="test") 
@@ -178,8 +219,10 @@ OutputDB::OutputDB(std::string sample, const Config& config) :
     mdb_env_create(&mdb_env);
     mdb_env_set_mapsize(mdb_env, 10737418240);
     mdb_env_open(mdb_env, outputDir.c_str(), 0, 0777);
+    MDB_txn *mdb_txn;
     mdb_txn_begin(mdb_env, NULL, 0, &mdb_txn);
     mdb_dbi_open(mdb_txn,NULL, 0, &mdb_dbi);
+    mdb_txn_commit(mdb_txn);
   }
 
   else {
@@ -187,26 +230,97 @@ OutputDB::OutputDB(std::string sample, const Config& config) :
     exit(1);
   }
 
+  fWriter = std::thread(&OutputDB::Write, this);
+
 }
 
 OutputDB::~OutputDB() {
-  if (mdb_txn)  mdb_txn_commit(mdb_txn);
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fDone = true;
+  }
+  fQueued.notify_one();
+  fWriter.join();
+
+  std::cout << "- " << fSample << " DB: " << fNPut << " datums in "
+            << fNBatches << " batches, " << fCommitSeconds << " s committing" << std::endl;
+  std::cout << "  Put blocked " << fNBlockedPut << " times for "
+            << fBlockedSeconds << " s, at most " << fMaxQueued
+            << " of " << fQueueDepth << " datums queued" << std::endl;
+
+  delete fLevelDB;
+  if (mdb_env) mdb_env_close(mdb_env);
 }
 
-void OutputDB::Put(std::string &serializeKey, std::string  &serializeString) {
+void OutputDB::Put(std::string serializeKey, std::string serializeString) {
+  std::unique_lock<std::mutex> lock(fMutex);
+  if (fQueue.size() >= fQueueDepth) {
+    // The writer is behind, wait for it and record how long for
+    const auto start = std::chrono::steady_clock::now();
+    fDequeued.wait(lock, [this]{ return fQueue.size() < fQueueDepth; });
+    fBlockedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++fNBlockedPut;
+  }
+
+  fQueue.emplace_back(std::move(serializeKey), std::move(serializeString));
+  fMaxQueued = std::max<unsigned long>(fMaxQueued, fQueue.size());
+  ++fNPut;
+  fQueued.notify_one();
+}//end OutputDB::Put
+
+void OutputDB::Write() {
+  std::vector<std::pair<std::string, std::string> > batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      // Wait for a full batch unless we are finishing up
+      fQueued.wait(lock, [this]{ return fQueue.size() >= fBatchSize || fDone; });
+      if (fQueue.empty()) break;
+
+      const size_t nTake = std::min<size_t>(fQueue.size(), fBatchSize);
+      batch.clear();
+      for (size_t i = 0; i < nTake; ++i) {
+        batch.push_back(std::move(fQueue.front()));
+        fQueue.pop_front();
+      }
+    }
+    fDequeued.notify_all();
+
+    const auto start = std::chrono::steady_clock::now();
+    Commit(batch);
+    fCommitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++fNBatches;
+  }
+}//end OutputDB::Write
+
+void OutputDB::Commit(std::vector<std::pair<std::string, std::string> >& batch) {
   if (fLevelDB) {
-    fLevelDB->Put(fWriteOptions, serializeKey, serializeString);
+    leveldb::WriteBatch writeBatch;
+    for (const auto& datum : batch)
+      writeBatch.Put(datum.first, datum.second);
+    if (!fLevelDB->Write(fWriteOptions, &writeBatch).ok()) {
+      std::cout<< "ERROR: Events not loaded correctly" <<std::endl;
+    }
   } //end if LevelDB
   else {//it must be LMDB
-    mdb_data.mv_size=serializeString.size();
-    mdb_data.mv_data=reinterpret_cast<void*>(&serializeString[0]);
-    mdb_key.mv_size=serializeKey.size();
-    mdb_key.mv_data=reinterpret_cast<void*>(&serializeKey[0]);
-    if ( mdb_put(mdb_txn,mdb_dbi,&mdb_key,&mdb_data,0)!= MDB_SUCCESS){
+    // LMDB transactions belong to the thread that opened them, so each batch
+    // is its own transaction opened here
+    MDB_txn *mdb_txn;
+    mdb_txn_begin(mdb_env, NULL, 0, &mdb_txn);
+    for (auto& datum : batch) {
+      mdb_data.mv_size=datum.second.size();
+      mdb_data.mv_data=reinterpret_cast<void*>(&datum.second[0]);
+      mdb_key.mv_size=datum.first.size();
+      mdb_key.mv_data=reinterpret_cast<void*>(&datum.first[0]);
+      if ( mdb_put(mdb_txn,mdb_dbi,&mdb_key,&mdb_data,0)!= MDB_SUCCESS){
+        std::cout<< "ERROR: Events not loaded correctly" <<std::endl;
+      }//end if put fails
+    }
+    if (mdb_txn_commit(mdb_txn) != MDB_SUCCESS) {
       std::cout<< "ERROR: Events not loaded correctly" <<std::endl;
-    }//end if put fails
+    }
   }//end if LMDB
-}//end OutputDB::Put
+}//end OutputDB::Commit
 
 void fill(const Config& config, std::string input)
 {
@@ -361,7 +475,7 @@ void fill(const Config& config, std::string input)
       snprintf(key, config.fMaxKeyLength, "%08lld", (long long int)iTrain);
       std::string serializeKey(key);
 
-      TrainDB.Put(serializeKey,serializeString);
+      TrainDB.Put(std::move(serializeKey),std::move(serializeString));
 
       regressionDataTrain[iTrain][0] = 1.;
       regressionDataTrain[iTrain][1] = 1.;
@@ -385,7 +499,7 @@ void fill(const Config& config, std::string input)
       snprintf(key, config.fMaxKeyLength, "%08lld", (long long int)iTest);
       std::string serializeKey(key);
 
-      TestDB.Put(serializeKey,serializeString);
+      TestDB.Put(std::move(serializeKey),std::move(serializeString));
 
       regressionDataTest[iTest][0] = 1.;
       regressionDataTest[iTest][1] = 1.;
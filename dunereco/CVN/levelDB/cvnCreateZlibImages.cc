@@ -10,6 +10,12 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 
 // Boost, for program options
 #include "boost/program_options/options_description.hpp"
@@ -26,13 +32,14 @@
 // ROOT stuff
 #include "TChain.h"
 #include "TFile.h"
+#include "TROOT.h"
 
 // CVN stuff
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/ImageCodec.h"
+#include "dunereco/CVN/func/ZlibShardWriter.h"
 //#include "CVN/art/CaffeNetHandler.h"
 
-#include "zlib.h" // compression algorithm
-
 namespace po = boost::program_options;
 
 class Config
@@ -45,7 +52,14 @@ public:
     fNEvents (pset.get<unsigned int>("NEvents")),
     fPlaneLimit (pset.get<unsigned int>("PlaneLimit")),
     fTDCLimit (pset.get<unsigned int>("TDCLimit")),
-    fReverseViews(pset.get<std::vector<bool> >("ReverseViews"))
+    fReverseViews(pset.get<std::vector<bool> >("ReverseViews")),
+    fNWorkers (pset.get<unsigned int>("NWorkers", 0)),
+    fChunkSize (std::max(1u, pset.get<unsigned int>("ChunkSize", 10000))),
+    fShardSize (pset.get<unsigned long>("ShardSize", 1000000000)),
+    fShardPrefix (pset.get<std::string>("ShardPrefix", "cvn")),
+    fCodec (cvn::ReadCodecConfig(pset)),
+    fTrainDictionary (pset.get<unsigned int>("TrainDictionary", 0)),
+    fDictionarySize (pset.get<unsigned long>("DictionarySize", 112640))
   {
   };
 
@@ -67,13 +81,100 @@ public:
   int fTDCLimit;
   /// Views to reverse
   std::vector<bool> fReverseViews;
+  /// Worker threads writing tar shards, 0 to write a .gz and a .info file per entry
+  unsigned int fNWorkers;
+  /// Entries of each unit of work of the sharded mode, the unit of the resume index
+  unsigned int fChunkSize;
+  /// Bytes after which a chunk starts a new shard
+  unsigned long fShardSize;
+  /// Shards are named <OutputDir>/<ShardPrefix>_c<chunk>_<NNNNNN>.tar
+  std::string fShardPrefix;
+  /// Codec of the images, zlib by default
+  cvn::CodecConfig fCodec;
+  /// zstd: train a dictionary on this many entries first, 0 for none
+  unsigned int fTrainDictionary;
+  /// Maximum size of the trained dictionary in bytes
+  unsigned long fDictionarySize;
 };
 
-void fill(const Config& config, std::string input)
+/// The branches of one entry of the training tree
+struct TreeEntry
 {
+  int fInt;
+  UInt_t          fPMap_fNWire;
+  UInt_t          fPMap_fNTdc;
+  std::vector<float>   fPMap_fPEX;
+  std::vector<float>   fPMap_fPEY;
+  std::vector<float>   fPMap_fPEZ;
 
-  TChain chain(config.fTreeName.c_str());
+  float fNuEnergy = -1;
+  float fLepEnergy = -1;
+  float fRecoNueEnergy = -1;
+  float fRecoNumuEnergy = -1;
+  float fEventWeight = -1;
+
+  int  fNuPDG = -1;
+  int  fNProton = -1;
+  int  fNPion = -1;
+  int  fNPizero = -1;
+  int  fNNeutron = -1;
+
+  int  fTopologyType = -1;
+  int  fTopologyTypeAlt = -1;
+
+  void SetBranches(TChain& chain)
+  {
+    chain.SetBranchAddress("fInt", &fInt);
+    chain.SetBranchAddress("fPMap.fNWire", &fPMap_fNWire);
+    chain.SetBranchAddress("fPMap.fNTdc", &fPMap_fNTdc);
+    chain.SetBranchAddress("fPMap.fPEX", &fPMap_fPEX);
+    chain.SetBranchAddress("fPMap.fPEY", &fPMap_fPEY);
+    chain.SetBranchAddress("fPMap.fPEZ", &fPMap_fPEZ);
+
+    chain.SetBranchAddress("fNuEnergy", &fNuEnergy);
+    chain.SetBranchAddress("fLepEnergy", &fLepEnergy);
+    chain.SetBranchAddress("fRecoNueEnergy", &fRecoNueEnergy);
+    chain.SetBranchAddress("fRecoNumuEnergy", &fRecoNumuEnergy);
+    chain.SetBranchAddress("fEventWeight", &fEventWeight);
+
+    chain.SetBranchAddress("fNuPDG", &fNuPDG);
+    chain.SetBranchAddress("fNProton", &fNProton);
+    chain.SetBranchAddress("fNPion", &fNPion);
+    chain.SetBranchAddress("fNPizero", &fNPizero);
+    chain.SetBranchAddress("fNNeutron", &fNNeutron);
+
+    chain.SetBranchAddress("fTopologyType", &fTopologyType);
+    chain.SetBranchAddress("fTopologyTypeAlt", &fTopologyTypeAlt);
+  }
+
+  /// The records of the .info file, one per line
+  std::string Info() const
+  {
+    std::ostringstream info;
+    // Category
+    info << fInt << std::endl;
+    // Energy
+    info << fNuEnergy << std::endl;
+    info << fLepEnergy << std::endl;
+    info << fRecoNueEnergy << std::endl;
+    info << fRecoNumuEnergy << std::endl;
+    info << fEventWeight << std::endl;
+    // Topology
+    info << fNuPDG << std::endl;
+    info << fNProton << std::endl;
+    info << fNPion << std::endl;
+    info << fNPizero << std::endl;
+    info << fNNeutron << std::endl;
+
+    info << fTopologyType << std::endl;
+    info << fTopologyTypeAlt;
+    return info.str();
+  }
+};
 
+/// Add the input, a .root file or a .list of them, to a chain
+void addInput(TChain& chain, const std::string& input)
+{
   if (boost::ends_with(input,".list")) {
     std::ifstream list_file(input.c_str());
     if (!list_file.is_open()) {
@@ -92,50 +193,16 @@ void fill(const Config& config, std::string input)
   }//end if root file
 
   chain.SetMakeClass(1);
+}
 
-  int fInt;
-  UInt_t          fPMap_fNWire;
-  UInt_t          fPMap_fNTdc;
-  std::vector<float>   fPMap_fPEX;
-  std::vector<float>   fPMap_fPEY;
-  std::vector<float>   fPMap_fPEZ;
-
-  chain.SetBranchAddress("fInt", &fInt);
-  chain.SetBranchAddress("fPMap.fNWire", &fPMap_fNWire);
-  chain.SetBranchAddress("fPMap.fNTdc", &fPMap_fNTdc);
-  chain.SetBranchAddress("fPMap.fPEX", &fPMap_fPEX);
-  chain.SetBranchAddress("fPMap.fPEY", &fPMap_fPEY);
-  chain.SetBranchAddress("fPMap.fPEZ", &fPMap_fPEZ);
-
-  float fNuEnergy = -1;
-  float fLepEnergy = -1;
-  float fRecoNueEnergy = -1;
-  float fRecoNumuEnergy = -1;
-  float fEventWeight = -1;
-
-  int  fNuPDG = -1;
-  int  fNProton = -1;
-  int  fNPion = -1;
-  int  fNPizero = -1;
-  int  fNNeutron = -1;
+void fill(const Config& config, std::string input)
+{
 
-  int  fTopologyType = -1;
-  int  fTopologyTypeAlt = -1;
+  TChain chain(config.fTreeName.c_str());
+  addInput(chain, input);
 
-  chain.SetBranchAddress("fNuEnergy", &fNuEnergy);
-  chain.SetBranchAddress("fLepEnergy", &fLepEnergy);
-  chain.SetBranchAddress("fRecoNueEnergy", &fRecoNueEnergy);
-  chain.SetBranchAddress("fRecoNumuEnergy", &fRecoNumuEnergy);
-  chain.SetBranchAddress("fEventWeight", &fEventWeight);
- 
-  chain.SetBranchAddress("fNuPDG", &fNuPDG);
-  chain.SetBranchAddress("fNProton", &fNProton);
-  chain.SetBranchAddress("fNPion", &fNPion);
-  chain.SetBranchAddress("fNPizero", &fNPizero);
-  chain.SetBranchAddress("fNNeutron", &fNNeutron);
-
-  chain.SetBranchAddress("fTopologyType", &fTopologyType);
-  chain.SetBranchAddress("fTopologyTypeAlt", &fTopologyTypeAlt);
+  TreeEntry tree;
+  tree.SetBranches(chain);
 
   unsigned int entries = chain.GetEntries();
   if(config.fNEvents < entries){
@@ -185,6 +252,9 @@ void fill(const Config& config, std::string input)
     }
   }
 
+  cvn::ImageCodec codec(config.fCodec);
+  std::vector<unsigned char> compressed;
+
   for(unsigned int iEntry = 0; iEntry < entries; ++iEntry)
   {
     unsigned int entry = shuffled[iEntry];
@@ -196,13 +266,13 @@ void fill(const Config& config, std::string input)
     // define how large we want the output image to be
     cvn::CVNImageUtils imageUtils(config.fPlaneLimit,config.fTDCLimit,nViews);
     // Since we don't have a PixelMap object, we need to tell it how big it is
-    imageUtils.SetPixelMapSize(fPMap_fNWire,fPMap_fNTdc);
+    imageUtils.SetPixelMapSize(tree.fPMap_fNWire,tree.fPMap_fNTdc);
     
     std::vector<unsigned char> pixelArray(nViews * config.fPlaneLimit * config.fTDCLimit,0);
 
     imageUtils.SetLogScale(config.fSetLog);
     imageUtils.SetViewReversal(config.fReverseViews);
-    imageUtils.ConvertChargeVectorsToPixelArray(fPMap_fPEX, fPMap_fPEY, fPMap_fPEZ, pixelArray);
+    imageUtils.ConvertChargeVectorsToPixelArray(tree.fPMap_fPEX, tree.fPMap_fPEY, tree.fPMap_fPEZ, pixelArray);
 
     //std::cout << "fNuEnergyi: " << fNuEnergy << std::endl;
     //std::cout << "fRecoNueEnergy: " << fRecoNueEnergy << std::endl;
@@ -216,37 +286,21 @@ void fill(const Config& config, std::string input)
     //std::cout << "[DEBUG] cells: " << config.fTDCLimit << std::endl;   
     //std::cout << "[DEBUG] channels*planes*cells: " << channels*planes*cells << std::endl; 
     
-    std::cout << "[DEBUG] label: " << fInt << std::endl;
+    std::cout << "[DEBUG] label: " << tree.fInt << std::endl;
     unsigned long srcLen = nViews * config.fPlaneLimit * config.fTDCLimit; // pixelArray length
-    unsigned long destLen = compressBound(srcLen);     // calculate size of the compressed data               
-    char* ostream = (char *) malloc(destLen);  // allocate memory for the compressed data
-
-    int res = compress((Bytef *) ostream, &destLen, (Bytef *) &pixelArray[0], srcLen); // compress pixels 
-
-    // destLen is now the size of actuall buffer needed for compression
-    // you don't want to uncompress whole buffer later, just the used part
-    //
-
-    // Buffer error
+    unsigned long destLen = codec.Compress(pixelArray.data(), srcLen, compressed); // compress pixels 
 
-    if(res == Z_BUF_ERROR){
-        std::cout << "[DEBUG] Buffer was too small!" << std::endl;
-    }
-
-    // Memory error
-    
-    else if(res ==  Z_MEM_ERROR){
-        std::cout << "[DEBUG] Not enough memory for compression!" << std::endl;
-    }
+    // destLen is the size of the used part of the compression buffer, which
+    // is kept for the next entry
 
     // Compression ok 
    
-    else{
+    if(destLen > 0){
         std::cout << "[DEBUG] Compression successful" << std::endl;
 
         // Create output files 
 
-        std::string image_file_name = image_path + input + std::to_string(iEntry) + ".gz";
+        std::string image_file_name = image_path + input + std::to_string(iEntry) + codec.Extension();
         std::string info_file_name = info_path + input + std::to_string(iEntry) + ".info";
 
         while(1){
@@ -258,34 +312,13 @@ void fill(const Config& config, std::string input)
 
                 // Write compressed data to file
 
-                image_file.write(ostream, destLen);
+                image_file.write(reinterpret_cast<const char*>(compressed.data()), destLen);
 
                 image_file.close(); // close file
 
                 // Write records to file
 
-                // Category
-
-                info_file << fInt << std::endl;
-
-                // Energy
-
-                info_file << fNuEnergy << std::endl;
-                info_file << fLepEnergy << std::endl;
-                info_file << fRecoNueEnergy << std::endl;
-                info_file << fRecoNumuEnergy << std::endl;
-                info_file << fEventWeight << std::endl;
-
-                // Topology
-
-                info_file << fNuPDG << std::endl;
-                info_file << fNProton << std::endl;
-                info_file << fNPion << std::endl;
-                info_file << fNPizero << std::endl;         
-                info_file << fNNeutron << std::endl;
-
-                info_file << fTopologyType << std::endl;
-                info_file << fTopologyTypeAlt;        
+                info_file << tree.Info();
 
                 info_file.close(); // close file
 
@@ -312,13 +345,189 @@ void fill(const Config& config, std::string input)
        }
         //else std::cout << "[DEBUG] Unable to open files " << image_file_name << " and " << info_file_name << std::endl;
     }
-    
-    free(ostream);  // free allocated memory
 
   }
 }
 
 
+/// Key of an entry in the shards: the input name without directory and
+/// extension, dots replaced so that the key holds none, and the entry
+std::string entryKey(const std::string& input, unsigned int entry)
+{
+  std::string stem = input.substr(input.find_last_of('/') + 1);
+  stem = stem.substr(0, stem.find_last_of('.'));
+  std::replace(stem.begin(), stem.end(), '.', '_');
+  return stem + "_" + std::to_string(entry);
+}
+
+/// Sharded mode. The entries are cut into contiguous chunks of ChunkSize,
+/// handed out in order to NWorkers threads that each read the tree through
+/// their own chain. Every chunk is written by its own ZlibShardWriter, which
+/// compresses into one reused buffer, to <ShardPrefix>_c<chunk>_<NNNNNN>.tar.
+/// A chunk is added to <OutputDir>/<ShardPrefix>.index once its shards are
+/// closed, and the chunks listed there are skipped when the conversion is run
+/// again, so an interrupted conversion restarts with its unfinished chunks
+void fillSharded(const Config& config, const std::string& input)
+{
+  ROOT::EnableThreadSafety();
+
+  unsigned int entries = 0;
+  {
+    TChain chain(config.fTreeName.c_str());
+    addInput(chain, input);
+    entries = std::min<Long64_t>(chain.GetEntries(), config.fNEvents);
+  }
+  if(entries <= 0){
+    std::cout << "Error: Input tree has no entries." << std::endl;
+    exit(4);
+  }
+
+  const unsigned int chunkSize = config.fChunkSize;
+  const unsigned int nChunks = (entries + chunkSize - 1) / chunkSize;
+  const std::string indexPath = config.fOutputDir + "/" + config.fShardPrefix + ".index";
+
+  // A "codec <name>" line, then one "chunk firstEntry endEntry" line per
+  // finished chunk. Indexes without the codec line were written with zlib
+  std::set<unsigned int> done;
+  bool newIndex = true;
+  {
+    std::ifstream indexIn(indexPath);
+    newIndex = indexIn.peek() == std::ifstream::traits_type::eof();
+    std::string codec = "zlib";
+    if(indexIn.peek() == 'c'){
+      std::string word;
+      indexIn >> word >> codec;
+    }
+    if(!newIndex && codec != config.fCodec.name){
+      std::cout << "Error: " << indexPath << " was written with the " << codec << " codec." << std::endl;
+      exit(1);
+    }
+    unsigned int chunk, first, end;
+    while(indexIn >> chunk >> first >> end){
+      if(first != chunk * chunkSize || end != std::min(first + chunkSize, entries)){
+        std::cout << "Error: " << indexPath << " was written with another ChunkSize or NEvents." << std::endl;
+        exit(1);
+      }
+      done.insert(chunk);
+    }
+  }
+
+  std::cout << "- Will process " << entries << " from the input tree in " << nChunks << " chunks, "
+            << done.size() << " of them already done." << std::endl;
+
+  std::ofstream index(indexPath, std::ofstream::app);
+  if(!index.is_open()){
+    std::cout << "Unable to open file: " << indexPath << std::endl;
+    exit(1);
+  }
+  if(newIndex) index << "codec " << config.fCodec.name << std::endl;
+
+  std::mutex mutex;
+  unsigned int nextChunk = 0;
+  std::exception_ptr error;
+
+  auto work = [&](){
+    try{
+      TChain chain(config.fTreeName.c_str());
+      addInput(chain, input);
+      TreeEntry tree;
+      tree.SetBranches(chain);
+
+      const unsigned int nViews = 3;
+      cvn::CVNImageUtils imageUtils(config.fPlaneLimit,config.fTDCLimit,nViews);
+      imageUtils.SetLogScale(config.fSetLog);
+      imageUtils.SetViewReversal(config.fReverseViews);
+
+      while(true){
+        unsigned int chunk;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          while(nextChunk < nChunks && done.count(nextChunk)) ++nextChunk;
+          if(nextChunk >= nChunks || error) return;
+          chunk = nextChunk++;
+        }
+
+        const unsigned int first = chunk * chunkSize;
+        const unsigned int end = std::min(first + chunkSize, entries);
+        char chunkName[16];
+        snprintf(chunkName, sizeof(chunkName), "_c%06u", chunk);
+        cvn::ZlibShardWriter writer(config.fOutputDir, config.fShardPrefix + chunkName, config.fShardSize,
+                                    64, config.fCodec);
+
+        for(unsigned int entry = first; entry < end; ++entry){
+          chain.GetEntry(entry);
+          imageUtils.SetPixelMapSize(tree.fPMap_fNWire,tree.fPMap_fNTdc);
+
+          std::vector<unsigned char> pixelArray(nViews * config.fPlaneLimit * config.fTDCLimit,0);
+          imageUtils.ConvertChargeVectorsToPixelArray(tree.fPMap_fPEX, tree.fPMap_fPEY, tree.fPMap_fPEZ, pixelArray);
+          writer.Write(entryKey(input, entry), std::move(pixelArray), tree.Info());
+        }
+        writer.Close();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        index << chunk << " " << first << " " << end << std::endl;
+        std::cout << "- Chunk " << chunk+1 << " out of " << nChunks << " done" << std::endl;
+      }
+    }
+    catch(...){
+      std::lock_guard<std::mutex> lock(mutex);
+      if(!error) error = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for(unsigned int iWorker = 0; iWorker < config.fNWorkers; ++iWorker) workers.emplace_back(work);
+  for(std::thread& worker : workers) worker.join();
+
+  if(error){
+    try{
+      std::rethrow_exception(error);
+    }
+    catch(const std::exception& e){
+      std::cout << "Error: " << e.what() << std::endl;
+    }
+    exit(1);
+  }
+}
+
+
+/// Train a zstd dictionary on the first TrainDictionary entries and write it
+/// to <OutputDir>/<ShardPrefix>.zdict, the training scripts need it to read
+/// the images. An existing dictionary is kept, so that a resumed conversion
+/// compresses its remaining chunks the same way. Returns the file name
+std::string trainDictionary(const Config& config, const std::string& input)
+{
+  const std::string path = config.fOutputDir + "/" + config.fShardPrefix + ".zdict";
+  if(std::ifstream(path).good()){
+    std::cout << "- Using the existing zstd dictionary " << path << std::endl;
+    return path;
+  }
+
+  TChain chain(config.fTreeName.c_str());
+  addInput(chain, input);
+  TreeEntry tree;
+  tree.SetBranches(chain);
+
+  const unsigned int nViews = 3;
+  cvn::CVNImageUtils imageUtils(config.fPlaneLimit,config.fTDCLimit,nViews);
+  imageUtils.SetLogScale(config.fSetLog);
+  imageUtils.SetViewReversal(config.fReverseViews);
+
+  const unsigned int entries = std::min<Long64_t>(chain.GetEntries(), config.fTrainDictionary);
+  std::vector< std::vector<unsigned char> > samples(entries);
+  for(unsigned int entry = 0; entry < entries; ++entry){
+    chain.GetEntry(entry);
+    imageUtils.SetPixelMapSize(tree.fPMap_fNWire,tree.fPMap_fNTdc);
+    samples[entry].assign(nViews * config.fPlaneLimit * config.fTDCLimit, 0);
+    imageUtils.ConvertChargeVectorsToPixelArray(tree.fPMap_fPEX, tree.fPMap_fPEY, tree.fPMap_fPEZ, samples[entry]);
+  }
+
+  std::cout << "- Training a zstd dictionary on " << entries << " entries" << std::endl;
+  cvn::ImageCodec::TrainZstdDictionary(samples, config.fDictionarySize, path);
+  return path;
+}
+
+
 po::variables_map getOptions(int argc, char*  argv[], std::string& config,
                                                       std::string& input)
 {
@@ -370,8 +579,24 @@ int main(int argc, char* argv[])
 
   Config config(getPSet(configPath));
 
+  // Check the codec before any image is made
+  try{
+    if(config.fTrainDictionary > 0){
+      if(config.fCodec.name != "zstd"){
+        std::cout << "Error: TrainDictionary needs the zstd codec." << std::endl;
+        exit(1);
+      }
+      config.fCodec.dictionary = trainDictionary(config, inputPath);
+    }
+    cvn::ImageCodec codec(config.fCodec);
+  }
+  catch(const std::exception& e){
+    std::cout << "Error: " << e.what() << std::endl;
+    exit(1);
+  }
 
-  fill(config, inputPath);
+  if(config.fNWorkers > 0) fillSharded(config, inputPath);
+  else fill(config, inputPath);
 
   return 0;
 
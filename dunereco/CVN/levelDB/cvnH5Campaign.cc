@@ -0,0 +1,317 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    cvnH5Campaign.cc
+/// \brief   Stitches the HDF5 files of a GCNH5 campaign into one file
+////////////////////////////////////////////////////////////////////////
+
+// The campaign file holds one virtual dataset per table column, each one
+// the concatenation of that column in every input file, in the order the
+// files are given. The rows are not copied, so reading the campaign file
+// reads the input files, which must stay next to it. Only columns of
+// variable length data, like the process names of the particle table,
+// are copied, since virtual datasets can not map them.
+//
+// Files of the "blocks" layout need two more steps. graph_index/first_node
+// counts the node_table rows of its own file, so it is copied shifted by
+// the node_table rows of the files before it, as a 64 bit column. The
+// encoding_table is the same in every file of a campaign, which is checked,
+// and it is written once.
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <hdf5.h>
+
+// Boost, for program options
+#include "boost/program_options/options_description.hpp"
+#include "boost/program_options/variables_map.hpp"
+#include "boost/program_options/parsers.hpp"
+#include "boost/program_options/positional_options.hpp"
+
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+po::variables_map getOptions(int argc, char* argv[],
+                             std::vector<std::string>& inputs, std::string& output)
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+  ("help", "produce help message")
+  ("output,o", po::value<std::string>(&output)->required(),
+    "campaign file to write")
+  ("input", po::value<std::vector<std::string> >(&inputs)->required(),
+    "files of the GCNH5 jobs, in rank order");
+  po::positional_options_description positional;
+  positional.add("input", -1);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    if (vm.count("help")) {
+      std::cout << "Usage: cvnH5Campaign -o campaign.h5 gcn_*_rank*.h5\n" << desc << "\n";
+      exit(1);
+    }
+    po::notify(vm);
+  }
+  catch(po::error& e)
+  {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    exit(1);
+  }
+
+  return vm;
+}
+
+/// Closes an HDF5 identifier when it goes out of scope
+class H5Handle
+{
+public:
+  H5Handle(hid_t id, herr_t (*close)(hid_t), const std::string& what)
+    : fId(id), fClose(close)
+  {
+    if (fId < 0) throw std::runtime_error("Problem with HDF5 " + what);
+  }
+  ~H5Handle() { fClose(fId); }
+  H5Handle(const H5Handle&) = delete;
+  H5Handle& operator=(const H5Handle&) = delete;
+  operator hid_t() const { return fId; }
+private:
+  hid_t fId;
+  herr_t (*fClose)(hid_t);
+};
+
+/// Extent of one dataset in one input file
+struct Part
+{
+  size_t input;
+  std::vector<hsize_t> dims;
+};
+
+herr_t collectDataset(hid_t, const char* name, const H5O_info_t* info, void* data)
+{
+  if (info->type == H5O_TYPE_DATASET)
+    static_cast<std::vector<std::string>*>(data)->push_back(name);
+  return 0;
+}
+
+/// The rows of a dataset as one string each, to compare tables between files
+std::vector<std::string> readRows(const std::string& fileName, const std::string& name)
+{
+  H5Handle file(H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "opening " + fileName);
+  H5Handle dataset(H5Dopen2(file, name.c_str(), H5P_DEFAULT), H5Dclose, "opening " + name);
+  H5Handle type(H5Dget_type(dataset), H5Tclose, "reading the type of " + name);
+  H5Handle memType(H5Tget_native_type(type, H5T_DIR_ASCEND), H5Tclose, "memory type of " + name);
+  H5Handle space(H5Dget_space(dataset), H5Sclose, "reading the extent of " + name);
+
+  std::vector<hsize_t> dims(H5Sget_simple_extent_ndims(space));
+  H5Sget_simple_extent_dims(space, dims.data(), nullptr);
+  hsize_t nElements = 1;
+  for (hsize_t dim : dims) nElements *= dim;
+  const size_t elementSize = H5Tget_size(memType);
+  std::vector<char> buffer(nElements * elementSize);
+  if (nElements > 0 && H5Dread(dataset, memType, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data()) < 0)
+    throw std::runtime_error("Problem reading " + name + " of " + fileName);
+
+  std::vector<std::string> rows;
+  if (H5Tis_variable_str(memType) > 0)
+  {
+    for (hsize_t i = 0; i < nElements; ++i)
+    {
+      const char* value;
+      std::memcpy(&value, buffer.data() + i * elementSize, sizeof(value));
+      rows.emplace_back(value ? value : "");
+    }
+    if (nElements > 0) H5Dvlen_reclaim(memType, space, H5P_DEFAULT, buffer.data());
+  }
+  else if (!dims.empty() && dims[0] > 0)
+  {
+    const size_t rowSize = buffer.size() / dims[0];
+    for (hsize_t i = 0; i < dims[0]; ++i) rows.emplace_back(buffer.data() + i * rowSize, rowSize);
+  }
+  return rows;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> inputs;
+  std::string output;
+  getOptions(argc, argv, inputs, output);
+
+  try
+  {
+    // The tables are opened with their first row, so a dataset may be
+    // missing from some of the files
+    std::map<std::string, std::vector<Part> > datasets;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+      H5Handle file(H5Fopen(inputs[i].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "opening " + inputs[i]);
+      std::vector<std::string> names;
+      H5Ovisit(file, H5_INDEX_NAME, H5_ITER_NATIVE, collectDataset, &names);
+      for (const std::string& name : names)
+      {
+        H5Handle dataset(H5Dopen2(file, name.c_str(), H5P_DEFAULT), H5Dclose, "opening " + name);
+        H5Handle space(H5Dget_space(dataset), H5Sclose, "reading the extent of " + name);
+        Part part{i, std::vector<hsize_t>(H5Sget_simple_extent_ndims(space))};
+        H5Sget_simple_extent_dims(space, part.dims.data(), nullptr);
+        datasets[name].push_back(part);
+      }
+    }
+
+    // Rows of node_table in the files before each one, the shift of first_node
+    std::vector<long long> nodeOffset(inputs.size(), 0);
+    const auto nodes = datasets.find("node_table/position");
+    if (nodes != datasets.end())
+    {
+      std::vector<long long> nodeRows(inputs.size(), 0);
+      for (const Part& part : nodes->second) nodeRows[part.input] = part.dims[0];
+      for (size_t i = 1; i < inputs.size(); ++i) nodeOffset[i] = nodeOffset[i - 1] + nodeRows[i - 1];
+    }
+
+    // The encoding table is kept from the first file that has one
+    for (auto& entry : datasets)
+    {
+      if (entry.first.compare(0, 15, "encoding_table/") != 0) continue;
+      std::vector<Part>& parts = entry.second;
+      const std::vector<std::string> rows = readRows(inputs[parts.front().input], entry.first);
+      for (size_t p = 1; p < parts.size(); ++p)
+      {
+        if (readRows(inputs[parts[p].input], entry.first) != rows)
+          throw std::runtime_error(entry.first + " of " + inputs[parts[p].input] + " differs from " +
+                                   inputs[parts.front().input] + ", the files were written with different encodings");
+      }
+      parts.resize(1);
+    }
+
+    // The virtual datasets find their sources relative to the campaign file
+    const fs::path outputDir = fs::absolute(output).parent_path();
+
+    H5Handle outFile(H5Fcreate(output.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT), H5Fclose, "creating " + output);
+    H5Handle linkProps(H5Pcreate(H5P_LINK_CREATE), H5Pclose, "link properties");
+    H5Pset_create_intermediate_group(linkProps, 1);
+
+    for (const auto& entry : datasets)
+    {
+      const std::string& name = entry.first;
+      const std::vector<Part>& parts = entry.second;
+
+      H5Handle first(H5Fopen(inputs[parts.front().input].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "opening " + inputs[parts.front().input]);
+      H5Handle firstDataset(H5Dopen2(first, name.c_str(), H5P_DEFAULT), H5Dclose, "opening " + name);
+      H5Handle type(H5Dget_type(firstDataset), H5Tclose, "reading the type of " + name);
+
+      // Rows are the first dimension, the others must agree
+      std::vector<hsize_t> dims = parts.front().dims;
+      dims[0] = 0;
+      for (const Part& part : parts)
+      {
+        if (part.dims.size() != dims.size() || !std::equal(dims.begin() + 1, dims.end(), part.dims.begin() + 1))
+          throw std::runtime_error("The rows of " + name + " in " + inputs[part.input] + " have a different shape");
+        dims[0] += part.dims[0];
+      }
+
+      // The copied columns are chunked, so they may be empty
+      const bool variableLength = H5Tdetect_class(type, H5T_VLEN) > 0 || H5Tis_variable_str(type) > 0;
+      const bool shifted = name == "graph_index/first_node";
+      std::vector<hsize_t> maxDims = dims;
+      if (variableLength || shifted) maxDims[0] = H5S_UNLIMITED;
+      H5Handle space(H5Screate_simple(dims.size(), dims.data(), maxDims.data()), H5Sclose, "extent of " + name);
+
+      H5Handle createProps(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "creation properties of " + name);
+      if (variableLength || shifted)
+      {
+        std::vector<hsize_t> chunk = dims;
+        chunk[0] = std::clamp<hsize_t>(dims[0], 1, 1024);
+        H5Pset_chunk(createProps, chunk.size(), chunk.data());
+      }
+      else
+      {
+        hsize_t offset = 0;
+        for (const Part& part : parts)
+        {
+          if (part.dims[0] == 0) continue;
+          std::vector<hsize_t> start(dims.size(), 0);
+          start[0] = offset;
+          H5Sselect_hyperslab(space, H5S_SELECT_SET, start.data(), nullptr, part.dims.data(), nullptr);
+          H5Handle sourceSpace(H5Screate_simple(part.dims.size(), part.dims.data(), nullptr), H5Sclose, "source extent of " + name);
+          const std::string source = fs::absolute(inputs[part.input]).lexically_relative(outputDir).string();
+          if (H5Pset_virtual(createProps, space, source.c_str(), name.c_str(), sourceSpace) < 0)
+            throw std::runtime_error("Problem mapping " + name + " of " + inputs[part.input]);
+          offset += part.dims[0];
+        }
+        H5Sselect_all(space);
+      }
+
+      H5Handle dataset(H5Dcreate2(outFile, name.c_str(), shifted ? H5T_STD_I64LE : hid_t(type), space, linkProps, createProps, H5P_DEFAULT),
+                       H5Dclose, "creating " + name);
+
+      if (shifted)
+      {
+        hsize_t offset = 0;
+        for (const Part& part : parts)
+        {
+          if (part.dims[0] == 0) continue;
+          H5Handle file(H5Fopen(inputs[part.input].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "opening " + inputs[part.input]);
+          H5Handle source(H5Dopen2(file, name.c_str(), H5P_DEFAULT), H5Dclose, "opening " + name);
+          H5Handle memSpace(H5Screate_simple(part.dims.size(), part.dims.data(), nullptr), H5Sclose, "memory extent of " + name);
+
+          hsize_t nElements = 1;
+          for (hsize_t dim : part.dims) nElements *= dim;
+          std::vector<long long> firstNode(nElements);
+          if (H5Dread(source, H5T_NATIVE_LLONG, memSpace, H5S_ALL, H5P_DEFAULT, firstNode.data()) < 0)
+            throw std::runtime_error("Problem reading " + name + " of " + inputs[part.input]);
+          for (long long& node : firstNode) node += nodeOffset[part.input];
+
+          std::vector<hsize_t> start(dims.size(), 0);
+          start[0] = offset;
+          H5Sselect_hyperslab(space, H5S_SELECT_SET, start.data(), nullptr, part.dims.data(), nullptr);
+          if (H5Dwrite(dataset, H5T_NATIVE_LLONG, memSpace, space, H5P_DEFAULT, firstNode.data()) < 0)
+            throw std::runtime_error("Problem writing " + name + " of " + inputs[part.input]);
+          offset += part.dims[0];
+        }
+        continue;
+      }
+      if (!variableLength) continue;
+
+      // Copy the variable length columns one file at a time
+      H5Handle memType(H5Tget_native_type(type, H5T_DIR_ASCEND), H5Tclose, "memory type of " + name);
+      const size_t elementSize = H5Tget_size(memType);
+      hsize_t offset = 0;
+      for (const Part& part : parts)
+      {
+        if (part.dims[0] == 0) continue;
+        H5Handle file(H5Fopen(inputs[part.input].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "opening " + inputs[part.input]);
+        H5Handle source(H5Dopen2(file, name.c_str(), H5P_DEFAULT), H5Dclose, "opening " + name);
+        H5Handle memSpace(H5Screate_simple(part.dims.size(), part.dims.data(), nullptr), H5Sclose, "memory extent of " + name);
+
+        hsize_t nElements = 1;
+        for (hsize_t dim : part.dims) nElements *= dim;
+        std::vector<char> buffer(nElements * elementSize);
+        if (H5Dread(source, memType, memSpace, H5S_ALL, H5P_DEFAULT, buffer.data()) < 0)
+          throw std::runtime_error("Problem reading " + name + " of " + inputs[part.input]);
+
+        std::vector<hsize_t> start(dims.size(), 0);
+        start[0] = offset;
+        H5Sselect_hyperslab(space, H5S_SELECT_SET, start.data(), nullptr, part.dims.data(), nullptr);
+        const herr_t written = H5Dwrite(dataset, memType, memSpace, space, H5P_DEFAULT, buffer.data());
+        H5Dvlen_reclaim(memType, memSpace, H5P_DEFAULT, buffer.data());
+        if (written < 0)
+          throw std::runtime_error("Problem writing " + name + " of " + inputs[part.input]);
+        offset += part.dims[0];
+      }
+    }
+
+    std::cout << "Wrote " << datasets.size() << " datasets of " << inputs.size() << " files to " << output << std::endl;
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include <array>
 #include <iomanip>
 #include <iostream>
 #include <fstream>
@@ -11,13 +12,13 @@
 #include "boost/program_options/parsers.hpp"
 
 
-#include "leveldb/db.h"
+#include "dunereco/CVN/levelDB/DBReader.h"
 
 #define CPU_ONLY
 // Suppress warnings originating in Caffe that we can't do anything about
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-compare"
-//#include "caffe/caffe.hpp"
+#include "caffe/caffe.hpp"
 #pragma GCC diagnostic pop
 
 #include <TH1D.h>
@@ -28,7 +29,8 @@
 using namespace std;
 namespace po = boost::program_options;
 
-po::variables_map getOptions(int argc, char*  argv[], std::string& dir)
+po::variables_map getOptions(int argc, char*  argv[], std::string& dir,
+                             bool& lmdb, unsigned int& nThreads, size_t& cacheMB)
 {
 
 // Declare the supported options.
@@ -37,6 +39,13 @@ po::variables_map getOptions(int argc, char*  argv[], std::string& dir)
   ("help", "produce help message")
   ("dir,d", po::value<std::string>(&dir)->required(),
     "leveldb directory");
+  desc.add_options()
+  ("lmdb", po::bool_switch(&lmdb),
+    "the directory is an LMDB database")
+  ("threads,j", po::value<unsigned int>(&nThreads)->default_value(1),
+    "threads for the statistics pass over all the records, which then are not limited to the first 10000")
+  ("cache-mb", po::value<size_t>(&cacheMB)->default_value(0),
+    "LevelDB block cache in MB, 0 for the default");
   po::variables_map vm;
 
   try
@@ -66,13 +75,22 @@ int main(int argc, char* argv[])
 {
 
   std::string directory;
-  po::variables_map vm = getOptions(argc, argv, directory);
-
-  leveldb::DB* db;
-  leveldb::Options options;
-  leveldb::Status status = leveldb::DB::Open(options, directory, &db);
+  bool lmdb(false);
+  unsigned int nThreads(1);
+  size_t cacheMB(0);
+  po::variables_map vm = getOptions(argc, argv, directory, lmdb, nThreads, cacheMB);
 
-  if (!status.ok()) return 1;
+  std::unique_ptr<cvn::DBReader> db;
+  try
+  {
+    db = std::make_unique<cvn::DBReader>(directory,
+      lmdb ? cvn::DBReader::kLMDB : cvn::DBReader::kLevelDB, cacheMB);
+  }
+  catch(std::exception& e)
+  {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
 
   ofstream outFile("test.txt");
 
@@ -82,104 +100,128 @@ int main(int argc, char* argv[])
   vector<TH2D*> YVec;
   vector<TH2D*> ZVec;
 
-  //caffe::Datum datum;
+  // Pixel and label counts, one set per range of the parallel scan. The
+  // records are parsed straight from the database's own buffers
+  const unsigned int nRanges = std::max(nThreads, 1u);
+  vector<std::array<double, 256> > peCounts(nRanges);
+  vector<std::array<double, 15> > labelCounts(nRanges);
+  for (unsigned int r = 0; r < nRanges; ++r)
+  {
+    peCounts[r].fill(0.);
+    labelCounts[r].fill(0.);
+  }
 
-  int total(0);
-  leveldb::Iterator* itCount = db->NewIterator(leveldb::ReadOptions());
-  for (itCount->SeekToFirst(); itCount->Valid(); itCount->Next())
+  const size_t maxStats = nThreads > 1 ? 0 : 10000;
+  vector<size_t> nStats(nRanges, 0);
+  auto fillStats = [&](unsigned int range, const char*, size_t, const char* value, size_t valueSize)
+  {
+    if (maxStats && nStats[range] >= maxStats) return true;
+    ++nStats[range];
+
+    caffe::Datum datum;
+    datum.ParseFromArray(value, valueSize);
+    const int nPixels = datum.channels()*datum.height()*datum.width();
+    const int label = datum.label();
+    const char* pixels = datum.data().data();
+    for (int iX = 0; iX < nPixels; ++iX)
+    {
+      peCounts[range][(uint8_t)pixels[iX]] += 1.;
+      if (label >= 0 && label < 15) labelCounts[range][label] += 1.;
+    }
+    return true;
+  };
+
+  size_t total(0);
+  try
   {
-    total++;
+    total = nThreads > 1 ? db->ParallelScan(nThreads, fillStats) : db->Scan(fillStats);
+  }
+  catch(std::exception& e)
+  {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    return 1;
   }
   std::cout << "total: " << total << std::endl;
 
+  for (unsigned int r = 0; r < nRanges; ++r)
+  {
+    for (int b = 0; b < 256; ++b) hPE->AddBinContent(b + 1, peCounts[r][b]);
+    for (int b = 0; b < 15; ++b) hLabels->AddBinContent(b + 1, labelCounts[r][b]);
+  }
+  hPE->SetEntries(hPE->Integral());
+  hLabels->SetEntries(hLabels->Integral());
+
   int count(0);
-  leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
-  for (it->SeekToFirst(); it->Valid(); it->Next())
+  db->Scan([&](unsigned int, const char* key, size_t keySize, const char* value, size_t valueSize)
   {
-    if (count < 10000)
+    if (count >= 100) return false;
+
+    caffe::Datum datum;
+    datum.ParseFromArray(value, valueSize);
+    int channels = datum.channels();
+    int height   = datum.height();
+    int width    = datum.width();
+    int label    = datum.label();
+
+    const char* pixels = datum.data().data();
+    outFile << "key " << std::string(key, keySize) << endl;
+    outFile << "count " << count << endl;
+    outFile << "label " << label << endl;
+
+    TString hName = "PixelMap_";
+    hName += count;
+    hName += "_type";
+    hName += label;
+
+    TH2D* xMap = new TH2D(hName + TString("_X"), ";Wire;TDC",
+     height, 0, height, width, 0, width);
+    XVec.push_back(xMap);
+    TH2D* yMap = new TH2D(hName + TString("_Y"), ";Wire;TDC",
+     height, 0, height, width, 0, width);
+    YVec.push_back(yMap);
+    TH2D* zMap = new TH2D(hName + TString("_Z"), ";Wire;TDC",
+     height, 0, height, width, 0, width);
+    ZVec.push_back(zMap);
+
+    for (int iPix = 0; iPix < channels*height*width; ++iPix)
     {
-      datum.ParseFromString( it->value().ToString() );
-      int channels = datum.channels();
-      int height   = datum.height();
-      int width    = datum.width();
-      int label    = datum.label();
+      int iCell = iPix%width;
+      int iPlane = (iPix/width)%height;
+      int iChan =  (iPix/width)/height;
+      int pixVal = (uint8_t)pixels[iPix];
+      if (iChan == 0)
+        {
+          xMap->SetBinContent(iPlane+1, iCell+1, pixVal);
+        }
+      if (iChan == 1)
+        {
+          yMap->SetBinContent(iPlane+1, iCell+1, pixVal);
+        }
+      if ( iChan == 2 )
+        {
+          zMap->SetBinContent(iPlane+1, iCell+1, pixVal);
+        }
       
-      //std::cout<<"channels:"<<channels<<std::endl;
-      //std::cout<<"height:"<<height<<std::endl;
-      //std::cout<<"width:"<<width<<std::endl;
-      //std::cout<<"label:"<<label<<std::endl;
-
-      const char* pixels = datum.data().data();
-      for (int iX = 0; iX < channels*height*width; ++iX)
-      {
-        hPE->Fill( (uint8_t)pixels[iX] );
-        hLabels->Fill(label);
-      }
-      if (count < 100)
-      {
-        outFile << "key " << it->key().ToString() << endl;
-        outFile << "count " << count << endl;
-        outFile << "label " << label << endl;
-
-        TString hName = "PixelMap_";
-        hName += count;
-        hName += "_type";
-        hName += label;
-
-        TH2D* xMap = new TH2D(hName + TString("_X"), ";Wire;TDC",
-         height, 0, height, width, 0, width);
-        XVec.push_back(xMap);
-        TH2D* yMap = new TH2D(hName + TString("_Y"), ";Wire;TDC",
-         height, 0, height, width, 0, width);
-        YVec.push_back(yMap);
-        TH2D* zMap = new TH2D(hName + TString("_Z"), ";Wire;TDC",
-         height, 0, height, width, 0, width);
-        ZVec.push_back(zMap);
-
-        for (int iPix = 0; iPix < channels*height*width; ++iPix)
+      if (pixVal > 0)
         {
-          int iCell = iPix%width;
-          int iPlane = (iPix/width)%height;
-          int iChan =  (iPix/width)/height;
-          int pixVal = (uint8_t)pixels[iPix];
           if (iChan == 0)
             {
-              xMap->SetBinContent(iPlane+1, iCell+1, pixVal);
+          outFile << "X " << iCell << "  " << iPlane << endl;
             }
-          if (iChan == 1)
+          else if (iChan == 1)
             {
-              yMap->SetBinContent(iPlane+1, iCell+1, pixVal);
+              outFile << "Y " << iCell << "  " << iPlane << endl;
             }
-          if ( iChan == 2 )
+          else
             {
-              zMap->SetBinContent(iPlane+1, iCell+1, pixVal);
-            }
-          
-          if (pixVal > 0)
-            {
-              if (iChan == 0)
-                {
-              outFile << "X " << iCell << "  " << iPlane << endl;
-                }
-              else if (iChan == 1)
-                {
-                  outFile << "Y " << iCell << "  " << iPlane << endl;
-                }
-              else
-                {
-                  outFile << "Z " << iCell << "  " << iPlane << endl;
-                }
-            outFile << "[" << pixVal << "]" << endl;
+              outFile << "Z " << iCell << "  " << iPlane << endl;
             }
+        outFile << "[" << pixVal << "]" << endl;
         }
-      }
     }
-    else
-      {
-        break;
-      }
     ++count;
-  }
+    return true;
+  });
 
   TFile* fOut = new TFile("test.root", "recreate");
   fOut->WriteTObject(hPE);
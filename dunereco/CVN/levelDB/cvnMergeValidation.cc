@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    cvnMergeValidation.cc
+/// \brief   Adds up the summaries written by CVNValidation jobs
+/// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
+////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Boost, for program options
+#include "boost/program_options/options_description.hpp"
+#include "boost/program_options/variables_map.hpp"
+#include "boost/program_options/parsers.hpp"
+#include "boost/program_options/positional_options.hpp"
+
+#include "dunereco/CVN/func/ValidationAccumulator.h"
+
+namespace po = boost::program_options;
+
+po::variables_map getOptions(int argc, char* argv[],
+                             std::vector<std::string>& inputs, std::string& output)
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+  ("help", "produce help message")
+  ("output,o", po::value<std::string>(&output),
+    "file for the merged summary, none to only print it")
+  ("input", po::value<std::vector<std::string> >(&inputs)->required(),
+    "summary files of the CVNValidation jobs");
+  po::positional_options_description positional;
+  positional.add("input", -1);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    if (vm.count("help")) {
+      std::cout << "Usage: cvnMergeValidation [-o merged.txt] summary.txt ...\n" << desc << "\n";
+      exit(1);
+    }
+    po::notify(vm);
+  }
+  catch(po::error& e)
+  {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    exit(1);
+  }
+
+  return vm;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> inputs;
+  std::string output;
+  getOptions(argc, argv, inputs, output);
+
+  std::unique_ptr<cvn::ValidationAccumulator> merged;
+  try
+  {
+    for(const std::string& input : inputs)
+    {
+      std::ifstream in(input);
+      if(!in)
+      {
+        std::cerr << "ERROR: unable to open " << input << std::endl;
+        return 1;
+      }
+
+      // The first summary fixes the binning the others must share
+      if(!merged)
+        merged = std::make_unique<cvn::ValidationAccumulator>(in);
+      else
+        merged->Add(cvn::ValidationAccumulator(in));
+    }
+
+    merged->Print(std::cout);
+    if(!output.empty()) merged->Write(output);
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
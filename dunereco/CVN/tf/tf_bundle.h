@@ -1,8 +1,10 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //// Class:       Bundle
 //// Authors:     A. Higuera, 			from DUNE, Rice U, Feb, 2024
-//// 
+////
 //// Iterface to run Tensorflow saved model bundle to a file.
+//// The SavedModel is loaded once per job through tf::SessionRegistry and the
+//// session is kept resident, shared by every Bundle using the same folder.
 ////
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -12,6 +14,8 @@
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/platform/env.h"
 
+#include "dunereco/TFRuntime/TFSessionRegistry.h"
+
 #include <memory>
 #include <vector>
 #include <string>
@@ -20,24 +24,33 @@ class Bundle{
 
 
 public:
-    static std::unique_ptr<Bundle> create(const char* bundle_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1){
+    static std::unique_ptr<Bundle> create(const char* bundle_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1,
+                                          const tf::ThreadConfig & threads = tf::ThreadConfig(),
+                                          const tf::DeviceConfig & device = tf::DeviceConfig()){
         bool success;
-        std::unique_ptr<Bundle> ptr(new Bundle(bundle_file_name, outputs, success, ninputs, noutputs));
+        std::unique_ptr<Bundle> ptr(new Bundle(bundle_file_name, outputs, success, ninputs, noutputs, threads, device));
         if (success){
              return ptr;
         }
         else {
-             return nullptr;   
+             return nullptr;
         }
     }
 
+    /// Run the resident session on a 4D (samples, rows, cols, depth) input
+    std::vector<std::vector<std::vector<float> > > run(const std::vector<std::vector<std::vector<std::vector<float> > > > & x);
+    /// Run the resident session on a prepared (samples, rows, cols, depth) tensor
+    std::vector<std::vector<std::vector<float> > > run(const tensorflow::Tensor & x);
 
-    std::vector<std::vector<std::vector<float> > > run(const char* bundle_file_name, std::vector<std::vector<std::vector<std::vector<float> > > >  x);
-    tensorflow::Tensor to_tensor(std::vector<std::vector<std::vector<std::vector<float> > > > x); 
+    tensorflow::Tensor to_tensor(const std::vector<std::vector<std::vector<std::vector<float> > > > & x);
     ~Bundle();
 private:
 
-    Bundle(const char* bundle_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs);
+    Bundle(const char* bundle_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+           const tf::ThreadConfig & threads, const tf::DeviceConfig & device);
 
+    std::shared_ptr<tf::SharedSession> fSession;
+    std::vector< std::string > fInputNames;
+    std::vector< std::string > fOutputNames;
 };
-#endif  
+#endif
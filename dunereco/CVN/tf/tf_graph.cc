@@ -10,46 +10,32 @@
 #include "tf_graph.h"
 
 #include "tensorflow/core/public/session.h"
-#include "tensorflow/core/platform/env.h"
 
-#include "tensorflow/core/public/session_options.h"
+#include "dunereco/TFRuntime/TFSessionRegistry.h"
+#include "dunereco/TFRuntime/TFTensorCache.h"
 
 // -------------------------------------------------------------------
-tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs)
+tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+                 const ThreadConfig & threads, const DeviceConfig & device)
 {
     success = false; // until all is done correctly
 
     n_inputs = ninputs;
     n_outputs = noutputs;
 
-    // Force tf to only use a single core so it doesn't eat batch farms
-    tensorflow::SessionOptions options;
-    tensorflow::ConfigProto &config = options.config;
-    config.set_inter_op_parallelism_threads(1);
-    config.set_intra_op_parallelism_threads(1);
-    config.set_use_per_session_threads(false);
+    fInputs = std::make_unique<TensorCache>();
 
-    auto status = tensorflow::NewSession(options, &fSession);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    // By default tf only uses a single core so it doesn't eat batch farms
+    fSession = SessionRegistry::Instance().GetGraph(graph_file_name, threads, device);
+    if (!fSession) { return; }
 
-    tensorflow::GraphDef graph_def;
-    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
-    size_t ng = graph_def.node().size();
+    const std::vector<std::string> & nodes = fSession->NodeNames();
+    size_t ng = nodes.size();
 
     // fill input names (TODO: generic)
     for(int i=0; i<n_inputs; ++i)
     {
-        fInputNames.push_back(graph_def.node()[i].name());
+        fInputNames.push_back(nodes[i]);
     }
 
     /*
@@ -63,7 +49,7 @@ tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & o
     {
         for(int i=n_outputs; i>0; --i)
         {
-            fOutputNames.push_back(graph_def.node()[ng - i].name()); 
+            fOutputNames.push_back(nodes[ng - i]);
         }
 
         /*
@@ -77,7 +63,7 @@ tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & o
         std::string last, current, basename, name;
         for (size_t n = 0; n < ng; ++n)
         {
-            name = graph_def.node()[n].name();
+            name = nodes[n];
             auto pos = name.find("/");
             if (pos != std::string::npos) { basename = name.substr(0, pos); }
             else { continue; }
@@ -105,23 +91,11 @@ tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & o
         return;
     }
 
-    status = fSession->Create(graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
     success = true; // ok, graph loaded from the file
 }
 
 tf::Graph::~Graph()
 {
-    if ( ! fSession->Close().ok() ) {
-      std::cout << "tf::Graph::dtor: " << "Close failed." << std::endl;
-    }
-    //fSession->Close();
-    delete fSession;
 }
 
 // -------------------------------------------------------------------
@@ -145,7 +119,7 @@ std::vector< std::vector< std::vector<float> > > tf::Graph::run(
     // Single-input network
     if (n_inputs == 1)
     {
-        _x.push_back(tensorflow::Tensor(tensorflow::DT_FLOAT, tensorflow::TensorShape({ samples, rows, cols, depth })));
+        _x.push_back(fInputs->Get(0, tensorflow::TensorShape({ samples, rows, cols, depth })));
         auto input_map = _x[0].tensor<float, 4>();
         for (long long int s = 0; s < samples; ++s) {
             const auto & sample = x[s];
@@ -164,7 +138,7 @@ std::vector< std::vector< std::vector<float> > > tf::Graph::run(
     else
     {
         for(int i=0; i<depth; ++i){
-            _x.push_back(tensorflow::Tensor(tensorflow::DT_FLOAT, tensorflow::TensorShape({ samples, rows, cols, 1 })));
+            _x.push_back(fInputs->Get(i, tensorflow::TensorShape({ samples, rows, cols, 1 })));
         }
 
         //tensorflow::Tensor _x(tensorflow::DT_FLOAT, tensorflow::TensorShape({ samples, rows, cols, depth }));
@@ -191,6 +165,24 @@ std::vector< std::vector< std::vector<float> > > tf::Graph::run(
 // -------------------------------------------------------------------
 
 std::vector< std::vector< std::vector< float > > > tf::Graph::run(const std::vector< tensorflow::Tensor > & x)
+{
+    return run(x, fOutputNames);
+}
+
+// -------------------------------------------------------------------
+
+std::vector< std::vector< std::vector< float > > > tf::Graph::run(const std::vector< tensorflow::Tensor > & x,
+                                                                  const std::vector< size_t > & outputs)
+{
+    std::vector< std::string > names;
+    for (size_t o : outputs) { names.push_back(fOutputNames.at(o)); }
+    return run(x, names);
+}
+
+// -------------------------------------------------------------------
+
+std::vector< std::vector< std::vector< float > > > tf::Graph::run(const std::vector< tensorflow::Tensor > & x,
+                                                                  const std::vector< std::string > & output_names)
 {
     std::vector< std::pair<std::string, tensorflow::Tensor> > inputs;
     for(int i=0; i<n_inputs; ++i){
@@ -207,7 +199,7 @@ std::vector< std::vector< std::vector< float > > > tf::Graph::run(const std::vec
     //std::cout << "run session" << std::endl;
 
     std::vector<tensorflow::Tensor> outputs;
-    auto status = fSession->Run(inputs, fOutputNames, {}, &outputs);
+    auto status = fSession->Run(inputs, output_names, &outputs);
 
     //std::cout << "out size " << outputs.size() << std::endl;
 
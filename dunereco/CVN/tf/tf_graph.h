@@ -14,25 +14,31 @@
 #include <vector>
 #include <string>
 
+#include "dunereco/TFRuntime/TFDeviceConfig.h"
+#include "dunereco/TFRuntime/TFThreadConfig.h"
+
 namespace tensorflow
 {
-    class Session;
     class Tensor;
 }
 
 namespace tf
 {
 
+class SharedSession;
+class TensorCache;
+
 class Graph
 {
 public:
    int n_inputs = 1;
    int n_outputs = 1;
 
-   static std::unique_ptr<Graph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1)
+   static std::unique_ptr<Graph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1,
+                                        const ThreadConfig & threads = ThreadConfig(), const DeviceConfig & device = DeviceConfig())
     {
         bool success;
-        std::unique_ptr<Graph> ptr(new Graph(graph_file_name, outputs, success, ninputs, noutputs));
+        std::unique_ptr<Graph> ptr(new Graph(graph_file_name, outputs, success, ninputs, noutputs, threads, device));
         if (success) { return ptr; }
         else { return nullptr; }
     }
@@ -48,11 +54,21 @@ public:
 	long long int samples = -1);
     std::vector< std::vector < std::vector< float > > > run(const std::vector< tensorflow::Tensor > & x);
 
+    // process input tensors, fetching only the outputs with the given indices, in that order;
+    // tf then only evaluates the part of the graph these outputs depend on
+    std::vector< std::vector < std::vector< float > > > run(const std::vector< tensorflow::Tensor > & x,
+                                                            const std::vector< size_t > & outputs);
+
 private:
+    std::vector< std::vector < std::vector< float > > > run(const std::vector< tensorflow::Tensor > & x,
+                                                            const std::vector< std::string > & output_names);
+
     /// Not-throwing constructor.
-    Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs);
+    Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+          const ThreadConfig & threads, const DeviceConfig & device);
 
-    tensorflow::Session* fSession;
+    std::shared_ptr<SharedSession> fSession; ///< Shared with other users of the same graph file
+    std::unique_ptr<TensorCache> fInputs;   ///< Input tensors reused between calls
     //std::vector< std::string > fInputNames;
     std::vector< std::string > fInputNames;
     std::vector< std::string > fOutputNames;
@@ -0,0 +1,325 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      Config
+////
+//// DBSCAN of 2D and 3D points on the CPU or a GPU
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/DBSCAN/DBSCAN.h"
+
+#ifdef DUNERECO_WITH_CUDA
+#include "dunereco/DBSCAN/DBSCANCUDA.h"
+#endif
+
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "tbb/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <unordered_map>
+
+namespace
+{
+
+/// Cell of a coordinate, the same on the host and the device
+int64_t CellIndex(const double pos, const double size)
+{
+    return int64_t(std::floor(pos / size));
+}
+
+/// Key of a cell, cells far apart may share one
+uint64_t CellKey(const unsigned int dim, const int64_t ix, const int64_t iy, const int64_t iz)
+{
+    if (dim == 2)
+        return (uint64_t(ix) << 32) ^ (uint64_t(iy) & 0xffffffff);
+    return ((uint64_t(ix) & 0x1fffff) << 42) | ((uint64_t(iy) & 0x1fffff) << 21) | (uint64_t(iz) & 0x1fffff);
+}
+
+/// Squared distance summed in coordinate order, as on the device
+double Distance2(const double * a, const double * b, const unsigned int dim)
+{
+    double d2(0.);
+    for (unsigned int k = 0; k < dim; ++k)
+    {
+        const double d(a[k] - b[k]);
+        d2 += d * d;
+    }
+    return d2;
+}
+
+/// Points bucketed into cells of the size of the search radius, so the
+/// points within reach of one are in the 3^dim cells around it
+class Grid
+{
+public:
+    Grid(const std::vector<double> & coords, const unsigned int dim, const double cell) :
+        m_coords(coords),
+        m_dim(dim),
+        m_cell(cell)
+    {
+        const size_t nPoints(coords.size() / dim);
+        for (size_t i = 0; i < nPoints; ++i)
+            m_cells[this->Key(&coords[i * dim], 0, 0, 0)].push_back(i);
+    }
+
+    /// Call f(j) for every point j in the cells around point i, in increasing j within each cell
+    template <typename F>
+    void ForEachCandidate(const size_t i, F && f) const
+    {
+        const double * p(&m_coords[i * m_dim]);
+        const int range3(m_dim > 2 ? 1 : 0);
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dz = -range3; dz <= range3; ++dz)
+                {
+                    const auto cell(m_cells.find(this->Key(p, dx, dy, dz)));
+                    if (cell == m_cells.end())
+                        continue;
+                    for (const size_t j : cell->second)
+                        f(j);
+                }
+            }
+        }
+    }
+
+private:
+    uint64_t Key(const double * p, const int dx, const int dy, const int dz) const
+    {
+        return CellKey(m_dim, CellIndex(p[0], m_cell) + dx, CellIndex(p[1], m_cell) + dy,
+                       m_dim > 2 ? CellIndex(p[2], m_cell) + dz : 0);
+    }
+
+    const std::vector<double> & m_coords;
+    const unsigned int m_dim;
+    const double m_cell;
+    std::unordered_map<uint64_t, std::vector<size_t> > m_cells;
+};
+
+/// The sequential DBSCAN, expanding each cluster breadth first from its lowest indexed core point
+size_t ClusterCPU(const std::vector<double> & coords, const unsigned int dim, const double eps,
+                  const unsigned int minPts, std::vector<int> & labels)
+{
+    const size_t nPoints(coords.size() / dim);
+    const double eps2(eps * eps);
+    const Grid grid(coords, dim, eps);
+
+    auto query = [&](const size_t i, std::vector<size_t> & neighbors)
+    {
+        neighbors.clear();
+        grid.ForEachCandidate(i, [&](const size_t j)
+        {
+            if (Distance2(&coords[j * dim], &coords[i * dim], dim) < eps2)
+                neighbors.push_back(j);
+        });
+    };
+
+    labels.assign(nPoints, -1);
+    std::vector<bool> visited(nPoints, false);
+    std::vector<int> queuedIn(nPoints, -1);
+    std::vector<size_t> neighbors, queue;
+    int nClusters(0);
+
+    for (size_t seed = 0; seed < nPoints; ++seed)
+    {
+        if (visited[seed])
+            continue;
+        visited[seed] = true;
+
+        query(seed, neighbors);
+        if (neighbors.size() < minPts)
+            continue;
+
+        const int cluster(nClusters++);
+        labels[seed] = cluster;
+        queue.assign(neighbors.begin(), neighbors.end());
+        for (const size_t i : queue)
+            queuedIn[i] = cluster;
+
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            const size_t i(queue[head]);
+            if (labels[i] == -1)
+                labels[i] = cluster;
+            if (visited[i])
+                continue;
+            visited[i] = true;
+
+            query(i, neighbors);
+            if (neighbors.size() < minPts)
+                continue;
+            for (const size_t j : neighbors)
+            {
+                if (queuedIn[j] == cluster)
+                    continue;
+                queuedIn[j] = cluster;
+                queue.push_back(j);
+            }
+        }
+    }
+
+    return nClusters;
+}
+
+void ForwardNeighborBinsCPU(const std::vector<double> & coords, const double maxDist, std::vector<long> & bestInBin,
+                            const bool parallel)
+{
+    const size_t nPoints(coords.size() / 3);
+    const size_t nBins(size_t(maxDist) + 1);
+    const Grid grid(coords, 3, maxDist);
+
+    bestInBin.assign(nPoints * nBins, -1);
+
+    auto findForwardNeighbors = [&](const size_t posO)
+    {
+        long * best(&bestInBin[posO * nBins]);
+        grid.ForEachCandidate(posO, [&](const size_t posI)
+        {
+            if (posI <= posO)
+                return;
+            const double distance(std::sqrt(Distance2(&coords[posO * 3], &coords[posI * 3], 3)));
+            if (distance > maxDist)
+                return;
+            long & bin(best[int(distance)]);
+            bin = std::max(bin, long(posI));
+        });
+    };
+
+    if (parallel)
+    {
+        tbb::parallel_for(size_t(0), nPoints, findForwardNeighbors);
+    }
+    else
+    {
+        for (size_t posO = 0; posO < nPoints; ++posO)
+            findForwardNeighbors(posO);
+    }
+}
+
+bool UseDevice(const dune::dbscan::Config & config, const size_t nPoints)
+{
+    if (config.backend == dune::dbscan::Config::kCPU || nPoints == 0)
+        return false;
+    if (config.backend == dune::dbscan::Config::kAuto && nPoints < config.minDevicePoints)
+        return false;
+    if (dune::dbscan::DeviceAvailable())
+        return true;
+
+    // Called from any thread of the job, warned once
+    static std::atomic<bool> warned(false);
+    if (config.backend == dune::dbscan::Config::kCUDA && !warned.exchange(true))
+    {
+        mf::LogWarning("DBSCAN") << "No CUDA device for DBSCANBackend cuda, running on the CPU";
+    }
+    return false;
+}
+
+} // namespace
+
+namespace dune
+{
+namespace dbscan
+{
+
+Config::Backend ParseBackend(const std::string & name)
+{
+    if (name == "cpu")
+        return Config::kCPU;
+    if (name == "cuda")
+        return Config::kCUDA;
+    if (name == "auto")
+        return Config::kAuto;
+    throw cet::exception("DBSCAN") << "Unknown DBSCANBackend " << name << ", use cpu, cuda or auto";
+}
+
+Config ConfigFromPSet(const fhicl::ParameterSet & pset)
+{
+    Config config;
+    config.backend = ParseBackend(pset.get<std::string>("DBSCANBackend", "cpu"));
+    config.minDevicePoints = pset.get<size_t>("DBSCANMinDevicePoints", config.minDevicePoints);
+    return config;
+}
+
+bool DeviceAvailable()
+{
+#ifdef DUNERECO_WITH_CUDA
+    static const bool available(cuda::Available());
+    return available;
+#else
+    return false;
+#endif
+}
+
+size_t Cluster(const Config & config, const std::vector<double> & coords, const unsigned int dim, const double eps,
+               const unsigned int minPts, std::vector<int> & labels)
+{
+    if (dim != 2 && dim != 3)
+        throw cet::exception("DBSCAN") << "Points of " << dim << " coordinates, only 2 and 3 are supported";
+
+#ifdef DUNERECO_WITH_CUDA
+    const size_t nPoints(coords.size() / dim);
+    if (UseDevice(config, nPoints))
+    {
+        try
+        {
+            std::vector<int> roots;
+            cuda::Roots(coords, dim, eps, minPts, roots);
+
+            // A root is the lowest indexed core of its cluster, so numbering the roots in
+            // index order numbers the clusters as the sequential expansion does
+            std::vector<int> cluster(nPoints, -1);
+            int nClusters(0);
+            for (size_t i = 0; i < nPoints; ++i)
+            {
+                if (roots[i] == int(i))
+                    cluster[i] = nClusters++;
+            }
+            labels.resize(nPoints);
+            for (size_t i = 0; i < nPoints; ++i)
+                labels[i] = roots[i] < 0 ? -1 : cluster[roots[i]];
+            return nClusters;
+        }
+        catch (const std::exception & e)
+        {
+            mf::LogWarning("DBSCAN") << "CUDA DBSCAN failed, running on the CPU: " << e.what();
+        }
+    }
+#else
+    UseDevice(config, coords.size() / dim);
+#endif
+
+    return ClusterCPU(coords, dim, eps, minPts, labels);
+}
+
+void ForwardNeighborBins(const Config & config, const std::vector<double> & coords, const double maxDist,
+                         std::vector<long> & bestInBin, const bool parallel)
+{
+#ifdef DUNERECO_WITH_CUDA
+    if (UseDevice(config, coords.size() / 3))
+    {
+        try
+        {
+            cuda::ForwardNeighborBins(coords, maxDist, bestInBin);
+            return;
+        }
+        catch (const std::exception & e)
+        {
+            mf::LogWarning("DBSCAN") << "CUDA neighbour search failed, running on the CPU: " << e.what();
+        }
+    }
+#else
+    UseDevice(config, coords.size() / 3);
+#endif
+
+    ForwardNeighborBinsCPU(coords, maxDist, bestInBin, parallel);
+}
+
+} // namespace dbscan
+} // namespace dune
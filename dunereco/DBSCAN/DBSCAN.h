@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      Config
+////
+//// DBSCAN of 2D and 3D points on the CPU or, in builds with CUDA, on a GPU.
+//// Both backends give the labels of the sequential algorithm: a cluster is
+//// a connected set of core points (with at least minPts points, themselves
+//// included, closer than eps) plus the other points closer than eps to one
+//// of its cores. A point near the cores of several clusters belongs to the
+//// first of them, and the clusters are numbered in the order of their
+//// lowest indexed core point.
+////
+//// On the device the points are binned in a cell list of cells of size
+//// eps, the neighbours of each point are counted from its adjacent cells,
+//// and the cores are joined by a lock-free union-find whose roots are the
+//// lowest indexed core of each cluster. Distances are summed without fused
+//// multiply-adds, so every neighbour decision is the one of the CPU.
+////
+//// A device backend that is not built, finds no GPU or fails at run time
+//// falls back to the CPU with a warning.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DBSCAN_DBSCAN_H
+#define DBSCAN_DBSCAN_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace fhicl
+{
+    class ParameterSet;
+}
+
+namespace dune
+{
+namespace dbscan
+{
+
+struct Config
+{
+    enum Backend
+    {
+        kCPU,  ///< always the CPU
+        kCUDA, ///< the GPU whenever one is usable
+        kAuto  ///< the GPU for inputs of at least minDevicePoints points
+    };
+
+    Backend backend = kCPU;
+    size_t minDevicePoints = 20000; ///< smaller inputs are not worth the transfers
+};
+
+/// Backend from the DBSCANBackend ("cpu", "cuda" or "auto") and DBSCANMinDevicePoints parameters
+Config ConfigFromPSet(const fhicl::ParameterSet & pset);
+
+/// Parse a backend name, throws a cet::exception for unknown names
+Config::Backend ParseBackend(const std::string & name);
+
+/// Whether the CUDA backend is built and finds a device
+bool DeviceAvailable();
+
+/// DBSCAN of the points of dim (2 or 3) coordinates each, stored one point after the other.
+/// Fills the cluster of every point, -1 for noise, and returns the number of clusters
+size_t Cluster(const Config & config, const std::vector<double> & coords, unsigned int dim, double eps,
+               unsigned int minPts, std::vector<int> & labels);
+
+/// The neighbourhood search of DBScanAlg_DUNE35t. For every 3D point p and every bin b of
+/// floor(distance) up to maxDist, the highest index of the later points within maxDist of p
+/// whose distance falls in that bin, -1 for none, in bestInBin[p * (size_t(maxDist) + 1) + b].
+/// parallel spreads the CPU search over TBB threads
+void ForwardNeighborBins(const Config & config, const std::vector<double> & coords, double maxDist,
+                         std::vector<long> & bestInBin, bool parallel = false);
+
+} // namespace dbscan
+} // namespace dune
+
+#endif
@@ -0,0 +1,322 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Device side of the dunereco DBSCAN: a cell list sorted by cell key,
+//// neighbour counting over the adjacent cells and a lock-free union-find
+//// of the core points. The arithmetic uses the _rn intrinsics so nothing
+//// is fused, every distance is rounded as on the host.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/DBSCAN/DBSCANCUDA.h"
+
+#include <cuda_runtime.h>
+
+#include <thrust/device_vector.h>
+#include <thrust/sort.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+const unsigned int kBlockSize(256);
+
+void Check(const cudaError_t status, const char * what)
+{
+    if (status != cudaSuccess)
+        throw std::runtime_error(std::string(what) + ": " + cudaGetErrorString(status));
+}
+
+unsigned int Blocks(const size_t n)
+{
+    return (n + kBlockSize - 1) / kBlockSize;
+}
+
+__host__ __device__ long long CellIndex(const double pos, const double size)
+{
+    return (long long)floor(pos / size);
+}
+
+__host__ __device__ unsigned long long CellKey(const unsigned int dim, const long long ix, const long long iy, const long long iz)
+{
+    if (dim == 2)
+        return ((unsigned long long)ix << 32) ^ ((unsigned long long)iy & 0xffffffffULL);
+    return (((unsigned long long)ix & 0x1fffffULL) << 42) | (((unsigned long long)iy & 0x1fffffULL) << 21) |
+           ((unsigned long long)iz & 0x1fffffULL);
+}
+
+/// The points and their cell list, the indices of the points sorted by cell key
+struct Grid
+{
+    const double * coords;
+    unsigned int dim;
+    size_t n;
+    double cell;
+    const unsigned long long * keys;
+    const unsigned int * index;
+};
+
+__device__ double Distance2(const double * a, const double * b, const unsigned int dim)
+{
+    double d2(0.);
+    for (unsigned int k = 0; k < dim; ++k)
+    {
+        const double d(__dsub_rn(a[k], b[k]));
+        d2 = __dadd_rn(d2, __dmul_rn(d, d));
+    }
+    return d2;
+}
+
+/// Call f(j) for every point j in the cells around point i
+template <typename F>
+__device__ void ForEachCandidate(const Grid & grid, const size_t i, F f)
+{
+    const double * p(grid.coords + i * grid.dim);
+    const long long cx(CellIndex(p[0], grid.cell)), cy(CellIndex(p[1], grid.cell));
+    const long long cz(grid.dim > 2 ? CellIndex(p[2], grid.cell) : 0);
+    const int range3(grid.dim > 2 ? 1 : 0);
+
+    for (int dx = -1; dx <= 1; ++dx)
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dz = -range3; dz <= range3; ++dz)
+            {
+                const unsigned long long key(CellKey(grid.dim, cx + dx, cy + dy, grid.dim > 2 ? cz + dz : 0));
+
+                // First point of the cell in the sorted keys
+                size_t lo(0), hi(grid.n);
+                while (lo < hi)
+                {
+                    const size_t mid((lo + hi) / 2);
+                    if (grid.keys[mid] < key)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                for (size_t s = lo; s < grid.n && grid.keys[s] == key; ++s)
+                    f(grid.index[s]);
+            }
+        }
+    }
+}
+
+__global__ void KeysKernel(const double * coords, const unsigned int dim, const size_t n, const double cell,
+                           unsigned long long * keys, unsigned int * index)
+{
+    const size_t i(blockIdx.x * size_t(blockDim.x) + threadIdx.x);
+    if (i >= n)
+        return;
+    const double * p(coords + i * dim);
+    keys[i] = CellKey(dim, CellIndex(p[0], cell), CellIndex(p[1], cell), dim > 2 ? CellIndex(p[2], cell) : 0);
+    index[i] = i;
+}
+
+__device__ int Find(int * parent, int x)
+{
+    // Path halving, a lost race only leaves a longer path
+    while (true)
+    {
+        const int p(parent[x]);
+        if (p == x)
+            return x;
+        const int gp(parent[p]);
+        if (p != gp)
+            atomicCAS(&parent[x], p, gp);
+        x = p;
+    }
+}
+
+/// Join two sets, always linking the higher root below the lower one so every root stays the lowest index of its set
+__device__ void Unite(int * parent, int a, int b)
+{
+    while (true)
+    {
+        a = Find(parent, a);
+        b = Find(parent, b);
+        if (a == b)
+            return;
+        if (a > b)
+        {
+            const int t(a);
+            a = b;
+            b = t;
+        }
+        if (atomicCAS(&parent[b], b, a) == b)
+            return;
+    }
+}
+
+__global__ void CoreKernel(const Grid grid, const double eps2, const unsigned int minPts, int * parent)
+{
+    const size_t i(blockIdx.x * size_t(blockDim.x) + threadIdx.x);
+    if (i >= grid.n)
+        return;
+
+    unsigned int count(0);
+    const double * p(grid.coords + i * grid.dim);
+    ForEachCandidate(grid, i, [&](const unsigned int j)
+    {
+        if (Distance2(grid.coords + j * grid.dim, p, grid.dim) < eps2)
+            ++count;
+    });
+    parent[i] = count >= minPts ? int(i) : -1;
+}
+
+__global__ void UnionKernel(const Grid grid, const double eps2, int * parent)
+{
+    const size_t i(blockIdx.x * size_t(blockDim.x) + threadIdx.x);
+    if (i >= grid.n || parent[i] < 0)
+        return;
+
+    const double * p(grid.coords + i * grid.dim);
+    ForEachCandidate(grid, i, [&](const unsigned int j)
+    {
+        if (j < i && parent[j] >= 0 && Distance2(grid.coords + j * grid.dim, p, grid.dim) < eps2)
+            Unite(parent, i, j);
+    });
+}
+
+__global__ void RootKernel(const size_t n, int * parent, int * roots)
+{
+    const size_t i(blockIdx.x * size_t(blockDim.x) + threadIdx.x);
+    if (i >= n)
+        return;
+    roots[i] = parent[i] < 0 ? -1 : Find(parent, i);
+}
+
+/// A border point takes the lowest root of its core neighbours, which is the first cluster to reach it
+__global__ void BorderKernel(const Grid grid, const double eps2, const int * parent, const int * roots, int * labels)
+{
+    const size_t i(blockIdx.x * size_t(blockDim.x) + threadIdx.x);
+    if (i >= grid.n)
+        return;
+    if (parent[i] >= 0)
+    {
+        labels[i] = roots[i];
+        return;
+    }
+
+    int label(-1);
+    const double * p(grid.coords + i * grid.dim);
+    ForEachCandidate(grid, i, [&](const unsigned int j)
+    {
+        if (roots[j] >= 0 && (label < 0 || roots[j] < label) &&
+            Distance2(grid.coords + j * grid.dim, p, grid.dim) < eps2)
+            label = roots[j];
+    });
+    labels[i] = label;
+}
+
+__global__ void ForwardKernel(const Grid grid, const double maxDist, const size_t nBins, long * best)
+{
+    const size_t posO(blockIdx.x * size_t(blockDim.x) + threadIdx.x);
+    if (posO >= grid.n)
+        return;
+
+    long * row(best + posO * nBins);
+    const double * p(grid.coords + posO * 3);
+    ForEachCandidate(grid, posO, [&](const unsigned int posI)
+    {
+        if (posI <= posO)
+            return;
+        const double distance(__dsqrt_rn(Distance2(p, grid.coords + posI * 3, 3)));
+        if (distance > maxDist)
+            return;
+        long & bin(row[int(distance)]);
+        if (long(posI) > bin)
+            bin = posI;
+    });
+}
+
+/// Copy the points to the device and sort them into the cell list
+struct DeviceGrid
+{
+    DeviceGrid(const std::vector<double> & coords, const unsigned int dim, const double cell) :
+        m_coords(coords.begin(), coords.end()),
+        m_keys(coords.size() / dim),
+        m_index(coords.size() / dim)
+    {
+        m_grid.coords = thrust::raw_pointer_cast(m_coords.data());
+        m_grid.dim = dim;
+        m_grid.n = coords.size() / dim;
+        m_grid.cell = cell;
+        m_grid.keys = thrust::raw_pointer_cast(m_keys.data());
+        m_grid.index = thrust::raw_pointer_cast(m_index.data());
+
+        KeysKernel<<<Blocks(m_grid.n), kBlockSize>>>(m_grid.coords, dim, m_grid.n, cell,
+                                                      thrust::raw_pointer_cast(m_keys.data()),
+                                                      thrust::raw_pointer_cast(m_index.data()));
+        Check(cudaGetLastError(), "cell keys");
+        thrust::sort_by_key(m_keys.begin(), m_keys.end(), m_index.begin());
+    }
+
+    thrust::device_vector<double> m_coords;
+    thrust::device_vector<unsigned long long> m_keys;
+    thrust::device_vector<unsigned int> m_index;
+    Grid m_grid;
+};
+
+} // namespace
+
+namespace dune
+{
+namespace dbscan
+{
+namespace cuda
+{
+
+bool Available()
+{
+    int nDevices(0);
+    return cudaGetDeviceCount(&nDevices) == cudaSuccess && nDevices > 0;
+}
+
+void Roots(const std::vector<double> & coords, const unsigned int dim, const double eps, const unsigned int minPts,
+           std::vector<int> & roots)
+{
+    const size_t nPoints(coords.size() / dim);
+    roots.assign(nPoints, -1);
+    if (nPoints == 0)
+        return;
+
+    const DeviceGrid grid(coords, dim, eps);
+    const double eps2(eps * eps);
+    thrust::device_vector<int> parent(nPoints), rootOf(nPoints), labels(nPoints);
+
+    CoreKernel<<<Blocks(nPoints), kBlockSize>>>(grid.m_grid, eps2, minPts, thrust::raw_pointer_cast(parent.data()));
+    Check(cudaGetLastError(), "core points");
+    UnionKernel<<<Blocks(nPoints), kBlockSize>>>(grid.m_grid, eps2, thrust::raw_pointer_cast(parent.data()));
+    Check(cudaGetLastError(), "union of the cores");
+    RootKernel<<<Blocks(nPoints), kBlockSize>>>(nPoints, thrust::raw_pointer_cast(parent.data()),
+                                                thrust::raw_pointer_cast(rootOf.data()));
+    Check(cudaGetLastError(), "cluster roots");
+    BorderKernel<<<Blocks(nPoints), kBlockSize>>>(grid.m_grid, eps2, thrust::raw_pointer_cast(parent.data()),
+                                                  thrust::raw_pointer_cast(rootOf.data()),
+                                                  thrust::raw_pointer_cast(labels.data()));
+    Check(cudaGetLastError(), "border points");
+
+    Check(cudaMemcpy(roots.data(), thrust::raw_pointer_cast(labels.data()), nPoints * sizeof(int),
+                     cudaMemcpyDeviceToHost), "copy of the labels");
+}
+
+void ForwardNeighborBins(const std::vector<double> & coords, const double maxDist, std::vector<long> & bestInBin)
+{
+    const size_t nPoints(coords.size() / 3);
+    const size_t nBins(size_t(maxDist) + 1);
+    bestInBin.assign(nPoints * nBins, -1);
+    if (nPoints == 0)
+        return;
+
+    const DeviceGrid grid(coords, 3, maxDist);
+    thrust::device_vector<long> best(bestInBin.begin(), bestInBin.end());
+
+    ForwardKernel<<<Blocks(nPoints), kBlockSize>>>(grid.m_grid, maxDist, nBins, thrust::raw_pointer_cast(best.data()));
+    Check(cudaGetLastError(), "neighbour search");
+
+    Check(cudaMemcpy(bestInBin.data(), thrust::raw_pointer_cast(best.data()), bestInBin.size() * sizeof(long),
+                     cudaMemcpyDeviceToHost), "copy of the neighbours");
+}
+
+} // namespace cuda
+} // namespace dbscan
+} // namespace dune
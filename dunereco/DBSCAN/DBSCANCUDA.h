@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Device side of the dunereco DBSCAN, built with DUNERECO_WITH_CUDA. The
+//// functions throw std::runtime_error on CUDA errors, for the caller to
+//// fall back to the CPU.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DBSCAN_DBSCANCUDA_H
+#define DBSCAN_DBSCANCUDA_H
+
+#include <vector>
+
+namespace dune
+{
+namespace dbscan
+{
+namespace cuda
+{
+
+/// Whether a device can be used
+bool Available();
+
+/// Lowest indexed core point of the cluster of every point, -1 for noise
+void Roots(const std::vector<double> & coords, unsigned int dim, double eps, unsigned int minPts,
+           std::vector<int> & roots);
+
+/// See dune::dbscan::ForwardNeighborBins
+void ForwardNeighborBins(const std::vector<double> & coords, double maxDist, std::vector<long> & bestInBin);
+
+} // namespace cuda
+} // namespace dbscan
+} // namespace dune
+
+#endif
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Compare the throughput of Wire-Cell art jobs on the same raw data.
+
+Each FHiCL file is run with lar on the same input and number of events,
+and the wall time, CPU time and peak memory of the job are reported, e.g.
+the serial protodunehd_nfsp job against the TbbFlow protodunehd_nfsp_mt
+one (see wirecell_dune.fcl):
+
+    wcls_benchmark.py -s np04hd_raw.root -n 20 \\
+        nfsp_serial.fcl nfsp_mt.fcl:--nthreads=8
+
+Options after a colon are given to lar for that job only. One process with
+N threads beats N single threaded processes when its events per second are
+more than N times those of the serial job, at less than N times its memory.
+"""
+
+import argparse
+import os
+import resource
+import subprocess
+import sys
+import time
+
+
+def run_job(fcl, extra, source, nevents, outdir):
+    name = os.path.splitext(os.path.basename(fcl))[0]
+    command = ['lar', '-c', fcl, '-s', source, '-n', str(nevents),
+               '-o', os.path.join(outdir, name + '.root')] + extra
+    log = os.path.join(outdir, name + '.log')
+
+    before = resource.getrusage(resource.RUSAGE_CHILDREN)
+    start = time.monotonic()
+    with open(log, 'w') as f:
+        status = subprocess.call(command, stdout=f, stderr=subprocess.STDOUT)
+    wall = time.monotonic() - start
+    after = resource.getrusage(resource.RUSAGE_CHILDREN)
+
+    if status != 0:
+        sys.exit('%s failed with status %d, see %s' % (' '.join(command), status, log))
+
+    cpu = (after.ru_utime - before.ru_utime) + (after.ru_stime - before.ru_stime)
+    # The peak of all children so far, in kB on Linux
+    return {'job': name, 'wall': wall, 'cpu': cpu, 'rss': after.ru_maxrss / 1024.}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('jobs', nargs='+', metavar='FCL[:LAROPTS]',
+                        help='FHiCL files to compare, with optional extra lar options after a colon')
+    parser.add_argument('-s', '--source', required=True, help='reference raw data file')
+    parser.add_argument('-n', '--nevents', type=int, default=10, help='events per job (default 10)')
+    parser.add_argument('-o', '--outdir', default='wcls_benchmark', help='directory for outputs and logs')
+    args = parser.parse_args()
+
+    os.makedirs(args.outdir, exist_ok=True)
+
+    results = []
+    for job in args.jobs:
+        fcl, _, opts = job.partition(':')
+        results.append(run_job(fcl, opts.split() if opts else [], args.source, args.nevents, args.outdir))
+
+    # Peak memory is only exact for the first job, later ones report the
+    # maximum of all jobs so far unless they used more
+    print('%-30s %10s %10s %10s %12s %10s' % ('job', 'wall [s]', 'cpu [s]', 'cpu/wall', 'events/s', 'rss [MB]'))
+    for r in results:
+        print('%-30s %10.1f %10.1f %10.2f %12.3f %10.0f' % (
+            r['job'], r['wall'], r['cpu'], r['cpu'] / r['wall'], args.nevents / r['wall'], r['rss']))
+
+    base = results[0]
+    for r in results[1:]:
+        print('%s is %.2f times faster than %s' % (r['job'], base['wall'] / r['wall'], base['job']))
+
+
+if __name__ == '__main__':
+    main()
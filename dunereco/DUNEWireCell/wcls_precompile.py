@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Pre-render a top level Wire-Cell configuration for short jobs.
+
+A WCLS job evaluates its main Jsonnet file, and every helper it imports, at
+start up, and then its components decompress the field response and wire
+files they name. This renders the configuration once, with the same external
+variables as the FHiCL "params" (-V) and "structs" (-C) of the job, and writes
+uncompressed copies of the .json.bz2 files it names next to the result:
+
+    wcls_precompile.py pgrapher/experiment/pdhd/wcls-nf-sp.jsonnet \\
+        -V raw_input_label=tpcrawdecoder:daq -V reality=data \\
+        -V epoch=after -V signal_output_form=sparse -V chndb_source=jsonnet \\
+        -o precompiled -n pdhd-wcls-nf-sp
+
+The job then uses the output directory first in WIRECELL_PATH and names the
+rendered file in place of the Jsonnet one, with the same params and structs:
+
+    export WIRECELL_PATH=$PWD/precompiled:$WIRECELL_PATH
+    configs: ["pdhd-wcls-nf-sp.json"]
+
+The rendering is only valid for the external variables it was made with, and
+must be redone when the configuration or the release changes.
+"""
+
+import argparse
+import bz2
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+
+def search_path(extra):
+    paths = list(extra)
+    paths += [p for p in os.environ.get('WIRECELL_PATH', '').split(':') if p]
+    return paths
+
+
+def find_file(name, paths):
+    if os.path.isabs(name):
+        return name if os.path.isfile(name) else None
+    for path in paths:
+        candidate = os.path.join(path, name)
+        if os.path.isfile(candidate):
+            return candidate
+    return None
+
+
+def split_vars(pairs, option):
+    result = {}
+    for pair in pairs:
+        if '=' not in pair:
+            sys.exit('%s expects name=value, got "%s"' % (option, pair))
+        name, value = pair.split('=', 1)
+        result[name] = value
+    return result
+
+
+def render(config, paths, extStr, extCode):
+    """Evaluate the Jsonnet with the Python binding, else with a command line evaluator"""
+    try:
+        import _jsonnet
+    except ImportError:
+        _jsonnet = None
+
+    if _jsonnet is not None:
+        return _jsonnet.evaluate_file(config, jpathdir=paths, ext_vars=extStr, ext_codes=extCode)
+
+    program = shutil.which('wcsonnet') or shutil.which('jsonnet')
+    if program is None:
+        sys.exit('no Jsonnet evaluator found: install the _jsonnet module, wcsonnet or jsonnet')
+
+    command = [program]
+    for path in paths:
+        command += ['-J', path]
+    for name, value in extStr.items():
+        command += ['-V', '%s=%s' % (name, value)]
+    for name, value in extCode.items():
+        command += ['-C', '%s=%s' % (name, value)]
+    command.append(config)
+    return subprocess.run(command, check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+
+def decompress_files(node, paths, outdir, written):
+    """Replace the names of .json.bz2 files by uncompressed copies in outdir"""
+    if isinstance(node, dict):
+        return {key: decompress_files(value, paths, outdir, written) for key, value in node.items()}
+    if isinstance(node, list):
+        return [decompress_files(value, paths, outdir, written) for value in node]
+    if not isinstance(node, str) or not node.endswith('.json.bz2'):
+        return node
+
+    source = find_file(node, paths)
+    if source is None:
+        print('warning: %s is not in WIRECELL_PATH, left compressed' % node)
+        return node
+
+    name = os.path.basename(node)[:-len('.bz2')]
+    if name not in written:
+        with bz2.open(source, 'rb') as fin, open(os.path.join(outdir, name), 'wb') as fout:
+            shutil.copyfileobj(fin, fout)
+        written[name] = source
+    elif written[name] != source:
+        sys.exit('%s and %s would both be written as %s' % (written[name], source, name))
+    return name
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('config', help='main Jsonnet file, relative to WIRECELL_PATH as in the FHiCL "configs"')
+    parser.add_argument('-V', '--ext-str', action='append', default=[], metavar='NAME=VALUE',
+                        help='string external variable, as the FHiCL "params"')
+    parser.add_argument('-C', '--ext-code', action='append', default=[], metavar='NAME=CODE',
+                        help='code external variable, as the FHiCL "structs"')
+    parser.add_argument('-J', '--jpath', action='append', default=[], help='search directory before WIRECELL_PATH')
+    parser.add_argument('-o', '--outdir', default='.', help='output directory (default .)')
+    parser.add_argument('-n', '--name', help='name of the rendered file, without .json (default: the config name)')
+    args = parser.parse_args()
+
+    paths = search_path(args.jpath)
+    config = find_file(args.config, paths)
+    if config is None:
+        sys.exit('%s is not in WIRECELL_PATH' % args.config)
+
+    extStr = split_vars(args.ext_str, '-V')
+    extCode = split_vars(args.ext_code, '-C')
+    rendered = json.loads(render(config, paths, extStr, extCode))
+
+    os.makedirs(args.outdir, exist_ok=True)
+    written = {}
+    rendered = decompress_files(rendered, paths, args.outdir, written)
+
+    name = args.name or os.path.basename(args.config).rsplit('.', 1)[0]
+    output = os.path.join(args.outdir, name + '.json')
+    with open(output, 'w') as f:
+        json.dump(rendered, f, separators=(',', ':'))
+
+    print('wrote %s and %d uncompressed data files' % (output, len(written)))
+
+
+if __name__ == '__main__':
+    main()
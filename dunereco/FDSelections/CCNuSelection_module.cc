@@ -63,6 +63,7 @@
 #include "dunereco/FDSelections/pandizzle/PandizzleAlg.h"
 #include "dunereco/FDSelections/pandrizzle/PandrizzleAlg.h"
 #include "FDSelectionUtils.h"
+#include "FDSelectionEventContext.h"
 #include "tools/RecoTrackSelector.h"
 #include "tools/RecoShowerSelector.h"
 
@@ -94,14 +95,14 @@ public:
 
 private:
   void Reset();
-  void GetEventInfo(art::Event const & evt);
+  void GetEventInfo(EventContext const & context);
   void GetTruthInfo(art::Event const & evt);
-  void FillVertexInfo(art::Event const & evt);
-  void GetRecoTrackInfo(art::Event const & evt);
-  void RunTrackSelection(art::Event const & evt);
-  void FillChildPFPInformation(art::Ptr<recob::PFParticle> const pfp, art::Event const & evt, int &n_child_pfp, int &n_child_track_pfp, int &n_child_shower_pfp);
-  void GetRecoShowerInfo(art::Event const & evt);
-  void RunShowerSelection(art::Event const & evt);
+  void FillVertexInfo(EventContext const & context);
+  void GetRecoTrackInfo(EventContext const & context);
+  void RunTrackSelection(EventContext const & context);
+  void FillChildPFPInformation(art::Ptr<recob::PFParticle> const pfp, EventContext const & context, int &n_child_pfp, int &n_child_track_pfp, int &n_child_shower_pfp);
+  void GetRecoShowerInfo(EventContext const & context);
+  void RunShowerSelection(EventContext const & context);
 
   TVector3 ProjectVectorOntoPlane(TVector3 vector_to_project, TVector3 plane_norm_vector);
   double DistanceToNuVertex(art::Event const & evt, std::vector<art::Ptr<recob::Hit>> const artHitList, const TVector3 &nuVertex);
@@ -578,16 +579,19 @@ void FDSelection::CCNuSelection::analyze(art::Event const & evt)
   fEvent = evt.event();
   fIsMC = !evt.isRealData();
 
-  GetEventInfo(evt);
+  // Fetch the products every stage needs once
+  const EventContext context(evt, fPFParticleModuleLabel, fTrackModuleLabel, fShowerModuleLabel, fHitsModuleLabel, fPIDModuleLabel);
+
+  GetEventInfo(context);
 
   if (fIsMC) 
     GetTruthInfo(evt);
 
-  FillVertexInfo(evt);
-  GetRecoTrackInfo(evt);
-  RunTrackSelection(evt);
-  GetRecoShowerInfo(evt);
-  RunShowerSelection(evt);
+  FillVertexInfo(context);
+  GetRecoTrackInfo(context);
+  RunTrackSelection(context);
+  GetRecoShowerInfo(context);
+  RunShowerSelection(context);
 
   if (fMakeSelectionTrainingTrees)
   {
@@ -1415,10 +1419,11 @@ void FDSelection::CCNuSelection::Reset()
 
 //////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::GetEventInfo(art::Event const & evt)
+void FDSelection::CCNuSelection::GetEventInfo(EventContext const & context)
 {
-  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-  auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
+  const art::Event &evt(context.Event());
+  const detinfo::DetectorClocksData &clockData(context.ClockData());
+  const detinfo::DetectorPropertiesData &detProp(context.DetProp());
 
   // T0
   fT0 = trigger_offset(clockData);
@@ -1426,8 +1431,7 @@ void FDSelection::CCNuSelection::GetEventInfo(art::Event const & evt)
   // Get total event charge
   try
   {
-      std::vector<art::Ptr<recob::Hit>> hitList = dune_ana::DUNEAnaEventUtils::GetHits(evt, fHitsModuleLabel);
-      fRecoEventCharge = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, hitList);
+      fRecoEventCharge = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, context.EventHits());
   }
   catch(...)
   {
@@ -1640,13 +1644,13 @@ void FDSelection::CCNuSelection::GetTruthInfo(art::Event const & evt)
 
 ///////////////////////////////////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::FillVertexInfo(art::Event const & evt)
+void FDSelection::CCNuSelection::FillVertexInfo(EventContext const & context)
 {
-  if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
+  if (!context.HasNeutrino())
     return;
 
-  art::Ptr<recob::PFParticle> nu_pfp = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nu_pfp, evt, fPFParticleModuleLabel);
+  const art::Ptr<recob::PFParticle> &nu_pfp(context.Neutrino());
+  const std::vector<art::Ptr<recob::PFParticle>> &nuChildren(context.NeutrinoChildren());
 
   fRecoNuVtxNChildren = nuChildren.size();
 
@@ -1660,32 +1664,29 @@ void FDSelection::CCNuSelection::FillVertexInfo(art::Event const & evt)
       fRecoNuVtxNTracks++;
   }
 
-  try
-  {
-      art::Ptr<recob::Vertex> nuVertex = dune_ana::DUNEAnaPFParticleUtils::GetVertex(nu_pfp, evt, fPFParticleModuleLabel);
+  const art::Ptr<recob::Vertex> &nuVertex(context.GetVertex(nu_pfp));
 
+  if (nuVertex.isNonnull())
+  {
       fRecoNuVtxX = nuVertex->position().X();
       fRecoNuVtxY = nuVertex->position().Y();
       fRecoNuVtxZ = nuVertex->position().Z();
   }
-  catch(...)
-  {
-      return;
-  }
 
   return;
 }
 
 ////////////////////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
+void FDSelection::CCNuSelection::GetRecoTrackInfo(EventContext const & context)
 {
-  if(!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
+  if(!context.HasNeutrino())
     return;
 
-  art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, fPFParticleModuleLabel); 
-  std::vector<art::Ptr<recob::PFParticle>> pfps = dune_ana::DUNEAnaEventUtils::GetPFParticles(evt, fPFParticleModuleLabel);
+  const art::Event &evt(context.Event());
+  const detinfo::DetectorClocksData &clockData(context.ClockData());
+  const detinfo::DetectorPropertiesData &detProp(context.DetProp());
+  const std::vector<art::Ptr<recob::PFParticle>> &pfps(context.PFParticles());
 
   int trackCounter = 0;
 
@@ -1694,26 +1695,18 @@ void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
     if (trackCounter == kDefMaxNRecoTracks)
       break;
 
-    if (!dune_ana::DUNEAnaPFParticleUtils::IsTrack(pfp, evt, fPFParticleModuleLabel, fTrackModuleLabel))
+    if (!context.IsTrack(pfp))
       continue;
 
-    for (art::Ptr<recob::PFParticle> nuChild : nuChildren)
-    {
-      if (nuChild->Self() == pfp->Self())
-      {
-        fRecoTrackIsPrimary[trackCounter] = true;
-        break;
-      }
-    }
+    if (context.IsNeutrinoChild(pfp))
+      fRecoTrackIsPrimary[trackCounter] = true;
 
     const std::vector<art::Ptr<recob::Hit>> current_track_hits = dune_ana::DUNEAnaPFParticleUtils::GetHits(pfp, evt, fPFParticleModuleLabel);
     fRecoTrackRecoNHits[trackCounter] = current_track_hits.size();
 
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
     fRecoTrackRecoCharge[trackCounter]  = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, current_track_hits); 
 
-    art::Ptr<recob::Track> current_track = dune_ana::DUNEAnaPFParticleUtils::GetTrack(pfp, evt, fPFParticleModuleLabel, fTrackModuleLabel);
+    const art::Ptr<recob::Track> &current_track(context.GetTrack(pfp));
 
     // General track variables
     recob::Track::Point_t trackStart, trackEnd;
@@ -1746,17 +1739,14 @@ void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
 
     fRecoTrackRecoLength[trackCounter] = current_track->Length();
 
-    try
-    {
-      art::Ptr<recob::Vertex> track_reco_vertex = dune_ana::DUNEAnaPFParticleUtils::GetVertex(pfp, evt, fPFParticleModuleLabel);
+    const art::Ptr<recob::Vertex> &track_reco_vertex(context.GetVertex(pfp));
 
+    if (track_reco_vertex.isNonnull())
+    {
       fRecoTrackRecoVertexX[trackCounter] = track_reco_vertex->position().X();
       fRecoTrackRecoVertexY[trackCounter] = track_reco_vertex->position().Y();
       fRecoTrackRecoVertexZ[trackCounter] = track_reco_vertex->position().Z();
     }
-    catch(...)
-    {
-    }
 
     TVector3 upstream_end(fRecoTrackRecoUpstreamX[trackCounter], fRecoTrackRecoUpstreamY[trackCounter], fRecoTrackRecoUpstreamZ[trackCounter]);
     TVector3 downstream_end(fRecoTrackRecoDownstreamX[trackCounter], fRecoTrackRecoDownstreamY[trackCounter], fRecoTrackRecoDownstreamZ[trackCounter]);
@@ -1776,7 +1766,7 @@ void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
     }
 
     // Child particle info
-    FillChildPFPInformation(pfp, evt, fRecoTrackRecoNChildPFP[trackCounter], fRecoTrackRecoNChildTrackPFP[trackCounter], fRecoTrackRecoNChildShowerPFP[trackCounter]);
+    FillChildPFPInformation(pfp, context, fRecoTrackRecoNChildPFP[trackCounter], fRecoTrackRecoNChildTrackPFP[trackCounter], fRecoTrackRecoNChildShowerPFP[trackCounter]);
 
     // Fill momentum variables
     std::unique_ptr<dune::EnergyRecoOutput> energyRecoHandle(std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(current_track, evt)));
@@ -1794,10 +1784,9 @@ void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
       fRecoTrackRecoMomMCS[trackCounter] = sqrt(energyRecoHandle->fLepLorentzVector.Vect().Mag2());
     }
 
-    std::vector<art::Ptr<recob::Hit>> eventHitList = dune_ana::DUNEAnaEventUtils::GetHits(evt, fHitsModuleLabel);
     int g4id = TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData, current_track_hits, 1);
-    fRecoTrackRecoCompleteness[trackCounter] = FDSelectionUtils::CompletenessFromTrueParticleID(clockData, current_track_hits, eventHitList, g4id);
-    fRecoTrackRecoHitPurity[trackCounter] = FDSelectionUtils::HitPurityFromTrueParticleID(clockData, current_track_hits, g4id);
+    fRecoTrackRecoCompleteness[trackCounter] = FDSelectionUtils::CompletenessFromTrueParticleID(context.EventHitTruth(), current_track_hits, g4id);
+    fRecoTrackRecoHitPurity[trackCounter] = FDSelectionUtils::HitPurityFromTrueParticleID(context.EventHitTruth(), current_track_hits, g4id);
 
     if (TruthMatchUtils::Valid(g4id)){
         art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
@@ -1825,8 +1814,7 @@ void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
     }
 
     // MVA PID
-    art::FindOneP<anab::MVAPIDResult> findPIDResult(std::vector<art::Ptr<recob::Track>>{current_track}, evt, fPIDModuleLabel);
-    art::Ptr<anab::MVAPIDResult> pid(findPIDResult.at(0));
+    art::Ptr<anab::MVAPIDResult> pid(context.GetMVAPID(current_track));
 
     if (pid.isAvailable())
     {
@@ -1867,13 +1855,13 @@ void FDSelection::CCNuSelection::GetRecoTrackInfo(art::Event const & evt)
 
 ///////////////////////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::FillChildPFPInformation(art::Ptr<recob::PFParticle> const pfp, art::Event const & evt, int &n_child_pfp, int &n_child_track_pfp, int &n_child_shower_pfp)
+void FDSelection::CCNuSelection::FillChildPFPInformation(art::Ptr<recob::PFParticle> const pfp, EventContext const & context, int &n_child_pfp, int &n_child_track_pfp, int &n_child_shower_pfp)
 {
   n_child_pfp = 0;
   n_child_track_pfp = 0;
   n_child_shower_pfp = 0;
 
-  std::vector<art::Ptr<recob::PFParticle>> childPFPs = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(pfp, evt, fPFParticleModuleLabel);
+  const std::vector<art::Ptr<recob::PFParticle>> &childPFPs(context.GetChildParticles(pfp));
 
   for (art::Ptr<recob::PFParticle> childPFP : childPFPs)
   {
@@ -1892,10 +1880,12 @@ void FDSelection::CCNuSelection::FillChildPFPInformation(art::Ptr<recob::PFParti
 
 ///////////////////////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
+void FDSelection::CCNuSelection::RunTrackSelection(EventContext const & context)
 {
+  const art::Event &evt(context.Event());
+
   // Get the selected track
-  art::Ptr<recob::Track> sel_track = fRecoTrackSelector->FindSelectedTrack(evt);
+  art::Ptr<recob::Track> sel_track = fRecoTrackSelector->FindSelectedTrack(context);
 
   if (!sel_track.isAvailable()) 
   {
@@ -1906,8 +1896,8 @@ void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
   std::vector<art::Ptr<recob::Hit>> sel_track_hits = dune_ana::DUNEAnaTrackUtils::GetHits(sel_track, evt, fTrackModuleLabel);
   fSelTrackRecoNHits = sel_track_hits.size();
 
-  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-  auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
+  const detinfo::DetectorClocksData &clockData(context.ClockData());
+  const detinfo::DetectorPropertiesData &detProp(context.DetProp());
   fSelTrackRecoCharge  = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, sel_track_hits); 
 
   // Get general track variables
@@ -1943,17 +1933,14 @@ void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
 
   art::Ptr<recob::PFParticle> sel_track_pfp = dune_ana::DUNEAnaTrackUtils::GetPFParticle(sel_track, evt, fTrackModuleLabel);
 
-  try
-  {
-      art::Ptr<recob::Vertex> track_reco_vertex = dune_ana::DUNEAnaPFParticleUtils::GetVertex(sel_track_pfp, evt, fPFParticleModuleLabel);
+  const art::Ptr<recob::Vertex> &track_reco_vertex(context.GetVertex(sel_track_pfp));
 
+  if (track_reco_vertex.isNonnull())
+  {
       fSelTrackRecoVertexX = track_reco_vertex->position().X();
       fSelTrackRecoVertexY = track_reco_vertex->position().Y();
       fSelTrackRecoVertexZ = track_reco_vertex->position().Z();
   }
-  catch(...)
-  {
-  }
 
   TVector3 upstream_end(fSelTrackRecoUpstreamX, fSelTrackRecoUpstreamY, fSelTrackRecoUpstreamZ);
   TVector3 downstream_end(fSelTrackRecoDownstreamX, fSelTrackRecoDownstreamY, fSelTrackRecoDownstreamZ);
@@ -1972,7 +1959,7 @@ void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
     fSelTrackRecoEndClosestToVertexZ = fSelTrackRecoDownstreamZ;
   }
 
-  FillChildPFPInformation(sel_track_pfp, evt, fSelTrackRecoNChildPFP, fSelTrackRecoNChildTrackPFP, fSelTrackRecoNChildShowerPFP);
+  FillChildPFPInformation(sel_track_pfp, context, fSelTrackRecoNChildPFP, fSelTrackRecoNChildTrackPFP, fSelTrackRecoNChildShowerPFP);
 
   // Fill neutrino energy variables
   // Use selected track to get neutrino energy
@@ -1998,9 +1985,8 @@ void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
 
   // Get truth information
   int g4id = TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData, sel_track_hits, 1);
-  std::vector<art::Ptr<recob::Hit>> eventHitList = dune_ana::DUNEAnaEventUtils::GetHits(evt, fHitsModuleLabel);
-  fSelTrackRecoCompleteness = FDSelectionUtils::CompletenessFromTrueParticleID(clockData, sel_track_hits, eventHitList, g4id);
-  fSelTrackRecoHitPurity = FDSelectionUtils::HitPurityFromTrueParticleID(clockData, sel_track_hits, g4id);
+  fSelTrackRecoCompleteness = FDSelectionUtils::CompletenessFromTrueParticleID(context.EventHitTruth(), sel_track_hits, g4id);
+  fSelTrackRecoHitPurity = FDSelectionUtils::HitPurityFromTrueParticleID(context.EventHitTruth(), sel_track_hits, g4id);
 
   if (TruthMatchUtils::Valid(g4id))
   {
@@ -2029,8 +2015,7 @@ void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
   }
 
   // MVA PID
-  art::FindOneP<anab::MVAPIDResult> findPIDResult(std::vector<art::Ptr<recob::Track>>{sel_track}, evt, fPIDModuleLabel);
-  art::Ptr<anab::MVAPIDResult> pid(findPIDResult.at(0));
+  art::Ptr<anab::MVAPIDResult> pid(context.GetMVAPID(sel_track));
 
   if (pid.isAvailable())
   {
@@ -2075,14 +2060,15 @@ void FDSelection::CCNuSelection::RunTrackSelection(art::Event const & evt)
 
 ///////////////////////////////////////////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
+void FDSelection::CCNuSelection::GetRecoShowerInfo(EventContext const & context)
 {
-  if(!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
+  if(!context.HasNeutrino())
     return;
 
-  art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, fPFParticleModuleLabel); 
-  std::vector<art::Ptr<recob::PFParticle>> pfps = dune_ana::DUNEAnaEventUtils::GetPFParticles(evt, fPFParticleModuleLabel);
+  const art::Event &evt(context.Event());
+  const detinfo::DetectorClocksData &clockData(context.ClockData());
+  const detinfo::DetectorPropertiesData &detProp(context.DetProp());
+  const std::vector<art::Ptr<recob::PFParticle>> &pfps(context.PFParticles());
 
   int showerCounter = 0;
 
@@ -2091,22 +2077,16 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
     if (showerCounter == kDefMaxNRecoShowers)
       break;
 
-    if (!dune_ana::DUNEAnaPFParticleUtils::IsShower(pfp, evt, fPFParticleModuleLabel, fShowerModuleLabel))
+    if (!context.IsShower(pfp))
       continue;
 
-    for (art::Ptr<recob::PFParticle> nuChild : nuChildren)
-    {
-      if (nuChild->Self() == pfp->Self())
-      {
-        fRecoShowerRecoIsPrimaryPFPDaughter[showerCounter] = true;
-        break;
-      }
-    }
+    if (context.IsNeutrinoChild(pfp))
+      fRecoShowerRecoIsPrimaryPFPDaughter[showerCounter] = true;
 
     const std::vector<art::Ptr<recob::Hit>> current_shower_hits = dune_ana::DUNEAnaPFParticleUtils::GetHits(pfp, evt, fPFParticleModuleLabel);
     fRecoShowerRecoNHits[showerCounter] = current_shower_hits.size();
 
-    art::Ptr<recob::Shower> current_shower = dune_ana::DUNEAnaPFParticleUtils::GetShower(pfp, evt, fPFParticleModuleLabel, fShowerModuleLabel);
+    const art::Ptr<recob::Shower> &current_shower(context.GetShower(pfp));
 
     // General shower variables
     fRecoShowerRecoDirX[showerCounter] = current_shower->Direction().X();
@@ -2120,21 +2100,20 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
     fRecoShowerRecoOpeningAngle[showerCounter] = current_shower->OpenAngle();
 
     // Vertex info
-    try
-    {
-        art::Ptr<recob::Vertex> shower_reco_vertex = dune_ana::DUNEAnaPFParticleUtils::GetVertex(pfp, evt, fPFParticleModuleLabel);
+    const art::Ptr<recob::Vertex> &shower_reco_vertex(context.GetVertex(pfp));
 
+    if (shower_reco_vertex.isNonnull())
+    {
         fRecoShowerRecoVertexX[showerCounter] = shower_reco_vertex->position().X();
         fRecoShowerRecoVertexY[showerCounter] = shower_reco_vertex->position().Y();
         fRecoShowerRecoVertexZ[showerCounter] = shower_reco_vertex->position().Z();
     }
-    catch(...)
-    {
-    }
+
+    const std::vector<std::vector<art::Ptr<recob::Hit>>> hitsByPlane(dune_ana::DUNEAnaHitUtils::GetHitsByPlane(current_shower_hits));
 
     try
     {
-        std::vector<art::Ptr<recob::Hit>> hitListU = dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(current_shower_hits, 0);
+        const std::vector<art::Ptr<recob::Hit>> &hitListU(hitsByPlane.at(0));
         fRecoShowerDistanceToNuVertexU[showerCounter] = DistanceToNuVertex(evt, hitListU, TVector3(fNuX, fNuY, fNuZ));
     }
     catch(...)
@@ -2143,7 +2122,7 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
 
     try
     {
-        std::vector<art::Ptr<recob::Hit>> hitListV = dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(current_shower_hits, 1);
+        const std::vector<art::Ptr<recob::Hit>> &hitListV(hitsByPlane.at(1));
         fRecoShowerDistanceToNuVertexV[showerCounter] = DistanceToNuVertex(evt, hitListV, TVector3(fNuX, fNuY, fNuZ));
     }
     catch(...)
@@ -2152,7 +2131,7 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
 
     try
     {
-        std::vector<art::Ptr<recob::Hit>> hitListW = dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(current_shower_hits, 2);
+        const std::vector<art::Ptr<recob::Hit>> &hitListW(hitsByPlane.at(2));
         fRecoShowerDistanceToNuVertexW[showerCounter] = DistanceToNuVertex(evt, hitListW, TVector3(fNuX, fNuY, fNuZ));
     }
     catch(...)
@@ -2160,8 +2139,6 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
     }
 
     // Momentum and energy
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
     fRecoShowerRecoCharge[showerCounter]  = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, current_shower_hits); 
 
     std::unique_ptr<dune::EnergyRecoOutput> energyRecoHandle(std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(current_shower, evt)));
@@ -2176,12 +2153,11 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
       }
     }
 
-    FillChildPFPInformation(pfp, evt, fRecoShowerRecoNChildPFP[showerCounter], fRecoShowerRecoNChildTrackPFP[showerCounter], fRecoShowerRecoNChildShowerPFP[showerCounter]);
+    FillChildPFPInformation(pfp, context, fRecoShowerRecoNChildPFP[showerCounter], fRecoShowerRecoNChildTrackPFP[showerCounter], fRecoShowerRecoNChildShowerPFP[showerCounter]);
 
     int g4id = TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData, current_shower_hits, 1);
-    std::vector<art::Ptr<recob::Hit>> eventHitList = dune_ana::DUNEAnaEventUtils::GetHits(evt, fHitsModuleLabel);
-    fRecoShowerRecoCompleteness[showerCounter] = FDSelectionUtils::CompletenessFromTrueParticleID(clockData, current_shower_hits, eventHitList, g4id);
-    fRecoShowerRecoHitPurity[showerCounter] = FDSelectionUtils::HitPurityFromTrueParticleID(clockData, current_shower_hits, g4id);
+    fRecoShowerRecoCompleteness[showerCounter] = FDSelectionUtils::CompletenessFromTrueParticleID(context.EventHitTruth(), current_shower_hits, g4id);
+    fRecoShowerRecoHitPurity[showerCounter] = FDSelectionUtils::HitPurityFromTrueParticleID(context.EventHitTruth(), current_shower_hits, g4id);
 
     if (TruthMatchUtils::Valid(g4id))
     {
@@ -2210,8 +2186,7 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
     }
 
     // MVA PID
-    art::FindOneP<anab::MVAPIDResult> findPIDResult(std::vector<art::Ptr<recob::Shower>>{current_shower}, evt, fPIDModuleLabel);
-    art::Ptr<anab::MVAPIDResult> pid(findPIDResult.at(0));
+    art::Ptr<anab::MVAPIDResult> pid(context.GetMVAPID(current_shower));
 
     if (pid.isAvailable())
     {
@@ -2271,10 +2246,12 @@ void FDSelection::CCNuSelection::GetRecoShowerInfo(art::Event const & evt)
 
 ///////////////////////////////////////////////////////////////////////////////////
 
-void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
+void FDSelection::CCNuSelection::RunShowerSelection(EventContext const & context)
 {
+  const art::Event &evt(context.Event());
+
   // Get the selected shower
-  art::Ptr<recob::Shower> sel_shower = fRecoShowerSelector->FindSelectedShower(evt);
+  art::Ptr<recob::Shower> sel_shower = fRecoShowerSelector->FindSelectedShower(context);
 
   if (!sel_shower.isAvailable()) 
   {
@@ -2299,21 +2276,20 @@ void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
   fSelShowerRecoOpeningAngle = sel_shower->OpenAngle();
 
   // Vertex info
-  try
-  {
-    art::Ptr<recob::Vertex> shower_reco_vertex = dune_ana::DUNEAnaPFParticleUtils::GetVertex(sel_pfp, evt, fPFParticleModuleLabel);
+  const art::Ptr<recob::Vertex> &shower_reco_vertex(context.GetVertex(sel_pfp));
 
+  if (shower_reco_vertex.isNonnull())
+  {
     fSelShowerRecoVertexX = shower_reco_vertex->position().X();
     fSelShowerRecoVertexY = shower_reco_vertex->position().Y();
     fSelShowerRecoVertexZ = shower_reco_vertex->position().Z();
   }
-  catch(...)
-  {
-  }
+
+  const std::vector<std::vector<art::Ptr<recob::Hit>>> hitsByPlane(dune_ana::DUNEAnaHitUtils::GetHitsByPlane(sel_shower_hits));
 
   try
   {
-    std::vector<art::Ptr<recob::Hit>> hitListU = dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(sel_shower_hits, 0);
+    const std::vector<art::Ptr<recob::Hit>> &hitListU(hitsByPlane.at(0));
     fSelShowerDistanceToNuVertexU = DistanceToNuVertex(evt, hitListU, TVector3(fNuX, fNuY, fNuZ));
   }
   catch(...)
@@ -2322,7 +2298,7 @@ void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
 
   try
   {
-    std::vector<art::Ptr<recob::Hit>> hitListV = dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(sel_shower_hits, 1);
+    const std::vector<art::Ptr<recob::Hit>> &hitListV(hitsByPlane.at(1));
     fSelShowerDistanceToNuVertexV = DistanceToNuVertex(evt, hitListV, TVector3(fNuX, fNuY, fNuZ));
   }
   catch(...)
@@ -2331,7 +2307,7 @@ void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
 
   try
   {
-    std::vector<art::Ptr<recob::Hit>> hitListW = dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(sel_shower_hits, 2);
+    const std::vector<art::Ptr<recob::Hit>> &hitListW(hitsByPlane.at(2));
     fSelShowerDistanceToNuVertexW = DistanceToNuVertex(evt, hitListW, TVector3(fNuX, fNuY, fNuZ));
   }
   catch(...)
@@ -2339,8 +2315,8 @@ void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
   }
 
   // Momentum and energy
-  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-  auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
+  const detinfo::DetectorClocksData &clockData(context.ClockData());
+  const detinfo::DetectorPropertiesData &detProp(context.DetProp());
   fSelShowerRecoCharge  = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, sel_shower_hits); 
 
   std::unique_ptr<dune::EnergyRecoOutput> energyRecoHandle(std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(sel_shower, evt)));
@@ -2358,13 +2334,12 @@ void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
   }
 
   // Child PFP info
-  FillChildPFPInformation(sel_pfp, evt, fSelShowerRecoNChildPFP, fSelShowerRecoNChildTrackPFP, fSelShowerRecoNChildShowerPFP);
+  FillChildPFPInformation(sel_pfp, context, fSelShowerRecoNChildPFP, fSelShowerRecoNChildTrackPFP, fSelShowerRecoNChildShowerPFP);
 
   // Truth info
   int g4id = TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData, sel_shower_hits, 1);
-  std::vector<art::Ptr<recob::Hit>> eventHitList = dune_ana::DUNEAnaEventUtils::GetHits(evt, fHitsModuleLabel);
-  fSelShowerRecoCompleteness = FDSelectionUtils::CompletenessFromTrueParticleID(clockData, sel_shower_hits, eventHitList, g4id);
-  fSelShowerRecoHitPurity = FDSelectionUtils::HitPurityFromTrueParticleID(clockData, sel_shower_hits, g4id);
+  fSelShowerRecoCompleteness = FDSelectionUtils::CompletenessFromTrueParticleID(context.EventHitTruth(), sel_shower_hits, g4id);
+  fSelShowerRecoHitPurity = FDSelectionUtils::HitPurityFromTrueParticleID(context.EventHitTruth(), sel_shower_hits, g4id);
 
   if (TruthMatchUtils::Valid(g4id))
   {
@@ -2393,8 +2368,7 @@ void FDSelection::CCNuSelection::RunShowerSelection(art::Event const & evt)
   }
 
   // MVA PID
-  art::FindOneP<anab::MVAPIDResult> findPIDResult(std::vector<art::Ptr<recob::Shower>>{sel_shower}, evt, fPIDModuleLabel);
-  art::Ptr<anab::MVAPIDResult> pid(findPIDResult.at(0));
+  art::Ptr<anab::MVAPIDResult> pid(context.GetMVAPID(sel_shower));
 
   if (pid.isAvailable())
   {
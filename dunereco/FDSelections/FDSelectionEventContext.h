@@ -0,0 +1,255 @@
+#ifndef FDSELECTIONEVENTCONTEXT_H_SEEN
+#define FDSELECTIONEVENTCONTEXT_H_SEEN
+
+///////////////////////////////////////////////
+// FDSelectionEventContext.h
+//
+// The products of one event that the selection stages and the
+// selector tools share. Everything is fetched once per event and
+// the per-PFParticle lookups are plain index lookups by key
+///////////////////////////////////////////////
+
+// framework
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Persistency/Common/FindOneP.h"
+
+// LArSoft
+#include "lardataobj/RecoBase/Hit.h"
+#include "lardataobj/RecoBase/PFParticle.h"
+#include "lardataobj/RecoBase/Shower.h"
+#include "lardataobj/RecoBase/Track.h"
+#include "lardataobj/RecoBase/Vertex.h"
+#include "lardataobj/AnalysisBase/MVAPIDResult.h"
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+
+// DUNE
+#include "dunereco/AnaUtils/DUNEAnaAssocCache.h"
+#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
+#include "FDSelectionUtils.h"
+
+// c++
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FDSelection
+{
+  class EventContext
+  {
+    public:
+      EventContext(const art::Event &evt, const std::string &pfpLabel, const std::string &trackLabel, const std::string &showerLabel,
+        const std::string &hitLabel, const std::string &pidLabel);
+
+      const art::Event &Event() const { return fEvent; }
+      const detinfo::DetectorClocksData &ClockData() const { return fClockData; }
+      const detinfo::DetectorPropertiesData &DetProp() const { return fDetProp; }
+
+      const std::string &PFParticleLabel() const { return fPFParticleLabel; }
+      const std::string &TrackLabel() const { return fTrackLabel; }
+      const std::string &ShowerLabel() const { return fShowerLabel; }
+
+      const std::vector<art::Ptr<recob::PFParticle>> &PFParticles() const { return fPFParticles; }
+      const std::vector<art::Ptr<recob::Hit>> &EventHits() const { return fEventHits; }
+
+      /// The truth matching of the event hits is only done if a stage asks for it
+      const FDSelectionUtils::HitTruthMatch &EventHitTruth() const;
+
+      bool HasNeutrino() const { return fNeutrino.isNonnull(); }
+      const art::Ptr<recob::PFParticle> &Neutrino() const { return fNeutrino; }
+      const std::vector<art::Ptr<recob::PFParticle>> &NeutrinoChildren() const;
+      bool IsNeutrinoChild(const art::Ptr<recob::PFParticle> &pfp) const;
+
+      /// The lookups below return empty results for PFParticles of another collection
+      const std::vector<art::Ptr<recob::PFParticle>> &GetChildParticles(const art::Ptr<recob::PFParticle> &pfp) const;
+      bool IsTrack(const art::Ptr<recob::PFParticle> &pfp) const { return GetTrack(pfp).isNonnull(); }
+      const art::Ptr<recob::Track> &GetTrack(const art::Ptr<recob::PFParticle> &pfp) const;
+      bool IsShower(const art::Ptr<recob::PFParticle> &pfp) const { return GetShower(pfp).isNonnull(); }
+      const art::Ptr<recob::Shower> &GetShower(const art::Ptr<recob::PFParticle> &pfp) const;
+      const art::Ptr<recob::Vertex> &GetVertex(const art::Ptr<recob::PFParticle> &pfp) const;
+
+      /// The MVA PID associations are only built if a stage asks for them
+      art::Ptr<anab::MVAPIDResult> GetMVAPID(const art::Ptr<recob::Track> &track) const;
+      art::Ptr<anab::MVAPIDResult> GetMVAPID(const art::Ptr<recob::Shower> &shower) const;
+
+    private:
+      bool Owns(const art::Ptr<recob::PFParticle> &pfp) const;
+      template <typename T> art::Ptr<anab::MVAPIDResult> GetMVAPID(const art::Ptr<T> &pProd, const std::string &label,
+        std::unique_ptr<art::FindOneP<anab::MVAPIDResult>> &findPID) const;
+
+      const art::Event &fEvent;
+      std::string fPFParticleLabel;
+      std::string fTrackLabel;
+      std::string fShowerLabel;
+      std::string fPIDLabel;
+
+      detinfo::DetectorClocksData fClockData;
+      detinfo::DetectorPropertiesData fDetProp;
+
+      art::Handle<std::vector<recob::PFParticle>> fPFParticleHandle;
+      std::vector<art::Ptr<recob::PFParticle>> fPFParticles;
+      std::vector<art::Ptr<recob::Hit>> fEventHits;
+      art::Ptr<recob::PFParticle> fNeutrino;
+
+      /// Indexed by PFParticle key
+      std::vector<std::vector<art::Ptr<recob::PFParticle>>> fChildren;
+      std::vector<art::Ptr<recob::Track>> fTracks;
+      std::vector<art::Ptr<recob::Shower>> fShowers;
+      std::vector<art::Ptr<recob::Vertex>> fVertices;
+
+      mutable std::unique_ptr<art::FindOneP<anab::MVAPIDResult>> fTrackPIDs;
+      mutable std::unique_ptr<art::FindOneP<anab::MVAPIDResult>> fShowerPIDs;
+      mutable std::unique_ptr<FDSelectionUtils::HitTruthMatch> fEventHitTruth;
+  };
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline EventContext::EventContext(const art::Event &evt, const std::string &pfpLabel, const std::string &trackLabel, const std::string &showerLabel,
+    const std::string &hitLabel, const std::string &pidLabel) :
+    fEvent(evt),
+    fPFParticleLabel(pfpLabel),
+    fTrackLabel(trackLabel),
+    fShowerLabel(showerLabel),
+    fPIDLabel(pidLabel),
+    fClockData(art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt)),
+    fDetProp(art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(fClockData)),
+    fPFParticleHandle(evt.getHandle<std::vector<recob::PFParticle>>(pfpLabel)),
+    fPFParticles(dune_ana::DUNEAnaEventUtils::GetPFParticles(evt, pfpLabel)),
+    fEventHits(dune_ana::DUNEAnaEventUtils::GetHits(evt, hitLabel))
+  {
+    if (!fPFParticleHandle.isValid())
+      return;
+
+    if (dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, pfpLabel))
+      fNeutrino = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, pfpLabel);
+
+    const unsigned int nParticles(fPFParticleHandle->size());
+    fChildren.resize(nParticles);
+    fTracks.resize(nParticles);
+    fShowers.resize(nParticles);
+    fVertices.resize(nParticles);
+
+    for (unsigned int iPart = 0; iPart < nParticles; ++iPart)
+    {
+      const size_t parent(fPFParticleHandle->at(iPart).Parent());
+      if (parent < nParticles)
+        fChildren[parent].emplace_back(fPFParticleHandle, iPart);
+    }
+
+    const auto findTracks(dune_ana::DUNEAnaAssocCache::Get<recob::Track>(evt, fPFParticleHandle, pfpLabel, trackLabel));
+    const auto findShowers(dune_ana::DUNEAnaAssocCache::Get<recob::Shower>(evt, fPFParticleHandle, pfpLabel, showerLabel));
+    const auto findVertices(dune_ana::DUNEAnaAssocCache::Get<recob::Vertex>(evt, fPFParticleHandle, pfpLabel, pfpLabel));
+
+    for (unsigned int iPart = 0; iPart < nParticles; ++iPart)
+    {
+      if (!findTracks->at(iPart).empty())
+        fTracks[iPart] = findTracks->at(iPart).front();
+
+      if (!findShowers->at(iPart).empty())
+        fShowers[iPart] = findShowers->at(iPart).front();
+
+      if (!findVertices->at(iPart).empty())
+        fVertices[iPart] = findVertices->at(iPart).front();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline bool EventContext::Owns(const art::Ptr<recob::PFParticle> &pfp) const
+  {
+    return fPFParticleHandle.isValid() && (pfp.id() == fPFParticleHandle.id()) && (pfp.key() < fChildren.size());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline const std::vector<art::Ptr<recob::PFParticle>> &EventContext::NeutrinoChildren() const
+  {
+    return GetChildParticles(fNeutrino);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline bool EventContext::IsNeutrinoChild(const art::Ptr<recob::PFParticle> &pfp) const
+  {
+    return HasNeutrino() && Owns(pfp) && (pfp->Parent() == fNeutrino.key());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline const std::vector<art::Ptr<recob::PFParticle>> &EventContext::GetChildParticles(const art::Ptr<recob::PFParticle> &pfp) const
+  {
+    static const std::vector<art::Ptr<recob::PFParticle>> noChildren;
+    return Owns(pfp) ? fChildren[pfp.key()] : noChildren;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline const art::Ptr<recob::Track> &EventContext::GetTrack(const art::Ptr<recob::PFParticle> &pfp) const
+  {
+    static const art::Ptr<recob::Track> noTrack;
+    return Owns(pfp) ? fTracks[pfp.key()] : noTrack;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline const art::Ptr<recob::Shower> &EventContext::GetShower(const art::Ptr<recob::PFParticle> &pfp) const
+  {
+    static const art::Ptr<recob::Shower> noShower;
+    return Owns(pfp) ? fShowers[pfp.key()] : noShower;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline const art::Ptr<recob::Vertex> &EventContext::GetVertex(const art::Ptr<recob::PFParticle> &pfp) const
+  {
+    static const art::Ptr<recob::Vertex> noVertex;
+    return Owns(pfp) ? fVertices[pfp.key()] : noVertex;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline const FDSelectionUtils::HitTruthMatch &EventContext::EventHitTruth() const
+  {
+    if (!fEventHitTruth)
+      fEventHitTruth = std::make_unique<FDSelectionUtils::HitTruthMatch>(fClockData, fEventHits);
+
+    return *fEventHitTruth;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline art::Ptr<anab::MVAPIDResult> EventContext::GetMVAPID(const art::Ptr<recob::Track> &track) const
+  {
+    return GetMVAPID(track, fTrackLabel, fTrackPIDs);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  inline art::Ptr<anab::MVAPIDResult> EventContext::GetMVAPID(const art::Ptr<recob::Shower> &shower) const
+  {
+    return GetMVAPID(shower, fShowerLabel, fShowerPIDs);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+
+  template <typename T> art::Ptr<anab::MVAPIDResult> EventContext::GetMVAPID(const art::Ptr<T> &pProd, const std::string &label,
+    std::unique_ptr<art::FindOneP<anab::MVAPIDResult>> &findPID) const
+  {
+    const art::Handle<std::vector<T>> products(fEvent.getHandle<std::vector<T>>(label));
+
+    // Objects that are not from the configured collection get their own lookup
+    if (!products.isValid() || (pProd.id() != products.id()))
+      return art::FindOneP<anab::MVAPIDResult>(std::vector<art::Ptr<T>>{pProd}, fEvent, fPIDLabel).at(0);
+
+    if (!findPID)
+      findPID = std::make_unique<art::FindOneP<anab::MVAPIDResult>>(products, fEvent, fPIDLabel);
+
+    return findPID->at(pProd.key());
+  }
+}
+
+#endif
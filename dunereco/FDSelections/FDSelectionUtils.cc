@@ -28,77 +28,97 @@ double FDSelectionUtils::HitPurityFromTrueParticleID(detinfo::DetectorClocksData
   return hit_purity;
 }
 
-bool FDSelectionUtils::IsInsideTPC(TVector3 position, double distance_buffer){
-  geo::Point_t vtx(position.X(), position.Y(), position.Z());
-  bool inside = false;
-  art::ServiceHandle<geo::Geometry> geom;
-  geo::TPCID idtpc = geom->FindTPCAtPosition(vtx);
-
-  if (geom->HasTPC(idtpc))
-  {
-    const geo::TPCGeo& tpcgeo = geom->GetElement(idtpc);
-    double minx = tpcgeo.MinX(); double maxx = tpcgeo.MaxX();
-    double miny = tpcgeo.MinY(); double maxy = tpcgeo.MaxY();
-    double minz = tpcgeo.MinZ(); double maxz = tpcgeo.MaxZ();
-
-    //need to loop over cryostats?
-
-    for (size_t cIndex = 0; cIndex < geom->Ncryostats(); cIndex++)
-    {
-      geo::CryostatID c(cIndex);
-
-      const geo::CryostatGeo& cryostat = geom->Cryostat(c);
-      for (size_t t = 0; t < cryostat.NTPC(); t++)
-      {
-        const geo::TPCGeo& tpcg = cryostat.TPC(t);
-        if (tpcg.MinX() < minx) minx = tpcg.MinX();
-        if (tpcg.MaxX() > maxx) maxx = tpcg.MaxX();
-        if (tpcg.MinY() < miny) miny = tpcg.MinY();
-        if (tpcg.MaxY() > maxy) maxy = tpcg.MaxY();
-        if (tpcg.MinZ() < minz) minz = tpcg.MinZ();
-        if (tpcg.MaxZ() > maxz) maxz = tpcg.MaxZ();
-      }
+FDSelectionUtils::HitTruthMatch::HitTruthMatch(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& all_hits) :
+  fClockData(clockData){
+  if (all_hits.empty()) return;
+  //The table covers the collection of the first hit, any others are counted but matched again when asked for
+  fHitsID = all_hits.front().id();
+  for (unsigned int i_hit = 0; i_hit < all_hits.size(); i_hit++){
+    const art::Ptr<recob::Hit>& hit = all_hits[i_hit];
+    int matched_id = TruthMatchUtils::TrueParticleID(clockData, hit, 1);
+    fNHits[matched_id]++;
+    if (hit.id() != fHitsID) continue;
+    if (hit.key() >= fTrueIDs.size()){
+      fTrueIDs.resize(hit.key()+1, 0);
+      fInTable.resize(hit.key()+1, false);
     }
+    fTrueIDs[hit.key()] = matched_id;
+    fInTable[hit.key()] = true;
+  }
+}
 
-    //x
-    double dista = fabs(minx - position.X());
-    double distb = fabs(position.X() - maxx);
-    if ((position.X() > minx) && (position.X() < maxx) &&
-        (dista > distance_buffer) && (distb > distance_buffer)) inside = true;
-    //y
-    dista = fabs(maxy - position.Y());
-    distb = fabs(position.Y() - miny);
-    if (inside && (position.Y() > miny) && (position.Y() < maxy) &&
-        (dista > distance_buffer) && (distb > distance_buffer)) inside = true;
-    else inside = false;
-    //z
-    dista = fabs(maxz - position.Z());
-    distb = fabs(position.Z() - minz);
-    if (inside && (position.Z() > minz) && (position.Z() < maxz) &&
-        (dista > distance_buffer) && (distb > distance_buffer)) inside = true;
-    else inside = false;
+int FDSelectionUtils::HitTruthMatch::TrueParticleID(const art::Ptr<recob::Hit>& hit) const{
+  if (hit.id() == fHitsID && hit.key() < fInTable.size() && fInTable[hit.key()]) return fTrueIDs[hit.key()];
+  return TruthMatchUtils::TrueParticleID(fClockData, hit, 1);
+}
+
+int FDSelectionUtils::HitTruthMatch::NHits(int track_id) const{
+  std::unordered_map<int,int>::const_iterator it = fNHits.find(track_id);
+  return it == fNHits.end() ? 0 : it->second;
+}
+
+double FDSelectionUtils::CompletenessFromTrueParticleID(const HitTruthMatch& truth, const std::vector<art::Ptr<recob::Hit> >& selected_hits, int track_id){
+  int num_matches_in_all_hits = truth.NHits(track_id);
+  if (num_matches_in_all_hits == 0) return 0;
+
+  int num_matches_in_sel_hits = 0;
+  for (unsigned int i_hit = 0; i_hit < selected_hits.size(); i_hit++){
+    if (truth.TrueParticleID(selected_hits[i_hit])==track_id) num_matches_in_sel_hits++;
   }
+  return 1.*num_matches_in_sel_hits/num_matches_in_all_hits;
+}
+
+double FDSelectionUtils::HitPurityFromTrueParticleID(const HitTruthMatch& truth, const std::vector<art::Ptr<recob::Hit> >& selected_hits, int track_id){
+  if (selected_hits.empty()) return 0;
+
+  int num_matches_in_sel_hits = 0;
+  for (unsigned int i_hit = 0; i_hit < selected_hits.size(); i_hit++){
+    if (truth.TrueParticleID(selected_hits[i_hit])==track_id) num_matches_in_sel_hits++;
+  }
+  return 1.*num_matches_in_sel_hits/selected_hits.size();
+}
+
+bool FDSelectionUtils::IsInsideTPC(const TVector3& position, double distance_buffer){
+  return FDSelectionUtils::IsInsideTPC(dune_ana::Vec3::From(position), distance_buffer);
+}
+
+bool FDSelectionUtils::IsInsideTPC(const dune_ana::Vec3& position, double distance_buffer){
+  const dune_ana::DUNEAnaActiveVolume& activeVolume = dune_ana::DUNEAnaActiveVolume::Get();
+
+  //envelope of the TPCs of all cryostats, shrunk by the buffer. Tested first
+  //since it is a few comparisons, the TPC lookup is only needed inside it
+  //(a negative buffer still needs the position strictly inside the envelope)
+  const double buffer = std::max(distance_buffer, 0.);
+  const double x = position.x, y = position.y, z = position.z;
+  if (!(x > activeVolume.MinX() + buffer && x < activeVolume.MaxX() - buffer)) return false;
+  if (!(y > activeVolume.MinY() + buffer && y < activeVolume.MaxY() - buffer)) return false;
+  if (!(z > activeVolume.MinZ() + buffer && z < activeVolume.MaxZ() - buffer)) return false;
 
-  return inside;
+  return activeVolume.IsInsideTPC(x, y, z);
 }
 
 double FDSelectionUtils::CalculateTrackLength(const art::Ptr<recob::Track> track){
   double length = 0;
   if (track->NumberTrajectoryPoints()==1) return length; //Nothing to calculate if there is only one point
 
+  //Containment of each point is tested once, and reused when it is the start of the next step
+  const auto& start = track->LocationAtPoint(0);
+  dune_ana::Vec3 this_point{start.X(),start.Y(),start.Z()};
+  bool this_inside = FDSelectionUtils::IsInsideTPC(this_point,0);
   for (size_t i_tp = 0; i_tp < track->NumberTrajectoryPoints()-1; i_tp++){ //Loop from the first to 2nd to last point
-    TVector3 this_point(track->TrajectoryPoint(i_tp).position.X(),track->TrajectoryPoint(i_tp).position.Y(),track->TrajectoryPoint(i_tp).position.Z());
-    if (!FDSelectionUtils::IsInsideTPC(this_point,0)){
+    const auto& next = track->LocationAtPoint(i_tp+1);
+    const dune_ana::Vec3 next_point{next.X(),next.Y(),next.Z()};
+    const bool next_inside = FDSelectionUtils::IsInsideTPC(next_point,0);
+    if (!this_inside){
       std::cout<<"FDSelectionUtils::CalculateTrackLength - Current trajectory point not in the TPC volume.  Skip over this point in the track length calculation"<<std::endl;
-      continue;
     }
-    TVector3 next_point(track->TrajectoryPoint(i_tp+1).position.X(),track->TrajectoryPoint(i_tp+1).position.Y(),track->TrajectoryPoint(i_tp+1).position.Z());
-    if (!FDSelectionUtils::IsInsideTPC(next_point,0)){
+    else if (!next_inside){
       std::cout<<"FDSelectionUtils::CalculateTrackLength - Next trajectory point not in the TPC volume.  Skip over this point in the track length calculation"<<std::endl;
-      continue;
     }
+    else length+=(next_point-this_point).Mag();
 
-    length+=(next_point-this_point).Mag();
+    this_point = next_point;
+    this_inside = next_inside;
   }
   return length;
 }
@@ -24,6 +24,8 @@
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/Track.h"
+
+#include "dunereco/AnaUtils/DUNEAnaVector.h"
 //#include "lardataobj/RecoBase/Track.h"
 //#include "lardataobj/RecoBase/Shower.h"
 //#include "lardataobj/AnalysisBase/MVAPIDResult.h"
@@ -31,8 +33,11 @@
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larsim/Utils/TruthMatchUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaActiveVolume.h"
 
 // c++
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 #include <map>
 
@@ -41,14 +46,33 @@
 
 
 namespace FDSelectionUtils{
+  //Dominant true particle ID of every hit of an event, matched once so the completeness and purity of each reco particle are counts over the table rather than new back tracker queries
+  class HitTruthMatch{
+    public:
+      HitTruthMatch(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& all_hits);
+
+      int TrueParticleID(const art::Ptr<recob::Hit>& hit) const; //Hits that are not in the table are matched on the fly
+      int NHits(int track_id) const; //Number of hits in the table which match to track_id
+
+    private:
+      detinfo::DetectorClocksData fClockData;
+      art::ProductID fHitsID;
+      std::vector<int> fTrueIDs; //Indexed by hit key
+      std::vector<bool> fInTable; //Indexed by hit key
+      std::unordered_map<int,int> fNHits;
+  };
+
   //int TrueParticleID(const art::Ptr<recob::Hit> hit, bool rollup_unsaved_ids=1); //Returns the geant4 ID which contributes the most to a single reco hit.  The matching method looks for true particle which deposits the most true energy in the reco hit.  If rollup_unsaved_ids is set to true, any unsaved daughter than contributed energy to the hit has its energy included in its closest ancestor that was saved.
   //int TrueParticleIDFromTotalTrueEnergy(const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1); //Returns the geant4 ID which contributes the most to the vector of hits.  The matching method looks for which true particle deposits the most true energy in the reco hits
   //int TrueParticleIDFromTotalRecoCharge(const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);  //Returns the geant4 ID which contributes the most to the vector of hits.  The matching method looks for which true particle contributes the most reconstructed charge to the hit selection (the reco charge of each hit is correlated with each maximally contributing true particle and summed)
   //int TrueParticleIDFromTotalRecoHits(const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);  //Returns the geant4 ID which contributes the most to the vector of hits.  The matching method looks for which true particle maximally contributes to the most reco hits
   double CompletenessFromTrueParticleID(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& selected_hits, const std::vector<art::Ptr<recob::Hit> >& all_hits, int track_id); //Calculate the completeness of hits in the selected hits set which match to a specific true particle ID
   double HitPurityFromTrueParticleID(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& selected_hits, int track_id); //Calculate the purity of a hit set for a specific track ID 
+  double CompletenessFromTrueParticleID(const HitTruthMatch& truth, const std::vector<art::Ptr<recob::Hit> >& selected_hits, int track_id); //As above, with the hits of the event matched once in a HitTruthMatch
+  double HitPurityFromTrueParticleID(const HitTruthMatch& truth, const std::vector<art::Ptr<recob::Hit> >& selected_hits, int track_id); //As above, with the hits of the event matched once in a HitTruthMatch
 
-  bool IsInsideTPC(TVector3 position, double distance_buffer); //Checks if a position is within any of the TPCs in the geometry (user can define some distance buffer from the TPC walls)
+  bool IsInsideTPC(const TVector3& position, double distance_buffer); //Checks if a position is within any of the TPCs in the geometry (user can define some distance buffer from the TPC walls)
+  bool IsInsideTPC(const dune_ana::Vec3& position, double distance_buffer); //As above, for the inner loops
   double CalculateTrackLength(const art::Ptr<recob::Track> track); //Calculates the total length of a recob::track by summing up the distances between adjacent traj. points
 }
 
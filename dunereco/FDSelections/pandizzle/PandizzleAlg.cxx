@@ -10,6 +10,7 @@
 #include "larsim/Utils/TruthMatchUtils.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "dunereco/AnaUtils/DUNEAnaAssocCache.h"
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
@@ -20,29 +21,14 @@ namespace
 
   using namespace FDSelection;
 
-  void Reset(PandizzleAlg::InputVarsToReader &inputVarsToReader)
+  void Reset(PandizzleAlg::InputVars &inputVars)
   {
-    for (PandizzleAlg::Vars var = PandizzleAlg::kMichelNHits; var < PandizzleAlg::kTerminatingValue; var=static_cast<PandizzleAlg::Vars>(static_cast<int>(var)+1))
-    {
-      auto [itr, inserted] = inputVarsToReader.try_emplace(var, std::make_unique<Float_t>(kDefValue));
-      if (!inserted)
-        *(itr->second.get()) = kDefValue;
-    }
+    inputVars.fill(kDefValue);
   }
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-FDSelection::PandizzleAlg::Record::Record(const InputVarsToReader &inputVarsToReader, const Float_t mvaScore, const bool isFilled) :
-  fMVAScore(mvaScore),
-  fIsFilled(isFilled)
-{
-  for (PandizzleAlg::Vars var = PandizzleAlg::kMichelNHits; var < PandizzleAlg::kTerminatingValue; var=static_cast<PandizzleAlg::Vars>(static_cast<int>(var)+1)) 
-    fInputs.try_emplace(var, *(inputVarsToReader.at(var)));
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 FDSelection::PandizzleAlg::PandizzleAlg(const fhicl::ParameterSet& pset) :
   fShowerEnergyAlg(pset.get<fhicl::ParameterSet>("ShowerEnergyAlg")),
   fTrackModuleLabel(pset.get<std::string>("ModuleLabels.TrackModuleLabel")),
@@ -55,9 +41,9 @@ FDSelection::PandizzleAlg::PandizzleAlg(const fhicl::ParameterSet& pset) :
   fMakeSelectionTrainingTrees(pset.get<bool>("MakeSelectionTrainingTrees")),
   fReducedTreeMode(pset.get<bool>("ReducedTreeMode", true)),
   fPandizzleWeightFileName(pset.get< std::string > ("PandizzleWeightFileName")),
-  fPandizzleReader("", 0)
+  fPandizzleReader(pset.get<bool>("UseCompiledBDT", true), "", 0)
 {
-  Reset(fInputsToReader);
+  Reset(fInputs);
 
   fPandizzleReader.AddVariable("PFPMichelNHits", GetVarPtr(kMichelNHits));
   fPandizzleReader.AddVariable("PFPMichelElectronMVA", GetVarPtr(kMichelElectronMVA)); 
@@ -211,12 +197,14 @@ void FDSelection::PandizzleAlg::ProcessPFParticle(const art::Ptr<recob::PFPartic
   fVarHolder.IntVars["PFPNShowerChildren"] = CountPFPWithPDG(child_pfps, 11);
   fVarHolder.IntVars["PFPNTrackChildren"] = CountPFPWithPDG(child_pfps, 13);
   
-  FillTruthInfo(pfp, evt);
+  // The truth only goes into the training trees, scoring never needs it
+  if (fMakeSelectionTrainingTrees)
+    FillTruthInfo(pfp, evt);
 
   FillMVAVariables(pfp, evt);
 
   if (child_pfps.size() != 0)
-    FillMichelElectronVariables(pfp, evt);
+    FillMichelElectronVariables(pfp, child_pfps, evt);
 
   FillTrackVariables(pfp, evt);
 
@@ -315,7 +303,8 @@ void FDSelection::PandizzleAlg::FillMVAVariables(const art::Ptr<recob::PFParticl
 
 ///////////////////////////////////////////////////////
 
-void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob::PFParticle> mu_pfp, const art::Event& evt)
+void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob::PFParticle> mu_pfp,
+  const std::vector<art::Ptr<recob::PFParticle>> &child_pfps, const art::Event& evt)
 {
   //Assign the branch value to a new default value to indicate that we have a track, but don't necessarily have a Michel candidate (rather than a global default value)
   fVarHolder.FloatVars["PFPMichelDist"] = -2.;
@@ -325,8 +314,6 @@ void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob
   fVarHolder.FloatVars["PFPMichelRecoEnergyPlane1"] = -2;
   fVarHolder.FloatVars["PFPMichelRecoEnergyPlane2"] = -2;
 
-  std::vector<art::Ptr<recob::PFParticle>> child_pfps = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(mu_pfp, evt, fPFParticleModuleLabel);
-  
   //Get the shower handle
   art::Handle< std::vector<recob::Shower> > showerListHandle;
   if (!(evt.getByLabel(fShowerModuleLabel, showerListHandle))){
@@ -341,8 +328,11 @@ void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob
     return;
   }
 
-  art::FindManyP<anab::MVAPIDResult> fmpidt(trackListHandle, evt, fPIDModuleLabel);
-  art::FindManyP<anab::MVAPIDResult> fmpids(showerListHandle, evt, fPIDModuleLabel);
+  // Built once per event rather than once per candidate track
+  const auto pfmpidt = dune_ana::DUNEAnaAssocCache::Get<anab::MVAPIDResult>(evt, trackListHandle, fTrackModuleLabel, fPIDModuleLabel);
+  const auto pfmpids = dune_ana::DUNEAnaAssocCache::Get<anab::MVAPIDResult>(evt, showerListHandle, fShowerModuleLabel, fPIDModuleLabel);
+  const art::FindManyP<anab::MVAPIDResult> &fmpidt = *pfmpidt;
+  const art::FindManyP<anab::MVAPIDResult> &fmpids = *pfmpids;
 
   // Find closest particle to end of track
   art::Ptr<recob::Track> mu_track = dune_ana::DUNEAnaPFParticleUtils::GetTrack(mu_pfp, evt, fPFParticleModuleLabel, fTrackModuleLabel);
@@ -360,15 +350,13 @@ void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob
     {
       art::Ptr<recob::Track> child_track = dune_ana::DUNEAnaPFParticleUtils::GetTrack(child_pfp, evt, fPFParticleModuleLabel, fTrackModuleLabel);
       child_start_pos.SetXYZ(child_track->Start().X(), child_track->Start().Y(), child_track->Start().Z());
-      std::vector<art::Ptr<anab::MVAPIDResult> > pids = fmpidt.at(child_track.key());
-      child_pfp_mva_pid_result = pids.at(0);
+      child_pfp_mva_pid_result = fmpidt.at(child_track.key()).at(0);
     }
     else if (dune_ana::DUNEAnaPFParticleUtils::IsShower(child_pfp, evt, fPFParticleModuleLabel, fShowerModuleLabel))
     {
       art::Ptr<recob::Shower> child_shower = dune_ana::DUNEAnaPFParticleUtils::GetShower(child_pfp, evt, fPFParticleModuleLabel, fShowerModuleLabel);
       child_start_pos.SetXYZ(child_shower->ShowerStart().X(), child_shower->ShowerStart().Y(), child_shower->ShowerStart().Z());
-      std::vector<art::Ptr<anab::MVAPIDResult> > pids = fmpids.at(child_shower.key());
-      child_pfp_mva_pid_result = pids.at(0);
+      child_pfp_mva_pid_result = fmpids.at(child_shower.key()).at(0);
     }
     else {
       continue;
@@ -392,18 +380,22 @@ void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob
   std::vector<art::Ptr<recob::Hit> > michel_hits = dune_ana::DUNEAnaPFParticleUtils::GetHits(closest_child_pfp, evt, fClusterModuleLabel);
   fVarHolder.IntVars["PFPMichelNHits"] = std::min((int)(michel_hits.size()), 100);
 
-  simb::MCParticle* matchedMCParticle = nullptr;
-
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
-  int g4id = TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData, michel_hits, 1); 
-  if (g4id > 0)
-    matchedMCParticle = pi_serv->ParticleList().at(g4id);
 
-  if (matchedMCParticle)
+  if (fMakeSelectionTrainingTrees)
   {
-    fVarHolder.IntVars["PFPMichelTrueID"] = matchedMCParticle->TrackId();
-    fVarHolder.IntVars["PFPMichelTrueMotherID"] = matchedMCParticle->Mother();
-    fVarHolder.IntVars["PFPMichelTruePDG"] = matchedMCParticle->PdgCode();
+    simb::MCParticle* matchedMCParticle = nullptr;
+
+    int g4id = TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData, michel_hits, 1); 
+    if (g4id > 0)
+      matchedMCParticle = pi_serv->ParticleList().at(g4id);
+
+    if (matchedMCParticle)
+    {
+      fVarHolder.IntVars["PFPMichelTrueID"] = matchedMCParticle->TrackId();
+      fVarHolder.IntVars["PFPMichelTrueMotherID"] = matchedMCParticle->Mother();
+      fVarHolder.IntVars["PFPMichelTruePDG"] = matchedMCParticle->PdgCode();
+    }
   }
 
   std::map<std::string,double> mvaOutMap = closest_child_pfp_mva_pid_result->mvaOutput;
@@ -411,8 +403,12 @@ void FDSelection::PandizzleAlg::FillMichelElectronVariables(const art::Ptr<recob
 
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
 
-  fVarHolder.FloatVars["PFPMichelRecoEnergyPlane0"] = fShowerEnergyAlg.ShowerEnergy(clockData, detProp, michel_hits, 0);
-  fVarHolder.FloatVars["PFPMichelRecoEnergyPlane1"] = fShowerEnergyAlg.ShowerEnergy(clockData, detProp, michel_hits, 1);
+  // Only the collection plane energy is a BDT input
+  if (fMakeSelectionTrainingTrees)
+  {
+    fVarHolder.FloatVars["PFPMichelRecoEnergyPlane0"] = fShowerEnergyAlg.ShowerEnergy(clockData, detProp, michel_hits, 0);
+    fVarHolder.FloatVars["PFPMichelRecoEnergyPlane1"] = fShowerEnergyAlg.ShowerEnergy(clockData, detProp, michel_hits, 1);
+  }
   fVarHolder.FloatVars["PFPMichelRecoEnergyPlane2"] = fShowerEnergyAlg.ShowerEnergy(clockData, detProp, michel_hits, 2);
 
   return;
@@ -592,40 +588,67 @@ void FDSelection::PandizzleAlg::ResetTreeVariables()
 
 FDSelection::PandizzleAlg::Record FDSelection::PandizzleAlg::RunPID(const art::Ptr<recob::Track> pTrack, const art::Event& evt) 
 {
-  art::Ptr<recob::PFParticle> pfp = dune_ana::DUNEAnaTrackUtils::GetPFParticle(pTrack, evt, fTrackModuleLabel);
-
-  fVarHolder.BoolVars["MVAVarsFilled"] = false;
+  return RunPID(std::vector<art::Ptr<recob::Track>>{pTrack}, evt).front();
+}
 
-  ResetTreeVariables();
-  ProcessPFParticle(pfp, evt);
+////////////////////////
 
-  if (fVarHolder.BoolVars["MVAVarsFilled"])
+std::vector<FDSelection::PandizzleAlg::Record> FDSelection::PandizzleAlg::RunPID(const std::vector<art::Ptr<recob::Track>> &tracks, const art::Event& evt) 
+{
+  // The variables are worked out one track at a time in the member state, so
+  // keep a copy of the inputs of each track and score them all together
+  std::vector<InputVars> inputs(tracks.size());
+  std::vector<bool> filled(tracks.size());
+  std::vector<InputVars> samples;
+  for (unsigned int iTrack = 0; iTrack < tracks.size(); ++iTrack)
   {
-    SetVar(kMichelNHits, (float)fVarHolder.IntVars["PFPMichelNHits"]);
-    SetVar(kMichelElectronMVA, fVarHolder.FloatVars["PFPMichelElectronMVA"]);
-    SetVar(kMichelRecoEnergyPlane2, fVarHolder.FloatVars["PFPMichelRecoEnergyPlane2"]);
-    SetVar(kTrackDeflecAngleSD, fVarHolder.FloatVars["PFPTrackDeflecAngleSD"]);
-    SetVar(kTrackLength, fVarHolder.FloatVars["PFPTrackLength"]);
-    SetVar(kEvalRatio, fVarHolder.FloatVars["PFPTrackEvalRatio"]);
-    SetVar(kConcentration, fVarHolder.FloatVars["PFPTrackConcentration"]);
-    SetVar(kCoreHaloRatio, fVarHolder.FloatVars["PFPTrackCoreHaloRatio"]);
-    SetVar(kConicalness, fVarHolder.FloatVars["PFPTrackConicalness"]);
-    SetVar(kdEdxStart, fVarHolder.FloatVars["PFPTrackdEdxStart"]);
-    SetVar(kdEdxEnd, fVarHolder.FloatVars["PFPTrackdEdxEnd"]);
-    SetVar(kdEdxEndRatio, fVarHolder.FloatVars["PFPTrackdEdxEndRatio"]);
-
-    return Record(fInputsToReader, fPandizzleReader.EvaluateMVA("BDTG"), true);
+    filled[iTrack] = FillInputs(tracks[iTrack], evt);
+    inputs[iTrack] = fInputs;
+    if (filled[iTrack])
+      samples.push_back(fInputs);
   }
 
-  return ReturnEmptyRecord();
+  std::vector<Double_t> scores(samples.size());
+  if (!samples.empty())
+    fPandizzleReader.EvaluateMVA("BDTG", fInputs.data(), kTerminatingValue, samples.front().data(), samples.size(), scores.data());
+
+  std::vector<Record> records;
+  records.reserve(tracks.size());
+  for (unsigned int iTrack = 0, iSample = 0; iTrack < tracks.size(); ++iTrack)
+    records.emplace_back(inputs[iTrack], filled[iTrack] ? scores[iSample++] : kDefValue, filled[iTrack]);
+
+  return records;
 }
 
 ////////////////////////
 
-FDSelection::PandizzleAlg::Record FDSelection::PandizzleAlg::ReturnEmptyRecord()
+bool FDSelection::PandizzleAlg::FillInputs(const art::Ptr<recob::Track> pTrack, const art::Event& evt) 
 {
-    Reset(fInputsToReader);
-    return Record(fInputsToReader, kDefValue, false);
+  art::Ptr<recob::PFParticle> pfp = dune_ana::DUNEAnaTrackUtils::GetPFParticle(pTrack, evt, fTrackModuleLabel);
+
+  fVarHolder.BoolVars["MVAVarsFilled"] = false;
+
+  Reset(fInputs);
+  ResetTreeVariables();
+  ProcessPFParticle(pfp, evt);
+
+  if (!fVarHolder.BoolVars["MVAVarsFilled"])
+    return false;
+
+  SetVar(kMichelNHits, (float)fVarHolder.IntVars["PFPMichelNHits"]);
+  SetVar(kMichelElectronMVA, fVarHolder.FloatVars["PFPMichelElectronMVA"]);
+  SetVar(kMichelRecoEnergyPlane2, fVarHolder.FloatVars["PFPMichelRecoEnergyPlane2"]);
+  SetVar(kTrackDeflecAngleSD, fVarHolder.FloatVars["PFPTrackDeflecAngleSD"]);
+  SetVar(kTrackLength, fVarHolder.FloatVars["PFPTrackLength"]);
+  SetVar(kEvalRatio, fVarHolder.FloatVars["PFPTrackEvalRatio"]);
+  SetVar(kConcentration, fVarHolder.FloatVars["PFPTrackConcentration"]);
+  SetVar(kCoreHaloRatio, fVarHolder.FloatVars["PFPTrackCoreHaloRatio"]);
+  SetVar(kConicalness, fVarHolder.FloatVars["PFPTrackConicalness"]);
+  SetVar(kdEdxStart, fVarHolder.FloatVars["PFPTrackdEdxStart"]);
+  SetVar(kdEdxEnd, fVarHolder.FloatVars["PFPTrackdEdxEnd"]);
+  SetVar(kdEdxEndRatio, fVarHolder.FloatVars["PFPTrackdEdxEndRatio"]);
+
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
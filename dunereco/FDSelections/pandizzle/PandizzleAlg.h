@@ -38,11 +38,12 @@
 #include "larreco/RecoAlg/ShowerEnergyAlg.h"
 
 // c++
+#include <array>
 #include <vector>
 
 // ROOT
 #include "TTree.h"
-#include "TMVA/Reader.h"
+#include "dunereco/BDTRuntime/BDTReader.h"
 
 namespace FDSelection {
   class PandizzleAlg;
@@ -67,27 +68,34 @@ class FDSelection::PandizzleAlg {
     kTerminatingValue //terminates the enum and not an actual variable
   };
 
-  using InputVarsToReader = std::map<Vars, std::unique_ptr<Float_t>>;
+  /// The reader inputs, indexed by Vars
+  using InputVars = std::array<Float_t, kTerminatingValue>;
 
+  /// Plain copy of the inputs and the score of one track
   class Record {
     public:
-      Record(const InputVarsToReader &inputVars, const Float_t mvaScore, const bool isFilled);
+      Record(const InputVars &inputVars, const Float_t mvaScore, const bool isFilled);
 
-      Float_t GetVar(const FDSelection::PandizzleAlg::Vars var);
-      bool IsFilled();
-      Float_t GetMVAScore();
+      Float_t GetVar(const FDSelection::PandizzleAlg::Vars var) const;
+      bool IsFilled() const;
+      Float_t GetMVAScore() const;
 
     private:
-      using InputVars = std::map<Vars, Float_t>;
       InputVars fInputs;
       Float_t fMVAScore;
       bool fIsFilled;
   };
 
   PandizzleAlg(const fhicl::ParameterSet& pset);
+  /// The reader holds pointers into fInputs, so the alg must stay where it was made
+  PandizzleAlg(const PandizzleAlg&) = delete;
+  PandizzleAlg& operator=(const PandizzleAlg&) = delete;
 
   void Run(const art::Event& evt);
   Record RunPID(const art::Ptr<recob::Track> pTrack, const art::Event& evt);
+  /// Records of several tracks, in the same order. The inputs are worked out
+  /// track by track and the filled ones are then scored with one BDT call
+  std::vector<Record> RunPID(const std::vector<art::Ptr<recob::Track>> &tracks, const art::Event& evt);
 
  private:
   void InitialiseTrees();
@@ -98,7 +106,8 @@ class FDSelection::PandizzleAlg {
   int CountPFPWithPDG(const std::vector<art::Ptr<recob::PFParticle> > & pfps, int pdg);
   void FillTruthInfo(const art::Ptr<recob::PFParticle> pfp, const art::Event& evt);
   void FillMVAVariables(const art::Ptr<recob::PFParticle> pfp, const art::Event& evt);
-  void FillMichelElectronVariables(const art::Ptr<recob::PFParticle> mu_pfp, const art::Event& evt);
+  void FillMichelElectronVariables(const art::Ptr<recob::PFParticle> mu_pfp,
+    const std::vector<art::Ptr<recob::PFParticle>> &child_pfps, const art::Event& evt);
   void FillTrackVariables(const art::Ptr<recob::PFParticle> pfp, const art::Event& evt);
   void CalculateTrackDeflection(const art::Ptr<recob::Track> track);
   void CalculateTrackLengthVariables(const art::Ptr<recob::PFParticle> pfp, const art::Event& evt);
@@ -107,7 +116,8 @@ class FDSelection::PandizzleAlg {
 
   Float_t* GetVarPtr(const FDSelection::PandizzleAlg::Vars var);
   void SetVar(const FDSelection::PandizzleAlg::Vars var, const Float_t value);
-  Record ReturnEmptyRecord();
+  /// Fill fInputs for the track, false if its variables could not be worked out
+  bool FillInputs(const art::Ptr<recob::Track> pTrack, const art::Event& evt);
 
   //Algs
   shower::ShowerEnergyAlg fShowerEnergyAlg;
@@ -130,8 +140,8 @@ class FDSelection::PandizzleAlg {
   TTree *fBackgroundTrackTree;
 
   std::string fPandizzleWeightFileName;
-  TMVA::Reader fPandizzleReader;
-  InputVarsToReader fInputsToReader;
+  bdt::BDTReader fPandizzleReader;
+  InputVars fInputs;
 
   struct VarHolder
   {
@@ -147,34 +157,36 @@ class FDSelection::PandizzleAlg {
   art::ServiceHandle<art::TFileService> tfs;
 };
 
-Float_t FDSelection::PandizzleAlg::Record::GetVar(const FDSelection::PandizzleAlg::Vars var)
+inline FDSelection::PandizzleAlg::Record::Record(const InputVars &inputVars, const Float_t mvaScore, const bool isFilled) :
+  fInputs(inputVars),
+  fMVAScore(mvaScore),
+  fIsFilled(isFilled)
 {
-  return (fInputs.at(var));
 }
 
-bool FDSelection::PandizzleAlg::Record::IsFilled()
+inline Float_t FDSelection::PandizzleAlg::Record::GetVar(const FDSelection::PandizzleAlg::Vars var) const
+{
+  return fInputs[var];
+}
+
+inline bool FDSelection::PandizzleAlg::Record::IsFilled() const
 {
   return fIsFilled;
 }
 
-Float_t FDSelection::PandizzleAlg::Record::GetMVAScore()
+inline Float_t FDSelection::PandizzleAlg::Record::GetMVAScore() const
 {
   return fMVAScore;
 }
 
-Float_t* FDSelection::PandizzleAlg::GetVarPtr(const FDSelection::PandizzleAlg::Vars var)
+inline Float_t* FDSelection::PandizzleAlg::GetVarPtr(const FDSelection::PandizzleAlg::Vars var)
 {
-  return fInputsToReader.at(var).get();
+  return &fInputs[var];
 }
 
-void FDSelection::PandizzleAlg::SetVar(const FDSelection::PandizzleAlg::Vars var, const Float_t value)
+inline void FDSelection::PandizzleAlg::SetVar(const FDSelection::PandizzleAlg::Vars var, const Float_t value)
 {
-  std::map<Vars, std::unique_ptr<Float_t> >::iterator itr(fInputsToReader.find(var));
-
-  if (itr != fInputsToReader.end())
-    *(itr->second.get()) = value;
-
-  return;
+  fInputs[var] = value;
 }
 
 #endif
@@ -32,6 +32,7 @@
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaShowerUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/Profiling/ProfScope.h"
 
 namespace
 {
@@ -39,29 +40,14 @@ namespace
 
   using namespace FDSelection;
 
-  void Reset(PandrizzleAlg::InputVarsToReader &inputVarsToReader)
+  void Reset(PandrizzleAlg::InputVars &inputVars)
   {
-    for (PandrizzleAlg::Vars var = PandrizzleAlg::kEvalRatio; var < PandrizzleAlg::kTerminatingValue; var=static_cast<PandrizzleAlg::Vars>(static_cast<int>(var)+1)) 
-    {
-      auto [itr, inserted] = inputVarsToReader.try_emplace(var, std::make_unique<Float_t>(kDefValue));
-      if (!inserted)
-       *(itr->second.get()) = kDefValue;
-    }
+    inputVars.fill(kDefValue);
   }
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-FDSelection::PandrizzleAlg::Record::Record(const InputVarsToReader &inputVarsToReader, const Float_t mvaScore, const bool isFilled) :
-  fMVAScore(mvaScore),
-  fIsFilled(isFilled)
-{
-  for (PandrizzleAlg::Vars var = PandrizzleAlg::kEvalRatio; var < PandrizzleAlg::kTerminatingValue; var=static_cast<PandrizzleAlg::Vars>(static_cast<int>(var)+1)) 
-    fInputs.try_emplace(var, *(inputVarsToReader.at(var)));
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 FDSelection::PandrizzleAlg::PandrizzleAlg(const fhicl::ParameterSet& pset) :
     fPFParticleModuleLabel(pset.get<std::string>("ModuleLabels.PFParticleModuleLabel")),
     fShowerModuleLabel(pset.get<std::string>("ModuleLabels.ShowerModuleLabel")),
@@ -70,8 +56,8 @@ FDSelection::PandrizzleAlg::PandrizzleAlg(const fhicl::ParameterSet& pset) :
     fPFPMetadataLabel(pset.get<std::string>("ModuleLabels.PFPMetadataLabel")),
     fPandrizzleWeightFileName(pset.get< std::string>("PandrizzleWeightFileName")),
     fEnhancedPandrizzleWeightFileName(pset.get< std::string>("EnhancedPandrizzleWeightFileName")),
-    fReader("", 0),
-    fEnhancedReader("", 0),
+    fReader(pset.get<bool>("UseCompiledBDT", true), "", 0),
+    fEnhancedReader(pset.get<bool>("UseCompiledBDT", true), "", 0),
     fMakeSelectionTrainingTrees(pset.get<bool>("MakeSelectionTrainingTrees")),
     fUseConcentration(pset.get<bool>("UseConcentration")),
     fUseDisplacement(pset.get<bool>("UseDisplacement")),
@@ -81,7 +67,7 @@ FDSelection::PandrizzleAlg::PandrizzleAlg(const fhicl::ParameterSet& pset) :
     fEnhancedPandrizzleHitCut(pset.get<int>("EnhancedPandrizzleHitCut")),
     fBackupPandrizzleHitCut(pset.get<int>("BackupPandrizzleHitCut"))
 {
-    Reset(fInputsToReader);
+    Reset(fInputs);
 
     fReader.AddVariable("EvalRatio", GetVarPtr(kEvalRatio));
 
@@ -276,6 +262,7 @@ void FDSelection::PandrizzleAlg::BookTreeBool(TTree *tree, std::string branch_na
 
 void FDSelection::PandrizzleAlg::Run(const art::Event& evt) 
 {
+  DUNE_PROF_SCOPE("FDSelection::PandrizzleAlg::Run");
   if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
     return;
   
@@ -310,7 +297,9 @@ void FDSelection::PandrizzleAlg::ProcessPFParticle(const art::Ptr<recob::PFParti
   std::vector<art::Ptr<recob::Hit>> pfp_hits = dune_ana::DUNEAnaPFParticleUtils::GetHits(pfp, evt, fClusterModuleLabel);
   fVarHolder.IntVars["PFPNHits"] = pfp_hits.size();
 
-  FillTruthInfo(pfp, evt);
+  // The truth only goes into the training trees, scoring never needs it
+  if (fMakeSelectionTrainingTrees)
+    FillTruthInfo(pfp, evt);
 
   // Fill the MVA Info
   if (!dune_ana::DUNEAnaPFParticleUtils::IsShower(pfp, evt, fPFParticleModuleLabel, fShowerModuleLabel))
@@ -597,6 +586,24 @@ float FDSelection::PandrizzleAlg::GetLargest3DPathwayKink(art::Ptr<recob::Track>
 
     const unsigned int maxCentralLayer(nLayersSpanned - (2 * nLayersHalfWindow) - 1);
     const unsigned int minCentralLayer(nLayersHalfWindow);
+    const unsigned int nTestLayers(maxCentralLayer + nLayersHalfWindow);
+
+    // The windows of neighbouring central layers overlap, so find the direction across each window
+    // and the kink at each test layer once. The direction into a test layer is the one out of the
+    // layer nLayersHalfWindow before it
+    std::vector<geo::Vector_t> windowDirections(nTestLayers);
+
+    for (unsigned int index = 0; index < nTestLayers; ++index)
+    {
+        geo::Vector_t direction(trackStub->LocationAtPoint(index + nLayersHalfWindow) - trackStub->LocationAtPoint(index));
+        direction /= std::sqrt(direction.Mag2());
+        windowDirections[index] = direction;
+    }
+
+    std::vector<float> openingAngles(nTestLayers);
+
+    for (unsigned int testIndex = minCentralLayer; testIndex < nTestLayers; ++testIndex)
+        openingAngles[testIndex] = acos(windowDirections[testIndex - nLayersHalfWindow].Dot(windowDirections[testIndex])) * 180.0 / 3.14;
 
     float highestOpeningAngle(-10.f);
 
@@ -607,22 +614,7 @@ float FDSelection::PandrizzleAlg::GetLargest3DPathwayKink(art::Ptr<recob::Track>
 
         for (int i = 0; i < nLayersHalfWindow; ++i)
         {
-            unsigned int testIndex = index + i;
-            const unsigned int firstIndex(testIndex - nLayersHalfWindow);
-            const unsigned int centralIndex(testIndex);
-            const unsigned int secondIndex(testIndex + nLayersHalfWindow);
-
-            const geo::Point_t firstPosition(trackStub->LocationAtPoint(firstIndex));
-            const geo::Point_t centralPosition(trackStub->LocationAtPoint(centralIndex));
-            const geo::Point_t secondPosition(trackStub->LocationAtPoint(secondIndex));
-
-            geo::Vector_t firstDirection(centralPosition - firstPosition);
-            firstDirection /= std::sqrt(firstDirection.Mag2());
-
-            geo::Vector_t secondDirection(secondPosition - centralPosition);
-            secondDirection /= std::sqrt(secondDirection.Mag2());
-
-            const float openingAngle(acos(firstDirection.Dot(secondDirection)) * 180.0 / 3.14);
+            const float openingAngle(openingAngles[index + i]);
 
             if (openingAngle < thisOpeningAngle)
             {
@@ -732,18 +724,22 @@ void FDSelection::PandrizzleAlg::GetShowerRegionVariables(const TVector3 &nuVert
     // Find 2D showers
 
     art::ServiceHandle<geo::Geometry const> theGeometry;
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
 
-    std::vector<art::Ptr<recob::Hit>> allShowerHits(dune_ana::DUNEAnaPFParticleUtils::GetHits(pfp, evt, "pandoraSel"));
-    std::vector<art::Ptr<recob::Hit>> showerHitsU, showerHitsV, showerHitsW;
+    // Project the hits once, the shower hit lists below hold indices into the projection
+    const std::vector<art::Ptr<recob::Hit>> allShowerHits(dune_ana::DUNEAnaPFParticleUtils::GetHits(pfp, evt, "pandoraSel"));
+    const ProjectedHits projectedHits(ProjectHits(allShowerHits, evt));
+    const unsigned int nAllShowerHits(allShowerHits.size());
+
+    std::vector<unsigned int> showerHitsU, showerHitsV, showerHitsW;
+    std::vector<bool> isShowerHit(nAllShowerHits, false);
     pandora::CartesianPointVector cartesianPointVectorU, cartesianPointVectorV, cartesianPointVectorW;
 
     int nHitsU(0), nHitsV(0), nHitsW(0);
 
-    for (auto pHit : allShowerHits)
+    for (unsigned int i = 0; i < nAllShowerHits; ++i)
     {
-        const geo::Vector_t hitPosition(GetPandoraHitPosition(pHit, evt));
-        const geo::View_t pandoraView(GetPandoraHitView(pHit));
+        const geo::Vector_t hitPosition(projectedHits.fX[i], 0.0, projectedHits.fZ[i]);
+        const geo::View_t pandoraView(projectedHits.fView[i]);
 
         if (pandoraView == geo::kW)
         {
@@ -755,7 +751,8 @@ void FDSelection::PandrizzleAlg::GetShowerRegionVariables(const TVector3 &nuVert
 
             if ((l > 0.f) && (t < 14.0))
             {
-                showerHitsW.push_back(pHit);
+                showerHitsW.push_back(i);
+                isShowerHit[i] = true;
                 cartesianPointVectorW.push_back(pandora::CartesianVector(hitPosition.X(), hitPosition.Y(), hitPosition.Z()));
             }
         }
@@ -769,11 +766,12 @@ void FDSelection::PandrizzleAlg::GetShowerRegionVariables(const TVector3 &nuVert
 
             if ((l > 0.f) && (t < 14.0))
             {
-                showerHitsU.push_back(pHit);
+                showerHitsU.push_back(i);
+                isShowerHit[i] = true;
                 cartesianPointVectorU.push_back(pandora::CartesianVector(hitPosition.X(), hitPosition.Y(), hitPosition.Z()));
             }
         }
-        else if (pandoraView == geo::kV) 
+        else
         {
             ++nHitsV;
 
@@ -783,15 +781,11 @@ void FDSelection::PandrizzleAlg::GetShowerRegionVariables(const TVector3 &nuVert
 
             if ((l > 0.f) && (t < 14.0))
             {
-                showerHitsV.push_back(pHit);
+                showerHitsV.push_back(i);
+                isShowerHit[i] = true;
                 cartesianPointVectorV.push_back(pandora::CartesianVector(hitPosition.X(), hitPosition.Y(), hitPosition.Z()));
             }
         }
-        else 
-        {
-            throw cet::exception("LArPandora")
-                << "CreatePandoraHits2D - this wire view not recognised (View=" << pandoraView << ") ";
-        }
     }
 
     modularShowerMaxNShowerHits = std::min(std::max(std::max(showerHitsU.size(), showerHitsV.size()), showerHitsW.size()), static_cast<long unsigned int>(2000));
@@ -814,61 +808,50 @@ void FDSelection::PandrizzleAlg::GetShowerRegionVariables(const TVector3 &nuVert
         pandora::CartesianVector fittedShowerDirectionW(isDownstream ? slidingFitResultW.GetGlobalMinLayerDirection() : slidingFitResultW.GetGlobalMaxLayerDirection() * -1.0);
 
         // now update...
-        for (auto pHit : allShowerHits)
+        for (unsigned int i = 0; i < nAllShowerHits; ++i)
         {
-            const geo::Vector_t hitPosition(GetPandoraHitPosition(pHit, evt));
-            const geo::View_t pandoraView(GetPandoraHitView(pHit));
+            if (isShowerHit[i])
+                continue;
+
+            const geo::Vector_t hitPosition(projectedHits.fX[i], 0.0, projectedHits.fZ[i]);
+            const geo::View_t pandoraView(projectedHits.fView[i]);
 
             if (pandoraView == geo::kW)
             {
-                if (std::find(showerHitsW.begin(), showerHitsW.end(), pHit) != showerHitsW.end())
-                    continue;
-
                 const geo::Vector_t displacement(hitPosition - showerStartW);
                 const float l(fittedShowerDirectionW.GetDotProduct(pandora::CartesianVector(displacement.X(), displacement.Y(), displacement.Z())));
                 const float t(fittedShowerDirectionW.GetCrossProduct(pandora::CartesianVector(displacement.X(), displacement.Y(), displacement.Z())).GetMagnitude());
 
                 if ((l > 0.f) && (t < 14.0))
                 {
-                    showerHitsW.push_back(pHit);
+                    showerHitsW.push_back(i);
                     cartesianPointVectorW.push_back(pandora::CartesianVector(hitPosition.X(), hitPosition.Y(), hitPosition.Z()));
                 }
             }
             else if (pandoraView == geo::kU)
             {
-                if (std::find(showerHitsU.begin(), showerHitsU.end(), pHit) != showerHitsU.end())
-                    continue;
-
                 const geo::Vector_t displacement(hitPosition - showerStartU);
                 const float l(fittedShowerDirectionU.GetDotProduct(pandora::CartesianVector(displacement.X(), displacement.Y(), displacement.Z())));
                 const float t(fittedShowerDirectionU.GetCrossProduct(pandora::CartesianVector(displacement.X(), displacement.Y(), displacement.Z())).GetMagnitude());
 
                 if ((l > 0.f) && (t < 14.0))
                 {
-                    showerHitsU.push_back(pHit);
+                    showerHitsU.push_back(i);
                     cartesianPointVectorU.push_back(pandora::CartesianVector(hitPosition.X(), hitPosition.Y(), hitPosition.Z()));
                 }
             }
-            else if (pandoraView == geo::kV)
+            else
             {
-                if (std::find(showerHitsV.begin(), showerHitsV.end(), pHit) != showerHitsV.end())
-                    continue;
-
                 const geo::Vector_t displacement(hitPosition - showerStartV);
                 const float l(fittedShowerDirectionV.GetDotProduct(pandora::CartesianVector(displacement.X(), displacement.Y(), displacement.Z())));
                 const float t(fittedShowerDirectionV.GetCrossProduct(pandora::CartesianVector(displacement.X(), displacement.Y(), displacement.Z())).GetMagnitude());
 
                 if ((l > 0.f) && (t < 14.0))
                 {
-                    showerHitsV.push_back(pHit);
+                    showerHitsV.push_back(i);
                     cartesianPointVectorV.push_back(pandora::CartesianVector(hitPosition.X(), hitPosition.Y(), hitPosition.Z()));
                 }
             }
-            else 
-            {
-                throw cet::exception("LArPandora")
-                    << "CreatePandoraHits2D - this wire view not recognised (View=" << pandoraView << ") ";
-            }
         }
 
         modularShowerMaxNShowerHits = std::min(std::max(std::max(showerHitsU.size(), showerHitsV.size()), showerHitsW.size()), static_cast<long unsigned int>(2000));
@@ -912,18 +895,18 @@ void FDSelection::PandrizzleAlg::GetShowerRegionVariables(const TVector3 &nuVert
 
         float nuVertexChargeAsymmetryU(-0.5f), showerStartChargeAsymmetryU(-0.5f), nuVertexChargeWeightedMeanRadialDistanceU(-10.f), showerStartMoliereRadiusU(-10.f);
 
-        GetShowerChargeDistributionVariables(nuVertexU, connectionPathwayDirectionU, fittedShowerStartU, fittedShowerDirectionU, showerHitsU, nuVertexChargeAsymmetryU,
-            showerStartChargeAsymmetryU, nuVertexChargeWeightedMeanRadialDistanceU, showerStartMoliereRadiusU, evt);
+        GetShowerChargeDistributionVariables(nuVertexU, connectionPathwayDirectionU, fittedShowerStartU, fittedShowerDirectionU, projectedHits, showerHitsU,
+            nuVertexChargeAsymmetryU, showerStartChargeAsymmetryU, nuVertexChargeWeightedMeanRadialDistanceU, showerStartMoliereRadiusU);
 
         float nuVertexChargeAsymmetryV(-0.5f), showerStartChargeAsymmetryV(-0.5f), nuVertexChargeWeightedMeanRadialDistanceV(-10.f), showerStartMoliereRadiusV(-10.f);
 
-        GetShowerChargeDistributionVariables(nuVertexV, connectionPathwayDirectionV, fittedShowerStartV, fittedShowerDirectionV, showerHitsV, nuVertexChargeAsymmetryV,
-            showerStartChargeAsymmetryV, nuVertexChargeWeightedMeanRadialDistanceV, showerStartMoliereRadiusV, evt);
+        GetShowerChargeDistributionVariables(nuVertexV, connectionPathwayDirectionV, fittedShowerStartV, fittedShowerDirectionV, projectedHits, showerHitsV,
+            nuVertexChargeAsymmetryV, showerStartChargeAsymmetryV, nuVertexChargeWeightedMeanRadialDistanceV, showerStartMoliereRadiusV);
 
         float nuVertexChargeAsymmetryW(-0.5f), showerStartChargeAsymmetryW(-0.5f), nuVertexChargeWeightedMeanRadialDistanceW(-10.f), showerStartMoliereRadiusW(-10.f);
 
-        GetShowerChargeDistributionVariables(nuVertexW, connectionPathwayDirectionW, fittedShowerStartW, fittedShowerDirectionW, showerHitsW, nuVertexChargeAsymmetryW,
-            showerStartChargeAsymmetryW, nuVertexChargeWeightedMeanRadialDistanceW, showerStartMoliereRadiusW, evt);
+        GetShowerChargeDistributionVariables(nuVertexW, connectionPathwayDirectionW, fittedShowerStartW, fittedShowerDirectionW, projectedHits, showerHitsW,
+            nuVertexChargeAsymmetryW, showerStartChargeAsymmetryW, nuVertexChargeWeightedMeanRadialDistanceW, showerStartMoliereRadiusW);
 
         modularShowerMaxNuVertexChargeAsymmetry = std::max(std::max(nuVertexChargeAsymmetryU, nuVertexChargeAsymmetryV), nuVertexChargeAsymmetryW);
         modularShowerMaxShowerStartChargeAsymmetry = std::max(std::max(showerStartChargeAsymmetryU, showerStartChargeAsymmetryV), showerStartChargeAsymmetryW);
@@ -1015,98 +998,68 @@ float FDSelection::PandrizzleAlg::GetShowerOpeningAngle(const geo::Vector_t &sho
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void FDSelection::PandrizzleAlg::GetShowerChargeDistributionVariables(const pandora::CartesianVector nuVertexPosition, const pandora::CartesianVector connectionPathwayDirection,
-    const pandora::CartesianVector &fittedShowerStart, const pandora::CartesianVector &fittedShowerDirection, std::vector<art::Ptr<recob::Hit>> &showerHits, float &nuVertexChargeAsymmetry,
-    float &showerStartChargeAsymmetry, float &nuVertexChargeWeightedMeanRadialDistance, float &showerStartMoliereRadius, const art::Event& evt)
+    const pandora::CartesianVector &fittedShowerStart, const pandora::CartesianVector &fittedShowerDirection, const ProjectedHits &projectedHits,
+    const std::vector<unsigned int> &showerHits, float &nuVertexChargeAsymmetry, float &showerStartChargeAsymmetry, float &nuVertexChargeWeightedMeanRadialDistance,
+    float &showerStartMoliereRadius)
 {
-    pandora::CartesianVector pathwayOrthoAxis = connectionPathwayDirection.GetCrossProduct(pandora::CartesianVector(0.f, 1.f, 0.f));
-    pandora::CartesianVector showerOrthoAxis = fittedShowerDirection.GetCrossProduct(pandora::CartesianVector(0.f, 1.f, 0.f));
+    // Everything lives in the y = 0 plane of a pandora view. Crossing an axis with the y axis turns it
+    // within that plane and only the y component of a cross product with it survives, so the projection
+    // onto the orthogonal axis and the distance from the axis are the same number up to the sign
+    const float nuVertexX(nuVertexPosition.GetX()), nuVertexZ(nuVertexPosition.GetZ());
+    const float showerStartX(fittedShowerStart.GetX()), showerStartZ(fittedShowerStart.GetZ());
+    const float pathwayDirectionX(connectionPathwayDirection.GetX()), pathwayDirectionZ(connectionPathwayDirection.GetZ());
+    const float showerDirectionX(fittedShowerDirection.GetX()), showerDirectionZ(fittedShowerDirection.GetZ());
+
+    // Transverse distance from the shower axis and charge of each hit, for the Moliere radius
+    std::vector<std::pair<float, float>> showerStartTransverseCharges;
+    showerStartTransverseCharges.reserve(showerHits.size());
 
-    // Nu vertex energy asymmetry
     float totalCharge(0.f);
     nuVertexChargeAsymmetry = 0.f;
+    showerStartChargeAsymmetry = 0.f;
+    nuVertexChargeWeightedMeanRadialDistance = 0.f;
 
-    for (auto pHit : showerHits)
+    for (const unsigned int index : showerHits)
     {
-        const float hitCharge(std::fabs(pHit->Integral()));
-        totalCharge += hitCharge;
+        const float hitCharge(projectedHits.fCharge[index]);
+        const float hitX(projectedHits.fX[index]);
+        const float hitZ(projectedHits.fZ[index]);
 
-        const geo::Vector_t hitPosition(GetPandoraHitPosition(pHit, evt));
-        const pandora::CartesianVector pandoraHitPosition(hitPosition.X(), hitPosition.Y(), hitPosition.Z());
-        const pandora::CartesianVector displacement(pandoraHitPosition - nuVertexPosition);
-        const float thisL(pathwayOrthoAxis.GetDotProduct(displacement));
+        const float nuVertexL(pathwayDirectionX * (hitZ - nuVertexZ) - pathwayDirectionZ * (hitX - nuVertexX));
+        const float showerStartL(showerDirectionX * (hitZ - showerStartZ) - showerDirectionZ * (hitX - showerStartX));
 
-        nuVertexChargeAsymmetry += (thisL < 0.f) ? (-1.f * hitCharge) : hitCharge;
+        totalCharge += hitCharge;
+        nuVertexChargeAsymmetry += (nuVertexL < 0.f) ? (-1.f * hitCharge) : hitCharge;
+        showerStartChargeAsymmetry += (showerStartL < 0.f) ? (-1.f * hitCharge) : hitCharge;
+        nuVertexChargeWeightedMeanRadialDistance += (std::fabs(nuVertexL) * hitCharge);
+        showerStartTransverseCharges.emplace_back(std::fabs(showerStartL), hitCharge);
     }
 
+    // Nu vertex energy asymmetry
     nuVertexChargeAsymmetry = (totalCharge < std::numeric_limits<float>::epsilon()) ? -0.5f : (nuVertexChargeAsymmetry / totalCharge);
     nuVertexChargeAsymmetry = std::fabs(nuVertexChargeAsymmetry);
 
     // Shower start energy asymmetry
-    showerStartChargeAsymmetry = 0.f;
-
-    for (auto pHit : showerHits)
-    {
-        const float hitCharge(std::fabs(pHit->Integral()));
-        const geo::Vector_t hitPosition(GetPandoraHitPosition(pHit, evt));
-        const pandora::CartesianVector pandoraHitPosition(hitPosition.X(), hitPosition.Y(), hitPosition.Z());
-        const pandora::CartesianVector displacement(pandoraHitPosition - fittedShowerStart);
-        const float thisL(showerOrthoAxis.GetDotProduct(displacement));
-
-        showerStartChargeAsymmetry += (thisL < 0.f) ? (-1.f * hitCharge) : hitCharge;
-    }
-
     showerStartChargeAsymmetry = (totalCharge < std::numeric_limits<float>::epsilon()) ? -0.5f : (showerStartChargeAsymmetry / totalCharge);
     showerStartChargeAsymmetry = std::fabs(showerStartChargeAsymmetry);
 
     // Mean radial distance
-    nuVertexChargeWeightedMeanRadialDistance = 0.f;
-
-    for (auto pHit : showerHits)
-    {
-        const float hitCharge(std::fabs(pHit->Integral()));
-        const geo::Vector_t hitPosition(GetPandoraHitPosition(pHit, evt));
-        const pandora::CartesianVector pandoraHitPosition(hitPosition.X(), hitPosition.Y(), hitPosition.Z());
-        const pandora::CartesianVector displacement(pandoraHitPosition - nuVertexPosition);
-        const float thisT(connectionPathwayDirection.GetCrossProduct(displacement).GetMagnitude());
-
-        nuVertexChargeWeightedMeanRadialDistance += (thisT * hitCharge);
-    }
-
     nuVertexChargeWeightedMeanRadialDistance = (totalCharge < std::numeric_limits<float>::epsilon()) ? -10.f : nuVertexChargeWeightedMeanRadialDistance / totalCharge;
 
     // Molliere radius
-    std::sort(showerHits.begin(), showerHits.end(),
-        [this, &fittedShowerStart, &fittedShowerDirection, &evt](auto pHitA, auto pHitB) -> bool {
-            const geo::Vector_t hitPositionA(GetPandoraHitPosition(pHitA, evt));
-            const pandora::CartesianVector pandoraHitPositionA(hitPositionA.X(), hitPositionA.Y(), hitPositionA.Z());
-            const pandora::CartesianVector displacementA(pandoraHitPositionA - fittedShowerStart);
-
-            const geo::Vector_t hitPositionB(GetPandoraHitPosition(pHitB, evt));
-            const pandora::CartesianVector pandoraHitPositionB(hitPositionB.X(), hitPositionB.Y(), hitPositionB.Z());
-            const pandora::CartesianVector displacementB(pandoraHitPositionB - fittedShowerStart);
-
-            const float tA(fittedShowerDirection.GetCrossProduct(displacementA).GetMagnitude());
-            const float tB(fittedShowerDirection.GetCrossProduct(displacementB).GetMagnitude());
-
-            return tA < tB;
-        });
+    std::sort(showerStartTransverseCharges.begin(), showerStartTransverseCharges.end(),
+        [](const std::pair<float, float> &lhs, const std::pair<float, float> &rhs) -> bool { return lhs.first < rhs.first; });
 
     float showerStartRunningChargeSum(0.f);
     showerStartMoliereRadius = -10.f;
 
-    for (auto pHit : showerHits)
+    for (const std::pair<float, float> &transverseCharge : showerStartTransverseCharges)
     {
-        const float hitCharge(std::fabs(pHit->Integral()));
-
-        showerStartRunningChargeSum += hitCharge;
+        showerStartRunningChargeSum += transverseCharge.second;
 
         if ((showerStartRunningChargeSum / totalCharge) > 0.9f)
         {
-            const geo::Vector_t hitPosition(GetPandoraHitPosition(pHit, evt));
-            const pandora::CartesianVector pandoraHitPosition(hitPosition.X(), hitPosition.Y(), hitPosition.Z());
-            const pandora::CartesianVector displacement(pandoraHitPosition - fittedShowerStart);
-            showerStartMoliereRadius = fittedShowerDirection.GetCrossProduct(displacement).GetMagnitude();
-
+            showerStartMoliereRadius = transverseCharge.first;
             break;
         }
     }
@@ -1176,14 +1129,22 @@ const geo::Vector_t FDSelection::PandrizzleAlg::GetPandoraHitPosition(art::Ptr<r
     art::ServiceHandle<geo::Geometry const> theGeometry;
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
 
-   const geo::WireID hit_WireID(pHit->WireID());
-   const double hit_Time(pHit->PeakTime());
-   const geo::View_t hit_View(pHit->View());
+    return GetPandoraHitPosition(*pHit, *theGeometry, detProp);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+const geo::Vector_t FDSelection::PandrizzleAlg::GetPandoraHitPosition(const recob::Hit &hit, const geo::GeometryCore &geometry,
+    const detinfo::DetectorPropertiesData &detProp)
+{
+   const geo::WireID hit_WireID(hit.WireID());
+   const double hit_Time(hit.PeakTime());
+   const geo::View_t hit_View(hit.View());
    const geo::CryostatID cryostatID(hit_WireID.Cryostat);
 
    const geo::View_t pandora_View(lar_pandora::LArPandoraGeometry::GetGlobalView(hit_WireID.Cryostat, hit_WireID.TPC, hit_View));
 
-   geo::Point_t hitXYZ = theGeometry->Cryostat(cryostatID).TPC(hit_WireID.TPC).Plane(hit_WireID.Plane).Wire(hit_WireID.Wire).GetCenter();
+   geo::Point_t hitXYZ = geometry.Cryostat(cryostatID).TPC(hit_WireID.TPC).Plane(hit_WireID.Plane).Wire(hit_WireID.Wire).GetCenter();
    const double hitY(hitXYZ.Y());
    const double hitZ(hitXYZ.Z());
 
@@ -1221,50 +1182,153 @@ const geo::View_t FDSelection::PandrizzleAlg::GetPandoraHitView(art::Ptr<recob::
     return pandora_View;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+FDSelection::PandrizzleAlg::ProjectedHits FDSelection::PandrizzleAlg::ProjectHits(const std::vector<art::Ptr<recob::Hit>> &hits, const art::Event& evt)
+{
+    art::ServiceHandle<geo::Geometry const> theGeometry;
+    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
+
+    ProjectedHits projectedHits;
+    projectedHits.fX.reserve(hits.size());
+    projectedHits.fZ.reserve(hits.size());
+    projectedHits.fCharge.reserve(hits.size());
+    projectedHits.fView.reserve(hits.size());
+
+    for (const art::Ptr<recob::Hit> &pHit : hits)
+    {
+        const geo::Vector_t hitPosition(GetPandoraHitPosition(*pHit, *theGeometry, detProp));
+
+        projectedHits.fX.push_back(hitPosition.X());
+        projectedHits.fZ.push_back(hitPosition.Z());
+        projectedHits.fCharge.push_back(std::fabs(pHit->Integral()));
+        projectedHits.fView.push_back(GetPandoraHitView(pHit));
+    }
+
+    return projectedHits;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 FDSelection::PandrizzleAlg::Record FDSelection::PandrizzleAlg::RunPID(const art::Ptr<recob::Shower> pShower, const art::Event& evt) 
 {
-  art::Ptr<recob::PFParticle> pfp = dune_ana::DUNEAnaShowerUtils::GetPFParticle(pShower, evt, fShowerModuleLabel);
-
-  fVarHolder.BoolVars["MVAVarsFilled"] = false;
-  fVarHolder.BoolVars["PandrizzleVarsFilled"] = false;
-  fVarHolder.BoolVars["EnhancedPandrizzleVarsFilled"] = false;
-  fVarHolder.BoolVars["BackupPandrizzleVarsFilled"] = false;
+  return RunPID(std::vector<art::Ptr<recob::Shower>>{pShower}, evt).front();
+}
 
-  Reset(fInputsToReader);
-  ResetTreeVariables();
-  ProcessPFParticle(pfp, evt);
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-  if (fVarHolder.BoolVars["MVAVarsFilled"])
+std::vector<FDSelection::PandrizzleAlg::Record> FDSelection::PandrizzleAlg::RunPID(const std::vector<art::Ptr<recob::Shower>> &showers, const art::Event& evt) 
+{
+  // The variables are worked out one shower at a time in the member state, so
+  // keep a copy of the inputs of each shower and score them per reader together
+  std::vector<InputVars> inputs(showers.size());
+  std::vector<Scoring> scoring(showers.size());
+  for (unsigned int iShower = 0; iShower < showers.size(); ++iShower)
   {
-    SetVar(kEvalRatio, fVarHolder.FloatVars["EvalRatio"]);
-    SetVar(kConcentration, fVarHolder.FloatVars["Concentration"]);
-    SetVar(kCoreHaloRatio, fVarHolder.FloatVars["CoreHaloRatio"]);
-    SetVar(kConicalness, fVarHolder.FloatVars["Conicalness"]);
+    scoring[iShower] = FillInputs(showers[iShower], evt);
+    inputs[iShower] = fInputs;
   }
-  else
+
+  // The enhanced score decides which score a shower gets, it is not an input of the backup BDT
+  if (fUseBDTVariables)
   {
-    return ReturnEmptyRecord();
+    this->ScoreBatch(fEnhancedReader, inputs, scoring, kEnhancedPandrizzleScore,
+      [](const Scoring &s) { return s.fEnhanced; });
+    for (unsigned int iShower = 0; iShower < showers.size(); ++iShower)
+      if (scoring[iShower].fEnhanced)
+        inputs[iShower][kBDTMethod] = 2;
   }
 
-  if (fVarHolder.BoolVars["PandrizzleVarsFilled"])
+  for (unsigned int iShower = 0; iShower < showers.size(); ++iShower)
+    if (scoring[iShower].fBackup && !scoring[iShower].fEnhanced)
+      inputs[iShower][kBDTMethod] = 1;
+
+  this->ScoreBatch(fReader, inputs, scoring, kBackupPandrizzleScore,
+    [](const Scoring &s) { return s.fBackup; });
+
+  // If the enhanced score could be calculated return that, if not return the backup one
+  std::vector<Record> records;
+  records.reserve(showers.size());
+  for (unsigned int iShower = 0; iShower < showers.size(); ++iShower)
   {
-    SetVar(kdEdxBestPlane, fVarHolder.FloatVars["dEdxBestPlane"]);
-    SetVar(kDisplacement, fVarHolder.FloatVars["Displacement"]);
-    SetVar(kDCA, fVarHolder.FloatVars["DCA"]);
-    SetVar(kWideness, fVarHolder.FloatVars["Wideness"]);
-    SetVar(kEnergyDensity, fVarHolder.FloatVars["EnergyDensity"]);
+    const Scoring &s(scoring[iShower]);
+    InputVars &showerInputs(inputs[iShower]);
+    if (s.fEnhanced)
+      records.emplace_back(showerInputs, showerInputs[kEnhancedPandrizzleScore], true);
+    else if (s.fBackup)
+      records.emplace_back(showerInputs, showerInputs[kBackupPandrizzleScore], true);
+    else
+    {
+      Reset(showerInputs);
+      records.emplace_back(showerInputs, kDefValue, false);
+    }
   }
-  else
+
+  return records;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename Select>
+void FDSelection::PandrizzleAlg::ScoreBatch(bdt::BDTReader &reader, std::vector<InputVars> &inputs, const std::vector<Scoring> &scoring,
+  const Vars scoreVar, Select select)
+{
+  std::vector<unsigned int> indices;
+  std::vector<InputVars> samples;
+  for (unsigned int iShower = 0; iShower < inputs.size(); ++iShower)
   {
-    return ReturnEmptyRecord();
+    if (!select(scoring[iShower]))
+      continue;
+
+    indices.push_back(iShower);
+    samples.push_back(inputs[iShower]);
   }
 
+  if (samples.empty())
+    return;
+
+  std::vector<Double_t> scores(samples.size());
+  reader.EvaluateMVA("BDTG", fInputs.data(), kTerminatingValue, samples.front().data(), samples.size(), scores.data());
+
+  for (unsigned int iSample = 0; iSample < indices.size(); ++iSample)
+    inputs[indices[iSample]][scoreVar] = scores[iSample];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+FDSelection::PandrizzleAlg::Scoring FDSelection::PandrizzleAlg::FillInputs(const art::Ptr<recob::Shower> pShower, const art::Event& evt) 
+{
+  Scoring scoring;
+
+  art::Ptr<recob::PFParticle> pfp = dune_ana::DUNEAnaShowerUtils::GetPFParticle(pShower, evt, fShowerModuleLabel);
+
+  fVarHolder.BoolVars["MVAVarsFilled"] = false;
+  fVarHolder.BoolVars["PandrizzleVarsFilled"] = false;
+  fVarHolder.BoolVars["EnhancedPandrizzleVarsFilled"] = false;
+  fVarHolder.BoolVars["BackupPandrizzleVarsFilled"] = false;
+
+  Reset(fInputs);
+  ResetTreeVariables();
+  ProcessPFParticle(pfp, evt);
+
+  if (!fVarHolder.BoolVars["MVAVarsFilled"] || !fVarHolder.BoolVars["PandrizzleVarsFilled"])
+    return scoring;
+
+  SetVar(kEvalRatio, fVarHolder.FloatVars["EvalRatio"]);
+  SetVar(kConcentration, fVarHolder.FloatVars["Concentration"]);
+  SetVar(kCoreHaloRatio, fVarHolder.FloatVars["CoreHaloRatio"]);
+  SetVar(kConicalness, fVarHolder.FloatVars["Conicalness"]);
+
+  SetVar(kdEdxBestPlane, fVarHolder.FloatVars["dEdxBestPlane"]);
+  SetVar(kDisplacement, fVarHolder.FloatVars["Displacement"]);
+  SetVar(kDCA, fVarHolder.FloatVars["DCA"]);
+  SetVar(kWideness, fVarHolder.FloatVars["Wideness"]);
+  SetVar(kEnergyDensity, fVarHolder.FloatVars["EnergyDensity"]);
+
   std::vector<art::Ptr<recob::Hit>> allShowerHits(dune_ana::DUNEAnaPFParticleUtils::GetHits(pfp, evt, fClusterModuleLabel));
   const int nShowerHits = allShowerHits.size();
 
-  // Fill enhanced Pandrizzle scores...
+  // Enhanced Pandrizzle inputs...
   if (fUseBDTVariables && (nShowerHits > fEnhancedPandrizzleHitCut) && fVarHolder.BoolVars["EnhancedPandrizzleVarsFilled"])
   {
     SetVar(kPathwayLengthMin, fVarHolder.FloatVars["PathwayLengthMin"]);
@@ -1281,42 +1345,22 @@ FDSelection::PandrizzleAlg::Record FDSelection::PandrizzleAlg::RunPID(const art:
     SetVar(kMinLargestProjectedGapSize, fVarHolder.FloatVars["MinLargestProjectedGapSize"]);
     SetVar(kNViewsWithAmbiguousHits, fVarHolder.FloatVars["NViewsWithAmbiguousHits"]);
     SetVar(kAmbiguousHitMaxUnaccountedEnergy, fVarHolder.FloatVars["AmbiguousHitMaxUnaccountedEnergy"]);
-    SetVar(kEnhancedPandrizzleScore, fEnhancedReader.EvaluateMVA("BDTG"));
-    SetVar(kBDTMethod, 2);
+    scoring.fEnhanced = true;
   }
 
-  // Fill backup Pandrizzle scores...
+  // Backup Pandrizzle inputs, without them only an enhanced score can be returned
   if (fUseModularShowerVariables && (nShowerHits > fBackupPandrizzleHitCut))
   {
     if (!fVarHolder.BoolVars["BackupPandrizzleVarsFilled"])
-    {
-      // If cannot be calculated, return the correct reader
-      return (std::fabs(*fInputsToReader.at(kBDTMethod) - 2.f) < std::numeric_limits<float>::epsilon()) ? 
-        Record(fInputsToReader, *fInputsToReader.at(kEnhancedPandrizzleScore), true) : ReturnEmptyRecord();
-    }
+      return scoring;
 
     SetVar(kModularShowerPathwayLengthMin, fVarHolder.FloatVars["ModularShowerPathwayLengthMin"]);
     SetVar(kModularShowerMaxNuVertexChargeWeightedMeanRadialDistance, fVarHolder.FloatVars["ModularShowerMaxNuVertexChargeWeightedMeanRadialDistance"]);
     SetVar(kModularShowerMaxNShowerHits, fVarHolder.FloatVars["ModularShowerMaxNShowerHits"]);
   }
- 
-  if (!(std::fabs(*fInputsToReader.at(kBDTMethod) - 2.f) < std::numeric_limits<float>::epsilon()))
-      SetVar(kBDTMethod, 1);
-
-  SetVar(kBackupPandrizzleScore, fReader.EvaluateMVA("BDTG"));
-
-  // Make sure the correct score is returned...
-  // If enhanced is filled could be calculated return that, if not return backup...
-  return (std::fabs(*fInputsToReader.at(kBDTMethod) - 2.f) < std::numeric_limits<float>::epsilon()) ? 
-    Record(fInputsToReader, *fInputsToReader.at(kEnhancedPandrizzleScore), true) : Record(fInputsToReader, *fInputsToReader.at(kBackupPandrizzleScore), true);
-}
 
-////////////////////////////////////////////////////////////////////////////////////////////////
-
-FDSelection::PandrizzleAlg::Record FDSelection::PandrizzleAlg::ReturnEmptyRecord()
-{
-    Reset(fInputsToReader);
-    return Record(fInputsToReader, kDefValue, false);
+  scoring.fBackup = true;
+  return scoring;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
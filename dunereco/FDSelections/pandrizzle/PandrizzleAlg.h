@@ -28,18 +28,21 @@
 #include "lardataobj/RecoBase/PFParticle.h"
 #include "lardataobj/AnalysisBase/MVAPIDResult.h"
 #include "lardataobj/AnalysisBase/ParticleID.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 
 #include "Pandora/PandoraInternal.h"
 // c++
+#include <array>
 #include <map>
 #include <memory>
 #include <vector>
 
 // ROOT
-#include "TMVA/Reader.h"
+#include "dunereco/BDTRuntime/BDTReader.h"
 #include "TTree.h"
 
 namespace FDSelection
@@ -80,27 +83,34 @@ namespace FDSelection
         kTerminatingValue //terminates the enum and not an actual variable
       };
 
-      using InputVarsToReader = std::map<Vars, std::unique_ptr<Float_t>>;
+      /// The reader inputs, indexed by Vars
+      using InputVars = std::array<Float_t, kTerminatingValue>;
 
+      /// Plain copy of the inputs and the score of one shower, cheap to copy and compare
       class Record {
         public:
-          Record(const InputVarsToReader &inputVars, const Float_t mvaScore, const bool isFilled);
+          Record(const InputVars &inputVars, const Float_t mvaScore, const bool isFilled);
 
-          Float_t GetVar(const FDSelection::PandrizzleAlg::Vars var);
-          bool IsFilled();
-          Float_t GetMVAScore();
+          Float_t GetVar(const FDSelection::PandrizzleAlg::Vars var) const;
+          bool IsFilled() const;
+          Float_t GetMVAScore() const;
 
         private:
-          using InputVars = std::map<Vars, Float_t>;
           InputVars fInputs;
           Float_t fMVAScore;
           bool fIsFilled;
       };
 
       PandrizzleAlg(const fhicl::ParameterSet& pset);
+      /// The readers hold pointers into fInputs, so the alg must stay where it was made
+      PandrizzleAlg(const PandrizzleAlg&) = delete;
+      PandrizzleAlg& operator=(const PandrizzleAlg&) = delete;
 
       void Run(const art::Event& evt);
       Record RunPID(const art::Ptr<recob::Shower> pShower, const art::Event& evt);
+      /// Records of several showers, in the same order. The inputs are worked out
+      /// shower by shower and then scored with one call per BDT
+      std::vector<Record> RunPID(const std::vector<art::Ptr<recob::Shower>> &showers, const art::Event& evt);
 
       private:
       void InitialiseTrees();
@@ -122,20 +132,44 @@ namespace FDSelection
         const art::Event& evt);
       float GetShowerOpeningAngle(const geo::Vector_t &showerStart, const pandora::CartesianVector &fittedShowerDirection,
         pandora::CartesianPointVector &cartesianPointVector);
+
+      /// Pandora view positions, charges and views of the hits of a shower, one entry per hit
+      struct ProjectedHits
+      {
+        std::vector<double> fX;
+        std::vector<double> fZ;
+        std::vector<float> fCharge;
+        std::vector<geo::View_t> fView;
+      };
+
+      ProjectedHits ProjectHits(const std::vector<art::Ptr<recob::Hit>> &hits, const art::Event& evt);
       void GetShowerChargeDistributionVariables(const pandora::CartesianVector nuVertexPosition, const pandora::CartesianVector connectionPathwayDirection,
-        const pandora::CartesianVector &fittedShowerStart, const pandora::CartesianVector &fittedShowerDirection, std::vector<art::Ptr<recob::Hit>> &showerHits, float &nuVertexChargeAsymmetry,
-        float &showerStartChargeAsymmetry, float &nuVertexChargeWeightedMeanRadialDistance, float &showerStartMoliereRadius, const art::Event& evt);
+        const pandora::CartesianVector &fittedShowerStart, const pandora::CartesianVector &fittedShowerDirection, const ProjectedHits &projectedHits,
+        const std::vector<unsigned int> &showerHits, float &nuVertexChargeAsymmetry, float &showerStartChargeAsymmetry, float &nuVertexChargeWeightedMeanRadialDistance,
+        float &showerStartMoliereRadius);
       void FillTree();
       void ResetTreeVariables();
       double YZtoU(double y, double z);
       double YZtoV(double y, double z);
       double YZtoW(double y, double z);
       const geo::Vector_t GetPandoraHitPosition(art::Ptr<recob::Hit> pHit, const art::Event& evt);
+      const geo::Vector_t GetPandoraHitPosition(const recob::Hit &hit, const geo::GeometryCore &geometry, const detinfo::DetectorPropertiesData &detProp);
       const geo::View_t GetPandoraHitView(art::Ptr<recob::Hit> pHit);
 
       Float_t* GetVarPtr(const FDSelection::PandrizzleAlg::Vars var);
       void SetVar(const FDSelection::PandrizzleAlg::Vars var, const Float_t value);
-      Record ReturnEmptyRecord();
+      /// Which BDTs a shower is scored with
+      struct Scoring
+      {
+        bool fEnhanced = false;
+        bool fBackup = false;
+      };
+
+      /// Fill fInputs for the shower, the BDTs it can be scored with
+      Scoring FillInputs(const art::Ptr<recob::Shower> pShower, const art::Event& evt);
+      template <typename Select>
+      void ScoreBatch(bdt::BDTReader &reader, std::vector<InputVars> &inputs, const std::vector<Scoring> &scoring,
+        const Vars scoreVar, Select select);
 
       std::string fPFParticleModuleLabel;
       std::string fShowerModuleLabel;
@@ -145,9 +179,9 @@ namespace FDSelection
       std::string fPandrizzleWeightFileName;
       std::string fEnhancedPandrizzleWeightFileName;
 
-      TMVA::Reader fReader;
-      TMVA::Reader fEnhancedReader;
-      InputVarsToReader fInputsToReader;
+      bdt::BDTReader fReader;
+      bdt::BDTReader fEnhancedReader;
+      InputVars fInputs;
 
       // Tree things
       bool fMakeSelectionTrainingTrees;
@@ -183,35 +217,36 @@ namespace FDSelection
   };
 }
 
-Float_t FDSelection::PandrizzleAlg::Record::GetVar(const FDSelection::PandrizzleAlg::Vars var)
+inline FDSelection::PandrizzleAlg::Record::Record(const InputVars &inputVars, const Float_t mvaScore, const bool isFilled) :
+  fInputs(inputVars),
+  fMVAScore(mvaScore),
+  fIsFilled(isFilled)
+{
+}
+
+inline Float_t FDSelection::PandrizzleAlg::Record::GetVar(const FDSelection::PandrizzleAlg::Vars var) const
 {
-  return (fInputs.at(var));
+  return fInputs[var];
 }
 
-bool FDSelection::PandrizzleAlg::Record::IsFilled()
+inline bool FDSelection::PandrizzleAlg::Record::IsFilled() const
 {
   return fIsFilled;
 }
 
-Float_t FDSelection::PandrizzleAlg::Record::GetMVAScore()
+inline Float_t FDSelection::PandrizzleAlg::Record::GetMVAScore() const
 {
   return fMVAScore;
 }
 
-Float_t* FDSelection::PandrizzleAlg::GetVarPtr(const FDSelection::PandrizzleAlg::Vars var)
+inline Float_t* FDSelection::PandrizzleAlg::GetVarPtr(const FDSelection::PandrizzleAlg::Vars var)
 {
-  return fInputsToReader.at(var).get();
+  return &fInputs[var];
 }
 
-void FDSelection::PandrizzleAlg::SetVar(const FDSelection::PandrizzleAlg::Vars var, const Float_t value)
+inline void FDSelection::PandrizzleAlg::SetVar(const FDSelection::PandrizzleAlg::Vars var, const Float_t value)
 {
-  std::map<Vars, std::unique_ptr<Float_t> >::iterator itr(fInputsToReader.find(var));
-  if (itr != fInputsToReader.end())
-  {
-    *(itr->second.get()) = value;
-  }
-
-  return;
+  fInputs[var] = value;
 }
 
 #endif
@@ -1,6 +1,5 @@
 #include "HighestEnergyRecoVertexShowerSelector.h"
 #include "dunereco/AnaUtils/DUNEAnaShowerUtils.h"
-#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
 
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
@@ -19,26 +18,22 @@ FDSelectionTools::HighestEnergyRecoVertexShowerSelector::HighestEnergyRecoVertex
 
 art::Ptr<recob::Shower> FDSelectionTools::HighestEnergyRecoVertexShowerSelector::SelectShower(art::Event const & evt)
 {
-  art::Ptr<recob::Shower> selShower;
+  return SelectShower(NeutrinoChildShowers(evt, fPFParticleModuleLabel, fShowerModuleLabel), evt);
+}
 
-  if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
-    return selShower;
+/////////////////////////////////////////////////////////////////////////////////////////////
 
-  art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, fPFParticleModuleLabel);
+art::Ptr<recob::Shower> FDSelectionTools::HighestEnergyRecoVertexShowerSelector::SelectShower(std::vector<art::Ptr<recob::Shower>> const & candidates, art::Event const & evt)
+{
+  art::Ptr<recob::Shower> selShower;
 
   art::ServiceHandle<geo::Geometry> geom;
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
   double highestEnergy = -999.0;
 
-  for (art::Ptr<recob::PFParticle> childPFP : nuChildren) 
+  for (art::Ptr<recob::Shower> const & childShower : candidates) 
   {
-    if (!dune_ana::DUNEAnaPFParticleUtils::IsShower(childPFP, evt, fPFParticleModuleLabel, fShowerModuleLabel))
-      continue;
-
-    art::Ptr<recob::Shower> childShower = dune_ana::DUNEAnaPFParticleUtils::GetShower(childPFP, evt, fPFParticleModuleLabel, fShowerModuleLabel);
-
     std::map<int,double> showerEnergy;
 
     if (childShower->Energy().size() > 0)
@@ -48,6 +43,7 @@ art::Ptr<recob::Shower> FDSelectionTools::HighestEnergyRecoVertexShowerSelector:
     }
     else 
     {
+      art::Ptr<recob::PFParticle> childPFP = dune_ana::DUNEAnaShowerUtils::GetPFParticle(childShower, evt, fShowerModuleLabel);
       std::vector<art::Ptr<recob::Hit>> childHits = dune_ana::DUNEAnaPFParticleUtils::GetHits(childPFP, evt, fPFParticleModuleLabel);
 
       for (unsigned int plane = 0; plane < geom->MaxPlanes(); ++plane)
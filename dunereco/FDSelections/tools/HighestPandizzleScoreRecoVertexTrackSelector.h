@@ -26,6 +26,7 @@ namespace FDSelectionTools{
 
     private:
       art::Ptr<recob::Track> SelectTrack(art::Event const & evt) override;
+      art::Ptr<recob::Track> SelectTrack(std::vector<art::Ptr<recob::Track>> const & candidates, art::Event const & evt) override;
 
       std::string fTrackModuleLabel;
       std::string fPFParticleModuleLabel;
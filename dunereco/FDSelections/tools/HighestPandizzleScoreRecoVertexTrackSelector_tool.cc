@@ -1,6 +1,4 @@
 #include "HighestPandizzleScoreRecoVertexTrackSelector.h"
-#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
-#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
 
 FDSelectionTools::HighestPandizzleScoreRecoVertexTrackSelector::HighestPandizzleScoreRecoVertexTrackSelector(fhicl::ParameterSet const& ps) :
     fTrackModuleLabel(ps.get< std::string> ("ModuleLabels.TrackModuleLabel")),
@@ -13,31 +11,27 @@ FDSelectionTools::HighestPandizzleScoreRecoVertexTrackSelector::HighestPandizzle
 
 art::Ptr<recob::Track> FDSelectionTools::HighestPandizzleScoreRecoVertexTrackSelector::SelectTrack(art::Event const & evt)
 {
-  art::Ptr<recob::Track> selTrack;
+  return SelectTrack(NeutrinoChildTracks(evt, fPFParticleModuleLabel, fTrackModuleLabel), evt);
+}
 
-  if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
-    return selTrack;
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, fPFParticleModuleLabel);
+art::Ptr<recob::Track> FDSelectionTools::HighestPandizzleScoreRecoVertexTrackSelector::SelectTrack(std::vector<art::Ptr<recob::Track>> const & candidates, art::Event const & evt)
+{
+  art::Ptr<recob::Track> selTrack;
 
-  // Loop over primaries, get the associated track and then find that with the highest pandizzle score
+  // All candidates are scored with one BDT call, then the highest pandizzle score is taken
+  const std::vector<FDSelection::PandizzleAlg::Record> pandizzleRecords(fPandizzleAlg.RunPID(candidates, evt));
   double highestPandizzleScore(std::numeric_limits<double>::lowest());
 
-  for (art::Ptr<recob::PFParticle> childPFP : nuChildren) 
+  for (unsigned int iTrack = 0; iTrack < candidates.size(); ++iTrack)
   {
-    if (!dune_ana::DUNEAnaPFParticleUtils::IsTrack(childPFP, evt, fPFParticleModuleLabel, fTrackModuleLabel))
-      continue;
-
-    art::Ptr<recob::Track> childTrack = dune_ana::DUNEAnaPFParticleUtils::GetTrack(childPFP, evt, fPFParticleModuleLabel, fTrackModuleLabel);
-
-    FDSelection::PandizzleAlg::Record pandizzleRecord(fPandizzleAlg.RunPID(childTrack, evt));
-    const double pandizzleScore = pandizzleRecord.GetMVAScore();
+    const double pandizzleScore = pandizzleRecords[iTrack].GetMVAScore();
 
     if (pandizzleScore > highestPandizzleScore)
     {
         highestPandizzleScore = pandizzleScore;
-        selTrack = childTrack;
+        selTrack = candidates[iTrack];
     }
   }
 
@@ -23,6 +23,7 @@ namespace FDSelectionTools{
 
     private:
       art::Ptr<recob::Shower> SelectShower(art::Event const & evt) override;
+      art::Ptr<recob::Shower> SelectShower(std::vector<art::Ptr<recob::Shower>> const & candidates, art::Event const & evt) override;
 
       std::string fShowerModuleLabel;
       std::string fPFParticleModuleLabel;
@@ -1,6 +1,4 @@
 #include "HighestPandrizzleScoreRecoVertexShowerSelector.h"
-#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
-#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
 
 FDSelectionTools::HighestPandrizzleScoreRecoVertexShowerSelector::HighestPandrizzleScoreRecoVertexShowerSelector(fhicl::ParameterSet const& ps) :
     fShowerModuleLabel(ps.get< std::string> ("ModuleLabels.ShowerModuleLabel")),
@@ -12,42 +10,41 @@ FDSelectionTools::HighestPandrizzleScoreRecoVertexShowerSelector::HighestPandriz
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 art::Ptr<recob::Shower> FDSelectionTools::HighestPandrizzleScoreRecoVertexShowerSelector::SelectShower(art::Event const & evt)
+{
+  return SelectShower(NeutrinoChildShowers(evt, fPFParticleModuleLabel, fShowerModuleLabel), evt);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+art::Ptr<recob::Shower> FDSelectionTools::HighestPandrizzleScoreRecoVertexShowerSelector::SelectShower(std::vector<art::Ptr<recob::Shower>> const & candidates, art::Event const & evt)
 {
   art::Ptr<recob::Shower> selShower;
   art::Ptr<recob::Shower> backupSelShower;
 
-  if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
-    return selShower;
-
-  art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, fPFParticleModuleLabel);
+  // All candidates are scored with one call per BDT
+  const std::vector<FDSelection::PandrizzleAlg::Record> pandrizzleRecords(fPandrizzleAlg.RunPID(candidates, evt));
 
   double highestEnhancedPandrizzleScore = std::numeric_limits<double>::lowest();
   double highestBackupPandrizzleScore = std::numeric_limits<double>::lowest();
   bool found = false;
 
-  for (art::Ptr<recob::PFParticle> childPFP : nuChildren) 
+  for (unsigned int iShower = 0; iShower < candidates.size(); ++iShower) 
   {
-    if (!dune_ana::DUNEAnaPFParticleUtils::IsShower(childPFP, evt, fPFParticleModuleLabel, fShowerModuleLabel))
-      continue;
-
-    art::Ptr<recob::Shower> childShower = dune_ana::DUNEAnaPFParticleUtils::GetShower(childPFP, evt, fPFParticleModuleLabel, fShowerModuleLabel);
-
-    FDSelection::PandrizzleAlg::Record pandrizzleRecord(fPandrizzleAlg.RunPID(childShower, evt));
+    const FDSelection::PandrizzleAlg::Record &pandrizzleRecord(pandrizzleRecords[iShower]);
     float pandrizzleBDTMethod = pandrizzleRecord.GetVar(FDSelection::PandrizzleAlg::kBDTMethod);
     double pandrizzleScore = pandrizzleRecord.GetMVAScore();
 
     if ((std::fabs(pandrizzleBDTMethod - 2.0) < std::numeric_limits<float>::epsilon()) && (pandrizzleScore > highestEnhancedPandrizzleScore))
     {
         highestEnhancedPandrizzleScore = pandrizzleScore;
-        selShower = childShower;
+        selShower = candidates[iShower];
         found = true;
     }
 
     if ((std::fabs(pandrizzleBDTMethod - 1.0) < std::numeric_limits<float>::epsilon()) && (pandrizzleScore > highestBackupPandrizzleScore))
     {
         highestBackupPandrizzleScore = pandrizzleScore;
-        backupSelShower = childShower;
+        backupSelShower = candidates[iShower];
     }
   }
 
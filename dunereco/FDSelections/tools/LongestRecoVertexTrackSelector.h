@@ -22,6 +22,8 @@ namespace FDSelectionTools{
 
     private:
       art::Ptr<recob::Track> SelectTrack(art::Event const & evt) override;
+      art::Ptr<recob::Track> SelectTrack(std::vector<art::Ptr<recob::Track>> const & candidates, art::Event const & evt) override;
+      art::Ptr<recob::Track> SelectTrackWithContext(FDSelection::EventContext const & context) override;
       std::string fTrackModuleLabel;
       std::string fPFParticleModuleLabel;
   };
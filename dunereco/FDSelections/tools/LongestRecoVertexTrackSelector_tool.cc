@@ -1,9 +1,5 @@
 #include "LongestRecoVertexTrackSelector.h"
 
-#include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
-#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
-#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
-
 FDSelectionTools::LongestRecoVertexTrackSelector::LongestRecoVertexTrackSelector(fhicl::ParameterSet const& ps) :
   fTrackModuleLabel(ps.get< std::string> ("ModuleLabels.TrackModuleLabel")),
   fPFParticleModuleLabel(ps.get< std::string> ("ModuleLabels.PFParticleModuleLabel"))
@@ -14,23 +10,19 @@ FDSelectionTools::LongestRecoVertexTrackSelector::LongestRecoVertexTrackSelector
 
 art::Ptr<recob::Track> FDSelectionTools::LongestRecoVertexTrackSelector::SelectTrack(art::Event const & evt)
 {
-  art::Ptr<recob::Track> selTrack;
+  return SelectTrack(NeutrinoChildTracks(evt, fPFParticleModuleLabel, fTrackModuleLabel), evt);
+}
 
-  if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, fPFParticleModuleLabel))
-    return selTrack;
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, fPFParticleModuleLabel);
-  std::vector<art::Ptr<recob::PFParticle>> nuChildren = dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, fPFParticleModuleLabel);
+art::Ptr<recob::Track> FDSelectionTools::LongestRecoVertexTrackSelector::SelectTrack(std::vector<art::Ptr<recob::Track>> const & candidates, art::Event const & evt)
+{
+  art::Ptr<recob::Track> selTrack;
 
   double longestLength = -999.0;
 
-  for (art::Ptr<recob::PFParticle> childPFP : nuChildren) 
+  for (art::Ptr<recob::Track> const & childTrack : candidates) 
   {
-    if (!dune_ana::DUNEAnaPFParticleUtils::IsTrack(childPFP, evt, fPFParticleModuleLabel, fTrackModuleLabel))
-      continue;
-
-    art::Ptr<recob::Track> childTrack = dune_ana::DUNEAnaPFParticleUtils::GetTrack(childPFP, evt, fPFParticleModuleLabel, fTrackModuleLabel);
-
     double childTrackLength = childTrack->Length();
 
     if (childTrackLength > longestLength)
@@ -42,3 +34,14 @@ art::Ptr<recob::Track> FDSelectionTools::LongestRecoVertexTrackSelector::SelectT
 
   return selTrack;
 }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+art::Ptr<recob::Track> FDSelectionTools::LongestRecoVertexTrackSelector::SelectTrackWithContext(FDSelection::EventContext const & context)
+{
+  // The context only holds the associations of its own labels
+  if ((context.PFParticleLabel() != fPFParticleModuleLabel) || (context.TrackLabel() != fTrackModuleLabel))
+    return SelectTrack(context.Event());
+
+  return SelectTrack(NeutrinoChildTracks(context), context.Event());
+}
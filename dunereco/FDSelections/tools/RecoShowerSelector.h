@@ -3,6 +3,8 @@
 
 //STL
 #include <iostream>
+#include <string>
+#include <vector>
 
 //ART
 #include "art/Framework/Principal/Handle.h"
@@ -11,13 +13,55 @@
 //LARSOFT
 #include "lardataobj/RecoBase/Shower.h"
 
+//DUNE
+#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/FDSelections/FDSelectionEventContext.h"
+
 namespace FDSelectionTools{
   class RecoShowerSelector {
     public:
       virtual ~RecoShowerSelector() noexcept = default;
       art::Ptr<recob::Shower> FindSelectedShower(art::Event const & evt) { return SelectShower(evt); };
+      /// Selection from the products the calling module has already fetched for this event
+      art::Ptr<recob::Shower> FindSelectedShower(FDSelection::EventContext const & context) { return SelectShowerWithContext(context); };
+      /// Selection among the given candidates, which are all looked at before the choice is made
+      art::Ptr<recob::Shower> FindSelectedShower(std::vector<art::Ptr<recob::Shower>> const & candidates, art::Event const & evt) { return SelectShower(candidates, evt); };
+    protected:
+      /// The showers of the primary daughters of the reconstructed neutrino, the usual candidates
+      static std::vector<art::Ptr<recob::Shower>> NeutrinoChildShowers(art::Event const & evt, std::string const & pfpLabel, std::string const & showerLabel);
+      static std::vector<art::Ptr<recob::Shower>> NeutrinoChildShowers(FDSelection::EventContext const & context);
     private:
       virtual art::Ptr<recob::Shower> SelectShower(art::Event const & evt) = 0;
+      virtual art::Ptr<recob::Shower> SelectShower(std::vector<art::Ptr<recob::Shower>> const & candidates, art::Event const & evt) = 0;
+      virtual art::Ptr<recob::Shower> SelectShowerWithContext(FDSelection::EventContext const & context) { return SelectShower(context.Event()); };
   };
+
+  inline std::vector<art::Ptr<recob::Shower>> RecoShowerSelector::NeutrinoChildShowers(art::Event const & evt, std::string const & pfpLabel, std::string const & showerLabel)
+  {
+    std::vector<art::Ptr<recob::Shower>> showers;
+    if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, pfpLabel))
+      return showers;
+
+    art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, pfpLabel);
+    for (art::Ptr<recob::PFParticle> const & childPFP : dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, pfpLabel))
+    {
+      if (dune_ana::DUNEAnaPFParticleUtils::IsShower(childPFP, evt, pfpLabel, showerLabel))
+        showers.push_back(dune_ana::DUNEAnaPFParticleUtils::GetShower(childPFP, evt, pfpLabel, showerLabel));
+    }
+    return showers;
+  }
+
+  inline std::vector<art::Ptr<recob::Shower>> RecoShowerSelector::NeutrinoChildShowers(FDSelection::EventContext const & context)
+  {
+    std::vector<art::Ptr<recob::Shower>> showers;
+    for (art::Ptr<recob::PFParticle> const & childPFP : context.NeutrinoChildren())
+    {
+      art::Ptr<recob::Shower> const & childShower(context.GetShower(childPFP));
+      if (childShower.isNonnull())
+        showers.push_back(childShower);
+    }
+    return showers;
+  }
 }
 #endif
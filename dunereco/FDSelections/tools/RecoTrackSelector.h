@@ -3,6 +3,8 @@
 
 //STL
 #include <iostream>
+#include <string>
+#include <vector>
 
 //ART
 #include "art/Framework/Principal/Handle.h"
@@ -12,13 +14,55 @@
 //LARSOFT
 #include "lardataobj/RecoBase/Track.h"
 
+//DUNE
+#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/FDSelections/FDSelectionEventContext.h"
+
 namespace FDSelectionTools{
   class RecoTrackSelector {
     public:
       virtual ~RecoTrackSelector() noexcept = default;
       art::Ptr<recob::Track> FindSelectedTrack(art::Event const & evt) { return SelectTrack(evt); };
+      /// Selection from the products the calling module has already fetched for this event
+      art::Ptr<recob::Track> FindSelectedTrack(FDSelection::EventContext const & context) { return SelectTrackWithContext(context); };
+      /// Selection among the given candidates, which are all looked at before the choice is made
+      art::Ptr<recob::Track> FindSelectedTrack(std::vector<art::Ptr<recob::Track>> const & candidates, art::Event const & evt) { return SelectTrack(candidates, evt); };
+    protected:
+      /// The tracks of the primary daughters of the reconstructed neutrino, the usual candidates
+      static std::vector<art::Ptr<recob::Track>> NeutrinoChildTracks(art::Event const & evt, std::string const & pfpLabel, std::string const & trackLabel);
+      static std::vector<art::Ptr<recob::Track>> NeutrinoChildTracks(FDSelection::EventContext const & context);
     private:
       virtual art::Ptr<recob::Track> SelectTrack(art::Event const & evt) = 0;
+      virtual art::Ptr<recob::Track> SelectTrack(std::vector<art::Ptr<recob::Track>> const & candidates, art::Event const & evt) = 0;
+      virtual art::Ptr<recob::Track> SelectTrackWithContext(FDSelection::EventContext const & context) { return SelectTrack(context.Event()); };
   };
+
+  inline std::vector<art::Ptr<recob::Track>> RecoTrackSelector::NeutrinoChildTracks(art::Event const & evt, std::string const & pfpLabel, std::string const & trackLabel)
+  {
+    std::vector<art::Ptr<recob::Track>> tracks;
+    if (!dune_ana::DUNEAnaEventUtils::HasNeutrino(evt, pfpLabel))
+      return tracks;
+
+    art::Ptr<recob::PFParticle> nuPFP = dune_ana::DUNEAnaEventUtils::GetNeutrino(evt, pfpLabel);
+    for (art::Ptr<recob::PFParticle> const & childPFP : dune_ana::DUNEAnaPFParticleUtils::GetChildParticles(nuPFP, evt, pfpLabel))
+    {
+      if (dune_ana::DUNEAnaPFParticleUtils::IsTrack(childPFP, evt, pfpLabel, trackLabel))
+        tracks.push_back(dune_ana::DUNEAnaPFParticleUtils::GetTrack(childPFP, evt, pfpLabel, trackLabel));
+    }
+    return tracks;
+  }
+
+  inline std::vector<art::Ptr<recob::Track>> RecoTrackSelector::NeutrinoChildTracks(FDSelection::EventContext const & context)
+  {
+    std::vector<art::Ptr<recob::Track>> tracks;
+    for (art::Ptr<recob::PFParticle> const & childPFP : context.NeutrinoChildren())
+    {
+      art::Ptr<recob::Track> const & childTrack(context.GetTrack(childPFP));
+      if (childTrack.isNonnull())
+        tracks.push_back(childTrack);
+    }
+    return tracks;
+  }
 }
 #endif
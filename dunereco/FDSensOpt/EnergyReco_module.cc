@@ -15,7 +15,7 @@
 //ROOT
 //ART
 #include "art/Framework/Core/ModuleMacros.h"
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -35,22 +35,23 @@
 #include "dunereco/FDSensOpt/NeutrinoEnergyRecoAlg/NeutrinoEnergyRecoAlg.h"
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaHitUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
 #include "dunereco/AnaUtils/DUNEAnaShowerUtils.h"
 
 namespace dune {
 
-    class EnergyReco : public art::EDProducer {
+    class EnergyReco : public art::SharedProducer {
 
         public:
 
-            explicit EnergyReco(fhicl::ParameterSet const& pset);
-            void produce(art::Event& evt) override;
+            explicit EnergyReco(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
+            void produce(art::Event& evt, art::ProcessingFrame const&) override;
 
         private:
-            art::Ptr<recob::Track> GetLongestTrack(const art::Event& event);
+            art::Ptr<recob::Track> GetLongestTrack(const art::Event& event) const;
             art::Ptr<recob::Shower> GetHighestChargeShower(detinfo::DetectorClocksData const& clockData,
                                                            detinfo::DetectorPropertiesData const& detProp,
-                                                           const art::Event& event);
+                                                           const art::Event& event) const;
 
             std::string fWireLabel;
             std::string fHitLabel;
@@ -63,14 +64,18 @@ namespace dune {
             int fRecoMethod;
             int fLongestTrackMethod;
 
+            // Forwards the energies of an earlier pass made with the same configuration
+            dune_ana::DUNEAnaProductReuse fReuse;
 
+
+            // Keeps no per-event state, so the events can share it
             NeutrinoEnergyRecoAlg fNeutrinoEnergyRecoAlg;
     }; // class EnergyReco
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
 
-EnergyReco::EnergyReco(fhicl::ParameterSet const& pset) :
-    EDProducer(pset),
+EnergyReco::EnergyReco(fhicl::ParameterSet const& pset, art::ProcessingFrame const&) :
+    SharedProducer(pset),
     fWireLabel(pset.get<std::string>("WireLabel")),
     fHitLabel(pset.get<std::string>("HitLabel")),
     fTrackLabel(pset.get<std::string>("TrackLabel")),
@@ -80,42 +85,58 @@ EnergyReco::EnergyReco(fhicl::ParameterSet const& pset) :
     fHitToSpacePointLabel(pset.get<std::string>("HitToSpacePointLabel")),
     fRecoMethod(pset.get<int>("RecoMethod")),
     fLongestTrackMethod(pset.get<int>("LongestTrackMethod")),
+    fReuse(pset),
     fNeutrinoEnergyRecoAlg(pset.get<fhicl::ParameterSet>("NeutrinoEnergyRecoAlg"),fTrackLabel,fShowerLabel,
         fHitLabel,fWireLabel,fTrackToHitLabel,fShowerToHitLabel,fHitToSpacePointLabel)
 {
+    fReuse.AddInput<std::vector<recob::Hit>>(fHitLabel);
+    fReuse.AddInput<std::vector<recob::Track>>(fTrackLabel);
+    fReuse.AddInput<std::vector<recob::Shower>>(fShowerLabel);
+
     produces<dune::EnergyRecoOutput>();
     produces<art::Assns<dune::EnergyRecoOutput, recob::Track>>();
     produces<art::Assns<dune::EnergyRecoOutput, recob::Shower>>();
+
+    async<art::InEvent>();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
 
-void EnergyReco::produce(art::Event& evt)
+void EnergyReco::produce(art::Event& evt, art::ProcessingFrame const&)
 {
+    // Energies of an earlier pass with the same configuration are forwarded
+    if (fReuse.Matches<dune::EnergyRecoOutput>(evt))
+    {
+        fReuse.Forward<dune::EnergyRecoOutput>(evt);
+        fReuse.ForwardAssns<dune::EnergyRecoOutput, recob::Track, dune::EnergyRecoOutput>(evt);
+        fReuse.ForwardAssns<dune::EnergyRecoOutput, recob::Shower, dune::EnergyRecoOutput>(evt);
+        return;
+    }
+
     std::unique_ptr<dune::EnergyRecoOutput> energyRecoOutput;
     auto assnstrk = std::make_unique<art::Assns<dune::EnergyRecoOutput, recob::Track>>();
     auto assnsshw = std::make_unique<art::Assns<dune::EnergyRecoOutput, recob::Shower>>();
 
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(evt, clockData);
+    // One context per event, so the detector data are read once for the shower choice and the energy
+    const NeutrinoEnergyRecoAlg::EventContext context(fNeutrinoEnergyRecoAlg, evt);
     art::Ptr<recob::Track> longestTrack(this->GetLongestTrack(evt));
-    art::Ptr<recob::Shower> highestChargeShower(this->GetHighestChargeShower(clockData, detProp, evt));
+    art::Ptr<recob::Shower> highestChargeShower(this->GetHighestChargeShower(context.GetClockData(), context.GetDetProp(), evt));
 
     if (fRecoMethod == 1)
     {
         if (fLongestTrackMethod == 0 || !longestTrack.isAvailable() || longestTrack.isNull())
-            energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(longestTrack, evt));
+            energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(longestTrack, context));
         else if (fLongestTrackMethod == 1)
-            energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergyViaMuonRanging(longestTrack, evt));
+            energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergyViaMuonRanging(longestTrack, context));
         else if (fLongestTrackMethod == 2)
         {
-            energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergyViaMuonMCS(longestTrack, evt));
+            energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergyViaMuonMCS(longestTrack, context));
         }
     }
     else if (fRecoMethod == 2)
-        energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(highestChargeShower, evt));
+        energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(highestChargeShower, context));
     else if (fRecoMethod == 3)
-        energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(evt));
+        energyRecoOutput = std::make_unique<dune::EnergyRecoOutput>(fNeutrinoEnergyRecoAlg.CalculateNeutrinoEnergy(context));
 
     art::ProductID const prodId = evt.getProductID<dune::EnergyRecoOutput>();
     art::EDProductGetter const* prodGetter = evt.productGetter(prodId);
@@ -129,7 +150,7 @@ void EnergyReco::produce(art::Event& evt)
 
 //-----------------------------------------------------------------------------------------------------------------------------------------
 
-art::Ptr<recob::Track> EnergyReco::GetLongestTrack(const art::Event &event)
+art::Ptr<recob::Track> EnergyReco::GetLongestTrack(const art::Event &event) const
 {
     art::Ptr<recob::Track> pTrack{};
     const std::vector<art::Ptr<recob::Track> > tracks(dune_ana::DUNEAnaEventUtils::GetTracks(event, fTrackLabel));
@@ -160,7 +181,7 @@ art::Ptr<recob::Track> EnergyReco::GetLongestTrack(const art::Event &event)
 
 art::Ptr<recob::Shower> EnergyReco::GetHighestChargeShower(detinfo::DetectorClocksData const& clockData,
                                                            detinfo::DetectorPropertiesData const& detProp,
-                                                           const art::Event &event)
+                                                           const art::Event &event) const
 {
     art::Ptr<recob::Shower> pShower{};
     const std::vector<art::Ptr<recob::Shower> > showers(dune_ana::DUNEAnaEventUtils::GetShowers(event, fShowerLabel));
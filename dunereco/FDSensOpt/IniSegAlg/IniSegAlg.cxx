@@ -11,26 +11,53 @@
 // framework libraries
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
+#include "cetlib_except/exception.h"
 
 // ROOT libraries
 #include "TMath.h"
 
 // C/C++ libraries
 #include <memory>
+#include <numeric>
 
-dunefd::Hit2D::Hit2D(TVector2 point2d, size_t key) :
+dunefd::Hit2D::Hit2D(TVector2 const & point2d, size_t key) :
+fPoint(dune_ana::Vec2::From(point2d)),
+fKey(key)
+{
+}
+
+dunefd::Hit2D::Hit2D(dune_ana::Vec2 const & point2d, size_t key) :
 fPoint(point2d),
 fKey(key)
 {
 }
 
-dunefd::IniSegAlg::IniSegAlg(std::map<size_t, std::vector<dunefd::Hit2D> > clusters) :
-fClusters(clusters),
+dunefd::IniSegAlg::IniSegAlg(std::map<size_t, std::vector<dunefd::Hit2D> > const & clusters) :
 fRadius(10.0),
 fDistVtxCl(0.0F),
 fThrcos(0.9),
 fCos(0.0F)
 {
+	for (auto const & cl: clusters)
+	{
+		fClusterKeys.push_back(cl.first);
+		fClusterBegin.push_back(fHits.size());
+		fHits.insert(fHits.end(), cl.second.begin(), cl.second.end());
+	}
+	fClusterBegin.push_back(fHits.size());
+}
+
+dunefd::IniSegAlg::IniSegAlg(std::vector<dunefd::Hit2D> hits, std::vector<size_t> clusterKeys, std::vector<size_t> clusterBegin) :
+fHits(std::move(hits)),
+fClusterKeys(std::move(clusterKeys)),
+fClusterBegin(std::move(clusterBegin)),
+fRadius(10.0),
+fDistVtxCl(0.0F),
+fThrcos(0.9),
+fCos(0.0F)
+{
+	if (fClusterBegin.size() != fClusterKeys.size() + 1)
+		throw cet::exception("IniSegAlg") << "cluster offsets do not match the cluster keys";
 }
 
 dunefd::IniSegAlg::IniSegAlg(std::vector< art::Ptr<recob::Track> > const & tracks, TVector3 const & mcvtx) :
@@ -46,8 +73,8 @@ fCos(-9999.0F)
 
 void dunefd::IniSegAlg::FeedwithMc(TVector2 const & vtx, TVector2 const & dir, TVector3 const & dir3d)
 {
-	fMcVtx = vtx;
-	fDir = dir;
+	fMcVtx = dune_ana::Vec2::From(vtx);
+	fDir = dune_ana::Vec2::From(dir);
 	fDir3d = dir3d;
 	FindClustersInRad();
 	SortLess();
@@ -62,34 +89,52 @@ void dunefd::IniSegAlg::FeedwithMc(TVector3 const & dir3d)
 
 void dunefd::IniSegAlg::FindClustersInRad()
 {
-	for (auto& cl: fClusters)
-		for (size_t h = 0; h < cl.second.size(); ++h)
-			if (pma::Dist2(fMcVtx, cl.second[h].GetPointCm()) < fRadius*fRadius)
+	// distances are needed again for the sorting, work them out once
+	fDist2.resize(fHits.size());
+	for (size_t h = 0; h < fHits.size(); ++h)
+		fDist2[h] = dune_ana::Dist2(fMcVtx, fHits[h].GetPoint());
+
+	fSelIdx.clear();
+	for (size_t c = 0; c < fClusterKeys.size(); ++c)
+		for (size_t h = fClusterBegin[c]; h < fClusterBegin[c+1]; ++h)
+			if (fDist2[h] < fRadius*fRadius)
 			{
-				fSelCls[cl.first] = cl.second;
+				fSelIdx.push_back(c);
 				break;
 			}
 }
 
 void dunefd::IniSegAlg::SortLess()
 {
-	for (auto& cl: fSelCls)
-		std::sort(cl.second.begin(), cl.second.end(), bDistCentLess2D(fMcVtx));
+	// sort hit indices by the precomputed distances, only the selected
+	// clusters are copied out
+	std::vector<size_t> order;
+	for (size_t c: fSelIdx)
+	{
+		order.resize(fClusterBegin[c+1] - fClusterBegin[c]);
+		std::iota(order.begin(), order.end(), fClusterBegin[c]);
+		std::sort(order.begin(), order.end(),
+			[this](size_t a, size_t b) { return fDist2[a] < fDist2[b]; });
+
+		std::vector<dunefd::Hit2D> & cl = fSelCls[fClusterKeys[c]];
+		cl.reserve(order.size());
+		for (size_t h: order) cl.push_back(fHits[h]);
+	}
 }
 
-TVector2 dunefd::IniSegAlg::ClusterDir(std::vector< Hit2D > const & hits)
+dune_ana::Vec2 dunefd::IniSegAlg::ClusterDir(std::vector< Hit2D > const & hits)
 {
-	TVector2 p1 = hits[0].GetPointCm();
+	dune_ana::Vec2 const & p1 = hits[0].GetPoint();
 	size_t id = 0;
 	for (size_t i = 0; i < hits.size(); ++i)
-		if (pma::Dist2(hits[0].GetPointCm(), hits[i].GetPointCm()) < 1.0)
+		if (dune_ana::Dist2(p1, hits[i].GetPoint()) < 1.0)
 		{
 			id = i; 
 		}
 		else break;
 
-	TVector2 p2 = hits[id].GetPointCm(); 
-	TVector2 dir = (p2 - p1) * (1 / (p2 - p1).Mod());
+	dune_ana::Vec2 const & p2 = hits[id].GetPoint(); 
+	dune_ana::Vec2 dir = (p2 - p1) * (1 / (p2 - p1).Mag());
 
 	return dir;	
 }
@@ -97,24 +142,28 @@ TVector2 dunefd::IniSegAlg::ClusterDir(std::vector< Hit2D > const & hits)
 void dunefd::IniSegAlg::FindCluster()
 {
 	double maxcos = 0;
-	std::map<size_t, std::vector<dunefd::Hit2D> > chosen;
-	for (auto& cl: fSelCls)
-		if (cl.second.size() > 2)
+	auto best = fSelCls.end();
+	for (auto it = fSelCls.begin(); it != fSelCls.end(); ++it)
+		if (it->second.size() > 2)
 		{
-			TVector2 dir = ClusterDir(cl.second);
-			double cos = fDir * dir;
+			dune_ana::Vec2 dir = ClusterDir(it->second);
+			double cos = fDir.Dot(dir);
 			if (cos > maxcos) 
 			{
 				maxcos = cos;
-				chosen[cl.first] = cl.second;
-				fCl.clear();
-				fCl = cl.second;
-				fDistVtxCl = std::sqrt(pma::Dist2(fCl[0].GetPointCm(), fMcVtx));
+				best = it;
 			}
 		}
 
-	fSelCls.clear();
-	fSelCls = chosen;
+	// copy the winner once, rather than on every improvement
+	std::map<size_t, std::vector<dunefd::Hit2D> > chosen;
+	if (best != fSelCls.end())
+	{
+		fCl = best->second;
+		fDistVtxCl = std::sqrt(dune_ana::Dist2(fCl[0].GetPoint(), fMcVtx));
+		chosen[best->first] = std::move(best->second);
+	}
+	fSelCls = std::move(chosen);
 }
 
 void dunefd::IniSegAlg::Find3dTrack()
@@ -14,6 +14,8 @@
 #include "larreco/RecoAlg/PMAlg/Utilities.h"
 #include "lardataobj/RecoBase/Track.h"
 
+#include "dunereco/AnaUtils/DUNEAnaVector.h"
+
 namespace fhicl {
 	class ParameterSet;
 }
@@ -27,12 +29,14 @@ namespace dunefd {
 class dunefd::Hit2D
 {
 	public:
-	Hit2D(TVector2 point2d, size_t key);
-	TVector2 const & GetPointCm(void) const { return fPoint;}
+	Hit2D(TVector2 const & point2d, size_t key);
+	Hit2D(dune_ana::Vec2 const & point2d, size_t key);
+	TVector2 GetPointCm(void) const { return fPoint.ToROOT(); }
+	dune_ana::Vec2 const & GetPoint(void) const { return fPoint; }
 	size_t const & GetKey(void) const { return fKey; }
 
 	private:
-	TVector2 fPoint;
+	dune_ana::Vec2 fPoint;
 	size_t fKey;
 };
 
@@ -43,7 +47,10 @@ class dunefd::Hit2D
 class dunefd::IniSegAlg
 {
 	public:
-	IniSegAlg(std::map<size_t, std::vector<dunefd::Hit2D> > clusters); 
+	IniSegAlg(std::map<size_t, std::vector<dunefd::Hit2D> > const & clusters); 
+	// clusters as one flat hit array: cluster c is keyed clusterKeys[c] and
+	// holds hits[clusterBegin[c]] ... hits[clusterBegin[c+1] - 1]
+	IniSegAlg(std::vector<dunefd::Hit2D> hits, std::vector<size_t> clusterKeys, std::vector<size_t> clusterBegin); 
 	IniSegAlg(std::vector< art::Ptr<recob::Track> > const & tracks, TVector3 const & mcvtx); 
 
 	void FeedwithMc(TVector2 const & vtx, TVector2 const & dir, TVector3 const & dir3d);
@@ -64,9 +71,13 @@ class dunefd::IniSegAlg
 
 	void Find3dTrack();
 
-	TVector2 ClusterDir(std::vector< Hit2D > const & hits);
+	dune_ana::Vec2 ClusterDir(std::vector< Hit2D > const & hits);
 
-	std::map<size_t, std::vector<dunefd::Hit2D> > fClusters;
+	std::vector<dunefd::Hit2D> fHits;
+	std::vector<size_t> fClusterKeys;
+	std::vector<size_t> fClusterBegin;
+	std::vector<double> fDist2; // squared distance of each hit to the vertex
+	std::vector<size_t> fSelIdx; // clusters in fRadius, indices to fClusterKeys
 	std::map<size_t, std::vector<dunefd::Hit2D> > fSelCls;
 	//
 
@@ -80,9 +91,9 @@ class dunefd::IniSegAlg
 	
 	//
 	std::vector< dunefd::Hit2D > fCl;
-	TVector2 fMcVtx;
+	dune_ana::Vec2 fMcVtx;
 	TVector3 fMcVtx3d;
-	TVector2 fDir;
+	dune_ana::Vec2 fDir;
 
 	float fRadius;
 	float fDistVtxCl;
@@ -97,18 +108,18 @@ class dunefd::bDistCentLess2D :
 	public std::binary_function< Hit2D, Hit2D, bool >
 	{
 		public:
-		bDistCentLess2D(const TVector2& c) : center(c) {}
+		bDistCentLess2D(const TVector2& c) : center(dune_ana::Vec2::From(c)) {}
 
-		bool operator() (Hit2D p1, Hit2D p2)
+		bool operator() (Hit2D const & p1, Hit2D const & p2) const
 		{
-			double dist1 = pma::Dist2(p1.GetPointCm(), center);
-			double dist2 = pma::Dist2(p2.GetPointCm(), center);
+			double dist1 = dune_ana::Dist2(p1.GetPoint(), center);
+			double dist2 = dune_ana::Dist2(p2.GetPoint(), center);
 
 			return dist1 < dist2;
 		}
 
 		private:
-		TVector2 center; 
+		dune_ana::Vec2 center; 
 	};
 
 #endif //IniSegAlg_h
@@ -42,6 +42,9 @@
 #include <memory>
 #include <utility>
 #include <fstream>
+#include <map>
+
+#include "tbb/parallel_for.h"
 namespace dunefd {
 	class IniSegReco;
 	class Hit2D;
@@ -85,9 +88,16 @@ private:
         void collectCls(art::Event const & evt,
                         detinfo::DetectorPropertiesData const& detProp,
                         art::Ptr<simb::MCTruth> const mctruth);
-	std::vector< dunefd::Hit2D > reselectCls(std::map<size_t, std::vector< dunefd::Hit2D > > const & cls, 
-																					art::Ptr<simb::MCTruth> const mctruth,
-																					const size_t cryo, const size_t tpc, const size_t plane) const;
+	// cluster hits of one plane as a flat array, in the layout IniSegAlg takes
+	struct ViewClusters
+	{
+		size_t cryo, tpc, plane;
+		std::vector< dunefd::Hit2D > hits;
+		std::vector< size_t > keys;
+		std::vector< size_t > begin;
+	};
+	std::vector< dunefd::Hit2D > reselectCls(ViewClusters const & cls, 
+																					art::Ptr<simb::MCTruth> const mctruth) const;
         void make3dseg(art::Event const & evt,
                        detinfo::DetectorPropertiesData const& detProp,
                        std::vector< std::vector<Hit2D> > const & src, TVector3 const & primary);
@@ -669,61 +679,76 @@ void dunefd::IniSegReco::collectCls(art::Event const & evt,
    		art::fill_ptr_vector(clusterlist, clusterListHandle);
 		art::FindManyP< recob::Hit > hc(clusterListHandle, evt, fClusterModuleLabel);		
 
-                for (auto const& tpcg : geom->Iterate<geo::TPCGeo>())
+		// one view per plane, in the geometry order
+		std::vector< ViewClusters > views;
+		std::vector< size_t > tpcFirstView;
+		std::map< geo::PlaneID, size_t > viewIndex;
+		for (auto const& tpcg : geom->Iterate<geo::TPCGeo>())
 		{
-                        auto const [c, t] = std::make_pair(tpcg.ID().Cryostat, tpcg.ID().TPC);
-				std::vector< std::vector< dunefd::Hit2D > > clinput;
-                        for (size_t p = 0; p < tpcg.Nplanes(); ++p)
-				{	
-					std::map<size_t, std::vector< dunefd::Hit2D > > cls; 
-					for (size_t i = 0; i < clusterlist.size(); ++i)
-					{
-						std::vector< art::Ptr<recob::Hit> > hitscl;
-						std::vector< Hit2D > hits2dcl;
-						hitscl = hc.at(i);
-					
-						bool found = false;
-						for (size_t h = 0; h < hitscl.size(); ++h)
-						{
-							size_t wire = hitscl[h]->WireID().Wire;
-							size_t plane = hitscl[h]->WireID().Plane;
-							size_t tpc = hitscl[h]->WireID().TPC;
-							size_t cryo = hitscl[h]->WireID().Cryostat;
-
-
-                                                if (cryo == c && tpc == t && plane == p)
-							{
-								found = true;
-                                                                TVector2 point = pma::WireDriftToCm(detProp, wire, hitscl[h]->PeakTime(), plane, tpc, cryo);
-								Hit2D hit2d(point, hitscl[h].key());
-								hits2dcl.push_back(hit2d);
-							}
-						}
-
-						if (found) cls[i] = hits2dcl;
-					}
+			tpcFirstView.push_back(views.size());
+			for (size_t p = 0; p < tpcg.Nplanes(); ++p)
+			{
+				viewIndex[geo::PlaneID(tpcg.ID(), p)] = views.size();
+				views.push_back(ViewClusters{tpcg.ID().Cryostat, tpcg.ID().TPC, p, {}, {}, {}});
+			}
+		}
+		tpcFirstView.push_back(views.size());
 
-					if (cls.size())
-							clinput.push_back(reselectCls(cls, mctruth, c, t, p));							
-				}
+		// a single pass sorts the cluster hits into their views; clusters come
+		// in index order, so each one is contiguous in every view it touches
+		for (size_t i = 0; i < clusterlist.size(); ++i)
+		{
+			std::vector< art::Ptr<recob::Hit> > const & hitscl = hc.at(i);
+			for (size_t h = 0; h < hitscl.size(); ++h)
+			{
+				geo::WireID const & wireid = hitscl[h]->WireID();
+				auto v = viewIndex.find(wireid.asPlaneID());
+				if (v == viewIndex.end()) continue;
 
-				if (clinput.size() > 1)
+				ViewClusters & view = views[v->second];
+				if (view.keys.empty() || (view.keys.back() != i))
 				{
-					const TLorentzVector& pvtx = mctruth->GetNeutrino().Nu().Position();
-					TVector3 primary(pvtx.X(), pvtx.Y(), pvtx.Z());
-                                        make3dseg(evt, detProp, clinput, primary);
+					view.keys.push_back(i);
+					view.begin.push_back(view.hits.size());
 				}
+				TVector2 point = pma::WireDriftToCm(detProp, wireid.Wire, hitscl[h]->PeakTime(), wireid.Plane, wireid.TPC, wireid.Cryostat);
+				view.hits.emplace_back(point, hitscl[h].key());
+			}
 		}
+		for (auto & view : views) view.begin.push_back(view.hits.size());
 
+		// the views are independent, select their clusters in parallel
+		std::vector< std::vector< dunefd::Hit2D > > selected(views.size());
+		tbb::parallel_for(size_t(0), views.size(), [&](size_t v)
+		{
+			if (views[v].keys.size())
+				selected[v] = reselectCls(views[v], mctruth);
+		});
+
+		for (size_t t = 0; t + 1 < tpcFirstView.size(); ++t)
+		{
+			std::vector< std::vector< dunefd::Hit2D > > clinput;
+			for (size_t v = tpcFirstView[t]; v < tpcFirstView[t+1]; ++v)
+				if (views[v].keys.size())
+					clinput.push_back(std::move(selected[v]));
+
+			if (clinput.size() > 1)
+			{
+				const TLorentzVector& pvtx = mctruth->GetNeutrino().Nu().Position();
+				TVector3 primary(pvtx.X(), pvtx.Y(), pvtx.Z());
+				make3dseg(evt, detProp, clinput, primary);
+			}
+		}
 	}		
 }
 
 /***********************************************************************/
 
-std::vector< dunefd::Hit2D > dunefd::IniSegReco::reselectCls(std::map<size_t, std::vector< dunefd::Hit2D > > const & cls, art::Ptr<simb::MCTruth> const mctruth, const size_t cryo, const size_t tpc, const size_t plane) const
+std::vector< dunefd::Hit2D > dunefd::IniSegReco::reselectCls(ViewClusters const & cls, art::Ptr<simb::MCTruth> const mctruth) const
 {
 	std::vector< dunefd::Hit2D > cluster;
-	if (!cls.size()) return cluster;
+	if (!cls.keys.size()) return cluster;
+	const size_t cryo = cls.cryo, tpc = cls.tpc, plane = cls.plane;
 
 	const simb::MCParticle& particle = mctruth->GetNeutrino().Nu();
 	const TLorentzVector& pvtx = particle.Position();
@@ -737,7 +762,7 @@ std::vector< dunefd::Hit2D > dunefd::IniSegReco::reselectCls(std::map<size_t, st
 		TVector2 mcdir2d = getMCdir2d(mcvtx3d, mcdir3d, cryo, tpc, plane);
 		
 		// reco: find the best clusters to proceed with segment reconstruction
-		IniSegAlg recoini(cls); 
+		IniSegAlg recoini(cls.hits, cls.keys, cls.begin); 
 		recoini.FeedwithMc(mcvtx2d, mcdir2d, mcdir3d);
 		cluster = recoini.GetCl();
 	}
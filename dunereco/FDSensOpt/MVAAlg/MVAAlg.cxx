@@ -22,7 +22,7 @@
 
 //--------------------------------------------------------------------------------
 dunemva::MVAAlg::MVAAlg( fhicl::ParameterSet const& p )
-  : fReader("")
+  : fReader(p.get<bool>("UseCompiledBDT", true), "")
     , fCalorimetryAlg (p.get<fhicl::ParameterSet>("CalorimetryAlg"))
     , fMakeAnaTree    (p.get<bool>("MakeAnaTree"))
     , fMakeWeightTree (p.get<bool>("MakeWeightTree"))
@@ -31,47 +31,52 @@ dunemva::MVAAlg::MVAAlg( fhicl::ParameterSet const& p )
   this->reconfigure(p);
   if(fMakeAnaTree) this->MakeTree();
 
+  // The vertex, track and truth blocks decide the fiducial volume and the
+  // sample type of every event. The inputs add their own blocks below
+  fRequiredBlocks = kTruthBlock | kVertexBlock | kTrackBlock;
+  if(!fScoringOnly || fMakeAnaTree || fMakeWeightTree) fRequiredBlocks = kAllBlocks;
+
   fFile.open("events.txt"); // for displaying selected events
 
   if(!fMakeWeightTree){
 
     // branch, name, unit, type
-    fReader.AddVariable("evtcharge", &evtcharge);
-    fReader.AddVariable("ntrack", &ntrack);
-    fReader.AddVariable("maxtrklength", &maxtrklength);
-    fReader.AddVariable("avgtrklength", &avgtrklength);
-    fReader.AddVariable("trkdedx", &trkdedx);
-    fReader.AddVariable("trkrch", &trkrch);
-    fReader.AddVariable("trkrt", &trkrt);
-    fReader.AddVariable("trkfr", &trkfr);
-    fReader.AddVariable("trkpida", &trkpida_save);
-    fReader.AddVariable("fract_5_wires", &fract_5_wires);
-    fReader.AddVariable("fract_10_wires", &fract_10_wires);
-    fReader.AddVariable("fract_50_wires", &fract_50_wires);
-    fReader.AddVariable("fract_100_wires", &fract_100_wires);
-    fReader.AddVariable("trkcosx", &trkcosx);
-    fReader.AddVariable("trkcosy", &trkcosy);
-    fReader.AddVariable("trkcosz", &trkcosz);
-    fReader.AddVariable("ET", &ET);
+    this->AddInput("evtcharge", &evtcharge);
+    this->AddInput("ntrack", &ntrack);
+    this->AddInput("maxtrklength", &maxtrklength);
+    this->AddInput("avgtrklength", &avgtrklength);
+    this->AddInput("trkdedx", &trkdedx);
+    this->AddInput("trkrch", &trkrch);
+    this->AddInput("trkrt", &trkrt);
+    this->AddInput("trkfr", &trkfr);
+    this->AddInput("trkpida", &trkpida_save);
+    this->AddInput("fract_5_wires", &fract_5_wires);
+    this->AddInput("fract_10_wires", &fract_10_wires);
+    this->AddInput("fract_50_wires", &fract_50_wires);
+    this->AddInput("fract_100_wires", &fract_100_wires);
+    this->AddInput("trkcosx", &trkcosx);
+    this->AddInput("trkcosy", &trkcosy);
+    this->AddInput("trkcosz", &trkcosz);
+    this->AddInput("ET", &ET);
 
     // Nice to plot and verify sig/back sample composition
-    //fReader.AddVariable("ccnc", &ccnc);
-    //fReader.AddVariable("NuPdg", &NuPdg); // must be floats
+    //this->AddInput("ccnc", &ccnc);
+    //this->AddInput("NuPdg", &NuPdg); // must be floats
 
     if(fSelect=="nue"){
-      fReader.AddVariable("nshower", &nshower);
-      fReader.AddVariable("showerdedx", &showerdedx);
-      fReader.AddVariable("eshower", &eshower);
-      fReader.AddVariable("frshower", &frshower);
-      fReader.AddVariable("nhitspershw", &nhitspershw);
-      fReader.AddVariable("shwlength", &shwlength);
-      fReader.AddVariable("shwmax", &shwmax);
-      fReader.AddVariable("shwdisx", &shwdisx);
-      fReader.AddVariable("shwdisy", &shwdisy);
-      fReader.AddVariable("shwdisz", &shwdisz);
-      fReader.AddVariable("shwcosx", &shwcosx);
-      fReader.AddVariable("shwcosy", &shwcosy);
-      fReader.AddVariable("shwcosz", &shwcosz);
+      this->AddInput("nshower", &nshower);
+      this->AddInput("showerdedx", &showerdedx);
+      this->AddInput("eshower", &eshower);
+      this->AddInput("frshower", &frshower);
+      this->AddInput("nhitspershw", &nhitspershw);
+      this->AddInput("shwlength", &shwlength);
+      this->AddInput("shwmax", &shwmax);
+      this->AddInput("shwdisx", &shwdisx);
+      this->AddInput("shwdisy", &shwdisy);
+      this->AddInput("shwdisz", &shwdisz);
+      this->AddInput("shwcosx", &shwcosx);
+      this->AddInput("shwcosy", &shwcosy);
+      this->AddInput("shwcosz", &shwcosz);
     }
 
 
@@ -287,6 +292,57 @@ void dunemva::MVAAlg::reconfigure(fhicl::ParameterSet const& p){
   fSelect                 =   p.get< std::string >("Select");
   fBeamMode               =   p.get< std::string >("BeamMode","FHC");
   fFidVolCut              =   p.get< double      >("FidVolCut");
+  fScoringOnly            =   p.get< bool        >("ScoringOnly", false);
+}
+
+//--------------------------------------------------------------------------------
+unsigned int dunemva::MVAAlg::InputBlocks(const std::string& name){
+
+  // What CalculateInputs reads to get each input on top of the vertex,
+  // track and truth blocks
+  static const std::map<std::string, unsigned int> blocks = {
+    {"evtcharge",       kHitBlock},
+    {"ntrack",          0},
+    {"maxtrklength",    0},
+    {"avgtrklength",    0},
+    {"trkcosx",         0},
+    {"trkcosy",         0},
+    {"trkcosz",         0},
+    {"trkdedx",         kCalorimetryBlock},
+    {"trkpida",         kCalorimetryBlock},
+    {"trkrch",          kHitBlock},
+    {"trkrt",           kHitBlock},
+    {"trkfr",           kHitBlock},
+    {"ET",              kShowerBlock | kCalorimetryBlock},
+    {"nshower",         kShowerBlock},
+    {"showerdedx",      kShowerBlock},
+    {"eshower",         kShowerBlock},
+    {"shwdis",          kShowerBlock},
+    {"shwdisx",         kShowerBlock},
+    {"shwdisy",         kShowerBlock},
+    {"shwdisz",         kShowerBlock},
+    {"shwcosx",         kShowerBlock},
+    {"shwcosy",         kShowerBlock},
+    {"shwcosz",         kShowerBlock},
+    {"frshower",        kShowerBlock | kHitBlock},
+    {"nhitspershw",     kShowerBlock | kHitBlock},
+    {"shwlength",       kShowerBlock | kHitBlock},
+    {"shwmax",          kShowerBlock | kHitBlock},
+    {"fract_5_wires",   kShowerBlock | kHitBlock},
+    {"fract_10_wires",  kShowerBlock | kHitBlock},
+    {"fract_50_wires",  kShowerBlock | kHitBlock},
+    {"fract_100_wires", kShowerBlock | kHitBlock}
+  };
+
+  auto it = blocks.find(name);
+  return it == blocks.end() ? kAllBlocks : it->second;
+}
+
+//--------------------------------------------------------------------------------
+void dunemva::MVAAlg::AddInput(const std::string& name, float* address){
+
+  fReader.AddVariable(name, address);
+  fRequiredBlocks |= InputBlocks(name);
 }
 
 //--------------------------------------------------------------------------------
@@ -1127,10 +1183,6 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   //std::cout << " ~~~~~~~~~~~~~~~ MVA: Getting Event Reco ~~~~~~~~~~~~~~ " << std::endl;
 
-  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
-  art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
-  const sim::ParticleList& plist = pi_serv->ParticleList();
-
   run = evt.run();
   subrun = evt.subRun();
   event = evt.id().event();
@@ -1142,22 +1194,23 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
   taulife = detProp.ElectronLifetime();
   isdata = evt.isRealData();
 
-  // * Raw Digits
-  std::vector<art::Ptr<raw::RawDigit> > rawlist;
-  auto rawListHandle = evt.getHandle<std::vector<raw::RawDigit> >(fRawDigitModuleLabel);
-  if (rawListHandle)
-    art::fill_ptr_vector(rawlist, rawListHandle);
+  // The truth matching services are only asked for when their blocks are filled
+  const bool backtrack = !isdata && this->Needs(kBackTrackerBlock);
+  cheat::BackTrackerService* bt_serv = backtrack ? art::ServiceHandle<cheat::BackTrackerService>().get() : nullptr;
+  cheat::ParticleInventoryService* pi_serv = backtrack ? art::ServiceHandle<cheat::ParticleInventoryService>().get() : nullptr;
 
   // * wires
   std::vector<art::Ptr<recob::Wire>> wirelist;
-  auto wireListHandle = evt.getHandle< std::vector<recob::Wire>>(fWireModuleLabel);
-  if (wireListHandle)
-    art::fill_ptr_vector(wirelist, wireListHandle);
+  if (this->Needs(kWireBlock)){
+    auto wireListHandle = evt.getHandle< std::vector<recob::Wire>>(fWireModuleLabel);
+    if (wireListHandle)
+      art::fill_ptr_vector(wirelist, wireListHandle);
+  }
 
-  // * hits
+  // * hits, the handle is still needed for the hit associations
   std::vector<art::Ptr<recob::Hit> > hitlist;
   auto hitListHandle = evt.getHandle< std::vector<recob::Hit> >(fHitsModuleLabel);
-  if (hitListHandle)
+  if (hitListHandle && this->Needs(kHitBlock))
     art::fill_ptr_vector(hitlist, hitListHandle);
 
   // * tracks
@@ -1174,15 +1227,20 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   // * showers
   std::vector<art::Ptr<recob::Shower>> shwlist;
-  auto shwListHandle = evt.getHandle<std::vector<recob::Shower>>(fShowerModuleLabel);
-  if (shwListHandle)
-    art::fill_ptr_vector(shwlist, shwListHandle);
+  art::Handle<std::vector<recob::Shower>> shwListHandle;
+  if (this->Needs(kShowerBlock)){
+    shwListHandle = evt.getHandle<std::vector<recob::Shower>>(fShowerModuleLabel);
+    if (shwListHandle)
+      art::fill_ptr_vector(shwlist, shwListHandle);
+  }
 
   // * flashes
   std::vector<art::Ptr<recob::OpFlash> > flashlist;
-  auto flashListHandle = evt.getHandle< std::vector<recob::OpFlash> >(fFlashModuleLabel);
-  if (flashListHandle)
-    art::fill_ptr_vector(flashlist, flashListHandle);
+  if (this->Needs(kFlashBlock)){
+    auto flashListHandle = evt.getHandle< std::vector<recob::OpFlash> >(fFlashModuleLabel);
+    if (flashListHandle)
+      art::fill_ptr_vector(flashlist, flashListHandle);
+  }
 
   // * associations
   art::FindManyP<recob::Hit> fmth(trackListHandle, evt, fTrackModuleLabel);
@@ -1193,6 +1251,10 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
   // charge from raw digits
   rawcharge = 0;
   /* Comment for now as it is too slow
+     std::vector<art::Ptr<raw::RawDigit> > rawlist;
+     auto rawListHandle = evt.getHandle<std::vector<raw::RawDigit> >(fRawDigitModuleLabel);
+     if (rawListHandle)
+     art::fill_ptr_vector(rawlist, rawListHandle);
      for (size_t i = 0; i<rawlist.size(); ++i){
      if (fGeom->SignalType(rawlist[i]->Channel()) == geo::kCollection){
      double pedestal = rawlist[i]->GetPedestal();
@@ -1258,7 +1320,8 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
     trkenddcosy[i]    = larEnd.Y();
     trkenddcosz[i]    = larEnd.Z();
     trklen[i]         = tracklist[i]->Length();
-    if (fmthm.isValid()){
+    // the per hit calorimetry is skipped when only the track keys are needed
+    if (this->Needs(kTrackHitMetaBlock) && fmthm.isValid()){
       auto vhit = fmthm.at(i);
       auto vmeta = fmthm.data(i);
       for (size_t h = 0; h < vhit.size(); ++h){
@@ -1280,7 +1343,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
         }
       }
     }
-    if (fmcal.isValid()){
+    if (this->Needs(kCalorimetryBlock) && fmcal.isValid()){
       unsigned maxnumhits = 0;
       std::vector<const anab::Calorimetry*> calos = fmcal.at(i);
       for (auto const& calo : calos){
@@ -1303,7 +1366,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
         }
       }
     }
-    if (!isdata&&fmth.isValid()){
+    if (backtrack&&fmth.isValid()){
       // Find true track for each reconstructed track
       int TrackID = 0;
       std::vector< art::Ptr<recob::Hit> > allHits = fmth.at(i);
@@ -1452,7 +1515,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
           }
         }
       }
-      if (!isdata&&fmsh.isValid()){
+      if (backtrack&&fmsh.isValid()){
         // Find true track for each reconstructed track
         int TrackID = 0;
         std::vector< art::Ptr<recob::Hit> > allHits = fmsh.at(i);
@@ -1609,10 +1672,13 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
     std::vector<const simb::MCParticle* > geant_part;
 
     // ### Looping over all the Geant4 particles from the BackTrackerService ###
-    for(size_t p = 0; p < plist.size(); ++p) 
-    {
-      // ### Filling the vector with MC Particles ###
-      geant_part.push_back(plist.Particle(p)); 
+    if (this->Needs(kGeantBlock)){
+      const sim::ParticleList& plist = art::ServiceHandle<cheat::ParticleInventoryService>()->ParticleList();
+      for(size_t p = 0; p < plist.size(); ++p) 
+      {
+        // ### Filling the vector with MC Particles ###
+        geant_part.push_back(plist.Particle(p)); 
+      }
     }
 
     //std::cout<<"No of geant part= "<<geant_part.size()<<std::endl;
@@ -1807,8 +1873,9 @@ void dunemva::MVAAlg::ResetVars(){
     trkg4id[i] = -9999;
   }
 
+  // the large arrays are only reset when their block is filled
   flash_total = 0;
-  for (int f = 0; f < kMaxFlash; ++f) {
+  for (int f = 0; f < kMaxFlash && this->Needs(kFlashBlock); ++f) {
     flash_time[f]    = -9999;
     flash_width[f]   = -9999;
     flash_abstime[f] = -9999;
@@ -1821,7 +1888,7 @@ void dunemva::MVAAlg::ResetVars(){
 
   nhits = 0;
   nhits_stored = 0;
-  for (int i = 0; i<kMaxHits; ++i){
+  for (int i = 0; i<kMaxHits && this->Needs(kHitBlock); ++i){
     hit_plane[i] = -9999;
     hit_wire[i] = -9999;
     hit_tpc[i] = -9999;
@@ -1875,7 +1942,7 @@ void dunemva::MVAAlg::ResetVars(){
 
   no_primaries = -99999;
   geant_list_size=-9999;
-  for (int i = 0; i<kMaxPrimaries; ++i){
+  for (int i = 0; i<kMaxPrimaries && this->Needs(kGeantBlock); ++i){
     pdg[i] = -99999;
     Eng[i] = -99999;
     Px[i] = -99999;
@@ -25,7 +25,7 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 
-#include "TMVA/Reader.h"
+#include "dunereco/BDTRuntime/BDTReader.h"
 #include "TTimeStamp.h"
 #include "TH1D.h"
 #include "TFile.h"
@@ -131,13 +131,35 @@ namespace dunemva{
 
     private:
 
+      /// Parts of the event model filled by PrepareEvent. In scoring-only
+      /// mode a part is only filled when a reader input depends on it
+      enum EventBlock : unsigned int {
+        kHitBlock          = 1u << 0,  ///< hit arrays
+        kTrackBlock        = 1u << 1,  ///< track arrays and hit_trkkey
+        kTrackHitMetaBlock = 1u << 2,  ///< hit_dQds, hit_dEds and hit_resrange
+        kCalorimetryBlock  = 1u << 3,  ///< trkke, trkpida and trkbestplane
+        kShowerBlock       = 1u << 4,  ///< shower arrays and hit_shwkey
+        kVertexBlock       = 1u << 5,  ///< vertex arrays
+        kTruthBlock        = 1u << 6,  ///< MCTruth and MCFlux information
+        kWireBlock         = 1u << 7,  ///< wirecharge
+        kFlashBlock        = 1u << 8,  ///< flash arrays
+        kBackTrackerBlock  = 1u << 9,  ///< geant matching of tracks and showers
+        kGeantBlock        = 1u << 10, ///< geant particle list
+        kAllBlocks         = (1u << 11) - 1
+      };
+
+      /// Blocks the reader input with this name is calculated from
+      static unsigned int InputBlocks(const std::string& name);
+      bool  Needs(unsigned int blocks) const { return (fRequiredBlocks & blocks) == blocks; }
+      void  AddInput(const std::string& name, float* address);
+
       void  PrepareEvent(const art::Event& event);
       void  MakeTree();
       void  CalculateInputs();
 
       std::ofstream fFile;
 
-      TMVA::Reader fReader;
+      bdt::BDTReader fReader;
       std::string fMVAMethod;
       std::string fWeightFile;
 
@@ -147,6 +169,11 @@ namespace dunemva{
       std::string fSelect;
       std::string fBeamMode;
 
+      /// Only fill the parts of the event model the reader inputs need.
+      /// rawcharge, wirecharge and the truth matching are then left unset
+      bool fScoringOnly;
+      unsigned int fRequiredBlocks;
+
       // ~~~~~~~~~~~~~~ from NuEAna: ~~~~~~~~~~~~~~~~
 
       void ResetVars();
@@ -42,13 +42,34 @@ NeutrinoAngularRecoAlg::NeutrinoAngularRecoAlg(fhicl::ParameterSet const& pset,
     fShowerToHitLabel(showerToHitLabel),
     fHitToSpacePointLabel(hitToSpacePointLabel),
     fCalorimetryLabel(pset.get<std::string>("CalorimetryLabel")),
-    fDistanceToWallThreshold(pset.get<float>("DistanceToWallThreshold"))
+    fDistanceToWallThreshold(pset.get<float>("DistanceToWallThreshold")),
+    fContainedMinX(std::numeric_limits<double>::max()),
+    fContainedMaxX(std::numeric_limits<double>::lowest()),
+    fContainedMinY(std::numeric_limits<double>::max()),
+    fContainedMaxY(std::numeric_limits<double>::lowest()),
+    fContainedMinZ(std::numeric_limits<double>::max()),
+    fContainedMaxZ(std::numeric_limits<double>::lowest())
 {
+    art::ServiceHandle<geo::Geometry> fGeometry;
+    for (geo::TPCGeo const& tpc: fGeometry->Iterate<geo::TPCGeo>()) {
+        fContainedMinX = std::min(fContainedMinX,tpc.MinX());
+        fContainedMaxX = std::max(fContainedMaxX,tpc.MaxX());
+        fContainedMinY = std::min(fContainedMinY,tpc.MinY());
+        fContainedMaxY = std::max(fContainedMaxY,tpc.MaxY());
+        fContainedMinZ = std::min(fContainedMinZ,tpc.MinZ());
+        fContainedMaxZ = std::max(fContainedMaxZ,tpc.MaxZ());
+    } // for all TPC
+    fContainedMinX += fDistanceToWallThreshold;
+    fContainedMaxX -= fDistanceToWallThreshold;
+    fContainedMinY += fDistanceToWallThreshold;
+    fContainedMaxY -= fDistanceToWallThreshold;
+    fContainedMinZ += fDistanceToWallThreshold;
+    fContainedMaxZ -= fDistanceToWallThreshold;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event)
+dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const
 {
     if (!pMuonTrack.isAvailable() || pMuonTrack.isNull())
     {
@@ -75,7 +96,7 @@ dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art::Ptr<recob::Shower> &pElectronShower, 
-    const art::Event &event)
+    const art::Event &event) const
 {
     if (!pElectronShower.isAvailable() || pElectronShower.isNull())
     {
@@ -102,7 +123,7 @@ dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art
 dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const std::vector<art::Ptr<recob::Track>> &pTracks,
                                                                        const std::map<art::Ptr<recob::Track>, int> &tracksPID,
                                                                        const std::vector<art::Ptr<recob::Shower>> &pShowers,
-                                                                       const art::Event &event)
+                                                                       const art::Event &event) const
 {
     //Using all the reco particles to determine the angle
     Point_t vertex(0,0,0); //No meaning vertex value is filled with this method
@@ -134,7 +155,7 @@ dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art
                                                                        const std::vector<art::Ptr<recob::Track>> &pTracks,
                                                                        const std::map<art::Ptr<recob::Track>, int> &tracksPID,
                                                                        const std::vector<art::Ptr<recob::Shower>> &pShowers,
-                                                                       const art::Event &event)
+                                                                       const art::Event &event) const
 {
     //Using all the reco particles to determine the angle, but using the longest track as muon
     Point_t vertex(0,0,0); //No meaning vertex value is filled with this method
@@ -175,7 +196,7 @@ dune::AngularRecoOutput NeutrinoAngularRecoAlg::CalculateNeutrinoAngle(const art
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 
-dune::AngularRecoOutput NeutrinoAngularRecoAlg::ReturnNeutrinoAngle(const AngularRecoInputHolder &angularRecoInputHolder)
+dune::AngularRecoOutput NeutrinoAngularRecoAlg::ReturnNeutrinoAngle(const AngularRecoInputHolder &angularRecoInputHolder) const
 {
     dune::AngularRecoOutput output;
     output.recoMethodUsed = angularRecoInputHolder.fAngularRecoMethod;
@@ -212,10 +233,8 @@ Momentum_t NeutrinoAngularRecoAlg::ComputeTracksMomentum(const std::vector<art::
 
     for(uint iTrack = 0; iTrack < pTracks.size(); iTrack++){
         const art::Ptr<recob::Track> &pTrack = pTracks[iTrack];
-        int pid = 0;
-        if (tracksPID.count(pTrack) == 1){
-            pid = tracksPID.at(pTrack);
-        }
+        const auto pidIter = tracksPID.find(pTrack);
+        const int pid = (pidIter != tracksPID.end()) ? pidIter->second : 0;
 
         float momentum_norm = 0;
 
@@ -276,27 +295,9 @@ float NeutrinoAngularRecoAlg::GetTrackKE(const std::vector<art::Ptr<anab::Calori
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 bool NeutrinoAngularRecoAlg::IsTrackContained(const art::Ptr<recob::Track> &pTrack) const {
-    art::ServiceHandle<geo::Geometry> fGeometry;
-    double minX(std::numeric_limits<double>::max());
-    double maxX(std::numeric_limits<double>::lowest());
-    double minY(std::numeric_limits<double>::max());
-    double maxY(std::numeric_limits<double>::lowest());
-    double minZ(std::numeric_limits<double>::max());
-    double maxZ(std::numeric_limits<double>::lowest());
-    for (geo::TPCGeo const& tpc: fGeometry->Iterate<geo::TPCGeo>()) {
-        minX = std::min(minX,tpc.MinX());
-        maxX = std::max(maxX,tpc.MaxX());
-        minY = std::min(minY,tpc.MinY());
-        maxY = std::max(maxY,tpc.MaxY());
-        minZ = std::min(minZ,tpc.MinZ());
-        maxZ = std::max(maxZ,tpc.MaxZ());
-    } // for all TPC
-    minX += fDistanceToWallThreshold;
-    maxX -= fDistanceToWallThreshold;
-    minY += fDistanceToWallThreshold;
-    maxY -= fDistanceToWallThreshold;
-    minZ += fDistanceToWallThreshold;
-    maxZ -= fDistanceToWallThreshold;
+    const double minX(fContainedMinX), maxX(fContainedMaxX);
+    const double minY(fContainedMinY), maxY(fContainedMaxY);
+    const double minZ(fContainedMinZ), maxZ(fContainedMaxZ);
 
     TVector3 start = pTrack->Start<TVector3>();
     TVector3 end = pTrack->End<TVector3>();
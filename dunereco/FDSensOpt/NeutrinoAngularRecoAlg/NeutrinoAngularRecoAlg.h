@@ -29,6 +29,8 @@ namespace dune
  *
  * @brief NeutrinoAngularRecoAlg class
  *
+ * The calculations are const. The contained volume is worked out from the TPCs once, in the constructor.
+ *
 */
 class NeutrinoAngularRecoAlg 
 {
@@ -57,7 +59,7 @@ class NeutrinoAngularRecoAlg
         *
         * @return the neutrino direction summary object
         */
-        dune::AngularRecoOutput CalculateNeutrinoAngle(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event);
+        dune::AngularRecoOutput CalculateNeutrinoAngle(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const;
 
         /**
         * @brief  Calculates neutrino angle using an electron shower 
@@ -67,7 +69,7 @@ class NeutrinoAngularRecoAlg
         *
         * @return the neutrino direction summary object
         */
-        dune::AngularRecoOutput CalculateNeutrinoAngle(const art::Ptr<recob::Shower> &pElectronShower, const art::Event &event);
+        dune::AngularRecoOutput CalculateNeutrinoAngle(const art::Ptr<recob::Shower> &pElectronShower, const art::Event &event) const;
 
         /**
         * @brief  Calculates neutrino angle using all the tracks and showers
@@ -80,7 +82,7 @@ class NeutrinoAngularRecoAlg
         dune::AngularRecoOutput CalculateNeutrinoAngle(const std::vector<art::Ptr<recob::Track>> &pTracks,
                                                        const std::map<art::Ptr<recob::Track>, int> &tracksPID,
                                                        const std::vector<art::Ptr<recob::Shower>> &pShowers,
-                                                       const art::Event &event);
+                                                       const art::Event &event) const;
 
         /**
         * @brief  Calculates neutrino angle using all the tracks and showers, assuming the longest track is a muon
@@ -94,7 +96,7 @@ class NeutrinoAngularRecoAlg
                                                        const std::vector<art::Ptr<recob::Track>> &pTracks,
                                                        const std::map<art::Ptr<recob::Track>, int> &tracksPID,
                                                        const std::vector<art::Ptr<recob::Shower>> &pShowers,
-                                                       const art::Event &event);
+                                                       const art::Event &event) const;
 
 
 
@@ -141,7 +143,7 @@ class NeutrinoAngularRecoAlg
         *
         * @return AngularRecoOutput 
         */
-        dune::AngularRecoOutput ReturnNeutrinoAngle(const AngularRecoInputHolder &angularRecoInputHolder);
+        dune::AngularRecoOutput ReturnNeutrinoAngle(const AngularRecoInputHolder &angularRecoInputHolder) const;
 
         Momentum_t ComputeShowersMomentum(const std::vector<art::Ptr<recob::Shower>> &pShowers) const;
         Momentum_t ComputeTracksMomentum(const std::vector<art::Ptr<recob::Track>> &pTracks,
@@ -162,6 +164,12 @@ class NeutrinoAngularRecoAlg
         std::string fHitToSpacePointLabel;                       ///< the associated hit-to-space point label
         std::string fCalorimetryLabel;                           ///< the calorimetry label
         float fDistanceToWallThreshold;                          ///< margin to consider wether a track is contained
+        double fContainedMinX;                                   ///< the lower x edge of the contained volume
+        double fContainedMaxX;                                   ///< the upper x edge of the contained volume
+        double fContainedMinY;                                   ///< the lower y edge of the contained volume
+        double fContainedMaxY;                                   ///< the upper y edge of the contained volume
+        double fContainedMinZ;                                   ///< the lower z edge of the contained volume
+        double fContainedMaxZ;                                   ///< the upper z edge of the contained volume
 
         const float fPION_MASS = 139.57; //MeV
 };
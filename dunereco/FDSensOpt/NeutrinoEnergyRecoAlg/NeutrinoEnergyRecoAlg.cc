@@ -9,8 +9,12 @@
 //STL
 #include <limits>
 #include <algorithm>
+#include <map>
+#include <tuple>
 //ROOT
 //ART
+#include "canvas/Persistency/Provenance/EventID.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
 #include "canvas/Utilities/Exception.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 //LArSoft
@@ -21,13 +25,35 @@
 #include "lardataobj/RecoBase/Wire.h"
 #include "larreco/RecoAlg/TrackMomentumCalculator.h"
 //DUNE
+#include "dunereco/AnaUtils/DUNEAnaActiveVolume.h"
+#include "dunereco/AnaUtils/DUNEAnaDetectorSnapshot.h"
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaHitUtils.h"
+#include "dunereco/Profiling/ProfScope.h"
 #include "dunereco/AnaUtils/DUNEAnaShowerUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
 
 #include "dunereco/FDSensOpt/NeutrinoEnergyRecoAlg/NeutrinoEnergyRecoAlg.h"
 
+namespace
+{
+/// (track product, track key, MCS method, min length, max length, segment size, max momentum, momentum steps, max resolution)
+typedef std::tuple<art::ProductID, std::size_t, std::string, double, double, double, int, int, int> MCSKey;
+
+/// The MCS fits of the current event, shared by every NeutrinoEnergyRecoAlg on this thread
+struct MCSCache
+{
+    art::EventID m_eventID;
+    std::map<MCSKey, std::pair<const recob::Track*, double> > m_momenta;   ///< the fitted track and its uncorrected momentum
+};
+
+MCSCache &GetMCSCache()
+{
+    thread_local MCSCache cache;
+    return cache;
+}
+}
+
 namespace dune
 {
 NeutrinoEnergyRecoAlg::NeutrinoEnergyRecoAlg(fhicl::ParameterSet const& pset, const std::string &trackLabel, 
@@ -68,20 +94,93 @@ NeutrinoEnergyRecoAlg::NeutrinoEnergyRecoAlg(fhicl::ParameterSet const& pset, co
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event)
+NeutrinoEnergyRecoAlg::EventContext::EventContext(const NeutrinoEnergyRecoAlg &alg, const art::Event &event) :
+    fAlg(alg),
+    fEvent(event),
+    fClockData(art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event)),
+    fDetProp(art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event, fClockData)),
+    fSnapshot(fClockData, fDetProp),
+    fEventHitCharge(0.)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double NeutrinoEnergyRecoAlg::EventContext::GetEventHitCharge() const
+{
+    std::call_once(fEventHitChargeOnce, [this]()
+    {
+        // All collection hits of the event are summed, so the lifetime corrections come from the table of the snapshot
+        const std::vector<art::Ptr<recob::Hit> > eventHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(
+            dune_ana::DUNEAnaEventUtils::GetHitView(fEvent, fAlg.fHitLabel), 2));
+        fEventHitCharge = dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(fSnapshot, eventHits);
+    });
+
+    return fEventHitCharge;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const
+{
+    const EventContext context(*this, event);
+    return this->CalculateNeutrinoEnergy(pMuonTrack, context);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Ptr<recob::Shower> &pElectronShower,
+    const art::Event &event) const
+{
+    const EventContext context(*this, event);
+    return this->CalculateNeutrinoEnergy(pElectronShower, context);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Event &event) const
+{
+    const EventContext context(*this, event);
+    return this->CalculateNeutrinoEnergy(context);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergyViaMuonRanging(const art::Ptr<recob::Track> &pMuonTrack,
+    const art::Event &event) const
+{
+    const EventContext context(*this, event);
+    return this->CalculateNeutrinoEnergyViaMuonRanging(pMuonTrack, context);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergyViaMuonMCS(const art::Ptr<recob::Track> &pMuonTrack,
+    const art::Event &event) const
+{
+    const EventContext context(*this, event);
+    return this->CalculateNeutrinoEnergyViaMuonMCS(pMuonTrack, context);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Ptr<recob::Track> &pMuonTrack,
+    const EventContext &context) const
 {
+    DUNE_PROF_SCOPE("NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(muon track)");
+    const art::Event &event(context.GetEvent());
     if (!pMuonTrack.isAvailable() || pMuonTrack.isNull())
     {
         mf::LogWarning("NeutrinoEnergyRecoAlg") << " Cannot access the muon track which is needed for this energy reconstructio method.\n"
         << "Swapping to energy reconstruction method " << kAllCharges << " for this calculation." << std::endl;
-        return this->CalculateNeutrinoEnergy(event);
+        return this->CalculateNeutrinoEnergy(context);
     }
 
     Point_t vertex(pMuonTrack->Start().X(), pMuonTrack->Start().Y(), pMuonTrack->Start().Z());
 
     const std::vector<art::Ptr<recob::Hit> > muonHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaTrackUtils::GetHits(pMuonTrack, event, fTrackToHitLabel),2));
-    bool isContained(this->IsContained(muonHits, event));
-    const double uncorrectedMuonMomentumMCS(this->CalculateUncorrectedMuonMomentumByMCS(pMuonTrack));
+    bool isContained(this->IsContained(pMuonTrack, muonHits, context));
+    const double uncorrectedMuonMomentumMCS(this->CalculateUncorrectedMuonMomentumByMCS(pMuonTrack, event));
     const double muonMomentumMCS(this->CalculateLinearlyCorrectedValue(uncorrectedMuonMomentumMCS, fGradTrkMomMCS, fIntTrkMomMCS));
     if (!isContained)
     {
@@ -90,11 +189,11 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
             EnergyRecoInputHolder energyRecoInputHolder(vertex, 
                 this->CalculateParticle4Momentum(kMuonMass, muonMomentumMCS, pMuonTrack->VertexDirection().X(), pMuonTrack->VertexDirection().Y(), pMuonTrack->VertexDirection().Z()), 
                 kMuonAndHadronic, kMCS, kIsExiting, fGradNuMuHadEnExit, fIntNuMuHadEnExit);
-            return this->CalculateNeutrinoEnergy(muonHits, event, energyRecoInputHolder);
+            return this->CalculateNeutrinoEnergy(muonHits, context, energyRecoInputHolder);
         }
         else
         {
-            return this->CalculateNeutrinoEnergy(event);
+            return this->CalculateNeutrinoEnergy(context);
         }
     }
     else
@@ -107,7 +206,7 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
                 this->CalculateParticle4Momentum(kMuonMass, muonMomentumMCS, pMuonTrack->VertexDirection().X(), pMuonTrack->VertexDirection().Y(), pMuonTrack->VertexDirection().Z()), 
                 kMuonAndHadronic, kMCS, kIsContained, fGradNuMuHadEnExit, fIntNuMuHadEnExit);
 
-            return this->CalculateNeutrinoEnergy(muonHits, event, energyRecoInputHolder);
+            return this->CalculateNeutrinoEnergy(muonHits, context, energyRecoInputHolder);
         }
         else
         {
@@ -115,7 +214,7 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
                 this->CalculateParticle4Momentum(kMuonMass, muonMomentumRange, pMuonTrack->VertexDirection().X(), pMuonTrack->VertexDirection().Y(), pMuonTrack->VertexDirection().Z()), 
                 kMuonAndHadronic, kContained, kIsContained, fGradNuMuHadEnCont, fIntNuMuHadEnCont);
 
-            return this->CalculateNeutrinoEnergy(muonHits, event, energyRecoInputHolder);
+            return this->CalculateNeutrinoEnergy(muonHits, context, energyRecoInputHolder);
         }
     }
 
@@ -125,21 +224,23 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Ptr<recob::Shower> &pElectronShower, 
-    const art::Event &event)
+    const EventContext &context) const
 {
+    DUNE_PROF_SCOPE("NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(electron shower)");
+    const art::Event &event(context.GetEvent());
     if (!pElectronShower.isAvailable() || pElectronShower.isNull())
     {
         mf::LogWarning("NeutrinoEnergyRecoAlg") 
         << " Cannot access the electron shower which is needed for this energy reconstructio method.\n"
         << "Swapping to energy reconstruction method " << kAllCharges << " for this calculation." << std::endl;
-        return this->CalculateNeutrinoEnergy(event);
+        return this->CalculateNeutrinoEnergy(context);
     }
 
 
     Point_t vertex(pElectronShower->ShowerStart().X(), pElectronShower->ShowerStart().Y(), pElectronShower->ShowerStart().Z());
 
     const std::vector<art::Ptr<recob::Hit> > electronHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaShowerUtils::GetHits(pElectronShower, event, fShowerToHitLabel),2));
-    const double electronEnergy(this->CalculateElectronEnergy(pElectronShower, event));
+    const double electronEnergy(this->CalculateElectronEnergy(pElectronShower, context));
     const double electronMomentum = std::sqrt(electronEnergy*(electronEnergy + 2*kElectronMass));
 
     const Momentum4_t electron4Momentum(this->CalculateParticle4Momentum(kElectronMass, electronMomentum,
@@ -148,33 +249,34 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
     EnergyRecoInputHolder energyRecoInputHolder(vertex, electron4Momentum, 
     kElectronAndHadronic, kTrackMethodNotSet, kContainmentNotSet, fGradNuEHadEn, fIntNuEHadEn);
 
-    return this->CalculateNeutrinoEnergy(electronHits, event, energyRecoInputHolder);
+    return this->CalculateNeutrinoEnergy(electronHits, context, energyRecoInputHolder);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art::Event &event)
+dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const EventContext &context) const
 {
+    DUNE_PROF_SCOPE("NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(all charges)");
     art::ServiceHandle<geo::Geometry> fGeometry;
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event);
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event, clockData);
-    const double triggerTme(clockData.TriggerTime());
+    // The wire signals are summed tick by tick, so the lifetime corrections are looked up in the table of the snapshot
+    const dune_ana::DUNEAnaDetectorSnapshot &snapshot(context.GetSnapshot());
 
-    const std::vector<art::Ptr<recob::Wire> > wires(dune_ana::DUNEAnaEventUtils::GetWires(event, fWireLabel));
+    // Every wire is read once, so no art::Ptrs are needed
+    const dune_ana::DUNEAnaProductView<recob::Wire> wires(dune_ana::DUNEAnaEventUtils::GetWireView(context.GetEvent(), fWireLabel));
     double wireCharge(0);
 
-    for (unsigned int iWire = 0; iWire < wires.size(); ++iWire)
+    for (const recob::Wire &wire : wires)
     {
-        if (fGeometry->SignalType(wires[iWire]->Channel()) != geo::kCollection)
+        if (fGeometry->SignalType(wire.Channel()) != geo::kCollection)
             continue;
 
-        const recob::Wire::RegionsOfInterest_t& signalROI(wires[iWire]->SignalROI());
+        const recob::Wire::RegionsOfInterest_t& signalROI(wire.SignalROI());
         for (const lar::sparse_vector<float>::datarange_t& range : signalROI.get_ranges())
         {
             const std::vector<float>& signal(range.data());
             const raw::TDCtick_t binFirstTickROI(range.begin_index());
             for (unsigned int iSignal = 0; iSignal < signal.size(); ++iSignal)
-                wireCharge += signal[iSignal]*dune_ana::DUNEAnaHitUtils::LifetimeCorrection(clockData, detProp, iSignal+binFirstTickROI, triggerTme);
+                wireCharge += signal[iSignal]*snapshot.LifetimeCorrection(iSignal+binFirstTickROI);
         }
     }
     const double totalEnergy(this->CalculateEnergyFromCharge(wireCharge));
@@ -193,31 +295,33 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergyViaMuonRanging(const art::Ptr<recob::Track> &pMuonTrack,
-    const art::Event &event)
+    const EventContext &context) const
 {
+    const art::Event &event(context.GetEvent());
     Point_t vertex(pMuonTrack->Start().X(), pMuonTrack->Start().Y(), pMuonTrack->Start().Z());
 
     const std::vector<art::Ptr<recob::Hit> > muonHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaTrackUtils::GetHits(pMuonTrack, event, fTrackToHitLabel),2));
-    bool isContained(this->IsContained(muonHits, event));
+    bool isContained(this->IsContained(pMuonTrack, muonHits, context));
     const double muonMomentumRange(this->CalculateMuonMomentumByRange(pMuonTrack));
 
     EnergyRecoInputHolder energyRecoInputHolder(vertex, 
         this->CalculateParticle4Momentum(kMuonMass, muonMomentumRange, pMuonTrack->VertexDirection().X(), pMuonTrack->VertexDirection().Y(), pMuonTrack->VertexDirection().Z()), 
         kMuonAndHadronic, kContained, static_cast<MuonContainmentStatus>(isContained), fGradNuMuHadEnCont, fIntNuMuHadEnCont);
 
-    return this->CalculateNeutrinoEnergy(muonHits, event, energyRecoInputHolder);
+    return this->CalculateNeutrinoEnergy(muonHits, context, energyRecoInputHolder);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergyViaMuonMCS(const art::Ptr<recob::Track> &pMuonTrack,
-    const art::Event &event)
+    const EventContext &context) const
 {
+    const art::Event &event(context.GetEvent());
     Point_t vertex(pMuonTrack->Start().X(), pMuonTrack->Start().Y(), pMuonTrack->Start().Z());
 
     const std::vector<art::Ptr<recob::Hit> > muonHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaTrackUtils::GetHits(pMuonTrack, event, fTrackToHitLabel),2));
-    bool isContained(this->IsContained(muonHits, event));
-    const double muonMomentumMCS(this->CalculateMuonMomentumByMCS(pMuonTrack));
+    bool isContained(this->IsContained(pMuonTrack, muonHits, context));
+    const double muonMomentumMCS(this->CalculateMuonMomentumByMCS(pMuonTrack, event));
 
     if (muonMomentumMCS > std::numeric_limits<double>::epsilon())
     {
@@ -225,10 +329,10 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergyViaMuonMCS(
                 this->CalculateParticle4Momentum(kMuonMass, muonMomentumMCS, pMuonTrack->VertexDirection().X(), pMuonTrack->VertexDirection().Y(), pMuonTrack->VertexDirection().Z()), 
                 kMuonAndHadronic, kMCS, static_cast<MuonContainmentStatus>(isContained), fGradNuMuHadEnExit, fIntNuMuHadEnExit);
 
-        return this->CalculateNeutrinoEnergy(muonHits, event, energyRecoInputHolder);
+        return this->CalculateNeutrinoEnergy(muonHits, context, energyRecoInputHolder);
     }
     else 
-        return this->CalculateNeutrinoEnergy(event);
+        return this->CalculateNeutrinoEnergy(context);
 
 
 }
@@ -236,7 +340,7 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergyViaMuonMCS(
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 NeutrinoEnergyRecoAlg::Momentum4_t NeutrinoEnergyRecoAlg::CalculateParticle4Momentum(const double mass, const double momentum, 
-    const double directionX, const double directionY, const double directionZ)
+    const double directionX, const double directionY, const double directionZ) const
 {
     const double E(std::sqrt(momentum*momentum + mass*mass));
     const double pX(directionX * momentum);
@@ -247,7 +351,7 @@ NeutrinoEnergyRecoAlg::Momentum4_t NeutrinoEnergyRecoAlg::CalculateParticle4Mome
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double NeutrinoEnergyRecoAlg::CalculateMuonMomentumByRange(const art::Ptr<recob::Track> pMuonTrack)
+double NeutrinoEnergyRecoAlg::CalculateMuonMomentumByRange(const art::Ptr<recob::Track> pMuonTrack) const
 {
     const double uncorrectedMomentum(this->CalculateUncorrectedMuonMomentumByRange(pMuonTrack));
     return this->CalculateLinearlyCorrectedValue(uncorrectedMomentum, fGradTrkMomRange, fIntTrkMomRange);
@@ -255,20 +359,20 @@ double NeutrinoEnergyRecoAlg::CalculateMuonMomentumByRange(const art::Ptr<recob:
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double NeutrinoEnergyRecoAlg::CalculateMuonMomentumByMCS(const art::Ptr<recob::Track> pMuonTrack)
+double NeutrinoEnergyRecoAlg::CalculateMuonMomentumByMCS(const art::Ptr<recob::Track> pMuonTrack, const art::Event &event) const
 {
-    const double uncorrectedMomentum(this->CalculateUncorrectedMuonMomentumByMCS(pMuonTrack));
+    const double uncorrectedMomentum(this->CalculateUncorrectedMuonMomentumByMCS(pMuonTrack, event));
     return this->CalculateLinearlyCorrectedValue(uncorrectedMomentum, fGradTrkMomMCS, fIntTrkMomMCS);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double NeutrinoEnergyRecoAlg::CalculateElectronEnergy(const art::Ptr<recob::Shower> &pElectronShower, const art::Event &event)
+double NeutrinoEnergyRecoAlg::CalculateElectronEnergy(const art::Ptr<recob::Shower> &pElectronShower, const EventContext &context) const
 {
-    const std::vector<art::Ptr<recob::Hit> > electronHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaShowerUtils::GetHits(pElectronShower, event, fShowerToHitLabel),2));
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event);
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event, clockData);
-    const double electronObservedCharge(dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, electronHits));
+    const std::vector<art::Ptr<recob::Hit> > electronHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaShowerUtils::GetHits(pElectronShower,
+        context.GetEvent(), fShowerToHitLabel),2));
+    const double electronObservedCharge(dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(context.GetClockData(), context.GetDetProp(),
+        electronHits));
     const double uncorrectedElectronEnergy(this->CalculateEnergyFromCharge(electronObservedCharge));
 
     return this->CalculateLinearlyCorrectedValue(uncorrectedElectronEnergy, fGradShwEnergy, fIntShwEnergy);
@@ -276,14 +380,14 @@ double NeutrinoEnergyRecoAlg::CalculateElectronEnergy(const art::Ptr<recob::Show
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double NeutrinoEnergyRecoAlg::CalculateEnergyFromCharge(const double charge)
+double NeutrinoEnergyRecoAlg::CalculateEnergyFromCharge(const double charge) const
 {
     return fCalorimetryAlg.ElectronsFromADCArea(charge,2)*1./fRecombFactor/util::kGeVToElectrons;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-bool NeutrinoEnergyRecoAlg::IsContained(const std::vector<art::Ptr<recob::Hit> > &hits, const art::Event &event)
+bool NeutrinoEnergyRecoAlg::IsContained(const std::vector<art::Ptr<recob::Hit> > &hits, const art::Event &event) const
 {
     for (unsigned int iHit = 0; iHit < hits.size(); ++iHit)
     {
@@ -301,15 +405,36 @@ bool NeutrinoEnergyRecoAlg::IsContained(const std::vector<art::Ptr<recob::Hit> >
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+bool NeutrinoEnergyRecoAlg::IsContained(const art::Ptr<recob::Track> &pTrack, const std::vector<art::Ptr<recob::Hit> > &hits,
+    const EventContext &context) const
+{
+    const EventContext::TrackKey key(pTrack.id(), pTrack.key());
+    {
+        std::lock_guard<std::mutex> lock(context.fContainmentMutex);
+        auto iter(context.fTrackContainment.find(key));
+        if (iter != context.fTrackContainment.end())
+            return iter->second;
+    }
+
+    // Worked out without the lock, two callers asking for the same track just both find the same answer
+    const bool isContained(this->IsContained(hits, context.GetEvent()));
+
+    std::lock_guard<std::mutex> lock(context.fContainmentMutex);
+    context.fTrackContainment.emplace(key, isContained);
+    return isContained;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 double NeutrinoEnergyRecoAlg::CalculateLinearlyCorrectedValue(const double value, const double correctionGradient,
-    const double correctionIntercept)
+    const double correctionIntercept) const
 {
     return (value - correctionIntercept) / correctionGradient;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByRange(const art::Ptr<recob::Track> &pMuonTrack)
+double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByRange(const art::Ptr<recob::Track> &pMuonTrack) const
 {
     trkf::TrackMomentumCalculator TrackMomCalc;
     return (TrackMomCalc.GetTrackMomentum(pMuonTrack->Length(), 13));
@@ -317,7 +442,7 @@ double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByRange(const art:
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByMCS(const art::Ptr<recob::Track> &pMuonTrack)
+double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByMCS(const art::Ptr<recob::Track> &pMuonTrack) const
 {
     trkf::TrackMomentumCalculator TrackMomCalc(fMinTrackLengthMCS,fMaxTrackLengthMCS, fSegmentSizeMCS);
     if (fMCSMethod == "Chi2")
@@ -335,15 +460,37 @@ double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByMCS(const art::P
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+double NeutrinoEnergyRecoAlg::CalculateUncorrectedMuonMomentumByMCS(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const
+{
+    MCSCache &cache(GetMCSCache());
+    if (cache.m_eventID != event.id())
+    {
+        cache.m_momenta.clear();
+        cache.m_eventID = event.id();
+    }
+
+    // The track address also catches different events that happen to share an event ID
+    const MCSKey key(pMuonTrack.id(), pMuonTrack.key(), fMCSMethod, fMinTrackLengthMCS, fMaxTrackLengthMCS, fSegmentSizeMCS,
+        fMaxMomentumMCS, fStepsMomentumMCS, fMaxResolutionMCS);
+    const recob::Track *const pTrack(pMuonTrack.get());
+    auto iter(cache.m_momenta.find(key));
+    if (iter == cache.m_momenta.end() || iter->second.first != pTrack)
+        iter = cache.m_momenta.insert_or_assign(key, std::make_pair(pTrack, this->CalculateUncorrectedMuonMomentumByMCS(pMuonTrack))).first;
+
+    return iter->second.second;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const std::vector<art::Ptr<recob::Hit> > &leptonHits, 
-    const art::Event &event, const EnergyRecoInputHolder &energyRecoInputHolder)
+    const EventContext &context, const EnergyRecoInputHolder &energyRecoInputHolder) const
 {
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event);
-    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event, clockData);
-    const double leptonObservedCharge(dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, leptonHits));
+    DUNE_PROF_SCOPE("NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(lepton hits)");
+    DUNE_PROF_COUNT("NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy lepton hits", leptonHits.size());
+    const double leptonObservedCharge(dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(context.GetSnapshot(), leptonHits));
 
-    const std::vector<art::Ptr<recob::Hit> > eventHits(dune_ana::DUNEAnaHitUtils::GetHitsOnPlane(dune_ana::DUNEAnaEventUtils::GetHits(event, fHitLabel),2));
-    const double eventObservedCharge(dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(clockData, detProp, eventHits));
+    // Summed once per event, however many lepton hypotheses are tried
+    const double eventObservedCharge(context.GetEventHitCharge());
 
     const double hadronicObservedCharge(eventObservedCharge-leptonObservedCharge);
     const double uncorrectedHadronicEnergy(this->CalculateEnergyFromCharge(hadronicObservedCharge));
@@ -366,37 +513,19 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const std:
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-bool NeutrinoEnergyRecoAlg::IsPointContained(const double x, const double y, const double z)
+bool NeutrinoEnergyRecoAlg::IsPointContained(const double x, const double y, const double z) const
 {
-    geo::Point_t const position{x,y,z};
-    art::ServiceHandle<geo::Geometry> fGeometry;
+    const dune_ana::DUNEAnaActiveVolume &activeVolume(dune_ana::DUNEAnaActiveVolume::Get());
 
-    geo::TPCID tpcID(fGeometry->FindTPCAtPosition(position));
-    if (!(fGeometry->HasTPC(tpcID)))
+    if (!activeVolume.IsInsideTPC(x,y,z))
         return false;
 
-    double minX(std::numeric_limits<double>::max());
-    double maxX(std::numeric_limits<double>::lowest());
-    double minY(std::numeric_limits<double>::max());
-    double maxY(std::numeric_limits<double>::lowest());
-    double minZ(std::numeric_limits<double>::max());
-    double maxZ(std::numeric_limits<double>::lowest());
-    for (auto const& tpc : fGeometry->Iterate<geo::TPCGeo>())
-    {
-            minX = std::min(minX,tpc.MinX());
-            maxX = std::max(maxX,tpc.MaxX());
-            minY = std::min(minY,tpc.MinY());
-            maxY = std::max(maxY,tpc.MaxY());
-            minZ = std::min(minZ,tpc.MinZ());
-            maxZ = std::max(maxZ,tpc.MaxZ());
-    }
-
-    minX += fDistanceToWallThreshold;
-    maxX -= fDistanceToWallThreshold;
-    minY += fDistanceToWallThreshold;
-    maxY -= fDistanceToWallThreshold;
-    minZ += fDistanceToWallThreshold;
-    maxZ -= fDistanceToWallThreshold;
+    const double minX(activeVolume.MinX() + fDistanceToWallThreshold);
+    const double maxX(activeVolume.MaxX() - fDistanceToWallThreshold);
+    const double minY(activeVolume.MinY() + fDistanceToWallThreshold);
+    const double maxY(activeVolume.MaxY() - fDistanceToWallThreshold);
+    const double minZ(activeVolume.MinZ() + fDistanceToWallThreshold);
+    const double maxZ(activeVolume.MaxZ() - fDistanceToWallThreshold);
 
     if (x - minX < -1.*std::numeric_limits<double>::epsilon() ||
         x - maxX > std::numeric_limits<double>::epsilon())
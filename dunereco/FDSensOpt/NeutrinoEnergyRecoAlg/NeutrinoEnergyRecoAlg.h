@@ -9,16 +9,23 @@
 #define DUNE_NEUTRINO_ENERGY_RECO_ALG_H
 
 //STL
+#include <map>
+#include <mutex>
 #include <string>
 #include <iostream>
+#include <utility>
 //ROOT
 #include "Math/GenVector/LorentzVector.h" 
 //ART
 #include "art/Framework/Principal/Event.h"
 #include "fhiclcpp/ParameterSet.h" 
+#include "canvas/Persistency/Provenance/ProductID.h"
 //LArSoft
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "larreco/Calorimetry/CalorimetryAlg.h"
 //DUNE
+#include "dunereco/AnaUtils/DUNEAnaDetectorSnapshot.h"
 #include "dunereco/FDSensOpt/FDSensOptData/EnergyRecoOutput.h"
 
 namespace dune
@@ -27,10 +34,66 @@ namespace dune
  *
  * @brief NeutrinoEnergyRecoAlg class
  *
+ * The calculations are const and keep nothing between calls, so one instance can be shared by the schedules of a job.
+ * What they read from an event is gathered in an EventContext, made once per event and handed to every calculation on
+ * it, so several lepton hypotheses of one event can be evaluated concurrently.
+ *
 */
 class NeutrinoEnergyRecoAlg 
 {
     public:
+        /**
+        *
+        * @brief EventContext class holding the detector data, the summed event charge and the track containment of one event
+        *
+        * The detector data are read in the constructor. The summed charge of the collection plane hits and the containment
+        * of each track are worked out the first time they are needed and kept, both are safe to request from several
+        * threads at once. A context belongs to the algorithm it was made with, as it uses its labels.
+        *
+        */
+        class EventContext
+        {
+            public:
+                /**
+                * @brief  Constructor
+                *
+                * @param  alg the algorithm whose labels are used
+                * @param  event the art event
+                */
+                EventContext(const NeutrinoEnergyRecoAlg &alg, const art::Event &event);
+
+                EventContext(const EventContext &) = delete;
+                EventContext &operator=(const EventContext &) = delete;
+
+                const art::Event &GetEvent() const { return fEvent; }
+                const detinfo::DetectorClocksData &GetClockData() const { return fClockData; }
+                const detinfo::DetectorPropertiesData &GetDetProp() const { return fDetProp; }
+                const dune_ana::DUNEAnaDetectorSnapshot &GetSnapshot() const { return fSnapshot; }
+
+                /**
+                * @brief  Get the lifetime corrected charge of all the collection plane hits of the event
+                *
+                * @return the summed charge
+                */
+                double GetEventHitCharge() const;
+
+            private:
+                friend class NeutrinoEnergyRecoAlg;
+
+                typedef std::pair<art::ProductID, std::size_t> TrackKey;
+
+                const NeutrinoEnergyRecoAlg &fAlg;                                  ///< the algorithm whose labels are used
+                const art::Event &fEvent;                                           ///< the art event
+                const detinfo::DetectorClocksData fClockData;                       ///< the detector clocks of the event
+                const detinfo::DetectorPropertiesData fDetProp;                     ///< the detector properties of the event
+                const dune_ana::DUNEAnaDetectorSnapshot fSnapshot;                  ///< the flat copy of the detector data
+
+                mutable std::once_flag fEventHitChargeOnce;                         ///< the event charge is summed by a single caller
+                mutable double fEventHitCharge;                                     ///< the summed charge of the collection plane hits
+                mutable std::mutex fContainmentMutex;                               ///< guards the containment of the tracks
+                mutable std::map<TrackKey, bool> fTrackContainment;                 ///< the containment of the tracks asked about
+        };
+
         /**
         * @brief  Constructor
         *
@@ -51,50 +114,59 @@ class NeutrinoEnergyRecoAlg
         * @brief  Calculates neutrino energy using a muon track (the muon track may be ignored if it isn't of a suitable quality)
         *
         * @param  pMuonTrack the muon track
-        * @param  event the art event
+        * @param  context the context of the event
         *
         * @return the neutrino energy summary object
         */
-        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event);
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Ptr<recob::Track> &pMuonTrack, const EventContext &context) const;
 
         /**
         * @brief  Calculates neutrino energy using an electron shower(the electron may be ignored if it isn't of a suitable quality)
         *
         * @param  pElectronShower the electron shower
-        * @param  event the art event
+        * @param  context the context of the event
         *
         * @return the neutrino energy summary object
         */
-        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Ptr<recob::Shower> &pElectronShower, const art::Event &event);
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Ptr<recob::Shower> &pElectronShower, const EventContext &context) const;
 
         /**
         * @brief  Calculates neutrino energy by summing wire charges
         *
-        * @param  event the art event
+        * @param  context the context of the event
         *
         * @return the neutrino energy summary object
         */
-        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Event &event);
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const EventContext &context) const;
 
         /**
         * @brief  Calculates neutrino energy explicitly using muon momentum by range
         *
         * @param  pMuonTrack the muon track
-        * @param  event the art event
+        * @param  context the context of the event
         *
         * @return the neutrino energy summary object
         */
-        dune::EnergyRecoOutput CalculateNeutrinoEnergyViaMuonRanging(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event);
+        dune::EnergyRecoOutput CalculateNeutrinoEnergyViaMuonRanging(const art::Ptr<recob::Track> &pMuonTrack, const EventContext &context) const;
 
         /**
         * @brief  Calculates neutrino energy explicitly using muon multiple scattering
         *
         * @param  pMuonTrack the muon track
-        * @param  event the art event
+        * @param  context the context of the event
         *
         * @return the neutrino energy summary object
         */
-        dune::EnergyRecoOutput CalculateNeutrinoEnergyViaMuonMCS(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event);
+        dune::EnergyRecoOutput CalculateNeutrinoEnergyViaMuonMCS(const art::Ptr<recob::Track> &pMuonTrack, const EventContext &context) const;
+
+        /**
+        * @brief  The calculations above for callers without a context, each call makes one for the event
+        */
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const;
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Ptr<recob::Shower> &pElectronShower, const art::Event &event) const;
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const art::Event &event) const;
+        dune::EnergyRecoOutput CalculateNeutrinoEnergyViaMuonRanging(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const;
+        dune::EnergyRecoOutput CalculateNeutrinoEnergyViaMuonMCS(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const;
 
     private:
 
@@ -171,26 +243,27 @@ class NeutrinoEnergyRecoAlg
         *
         * @return the reconstructed muon momentum
         */
-        double CalculateMuonMomentumByRange(const art::Ptr<recob::Track> pMuonTrack);
+        double CalculateMuonMomentumByRange(const art::Ptr<recob::Track> pMuonTrack) const;
 
         /**
         * @brief  Calculates muon momentum by multiple coulomb scattering
         *
         * @param  pMuonTrack the muon track
+        * @param  event the art event
         *
         * @return the reconstructed muon momentum
         */
-        double CalculateMuonMomentumByMCS(const art::Ptr<recob::Track> pMuonTrack);
+        double CalculateMuonMomentumByMCS(const art::Ptr<recob::Track> pMuonTrack, const art::Event &event) const;
 
         /**
         * @brief  Calculates an electron shower's deposited energy by converting its deposited charge
         *
         * @param  pElectronShower the electron shower
-        * @param  event the art event
+        * @param  context the context of the event
         *
         * @return the reconstructed electron energy
         */
-        double CalculateElectronEnergy(const art::Ptr<recob::Shower> &pElectronShower, const art::Event &event);
+        double CalculateElectronEnergy(const art::Ptr<recob::Shower> &pElectronShower, const EventContext &context) const;
 
         /**
         * @brief  Converts deposited charge into energy by converting to number of electrons and correcting for average recombination
@@ -199,16 +272,29 @@ class NeutrinoEnergyRecoAlg
         *
         * @return the reconstructed deposited energy
         */
-        double CalculateEnergyFromCharge(const double charge);
+        double CalculateEnergyFromCharge(const double charge) const;
 
         /**
         * @brief  Checks if a set of track hits are contained within a central volume of the detector 
         *
         * @param  hits the track hits
+        * @param  event the art event
         *
         * @return an is contained bool
         */
-        bool IsContained(const std::vector<art::Ptr<recob::Hit> > &hits, const art::Event &event);
+        bool IsContained(const std::vector<art::Ptr<recob::Hit> > &hits, const art::Event &event) const;
+
+        /**
+        * @brief  Checks if a track is contained, looking up or filling the containment kept by the context
+        *
+        * @param  pTrack the track
+        * @param  hits the collection plane hits of the track
+        * @param  context the context of the event
+        *
+        * @return an is contained bool
+        */
+        bool IsContained(const art::Ptr<recob::Track> &pTrack, const std::vector<art::Ptr<recob::Hit> > &hits,
+            const EventContext &context) const;
 
         /**
         * @brief  Calculates a particle's four-momentum vector
@@ -222,7 +308,7 @@ class NeutrinoEnergyRecoAlg
         * @return the particle's four-momenutm vector
         */
         Momentum4_t CalculateParticle4Momentum(const double mass, const double momentum, 
-            const double directionX, const double directionY, const double directionZ);
+            const double directionX, const double directionY, const double directionZ) const;
 
         /**
         * @brief  Linearly corrects a value
@@ -234,7 +320,7 @@ class NeutrinoEnergyRecoAlg
         * @return the linearly corrected value
         */
         double CalculateLinearlyCorrectedValue(const double value, const double correctionGradient,
-            const double correctionIntercept);
+            const double correctionIntercept) const;
 
         /**
         * @brief  Calculates the raw muon momentum by continuous-slowing-down approximation (CSDA) table
@@ -243,7 +329,7 @@ class NeutrinoEnergyRecoAlg
         *
         * @return the uncorrected reconstructed muon momentum (in GeV)
         */
-        double CalculateUncorrectedMuonMomentumByRange(const art::Ptr<recob::Track> &pMuonTrack);
+        double CalculateUncorrectedMuonMomentumByRange(const art::Ptr<recob::Track> &pMuonTrack) const;
 
         /**
         * @brief  Calculates the raw muon momentum by multiple coulomb scattering
@@ -252,19 +338,30 @@ class NeutrinoEnergyRecoAlg
         *
         * @return the uncorrected reconstructed muon momentum
         */
-        double CalculateUncorrectedMuonMomentumByMCS(const art::Ptr<recob::Track> &pMuonTrack);
+        double CalculateUncorrectedMuonMomentumByMCS(const art::Ptr<recob::Track> &pMuonTrack) const;
+
+        /**
+        * @brief  Gets the raw muon momentum by multiple coulomb scattering, reusing the result of any earlier call on this thread
+        *         for the same track, event and MCS settings (e.g. from EnergyReco and CCNuSelection in one job)
+        *
+        * @param  pMuonTrack the muon track
+        * @param  event the art event
+        *
+        * @return the uncorrected reconstructed muon momentum
+        */
+        double CalculateUncorrectedMuonMomentumByMCS(const art::Ptr<recob::Track> &pMuonTrack, const art::Event &event) const;
 
         /**
         * @brief  Calculates neutrino energy by summing hadronic deposited energy and lepton energy
         *
         * @param  leptonHits the lepton hits
-        * @param  event the art event
+        * @param  context the context of the event
         * @param  energyRecoInputHolder the holder object holding pre-calculated or pre-existing information
         *
         * @return the neutrino energy summary object
         */
-        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const std::vector<art::Ptr<recob::Hit> > &leptonHits, const art::Event &event, 
-            const EnergyRecoInputHolder &energyRecoInputHolder);
+        dune::EnergyRecoOutput CalculateNeutrinoEnergy(const std::vector<art::Ptr<recob::Hit> > &leptonHits, const EventContext &context, 
+            const EnergyRecoInputHolder &energyRecoInputHolder) const;
 
         /**
         * @brief  Check's if a point is contained within a central detector volume
@@ -275,7 +372,7 @@ class NeutrinoEnergyRecoAlg
         *
         * @return an is contained bool
         */
-        bool IsPointContained(const double x, const double y, const double z);
+        bool IsPointContained(const double x, const double y, const double z) const;
 
         calo::CalorimetryAlg fCalorimetryAlg;                    ///< the calorimetry algorithm
 
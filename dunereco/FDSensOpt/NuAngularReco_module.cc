@@ -32,6 +32,7 @@
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 //DUNE
 #include "dunereco/FDSensOpt/FDSensOptData/AngularRecoOutput.h"
+#include "dunereco/FDSensOpt/FDSensOptData/EnergyRecoOutput.h"
 #include "dunereco/FDSensOpt/NeutrinoAngularRecoAlg/NeutrinoAngularRecoAlg.h"
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaHitUtils.h"
@@ -70,6 +71,8 @@ namespace dune {
                                   std::vector<art::Ptr<recob::Track>> &pTracks);
             std::map<art::Ptr<recob::Track>, int> GetTracksPID(const art::Event& event,
                                                                const std::vector<art::Ptr<recob::Track>> &pTracks);
+            void GetLeptonsFromEnergyReco(const art::Event& event, art::Ptr<recob::Track> &pTrack,
+                                          art::Ptr<recob::Shower> &pShower) const;
       std::string fWireLabel;
       std::string fHitLabel;
       std::string fTrackLabel;
@@ -81,6 +84,7 @@ namespace dune {
       std::string fShowerToHitLabel;
       std::string fHitToSpacePointLabel;
       std::string fParticleIDLabel;
+      std::string fEnergyRecoLabel;   ///< EnergyReco run on the same tracks and showers, empty to pick the leptons here
 
       int fRecoMethod;
       float fPIDACut;
@@ -104,6 +108,7 @@ NuAngularReco::NuAngularReco(fhicl::ParameterSet const& pset) :
     fShowerToHitLabel(pset.get<std::string>("ShowerToHitLabel")),
     fHitToSpacePointLabel(pset.get<std::string>("HitToSpacePointLabel")),
     fParticleIDLabel(pset.get<std::string>("ParticleIDLabel")),
+    fEnergyRecoLabel(pset.get<std::string>("EnergyRecoLabel", "")),
     fRecoMethod(pset.get<int>("RecoMethod")),
     fPIDACut(pset.get<float>("PIDACut")),
     fNeutrinoAngularRecoAlg(pset.get<fhicl::ParameterSet>("NeutrinoAngularRecoAlg"),fTrackLabel,fShowerLabel,
@@ -122,10 +127,20 @@ void NuAngularReco::produce(art::Event& evt)
   auto assnstrk = std::make_unique<art::Assns<dune::AngularRecoOutput, recob::Track>>();
   auto assnsshw = std::make_unique<art::Assns<dune::AngularRecoOutput, recob::Shower>>();
 
-  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
-  auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(evt, clockData);
-  art::Ptr<recob::Track> longestTrack(this->GetLongestTrack(evt));
-  art::Ptr<recob::Shower> highestChargeShower(this->GetHighestChargeShower(clockData, detProp, evt));
+  art::Ptr<recob::Track> longestTrack;
+  art::Ptr<recob::Shower> highestChargeShower;
+  if (!fEnergyRecoLabel.empty())
+  {
+      // EnergyReco has already summed the charge of every shower to find the same leptons
+      this->GetLeptonsFromEnergyReco(evt, longestTrack, highestChargeShower);
+  }
+  else
+  {
+      auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataFor(evt);
+      auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(evt, clockData);
+      longestTrack = this->GetLongestTrack(evt);
+      highestChargeShower = this->GetHighestChargeShower(clockData, detProp, evt);
+  }
 
   if (fRecoMethod == 1)
       angularRecoOutput = std::make_unique<dune::AngularRecoOutput>(fNeutrinoAngularRecoAlg.CalculateNeutrinoAngle(longestTrack, evt));
@@ -143,7 +158,6 @@ void NuAngularReco::produce(art::Event& evt)
       std::vector<art::Ptr<recob::Track>> pTracks;
       GetTracksShowersFromPFP(evt, pShowers, pTracks);
       std::map<art::Ptr<recob::Track>, int> tracksPID = GetTracksPID(evt, pTracks);
-      art::Ptr<recob::Track> longestTrack(this->GetLongestTrack(evt));
       angularRecoOutput = std::make_unique<dune::AngularRecoOutput>(fNeutrinoAngularRecoAlg.CalculateNeutrinoAngle(longestTrack, pTracks, tracksPID, pShowers, evt));
   }
 
@@ -287,6 +301,21 @@ std::map<art::Ptr<recob::Track>, int> NuAngularReco::GetTracksPID(const art::Eve
 
 }
 
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+void NuAngularReco::GetLeptonsFromEnergyReco(const art::Event& event, art::Ptr<recob::Track> &pTrack,
+                                             art::Ptr<recob::Shower> &pShower) const
+{
+    // EnergyReco makes one output per event, associated to the longest track and the highest charge shower when it found them
+    const auto &trackAssns(*event.getValidHandle<art::Assns<dune::EnergyRecoOutput, recob::Track>>(fEnergyRecoLabel));
+    const auto &showerAssns(*event.getValidHandle<art::Assns<dune::EnergyRecoOutput, recob::Shower>>(fEnergyRecoLabel));
+
+    if (!trackAssns.empty())
+        pTrack = trackAssns.at(0).second;
+    if (!showerAssns.empty())
+        pShower = showerAssns.at(0).second;
+}
+
 DEFINE_ART_MODULE(NuAngularReco)
 
 } // namespace dune
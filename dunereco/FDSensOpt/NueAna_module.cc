@@ -39,6 +39,7 @@
 #include "larreco/RecoAlg/PMAlg/Utilities.h"
 #include "larreco/RecoAlg/TrackMomentumCalculator.h"
 #include "larreco/Calorimetry/CalorimetryAlg.h"
+#include "dunereco/AnaUtils/DUNEAnaHitTruthCache.h"
 #include "larcoreobj/SummaryData/POTSummary.h"
 #include "nusimdata/SimulationBase/MCFlux.h"
 
@@ -261,6 +262,19 @@ private:
 
   double fFidVolCut;
 
+  // Branch groups to write. A group that is off gets no branches, and its products are not read
+  bool fSaveHits;
+  bool fSaveTracks;
+  bool fSaveShowers;
+  bool fSaveVertices;
+  bool fSaveFlashes;
+  bool fSaveRecoTruthMatch;   // backtracking of the track and shower hits, the only IDE work
+  bool fSaveMCTruth;
+  bool fSaveGeant;
+
+  Int_t fTreeBasketSize;
+  Long64_t fTreeAutoFlush;
+
   calo::CalorimetryAlg fCalorimetryAlg;
 
 };
@@ -299,10 +313,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
   std::cout << " **************************************** analyze ************ " << std::endl;
   // Implementation of required member function here.
   ResetVars();
-  art::ServiceHandle<geo::Geometry> geom;
-  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
   art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
-  const sim::ParticleList& plist = pi_serv->ParticleList();
 
   run = evt.run();
   subrun = evt.subRun();
@@ -313,45 +324,61 @@ void dunefd::NueAna::analyze(art::Event const & evt)
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt, clockData);
   taulife = detProp.ElectronLifetime();
+  // Track and shower hits are backtracked more than once below
+  dune_ana::DUNEAnaHitTruthCache truth(clockData);
   isdata = evt.isRealData();
 
+  const bool matchTruth = fSaveRecoTruthMatch && !isdata;
+  // The tracks also give the reco vertex closest to the true one
+  const bool readTracks = fSaveTracks || (fSaveVertices && fSaveMCTruth && !isdata);
+  // The hit space points place the start of the true track
+  const bool readHits = fSaveHits || (fSaveTracks && matchTruth);
+
   // * hits
   std::vector<art::Ptr<recob::Hit> > hitlist;
-  auto hitListHandle = evt.getHandle< std::vector<recob::Hit> >(fHitsModuleLabel);
-  if (hitListHandle)
-    art::fill_ptr_vector(hitlist, hitListHandle);
+  art::Handle< std::vector<recob::Hit> > hitListHandle;
+  if (readHits){
+    hitListHandle = evt.getHandle< std::vector<recob::Hit> >(fHitsModuleLabel);
+    if (hitListHandle)
+      art::fill_ptr_vector(hitlist, hitListHandle);
+  }
 
   // * tracks
   std::vector<art::Ptr<recob::Track> > tracklist;
-  auto trackListHandle = evt.getHandle< std::vector<recob::Track> >(fTrackModuleLabel);
-  if (trackListHandle)
-    art::fill_ptr_vector(tracklist, trackListHandle);
+  art::Handle< std::vector<recob::Track> > trackListHandle;
+  if (readTracks){
+    trackListHandle = evt.getHandle< std::vector<recob::Track> >(fTrackModuleLabel);
+    if (trackListHandle)
+      art::fill_ptr_vector(tracklist, trackListHandle);
+  }
 
   // * vertices
   std::vector<art::Ptr<recob::Vertex> > vtxlist;
-  auto vtxListHandle = evt.getHandle< std::vector<recob::Vertex> >(fVertexModuleLabel);
-  if (vtxListHandle)
-    art::fill_ptr_vector(vtxlist, vtxListHandle);
+  if (fSaveVertices){
+    auto vtxListHandle = evt.getHandle< std::vector<recob::Vertex> >(fVertexModuleLabel);
+    if (vtxListHandle)
+      art::fill_ptr_vector(vtxlist, vtxListHandle);
+  }
 
   // * showers
   std::vector<art::Ptr<recob::Shower>> shwlist;
-  auto shwListHandle = evt.getHandle<std::vector<recob::Shower> >(fShowerModuleLabel);
-  if (shwListHandle)
-    art::fill_ptr_vector(shwlist, shwListHandle);
+  art::Handle< std::vector<recob::Shower> > shwListHandle;
+  if (fSaveShowers){
+    shwListHandle = evt.getHandle<std::vector<recob::Shower> >(fShowerModuleLabel);
+    if (shwListHandle)
+      art::fill_ptr_vector(shwlist, shwListHandle);
+  }
   
   // * flashes
   std::vector<art::Ptr<recob::OpFlash> > flashlist;
-  auto flashListHandle = evt.getHandle< std::vector<recob::OpFlash> >(fFlashModuleLabel);
-  if (flashListHandle)
-    art::fill_ptr_vector(flashlist, flashListHandle);
-
-  // * associations
-  art::FindManyP<recob::Hit> fmth(trackListHandle, evt, fTrackModuleLabel);
-  art::FindManyP<recob::Hit, recob::TrackHitMeta> fmthm(trackListHandle, evt, fTrackModuleLabel);
-  art::FindManyP<recob::SpacePoint> fmhs(hitListHandle, evt, fTrackModuleLabel);
-  art::FindMany<anab::Calorimetry>  fmcal(trackListHandle, evt, fCalorimetryModuleLabel);
+  if (fSaveFlashes){
+    auto flashListHandle = evt.getHandle< std::vector<recob::OpFlash> >(fFlashModuleLabel);
+    if (flashListHandle)
+      art::fill_ptr_vector(flashlist, flashListHandle);
+  }
 
   //hit information
+  if (fSaveHits){
   nhits = hitlist.size();
   nhits_stored = std::min(nhits, kMaxHits);
   for (int i = 0; i < nhits && i < kMaxHits ; ++i){//loop over hits
@@ -366,8 +393,18 @@ void dunefd::NueAna::analyze(art::Event const & evt)
     hit_endT[i] = hitlist[i]->PeakTimePlusRMS();
 
   }
+  }
 
   //track information
+  if (fSaveTracks){
+  // * associations
+  art::FindManyP<recob::Hit> fmth(trackListHandle, evt, fTrackModuleLabel);
+  art::FindManyP<recob::Hit, recob::TrackHitMeta> fmthm(trackListHandle, evt, fTrackModuleLabel);
+  art::FindMany<anab::Calorimetry>  fmcal(trackListHandle, evt, fCalorimetryModuleLabel);
+  std::unique_ptr< art::FindManyP<recob::SpacePoint> > fmhs;
+  if (matchTruth)
+    fmhs = std::make_unique< art::FindManyP<recob::SpacePoint> >(hitListHandle, evt, fTrackModuleLabel);
+
   ntracks_reco=tracklist.size();
 
   recob::Track::Vector_t larStart;
@@ -394,7 +431,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
     trkenddcosz[i]    = larEnd.Z();
     trklen[i]         = tracklist[i]->Length();
     if (!std::isnan(trklen[i])) trkmomrange[i]    = trkm.GetTrackMomentum(trklen[i],13);
-    if (fmthm.isValid()){
+    if (fSaveHits && fmthm.isValid()){
       auto vhit = fmthm.at(i);
       auto vmeta = fmthm.data(i);
       for (size_t h = 0; h < vhit.size(); ++h){
@@ -408,7 +445,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
 	}
       }//loop over all hits
     }//fmthm is valid
-    else if (fmth.isValid()){
+    else if (fSaveHits && fmth.isValid()){
       std::vector< art::Ptr<recob::Hit> > vhit = fmth.at(i);
       for (size_t h = 0; h < vhit.size(); ++h){
 	if (vhit[h].key()<kMaxHits){
@@ -439,15 +476,16 @@ void dunefd::NueAna::analyze(art::Event const & evt)
 	}
       }
     }
-    if (!isdata&&fmth.isValid()){
+    if (matchTruth&&fmth.isValid()){
       // Find true track for each reconstructed track
       int TrackID = 0;
       std::vector< art::Ptr<recob::Hit> > allHits = fmth.at(i);
       
       std::map<int,double> trkide;
+      truth.Fill(allHits);
       for(size_t h = 0; h < allHits.size(); ++h){
 	art::Ptr<recob::Hit> hit = allHits[h];
-	std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
+	const std::vector<sim::TrackIDE>& TrackIDs = truth.GetTrackIDEs(hit);
 	for(size_t e = 0; e < TrackIDs.size(); ++e){
 	  trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
 	}	    
@@ -481,7 +519,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
 	for(size_t h = 0; h < allHits.size(); ++h){
 	  art::Ptr<recob::Hit> hit = allHits[h];
 	  if (hit->WireID().Plane==2){
-	    std::vector<art::Ptr<recob::SpacePoint> > spts = fmhs.at(hit.key());
+	    std::vector<art::Ptr<recob::SpacePoint> > spts = fmhs->at(hit.key());
 	    if (spts.size()){
 	      double dis = sqrt(pow(spts[0]->XYZ()[0]-trkg4startx[i],2)+
 				pow(spts[0]->XYZ()[1]-trkg4starty[i],2)+
@@ -498,12 +536,12 @@ void dunefd::NueAna::analyze(art::Event const & evt)
 	for(size_t h = 0; h < allHits.size(); ++h){
 	  art::Ptr<recob::Hit> hit = allHits[h];
 	  if (hit->WireID().Plane==2){
-	    std::vector<art::Ptr<recob::SpacePoint> > spts = fmhs.at(hit.key());
+	    std::vector<art::Ptr<recob::SpacePoint> > spts = fmhs->at(hit.key());
 	    if (spts.size()){
 	      if (sqrt(pow(spts[0]->XYZ()[0]-x,2)+
 		       pow(spts[0]->XYZ()[1]-y,2)+
 		       pow(spts[0]->XYZ()[2]-z,2))<3){
-		std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
+		const std::vector<sim::TrackIDE>& TrackIDs = truth.GetTrackIDEs(hit);
 		float toten = 0;
 		for(size_t e = 0; e < TrackIDs.size(); ++e){
 		  //sum_energy += TrackIDs[e].energy;
@@ -550,6 +588,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
       }//if (particle)
     }//MC
   }
+  }
 
   //vertex information
   nvtx = vtxlist.size();
@@ -560,7 +599,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
   }
 
   //shower information
-  if (shwListHandle.isValid()){
+  if (fSaveShowers && shwListHandle.isValid()){
   art::FindManyP<recob::Hit> fmsh(shwListHandle, evt, fShowerModuleLabel);
 
   nshws = shwlist.size();
@@ -580,7 +619,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
       shwdedx[i][j] = shwlist[i]->dEdx()[j];
     }
     shwbestplane[i] = shwlist[i]->best_plane();
-    if (fmsh.isValid()){
+    if (fSaveHits && fmsh.isValid()){
       auto vhit = fmsh.at(i);
       for (size_t h = 0; h < vhit.size(); ++h){
 	if (vhit[h].key()<kMaxHits){
@@ -588,14 +627,15 @@ void dunefd::NueAna::analyze(art::Event const & evt)
 	}
       }
     }
-    if (!isdata&&fmsh.isValid()){
+    if (matchTruth&&fmsh.isValid()){
       // Find true track for each reconstructed track
       int TrackID = 0;
       std::vector< art::Ptr<recob::Hit> > allHits = fmsh.at(i);
       std::map<int,double> trkide;
+      truth.Fill(allHits);
       for(size_t h = 0; h < allHits.size(); ++h){
 	art::Ptr<recob::Hit> hit = allHits[h];
-	std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
+	const std::vector<sim::TrackIDE>& TrackIDs = truth.GetTrackIDEs(hit);
 	for(size_t e = 0; e < TrackIDs.size(); ++e){
 	  trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
 	}	    
@@ -620,7 +660,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
   }
   // flash information
   flash_total = flashlist.size();
-  for ( int f = 0; f < std::min(flash_total,kMaxHits); ++f ) {
+  for ( int f = 0; f < std::min(flash_total,kMaxFlash); ++f ) {
     flash_time[f]      = flashlist[f]->Time();
     flash_width[f]     = flashlist[f]->TimeWidth();
     flash_abstime[f]   = flashlist[f]->AbsTime();
@@ -633,7 +673,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
 
 
 
-  if (!isdata){
+  if (!isdata && fSaveMCTruth){
 
     // * MC truth information
     std::vector<art::Ptr<simb::MCTruth> > mclist;
@@ -741,8 +781,11 @@ void dunefd::NueAna::analyze(art::Event const & evt)
       vy_flux     = fluxlist[0]->fvy;
       vz_flux     = fluxlist[0]->fvz;
     }
+  }
 
+  if (!isdata && fSaveGeant){
     //save g4 particle information
+    const sim::ParticleList& plist = pi_serv->ParticleList();
     std::vector<const simb::MCParticle* > geant_part;
     
     // ### Looping over all the Geant4 particles from the BackTrackerService ###
@@ -827,7 +870,7 @@ void dunefd::NueAna::analyze(art::Event const & evt)
     } //geant particles
 
 
-  }//is neutrino
+  }//geant
   fTree->Fill();
 }
 
@@ -842,127 +885,157 @@ void dunefd::NueAna::beginJob()
   fTree->Branch("evttime",&evttime,"evttime/F");
   fTree->Branch("taulife",&taulife,"taulife/F");
   fTree->Branch("isdata",&isdata,"isdata/S");
-  fTree->Branch("ntracks_reco",&ntracks_reco,"ntracks_reco/I");
-  fTree->Branch("trkid",trkid,"trkid[ntracks_reco]/I");
-  fTree->Branch("trkstartx",trkstartx,"trkstartx[ntracks_reco]/F");
-  fTree->Branch("trkstarty",trkstarty,"trkstarty[ntracks_reco]/F");
-  fTree->Branch("trkstartz",trkstartz,"trkstartz[ntracks_reco]/F");
-  fTree->Branch("trkendx",trkendx,"trkendx[ntracks_reco]/F");
-  fTree->Branch("trkendy",trkendy,"trkendy[ntracks_reco]/F");
-  fTree->Branch("trkendz",trkendz,"trkendz[ntracks_reco]/F");
-  fTree->Branch("trkstartdcosx",trkstartdcosx,"trkstartdcosx[ntracks_reco]/F");
-  fTree->Branch("trkstartdcosy",trkstartdcosy,"trkstartdcosy[ntracks_reco]/F");
-  fTree->Branch("trkstartdcosz",trkstartdcosz,"trkstartdcosz[ntracks_reco]/F");
-  fTree->Branch("trkenddcosx",trkenddcosx,"trkenddcosx[ntracks_reco]/F");
-  fTree->Branch("trkenddcosy",trkenddcosy,"trkenddcosy[ntracks_reco]/F");
-  fTree->Branch("trkenddcosz",trkenddcosz,"trkenddcosz[ntracks_reco]/F");
-  fTree->Branch("trklen",trklen,"trklen[ntracks_reco]/F");
-  fTree->Branch("trkbestplane",trkbestplane,"trkbestplane[ntracks_reco]/I");
-  fTree->Branch("trkmomrange",trkmomrange,"trkmomrange[ntracks_reco]/F");
-  fTree->Branch("trkke",trkke,"trkke[ntracks_reco][3]/F");
-  fTree->Branch("trkpida",trkpida,"trkpida[ntracks_reco][3]/F");
-  fTree->Branch("trkg4id",trkg4id,"trkg4id[ntracks_reco]/I");
-  fTree->Branch("trkg4pdg",trkg4pdg,"trkg4pdg[ntracks_reco]/I");
-  fTree->Branch("trkg4startx",trkg4startx,"trkg4startx[ntracks_reco]/F");
-  fTree->Branch("trkg4starty",trkg4starty,"trkg4starty[ntracks_reco]/F");
-  fTree->Branch("trkg4startz",trkg4startz,"trkg4startz[ntracks_reco]/F");
-  fTree->Branch("trkg4initdedx",trkg4initdedx,"trkg4initdedx[ntracks_reco]/F");
-  fTree->Branch("nshws",&nshws,"nshws/I");
-  fTree->Branch("shwid",shwid,"shwid[nshws]/I");
-  fTree->Branch("shwdcosx",shwdcosx,"shwdcosx[nshws]/F");
-  fTree->Branch("shwdcosy",shwdcosy,"shwdcosy[nshws]/F");
-  fTree->Branch("shwdcosz",shwdcosz,"shwdcosz[nshws]/F");
-  fTree->Branch("shwstartx",shwstartx,"shwstartx[nshws]/F");
-  fTree->Branch("shwstarty",shwstarty,"shwstarty[nshws]/F");
-  fTree->Branch("shwstartz",shwstartz,"shwstartz[nshws]/F");
-  fTree->Branch("shwenergy",shwenergy,"shwenergy[nshws][3]/F");
-  fTree->Branch("shwdedx",shwdedx,"shwdedx[nshws][3]/F");
-  fTree->Branch("shwbestplane",shwbestplane,"shwbestplane[nshws]/I");
-  fTree->Branch("shwg4id",shwg4id,"shwg4id[nshws]/I");
-  fTree->Branch("flash_total"  ,&flash_total ,"flash_total/I");
-  fTree->Branch("flash_time"   ,flash_time   ,"flash_time[flash_total]/F");
-  fTree->Branch("flash_width"  ,flash_width  ,"flash_width[flash_total]/F");
-  fTree->Branch("flash_abstime",flash_abstime,"flash_abstime[flash_total]/F");
-  fTree->Branch("flash_YCenter",flash_YCenter,"flash_YCenter[flash_total]/F");
-  fTree->Branch("flash_YWidth" ,flash_YWidth ,"flash_YWidth[flash_total]/F");
-  fTree->Branch("flash_ZCenter",flash_ZCenter,"flash_ZCenter[flash_total]/F");
-  fTree->Branch("flash_ZWidth" ,flash_ZWidth ,"flash_ZWidth[flash_total]/F");
-  fTree->Branch("flash_TotalPE",flash_TotalPE,"flash_TotalPE[flash_total]/F");
-  fTree->Branch("nhits",&nhits,"nhits/I");
-  fTree->Branch("nhits_stored",&nhits_stored,"nhits_stored/I");
-  fTree->Branch("hit_plane",hit_plane,"hit_plane[nhits_stored]/S");
-  fTree->Branch("hit_tpc",hit_tpc,"hit_tpc[nhits_stored]/S");
-  fTree->Branch("hit_wire",hit_wire,"hit_wire[nhits_stored]/S");
-  fTree->Branch("hit_channel",hit_channel,"hit_channel[nhits_stored]/I");
-  fTree->Branch("hit_peakT",hit_peakT,"hit_peakT[nhits_stored]/F");
-  fTree->Branch("hit_charge",hit_charge,"hit_charge[nhits_stored]/F");
-  fTree->Branch("hit_summedADC",hit_summedADC,"hit_summedADC[nhits_stored]/F");
-  fTree->Branch("hit_startT",hit_startT,"hit_startT[nhits_stored]/F");
-  fTree->Branch("hit_endT",hit_endT,"hit_endT[nhits_stored]/F");
-  fTree->Branch("hit_trkkey",hit_trkkey,"hit_trkkey[nhits_stored]/I");
-  fTree->Branch("hit_dQds",hit_dQds,"hit_dQds[nhits_stored]/F");
-  fTree->Branch("hit_dEds",hit_dEds,"hit_dEds[nhits_stored]/F");
-  fTree->Branch("hit_resrange",hit_resrange,"hit_resrange[nhits_stored]/F");
-  fTree->Branch("hit_shwkey",hit_shwkey,"hit_shwkey[nhits_stored]/I");
-  fTree->Branch("infidvol",&infidvol,"infidvol/I");
-  fTree->Branch("nvtx",&nvtx,"nvtx/S");
-  fTree->Branch("vtx",vtx,"vtx[nvtx][3]/F");
-  fTree->Branch("vtxrecomc",&vtxrecomc,"vtxrecomc/F");
-  fTree->Branch("vtxrecomcx",&vtxrecomcx,"vtxrecomcx/F");
-  fTree->Branch("vtxrecomcy",&vtxrecomcy,"vtxrecomcy/F");
-  fTree->Branch("vtxrecomcz",&vtxrecomcz,"vtxrecomcz/F");
-  fTree->Branch("mcevts_truth",&mcevts_truth,"mcevts_truth/I");
-  fTree->Branch("nuPDG_truth",&nuPDG_truth,"nuPDG_truth/I");
-  fTree->Branch("ccnc_truth",&ccnc_truth,"ccnc_truth/I");
-  fTree->Branch("mode_truth",&mode_truth,"mode_truth/I");
-  fTree->Branch("enu_truth",&enu_truth,"enu_truth/F");
-  fTree->Branch("Q2_truth",&Q2_truth,"Q2_truth/F");
-  fTree->Branch("W_truth",&W_truth,"W_truth/F");
-  fTree->Branch("X_truth",&X_truth,"X_truth/F");
-  fTree->Branch("Y_truth",&Y_truth,"Y_truth/F");
-  fTree->Branch("hitnuc_truth",&hitnuc_truth,"hitnuc_truth/I");
-  fTree->Branch("target_truth",&target_truth,"target_truth/I");
-  fTree->Branch("nuvtxx_truth",&nuvtxx_truth,"nuvtxx_truth/F");
-  fTree->Branch("nuvtxy_truth",&nuvtxy_truth,"nuvtxy_truth/F");
-  fTree->Branch("nuvtxz_truth",&nuvtxz_truth,"nuvtxz_truth/F");
-  fTree->Branch("nu_dcosx_truth",&nu_dcosx_truth,"nu_dcosx_truth/F");
-  fTree->Branch("nu_dcosy_truth",&nu_dcosy_truth,"nu_dcosy_truth/F");
-  fTree->Branch("nu_dcosz_truth",&nu_dcosz_truth,"nu_dcosz_truth/F");
-  fTree->Branch("lep_mom_truth",&lep_mom_truth,"lep_mom_truth/F");
-  fTree->Branch("lep_dcosx_truth",&lep_dcosx_truth,"lep_dcosx_truth/F");
-  fTree->Branch("lep_dcosy_truth",&lep_dcosy_truth,"lep_dcosy_truth/F");
-  fTree->Branch("lep_dcosz_truth",&lep_dcosz_truth,"lep_dcosz_truth/F");
-  fTree->Branch("t0_truth",&t0_truth,"t0_truth/F");
-  fTree->Branch("no_primaries",&no_primaries,"no_primaries/I");
-  fTree->Branch("geant_list_size",&geant_list_size,"geant_list_size/I");
-  fTree->Branch("pdg",pdg,"pdg[geant_list_size]/I");
-  fTree->Branch("Eng",Eng,"Eng[geant_list_size]/F");
-  fTree->Branch("Px",Px,"Px[geant_list_size]/F");
-  fTree->Branch("Py",Py,"Py[geant_list_size]/F");
-  fTree->Branch("Pz",Pz,"Pz[geant_list_size]/F");
-  fTree->Branch("StartPointx",StartPointx,"StartPointx[geant_list_size]/F");
-  fTree->Branch("StartPointy",StartPointy,"StartPointy[geant_list_size]/F");
-  fTree->Branch("StartPointz",StartPointz,"StartPointz[geant_list_size]/F");
-  fTree->Branch("EndPointx",EndPointx,"EndPointx[geant_list_size]/F");
-  fTree->Branch("EndPointy",EndPointy,"EndPointy[geant_list_size]/F");
-  fTree->Branch("EndPointz",EndPointz,"EndPointz[geant_list_size]/F");
-  fTree->Branch("Startdcosx",Startdcosx,"Startdcosx[geant_list_size]/F");
-  fTree->Branch("Startdcosy",Startdcosy,"Startdcosy[geant_list_size]/F");
-  fTree->Branch("Startdcosz",Startdcosz,"Startdcosz[geant_list_size]/F");
-  fTree->Branch("NumberDaughters",NumberDaughters,"NumberDaughters[geant_list_size]/I");
-  fTree->Branch("Mother",Mother,"Mother[geant_list_size]/I");
-  fTree->Branch("TrackId",TrackId,"TrackId[geant_list_size]/I");
-  fTree->Branch("process_primary",process_primary,"process_primary[geant_list_size]/I");
-  fTree->Branch("G4Process",&G4Process);//,"G4Process[geant_list_size]");
-  fTree->Branch("G4FinalProcess",&G4FinalProcess);//,"G4FinalProcess[geant_list_size]");
-  fTree->Branch("ptype_flux",&ptype_flux,"ptype_flux/I");
-  fTree->Branch("pdpx_flux",&pdpx_flux,"pdpx_flux/F");
-  fTree->Branch("pdpy_flux",&pdpy_flux,"pdpy_flux/F");
-  fTree->Branch("pdpz_flux",&pdpz_flux,"pdpz_flux/F");
-  fTree->Branch("pntype_flux",&pntype_flux,"pntype_flux/I");
-  fTree->Branch("vx_flux",&vx_flux,"vx_flux/F");
-  fTree->Branch("vy_flux",&vy_flux,"vy_flux/F");
-  fTree->Branch("vz_flux",&vz_flux,"vz_flux/F");
+  if (fSaveTracks){
+    fTree->Branch("ntracks_reco",&ntracks_reco,"ntracks_reco/I");
+    fTree->Branch("trkid",trkid,"trkid[ntracks_reco]/I");
+    fTree->Branch("trkstartx",trkstartx,"trkstartx[ntracks_reco]/F");
+    fTree->Branch("trkstarty",trkstarty,"trkstarty[ntracks_reco]/F");
+    fTree->Branch("trkstartz",trkstartz,"trkstartz[ntracks_reco]/F");
+    fTree->Branch("trkendx",trkendx,"trkendx[ntracks_reco]/F");
+    fTree->Branch("trkendy",trkendy,"trkendy[ntracks_reco]/F");
+    fTree->Branch("trkendz",trkendz,"trkendz[ntracks_reco]/F");
+    fTree->Branch("trkstartdcosx",trkstartdcosx,"trkstartdcosx[ntracks_reco]/F");
+    fTree->Branch("trkstartdcosy",trkstartdcosy,"trkstartdcosy[ntracks_reco]/F");
+    fTree->Branch("trkstartdcosz",trkstartdcosz,"trkstartdcosz[ntracks_reco]/F");
+    fTree->Branch("trkenddcosx",trkenddcosx,"trkenddcosx[ntracks_reco]/F");
+    fTree->Branch("trkenddcosy",trkenddcosy,"trkenddcosy[ntracks_reco]/F");
+    fTree->Branch("trkenddcosz",trkenddcosz,"trkenddcosz[ntracks_reco]/F");
+    fTree->Branch("trklen",trklen,"trklen[ntracks_reco]/F");
+    fTree->Branch("trkbestplane",trkbestplane,"trkbestplane[ntracks_reco]/I");
+    fTree->Branch("trkmomrange",trkmomrange,"trkmomrange[ntracks_reco]/F");
+    fTree->Branch("trkke",trkke,"trkke[ntracks_reco][3]/F");
+    fTree->Branch("trkpida",trkpida,"trkpida[ntracks_reco][3]/F");
+  }
+  if (fSaveTracks && fSaveRecoTruthMatch){
+    fTree->Branch("trkg4id",trkg4id,"trkg4id[ntracks_reco]/I");
+    fTree->Branch("trkg4pdg",trkg4pdg,"trkg4pdg[ntracks_reco]/I");
+    fTree->Branch("trkg4startx",trkg4startx,"trkg4startx[ntracks_reco]/F");
+    fTree->Branch("trkg4starty",trkg4starty,"trkg4starty[ntracks_reco]/F");
+    fTree->Branch("trkg4startz",trkg4startz,"trkg4startz[ntracks_reco]/F");
+    fTree->Branch("trkg4initdedx",trkg4initdedx,"trkg4initdedx[ntracks_reco]/F");
+  }
+  if (fSaveShowers){
+    fTree->Branch("nshws",&nshws,"nshws/I");
+    fTree->Branch("shwid",shwid,"shwid[nshws]/I");
+    fTree->Branch("shwdcosx",shwdcosx,"shwdcosx[nshws]/F");
+    fTree->Branch("shwdcosy",shwdcosy,"shwdcosy[nshws]/F");
+    fTree->Branch("shwdcosz",shwdcosz,"shwdcosz[nshws]/F");
+    fTree->Branch("shwstartx",shwstartx,"shwstartx[nshws]/F");
+    fTree->Branch("shwstarty",shwstarty,"shwstarty[nshws]/F");
+    fTree->Branch("shwstartz",shwstartz,"shwstartz[nshws]/F");
+    fTree->Branch("shwenergy",shwenergy,"shwenergy[nshws][3]/F");
+    fTree->Branch("shwdedx",shwdedx,"shwdedx[nshws][3]/F");
+    fTree->Branch("shwbestplane",shwbestplane,"shwbestplane[nshws]/I");
+  }
+  if (fSaveShowers && fSaveRecoTruthMatch){
+    fTree->Branch("shwg4id",shwg4id,"shwg4id[nshws]/I");
+  }
+  if (fSaveFlashes){
+    fTree->Branch("flash_total"  ,&flash_total ,"flash_total/I");
+    fTree->Branch("flash_time"   ,flash_time   ,"flash_time[flash_total]/F");
+    fTree->Branch("flash_width"  ,flash_width  ,"flash_width[flash_total]/F");
+    fTree->Branch("flash_abstime",flash_abstime,"flash_abstime[flash_total]/F");
+    fTree->Branch("flash_YCenter",flash_YCenter,"flash_YCenter[flash_total]/F");
+    fTree->Branch("flash_YWidth" ,flash_YWidth ,"flash_YWidth[flash_total]/F");
+    fTree->Branch("flash_ZCenter",flash_ZCenter,"flash_ZCenter[flash_total]/F");
+    fTree->Branch("flash_ZWidth" ,flash_ZWidth ,"flash_ZWidth[flash_total]/F");
+    fTree->Branch("flash_TotalPE",flash_TotalPE,"flash_TotalPE[flash_total]/F");
+  }
+  if (fSaveHits){
+    fTree->Branch("nhits",&nhits,"nhits/I");
+    fTree->Branch("nhits_stored",&nhits_stored,"nhits_stored/I");
+    fTree->Branch("hit_plane",hit_plane,"hit_plane[nhits_stored]/S");
+    fTree->Branch("hit_tpc",hit_tpc,"hit_tpc[nhits_stored]/S");
+    fTree->Branch("hit_wire",hit_wire,"hit_wire[nhits_stored]/S");
+    fTree->Branch("hit_channel",hit_channel,"hit_channel[nhits_stored]/I");
+    fTree->Branch("hit_peakT",hit_peakT,"hit_peakT[nhits_stored]/F");
+    fTree->Branch("hit_charge",hit_charge,"hit_charge[nhits_stored]/F");
+    fTree->Branch("hit_summedADC",hit_summedADC,"hit_summedADC[nhits_stored]/F");
+    fTree->Branch("hit_startT",hit_startT,"hit_startT[nhits_stored]/F");
+    fTree->Branch("hit_endT",hit_endT,"hit_endT[nhits_stored]/F");
+    fTree->Branch("hit_trkkey",hit_trkkey,"hit_trkkey[nhits_stored]/I");
+    fTree->Branch("hit_dQds",hit_dQds,"hit_dQds[nhits_stored]/F");
+    fTree->Branch("hit_dEds",hit_dEds,"hit_dEds[nhits_stored]/F");
+    fTree->Branch("hit_resrange",hit_resrange,"hit_resrange[nhits_stored]/F");
+    fTree->Branch("hit_shwkey",hit_shwkey,"hit_shwkey[nhits_stored]/I");
+  }
+  if (fSaveMCTruth){
+    fTree->Branch("infidvol",&infidvol,"infidvol/I");
+  }
+  if (fSaveVertices){
+    fTree->Branch("nvtx",&nvtx,"nvtx/S");
+    fTree->Branch("vtx",vtx,"vtx[nvtx][3]/F");
+  }
+  if (fSaveVertices && fSaveMCTruth){
+    fTree->Branch("vtxrecomc",&vtxrecomc,"vtxrecomc/F");
+    fTree->Branch("vtxrecomcx",&vtxrecomcx,"vtxrecomcx/F");
+    fTree->Branch("vtxrecomcy",&vtxrecomcy,"vtxrecomcy/F");
+    fTree->Branch("vtxrecomcz",&vtxrecomcz,"vtxrecomcz/F");
+  }
+  if (fSaveMCTruth){
+    fTree->Branch("mcevts_truth",&mcevts_truth,"mcevts_truth/I");
+    fTree->Branch("nuPDG_truth",&nuPDG_truth,"nuPDG_truth/I");
+    fTree->Branch("ccnc_truth",&ccnc_truth,"ccnc_truth/I");
+    fTree->Branch("mode_truth",&mode_truth,"mode_truth/I");
+    fTree->Branch("enu_truth",&enu_truth,"enu_truth/F");
+    fTree->Branch("Q2_truth",&Q2_truth,"Q2_truth/F");
+    fTree->Branch("W_truth",&W_truth,"W_truth/F");
+    fTree->Branch("X_truth",&X_truth,"X_truth/F");
+    fTree->Branch("Y_truth",&Y_truth,"Y_truth/F");
+    fTree->Branch("hitnuc_truth",&hitnuc_truth,"hitnuc_truth/I");
+    fTree->Branch("target_truth",&target_truth,"target_truth/I");
+    fTree->Branch("nuvtxx_truth",&nuvtxx_truth,"nuvtxx_truth/F");
+    fTree->Branch("nuvtxy_truth",&nuvtxy_truth,"nuvtxy_truth/F");
+    fTree->Branch("nuvtxz_truth",&nuvtxz_truth,"nuvtxz_truth/F");
+    fTree->Branch("nu_dcosx_truth",&nu_dcosx_truth,"nu_dcosx_truth/F");
+    fTree->Branch("nu_dcosy_truth",&nu_dcosy_truth,"nu_dcosy_truth/F");
+    fTree->Branch("nu_dcosz_truth",&nu_dcosz_truth,"nu_dcosz_truth/F");
+    fTree->Branch("lep_mom_truth",&lep_mom_truth,"lep_mom_truth/F");
+    fTree->Branch("lep_dcosx_truth",&lep_dcosx_truth,"lep_dcosx_truth/F");
+    fTree->Branch("lep_dcosy_truth",&lep_dcosy_truth,"lep_dcosy_truth/F");
+    fTree->Branch("lep_dcosz_truth",&lep_dcosz_truth,"lep_dcosz_truth/F");
+    fTree->Branch("t0_truth",&t0_truth,"t0_truth/F");
+  }
+  if (fSaveGeant){
+    fTree->Branch("no_primaries",&no_primaries,"no_primaries/I");
+    fTree->Branch("geant_list_size",&geant_list_size,"geant_list_size/I");
+    fTree->Branch("pdg",pdg,"pdg[geant_list_size]/I");
+    fTree->Branch("Eng",Eng,"Eng[geant_list_size]/F");
+    fTree->Branch("Px",Px,"Px[geant_list_size]/F");
+    fTree->Branch("Py",Py,"Py[geant_list_size]/F");
+    fTree->Branch("Pz",Pz,"Pz[geant_list_size]/F");
+    fTree->Branch("StartPointx",StartPointx,"StartPointx[geant_list_size]/F");
+    fTree->Branch("StartPointy",StartPointy,"StartPointy[geant_list_size]/F");
+    fTree->Branch("StartPointz",StartPointz,"StartPointz[geant_list_size]/F");
+    fTree->Branch("EndPointx",EndPointx,"EndPointx[geant_list_size]/F");
+    fTree->Branch("EndPointy",EndPointy,"EndPointy[geant_list_size]/F");
+    fTree->Branch("EndPointz",EndPointz,"EndPointz[geant_list_size]/F");
+    fTree->Branch("Startdcosx",Startdcosx,"Startdcosx[geant_list_size]/F");
+    fTree->Branch("Startdcosy",Startdcosy,"Startdcosy[geant_list_size]/F");
+    fTree->Branch("Startdcosz",Startdcosz,"Startdcosz[geant_list_size]/F");
+    fTree->Branch("NumberDaughters",NumberDaughters,"NumberDaughters[geant_list_size]/I");
+    fTree->Branch("Mother",Mother,"Mother[geant_list_size]/I");
+    fTree->Branch("TrackId",TrackId,"TrackId[geant_list_size]/I");
+    fTree->Branch("process_primary",process_primary,"process_primary[geant_list_size]/I");
+    fTree->Branch("G4Process",&G4Process);//,"G4Process[geant_list_size]");
+    fTree->Branch("G4FinalProcess",&G4FinalProcess);//,"G4FinalProcess[geant_list_size]");
+  }
+  if (fSaveMCTruth){
+    fTree->Branch("ptype_flux",&ptype_flux,"ptype_flux/I");
+    fTree->Branch("pdpx_flux",&pdpx_flux,"pdpx_flux/F");
+    fTree->Branch("pdpy_flux",&pdpy_flux,"pdpy_flux/F");
+    fTree->Branch("pdpz_flux",&pdpz_flux,"pdpz_flux/F");
+    fTree->Branch("pntype_flux",&pntype_flux,"pntype_flux/I");
+    fTree->Branch("vx_flux",&vx_flux,"vx_flux/F");
+    fTree->Branch("vy_flux",&vy_flux,"vy_flux/F");
+    fTree->Branch("vz_flux",&vz_flux,"vz_flux/F");
+  }
+
+  // Larger baskets and flushes make fewer, better compressed writes; a negative auto flush is a size in bytes
+  if (fTreeBasketSize > 0)
+    fTree->SetBasketSize("*", fTreeBasketSize);
+  if (fTreeAutoFlush != 0)
+    fTree->SetAutoFlush(fTreeAutoFlush);
 
   fPOT = tfs->make<TTree>("pottree","pot tree");
   fPOT->Branch("pot",&pot,"pot/D");
@@ -982,8 +1055,9 @@ void dunefd::NueAna::ResetVars(){
   taulife = 0;
   isdata = -9999;
 
+  // Only the arrays of the groups written are reset, the hit and Geant4 ones are large
   ntracks_reco = 0;
-  for (int i = 0; i < kMaxTrack; ++i){
+  for (int i = 0; fSaveTracks && i < kMaxTrack; ++i){
     trkid[i] = -9999;
     trkstartx[i] = -9999;
     trkstarty[i] = -9999;
@@ -1013,7 +1087,7 @@ void dunefd::NueAna::ResetVars(){
   }
 
   nshws = 0;
-  for (int i = 0; i<kMaxShower; ++i){
+  for (int i = 0; fSaveShowers && i<kMaxShower; ++i){
     shwid[i] = -9999;
     shwdcosx[i] = -9999;
     shwdcosy[i] = -9999;
@@ -1030,7 +1104,7 @@ void dunefd::NueAna::ResetVars(){
   }
 
   flash_total = 0;
-  for (int f = 0; f < kMaxFlash; ++f) {
+  for (int f = 0; fSaveFlashes && f < kMaxFlash; ++f) {
     flash_time[f]    = -9999;
     flash_width[f]   = -9999;
     flash_abstime[f] = -9999;
@@ -1043,7 +1117,7 @@ void dunefd::NueAna::ResetVars(){
 
   nhits = 0;
   nhits_stored = 0;
-  for (int i = 0; i<kMaxHits; ++i){
+  for (int i = 0; fSaveHits && i<kMaxHits; ++i){
     hit_plane[i] = -9999;
     hit_wire[i] = -9999;
     hit_tpc[i] = -9999;
@@ -1062,7 +1136,7 @@ void dunefd::NueAna::ResetVars(){
 
   infidvol = 0;
   nvtx = 0;
-  for (int i = 0; i<kMaxVertices; ++i){
+  for (int i = 0; fSaveVertices && i<kMaxVertices; ++i){
     vtx[i][0] = -9999;
     vtx[i][1] = -9999;
     vtx[i][2] = -9999;
@@ -1097,7 +1171,7 @@ void dunefd::NueAna::ResetVars(){
 
   no_primaries = -99999;
   geant_list_size=-9999;
-  for (int i = 0; i<kMaxPrimaries; ++i){
+  for (int i = 0; fSaveGeant && i<kMaxPrimaries; ++i){
     pdg[i] = -99999;
     Eng[i] = -99999;
     Px[i] = -99999;
@@ -1145,6 +1219,16 @@ void dunefd::NueAna::reconfigure(fhicl::ParameterSet const & p)
   fPOTModuleLabel      =   p.get< std::string >("POTModuleLabel"); 
   fFlashModuleLabel    =   p.get< std::string >("FlashModuleLabel");
   fCalorimetryModuleLabel = p.get< std::string >("CalorimetryModuleLabel");
+  fSaveHits            =   p.get< bool >("SaveHits", true);
+  fSaveTracks          =   p.get< bool >("SaveTracks", true);
+  fSaveShowers         =   p.get< bool >("SaveShowers", true);
+  fSaveVertices        =   p.get< bool >("SaveVertices", true);
+  fSaveFlashes         =   p.get< bool >("SaveFlashes", true);
+  fSaveRecoTruthMatch  =   p.get< bool >("SaveRecoTruthMatch", true);
+  fSaveMCTruth         =   p.get< bool >("SaveMCTruth", true);
+  fSaveGeant           =   p.get< bool >("SaveGeant", true);
+  fTreeBasketSize      =   p.get< Int_t >("TreeBasketSize", 0);
+  fTreeAutoFlush       =   p.get< Long64_t >("TreeAutoFlush", 0);
   return;
 }
 
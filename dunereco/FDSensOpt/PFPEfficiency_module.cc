@@ -27,11 +27,13 @@
 #include "lardataobj/RecoBase/Cluster.h"
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
+#include "dunereco/AnaUtils/DUNEAnaContingencyMatrix.h"
 #include "TH1D.h"
 #include "TEfficiency.h"
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace dune {
   class PFPEfficiency;
@@ -81,6 +83,10 @@ private:
 
   bool insideFV(double vertex[4]);
 
+  // Eve track ID depositing the most energy in the hit, 0 if it is not
+  // a particle of the inventory
+  int EveTrackID(art::Ptr<recob::Hit> const& hit) const;
+
   //efficiency
   TH1D *h_den[6];
   TH1D *h_num[6];
@@ -173,88 +179,49 @@ void dune::PFPEfficiency::analyze(art::Event const& event)
   // Get hit-cluster association
   art::FindManyP<recob::Hit> fmhc(cluListHandle, event, fPFPModuleLabel);
 
-  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
   art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
 
-  std::map<int, int> hitmap;
+  // Collection plane hits each true particle shares with each PFParticle,
+  // filled in one pass over the event hits and one over the PFParticle hits.
+  // The eve track ID of each event hit, 0 if none, is kept by key for the
+  // PFParticle hits
+  dune_ana::DUNEAnaContingencyMatrix matrix(pfpList.size());
+  std::vector<int> hitTrackIDs(hitlist.size(), 0);
 
   for (auto const& hit : hitlist){
     if (hit->WireID().Plane!=2) continue;
-    std::map<int,double> trkide;
-    std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToEveTrackIDEs(hit);
-    for(size_t e = 0; e < TrackIDs.size(); ++e){
-      trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
-    } 
-    double maxe = -1;
-    double tote = 0;
-    int TrackID = 0;
-    for (std::map<int,double>::iterator ii = trkide.begin(); ii!=trkide.end(); ++ii){
-      tote += ii->second;
-      if ((ii->second)>maxe){
-        maxe = ii->second;
-        TrackID = ii->first;
-      }
-    }
-    const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackID);
-    if (particle){
-      ++hitmap[TrackID];
+    const int TrackID = EveTrackID(hit);
+    hitTrackIDs[hit.key()] = TrackID;
+    if (TrackID){
+      matrix.FillTrue(TrackID);
     }
   }
 
-  std::map<int, float> completeness;
-  std::map<int, float> purity;
-
-  for (size_t i = 0; i<pfpList.size(); ++i){
-    std::map<int, int> hitmap0;
-    if (fmcpfp.isValid()){
-      // Get clusters associated with pfparticle
-      auto const& clusters = fmcpfp.at(i);
-      for (auto const & cluster : clusters){
-        if (fmhc.isValid()){
-          // Get hits associated with cluster
-          auto const& hits = fmhc.at(cluster.key());
-          //auto const& hits = hitsFromSlice.at(sliceid);
-          //std::cout<<hits.size()<<std::endl;
-          for (auto const& hit : hits){
-            if (hit->WireID().Plane!=2) continue;
-            std::map<int,double> trkide;
-            std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToEveTrackIDEs(hit);
-            for(size_t e = 0; e < TrackIDs.size(); ++e){
-              trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
-            } 
-            double maxe = -1;
-            double tote = 0;
-            int TrackID = 0;
-            for (std::map<int,double>::iterator ii = trkide.begin(); ii!=trkide.end(); ++ii){
-              tote += ii->second;
-              if ((ii->second)>maxe){
-                maxe = ii->second;
-                TrackID = ii->first;
-              }
-            }
-            const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackID);
-            if (particle){
-              ++hitmap0[TrackID];
-            }
+  if (fmcpfp.isValid() && fmhc.isValid()){
+    for (size_t i = 0; i<pfpList.size(); ++i){
+      // Get clusters associated with pfparticle, and their hits
+      for (auto const & cluster : fmcpfp.at(i)){
+        for (auto const& hit : fmhc.at(cluster.key())){
+          if (hit->WireID().Plane!=2) continue;
+          const int TrackID = (hit.key() < hitTrackIDs.size() && hit.id() == hitListHandle.id()) ?
+            hitTrackIDs[hit.key()] : EveTrackID(hit);
+          if (TrackID){
+            matrix.Fill(TrackID, i);
           }
         }
       }
     }
-    int maxhits = -1;
-    int tothits = 0;
-    int TrackID = 0;
-    for (std::map<int,int>::iterator ii = hitmap0.begin(); ii!=hitmap0.end(); ++ii){
-      tothits += ii->second;
-      if ((ii->second)>maxhits){
-        maxhits = ii->second;
-        TrackID = ii->first;
-      }
-    }
+  }
+
+  // Best PFParticle of each true particle, by completeness times purity
+  std::map<int, float> completeness;
+  std::map<int, float> purity;
+
+  for (size_t i = 0; i<matrix.NReco(); ++i){
+    const int TrackID = matrix.BestTrue(i).first;
     if (TrackID){
-      double new_completeness = 1.0*maxhits/hitmap[TrackID];
-      double new_purity = 1.0*maxhits/tothits;
-      //const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackID);
-      //if (particle->PdgCode() == 13) std::cout<<new_completeness<<" "<<new_purity<<std::endl;
+      double new_completeness = matrix.Completeness(TrackID, i);
+      double new_purity = matrix.Purity(TrackID, i);
       if (new_completeness*new_purity > completeness[TrackID]*purity[TrackID]){ 
         completeness[TrackID] = new_completeness;
         purity[TrackID] = new_purity;
@@ -283,6 +250,28 @@ void dune::PFPEfficiency::analyze(art::Event const& event)
   }
 }
 
+int dune::PFPEfficiency::EveTrackID(art::Ptr<recob::Hit> const& hit) const
+{
+  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
+  art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
+
+  std::map<int,double> trkide;
+  std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToEveTrackIDEs(hit);
+  for(size_t e = 0; e < TrackIDs.size(); ++e){
+    trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
+  }
+  double maxe = -1;
+  int TrackID = 0;
+  for (std::map<int,double>::iterator ii = trkide.begin(); ii!=trkide.end(); ++ii){
+    if ((ii->second)>maxe){
+      maxe = ii->second;
+      TrackID = ii->first;
+    }
+  }
+  const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackID);
+  return particle ? TrackID : 0;
+}
+
 void dune::PFPEfficiency::beginJob(){
   // Get geometry.
   auto const* geo = lar::providerFrom<geo::Geometry>();
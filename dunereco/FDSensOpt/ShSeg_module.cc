@@ -50,6 +50,7 @@
 #include "larreco/RecoAlg/PMAlg/Utilities.h"
 #include "larreco/RecoAlg/PMAlg/PmaTrack3D.h"
 
+#include <memory>
 #include <random>
 
 #include "TTree.h"
@@ -104,7 +105,7 @@ private:
 
 	bool BuildSegMC(art::Event & e);
 
-	std::vector< pma::Track3D* > fPmatracks;
+	std::vector< std::unique_ptr< pma::Track3D > > fPmatracks;
   
 	double fFidVolCut;
 	double fR0; double fR1; 
@@ -192,7 +193,7 @@ void dunefd::ShSeg::produce(art::Event & e)
 		for (size_t i = 0; i < 6; i++) sp_err[i] = 1.0;
 
 		fTrkindex = 0;
-		for (auto trk : fPmatracks)
+		for (auto const & trk : fPmatracks)
 		{
 			tracks->push_back(ConvertFrom(*trk));
 			fTrkindex++;
@@ -237,8 +238,7 @@ void dunefd::ShSeg::produce(art::Event & e)
 				}
 			}
 
-		// data prods done, delete all pma::Track3D's
-		for (size_t t = 0; t < fPmatracks.size(); t++) delete fPmatracks[t];
+		// data prods done, drop all pma::Track3D's
 		fPmatracks.clear();
 	}
 
@@ -338,7 +338,8 @@ bool dunefd::ShSeg::BuildSegMC(art::Event & e)
 	// try to build seg, it is based on MC truth 
 	size_t tpc = tpcid.TPC;
         size_t cryo = geom->PositionToCryostatID(geo::vect::toPoint(firstpoint)).Cryostat;
-	pma::Track3D* iniseg = new pma::Track3D();
+	// owned here until it is kept, so the early returns below do not leak it
+	auto iniseg = std::make_unique< pma::Track3D >();
         iniseg->AddNode(detProp, firstpoint, tpc, cryo);
         iniseg->AddNode(detProp, secondpoint, tpc, cryo);
 
@@ -372,13 +373,15 @@ bool dunefd::ShSeg::BuildSegMC(art::Event & e)
 	
 	for (size_t view = 0; view < tpcgeo.Nplanes(); ++view) 
 	{
-		std::map< size_t, std::vector< double > > ex;
-		iniseg->GetRawdEdxSequence(ex, view);
-	
 		TVector2 proj_i = pma::GetProjectionToPlane(firstpoint, view, tpc, cryo); 
 		TVector2 proj_f = pma::GetProjectionToPlane(secondpoint, view, tpc, cryo); 
 		double dist = std::sqrt(pma::Dist2(proj_i, proj_f));
-		if ((dist > maxdist) && (ex.size() > 0))
+		if (dist <= maxdist) continue;
+
+		// the dE/dx sequence is only needed to see the view is not empty, so it is made for the candidates alone
+		std::map< size_t, std::vector< double > > ex;
+		iniseg->GetRawdEdxSequence(ex, view);
+		if (ex.size() > 0)
 		{
 			maxdist = dist;
 			bestview = view;
@@ -386,12 +389,13 @@ bool dunefd::ShSeg::BuildSegMC(art::Event & e)
 	}
 
 	
-	fPmatracks.push_back(iniseg);
+	pma::Track3D* seg = iniseg.get();
+	fPmatracks.push_back(std::move(iniseg));
 	/************************************/
 	
-        iniseg->CompleteMissingWires(detProp, bestview);
+        seg->CompleteMissingWires(detProp, bestview);
 	std::map< size_t, std::vector< double > > dedx;
-	iniseg->GetRawdEdxSequence(dedx, bestview);
+	seg->GetRawdEdxSequence(dedx, bestview);
 	double sumdx = 0.0; fDedxavg = 0.0;
 
 	double rmin = 1.0e9;
@@ -119,13 +119,39 @@ namespace dune::apa {
     fChannelRange[0] = (fLastU-fFirstU + 1)*fGeom->WirePitch(geo::kU);
     fChannelRange[1] = (fLastV-fFirstV + 1)*fGeom->WirePitch(geo::kV);
 
+    fChannelWires.clear();
+    fChannelViews.clear();
+    fChannelIntersects.clear();
+
+  }
+
+
+  //----------------------------------------------------------
+  const std::vector<geo::WireID>& APAGeometryAlg::ChannelWires( uint32_t chan ){
+
+    auto it = fChannelWires.find(chan);
+    if( it == fChannelWires.end() )
+      it = fChannelWires.emplace( chan, fGeom->ChannelToWire(chan) ).first;
+    return it->second;
+
+  }
+
+
+  //----------------------------------------------------------
+  geo::View_t APAGeometryAlg::ChannelView( uint32_t chan ){
+
+    auto it = fChannelViews.find(chan);
+    if( it == fChannelViews.end() )
+      it = fChannelViews.emplace( chan, fGeom->View(chan) ).first;
+    return it->second;
+
   }
 
 
   //----------------------------------------------------------
   void APAGeometryAlg::ChannelToAPA( uint32_t chan, 
 				     unsigned int & apa, 
-				     unsigned int & cryo){
+				     unsigned int & cryo) const {
 
     cryo  =  chan / (fAPAsPerCryo*fChannelsPerAPA);
 
@@ -139,7 +165,7 @@ namespace dune::apa {
   }
 
   //----------------------------------------------------------
-  unsigned int APAGeometryAlg::ChannelToAPA( uint32_t chan ){
+  unsigned int APAGeometryAlg::ChannelToAPA( uint32_t chan ) const {
 
     return chan / fChannelsPerAPA;
   }
@@ -207,7 +233,7 @@ namespace dune::apa {
   //----------------------------------------------------------
   uint32_t APAGeometryAlg::FirstChannelInView( uint32_t chan ){
 
-    geo::View_t geoview = fGeom->View(chan);
+    geo::View_t geoview = this->ChannelView(chan);
     unsigned int apa, cryo;
     this->ChannelToAPA( chan, apa, cryo );
     return this->FirstChannelInView( geoview, chan );
@@ -232,7 +258,7 @@ namespace dune::apa {
     // it seems trivial to do this for U and V, but this gives a side to
     // geo::kZ, unlike Geometry::View(c), as is often needed in disambiguation
 
-    geo::View_t view = fGeom->View( chan );
+    geo::View_t view = this->ChannelView( chan );
     switch(view){
     default       :  
       break;
@@ -255,8 +281,7 @@ namespace dune::apa {
   //----------------------------------------------------------
   std::vector<geo::WireID> APAGeometryAlg::ChanSegsPerSide(uint32_t chan, unsigned int side){
 
-    std::vector<geo::WireID> wids = fGeom->ChannelToWire(chan);
-    return this->ChanSegsPerSide(wids, side);
+    return this->ChanSegsPerSide(this->ChannelWires(chan), side);
 
   }
 
@@ -287,7 +312,7 @@ namespace dune::apa {
 						    unsigned int const cstat   )
   {
 
-    std::vector<geo::WireID> cWids = fGeom->ChannelToWire( chan );
+    const std::vector<geo::WireID>& cWids = this->ChannelWires( chan );
 
     if( cWids[0].Cryostat != cstat ) 
       throw cet::exception("APAGeometryAlg") << "Channel " << chan 
@@ -297,7 +322,7 @@ namespace dune::apa {
 					     << "not in APA " << std::floor(tpc/2) << "\n";
 
     // special case for vertical wires
-    if(fGeom->View(chan)==geo::kZ) return fGeom->ChannelToWire(chan)[0];
+    if(this->ChannelView(chan)==geo::kZ) return cWids[0];
 
     unsigned int xyzWire = fGeom->NearestWireID( geo::vect::toPoint(WorldLoc),
                                                  geo::PlaneID{cstat, tpc, plane} ).Wire;
@@ -330,7 +355,7 @@ namespace dune::apa {
     auto const tpcID = fGeom->PositionToTPCID(toPoint((xyzStart + xyzEnd) * 0.5));
 
     // Find the nearest wire number to the line segment endpoints
-    std::vector<geo::WireID> wids = fGeom->ChannelToWire(chan);
+    const std::vector<geo::WireID>& wids = this->ChannelWires(chan);
     geo::PlaneID const planeID{tpcID, wids[0].Plane};
     unsigned int startW = fGeom->NearestWireID( toPoint(xyzStart), planeID ).Wire;
     unsigned int endW   = fGeom->NearestWireID( toPoint(xyzEnd),   planeID ).Wire;
@@ -376,11 +401,11 @@ namespace dune::apa {
     std::vector< geo::WireIDIntersection > UVIntersects;
     this->APAChannelsIntersect( u, v, UVIntersects );
     std::vector< double > UVzToZ(UVIntersects.size());
-    geo::WireID Zwid = fGeom->ChannelToWire(z)[0];
+    geo::WireID Zwid = this->ChannelWires(z)[0];
     unsigned int cryo = Zwid.Cryostat;
     unsigned int tpc = Zwid.TPC;
-    std::vector<geo::WireID> Uwids = fGeom->ChannelToWire(u);
-    std::vector<geo::WireID> Vwids = fGeom->ChannelToWire(v);
+    const std::vector<geo::WireID>& Uwids = this->ChannelWires(u);
+    const std::vector<geo::WireID>& Vwids = this->ChannelWires(v);
     std::vector<geo::WireID> UwidsInTPC, VwidsInTPC;
     for(size_t i=0; i<Uwids.size(); i++) if( Uwids[i].TPC==tpc ) UwidsInTPC.push_back(Uwids[i]);
     for(size_t i=0; i<Vwids.size(); i++) if( Vwids[i].TPC==tpc ) VwidsInTPC.push_back(Vwids[i]);
@@ -493,10 +518,10 @@ namespace dune::apa {
     
     // Get the WireIDs and view for each channel, make sure views are different
     geo::WireIDIntersection    widIntersect;
-    std::vector< geo::WireID > wids1 = fGeom->ChannelToWire( chan1 );
-    std::vector< geo::WireID > wids2 = fGeom->ChannelToWire( chan2 );
-    geo::View_t                view1 = fGeom->View( chan1 );
-    geo::View_t                view2 = fGeom->View( chan2 );
+    const std::vector< geo::WireID >& wids1 = this->ChannelWires( chan1 );
+    const std::vector< geo::WireID >& wids2 = this->ChannelWires( chan2 );
+    geo::View_t                view1 = this->ChannelView( chan1 );
+    geo::View_t                view2 = this->ChannelView( chan2 );
     if( view1 == view2 ){
       mf::LogWarning("APAChannelsIntersect") << "Comparing two channels in the same view, return false";
       return false;     }
@@ -512,9 +537,14 @@ namespace dune::apa {
  
 
     // Loop through wids1 and see if wids2 has any intersecting wires, 
-    // given that the WireIDs are in the same TPC
-    for( unsigned int i1 = 0; i1 < wids1.size() ; i1++){
-      for( unsigned int i2 = 0; i2 < wids2.size() ; i2++){
+    // given that the WireIDs are in the same TPC. The intersections of
+    // each channel pair are only computed the first time it is asked for
+    const uint64_t pairKey = ( uint64_t(chan1) << 32 ) | chan2;
+    auto cached = fChannelIntersects.find(pairKey);
+    if( cached == fChannelIntersects.end() ){
+      std::vector< geo::WireIDIntersection > pairIntersects;
+      for( unsigned int i1 = 0; i1 < wids1.size() ; i1++){
+        for( unsigned int i2 = 0; i2 < wids2.size() ; i2++){
 
 	// make sure it is reasonable to intersect
 	if( wids1[i1].Plane    == wids2[i2].Plane ||
@@ -533,10 +563,13 @@ namespace dune::apa {
 
 //	  std::cout << "we have an intersect" << std::endl;
 
-	  IntersectVector.push_back( widIntersect );
+	  pairIntersects.push_back( widIntersect );
 	}
+        }
       }
+      cached = fChannelIntersects.emplace( pairKey, std::move(pairIntersects) ).first;
     }
+    IntersectVector.insert( IntersectVector.end(), cached->second.begin(), cached->second.end() );
 
     // Of all considered configurations, there are never more than 
     // 4 intersections per channel pair
@@ -5,6 +5,8 @@
 #ifndef APAGeometryALG_H
 #define APAGeometryALG_H
 #include <vector>
+#include <unordered_map>
+#include <utility>
 #include <cmath>
 #include <iostream>
 #include <stdint.h>
@@ -72,10 +74,10 @@ namespace dune::apa {
 					      unsigned int const tpc=0, 
 					      unsigned int const cstat=0);
 
-    unsigned int         ChannelToAPA(uint32_t chan);  ///< Get number of the APA containing the given channel 
+    unsigned int         ChannelToAPA(uint32_t chan) const;  ///< Get number of the APA containing the given channel 
     void                 ChannelToAPA(         uint32_t chan, 
 				               unsigned int & apa, 
-					       unsigned int & cryo);
+					       unsigned int & cryo) const;
     APAView_t            APAView(uint32_t chan);       ///< Get which of the 4 APA views the channel is in
     unsigned int         ChannelsInView( geo::View_t geoview );
     uint32_t             FirstChannelInView(   geo::View_t geoview, 
@@ -90,6 +92,9 @@ namespace dune::apa {
 
   private:
 
+    const std::vector<geo::WireID>& ChannelWires(uint32_t chan);  ///< ChannelToWire, looked up once per channel
+    geo::View_t          ChannelView(uint32_t chan);   ///< View, looked up once per channel
+
     art::ServiceHandle<geo::Geometry> fGeom;           // handle to geometry service
 
     unsigned int fChannelsPerAPA;                      ///< All APAs have this same number of channels
@@ -107,6 +112,11 @@ namespace dune::apa {
 
     double fChannelRange[2]; // for each induction view: U=0, V=1
 
+    // geometry answers kept for the channels seen so far
+    std::unordered_map< uint32_t, std::vector<geo::WireID> > fChannelWires;
+    std::unordered_map< uint32_t, geo::View_t >              fChannelViews;
+    std::unordered_map< uint64_t, std::vector<geo::WireIDIntersection> > fChannelIntersects; ///< keyed by (chan1 << 32) | chan2
+
   }; // class APAGeometryAlg
 
 } // namespace apa
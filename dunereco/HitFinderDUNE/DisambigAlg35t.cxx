@@ -31,7 +31,9 @@
 #include "larcorealg/Geometry/PlaneGeo.h"
 #include "larcorealg/Geometry/WireGeo.h"
 #include "DisambigAlg35t.h"
+#include "DisambigTimeIndex.h"
 #include "larevt/Filters/ChannelFilter.h"
+#include "dunereco/Profiling/ProfScope.h"
 
 #include <map>
 #include <cmath>
@@ -62,6 +64,9 @@ namespace dune{
                                    detinfo::DetectorPropertiesData const& detProp,
                                    const std::vector< art::Ptr<recob::Hit> > &OrigHits   )
   {
+    DUNE_PROF_SCOPE("dune::DisambigAlg35t::RunDisambig");
+    DUNE_PROF_COUNT("dune::DisambigAlg35t::RunDisambig hits", OrigHits.size());
+
     fDisambigHits.clear();
 
     art::ServiceHandle<geo::Geometry> geo;
@@ -125,6 +130,38 @@ namespace dune{
     std::vector<std::vector<unsigned int> > bestwireidu(ntpc);
     std::vector<std::vector<unsigned int> > bestwireidv(ntpc);
 
+    //Geometry of every U and V hit, looked up once
+    std::vector<std::vector<unsigned int> > apaUV(2);
+    std::vector<std::vector<std::vector<geo::WireID> > > wiresUV(2);
+    //U and V hits of each APA sorted by peak time
+    std::vector<std::map<unsigned int, DisambigTimeIndex> > timeIndexUV(2);
+    for (size_t i = 0; i<2; ++i){
+      for (size_t hit = 0; hit<hitsUV[i].size(); ++hit){
+        unsigned int apa(0), cryo(0);
+        fAPAGeo.ChannelToAPA(hitsUV[i][hit]->Channel(), apa, cryo);
+        apaUV[i].push_back(apa);
+        wiresUV[i].push_back(geo->ChannelToWire(hitsUV[i][hit]->Channel()));
+        timeIndexUV[i][apa].Add(hitsUV[i][hit]->PeakTime(), hit);
+      }
+      for (auto& index : timeIndexUV[i]) index.second.Sort();
+    }
+
+    //Wire crossings of a pair of wire segments
+    struct Crossing{
+      bool intersect;
+      geo::WireIDIntersection widi;
+    };
+    //U-V crossings of all wire segment pairs, keyed by (U channel, V channel)
+    std::map<std::pair<raw::ChannelID_t, raw::ChannelID_t>, std::vector<Crossing> > crossingsUV;
+    //Crossings with the current Z wire, per candidate U or V hit
+    std::vector<std::vector<Crossing> > crossingsUZ;
+    std::vector<std::vector<Crossing> > crossingsVZ;
+    //Candidate U and V hits of the current Z hit
+    std::vector<unsigned int> candu;
+    std::vector<unsigned int> candv;
+    //Margin on the time windows, the exact cut is applied to the candidates
+    const double timeMargin = 1.e-3;
+
     //Look for triplets of U,V,Z hits that are common in time
     //Try all possible wire segments for U and V hits and 
     //see if U, V, Z wires cross
@@ -137,36 +174,73 @@ namespace dune{
         - detProp.GetXTicksOffset(hitsZ[z]->WireID().Plane,
                                    hitsZ[z]->WireID().TPC,
                                    hitsZ[z]->WireID().Cryostat);
+      double offsetu = detProp.GetXTicksOffset(0,
+                                                hitsZ[z]->WireID().TPC,
+                                                hitsZ[z]->WireID().Cryostat);
+      double offsetv = detProp.GetXTicksOffset(1,
+                                                hitsZ[z]->WireID().TPC,
+                                                hitsZ[z]->WireID().Cryostat);
+
+      //u and v hits of the same APA within the time cut, in hit order
+      candu.clear();
+      candv.clear();
+      auto indexu = timeIndexUV[0].find(apaz);
+      auto indexv = timeIndexUV[1].find(apaz);
+      if (indexu!=timeIndexUV[0].end())
+        indexu->second.Window(tz+offsetu-fTimeCut-timeMargin, tz+offsetu+fTimeCut+timeMargin, candu);
+      if (indexv!=timeIndexUV[1].end())
+        indexv->second.Window(tz+offsetv-fTimeCut-timeMargin, tz+offsetv+fTimeCut+timeMargin, candv);
+      if (candu.empty() || candv.empty()) continue;
+
+      geo::WireID zwire = geo->ChannelToWire(hitsZ[z]->Channel())[0];
+      crossingsUZ.assign(candu.size(), std::vector<Crossing>());
+      crossingsVZ.assign(candv.size(), std::vector<Crossing>());
+
+      //crossings of the wire segments of a hit with the z wire, computed on first use
+      auto crossingsWithZ = [&](const std::vector<geo::WireID> &wires, std::vector<Crossing> &crossings) -> const std::vector<Crossing>& {
+        if (crossings.empty()){
+          crossings.resize(wires.size(), Crossing{false, geo::WireIDIntersection()});
+          for (size_t w = 0; w<wires.size(); ++w){
+            if (wires[w].TPC!=zwire.TPC) continue;
+            crossings[w].intersect = geo->WireIDsIntersect(zwire,wires[w],crossings[w].widi);
+          }
+        }
+        return crossings;
+      };
+
       //loop over u hits
       bool findmatch = false;
-      for (size_t u = 0; u<hitsUV[0].size() && !findmatch; ++u){
+      for (size_t iu = 0; iu<candu.size() && !findmatch; ++iu){
+        const unsigned int u = candu[iu];
         if (fHasBeenDisambigedUV[0].find(u)!=fHasBeenDisambigedUV[0].end()) continue;
-        unsigned int apau(0), cryou(0);
-        fAPAGeo.ChannelToAPA(hitsUV[0][u]->Channel(), apau, cryou);
-        if (apau!=apaz) continue;
-        double tu = hitsUV[0][u]->PeakTime()
-          - detProp.GetXTicksOffset(0,
-                                     hitsZ[z]->WireID().TPC,
-                                     hitsZ[z]->WireID().Cryostat);
+        double tu = hitsUV[0][u]->PeakTime() - offsetu;
        
         if (std::abs(tu-tz)<fTimeCut){
           //find a matched u hit, loop over v hits
-          for (size_t v = 0; v<hitsUV[1].size(); ++v){
+          for (size_t iv = 0; iv<candv.size(); ++iv){
+            const unsigned int v = candv[iv];
             if (fHasBeenDisambigedUV[1].find(v)!=fHasBeenDisambigedUV[1].end()) continue;
-            unsigned int apav(0), cryov(0);
-            fAPAGeo.ChannelToAPA(hitsUV[1][v]->Channel(), apav, cryov);
-            if (apav!=apaz) continue;
-            double tv = hitsUV[1][v]->PeakTime()
-              - detProp.GetXTicksOffset(1,
-                                         hitsZ[z]->WireID().TPC,
-                                         hitsZ[z]->WireID().Cryostat);
+            double tv = hitsUV[1][v]->PeakTime() - offsetv;
     
             if (std::abs(tv-tz)<fTimeCut){
 	    
               //find a matched v hit, see if the 3 wire segments cross
-              geo::WireID zwire = geo->ChannelToWire(hitsZ[z]->Channel())[0];
-              std::vector<geo::WireID>  uwires = geo->ChannelToWire(hitsUV[0][u]->Channel());
-              std::vector<geo::WireID>  vwires = geo->ChannelToWire(hitsUV[1][v]->Channel());
+              const std::vector<geo::WireID> &uwires = wiresUV[0][u];
+              const std::vector<geo::WireID> &vwires = wiresUV[1][v];
+              const std::vector<Crossing> &uzcross = crossingsWithZ(uwires, crossingsUZ[iu]);
+              const std::vector<Crossing> &vzcross = crossingsWithZ(vwires, crossingsVZ[iv]);
+
+              std::vector<Crossing> &uvcross = crossingsUV[std::make_pair(hitsUV[0][u]->Channel(), hitsUV[1][v]->Channel())];
+              if (uvcross.empty()){
+                uvcross.resize(uwires.size()*vwires.size(), Crossing{false, geo::WireIDIntersection()});
+                for (size_t uw = 0; uw<uwires.size(); ++uw){
+                  for (size_t vw = 0; vw<vwires.size(); ++vw){
+                    if (uwires[uw].TPC!=vwires[vw].TPC) continue;
+                    Crossing &crossing = uvcross[uw*vwires.size()+vw];
+                    crossing.intersect = geo->WireIDsIntersect(uwires[uw],vwires[vw],crossing.widi);
+                  }
+                }
+              }
 	    
               unsigned int totalintersections = 0;
               unsigned int bestu = 0;  //index to wires associated with channel
@@ -174,17 +248,17 @@ namespace dune{
 
               for (size_t uw = 0; uw<uwires.size(); ++uw){
                 for (size_t vw = 0; vw<vwires.size(); ++vw){
-                  geo::WireIDIntersection widiuv;
-                  geo::WireIDIntersection widiuz;
-                  geo::WireIDIntersection widivz;
-
                   if (uwires[uw].TPC!=vwires[vw].TPC) continue;
                   if (uwires[uw].TPC!=zwire.TPC) continue;
                   if (vwires[vw].TPC!=zwire.TPC) continue;
 
-                  if (!geo->WireIDsIntersect(zwire,uwires[uw],widiuz)) continue;
-                  if (!geo->WireIDsIntersect(zwire,vwires[vw],widivz)) continue;
-                  if (!geo->WireIDsIntersect(uwires[uw],vwires[vw],widiuv)) continue;
+                  if (!uzcross[uw].intersect) continue;
+                  if (!vzcross[vw].intersect) continue;
+                  if (!uvcross[uw*vwires.size()+vw].intersect) continue;
+
+                  const geo::WireIDIntersection &widiuz = uzcross[uw].widi;
+                  const geo::WireIDIntersection &widivz = vzcross[vw].widi;
+                  const geo::WireIDIntersection &widiuv = uvcross[uw*vwires.size()+vw].widi;
 
                   double dis1 = sqrt(pow(widiuz.y-widivz.y,2)+pow(widiuz.z-widivz.z,2));
                   double dis2 = sqrt(pow(widiuz.y-widiuv.y,2)+pow(widiuz.z-widiuv.z,2));
@@ -433,18 +507,16 @@ namespace dune{
     for (size_t i = 0; i<2; ++i){//loop over U and V hits
       for (size_t hit = 0; hit<hitsUV[i].size(); ++hit){
         if (fHasBeenDisambigedUV[i].find(hit)!=fHasBeenDisambigedUV[i].end()) continue;
-        unsigned int apa1(0), cryo1(0);
-        fAPAGeo.ChannelToAPA(hitsUV[i][hit]->Channel(), apa1, cryo1);
+        unsigned int apa1 = apaUV[i][hit];
         //unsigned int channdiff = 100000;
         //geo::WireID nearestwire;
-        std::vector<geo::WireID> wires = geo->ChannelToWire(hitsUV[i][hit]->Channel());
+        const std::vector<geo::WireID> &wires = wiresUV[i][hit];
         //std::vector<double> disttoallhits(wires.size(),-1);
         std::vector<int> nearbyhits(wires.size(),-1);
         for (auto& u2 : fHasBeenDisambigedUV[i]){
-          unsigned int apa2(0), cryo2(0);
-          fAPAGeo.ChannelToAPA(hitsUV[i][u2.first]->Channel(), apa2, cryo2);
+          unsigned int apa2 = apaUV[i][u2.first];
           if (apa1!=apa2) continue;
-          geo::WireID hitwire = geo->ChannelToWire(hitsUV[i][u2.first]->Channel())[u2.second-1];
+          geo::WireID hitwire = wiresUV[i][u2.first][u2.second-1];
           double wire_pitch = geo->WirePitch(hitwire.asPlaneID());    //wire pitch in cm
           for (size_t w = 0; w<wires.size(); ++w){
             if (wires[w].TPC!= hitwire.TPC) continue;
@@ -34,6 +34,7 @@
 #include "larcorealg/Geometry/WireGeo.h"
 #include "DisambigAlgProtoDUNESP.h"
 #include "larevt/Filters/ChannelFilter.h"
+#include "dunereco/Profiling/ProfScope.h"
 
 #include <map>
 #include <cmath>
@@ -44,9 +45,12 @@
 
 #include "TH1D.h"
 
+#include "tbb/parallel_for.h"
+
 namespace dune{
 
   DisambigAlgProtoDUNESP::DisambigAlgProtoDUNESP(fhicl::ParameterSet const& pset)
+    : fGeom(&*(art::ServiceHandle<geo::Geometry const>()))
   {
     this->reconfigure(pset); 
   }
@@ -58,6 +62,7 @@ namespace dune{
     fTimeCut = p.get<double>("TimeCut");
     fDistanceCut = p.get<double>("DistanceCut");
     fDcut2 = fDistanceCut * fDistanceCut;
+    fPlacement = dune::numa::PlacementFromPSet(p);
   }
 
 
@@ -66,16 +71,57 @@ namespace dune{
   void DisambigAlgProtoDUNESP::RunDisambig(detinfo::DetectorPropertiesData const& detProp,
                                            const std::vector< art::Ptr<recob::Hit> > &OrigHits   )
   {
-    fDisambigHits.clear();
+    fDisambigHits = this->Disambiguate(detProp, OrigHits, false);
+  }
+
+  //----------------------------------------------------------
+  DisambigAlgProtoDUNESP::DisambigHits_t
+  DisambigAlgProtoDUNESP::Disambiguate(detinfo::DetectorPropertiesData const& detProp,
+                                      const std::vector< art::Ptr<recob::Hit> > &OrigHits,
+                                      bool parallel ) const
+  {
+    DUNE_PROF_SCOPE("dune::DisambigAlgProtoDUNESP::RunDisambig");
+    DUNE_PROF_COUNT("dune::DisambigAlgProtoDUNESP::RunDisambig hits", OrigHits.size());
+
+    // the APAs do not share hits, so each one is done on its own
+    // and the results are put back together in APA order
 
-    art::ServiceHandle<geo::Geometry> geo;
+    std::vector< std::vector< art::Ptr<recob::Hit> > > apaHits = this->HitsPerAPA(OrigHits);
+    std::vector< DisambigHits_t > apaResults(apaHits.size());
 
-    size_t napas = geo->NTPC()/2;
+    auto runAPA = [&](size_t apa){ apaResults[apa] = this->DisambigAPA(detProp, apa, apaHits[apa]); };
+    if (parallel) dune::numa::Execute(fPlacement, [&]{ tbb::parallel_for(size_t(0), apaHits.size(), runAPA); });
+    else for (size_t apa=0; apa<apaHits.size(); apa++) runAPA(apa);
+
+    DisambigHits_t result;
+    for (auto & hits : apaResults) result.insert(result.end(), hits.begin(), hits.end());
+    return result;
+  }
 
-    // do only one APA at a time.
+  //----------------------------------------------------------
+  std::vector< std::vector< art::Ptr<recob::Hit> > >
+  DisambigAlgProtoDUNESP::HitsPerAPA( const std::vector< art::Ptr<recob::Hit> > &OrigHits ) const
+  {
+    size_t napas = fGeom->NTPC()/2;
 
-    for (size_t apa=0; apa<napas; apa++)
+    std::vector< std::vector< art::Ptr<recob::Hit> > > apaHits(napas);
+    for (size_t i = 0; i<OrigHits.size(); ++i)
       {
+	unsigned int hitapa(0), hitcryo(0);
+	fAPAGeo.ChannelToAPA(OrigHits[i]->Channel(), hitapa, hitcryo);
+	if (hitapa < napas) apaHits[hitapa].push_back(OrigHits[i]);
+      }
+    return apaHits;
+  }
+
+  //----------------------------------------------------------
+  DisambigAlgProtoDUNESP::DisambigHits_t
+  DisambigAlgProtoDUNESP::DisambigAPA(detinfo::DetectorPropertiesData const& detProp,
+                                     size_t apa,
+                                     const std::vector< art::Ptr<recob::Hit> > &APAHits ) const
+  {
+    DUNE_PROF_SCOPE("dune::DisambigAlgProtoDUNESP::DisambigAPA");
+    DisambigHits_t result;
 
 	int tpc = longTPC(apa); // for purposes of evaluating time offsets for time matching.
 	//tick offsets differ for the even and odd TPC's
@@ -92,49 +138,44 @@ namespace dune{
 
 	//std::cout << "Dumping hits for this APA" << std::endl;
 
-	for (size_t i = 0; i<OrigHits.size(); ++i)
-	  {
-	    unsigned int hitapa(0), hitcryo(0);
-	    fAPAGeo.ChannelToAPA(OrigHits[i]->Channel(), hitapa, hitcryo);
-	    if (apa == hitapa)
+	for (size_t i = 0; i<APAHits.size(); ++i)
 	      {
-		//std::cout << *OrigHits[i] << std::endl;
+		//std::cout << *APAHits[i] << std::endl;
 
-		switch (OrigHits[i]->View())
+		switch (APAHits[i]->View())
 		  {
 		  case geo::kU:
-		    hitsUV[0].push_back(OrigHits[i]);
-		    //      if (OrigHits[i]->WireID().TPC==1) 
-		    //	histu->Fill(OrigHits[i]->PeakTime()
+		    hitsUV[0].push_back(APAHits[i]);
+		    //      if (APAHits[i]->WireID().TPC==1) 
+		    //	histu->Fill(APAHits[i]->PeakTime()
 		    //		    - detProp.GetXTicksOffset(0,
 		    //					       tpc,
 		    //					       cryostat)
-		    //		    ,OrigHits[i]->Charge());
+		    //		    ,APAHits[i]->Charge());
 
 		    break;
 		  case geo::kV:
-		    hitsUV[1].push_back(OrigHits[i]);
-		    //      if (OrigHits[i]->WireID().TPC==1) 
-		    //	histv->Fill(OrigHits[i]->PeakTime()
+		    hitsUV[1].push_back(APAHits[i]);
+		    //      if (APAHits[i]->WireID().TPC==1) 
+		    //	histv->Fill(APAHits[i]->PeakTime()
 		    //		    - detProp.GetXTicksOffset(1,
 		    //					       tpc,
 		    //					       cryostat)
-		    //		    ,OrigHits[i]->Charge());
+		    //		    ,APAHits[i]->Charge());
 		    break;
 		  case geo::kZ:
-		    hitsZ.push_back(OrigHits[i]);
-		    //      if (OrigHits[i]->WireID().TPC==1) 
-		    //	histz->Fill(OrigHits[i]->PeakTime()
+		    hitsZ.push_back(APAHits[i]);
+		    //      if (APAHits[i]->WireID().TPC==1) 
+		    //	histz->Fill(APAHits[i]->PeakTime()
 		    //		    - detProp.GetXTicksOffset(2,
 		    //					       tpc,
 		    //					       cryostat)
-		    //		    ,OrigHits[i]->Charge());
+		    //		    ,APAHits[i]->Charge());
 		    break;
 		  default:
 		    throw cet::exception("DisambigAlgProtoDUNESP") <<": hit view unkonwn. \n";
 		  }
 	      }
-	  }
 
 	//  std::cout << " DisambigAlgProtoDUNESP timing means: " <<histu->GetMean()<<" "<<histv->GetMean()<<" "<<histz->GetMean()<<std::endl;
 	//  delete histu;
@@ -200,7 +241,7 @@ namespace dune{
 		std::vector< double > othermatchz;
 		std::vector< double > othermatchy;
 
-		std::vector<geo::WireID>  wires = geo->ChannelToWire(hitsUV[uv][iuv]->Channel());
+		std::vector<geo::WireID>  wires = fGeom->ChannelToWire(hitsUV[uv][iuv]->Channel());
 		size_t wsize = wires.size();
 		std::vector<size_t> ndoublets(wsize,0);
 		std::vector<size_t> ntriplets(wsize,0);
@@ -214,11 +255,11 @@ namespace dune{
 		      {
 			for (size_t z=0; z<zmatches.size(); z++)
 			  {
-			    geo::WireID zwire = geo->ChannelToWire(hitsZ[zmatches[z]]->Channel())[0];
+			    geo::WireID zwire = fGeom->ChannelToWire(hitsZ[zmatches[z]]->Channel())[0];
 			    if ( notOuterWire(zwire) )  // we really shouldn't have any hits on the outer z wires
 			      {
 			        geo::WireIDIntersection isect;
-			        if (geo->WireIDsIntersect(zwire,uvwire,isect))
+			        if (fGeom->WireIDsIntersect(zwire,uvwire,isect))
 			          {
 				    zmatchz.push_back(isect.z);
 				    zmatchy.push_back(isect.y);
@@ -228,14 +269,14 @@ namespace dune{
 			// There is at most one intersection of the u channel with a v channel. Still have to loop over possibilities though.
 			for (size_t iother=0; iother<othermatches.size(); iother++)
 			  {
-			    std::vector<geo::WireID>  otherwires = geo->ChannelToWire(hitsUV[other][othermatches[iother]]->Channel());
+			    std::vector<geo::WireID>  otherwires = fGeom->ChannelToWire(hitsUV[other][othermatches[iother]]->Channel());
 			    for (size_t otherw = 0; otherw < otherwires.size(); otherw++)
 			      {
 				geo::WireID otherwire = otherwires[otherw];
 				if (notOuterWire(otherwire))
 				  {
 				    geo::WireIDIntersection isect;
-				    if (geo->WireIDsIntersect(otherwire,uvwire,isect))
+				    if (fGeom->WireIDsIntersect(otherwire,uvwire,isect))
 				      {
 					othermatchz.push_back(isect.z);
 					othermatchy.push_back(isect.y);
@@ -299,7 +340,7 @@ namespace dune{
 		  }
 		if (found_disambig)
 		  {
-		    fDisambigHits.push_back(std::pair<art::Ptr<recob::Hit>, geo::WireID>(hitsUV[uv][iuv],wires[bestwire]));
+		    result.push_back(std::pair<art::Ptr<recob::Hit>, geo::WireID>(hitsUV[uv][iuv],wires[bestwire]));
 		  }
 		else
 		  {
@@ -309,13 +350,13 @@ namespace dune{
 
 	      } // end loop over induction hits in this plane
 	  } // end loop over induction planes 
-      } // end loop over APA's
+    return result;
   }
 
 // method to tell us whether a particular wire is in an outer TPC.  Hardcoded outer TPC numbers.
 // might be quicker to check the lowest two bits: 00 or 11 mean outer TPC.
 
-  bool DisambigAlgProtoDUNESP::notOuterWire(geo::WireID wireid)
+  bool DisambigAlgProtoDUNESP::notOuterWire(geo::WireID wireid) const
   {
     auto tpc = wireid.TPC;
     bool result;
@@ -330,7 +371,7 @@ namespace dune{
     return(result);
   }
 
-  int DisambigAlgProtoDUNESP::longTPC(int apa)
+  int DisambigAlgProtoDUNESP::longTPC(int apa) const
   {
     int tpc=0;
 
@@ -28,6 +28,7 @@
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/Cluster.h"
 #include "APAGeometryAlg.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
 namespace detinfo {
   class DetectorPropertiesData;
 }
@@ -48,25 +49,42 @@ namespace dune{
     
     void               reconfigure(fhicl::ParameterSet const& p);
 
+    typedef std::vector< std::pair<art::Ptr<recob::Hit>, geo::WireID> > DisambigHits_t;
+
     void               RunDisambig(detinfo::DetectorPropertiesData const& detProp,
                                    const std::vector< art::Ptr<recob::Hit> > &OrigHits );
-                                                                  ///< Run disambiguation as currently configured
+                                                                  ///< Run disambiguation as currently configured, results in fDisambigHits
+
+    DisambigHits_t     Disambiguate(detinfo::DetectorPropertiesData const& detProp,
+                                    const std::vector< art::Ptr<recob::Hit> > &OrigHits,
+                                    bool parallel ) const;
+                                                                  ///< Same as RunDisambig but returns the hits, APAs optionally run in parallel
+
+    std::vector< std::vector< art::Ptr<recob::Hit> > > HitsPerAPA( const std::vector< art::Ptr<recob::Hit> > &OrigHits ) const;
+                                                                  ///< Hits split by APA, in their original order
+
+    DisambigHits_t     DisambigAPA(detinfo::DetectorPropertiesData const& detProp,
+                                   size_t apa,
+                                   const std::vector< art::Ptr<recob::Hit> > &APAHits ) const;
+                                                                  ///< Disambiguate the hits of one APA, safe to call concurrently
 
 
-    std::vector< std::pair<art::Ptr<recob::Hit>, geo::WireID> > fDisambigHits;
+    DisambigHits_t fDisambigHits;
                                                                    ///< The final list of hits to pass back to be made
 
     private:
 
-    bool notOuterWire(geo::WireID wireid);
+    bool notOuterWire(geo::WireID wireid) const;
 
-    int longTPC(int apa);
+    int longTPC(int apa) const;
 
     // other classes we will use
+    geo::GeometryCore const*   fGeom;
     dune::apa::APAGeometryAlg  fAPAGeo;
     double fTimeCut;
     double fDistanceCut;
     double fDcut2;
+    dune::numa::PlacementConfig fPlacement; ///< NUMA node of the parallel APAs
   }; // class DisambigAlgProtoDUNESP
 
 } // namespace dune
@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////////
+//
+// DisambigBenchmark class
+//
+// Replays the undisambiguated hits of each event through several
+// disambiguation algorithms and records, per algorithm, the time taken,
+// the growth of the peak resident memory and the fraction of induction
+// hits put on the right wire, checked against a cheated disambiguation.
+// This is the cost/correctness comparison disambigcheck can not give,
+// since that one only sees the output of a single algorithm.
+//
+// The algorithms need the geometry and detector services, so the hits are
+// replayed from an art file rather than outside the framework. The
+// DisambigFromSpacePoints module starts from spacepoints instead of hits
+// and is not one of the algorithms.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Framework includes
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// LArSoft Includes
+#include "lardataobj/RecoBase/Hit.h"
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+
+#include "dunereco/Profiling/ProfRegistry.h"
+
+#include "DisambigAlg35t.h"
+#include "DisambigAlgProtoDUNESP.h"
+#include "TimeBasedDisambig.h"
+
+// ROOT Includes
+#include "TTree.h"
+
+namespace dune {
+
+  class DisambigBenchmark : public art::EDAnalyzer
+  {
+
+  public:
+
+    explicit DisambigBenchmark(fhicl::ParameterSet const& pset);
+
+    void analyze(const art::Event& evt) override;
+    void beginJob() override;
+    void endJob() override;
+
+  private:
+
+    typedef std::vector< std::pair<art::Ptr<recob::Hit>, geo::WireID> > DisambigHits_t;
+
+    // Totals of one algorithm over the job
+    struct Summary {
+      unsigned int nEvents = 0;
+      double totalMs = 0.;
+      double maxMs = 0.;
+      double peakRSSGrowthMB = 0.;
+      unsigned long correct = 0, incorrect = 0, missed = 0;
+    };
+
+    DisambigHits_t RunAlgorithm(const std::string& alg, const art::Event& evt,
+                                const std::vector< art::Ptr<recob::Hit> >& hits);
+
+    /// Count the cheated induction hits found on the same wire, on another
+    /// wire, or not at all. Hits are matched by channel and peak time
+    void Check(const DisambigHits_t& disambigHits,
+               const std::vector< art::Ptr<recob::Hit> >& cheatHits,
+               unsigned int& correct, unsigned int& incorrect, unsigned int& missed) const;
+
+    std::string fChanHitLabel;
+    std::string fChanHitCheater;
+    std::vector<std::string> fAlgorithms;
+    bool fParallelAPAs;
+    double fPeakTimeTolerance;
+
+    DisambigAlg35t         fDisambigAlg;
+    TimeBasedDisambig      fTimeBasedDisambigAlg;
+    DisambigAlgProtoDUNESP fProtoDUNESPDisambigAlg;
+
+    std::vector<Summary> fSummaries;
+
+    TTree* fTree;
+    unsigned int fRun, fSubRun, fEvent;
+    unsigned int fAlg;
+    unsigned int fNHits, fNDisambigHits;
+    double fTimeMs, fPeakRSSGrowthMB;
+    unsigned int fCorrect, fIncorrect, fMissed;
+  };
+
+  //-------------------------------------------------
+  DisambigBenchmark::DisambigBenchmark(fhicl::ParameterSet const& pset)
+    : EDAnalyzer(pset)
+    , fChanHitLabel(pset.get< std::string >("ChanHitLabel"))
+    , fChanHitCheater(pset.get< std::string >("ChanHitCheater", ""))
+    , fAlgorithms(pset.get< std::vector<std::string> >("Algorithms"))
+    , fParallelAPAs(pset.get< bool >("ParallelAPAs", false))
+    , fPeakTimeTolerance(pset.get< double >("PeakTimeTolerance", 0.1))
+    , fDisambigAlg(pset.get< fhicl::ParameterSet >("DisambigAlg"))
+    , fTimeBasedDisambigAlg(pset.get< fhicl::ParameterSet >("TimeBasedDisambigAlg"))
+    , fProtoDUNESPDisambigAlg(pset.get< fhicl::ParameterSet >("ProtoDUNESPDisambigAlg"))
+    , fSummaries(fAlgorithms.size())
+  {
+    for (const std::string& alg : fAlgorithms)
+      if (alg != "TripletMatch" && alg != "TimeBased" && alg != "ProtoDUNESP")
+        throw cet::exception("DisambigBenchmark") << "Disambiguation algorithm name: " << alg << " is not supported.\n";
+  }
+
+  //-------------------------------------------------
+  void DisambigBenchmark::beginJob()
+  {
+    art::ServiceHandle<art::TFileService> tfs;
+    fTree = tfs->make<TTree>("benchmark", "Disambiguation cost and correctness per event and algorithm");
+    fTree->Branch("run", &fRun);
+    fTree->Branch("subrun", &fSubRun);
+    fTree->Branch("event", &fEvent);
+    fTree->Branch("alg", &fAlg);  // index in Algorithms
+    fTree->Branch("nHits", &fNHits);
+    fTree->Branch("nDisambigHits", &fNDisambigHits);
+    fTree->Branch("timeMs", &fTimeMs);
+    fTree->Branch("peakRSSGrowthMB", &fPeakRSSGrowthMB);
+    fTree->Branch("correct", &fCorrect);
+    fTree->Branch("incorrect", &fIncorrect);
+    fTree->Branch("missed", &fMissed);
+  }
+
+  //-------------------------------------------------
+  DisambigBenchmark::DisambigHits_t DisambigBenchmark::RunAlgorithm(const std::string& alg, const art::Event& evt,
+                                                                    const std::vector< art::Ptr<recob::Hit> >& hits)
+  {
+    if (alg == "TimeBased") {
+      // This one appends to its results
+      fTimeBasedDisambigAlg.fDisambigHits.clear();
+      fTimeBasedDisambigAlg.RunDisambig(hits);
+      return std::move(fTimeBasedDisambigAlg.fDisambigHits);
+    }
+
+    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
+    auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt, clockData);
+    if (alg == "ProtoDUNESP")
+      return fProtoDUNESPDisambigAlg.Disambiguate(detProp, hits, fParallelAPAs);
+
+    fDisambigAlg.RunDisambig(clockData, detProp, hits);
+    return std::move(fDisambigAlg.fDisambigHits);
+  }
+
+  //-------------------------------------------------
+  void DisambigBenchmark::Check(const DisambigHits_t& disambigHits,
+                                const std::vector< art::Ptr<recob::Hit> >& cheatHits,
+                                unsigned int& correct, unsigned int& incorrect, unsigned int& missed) const
+  {
+    // (channel, peak time, wire) of the results, sorted once so each
+    // cheated hit is a binary search instead of a pass over all of them
+    std::vector< std::tuple<raw::ChannelID_t, double, unsigned int> > found;
+    found.reserve(disambigHits.size());
+    for (const auto& dh : disambigHits)
+      found.emplace_back(dh.first->Channel(), dh.first->PeakTime(), dh.second.Wire);
+    std::sort(found.begin(), found.end());
+
+    correct = incorrect = missed = 0;
+    for (const art::Ptr<recob::Hit>& hit : cheatHits) {
+      if (hit->View() == geo::kZ) continue;
+
+      auto it = std::lower_bound(found.begin(), found.end(),
+                                 std::make_tuple(hit->Channel(), hit->PeakTime() - fPeakTimeTolerance, 0u));
+      if (it == found.end() || std::get<0>(*it) != hit->Channel() ||
+          std::abs(std::get<1>(*it) - hit->PeakTime()) >= fPeakTimeTolerance)
+        ++missed;
+      else if (std::get<2>(*it) == hit->WireID().Wire)
+        ++correct;
+      else
+        ++incorrect;
+    }
+  }
+
+  //-------------------------------------------------
+  void DisambigBenchmark::analyze(const art::Event& evt)
+  {
+    std::vector< art::Ptr<recob::Hit> > ChHits;
+    auto ChannelHits = evt.getValidHandle< std::vector<recob::Hit> >(fChanHitLabel);
+    art::fill_ptr_vector(ChHits, ChannelHits);
+
+    std::vector< art::Ptr<recob::Hit> > ChHitsCheater;
+    if (!fChanHitCheater.empty()) {
+      auto ChannelHitsCheater = evt.getHandle< std::vector<recob::Hit> >(fChanHitCheater);
+      if (ChannelHitsCheater)
+        art::fill_ptr_vector(ChHitsCheater, ChannelHitsCheater);
+    }
+
+    fRun = evt.run();
+    fSubRun = evt.subRun();
+    fEvent = evt.event();
+    fNHits = ChHits.size();
+
+    const double toMB(1. / (1024. * 1024.));
+    for (fAlg = 0; fAlg < fAlgorithms.size(); ++fAlg) {
+      const std::uint64_t peakBefore(prof::ProfRegistry::PeakRSS());
+      const auto start = std::chrono::steady_clock::now();
+      const DisambigHits_t disambigHits = RunAlgorithm(fAlgorithms[fAlg], evt, ChHits);
+      fTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      fPeakRSSGrowthMB = (prof::ProfRegistry::PeakRSS() - peakBefore) * toMB;
+
+      fNDisambigHits = disambigHits.size();
+      Check(disambigHits, ChHitsCheater, fCorrect, fIncorrect, fMissed);
+      fTree->Fill();
+
+      Summary& summary = fSummaries[fAlg];
+      ++summary.nEvents;
+      summary.totalMs += fTimeMs;
+      summary.maxMs = std::max(summary.maxMs, fTimeMs);
+      summary.peakRSSGrowthMB += fPeakRSSGrowthMB;
+      summary.correct += fCorrect;
+      summary.incorrect += fIncorrect;
+      summary.missed += fMissed;
+    }
+  }
+
+  //-------------------------------------------------
+  void DisambigBenchmark::endJob()
+  {
+    // The peak memory only grows, so its growth is charged to whichever
+    // algorithm first needed more than the ones before it
+    mf::LogInfo log("DisambigBenchmark");
+    log << "Disambiguation benchmark, peak RSS " << prof::ProfRegistry::PeakRSS() / (1024. * 1024.) << " MB\n"
+        << "algorithm      events  mean [ms]   max [ms]  peak RSS growth [MB]  correct  incorrect  missed";
+    for (size_t a = 0; a < fAlgorithms.size(); ++a) {
+      const Summary& summary = fSummaries[a];
+      const unsigned long total = summary.correct + summary.incorrect + summary.missed;
+      log << "\n" << fAlgorithms[a] << "  " << summary.nEvents
+          << "  " << (summary.nEvents ? summary.totalMs / summary.nEvents : 0.)
+          << "  " << summary.maxMs
+          << "  " << summary.peakRSSGrowthMB;
+      if (total)
+        log << "  " << double(summary.correct) / total
+            << "  " << double(summary.incorrect) / total
+            << "  " << double(summary.missed) / total;
+    }
+  }
+
+  DEFINE_ART_MODULE(DisambigBenchmark)
+
+} // namespace dune
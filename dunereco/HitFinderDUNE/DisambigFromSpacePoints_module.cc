@@ -11,6 +11,11 @@
 // in the right wires. Resolve hits undisambiguated by SpacePoints using
 // assignments of neighboring hits.
 //
+// The neighbors are looked up in a (wire, drift) grid of the resolved hits
+// of each TPC plane, and the unresolved hits are processed in parallel.
+// The module is shared between the schedules; with MonitoringPlots the
+// events are serialized on the TFileService to fill the statistics tree.
+//
 ////////////////////////////////////////////////////////////////////////
 
 #include <string>
@@ -18,13 +23,19 @@
 #include <utility> 
 #include <memory>  
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "tbb/parallel_for.h"
 
 // Framework includes
 #include "canvas/Utilities/InputTag.h"
 #include "canvas/Persistency/Common/Ptr.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
+#include "art/Utilities/SharedResource.h"
 #include "art_root_io/TFileService.h"
 #include "fhiclcpp/types/Atom.h"
 #include "fhiclcpp/types/Sequence.h"
@@ -42,13 +53,42 @@
 // ROOT includes
 #include "TTree.h"
 
+#include "dunereco/NUMA/NUMAPlacement.h"
+
 namespace dune {
   // these types to be replaced with use of feature proposed in redmine #12602
   typedef std::map< unsigned int, std::vector< size_t > > plane_keymap;
   typedef std::map< unsigned int, plane_keymap > tpc_plane_keymap;
   typedef std::map< unsigned int, tpc_plane_keymap > cryo_tpc_plane_keymap;
 
-  class DisambigFromSpacePoints : public art::EDProducer {
+  // resolved induction hits of one TPC plane, binned in wire and drift time,
+  // so the closest resolved hits of a position are found by visiting the
+  // cells around it ring by ring instead of scanning the whole plane
+  class NeighborGrid {
+  public:
+    struct Entry { float wire; float time; };
+
+    // cellWires wires per cell, cellTicks chosen so cells are square in cm
+    void build(const std::vector< Entry > & entries, float cellWires, float wirePitch, float driftPitch);
+
+    // distances squared [cm^2] of the nNeighbors closest entries within dwMax wires,
+    // ddMax ticks and sqrt(maxDValue) cm, same selection as a scan over all entries;
+    // unfilled slots keep maxDValue
+    void closest(float hitWire, float hitDrift, float dwMax, float ddMax,
+                 float maxDValue, std::vector<float> & distBuff) const;
+
+  private:
+    void visit(int i, int j, float hitWire, float hitDrift, float dwMax, float ddMax,
+               std::vector<float> & distBuff) const;
+
+    float fCellWires = 1, fCellTicks = 1, fCellSize = 0;
+    float fWirePitch = 0, fDriftPitch = 0;
+    float fMinWire = 0, fMinTick = 0;
+    int fNWireCells = 0, fNTickCells = 0;
+    std::vector< std::vector< Entry > > fCells;
+  };
+
+  class DisambigFromSpacePoints : public art::SharedProducer {
   public:
     struct Config {
         using Name = fhicl::Name;
@@ -62,22 +102,34 @@ namespace dune {
         fhicl::Atom<float> MaxDistance { Name("MaxDistance"), Comment("Distance [cm] used to complete hits unresolved with spacepoints.") };
         fhicl::Atom<std::string> MoveLeftovers { Name("MoveLeftovers"), Comment("Mode of dealing with undisambiguated hits.") };
         fhicl::Atom<bool> MonitoringPlots { Name("MonitoringPlots"), Comment("Create histograms of no. of unresolved hits at eacch stage, per plane.") };
+        fhicl::Atom<std::string> NUMAPolicy { Name("NUMAPolicy"), Comment("NUMA node of the parallel loops: none, local or node."), "none" };
+        fhicl::Atom<int> NUMANode { Name("NUMANode"), Comment("Node used with NUMAPolicy node."), 0 };
     };
-    using Parameters = art::EDProducer::Table<Config>;
+    using Parameters = art::SharedProducer::Table<Config>;
 
-    explicit DisambigFromSpacePoints(Parameters const& config);
+    explicit DisambigFromSpacePoints(Parameters const& config, art::ProcessingFrame const&);
 
-    void produce(art::Event& evt);
+    void produce(art::Event& evt, art::ProcessingFrame const&) override;
 
   private:
+    // statistics of one event, also the branch buffer of the monitoring tree
+    struct HitStats
+    {
+        int run = 0, event = 0;
+        int nHits[3] = {0, 0, 0};                // n all hits in each plane
+        int nMissedBySpacePoints[2] = {0, 0};    // n hits unresolved by SpacePoints in induction planes
+        int nMissedByNeighbors[2] = {0, 0};      // n hits unresolved by using neighboring hits
+    };
+
     int runOnSpacePoints(
             const std::vector< art::Ptr<recob::Hit> > & eventHits,
             const art::FindManyP< recob::SpacePoint > & spFromHit,
             const std::unordered_map< size_t, size_t > & spToTPC,
             std::unordered_map< size_t, geo::WireID > & assignments,
             cryo_tpc_plane_keymap & indHits,
-            std::vector<size_t> & unassigned
-            );
+            std::vector<size_t> & unassigned,
+            HitStats & stats
+            ) const;
 
     int resolveUnassigned(
             detinfo::DetectorPropertiesData const& detProp,
@@ -85,8 +137,9 @@ namespace dune {
             const std::vector< art::Ptr<recob::Hit> > & eventHits,
             cryo_tpc_plane_keymap & indHits,
             std::vector<size_t> & unassigned,
-            size_t nNeighbors
-            );
+            size_t nNeighbors,
+            HitStats & stats
+            ) const;
 
     void assignFirstAllowedWire(
             std::unordered_map< size_t, geo::WireID > & assignments,
@@ -103,10 +156,7 @@ namespace dune {
 
     geo::GeometryCore const* fGeom;
 
-    int fRun, fEvent;
-    int fNHits[3];                // n all hits in each plane
-    int fNMissedBySpacePoints[2]; // n hits unresolved by SpacePoints in induction planes
-    int fNMissedByNeighbors[2];   // n hits unresolved by using neighboring hits
+    HitStats fTreeStats;          // only written with the events serialized
     TTree *fTree;
 
     const bool fMonitoringPlots;
@@ -117,10 +167,11 @@ namespace dune {
     const std::vector< size_t > fExcludeTPCs;
     const art::InputTag fHitModuleLabel;
     const art::InputTag fSpModuleLabel;
+    const dune::numa::PlacementConfig fPlacement;
   };
 
-  DisambigFromSpacePoints::DisambigFromSpacePoints(DisambigFromSpacePoints::Parameters const& config) :
-    EDProducer(config),
+  DisambigFromSpacePoints::DisambigFromSpacePoints(DisambigFromSpacePoints::Parameters const& config, art::ProcessingFrame const&) :
+    SharedProducer(config),
     fTree(0),
     fMonitoringPlots(config().MonitoringPlots()),
     fUseNeighbors(config().UseNeighbors()),
@@ -129,7 +180,8 @@ namespace dune {
     fMoveLeftovers(config().MoveLeftovers()),
     fExcludeTPCs(config().ExcludeTPCs()),
     fHitModuleLabel(config().HitModuleLabel()),
-    fSpModuleLabel(config().SpModuleLabel())
+    fSpModuleLabel(config().SpModuleLabel()),
+    fPlacement{dune::numa::ParsePolicy(config().NUMAPolicy()), config().NUMANode()}
   {
     if (fNumNeighbors < 1)
     {
@@ -150,18 +202,25 @@ namespace dune {
     {
         art::ServiceHandle<art::TFileService> tfs;
         fTree = tfs->make<TTree>("hitstats", "Unresolved hits statistics");
-        fTree->Branch("fRun", &fRun, "fRun/I");
-        fTree->Branch("fEvent", &fEvent, "fEvent/I");
-        fTree->Branch("fNHits", fNHits, "fNHits[3]/I");
-        fTree->Branch("fNMissedBySpacePoints", fNMissedBySpacePoints, "fNMissedBySpacePoints[2]/I");
-        fTree->Branch("fNMissedByNeighbors", fNMissedByNeighbors, "fNMissedByNeighbors[2]/I");
+        fTree->Branch("fRun", &fTreeStats.run, "fRun/I");
+        fTree->Branch("fEvent", &fTreeStats.event, "fEvent/I");
+        fTree->Branch("fNHits", fTreeStats.nHits, "fNHits[3]/I");
+        fTree->Branch("fNMissedBySpacePoints", fTreeStats.nMissedBySpacePoints, "fNMissedBySpacePoints[2]/I");
+        fTree->Branch("fNMissedByNeighbors", fTreeStats.nMissedByNeighbors, "fNMissedByNeighbors[2]/I");
+
+        serialize<art::InEvent>(art::SharedResource<art::TFileService>);
+    }
+    else
+    {
+        async<art::InEvent>();
     }
   }
 
-  void DisambigFromSpacePoints::produce(art::Event& evt)
+  void DisambigFromSpacePoints::produce(art::Event& evt, art::ProcessingFrame const&)
   {
-    fRun = evt.run();
-    fEvent = evt.id().event();
+    HitStats stats;
+    stats.run = evt.run();
+    stats.event = evt.id().event();
 
     auto hitsHandle = evt.getValidHandle< std::vector<recob::Hit> >(fHitModuleLabel);
     auto spHandle = evt.getValidHandle< std::vector<recob::SpacePoint> >(fSpModuleLabel);
@@ -218,12 +277,14 @@ namespace dune {
 
     hitToWire.reserve(eventHits.size());
 
-    int n = runOnSpacePoints(eventHits, spFromHit, spToTPC, hitToWire, indHits, unassignedHits);
+    int n = runOnSpacePoints(eventHits, spFromHit, spToTPC, hitToWire, indHits, unassignedHits, stats);
     mf::LogInfo("DisambigFromSpacePoints") << n << " hits undisambiguated by space points.";
 
     if (fUseNeighbors)
     {
-        n = resolveUnassigned(detProp, hitToWire, eventHits, indHits, unassignedHits, fNumNeighbors);
+        dune::numa::Execute(fPlacement, [&]() {
+            n = resolveUnassigned(detProp, hitToWire, eventHits, indHits, unassignedHits, fNumNeighbors, stats);
+        });
         mf::LogInfo("DisambigFromSpacePoints") << n << " hits undisambiguated by neighborhood.";
     }
 
@@ -268,7 +329,7 @@ namespace dune {
         }
     }
 
-    if (fMonitoringPlots && fTree) { fTree->Fill(); } // save statistics if MonitoringPlots was set to true
+    if (fMonitoringPlots && fTree) { fTreeStats = stats; fTree->Fill(); } // save statistics if MonitoringPlots was set to true
 
     // put the hit collection and associations into the event
     hcol.put_into(evt);
@@ -281,13 +342,10 @@ namespace dune {
     const std::unordered_map< size_t, size_t > & spToTPC,
     std::unordered_map< size_t, geo::WireID > & assignments,
     cryo_tpc_plane_keymap & indHits,
-    std::vector<size_t> & unassigned
-    )
+    std::vector<size_t> & unassigned,
+    HitStats & stats
+    ) const
   {
-    fNHits[0] = 0; fNHits[1] = 0; fNHits[2] = 0;
-    fNMissedBySpacePoints[0] = 0;
-    fNMissedBySpacePoints[1] = 0;
-
     for (size_t i = 0; i < eventHits.size(); ++i)
     {
         const art::Ptr<recob::Hit> & hit = eventHits[i];
@@ -296,18 +354,18 @@ namespace dune {
         if (hit->SignalType() == geo::kCollection)
         {
             assignments[hit.key()] = cwids.front();
-            fNHits[2]++; // count collection hit
+            stats.nHits[2]++; // count collection hit
         }
         else
         {
             geo::WireID id = hit->WireID();
             size_t cryo = id.Cryostat, plane = id.Plane;
-            fNHits[plane]++; // count induction hit
+            stats.nHits[plane]++; // count induction hit
 
             if (spFromHit.at(hit.key()).size() == 0)
             {
                 unassigned.push_back(hit.key());
-                fNMissedBySpacePoints[plane]++; //count unresolved hit
+                stats.nMissedBySpacePoints[plane]++; //count unresolved hit
             }
             else
             {
@@ -355,13 +413,13 @@ namespace dune {
                 {
 		  //mf::LogWarning("DisambigFromSpacePoints") << "Did not find matching wire (plane:" << plane << ").";
                     unassigned.push_back(hit.key());
-                    fNMissedBySpacePoints[plane]++; //count unresolved hit
+                    stats.nMissedBySpacePoints[plane]++; //count unresolved hit
                 }
             }
         }
     }
 
-    return fNMissedBySpacePoints[0] + fNMissedBySpacePoints[1];
+    return stats.nMissedBySpacePoints[0] + stats.nMissedBySpacePoints[1];
   }
 
   int DisambigFromSpacePoints::resolveUnassigned(
@@ -370,29 +428,68 @@ namespace dune {
     const std::vector< art::Ptr<recob::Hit> > & eventHits,
     cryo_tpc_plane_keymap & allIndHits,
     std::vector<size_t> & unassigned,
-    size_t nNeighbors
-    )
+    size_t nNeighbors,
+    HitStats & stats
+    ) const
   {
-    fNMissedByNeighbors[0] = 0;
-    fNMissedByNeighbors[1] = 0;
+    const float maxDValue = fMaxDistance*fMaxDistance;
+    const float cellWires = 16; // grid cell size in wires (the drift size is the same in cm)
+
+    // index the resolved hits of each TPC plane, planes are independent
+    std::map< geo::PlaneID, NeighborGrid > grids;
+    std::vector< std::pair< geo::PlaneID, const std::vector<size_t>* > > toBuild;
+    for (const auto & cryoHits : allIndHits)
+        for (const auto & tpcHits : cryoHits.second)
+            for (const auto & planeHits : tpcHits.second)
+            {
+                geo::PlaneID const planeID(cryoHits.first, tpcHits.first, planeHits.first);
+                grids[planeID];
+                toBuild.emplace_back(planeID, &planeHits.second);
+            }
 
-    std::unordered_map< size_t, geo::WireID > result;
+    tbb::parallel_for(size_t(0), toBuild.size(), [&](size_t i)
+    {
+        geo::PlaneID const & planeID = toBuild[i].first;
+        const auto & keys = *toBuild[i].second;
 
-    for (const size_t key : unassigned)
+        std::vector< NeighborGrid::Entry > entries;
+        entries.reserve(keys.size());
+        for (const size_t keyInd : keys)
+        {
+            auto search = assignments.find(keyInd);        // find resolved wire id
+            if (search == assignments.end())
+            {
+                mf::LogWarning("DisambigFromSpacePoints") << "Did not find resolved wire id.";
+                continue;
+            }
+            entries.push_back({ float(search->second.Wire), eventHits[keyInd]->PeakTime() });
+        }
+        grids.at(planeID).build(entries, cellWires,
+            fGeom->Plane(planeID).WirePitch(),
+            std::fabs(detProp.GetXTicksCoefficient(planeID.TPC, planeID.Cryostat)));
+    });
+
+    // each unresolved hit only reads the grids, so they are resolved in parallel
+    std::vector< geo::WireID > result(unassigned.size());
+    std::vector< char > hasWires(unassigned.size(), 0);
+    tbb::parallel_for(size_t(0), unassigned.size(), [&](size_t u)
     {
+        const size_t key = unassigned[u];
         const auto & hit = eventHits[key];
         geo::WireID id = hit->WireID();
         size_t cryo = id.Cryostat, plane = id.Plane;
         float hitDrift = hit->PeakTime();
 
         std::vector<geo::WireID> cwids = fGeom->ChannelToWire(hit->Channel());
-        if (cwids.empty()) { mf::LogWarning("DisambigFromSpacePoints") << "No wires for this channel???"; continue; }
+        if (cwids.empty()) { mf::LogWarning("DisambigFromSpacePoints") << "No wires for this channel???"; return; }
+        hasWires[u] = 1;
 
         const float dwMax = fMaxDistance / fGeom->TPC().Plane(plane).WirePitch(); // max distance in wires to look for neighbors
         const float ddMax = dwMax * fGeom->TPC().Plane(plane).WirePitch() / std::fabs(detProp.GetXTicksCoefficient(0, 0));
 
         float bestScore = 0;
         geo::WireID bestId;
+        std::vector<float> distBuff(nNeighbors); // distance to n closest hits
         for (size_t w = 0; w < cwids.size(); ++w)
         {
             const size_t tpc = cwids[w].TPC;
@@ -402,42 +499,13 @@ namespace dune {
             for (auto t : fExcludeTPCs) { if (t == tpc) { allowed = false; break; } }
             if (!allowed) { continue; }
 
-            geo::PlaneID const planeID(cryo, tpc, plane);
-            const float wirePitch = fGeom->Plane(planeID).WirePitch();
-            const float driftPitch = std::fabs(detProp.GetXTicksCoefficient(tpc, cryo));
-
-            float maxDValue = fMaxDistance*fMaxDistance;
-            std::vector<float> distBuff(nNeighbors, maxDValue); // distance to n closest hits
-            const auto & keys = allIndHits[cryo][tpc][plane];
-            for (const size_t keyInd : keys)
+            std::fill(distBuff.begin(), distBuff.end(), maxDValue);
+            auto grid = grids.find(geo::PlaneID(cryo, tpc, plane));
+            if (grid != grids.end())
             {
-                const auto & hitInd = eventHits[keyInd];
-
-                auto search = assignments.find(keyInd);        // find resolved wire id
-                if (search == assignments.end())
-                {
-                    mf::LogWarning("DisambigFromSpacePoints") << "Did not find resolved wire id.";
-                    continue;
-                }
-
-                //float dWire = std::abs(hitWire - search->second.Wire);
-                float dWire = std::abs(float(hitWire) - float(search->second.Wire));
-                float dDrift = std::fabs(hitDrift - hitInd->PeakTime());
-
-                if ((dWire > dwMax) || (dDrift > ddMax)) { continue; }
-
-                dWire *= wirePitch;
-                dDrift *= driftPitch;
-                float dist2 = dWire * dWire + dDrift * dDrift;
-
-                float maxd2 = 0;
-                size_t maxIdx = 0;
-                for (size_t i = 0; i < distBuff.size(); ++i )
-                {
-                    if (distBuff[i] > maxd2) { maxd2 = distBuff[i]; maxIdx = i; }
-                }
-                if (dist2 < maxd2) { distBuff[maxIdx] = dist2; }
+                grid->second.closest(float(hitWire), hitDrift, dwMax, ddMax, maxDValue, distBuff);
             }
+
             float score = 0;
             size_t nhits = 0;
             for (size_t i = 0; i < distBuff.size(); ++i )
@@ -453,19 +521,121 @@ namespace dune {
                 }
             }
         }
-        if (bestId.isValid) { result[key] = bestId; }
-        else { fNMissedByNeighbors[plane]++; }
-    }
+        result[u] = bestId;
+    });
 
     // remove from list of unassigned hits
-    for (const auto & entry : result)
+    size_t nLeft = 0;
+    for (size_t u = 0; u < unassigned.size(); ++u)
     {
-        unassigned.erase(std::remove(unassigned.begin(), unassigned.end(), entry.first), unassigned.end());
+        const size_t key = unassigned[u];
+        if (result[u].isValid) { assignments[key] = result[u]; }
+        else
+        {
+            if (hasWires[u]) { stats.nMissedByNeighbors[eventHits[key]->WireID().Plane]++; }
+            unassigned[nLeft++] = key;
+        }
     }
+    unassigned.resize(nLeft);
+
+    return stats.nMissedByNeighbors[0] + stats.nMissedByNeighbors[1];
+  }
+
+  void NeighborGrid::build(const std::vector< Entry > & entries, float cellWires, float wirePitch, float driftPitch)
+  {
+    fWirePitch = wirePitch;
+    fDriftPitch = driftPitch;
+    fCellWires = cellWires;
+    fCellSize = cellWires * wirePitch;
+    fCellTicks = (driftPitch > 0) ? fCellSize / driftPitch : cellWires;
+    fCells.clear();
+    fNWireCells = fNTickCells = 0;
+    if (entries.empty()) { return; }
+
+    float maxWire = entries.front().wire, maxTick = entries.front().time;
+    fMinWire = maxWire; fMinTick = maxTick;
+    for (const auto & e : entries)
+    {
+        fMinWire = std::min(fMinWire, e.wire); maxWire = std::max(maxWire, e.wire);
+        fMinTick = std::min(fMinTick, e.time); maxTick = std::max(maxTick, e.time);
+    }
+    fNWireCells = int((maxWire - fMinWire) / fCellWires) + 1;
+    fNTickCells = int((maxTick - fMinTick) / fCellTicks) + 1;
+    fCells.resize(size_t(fNWireCells) * fNTickCells);
+    for (const auto & e : entries)
+    {
+        const int i = std::min(fNWireCells - 1, int((e.wire - fMinWire) / fCellWires));
+        const int j = std::min(fNTickCells - 1, int((e.time - fMinTick) / fCellTicks));
+        fCells[size_t(i) * fNTickCells + j].push_back(e);
+    }
+  }
+
+  void NeighborGrid::visit(int i, int j, float hitWire, float hitDrift, float dwMax, float ddMax,
+                           std::vector<float> & distBuff) const
+  {
+    if ((i < 0) || (i >= fNWireCells) || (j < 0) || (j >= fNTickCells)) { return; }
+
+    for (const auto & e : fCells[size_t(i) * fNTickCells + j])
+    {
+        float dWire = std::abs(hitWire - e.wire);
+        float dDrift = std::fabs(hitDrift - e.time);
+
+        if ((dWire > dwMax) || (dDrift > ddMax)) { continue; }
+
+        dWire *= fWirePitch;
+        dDrift *= fDriftPitch;
+        float dist2 = dWire * dWire + dDrift * dDrift;
 
-    //assignments.merge(result); // use this with C++ 17
-    assignments.insert(result.begin(), result.end());
-    return fNMissedByNeighbors[0] + fNMissedByNeighbors[1];
+        float maxd2 = 0;
+        size_t maxIdx = 0;
+        for (size_t k = 0; k < distBuff.size(); ++k )
+        {
+            if (distBuff[k] > maxd2) { maxd2 = distBuff[k]; maxIdx = k; }
+        }
+        if (dist2 < maxd2) { distBuff[maxIdx] = dist2; }
+    }
+  }
+
+  void NeighborGrid::closest(float hitWire, float hitDrift, float dwMax, float ddMax,
+                             float maxDValue, std::vector<float> & distBuff) const
+  {
+    if (fCells.empty()) { return; }
+
+    // cell of the hit, may be outside the grid
+    const int ci = int(std::floor((hitWire - fMinWire) / fCellWires));
+    const int cj = int(std::floor((hitDrift - fMinTick) / fCellTicks));
+
+    for (int r = 0; ; ++r)
+    {
+        if ((ci - r < 0) && (ci + r >= fNWireCells) && (cj - r < 0) && (cj + r >= fNTickCells)) { break; }
+
+        // entries of ring r and beyond are more than (r-1) cells away from the hit,
+        // one more cell is kept as margin for the rounding at the cell edges
+        const int far = r - 2;
+        if (far > 0)
+        {
+            if ((far * fCellWires >= dwMax) && (far * fCellTicks >= ddMax)) { break; }
+
+            const float low = far * fCellSize, low2 = low * low;
+            if (low2 >= maxDValue) { break; }
+            if (*std::max_element(distBuff.begin(), distBuff.end()) <= low2) { break; }
+        }
+
+        if (r == 0) { visit(ci, cj, hitWire, hitDrift, dwMax, ddMax, distBuff); continue; }
+
+        const int jLow = std::max(cj - r, 0), jHigh = std::min(cj + r, fNTickCells - 1);
+        for (int j = jLow; j <= jHigh; ++j)
+        {
+            visit(ci - r, j, hitWire, hitDrift, dwMax, ddMax, distBuff);
+            visit(ci + r, j, hitWire, hitDrift, dwMax, ddMax, distBuff);
+        }
+        const int iLow = std::max(ci - r + 1, 0), iHigh = std::min(ci + r - 1, fNWireCells - 1);
+        for (int i = iLow; i <= iHigh; ++i)
+        {
+            visit(i, cj - r, hitWire, hitDrift, dwMax, ddMax, distBuff);
+            visit(i, cj + r, hitWire, hitDrift, dwMax, ddMax, distBuff);
+        }
+    }
   }
 
   void DisambigFromSpacePoints::assignFirstAllowedWire(
@@ -0,0 +1,44 @@
+/////////////////////////////////////////////////////////////////
+//
+//  Hit indices sorted by time, used by the disambiguation
+//  algorithms to find the hits of a time window without
+//  scanning every hit of the event
+//
+////////////////////////////////////////////////////////////////////
+#ifndef DisambigTimeIndex_H
+#define DisambigTimeIndex_H
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace dune{
+
+  //---------------------------------------------------------------
+  class DisambigTimeIndex {
+  public:
+
+    /// Add a hit with its time, call Sort() once all hits are added
+    void Add(double time, unsigned int hit) { fSorted.emplace_back(time, hit); }
+    void Sort() { std::sort(fSorted.begin(), fSorted.end()); }
+
+    /// Fill result with the hits whose time is in [low, high], in increasing hit order,
+    /// so that callers which keep the first best candidate behave as with a full scan.
+    /// The window should be a little wider than the cut, which the caller then applies.
+    void Window(double low, double high, std::vector<unsigned int> &result) const
+    {
+      result.clear();
+      auto first = std::lower_bound(fSorted.begin(), fSorted.end(), low,
+        [](const std::pair<double, unsigned int> &entry, double time){ return entry.first < time; });
+      for (auto iter = first; iter != fSorted.end() && iter->first <= high; ++iter)
+        result.push_back(iter->second);
+      std::sort(result.begin(), result.end());
+    }
+
+  private:
+
+    std::vector< std::pair<double, unsigned int> > fSorted;
+  }; // class DisambigTimeIndex
+
+} // namespace dune
+
+#endif // ifndef DisambigTimeIndex_H
@@ -18,10 +18,20 @@
 // product with node description the distance will use NODES INSTEAD OF TRAJECTORY
 // POINTS since many trajectory points may belong to single linear segment.
 //
+// With HitPtrOutput the selection is written as a vector of art::Ptr to the input
+// hits instead of a collection of hit copies.
+//
+// Projected trajectory segments of the hadron/muon tracks are binned once per plane
+// and event into a grid of cells, each hit is only compared with the segments that
+// pass close to its cell.
+//
+// The module keeps no per-event state, so it runs as a shared module on concurrent
+// events.
+//
 ///////////////////////////////////////////////////////////////////////////////////////
 
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -43,13 +53,20 @@
 #include "lardata/Utilities/AssociationUtil.h"
 #include "larreco/RecoAlg/PMAlg/Utilities.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace dune {
 
-class EmLikeHits : public art::EDProducer {
+class EmLikeHits : public art::SharedProducer {
 
 public:
 
-  explicit EmLikeHits(fhicl::ParameterSet const & p);
+  explicit EmLikeHits(fhicl::ParameterSet const & p, art::ProcessingFrame const&);
 
   EmLikeHits(EmLikeHits const &) = delete;
 
@@ -61,26 +78,48 @@ public:
 
   void reconfigure(fhicl::ParameterSet const& p);
 
-  void produce(art::Event & e) override;
+  void produce(art::Event & e, art::ProcessingFrame const&) override;
 
 private:
 
+  // Segments of the track-like tracks projected to one plane, binned in square cells
+  // of twice the largest distance at which a hit is close, see isCloseToTrack
+  struct SegmentGrid
+  {
+	struct Segment
+	{
+		TVector2 p0, p1;
+		bool flat; // drift extent small with respect to the wire extent
+	};
+
+	double cellSize;
+	double max_d2_d, max_d2_w;
+	std::vector< Segment > segments;
+	std::unordered_map< std::int64_t, std::vector< unsigned int > > cells;
+
+	static std::int64_t cellKey(std::int64_t ix, std::int64_t iy) { return (ix << 32) ^ (iy & 0xFFFFFFFF); }
+	std::int64_t cellIndex(double x) const { return (std::int64_t)std::floor(x / cellSize); }
+
+	void add(const TVector2& p0, const TVector2& p1);
+	bool isClose(const TVector2& p) const;
+  };
+
+  SegmentGrid makeSegmentGrid(
+	const std::vector<recob::Track>& tracks,
+	unsigned int view,
+	unsigned int tpc,
+	unsigned int cryo) const;
+
   void removeHitsAssignedToTracks(
 	std::vector< art::Ptr<recob::Hit> >& hitlist,
 	const std::vector<recob::Track>& tracks,
-	const art::FindManyP< recob::Hit >& fbp);
+	const art::FindManyP< recob::Hit >& fbp) const;
 
   void removeUnmatchedHitsCloseToTracks(
         detinfo::DetectorPropertiesData const& detProp,
 	std::vector< art::Ptr<recob::Hit> >& hitlist,
 	const std::vector<recob::Track>& tracks,
-	const art::FindManyP< recob::Hit >& fbp);
-
-  bool isCloseToTrack(
-	TVector2 p, const recob::Track& trk,
-	unsigned int view,
-	unsigned int tpc,
-	unsigned int cryo);
+	const art::FindManyP< recob::Hit >& fbp) const;
 
   static double getDist2(
 	const TVector2& psrc,
@@ -91,14 +130,18 @@ private:
 
   std::string fHitModuleLabel;
   std::string fTrk3DModuleLabel;
+  bool fHitPtrOutput;
 
 };
 // ------------------------------------------------------
 
-EmLikeHits::EmLikeHits(fhicl::ParameterSet const & p) : EDProducer{p}
+EmLikeHits::EmLikeHits(fhicl::ParameterSet const & p, art::ProcessingFrame const&) : SharedProducer{p}
 {
         this->reconfigure(p);
-        produces< std::vector<recob::Hit> >();
+        if (fHitPtrOutput) produces< std::vector< art::Ptr<recob::Hit> > >();
+        else produces< std::vector<recob::Hit> >();
+
+        async<art::InEvent>();
 }
 // ------------------------------------------------------
 
@@ -106,37 +149,71 @@ void EmLikeHits::reconfigure(fhicl::ParameterSet const& pset)
 {
         fHitModuleLabel = pset.get< std::string >("HitModuleLabel");
         fTrk3DModuleLabel = pset.get< std::string >("Trk3DModuleLabel");
+        fHitPtrOutput = pset.get< bool >("HitPtrOutput", false);
 }
 // ------------------------------------------------------
 
 void EmLikeHits::removeHitsAssignedToTracks(
 	std::vector< art::Ptr<recob::Hit> >& hitlist,
 	const std::vector<recob::Track>& tracks,
-	const art::FindManyP< recob::Hit >& fbp)
+	const art::FindManyP< recob::Hit >& fbp) const
 {
+	std::unordered_set< size_t > trackHits;
 	for (size_t t = 0; t < tracks.size(); t++)
 		if (!(tracks[t].ID() & 0x10000))
 	{
-		std::vector< art::Ptr<recob::Hit> > v = fbp.at(t);
+		const std::vector< art::Ptr<recob::Hit> >& v = fbp.at(t);
 		mf::LogVerbatim("EmLikeHits") << "   track-like trajectory: " << v.size() << std::endl;
-		size_t ih = 0;
-		while (ih < hitlist.size())
+		for (auto const& h : v) trackHits.insert(h.key());
+	}
+
+	hitlist.erase(std::remove_if(hitlist.begin(), hitlist.end(),
+		[&trackHits](const art::Ptr<recob::Hit>& h) { return trackHits.count(h.key()) > 0; }),
+		hitlist.end());
+}
+// ------------------------------------------------------
+
+void EmLikeHits::SegmentGrid::add(const TVector2& p0, const TVector2& p1)
+{
+	const unsigned int idx = segments.size();
+	segments.push_back({ p0, p1, fabs(p0.X() - p1.X()) > 0.5 * fabs(p0.Y() - p1.Y()) });
+
+	// Points along the segment at most half a cell apart, each one with its neighbour
+	// cells, cover everything within half a cell of the segment
+	const size_t nSteps = (size_t)std::ceil(2.0 * (p1 - p0).Mod() / cellSize);
+	for (size_t s = 0; s <= nSteps; ++s)
+	{
+		TVector2 q = p0;
+		if (nSteps > 0) q += (p1 - p0) * (double(s) / nSteps);
+
+		const std::int64_t ix = cellIndex(q.X()), iy = cellIndex(q.Y());
+		for (std::int64_t dx = -1; dx <= 1; ++dx)
+			for (std::int64_t dy = -1; dy <= 1; ++dy)
 		{
-			bool found = false;
-			for (size_t it = 0; it < v.size(); it++)
-				if (v[it].key() == hitlist[ih].key())
-			{
-				found = true; break;
-			}
-			if (found) hitlist.erase(hitlist.begin() + ih);
-			else ih++;
+			std::vector< unsigned int >& cell = cells[cellKey(ix + dx, iy + dy)];
+			if (cell.empty() || (cell.back() != idx)) cell.push_back(idx);
 		}
 	}
 }
 // ------------------------------------------------------
 
-bool EmLikeHits::isCloseToTrack(TVector2 p, const recob::Track& trk,
-	unsigned int view, unsigned int tpc, unsigned int cryo)
+bool EmLikeHits::SegmentGrid::isClose(const TVector2& p) const
+{
+	auto c = cells.find(cellKey(cellIndex(p.X()), cellIndex(p.Y())));
+	if (c == cells.end()) return false;
+
+	for (unsigned int idx : c->second)
+	{
+		const Segment& seg = segments[idx];
+		double d2 = getDist2(p, seg.p0, seg.p1);
+		if ((seg.flat && (d2 < max_d2_d)) || (d2 < max_d2_w)) return true;
+	}
+	return false;
+}
+// ------------------------------------------------------
+
+EmLikeHits::SegmentGrid EmLikeHits::makeSegmentGrid(const std::vector<recob::Track>& tracks,
+	unsigned int view, unsigned int tpc, unsigned int cryo) const
 {
 	art::ServiceHandle<geo::Geometry> geom;
         geo::PlaneID const planeID{cryo, tpc, view};
@@ -144,25 +221,24 @@ bool EmLikeHits::isCloseToTrack(TVector2 p, const recob::Track& trk,
 
 	//double driftPitch = detProp.GetXTicksCoefficient(tpc, cryo);
 
-	double max_d2_d = 0.3 * 0.3;
-	double max_d2_w = (wirePitch + 0.1) * (wirePitch + 0.1);
+	SegmentGrid grid;
+	grid.max_d2_d = 0.3 * 0.3;
+	grid.max_d2_w = (wirePitch + 0.1) * (wirePitch + 0.1);
+	grid.cellSize = 2.0 * std::max(0.3, wirePitch + 0.1);
 
-	bool isClose = false;
-	for (size_t i = 0; i < trk.NumberTrajectoryPoints() - 1; ++i)
+	std::vector< TVector2 > points;
+	for (size_t t = 0; t < tracks.size(); t++)
+		if (!(tracks[t].ID() & 0x10000))
 	{
-		TVector2 p0 = pma::GetVectorProjectionToPlane(trk.LocationAtPoint<TVector3>(i), view, tpc, cryo);
-		TVector2 p1 = pma::GetVectorProjectionToPlane(trk.LocationAtPoint<TVector3>(i + 1), view, tpc, cryo);
-		double d2 = getDist2(p, p0, p1);
+		const recob::Track& trk = tracks[t];
 
-		double dpx = fabs(p0.X() - p1.X());
-		double dpy = fabs(p0.Y() - p1.Y());
+		points.clear();
+		for (size_t i = 0; i < trk.NumberTrajectoryPoints(); ++i)
+			points.push_back(pma::GetVectorProjectionToPlane(trk.LocationAtPoint<TVector3>(i), view, tpc, cryo));
 
-		if (((dpx > 0.5 * dpy) && (d2 < max_d2_d)) || (d2 < max_d2_w))
-		{
-			isClose = true; break;
-		}
+		for (size_t i = 0; i + 1 < points.size(); ++i) grid.add(points[i], points[i + 1]);
 	}
-	return isClose;
+	return grid;
 }
 // ------------------------------------------------------
 
@@ -170,49 +246,40 @@ void EmLikeHits::removeUnmatchedHitsCloseToTracks(
         detinfo::DetectorPropertiesData const& detProp,
 	std::vector< art::Ptr<recob::Hit> >& hitlist,
 	const std::vector<recob::Track>& tracks,
-	const art::FindManyP< recob::Hit >& fbp)
+	const art::FindManyP< recob::Hit >& fbp) const
 {
-	size_t ih = 0;
-	while (ih < hitlist.size())
+	std::unordered_set< size_t > matchedHits;
+	for (size_t t = 0; t < tracks.size(); t++)
+		for (auto const& h : fbp.at(t)) matchedHits.insert(h.key());
+
+	// grids are made on the first hit in each plane
+	std::map< geo::PlaneID, SegmentGrid > grids;
+
+	auto isClose = [&](const art::Ptr<recob::Hit>& hit)
 	{
-		bool unmatched = true, close = false;;
-		for (size_t t = 0; t < tracks.size(); t++)
-		{
-			std::vector< art::Ptr<recob::Hit> > v = fbp.at(t);
-			for (size_t it = 0; it < v.size(); it++)
-				if (v[it].key() == hitlist[ih].key())
-				{
-					unmatched = false; break;
-				}
-			if (!unmatched) break;
-		}
-		if (unmatched)
-		{
-			unsigned int plane = hitlist[ih]->WireID().Plane;
-			unsigned int tpc = hitlist[ih]->WireID().TPC;
-			unsigned int cryo = hitlist[ih]->WireID().Cryostat;
-
-                        TVector2 hcm = pma::WireDriftToCm(detProp,
-				hitlist[ih]->WireID().Wire, hitlist[ih]->PeakTime(), plane, tpc, cryo);
-
-			for (size_t t = 0; t < tracks.size(); t++)
-				if (!(tracks[t].ID() & 0x10000) &&
-				    isCloseToTrack(hcm, tracks[t], plane, tpc, cryo))
-			{
-				close = true; break;
-			}
-		}
-		if (close) hitlist.erase(hitlist.begin() + ih);
-		else ih++;
-	}
+		if (matchedHits.count(hit.key())) return false;
+
+		unsigned int plane = hit->WireID().Plane;
+		unsigned int tpc = hit->WireID().TPC;
+		unsigned int cryo = hit->WireID().Cryostat;
+
+                TVector2 hcm = pma::WireDriftToCm(detProp,
+			hit->WireID().Wire, hit->PeakTime(), plane, tpc, cryo);
+
+		geo::PlaneID const planeID{cryo, tpc, plane};
+		auto g = grids.find(planeID);
+		if (g == grids.end())
+			g = grids.emplace(planeID, makeSegmentGrid(tracks, plane, tpc, cryo)).first;
+
+		return g->second.isClose(hcm);
+	};
+	hitlist.erase(std::remove_if(hitlist.begin(), hitlist.end(), isClose), hitlist.end());
 }
 // ------------------------------------------------------
 
-void EmLikeHits::produce(art::Event& evt)
+void EmLikeHits::produce(art::Event& evt, art::ProcessingFrame const&)
 {
-	std::unique_ptr< std::vector< recob::Hit > > not_track_hits(new std::vector< recob::Hit >);
-
-	std::vector< art::Ptr<recob::Hit> > hitlist;
+	std::unique_ptr< std::vector< art::Ptr<recob::Hit> > > hitlist(new std::vector< art::Ptr<recob::Hit> >);
 	auto hitListHandle = evt.getHandle< std::vector<recob::Hit> >(fHitModuleLabel);
 	auto trkListHandle = evt.getHandle< std::vector<recob::Track> >(fTrk3DModuleLabel);
 
@@ -220,17 +287,26 @@ void EmLikeHits::produce(art::Event& evt)
 	{
 		art::FindManyP< recob::Hit > fbp(trkListHandle, evt, fTrk3DModuleLabel);
 
-		art::fill_ptr_vector(hitlist, hitListHandle);
-		mf::LogVerbatim("EmLikeHits") << "all hits: " << hitlist.size() << std::endl;
+		art::fill_ptr_vector(*hitlist, hitListHandle);
+		mf::LogVerbatim("EmLikeHits") << "all hits: " << hitlist->size() << std::endl;
 
-		removeHitsAssignedToTracks(hitlist, *trkListHandle, fbp);
+		removeHitsAssignedToTracks(*hitlist, *trkListHandle, fbp);
                 auto const detProp =
                   art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
-                removeUnmatchedHitsCloseToTracks(detProp, hitlist, *trkListHandle, fbp);
+                removeUnmatchedHitsCloseToTracks(detProp, *hitlist, *trkListHandle, fbp);
 
-		for (auto const& hit : hitlist) not_track_hits->push_back(recob::Hit(*hit));
-		mf::LogVerbatim("EmLikeHits") << "remaining not track-like hits: " << not_track_hits->size() << std::endl;
+		mf::LogVerbatim("EmLikeHits") << "remaining not track-like hits: " << hitlist->size() << std::endl;
 	}
+
+	if (fHitPtrOutput)
+	{
+		evt.put(std::move(hitlist));
+		return;
+	}
+
+	std::unique_ptr< std::vector< recob::Hit > > not_track_hits(new std::vector< recob::Hit >);
+	not_track_hits->reserve(hitlist->size());
+	for (auto const& hit : *hitlist) not_track_hits->push_back(recob::Hit(*hit));
 	evt.put(std::move(not_track_hits));
 }
 // ------------------------------------------------------
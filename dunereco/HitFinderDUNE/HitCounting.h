@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////
+//
+//  Hit count cut of NumberOfHitsFilter, for modules that apply it
+//  without a separate filter path
+//
+////////////////////////////////////////////////////////////////////////
+
+#ifndef HIT_HITCOUNTING_H
+#define HIT_HITCOUNTING_H
+
+#include <iostream>
+#include <map>
+
+#include "canvas/Persistency/Common/Ptr.h"
+#include "lardataobj/RecoBase/Hit.h"
+
+namespace hit
+{
+  inline const recob::Hit& HitOf(const recob::Hit& hit) { return hit; }
+  inline const recob::Hit& HitOf(const art::Ptr<recob::Hit>& hit) { return *hit; }
+
+  /// Whether there are at most hitLimit hits, in all TPCs together or in
+  /// every TPC. Takes hits or art::Ptrs to hits
+  template <typename HitCollection>
+  bool WithinHitLimit(const HitCollection& hits, unsigned int hitLimit, bool limitPerTPC, bool verbose = false)
+  {
+    if(limitPerTPC){
+      // Find the number of hits per TPC and then filter based on a large value
+      std::map<unsigned int,unsigned int> hitsPerTPC;
+
+      for(auto const &hit : hits){
+        hitsPerTPC[HitOf(hit).WireID().TPC]++;
+      }
+
+      for(auto const m:  hitsPerTPC){
+
+        if (verbose) {
+          std::cout << m.second << " hits in TPC " << m.first << std::endl;
+        }
+
+        if(m.second > hitLimit){
+          return false;
+        }
+      }
+      return true;
+    }
+
+    if (verbose) {
+      std::cout << hits.size() << " hits in all TPCs" << std::endl;
+    }
+
+    // This is the simplest thing we can do, just cut on the total number of hits
+    return hits.size() <= hitLimit;
+  }
+}
+
+#endif // HIT_HITCOUNTING_H
@@ -9,7 +9,8 @@
 //  
 // Runs the disambiguation algorithm for the single-phase ProtoDUNE detector
 // 
-// 
+// The algorithm keeps no per-event state, so the module is shared and
+// the APAs can be disambiguated in parallel (ParallelAPAs).
 //
 //
 ////////////////////////////////////////////////////////////////////////
@@ -22,7 +23,7 @@
 // Framework includes
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 
 #include "canvas/Persistency/Common/Ptr.h"
 
@@ -46,15 +47,15 @@
 #include "TVector3.h"
 
 namespace dune{
-  class HitFinderProtoDUNESP : public art::EDProducer {
+  class HitFinderProtoDUNESP : public art::SharedProducer {
     
   public:
     
-    explicit HitFinderProtoDUNESP(fhicl::ParameterSet const& pset); 
+    explicit HitFinderProtoDUNESP(fhicl::ParameterSet const& pset, art::ProcessingFrame const&); 
     
-    void produce(art::Event& evt); 
-    void beginJob(); 
-    void endJob(); 
+    void produce(art::Event& evt, art::ProcessingFrame const&) override; 
+    void beginJob(art::ProcessingFrame const&) override; 
+    void endJob(art::ProcessingFrame const&) override; 
     void reconfigure(fhicl::ParameterSet const& p);                
     
     
@@ -66,6 +67,7 @@ namespace dune{
     
     std::string fChanHitLabel;
     std::string fAlg;    // which algorithm to use
+    bool fParallelAPAs;  // disambiguate the APAs in parallel
     
   protected: 
     
@@ -75,11 +77,12 @@ namespace dune{
   
   //-------------------------------------------------
   //-------------------------------------------------
-  HitFinderProtoDUNESP::HitFinderProtoDUNESP(fhicl::ParameterSet const& pset) :
-    EDProducer(pset),
+  HitFinderProtoDUNESP::HitFinderProtoDUNESP(fhicl::ParameterSet const& pset, art::ProcessingFrame const&) :
+    SharedProducer(pset),
     fDisambigAlg(pset.get< fhicl::ParameterSet >("DisambigAlg"))
   {
     this->reconfigure(pset);
+    async<art::InEvent>();
     
     // let HitCollectionCreator declare that we are going to produce
     // hits and associations with wires and raw digits
@@ -95,26 +98,27 @@ namespace dune{
     
     fChanHitLabel =  p.get< std::string >("ChanHitLabel");
     fAlg = p.get < std::string >("Algorithm");  // switch on which algorithm to run
+    fParallelAPAs = p.get< bool >("ParallelAPAs", false);
     
   }  
   
   //-------------------------------------------------
   //-------------------------------------------------
-  void HitFinderProtoDUNESP::beginJob()
+  void HitFinderProtoDUNESP::beginJob(art::ProcessingFrame const&)
   {
     
   }
   
   //-------------------------------------------------
   //-------------------------------------------------
-  void HitFinderProtoDUNESP::endJob()
+  void HitFinderProtoDUNESP::endJob(art::ProcessingFrame const&)
   {
     
   }
   
 
   //-------------------------------------------------
-  void HitFinderProtoDUNESP::produce(art::Event& evt)
+  void HitFinderProtoDUNESP::produce(art::Event& evt, art::ProcessingFrame const&)
   {
     
     auto ChannelHits = evt.getValidHandle<std::vector<recob::Hit>>(fChanHitLabel);
@@ -149,11 +153,11 @@ namespace dune{
     
     // Run alg on all APAs -- check fAlg if we have more than one algorithm defined (future expansion)
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
-    fDisambigAlg.RunDisambig(detProp, ChHits);
+    const DisambigAlgProtoDUNESP::DisambigHits_t disambigHits = fDisambigAlg.Disambiguate(detProp, ChHits, fParallelAPAs);
 
-    for( size_t t=0; t < fDisambigAlg.fDisambigHits.size(); t++ ){
-      art::Ptr<recob::Hit>  hit = fDisambigAlg.fDisambigHits[t].first;
-      geo::WireID           wid = fDisambigAlg.fDisambigHits[t].second;
+    for( size_t t=0; t < disambigHits.size(); t++ ){
+      art::Ptr<recob::Hit>  hit = disambigHits[t].first;
+      geo::WireID           wid = disambigHits[t].second;
       
       // create a new hit copy of the original one, but with new wire ID
       recob::HitCreator disambiguous_hit(*hit, wid);
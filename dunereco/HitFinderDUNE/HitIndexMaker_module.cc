@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       HitIndexMaker
+// Plugin Type: producer
+// File:        HitIndexMaker_module.cc
+//
+// Indexes a recob::Hit collection once per event into a dune::HitIndex,
+// for the stages that look up the hits of a plane or a channel
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "lardataobj/RecoBase/Hit.h"
+#include "dunereco/HitFinderDUNE/products/HitIndex.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dune
+{
+  class HitIndexMaker;
+}
+
+class dune::HitIndexMaker : public art::EDProducer
+{
+public:
+  explicit HitIndexMaker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  HitIndexMaker(HitIndexMaker const&) = delete;
+  HitIndexMaker(HitIndexMaker&&) = delete;
+  HitIndexMaker& operator=(HitIndexMaker const&) = delete;
+  HitIndexMaker& operator=(HitIndexMaker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+  const std::string fHitModule;
+};
+
+dune::HitIndexMaker::HitIndexMaker(fhicl::ParameterSet const& p)
+  : EDProducer{p},
+    fHitModule (p.get<std::string> ("HitModule"))
+{
+  consumes<std::vector<recob::Hit>>(fHitModule);
+
+  produces<dune::HitIndex>();
+}
+
+void dune::HitIndexMaker::produce(art::Event& e)
+{
+  auto hits = e.getValidHandle<std::vector<recob::Hit>>(fHitModule);
+
+  e.put(std::make_unique<dune::HitIndex>(*hits));
+}
+
+DEFINE_ART_MODULE(dune::HitIndexMaker)
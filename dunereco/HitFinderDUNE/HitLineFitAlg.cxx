@@ -9,8 +9,60 @@ m.thiesse@sheffield.ac.uk
 ********************************/
 
 #include "HitLineFitAlg.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+  // Philox4x32-10 counter-based generator (Salmon et al., SC11). Block b of
+  // the stream of iteration i is the encryption of the counter (i,b,0,0)
+  // under the seed, so any iteration's draws can be made on any thread
+  class PhiloxStream {
+  public:
+    PhiloxStream(std::uint32_t seed, std::uint32_t iteration)
+      : fKey{{seed, 0x5DEECE66u}}, fIteration(iteration), fBlock(0), fNext(4) {}
+
+    // random integer in [0,range)
+    unsigned int Uniform(unsigned int range)
+    {
+      if (fNext == 4) Refill();
+      return (unsigned int)((std::uint64_t(fOut[fNext++])*range) >> 32);
+    }
+
+  private:
+    void Refill()
+    {
+      std::array<std::uint32_t,4> ctr{{fIteration, fBlock++, 0u, 0u}};
+      std::array<std::uint32_t,2> key = fKey;
+      for (int round = 0; round < 10; ++round)
+        {
+          const std::uint64_t p0 = std::uint64_t(0xD2511F53u)*ctr[0];
+          const std::uint64_t p1 = std::uint64_t(0xCD9E8D57u)*ctr[2];
+          ctr = {{std::uint32_t(p1 >> 32)^ctr[1]^key[0], std::uint32_t(p1),
+                  std::uint32_t(p0 >> 32)^ctr[3]^key[1], std::uint32_t(p0)}};
+          key[0] += 0x9E3779B9u;
+          key[1] += 0xBB67AE85u;
+        }
+      fOut = ctr;
+      fNext = 0;
+    }
+
+    std::array<std::uint32_t,2> fKey;
+    std::uint32_t fIteration;
+    std::uint32_t fBlock;
+    std::array<std::uint32_t,4> fOut;
+    int fNext;
+  };
+
+}
 
 dune::HitLineFitAlg::HitLineFitAlg(fhicl::ParameterSet const& pset)
+  : fVertRangeMin(0), fVertRangeMax(0), fHorizRangeMin(0), fHorizRangeMax(0), fSeedValue(0)
 {
   this->reconfigure(pset);
 }
@@ -29,23 +81,193 @@ bool dune::HitLineFitAlg::CheckModelParameters()
       if (ipar.first != test) return false;
       ++test;
     }
-  if (fParIVal.size() < 2) return false;
+  if (fParIVal.size() < 2 || fParIVal.size() > kMaxPar) return false;
   return true;
 }
 
-float dune::HitLineFitAlg::PointToLineDist(TVector3 ptloc, TVector3 linept1, TVector3 linept2)
+double dune::HitLineFitAlg::EvalPolynomial(const PolyFit & fit, double x) const
 {
-  return (((ptloc-linept1).Cross(ptloc-linept2)).Mag()/(linept2-linept1).Mag());
+  double y = 0;
+  for (int ipar = fFitPolN; ipar >= 0; --ipar) y = y*x + fit.par[ipar];
+  return y;
 }
 
-void dune::HitLineFitAlg::DeterministicShuffle(std::vector<unsigned int> & vec)
+void dune::HitLineFitAlg::LineDistances(const PolyFit & fit, const std::vector<double> & horiz, const std::vector<double> & vert,
+                                        std::vector<float> & dist) const
 {
-  TRandom3 rand(fSeedValue);
-  for (size_t i = vec.size()-1; i > 0; --i)
+  // Distance from each hit to the chord of the model between horiz-1 and horiz+1.
+  // With the chord ends one unit either side of the hit, the cross product reduces to 2*vert-f(horiz-1)-f(horiz+1)
+  for (size_t i = 0; i < horiz.size(); ++i)
+    {
+      const double f1 = EvalPolynomial(fit,horiz[i]-1);
+      const double f2 = EvalPolynomial(fit,horiz[i]+1);
+      dist[i] = std::fabs(2*vert[i]-f1-f2)/std::sqrt(4+(f2-f1)*(f2-f1));
+    }
+}
+
+bool dune::HitLineFitAlg::FitPolynomial(const std::vector<double> & horiz, const std::vector<double> & vert,
+                                        const std::vector<HitLineFitData> & data, const std::vector<unsigned int> & keys,
+                                        PolyFit & fit) const
+{
+  // Weighted least squares through the normal equations. The horizontal coordinate is
+  // scaled to [-1,1] so the equations stay well conditioned. Parameters that end up
+  // outside their limits are fixed at the limit and the others are refitted.
+  // The first pass uses the vertical errors only, the second pass uses the effective
+  // variance including the horizontal errors, as the ROOT fitter did.
+  // As with the range option of the ROOT fit, points outside the horizontal range
+  // set by SetHorizVertRanges take no part, they are given a zero weight.
+  const int npar = fFitPolN+1;
+  fit.par.fill(0.);
+  fit.parErr.fill(0.);
+  fit.chi2 = 0;
+  fit.ndf = 0;
+
+  double scale = 0;
+  int nused = 0;
+  for (unsigned int key : keys)
+    {
+      if (!InHorizRange(horiz[key])) continue;
+      scale = std::max(scale,std::fabs(horiz[key]));
+      ++nused;
+    }
+  if (nused == 0) return false;
+  if (scale <= 0) scale = 1;
+
+  std::array<double,kMaxPar> scalePow, lo, hi;
+  std::array<bool,kMaxPar> bounded;
+  for (int ipar = 0; ipar < npar; ++ipar)
+    {
+      scalePow[ipar] = (ipar == 0) ? 1. : scalePow[ipar-1]*scale;
+      const ParVals & vals = fParIVal.at(ipar);
+      bounded[ipar] = vals.min < vals.max;
+      lo[ipar] = vals.min*scalePow[ipar];
+      hi[ipar] = vals.max*scalePow[ipar];
+    }
+
+  std::array<double,kMaxPar> b, bErr;
+  b.fill(0.);
+  bErr.fill(0.);
+  std::array<double,2*kMaxPar-1> up;
+  std::vector<double> weight(keys.size());
+  int nfree = 0;
+  for (int pass = 0; pass < 2; ++pass)
+    {
+      for (size_t i = 0; i < keys.size(); ++i)
+        {
+          if (!InHorizRange(horiz[keys[i]]))
+            {
+              weight[i] = 0;
+              continue;
+            }
+          const HitLineFitData & thisdata = data[keys[i]];
+          double sy = 0.5*(thisdata.hitVertErrLo+thisdata.hitVertErrHi);
+          double var = 0;
+          if (pass == 0) var = sy*sy;
+          else
+            {
+              const double x = horiz[keys[i]];
+              const double resid = vert[keys[i]]-EvalPolynomial(fit,x);
+              sy = (resid > 0) ? thisdata.hitVertErrLo : thisdata.hitVertErrHi;
+              double slope = 0;
+              for (int ipar = fFitPolN; ipar >= 1; --ipar) slope = slope*x + ipar*fit.par[ipar];
+              const double sx = 0.5*(thisdata.hitHorizErrLo+thisdata.hitHorizErrHi);
+              var = sy*sy + slope*slope*sx*sx;
+            }
+          weight[i] = (var > 0) ? 1./var : 1.;
+        }
+
+      // Normal equations A.b = r in the scaled coordinate
+      double A[kMaxPar][kMaxPar] = {};
+      double r[kMaxPar] = {};
+      for (size_t i = 0; i < keys.size(); ++i)
+        {
+          const double u = horiz[keys[i]]/scale;
+          up[0] = weight[i];
+          for (int j = 1; j < 2*npar-1; ++j) up[j] = up[j-1]*u;
+          for (int j = 0; j < npar; ++j)
+            {
+              r[j] += up[j]*vert[keys[i]];
+              for (int l = 0; l < npar; ++l) A[j][l] += up[j+l];
+            }
+        }
+
+      std::array<bool,kMaxPar> fixed;
+      fixed.fill(false);
+      bool solved = false;
+      for (int iter = 0; iter <= npar && !solved; ++iter)
+        {
+          int freePar[kMaxPar];
+          nfree = 0;
+          for (int ipar = 0; ipar < npar; ++ipar) if (!fixed[ipar]) freePar[nfree++] = ipar;
+          if (nfree == 0) break;
+
+          // Invert the free block by Gauss-Jordan elimination with partial pivoting
+          double M[kMaxPar][2*kMaxPar] = {};
+          double rhs[kMaxPar];
+          for (int j = 0; j < nfree; ++j)
+            {
+              rhs[j] = r[freePar[j]];
+              for (int ipar = 0; ipar < npar; ++ipar) if (fixed[ipar]) rhs[j] -= A[freePar[j]][ipar]*b[ipar];
+              for (int l = 0; l < nfree; ++l) M[j][l] = A[freePar[j]][freePar[l]];
+              M[j][nfree+j] = 1.;
+            }
+          for (int col = 0; col < nfree; ++col)
+            {
+              int pivot = col;
+              for (int j = col+1; j < nfree; ++j) if (std::fabs(M[j][col]) > std::fabs(M[pivot][col])) pivot = j;
+              if (std::fabs(M[pivot][col]) < 1e-300) return false;
+              if (pivot != col) for (int l = 0; l < 2*nfree; ++l) std::swap(M[pivot][l],M[col][l]);
+              const double norm = 1./M[col][col];
+              for (int l = 0; l < 2*nfree; ++l) M[col][l] *= norm;
+              for (int j = 0; j < nfree; ++j)
+                {
+                  if (j == col || M[j][col] == 0) continue;
+                  const double factor = M[j][col];
+                  for (int l = 0; l < 2*nfree; ++l) M[j][l] -= factor*M[col][l];
+                }
+            }
+
+          int worst = -1;
+          double worstViolation = 0;
+          for (int j = 0; j < nfree; ++j)
+            {
+              double val = 0;
+              for (int l = 0; l < nfree; ++l) val += M[j][nfree+l]*rhs[l];
+              const int ipar = freePar[j];
+              b[ipar] = val;
+              bErr[ipar] = std::sqrt(std::max(M[j][nfree+j],0.));
+              if (!bounded[ipar]) continue;
+              const double violation = std::max(lo[ipar]-val,val-hi[ipar]);
+              if (violation > worstViolation)
+                {
+                  worstViolation = violation;
+                  worst = ipar;
+                }
+            }
+          if (worst < 0) solved = true;
+          else
+            {
+              b[worst] = std::min(std::max(b[worst],lo[worst]),hi[worst]);
+              bErr[worst] = 0;
+              fixed[worst] = true;
+            }
+        }
+      if (!solved) return false;
+
+      for (int ipar = 0; ipar < npar; ++ipar)
+        {
+          fit.par[ipar] = b[ipar]/scalePow[ipar];
+          fit.parErr[ipar] = bErr[ipar]/scalePow[ipar];
+        }
+    }
+
+  for (size_t i = 0; i < keys.size(); ++i)
     {
-      unsigned int randint =  (unsigned int)(rand.Uniform(i+1)); // gives random integer from [0,i) but we need [0,i], so do [0,i+1)...
-      std::swap(vec[randint],vec[i]);
+      const double resid = vert[keys[i]]-EvalPolynomial(fit,horiz[keys[i]]);
+      fit.chi2 += weight[i]*resid*resid;
     }
+  fit.ndf = nused-nfree;
+  return true;
 }
 
 void dune::HitLineFitAlg::SetHorizVertRanges(float hmin, float hmax, float vmin, float vmax)
@@ -54,8 +276,98 @@ void dune::HitLineFitAlg::SetHorizVertRanges(float hmin, float hmax, float vmin,
   fVertRangeMin = vmin; fVertRangeMax = vmax;
 }
 
+void dune::HitLineFitAlg::TryModel(std::uint32_t iteration, unsigned int n, unsigned int d, float t,
+                                   const std::vector<double> & horiz, const std::vector<double> & vert,
+                                   const std::vector<HitLineFitData> & data, Workspace & ws, Candidate & cand) const
+{
+  cand.valid = false;
+  cand.points_best.clear();
+  ws.sampled.resize(data.size(),0);
+  ws.alldist.resize(data.size());
+  ws.points.clear();
+  ws.distances.clear();
+
+  // Randomly sample n distinct points from the original data set
+  PhiloxStream rand(fSeedValue,iteration);
+  while (ws.points.size() < n)
+    {
+      const unsigned int key = rand.Uniform(data.size());
+      if (ws.sampled[key]) continue;
+      ws.sampled[key] = 1;
+      ws.points.push_back(key);
+    }
+
+  // Do initial fit through these n points to the model
+  PolyFit maybe;
+  const bool fitted = FitPolynomial(horiz,vert,data,ws.points,maybe);
+
+  // Now, search through all data points and select those which are near the best fit model
+  if (fitted)
+    {
+      LineDistances(maybe,horiz,vert,ws.alldist);
+      for (size_t i = 0; i < data.size(); ++i)
+        {
+          if (!ws.sampled[i] && ws.alldist[i] <= t) ws.points.push_back(i);
+        }
+    }
+  for (size_t i = 0; i < n; ++i) ws.sampled[ws.points[i]] = 0;
+
+  // If more inliers were found, then we've probably found a good track
+  if (!fitted || ws.points.size() - n <= d) return;
+
+  // Fit to improved data sample
+  if (!FitPolynomial(horiz,vert,data,ws.points,cand.fit)) return;
+
+  // loop over one more time to find all nearby points, and calculate errors in the process
+  LineDistances(cand.fit,horiz,vert,ws.alldist);
+  cand.ssr = 0;
+  for (unsigned int key : ws.points)
+    {
+      const float dist = ws.alldist[key];
+      ws.distances.push_back(fabs(dist));
+      if (dist <= t)
+        {
+          cand.ssr += dist*dist;
+          cand.points_best.push_back(key);
+        }
+    }
+  if (cand.points_best.size() < 2) return;
+
+  // Computing the log likelihood for this model fit
+  std::vector<float> & distances = ws.distances;
+  float sigma = TMath::Median(distances.size(),distances.data());
+  float gamma = 0.5;
+  float p_outlier_prob = 0;
+  float v = 0.5;
+  std::vector<float> & p_inlier_prob = ws.p_inlier_prob;
+  p_inlier_prob.resize(distances.size());
+  for (int j = 0; j < 3; ++j)
+    {
+      for (size_t i = 0; i < distances.size(); ++i)
+        {
+          p_inlier_prob[i] = gamma*TMath::Exp(-(distances[i]*distances[i])/(2*sigma*sigma))/(TMath::Sqrt(2*TMath::Pi())*sigma);
+        }
+      p_outlier_prob = (1-gamma)/v;
+      gamma = 0;
+      for (size_t i = 0; i < distances.size(); ++i)
+        {
+          gamma += p_inlier_prob[i]/(p_inlier_prob[i]+p_outlier_prob);
+        }
+      if (distances.size() > 0) gamma /= distances.size();
+    }
+  float d_cur_penalty = 0;
+  for (size_t i = 0; i < distances.size(); ++i)
+    {
+      d_cur_penalty += TMath::Log(p_inlier_prob[i]+p_outlier_prob);
+    }
+  cand.penalty = (-d_cur_penalty);
+  cand.valid = true;
+}
+
 int dune::HitLineFitAlg::FitLine(std::vector<HitLineFitData> & data, HitLineFitResults & bestfit)
 {
+  DUNE_PROF_SCOPE("dune::HitLineFitAlg::FitLine");
+  DUNE_PROF_COUNT("dune::HitLineFitAlg::FitLine points", data.size());
   if (!CheckModelParameters()) 
     {
       throw cet::exception("HitLineFitAlg") << "Invalid fit parameters. Fix it!";
@@ -64,42 +376,22 @@ int dune::HitLineFitAlg::FitLine(std::vector<HitLineFitData> & data, HitLineFitR
 
   // define variables once
   size_t i;
-  float horiz,vert,dist,ssr,diff,fiterr;
-  TVector3 hitloc,lineloc1,lineloc2;
+  float diff,fiterr;
   int iterations;
-  std::vector<float> distances;  
-
-  // vectors of vector indices of points to request from the input data vector
-  std::vector<unsigned int> points;
-  std::vector<unsigned int> points_best;
-  std::vector<unsigned int> bestkeys;
-  std::vector<unsigned int> datakeys;
+  size_t nbest;
 
   // initialize values
   bestfit.fitsuccess = false;
   iterations = 0;
+  nbest = 0;
   fiterr = std::numeric_limits<float>::max();
 
-  // construct TGraphAsymmErrors for doing the fits
-  TGraphAsymmErrors * maybe = new TGraphAsymmErrors(); 
-  TGraphAsymmErrors * maybebetter = new TGraphAsymmErrors();
-
-  // define the fit model
-  // currently uses a polynomial of N dimensions
-  TF1 * model = new TF1("model",TString::Format("pol%u",fFitPolN),fHorizRangeMin,fHorizRangeMax);
-  model->SetNpx(10000);
-  model->SetParNames("constant","linear","quadratic","cubic","quartic","quintic");
-  for (auto & ipar : fParIVal)
-    {
-      model->SetParLimits(ipar.first,ipar.second.min,ipar.second.max);
-      model->SetParameter(ipar.first,ipar.second.start);
-    }
-
   // steering parameters for the RANSAC algorithm
   // n (fMinStartPoints)       = minimum number of data points requred to fit model
   // k (fIterationsMultiplier) = maximum number of iterations allowed, defined as a multiple of the number of points in data set. 200 is usually more than enough
   // t (fInclusionThreshold)   = threshold value for model inclusion, in cm
   // d (fMinAlsoPoints)        = number of close data points requred to assert that a model fits well to data
+  // p (fConfidence)           = probability of having drawn an all-inlier sample at which to stop early, 0 to run all k iterations
   unsigned int n = std::max((unsigned int)fMinStartPoints,(unsigned int)(data.size()*0.01));
   if (n >= data.size()) return -1;
   int k = data.size()*fIterationsMultiplier;
@@ -107,8 +399,15 @@ int dune::HitLineFitAlg::FitLine(std::vector<HitLineFitData> & data, HitLineFitR
   unsigned int d = std::max(int(data.size()*0.05-n),int(fMinAlsoPoints));
   if (d < 2*n || n < 2) return -2;
 
-  // make collection of indices to refer back to data vector
-  for (i = 0; i < data.size(); ++i) datakeys.push_back(i);
+  // flat copies of the hit positions, and buffers reused by the iterations of each thread
+  std::vector<double> horizVec(data.size()), vertVec(data.size());
+  for (i = 0; i < data.size(); ++i)
+    {
+      horizVec[i] = data[i].hitHoriz;
+      vertVec[i] = data[i].hitVert;
+    }
+  tbb::enumerable_thread_specific<Workspace> workspaces;
+  std::vector<Candidate> candidates(kIterationChunk);
 
 
   if (fLogLevel > 1) std::cout << "Minimum number of data points required to fit the model, n=" << n << "\n" 
@@ -117,154 +416,66 @@ int dune::HitLineFitAlg::FitLine(std::vector<HitLineFitData> & data, HitLineFitR
 			       << "Number of close data points required to assert a good fit, d=" << d << std::endl;
 
 
-  // DO MAIN LOOP
+  // DO MAIN LOOP, a chunk of iterations at a time. The candidates of a chunk are
+  // compared in iteration order, so the best fit is the one a serial loop finds
   while (iterations < k)
     {
-      ++iterations;
-
-      // reset collections
-      maybe->Clear();
-      maybebetter->Clear();
-      points.clear();
-      points_best.clear();
-      distances.clear();
-      if (fLogLevel > 1) 
-	{
-	  if (iterations % 1000 == 0) std::cout << "Iteration # " << iterations << std::endl;
-	}
-
-      // Shuffle list of keys
-      DeterministicShuffle(datakeys);
-
-      // Randomly sample n points from the original data set
-      for (i = 0; i < n; ++i)
+      const int nchunk = std::min(kIterationChunk,k-iterations);
+      tbb::parallel_for(0, nchunk, [&](int c)
         {
-          points.push_back(datakeys[i]);
-          HitLineFitData thisdata = data.at(datakeys[i]);
-          maybe->SetPoint(i,thisdata.hitHoriz,thisdata.hitVert);
-          maybe->SetPointError(i,thisdata.hitHorizErrLo,
-			       thisdata.hitHorizErrHi,
-			       thisdata.hitVertErrLo,
-			       thisdata.hitVertErrHi);
-        }
-
-      // Do initial fit through these n points to the model
-      TFitResultPtr r = maybe->Fit("model","SQCBR0");
+          TryModel(iterations+c,n,d,t,horizVec,vertVec,data,workspaces.local(),candidates[c]);
+        });
 
-      // Now, search through all data points and select those which are near the best fit model
-      for (i = n; i < data.size(); ++i)
+      for (int c = 0; c < nchunk; ++c)
         {
-          vert = data.at(datakeys[i]).hitVert;
-          horiz = data.at(datakeys[i]).hitHoriz;
-          hitloc.SetXYZ(horiz,vert,0.);
-          double xloc1[1] = { horiz-1 };
-          double xloc2[1] = { horiz+1 };
-          lineloc1.SetXYZ(horiz-1,model->EvalPar(xloc1,r->GetParams()),0.);
-          lineloc2.SetXYZ(horiz+1,model->EvalPar(xloc2,r->GetParams()),0.);
-          dist = PointToLineDist(hitloc,lineloc1,lineloc2);
-          if (dist <= t) points.push_back(datakeys[i]);
-        }
-
-      // If more inliers were found, then we've probably found a good track
-      if (points.size() - n > d)
-        {
-	  // Make collection of point locations from improved set
-          for (i = 0; i < points.size(); ++i)
-            {
-              HitLineFitData thisdata = data.at(points[i]);
-              maybebetter->SetPoint(i,thisdata.hitHoriz,thisdata.hitVert);
-              maybebetter->SetPointError(i,thisdata.hitHorizErrLo,thisdata.hitHorizErrHi,thisdata.hitVertErrLo,thisdata.hitVertErrHi);
-            }
-
-	  // Fit to improved data sample
-          TFitResultPtr rb = maybebetter->Fit("model","SQCBR0");
+          ++iterations;
+          if (fLogLevel > 1) 
+	    {
+	      if (iterations % 1000 == 0) std::cout << "Iteration # " << iterations << std::endl;
+	    }
 
-	  // loop over one more time to find all nearby points, and calculate errors in the process
-          ssr = 0;
-          for (i = 0; i < points.size(); ++i)
-            {
-              vert = data.at(points[i]).hitVert;
-              horiz = data.at(points[i]).hitHoriz;
-              hitloc.SetXYZ(horiz,vert,0.);
-              double xloc1[1] = { horiz-1 };
-              double xloc2[1] = { horiz+1 };
-              lineloc1.SetXYZ(horiz-1,model->EvalPar(xloc1,rb->GetParams()),0.);
-              lineloc2.SetXYZ(horiz+1,model->EvalPar(xloc2,rb->GetParams()),0.);
-              dist = PointToLineDist(hitloc,lineloc1,lineloc2);
-              distances.push_back(fabs(dist));
-              if (dist <= t)
-                {
-                  ssr += dist*dist;
-                  points_best.push_back(points[i]);
-                }
-            }
-	  if (points_best.size() < 2) continue;
-
-	  // Computing the log likelihood for this model fit
-          float sigma = TMath::Median(distances.size(),distances.data());
-          float gamma = 0.5;
-          float p_outlier_prob = 0;
-          float v = 0.5;
-          std::vector<float> p_inlier_prob(distances.size());
-          for (int j = 0; j < 3; ++j)
-            {
-              for (i = 0; i < distances.size(); ++i)
-                {
-                  p_inlier_prob[i] = gamma*TMath::Exp(-(distances[i]*distances[i])/(2*sigma*sigma))/(TMath::Sqrt(2*TMath::Pi())*sigma);
-                }
-              p_outlier_prob = (1-gamma)/v;
-              gamma = 0;
-              for (i = 0; i < distances.size(); ++i)
-                {
-                  gamma += p_inlier_prob[i]/(p_inlier_prob[i]+p_outlier_prob);
-                }
-              if (distances.size() > 0) gamma /= distances.size();
-            }
-          float d_cur_penalty = 0;
-          for (i = 0; i < distances.size(); ++i)
-            {
-              d_cur_penalty += TMath::Log(p_inlier_prob[i]+p_outlier_prob);
-            }
-          d_cur_penalty = (-d_cur_penalty);
+          const Candidate & cand = candidates[c];
 
 	  // If a minimum -Log(L), then take this data set as "true"
 	  // Also require that the slope is not zero
-          if (d_cur_penalty < fiterr && fabs(model->GetParameter("linear")) > 0.0015)
+          if (cand.valid && cand.penalty < fiterr && fabs(cand.fit.par[1]) > 0.0015)
             {
-              diff = d_cur_penalty-fiterr;
-              fiterr = d_cur_penalty;
+              diff = cand.penalty-fiterr;
+              fiterr = cand.penalty;
 	      for (auto & ipar : fParIVal)
 		{
-		  bestfit.bestVal[ipar.first] = model->GetParameter(ipar.first);
-		  bestfit.bestValError[ipar.first] = model->GetParError(ipar.first);
+		  bestfit.bestVal[ipar.first] = cand.fit.par[ipar.first];
+		  bestfit.bestValError[ipar.first] = cand.fit.parErr[ipar.first];
 		}
-              bestfit.chi2 = model->GetChisquare();
-              bestfit.ndf = model->GetNDF();
-              bestfit.sum2resid = ssr;
+              bestfit.chi2 = cand.fit.chi2;
+              bestfit.ndf = cand.fit.ndf;
+              bestfit.sum2resid = cand.ssr;
               bestfit.mle = fiterr;
               bestfit.fitsuccess = true;
+              nbest = cand.points_best.size();
 
 	      // Designate the "real" hits from the "fake" hits
-              for (i = 0; i < data.size(); i++)
-                {
-                  if (std::find(points_best.begin(),points_best.end(),i) != points_best.end())
-                    {
-                      data.at(i).hitREAL = true;
-                    }
-                  else
-                    {
-                      data.at(i).hitREAL = false;
-                    }
-                }
+              for (i = 0; i < data.size(); i++) data[i].hitREAL = false;
+              for (unsigned int key : cand.points_best) data[key].hitREAL = true;
 	      if (fLogLevel > 1)
 		{
 		  std::cout << "-------------Found new minimum!-------------" << std::endl
 			    << "FitError=" << fiterr << "  delta(fiterr)=" << diff << std::endl
-			    << "Number of points included = " << points_best.size() << " out of " << data.size() << std::endl
+			    << "Number of points included = " << nbest << " out of " << data.size() << std::endl
 			    << "--------------------------------------------" << std::endl;
 		}
 	    }
         }
+
+      // Stop once enough samples were drawn to have picked only inliers of the
+      // best model with probability p, given the fraction of inliers it has
+      if (fConfidence > 0 && bestfit.fitsuccess)
+        {
+          const double allInliers = std::pow(double(nbest)/data.size(),double(n));
+          if (allInliers >= 1) break;
+          const double needed = std::log(1.-fConfidence)/std::log(1.-allInliers);
+          if (iterations >= needed) break;
+        }
     }
   if (bestfit.fitsuccess) return 1;
   return 0;
@@ -276,5 +487,6 @@ void dune::HitLineFitAlg::reconfigure(fhicl::ParameterSet const& p)
   fMinAlsoPoints = p.get<int>("MinAlsoPoints");
   fIterationsMultiplier = p.get<float>("IterationsMultiplier");
   fInclusionThreshold = p.get<float>("InclusionThreshold");
+  fConfidence = p.get<float>("Confidence",0.);
   fLogLevel = p.get<int>("LogLevel",1);
 }
@@ -6,14 +6,12 @@
 
 #include "RobustHitFinderSupport.h"
 
-#include "TVector3.h"
-#include "TRandom3.h"
-#include "TF1.h"
-#include "TFitResult.h"
 #include "TMath.h"
-#include "TGraphAsymmErrors.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -54,16 +52,64 @@ public:
 
     int FitLine(std::vector<HitLineFitData> & data, HitLineFitResults & bestfit);
     void SetParameter(int i, double startValue, double minValue, double maxValue);
+    // Only hits with hmin <= horiz <= hmax are used in the fits, all hits if hmin >= hmax (the default)
     void SetHorizVertRanges(float hmin, float hmax, float vmin, float vmax);
+    // Each iteration draws its sample from its own random stream, derived
+    // from the seed and the iteration number, so the fit does not depend on
+    // how the iterations are spread over threads
     void SetSeed(UInt_t seed) {
       fSeedValue = seed;
     }
 
 private:
-    float PointToLineDist(TVector3 ptloc, TVector3 linept1, TVector3 linept2);
-    void DeterministicShuffle(std::vector<unsigned int> & vec);
+    // highest supported polynomial is a quintic
+    static constexpr int kMaxPar = 6;
+
+    // result of one weighted least-squares polynomial fit
+    struct PolyFit {
+      std::array<double,kMaxPar> par;
+      std::array<double,kMaxPar> parErr;
+      double chi2;
+      int ndf;
+    };
+
+    bool FitPolynomial(const std::vector<double> & horiz, const std::vector<double> & vert,
+                       const std::vector<HitLineFitData> & data, const std::vector<unsigned int> & keys,
+                       PolyFit & fit) const;
+    double EvalPolynomial(const PolyFit & fit, double x) const;
+    bool InHorizRange(double x) const {
+      return fHorizRangeMin >= fHorizRangeMax || (x >= fHorizRangeMin && x <= fHorizRangeMax);
+    }
+    void LineDistances(const PolyFit & fit, const std::vector<double> & horiz, const std::vector<double> & vert,
+                       std::vector<float> & dist) const;
     bool CheckModelParameters();
 
+    // buffers of one thread, reused by the iterations it runs
+    struct Workspace {
+      std::vector<char> sampled;
+      std::vector<float> alldist;
+      std::vector<unsigned int> points;
+      std::vector<float> distances;
+      std::vector<float> p_inlier_prob;
+    };
+
+    // best refined model of one iteration
+    struct Candidate {
+      bool valid;
+      float penalty;
+      float ssr;
+      PolyFit fit;
+      std::vector<unsigned int> points_best;
+    };
+
+    // iterations run in parallel as chunks of this many, a number that does
+    // not depend on the threads so neither does the early termination
+    static constexpr int kIterationChunk = 64;
+
+    void TryModel(std::uint32_t iteration, unsigned int n, unsigned int d, float t,
+                  const std::vector<double> & horiz, const std::vector<double> & vert,
+                  const std::vector<HitLineFitData> & data, Workspace & ws, Candidate & cand) const;
+
     float fVertRangeMin;
     float fVertRangeMax;
     float fHorizRangeMin;
@@ -78,6 +124,7 @@ private:
     int fMinAlsoPoints;
     float fIterationsMultiplier;
     float fInclusionThreshold;
+    float fConfidence;
     int fLogLevel;
   };
 
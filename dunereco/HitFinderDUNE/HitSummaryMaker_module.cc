@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       HitSummaryMaker
+// Plugin Type: producer
+// File:        HitSummaryMaker_module.cc
+//
+// Summarises a recob::Hit collection once per event into a
+// dune::HitSummary, for the filters and later stages that only need
+// hit counts, charge sums or time ranges
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "lardataobj/RecoBase/Hit.h"
+#include "dunereco/HitFinderDUNE/products/HitSummary.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dune
+{
+  class HitSummaryMaker;
+}
+
+class dune::HitSummaryMaker : public art::EDProducer
+{
+public:
+  explicit HitSummaryMaker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  HitSummaryMaker(HitSummaryMaker const&) = delete;
+  HitSummaryMaker(HitSummaryMaker&&) = delete;
+  HitSummaryMaker& operator=(HitSummaryMaker const&) = delete;
+  HitSummaryMaker& operator=(HitSummaryMaker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+  const std::string fHitModule;
+};
+
+dune::HitSummaryMaker::HitSummaryMaker(fhicl::ParameterSet const& p)
+  : EDProducer{p},
+    fHitModule (p.get<std::string> ("HitModule"))
+{
+  consumes<std::vector<recob::Hit>>(fHitModule);
+
+  produces<dune::HitSummary>();
+}
+
+void dune::HitSummaryMaker::produce(art::Event& e)
+{
+  auto hits = e.getValidHandle<std::vector<recob::Hit>>(fHitModule);
+
+  e.put(std::make_unique<dune::HitSummary>(*hits));
+}
+
+DEFINE_ART_MODULE(dune::HitSummaryMaker)
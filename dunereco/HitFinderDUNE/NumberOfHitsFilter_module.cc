@@ -22,6 +22,9 @@
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 
+#include "dunereco/HitFinderDUNE/HitCounting.h"
+#include "dunereco/HitFinderDUNE/products/HitSummary.h"
+
 namespace hit{
   class NumberOfHitsFilter;
 }
@@ -42,6 +45,8 @@ private:
   bool fLimitPerTPC;
   unsigned int fHitLimit;
   std::string fHitModule;
+  /// HitSummaryMaker of the same hits, empty to count the hits here
+  std::string fHitSummaryLabel;
   bool fScaleThresholdForReadoutWindow;
   bool fVerbose;
 };
@@ -53,6 +58,7 @@ hit::NumberOfHitsFilter::NumberOfHitsFilter(fhicl::ParameterSet const& pset):
   fLimitPerTPC = pset.get<bool>("LimitPerTPC");
   fHitLimit = pset.get<unsigned int>("HitLimit");
   fHitModule = pset.get<std::string>("HitModule");
+  fHitSummaryLabel = pset.get<std::string>("HitSummaryLabel", "");
   fVerbose = pset.get<bool>("Verbose");
   fScaleThresholdForReadoutWindow = pset.get<bool>("ScaleThresholdForReadoutWindow");
 }
@@ -75,43 +81,20 @@ bool hit::NumberOfHitsFilter::beginRun(art::Run& r){
 //-----------------------------------------------------------------------
 bool hit::NumberOfHitsFilter::filter(art::Event& evt){
 
-  // Get the hit collection from the event 
-  auto allHits = evt.getValidHandle<std::vector<recob::Hit> >(fHitModule);  
- 
-  bool result = true;
-
-  if(fLimitPerTPC){
-    // Find the number of hits per TPC and then filter based on a large value
-    std::map<unsigned int,unsigned int> hitsPerTPC;
-
-    for(auto const &hit : *allHits){
-      hitsPerTPC[hit.WireID().TPC]++;
-    }
-    
-    for(auto const m:  hitsPerTPC){
-
-      if (fVerbose) {
-        std::cout << m.second << " hits in TPC " << m.first << std::endl;
-      }
-
-      if(m.second > fHitLimit){
-        result = false;
-        break;
-      }
-    }
-  }
-  else{
+  // The summary has the counts already
+  if(!fHitSummaryLabel.empty()){
+    auto const& summary = *evt.getValidHandle<dune::HitSummary>(fHitSummaryLabel);
+    const unsigned int nHits = fLimitPerTPC ? summary.MaxHitsPerTPC() : summary.NHits();
     if (fVerbose) {
-      std::cout << allHits->size() << " hits in all TPCs" << std::endl;
-    }
-
-
-    // This is the simplest thing we can do, just cut on the total number of hits
-    if (allHits->size() > fHitLimit){
-      result = false;
+      std::cout << nHits << (fLimitPerTPC ? " hits in the fullest TPC" : " hits in all TPCs") << std::endl;
     }
+    return nHits <= fHitLimit;
   }
 
+  // Get the hit collection from the event 
+  auto allHits = evt.getValidHandle<std::vector<recob::Hit> >(fHitModule);  
+ 
+  bool result = hit::WithinHitLimit(*allHits, fHitLimit, fLimitPerTPC, fVerbose);
 
   return result;
 }
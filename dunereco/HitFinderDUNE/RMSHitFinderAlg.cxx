@@ -10,6 +10,12 @@ m.thiesse@sheffield.ac.uk
 ****************************************/
 
 #include "RMSHitFinderAlg.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+#include <cmath>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
 
 dune::RMSHitFinderAlg::RMSHitFinderAlg(fhicl::ParameterSet const & p)
 {
@@ -23,29 +29,101 @@ void dune::RMSHitFinderAlg::reconfigure(fhicl::ParameterSet const& p)
   fFilterWidth = p.get<float>("FilterWidth");
   fSigmaRiseThreshold = p.get<float>("SigmaRiseThreshold");
   fSigmaFallThreshold = p.get<float>("SigmaFallThreshold");
+  fPreScanThreshold = p.get<float>("PreScanThreshold",0);
+  fPreScanPad = p.get<int>("PreScanPad",fWindowWidth);
+  fPlacement = dune::numa::PlacementFromPSet(p);
 }
 
-void dune::RMSHitFinderAlg::FindHits(dune::ChannelInformation & chan)
+void dune::RMSHitFinderAlg::FindHits(dune::ChannelInformation & chan) const
 {
-  if (fSearchTickStart < 0 || fSearchTickEnd < 0)
+  // The search window is resolved per channel so that concurrent calls never write to the alg
+  int searchTickStart = fSearchTickStart, searchTickEnd = fSearchTickEnd;
+  if (searchTickStart < 0 || searchTickEnd < 0)
     {
-      fSearchTickStart = 0; fSearchTickEnd = chan.signalSize;
+      searchTickStart = 0; searchTickEnd = chan.signalSize;
     }
-  std::vector<float> signalFilter(chan.signalFilterVec.begin()+fSearchTickStart,chan.signalFilterVec.begin()+fSearchTickEnd);
   //FilterWaveform(chan.signalVec,chan.signalFilterVec);
   //FilterWaveform(signal,signalFilter);
   //RobustRMSBase(chan.signalVec,chan.baseline,chan.rms);
   //RobustRMSBase(signalFilter,chan.baselineFilter,chan.rmsFilter);
-  FindPulses(signalFilter,chan.baselineFilter,chan.rmsFilter,chan.pulse_ends);
+  if (fPreScanThreshold <= 0)
+    {
+      chan.pulse_ends.clear();
+      FindPulses(chan.signalFilterVec.data()+searchTickStart,searchTickEnd-searchTickStart,searchTickStart,
+                 chan.baselineFilter,chan.rmsFilter,chan.prefixSums,chan.pulse_ends);
+      MergeHits(chan.pulse_ends);
+      return;
+    }
+
+  // Only look for pulses around the samples that pass the coarse threshold, so quiet channels cost one pass
+  ScanRegions(chan,searchTickStart,searchTickEnd,chan.scanRegions);
+  chan.pulse_ends.clear();
+  for (const auto & region : chan.scanRegions)
+    {
+      FindPulses(chan.signalFilterVec.data()+region.first,region.second-region.first,region.first,
+                 chan.baselineFilter,chan.rmsFilter,chan.prefixSums,chan.pulse_ends);
+    }
   MergeHits(chan.pulse_ends);
 }
 
-void dune::RMSHitFinderAlg::FilterWaveform(std::vector<float> wf, std::vector<float> & fwf)
+void dune::RMSHitFinderAlg::ScanRegions(const dune::ChannelInformation & chan, int searchTickStart, int searchTickEnd,
+                                        std::vector<std::pair<int,int> > & regions) const
+{
+  regions.clear();
+  // A pulse is opened by a window mean above the rise threshold, which needs at least one sample above it.
+  // The pad leaves room for the backward search of the pulse start and for the falling edge
+  const float threshold = chan.baselineFilter+fPreScanThreshold*chan.rmsFilter;
+  const int pad = fWindowWidth+fPreScanPad;
+  const float * wf = chan.signalFilterVec.data();
+  for (int i_wf = searchTickStart; i_wf < searchTickEnd; ++i_wf)
+    {
+      if (wf[i_wf] <= threshold) continue;
+      const int start = std::max(i_wf-pad,searchTickStart);
+      const int end = std::min(i_wf+pad,searchTickEnd);
+      if (!regions.empty() && start <= regions.back().second) regions.back().second = end;
+      else regions.push_back(std::make_pair(start,end));
+    }
+}
+
+void dune::RMSHitFinderAlg::FindHits(dune::ChanMap_t & chanMap) const
+{
+  DUNE_PROF_SCOPE("dune::RMSHitFinderAlg::FindHits");
+  DUNE_PROF_COUNT("dune::RMSHitFinderAlg::FindHits channels", chanMap.size());
+  // Flatten the map so the channels can be handed out by index
+  std::vector<dune::ChannelInformation*> chans;
+  chans.reserve(chanMap.size());
+  for (auto & chan : chanMap) chans.push_back(&chan.second);
+
+  dune::numa::Execute(fPlacement, [this,&chans]
+    {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0,chans.size()),
+                        [this,&chans](const tbb::blocked_range<size_t> & range)
+                        {
+                          for (size_t i = range.begin(); i != range.end(); ++i) FindHits(*chans[i]);
+                        });
+    });
+}
+
+void dune::RMSHitFinderAlg::FindHits(dune::ChannelTable & chanTable) const
+{
+  DUNE_PROF_SCOPE("dune::RMSHitFinderAlg::FindHits");
+  DUNE_PROF_COUNT("dune::RMSHitFinderAlg::FindHits channels", chanTable.size());
+  dune::numa::Execute(fPlacement, [this,&chanTable]
+    {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0,chanTable.size()),
+                        [this,&chanTable](const tbb::blocked_range<size_t> & range)
+                        {
+                          for (size_t i = range.begin(); i != range.end(); ++i) FindHits(chanTable[i]);
+                        });
+    });
+}
+
+void dune::RMSHitFinderAlg::FilterWaveform(const std::vector<float> & wf, std::vector<float> & fwf) const
 {
-  fwf.clear();
+  // Forward then backward single pole filter. The forward pass is kept in fwf and overwritten by
+  // the backward one, so no intermediate waveform is allocated and fwf keeps its capacity
   unsigned int wfs = wf.size();
   fwf.resize(wfs);
-  std::vector<float> intermediate_wf(wfs);
   float filter_coef = static_cast<float>(TMath::Exp(static_cast<double>(-1.0/fFilterWidth)));
   float a0 = 1.0-filter_coef;
   float b1 = filter_coef;
@@ -54,67 +132,92 @@ void dune::RMSHitFinderAlg::FilterWaveform(std::vector<float> wf, std::vector<fl
     {
       if (i<order)
         {
-          intermediate_wf[i] = wf[i];
+          fwf[i] = wf[i];
         }
       else
         {
-          intermediate_wf[i] = a0*wf[i]+b1*intermediate_wf[i-1];
+          fwf[i] = a0*wf[i]+b1*fwf[i-1];
         }
     }
-  for (size_t i = 0; i < wfs; ++i)
+  for (size_t i = order; i < wfs; ++i)
     {
-      if (i<order)
-        {
-          fwf[wfs-1-i] = intermediate_wf[wfs-1-i];
-        }
-      else
-        {
-          fwf[wfs-1-i] = a0*intermediate_wf[wfs-1-i]+b1*fwf[wfs-i];
-        }
+      fwf[wfs-1-i] = a0*fwf[wfs-1-i]+b1*fwf[wfs-i];
     }
 }
 
-void dune::RMSHitFinderAlg::RobustRMSBase(std::vector<float> wf, float & bl, float & r)
+float dune::RMSHitFinderAlg::Median(std::vector<float> & vals)
+{
+  // Same convention as TMath::Median, but by selection rather than a full sort
+  if (vals.empty()) return 0;
+  const size_t half = vals.size()/2;
+  std::nth_element(vals.begin(),vals.begin()+half,vals.end());
+  if (vals.size()%2 == 1) return vals[half];
+  const float lower = *std::max_element(vals.begin(),vals.begin()+half);
+  return static_cast<float>(0.5*(static_cast<double>(lower)+static_cast<double>(vals[half])));
+}
+
+void dune::RMSHitFinderAlg::PrefixSums(const float * wf, size_t n, std::vector<double> & sums)
 {
+  // sums[i] is the sum of the first i samples, so any window sum is a difference of two entries
+  sums.resize(n+1);
+  sums[0] = 0;
+  for (size_t i = 0; i < n; ++i) sums[i+1] = sums[i]+wf[i];
+}
+
+void dune::RMSHitFinderAlg::RobustRMSBase(const std::vector<float> & wf, float & bl, float & r) const
+{
+  // Sliding window means and RMS from running sums, rather than recomputing every window
   unsigned int window_size = (unsigned int)(0.10*wf.size());
+  std::vector<double> sums;
+  PrefixSums(wf.data(),wf.size(),sums);
+
   std::vector<float> bl_collection;
+  bl_collection.reserve(wf.size()-window_size);
   for (size_t i_wf = 0; i_wf < wf.size()-window_size; ++i_wf)
     {
-      std::vector<float> partial_window(wf.begin()+i_wf,wf.begin()+i_wf+window_size);
-      bl_collection.push_back(static_cast<float>(TMath::Mean(partial_window.size(),partial_window.data())));
+      bl_collection.push_back(static_cast<float>((sums[i_wf+window_size]-sums[i_wf])/window_size));
     }
-  bl = static_cast<float>(TMath::Median(bl_collection.size(),bl_collection.data()));
+  bl = Median(bl_collection);
 
-  std::vector<float> bl_sub_wf;
-  for (size_t i_wf = 0; i_wf < wf.size(); ++i_wf) bl_sub_wf.push_back(wf[i_wf]-bl);
+  std::vector<double> sub_sums(wf.size()+1), sub_sums2(wf.size()+1);
+  sub_sums[0] = 0; sub_sums2[0] = 0;
+  for (size_t i_wf = 0; i_wf < wf.size(); ++i_wf)
+    {
+      const double sub = wf[i_wf]-bl;
+      sub_sums[i_wf+1] = sub_sums[i_wf]+sub;
+      sub_sums2[i_wf+1] = sub_sums2[i_wf]+sub*sub;
+    }
 
+  // Sample RMS about the window mean, as TMath::RMS
   std::vector<float> rms_collection;
-  for (size_t i_wf = 0; i_wf < bl_sub_wf.size()-window_size; ++i_wf)
+  rms_collection.reserve(wf.size()-window_size);
+  for (size_t i_wf = 0; i_wf < wf.size()-window_size; ++i_wf)
     {
-      std::vector<float> partial_window(bl_sub_wf.begin()+i_wf,bl_sub_wf.begin()+i_wf+window_size);
-      rms_collection.push_back(static_cast<float>(TMath::RMS(partial_window.size(),partial_window.data())));
-
+      const double s1 = sub_sums[i_wf+window_size]-sub_sums[i_wf];
+      const double s2 = sub_sums2[i_wf+window_size]-sub_sums2[i_wf];
+      const double var = (window_size > 1) ? (s2-s1*s1/window_size)/(window_size-1) : 0.;
+      rms_collection.push_back(static_cast<float>(std::sqrt(std::max(var,0.))));
     }
-  r = static_cast<float>(TMath::Median(rms_collection.size(),rms_collection.data()));
+  r = Median(rms_collection);
 }
 
 
-void dune::RMSHitFinderAlg::FindPulses(std::vector<float> wf, float bl, float r, std::vector<std::pair<int,int> > & pulse_ends)
+void dune::RMSHitFinderAlg::FindPulses(const float * wf, int wfSize, int tickOffset, float bl, float r, std::vector<double> & sums,
+                                       std::vector<std::pair<int,int> > & pulse_ends) const
 {
-  pulse_ends.clear();
+  // The pulses are appended, so the callers can collect those of several ranges
   int start = 0, end = 0;
   bool started = false;
-  for (int i_wf = 0; i_wf < static_cast<int>(wf.size())-fWindowWidth; ++i_wf)
+  PrefixSums(wf,std::max(wfSize,0),sums);
+  for (int i_wf = 0; i_wf < wfSize-fWindowWidth; ++i_wf)
     {
-      std::vector<float> window(wf.begin()+i_wf,wf.begin()+i_wf+fWindowWidth);
-      float window_mean = static_cast<float>(TMath::Mean(window.size(),window.data()));
+      float window_mean = static_cast<float>((sums[i_wf+fWindowWidth]-sums[i_wf])/fWindowWidth);
       if ((window_mean > bl+fSigmaRiseThreshold*r) && !started)
         {
           started = true;
           for (int i_wf_back = i_wf-1; i_wf_back >= 0; --i_wf_back)
             {
-              std::vector<float> window_back(wf.begin()+i_wf_back,wf.begin()+i_wf_back+fWindowWidth);
-              float window_mean_back = static_cast<float>(TMath::Mean(window_back.size(),window_back.data()));
+              float window_mean_back = static_cast<float>((sums[i_wf_back+fWindowWidth]-sums[i_wf_back])/fWindowWidth);
               if (window_mean_back < bl+fSigmaFallThreshold*r)
                 {
                   start = i_wf_back;
@@ -127,17 +230,17 @@ void dune::RMSHitFinderAlg::FindPulses(std::vector<float> wf, float bl, float r,
         {
           started = false;
           end = i_wf+fWindowWidth;
-          pulse_ends.push_back(std::make_pair(start+fSearchTickStart,end+fSearchTickStart));
+          pulse_ends.push_back(std::make_pair(start+tickOffset,end+tickOffset));
           continue;
         }
     }
   if (started)
     {
-      pulse_ends.push_back(std::make_pair(start+fSearchTickStart,wf.size()-1+fSearchTickStart));
+      pulse_ends.push_back(std::make_pair(start+tickOffset,wfSize-1+tickOffset));
     }
 }
 
-void dune::RMSHitFinderAlg::MergeHits(std::vector<std::pair<int,int> > & pulse_ends)
+void dune::RMSHitFinderAlg::MergeHits(std::vector<std::pair<int,int> > & pulse_ends) const
 {
   std::vector<std::pair<int,int> > oldpulse_ends = std::move(pulse_ends);
   pulse_ends.clear();
@@ -6,10 +6,12 @@
 #include "TMath.h"
 
 #include "RobustHitFinderSupport.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
 
 #include <memory>
 #include <algorithm>
 #include <map>
+#include <vector>
 
 namespace dune {
   class RMSHitFinderAlg {
@@ -18,16 +20,28 @@ public:
 
     void reconfigure(fhicl::ParameterSet const& p);
 
-    void FindHits(dune::ChannelInformation & chan);
+    void FindHits(dune::ChannelInformation & chan) const;
+    // Channels are independent, so they are processed in parallel
+    void FindHits(dune::ChanMap_t & chanMap) const;
+    void FindHits(dune::ChannelTable & chanTable) const;
 
+    // Negative values (the default) search the full waveform
     void SetSearchTicks(int s, int e) { fSearchTickStart = s; fSearchTickEnd = e; }
 
-    void FilterWaveform(std::vector<float> wf, std::vector<float> & fwf);
-    void RobustRMSBase(std::vector<float> wf, float & bl, float & r);
+    void FilterWaveform(const std::vector<float> & wf, std::vector<float> & fwf) const;
+    void RobustRMSBase(const std::vector<float> & wf, float & bl, float & r) const;
 
 private:
-    void FindPulses(std::vector<float> wf, float bl, float r, std::vector<std::pair<int,int> > & pulse_ends);
-    void MergeHits(std::vector<std::pair<int,int> > & pulse_ends);
+    // Append the pulses found in wf, with ticks shifted by tickOffset
+    void FindPulses(const float * wf, int wfSize, int tickOffset, float bl, float r, std::vector<double> & sums,
+                    std::vector<std::pair<int,int> > & pulse_ends) const;
+    // Coarse pass over the filtered waveform: the padded tick ranges around samples above the
+    // pre-scan threshold, merged where they overlap
+    void ScanRegions(const dune::ChannelInformation & chan, int searchTickStart, int searchTickEnd,
+                     std::vector<std::pair<int,int> > & regions) const;
+    void MergeHits(std::vector<std::pair<int,int> > & pulse_ends) const;
+    static float Median(std::vector<float> & vals);
+    static void PrefixSums(const float * wf, size_t n, std::vector<double> & sums);
 
     int fWindowWidth;
     float fFilterWidth;
@@ -35,6 +49,9 @@ private:
     float fSigmaFallThreshold;
     int fSearchTickStart;
     int fSearchTickEnd;
+    float fPreScanThreshold; // in units of the filtered RMS, 0 searches the whole range
+    int fPreScanPad;
+    dune::numa::PlacementConfig fPlacement; // NUMA node of the parallel channel loops
   };
 
 }
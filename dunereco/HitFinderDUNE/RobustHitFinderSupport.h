@@ -77,6 +77,76 @@ public:
     float goodHitStartTick;
     float goodHitEndTick;
     std::vector<std::pair<int,int> > pulse_ends;
+    // Work buffers of the hit finder, kept with the channel so they are reused between events
+    std::vector<double> prefixSums;
+    std::vector<std::pair<int,int> > scanRegions;
+
+    // Reset for a new event, keeping the capacity of all the vectors
+    void Clear()
+    {
+      signalSize = 0;
+      signalVec.clear();
+      signalFilterVec.clear();
+      artWire = art::Ptr<recob::Wire>();
+      artRawDigit = art::Ptr<raw::RawDigit>();
+      baseline = rms = baselineFilter = rmsFilter = 0;
+      channelID = wireID = tpcNum = -1;
+      chanz = 0;
+      nGoodHits = 0;
+      goodHitStartTick = goodHitEndTick = 0;
+      pulse_ends.clear();
+      prefixSums.clear();
+      scanRegions.clear();
+    }
+  };
+
+  // The channels of an event in a flat table. Entries are looked up by channel ID through a
+  // dense index, and Reset keeps them and their buffers for the next event. Callers that keep
+  // one table across events use it instead of a ChanMap_t
+  class ChannelTable {
+public:
+    typedef std::vector<ChannelInformation>::iterator iterator;
+    typedef std::vector<ChannelInformation>::const_iterator const_iterator;
+
+    void Reset()
+    {
+      for (size_t i = 0; i < fUsed; ++i) fIndex[fChans[i].channelID] = -1;
+      fUsed = 0;
+    }
+
+    // The entry of a channel, added (cleared) if the channel is not in the table yet
+    ChannelInformation & Add(int channelID)
+    {
+      if (channelID >= static_cast<int>(fIndex.size())) fIndex.resize(channelID+1,-1);
+      if (fIndex[channelID] >= 0) return fChans[fIndex[channelID]];
+      if (fUsed == fChans.size()) fChans.emplace_back();
+      ChannelInformation & chan = fChans[fUsed];
+      chan.Clear();
+      chan.channelID = channelID;
+      fIndex[channelID] = fUsed++;
+      return chan;
+    }
+
+    ChannelInformation * Find(int channelID)
+    {
+      if (channelID < 0 || channelID >= static_cast<int>(fIndex.size()) || fIndex[channelID] < 0) return nullptr;
+      return &fChans[fIndex[channelID]];
+    }
+
+    size_t size() const { return fUsed; }
+    bool empty() const { return fUsed == 0; }
+    ChannelInformation & operator[](size_t i) { return fChans[i]; }
+    const ChannelInformation & operator[](size_t i) const { return fChans[i]; }
+
+    iterator begin() { return fChans.begin(); }
+    iterator end() { return fChans.begin()+fUsed; }
+    const_iterator begin() const { return fChans.begin(); }
+    const_iterator end() const { return fChans.begin()+fUsed; }
+
+private:
+    std::vector<ChannelInformation> fChans;
+    std::vector<int> fIndex;
+    size_t fUsed = 0;
   };
 
   typedef std::map<int,ChannelInformation> ChanMap_t;
@@ -17,6 +17,10 @@
 // Can optionally produce an output tree containing the information
 // to visualise the separation of hits. 
 //
+// With HitPtrOutput the two selections are written as vectors of
+// art::Ptr to the input hits instead of hit copies with their wire
+// and raw digit associations.
+//
 ////////////////////////////////////////////////////////////////////////
 
 #include <string>
@@ -25,12 +29,15 @@
 #include <memory>  
 #include <iostream>
 #include <map>
+#include <algorithm>
+#include <cstdint>
 
 // Framework includes
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Core/EDProducer.h"
 #include "art_root_io/TFileService.h"
+#include "canvas/Persistency/Common/Ptr.h"
 
 // LArSoft Includes
 #include "lardataobj/RawData/RawDigit.h"
@@ -54,11 +61,14 @@ namespace shs {
     private:
       template<size_t N> void ReadMVA(std::vector<float> &weights, art::Event& evt);
       void SaveTree(std::vector<recob::Hit> const& shwHits, std::vector<recob::Hit> const& trkHits);
+      void SaveTree(std::vector<art::Ptr<recob::Hit> > const& shwHits, std::vector<art::Ptr<recob::Hit> > const& trkHits);
+      void FillTree(recob::Hit const& hit, bool isShower);
 
       std::string fMVALabel;
       std::string fHitLabel;
       double fMVAOutputCut;
       bool fSaveTree;	
+      bool fHitPtrOutput;
 
       std::string fMVAClusterLabel; // Get this from the MVA itself.
 
@@ -84,10 +94,16 @@ namespace shs {
 
     this->reconfigure(pset);
 
-    // Let HitCollectionCreator declare that we are going to produce
-    // hits and associations with wires and raw digits
-    recob::HitCollectionCreator::declare_products(producesCollector(),"showerhits",true,true);
-    recob::HitCollectionCreator::declare_products(producesCollector(),"trackhits",true,true);
+    if(fHitPtrOutput){
+      produces<std::vector<art::Ptr<recob::Hit> > >("showerhits");
+      produces<std::vector<art::Ptr<recob::Hit> > >("trackhits");
+    }
+    else{
+      // Let HitCollectionCreator declare that we are going to produce
+      // hits and associations with wires and raw digits
+      recob::HitCollectionCreator::declare_products(producesCollector(),"showerhits",true,true);
+      recob::HitCollectionCreator::declare_products(producesCollector(),"trackhits",true,true);
+    }
 
     // Define some histograms if we want the plots
     if(fSaveTree){
@@ -116,6 +132,7 @@ namespace shs {
     fHitLabel = p.get<std::string>("HitLabel");
     fMVAOutputCut = p.get<double>("MVAOutputCut");
     fSaveTree = p.get<bool>("SaveTree");
+    fHitPtrOutput = p.get<bool>("HitPtrOutput",false);
 
   }
 
@@ -143,6 +160,7 @@ namespace shs {
 
     // Actually extract the weights
     const auto & cnnOuts = cluResults->outputs();
+    weights.reserve(cnnOuts.size());
     for (size_t i = 0; i < cnnOuts.size(); ++i){
 
       double trkOrEm = cnnOuts[i][trkLikeIdx] + cnnOuts[i][emLikeIdx];
@@ -158,10 +176,6 @@ namespace shs {
 
   void ShowerHitSeparator::produce(art::Event& evt) {
 
-    // We want to produce two hit collections
-    recob::HitCollectionCreator showerHits(evt,"showerhits",true,true);
-    recob::HitCollectionCreator trackHits(evt,"trackhits",true,true);
-
     // These are the MVA weights
     std::vector<float> mvaWeights;
 
@@ -172,6 +186,51 @@ namespace shs {
       ReadMVA<3>(mvaWeights,evt);
     }
 
+    // Apply the cut to all of the clusters in one pass over the weights
+    std::vector<uint8_t> isShowerCluster(mvaWeights.size());
+    std::transform(mvaWeights.begin(),mvaWeights.end(),isShowerCluster.begin(),
+                   [this](float weight){ return weight < fMVAOutputCut; });
+
+    if(fHitPtrOutput){
+      auto showerHits = std::make_unique<std::vector<art::Ptr<recob::Hit> > >();
+      auto trackHits = std::make_unique<std::vector<art::Ptr<recob::Hit> > >();
+
+      if(mvaWeights.size() != 0){
+        const art::FindManyP<recob::Hit> hitsFromClusters(fMVAClusters, evt,fMVAClusterLabel);
+
+        size_t nHits[2] = {0,0};
+        for (size_t c = 0; c != fMVAClusters->size(); ++c) nHits[isShowerCluster[c]] += hitsFromClusters.at(c).size();
+        trackHits->reserve(nHits[0]);
+        showerHits->reserve(nHits[1]);
+
+        // The pointers refer to the input hits, so nothing is copied or reassociated
+        for (size_t c = 0; c != fMVAClusters->size(); ++c){
+          auto const& hits = hitsFromClusters.at(c);
+          auto& selection = isShowerCluster[c] ? *showerHits : *trackHits;
+          selection.insert(selection.end(), hits.begin(), hits.end());
+        }
+      }
+
+      std::cout << "CNN output splitter: " << std::endl;
+      std::cout << " - Found " << showerHits->size() << " shower-like hits" << std::endl;
+      std::cout << " - Found " << trackHits->size() << " track-like hits" << std::endl;
+
+      if(fSaveTree){
+        fOutEvent = evt.event();
+        fOutRun = evt.run();
+        fOutSubrun = evt.subRun();
+        SaveTree(*showerHits,*trackHits);
+      }
+
+      evt.put(std::move(showerHits),"showerhits");
+      evt.put(std::move(trackHits),"trackhits");
+      return;
+    }
+
+    // We want to produce two hit collections
+    recob::HitCollectionCreator showerHits(evt,"showerhits",true,true);
+    recob::HitCollectionCreator trackHits(evt,"trackhits",true,true);
+
     // If we get some weights then separate the hits into two collections
     if(mvaWeights.size() != 0){
 
@@ -182,26 +241,26 @@ namespace shs {
       art::FindOneP<raw::RawDigit> rawDigits(inputHits,evt,fHitLabel);
       art::FindOneP<recob::Wire> recoWires(inputHits,evt,fHitLabel);
 
+      size_t nHits[2] = {0,0};
+      for (size_t c = 0; c != fMVAClusters->size(); ++c) nHits[isShowerCluster[c]] += hitsFromClusters.at(c).size();
+      trackHits.reserve(nHits[0]);
+      showerHits.reserve(nHits[1]);
+
       // At this stage we have the hits from the clusters and the tag for each cluster.
       // Loop over the clusters and add the hits to the shower-like hit collection.
       for (size_t c = 0; c != fMVAClusters->size(); ++c){
 
         // Get the hits from this cluster
         auto const& hits = hitsFromClusters.at(c);
+        recob::HitCollectionCreator& selection = isShowerCluster[c] ? showerHits : trackHits;
 
         // Now we must copy each hit and reassociate it to the raw digits and wires
         for (auto const & h : hits){
           // The art pointer key gives us the position of "h" in the hit collection
-          recob::Hit thisHit = (*h);
           auto digit = rawDigits.at(h.key());
           auto wire = recoWires.at(h.key());
-          // Add the hit and its associated raw digit and wire to the collection.
-          if(mvaWeights[c] < fMVAOutputCut){
-            showerHits.emplace_back(thisHit,wire,digit);
-          }
-          else{
-            trackHits.emplace_back(thisHit,wire,digit);
-          }
+          // Add a copy of the hit and its associated raw digit and wire to the collection.
+          selection.emplace_back(*h,wire,digit);
         } // End loop over hits
       } // End for loop over clusters
     }
@@ -228,29 +287,29 @@ namespace shs {
 
     // Event, Run and Subrun set outside of this function. Take care of everything else here.
 
-    for(auto const &shwHit : shwHits){
-      fOutTPC = shwHit.WireID().TPC;
-      fOutCryo = shwHit.WireID().Cryostat;
-      fOutPlane = shwHit.WireID().planeID().Plane;
-      fOutTime = shwHit.StartTick();
-      fOutWire = shwHit.WireID().Wire;
-      fOutIsShw = true;
-      fOutIsTrk = false;
+    for(auto const &shwHit : shwHits) FillTree(shwHit,true);
+    for(auto const &trkHit : trkHits) FillTree(trkHit,false);
 
-      fOutTree->Fill();
-    }
+  }
 
-    for(auto const &trkHit : trkHits){
-      fOutTPC = trkHit.WireID().TPC;
-      fOutCryo = trkHit.WireID().Cryostat;
-      fOutPlane = trkHit.WireID().planeID().Plane;
-      fOutTime = trkHit.StartTick();
-      fOutWire = trkHit.WireID().Wire;
-      fOutIsShw = false;
-      fOutIsTrk = true;
+  void ShowerHitSeparator::SaveTree(std::vector<art::Ptr<recob::Hit> > const& shwHits, std::vector<art::Ptr<recob::Hit> > const& trkHits){
 
-      fOutTree->Fill();
-    }
+    for(auto const &shwHit : shwHits) FillTree(*shwHit,true);
+    for(auto const &trkHit : trkHits) FillTree(*trkHit,false);
+
+  }
+
+  void ShowerHitSeparator::FillTree(recob::Hit const& hit, bool isShower){
+
+    fOutTPC = hit.WireID().TPC;
+    fOutCryo = hit.WireID().Cryostat;
+    fOutPlane = hit.WireID().planeID().Plane;
+    fOutTime = hit.StartTick();
+    fOutWire = hit.WireID().Wire;
+    fOutIsShw = isShower;
+    fOutIsTrk = !isShower;
+
+    fOutTree->Fill();
 
   }
 
@@ -28,8 +28,10 @@
 #include "larcorealg/Geometry/PlaneGeo.h"
 #include "larcorealg/Geometry/WireGeo.h"
 #include "TimeBasedDisambig.h"
+#include "DisambigTimeIndex.h"
 //#include "MCCheater/BackTracker.h"
 #include "larevt/Filters/ChannelFilter.h"
+#include "dunereco/Profiling/ProfScope.h"
 
 #include <map>
 #include <cmath>
@@ -65,6 +67,9 @@ void TimeBasedDisambig::reconfigure(fhicl::ParameterSet const& p)
 void TimeBasedDisambig::RunDisambig( const std::vector< art::Ptr<recob::Hit> > &OrigHits )
 //void TimeBasedDisambig::RunDisambig()
 {
+  DUNE_PROF_SCOPE("dune::TimeBasedDisambig::RunDisambig");
+  DUNE_PROF_COUNT("dune::TimeBasedDisambig::RunDisambig hits", OrigHits.size());
+
   //fDisambigHits.clear();
 
   //create geometry and backtracker servicehandle object
@@ -88,24 +93,55 @@ void TimeBasedDisambig::RunDisambig( const std::vector< art::Ptr<recob::Hit> > &
   //double HitsTotal=0;
   //double HitsCorrect=0;
 
+  //sort the hits by component once, keeping their order
+  std::map<std::pair<unsigned int, unsigned int>, std::vector<size_t> > HitsPerAPA;
+  for (size_t i = 0; i<OrigHits.size(); ++i){
+    HitsPerAPA[std::make_pair(OrigHits[i]->WireID().Cryostat, OrigHits[i]->WireID().TPC/2)].push_back(i);
+  }
+  //margin on the time windows below, the exact cuts are applied to the candidates
+  const double TimeMargin=1.e-3;
+  std::vector<unsigned int> Candidates;
+
   //loop over detector volumn in each component
   for (unsigned int Cstat=0; Cstat < geo->Ncryostats(); ++Cstat){
     for (unsigned int APA=0; APA < geo->Cryostat(geo::CryostatID{Cstat}).NTPC()/2; ++APA){
       hitsUV.clear();
       hitsZ.clear();
-      //loop over all induction and collection plane hits and save the hits within each component
-      for (size_t i = 0; i<OrigHits.size(); ++i){
-	if (OrigHits[i]->WireID().Cryostat==Cstat && (OrigHits[i]->WireID().TPC==APA*2 || OrigHits[i]->WireID().TPC==APA*2+1)){	  
-	  
+      //save the induction and collection plane hits within each component
+      auto ComponentHits=HitsPerAPA.find(std::make_pair(Cstat, APA));
+      if (ComponentHits!=HitsPerAPA.end()){
+	for (size_t i : ComponentHits->second){
 	  //save induction and collection plane hits in two separate vectors
 	  if (OrigHits[i]->View()!=geo::kZ){
 	    hitsUV.push_back(OrigHits[i]);
 	  } else {
 	    hitsZ.push_back(OrigHits[i]);
 	  }
+	}
+      }
 
+      //induction plane hits sorted by their offset corrected peaktime
+      DisambigTimeIndex TimeIndexUV;
+      for (unsigned int uv1=0; uv1 < hitsUV.size(); ++uv1){
+	double PeakTimeUV1=hitsUV[uv1]->PeakTime()+timeoffset[1];
+	if (hitsUV[uv1]->View()==geo::kU){
+	  PeakTimeUV1+=timeoffset[1];
 	}
+	TimeIndexUV.Add(PeakTimeUV1, uv1);
+      }
+      TimeIndexUV.Sort();
+
+      //collection plane hits sorted by peaktime, with the tpc and position of their wire
+      DisambigTimeIndex TimeIndexZ;
+      std::vector<unsigned int> TPCZ(hitsZ.size(),0);
+      std::vector<double> VertZ(hitsZ.size(),0.0);
+      for (unsigned int z=0; z < hitsZ.size(); ++z){
+	std::vector<geo::WireID> wires = geo->ChannelToWire(hitsZ[z]->Channel());
+	TPCZ[z]=wires[0].TPC;
+	VertZ[z]=geo->Wire(wires[0]).GetCenter().Z();
+	TimeIndexZ.Add(hitsZ[z]->PeakTime(), z);
       }
+      TimeIndexZ.Sort();
 
       //double xbound[2]={-2000,2000};
       //define xbound using peaktime for now but need to be replaced with coverted position in the future
@@ -144,7 +180,9 @@ void TimeBasedDisambig::RunDisambig( const std::vector< art::Ptr<recob::Hit> > &
 	//that is in loop.
 	double MeanPeakTimeUV=99999;
 	unsigned int ChannelUV1=0;
-	for (unsigned int uv1=0; uv1 < hitsUV.size(); ++uv1){
+	//only hits within the peaktime cut below can match
+	TimeIndexUV.Window(PeakTimeUV-20-TimeMargin, PeakTimeUV+20+TimeMargin, Candidates);
+	for (unsigned int uv1 : Candidates){
 	  double PeakTimeMinusUV1=hitsUV[uv1]->PeakTimePlusRMS(-1.)+timeoffset[1];
 	  double PeakTimeUV1=hitsUV[uv1]->PeakTime()+timeoffset[1];
 	  if (hitsUV[uv1]->View()==geo::kU){
@@ -185,47 +223,23 @@ void TimeBasedDisambig::RunDisambig( const std::vector< art::Ptr<recob::Hit> > &
 	  //loop over collection plane hits and among the collection plane hits whose charge per num to that 
 	  //of the hit in loop is within 2.5 find a collection plane hit that has closest time to the induction plane
 	  //hit in the loop.
-	  for (unsigned int z=0; z < hitsZ.size(); ++z){
+	  TimeIndexZ.Window(PeakTimeUV-20-TimeMargin, PeakTimeUV+20+TimeMargin, Candidates);
+	  for (unsigned int z : Candidates){
 	    double PeakTimeMinusZ=hitsZ[z]->PeakTimePlusRMS(-1.);
 	    double PeakTimeZ=hitsZ[z]->PeakTime();
 	    double ChargePerNumZ=hitsZ[z]->Integral()/hitsZ[z]->Multiplicity();
 	    double rChargeZ=hitsUV[uv0]->Integral()/hitsZ[z]->Integral();
 	    if (hitsUV[uv0]->Multiplicity()>0 && hitsZ[z]->Integral()>0) rChargeZ=ChargePerNum0/ChargePerNumZ;
-	    std::vector<geo::WireID> wires = geo->ChannelToWire(hitsZ[z]->Channel());
-            auto const vert = geo->Wire(wires[0]).GetCenter();
 	    if (fabs(PeakTimeMinusUV-PeakTimeMinusZ)<MinPeakTime && fabs(PeakTimeUV-PeakTimeZ)<20 &&
 		(rChargeZ<rmax && rChargeZ>(1/rmax)) &&
-	  	wireiduv0[wireid0].TPC==wires[0].TPC){
+	  	wireiduv0[wireid0].TPC==TPCZ[z]){
 	      MinPeakTime=fabs(PeakTimeMinusUV-PeakTimeMinusZ);
-              VertPos=vert.Z();
+              VertPos=VertZ[z];
 	    } 
 	  }
 
-	  //loop over collection plane hits and among the collection plane hits whose charge per num to that
-	  //of the hit in the loop is within 2.5 find collection plane hits whose time difference to the induction
-	  //plane hit is within 10 and take the average position of the collection plane hits.
-	  double VertPosMean=0; //average position of all collection plane hits whose peaktime are in the window
-	  double RMS=0; //rms of the collection plane hit positions 
-	  unsigned int CollectionHits=0; //total no of collection plane hits in the time window
-	  for (unsigned int z=0; z < hitsZ.size(); ++z){
-	    double PeakTimeMinusZ=hitsZ[z]->PeakTimePlusRMS(-1.);
-	    //double PeakTimeZ=hitsZ[z]->PeakTime();
-	    double ChargePerNumZ=hitsZ[z]->Integral()/hitsZ[z]->Multiplicity();
-	    double rChargeZ=hitsUV[uv0]->Integral()/hitsZ[z]->Integral();
-	    if (hitsUV[uv0]->Multiplicity()>0 && hitsZ[z]->Integral()>0) rChargeZ=ChargePerNum0/ChargePerNumZ;
-	    std::vector<geo::WireID> wires = geo->ChannelToWire(hitsZ[z]->Channel());
-            auto const vert = geo->Wire(wires[0]).GetCenter();
-	    if (fabs(fabs(PeakTimeMinusUV-PeakTimeMinusZ)-MinPeakTime)<10 &&
-		//fabs(PeakTimeUV-PeakTimeZ)<20 &&
-		(rChargeZ<rmax && rChargeZ>(1/rmax)) &&
-		wireiduv0[wireid0].TPC==wires[0].TPC ){
-	      CollectionHits++;
-              VertPosMean+=vert.Z();
-              RMS+=(VertPos-vert.Z())*(VertPos-vert.Z());
-	    } 
-	  }
-	  VertPosMean=VertPosMean/double(CollectionHits); //average position
-	  RMS=RMS/double(CollectionHits); //rms of the collection plane hits
+	  //the average and rms of the collection plane hit positions in a window around MinPeakTime were
+	  //computed here but never used, only VertPos enters the wire choice below
 	  
 	  
 	  //loop over the wireid of the induction plane hit whose time is closest to the hit in the first loop
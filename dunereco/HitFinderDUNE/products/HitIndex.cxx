@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    HitIndex.cxx
+/// \brief   Keys of the hits of a recob::Hit collection by TPC plane and
+///          by channel, each ordered by peak time, made once after hit
+///          finding
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <numeric>
+
+#include "dunereco/HitFinderDUNE/products/HitIndex.h"
+
+namespace dune
+{
+
+  HitIndex::HitIndex():
+  fNHits(0), fNCryostats(0), fNTPCs(0), fNPlanes(0), fFirstChannel(0)
+  {
+  }
+
+  HitIndex::HitIndex(const std::vector<recob::Hit>& hits):
+  HitIndex()
+  {
+    fNHits = hits.size();
+    if(hits.empty()) return;
+
+    raw::ChannelID_t lastChannel = hits.front().Channel();
+    fFirstChannel = lastChannel;
+    for(const recob::Hit& hit : hits){
+      const geo::WireID& wire = hit.WireID();
+      fNCryostats = std::max(fNCryostats, wire.Cryostat + 1);
+      fNTPCs = std::max(fNTPCs, wire.TPC + 1);
+      fNPlanes = std::max(fNPlanes, wire.Plane + 1);
+      fFirstChannel = std::min(fFirstChannel, hit.Channel());
+      lastChannel = std::max(lastChannel, hit.Channel());
+    }
+
+    // Filling the groups in time order leaves each of them ordered by time
+    std::vector<unsigned int> byTime(hits.size());
+    std::iota(byTime.begin(), byTime.end(), 0);
+    std::stable_sort(byTime.begin(), byTime.end(), [&hits](unsigned int a, unsigned int b)
+      { return hits[a].PeakTime() < hits[b].PeakTime(); });
+
+    auto planeIndex = [this](const geo::WireID& wire)
+      { return (wire.Cryostat*fNTPCs + wire.TPC)*fNPlanes + wire.Plane; };
+
+    fPlaneFirst.assign(fNCryostats*fNTPCs*fNPlanes + 1, 0);
+    fChannelFirst.assign(lastChannel - fFirstChannel + 2, 0);
+    for(const recob::Hit& hit : hits){
+      ++fPlaneFirst[planeIndex(hit.WireID()) + 1];
+      ++fChannelFirst[hit.Channel() - fFirstChannel + 1];
+    }
+    std::partial_sum(fPlaneFirst.begin(), fPlaneFirst.end(), fPlaneFirst.begin());
+    std::partial_sum(fChannelFirst.begin(), fChannelFirst.end(), fChannelFirst.begin());
+
+    std::vector<unsigned int> planeNext(fPlaneFirst.begin(), fPlaneFirst.end() - 1);
+    std::vector<unsigned int> channelNext(fChannelFirst.begin(), fChannelFirst.end() - 1);
+    fPlaneHits.resize(hits.size());
+    fChannelHits.resize(hits.size());
+    for(unsigned int key : byTime){
+      fPlaneHits[planeNext[planeIndex(hits[key].WireID())]++] = key;
+      fChannelHits[channelNext[hits[key].Channel() - fFirstChannel]++] = key;
+    }
+  }
+
+  HitKeyRange HitIndex::HitsOnPlane(const geo::PlaneID& planeID) const
+  {
+    if(planeID.Cryostat >= fNCryostats || planeID.TPC >= fNTPCs || planeID.Plane >= fNPlanes)
+      return HitKeyRange();
+
+    const unsigned int index = (planeID.Cryostat*fNTPCs + planeID.TPC)*fNPlanes + planeID.Plane;
+    return HitKeyRange(fPlaneHits.data() + fPlaneFirst[index], fPlaneHits.data() + fPlaneFirst[index + 1]);
+  }
+
+  HitKeyRange HitIndex::HitsOnChannel(raw::ChannelID_t channel) const
+  {
+    if(channel < fFirstChannel || channel - fFirstChannel + 1 >= fChannelFirst.size())
+      return HitKeyRange();
+
+    const unsigned int index = channel - fFirstChannel;
+    return HitKeyRange(fChannelHits.data() + fChannelFirst[index], fChannelHits.data() + fChannelFirst[index + 1]);
+  }
+
+  HitKeyRange HitIndex::InTime(const HitKeyRange& range, const std::vector<recob::Hit>& hits,
+                               float minTime, float maxTime)
+  {
+    const unsigned int* begin = std::partition_point(range.begin(), range.end(),
+      [&hits, minTime](unsigned int key) { return hits[key].PeakTime() < minTime; });
+    const unsigned int* end = std::partition_point(begin, range.end(),
+      [&hits, maxTime](unsigned int key) { return hits[key].PeakTime() < maxTime; });
+    return HitKeyRange(begin, end);
+  }
+
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    HitIndex.h
+/// \brief   Keys of the hits of a recob::Hit collection by TPC plane and
+///          by channel, each ordered by peak time, made once after hit
+///          finding
+////////////////////////////////////////////////////////////////////////
+
+#ifndef DUNE_HITINDEX_H
+#define DUNE_HITINDEX_H
+
+#include <vector>
+
+#include "lardataobj/RecoBase/Hit.h"
+
+namespace dune
+{
+
+  /// Keys of a run of hits in the index, ordered by peak time
+  class HitKeyRange
+  {
+  public:
+    HitKeyRange(): fBegin(nullptr), fEnd(nullptr) {};
+    HitKeyRange(const unsigned int* begin, const unsigned int* end): fBegin(begin), fEnd(end) {};
+
+    const unsigned int* begin() const {return fBegin;};
+    const unsigned int* end() const {return fEnd;};
+    unsigned int size() const {return fEnd - fBegin;};
+    bool empty() const {return fBegin == fEnd;};
+    unsigned int operator[](unsigned int i) const {return fBegin[i];};
+
+  private:
+    const unsigned int* fBegin;
+    const unsigned int* fEnd;
+  };
+
+  /// Hits of a collection grouped by (cryostat, TPC, plane) and by channel,
+  /// as offsets into key arrays, so that the hits of one plane or channel are
+  /// found without going over the collection. The hits of each group are
+  /// ordered by peak time, ties kept in collection order
+  class HitIndex
+  {
+  public:
+    HitIndex();
+    explicit HitIndex(const std::vector<recob::Hit>& hits);
+
+    unsigned int NHits() const {return fNHits;};
+
+    /// Keys of the hits on one plane, empty for planes without hits
+    HitKeyRange HitsOnPlane(const geo::PlaneID& planeID) const;
+    /// Keys of the hits on one channel, empty for channels without hits
+    HitKeyRange HitsOnChannel(raw::ChannelID_t channel) const;
+
+    /// The part of a range with peak times in [minTime, maxTime)
+    static HitKeyRange InTime(const HitKeyRange& range, const std::vector<recob::Hit>& hits,
+                              float minTime, float maxTime);
+
+    /// Planes are indexed up to these, from the hits of the collection
+    unsigned int NCryostats() const {return fNCryostats;};
+    unsigned int NTPCs() const {return fNTPCs;};
+    unsigned int NPlanes() const {return fNPlanes;};
+
+  private:
+    unsigned int fNHits;
+    unsigned int fNCryostats;
+    unsigned int fNTPCs;
+    unsigned int fNPlanes;
+    std::vector<unsigned int> fPlaneFirst;   ///< First entry of each (cryostat*fNTPCs + tpc)*fNPlanes + plane
+    std::vector<unsigned int> fPlaneHits;    ///< Hit keys by plane
+    raw::ChannelID_t fFirstChannel;          ///< Lowest channel with hits
+    std::vector<unsigned int> fChannelFirst; ///< First entry of each channel from fFirstChannel
+    std::vector<unsigned int> fChannelHits;  ///< Hit keys by channel
+  };
+
+}
+
+#endif  // DUNE_HITINDEX_H
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    HitSummary.cxx
+/// \brief   Hit counts, charge sums and time extents of a recob::Hit
+///          collection, made once after hit finding
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "dunereco/HitFinderDUNE/products/HitSummary.h"
+
+namespace dune
+{
+
+  HitSummary::HitSummary():
+  fNHits(0), fCharge(0.), fMinTime(0.), fMaxTime(0.), fMaxHitsPerTPC(0)
+  {
+  }
+
+  HitSummary::HitSummary(const std::vector<recob::Hit>& hits):
+  HitSummary()
+  {
+    std::map<std::tuple<unsigned int, unsigned int, unsigned int>, HitPlaneSummary> planes;
+    std::map<unsigned int, unsigned int> hitsPerTPC;
+
+    for(const recob::Hit& hit : hits){
+      const geo::WireID& wire = hit.WireID();
+      const float time = hit.PeakTime();
+
+      HitPlaneSummary& plane = planes[std::make_tuple(wire.Cryostat, wire.TPC, wire.Plane)];
+      if(plane.nHits == 0){
+        plane.cryostat = wire.Cryostat;
+        plane.tpc = wire.TPC;
+        plane.plane = wire.Plane;
+        plane.minTime = time;
+        plane.maxTime = time;
+      }
+      ++plane.nHits;
+      plane.charge += hit.Integral();
+      plane.minTime = std::min(plane.minTime, time);
+      plane.maxTime = std::max(plane.maxTime, time);
+
+      ++hitsPerTPC[wire.TPC];
+    }
+
+    fPlanes.reserve(planes.size());
+    for(const auto& plane : planes){
+      const HitPlaneSummary& summary = plane.second;
+      fMinTime = fPlanes.empty() ? summary.minTime : std::min(fMinTime, summary.minTime);
+      fMaxTime = fPlanes.empty() ? summary.maxTime : std::max(fMaxTime, summary.maxTime);
+      fNHits += summary.nHits;
+      fCharge += summary.charge;
+      fPlanes.push_back(summary);
+    }
+
+    for(const auto& tpc : hitsPerTPC) fMaxHitsPerTPC = std::max(fMaxHitsPerTPC, tpc.second);
+  }
+
+  unsigned int HitSummary::NHitsOnPlane(unsigned int plane) const
+  {
+    unsigned int nHits = 0;
+    for(const HitPlaneSummary& summary : fPlanes)
+      if(summary.plane == plane) nHits += summary.nHits;
+    return nHits;
+  }
+
+  float HitSummary::ChargeOnPlane(unsigned int plane) const
+  {
+    float charge = 0.;
+    for(const HitPlaneSummary& summary : fPlanes)
+      if(summary.plane == plane) charge += summary.charge;
+    return charge;
+  }
+
+}
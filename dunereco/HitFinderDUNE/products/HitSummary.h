@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    HitSummary.h
+/// \brief   Hit counts, charge sums and time extents of a recob::Hit
+///          collection, made once after hit finding
+////////////////////////////////////////////////////////////////////////
+
+#ifndef DUNE_HITSUMMARY_H
+#define DUNE_HITSUMMARY_H
+
+#include <vector>
+
+#include "lardataobj/RecoBase/Hit.h"
+
+namespace dune
+{
+
+  /// Summary of the hits on one plane of one TPC
+  struct HitPlaneSummary
+  {
+    unsigned int cryostat = 0;
+    unsigned int tpc = 0;
+    unsigned int plane = 0;
+    unsigned int nHits = 0;
+    float charge = 0.;       ///< Summed hit integral
+    float minTime = 0.;      ///< Earliest hit peak time, in ticks
+    float maxTime = 0.;      ///< Latest hit peak time, in ticks
+  };
+
+  /// Counts, charge and time range of a hit collection, per plane and in
+  /// total, so that filters and later stages read them without going over
+  /// the hits again
+  class HitSummary
+  {
+  public:
+    HitSummary();
+    explicit HitSummary(const std::vector<recob::Hit>& hits);
+
+    unsigned int NHits() const {return fNHits;};
+    float Charge() const {return fCharge;};
+    /// Peak time range of all hits, 0 without hits
+    float MinTime() const {return fMinTime;};
+    float MaxTime() const {return fMaxTime;};
+
+    /// Most hits in a single TPC, TPCs of different cryostats with the same
+    /// number counted together as NumberOfHitsFilter does
+    unsigned int MaxHitsPerTPC() const {return fMaxHitsPerTPC;};
+
+    /// The planes with hits, ordered by cryostat, TPC and plane
+    const std::vector<HitPlaneSummary>& Planes() const {return fPlanes;};
+
+    /// Hits and charge of one plane number, summed over TPCs
+    unsigned int NHitsOnPlane(unsigned int plane) const;
+    float ChargeOnPlane(unsigned int plane) const;
+
+  private:
+    std::vector<HitPlaneSummary> fPlanes;
+    unsigned int fNHits;
+    float fCharge;
+    float fMinTime;
+    float fMaxTime;
+    unsigned int fMaxHitsPerTPC;
+  };
+
+}
+
+#endif  // DUNE_HITSUMMARY_H
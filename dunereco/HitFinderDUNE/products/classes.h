@@ -0,0 +1,3 @@
+#include "canvas/Persistency/Common/Wrapper.h"
+#include "dunereco/HitFinderDUNE/products/HitSummary.h"
+#include "dunereco/HitFinderDUNE/products/HitIndex.h"
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       QueueOptions, QueueBase, BatchQueue
+////
+//// Request queue of one network, run by a pool of worker threads. Callers
+//// submit their inputs and receive a future; a worker packs the pending
+//// requests of all callers into one batch of at most maxBatch samples,
+//// waiting up to maxWait for more requests when the batch is not full, and
+//// runs the batch function on it. The inputs must stay alive until the
+//// future is ready. With more than one worker the batch function is called
+//// from several threads at once and must allow it.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef INFER_BATCH_QUEUE_H
+#define INFER_BATCH_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+namespace infer
+{
+
+struct QueueOptions
+{
+    unsigned int workers = 1;                            ///< threads running the batch function
+    size_t maxBatch = 0;                                 ///< samples per batch, 0 = all pending samples
+    std::chrono::microseconds maxWait{0};                ///< wait for more requests when a batch is not full
+};
+
+class QueueBase
+{
+public:
+    virtual ~QueueBase() = default;
+
+    /// Finish the pending requests and join the workers
+    virtual void Stop() = 0;
+};
+
+template <typename Input, typename Output>
+class BatchQueue : public QueueBase
+{
+public:
+    using BatchFunction = std::function< std::vector<Output>(const std::vector<const Input*> &) >;
+
+    BatchQueue(const std::string & name, BatchFunction function, const QueueOptions & options);
+    ~BatchQueue() override;
+
+    BatchQueue(const BatchQueue&) = delete;
+    BatchQueue& operator=(const BatchQueue&) = delete;
+
+    /// Queue the inputs of one caller, the future holds one output per input
+    std::future< std::vector<Output> > Submit(std::vector<const Input*> inputs);
+
+    void Stop() override;
+
+    const std::string & Name() const { return fName; }
+    const QueueOptions & Options() const { return fOptions; }
+
+private:
+    struct Request
+    {
+        std::vector<const Input*> inputs;
+        std::promise< std::vector<Output> > result;
+    };
+
+    void Work();
+
+    /// Take the requests of the next batch, empty once stopped and drained
+    std::vector<Request> NextBatch();
+
+    std::string fName;
+    BatchFunction fFunction;
+    QueueOptions fOptions;
+
+    std::mutex fMutex;
+    std::condition_variable fCondition;
+    std::deque<Request> fPending;
+    size_t fNPendingSamples = 0;
+    bool fStopped = false;
+
+    unsigned long fNBatches = 0;
+    unsigned long fNSamples = 0;
+
+    std::vector<std::thread> fWorkers;
+};
+
+// -------------------------------------------------------------------
+template <typename Input, typename Output>
+BatchQueue<Input, Output>::BatchQueue(const std::string & name, BatchFunction function, const QueueOptions & options) :
+    fName(name),
+    fFunction(std::move(function)),
+    fOptions(options)
+{
+    if (fOptions.workers == 0) { fOptions.workers = 1; }
+    for (unsigned int w = 0; w < fOptions.workers; ++w)
+    {
+        fWorkers.emplace_back(&BatchQueue::Work, this);
+    }
+}
+
+template <typename Input, typename Output>
+BatchQueue<Input, Output>::~BatchQueue()
+{
+    Stop();
+}
+
+template <typename Input, typename Output>
+std::future< std::vector<Output> > BatchQueue<Input, Output>::Submit(std::vector<const Input*> inputs)
+{
+    Request request;
+    request.inputs = std::move(inputs);
+    std::future< std::vector<Output> > future = request.result.get_future();
+
+    if (request.inputs.empty())
+    {
+        request.result.set_value({});
+        return future;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fStopped)
+        {
+            throw std::logic_error("infer::BatchQueue " + fName + ": request submitted after the queue was stopped");
+        }
+        fNPendingSamples += request.inputs.size();
+        fPending.push_back(std::move(request));
+    }
+    fCondition.notify_one();
+    return future;
+}
+
+template <typename Input, typename Output>
+void BatchQueue<Input, Output>::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fStopped && fWorkers.empty()) { return; }
+        fStopped = true;
+    }
+    fCondition.notify_all();
+
+    for (auto & worker : fWorkers) { worker.join(); }
+    fWorkers.clear();
+
+    if (fNBatches > 0)
+    {
+        mf::LogInfo("BatchQueue") << fName << ": " << fNSamples << " samples in " << fNBatches
+                                  << " batches, " << double(fNSamples) / fNBatches << " samples/batch";
+    }
+}
+
+template <typename Input, typename Output>
+std::vector<typename BatchQueue<Input, Output>::Request> BatchQueue<Input, Output>::NextBatch()
+{
+    std::unique_lock<std::mutex> lock(fMutex);
+    fCondition.wait(lock, [this] { return fStopped || !fPending.empty(); });
+    if (fPending.empty()) { return {}; }
+
+    // Give the other callers a chance to fill the batch, unless stopping
+    const size_t maxBatch = fOptions.maxBatch;
+    if (fOptions.maxWait.count() > 0 && (maxBatch == 0 || fNPendingSamples < maxBatch))
+    {
+        fCondition.wait_for(lock, fOptions.maxWait, [this, maxBatch]
+        {
+            return fStopped || fPending.empty() || (maxBatch > 0 && fNPendingSamples >= maxBatch);
+        });
+        if (fPending.empty()) { return {}; }
+    }
+
+    // Whole requests only, a request larger than maxBatch is a batch of its own
+    std::vector<Request> batch;
+    size_t nSamples = 0;
+    while (!fPending.empty())
+    {
+        const size_t size = fPending.front().inputs.size();
+        if (!batch.empty() && maxBatch > 0 && nSamples + size > maxBatch) { break; }
+        nSamples += size;
+        batch.push_back(std::move(fPending.front()));
+        fPending.pop_front();
+    }
+    fNPendingSamples -= nSamples;
+    ++fNBatches;
+    fNSamples += nSamples;
+
+    // More work left for another worker
+    if (!fPending.empty()) { fCondition.notify_one(); }
+    return batch;
+}
+
+template <typename Input, typename Output>
+void BatchQueue<Input, Output>::Work()
+{
+    while (true)
+    {
+        std::vector<Request> batch = NextBatch();
+        if (batch.empty())
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (fStopped && fPending.empty()) { return; }
+            continue;
+        }
+
+        std::vector<const Input*> inputs;
+        for (auto const & request : batch)
+        {
+            inputs.insert(inputs.end(), request.inputs.begin(), request.inputs.end());
+        }
+
+        std::vector<Output> outputs;
+        try
+        {
+            outputs = fFunction(inputs);
+            if (outputs.size() != inputs.size())
+            {
+                throw std::runtime_error("infer::BatchQueue " + fName + ": " + std::to_string(outputs.size())
+                                         + " outputs for " + std::to_string(inputs.size()) + " inputs");
+            }
+        }
+        catch (...)
+        {
+            for (auto & request : batch) { request.result.set_exception(std::current_exception()); }
+            continue;
+        }
+
+        auto output = std::make_move_iterator(outputs.begin());
+        for (auto & request : batch)
+        {
+            std::vector<Output> result(output, output + request.inputs.size());
+            output += request.inputs.size();
+            request.result.set_value(std::move(result));
+        }
+    }
+}
+// -------------------------------------------------------------------
+
+} // namespace infer
+
+#endif
@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       InferenceService
+//// Plugin Type: service
+////
+//// Job-wide network request queues shared by the producers of all the
+//// schedules. See InferenceService.h.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/InferenceService/InferenceService.h"
+
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+namespace dune
+{
+
+InferenceService::InferenceService(const fhicl::ParameterSet &pset, art::ActivityRegistry &reg) :
+    fQueueConfig(pset.get<fhicl::ParameterSet>("Queues", fhicl::ParameterSet()))
+{
+    fDefaults.workers = pset.get<unsigned int>("Workers", 1);
+    fDefaults.maxBatch = pset.get<unsigned int>("MaxBatchSize", 0);
+    fDefaults.maxWait = std::chrono::microseconds(pset.get<unsigned int>("MaxWaitMicroseconds", 0));
+
+    reg.sPostEndJob.watch(this, &InferenceService::postEndJob);
+}
+
+infer::QueueOptions InferenceService::Options(const std::string &name) const
+{
+    infer::QueueOptions options(fDefaults);
+
+    fhicl::ParameterSet queue;
+    if (fQueueConfig.get_if_present(name, queue))
+    {
+        options.workers = queue.get<unsigned int>("Workers", options.workers);
+        options.maxBatch = queue.get<unsigned int>("MaxBatchSize", options.maxBatch);
+        options.maxWait = std::chrono::microseconds(
+            queue.get<unsigned int>("MaxWaitMicroseconds", options.maxWait.count()));
+    }
+    return options;
+}
+
+void InferenceService::postEndJob()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    for (auto &queue : fQueues)
+    {
+        queue.second->Stop();
+        mf::LogInfo("InferenceService") << "Stopped queue " << queue.first;
+    }
+}
+
+} // namespace dune
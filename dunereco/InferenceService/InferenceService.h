@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       InferenceService
+//// Plugin Type: service
+////
+//// Job-wide network request queues shared by the producers of all the
+//// schedules. A producer gets the queue of its network once, at
+//// construction, and submits the inputs of each event to it; the queue
+//// workers batch the requests of all the schedules into single network
+//// calls while the event loop threads wait on their futures, or prepare the
+//// next inputs. See inferenceservice.fcl for the configuration.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DUNE_INFERENCE_SERVICE_H
+#define DUNE_INFERENCE_SERVICE_H
+
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "canvas/Utilities/Exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "dunereco/InferenceService/BatchQueue.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace art
+{
+class ActivityRegistry;
+}
+
+namespace dune
+{
+
+class InferenceService
+{
+public:
+    InferenceService(const fhicl::ParameterSet &pset, art::ActivityRegistry &reg);
+
+    /// Queue of the network called name, made with the batch function on the
+    /// first request. Later requests for the same name share that queue and
+    /// its function, whatever function they pass
+    template <typename Input, typename Output>
+    std::shared_ptr< infer::BatchQueue<Input, Output> >
+    GetQueue(const std::string &name, typename infer::BatchQueue<Input, Output>::BatchFunction function);
+
+    /// Options of the queue called name: the service defaults, overridden by
+    /// its entry in the Queues table
+    infer::QueueOptions Options(const std::string &name) const;
+
+private:
+    void postEndJob();
+
+    infer::QueueOptions fDefaults;
+    fhicl::ParameterSet fQueueConfig;
+
+    std::mutex fMutex;
+    std::map< std::string, std::shared_ptr<infer::QueueBase> > fQueues;
+};
+
+template <typename Input, typename Output>
+std::shared_ptr< infer::BatchQueue<Input, Output> >
+InferenceService::GetQueue(const std::string &name, typename infer::BatchQueue<Input, Output>::BatchFunction function)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    std::shared_ptr<infer::QueueBase> &queue(fQueues[name]);
+    if (!queue)
+        queue = std::make_shared< infer::BatchQueue<Input, Output> >(name, std::move(function), this->Options(name));
+
+    auto typed(std::dynamic_pointer_cast< infer::BatchQueue<Input, Output> >(queue));
+    if (!typed)
+    {
+        throw art::Exception(art::errors::Configuration)
+            << "InferenceService: queue " << name << " already exists with other input or output types";
+    }
+    return typed;
+}
+
+} // namespace dune
+
+DECLARE_ART_SERVICE(dune::InferenceService, SHARED)
+
+#endif
@@ -0,0 +1,14 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       InferenceService
+//// Plugin Type: service
+////
+//// Job-wide network request queues shared by the producers of all the
+//// schedules. See InferenceService.h and inferenceservice.fcl.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+
+#include "dunereco/InferenceService/InferenceService.h"
+
+DEFINE_ART_SERVICE(dune::InferenceService)
@@ -6,7 +6,7 @@
 // Alex Wilkinson - 08/03/21
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -22,30 +22,42 @@
 #include "lardataobj/RawData/raw.h"
 #include "larevt/CalibrationDBI/Interface/ChannelStatusService.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "dunereco/InfillChannels/products/DecodedADCs.h"
 
 #include <TGeoVolume.h>
 
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 #include <algorithm>
 #include <iterator>
 #include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 #undef ClassDef // Because ROOT's ClassDef macro conflicts with libtorch's class of the same name.
 
 #include <torch/script.h>
 #include <torch/torch.h>
 
+#include "dunereco/TorchRuntime/TorchModuleRegistry.h"
+#include "dunereco/Profiling/ProfScope.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
 namespace Infill 
 {
   class InfillChannels;
 }
 
-class Infill::InfillChannels : public art::EDProducer 
+class Infill::InfillChannels : public art::SharedProducer 
 {
 public:
-  explicit InfillChannels(fhicl::ParameterSet const& p);
+  explicit InfillChannels(fhicl::ParameterSet const& p, art::ProcessingFrame const&);
 
   // Plugins should not be copied or assigned.
   InfillChannels(InfillChannels const&) = delete;
@@ -54,11 +66,11 @@ public:
   InfillChannels& operator=(InfillChannels&&) = delete;
 
   // Required functions.
-  void produce(art::Event& e) override;
+  void produce(art::Event& e, art::ProcessingFrame const&) override;
 
   // Selected optional functions.
-  void beginJob() override;
-  void endJob() override;
+  void beginJob(art::ProcessingFrame const&) override;
+  void endJob(art::ProcessingFrame const&) override;
 
 private:
   // Declare member data here.
@@ -69,28 +81,105 @@ private:
   std::set<raw::ChannelID_t> fDeadChannels;
 
   std::set<readout::ROPID> fActiveRops;
-  
+
+  // A batch of equal width channel windows infilled by one forward call. Without cropping
+  // an image holds up to RopBatchSize full ROP windows of one plane type and width, with cropping
+  // one image per plane type holds a window around every dead channel cluster.
+  // Laid out once in beginJob, the tensors of an event are held in EventTensors
+  struct InfillImage {
+    geo::SigType_t sigType;
+    unsigned int width;
+    std::vector<raw::ChannelID_t> windowFirstCh;
+    std::vector<std::vector<raw::ChannelID_t>> windowDeadChannels;
+    std::vector<int64_t> shape;
+  };
+  std::vector<InfillImage> fImages;
+  // (image, window) pairs each live channel is copied into
+  std::unordered_map<raw::ChannelID_t, std::vector<std::pair<size_t, size_t>>> fChannelTargets;
+
+  // The masked and infilled tensors of every image for one event. Concurrent events
+  // each take a set from the pool, so a set is allocated once and reused
+  struct EventTensors {
+    std::vector<torch::Tensor> masked;
+    std::vector<torch::Tensor> infilled;
+  };
+  std::mutex fPoolMutex;
+  std::vector<std::unique_ptr<EventTensors>> fTensorPool;
+
+  std::unique_ptr<EventTensors> TakeTensors();
+  void ReturnTensors(std::unique_ptr<EventTensors> tensors);
+
+  void AddFullRopImages();
+  void AddCropImages();
+  void RunInfill(const InfillImage& image, const torch::Tensor& masked, torch::Tensor& infilled) const;
+  std::shared_ptr<torchrt::SharedModule> LoadNetwork(const std::string& networkLoc) const;
+
   const std::string fNetworkPath;
   const std::string fNetworkNameInduction;
   const std::string fNetworkNameCollection;
-  torch::jit::script::Module fInductionModule;
-  torch::jit::script::Module fCollectionModule;
+  std::shared_ptr<torchrt::SharedModule> fInductionModule;
+  std::shared_ptr<torchrt::SharedModule> fCollectionModule;
   const std::string fInputLabel;
+  const std::string fDecodedADCLabel;
+  const unsigned int fNThreads;
+  tbb::task_arena fImageArena; ///< Runs at most fNThreads images of an event at once on the TBB pool
+  const unsigned int fCropWidth;
+  const unsigned int fRopBatchSize;
+  const bool fInfilledOnly;
+  const torch::Device fDevice;
+  const std::string fPrecision;
+  torch::ScalarType fDtype;
+  const bool fOptimizeForInference;
+  const unsigned int fWarmUpPasses;
+  const torchrt::ThreadConfig fTorchThreads;
 };
 
-Infill::InfillChannels::InfillChannels(fhicl::ParameterSet const& p)
-  : EDProducer{p},
+Infill::InfillChannels::InfillChannels(fhicl::ParameterSet const& p, art::ProcessingFrame const&)
+  : SharedProducer{p},
     fNetworkPath           (p.get<std::string> ("NetworkPath")),
     fNetworkNameInduction  (p.get<std::string> ("NetworkNameInduction")),
     fNetworkNameCollection (p.get<std::string> ("NetworkNameCollection")),
-    fInputLabel            (p.get<std::string> ("InputLabel"))
+    fInputLabel            (p.get<std::string> ("InputLabel")),
+    fDecodedADCLabel       (p.get<std::string> ("DecodedADCLabel", "")),
+    fNThreads              (std::max(1u, p.get<unsigned int> ("NThreads", 1))),
+    fImageArena            (fNThreads),
+    fCropWidth             (p.get<unsigned int> ("CropWidth", 0)),
+    fRopBatchSize          (p.get<unsigned int> ("RopBatchSize", 1)),
+    fInfilledOnly          (p.get<bool> ("InfilledOnly", false)),
+    fDevice                (p.get<std::string> ("Device", "cpu")),
+    fPrecision             (p.get<std::string> ("Precision", "fp32")),
+    fOptimizeForInference  (p.get<bool> ("OptimizeForInference", true)),
+    fWarmUpPasses          (p.get<unsigned int> ("WarmUpPasses", 2)),
+    fTorchThreads          {p.get<int> ("IntraOpThreads", 1), p.get<int> ("InterOpThreads", 1),
+                            dune::numa::ResolveNode(dune::numa::PlacementFromPSet(p))}
 {
+  if (fPrecision == "fp32") fDtype = torch::kFloat32;
+  else if (fPrecision == "bf16") fDtype = torch::kBFloat16;
+  else if (fPrecision == "fp16") fDtype = torch::kFloat16;
+  else {
+    std::cerr << "InfillChannels_module.cc: Precision must be fp32, bf16 or fp16, not " << fPrecision << "\n";
+    std::abort();
+  }
+  if (fDevice.is_cuda() && !torch::cuda::is_available()) {
+    std::cerr << "InfillChannels_module.cc: Device " << fDevice << " was requested but CUDA is not available\n";
+    std::abort();
+  }
+  // Half precision convolutions are only fast, and only fully supported, on GPUs
+  if (fDtype == torch::kFloat16 && !fDevice.is_cuda()) {
+    std::cerr << "InfillChannels_module.cc: fp16 needs a CUDA Device, use bf16 on CPU\n";
+    std::abort();
+  }
+
   consumes<std::vector<raw::RawDigit>>(fInputLabel);
+  if (!fDecodedADCLabel.empty()) consumes<Infill::DecodedADCs>(fDecodedADCLabel);
 
   produces<std::vector<raw::RawDigit>>();
+
+  // The networks are shared and thread safe, each event infills its own tensors
+  async<art::InEvent>();
 }
 
-void Infill::InfillChannels::produce(art::Event& e)
+void Infill::InfillChannels::produce(art::Event& e, art::ProcessingFrame const&)
 {
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(e);
   // Networks expect a fixed image size
@@ -101,83 +190,119 @@ void Infill::InfillChannels::produce(art::Event& e)
       
   typedef std::array<short, 6000> vecAdc;
   std::map<raw::ChannelID_t, vecAdc> infilledAdcs;
-  torch::Tensor maskedRopTensor;
-  torch::Tensor infilledRopTensor; 
 
   auto digs = e.getHandle<std::vector<raw::RawDigit> >(fInputLabel);
 
-  // Get infilled adc ROP by ROP
-  for (const readout::ROPID& currentRop : fActiveRops) {
-    maskedRopTensor = torch::zeros(
-      {1, 1 ,6000, fGeom->Nchannels(currentRop)}, torch::dtype(torch::kFloat32).device(torch::kCPU).requires_grad(false)
-    );
-    auto maskedRopTensorAccess = maskedRopTensor.accessor<float, 4>();
-
-    const raw::ChannelID_t firstCh = fGeom->FirstChannelInROP(currentRop);
+  std::unique_ptr<EventTensors> tensors = TakeTensors();
+  for (torch::Tensor& masked : tensors->masked) masked.zero_();
 
-    // Fill ROP image
-    for (const raw::RawDigit& dig : *digs) {
-      if (fDeadChannels.count(dig.Channel())) continue;
-
-      readout::ROPID rop = fGeom->ChannelToROP(dig.Channel());
-      if (rop != currentRop) continue;
+  // The digits decoded by DecodeRawDigits, shared with the other raw level modules
+  const Infill::DecodedADCs* decoded = nullptr;
+  if (!fDecodedADCLabel.empty()) {
+    decoded = e.getValidHandle<Infill::DecodedADCs>(fDecodedADCLabel).product();
+    if (decoded->NDigits() != digs->size()) {
+      std::cerr << "InfillChannels_module.cc: " << fDecodedADCLabel << " was not decoded from " << fInputLabel << "\n";
+      std::abort();
+    }
+  }
 
-      raw::RawDigit::ADCvector_t adcs(dig.Samples());
+  // Fill all images in a single pass over the digits
+  raw::RawDigit::ADCvector_t adcs;
+  for (size_t iDig = 0; iDig < digs->size(); ++iDig) {
+    const raw::RawDigit& dig = (*digs)[iDig];
+    auto targetIt = fChannelTargets.find(dig.Channel());
+    if (targetIt == fChannelTargets.end()) continue;
+
+    const short* digAdcs;
+    size_t nAdcs;
+    if (decoded) {
+      digAdcs = decoded->ADCs(iDig);
+      nAdcs = decoded->NSamples(iDig);
+    }
+    else {
+      adcs.resize(dig.Samples());
       raw::Uncompress(dig.ADCs(), adcs, dig.Compression());
-      
-      for (unsigned int tick = 0; tick < adcs.size(); ++tick) {
-        const int adc = adcs[tick] ? int(adcs[tick]) - dig.GetPedestal() : 0;
-
-        maskedRopTensorAccess[0][0][tick][dig.Channel() - firstCh] = adc;
-      } 
+      digAdcs = adcs.data();
+      nAdcs = adcs.size();
     }
 
-    // Do the Infill
-    std::vector<torch::jit::IValue> inputs;
-    inputs.push_back(maskedRopTensor);
-    if (fGeom->SignalType(currentRop) == geo::kInduction) {
-      torch::NoGradGuard no_grad_guard; 
-      infilledRopTensor = fInductionModule.forward(inputs).toTensor().detach();
-    }
-    else if (fGeom->SignalType(currentRop) == geo::kCollection) {
-      torch::NoGradGuard no_grad_guard; 
-      infilledRopTensor = fCollectionModule.forward(inputs).toTensor().detach();
+    for (const std::pair<size_t, size_t>& target : targetIt->second) {
+      const InfillImage& image = fImages[target.first];
+      float* masked = tensors->masked[target.first].data_ptr<float>() + target.second*6000*image.width
+        + (dig.Channel() - image.windowFirstCh[target.second]);
+      for (unsigned int tick = 0; tick < nAdcs; ++tick) {
+        const int adc = digAdcs[tick] ? int(digAdcs[tick]) - dig.GetPedestal() : 0;
+
+        masked[tick*image.width] = adc;
+      }
     }
+  }
+
+  // Do the Infill, independent images are run as tasks of the art TBB pool, so an
+  // exception of the network reaches art
+  if (fNThreads <= 1 || fImages.size() <= 1) {
+    for (size_t i = 0; i < fImages.size(); ++i) RunInfill(fImages[i], tensors->masked[i], tensors->infilled[i]);
+  }
+  else {
+    fImageArena.execute([this, &tensors]() {
+      tbb::parallel_for(size_t(0), fImages.size(), [this, &tensors](size_t i) {
+        RunInfill(fImages[i], tensors->masked[i], tensors->infilled[i]);
+      });
+    });
+  }
 
-    // Store infilled ADC of dead channels
-    auto infilledRopTensorAccess = infilledRopTensor.accessor<float, 4>();
-    for (const raw::ChannelID_t ch : fDeadChannels) {
-      if (fGeom->ChannelToROP(ch) == currentRop) {
+  // Store infilled ADC of dead channels
+  for (size_t iImage = 0; iImage < fImages.size(); ++iImage) {
+    const InfillImage& image = fImages[iImage];
+    const torch::Tensor& infilledTensor = tensors->infilled[iImage];
+    if (!infilledTensor.defined()) continue;
+
+    auto infilledTensorAccess = infilledTensor.accessor<float, 4>();
+    for (size_t window = 0; window < image.windowFirstCh.size(); ++window) {
+      const raw::ChannelID_t firstCh = image.windowFirstCh[window];
+      for (const raw::ChannelID_t ch : image.windowDeadChannels[window]) {
         for (unsigned int tick = 0; tick < detProp.NumberTimeSamples(); ++tick) {
-          infilledAdcs[ch][tick] = (short)std::round(infilledRopTensorAccess[0][0][tick][ch - firstCh]);
+          infilledAdcs[ch][tick] = (short)std::round(infilledTensorAccess[window][0][tick][ch - firstCh]);
         }
       }
-    } // Could break early if ch > last ch in currentRop to save a bit of looping?
+    }
   }
+  ReturnTensors(std::move(tensors));
 
-  // Encode infilled ADC into RawDigit and put back onto event 
+  // Encode infilled ADC into RawDigit and put back onto event. With fInfilledOnly only the
+  // infilled digits are written, Infill::MergedDigits puts them in place of the originals
   auto infilledDigs = std::make_unique<std::vector<raw::RawDigit>>();
-  *infilledDigs = *digs;
-  for (raw::RawDigit& dig : *infilledDigs) {
-    if (infilledAdcs.count(dig.Channel())) {
-      raw::RawDigit::ADCvector_t infilledAdc(
-        infilledAdcs[dig.Channel()].begin(), (infilledAdcs[dig.Channel()].begin() + detProp.NumberTimeSamples())
-      );
-
-      // Get new pedestal
-      auto infilledAdcMin = std::min_element(infilledAdc.begin(), infilledAdc.end());
-      short ped = *infilledAdcMin < 0 ? std::abs(*infilledAdcMin) + 1 : 0;
-      for (short& adc : infilledAdc) adc += ped;
-
-      raw::Compress(infilledAdc, dig.Compression()); // need to consider compression parameters
-      dig = raw::RawDigit(dig.Channel(), dig.Samples(), infilledAdc, dig.Compression());
-      dig.SetPedestal(ped);
+  if (fInfilledOnly) infilledDigs->reserve(infilledAdcs.size());
+  else *infilledDigs = *digs;
+  auto encode = [&detProp](const raw::RawDigit& dig, const vecAdc& adcs) {
+    raw::RawDigit::ADCvector_t infilledAdc(adcs.begin(), adcs.begin() + detProp.NumberTimeSamples());
+
+    // Get new pedestal
+    auto infilledAdcMin = std::min_element(infilledAdc.begin(), infilledAdc.end());
+    short ped = *infilledAdcMin < 0 ? std::abs(*infilledAdcMin) + 1 : 0;
+    for (short& adc : infilledAdc) adc += ped;
+
+    raw::Compress(infilledAdc, dig.Compression()); // need to consider compression parameters
+    raw::RawDigit infilledDig(dig.Channel(), dig.Samples(), infilledAdc, dig.Compression());
+    infilledDig.SetPedestal(ped);
+    return infilledDig;
+  };
+  if (fInfilledOnly) {
+    for (const raw::RawDigit& dig : *digs) {
+      auto adcIt = infilledAdcs.find(dig.Channel());
+      if (adcIt != infilledAdcs.end()) infilledDigs->push_back(encode(dig, adcIt->second));
+    }
+  }
+  else {
+    for (raw::RawDigit& dig : *infilledDigs) {
+      auto adcIt = infilledAdcs.find(dig.Channel());
+      if (adcIt != infilledAdcs.end()) dig = encode(dig, adcIt->second);
     }
   }
   e.put(std::move(infilledDigs)); 
 }
 
-void Infill::InfillChannels::beginJob()
+void Infill::InfillChannels::beginJob(art::ProcessingFrame const&)
 {
   fGeom = art::ServiceHandle<geo::Geometry>()->provider();
 
@@ -206,12 +331,12 @@ void Infill::InfillChannels::beginJob()
       const TGeoVolume* tpcVol = tpc.ActiveVolume();
       
       if (tpcVol->Capacity() > 1000000) { // At least one of the ROP's TPCIDs needs to be active
-        // Networks expect a fixed image size
-        if(fGeom->SignalType(ropID) == geo::kInduction && fGeom->Nchannels(ropID) > 800) {
+        // Networks expect a fixed image size, windows are always fCropWidth wide
+        if(fCropWidth == 0 && fGeom->SignalType(ropID) == geo::kInduction && fGeom->Nchannels(ropID) > 800) {
 	  std::cerr << "InfillChannels_module.cc: Induction view network cannot handle more then 800 channels\n";
 	  std::abort();
         }
-        if(fGeom->SignalType(ropID) == geo::kCollection && fGeom->Nchannels(ropID) > 480) {
+        if(fCropWidth == 0 && fGeom->SignalType(ropID) == geo::kCollection && fGeom->Nchannels(ropID) > 480) {
 	  std::cerr << "InfillChannels_module.cc: Collection view network cannot handle more then 400 channels\n";
 	  std::abort();
         }
@@ -222,6 +347,10 @@ void Infill::InfillChannels::beginJob()
     }
   }
   
+  // Lay out the images once, their tensors are zeroed and refilled every event
+  if (fCropWidth > 0) AddCropImages();
+  else AddFullRopImages();
+
   // Check dead channels resemble the dead channels used for training
   raw::ChannelID_t chGap = 1;
   for (const raw::ChannelID_t ch : fDeadChannels) {
@@ -252,25 +381,179 @@ void Infill::InfillChannels::beginJob()
   const std::string networkLocInduction = std::string(networkPath) + "/" + fNetworkNameInduction;
   const std::string networkLocCollection = std::string(networkPath) + "/" + fNetworkNameCollection;
 
-  try {
-    fInductionModule = torch::jit::load(networkLocInduction);
-    std::cout << "Induction module loaded from " << networkLocInduction <<std::endl;
+  fInductionModule = LoadNetwork(networkLocInduction);
+  std::cout << "Induction module loaded from " << networkLocInduction <<std::endl;
+  fCollectionModule = LoadNetwork(networkLocCollection);
+  std::cout << "Collection module loaded from " << networkLocCollection << std::endl;
+
+  // Pay the JIT optimisation of each network once for every image shape it will be given
+  std::set<std::pair<geo::SigType_t, std::vector<int64_t>>> warmedUp;
+  for (const InfillImage& image : fImages) {
+    if (!warmedUp.insert({image.sigType, image.shape}).second) continue;
+    const torch::Tensor input = torch::zeros(image.shape, torch::dtype(torch::kFloat32).device(torch::kCPU));
+    if (image.sigType == geo::kInduction) fInductionModule->WarmUp(input, fWarmUpPasses);
+    else if (image.sigType == geo::kCollection) fCollectionModule->WarmUp(input, fWarmUpPasses);
   }
-  catch (const c10::Error& err) {
-    std::cerr << "error loading the model\n";
-    std::cerr << err.what();
+}
+
+std::unique_ptr<Infill::InfillChannels::EventTensors> Infill::InfillChannels::TakeTensors()
+{
+  {
+    std::lock_guard<std::mutex> lock(fPoolMutex);
+    if (!fTensorPool.empty()) {
+      std::unique_ptr<EventTensors> tensors = std::move(fTensorPool.back());
+      fTensorPool.pop_back();
+      return tensors;
+    }
   }
-  try {
-    fCollectionModule = torch::jit::load(networkLocCollection);
-    std::cout << "Collection module loaded from " << networkLocCollection << std::endl;
+
+  auto tensors = std::make_unique<EventTensors>();
+  for (const InfillImage& image : fImages) {
+    tensors->masked.push_back(
+      torch::zeros(image.shape, torch::dtype(torch::kFloat32).device(torch::kCPU).requires_grad(false))
+    );
+  }
+  tensors->infilled.resize(fImages.size());
+  return tensors;
+}
+
+void Infill::InfillChannels::ReturnTensors(std::unique_ptr<EventTensors> tensors)
+{
+  std::lock_guard<std::mutex> lock(fPoolMutex);
+  fTensorPool.push_back(std::move(tensors));
+}
+
+std::shared_ptr<torchrt::SharedModule> Infill::InfillChannels::LoadNetwork(const std::string& networkLoc) const
+{
+  torchrt::ModuleOptions options;
+  options.device = fDevice.str();
+  // Int8 networks are quantised when the TorchScript is made (make_tscript.py --quantise), they take and give fp32
+  options.dtype = fDtype;
+  // Freeze the weights into the graph and fold and fuse its operations for the device
+  options.optimizeForInference = fOptimizeForInference;
+
+  std::shared_ptr<torchrt::SharedModule> module =
+    torchrt::ModuleRegistry::Instance().Get(networkLoc, options, fTorchThreads);
+  if (!module) {
+    std::cerr << "InfillChannels_module.cc: error loading the model " << networkLoc << "\n";
+    std::abort();
+  }
+
+  return module;
+}
+
+void Infill::InfillChannels::AddFullRopImages()
+{
+  // ROPs of the same plane type and width can share one batched forward call, up to
+  // fRopBatchSize of them per image (0 = no limit)
+  std::map<std::pair<geo::SigType_t, unsigned int>, size_t> openImages;
+  for (const readout::ROPID& ropID : fActiveRops) {
+    const raw::ChannelID_t firstCh = fGeom->FirstChannelInROP(ropID);
+    const unsigned int nChannels = fGeom->Nchannels(ropID);
+    const geo::SigType_t sigType = fGeom->SignalType(ropID);
+
+    auto openIt = openImages.find({sigType, nChannels});
+    if (openIt == openImages.end() ||
+        (fRopBatchSize > 0 && fImages[openIt->second].windowFirstCh.size() >= fRopBatchSize)) {
+      InfillImage image;
+      image.sigType = sigType;
+      image.width = nChannels;
+      openImages[{sigType, nChannels}] = fImages.size();
+      fImages.push_back(std::move(image));
+      openIt = openImages.find({sigType, nChannels});
+    }
+
+    const size_t iImage = openIt->second;
+    InfillImage& image = fImages[iImage];
+    const size_t window = image.windowFirstCh.size();
+    image.windowFirstCh.push_back(firstCh);
+    image.windowDeadChannels.emplace_back();
+    for (raw::ChannelID_t ch = firstCh; ch < firstCh + nChannels; ++ch) {
+      if (fDeadChannels.count(ch)) image.windowDeadChannels.back().push_back(ch);
+      else fChannelTargets[ch].emplace_back(iImage, window);
+    }
+  }
+
+  for (InfillImage& image : fImages) {
+    image.shape = {int64_t(image.windowFirstCh.size()), 1, 6000, image.width};
+  }
+  mf::LogInfo("InfillChannels") << fActiveRops.size() << " ROPs in " << fImages.size() << " images";
+}
+
+void Infill::InfillChannels::AddCropImages()
+{
+  // One image for each plane type, every window is fCropWidth channels wide
+  std::map<geo::SigType_t, InfillImage> images;
+  // Clusters wider than half the window are split so every piece keeps some live context
+  const unsigned int maxClusterWidth = std::max(1u, fCropWidth/2);
+
+  for (const readout::ROPID& ropID : fActiveRops) {
+    const raw::ChannelID_t ropFirstCh = fGeom->FirstChannelInROP(ropID);
+    const raw::ChannelID_t ropEndCh = ropFirstCh + fGeom->Nchannels(ropID);
+    const geo::SigType_t sigType = fGeom->SignalType(ropID);
+
+    InfillImage& image = images[sigType];
+    image.sigType = sigType;
+    image.width = fCropWidth;
+
+    // Dead channels are sorted, so clusters are runs of consecutive channels
+    auto deadIt = fDeadChannels.lower_bound(ropFirstCh);
+    while (deadIt != fDeadChannels.end() && *deadIt < ropEndCh) {
+      std::vector<raw::ChannelID_t> cluster;
+      cluster.push_back(*deadIt++);
+      while (deadIt != fDeadChannels.end() && *deadIt == cluster.back() + 1 && *deadIt < ropEndCh &&
+             cluster.size() < maxClusterWidth) {
+        cluster.push_back(*deadIt++);
+      }
+
+      // Centre the window on the cluster, keeping it inside the ROP where possible
+      const long centre = (long(cluster.front()) + long(cluster.back()))/2;
+      long firstCh = std::min(centre - long(fCropWidth/2), long(ropEndCh) - long(fCropWidth));
+      firstCh = std::max(firstCh, long(ropFirstCh));
+
+      image.windowFirstCh.push_back(firstCh);
+      image.windowDeadChannels.push_back(cluster);
+    }
+  }
+
+  for (auto& sigImage : images) {
+    InfillImage& image = sigImage.second;
+    const size_t imageIndex = fImages.size();
+    for (size_t window = 0; window < image.windowFirstCh.size(); ++window) {
+      const raw::ChannelID_t firstCh = image.windowFirstCh[window];
+      const readout::ROPID ropID = fGeom->ChannelToROP(image.windowDeadChannels[window].front());
+      const raw::ChannelID_t ropEndCh = fGeom->FirstChannelInROP(ropID) + fGeom->Nchannels(ropID);
+      for (raw::ChannelID_t ch = firstCh; ch < std::min<raw::ChannelID_t>(firstCh + fCropWidth, ropEndCh); ++ch) {
+        if (!fDeadChannels.count(ch)) fChannelTargets[ch].emplace_back(imageIndex, window);
+      }
+    }
+    const long nWindows = image.windowFirstCh.size();
+    image.shape = {nWindows, 1, 6000, fCropWidth};
+    fImages.push_back(std::move(image));
+  }
+}
+
+void Infill::InfillChannels::RunInfill(const InfillImage& image, const torch::Tensor& masked, torch::Tensor& infilled) const
+{
+  DUNE_PROF_SCOPE("Infill::InfillChannels::RunInfill");
+  DUNE_PROF_COUNT("Infill::InfillChannels::RunInfill windows", masked.size(0));
+
+  // Grad mode is thread local so the guard has to live on the worker thread
+  torch::NoGradGuard no_grad_guard;
+  std::vector<torch::jit::IValue> inputs;
+  // The images are filled in fp32 on the CPU, and the infilled ADCs are read back the same way
+  inputs.push_back(masked.to(fDevice, fDtype));
+  torch::Tensor output;
+  if (image.sigType == geo::kInduction) {
+    output = fInductionModule->Forward(inputs).toTensor();
   }
-  catch (const c10::Error& err) {
-    std::cerr << "error loading the model\n";
-    std::cerr << err.what();
+  else if (image.sigType == geo::kCollection) {
+    output = fCollectionModule->Forward(inputs).toTensor();
   }
+  if (output.defined()) infilled = output.detach().to(torch::kCPU, torch::kFloat32);
 }
 
-void Infill::InfillChannels::endJob()
+void Infill::InfillChannels::endJob(art::ProcessingFrame const&)
 {
   // Implementation of optional member function here.
 }
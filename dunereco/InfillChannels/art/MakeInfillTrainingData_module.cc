@@ -25,11 +25,13 @@
 #include "lardataobj/RawData/raw.h"
 #include "larevt/CalibrationDBI/Interface/ChannelStatusService.h"
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "dunereco/InfillChannels/products/DecodedADCs.h"
 
 #include <TH2F.h>
 #include <TTree.h>
 #include <TGeoVolume.h>
 #include <TFile.h>
+#include <TDirectory.h>
 
 #include <vector>
 #include <string>
@@ -37,6 +39,7 @@
 #include <algorithm>
 #include <iterator>
 #include <utility>
+#include <memory>
 
 namespace Infill {
   class MakeInfillTrainingData;
@@ -74,14 +77,22 @@ private:
 
   std::set<readout::ROPID> fActiveRops;
 
+  // One image per active ROP, made once and refilled and written under a new name every event
+  std::map<readout::ROPID, std::unique_ptr<TH2F>> fRopImages;
+  TDirectory* fImageDir;
+
   std::string fInputLabel;
+  std::string fDecodedADCLabel;
 };
 
 Infill::MakeInfillTrainingData::MakeInfillTrainingData(fhicl::ParameterSet const& p)
   : EDAnalyzer{p},
-  fInputLabel           (p.get<std::string> ("inputLabel"))
+  fImageDir             (nullptr),
+  fInputLabel           (p.get<std::string> ("inputLabel")),
+  fDecodedADCLabel      (p.get<std::string> ("DecodedADCLabel", ""))
 {
   consumes<std::vector<raw::RawDigit>>(fInputLabel);
+  if (!fDecodedADCLabel.empty()) consumes<Infill::DecodedADCs>(fDecodedADCLabel);
 }
 
 void Infill::MakeInfillTrainingData::analyze(art::Event const& e)
@@ -90,7 +101,6 @@ void Infill::MakeInfillTrainingData::analyze(art::Event const& e)
     "Ev" + std::to_string(e.id().event()) + "Run" + std::to_string(e.id().run()) + 
     "SRun" + std::to_string(e.id().subRun())
   );
-  std::map<readout::ROPID, TH2F*> ropImages;
 
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(e);
   // Networks expect a fixed image size
@@ -100,37 +110,60 @@ void Infill::MakeInfillTrainingData::analyze(art::Event const& e)
   } 
 
   // Prepare TH2s
-  for (const readout::ROPID& rop : fActiveRops) {
+  for (auto& ropImage : fRopImages) {
+    const readout::ROPID& rop = ropImage.first;
     std::string sTitle = (
       sEvent + "_TPCset" + std::to_string(rop.TPCset) + "_ROP" + std::to_string(rop.ROP)
     );
-    ropImages[rop] = tfs->make<TH2F>(
-      sTitle.c_str(), sTitle.c_str(), fGeom->Nchannels(rop), 0, fGeom->Nchannels(rop), 6000, 0, 6000
-    );
+    ropImage.second->Reset();
+    ropImage.second->SetNameTitle(sTitle.c_str(), sTitle.c_str());
   }
 
   auto digs = e.getHandle<std::vector<raw::RawDigit>>(fInputLabel);
 
+  // The digits decoded by DecodeRawDigits, shared with the other raw level modules
+  const Infill::DecodedADCs* decoded = nullptr;
+  if (!fDecodedADCLabel.empty()) {
+    decoded = e.getValidHandle<Infill::DecodedADCs>(fDecodedADCLabel).product();
+    if (decoded->NDigits() != digs->size()) {
+      std::cerr << "MakeInfillTrainingData_module.cc: " << fDecodedADCLabel << " was not decoded from " << fInputLabel << "\n";
+      std::abort();
+    }
+  }
+
   // Fill TH2s
-  for(const raw::RawDigit& dig : *digs){ 
+  raw::RawDigit::ADCvector_t adcs;
+  for (size_t iDig = 0; iDig < digs->size(); ++iDig) {
+    const raw::RawDigit& dig = (*digs)[iDig];
     readout::ROPID rop = fGeom->ChannelToROP(dig.Channel());
-    if(ropImages.count(rop)){ // Ignores ROPs associated with only inactive TPCIDs
-      raw::RawDigit::ADCvector_t adcs(dig.Samples());
-      // raw::Uncompress(dig.ADCs(), adcs, dig.GetPedestal(), dig.Compression());
-      raw::Uncompress(dig.ADCs(), adcs, dig.Compression());
+    auto imageIt = fRopImages.find(rop);
+    if (imageIt != fRopImages.end()) { // Ignores ROPs associated with only inactive TPCIDs
+      const short* digAdcs;
+      size_t nAdcs;
+      if (decoded) {
+        digAdcs = decoded->ADCs(iDig);
+        nAdcs = decoded->NSamples(iDig);
+      }
+      else {
+        adcs.assign(dig.Samples(), 0);
+        // raw::Uncompress(dig.ADCs(), adcs, dig.GetPedestal(), dig.Compression());
+        raw::Uncompress(dig.ADCs(), adcs, dig.Compression());
+        digAdcs = adcs.data();
+        nAdcs = adcs.size();
+      }
 
+      TH2F* image = imageIt->second.get();
       const raw::ChannelID_t firstCh = fGeom->FirstChannelInROP(rop);
-      for(unsigned int tick = 0; tick < adcs.size(); ++tick){
-        const int adc = adcs[tick] ? int(adcs[tick]) - dig.GetPedestal() : 0;
+      for(unsigned int tick = 0; tick < nAdcs; ++tick){
+        const int adc = digAdcs[tick] ? int(digAdcs[tick]) - dig.GetPedestal() : 0;
 
-        ropImages[rop]->Fill(dig.Channel() - firstCh, tick, adc);
+        image->Fill(dig.Channel() - firstCh, tick, adc);
       }
     }
   }
 
-  tfs->file().Write();
+  for (const auto& ropImage : fRopImages) fImageDir->WriteTObject(ropImage.second.get());
   tfs->file().Flush();
-  for(auto it: ropImages) delete it.second;
 }
 
 void Infill::MakeInfillTrainingData::beginJob()
@@ -159,6 +192,18 @@ void Infill::MakeInfillTrainingData::beginJob()
       }
     }
   }
+
+  // The images are made in the module directory of the output file but owned here, so that they are not
+  // written again when the file is closed
+  for (const readout::ROPID& rop : fActiveRops) {
+    std::string sName = "TPCset" + std::to_string(rop.TPCset) + "_ROP" + std::to_string(rop.ROP);
+    TH2F* image = tfs->make<TH2F>(
+      sName.c_str(), sName.c_str(), fGeom->Nchannels(rop), 0, fGeom->Nchannels(rop), 6000, 0, 6000
+    );
+    fImageDir = image->GetDirectory();
+    image->SetDirectory(nullptr);
+    fRopImages[rop].reset(image);
+  }
 }
 
 void Infill::MakeInfillTrainingData::endJob()
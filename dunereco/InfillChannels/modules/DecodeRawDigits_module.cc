@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       DecodeRawDigits
+// Plugin Type: producer
+// File:        DecodeRawDigits_module.cc
+//
+// Decodes a raw::RawDigit collection once per event into an
+// Infill::DecodedADCs, for the raw level modules that would otherwise
+// each uncompress the same digits
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "lardataobj/RawData/RawDigit.h"
+#include "dunereco/InfillChannels/products/DecodedADCs.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Infill
+{
+  class DecodeRawDigits;
+}
+
+class Infill::DecodeRawDigits : public art::EDProducer
+{
+public:
+  explicit DecodeRawDigits(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  DecodeRawDigits(DecodeRawDigits const&) = delete;
+  DecodeRawDigits(DecodeRawDigits&&) = delete;
+  DecodeRawDigits& operator=(DecodeRawDigits const&) = delete;
+  DecodeRawDigits& operator=(DecodeRawDigits&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+  const std::string fInputLabel;
+};
+
+Infill::DecodeRawDigits::DecodeRawDigits(fhicl::ParameterSet const& p)
+  : EDProducer{p},
+    fInputLabel (p.get<std::string> ("InputLabel"))
+{
+  consumes<std::vector<raw::RawDigit>>(fInputLabel);
+
+  produces<Infill::DecodedADCs>();
+}
+
+void Infill::DecodeRawDigits::produce(art::Event& e)
+{
+  auto digs = e.getHandle<std::vector<raw::RawDigit>>(fInputLabel);
+
+  e.put(std::make_unique<Infill::DecodedADCs>(*digs));
+}
+
+DEFINE_ART_MODULE(Infill::DecodeRawDigits)
@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    DecodedADCs.cxx
+/// \brief   The uncompressed ADCs of a raw::RawDigit collection, decoded
+///          once and shared by the raw level modules of a job
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+#include "lardataobj/RawData/raw.h"
+#include "dunereco/InfillChannels/products/DecodedADCs.h"
+
+namespace Infill
+{
+
+  DecodedADCs::DecodedADCs()
+    : fOffsets(1, 0)
+  {
+  }
+
+  DecodedADCs::DecodedADCs(const std::vector<raw::RawDigit>& digits)
+    : fChannels(digits.size()),
+      fPedestals(digits.size()),
+      fOffsets(digits.size() + 1, 0)
+  {
+    for (size_t i = 0; i < digits.size(); ++i) {
+      fChannels[i] = digits[i].Channel();
+      fPedestals[i] = digits[i].GetPedestal();
+      fOffsets[i + 1] = fOffsets[i] + digits[i].Samples();
+    }
+    fADCs.resize(fOffsets.back());
+
+    // Every digit is decoded straight into its own slice of the array,
+    // raw::Uncompress only needs a buffer for the compressed ones
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, digits.size()),
+      [&](const tbb::blocked_range<size_t>& range) {
+        raw::RawDigit::ADCvector_t buffer;
+        for (size_t i = range.begin(); i < range.end(); ++i) {
+          const raw::RawDigit& digit = digits[i];
+          short* out = fADCs.data() + fOffsets[i];
+          if (digit.Compression() == raw::kNone) {
+            const size_t n = std::min<size_t>(digit.ADCs().size(), NSamples(i));
+            std::copy(digit.ADCs().begin(), digit.ADCs().begin() + n, out);
+            continue;
+          }
+          buffer.resize(NSamples(i));
+          raw::Uncompress(digit.ADCs(), buffer, digit.Compression());
+          std::copy(buffer.begin(), buffer.end(), out);
+        }
+      });
+  }
+
+}
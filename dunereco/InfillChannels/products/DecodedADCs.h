@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    DecodedADCs.h
+/// \brief   The uncompressed ADCs of a raw::RawDigit collection, decoded
+///          once and shared by the raw level modules of a job
+////////////////////////////////////////////////////////////////////////
+
+#ifndef INFILL_DECODEDADCS_H
+#define INFILL_DECODEDADCS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "lardataobj/RawData/RawDigit.h"
+
+namespace Infill
+{
+
+  /// The ADCs of every digit of a collection, in the order of the digits,
+  /// one after the other in a single array. The pedestals are kept
+  /// separately and not subtracted, as for raw::Uncompress
+  class DecodedADCs
+  {
+  public:
+    DecodedADCs();
+    /// Decode all digits, in parallel
+    explicit DecodedADCs(const std::vector<raw::RawDigit>& digits);
+
+    size_t NDigits() const {return fChannels.size();};
+    raw::ChannelID_t Channel(size_t digit) const {return fChannels[digit];};
+    float Pedestal(size_t digit) const {return fPedestals[digit];};
+    size_t NSamples(size_t digit) const {return fOffsets[digit + 1] - fOffsets[digit];};
+    /// The NSamples(digit) ADCs of a digit
+    const short* ADCs(size_t digit) const {return fADCs.data() + fOffsets[digit];};
+
+  private:
+    std::vector<raw::ChannelID_t> fChannels;
+    std::vector<float> fPedestals;
+    std::vector<size_t> fOffsets;   ///< First ADC of each digit, plus the total
+    std::vector<short> fADCs;
+  };
+
+}
+
+#endif  // INFILL_DECODEDADCS_H
@@ -0,0 +1,37 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    MergedDigits.cxx
+/// \brief   The raw digits of an event with the infilled dead channels
+///          put in place, without copying either collection
+////////////////////////////////////////////////////////////////////////
+
+#include <unordered_map>
+
+#include "dunereco/InfillChannels/products/MergedDigits.h"
+
+namespace Infill
+{
+
+  MergedDigits::MergedDigits(const std::vector<raw::RawDigit>& digits,
+                             const std::vector<raw::RawDigit>& infilled)
+    : fDigits(digits.size()),
+      fInfilled(digits.size(), false),
+      fNInfilled(0)
+  {
+    std::unordered_map<raw::ChannelID_t, const raw::RawDigit*> replacements;
+    replacements.reserve(infilled.size());
+    for (const raw::RawDigit& dig : infilled) replacements[dig.Channel()] = &dig;
+
+    for (size_t i = 0; i < digits.size(); ++i) {
+      auto it = replacements.find(digits[i].Channel());
+      if (it == replacements.end()) {
+        fDigits[i] = &digits[i];
+      }
+      else {
+        fDigits[i] = it->second;
+        fInfilled[i] = true;
+        ++fNInfilled;
+      }
+    }
+  }
+
+}
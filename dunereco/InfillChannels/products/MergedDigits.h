@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    MergedDigits.h
+/// \brief   The raw digits of an event with the infilled dead channels
+///          put in place, without copying either collection
+////////////////////////////////////////////////////////////////////////
+
+#ifndef INFILL_MERGEDDIGITS_H
+#define INFILL_MERGEDDIGITS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "lardataobj/RawData/RawDigit.h"
+
+namespace Infill
+{
+
+  /// A view of the original digits in which every digit whose channel was
+  /// infilled is replaced by its infilled digit, for the InfilledOnly output
+  /// of InfillChannels. Only pointers are held, so both collections must
+  /// outlive the view
+  class MergedDigits
+  {
+  public:
+    MergedDigits(const std::vector<raw::RawDigit>& digits,
+                 const std::vector<raw::RawDigit>& infilled);
+
+    size_t size() const {return fDigits.size();};
+    /// The digit in position i of the original collection, or its infilled
+    /// replacement
+    const raw::RawDigit& operator[](size_t i) const {return *fDigits[i];};
+    /// Whether the digit in position i was infilled
+    bool Infilled(size_t i) const {return fInfilled[i];};
+    size_t NInfilled() const {return fNInfilled;};
+
+  private:
+    std::vector<const raw::RawDigit*> fDigits;
+    std::vector<bool> fInfilled;
+    size_t fNInfilled;
+  };
+
+}
+
+#endif  // INFILL_MERGEDDIGITS_H
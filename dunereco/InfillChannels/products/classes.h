@@ -0,0 +1,2 @@
+#include "canvas/Persistency/Common/Wrapper.h"
+#include "dunereco/InfillChannels/products/DecodedADCs.h"
@@ -1,6 +1,10 @@
 """
 Trace trained infill model to produce a TorchScript. Resulting .pt can then be loaded direclty into
 C++.
+
+With --quantise the convolutions are quantised to int8 first, calibrated on the example images. The
+quantised TorchScript still takes and returns fp32 images, so InfillChannels runs it with Precision fp32
+on the CPU.
 """
 
 import os, argparse
@@ -10,7 +14,33 @@ import numpy as np
 
 from model import UnetInduction, UnetCollection
 
-def main(input_file, out_name, example_dir, collection):
+def load_examples(example_dir, n_examples):
+    examples = []
+    for filename in sorted(os.listdir(example_dir)):
+        if filename.endswith(".npy"):
+            arr = np.load(os.path.join(example_dir, filename)).T
+            maskpattern = [114, 273, 401] # Example maskpattern
+            arr[:, maskpattern] = 0
+            example_img = torch.FloatTensor(arr.reshape(1, *arr.shape))
+            examples.append(torch.stack([example_img]))
+            if len(examples) == n_examples:
+                break
+    return examples
+
+
+def quantise(model, examples):
+    """Static int8 quantisation of the convolutions, observed on the examples"""
+    from torch.ao.quantization import get_default_qconfig_mapping
+    from torch.ao.quantization.quantize_fx import prepare_fx, convert_fx
+
+    prepared = prepare_fx(model, get_default_qconfig_mapping("fbgemm"), example_inputs=(examples[0],))
+    with torch.no_grad():
+        for example_img in examples:
+            prepared(example_img)
+    return convert_fx(prepared)
+
+
+def main(input_file, out_name, example_dir, collection, n_quantise):
 
     if collection:
         model = UnetCollection()
@@ -25,15 +55,11 @@ def main(input_file, out_name, example_dir, collection):
     pretrained_dict = {key.replace("module.", ""): value for key, value in pretrained_dict.items()}
     model.load_state_dict(pretrained_dict)
 
-    for filename in os.listdir(example_dir):
-        if filename.endswith(".npy"):
-            arr = np.load(os.path.join(example_dir, filename)).T
-            maskpattern = [114, 273, 401] # Example maskpattern
-            arr[:, maskpattern] = 0
-            example_img = torch.FloatTensor(arr.reshape(1, *arr.shape))
-            example_img = torch.stack([example_img])
-            break
-    
+    examples = load_examples(example_dir, max(1, n_quantise))
+    example_img = examples[0]
+    if n_quantise > 0:
+        model = quantise(model, examples)
+
     with torch.no_grad():  
         traced_model = torch.jit.trace(model, example_img)
     traced_model.save(out_name + ".pt")
@@ -47,13 +73,16 @@ def parse_arguments():
     parser.add_argument("output_name")
     parser.add_argument("example_dir", help="Directory containing input data for the model being serialised")
 
+    parser.add_argument("--quantise", type=int, default=0, metavar="N",
+                        help="quantise the convolutions to int8, calibrated on N example images")
+
     group = parser.add_mutually_exclusive_group(required=True)
     group.add_argument("--collection",action='store_true')
     group.add_argument("--induction",action='store_true')
 
     args = parser.parse_args()
 
-    return (args.input_file, args.output_name, args.example_dir, args.collection)
+    return (args.input_file, args.output_name, args.example_dir, args.collection, args.quantise)
 
 
 if __name__ == "__main__":
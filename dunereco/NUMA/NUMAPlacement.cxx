@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      PlacementConfig
+////
+//// NUMA placement of the dunereco thread pools on multi-socket nodes
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/task_arena.h"
+#include "tbb/task_scheduler_observer.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+
+/// CPUs of a sysfs cpulist, e.g. "0-15,32-47"
+std::vector<int> ParseCPUList(const std::string & list)
+{
+    std::vector<int> cpus;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+        const size_t dash(range.find('-'));
+        const int first(std::stoi(range.substr(0, dash)));
+        const int last(dash == std::string::npos ? first : std::stoi(range.substr(dash + 1)));
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::vector< std::vector<int> > ReadNodes()
+{
+    std::vector< std::vector<int> > nodes;
+    for (unsigned int node = 0; ; ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file)
+            break;
+        std::string list;
+        std::getline(file, list);
+        nodes.push_back(ParseCPUList(list));
+    }
+    return nodes;
+}
+
+cpu_set_t ReadProcessCPUs()
+{
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0)
+    {
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &set);
+    }
+    return set;
+}
+
+/// The CPUs the process may run on, read when the library is loaded, before any thread is pinned by it
+const cpu_set_t kProcessCPUs(ReadProcessCPUs());
+
+/// CPUs of a node the process may run on, so a placement never widens the affinity given to the job
+cpu_set_t NodeSet(const int node)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : dune::numa::Nodes()[node])
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &kProcessCPUs))
+            CPU_SET(cpu, &set);
+    }
+    return set;
+}
+
+/// Pins the threads that join an arena to the CPUs of its node while they work in it
+class NodeObserver : public tbb::task_scheduler_observer
+{
+public:
+    NodeObserver(tbb::task_arena & arena, const cpu_set_t & cpus) : tbb::task_scheduler_observer(arena), fCPUs(cpus)
+    {
+        observe(true);
+    }
+
+    ~NodeObserver()
+    {
+        observe(false);
+    }
+
+    void on_scheduler_entry(bool) override
+    {
+        SavedMask & saved(fSaved.local());
+        saved.pinned = sched_getaffinity(0, sizeof(cpu_set_t), &saved.previous) == 0 &&
+            sched_setaffinity(0, sizeof(cpu_set_t), &fCPUs) == 0;
+    }
+
+    void on_scheduler_exit(bool) override
+    {
+        SavedMask & saved(fSaved.local());
+        if (saved.pinned)
+            sched_setaffinity(0, sizeof(cpu_set_t), &saved.previous);
+        saved.pinned = false;
+    }
+
+private:
+    struct SavedMask
+    {
+        bool pinned = false;
+        cpu_set_t previous;
+    };
+
+    const cpu_set_t fCPUs;
+    /// Affinity of each thread before it joined this arena. Kept per observer, so a thread working in the
+    /// arenas of two nodes, one inside the other, gets back the mask it had before each of them
+    tbb::enumerable_thread_specific<SavedMask> fSaved;
+};
+
+struct NodeArena
+{
+    explicit NodeArena(const cpu_set_t & cpus) :
+        fArena(CPU_COUNT(&cpus)),
+        fObserver(fArena, cpus)
+    {
+    }
+
+    tbb::task_arena fArena;
+    NodeObserver fObserver;
+};
+
+} // namespace
+
+namespace dune
+{
+namespace numa
+{
+
+PlacementConfig::Policy ParsePolicy(const std::string & name)
+{
+    if (name == "none")
+        return PlacementConfig::kNone;
+    if (name == "local")
+        return PlacementConfig::kLocal;
+    if (name == "node")
+        return PlacementConfig::kNode;
+    throw cet::exception("NUMA") << "Unknown NUMAPolicy " << name << ", use none, local or node";
+}
+
+PlacementConfig PlacementFromPSet(const fhicl::ParameterSet & pset)
+{
+    PlacementConfig placement;
+    placement.policy = ParsePolicy(pset.get<std::string>("NUMAPolicy", "none"));
+    placement.node = pset.get<int>("NUMANode", 0);
+    return placement;
+}
+
+const std::vector< std::vector<int> > & Nodes()
+{
+    static const std::vector< std::vector<int> > nodes(ReadNodes());
+    return nodes;
+}
+
+int CurrentNode()
+{
+    const int cpu(sched_getcpu());
+    const std::vector< std::vector<int> > & nodes(Nodes());
+    for (size_t node = 0; cpu >= 0 && node < nodes.size(); ++node)
+    {
+        for (const int nodeCPU : nodes[node])
+        {
+            if (nodeCPU == cpu)
+                return node;
+        }
+    }
+    return 0;
+}
+
+int ResolveNode(const PlacementConfig & placement)
+{
+    const int nNodes(Nodes().size());
+    if (placement.policy == PlacementConfig::kNone || nNodes < 2)
+        return -1;
+    if (placement.policy == PlacementConfig::kLocal)
+        return CurrentNode();
+    return ((placement.node % nNodes) + nNodes) % nNodes;
+}
+
+ScopedPin::ScopedPin(const int node) : fPinned(false)
+{
+    if (node < 0 || node >= static_cast<int>(Nodes().size()))
+        return;
+
+    const cpu_set_t set(NodeSet(node));
+    if (CPU_COUNT(&set) == 0)
+        return;
+    fPinned = sched_getaffinity(0, sizeof(cpu_set_t), &fPrevious) == 0 && sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+}
+
+ScopedPin::~ScopedPin()
+{
+    if (fPinned)
+        sched_setaffinity(0, sizeof(cpu_set_t), &fPrevious);
+}
+
+void ExecuteOnNode(const int node, void (*call)(void *), void * context)
+{
+    static std::mutex mutex;
+    static std::vector< std::unique_ptr<NodeArena> > arenas(Nodes().size());
+
+    if (node < 0 || node >= static_cast<int>(arenas.size()))
+    {
+        call(context);
+        return;
+    }
+
+    NodeArena * arena(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!arenas[node])
+        {
+            const cpu_set_t cpus(NodeSet(node));
+            if (CPU_COUNT(&cpus) > 0)
+                arenas[node] = std::make_unique<NodeArena>(cpus);
+        }
+        arena = arenas[node].get();
+    }
+
+    // None of the CPUs of the node are available to the process
+    if (!arena)
+    {
+        call(context);
+        return;
+    }
+    arena->fArena.execute([call, context]() { call(context); });
+}
+
+} // namespace numa
+} // namespace dune
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      PlacementConfig
+////
+//// NUMA placement of the dunereco thread pools on multi-socket nodes. The
+//// inference runtimes make their pools while the calling thread is pinned
+//// to one node, so the pool threads inherit that node's CPUs, and the
+//// parallel algorithms run their loops in a task arena whose threads are
+//// kept on one node. Memory is placed by first touch, so buffers filled in
+//// those threads stay on the node that reads them.
+////
+//// The topology is read from /sys/devices/system/node. On a machine with
+//// one node, or without that directory, every placement does nothing.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sched.h>
+
+namespace fhicl
+{
+    class ParameterSet;
+}
+
+namespace dune
+{
+namespace numa
+{
+
+struct PlacementConfig
+{
+    enum Policy
+    {
+        kNone,  ///< leave the threads where the scheduler puts them
+        kLocal, ///< the node the calling thread runs on when the work starts
+        kNode   ///< a fixed node
+    };
+
+    Policy policy = kNone;
+    int node = 0; ///< node of kNode, wrapped onto the nodes of the machine
+};
+
+/// Placement from the NUMAPolicy ("none", "local" or "node") and NUMANode parameters of a module or tool
+PlacementConfig PlacementFromPSet(const fhicl::ParameterSet & pset);
+
+/// Parse a policy name, throws a cet::exception for unknown names
+PlacementConfig::Policy ParsePolicy(const std::string & name);
+
+/// CPUs of each NUMA node, read once
+const std::vector< std::vector<int> > & Nodes();
+
+/// Node of the CPU the calling thread runs on, 0 if unknown
+int CurrentNode();
+
+/// Node a placement resolves to for the calling thread, -1 for no placement or a single node machine
+int ResolveNode(const PlacementConfig & placement);
+
+/// Pins the calling thread to the CPUs of a node and restores its previous affinity on destruction.
+/// Only the CPUs of the node the process was allowed to run on at start up are used. Does nothing for a
+/// negative node, or a node with none of those CPUs
+class ScopedPin
+{
+public:
+    explicit ScopedPin(int node);
+    ~ScopedPin();
+
+    ScopedPin(const ScopedPin &) = delete;
+    ScopedPin & operator=(const ScopedPin &) = delete;
+
+private:
+    bool fPinned;
+    cpu_set_t fPrevious;
+};
+
+/// Run a function in the task arena of a node, whose worker threads are pinned to its CPUs while they
+/// work in it, so a tbb::parallel_for inside stays on that node. The CPUs are limited as for ScopedPin.
+/// Runs it directly for a negative node, or a node with none of the process CPUs
+void ExecuteOnNode(int node, void (*call)(void *), void * context);
+
+/// Run f, with the placement of its parallel loops
+template <typename F>
+void Execute(const PlacementConfig & placement, F && f)
+{
+    const int node(ResolveNode(placement));
+    if (node < 0)
+    {
+        f();
+        return;
+    }
+    using Function = std::remove_reference_t<F>;
+    ExecuteOnNode(node, [](void * context) { (*static_cast<Function *>(context))(); },
+                  const_cast<void *>(static_cast<const void *>(&f)));
+}
+
+} // namespace numa
+} // namespace dune
+
+#endif
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      SessionConfig
+////
+//// Configuration of the ONNX Runtime sessions of the dunereco network wrappers
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/ONNXRuntime/ORTSessionConfig.h"
+
+#include "onnxruntime_cxx_api.h"
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+namespace
+{
+    bool optimizationLevel(const std::string & name, GraphOptimizationLevel & level)
+    {
+        if (name == "disable") { level = GraphOptimizationLevel::ORT_DISABLE_ALL; }
+        else if (name == "basic") { level = GraphOptimizationLevel::ORT_ENABLE_BASIC; }
+        else if (name == "extended") { level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED; }
+        else if (name == "all") { level = GraphOptimizationLevel::ORT_ENABLE_ALL; }
+        else { return false; }
+        return true;
+    }
+}
+
+bool onnxrt::CheckSessionConfig(const SessionConfig & config, std::string & message)
+{
+    GraphOptimizationLevel level;
+    if (!optimizationLevel(config.optimizationLevel, level))
+    {
+        message = "optimisation level must be disable, basic, extended or all, not " + config.optimizationLevel;
+        return false;
+    }
+    if (config.executionProvider != "cpu" && config.executionProvider != "cuda")
+    {
+        message = "execution provider must be cpu or cuda, not " + config.executionProvider;
+        return false;
+    }
+    return true;
+}
+
+std::string onnxrt::ApplySessionConfig(const SessionConfig & config, Ort::SessionOptions & options)
+{
+    GraphOptimizationLevel level = GraphOptimizationLevel::ORT_ENABLE_ALL;
+    optimizationLevel(config.optimizationLevel, level);
+    options.SetGraphOptimizationLevel(level);
+
+    options.SetIntraOpNumThreads(config.intraOpThreads);
+    options.SetInterOpNumThreads(config.interOpThreads);
+    // Independent ops only run concurrently with more than one inter-op thread
+    options.SetExecutionMode(config.interOpThreads == 1 ? ExecutionMode::ORT_SEQUENTIAL : ExecutionMode::ORT_PARALLEL);
+
+    if (config.executionProvider == "cuda")
+    {
+        try
+        {
+            OrtCUDAProviderOptions cuda;
+            cuda.device_id = config.deviceId;
+            options.AppendExecutionProvider_CUDA(cuda);
+            return "cuda";
+        }
+        catch (const Ort::Exception & e)
+        {
+            mf::LogWarning("ApplySessionConfig") << "No CUDA execution provider, " << e.what()
+                                                 << ", using the CPU";
+        }
+    }
+    return "cpu";
+}
+
+std::string onnxrt::SessionKey(const SessionConfig & config)
+{
+    return "|" + config.optimizationLevel + "|" + std::to_string(config.intraOpThreads) + "|"
+        + std::to_string(config.interOpThreads) + "|" + config.executionProvider + ":" + std::to_string(config.deviceId);
+}
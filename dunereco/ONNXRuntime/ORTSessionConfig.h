@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      SessionConfig
+////
+//// Configuration of the ONNX Runtime sessions of the dunereco network
+//// wrappers: graph optimisation, threading and execution provider. The
+//// defaults keep one core per session so production jobs don't eat batch
+//// farms, as for the Tensorflow sessions.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ORT_SESSION_CONFIG_H
+#define ORT_SESSION_CONFIG_H
+
+#include <string>
+
+namespace Ort
+{
+    struct SessionOptions;
+}
+
+namespace onnxrt
+{
+
+struct SessionConfig
+{
+    std::string optimizationLevel = "all"; ///< graph optimisations: "disable", "basic", "extended" or "all"
+    int intraOpThreads = 1;                ///< threads used inside a single op (0 = let ONNX Runtime decide)
+    int interOpThreads = 1;                ///< threads running independent ops in parallel (0 = let ONNX Runtime decide)
+    std::string executionProvider = "cpu"; ///< "cpu" or "cuda"
+    int deviceId = 0;                      ///< "cuda": the GPU to run on
+};
+
+/// Whether the optimisation level and execution provider names are known,
+/// with the reason in message if not
+bool CheckSessionConfig(const SessionConfig & config, std::string & message);
+
+/// Fill the session options. A CUDA provider which is not available in this
+/// ONNX Runtime is reported and the session runs on the CPU. Returns the
+/// execution provider actually used
+std::string ApplySessionConfig(const SessionConfig & config, Ort::SessionOptions & options);
+
+/// Suffix of the registry key, sessions with different configurations are not shared
+std::string SessionKey(const SessionConfig & config);
+
+} // namespace onnxrt
+
+#endif
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SharedSession, SessionRegistry
+////
+//// Job-wide registry of ONNX Runtime sessions shared by the dunereco network wrappers.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/ONNXRuntime/ORTSessionRegistry.h"
+
+#include <chrono>
+
+#include "onnxruntime_cxx_api.h"
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// -------------------------------------------------------------------
+onnxrt::SharedSession::SharedSession(const std::string & path, std::unique_ptr<Ort::Session> session,
+                                     const std::string & provider) :
+    fPath(path),
+    fSession(std::move(session)),
+    fProvider(provider)
+{
+    Ort::AllocatorWithDefaultOptions allocator;
+    for (size_t i = 0; i < fSession->GetInputCount(); ++i)
+    {
+        fInputNames.emplace_back(fSession->GetInputNameAllocated(i, allocator).get());
+    }
+    for (size_t i = 0; i < fSession->GetOutputCount(); ++i)
+    {
+        fOutputNames.emplace_back(fSession->GetOutputNameAllocated(i, allocator).get());
+    }
+}
+
+onnxrt::SharedSession::~SharedSession()
+{
+    if (fNCalls > 0)
+    {
+        mf::LogInfo("SharedSession") << fPath << ": " << fNCalls << " calls, "
+                                     << fTotalTime << " s, " << 1000. * fTotalTime / fNCalls << " ms/call";
+    }
+}
+
+std::vector<onnxrt::Output> onnxrt::SharedSession::Run(const std::vector<Input> & inputs) const
+{
+    // The inputs are wrapped, not copied
+    const Ort::MemoryInfo memory = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::vector<Ort::Value> inputValues;
+    std::vector<const char*> inputNames;
+    for (auto const & input : inputs)
+    {
+        size_t size = 1;
+        for (const int64_t dim : input.shape) { size *= dim; }
+        inputValues.push_back(Ort::Value::CreateTensor<float>(memory, const_cast<float*>(input.data), size,
+                                                              input.shape.data(), input.shape.size()));
+        inputNames.push_back(input.name.c_str());
+    }
+    std::vector<const char*> outputNames;
+    for (auto const & name : fOutputNames) { outputNames.push_back(name.c_str()); }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Ort::Value> outputValues = fSession->Run(Ort::RunOptions{nullptr}, inputNames.data(), inputValues.data(),
+                                                         inputValues.size(), outputNames.data(), outputNames.size());
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    {
+        std::lock_guard<std::mutex> lock(fStatsMutex);
+        ++fNCalls;
+        fTotalTime += elapsed.count();
+    }
+
+    std::vector<Output> outputs(outputValues.size());
+    for (size_t o = 0; o < outputValues.size(); ++o)
+    {
+        const Ort::TensorTypeAndShapeInfo info = outputValues[o].GetTensorTypeAndShapeInfo();
+        const float* values = outputValues[o].GetTensorData<float>();
+        outputs[o].name = fOutputNames[o];
+        outputs[o].shape = info.GetShape();
+        outputs[o].values.assign(values, values + info.GetElementCount());
+    }
+    return outputs;
+}
+
+unsigned long onnxrt::SharedSession::NCalls() const
+{
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    return fNCalls;
+}
+
+double onnxrt::SharedSession::TotalTime() const
+{
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    return fTotalTime;
+}
+
+// -------------------------------------------------------------------
+onnxrt::SessionRegistry::SessionRegistry() :
+    fEnv(std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "dunereco"))
+{
+}
+
+onnxrt::SessionRegistry::~SessionRegistry() = default;
+
+onnxrt::SessionRegistry & onnxrt::SessionRegistry::Instance()
+{
+    static SessionRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<onnxrt::SharedSession> onnxrt::SessionRegistry::Get(const std::string & path, const SessionConfig & config)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    const std::string key = path + SessionKey(config);
+    std::shared_ptr<SharedSession> shared = fSessions[key].lock();
+    if (shared) { return shared; }
+
+    std::string message;
+    if (!CheckSessionConfig(config, message))
+    {
+        mf::LogError("SessionRegistry") << message;
+        return nullptr;
+    }
+
+    std::unique_ptr<Ort::Session> session;
+    std::string provider;
+    try
+    {
+        Ort::SessionOptions options;
+        provider = ApplySessionConfig(config, options);
+        session = std::make_unique<Ort::Session>(*fEnv, path.c_str(), options);
+    }
+    catch (const Ort::Exception & e)
+    {
+        mf::LogError("SessionRegistry") << "Failed to load " << path << ", " << e.what();
+        return nullptr;
+    }
+
+    shared = std::make_shared<SharedSession>(path, std::move(session), provider);
+    fSessions[key] = shared;
+    return shared;
+}
+// -------------------------------------------------------------------
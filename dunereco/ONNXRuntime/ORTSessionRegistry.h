@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SharedSession, SessionRegistry
+////
+//// Job-wide registry of ONNX Runtime sessions shared by the dunereco network
+//// wrappers. A .onnx model file is loaded once per job for each session
+//// configuration; every wrapper asking for the same gets the same session.
+//// All session calls go through SharedSession::Run, which keeps the timing
+//// statistics printed when the session is released.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ORT_SESSION_REGISTRY_H
+#define ORT_SESSION_REGISTRY_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dunereco/ONNXRuntime/ORTSessionConfig.h"
+
+namespace Ort
+{
+    struct Env;
+    struct Session;
+}
+
+namespace onnxrt
+{
+
+/// A float input of the network, in row-major order. The data is only read
+/// during the call and must stay alive until Run returns
+struct Input
+{
+    std::string name;
+    std::vector<int64_t> shape;
+    const float* data;
+};
+
+/// A float output of the network, in row-major order
+struct Output
+{
+    std::string name;
+    std::vector<int64_t> shape;
+    std::vector<float> values;
+};
+
+class SharedSession
+{
+public:
+    SharedSession(const std::string & path, std::unique_ptr<Ort::Session> session, const std::string & provider);
+    ~SharedSession();
+
+    SharedSession(const SharedSession&) = delete;
+    SharedSession& operator=(const SharedSession&) = delete;
+
+    /// Run the session on the inputs and return all outputs, in the order of
+    /// OutputNames. Can be called from several threads at once
+    std::vector<Output> Run(const std::vector<Input> & inputs) const;
+
+    const std::string & Path() const { return fPath; }
+    /// Execution provider the session runs on, "cpu" or "cuda"
+    const std::string & Provider() const { return fProvider; }
+
+    /// Input and output names of the model, in model order
+    const std::vector<std::string> & InputNames() const { return fInputNames; }
+    const std::vector<std::string> & OutputNames() const { return fOutputNames; }
+
+    unsigned long NCalls() const;
+    double TotalTime() const; ///< seconds spent inside Session::Run
+
+private:
+    std::string fPath;
+    std::unique_ptr<Ort::Session> fSession;
+    std::string fProvider;
+    std::vector<std::string> fInputNames;
+    std::vector<std::string> fOutputNames;
+
+    mutable std::mutex fStatsMutex;
+    mutable unsigned long fNCalls = 0;
+    mutable double fTotalTime = 0.;
+};
+
+class SessionRegistry
+{
+public:
+    static SessionRegistry & Instance();
+
+    /// Session for a .onnx file, loaded on first request for each
+    /// configuration. Returns nullptr on failure.
+    std::shared_ptr<SharedSession> Get(const std::string & path, const SessionConfig & config = SessionConfig());
+
+private:
+    SessionRegistry();
+    ~SessionRegistry();
+
+    std::mutex fMutex;
+    std::unique_ptr<Ort::Env> fEnv; ///< One environment, and logger, for all sessions of the process
+    std::map< std::string, std::weak_ptr<SharedSession> > fSessions;
+};
+
+} // namespace onnxrt
+
+#endif
@@ -26,6 +26,7 @@
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileDirectory.h"
 #include "art_root_io/TFileService.h"
+#include "canvas/Persistency/Common/Assns.h"
 #include "canvas/Persistency/Common/FindMany.h"
 #include "canvas/Persistency/Common/Ptr.h"
 #include "canvas/Persistency/Common/FindManyP.h"
@@ -143,9 +144,16 @@ private:
                              ///< producer.
   std::vector<recob::Hit> hits_U, hits_V, hits_Z;
   bool has_sp_vertex;
+  std::vector<art::Ptr<recob::SpacePoint>>
+      hit_sp; ///< First space point of each hit, null if it has none.
+  std::vector<Double_t> sp_z_amplitude; ///< Peak amplitude of the collection
+                                        ///< hit of each space point.
 
   // operation flags
   bool fCollectTracks;
+  // output tree tuning, 0 keeps the ROOT defaults
+  Int_t fTreeBasketSize;
+  Long64_t fTreeAutoFlush;
   // art module labels
   std::string fGeneratorLabel;
   std::string fSimulationLabel;
@@ -227,17 +235,38 @@ private:
   void calculate_electron_direction();
 
   /**
-   * @brief Determine if a hit should be included in the energy sum.
+   * @brief Resolve the hit-spacepoint associations of the event in a single
+   * pass, filling hit_sp and sp_z_amplitude.
+   * @param event art event.
+   * @param hit_handle  hits the hit_sp entries refer to.
+   * @param sp_handle   spacepoints the sp_z_amplitude entries refer to.
+   */
+  void resolve_associations(
+      art::Event const &event,
+      art::ValidHandle<std::vector<recob::Hit>> const &hit_handle,
+      art::ValidHandle<std::vector<recob::SpacePoint>> const &sp_handle);
+
+  /**
+   * @brief Locate all collection plane hits for the distance cuts.
    * If there are 3D reco information (SpacePoints) associated with the hit,
    * use that as the track location. If there are no spacepoints, carry out a
    * 2D reconstruction using drift time and the center of the wire segment.
+   * The services are looked up once for the whole hit list.
    * @param event art event.
-   * @param hit   hit currently working on.
-   * @param spacepoints   spacepoints associated with the hit.
+   * @param hit_list  hits of the event, in the order of hit_sp.
+   * @param positions filled with the location of each collection plane hit.
+   */
+  void locate_hits(art::Event const &event,
+                   std::vector<art::Ptr<recob::Hit>> const &hit_list,
+                   std::vector<XYZVector> &positions);
+
+  /**
+   * @brief Determine if a hit should be included in the energy sum.
+   * @param pos     location of the hit, from locate_hits.
+   * @param has_sp  whether the location comes from a spacepoint.
    * @return Bool_t True if should be cut, false if shoudl be included.
    */
-  Bool_t distance_cut(art::Event const &event, recob::Hit const &hit,
-                      std::vector<art::Ptr<recob::SpacePoint>> spacepoints);
+  Bool_t distance_cut(XYZVector const &pos, bool has_sp) const;
 
   /**
    * @brief Determine the vertex of the SN event using reconstructed
@@ -249,8 +278,8 @@ private:
    */
   XYZVector find_vertex_sp(art::Event const &event);
   /* Function to write hit as a distance of truth distance. */
-  void write_multi_distance(art::Event const &, recob::Hit const &,
-                            std::vector<art::Ptr<recob::SpacePoint>>);
+  void write_multi_distance(recob::Hit const &, XYZVector const &pos,
+                            bool has_sp);
 
 }; // class PointResTree
 
@@ -282,6 +311,8 @@ void dune::PointResTree::reconfigure(fhicl::ParameterSet const &parameterSet) {
   fCollectTracks = parameterSet.get<bool>("CollectTracks");
   fSpacePointModuleLabel =
       parameterSet.get<std::string>("SpacePointModuleLabel");
+  fTreeBasketSize = parameterSet.get<Int_t>("TreeBasketSize", 0);
+  fTreeAutoFlush = parameterSet.get<Long64_t>("TreeAutoFlush", 0);
 }
 
 void dune::PointResTree::beginJob() {
@@ -341,6 +372,13 @@ void dune::PointResTree::beginJob() {
   tr->Branch("trk_end_dir_y", &trk_end_dir_y);
   tr->Branch("trk_end_dir_z", &trk_end_dir_z);
 
+  // Larger baskets and flushes make fewer, better compressed writes on
+  // long campaigns; a negative auto flush is a size in bytes.
+  if (fTreeBasketSize > 0)
+    tr->SetBasketSize("*", fTreeBasketSize);
+  if (fTreeAutoFlush != 0)
+    tr->SetAutoFlush(fTreeAutoFlush);
+
 } // beginJob()
 
 void dune::PointResTree::endJob() {
@@ -376,6 +414,14 @@ void dune::PointResTree::analyze(art::Event const &event) {
   // if (fSimulationLabel == "marley") writeMCTruths_marley(event);
   // if (fSimulationLabel == "largeant") writeMCTruths_largeant(event);
 
+  // resolve the hit-spacepoint associations once for the vertex finding and
+  // the hit loop below
+  auto hit_handle =
+      event.getValidHandle<std::vector<recob::Hit>>(fHitsModuleLabel);
+  auto sp_handle = event.getValidHandle<std::vector<recob::SpacePoint>>(
+      fSpacePointModuleLabel);
+  resolve_associations(event, hit_handle, sp_handle);
+
   // use spacepoint info to reconstruct an approximate vertex. This vertex is
   // then used to find correct tracks by scanning tracks close to it.
   auto sp_vertex = find_vertex_sp(event);
@@ -485,16 +531,10 @@ void dune::PointResTree::analyze(art::Event const &event) {
   // get hit info
   if (DEBUG_MSG)
     std::cout << "Getting Hits..." << std::endl;
-  auto hit_handle =
-      event.getValidHandle<std::vector<recob::Hit>>(fHitsModuleLabel);
   std::vector<art::Ptr<recob::Hit>> hit_list;
   art::fill_ptr_vector(hit_list, hit_handle);
-  auto const detectorPropertiesData =
-      art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(
-          event);
-  art::ServiceHandle<cheat::BackTrackerService> bt;
-  auto hit_to_sp = art::FindManyP<recob::SpacePoint>(hit_handle, event,
-                                                     fHitToSpacePointLabel);
+  std::vector<XYZVector> hit_positions;
+  locate_hits(event, hit_list, hit_positions);
   float NHits_Z = 0;
   NHits = hit_list.size();
   double uncut_charge = 0;
@@ -510,10 +550,10 @@ void dune::PointResTree::analyze(art::Event const &event) {
       uncut_charge += hit->Integral();
     // for collection plane, apply distance cut
     if (hit->View() == geo::kZ) {
-      auto spacepoints = hit_to_sp.at(i);
+      bool has_sp = hit_sp.at(i).isNonnull();
       NHits_Z++;
-      write_multi_distance(event, *hit, spacepoints);
-      if (distance_cut(event, *hit, spacepoints)) {
+      write_multi_distance(*hit, hit_positions.at(i), has_sp);
+      if (distance_cut(hit_positions.at(i), has_sp)) {
         continue;
       } else
         charge_Z += hit->Integral();
@@ -755,34 +795,66 @@ void dune::PointResTree::calculate_electron_direction() {
   }
 }
 
-Bool_t dune::PointResTree::distance_cut(
-    art::Event const &event, recob::Hit const &hit,
-    std::vector<art::Ptr<recob::SpacePoint>> spacepoints) {
+void dune::PointResTree::resolve_associations(
+    art::Event const &event,
+    art::ValidHandle<std::vector<recob::Hit>> const &hit_handle,
+    art::ValidHandle<std::vector<recob::SpacePoint>> const &sp_handle) {
+  hit_sp.assign(hit_handle->size(), art::Ptr<recob::SpacePoint>());
+  sp_z_amplitude.assign(sp_handle->size(), 0.);
+  // one pass over the association in its stored order, so the first
+  // spacepoint of a hit and the last collection hit of a spacepoint are the
+  // same ones FindManyP would give
+  auto const &hit_sp_assns =
+      *event.getValidHandle<art::Assns<recob::SpacePoint, recob::Hit>>(
+          fHitToSpacePointLabel);
+  for (auto const &assn : hit_sp_assns) {
+    art::Ptr<recob::SpacePoint> const &sp = assn.first;
+    art::Ptr<recob::Hit> const &hit = assn.second;
+    if (hit.id() == hit_handle.id() && hit_sp.at(hit.key()).isNull())
+      hit_sp.at(hit.key()) = sp;
+    if (sp.id() == sp_handle.id() && hit->View() == geo::kZ)
+      sp_z_amplitude.at(sp.key()) = hit->PeakAmplitude();
+  }
+}
+
+void dune::PointResTree::locate_hits(
+    art::Event const &event, std::vector<art::Ptr<recob::Hit>> const &hit_list,
+    std::vector<XYZVector> &positions) {
+  positions.assign(hit_list.size(), XYZVector());
   if (primary_trk_id < 0)
-    return kFALSE;           // don't cut anything if there are no tracks
-  double dist_th = 14.0 * 5; // 14 is radiation length
-  Double_t distance = 0;
-  // art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
-  // auto const& clockData = art::ServiceHandle<detinfo::DetectorClocksService
-  // const>()->DataFor(event); art::ServiceHandle<cheat::BackTrackerService>
-  // bt;
-
-  if (spacepoints.size()) {
-    // average of all spacepoint recos
-    auto spacepoint = spacepoints.at(0);
-    auto pos = XYZVector(spacepoint->XYZ());
-    distance += (pos - reco_e_position).Mag();
-  } else { // no spacepoint found, do 2D reconstruction (X, Z)
-    geo::GeometryCore const &geom = *(lar::providerFrom<geo::Geometry>());
-    auto const detProperties =
-        art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(
-            event);
+    return; // no distance cuts without tracks
+  geo::GeometryCore const &geom = *(lar::providerFrom<geo::Geometry>());
+  auto const detProperties =
+      art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(event);
+  for (size_t i = 0; i < hit_list.size(); i++) {
+    recob::Hit const &hit = *hit_list.at(i);
+    if (hit.View() != geo::kZ)
+      continue;
+    if (hit_sp.at(i).isNonnull()) {
+      positions.at(i) = XYZVector(hit_sp.at(i)->XYZ());
+      continue;
+    }
+    // no spacepoint found, do 2D reconstruction (X, Z)
     auto wireID = hit.WireID();
     auto plane = geom.Plane(wireID);
     auto pos = plane.Wire(wireID).GetCenter();
     plane.DriftPoint(pos,
                      -abs(detProperties.ConvertTicksToX(
                          hit.PeakTime(), wireID))); // drift away from plane
+    positions.at(i).SetXYZ(pos.X(), pos.Y(), pos.Z());
+  }
+}
+
+Bool_t dune::PointResTree::distance_cut(XYZVector const &pos,
+                                        bool has_sp) const {
+  if (primary_trk_id < 0)
+    return kFALSE;           // don't cut anything if there are no tracks
+  double dist_th = 14.0 * 5; // 14 is radiation length
+  Double_t distance = 0;
+
+  if (has_sp) {
+    distance = (pos - reco_e_position).Mag();
+  } else { // 2D reconstruction, only (X, Z) are meaningful
     distance = std::pow(pos.X() - reco_e_position.X(), 2) +
                std::pow(pos.Z() - reco_e_position.Z(), 2);
     distance = sqrt(distance);
@@ -791,33 +863,16 @@ Bool_t dune::PointResTree::distance_cut(
   return (distance > dist_th);
 }
 
-void dune::PointResTree::write_multi_distance(
-    art::Event const &event, recob::Hit const &hit,
-    std::vector<art::Ptr<recob::SpacePoint>> spacepoints) {
+void dune::PointResTree::write_multi_distance(recob::Hit const &hit,
+                                              XYZVector const &pos,
+                                              bool has_sp) {
   if (primary_trk_id < 0)
     return; // don't cut anything if there are no tracks
   Double_t distance = 0;
-  // art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
-  // auto const& clockData = art::ServiceHandle<detinfo::DetectorClocksService
-  // const>()->DataFor(event); art::ServiceHandle<cheat::BackTrackerService>
-  // bt;
-
-  if (spacepoints.size()) {
-    // average of all spacepoint recos
-    auto spacepoint = spacepoints.at(0);
-    auto pos = XYZVector(spacepoint->XYZ());
-    distance += (pos - reco_e_position).Mag();
-  } else { // no spacepoint found, do 2D reconstruction (X, Z)
-    geo::GeometryCore const &geom = *(lar::providerFrom<geo::Geometry>());
-    auto const detProperties =
-        art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataFor(
-            event);
-    auto wireID = hit.WireID();
-    auto plane = geom.Plane(wireID);
-    auto pos = plane.Wire(wireID).GetCenter();
-    plane.DriftPoint(pos,
-                     -abs(detProperties.ConvertTicksToX(
-                         hit.PeakTime(), wireID))); // drift away from plane
+
+  if (has_sp) {
+    distance = (pos - reco_e_position).Mag();
+  } else { // 2D reconstruction, only (X, Z) are meaningful
     distance = std::pow(pos.X() - truth_e_position.X(), 2) +
                std::pow(pos.Z() - truth_e_position.Z(), 2);
     distance = sqrt(distance);
@@ -834,8 +889,6 @@ void dune::PointResTree::write_multi_distance(
 XYZVector dune::PointResTree::find_vertex_sp(art::Event const &event) {
   auto sp_handle = event.getValidHandle<std::vector<recob::SpacePoint>>(
       fSpacePointModuleLabel);
-  auto sp_to_hit =
-      art::FindManyP<recob::Hit>(sp_handle, event, fHitToSpacePointLabel);
   int N_spacepoint = sp_handle->size();
   // Using a priority queue to get the top k nmber of spacepoints. Runtime is
   // O(NlogK)
@@ -845,14 +898,7 @@ XYZVector dune::PointResTree::find_vertex_sp(art::Event const &event) {
       sp_brightness_queue;
   size_t queue_size = 10; // number of spacepoints to keep
   for (int i = 0; i < N_spacepoint; i++) {
-    auto hits = sp_to_hit.at(i);
-    double avg_amplitude = 0;
-    for (auto hit : hits) {
-      // avg_amplitude += hit->PeakAmplitude();
-      if (hit->View() == geo::kZ)
-        avg_amplitude = hit->PeakAmplitude();
-    }
-    // avg_amplitude /= hits.size();
+    double avg_amplitude = sp_z_amplitude.at(i);
     if (sp_brightness_queue.size() < queue_size) {
       sp_brightness_queue.push(AVGAMP_SP(avg_amplitude, sp_handle->at(i)));
     } else if (sp_brightness_queue.top().first < avg_amplitude) {
@@ -0,0 +1,206 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    duneKernelBenchmark.cc
+/// \brief   Times the CVN image and hit line fit kernels outside art
+////////////////////////////////////////////////////////////////////////
+
+// Each iteration, counted as one event, fills a pixel map with PixelMap::Add,
+// converts it with CVNImageUtils and fits a line through a set of hits with
+// HitLineFitAlg::FitLine. The hits come from a fixed seed, so every release
+// times the same work. The kernels are timed with the steady_clock timers of
+// the ProfRegistry, the ones they have inside and one around the PixelMap::Add
+// loop, and the summary is written as the JSON of the ProfilingReport service,
+// so two summaries can be compared with compare_profiles.py:
+//
+//     duneKernelBenchmark -o reference.json
+//     duneKernelBenchmark -o current.json
+//     compare_profiles.py reference.json current.json --threshold 0.1
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "dunereco/CVN/func/Boundary.h"
+#include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/HitFinderDUNE/HitLineFitAlg.h"
+#include "dunereco/Profiling/ProfScope.h"
+
+// Boost, for program options
+#include "boost/program_options/options_description.hpp"
+#include "boost/program_options/variables_map.hpp"
+#include "boost/program_options/parsers.hpp"
+
+namespace po = boost::program_options;
+
+struct BenchmarkConfig
+{
+  unsigned int iterations;
+  unsigned int mapWires;
+  unsigned int mapTDCs;
+  unsigned int imageSize;
+  unsigned int hits;
+  unsigned int fitPoints;
+  unsigned int seed;
+  std::string output;
+};
+
+po::variables_map getOptions(int argc, char* argv[], BenchmarkConfig& config)
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+  ("help", "produce help message")
+  ("iterations,n", po::value<unsigned int>(&config.iterations)->default_value(50),
+    "iterations, each one counted as an event of the summary")
+  ("map-wires", po::value<unsigned int>(&config.mapWires)->default_value(2880),
+    "wires of the pixel map")
+  ("map-tdcs", po::value<unsigned int>(&config.mapTDCs)->default_value(500),
+    "tdcs of the pixel map")
+  ("image-size", po::value<unsigned int>(&config.imageSize)->default_value(500),
+    "wires and tdcs of the CVN image")
+  ("hits", po::value<unsigned int>(&config.hits)->default_value(20000),
+    "hits added to the pixel map in each iteration")
+  ("fit-points", po::value<unsigned int>(&config.fitPoints)->default_value(500),
+    "hits of the line fit in each iteration")
+  ("seed", po::value<unsigned int>(&config.seed)->default_value(12345),
+    "seed of the generated hits")
+  ("output,o", po::value<std::string>(&config.output)->default_value("dune_kernel_benchmark.json"),
+    "summary to write");
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << "Usage: duneKernelBenchmark -n 50 -o current.json\n" << desc << "\n";
+      exit(1);
+    }
+    po::notify(vm);
+  }
+  catch(po::error& e)
+  {
+    std::cerr << "ERROR: " << e.what() << "\n" << desc << "\n";
+    exit(1);
+  }
+  return vm;
+}
+
+// Hits spread over the three views of the map
+struct MapHits
+{
+  std::vector<unsigned int> wires;
+  std::vector<double> tdcs;
+  std::vector<unsigned int> views;
+  std::vector<double> pes;
+};
+
+MapHits makeMapHits(const BenchmarkConfig& config, std::mt19937& rng)
+{
+  std::uniform_int_distribution<unsigned int> wire(0, config.mapWires - 1);
+  std::uniform_real_distribution<double> tdc(0., config.mapTDCs);
+  std::uniform_int_distribution<unsigned int> view(0, 2);
+  std::exponential_distribution<double> pe(1. / 200.);
+
+  MapHits hits;
+  for(unsigned int i = 0; i < config.hits; ++i){
+    hits.wires.push_back(wire(rng));
+    hits.tdcs.push_back(tdc(rng));
+    hits.views.push_back(view(rng));
+    hits.pes.push_back(pe(rng));
+  }
+  return hits;
+}
+
+// Points along a parabola with a fifth of them scattered as outliers
+std::vector<dune::HitLineFitAlg::HitLineFitData> makeFitPoints(const BenchmarkConfig& config, std::mt19937& rng)
+{
+  std::uniform_real_distribution<double> horiz(0., 200.);
+  std::uniform_real_distribution<double> outlier(-50., 250.);
+  std::uniform_real_distribution<double> chance(0., 1.);
+  std::normal_distribution<double> noise(0., 0.5);
+
+  std::vector<dune::HitLineFitAlg::HitLineFitData> points;
+  for(unsigned int i = 0; i < config.fitPoints; ++i){
+    dune::HitLineFitAlg::HitLineFitData point;
+    point.hitHoriz = horiz(rng);
+    point.hitVert = chance(rng) < 0.2 ? outlier(rng) : 10. + 0.5 * point.hitHoriz + 0.002 * point.hitHoriz * point.hitHoriz + noise(rng);
+    point.hitHorizErrLo = point.hitHorizErrHi = 0.5;
+    point.hitVertErrLo = point.hitVertErrHi = 0.5;
+    point.hitREAL = true;
+    points.push_back(point);
+  }
+  return points;
+}
+
+int main(int argc, char* argv[])
+{
+  BenchmarkConfig config;
+  getOptions(argc, argv, config);
+
+  // The settings of dune35t_hitlinefitalg, without the per iteration printout
+  fhicl::ParameterSet fitPSet;
+  fitPSet.put("MinStartPoints", 3);
+  fitPSet.put("MinAlsoPoints", 6);
+  fitPSet.put("IterationsMultiplier", 20.f);
+  fitPSet.put("InclusionThreshold", 2.f);
+  fitPSet.put("LogLevel", 0);
+  dune::HitLineFitAlg fitAlg(fitPSet);
+  for(int ipar = 0; ipar <= 2; ++ipar) fitAlg.SetParameter(ipar, 0., 0., 0.);
+  fitAlg.SetSeed(config.seed);
+
+  cvn::CVNImageUtils imageUtils(config.imageSize, config.imageSize, 3);
+  imageUtils.SetViewReversal(false, true, false);
+  imageUtils.SetPixelMapSize(config.mapWires, config.mapTDCs);
+  // Both conversions write into buffers the caller sizes
+  std::vector<unsigned char> pixelArray(config.imageSize * config.imageSize * 3);
+  std::vector<float> buffer(config.imageSize * config.imageSize * 3);
+
+  const cvn::Boundary bound(config.mapWires, config.mapTDCs / 2., 0, 0, 0,
+                            config.mapTDCs / 2., config.mapTDCs / 2., config.mapTDCs / 2.);
+  std::mt19937 rng(config.seed);
+
+  dune::prof::ProfRegistry::SetEnabled(true);
+  std::uint64_t maxRSS(0), sumRSS(0);
+  for(unsigned int iter = 0; iter < config.iterations; ++iter){
+    const MapHits hits = makeMapHits(config, rng);
+    std::vector<dune::HitLineFitAlg::HitLineFitData> points = makeFitPoints(config, rng);
+
+    cvn::PixelMap pm(config.mapWires, config.mapTDCs, bound, false);
+    {
+      DUNE_PROF_SCOPE("bench::PixelMap::Add");
+      DUNE_PROF_COUNT("bench::PixelMap::Add hits", hits.wires.size());
+      for(size_t i = 0; i < hits.wires.size(); ++i) pm.Add(hits.wires[i], hits.tdcs[i], hits.views[i], hits.pes[i]);
+    }
+    imageUtils.ConvertPixelMapToPixelArray(pm, pixelArray);
+    imageUtils.ConvertPixelMapToBuffer(pm, buffer.data());
+    dune::HitLineFitAlg::HitLineFitResults fit;
+    fitAlg.FitLine(points, fit);
+
+    const std::uint64_t rss(dune::prof::ProfRegistry::CurrentRSS());
+    maxRSS = std::max(maxRSS, rss);
+    sumRSS += rss;
+  }
+  dune::prof::ProfRegistry::SetEnabled(false);
+
+  // The layout of the ProfilingReport summary
+  std::ofstream out(config.output);
+  if(!out){
+    std::cerr << "ERROR: could not open " << config.output << "\n";
+    return 1;
+  }
+  const double toMB(1. / (1024. * 1024.));
+  out << "{\n  \"events\": " << config.iterations << ",\n"
+      << "  \"memory\": {\"peak_rss_mb\": " << dune::prof::ProfRegistry::PeakRSS() * toMB
+      << ", \"max_event_rss_mb\": " << maxRSS * toMB
+      << ", \"mean_event_rss_mb\": " << (config.iterations > 0 ? sumRSS * toMB / config.iterations : 0.) << "},\n";
+  dune::prof::ProfRegistry::Instance().WriteJSON(out, config.iterations);
+  out << "\n}\n";
+
+  dune::prof::ProfRegistry::Instance().WriteTable(std::cout, config.iterations);
+  return 0;
+}
@@ -0,0 +1,283 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       ProfRegistry
+////
+//// Process wide table of the named timers and counters
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/Profiling/ProfRegistry.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef DUNERECO_WITH_ITT
+#include <ittnotify.h>
+#endif
+#ifdef DUNERECO_WITH_NVTX
+#include <nvtx3/nvToolsExt.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+
+void WriteJSONString(std::ostream &os, const std::string &str)
+{
+    os << '"';
+    for (const char c : str)
+    {
+        if (c == '"' || c == '\\')
+            os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+#ifdef DUNERECO_WITH_ITT
+__itt_domain *IttDomain()
+{
+    static __itt_domain *const domain(__itt_domain_create("dunereco"));
+    return domain;
+}
+#endif
+
+#ifdef DUNERECO_WITH_NVTX
+nvtxDomainHandle_t NvtxDomain()
+{
+    static const nvtxDomainHandle_t domain(nvtxDomainCreateA("dunereco"));
+    return domain;
+}
+
+nvtxEventAttributes_t NvtxAttributes(void *const name)
+{
+    nvtxEventAttributes_t attributes = {};
+    attributes.version = NVTX_VERSION;
+    attributes.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+    attributes.messageType = NVTX_MESSAGE_TYPE_REGISTERED;
+    attributes.message.registered = static_cast<nvtxStringHandle_t>(name);
+    return attributes;
+}
+#endif
+
+} // namespace
+
+namespace dune
+{
+namespace prof
+{
+
+std::atomic<unsigned int> ProfRegistry::fMode{0};
+
+void TimerStats::Add(const std::uint64_t ns)
+{
+    fCalls.fetch_add(1, std::memory_order_relaxed);
+    fTotalNs.fetch_add(ns, std::memory_order_relaxed);
+
+    std::uint64_t maxNs(fMaxNs.load(std::memory_order_relaxed));
+    while (ns > maxNs && !fMaxNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed))
+        ;
+}
+
+ProfRegistry &ProfRegistry::Instance()
+{
+    static ProfRegistry registry;
+    return registry;
+}
+
+TimerStats &ProfRegistry::Timer(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto iter(fTimerIndex.find(name));
+    if (iter == fTimerIndex.end())
+    {
+        fTimers.emplace_back(name);
+        MakeHandles(fTimers.back());
+        iter = fTimerIndex.emplace(name, &fTimers.back()).first;
+    }
+    return *iter->second;
+}
+
+CounterStats &ProfRegistry::Counter(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto iter(fCounterIndex.find(name));
+    if (iter == fCounterIndex.end())
+    {
+        fCounters.emplace_back(name);
+        MakeHandles(fCounters.back());
+        iter = fCounterIndex.emplace(name, &fCounters.back()).first;
+    }
+    return *iter->second;
+}
+
+bool ProfRegistry::SetAnnotating(const bool annotating)
+{
+#if defined(DUNERECO_WITH_ITT) || defined(DUNERECO_WITH_NVTX)
+    SetMode(kAnnotate, annotating);
+    return true;
+#else
+    SetMode(kAnnotate, false);
+    return !annotating;
+#endif
+}
+
+void ProfRegistry::MakeHandles([[maybe_unused]] TimerStats &stats)
+{
+#ifdef DUNERECO_WITH_ITT
+    stats.fItt = __itt_string_handle_create(stats.fName.c_str());
+#endif
+#ifdef DUNERECO_WITH_NVTX
+    stats.fNvtx = nvtxDomainRegisterStringA(NvtxDomain(), stats.fName.c_str());
+#endif
+}
+
+void ProfRegistry::MakeHandles([[maybe_unused]] CounterStats &stats)
+{
+#ifdef DUNERECO_WITH_ITT
+    stats.fItt = __itt_counter_create_typed(stats.fName.c_str(), "dunereco", __itt_metadata_u64);
+#endif
+#ifdef DUNERECO_WITH_NVTX
+    stats.fNvtx = nvtxDomainRegisterStringA(NvtxDomain(), stats.fName.c_str());
+#endif
+}
+
+void ProfRegistry::BeginRange([[maybe_unused]] const TimerStats &stats)
+{
+#ifdef DUNERECO_WITH_ITT
+    __itt_task_begin(IttDomain(), __itt_null, __itt_null, static_cast<__itt_string_handle *>(stats.fItt));
+#endif
+#ifdef DUNERECO_WITH_NVTX
+    const nvtxEventAttributes_t attributes(NvtxAttributes(stats.fNvtx));
+    nvtxDomainRangePushEx(NvtxDomain(), &attributes);
+#endif
+}
+
+void ProfRegistry::EndRange([[maybe_unused]] const TimerStats &stats)
+{
+#ifdef DUNERECO_WITH_ITT
+    __itt_task_end(IttDomain());
+#endif
+#ifdef DUNERECO_WITH_NVTX
+    nvtxDomainRangePop(NvtxDomain());
+#endif
+}
+
+void ProfRegistry::Annotate([[maybe_unused]] const CounterStats &stats, [[maybe_unused]] const std::uint64_t value)
+{
+#ifdef DUNERECO_WITH_ITT
+    std::uint64_t sample(value);
+    __itt_counter_set_value(static_cast<__itt_counter>(stats.fItt), &sample);
+#endif
+#ifdef DUNERECO_WITH_NVTX
+    // NVTX has no counters, the values are marks with the count as payload
+    nvtxEventAttributes_t attributes(NvtxAttributes(stats.fNvtx));
+    attributes.payloadType = NVTX_PAYLOAD_TYPE_UNSIGNED_INT64;
+    attributes.payload.ullValue = value;
+    nvtxDomainMarkEx(NvtxDomain(), &attributes);
+#endif
+}
+
+void ProfRegistry::WriteJSON(std::ostream &os, const unsigned int nEvents) const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    const double perEvent(nEvents > 0 ? 1. / nEvents : 1.);
+
+    os << "  \"timers\": [";
+    bool first(true);
+    for (const auto &entry : fTimerIndex)
+    {
+        const TimerStats &stats(*entry.second);
+        const std::uint64_t calls(stats.fCalls.load());
+        const double totalMs(stats.fTotalNs.load() * 1.e-6);
+
+        os << (first ? "\n" : ",\n") << "    {\"name\": ";
+        WriteJSONString(os, stats.fName);
+        os << ", \"calls\": " << calls << ", \"total_ms\": " << totalMs << ", \"ms_per_event\": " << totalMs * perEvent
+           << ", \"mean_us\": " << (calls > 0 ? 1.e3 * totalMs / calls : 0.) << ", \"max_us\": " << stats.fMaxNs.load() * 1.e-3 << "}";
+        first = false;
+    }
+    os << (first ? "" : "\n  ") << "],\n";
+
+    os << "  \"counters\": [";
+    first = true;
+    for (const auto &entry : fCounterIndex)
+    {
+        const CounterStats &stats(*entry.second);
+        const std::uint64_t sum(stats.fSum.load());
+
+        os << (first ? "\n" : ",\n") << "    {\"name\": ";
+        WriteJSONString(os, stats.fName);
+        os << ", \"calls\": " << stats.fCalls.load() << ", \"sum\": " << sum << ", \"per_event\": " << sum * perEvent << "}";
+        first = false;
+    }
+    os << (first ? "" : "\n  ") << "]";
+}
+
+void ProfRegistry::WriteTable(std::ostream &os, const unsigned int nEvents) const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    const double perEvent(nEvents > 0 ? 1. / nEvents : 1.);
+
+    std::size_t width(20);
+    for (const auto &entry : fTimerIndex)
+        width = std::max(width, entry.first.size());
+    for (const auto &entry : fCounterIndex)
+        width = std::max(width, entry.first.size());
+
+    os << std::left << std::setw(width) << "timer" << std::right << std::setw(12) << "calls" << std::setw(14) << "total [ms]"
+       << std::setw(14) << "ms/event" << std::setw(14) << "mean [us]" << std::setw(14) << "max [us]" << "\n";
+    for (const auto &entry : fTimerIndex)
+    {
+        const TimerStats &stats(*entry.second);
+        const std::uint64_t calls(stats.fCalls.load());
+        const double totalMs(stats.fTotalNs.load() * 1.e-6);
+
+        os << std::left << std::setw(width) << stats.fName << std::right << std::setw(12) << calls << std::setw(14) << totalMs
+           << std::setw(14) << totalMs * perEvent << std::setw(14) << (calls > 0 ? 1.e3 * totalMs / calls : 0.)
+           << std::setw(14) << stats.fMaxNs.load() * 1.e-3 << "\n";
+    }
+
+    if (fCounterIndex.empty())
+        return;
+
+    os << std::left << std::setw(width) << "counter" << std::right << std::setw(12) << "calls" << std::setw(14) << "sum"
+       << std::setw(14) << "per event" << "\n";
+    for (const auto &entry : fCounterIndex)
+    {
+        const CounterStats &stats(*entry.second);
+        const std::uint64_t sum(stats.fSum.load());
+
+        os << std::left << std::setw(width) << stats.fName << std::right << std::setw(12) << stats.fCalls.load() << std::setw(14) << sum
+           << std::setw(14) << sum * perEvent << "\n";
+    }
+}
+
+std::uint64_t ProfRegistry::CurrentRSS()
+{
+    // The second field of statm is the resident size in pages
+    unsigned long size(0), resident(0);
+    FILE *statm(std::fopen("/proc/self/statm", "r"));
+    if (!statm)
+        return 0;
+    const int nRead(std::fscanf(statm, "%lu %lu", &size, &resident));
+    std::fclose(statm);
+
+    return (nRead == 2) ? static_cast<std::uint64_t>(resident) * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+std::uint64_t ProfRegistry::PeakRSS()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    // Linux reports the peak in kB
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+} // namespace prof
+} // namespace dune
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       ProfRegistry
+////
+//// Process wide table of the named timers and counters filled by the
+//// DUNE_PROF_* macros of ProfScope.h. Entries are made on first use and
+//// never move, so the macros keep a reference to theirs and only touch
+//// atomics afterwards. Nothing is recorded until a ProfilingReport service
+//// (or another owner) enables the registry.
+////
+//// Built with DUNERECO_WITH_ITT or DUNERECO_WITH_NVTX, the timers can also
+//// be sent to VTune or Nsight Systems as named ranges, and the counters as
+//// counter samples or marks, once annotation is switched on. Recording and
+//// annotation are independent, so a profiled job need not pay for both.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PROF_REGISTRY_H
+#define PROF_REGISTRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace dune
+{
+namespace prof
+{
+
+struct TimerStats
+{
+    explicit TimerStats(const std::string &name) : fName(name) {}
+
+    void Add(const std::uint64_t ns);
+
+    const std::string fName;
+    std::atomic<std::uint64_t> fCalls{0};
+    std::atomic<std::uint64_t> fTotalNs{0};
+    std::atomic<std::uint64_t> fMaxNs{0};
+    void *fItt{nullptr};   ///< ITT string handle of the name, when built with ITT
+    void *fNvtx{nullptr};  ///< NVTX registered string of the name, when built with NVTX
+};
+
+struct CounterStats
+{
+    explicit CounterStats(const std::string &name) : fName(name) {}
+
+    void Add(const std::uint64_t value)
+    {
+        fCalls.fetch_add(1, std::memory_order_relaxed);
+        fSum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    const std::string fName;
+    std::atomic<std::uint64_t> fCalls{0};
+    std::atomic<std::uint64_t> fSum{0};
+    void *fItt{nullptr};   ///< ITT counter of the name, when built with ITT
+    void *fNvtx{nullptr};  ///< NVTX registered string of the name, when built with NVTX
+};
+
+class ProfRegistry
+{
+public:
+    static ProfRegistry &Instance();
+
+    /// Get the entry of a name, made on first use
+    TimerStats &Timer(const std::string &name);
+    CounterStats &Counter(const std::string &name);
+
+    /// Bits of Mode()
+    static constexpr unsigned int kRecord = 1;
+    static constexpr unsigned int kAnnotate = 2;
+
+    /// What the macros do now, one load for both
+    static unsigned int Mode() { return fMode.load(std::memory_order_relaxed); }
+    static bool Enabled() { return Mode() & kRecord; }
+    static bool Annotating() { return Mode() & kAnnotate; }
+    static void SetEnabled(const bool enabled) { SetMode(kRecord, enabled); }
+
+    /// Send the timers and counters to the profiler libraries built in, false if there are none
+    static bool SetAnnotating(const bool annotating);
+
+    /// Named range of a timer and sample of a counter for the profilers, only called while annotating
+    static void BeginRange(const TimerStats &stats);
+    static void EndRange(const TimerStats &stats);
+    static void Annotate(const CounterStats &stats, const std::uint64_t value);
+
+    /// Write the timers and counters as the members of a JSON object, averages are per event if nEvents is set
+    void WriteJSON(std::ostream &os, const unsigned int nEvents) const;
+
+    /// Write a plain text table of the timers and counters
+    void WriteTable(std::ostream &os, const unsigned int nEvents) const;
+
+    /// Resident set size of the process now and at its peak, in bytes
+    static std::uint64_t CurrentRSS();
+    static std::uint64_t PeakRSS();
+
+private:
+    ProfRegistry() = default;
+
+    static void SetMode(const unsigned int bit, const bool on)
+    {
+        if (on)
+            fMode.fetch_or(bit, std::memory_order_relaxed);
+        else
+            fMode.fetch_and(~bit, std::memory_order_relaxed);
+    }
+
+    /// Make the profiler handles of a new entry, needs fMutex
+    static void MakeHandles(TimerStats &stats);
+    static void MakeHandles(CounterStats &stats);
+
+    static std::atomic<unsigned int> fMode;
+
+    mutable std::mutex fMutex;
+    std::deque<TimerStats> fTimers;
+    std::deque<CounterStats> fCounters;
+    std::map<std::string, TimerStats*> fTimerIndex;
+    std::map<std::string, CounterStats*> fCounterIndex;
+};
+
+} // namespace prof
+} // namespace dune
+
+#endif
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Macros:      DUNE_PROF_SCOPE, DUNE_PROF_COUNT
+////
+//// DUNE_PROF_SCOPE("name") times the rest of the enclosing scope and
+//// DUNE_PROF_COUNT("name", n) adds n to a counter, both into the
+//// ProfRegistry entry of that name, and to the profiler timeline while
+//// the registry is annotating. A registry doing neither costs one relaxed
+//// load per use. Building with -DDUNERECO_NO_PROFILING removes them.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PROF_SCOPE_H
+#define PROF_SCOPE_H
+
+#ifndef DUNERECO_NO_PROFILING
+
+#include "dunereco/Profiling/ProfRegistry.h"
+
+#include <chrono>
+
+namespace dune
+{
+namespace prof
+{
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(TimerStats &stats) : fStats(nullptr), fRange(nullptr)
+    {
+        const unsigned int mode(ProfRegistry::Mode());
+        if (!mode)
+            return;
+
+        if (mode & ProfRegistry::kAnnotate)
+        {
+            fRange = &stats;
+            ProfRegistry::BeginRange(stats);
+        }
+        if (mode & ProfRegistry::kRecord)
+        {
+            fStats = &stats;
+            fStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (fStats)
+            fStats->Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - fStart).count());
+        if (fRange)
+            ProfRegistry::EndRange(*fRange);
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    TimerStats *fStats;
+    const TimerStats *fRange;
+    std::chrono::steady_clock::time_point fStart;
+};
+
+} // namespace prof
+} // namespace dune
+
+#define DUNE_PROF_CONCAT_IMPL(a, b) a##b
+#define DUNE_PROF_CONCAT(a, b) DUNE_PROF_CONCAT_IMPL(a, b)
+
+#define DUNE_PROF_SCOPE(name)                                                                                               \
+    static dune::prof::TimerStats &DUNE_PROF_CONCAT(duneProfTimerStats, __LINE__)(dune::prof::ProfRegistry::Instance().Timer(name)); \
+    const dune::prof::ScopedTimer DUNE_PROF_CONCAT(duneProfTimer, __LINE__)(DUNE_PROF_CONCAT(duneProfTimerStats, __LINE__))
+
+#define DUNE_PROF_COUNT(name, value)                                                                                        \
+    do                                                                                                                      \
+    {                                                                                                                       \
+        static dune::prof::CounterStats &duneProfCounterStats(dune::prof::ProfRegistry::Instance().Counter(name));         \
+        const unsigned int duneProfMode(dune::prof::ProfRegistry::Mode());                                                 \
+        if (duneProfMode & dune::prof::ProfRegistry::kRecord)                                                               \
+            duneProfCounterStats.Add(value);                                                                                \
+        if (duneProfMode & dune::prof::ProfRegistry::kAnnotate)                                                             \
+            dune::prof::ProfRegistry::Annotate(duneProfCounterStats, value);                                                \
+    } while (false)
+
+#else
+
+#define DUNE_PROF_SCOPE(name) static_cast<void>(0)
+#define DUNE_PROF_COUNT(name, value) static_cast<void>(sizeof(value))
+
+#endif
+
+#endif
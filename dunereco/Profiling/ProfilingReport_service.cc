@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       ProfilingReport
+//// Plugin Type: service
+////
+//// Enables the ProfRegistry for the job, samples the resident memory after
+//// each event and writes the timers, counters and memory as a JSON summary
+//// at the end of the job. It can also switch on the annotation of the
+//// timers and counters for VTune or Nsight Systems, in builds with ITT or
+//// NVTX. See profiling.fcl for the configuration.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "art/Persistency/Provenance/ScheduleContext.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/Profiling/ProfRegistry.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace dune
+{
+
+class ProfilingReport
+{
+public:
+    ProfilingReport(const fhicl::ParameterSet &pset, art::ActivityRegistry &reg);
+
+private:
+    void postProcessEvent(const art::Event &evt, art::ScheduleContext);
+    void postEndJob();
+
+    std::string fOutputFile;
+    bool fPrintSummary;
+    bool fRecord;
+
+    std::atomic<unsigned int> fNEvents{0};
+    std::atomic<std::uint64_t> fSumEventRSS{0};
+    std::atomic<std::uint64_t> fMaxEventRSS{0};
+};
+
+ProfilingReport::ProfilingReport(const fhicl::ParameterSet &pset, art::ActivityRegistry &reg) :
+    fOutputFile(pset.get<std::string>("OutputFile", "dunereco_profile.json")),
+    fPrintSummary(pset.get<bool>("PrintSummary", true)),
+    fRecord(pset.get<bool>("Record", true))
+{
+    prof::ProfRegistry::SetEnabled(fRecord);
+    if (!prof::ProfRegistry::SetAnnotating(pset.get<bool>("Annotate", false)))
+        mf::LogWarning("ProfilingReport") << "Annotate needs a dunereco built with ITT_DIR or NVTX_DIR set, no ranges are emitted";
+
+    reg.sPostProcessEvent.watch(this, &ProfilingReport::postProcessEvent);
+    reg.sPostEndJob.watch(this, &ProfilingReport::postEndJob);
+}
+
+void ProfilingReport::postProcessEvent(const art::Event &, art::ScheduleContext)
+{
+    const std::uint64_t rss(prof::ProfRegistry::CurrentRSS());
+
+    fNEvents.fetch_add(1, std::memory_order_relaxed);
+    fSumEventRSS.fetch_add(rss, std::memory_order_relaxed);
+
+    std::uint64_t maxRSS(fMaxEventRSS.load(std::memory_order_relaxed));
+    while (rss > maxRSS && !fMaxEventRSS.compare_exchange_weak(maxRSS, rss, std::memory_order_relaxed))
+        ;
+}
+
+void ProfilingReport::postEndJob()
+{
+    prof::ProfRegistry::SetAnnotating(false);
+    if (!fRecord)
+        return;
+
+    const prof::ProfRegistry &registry(prof::ProfRegistry::Instance());
+    const unsigned int nEvents(fNEvents.load());
+    const double toMB(1. / (1024. * 1024.));
+
+    if (!fOutputFile.empty())
+    {
+        std::ofstream out(fOutputFile);
+        if (!out)
+        {
+            mf::LogWarning("ProfilingReport") << "Could not open " << fOutputFile << ", no summary written";
+        }
+        else
+        {
+            out << "{\n  \"events\": " << nEvents << ",\n"
+                << "  \"memory\": {\"peak_rss_mb\": " << prof::ProfRegistry::PeakRSS() * toMB
+                << ", \"max_event_rss_mb\": " << fMaxEventRSS.load() * toMB
+                << ", \"mean_event_rss_mb\": " << (nEvents > 0 ? fSumEventRSS.load() * toMB / nEvents : 0.) << "},\n";
+            registry.WriteJSON(out, nEvents);
+            out << "\n}\n";
+        }
+    }
+
+    if (fPrintSummary)
+    {
+        std::ostringstream table;
+        registry.WriteTable(table, nEvents);
+        mf::LogInfo("ProfilingReport") << "Profile of " << nEvents << " events, peak RSS " << prof::ProfRegistry::PeakRSS() * toMB
+                                       << " MB\n" << table.str();
+    }
+
+    prof::ProfRegistry::SetEnabled(false);
+}
+
+} // namespace dune
+
+DECLARE_ART_SERVICE(dune::ProfilingReport, SHARED)
+DEFINE_ART_SERVICE(dune::ProfilingReport)
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Time the reference dunereco jobs and compare them against stored baselines.
+
+Each workflow of the manifest (benchmark_workflows.json by default) is run on
+its pinned input with the TimeTracker, MemoryTracker and ProfilingReport
+services, in a scratch directory of its own:
+
+    export DUNERECO_BENCHMARK_INPUTS=/path/to/pinned/inputs
+    benchmark_workflows.py --report report.json --baseline reference_report.json
+
+The report holds per workflow the events per second and mean event time of the
+event loop, the first event left out as warm-up, the slowest modules, the
+peak memory and the path of the ProfilingReport summary, which
+compare_profiles.py compares timer by timer. With a baseline, each workflow is
+compared against it, and the exit status is 1 if one became slower, or needs
+more memory, by more than the threshold. --write-baseline stores the report as
+the new baseline instead.
+"""
+
+import argparse
+import json
+import os
+import sqlite3
+import subprocess
+import sys
+import time
+
+
+def read_table(path, table):
+    """Rows of a tracker table as dicts, empty if the database or table is missing."""
+    if not os.path.exists(path):
+        return []
+    with sqlite3.connect(path) as db:
+        db.row_factory = sqlite3.Row
+        try:
+            return [dict(row) for row in db.execute('SELECT * FROM %s' % table)]
+        except sqlite3.OperationalError:
+            return []
+
+
+def column(row, *names):
+    for name in names:
+        for key in row:
+            if key.lower() == name.lower():
+                return row[key]
+    return None
+
+
+def write_job(workdir, workflow):
+    """The job of a workflow with the trackers and the profiling summary turned on."""
+    path = os.path.join(workdir, 'benchmark_%s.fcl' % workflow['name'])
+    with open(path, 'w') as f:
+        f.write('#include "profiling.fcl"\n')
+        f.write('#include "%s"\n\n' % workflow['fcl'])
+        f.write('services.TimeTracker: { printSummary: false dbOutput: { filename: "time.db" overwrite: true } }\n')
+        f.write('services.MemoryTracker: { dbOutput: { filename: "memory.db" overwrite: true } }\n')
+        f.write('services.ProfilingReport: @local::dune_profiling_report\n')
+        f.write('services.ProfilingReport.OutputFile: "profile.json"\n')
+        f.write('services.ProfilingReport.PrintSummary: false\n')
+    return path
+
+
+def run_workflow(workflow, events, skip, workdir, lar):
+    name = workflow['name']
+    inputFile = os.path.expandvars(workflow['input'])
+    if '$' in inputFile or not os.path.exists(inputFile):
+        print('%s: input %s not found, skipped' % (name, inputFile))
+        return {'status': 'skipped', 'input': inputFile}
+
+    workdir = os.path.join(workdir, name)
+    os.makedirs(workdir, exist_ok=True)
+    job = write_job(workdir, workflow)
+    command = [lar, '-c', job, '-s', inputFile, '-n', str(events), '--nskip', str(skip)]
+
+    print('%s: %s' % (name, ' '.join(command)))
+    start = time.time()
+    with open(os.path.join(workdir, 'lar.log'), 'w') as log:
+        status = subprocess.call(command, cwd=workdir, stdout=log, stderr=subprocess.STDOUT)
+    wall = time.time() - start
+    if status != 0:
+        print('%s: lar exited with %d, see %s' % (name, status, os.path.join(workdir, 'lar.log')))
+        return {'status': 'failed', 'exit_code': status, 'wall_s': wall}
+
+    result = {'status': 'ok', 'input': inputFile, 'wall_s': wall}
+
+    eventTimes = [column(row, 'Time') for row in read_table(os.path.join(workdir, 'time.db'), 'TimeEvent')]
+    eventTimes = [t for t in eventTimes if t is not None]
+    timed = eventTimes[1:] if len(eventTimes) > 1 else eventTimes
+    result['events'] = len(eventTimes)
+    if timed:
+        result['mean_event_s'] = sum(timed) / len(timed)
+        result['events_per_s'] = len(timed) / sum(timed) if sum(timed) > 0 else 0.
+
+    modules = {}
+    for row in read_table(os.path.join(workdir, 'time.db'), 'TimeModule'):
+        label = column(row, 'ModuleLabel')
+        if label is not None and column(row, 'Time') is not None:
+            modules.setdefault(label, []).append(column(row, 'Time'))
+    result['modules_mean_s'] = dict(sorted(((label, sum(t) / len(t)) for label, t in modules.items()),
+                                           key=lambda item: -item[1])[:10])
+
+    rss = [column(row, 'RSS') for row in read_table(os.path.join(workdir, 'memory.db'), 'EventInfo')]
+    rss = [r for r in rss if r is not None]
+    if rss:
+        result['max_event_rss_mb'] = max(rss)
+
+    profile = os.path.join(workdir, 'profile.json')
+    if os.path.exists(profile):
+        result['profile'] = profile
+        with open(profile) as f:
+            result['peak_rss_mb'] = json.load(f).get('memory', {}).get('peak_rss_mb')
+
+    print('%s: %s events, %.3f events/s, peak RSS %s MB' % (name, result['events'], result.get('events_per_s', 0.),
+                                                          result.get('peak_rss_mb')))
+    return result
+
+
+def compare(baseline, report, threshold):
+    """Print the changes against the baseline, return the number of regressions."""
+    regressions = 0
+    print('\n%-24s %14s %14s %8s %12s %12s %8s' % ('workflow', 'ref events/s', 'new events/s', 'change',
+                                                   'ref RSS MB', 'new RSS MB', 'change'))
+    for name, cur in sorted(report['workflows'].items()):
+        ref = baseline.get('workflows', {}).get(name)
+        if cur.get('status') != 'ok' or not ref or ref.get('status') != 'ok':
+            print('%-24s %s' % (name, 'not compared (%s)' % cur.get('status') if ref else 'no baseline'))
+            continue
+
+        flags = []
+        refRate, curRate = ref.get('events_per_s', 0.), cur.get('events_per_s', 0.)
+        rateChange = (curRate - refRate) / refRate if refRate > 0 else 0.
+        if rateChange < -threshold:
+            flags.append('slower')
+
+        refMem, curMem = ref.get('peak_rss_mb') or 0., cur.get('peak_rss_mb') or 0.
+        memChange = (curMem - refMem) / refMem if refMem > 0 else 0.
+        if memChange > threshold:
+            flags.append('more memory')
+
+        regressions += len(flags)
+        print('%-24s %14.3f %14.3f %+7.1f%% %12.1f %12.1f %+7.1f%%%s' % (
+            name, refRate, curRate, 100 * rateChange, refMem, curMem, 100 * memChange,
+            '  <-- ' + ', '.join(flags) if flags else ''))
+    return regressions
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--manifest', default=os.path.join(here, 'benchmark_workflows.json'),
+                        help='workflows to run (default benchmark_workflows.json next to this script)')
+    parser.add_argument('--only', nargs='*', default=None, help='names of the workflows to run, default all')
+    parser.add_argument('--events', type=int, default=None, help='events per workflow, overrides the manifest')
+    parser.add_argument('--workdir', default='dunereco_benchmark', help='scratch directory of the jobs')
+    parser.add_argument('--lar', default='lar', help='art executable')
+    parser.add_argument('--report', default='dunereco_benchmark.json', help='report to write')
+    parser.add_argument('--baseline', default=None,
+                        help='report to compare against, looked up in DUNERECO_BENCHMARK_BASELINES if not a path')
+    parser.add_argument('--write-baseline', action='store_true', help='store the report as the baseline')
+    parser.add_argument('--threshold', type=float, default=0.1, help='allowed fractional change (default 0.1)')
+    args = parser.parse_args()
+
+    with open(args.manifest) as f:
+        manifest = json.load(f)
+
+    workdir = os.path.abspath(args.workdir)
+    report = {'manifest': os.path.abspath(args.manifest), 'release': os.environ.get('DUNERECO_VERSION', ''),
+              'host': os.uname()[1], 'time': time.strftime('%Y-%m-%dT%H:%M:%S'), 'workflows': {}}
+    for workflow in manifest['workflows']:
+        if args.only is not None and workflow['name'] not in args.only:
+            continue
+        events = args.events or workflow.get('events', manifest.get('events', 50))
+        skip = workflow.get('skip_events', manifest.get('skip_events', 0))
+        report['workflows'][workflow['name']] = run_workflow(workflow, events, skip, workdir, args.lar)
+
+    with open(args.report, 'w') as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+    print('\nreport written to %s' % args.report)
+
+    baseline = args.baseline
+    if baseline and not os.path.exists(baseline):
+        baseline = os.path.join(os.environ.get('DUNERECO_BENCHMARK_BASELINES', '.'), baseline)
+
+    if args.write_baseline:
+        if not baseline:
+            parser.error('--write-baseline needs --baseline')
+        with open(baseline, 'w') as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+        print('baseline written to %s' % baseline)
+        return 0
+
+    failed = sum(1 for result in report['workflows'].values() if result.get('status') == 'failed')
+    regressions = 0
+    if baseline and not os.path.exists(baseline):
+        print('no baseline %s, nothing compared' % baseline)
+    elif baseline:
+        with open(baseline) as f:
+            regressions = compare(json.load(f), report, args.threshold)
+
+    return 1 if failed > 0 or regressions > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
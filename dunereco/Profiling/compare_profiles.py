@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Compare two ProfilingReport summaries of the same job and input.
+
+Runs the instrumented algorithms on a recorded input with the ProfilingReport
+service, keeps the JSON of a reference release, and then compares each new
+summary against it:
+
+    lar -c job_with_profiling.fcl -s recorded.root -n 100
+    compare_profiles.py reference.json dunereco_profile.json --threshold 0.1
+
+duneKernelBenchmark writes the same summary for the CVN image and hit line fit
+kernels without art, each iteration counted as an event.
+
+Exits with status 1 if a timer's ms per event, or a counter's sum per event,
+rose by more than the threshold. Timers below --min-ms are ignored because
+their timings are mostly noise.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        summary = json.load(f)
+    timers = {t['name']: t for t in summary.get('timers', [])}
+    counters = {c['name']: c for c in summary.get('counters', [])}
+    return summary, timers, counters
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('reference', help='summary of the reference release')
+    parser.add_argument('current', help='summary to check')
+    parser.add_argument('--threshold', type=float, default=0.1, help='allowed fractional increase (default 0.1)')
+    parser.add_argument('--min-ms', type=float, default=0.01, help='ignore timers below this many ms per event')
+    args = parser.parse_args()
+
+    refSummary, refTimers, refCounters = load(args.reference)
+    curSummary, curTimers, curCounters = load(args.current)
+
+    if refSummary.get('events') != curSummary.get('events'):
+        print('warning: the summaries are of %s and %s events' % (refSummary.get('events'), curSummary.get('events')))
+
+    regressions = 0
+    print('%-60s %12s %12s %8s' % ('timer', 'ref ms/evt', 'new ms/evt', 'change'))
+    for name in sorted(set(refTimers) | set(curTimers)):
+        if name not in refTimers or name not in curTimers:
+            print('%-60s %s' % (name, 'only in ' + ('current' if name in curTimers else 'reference')))
+            continue
+        ref = refTimers[name]['ms_per_event']
+        cur = curTimers[name]['ms_per_event']
+        if max(ref, cur) < args.min_ms:
+            continue
+        change = (cur - ref) / ref if ref > 0 else float('inf')
+        flag = ''
+        if change > args.threshold:
+            flag = '  <-- slower'
+            regressions += 1
+        print('%-60s %12.4f %12.4f %+7.1f%%%s' % (name, ref, cur, 100 * change, flag))
+
+    print('\n%-60s %12s %12s %8s' % ('counter', 'ref /evt', 'new /evt', 'change'))
+    for name in sorted(set(refCounters) & set(curCounters)):
+        ref = refCounters[name]['per_event']
+        cur = curCounters[name]['per_event']
+        change = (cur - ref) / ref if ref > 0 else (0. if cur == 0 else float('inf'))
+        flag = ''
+        if change > args.threshold:
+            flag = '  <-- more work'
+            regressions += 1
+        print('%-60s %12.1f %12.1f %+7.1f%%%s' % (name, ref, cur, 100 * change, flag))
+
+    refMem = refSummary.get('memory', {}).get('peak_rss_mb', 0.)
+    curMem = curSummary.get('memory', {}).get('peak_rss_mb', 0.)
+    print('\npeak RSS %.1f MB -> %.1f MB' % (refMem, curMem))
+    if refMem > 0 and (curMem - refMem) / refMem > args.threshold:
+        print('peak RSS rose by more than the threshold')
+        regressions += 1
+
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -23,10 +23,17 @@
 #include "larcorealg/Geometry/GeometryCore.h"
 
 // std includes
+#include <algorithm>
 #include <string>
 #include <functional>
+#include <iterator>
 #include <iostream>
 #include <memory>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+
+#include "tbb/parallel_for.h"
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // implementation follows
@@ -53,6 +60,9 @@ void DBScanAlg_DUNE35t::reconfigure(fhicl::ParameterSet const &pset)
     m_timeAdvanceGap         = pset.get<double>("TimeAdvanceGap",   50.);
     m_numSigmaPeakTime       = pset.get<double>("NumSigmaPeakTime",  5.);
     m_EpsMaxDist             = pset.get<double>("EpsilonDistanceDBScan", 5.);
+    m_parallelNeighborhood   = pset.get<bool>("ParallelNeighborhood", false);
+    m_parallelPairing        = pset.get<bool>("ParallelPairing", false);
+    m_dbscanConfig           = dune::dbscan::ConfigFromPSet(pset);
     
     art::ServiceHandle<geo::Geometry>            geometry;
     
@@ -63,134 +73,121 @@ void DBScanAlg_DUNE35t::reconfigure(fhicl::ParameterSet const &pset)
     
 }
     
-void DBScanAlg_DUNE35t::expandCluster(EpsPairNeighborhoodMapVec&          epsNeighborhoodMapVec,
-                              EpsPairNeighborhoodMapVec::iterator epsVecItr,
-                              reco::HitPairListPtr&               curCluster,
-                              size_t                              minPts) const
+void DBScanAlg_DUNE35t::expandCluster(EpsPairNeighborhoods&  neighborhoods,
+                                      size_t                 hitID,
+                                      reco::HitPairListPtr&  curCluster,
+                                      size_t                 minPts) const
 {
     // This is the main inside loop for the DBScan based clustering algorithm
     //
     // Add the current hit to the current cluster
-    epsVecItr->second.first.setInCluster();
-    curCluster.push_back(epsVecItr->first);
+    neighborhoods.m_params[hitID].setInCluster();
+    curCluster.push_back(neighborhoods.m_hits[hitID]);
     
     // Get the list of points in this hit's epsilon neighborhood
-    // Note this is a copy so we can modify locally
-    EpsPairNeighborhoodList epsNeighborhoodList = epsVecItr->second.second;
+    // Note this is a copy so we can extend it locally, points are taken from the front
+    std::vector<size_t> epsNeighborhoodList(neighborhoods.m_neighbors.begin() + neighborhoods.m_offsets[hitID],
+                                            neighborhoods.m_neighbors.begin() + neighborhoods.m_offsets[hitID + 1]);
     
-    while(!epsNeighborhoodList.empty())
+    for(size_t head = 0; head < epsNeighborhoodList.size(); head++)
     {
-        // Dereference the point so we can see in the debugger...
-        const reco::ClusterHit3D* neighborPtr = epsNeighborhoodList.front();
-        
-        // Use that to look up the iterator in the general neighborhood map
-        EpsPairNeighborhoodMapVec::iterator curPtEpsVecItr = epsNeighborhoodMapVec.begin();
-        
-        std::advance(curPtEpsVecItr, neighborPtr->getID());
+        const size_t  neighborID = epsNeighborhoodList[head];
+        DBScanParams& neighborParams(neighborhoods.m_params[neighborID]);
         
         // If we've not been here before then take action...
-        if (!curPtEpsVecItr->second.first.visited())
+        if (!neighborParams.visited())
         {
-            curPtEpsVecItr->second.first.setVisited();
+            neighborParams.setVisited();
                 
             // If this epsilon neighborhood of this point is large enough then add its points to our list
-            if (curPtEpsVecItr->second.first.getCount() >= minPts)
+            if (neighborParams.getCount() >= minPts)
             {
-                // Plan is to loop through the hits in this point's neighborhood and add them to our list provided
-                // they have not already been added, or are part of a cluster, etc.
-                // So, get the list of points in the neighborhood
-                EpsPairNeighborhoodList& locList = curPtEpsVecItr->second.second;
-                    
-                // And loop through them...
-                for(EpsPairNeighborhoodList::iterator hitItr = locList.begin(); hitItr != locList.end(); hitItr++)
-                {
-                    epsNeighborhoodList.push_back(*hitItr);
-                }
+                epsNeighborhoodList.insert(epsNeighborhoodList.end(),
+                                           neighborhoods.m_neighbors.begin() + neighborhoods.m_offsets[neighborID],
+                                           neighborhoods.m_neighbors.begin() + neighborhoods.m_offsets[neighborID + 1]);
             }
         }
             
         // If the point is not yet in a cluster then we now add
-        if (!curPtEpsVecItr->second.first.inCluster())
+        if (!neighborParams.inCluster())
         {
-            curPtEpsVecItr->second.first.setInCluster();
-            curCluster.push_back(curPtEpsVecItr->first);
+            neighborParams.setInCluster();
+            curCluster.push_back(neighborhoods.m_hits[neighborID]);
         }
-        
-        epsNeighborhoodList.pop_front();
     }
     
     return;
 }
 
-bool SetPositionOrder(const std::unique_ptr<reco::ClusterHit3D>& left, const std::unique_ptr<reco::ClusterHit3D>& right)
+bool SetPositionOrder(const reco::ClusterHit3D& left, const reco::ClusterHit3D& right)
 {
     // The positions in the Y-Z plane are quantized so take advantage of that for ordering
     // First check that we are in the same "bin" in the z direction
-    if (left->getHits().back()->getHit().WireID().Wire == right->getHits().back()->getHit().WireID().Wire) // These hits are "on the same w wire"
+    if (left.getHits().back()->getHit().WireID().Wire == right.getHits().back()->getHit().WireID().Wire) // These hits are "on the same w wire"
     {
         // We can use the U wires as a proxy for ordering hits in increasing Y
         // where we remember that as Y increases the U wire number decreases
-        if (left->getHits().front()->getHit().WireID().Wire == right->getHits().front()->getHit().WireID().Wire)
+        if (left.getHits().front()->getHit().WireID().Wire == right.getHits().front()->getHit().WireID().Wire)
         {
             // In the time direction we are not quantized at a large enough level to check
-            return left->getX() < right->getX();
+            return left.getX() < right.getX();
         }
         
-        return left->getHits().front()->getHit().WireID().Wire > right->getHits().front()->getHit().WireID().Wire;
+        return left.getHits().front()->getHit().WireID().Wire > right.getHits().front()->getHit().WireID().Wire;
     }
 
-    return left->getHits().back()->getHit().WireID().Wire < right->getHits().back()->getHit().WireID().Wire;
+    return left.getHits().back()->getHit().WireID().Wire < right.getHits().back()->getHit().WireID().Wire;
 }
 
 
 //This function sorts by Z first. It is the default, and is also used if we have particles passing through the EW
 //scintillation counters on the exterior of the detector
-bool SetPositionOrderZ( const std::unique_ptr<reco::ClusterHit3D>& left, const std::unique_ptr<reco::ClusterHit3D>& right ) 
+bool SetPositionOrderZ( const reco::ClusterHit3D& left, const reco::ClusterHit3D& right ) 
 {
   //Sort by Z first, then by Y, then by X.
-  if( left->getZ() == right->getZ() ){
-    if( left->getY() == right->getY() ){
-      return left->getX() < right->getX();
+  if( left.getZ() == right.getZ() ){
+    if( left.getY() == right.getY() ){
+      return left.getX() < right.getX();
     }
-    return left->getY() < right->getY();
+    return left.getY() < right.getY();
   }
-  return left->getZ() < right->getZ();
+  return left.getZ() < right.getZ();
 }
 
 
 //This function sorts by X first. It is used if we have particles passing through the NS scintillation counters on the
 //exterior of the detector.
-bool SetPositionOrderX( const std::unique_ptr<reco::ClusterHit3D>& left, const std::unique_ptr<reco::ClusterHit3D>& right ) 
+bool SetPositionOrderX( const reco::ClusterHit3D& left, const reco::ClusterHit3D& right ) 
 {
   //Sort by X first, then by Z, then by Y.
-  if( left->getX() == right->getX() ){
-    if( left->getZ() == right->getZ() ){
-      return left->getY() < right->getY();
+  if( left.getX() == right.getX() ){
+    if( left.getZ() == right.getZ() ){
+      return left.getY() < right.getY();
     }
-    return left->getZ() < right->getZ();
+    return left.getZ() < right.getZ();
   }
-  return left->getX() < right->getX();
+  return left.getX() < right.getX();
 }
 
 //This function sorts by Y first. It is used if we have particles passing through the top scintillation counters above
 //the detector.
-bool SetPositionOrderY( const std::unique_ptr<reco::ClusterHit3D>& left, const std::unique_ptr<reco::ClusterHit3D>& right ) 
+bool SetPositionOrderY( const reco::ClusterHit3D& left, const reco::ClusterHit3D& right ) 
 {
   //Sort by Y first, then by Z, then by X.
-  if( left->getY() == right->getY() ){
-    if( left->getZ() == right->getZ() ){
-      return left->getX() < right->getX();
+  if( left.getY() == right.getY() ){
+    if( left.getZ() == right.getZ() ){
+      return left.getX() < right.getX();
     }
-    return left->getZ() < right->getZ();
+    return left.getZ() < right.getZ();
   }
-  return left->getY() < right->getY();
+  return left.getY() < right.getY();
 }
 
 
     
 bool SetPeakHitPairIteratorOrder(const HitPairList::iterator& left, const HitPairList::iterator& right)
 {
-    return (*left)->getAvePeakTime() < (*right)->getAvePeakTime();
+    return left->getAvePeakTime() < right->getAvePeakTime();
 }
     
 struct HitPairClusterOrder
@@ -235,13 +232,14 @@ void DBScanAlg_DUNE35t::ClusterHitsDBScan(ViewToHitVectorMap&       viewToHitVec
     }
 
     // The container of pairs and those in each pair's epsilon neighborhood
-    EpsPairNeighborhoodMapVec epsPairNeighborhoodMapVec;
-    epsPairNeighborhoodMapVec.resize(numHitPairs, EpsPairNeighborhoodMapPair(0,EpsPairNeighborhoodPair()));  //<-- initialize too!
+    EpsPairNeighborhoods epsPairNeighborhoods;
+    epsPairNeighborhoods.m_hits.resize(numHitPairs, 0);
+    epsPairNeighborhoods.m_params.resize(numHitPairs);
     
     // DBScan is driven of its "epsilon neighborhood". Computing adjacency within DBScan can be time
     // consuming so the idea is the prebuild the adjaceny map and then run DBScan.
     // The following call does this work
-    BuildNeighborhoodMap(hitPairList, epsPairNeighborhoodMapVec);
+    BuildNeighborhoodMap(hitPairList, epsPairNeighborhoods);
 
     //Monitoring activity
     if (m_enableMonitoring)
@@ -258,23 +256,23 @@ void DBScanAlg_DUNE35t::ClusterHitsDBScan(ViewToHitVectorMap&       viewToHitVec
     
     // Ok, here we go!
     // We can simply iterate over the map we have just built to loop through the hits "simply"
-    for(EpsPairNeighborhoodMapVec::iterator epsPairVecItr  = epsPairNeighborhoodMapVec.begin();
-                                            epsPairVecItr != epsPairNeighborhoodMapVec.end();
-                                            epsPairVecItr++)
+    for(size_t hitID = 0; hitID < epsPairNeighborhoods.m_hits.size(); hitID++)
     {
         // Skip the null entries (they were filtered out)
-        if (!epsPairVecItr->first) continue;
+        if (!epsPairNeighborhoods.m_hits[hitID]) continue;
+        
+        DBScanParams& hitParams(epsPairNeighborhoods.m_params[hitID]);
         
         // If this hit has been "visited" already then skip
-        if (epsPairVecItr->second.first.visited()) continue;
+        if (hitParams.visited()) continue;
         
         // We are now visiting it so mark it as so
-        epsPairVecItr->second.first.setVisited();
+        hitParams.setVisited();
         
         // Check that density is sufficient
-        if (epsPairVecItr->second.first.getCount() < m_minPairPts)
+        if (hitParams.getCount() < m_minPairPts)
         {
-            epsPairVecItr->second.first.setNoise();
+            hitParams.setNoise();
         }
         else
         {
@@ -282,7 +280,7 @@ void DBScanAlg_DUNE35t::ClusterHitsDBScan(ViewToHitVectorMap&       viewToHitVec
             reco::HitPairListPtr& curCluster = hitPairClusterMap[pairClusterIdx++];
             
             // expand the cluster
-            expandCluster(epsPairNeighborhoodMapVec, epsPairVecItr, curCluster, m_minPairPts);
+            expandCluster(epsPairNeighborhoods, hitID, curCluster, m_minPairPts);
         }
     }
 
@@ -343,119 +341,165 @@ size_t DBScanAlg_DUNE35t::BuildHitPairMap(ViewToHitVectorMap& viewToHitVectorMap
             if (viewToHitVectorMap.find(geo::kV) != viewToHitVectorMap.end())
                 totalNumHits += viewToHitVectorMap[geo::kV].size();
             
-            // Take advantage that hits are sorted in "start time order"
-            // Set the inner loop iterator before starting loop over outer hits
-            HitVector::iterator hitVectorWStartItr = hitVectorW.begin();
+            // The V plane of each TPC, from its first V hit, looked up for every pair below
+            std::map<unsigned int, size_t> tpcToVPlane;
+            for (const reco::ClusterHit2D* hitV : viewToHitVectorMap[geo::kV])
+                tpcToVPlane.emplace(hitV->getHit().WireID().TPC, hitV->getHit().WireID().Plane);
             
-            // Now we loop over the hits in these two layers
-            for (HitVector::iterator hitItrU = hitVectorU.begin(); hitItrU != hitVectorU.end(); hitItrU++)
+            const WireToHitSetMap& wireToHitSetMapV = viewToWireToHitSetMap[geo::kV];
+            
+            // Hits are only paired within a TPC, so split both views by TPC, keeping their
+            // "start time order", and sweep each TPC on its own. Each hit keeps its position
+            // in the full vector so the triplets can be put back in the order of one sweep
+            typedef std::vector<std::pair<size_t, const reco::ClusterHit2D*> > TPCHitVector;
+            std::map<unsigned int, std::pair<TPCHitVector, TPCHitVector> > tpcToHitVectorsMap;
+            
+            for (size_t hitIdx = 0; hitIdx < hitVectorU.size(); hitIdx++)
+                tpcToHitVectorsMap[hitVectorU[hitIdx]->getHit().WireID().TPC].first.emplace_back(hitIdx, hitVectorU[hitIdx]);
+            
+            for (size_t hitIdx = 0; hitIdx < hitVectorW.size(); hitIdx++)
+                tpcToHitVectorsMap[hitVectorW[hitIdx]->getHit().WireID().TPC].second.emplace_back(hitIdx, hitVectorW[hitIdx]);
+            
+            std::vector<const std::pair<TPCHitVector, TPCHitVector>*> tpcHitVectors;
+            for (const auto& tpcHitVectorsItr : tpcToHitVectorsMap) tpcHitVectors.push_back(&tpcHitVectorsItr.second);
+            
+            // A triplet with the positions of its U and W hits
+            struct OrderedTriplet
             {
-
-                const reco::ClusterHit2D* hitPtrU = *hitItrU;
+                size_t             indexU;
+                size_t             indexW;
+                reco::ClusterHit3D triplet;
+            };
+            
+            std::vector<std::vector<OrderedTriplet> > tpcTriplets(tpcHitVectors.size());
+            
+            auto sweepTPC = [&](size_t tpcIdx)
+            {
+                const TPCHitVector&          tpcHitVectorU = tpcHitVectors[tpcIdx]->first;
+                const TPCHitVector&          tpcHitVectorW = tpcHitVectors[tpcIdx]->second;
+                std::vector<OrderedTriplet>& triplets      = tpcTriplets[tpcIdx];
                 
-                if (hitPtrU->getHit().Integral() < minCharge[hitPtrU->getHit().View()]) continue;
+                // The y,z of a pair come from the crossing of its wires, so the nearest V wire
+                // only has to be found once for each crossing
+                std::map<std::pair<unsigned int, unsigned int>, geo::WireID> crossingToWireIDV;
                 
-
-                // This will be used in each loop so dereference the peak time here
-                double hitUPeakTime = hitPtrU->getTimeTicks();
+                // Take advantage that hits are sorted in "start time order"
+                // Set the inner loop iterator before starting loop over outer hits
+                TPCHitVector::const_iterator hitVectorWStartItr = tpcHitVectorW.begin();
                 
-                // Inner loop is over hits within the time range of the outer hit
-                for (HitVector::iterator hitItrW = hitVectorWStartItr; hitItrW != hitVectorW.end(); hitItrW++)
+                // Now we loop over the hits in these two layers
+                for (TPCHitVector::const_iterator hitItrU = tpcHitVectorU.begin(); hitItrU != tpcHitVectorU.end(); hitItrU++)
                 {
-                    const reco::ClusterHit2D* hitPtrW = *hitItrW;
+                    const reco::ClusterHit2D* hitPtrU = hitItrU->second;
                     
-		    //Check to make sure that this hit is in the same TPC as the previous hit
-		    if( hitPtrW->getHit().WireID().TPC != hitPtrU->getHit().WireID().TPC ) continue;
-
-                    if (hitPtrW->getHit().Integral() < minCharge[hitPtrW->getHit().View()]) continue;
-                    
-                    // Hits are sorted in "peak time order" which we can take advantage of to try to speed
-                    // the loops. Basically, we can compare the peak time for the outer loop hit against
-                    // the current hit's peak time and if outside the range of interest we can take action.
-                    // The range of interest is eyeballed but is meant to account for large pulse widths
-                    // Start by dereferencing the inner hit peak time
-                    double hitWPeakTime = hitPtrW->getTimeTicks();
-                    
-                    // If the outer loop's peak time is well past the current hit's then
-                    // we should advance the inner loop's start iterator and keep going
-                    if (hitUPeakTime >  hitWPeakTime + m_timeAdvanceGap)
-                    {
-
-		      
-                        hitVectorWStartItr++;
-                        continue;
-                    }
-
-                    // If the inner loop hit start time is past the end of the outer's end time, then break out loop
-                    if (hitUPeakTime + m_timeAdvanceGap < hitWPeakTime) break;
+                    if (hitPtrU->getHit().Integral() < minCharge[hitPtrU->getHit().View()]) continue;
                     
-                    // We have a candidate hit pair combination, try to make a hit
-                    reco::ClusterHit3D pair = makeHitPair(hitPtrU, hitPtrW);
-
+                    // This will be used in each loop so dereference the peak time here
+                    double hitUPeakTime = hitPtrU->getTimeTicks();
                     
-                    // The sign of success here is that the average peak time of the combined hits is > 0
-                    // (note that when hits are combined the first window offset is accounted for)
-                    if (pair.getAvePeakTime() > 0.)
+                    // Inner loop is over hits within the time range of the outer hit
+                    for (TPCHitVector::const_iterator hitItrW = hitVectorWStartItr; hitItrW != tpcHitVectorW.end(); hitItrW++)
                     {
-		      //bool hitInVNotFound(true);
-
-
-			//I need to know the plane ID to find the nearest wire in this TPC. In order to do that, I need to
-			//loop through the viewToHitVector map and find the plane ID corresponding to a hit in this plane and this TPC
-			size_t thePlane = 9999;
-			for( HitVector::iterator hitVect_iter = viewToHitVectorMap[geo::kV].begin(); hitVect_iter != viewToHitVectorMap[geo::kV].end(); ++hitVect_iter ){
-			  if( (*(hitVect_iter))->getHit().WireID().TPC == hitPtrW->getHit().WireID().TPC ){
-			    thePlane = (*(hitVect_iter))->getHit().WireID().Plane;
-			    break;
-			  }
-			}
-			geo::PlaneID thePlaneID(0,hitPtrW->getHit().WireID().TPC,thePlane);
-           
-                        // Recover the WireID nearest in the V plane to the position of the pair
-			//REL Use plane ids here to avoid TPC ambiguity introduced by just using view type
-                        const geo::WireID wireIDV = NearestWireID_mod(pair.getPosition(), thePlaneID);
-
-			//Some debug printing
-			if( wireIDV.TPC != hitPtrW->getHit().WireID().TPC )
-			  std::cout << "TPC of third (nearest) wire is not the same as the TPC of the first two." << std::endl;
-			if( hitPtrU->getHit().WireID().TPC != hitPtrW->getHit().WireID().TPC )
-			  std::cout << "TPC of wire 1 is not TPC of wire 2." << std::endl;
-                            
-                        // We believe the code that returns the ID is offset by one
-			//Get the hits associated with the nearest wire
-                        WireToHitSetMap::iterator wireToHitSetMapVItr = viewToWireToHitSetMap[geo::kV].find(wireIDV.Wire);
-			
-                        if (wireToHitSetMapVItr != viewToWireToHitSetMap[geo::kV].end())
+                        const reco::ClusterHit2D* hitPtrW = hitItrW->second;
+                        
+                        if (hitPtrW->getHit().Integral() < minCharge[hitPtrW->getHit().View()]) continue;
+                        
+                        // Hits are sorted in "peak time order" which we can take advantage of to try to speed
+                        // the loops. Basically, we can compare the peak time for the outer loop hit against
+                        // the current hit's peak time and if outside the range of interest we can take action.
+                        // The range of interest is eyeballed but is meant to account for large pulse widths
+                        // Start by dereferencing the inner hit peak time
+                        double hitWPeakTime = hitPtrW->getTimeTicks();
+                        
+                        // If the outer loop's peak time is well past the current hit's then
+                        // we should advance the inner loop's start iterator and keep going
+                        if (hitUPeakTime >  hitWPeakTime + m_timeAdvanceGap)
                         {
-			  const reco::ClusterHit2D* hit2DV = FindBestMatchingHit(wireToHitSetMapVItr->second, pair, m_numSigmaPeakTime*pair.getSigmaPeakTime());
-
-
-                            // If a V hit found then it should be straightforward to make the triplet
-
-			  if (hit2DV){
-			    if( hitPtrW->getHit().WireID().TPC == hit2DV->getHit().WireID().TPC ){ 
-			      
-			      reco::ClusterHit3D triplet = makeHitTriplet(pair, hit2DV);
-			      
-			      if (triplet.getAvePeakTime() > 0.)
-				{
-				  
-				  triplet.setID(hitPairCntr++);
-				  hitPairList.emplace_back(std::unique_ptr<reco::ClusterHit3D>(new reco::ClusterHit3D(triplet)));
-				  //				    goodBool = true;
-				}
-			      
-			      //hitInVNotFound = false;
-			    }
-			  }
-			}
-			
-		    }
-		}
-	    }
-	}
+                            hitVectorWStartItr++;
+                            continue;
+                        }
+                        
+                        // If the inner loop hit start time is past the end of the outer's end time, then break out loop
+                        if (hitUPeakTime + m_timeAdvanceGap < hitWPeakTime) break;
+                        
+                        // We have a candidate hit pair combination, try to make a hit
+                        reco::ClusterHit3D pair = makeHitPair(hitPtrU, hitPtrW);
+                        
+                        // The sign of success here is that the average peak time of the combined hits is > 0
+                        // (note that when hits are combined the first window offset is accounted for)
+                        if (pair.getAvePeakTime() > 0.)
+                        {
+                            std::pair<unsigned int, unsigned int> crossing(hitPtrU->getHit().WireID().Wire, hitPtrW->getHit().WireID().Wire);
+                            
+                            auto crossingItr = crossingToWireIDV.find(crossing);
+                            
+                            if (crossingItr == crossingToWireIDV.end())
+                            {
+                                //I need to know the plane ID to find the nearest wire in this TPC, the plane of the
+                                //first V hit in this TPC
+                                std::map<unsigned int, size_t>::const_iterator tpcPlaneItr = tpcToVPlane.find(hitPtrW->getHit().WireID().TPC);
+                                size_t thePlane = tpcPlaneItr != tpcToVPlane.end() ? tpcPlaneItr->second : 9999;
+                                geo::PlaneID thePlaneID(0,hitPtrW->getHit().WireID().TPC,thePlane);
+                                
+                                // Recover the WireID nearest in the V plane to the position of the pair
+                                //REL Use plane ids here to avoid TPC ambiguity introduced by just using view type
+                                const geo::WireID wireIDV = NearestWireID_mod(pair.getPosition(), thePlaneID);
+                                
+                                //Some debug printing
+                                if( wireIDV.TPC != hitPtrW->getHit().WireID().TPC )
+                                    mf::LogDebug("Cluster3D") << "TPC of third (nearest) wire is not the same as the TPC of the first two." << std::endl;
+                                
+                                crossingItr = crossingToWireIDV.emplace(crossing, wireIDV).first;
+                            }
+                            
+                            // We believe the code that returns the ID is offset by one
+                            //Get the hits associated with the nearest wire
+                            WireToHitSetMap::const_iterator wireToHitSetMapVItr = wireToHitSetMapV.find(crossingItr->second.Wire);
+                            
+                            if (wireToHitSetMapVItr != wireToHitSetMapV.end())
+                            {
+                                const reco::ClusterHit2D* hit2DV = FindBestMatchingHit(wireToHitSetMapVItr->second, pair, m_numSigmaPeakTime*pair.getSigmaPeakTime());
+                                
+                                // If a V hit found then it should be straightforward to make the triplet
+                                if (hit2DV && hitPtrW->getHit().WireID().TPC == hit2DV->getHit().WireID().TPC)
+                                {
+                                    reco::ClusterHit3D triplet = makeHitTriplet(pair, hit2DV);
+                                    
+                                    if (triplet.getAvePeakTime() > 0.)
+                                        triplets.push_back(OrderedTriplet{hitItrU->first, hitItrW->first, std::move(triplet)});
+                                }
+                            }
+                        }
+                    }
+                }
+            };
+            
+            if (m_parallelPairing){
+                tbb::parallel_for(size_t(0), tpcHitVectors.size(), sweepTPC);
+            }
+            else{
+                for (size_t tpcIdx = 0; tpcIdx < tpcHitVectors.size(); tpcIdx++) sweepTPC(tpcIdx);
+            }
+            
+            // Put the triplets back in U then W hit order, so the IDs are those of a single sweep
+            std::vector<OrderedTriplet> orderedTriplets;
+            for (auto& triplets : tpcTriplets)
+                std::move(triplets.begin(), triplets.end(), std::back_inserter(orderedTriplets));
+            
+            std::sort(orderedTriplets.begin(), orderedTriplets.end(), [](const OrderedTriplet& left, const OrderedTriplet& right)
+                      {return std::make_pair(left.indexU, left.indexW) < std::make_pair(right.indexU, right.indexW);});
+            
+            hitPairList.reserve(hitPairList.size() + orderedTriplets.size());
+            
+            for (OrderedTriplet& orderedTriplet : orderedTriplets)
+            {
+                orderedTriplet.triplet.setID(hitPairCntr++);
+                hitPairList.emplace_back(std::move(orderedTriplet.triplet));
+            }
+        }
     }
-    hitPairList.sort(SetPositionOrderZ);
+    // Stable, as the list sort was, so hits at the same position keep their order
+    std::stable_sort(hitPairList.begin(), hitPairList.end(), SetPositionOrderZ);
     return hitPairList.size();
     
 }
@@ -466,107 +510,78 @@ size_t DBScanAlg_DUNE35t::BuildHitPairMap(ViewToHitVectorMap& viewToHitVectorMap
 
 //REL modified
 size_t DBScanAlg_DUNE35t::BuildNeighborhoodMap(HitPairList& hitPairList,
-					       EpsPairNeighborhoodMapVec& epsPairNeighborhoodMapVec )const
+					       EpsPairNeighborhoods& neighborhoods )const
 					      
 {
+  // Hits have been sorted by Z position, then by Y, then by X (each in ascending order).
+  // Each hit looks forward in that order for the hits within maxDist of it. For every
+  // integer bin of distance only the last such hit in the order is kept, and the hits
+  // are linked both ways. The hits within reach are found by dune::dbscan from a uniform
+  // grid of cells of size maxDist, so only the 27 cells around each hit are searched.
+  // Note that the consistentPairs check which used to be made here had no effect on
+  // the result (its choice was always overwritten) and is no longer run.
+  const double maxDist = m_EpsMaxDist; //REL 4.0; //Was 2, then 4 REL
+  const size_t nBins   = size_t(maxDist) + 1;
+  
+  std::vector<const reco::ClusterHit3D*> sortedHits;
+  sortedHits.reserve(hitPairList.size());
+  for (const auto& hitPair : hitPairList){
+    sortedHits.push_back(&hitPair);
+    neighborhoods.m_hits[hitPair.getID()] = &hitPair;
+  }
+  
+  const size_t nHits = sortedHits.size();
+  
+  std::vector<double> coords;
+  coords.reserve(3 * nHits);
+  for (const reco::ClusterHit3D* hitPair : sortedHits){
+    for (int k = 0; k < 3; k++) coords.push_back(hitPair->getPosition()[k]);
+  }
+  
+  // The chosen forward neighbor (a position in the sorted order) in each distance bin,
+  // searched on the CPU or the device of m_dbscanConfig
+  std::vector<long> bestInBin;
+  dune::dbscan::ForwardNeighborBins(m_dbscanConfig, coords, maxDist, bestInBin, m_parallelNeighborhood);
+  
+  // Turn the chosen links into the neighbor lists. A hit's list holds the hits that chose it,
+  // in their sorted order, followed by its own choices in increasing distance bin
+  const size_t nIDs = neighborhoods.m_hits.size();
+  std::vector<size_t> backwardCount(nIDs, 0);
+  std::vector<size_t> forwardCount(nIDs, 0);
   size_t consistentPairsCnt = 0;
-  size_t pairsChecked = 0;
   
-  for (HitPairList::const_iterator pairItrO = hitPairList.begin(); pairItrO != hitPairList.end(); pairItrO++){
-     
-    const reco::ClusterHit3D* hitPairO   = (*pairItrO).get();
-    const size_t              hitPairOID = hitPairO->getID();
-    
-    // Need to initialize the "first" part of the vector pseudo map
-    epsPairNeighborhoodMapVec[hitPairOID].first = hitPairO;
-    
-    // Get reference to the list for this hit so we don't look it up inside the loop
-    EpsPairNeighborhoodPair& hitPairOPair(epsPairNeighborhoodMapVec[hitPairOID].second);
-    
-    HitPairList::const_iterator pairItrI = pairItrO;
-    
-    std::map<int, std::pair<double, const reco::ClusterHit3D*> > bestTripletMap;
-    
-    // Get the X,Y, and Z for this triplet
-    double pairO_X = hitPairO->getPosition()[0];
-    double pairO_Y = hitPairO->getPosition()[1];
-    double pairO_Z = hitPairO->getPosition()[2];
-
-    // Set maximums
-    double maxDist = m_EpsMaxDist; //REL 4.0; //Was 2, then 4 REL
-
-    //Loop over second iterator
-    while (++pairItrI != hitPairList.end())
-      {
-	const reco::ClusterHit3D* hitPairI = (*pairItrI).get();
-
-	//OLD WAY
-	// Note that the hits have been sorted by z, then y and then in x
-	// Translation: hits are sorted by W wire, then in Y (increasing u, decreasing v)
-	// and then in time.
-	
-	//NEW WAY
-	// Hits have been sorted by Z position, then by Y, then by X (each in ascending order).
-	// There is no reference to wire number here, since we need to consider clustering
-	// across TPCs.
-	
-	// Get the X,Y, and Z for this triplet
-	double pairI_X = hitPairI->getPosition()[0];
-	double pairI_Y = hitPairI->getPosition()[1];
-	double pairI_Z = hitPairI->getPosition()[2];
-	
-	//Sorting allows us to break this loop after the maxDist is surpassed in z
-	if( pairI_Z - pairO_Z > maxDist ) break;
-
-	//Form the distance so we can check ranges
-	double distance = pow(
-			      pow(pairO_X-pairI_X,2) +
-			      pow(pairO_Y-pairI_Y,2) +
-			      pow(pairO_Z-pairI_Z,2),0.5);
-	
-	// If we have passed the 3d distance then we are done with the loop
-	if( distance > maxDist )continue;
-	
-	
-	// This is the tight constraint on the hits
-	if (consistentPairs(hitPairO, hitPairI))
-	  {
-	    double    bestBin = distance;
-	    double bestDist = 10000.;
-            
-	    if (bestTripletMap.find(bestBin) != bestTripletMap.end())  //Look at a given case of error (a given bin) and pull out the best (shortest) distance
-	      {
-		bestDist = bestTripletMap[bestBin].first;
-	      }
-	    
-	    double newDist = fabs(hitPairI->getX() - hitPairO->getX());
-            
-	    // This is an attempt to "prefer" triplets over pairs
-	    if (hitPairI->getHits().size() < 3) newDist += 25.;
-            
-	    if (newDist < bestDist) bestTripletMap[bestBin] = std::pair<double, const reco::ClusterHit3D*>(newDist, hitPairI); //Select the pair of hits that is closest in time
-            
-	  }
-	
-	bestTripletMap[distance] = std::pair<double,const reco::ClusterHit3D*>(distance,hitPairI);
-	
-      }
-    
-    for(const auto& bestMapItr : bestTripletMap)
-      {
-	const reco::ClusterHit3D* hitPairI(bestMapItr.second.second);
-        
-	hitPairOPair.first.incrementCount();
-	hitPairOPair.second.emplace_back(hitPairI);
-	
-	epsPairNeighborhoodMapVec[hitPairI->getID()].second.first.incrementCount();
-	epsPairNeighborhoodMapVec[hitPairI->getID()].second.second.emplace_back(hitPairO);
-        
-	consistentPairsCnt++;
-      }
+  for (size_t posO = 0; posO < nHits; posO++){
+    const size_t hitPairOID = sortedHits[posO]->getID();
+    for (size_t bin = 0; bin < nBins; bin++){
+      const long posI = bestInBin[posO * nBins + bin];
+      if (posI < 0) continue;
+      forwardCount[hitPairOID]++;
+      backwardCount[sortedHits[posI]->getID()]++;
+      consistentPairsCnt++;
+    }
+  }
+  
+  neighborhoods.m_offsets.assign(nIDs + 1, 0);
+  for (size_t id = 0; id < nIDs; id++){
+    neighborhoods.m_offsets[id + 1] = neighborhoods.m_offsets[id] + backwardCount[id] + forwardCount[id];
+    neighborhoods.m_params[id].incrementCount(backwardCount[id] + forwardCount[id]);
+  }
+  neighborhoods.m_neighbors.resize(neighborhoods.m_offsets[nIDs]);
+  
+  std::vector<size_t> backwardFill(neighborhoods.m_offsets.begin(), neighborhoods.m_offsets.end() - 1);
+  for (size_t posO = 0; posO < nHits; posO++){
+    const size_t hitPairOID  = sortedHits[posO]->getID();
+    size_t       forwardFill = neighborhoods.m_offsets[hitPairOID] + backwardCount[hitPairOID];
+    for (size_t bin = 0; bin < nBins; bin++){
+      const long posI = bestInBin[posO * nBins + bin];
+      if (posI < 0) continue;
+      const size_t hitPairIID = sortedHits[posI]->getID();
+      neighborhoods.m_neighbors[forwardFill++] = hitPairIID;
+      neighborhoods.m_neighbors[backwardFill[hitPairIID]++] = hitPairOID;
+    }
   }
   
-  mf::LogDebug("Cluster3D") << "Consistent pairs: " << consistentPairsCnt << " of " << pairsChecked << " checked." << std::endl;
+  mf::LogDebug("Cluster3D") << "Consistent pairs: " << consistentPairsCnt << " of " << nHits << " hits." << std::endl;
   
   return consistentPairsCnt;
   
@@ -18,6 +18,8 @@
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardata/RecoObjects/Cluster3D.h"
 
+#include "dunereco/DBSCAN/DBSCAN.h"
+
 // std includes
 #include <vector>
 #include <list>
@@ -78,7 +80,12 @@ typedef std::map<geo::View_t, WireToHitSetMap >              ViewToWireToHitSetM
 typedef std::map<geo::View_t, HitVector >                    HitVectorMap;
     
 typedef std::vector<std::unique_ptr<reco::ClusterHit3D> >    HitPairVector;
-typedef std::list<std::unique_ptr<reco::ClusterHit3D> >      HitPairList;
+
+/**
+ *  @brief The 3D hits of an event, held contiguously. The clusters point into it, so it must not
+ *         change once ClusterHitsDBScan has returned
+ */
+typedef std::vector<reco::ClusterHit3D>                      HitPairList;
 
 /**
  *  @brief  DBScanAlg_DUNE35t class definiton
@@ -158,25 +165,31 @@ private:
      */
     bool consistentPairs(const reco::ClusterHit3D* pair1, const reco::ClusterHit3D* pair2) const;
     
-    typedef std::list<const reco::ClusterHit3D*>                           EpsPairNeighborhoodList;
-    typedef std::pair<DBScanParams, EpsPairNeighborhoodList >              EpsPairNeighborhoodPair;
-    typedef std::map<const reco::ClusterHit3D*, EpsPairNeighborhoodPair >  EpsPairNeighborhoodMap;
-    typedef std::pair<const reco::ClusterHit3D*, EpsPairNeighborhoodPair > EpsPairNeighborhoodMapPair;
-    typedef std::vector<EpsPairNeighborhoodMapPair >                       EpsPairNeighborhoodMapVec;
+    /**
+     *  @brief The epsilon neighborhoods of all 3D hits, indexed by hit ID, in compressed sparse row
+     *         form: the neighbors of hit i are m_neighbors[m_offsets[i]] to m_neighbors[m_offsets[i+1]-1]
+     */
+    struct EpsPairNeighborhoods
+    {
+        std::vector<const reco::ClusterHit3D*> m_hits;       ///< The hit with each ID, null if filtered out
+        std::vector<DBScanParams>              m_params;     ///< The DBScan state of each hit
+        std::vector<size_t>                    m_offsets;    ///< Start of each hit's neighbors, one past the end for the last
+        std::vector<size_t>                    m_neighbors;  ///< IDs of the neighbors of all hits, concatenated
+    };
     
     /**
      *  @brief the main routine for DBScan
      */
-    void expandCluster(EpsPairNeighborhoodMapVec&          nMap,
-                       EpsPairNeighborhoodMapVec::iterator vecItr,
-                       reco::HitPairListPtr&               cluster,
-                       size_t                              minPts) const;
+    void expandCluster(EpsPairNeighborhoods&  neighborhoods,
+                       size_t                 hitID,
+                       reco::HitPairListPtr&  cluster,
+                       size_t                 minPts) const;
     
     /**
      *  @brief Given an input HitPairList, build out the map of nearest neighbors
      */
     size_t BuildNeighborhoodMap(HitPairList& hitPairList,
-				EpsPairNeighborhoodMapVec& epsPairNeighborhoodMapVec )const;
+				EpsPairNeighborhoods& neighborhoods )const;
 
     
     /** 
@@ -194,6 +207,9 @@ private:
     double                    m_timeAdvanceGap;
     double                    m_numSigmaPeakTime;
     double                    m_EpsMaxDist;
+    bool                      m_parallelNeighborhood;  ///< Build the neighborhoods with multiple threads
+    bool                      m_parallelPairing;       ///< Pair the hits of each TPC in its own thread
+    dune::dbscan::Config      m_dbscanConfig;          ///< Device of the neighborhood search
 
     bool                      m_enableMonitoring;      ///<
     int                       m_hits;                  ///<
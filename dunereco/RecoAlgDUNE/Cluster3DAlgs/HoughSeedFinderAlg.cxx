@@ -38,6 +38,9 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -46,6 +49,24 @@
 
 namespace lar_cluster3d {
 
+class HoughSeedFinderAlg::HoughDisplay
+{
+    /**
+     *  @brief Draws the accumulator of each Hough transform on its own canvas
+     *
+     *         The canvases are all that the seed finder keeps from one call to the next, so they
+     *         live here behind a lock instead of in the (const) algorithm
+     */
+public:
+    void draw(const RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap, int rhoBins, int thetaBins);
+    
+private:
+    std::mutex                             m_mutex;
+    int                                    m_histCount = 0;
+    std::vector<std::unique_ptr<TCanvas> > m_Canvases;           ///< Graphical trace canvases.
+    std::vector<TVirtualPad*>              m_Pads;               ///< View pads in current canvas.
+};
+
 HoughSeedFinderAlg::HoughSeedFinderAlg(fhicl::ParameterSet const &pset) :
      m_minimum3DHits(5),
      m_thetaBins(360),
@@ -90,6 +111,8 @@ void HoughSeedFinderAlg::reconfigure(fhicl::ParameterSet const &pset)
     m_maximumGap         = pset.get<double>("MaximumGap",             5.);
     m_displayHist        = pset.get<bool>  ("DisplayHoughHist",    false);
     
+    if (m_displayHist && !m_display) m_display = std::make_unique<HoughDisplay>();
+    
     m_pcaAlg.reconfigure(pset.get<fhicl::ParameterSet>("PrincipalComponentsAlg"));
 }
     
@@ -103,19 +126,20 @@ class AccumulatorValues
      *         that hit in the input container
      */
 public:
-    AccumulatorValues() : m_position(0.,0.,0.) {}
-    AccumulatorValues(const TVector3& position, const reco::HitPairListPtr::const_iterator& itr) :
+    AccumulatorValues() : m_position{0.,0.} {}
+    AccumulatorValues(const dune_ana::Vec2& position, const reco::HitPairListPtr::const_iterator& itr) :
          m_position(position), m_hit3DIterator(itr) {}
      
-    const TVector3&                      getPosition()    const {return m_position;}
+    const dune_ana::Vec2&                getPosition()    const {return m_position;}
     reco::HitPairListPtr::const_iterator getHitIterator() const {return m_hit3DIterator;}
      
 private:
-    TVector3                             m_position;       ///< We really only need the x,y coordinates here but keep all three for now
+    dune_ana::Vec2                       m_position;       ///< The x,y coordinates in the PCA plane
     reco::HitPairListPtr::const_iterator m_hit3DIterator;  ///< This will be used to take us back to our 3D hit
 };
      
-typedef std::vector<AccumulatorValues> AccumulatorValuesVec;
+typedef std::vector<AccumulatorValues>       AccumulatorValuesVec;
+typedef std::vector<const AccumulatorValues*> AccumulatorValuesPtrVec;
      
 class HoughSeedFinderAlg::AccumulatorBin
 {
@@ -127,27 +151,70 @@ class HoughSeedFinderAlg::AccumulatorBin
      */
 public:
     AccumulatorBin() : m_visited(false), m_noise(false), m_inCluster(false) {}
-    AccumulatorBin(AccumulatorValues& values) : m_visited(false), m_noise(false), m_inCluster(false)
-    {
-        m_accumulatorValuesVec.push_back(values);
-    }
      
     void setVisited()   {m_visited   = true;}
     void setNoise()     {m_noise     = true;}
     void setInCluster() {m_inCluster = true;}
      
-    void addAccumulatorValue(AccumulatorValues& value) {m_accumulatorValuesVec.push_back(value);}
+    void addAccumulatorValue(const AccumulatorValues* value) {m_accumulatorValuesVec.push_back(value);}
      
     bool isVisited()   const {return m_visited;}
     bool isNoise()     const {return m_noise;}
     bool isInCluster() const {return m_inCluster;}
      
-    const AccumulatorValuesVec& getAccumulatorValues() const {return m_accumulatorValuesVec;}
+    const AccumulatorValuesPtrVec& getAccumulatorValues() const {return m_accumulatorValuesVec;}
+private:
+    bool                    m_visited;
+    bool                    m_noise;
+    bool                    m_inCluster;
+    AccumulatorValuesPtrVec m_accumulatorValuesVec;  ///< Points into the values owned by the accumulator
+};
+
+class HoughSeedFinderAlg::RhoThetaAccumulatorBinMap
+{
+    /**
+     *  @brief The rho-theta accumulator, a dense array of bins stored theta fastest
+     *
+     *         The rho range is set from the hits before voting, so every vote is a direct
+     *         index. It also owns the accumulator values the bins point to.
+     */
+public:
+    RhoThetaAccumulatorBinMap() : m_minRho(0), m_rhoBins(0), m_thetaBins(0) {}
+     
+    void reset(int maxAbsRhoIdx, int thetaBins, size_t numValues)
+    {
+        m_minRho    = -maxAbsRhoIdx;
+        m_rhoBins   = 2 * maxAbsRhoIdx + 1;
+        m_thetaBins = thetaBins;
+        m_bins.assign(size_t(m_rhoBins) * size_t(m_thetaBins), AccumulatorBin());
+        m_values.clear();
+        m_values.reserve(numValues);   // The bins point into this so it must not reallocate
+    }
+     
+    const AccumulatorValues* addValue(const AccumulatorValues& value) {m_values.push_back(value); return &m_values.back();}
+     
+    bool   contains(const BinIndex& bin) const
+    {
+        return bin.first  >= m_minRho && bin.first  < m_minRho + m_rhoBins &&
+               bin.second >= 0        && bin.second < m_thetaBins;
+    }
+    size_t flatIndex(const BinIndex& bin)  const {return size_t(bin.first - m_minRho) * m_thetaBins + bin.second;}
+    BinIndex binIndex(size_t flatIdx)      const {return BinIndex(int(flatIdx / m_thetaBins) + m_minRho, int(flatIdx % m_thetaBins));}
+    size_t size()                          const {return m_bins.size();}
+     
+    AccumulatorBin&       operator[](const BinIndex& bin)       {return m_bins[flatIndex(bin)];}
+    AccumulatorBin&       operator[](size_t flatIdx)            {return m_bins[flatIdx];}
+    const AccumulatorBin& operator[](size_t flatIdx)      const {return m_bins[flatIdx];}
+     
+    /// Number of entries in a bin, 0 for bins outside the array
+    size_t count(const BinIndex& bin) const {return contains(bin) ? m_bins[flatIndex(bin)].getAccumulatorValues().size() : 0;}
+     
 private:
-    bool                 m_visited;
-    bool                 m_noise;
-    bool                 m_inCluster;
-    AccumulatorValuesVec m_accumulatorValuesVec;
+    int                         m_minRho;
+    int                         m_rhoBins;
+    int                         m_thetaBins;
+    std::vector<AccumulatorBin> m_bins;
+    AccumulatorValuesVec        m_values;
 };
 
 class HoughSeedFinderAlg::SortHoughClusterList
@@ -164,9 +231,9 @@ public:
         size_t peakCountRight(0);
      
         for(const auto& binIndex : left)
-            peakCountLeft = std::max(peakCountLeft, m_accMap[binIndex].getAccumulatorValues().size());
+            peakCountLeft = std::max(peakCountLeft, m_accMap.count(binIndex));
         for(const auto& binIndex : right)
-            peakCountRight = std::max(peakCountRight, m_accMap[binIndex].getAccumulatorValues().size());
+            peakCountRight = std::max(peakCountRight, m_accMap.count(binIndex));
      
         return peakCountLeft > peakCountRight;
     }
@@ -174,20 +241,6 @@ private:
     HoughSeedFinderAlg::RhoThetaAccumulatorBinMap& m_accMap;
 };
     
-struct HoughSeedFinderAlg::SortBinIndexList
-{
-    /**
-     *  @brief This is used to sort bins in Hough Space
-     */
-    bool operator()(const HoughSeedFinderAlg::RhoThetaAccumulatorBinMap::iterator& left, const HoughSeedFinderAlg::RhoThetaAccumulatorBinMap::iterator& right)
-    {
-        size_t leftSize  = left->second.getAccumulatorValues().size();
-        size_t rightSize = right->second.getAccumulatorValues().size();
-     
-        return  leftSize > rightSize;
-    }
-};
-     
     
 void HoughSeedFinderAlg::HoughRegionQuery(BinIndex&                  curBin,
                                           RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap,
@@ -212,13 +265,11 @@ void HoughSeedFinderAlg::HoughRegionQuery(BinIndex&                  curBin,
             if      (thetaIdx < 0)             thetaIdx = m_thetaBins - 1;
             else if (thetaIdx > m_thetaBins -1) thetaIdx = 0;
             
-            BinIndex                            binIndex(rhoIdx,thetaIdx);
-            RhoThetaAccumulatorBinMap::iterator mapItr = rhoThetaAccumulatorBinMap.find(binIndex);
+            // Bins outside the array, or empty, have no entries and so never pass
+            BinIndex binIndex(rhoIdx,thetaIdx);
+            size_t   binCount = rhoThetaAccumulatorBinMap.count(binIndex);
             
-            if (mapItr != rhoThetaAccumulatorBinMap.end())
-            {
-                if (mapItr->second.getAccumulatorValues().size() >= threshold) neighborPts.push_back(binIndex);
-            }
+            if (binCount > 0 && binCount >= threshold) neighborPts.push_back(binIndex);
         }
     }
     
@@ -238,25 +289,23 @@ void HoughSeedFinderAlg::expandHoughCluster(BinIndex&                  curBin,
     // Start by adding the input point to our Hough Cluster
     houghCluster.push_back(curBin);
     
-    for(auto& binIndex : neighborPts)
+    // Note the neighbor list grows as we go, so loop by index
+    HoughCluster nextNeighborPts;
+    
+    for(size_t neighborIdx = 0; neighborIdx < neighborPts.size(); neighborIdx++)
     {
-        AccumulatorBin& accBin = rhoThetaAccumulatorBinMap[binIndex];
+        BinIndex        binIndex = neighborPts[neighborIdx];
+        AccumulatorBin& accBin   = rhoThetaAccumulatorBinMap[binIndex];
         
         if (!accBin.isVisited())
         {
             accBin.setVisited();
             
-            HoughCluster nextNeighborPts;
+            nextNeighborPts.clear();
             
             HoughRegionQuery(binIndex, rhoThetaAccumulatorBinMap, nextNeighborPts, threshold);
             
-            if(!nextNeighborPts.empty())
-            {
-                for(auto& neighborIdx : nextNeighborPts)
-                {
-                    neighborPts.push_back(neighborIdx);
-                }
-            }
+            neighborPts.insert(neighborPts.end(), nextNeighborPts.begin(), nextNeighborPts.end());
         }
         
         if (!accBin.isInCluster())
@@ -371,6 +420,52 @@ void HoughSeedFinderAlg::findHitGaps(reco::HitPairListPtr&      inputHitList,
     return;
 }
     
+void HoughSeedFinderAlg::HoughDisplay::draw(const RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap, int rhoBins, int thetaBins)
+{
+    // ROOT object creation is not thread safe, and the canvases are shared
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::ostringstream ostr;
+    ostr << "Hough Histogram " << m_histCount++;
+    m_Canvases.emplace_back(new TCanvas(ostr.str().c_str(), ostr.str().c_str(), 1000, 1000));
+    
+    std::ostringstream ostr2;
+    ostr2 << "Plane";
+    
+    m_Canvases.back()->GetFrame()->SetFillColor(46);
+    m_Canvases.back()->SetFillColor(19);
+    m_Canvases.back()->SetBorderMode(19);
+    m_Canvases.back()->cd(1);
+    
+    double zmin = 0.06;
+    double zmax = 0.94;
+    double xmin = 0.04;
+    double xmax = 0.95;
+    TPad* p = new TPad(ostr2.str().c_str(), ostr2.str().c_str(), zmin, xmin, zmax, xmax);
+    p->SetBit(kCanDelete);   // Give away ownership.
+    p->Range(zmin, xmin, zmax, xmax);
+    p->SetFillStyle(4000);   // Transparent.
+    p->Draw();
+    m_Pads.push_back(p);
+    
+    TH2D* houghHist = new TH2D("HoughHist", "Hough Space", 2*rhoBins, -rhoBins+0.5, rhoBins+0.5, thetaBins, 0., thetaBins);
+    
+    for(size_t flatIdx = 0; flatIdx < rhoThetaAccumulatorBinMap.size(); flatIdx++)
+    {
+        const AccumulatorBin& accBin = rhoThetaAccumulatorBinMap[flatIdx];
+        
+        if (accBin.getAccumulatorValues().empty()) continue;
+        
+        BinIndex binIndex = rhoThetaAccumulatorBinMap.binIndex(flatIdx);
+        
+        houghHist->Fill(binIndex.first, binIndex.second+0.5, accBin.getAccumulatorValues().size());
+    }
+    
+    houghHist->SetBit(kCanDelete);
+    houghHist->Draw();
+    m_Canvases.back()->Update();
+}
+    
 void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairListPtr,
                                            reco::PrincipalComponents&  pca,
                                            int&                        nLoops,
@@ -386,16 +481,14 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
     // Unfortunately, the following may not be suitable viewing for those who may be feint of heart
     //
     // Define some constants
-    static int   histCount(0);
     const double maxTheta(M_PI);                               // Obviously, 180 degrees
     const double thetaBinSize(maxTheta/double(m_thetaBins));    // around 4 degrees (45 bins)
     const double rhoBinSizeMin(m_geometry->WirePitch());       // Wire spacing gives a natural bin size?
     
     // Recover the parameters from the Principal Components Analysis that we need to project and accumulate
-    TVector3 pcaCenter(pca.getAvePosition()[0],pca.getAvePosition()[1],pca.getAvePosition()[2]);
-    TVector3 planeVec0(pca.getEigenVectors()[0][0],pca.getEigenVectors()[0][1],pca.getEigenVectors()[0][2]);
-    TVector3 planeVec1(pca.getEigenVectors()[1][0],pca.getEigenVectors()[1][1],pca.getEigenVectors()[1][2]);
-    TVector3 pcaPlaneNrml(pca.getEigenVectors()[2][0],pca.getEigenVectors()[2][1],pca.getEigenVectors()[2][2]);
+    const dune_ana::Vec3 pcaCenter{pca.getAvePosition()[0],pca.getAvePosition()[1],pca.getAvePosition()[2]};
+    const dune_ana::Vec3 planeVec0{pca.getEigenVectors()[0][0],pca.getEigenVectors()[0][1],pca.getEigenVectors()[0][2]};
+    const dune_ana::Vec3 planeVec1{pca.getEigenVectors()[1][0],pca.getEigenVectors()[1][1],pca.getEigenVectors()[1][2]};
     double   eigenVal0  = 3. * sqrt(pca.getEigenValues()[0]);
     double   eigenVal1  = 3. * sqrt(pca.getEigenValues()[1]);
     double   maxRho     = std::sqrt(eigenVal0*eigenVal0 + eigenVal1*eigenVal1) * 2. / 3.;
@@ -410,7 +503,11 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
     size_t maxBinCount(0);
     int    nAccepted3DHits(0);
     
-    // Commence looping over the input 3D hits and fill our accumulator bins
+    // Project the skeleton hits to the plane first, this also tells us the range of rho
+    std::vector<reco::HitPairListPtr::const_iterator> acceptedHitItrs;
+    std::vector<dune_ana::Vec2>                       acceptedHitPlaneVecs;
+    double                                            maxPlaneDist(0.);
+    
     for(reco::HitPairListPtr::const_iterator hit3DItr  = hitPairListPtr.begin();
                                              hit3DItr != hitPairListPtr.end();
                                              hit3DItr++)
@@ -423,76 +520,59 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
         
         nAccepted3DHits++;
         
-        TVector3 hit3DPosition(hit3D->getPosition()[0], hit3D->getPosition()[1], hit3D->getPosition()[2]);
-        TVector3 pcaToHitVec = hit3DPosition - pcaCenter;
-        TVector3 pcaToHitPlaneVec(pcaToHitVec.Dot(planeVec0), pcaToHitVec.Dot(planeVec1), 0.);
+        const dune_ana::Vec3 hit3DPosition{hit3D->getPosition()[0], hit3D->getPosition()[1], hit3D->getPosition()[2]};
+        const dune_ana::Vec3 pcaToHitVec = hit3DPosition - pcaCenter;
+        const dune_ana::Vec2 pcaToHitPlaneVec{pcaToHitVec.Dot(planeVec0), pcaToHitVec.Dot(planeVec1)};
+        
+        acceptedHitItrs.push_back(hit3DItr);
+        acceptedHitPlaneVecs.push_back(pcaToHitPlaneVec);
+        maxPlaneDist = std::max(maxPlaneDist, pcaToHitPlaneVec.Mag());
+    }
+    
+    // |rho| can never exceed the distance of the hit from the center, leave a bin for rounding
+    rhoThetaAccumulatorBinMap.reset(int(std::ceil(maxPlaneDist / rhoBinSize)) + 1, m_thetaBins, acceptedHitItrs.size());
+    
+    // The angles are the same for every hit so tabulate them once
+    std::vector<double> cosTheta(m_thetaBins);
+    std::vector<double> sinTheta(m_thetaBins);
+    
+    for(int thetaIdx = 0; thetaIdx < m_thetaBins; thetaIdx++)
+    {
+        // We need to convert our theta index to an angle
+        double theta = thetaBinSize * double(thetaIdx);
         
-        double   xPcaToHit = pcaToHitPlaneVec[0];
-        double   yPcaToHit = pcaToHitPlaneVec[1];
+        cosTheta[thetaIdx] = std::cos(theta);
+        sinTheta[thetaIdx] = std::sin(theta);
+    }
+    
+    std::vector<int> rhoIndices(m_thetaBins);
+    
+    // Commence looping over the accepted 3D hits and fill our accumulator bins
+    for(size_t hitIdx = 0; hitIdx < acceptedHitItrs.size(); hitIdx++)
+    {
+        double xPcaToHit = acceptedHitPlaneVecs[hitIdx].x;
+        double yPcaToHit = acceptedHitPlaneVecs[hitIdx].y;
         
         // Create an accumulator value
-        AccumulatorValues accValue(pcaToHitPlaneVec, hit3DItr);
+        const AccumulatorValues* accValue = rhoThetaAccumulatorBinMap.addValue(AccumulatorValues(acceptedHitPlaneVecs[hitIdx], acceptedHitItrs[hitIdx]));
         
-        // Commence loop over theta to fill accumulator bins
+        // Compute rho for all angles in one go, then accumulate
         // Note that with theta in the range 0-pi then we can have negative values for rho
-        for(int thetaIdx  = 0; thetaIdx < m_thetaBins; thetaIdx++)
+        for(int thetaIdx = 0; thetaIdx < m_thetaBins; thetaIdx++)
+            rhoIndices[thetaIdx] = std::round((xPcaToHit * cosTheta[thetaIdx] + yPcaToHit * sinTheta[thetaIdx]) / rhoBinSize);
+        
+        for(int thetaIdx = 0; thetaIdx < m_thetaBins; thetaIdx++)
         {
-            // We need to convert our theta index to an angle
-            double theta  = thetaBinSize * double(thetaIdx);
-            
-            // calculate rho for this angle
-            double rho    = xPcaToHit * std::cos(theta) + yPcaToHit * std::sin(theta);
-            
-            // Get the rho index
-            int    rhoIdx = std::round(rho / rhoBinSize);
+            AccumulatorBin& accBin = rhoThetaAccumulatorBinMap[BinIndex(rhoIndices[thetaIdx], thetaIdx)];
             
-            // Accumulate
-            BinIndex binIndex(rhoIdx, thetaIdx);
+            accBin.addAccumulatorValue(accValue);
             
-            rhoThetaAccumulatorBinMap[binIndex].addAccumulatorValue(accValue);
-            
-            if (rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues().size() > maxBinCount)
-                maxBinCount = rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues().size();
+            maxBinCount = std::max(maxBinCount, accBin.getAccumulatorValues().size());
         }
     }
     
     // Accumulation done, if asked now display the hist
-    if (m_displayHist)
-    {
-        std::ostringstream ostr;
-        ostr << "Hough Histogram " << histCount++;
-        m_Canvases.emplace_back(new TCanvas(ostr.str().c_str(), ostr.str().c_str(), 1000, 1000));
-        
-        std::ostringstream ostr2;
-        ostr2 << "Plane";
-        
-        m_Canvases.back()->GetFrame()->SetFillColor(46);
-        m_Canvases.back()->SetFillColor(19);
-        m_Canvases.back()->SetBorderMode(19);
-        m_Canvases.back()->cd(1);
-        
-        double zmin = 0.06;
-        double zmax = 0.94;
-        double xmin = 0.04;
-        double xmax = 0.95;
-        TPad* p = new TPad(ostr2.str().c_str(), ostr2.str().c_str(), zmin, xmin, zmax, xmax);
-        p->SetBit(kCanDelete);   // Give away ownership.
-        p->Range(zmin, xmin, zmax, xmax);
-        p->SetFillStyle(4000);   // Transparent.
-        p->Draw();
-        m_Pads.push_back(p);
-        
-        TH2D* houghHist = new TH2D("HoughHist", "Hough Space", 2*m_rhoBins, -m_rhoBins+0.5, m_rhoBins+0.5, m_thetaBins, 0., m_thetaBins);
-        
-        for(const auto& rhoThetaMap : rhoThetaAccumulatorBinMap)
-        {
-            houghHist->Fill(rhoThetaMap.first.first, rhoThetaMap.first.second+0.5, rhoThetaMap.second.getAccumulatorValues().size());
-        }
-        
-        houghHist->SetBit(kCanDelete);
-        houghHist->Draw();
-        m_Canvases.back()->Update();
-    }
+    if (m_displayHist) m_display->draw(rhoThetaAccumulatorBinMap, m_rhoBins, m_thetaBins);
     
     // **********************************************************************
     // Part II: Use DBScan (or a slight variation) to find clusters of bins
@@ -501,38 +581,40 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
     size_t thresholdLo = std::max(size_t(m_hiThresholdFrac*nAccepted3DHits), m_hiThresholdMin);
     size_t thresholdHi = m_loThresholdFrac * maxBinCount;
     
-    std::list<RhoThetaAccumulatorBinMap::iterator> binIndexList;
+    // The occupied bins in (rho, theta) order, then (stably) by decreasing count
+    std::vector<size_t> binIndexList;
     
-    for(RhoThetaAccumulatorBinMap::iterator mapItr  = rhoThetaAccumulatorBinMap.begin();
-        mapItr != rhoThetaAccumulatorBinMap.end();
-        mapItr++)
-        binIndexList.push_back(mapItr);
+    for(size_t flatIdx = 0; flatIdx < rhoThetaAccumulatorBinMap.size(); flatIdx++)
+        if (!rhoThetaAccumulatorBinMap[flatIdx].getAccumulatorValues().empty()) binIndexList.push_back(flatIdx);
     
-    binIndexList.sort(SortBinIndexList());
+    std::stable_sort(binIndexList.begin(), binIndexList.end(), [&rhoThetaAccumulatorBinMap](size_t left, size_t right)
+        {return rhoThetaAccumulatorBinMap[left].getAccumulatorValues().size() > rhoThetaAccumulatorBinMap[right].getAccumulatorValues().size();});
     
-    for(auto& mapItr : binIndexList)
+    for(size_t flatIdx : binIndexList)
     {
+        AccumulatorBin& accBin = rhoThetaAccumulatorBinMap[flatIdx];
+        
         // If we have been here before we skip
-        //if (mapItr.second.isVisited()) continue;
-        if (mapItr->second.isInCluster()) continue;
+        //if (accBin.isVisited()) continue;
+        if (accBin.isInCluster()) continue;
         
         // Mark this bin as visited
         // Actually, don't mark it since we are double thresholding and don't want it missed
-        //mapItr.second.setVisited();
+        //accBin.setVisited();
         
         // Make sure over threshold
-        if (mapItr->second.getAccumulatorValues().size() < thresholdLo)
+        if (accBin.getAccumulatorValues().size() < thresholdLo)
         {
-            mapItr->second.setNoise();
+            accBin.setNoise();
             continue;
         }
         
         // Set the low threshold to make sure we merge bins that might be either side of a boundary trajectory
-        thresholdHi = std::max(size_t(m_loThresholdFrac * mapItr->second.getAccumulatorValues().size()), m_hiThresholdMin);
+        thresholdHi = std::max(size_t(m_loThresholdFrac * accBin.getAccumulatorValues().size()), m_hiThresholdMin);
         
         // Recover our neighborhood
         HoughCluster neighborhood;
-        BinIndex     curBin(mapItr->first);
+        BinIndex     curBin(rhoThetaAccumulatorBinMap.binIndex(flatIdx));
         
         HoughRegionQuery(curBin, rhoThetaAccumulatorBinMap, neighborhood, thresholdHi);
         
@@ -626,8 +708,8 @@ bool HoughSeedFinderAlg::buildSeed(reco::HitPairListPtr& seed3DHits, SeedHitPair
     
     if (seedHitSet.size() >= 10)
     {
-        TVector3 newSeedPos;
-        TVector3 newSeedDir;
+        dune_ana::Vec3 newSeedPos;
+        dune_ana::Vec3 newSeedDir;
         double   chiDOF;
     
         LineFit2DHits(seedHitSet, seedStart[0], newSeedPos, newSeedDir, chiDOF);
@@ -635,16 +717,16 @@ bool HoughSeedFinderAlg::buildSeed(reco::HitPairListPtr& seed3DHits, SeedHitPair
         if (chiDOF > 0.)
         {
             // check angles between new/old directions
-            double cosAng = seedDir[0]*newSeedDir[0]+seedDir[1]*newSeedDir[1]+seedDir[2]*newSeedDir[2];
+            double cosAng = seedDir[0]*newSeedDir.x+seedDir[1]*newSeedDir.y+seedDir[2]*newSeedDir.z;
             
-            if (cosAng < 0.) newSeedDir *= -1.;
+            if (cosAng < 0.) newSeedDir = newSeedDir * -1.;
             
-            seedStart[0] = newSeedPos[0];
-            seedStart[1] = newSeedPos[1];
-            seedStart[2] = newSeedPos[2];
-            seedDir[0]   = newSeedDir[0];
-            seedDir[1]   = newSeedDir[1];
-            seedDir[2]   = newSeedDir[2];
+            seedStart[0] = newSeedPos.x;
+            seedStart[1] = newSeedPos.y;
+            seedStart[2] = newSeedPos.z;
+            seedDir[0]   = newSeedDir.x;
+            seedDir[1]   = newSeedDir.y;
+            seedDir[2]   = newSeedDir.z;
         }
     }
 
@@ -747,7 +829,7 @@ bool HoughSeedFinderAlg::findTrackSeeds(reco::HitPairListPtr&      inputHitPairL
                     // Recover the hits associated to this cluster
                     for(auto& hitItr : rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues())
                     {
-                        reco::HitPairListPtr::const_iterator hit3DItr = hitItr.getHitIterator();
+                        reco::HitPairListPtr::const_iterator hit3DItr = hitItr->getHitIterator();
                         
                         tempHitPtrList.insert(*hit3DItr);
                     }
@@ -928,7 +1010,7 @@ bool HoughSeedFinderAlg::findTrackHits(reco::HitPairListPtr&      inputHitPairLi
                 // Recover the hits associated to this cluster
                 for(auto& hitItr : rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues())
                 {
-                    reco::HitPairListPtr::const_iterator hit3DItr = hitItr.getHitIterator();
+                    reco::HitPairListPtr::const_iterator hit3DItr = hitItr->getHitIterator();
                     
                     tempHitPtrList.insert(*hit3DItr);
                 }
@@ -988,8 +1070,8 @@ bool HoughSeedFinderAlg::findTrackHits(reco::HitPairListPtr&      inputHitPairLi
 //------------------------------------------------------------------------------
 void HoughSeedFinderAlg::LineFit2DHits(std::set<const reco::ClusterHit2D*>& hit2DSet,
                                        double                               XOrigin,
-                                       TVector3&                            Pos,
-                                       TVector3&                            Dir,
+                                       dune_ana::Vec3&                      Pos,
+                                       dune_ana::Vec3&                      Dir,
                                        double&                              ChiDOF) const
 {
     // The following is lifted from Bruce Baller to try to get better
@@ -1096,13 +1178,13 @@ void HoughSeedFinderAlg::LineFit2DHits(std::set<const reco::ClusterHit2D*>& hit2
     ChiDOF /= (float)(npts - 4);
     
     double norm = sqrt(1 + tVec[2] * tVec[2] + tVec[3] * tVec[3]);
-    Dir[0] = 1 / norm;
-    Dir[1] = tVec[2] / norm;
-    Dir[2] = tVec[3] / norm;
+    Dir.x = 1 / norm;
+    Dir.y = tVec[2] / norm;
+    Dir.z = tVec[3] / norm;
     
-    Pos[0] = XOrigin;
-    Pos[1] = tVec[0];
-    Pos[2] = tVec[1];
+    Pos.x = XOrigin;
+    Pos.y = tVec[0];
+    Pos.z = tVec[1];
     
 } // TrkLineFit()
     
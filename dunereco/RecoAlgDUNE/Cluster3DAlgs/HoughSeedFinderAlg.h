@@ -14,12 +14,16 @@
 #include "larcore/Geometry/Geometry.h"
 #include "lardataobj/RecoBase/Seed.h"
 #include "lardata/RecoObjects/Cluster3D.h"
+#include "dunereco/AnaUtils/DUNEAnaVector.h"
 
 // ROOT includes
 #include "TCanvas.h"
 #include "TFrame.h"
 #include "TH2D.h"
 
+// std includes
+#include <memory>
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 namespace lar_cluster3d
@@ -78,14 +82,14 @@ private:
      */
 
     class  AccumulatorBin;
+    class  RhoThetaAccumulatorBinMap;
     class  SortHoughClusterList;
-    struct SortBinIndexList;
+    class  HoughDisplay;
     
-    // Basic structure for holding our accumlator bins (to avoid a full array)
-    // structure will be rho bin for first key, theta bin for second key
+    // Bins are indexed by rho bin first, theta bin second. The accumulator itself is a dense
+    // array covering the range of rho reachable by the hits, see RhoThetaAccumulatorBinMap
     typedef std::pair<int, int>                BinIndex;
-    typedef std::map<BinIndex, AccumulatorBin> RhoThetaAccumulatorBinMap;
-    typedef std::list<BinIndex>                HoughCluster;
+    typedef std::vector<BinIndex>              HoughCluster;
     typedef std::list<HoughCluster >           HoughClusterList;
     
     void HoughRegionQuery(BinIndex& curBin, RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap, HoughCluster& neighborPts, size_t threshold) const;
@@ -107,7 +111,7 @@ private:
      */
     bool buildSeed(reco::HitPairListPtr& seed3DHits, SeedHitPairListPair& seedHitPair) const;
 
-    void LineFit2DHits(std::set<const reco::ClusterHit2D*>& hitList, double XOrigin, TVector3& Pos, TVector3& Dir, double& ChiDOF) const;
+    void LineFit2DHits(std::set<const reco::ClusterHit2D*>& hitList, double XOrigin, dune_ana::Vec3& Pos, dune_ana::Vec3& Dir, double& ChiDOF) const;
     
     size_t                                         m_minimum3DHits;      ///<
     int                                            m_thetaBins;          ///<
@@ -127,8 +131,7 @@ private:
     PrincipalComponentsAlg                         m_pcaAlg;             // For running Principal Components Analysis
     
     bool                                           m_displayHist;
-    mutable std::vector<std::unique_ptr<TCanvas> > m_Canvases;           ///< Graphical trace canvases.
-    mutable std::vector<TVirtualPad*>              m_Pads;               ///< View pads in current canvas.
+    std::unique_ptr<HoughDisplay>                  m_display;            ///< Debug drawing of the accumulators, only made if displaying
 };
 
 } // namespace lar_cluster3d
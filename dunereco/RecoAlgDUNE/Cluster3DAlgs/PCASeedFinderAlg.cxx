@@ -137,8 +137,8 @@ bool PCASeedFinderAlg::findTrackSeeds(reco::HitPairListPtr&      inputHitPairLis
                 
                 if (hit3DList.size() > 10)
                 {
-                    TVector3 newSeedPos;
-                    TVector3 newSeedDir;
+                    dune_ana::Vec3 newSeedPos;
+                    dune_ana::Vec3 newSeedDir;
                     double   chiDOF;
                 
                     LineFit2DHits(hit3DList, seedStart[0], newSeedPos, newSeedDir, chiDOF);
@@ -146,16 +146,16 @@ bool PCASeedFinderAlg::findTrackSeeds(reco::HitPairListPtr&      inputHitPairLis
                     if (chiDOF > 0.)
                     {
                         // check angles between new/old directions
-                        double cosAng = seedDir[0]*newSeedDir[0]+seedDir[1]*newSeedDir[1]+seedDir[2]*newSeedDir[2];
+                        double cosAng = seedDir[0]*newSeedDir.x+seedDir[1]*newSeedDir.y+seedDir[2]*newSeedDir.z;
                     
-                        if (cosAng < 0.) newSeedDir *= -1.;
+                        if (cosAng < 0.) newSeedDir = newSeedDir * -1.;
                     
-                        seedStart[0] = newSeedPos[0];
-                        seedStart[1] = newSeedPos[1];
-                        seedStart[2] = newSeedPos[2];
-                        seedDir[0]   = newSeedDir[0];
-                        seedDir[1]   = newSeedDir[1];
-                        seedDir[2]   = newSeedDir[2];
+                        seedStart[0] = newSeedPos.x;
+                        seedStart[1] = newSeedPos.y;
+                        seedStart[2] = newSeedPos.z;
+                        seedDir[0]   = newSeedDir.x;
+                        seedDir[1]   = newSeedDir.y;
+                        seedDir[2]   = newSeedDir.z;
                     }
                 }
             
@@ -184,6 +184,17 @@ bool PCASeedFinderAlg::getHitsAtEnd(reco::HitPairListPtr& hit3DList, reco::Princ
     reco::HitPairListPtr::iterator startItr = hit3DList.begin();
     reco::HitPairListPtr::iterator lastItr  = hit3DList.begin();
     
+    // Keep the moments of the skeleton hits in [startItr, lastItr) as we go, so the
+    // pca of the selected hits does not need another pass over them
+    PCAMoments moments;
+    
+    auto addSkeletonHit = [&moments](const reco::ClusterHit3D* hit3D)
+    {
+        if ((hit3D->getStatusBits() & 0x10000000) == 0x10000000) moments.addHit(hit3D);
+    };
+    
+    addSkeletonHit(hit3DList.front());
+    
     while(++lastItr != hit3DList.end())
     {
         const reco::ClusterHit3D* hit3D  = *lastItr;
@@ -193,6 +204,7 @@ bool PCASeedFinderAlg::getHitsAtEnd(reco::HitPairListPtr& hit3DList, reco::Princ
         {
             startItr = lastItr;
             hit2DSet.clear();
+            moments.clear();
         }
         
         for(const auto& hit2D : hit3D->getHits())
@@ -202,6 +214,8 @@ bool PCASeedFinderAlg::getHitsAtEnd(reco::HitPairListPtr& hit3DList, reco::Princ
         
         if (hit2DSet.size() > m_numSeed2DHits) break;
         
+        addSkeletonHit(hit3D);
+        
         lastArcLen = arcLen;
     }
     
@@ -213,7 +227,7 @@ bool PCASeedFinderAlg::getHitsAtEnd(reco::HitPairListPtr& hit3DList, reco::Princ
         // On input, the seedPca will contain the original values so we can recover the original axis now
         TVector3 planeVec0(seedPca.getEigenVectors()[0][0],seedPca.getEigenVectors()[0][1],seedPca.getEigenVectors()[0][2]);
         
-        m_pcaAlg.PCAAnalysis_3D(hit3DList, seedPca, true);
+        m_pcaAlg.PCAAnalysis_3D(moments, seedPca);
         
         if (seedPca.getSvdOK())
         {
@@ -237,8 +251,8 @@ bool PCASeedFinderAlg::getHitsAtEnd(reco::HitPairListPtr& hit3DList, reco::Princ
 //------------------------------------------------------------------------------
 void PCASeedFinderAlg::LineFit2DHits(const reco::HitPairListPtr& hit3DList,
                                      double                      XOrigin,
-                                     TVector3&                   Pos,
-                                     TVector3&                   Dir,
+                                     dune_ana::Vec3&             Pos,
+                                     dune_ana::Vec3&             Dir,
                                      double&                     ChiDOF) const
 {
     // The following is lifted from Bruce Baller to try to get better
@@ -352,13 +366,13 @@ void PCASeedFinderAlg::LineFit2DHits(const reco::HitPairListPtr& hit3DList,
     ChiDOF /= (float)(npts - 4);
     
     double norm = sqrt(1 + tVec[2] * tVec[2] + tVec[3] * tVec[3]);
-    Dir[0] = 1 / norm;
-    Dir[1] = tVec[2] / norm;
-    Dir[2] = tVec[3] / norm;
+    Dir.x = 1 / norm;
+    Dir.y = tVec[2] / norm;
+    Dir.z = tVec[3] / norm;
     
-    Pos[0] = XOrigin;
-    Pos[1] = tVec[0];
-    Pos[2] = tVec[1];
+    Pos.x = XOrigin;
+    Pos.y = tVec[0];
+    Pos.z = tVec[1];
     
 } // TrkLineFit()
 
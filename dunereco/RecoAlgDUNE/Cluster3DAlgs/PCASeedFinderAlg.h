@@ -17,6 +17,7 @@
 #include "larcore/Geometry/Geometry.h"
 #include "lardataobj/RecoBase/Seed.h"
 #include "lardata/RecoObjects/Cluster3D.h"
+#include "dunereco/AnaUtils/DUNEAnaVector.h"
 
 // ROOT includes
 #include "TCanvas.h"
@@ -65,7 +66,7 @@ private:
      */
     bool getHitsAtEnd(reco::HitPairListPtr& hit3DList, reco::PrincipalComponents& seedPca) const;
     
-    void LineFit2DHits(const reco::HitPairListPtr& hitList, double XOrigin, TVector3& Pos, TVector3& Dir, double& ChiDOF) const;
+    void LineFit2DHits(const reco::HitPairListPtr& hitList, double XOrigin, dune_ana::Vec3& Pos, dune_ana::Vec3& Dir, double& ChiDOF) const;
 
     geo::Geometry*                         m_geometry;         // pointer to the Geometry service
     //    const detinfo::DetectorProperties*    m_detector;         // Pointer to the detector properties
@@ -32,6 +32,8 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <cmath>
+#include <vector>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // implementation follows
@@ -232,50 +234,34 @@ void PrincipalComponentsAlg::PCAAnalysis_3D(const reco::HitPairListPtr& hitPairV
     // 4) extract the eigen vectors and values
     // see what happens
     
-    // Run through the HitPairList and get the mean position of all the hits
-    double meanPos[] = {0.,0.,0.};
-    int    numPairsInt(0);
+    // Accumulate the mean position and covariance of the hits in one pass
+    PCAMoments moments;
     
     for (const auto& hit : hitPairVector)
     {
         if (skeletonOnly && !((hit->getStatusBits() & 0x10000000) == 0x10000000)) continue;
         
-        meanPos[0] += hit->getPosition()[0];
-        meanPos[1] += hit->getPosition()[1];
-        meanPos[2] += hit->getPosition()[2];
-        numPairsInt++;
+        moments.addHit(hit);
     }
     
-    double numPairs = double(numPairsInt);
+    PCAAnalysis_3D(moments, pca);
     
-    meanPos[0] /= numPairs;
-    meanPos[1] /= numPairs;
-    meanPos[2] /= numPairs;
+    return;
+}
+    
+void PrincipalComponentsAlg::PCAAnalysis_3D(const PCAMoments& moments, reco::PrincipalComponents& pca) const
+{
+    int    numPairsInt(moments.getNumHits());
+    double numPairs = double(numPairsInt);
+    double meanPos[] = {moments.getAvePosition()[0], moments.getAvePosition()[1], moments.getAvePosition()[2]};
     
     // Define elements of our covariance matrix
-    double xi2  = 0.;
-    double xiyi = 0.;
-    double xizi = 0.;
-    double yi2  = 0.;
-    double yizi = 0.;
-    double zi2  = 0.;
-    
-    // Back through the hits to build the matrix
-    for (const auto& hit : hitPairVector)
-    {
-        if (skeletonOnly && !((hit->getStatusBits() & 0x10000000) == 0x10000000)) continue;
-        
-        double x = hit->getPosition()[0] - meanPos[0];
-        double y = hit->getPosition()[1] - meanPos[1];
-        double z = hit->getPosition()[2] - meanPos[2];
-        
-        xi2  += x * x;
-        xiyi += x * y;
-        xizi += x * z;
-        yi2  += y * y;
-        yizi += y * z;
-        zi2  += z * z;
-    }
+    double xi2  = moments.getSum(0,0);
+    double xiyi = moments.getSum(0,1);
+    double xizi = moments.getSum(0,2);
+    double yi2  = moments.getSum(1,1);
+    double yizi = moments.getSum(1,2);
+    double zi2  = moments.getSum(2,2);
     
     // Create the actual matrix
     TMatrixD sigma(3, 3);
@@ -612,6 +598,51 @@ void PrincipalComponentsAlg::PCAAnalysis_2D(const reco::HitPairListPtr& hitPairV
     return;
 }
     
+void PrincipalComponentsAlg::calc3DDocas(const reco::HitPairListPtr&      hitPairVector,
+                                         const reco::PrincipalComponents& pca,
+                                         std::vector<double>&             docas,
+                                         std::vector<double>&             arcLens) const
+{
+    // We'll need the current PCA axis to determine doca and arclen
+    const double avePosition[] = {pca.getAvePosition()[0], pca.getAvePosition()[1], pca.getAvePosition()[2]};
+    const double axisDirVec[]  = {pca.getEigenVectors()[0][0], pca.getEigenVectors()[0][1], pca.getEigenVectors()[0][2]};
+    
+    // Gather the hit positions, the list itself is not contiguous
+    const size_t        numHits(hitPairVector.size());
+    std::vector<double> positions(3 * numHits);
+    size_t              hitIdx(0);
+    
+    for (const auto* clusterHit3D : hitPairVector)
+    {
+        positions[3*hitIdx    ] = clusterHit3D->getPosition()[0];
+        positions[3*hitIdx + 1] = clusterHit3D->getPosition()[1];
+        positions[3*hitIdx + 2] = clusterHit3D->getPosition()[2];
+        hitIdx++;
+    }
+    
+    docas.resize(numHits);
+    arcLens.resize(numHits);
+    
+    for (size_t idx = 0; idx < numHits; idx++)
+    {
+        // Vector from the cluster average position to the hit and the arclength to the doca point
+        const double clusToHitX   = positions[3*idx    ] - avePosition[0];
+        const double clusToHitY   = positions[3*idx + 1] - avePosition[1];
+        const double clusToHitZ   = positions[3*idx + 2] - avePosition[2];
+        const double arclenToPoca = clusToHitX * axisDirVec[0] + clusToHitY * axisDirVec[1] + clusToHitZ * axisDirVec[2];
+        
+        // Now get doca from the coordinates along the axis for this point
+        const double deltaX = positions[3*idx    ] - (avePosition[0] + arclenToPoca * axisDirVec[0]);
+        const double deltaY = positions[3*idx + 1] - (avePosition[1] + arclenToPoca * axisDirVec[1]);
+        const double deltaZ = positions[3*idx + 2] - (avePosition[2] + arclenToPoca * axisDirVec[2]);
+        
+        docas[idx]   = std::sqrt(deltaX*deltaX + deltaY*deltaY + deltaZ*deltaZ);
+        arcLens[idx] = arclenToPoca;
+    }
+    
+    return;
+}
+    
 void PrincipalComponentsAlg::PCAAnalysis_calc3DDocas(const reco::HitPairListPtr& hitPairVector,
                                                      const reco::PrincipalComponents& pca) const
 {
@@ -619,12 +650,14 @@ void PrincipalComponentsAlg::PCAAnalysis_calc3DDocas(const reco::HitPairListPtr&
     // any outliers. Basically, any hit outside a scaled range of the average doca from the
     // first pass is marked by setting the bit in the status word.
     
-    // We'll need the current PCA axis to determine doca and arclen
-    TVector3 avePosition(pca.getAvePosition()[0], pca.getAvePosition()[1], pca.getAvePosition()[2]);
-    TVector3 axisDirVec(pca.getEigenVectors()[0][0], pca.getEigenVectors()[0][1], pca.getEigenVectors()[0][2]);
+    std::vector<double> docas;
+    std::vector<double> arcLens;
+    
+    calc3DDocas(hitPairVector, pca, docas, arcLens);
     
     // We want to keep track of the average
     double aveDoca3D(0.);
+    size_t hitIdx(0);
     
     // Outer loop over views
     for (const auto* clusterHit3D : hitPairVector)
@@ -632,28 +665,12 @@ void PrincipalComponentsAlg::PCAAnalysis_calc3DDocas(const reco::HitPairListPtr&
         // Always reset the existing status bit
         clusterHit3D->clearStatusBits(0x80);
         
-        // Now we need to calculate the doca and poca...
-        // Start by getting this hits position
-        TVector3 clusPos(clusterHit3D->getPosition()[0],clusterHit3D->getPosition()[1],clusterHit3D->getPosition()[2]);
-        
-        // Form a TVector from this to the cluster average position
-        TVector3 clusToHitVec = clusPos - avePosition;
-        
-        // With this we can get the arclength to the doca point
-        double arclenToPoca = clusToHitVec.Dot(axisDirVec);
-        
-        // Get the coordinates along the axis for this point
-        TVector3 docaPos = avePosition + arclenToPoca * axisDirVec;
-        
-        // Now get doca and poca
-        TVector3 docaPosToClusPos = clusPos - docaPos;
-        double   docaToAxis       = docaPosToClusPos.Mag();
-        
-        aveDoca3D += docaToAxis;
+        aveDoca3D += docas[hitIdx];
         
         // Ok, set the values in the hit
-        clusterHit3D->setDocaToAxis(docaToAxis);
-        clusterHit3D->setArclenToPoca(arclenToPoca);
+        clusterHit3D->setDocaToAxis(docas[hitIdx]);
+        clusterHit3D->setArclenToPoca(arcLens[hitIdx]);
+        hitIdx++;
     }
     
     // Compute the average and store
@@ -788,9 +805,12 @@ int PrincipalComponentsAlg::PCAAnalysis_reject3DOutliers(const reco::HitPairList
     // First get the average doca scaled by some appropriate factor
     int    numRejHits(0);
     
-    // We'll need the current PCA axis to determine doca and arclen
-    TVector3 avePosition(pca.getAvePosition()[0], pca.getAvePosition()[1], pca.getAvePosition()[2]);
-    TVector3 axisDirVec(pca.getEigenVectors()[0][0], pca.getEigenVectors()[0][1], pca.getEigenVectors()[0][2]);
+    std::vector<double> docas;
+    std::vector<double> arcLens;
+    
+    calc3DDocas(hitPairVector, pca, docas, arcLens);
+    
+    size_t hitIdx(0);
     
     // Outer loop over views
     for (const auto* clusterHit3D : hitPairVector)
@@ -798,26 +818,10 @@ int PrincipalComponentsAlg::PCAAnalysis_reject3DOutliers(const reco::HitPairList
         // Always reset the existing status bit
         clusterHit3D->clearStatusBits(0x80);
         
-        // Now we need to calculate the doca and poca...
-        // Start by getting this hits position
-        TVector3 clusPos(clusterHit3D->getPosition()[0],clusterHit3D->getPosition()[1],clusterHit3D->getPosition()[2]);
-        
-        // Form a TVector from this to the cluster average position
-        TVector3 clusToHitVec = clusPos - avePosition;
-        
-        // With this we can get the arclength to the doca point
-        double arclenToPoca = clusToHitVec.Dot(axisDirVec);
-        
-        // Get the coordinates along the axis for this point
-        TVector3 docaPos = avePosition + arclenToPoca * axisDirVec;
-        
-        // Now get doca and poca
-        TVector3 docaPosToClusPos = clusPos - docaPos;
-        double   docaToAxis       = docaPosToClusPos.Mag();
-        
         // Ok, set the values in the hit
-        clusterHit3D->setDocaToAxis(docaToAxis);
-        clusterHit3D->setArclenToPoca(arclenToPoca);
+        clusterHit3D->setDocaToAxis(docas[hitIdx]);
+        clusterHit3D->setArclenToPoca(arcLens[hitIdx]);
+        hitIdx++;
         
         // Check to see if this is a keeper
         if (clusterHit3D->getDocaToAxis() > maxDocaAllowed)
@@ -24,6 +24,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -31,6 +32,78 @@
 namespace lar_cluster3d
 {
 
+/**
+ *  @brief  Running mean and covariance of 3D hit positions
+ *
+ *          Hits can be added and removed one at a time (Welford's updates), so a PCA can be
+ *          refit after trimming a hit list without going back over the hits that remain
+ */
+class PCAMoments
+{
+public:
+    PCAMoments() : m_numHits(0), m_mean{0.,0.,0.}, m_sums{0.,0.,0.,0.,0.,0.} {}
+
+    void addHit(const reco::ClusterHit3D* hit);
+
+    /**
+     *  @brief Remove a hit that was added before
+     */
+    void removeHit(const reco::ClusterHit3D* hit);
+
+    void clear() {*this = PCAMoments();}
+
+    int           getNumHits()     const {return m_numHits;}
+    const double* getAvePosition() const {return m_mean;}
+
+    /**
+     *  @brief Sum over the hits of (x_i - mean_i)(x_j - mean_j), not yet scaled by the number of hits
+     */
+    double        getSum(int i, int j) const {return m_sums[index(i, j)];}
+
+private:
+    static int index(int i, int j) {return i <= j ? 3*i - i*(i+1)/2 + j : index(j, i);}
+
+    int    m_numHits;
+    double m_mean[3];
+    double m_sums[6];   ///< xx, xy, xz, yy, yz, zz
+};
+
+inline void PCAMoments::addHit(const reco::ClusterHit3D* hit)
+{
+    const double pos[] = {hit->getPosition()[0], hit->getPosition()[1], hit->getPosition()[2]};
+    double       deltaOld[3];
+
+    m_numHits++;
+
+    for(int i = 0; i < 3; i++)
+    {
+        deltaOld[i]  = pos[i] - m_mean[i];
+        m_mean[i]   += deltaOld[i] / double(m_numHits);
+    }
+
+    for(int i = 0; i < 3; i++)
+        for(int j = i; j < 3; j++) m_sums[index(i, j)] += deltaOld[i] * (pos[j] - m_mean[j]);
+}
+
+inline void PCAMoments::removeHit(const reco::ClusterHit3D* hit)
+{
+    if (m_numHits < 2) {clear(); return;}
+
+    const double pos[] = {hit->getPosition()[0], hit->getPosition()[1], hit->getPosition()[2]};
+    double       deltaOld[3];
+
+    m_numHits--;
+
+    for(int i = 0; i < 3; i++)
+    {
+        deltaOld[i]  = pos[i] - m_mean[i];
+        m_mean[i]   -= deltaOld[i] / double(m_numHits);
+    }
+
+    for(int i = 0; i < 3; i++)
+        for(int j = i; j < 3; j++) m_sums[index(i, j)] -= deltaOld[i] * (pos[j] - m_mean[j]);
+}
+
 /**
  *  @brief  Cluster3D class
  */
@@ -61,6 +134,11 @@ public:
     
     void PCAAnalysis_3D(const reco::HitPairListPtr& hitPairList, reco::PrincipalComponents& pca, bool skeletonOnly = false)               const;
     
+    /**
+     *  @brief Run the 3D analysis from already accumulated moments
+     */
+    void PCAAnalysis_3D(const PCAMoments& moments, reco::PrincipalComponents& pca)                                                        const;
+    
     void PCAAnalysis_2D(const reco::HitPairListPtr& hitPairVector, reco::PrincipalComponents& pca, bool updateAvePos = false)             const;
     
     void PCAAnalysis_calc3DDocas(const reco::HitPairListPtr& hitPairVector, const reco::PrincipalComponents& pca)                         const;
@@ -74,6 +152,15 @@ public:
     
 
 private:
+    /**
+     *  @brief Compute the 3D doca and arclen to the pca axis of each hit, the positions are copied into a
+     *         contiguous array first so the arithmetic runs as one tight loop
+     */
+    void calc3DDocas(const reco::HitPairListPtr&      hitPairVector,
+                     const reco::PrincipalComponents& pca,
+                     std::vector<double>&             docas,
+                     std::vector<double>&             arcLens)                                                                              const;
+    
     /**
      *  @brief This is used to get the poca, doca and arclen along cluster axis to 2D hit
      */
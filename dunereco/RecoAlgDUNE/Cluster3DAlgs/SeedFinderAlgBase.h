@@ -34,6 +34,11 @@ public:
     /**
      *  @brief Define the interface to take an input list of 3D hits and return seed candidates
      *         so hits are ordered along the axis
+     *
+     *         Implementations keep no state between calls: everything a call needs beyond the
+     *         configuration lives on its stack or in the inputs, and any debug output is kept in
+     *         an object of its own that locks itself. So one instance can be used for several
+     *         clusters at once, as long as the clusters do not share 3D hits
      */
     virtual bool findTrackSeeds(reco::HitPairListPtr&       hitPairListPtr,
                                 reco::PrincipalComponents&  inputPCA,
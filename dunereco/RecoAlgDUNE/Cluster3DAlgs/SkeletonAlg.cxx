@@ -22,6 +22,11 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "tbb/parallel_for.h"
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -47,7 +52,8 @@ void SkeletonAlg::reconfigure(fhicl::ParameterSet const &pset)
     m_maximumDeltaTicks = pset.get<double>("MaximumDeltaTicks", 10.0 );
 }
     
-double SkeletonAlg::FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>& hitVec,
+double SkeletonAlg::FindFirstAndLastWires(const reco::ClusterHit3D* const*        hitBegin,
+                                          const reco::ClusterHit3D* const*        hitEnd,
                                           int                                     viewToCheck,
                                           int                                     referenceWire,
                                           double                                  referenceTicks,
@@ -55,18 +61,21 @@ double SkeletonAlg::FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>
                                           int&                                    lastWire) const
 {
     // In the simple case the first and last wires are simply the front and back of the input vector
-    firstWire = hitVec.front()->getHits()[viewToCheck]->getHit().WireID().Wire;
-    lastWire  = hitVec.back()->getHits()[viewToCheck]->getHit().WireID().Wire;
+    const reco::ClusterHit3D* frontHit = *hitBegin;
+    const reco::ClusterHit3D* backHit  = *(hitEnd - 1);
+    
+    firstWire = frontHit->getHits()[viewToCheck]->getHit().WireID().Wire;
+    lastWire  = backHit->getHits()[viewToCheck]->getHit().WireID().Wire;
     
-    double maxDeltaTicks = referenceTicks - hitVec.front()->getHits()[viewToCheck]->getTimeTicks();
-    double minDeltaTicks = referenceTicks - hitVec.back()->getHits()[viewToCheck]->getTimeTicks();
+    double maxDeltaTicks = referenceTicks - frontHit->getHits()[viewToCheck]->getTimeTicks();
+    double minDeltaTicks = referenceTicks - backHit->getHits()[viewToCheck]->getTimeTicks();
     
     if (minDeltaTicks > maxDeltaTicks) std::swap(maxDeltaTicks, minDeltaTicks);
 
     double bestDeltaTicks = 1000000.;
     
     // Can't have a gap if only one element
-    if (hitVec.size() > 1)
+    if (hitEnd - hitBegin > 1)
     {
         // The issue is that there may be a gap in wires which we need to find.
         // Reset the last wire
@@ -75,8 +84,9 @@ double SkeletonAlg::FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>
         // Keep track of all the deltas
         double nextBestDeltaTicks = bestDeltaTicks;
         
-        for(const auto& hitPair : hitVec)
+        for(const reco::ClusterHit3D* const* hitItr = hitBegin; hitItr != hitEnd; hitItr++)
         {
+            const reco::ClusterHit3D* hitPair = *hitItr;
             int    curWire    = hitPair->getHits()[viewToCheck]->getHit().WireID().Wire;
             double deltaTicks = referenceTicks - hitPair->getHits()[viewToCheck]->getTimeTicks();
             
@@ -150,46 +160,87 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
     // Our mission is to try to find the medial skeletion of the input list of hits
     // We define that as the set of hit pairs where the pairs share the same hit in a given direction
     // and the selected medial hit is equal distance from the edges.
-    // The first step in trying to do this is to build a map which relates a give 2D hit to an ordered list of hitpairs using it
-    typedef std::map<const reco::ClusterHit2D*, std::vector<const reco::ClusterHit3D*> > Hit2DtoHit3DMapU;
-    
-    Hit2DtoHit3DMapU hit2DToHit3DMap[3];
+    // The first step in trying to do this is to build a table which relates a give 2D hit to an ordered list of hitpairs using it.
+    // The 3D hits are numbered in list order and, for each view, the (2D hit, 3D hit) pairs are sorted by 2D hit so the
+    // hit pairs using a 2D hit are one contiguous range of a flat array (compressed rows, one row per 2D hit)
+    std::vector<const reco::ClusterHit3D*> hitPairVec;
     
     for(const auto& hitPair : hitPairList)
     {
         // Don't consider points "rejected" earlier
-        if (hitPair->bitsAreSet(reco::ClusterHit3D::REJECTEDHIT)) continue;
+        if (!hitPair->bitsAreSet(reco::ClusterHit3D::REJECTEDHIT)) hitPairVec.push_back(hitPair);
+    }
+    
+    struct Hit2DUse
+    {
+        const reco::ClusterHit2D* hit2D;
+        size_t                    hitPairIdx;
+        size_t                    hitIdx;     ///< which of the 2D hits of the hit pair
+    };
+    
+    std::vector<Hit2DUse>                  hit2DUses[3];
+    std::vector<const reco::ClusterHit3D*> hit2DToHit3D[3];   // the rows, one after the other
+    std::vector<const reco::ClusterHit2D*> rowHit2D[3];       // the 2D hit of each row, in increasing order
+    std::vector<size_t>                    rowStart[3];       // index of the first entry of each row, plus the end
+    std::vector<size_t>                    hitPairRow(3 * hitPairVec.size(), std::numeric_limits<size_t>::max());
+    
+    for(size_t hitPairIdx = 0; hitPairIdx < hitPairVec.size(); hitPairIdx++)
+    {
+        const std::vector<const reco::ClusterHit2D*>& hits = hitPairVec[hitPairIdx]->getHits();
         
-        for(const auto& hit2D : hitPair->getHits())
+        for(size_t hitIdx = 0; hitIdx < hits.size(); hitIdx++)
         {
-            size_t view = hit2D->getHit().View();
+            size_t view = hits[hitIdx]->getHit().View();
             
-            hit2DToHit3DMap[view][hit2D].push_back(hitPair);
+            hit2DUses[view].push_back({hits[hitIdx], hitPairIdx, hitIdx});
         }
     }
     
-    // Do an explicit loop through to sort?
     for(size_t idx = 0; idx < 3; idx++)
     {
-        for(auto& mapPair : hit2DToHit3DMap[idx])
+        // Within a row keep the order the hit pairs were found in, as they are sorted along the wire from there
+        std::sort(hit2DUses[idx].begin(), hit2DUses[idx].end(), [](const Hit2DUse& left, const Hit2DUse& right)
+            {return std::less<const reco::ClusterHit2D*>()(left.hit2D, right.hit2D) ||
+                    (left.hit2D == right.hit2D && (left.hitPairIdx < right.hitPairIdx ||
+                                                   (left.hitPairIdx == right.hitPairIdx && left.hitIdx < right.hitIdx)));});
+        
+        hit2DToHit3D[idx].reserve(hit2DUses[idx].size());
+        
+        for(const auto& use : hit2DUses[idx])
         {
-            size_t numHitPairs = mapPair.second.size();
+            if (rowHit2D[idx].empty() || rowHit2D[idx].back() != use.hit2D)
+            {
+                rowHit2D[idx].push_back(use.hit2D);
+                rowStart[idx].push_back(hit2DToHit3D[idx].size());
+            }
             
-            if (numHitPairs > 1) std::sort(mapPair.second.begin(), mapPair.second.end(), OrderHitsAlongWire(idx));
+            hit2DToHit3D[idx].push_back(hitPairVec[use.hitPairIdx]);
+            
+            // The lookups below are by position in the hit pair, which is normally the view
+            if (use.hitIdx == idx) hitPairRow[3 * use.hitPairIdx + idx] = rowHit2D[idx].size() - 1;
+        }
+        
+        rowStart[idx].push_back(hit2DToHit3D[idx].size());
+        
+        // Do an explicit loop through to sort?
+        for(size_t row = 0; row + 1 < rowStart[idx].size(); row++)
+        {
+            size_t numHitPairs = rowStart[idx][row + 1] - rowStart[idx][row];
+            
+            if (numHitPairs > 1) std::sort(hit2DToHit3D[idx].begin() + rowStart[idx][row], hit2DToHit3D[idx].begin() + rowStart[idx][row + 1], OrderHitsAlongWire(idx));
         }
     }
     
-    // Keep a count of the number of skeleton points to be returned
-    int nSkeletonPoints(0);
+    // The idea is go through all the hits again and determine if they could be "skeleton" elements.
+    // Each 3D hit only sets its own status bits, so the hits are done in parallel
+    std::vector<char> isPureSkeleton(hitPairVec.size(), 0);
     
-    // The idea is go through all the hits again and determine if they could be "skeleton" elements
-    for(const auto& hitPair : hitPairList)
+    tbb::parallel_for(size_t(0), hitPairVec.size(), [&](size_t hitPairIdx)
     {
-        // Don't consider points "rejected" earlier
-        if (hitPair->bitsAreSet(reco::ClusterHit3D::REJECTEDHIT)) continue;
+        const reco::ClusterHit3D* hitPair = hitPairVec[hitPairIdx];
         
         // If a hit pair we skip for now
-        if (hitPair->getHits().size() < 3) continue;
+        if (hitPair->getHits().size() < 3) return;
         
         // Hopefully I am not confusing myself here.
         // The goal is to know, for a given 3D hit, how many other 3D hits share the 2D hits that it is made of
@@ -219,9 +270,26 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
             const reco::ClusterHit2D* hit2D          = hitPair->getHits()[viewIdx];
             double                    hit2DTimeTicks = hit2D->getTimeTicks();
             
-            std::vector<const reco::ClusterHit3D*>& hitVec(hit2DToHit3DMap[viewIdx][hit2D]);
+            // Find the row of this 2D hit, a 2D hit of the hit pair not in its expected view may still have one
+            size_t row = hitPairRow[3 * hitPairIdx + viewIdx];
+            
+            if (row == std::numeric_limits<size_t>::max())
+            {
+                auto rowItr = std::lower_bound(rowHit2D[viewIdx].begin(), rowHit2D[viewIdx].end(), hit2D, std::less<const reco::ClusterHit2D*>());
+                
+                if (rowItr != rowHit2D[viewIdx].end() && *rowItr == hit2D) row = rowItr - rowHit2D[viewIdx].begin();
+            }
+            
+            const reco::ClusterHit3D* const* hitBegin = hit2DToHit3D[viewIdx].data();
+            const reco::ClusterHit3D* const* hitEnd   = hitBegin;
+            
+            if (row != std::numeric_limits<size_t>::max())
+            {
+                hitEnd    = hitBegin + rowStart[viewIdx][row + 1];
+                hitBegin += rowStart[viewIdx][row];
+            }
             
-            numHitPairs[viewIdx] = hitVec.size();
+            numHitPairs[viewIdx] = hitEnd - hitBegin;
             
             if (numHitPairs[viewIdx] > 1)
             {
@@ -229,7 +297,8 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
                 int firstWire;
                 int lastWire;
                 
-                bestDeltaTicks[viewIdx] = FindFirstAndLastWires(hitVec,
+                bestDeltaTicks[viewIdx] = FindFirstAndLastWires(hitBegin,
+                                                                hitEnd,
                                                                 viewToCheck,
                                                                 wireNumByView[viewToCheck],
                                                                 hit2DTimeTicks,
@@ -288,7 +357,7 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
                     if (nextBestIdx > 2)
                     {
                         std::cout << "***** invalid next best view: " << nextBestIdx << " *******" << std::endl;
-                        continue;
+                        return;
                     }
                     
                     if (viewDeltaT[bestViewIdx] < 1.01*bestDeltaTicks[bestViewIdx] && viewDeltaT[nextBestIdx] < 6.01*bestDeltaTicks[nextBestIdx])
@@ -298,8 +367,11 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
         }
         
         // We want to keep count of "pure" skeleton points only
-        if (hitPair->bitsAreSet(reco::ClusterHit3D::SKELETONHIT) && !hitPair->bitsAreSet(reco::ClusterHit3D::EDGEHIT)) nSkeletonPoints++;
-    }
+        if (hitPair->bitsAreSet(reco::ClusterHit3D::SKELETONHIT) && !hitPair->bitsAreSet(reco::ClusterHit3D::EDGEHIT)) isPureSkeleton[hitPairIdx] = 1;
+    });
+    
+    // Keep a count of the number of skeleton points to be returned
+    int nSkeletonPoints(std::count(isPureSkeleton.begin(), isPureSkeleton.end(), 1));
     
     return nSkeletonPoints;
 }
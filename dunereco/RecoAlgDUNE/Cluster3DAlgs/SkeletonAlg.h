@@ -78,7 +78,8 @@ private:
      *  @brief A function to find the bounding wires in a given view 
      *
      */
-    double FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>& hitVec,
+    double FindFirstAndLastWires(const reco::ClusterHit3D* const*        hitBegin,
+                                 const reco::ClusterHit3D* const*        hitEnd,
                                  int                                     viewToCheck,
                                  int                                     referenceWire,
                                  double                                  referenceTicks,
@@ -1,6 +1,8 @@
 ////////////////////////////////////////////////////////////////////////
 // \file    RegCNNEvaluator_module.cc
-// \brief   Producer module creating RegCNN results modified from CVNEvaluator_module.cc
+// \brief   Producer module creating RegCNN results modified from CVNEvaluator_module.cc,
+//          shared between the schedules with the network calls serialized
+//          in the handlers
 // \author  Ilsoo Seong - iseong@uci.edu
 //
 // Modifications to interface for numu energy estimation
@@ -9,7 +11,10 @@
 ////////////////////////////////////////////////////////////////////////
 
 // C/C++ includes
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <set>
 #include <sstream>
 
 // ROOT includes
@@ -20,7 +25,7 @@
 #include "TVectorD.h"
 
 // Framework includes
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art_root_io/TFileDirectory.h"
@@ -54,21 +59,25 @@
 
 namespace cnn {
 
-  class RegCNNEvaluator : public art::EDProducer {
+  class RegCNNEvaluator : public art::SharedProducer {
 
     public:
 
-      explicit RegCNNEvaluator(fhicl::ParameterSet const& pset);
+      explicit RegCNNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
       ~RegCNNEvaluator();
 
-      void produce(art::Event& evt);
-      void beginJob();
-      void endJob();
+      void produce(art::Event& evt, art::ProcessingFrame const&) override;
+      void beginJob(art::ProcessingFrame const&) override;
+      void endJob(art::ProcessingFrame const&) override;
 
     private:
 
-      void PrepareEvent(const art::Event& event);
-      bool insideContVol(const double posX, const double posY, const double posZ);
+      /// Whether the longest track of the event is contained
+      bool PrepareEvent(const art::Event& event) const;
+      /// Run the networks of one target on the shared input of the pixel map
+      std::vector<float> PredictTarget(const std::string& target, RegCNNSharedInput& input,
+                                       art::Event& evt, bool longestTrackContained);
+      bool insideContVol(const double posX, const double posY, const double posZ) const;
 
       art::ServiceHandle<geo::Geometry> fGeom;
 
@@ -77,6 +86,9 @@ namespace cnn {
       std::string fResultLabel;
       std::string fCNNType;
       std::string fTarget;
+      /// Targets evaluated together on one pixel map, each put as the product
+      /// instance of its name. Empty to evaluate Target alone into ResultLabel
+      std::vector<std::string> fTargets;
 
       cnn::TFRegNetHandler fTFHandler;
       cnn::RegCNNVtxHandler fRegCNNVtxHandler;
@@ -87,19 +99,17 @@ namespace cnn {
 
       double fContVolCut;
 
-      // for checking track status
-      bool fLongestTrackContained;
-
-      void getCM(const RegPixelMap& pm, std::vector<float> &cm_list);
+      void getCM(const RegPixelMap& pm, std::vector<float> &cm_list) const;
   }; // class RegCNNEvaluator
 
   //.......................................................................
-  RegCNNEvaluator::RegCNNEvaluator(fhicl::ParameterSet const& pset):
-    EDProducer(pset),
+  RegCNNEvaluator::RegCNNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&):
+    SharedProducer(pset),
     fPixelMapInput     (pset.get<std::string>         ("PixelMapInput")),
     fResultLabel       (pset.get<std::string>         ("ResultLabel")),
     fCNNType           (pset.get<std::string>         ("CNNType")),
     fTarget            (pset.get<std::string>         ("Target")),
+    fTargets           (pset.get<std::vector<std::string> >("Targets", {})),
     fTFHandler         (pset.get<fhicl::ParameterSet> ("TFNetHandler")),
     fRegCNNVtxHandler  (pset.get<fhicl::ParameterSet> ("RegCNNVtxHandler")),
     fRegCNNNumuHandler (pset.get<fhicl::ParameterSet> ("RegCNNNumuHandler")),
@@ -107,7 +117,27 @@ namespace cnn {
     fTrackModuleLabel  (pset.get<std::string>         ("TrackModuleLabel")),
     fContVolCut        (pset.get<double>              ("ContVolCut"))
   {
-    produces< std::vector<cnn::RegCNNResult> >(fResultLabel);
+    if (fTargets.empty()) {
+      produces< std::vector<cnn::RegCNNResult> >(fResultLabel);
+    }
+    else {
+      std::set<std::string> known = {"nueenergy", "nuevertex", "nuevertex_on_img", "numuenergy"};
+      for (const std::string& target : fTargets) {
+        if (!known.count(target)) {
+          throw art::Exception(art::errors::Configuration)
+            << "RegCNNEvaluator: unknown target " << target << " in Targets";
+        }
+        produces< std::vector<cnn::RegCNNResult> >(target);
+      }
+      // Both run the graph of TFNetHandler
+      if (std::count(fTargets.begin(), fTargets.end(), "nueenergy") &&
+          std::count(fTargets.begin(), fTargets.end(), "nuevertex")) {
+        throw art::Exception(art::errors::Configuration)
+          << "RegCNNEvaluator: nueenergy and nuevertex both use TFNetHandler and can not be evaluated together";
+      }
+    }
+
+    async<art::InEvent>();
   }
 
   //......................................................................
@@ -119,17 +149,17 @@ namespace cnn {
   }
 
   //......................................................................
-  void RegCNNEvaluator::beginJob()
+  void RegCNNEvaluator::beginJob(art::ProcessingFrame const&)
   {  
   }
 
   //......................................................................
-  void RegCNNEvaluator::endJob()
+  void RegCNNEvaluator::endJob(art::ProcessingFrame const&)
   {
   }
 
   //......................................................................
-  void RegCNNEvaluator::getCM(const RegPixelMap& pm, std::vector<float> &cm_list)
+  void RegCNNEvaluator::getCM(const RegPixelMap& pm, std::vector<float> &cm_list) const
   {
     //std::cout << pm.fBound.fFirstWire[0]+pm.fNWire/2 << std::endl;
     //std::cout << pm.fBound.fFirstTDC[0]+pm.fNTdc*pm.fNTRes/2 << std::endl;
@@ -142,10 +172,10 @@ namespace cnn {
   }
 
   //......................................................................
-  void RegCNNEvaluator::produce(art::Event& evt)
+  void RegCNNEvaluator::produce(art::Event& evt, art::ProcessingFrame const&)
   {
 
-    this->PrepareEvent(evt);
+    const bool longestTrackContained = this->PrepareEvent(evt);
 
     /// Define containers for the things we're going to produce
     std::unique_ptr< std::vector<RegCNNResult> >
@@ -171,33 +201,20 @@ namespace cnn {
     if(fCNNType == "TF" || fCNNType == "Tensorflow" || fCNNType == "TensorFlow"){
         // If we have a pixel map then use the TF interface to give us a prediction
         if(pixelmaplist.size() > 0){
-            std::vector<float> networkOutput;
-            if (fTarget == "nueenergy"){
-                networkOutput = fTFHandler.Predict(*pixelmaplist[0]);
-                //std::cout << "-->" << networkOutput[0] << std::endl;
-            }
-            else if (fTarget == "nuevertex"){
-                std::vector<float> center_of_mass(6,0);
-                getCM(*pixelmaplist[0], center_of_mass);
-                std::cout << "cm: " << center_of_mass[0] << " " << center_of_mass[1] << " " << center_of_mass[2] << std::endl;
-                networkOutput = fTFHandler.Predict(*pixelmaplist[0], center_of_mass);
-                std::cout << "cnn nuevertex : "<<networkOutput[0] << " " << networkOutput[1] << " " << networkOutput[2] << std::endl;
-            }
-            else if (fTarget == "nuevertex_on_img"){
-                auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
-                auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt, clockData);
-                networkOutput = fRegCNNVtxHandler.GetVertex(clockData, detProp, evt, *pixelmaplist[0]);
-            } 
-            else if (fTarget == "numuenergy") {
-                networkOutput = fRegCNNNumuHandler.Predict(*pixelmaplist[0], fLongestTrackContained);
+            // The map is converted to the network input once, for all the targets
+            RegCNNSharedInput input(*pixelmaplist[0]);
+            if (fTargets.empty()) {
+                // cnn::Result can now take a vector of floats and works out the number of outputs
+                resultCol->emplace_back(PredictTarget(fTarget, input, evt, longestTrackContained));
             }
             else {
-                std::cout << "Wrong Target with 2D 3-view pixel maps" << std::endl;
-                abort();
+                for (const std::string& target : fTargets) {
+                    std::unique_ptr< std::vector<RegCNNResult> > targetCol(new std::vector<RegCNNResult>);
+                    targetCol->emplace_back(PredictTarget(target, input, evt, longestTrackContained));
+                    evt.put(std::move(targetCol), target);
+                }
+                return;
             }
-
-            // cnn::Result can now take a vector of floats and works out the number of outputs
-            resultCol->emplace_back(networkOutput);
         }
     } else {
         mf::LogError("RegCNNEvaluator::produce") << "CNN Type not in the allowed list: Tensorflow, Torch" << std::endl;
@@ -205,10 +222,48 @@ namespace cnn {
         return;
     } // end fCNNType
 
-    evt.put(std::move(resultCol), fResultLabel);
+    if (fTargets.empty()) {
+        evt.put(std::move(resultCol), fResultLabel);
+    }
+    else {
+        // No pixel map, every target gets an empty collection
+        for (const std::string& target : fTargets) {
+            evt.put(std::make_unique< std::vector<RegCNNResult> >(), target);
+        }
+    }
+  }
+
+  std::vector<float> RegCNNEvaluator::PredictTarget(const std::string& target, RegCNNSharedInput& input,
+                                                    art::Event& evt, bool longestTrackContained)
+  {
+      std::vector<float> networkOutput;
+      if (target == "nueenergy"){
+          networkOutput = fTFHandler.Predict(input);
+          //std::cout << "-->" << networkOutput[0] << std::endl;
+      }
+      else if (target == "nuevertex"){
+          std::vector<float> center_of_mass(6,0);
+          getCM(input.PixelMap(), center_of_mass);
+          std::cout << "cm: " << center_of_mass[0] << " " << center_of_mass[1] << " " << center_of_mass[2] << std::endl;
+          networkOutput = fTFHandler.Predict(input, center_of_mass);
+          std::cout << "cnn nuevertex : "<<networkOutput[0] << " " << networkOutput[1] << " " << networkOutput[2] << std::endl;
+      }
+      else if (target == "nuevertex_on_img"){
+          auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
+          auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt, clockData);
+          networkOutput = fRegCNNVtxHandler.GetVertex(clockData, detProp, evt, input);
+      } 
+      else if (target == "numuenergy") {
+          networkOutput = fRegCNNNumuHandler.Predict(input, longestTrackContained);
+      }
+      else {
+          std::cout << "Wrong Target with 2D 3-view pixel maps" << std::endl;
+          abort();
+      }
+      return networkOutput;
   }
 
-  void RegCNNEvaluator::PrepareEvent(const art::Event& evt) {
+  bool RegCNNEvaluator::PrepareEvent(const art::Event& evt) const {
       // Hits
       auto hitListHandle = evt.getValidHandle<std::vector<recob::Hit>>(fHitsModuleLabel);
 
@@ -234,7 +289,7 @@ namespace cnn {
           }
       }
 
-      fLongestTrackContained = true;
+      bool longestTrackContained = true;
       if (iLongestTrack >= 0 && iLongestTrack <= ntracks-1) {
           if (fmth.isValid()) {
               std::vector< art::Ptr<recob::Hit> > vhit = fmth.at(iLongestTrack);
@@ -243,15 +298,17 @@ namespace cnn {
                       std::vector< art::Ptr<recob::SpacePoint> > spts = fmhs.at(vhit[h].key());
                       if (spts.size()) {
                           if (!insideContVol(spts[0]->XYZ()[0], spts[0]->XYZ()[1], spts[0]->XYZ()[2]))
-                              fLongestTrackContained = false;
+                              longestTrackContained = false;
                       }
                   }
               }
           }
       } // End of search longestTrack
+
+      return longestTrackContained;
   }
 
-  bool RegCNNEvaluator::insideContVol(const double posX, const double posY, const double posZ) {
+  bool RegCNNEvaluator::insideContVol(const double posX, const double posY, const double posZ) const {
       geo::Point_t const vtx{posX, posY, posZ};
       bool inside = false;
 
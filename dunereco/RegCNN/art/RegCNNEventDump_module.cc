@@ -9,6 +9,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // ROOT includes
@@ -44,6 +45,7 @@
 
 #include "dunereco/RegCNN/func/RegPixelMap.h"
 #include "dunereco/RegCNN/func/RegPixelMap3D.h"
+#include "dunereco/CVN/func/AsyncDumpWriter.h"
 
 namespace cnn {
   class RegCNNEventDump : public art::EDAnalyzer {
@@ -67,6 +69,17 @@ namespace cnn {
     bool        fWriteCroppedMapTH3;
     bool        fApplyFidVol;
 
+    // Writer thread filling RegCNNTrainTree with the 2D maps in a file of its own, if
+    // AsyncDump.OutputFile is set
+    std::string  fAsyncFile;
+    unsigned int fAsyncQueueDepth;
+    int          fAsyncCompression;
+    std::unique_ptr<cvn::AsyncDumpWriter> fAsyncWriter;
+    unsigned int fAsyncNPixel; ///< Pixels per map, fixed by the first one written
+
+    /// Queue the map and its truth for the writer thread, opening the file with the first one
+    void WriteAsync(const simb::MCNeutrino& truthN, const RegPixelMap& pm);
+
     //art::ServiceHandle<cheat::BackTracker> fBT;
 
     /// Function to extract TH2 from PixelMap and write to TFile
@@ -97,6 +110,10 @@ namespace cnn {
     fWriteMapTH3         = pset.get<bool>       ("WriteMapTH3");
     fWriteCroppedMapTH3  = pset.get<bool>       ("WriteCroppedMapTH3");
     fApplyFidVol         = pset.get<bool>       ("ApplyFidVol");
+    const fhicl::ParameterSet asyncDump = pset.get<fhicl::ParameterSet>("AsyncDump", fhicl::ParameterSet());
+    fAsyncFile           = asyncDump.get<std::string>("OutputFile", "");
+    fAsyncQueueDepth     = asyncDump.get<unsigned int>("QueueDepth", 16);
+    fAsyncCompression    = asyncDump.get<int>("Compression", -1);
     
   }
 
@@ -109,7 +126,7 @@ namespace cnn {
   //......................................................................
   void RegCNNEventDump::endJob()
   {
-
+    if(fAsyncWriter) fAsyncWriter->Close();
   }
 
   //......................................................................
@@ -171,6 +188,8 @@ namespace cnn {
       if(!isFid) return;
     }
 
+    if (!fAsyncFile.empty() && nhits > 0) WriteAsync(truthN, *pixelmaplist[0]);
+
     // Make a plot of the pixel map if required
     if (fWriteMapTH2) WriteMapTH2(evt, 0, *pixelmaplist[0]);
     if (fWriteMapTH3) WriteMapTH3(evt, 0, *pm3Dlist[0]);
@@ -180,6 +199,35 @@ namespace cnn {
 
   //----------------------------------------------------------------------
 
+  void RegCNNEventDump::WriteAsync(const simb::MCNeutrino& truthN, const RegPixelMap& pm)
+  {
+    const unsigned int nPixel = pm.NInput();
+    if(!fAsyncWriter){
+      fAsyncNPixel = nPixel;
+      const cvn::DumpLayout layout = {{"nuEnergy", 'F', 1}, {"lepEnergy", 'F', 1}, {"pixels", 'F', nPixel},
+                                      {"nuPDG", 'I', 1}, {"lepPDG", 'I', 1}, {"ccnc", 'I', 1}, {"mode", 'I', 1}};
+      fAsyncWriter = std::make_unique<cvn::AsyncDumpWriter>(fAsyncFile, "RegCNNTrainTree", layout,
+                                                            fAsyncQueueDepth, fAsyncCompression);
+    }
+    // The branches have a fixed size
+    if(nPixel != fAsyncNPixel){
+      mf::LogWarning("RegCNNEventDump") << "Skipping a pixel map of " << nPixel << " pixels, "
+                                        << fAsyncFile << " holds maps of " << fAsyncNPixel;
+      return;
+    }
+
+    // In the order of the layout
+    cvn::DumpRecord record = fAsyncWriter->NewRecord();
+    record.floats[0] = truthN.Nu().E();
+    record.floats[1] = truthN.Lepton().E();
+    pm.FillInputVector(record.floats.data() + 2);
+    record.ints[0] = truthN.Nu().PdgCode();
+    record.ints[1] = truthN.Lepton().PdgCode();
+    record.ints[2] = truthN.CCNC();
+    record.ints[3] = truthN.Mode();
+    fAsyncWriter->Write(std::move(record));
+  }
+
 
 
   void RegCNNEventDump::WriteMapTH2(const art::Event& evt, int slice, const RegPixelMap& pm)
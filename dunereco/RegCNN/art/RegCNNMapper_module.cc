@@ -106,6 +106,8 @@ namespace cnn {
     bool fCropped;
     // Use Prong only pixel maps
     bool fProngOnly;
+    // Only keep the hits inside the crop window of cropped 3D maps
+    bool fCropOnly;
     // How many pixels in each dimension
     int fUnitX;
     int fUnitY;
@@ -116,6 +118,10 @@ namespace cnn {
     double fZResolution;
     // generate pixel map by raw charge or by reco. hit
     bool fByHit;
+    // Only store the per view charges of the 2D maps that the network reads
+    bool fNetworkInputOnly;
+    // Centre 2D maps without a vertex on the charge weighted mean of the hits
+    bool fChargeWeightedCentre;
 
     std::string fShowerModuleLabel;
     std::string fTrackModuleLabel;
@@ -149,6 +155,7 @@ namespace cnn {
   fUseThreeDMap     (pset.get<int>                 ("UseThreeDMap")),
   fCropped          (pset.get<bool>                ("Cropped")),
   fProngOnly        (pset.get<bool>                ("ProngOnly")),
+  fCropOnly         (pset.get<bool>                ("CropOnly", false)),
   fUnitX            (pset.get<int>                 ("UnitX")),
   fUnitY            (pset.get<int>                 ("UnitY")),
   fUnitZ            (pset.get<int>                 ("UnitZ")),
@@ -156,6 +163,8 @@ namespace cnn {
   fYResolution      (pset.get<double>              ("YResolution")),
   fZResolution      (pset.get<double>              ("ZResolution")),
   fByHit            (pset.get<bool>                ("ByHit")),
+  fNetworkInputOnly (pset.get<bool>                ("NetworkInputOnly", false)),
+  fChargeWeightedCentre(pset.get<bool>             ("ChargeWeightedCentre", false)),
   fShowerModuleLabel(pset.get<std::string>         ("ShowerModuleLabel")),
   fTrackModuleLabel (pset.get<std::string>         ("TrackModuleLabel")),
   fVertexModuleLabel(pset.get<std::string>         ("VertexModuleLabel")),
@@ -163,8 +172,9 @@ namespace cnn {
   fPandoraNuVertexModuleLabel(pset.get<std::string>("PandoraNuVertexModuleLabel")),
   fRegCNNResultLabel (pset.get<std::string>        ("RegCNNResultLabel")),
   fRegCNNModuleLabel (pset.get<std::string>        ("RegCNNModuleLabel")),
-  fProducer(RegPixelMapProducer(fWireLength, fWireResolution, fTdcWidth, fTimeResolution, fGlobalWireMethod, fProngOnly, fByHit)),
-  fProducer3D(RegPixelMap3DProducer(fUnitX, fUnitY, fUnitZ, fXResolution, fYResolution, fZResolution, fCropped, fProngOnly))
+  fProducer(RegPixelMapProducer(fWireLength, fWireResolution, fTdcWidth, fTimeResolution, fGlobalWireMethod, fProngOnly, fByHit,
+                                       fNetworkInputOnly, fChargeWeightedCentre)),
+  fProducer3D(RegPixelMap3DProducer(fUnitX, fUnitY, fUnitZ, fXResolution, fYResolution, fZResolution, fCropped, fProngOnly, fCropOnly))
     { 
         if (fUseThreeDMap==0) {
             produces< std::vector<cnn::RegPixelMap> >(fClusterPMLabel);
@@ -321,7 +331,7 @@ namespace cnn {
                 }
             }
             // skip if PixelMap is empty
-            if (pm.fInPM) pmCol->push_back(pm);
+            if (pm.fInPM) pmCol->push_back(std::move(pm));
         } // end if fUseThreeDMap==0
         else if (fUseThreeDMap==1) {
             RegPixelMap3D pm;
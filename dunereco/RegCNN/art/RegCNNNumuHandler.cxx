@@ -25,12 +25,18 @@ namespace cnn
   }
  
   std::vector<float> RegCNNNumuHandler::Predict(const RegPixelMap& pm, bool fLongestTrackContained)
+  {
+    RegCNNSharedInput input(pm);
+    return Predict(input, fLongestTrackContained);
+  }
+
+  std::vector<float> RegCNNNumuHandler::Predict(RegCNNSharedInput& input, bool fLongestTrackContained)
   {
     std::vector<float> cnnResults;
     if (fLongestTrackContained) {
-      cnnResults = fTFHandlerContained.Predict(pm);
+      cnnResults = fTFHandlerContained.Predict(input);
     } else {
-      cnnResults = fTFHandlerExiting.Predict(pm);
+      cnnResults = fTFHandlerExiting.Predict(input);
     }
 
     //std::cout << "Number of CNN result vectors " << cnnResults.size() << " with " << cnnResults[0].size() << " categories" << std::endl;
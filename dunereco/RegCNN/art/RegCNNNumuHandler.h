@@ -27,6 +27,7 @@ namespace cnn
 
       /// Return prediction arrays for RegPixelMap
       std::vector<float> Predict(const RegPixelMap& pm, bool fLongestTrackContained);
+      std::vector<float> Predict(RegCNNSharedInput& input, bool fLongestTrackContained);
 
     private:
 
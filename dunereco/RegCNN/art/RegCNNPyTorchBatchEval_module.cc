@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////
+// \file    RegCNNPyTorchBatchEval_module.cc
+// \brief   Analyzer module evaluating the 3D RegCNN on batches of events
+//          and writing the network outputs to a TTree
+// \author  Wenjie Wu - wenjieww@uci.edu
+////////////////////////////////////////////////////////////////////////
+
+// C/C++ includes
+#include <algorithm>
+#include <vector>
+
+// ROOT includes
+#include "TTree.h"
+
+#include "cetlib/getenv.h"
+
+// Framework includes
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/SubRun.h"
+#include "art_root_io/TFileService.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "canvas/Persistency/Common/Ptr.h"
+
+#include "dunereco/RegCNN/func/RegPixelMap3D.h"
+#include "dunereco/RegCNN/art/RegCNNTorchHandler.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+namespace cnn {
+
+    /// Offline evaluator for re-processing at ntuple level. The 3D pixel maps
+    /// of BatchSize events are queued and evaluated in one forward call. The
+    /// queue is also flushed at the end of every subrun and of the job, and
+    /// each output is written to the tree with the ID of its own event.
+    class RegCNNPyTorchBatchEval : public art::EDAnalyzer {
+
+        public:
+            explicit RegCNNPyTorchBatchEval(fhicl::ParameterSet const& pset);
+
+            void analyze(const art::Event& evt) override;
+            void beginJob() override;
+            void endSubRun(const art::SubRun&) override;
+            void endJob() override;
+
+        private:
+
+            /// Evaluate and write out all queued pixel maps
+            void Flush();
+
+            std::string  fLibPath;
+            std::string  fNetwork;
+            std::string  fPixelMapInput;
+            unsigned int fBatchSize;
+            unsigned int fNOutputs;
+            unsigned int fWarmUpPasses;
+            int64_t      fWarmUpInputSide;
+            bool         fLazyLoad;
+
+            RegCNNTorchHandler fTorchHandler;
+
+            /// Queued pixel maps and the events they belong to
+            std::vector<RegPixelMap3D> fQueue;
+            std::vector<art::EventID>  fQueueIDs;
+
+            TTree*             fTree;
+            int                fRun;
+            int                fSubRun;
+            int                fEvent;
+            std::vector<float> fOutput;
+    }; // class RegCNNPyTorchBatchEval
+
+    RegCNNPyTorchBatchEval::RegCNNPyTorchBatchEval(fhicl::ParameterSet const& pset):
+        EDAnalyzer(pset),
+        fLibPath       (cet::getenv(pset.get<std::string>      ("LibPath", ""))),
+        fNetwork       (fLibPath + "/" + pset.get<std::string> ("Network")),
+        fPixelMapInput (pset.get<std::string>                  ("PixelMapInput")),
+        fBatchSize     (std::max(1u, pset.get<unsigned int>    ("BatchSize", 16))),
+        fNOutputs      (pset.get<unsigned int>                 ("NOutputs", 3)),
+        fWarmUpPasses  (pset.get<unsigned int>                 ("WarmUpPasses", 2)),
+        fWarmUpInputSide (pset.get<int64_t>                    ("WarmUpInputSide", 32)),
+        fLazyLoad      (pset.get<bool>                         ("LazyLoad", true)),
+        fTorchHandler  (fNetwork, pset.get<bool>               ("SparseInput", false),
+                        {pset.get<int>("IntraOpThreads", 1), pset.get<int>("InterOpThreads", 1),
+                         dune::numa::ResolveNode(dune::numa::PlacementFromPSet(pset))}),
+        fTree(nullptr)
+    {
+    }
+
+    void RegCNNPyTorchBatchEval::beginJob() {
+        // Warmed up with full batches, the size of all but the last call
+        if (!fLazyLoad) fTorchHandler.EnsureLoaded(fWarmUpInputSide, fBatchSize, fWarmUpPasses);
+        fQueue.reserve(fBatchSize);
+        fQueueIDs.reserve(fBatchSize);
+
+        art::ServiceHandle<art::TFileService> tfs;
+        fTree = tfs->make<TTree>("regcnn3d", "3D RegCNN outputs");
+        fTree->Branch("run",    &fRun);
+        fTree->Branch("subrun", &fSubRun);
+        fTree->Branch("event",  &fEvent);
+        fTree->Branch("output", &fOutput);
+    }
+
+    void RegCNNPyTorchBatchEval::analyze(const art::Event& evt) {
+        art::InputTag itag1(fPixelMapInput, fPixelMapInput);
+        auto pixelmap3DListHandle = evt.getHandle< std::vector< cnn::RegPixelMap3D > >(itag1);
+        if (!pixelmap3DListHandle || pixelmap3DListHandle->empty()) return;
+
+        // The event data is gone once we return, so keep our own copy
+        fQueue.push_back(pixelmap3DListHandle->front());
+        fQueueIDs.push_back(evt.id());
+        if (fQueue.size() >= fBatchSize) Flush();
+    }
+
+    void RegCNNPyTorchBatchEval::endSubRun(const art::SubRun&) {
+        Flush();
+    }
+
+    void RegCNNPyTorchBatchEval::endJob() {
+        Flush();
+    }
+
+    void RegCNNPyTorchBatchEval::Flush() {
+        if (fQueue.empty()) return;
+
+        // A batch can only hold maps of the same size, split on the crop flag
+        unsigned int begin = 0;
+        while (begin < fQueue.size()) {
+            unsigned int end = begin + 1;
+            while (end < fQueue.size() && fQueue[end].IsCroppedPM() == fQueue[begin].IsCroppedPM()) ++end;
+
+            std::vector<const RegPixelMap3D*> batch;
+            for (unsigned int i_pm= begin; i_pm< end; ++i_pm) batch.push_back(&fQueue[i_pm]);
+            fTorchHandler.EnsureLoaded(fWarmUpInputSide, fBatchSize, fWarmUpPasses);
+            std::vector< std::vector<float> > outputs = fTorchHandler.Predict(batch, fNOutputs);
+            mf::LogDebug("RegCNNPyTorchBatchEval::Flush")<<"evaluated a batch of "<<batch.size()<<" pixel maps";
+
+            for (unsigned int i_pm= 0; i_pm< outputs.size(); ++i_pm) {
+                const art::EventID& id = fQueueIDs[begin + i_pm];
+                fRun    = id.run();
+                fSubRun = id.subRun();
+                fEvent  = id.event();
+                fOutput = outputs[i_pm];
+                fTree->Fill();
+            }
+            begin = end;
+        }
+
+        fQueue.clear();
+        fQueueIDs.clear();
+    }
+
+    DEFINE_ART_MODULE(cnn::RegCNNPyTorchBatchEval)
+} // end namespace cnn
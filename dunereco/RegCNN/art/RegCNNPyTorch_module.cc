@@ -2,9 +2,6 @@
 #include <iostream>
 #include <sstream>
 
-#include <torch/script.h>
-#include <torch/torch.h>
-
 #include "cetlib/getenv.h"
 
 // Framework includes
@@ -22,6 +19,8 @@
 
 #include "dunereco/RegCNN/func/RegCNNResult.h"
 #include "dunereco/RegCNN/func/RegPixelMap3D.h"
+#include "dunereco/RegCNN/art/RegCNNTorchHandler.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
 
 namespace cnn {
 
@@ -41,8 +40,14 @@ namespace cnn {
             std::string fNetwork;
             std::string fPixelMapInput;
             std::string fResultLabel;
+            /// Pass the occupied voxels as a sparse COO tensor instead of a dense one
+            bool        fSparseInput;
+            /// Forward passes on an empty map when the network is loaded, and the side of that map
+            unsigned int fWarmUpPasses;
+            int64_t      fWarmUpInputSide;
+            bool         fLazyLoad;
         
-            torch::jit::script::Module module;
+            RegCNNTorchHandler fTorchHandler;
     }; // class RegCNNPyTorch
 
     RegCNNPyTorch::RegCNNPyTorch(fhicl::ParameterSet const& pset):
@@ -50,7 +55,14 @@ namespace cnn {
         fLibPath       (cet::getenv(pset.get<std::string>      ("LibPath", ""))),
         fNetwork       (fLibPath + "/" + pset.get<std::string> ("Network")),
         fPixelMapInput (pset.get<std::string>                  ("PixelMapInput")),
-        fResultLabel   (pset.get<std::string>                  ("ResultLabel"))
+        fResultLabel   (pset.get<std::string>                  ("ResultLabel")),
+        fSparseInput   (pset.get<bool>                         ("SparseInput", false)),
+        fWarmUpPasses  (pset.get<unsigned int>                 ("WarmUpPasses", 2)),
+        fWarmUpInputSide (pset.get<int64_t>                    ("WarmUpInputSide", 32)),
+        fLazyLoad      (pset.get<bool>                         ("LazyLoad", true)),
+        fTorchHandler  (fNetwork, fSparseInput,
+                        {pset.get<int>("IntraOpThreads", 1), pset.get<int>("InterOpThreads", 1),
+                         dune::numa::ResolveNode(dune::numa::PlacementFromPSet(pset))})
     {
         produces<std::vector<cnn::RegCNNResult> >(fResultLabel);
     }
@@ -61,15 +73,7 @@ namespace cnn {
 
     void RegCNNPyTorch::beginJob() {
         std::cout<<"regcnn_torch job begins ...... "<<std::endl;
-        try {
-            // Deserialize the ScriptModule from a file using torch::jit::load().
-            module = torch::jit::load(fNetwork);
-        }
-        catch (const c10::Error& e) {
-            std::cerr<<"error loading the model\n";
-            return;
-        }
-        mf::LogDebug("RegCNNPyTorch::beginJob")<<"loaded model "<<fNetwork<<" ... ok\n";
+        if (!fLazyLoad) fTorchHandler.EnsureLoaded(fWarmUpInputSide, 1, fWarmUpPasses);
     }
 
     void RegCNNPyTorch::endJob() {
@@ -91,33 +95,14 @@ namespace cnn {
         if (pixelmap3Dlist.size() > 0) {
             mf::LogDebug("RegCNNPyTorch::produce")<<"3D pixel map was made for this event, loading it as the input";
 
-            RegPixelMap3D pm = *pixelmap3Dlist[0];
-
-            // Convert RegPixelMap3D to at::Tensor, which is the actual input of the network
-            // Currently we have two configurations for the 3D pixel map
-            // 100*100*100: a pixel map centered at the vertex, need longer evaluation time
-            // 32*32*32: cropped pixel map around the vertex of the interaction from 100*100*100 pm, faster
-            at::Tensor t_pm;
-            if (pm.IsCroppedPM()) {
-                t_pm = torch::from_blob(pm.fPECropped.data(), {1,1,32,32,32});
-            } else {
-                t_pm = torch::from_blob(pm.fPE.data(), {1,1,100,100,100});
-            }
-
-            std::vector<torch::jit::IValue> inputs_pm;
-            inputs_pm.push_back(t_pm);
-            at::Tensor torchOutput = module.forward(inputs_pm).toTensor();
+            const RegPixelMap3D& pm = *pixelmap3Dlist[0];
 
             // Output of the network
             // Currently only direction reconstruction utilizes 3D CNN, which has 3 output represent 3 components
             // Absolute value of 3 output are meaningless, their combination is the direction of the prong
-            std::vector<float> networkOutput;
-            for (unsigned int i= 0; i< 3; ++i) {
-                networkOutput.push_back(torchOutput[0][i].item<float>());
-                std::cout<<torchOutput[0][i].item<float>()<<std::endl;
-            }
-
-            resultCol->emplace_back(networkOutput);
+            fTorchHandler.EnsureLoaded(fWarmUpInputSide, 1, fWarmUpPasses);
+            std::vector< std::vector<float> > batchOutput = fTorchHandler.Predict({&pm}, 3);
+            if (!batchOutput.empty()) resultCol->emplace_back(batchOutput[0]);
 
             //std::cout<<output.slice(/*dim=*/1, /*start=*/0, /*end=*/10) << '\n';
             //std::cout<<output[0]<<std::endl;
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    RegCNNTorchHandler.cxx
+/// \brief   Runs the TorchScript 3D RegCNN on batches of 3D pixel maps
+/// \author  Wenjie Wu - wenjieww@uci.edu
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/RegCNN/art/RegCNNTorchHandler.h"
+
+namespace cnn
+{
+
+  RegCNNTorchHandler::RegCNNTorchHandler(const std::string& network, bool sparseInput,
+                                         const torchrt::ThreadConfig& threads):
+    fNetwork(network),
+    fSparseInput(sparseInput),
+    fThreads(threads)
+  {
+  }
+
+  bool RegCNNTorchHandler::Load()
+  {
+    // Shared with any other module of the job running the same network
+    fModule = torchrt::ModuleRegistry::Instance().Get(fNetwork, torchrt::ModuleOptions(), fThreads);
+    if (!fModule) {
+      mf::LogError("RegCNNTorchHandler::Load")<<"error loading the model "<<fNetwork;
+      return false;
+    }
+    mf::LogDebug("RegCNNTorchHandler::Load")<<"loaded model "<<fNetwork<<" ... ok\n";
+    return true;
+  }
+
+  bool RegCNNTorchHandler::EnsureLoaded(int64_t side, int64_t batch, unsigned int nPasses)
+  {
+    if (!fLoadAttempted) {
+      fLoadAttempted = true;
+      if (Load()) WarmUp(side, batch, nPasses);
+    }
+    return fModule != nullptr;
+  }
+
+  void RegCNNTorchHandler::WarmUp(int64_t side, int64_t batch, unsigned int nPasses)
+  {
+    if (!fModule || nPasses == 0) return;
+
+    at::Tensor input = torch::zeros({batch,1,side,side,side});
+    fModule->WarmUp(fSparseInput ? input.to_sparse() : input, nPasses);
+  }
+
+  at::Tensor RegCNNTorchHandler::DenseInput(const std::vector<const RegPixelMap3D*>& pms)
+  {
+    const int64_t side = InputSide(*pms.front());
+    const int64_t mapSize = side*side*side;
+    fInputBuffer.resize(pms.size()*mapSize);
+    for (unsigned int i_pm= 0; i_pm< pms.size(); ++i_pm) {
+      if (pms[i_pm]->IsCroppedPM()) pms[i_pm]->FillCroppedPM(fMapBuffer);
+      else pms[i_pm]->FillPM(fMapBuffer);
+      std::copy(fMapBuffer.begin(), fMapBuffer.end(), fInputBuffer.begin() + i_pm*mapSize);
+    }
+    const int64_t batch = pms.size();
+    return torch::from_blob(fInputBuffer.data(), {batch,1,side,side,side});
+  }
+
+  at::Tensor RegCNNTorchHandler::SparseInput(const std::vector<const RegPixelMap3D*>& pms)
+  {
+    const int64_t side = InputSide(*pms.front());
+    // (batch, channel, x, y, z) coordinates of the occupied voxels
+    std::vector<int64_t> coords;
+    std::vector<float> values;
+    for (unsigned int i_pm= 0; i_pm< pms.size(); ++i_pm) {
+      const RegPixelMap3D& pm = *pms[i_pm];
+      for (unsigned int i_v= 0; i_v< pm.NVoxels(); ++i_v) {
+        int index = pm.VoxelIndices()[i_v];
+        if (pm.IsCroppedPM()) index = pm.CroppedIndex(index);
+        if (index < 0) continue;
+        coords.insert(coords.end(), {i_pm, 0, index/(side*side), (index/side)%side, index%side});
+        values.push_back(pm.VoxelCharges()[i_v]);
+      }
+    }
+    const int64_t nVoxels = values.size();
+    const int64_t batch = pms.size();
+    at::Tensor t_coords = torch::from_blob(coords.data(), {nVoxels, 5}, torch::kInt64).t().clone();
+    at::Tensor t_values = torch::from_blob(values.data(), {nVoxels}).clone();
+    return torch::sparse_coo_tensor(t_coords, t_values, {batch,1,side,side,side});
+  }
+
+  std::vector< std::vector<float> > RegCNNTorchHandler::Predict(const std::vector<const RegPixelMap3D*>& pms,
+                                                                unsigned int nOutputs)
+  {
+    std::vector< std::vector<float> > result;
+    if (!fModule || pms.empty()) return result;
+
+    // Currently we have two configurations for the 3D pixel map
+    // 100*100*100: a pixel map centered at the vertex, need longer evaluation time
+    // 32*32*32: cropped pixel map around the vertex of the interaction from 100*100*100 pm, faster
+    torch::NoGradGuard noGrad;
+    std::vector<torch::jit::IValue> inputs_pm;
+    inputs_pm.push_back(fSparseInput ? SparseInput(pms) : DenseInput(pms));
+    at::Tensor torchOutput = fModule->Forward(inputs_pm).toTensor().contiguous();
+
+    const float* output = torchOutput.data_ptr<float>();
+    const int64_t stride = torchOutput.size(1);
+    result.resize(pms.size());
+    for (unsigned int i_pm= 0; i_pm< pms.size(); ++i_pm) {
+      result[i_pm].assign(output + i_pm*stride, output + i_pm*stride + std::min<int64_t>(nOutputs, stride));
+    }
+    return result;
+  }
+
+}
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    RegCNNTorchHandler.h
+/// \brief   Runs the TorchScript 3D RegCNN on batches of 3D pixel maps
+/// \author  Wenjie Wu - wenjieww@uci.edu
+////////////////////////////////////////////////////////////////////////
+
+#ifndef REGCNN_TORCHHANDLER_H
+#define REGCNN_TORCHHANDLER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <torch/script.h>
+#include <torch/torch.h>
+
+#include "dunereco/RegCNN/func/RegPixelMap3D.h"
+#include "dunereco/TorchRuntime/TorchModuleRegistry.h"
+
+namespace cnn
+{
+  /// RegCNNTorchHandler, gets a TorchScript network from the job-wide module
+  /// registry and evaluates it on any number of 3D pixel maps in a single
+  /// forward call
+  class RegCNNTorchHandler
+  {
+  public:
+    /// Network is the full path of the traced model.
+    /// With sparseInput the maps are passed as a sparse COO tensor.
+    /// The threading is that of the first libtorch network of the job
+    RegCNNTorchHandler(const std::string& network, bool sparseInput,
+                       const torchrt::ThreadConfig& threads = torchrt::ThreadConfig());
+
+    /// Load the network, returns false if that failed
+    bool Load();
+
+    /// Load and warm up the network on the first call only, so a job
+    /// can defer it to its first pixel map. Returns whether it is loaded
+    bool EnsureLoaded(int64_t side, int64_t batch, unsigned int nPasses);
+
+    /// Run the network nPasses times on empty (batch, 1, side, side, side)
+    /// inputs of the configured kind, side 32 for cropped maps and 100 for
+    /// full ones, so the JIT optimisation is done before the first event
+    void WarmUp(int64_t side, int64_t batch, unsigned int nPasses);
+
+    /// Evaluate the network on all maps together. Returns the first nOutputs
+    /// outputs for each map, in the order of the input. All maps must share
+    /// the same geometry (cropped or not)
+    std::vector< std::vector<float> > Predict(const std::vector<const RegPixelMap3D*>& pms,
+                                              unsigned int nOutputs);
+
+  private:
+    /// Side of the cubic network input for a map
+    int64_t InputSide(const RegPixelMap3D& pm) const {return pm.IsCroppedPM() ? 32 : 100;};
+
+    at::Tensor DenseInput(const std::vector<const RegPixelMap3D*>& pms);
+    at::Tensor SparseInput(const std::vector<const RegPixelMap3D*>& pms);
+
+    std::string fNetwork;
+    bool        fSparseInput;
+    torchrt::ThreadConfig fThreads;
+
+    std::shared_ptr<torchrt::SharedModule> fModule;
+    bool fLoadAttempted = false; ///< A failed load is not retried on every event
+    /// Dense (batch, 1, side, side, side) input buffer, reused between calls
+    std::vector<float> fInputBuffer;
+    /// Single map buffer, reused between calls
+    std::vector<float> fMapBuffer;
+  };
+
+}
+
+#endif  // REGCNN_TORCHHANDLER_H
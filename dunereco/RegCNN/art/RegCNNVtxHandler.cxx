@@ -29,12 +29,20 @@ namespace cnn
     fWireResolution   (pset.get<unsigned short>     ("WireResolution")),
     fGlobalWireMethod (pset.get<int>                ("GlobalWireMethod")),
 //    fProngOnly        (pset.get<bool>               ("ProngOnly")),
-    fProducer      (fWireLength, fWireResolution, fTdcWidth, fTimeResolution, fGlobalWireMethod, 0, 1)
+    fProducer      (fWireLength, fWireResolution, fTdcWidth, fTimeResolution, fGlobalWireMethod, 0, 1, true)
   {
   }
   std::vector<float> RegCNNVtxHandler::GetVertex(detinfo::DetectorClocksData const& clockData,
                                                  detinfo::DetectorPropertiesData const& detProp,
                                                  art::Event &evt, const RegPixelMap &pixelmap){
+      RegCNNSharedInput input(pixelmap);
+      return GetVertex(clockData, detProp, evt, input);
+  }
+
+  std::vector<float> RegCNNVtxHandler::GetVertex(detinfo::DetectorClocksData const& clockData,
+                                                 detinfo::DetectorPropertiesData const& detProp,
+                                                 art::Event &evt, RegCNNSharedInput &input){
+      const RegPixelMap& pixelmap = input.PixelMap();
 
       std::vector< art::Ptr< recob::Hit > > hitlist;
       auto hitListHandle = evt.getHandle< std::vector< recob::Hit > >(fHitsModuleLabel);
@@ -47,7 +55,7 @@ namespace cnn
       std::vector <float> Result(3, -99999);
       if (pixelmap.fInPM){
               std::vector<float> networkOutput(6, -99999);
-              networkOutput = fTFHandler1st.Predict(pixelmap);
+              networkOutput = fTFHandler1st.Predict(input);
               FindGlobalVertices(pixelmap, networkOutput);
               std::vector <float> center_of_mass(7,0);
 	      for (int ii = 0; ii < 6; ii++){
@@ -57,7 +65,10 @@ namespace cnn
               networkOutput[3] -= 9;
 
       	      RegPixelMap pm;
-              pm = fProducer.CreateMap(clockData, detProp, hitlist, fmwire, networkOutput);
+              {
+                std::lock_guard<std::mutex> lock(fProducerMutex);
+                pm = fProducer.CreateMap(clockData, detProp, hitlist, fmwire, networkOutput);
+              }
       	      if (pm.fInPM){
 		      center_of_mass[6] = (float)(pm.fTPC%4); // add TPC info
               	      Result = fTFHandler2nd.Predict(pm, center_of_mass);
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "fhiclcpp/ParameterSet.h"
 #include "art/Framework/Principal/Event.h"
@@ -28,6 +29,10 @@ namespace cnn
     std::vector<float> GetVertex(detinfo::DetectorClocksData const& clockData,
                                  detinfo::DetectorPropertiesData const& detProp,
                                  art::Event& evt, const RegPixelMap &pixelmap);
+    /// As above, the first network reading the shared input of the pixel map
+    std::vector<float> GetVertex(detinfo::DetectorClocksData const& clockData,
+                                 detinfo::DetectorPropertiesData const& detProp,
+                                 art::Event& evt, RegCNNSharedInput &input);
 
   private:
     void FindGlobalVertices(const RegPixelMap &pm, std::vector<float> &outputs);
@@ -43,6 +48,7 @@ namespace cnn
     unsigned int fGlobalWireMethod;
 //    bool fProngOnly;
     RegPixelMapProducer fProducer;
+    std::mutex fProducerMutex; ///< The map producer keeps the wire offsets of the event it works on
 
   };
 
@@ -18,7 +18,7 @@ namespace cnn
 {
   RegPixelMap3DProducer::RegPixelMap3DProducer(int nbinsX, int nbinsY, int nbinsZ,
                     double XResolution, double YResolution, double ZResolution,
-                    bool Cropped, bool ProngOnly):
+                    bool Cropped, bool ProngOnly, bool CropOnly):
     fNBinsX(nbinsX),
     fNBinsY(nbinsY),
     fNBinsZ(nbinsZ),
@@ -26,7 +26,8 @@ namespace cnn
     fLengthY(nbinsY*YResolution),
     fLengthZ(nbinsZ*ZResolution),
     fCropped(Cropped),
-    fProngOnly(ProngOnly)
+    fProngOnly(ProngOnly),
+    fCropOnly(CropOnly)
     {
     }
 
@@ -56,7 +57,9 @@ namespace cnn
   {
       std::cout<<"create 3D pixel maps"<<std::endl;
 
-      RegPixelMap3D pm(bound, Cropped, ProngOnly);
+      // When only the cropped network is used the full grid is never needed,
+      // so hits outside the crop window around the vertex are dropped early
+      RegPixelMap3D pm(bound, Cropped, ProngOnly, fCropOnly);
 
       if (!fmSPFromHits.isValid()) return pm;
 
@@ -65,7 +68,7 @@ namespace cnn
       for (unsigned int ihit= 0; ihit< nhits; ++ihit) {
           // Get hit
           art::Ptr<recob::Hit> hit = cluster.at(ihit);
-          std::vector<art::Ptr<recob::SpacePoint> > sp = fmSPFromHits.at(ihit);
+          std::vector<art::Ptr<recob::SpacePoint> > const& sp = fmSPFromHits.at(ihit);
 
           std::vector<float> coordinates(3);
           if (!sp.empty()) {
@@ -123,7 +126,9 @@ namespace cnn
   {
       std::cout<<"create 3D pixel maps, tag by Shower"<<std::endl;
 
-      RegPixelMap3D pm(bound, Cropped, ProngOnly);
+      // When only the cropped network is used the full grid is never needed,
+      // so hits outside the crop window around the vertex are dropped early
+      RegPixelMap3D pm(bound, Cropped, ProngOnly, fCropOnly);
 
       if (!fmSPFromHits.isValid()) return pm;
 
@@ -132,7 +137,7 @@ namespace cnn
       for (unsigned int ihit= 0; ihit< nhits; ++ihit) {
           // Get hit
           art::Ptr<recob::Hit> hit = cluster.at(ihit);
-          std::vector<art::Ptr<recob::SpacePoint> > sp = fmSPFromHits.at(ihit);
+          std::vector<art::Ptr<recob::SpacePoint> > const& sp = fmSPFromHits.at(ihit);
 
           std::vector<float> coordinates(3);
           if (!sp.empty()) {
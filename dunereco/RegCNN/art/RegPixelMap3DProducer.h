@@ -48,7 +48,7 @@ namespace cnn
         public:
             RegPixelMap3DProducer(int nbinsX, int nbinsY, int nbinsZ,
                     double XResolution, double YResolution, double ZResolution,
-                    bool Cropped, bool ProngOnly);
+                    bool Cropped, bool ProngOnly, bool CropOnly = false);
 
             /// Get boundaries for pixel map representation of cluster
             RegCNNBoundary3D Define3DBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -99,6 +99,7 @@ namespace cnn
             double fLengthZ;
             bool fCropped;
             bool fProngOnly;
+            bool fCropOnly;   ///< only bin hits inside the crop window of cropped maps
 
             art::ServiceHandle<geo::Geometry> geom;
     };
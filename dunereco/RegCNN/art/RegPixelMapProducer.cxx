@@ -12,16 +12,30 @@
 #include  <ostream>
 #include  <list>
 #include  <algorithm>
+#include  <numeric>
 
 #include "larcorealg/Geometry/Exceptions.h" // geo::InvalidWireError
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "dunereco/AnaUtils/DUNEAnaDetectorSnapshot.h"
 #include "dunereco/RegCNN/art/RegPixelMapProducer.h"
 #include  "TVector2.h"
 
 namespace cnn
 {
 
-  RegPixelMapProducer::RegPixelMapProducer(unsigned int nWire, unsigned int wRes, unsigned int nTdc, double tRes, int Global, bool ProngOnly, bool ByHit):
+  namespace
+  {
+    /// RegCNN was trained with the drift and APA times not rounded to ticks
+    cvn::GlobalWireMapper::Options ExactDriftOptions()
+    {
+      cvn::GlobalWireMapper::Options options;
+      options.wholeTickDrift = false;
+      return options;
+    }
+  }
+
+  RegPixelMapProducer::RegPixelMapProducer(unsigned int nWire, unsigned int wRes, unsigned int nTdc, double tRes, int Global, bool ProngOnly, bool ByHit,
+          bool NetworkOnly, bool ChargeWeighted):
   fNWire(nWire),
   fWRes(wRes),
   fNTdc(nTdc),
@@ -29,7 +43,10 @@ namespace cnn
   fGlobalWireMethod(Global),
   fProngOnly(ProngOnly),
   fByHit(ByHit),
-  fOffset{0,0}
+  fNetworkOnly(NetworkOnly),
+  fChargeWeighted(ChargeWeighted),
+  fOffset{0,0},
+  fWireMapper(ExactDriftOptions())
   {}
 
   RegPixelMap RegPixelMapProducer::CreateMap(detinfo::DetectorClocksData const& clockData,
@@ -124,10 +141,13 @@ namespace cnn
           const RegCNNBoundary& bound,
           art::FindManyP<recob::Wire> const& fmwire)
   {
-      RegPixelMap pm(fNWire, fWRes, fNTdc, fTRes, bound, 0);
+      RegPixelMap pm(fNWire, fWRes, fNTdc, fTRes, bound, 0, fNetworkOnly);
 
       if (!fmwire.isValid()) return pm;
 
+      // The wire signals are corrected tick by tick, from the lifetime table of the snapshot
+      const dune_ana::DUNEAnaDetectorSnapshot snapshot(clockData, detProp);
+
       // get all raw adc of every hit wire
       for (size_t iwire = 0; iwire < hitwireidx.size(); ++iwire)
       {
@@ -168,7 +188,7 @@ namespace cnn
               for (int tt = t0_hit; tt <= t1_hit; ++tt)
               {
                   //double correctedadc = (double) signal[tt];
-                  double correctedadc = ( signal[tt] * TMath::Exp( (sampling_rate(clockData) * tt) / (detProp.ElectronLifetime()*1.e3) ) );
+                  double correctedadc = ( signal[tt] * snapshot.TickZeroLifetimeCorrection(tt) );
                   int tdc = tt;
                   if (wireid.TPC%2 == 0) tdc = -tdc;
                   if (fGlobalWireMethod == 2){
@@ -202,7 +222,7 @@ namespace cnn
                                                           const bool& ProngOnly)
   {
 
-      RegPixelMap pm(fNWire, fWRes, fNTdc, fTRes, bound, ProngOnly);
+      RegPixelMap pm(fNWire, fWRes, fNTdc, fTRes, bound, ProngOnly, fNetworkOnly);
 
       if (!fmwire.isValid()) return pm;
 
@@ -258,7 +278,7 @@ namespace cnn
                                                           const bool& ProngOnly)
   {
 
-      RegPixelMap pm(fNWire, fWRes, fNTdc, fTRes, bound, ProngOnly);
+      RegPixelMap pm(fNWire, fWRes, fNTdc, fTRes, bound, ProngOnly, fNetworkOnly);
 
       if (!fmwire.isValid()) return pm;
 
@@ -316,6 +336,17 @@ namespace cnn
 
 
 
+  template <typename T>
+  double RegPixelMapProducer::Mean(const std::vector<T>& values, const std::vector<float>& charges) const
+  {
+    // Views without positive charge fall back to the plain mean
+    double chargesum = fChargeWeighted ? std::accumulate(charges.begin(), charges.end(), 0.0) : 0.;
+    if (chargesum <= 0.)
+      return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+
+    return std::inner_product(values.begin(), values.end(), charges.begin(), 0.0) / chargesum;
+  }
+
   RegCNNBoundary RegPixelMapProducer::DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
                                                      std::vector< art::Ptr< recob::Hit > > const& cluster)
   {
@@ -329,6 +360,11 @@ namespace cnn
     std::vector<int> wire_1;
     std::vector<int> wire_2;
 
+    // Hit charges, the weights of the charge weighted centre
+    std::vector<float> charge_0;
+    std::vector<float> charge_1;
+    std::vector<float> charge_2;
+
     unsigned int temp_wire = cluster[0]->WireID().Wire;
     float temp_time_min = 1e5; //99999;
     float temp_time_max = 0;   //-99999;
@@ -373,36 +409,27 @@ namespace cnn
         if(globalplane==0){
           time_0.push_back(peaktime);
           wire_0.push_back((int)globalWire);
+          charge_0.push_back(cluster[iHit]->Integral());
         }
         if(globalplane==1){
           time_1.push_back(peaktime);
           wire_1.push_back((int)globalWire);
+          charge_1.push_back(cluster[iHit]->Integral());
         }
         if(globalplane==2){
           time_2.push_back(peaktime);
           wire_2.push_back((int)globalWire);
+          charge_2.push_back(cluster[iHit]->Integral());
         }
     }
   
+    double tmean_0 = Mean(time_0, charge_0);
+    double tmean_1 = Mean(time_1, charge_1);
+    double tmean_2 = Mean(time_2, charge_2);
 
-    double tsum_0 = std::accumulate(time_0.begin(), time_0.end(), 0.0);
-    double tmean_0 = tsum_0 / time_0.size();
-
-    double tsum_1 = std::accumulate(time_1.begin(), time_1.end(), 0.0);
-    double tmean_1 = tsum_1 / time_1.size();
-
-    double tsum_2 = std::accumulate(time_2.begin(), time_2.end(), 0.0);
-    double tmean_2 = tsum_2 / time_2.size();
-
-
-    double wiresum_0 = std::accumulate(wire_0.begin(), wire_0.end(), 0.0);
-    double wiremean_0 = wiresum_0 / wire_0.size();
-
-    double wiresum_1 = std::accumulate(wire_1.begin(), wire_1.end(), 0.0);
-    double wiremean_1 = wiresum_1 / wire_1.size();
-
-    double wiresum_2 = std::accumulate(wire_2.begin(), wire_2.end(), 0.0);
-    double wiremean_2 = wiresum_2 / wire_2.size();
+    double wiremean_0 = Mean(wire_0, charge_0);
+    double wiremean_1 = Mean(wire_1, charge_1);
+    double wiremean_2 = Mean(wire_2, charge_2);
 
     //std::cout << "TDC ===> " << round(tmean_0) << " " <<   round(tmean_1) << " " << round(tmean_2) << std::endl;
     //std::cout << "Wire ==> " << round(wiremean_0) << " " << round(wiremean_1) << " " << round(wiremean_2) << std::endl;
@@ -617,72 +644,9 @@ namespace cnn
                                                  const geo::WireID& wireID, double localTDC,
                                                  unsigned int& globalWire, unsigned int& globalPlane, 
                                                  double& globalTDC){
-    unsigned int localWire = wireID.Wire;
-    unsigned int plane = wireID.Plane;
-    unsigned int tpc   = wireID.TPC;
-
-    unsigned int nWiresTPC = 400;
-    unsigned int wireGap = 4;
-    auto const& tpcg = geom->TPC(geo::TPCID{0, tpc});
-    double driftLen = tpcg.DriftDistance();
-    double apaLen = tpcg.Width() - tpcg.ActiveWidth();
-    double driftVel = detProp.DriftVelocity();
-    //unsigned int drift_size = (driftLen / driftVel) * 2;
-    //unsigned int apa_size   = 4*(apaLen / driftVel) * 2;
-    double drift_size = (driftLen / driftVel) * 2;
-    double apa_size   = 4*(apaLen / driftVel) * 2;
-
-    globalWire = 0;
-    globalPlane = 0;
-    // Collection plane has more wires
-    if(plane == 2){
-        nWiresTPC=480;
-        wireGap = 5;
-        globalPlane = 2;
-    }
-    bool includeZGap = true;
-    if(includeZGap) nWiresTPC += wireGap;
-
-  // Workspace geometry has two drift regions
-  //                  |-----|-----| /  /
-  //      y ^         |  3  |  2  |/  /
-  //        | -| z    |-----|-----|  /
-  //        | /       |  1  |  0  | /
-  //  x <---|/        |-----|-----|/
-  //
-  
-    int tpcMod4 = tpc%4;
-    int offset = 0;
-    // Induction views depend on the drift direction
-    if(plane < 2){
-        // For TPCs 0 and 3 keep U and V as defined.
-        if(tpcMod4 == 0 || tpcMod4 == 3){
-          globalPlane = plane;
-      // But reverse the TDCs
-        }
-    // For TPCs 1 and 2, swap U and V.
-        else{
-            if(plane == 0) globalPlane = 1;
-            else globalPlane = 0;
-        }
-    }
-    if(globalPlane != 1){
-        globalWire += (tpc/4)*nWiresTPC + (tpcMod4>1)*offset + localWire;
-    }
-    else{
-        globalWire += ((23-tpc)/4)*nWiresTPC + (tpcMod4>1)*offset + localWire;
-    }
-    
-    if(tpcMod4 == 0 || tpcMod4 == 2){
-        //globalTDC = (float)( drift_size - (double)localTDC );
-        globalTDC =  drift_size - localTDC;
-    }
-    else {
-        //globalTDC = (float)( (double)localTDC + drift_size + apa_size );
-        globalTDC = localTDC + drift_size + apa_size;
-    }
-
-
+    // The 1x2x6 workspace unwrapping of the CVN maps, with exact drift times
+    fWireMapper.GetDUNEGlobalWireTDC(detProp, wireID.Wire, localTDC, wireID.Plane, wireID.TPC,
+                                     globalWire, globalPlane, globalTDC);
   } // end of GetDUNEGlobalWireTDC
 
 }
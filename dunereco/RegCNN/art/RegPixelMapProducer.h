@@ -26,6 +26,7 @@
 
 #include "dunereco/RegCNN/func/RegPixelMap.h"
 #include "dunereco/RegCNN/func/RegCNNBoundary.h"
+#include "dunereco/CVN/art/GlobalWireMapper.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/Wire.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
@@ -46,8 +47,11 @@ namespace cnn
   class RegPixelMapProducer
   {
   public:
+    /// NetworkOnly maps only hold the per view charges the network reads.
+    /// ChargeWeighted centres maps without a vertex on the hit charge
+    /// weighted mean wire and time of each view instead of the plain mean
     RegPixelMapProducer(unsigned int nWire, unsigned int wRes, unsigned int nTdc, double tRes, int Global,
-            bool ProngOnly, bool ByHit);
+            bool ProngOnly, bool ByHit, bool NetworkOnly = false, bool ChargeWeighted = false);
 
     /// Get boundaries for pixel map representation of cluster
     RegCNNBoundary DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -120,6 +124,10 @@ namespace cnn
 
    private:
 
+    /// Mean of the values of one view, weighted by the hit charges if fChargeWeighted
+    template <typename T>
+    double Mean(const std::vector<T>& values, const std::vector<float>& charges) const;
+
     unsigned int      fNWire;  ///< Number of wires, length for pixel maps
     unsigned int      fWRes;
     unsigned int      fNTdc;   ///< Number of tdcs, width of pixel map
@@ -127,6 +135,8 @@ namespace cnn
     int               fGlobalWireMethod;
     bool              fProngOnly;
     bool              fByHit;
+    bool              fNetworkOnly;
+    bool              fChargeWeighted;
     double            fOffset[2];
     std::vector<int> hitwireidx; // collect hit wire
     std::vector<int> tmin_each_wire;
@@ -134,6 +144,7 @@ namespace cnn
     std::vector<float> trms_max_each_wire;
 
     art::ServiceHandle<geo::Geometry> geom;
+    cvn::GlobalWireMapper fWireMapper; ///< Global wire conversions shared with the CVN maps
   };
 
 }
@@ -13,97 +13,227 @@
 
 #include "dunereco/RegCNN/art/TFRegNetHandler.h"
 #include "dunereco/RegCNN/func/RegCNNImageUtils.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+#include "tensorflow/core/framework/tensor.h"
 
 #include "TH2D.h"
 #include "TCanvas.h"
 
+#ifdef DUNERECO_WITH_TRITON
+#include "dunereco/TritonRuntime/TritonRemoteModel.h"
+#endif
+
 namespace cnn
 {
 
+  RegCNNSharedInput::RegCNNSharedInput(const RegPixelMap& pm):
+    fPixelMap(pm)
+  {
+  }
+
+  RegCNNSharedInput::~RegCNNSharedInput() = default;
+
+  const ImageVectorF& RegCNNSharedInput::Image(const std::vector<bool>& reverseViews)
+  {
+    auto it = fImages.find(reverseViews);
+    if (it == fImages.end()){
+      RegCNNImageUtils imageUtils;
+      imageUtils.SetViewReversal(reverseViews);
+      it = fImages.emplace(reverseViews, ImageVectorF()).first;
+      imageUtils.ConvertPixelMapToImageVectorF(fPixelMap, it->second);
+    }
+    return it->second;
+  }
+
+  const std::vector<tensorflow::Tensor>& RegCNNSharedInput::Tensors(const std::vector<bool>& reverseViews, unsigned int ninputs)
+  {
+    const std::pair<std::vector<bool>, unsigned int> key(reverseViews, ninputs);
+    auto it = fTensors.find(key);
+    if (it == fTensors.end()){
+      it = fTensors.emplace(key, tf::RegCNNGraph::makeImageTensors(Image(reverseViews), ninputs)).first;
+    }
+    return it->second;
+  }
+
   TFRegNetHandler::TFRegNetHandler(const fhicl::ParameterSet& pset):
     fLibPath(cet::getenv(pset.get<std::string>("LibPath", ""))),
     //fLibPath((pset.get<std::string>("LibPath", ""))),
     fTFProtoBuf  (fLibPath+"/"+pset.get<std::string>("TFProtoBuf")),
     fInputs(pset.get<unsigned int>("NInputs")),
     fOutputName(pset.get<std::vector<std::string>>("OutputName")),
-    fReverseViews(pset.get<std::vector<bool> >("ReverseViews"))
+    fReverseViews(pset.get<std::vector<bool> >("ReverseViews")),
+    fThreads{pset.get<int>("InterOpThreads", 0),
+             pset.get<int>("IntraOpThreads", 0),
+             pset.get<bool>("UseGlobalThreadPool", false),
+             dune::numa::ResolveNode(dune::numa::PlacementFromPSet(pset))},
+    fLazyLoad(pset.get<bool>("LazyLoad", true)),
+    fRemoteFallback(true)
   {
 
-    // Construct the TF Graph object. The empty vector {} is used since the protobuf
-    // file gives the names of the output layer nodes
-    mf::LogInfo("TFRegNetHandler") << "Loading network: " << fTFProtoBuf << std::endl;
-    std::cout<<"Loading network: "<<fTFProtoBuf<<std::endl;
-    //fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,{});
-    fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,fOutputName);
-    if(!fTFGraph){
-      art::Exception(art::errors::Unknown) << "Tensorflow model not found or incorrect";
+    // The output names pick what the graph returns, so they are part of the key
+    const std::string cacheFile = pset.get<std::string>("OutputCache", "");
+    if (!cacheFile.empty()){
+      std::string tag = "TFRegNetHandler";
+      for (auto const & name : fOutputName) tag += " " + name;
+      fOutputCache = tf::OutputCache::Open(cacheFile, fTFProtoBuf, tag);
+    }
+
+    // The graph is loaded on first use, so jobs that see no pixel maps, or
+    // whose requests all go to an inference server, never pay for it
+    if (!fLazyLoad) LoadGraph();
+
+    // Optional inference server, the local graph is kept as the fallback
+    if (pset.has_key("TritonServer")){
+      const fhicl::ParameterSet server = pset.get<fhicl::ParameterSet>("TritonServer");
+#ifdef DUNERECO_WITH_TRITON
+      fRemoteInputs = server.get<std::vector<std::string> >("InputNames");
+      fRemoteOutputs = server.get<std::vector<std::string> >("OutputNames");
+      fRemoteFallback = server.get<bool>("Fallback", true);
+      const tritonrt::RemoteConfig config = tritonrt::ReadRemoteConfig(server);
+      fRemote = tritonrt::RemoteModel::Create(config);
+      if (!fRemote){
+        if (!fRemoteFallback){
+          throw art::Exception(art::errors::Configuration)
+            << "TFRegNetHandler: model " << config.modelName << " not available on " << config.url;
+        }
+        mf::LogWarning("TFRegNetHandler") << "Inference server not available, running locally" << std::endl;
+      }
+#else
+      throw art::Exception(art::errors::Configuration)
+        << "TFRegNetHandler: TritonServer is set but dunereco was built without the Triton client";
+#endif
     }
 
   }
-  std::vector<float> TFRegNetHandler::Predict(const RegPixelMap& pm, const std::vector<float> cm_list)
-  {
-   
-    RegCNNImageUtils imageUtils;
 
-    // Configure the image utility  
-    imageUtils.SetViewReversal(fReverseViews);
-    ImageVectorF thisImage;
-    imageUtils.ConvertPixelMapToImageVectorF(pm,thisImage);
-    std::vector<ImageVectorF> vecForTF;
-    vecForTF.push_back(thisImage);
+  TFRegNetHandler::~TFRegNetHandler() = default;
 
-    auto cnnResults = fTFGraph->run(vecForTF, cm_list, fInputs);
-    return cnnResults[0];
+  tf::RegCNNGraph& TFRegNetHandler::LoadGraph()
+  {
+    std::call_once(fLoadOnce, [this]()
+    {
+      // Construct the TF Graph object. The empty vector {} is used since the protobuf
+      // file gives the names of the output layer nodes
+      mf::LogInfo("TFRegNetHandler") << "Loading network: " << fTFProtoBuf << std::endl;
+      std::cout<<"Loading network: "<<fTFProtoBuf<<std::endl;
+      //fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,{});
+      fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,fOutputName,fThreads);
+    });
+    if(!fTFGraph){
+      throw art::Exception(art::errors::Configuration) << "TFRegNetHandler: Tensorflow model not found or incorrect: " << fTFProtoBuf;
+    }
+    return *fTFGraph;
   }
 
- 
-  std::vector<float> TFRegNetHandler::Predict(const RegPixelMap& pm)
+  bool TFRegNetHandler::RunRemote(const std::vector< std::vector< std::vector<float> > >& image, const std::vector<float>* cm,
+                                  std::vector<float>& result)
   {
-   
-    RegCNNImageUtils imageUtils;
-
-    // Configure the image utility  
-    imageUtils.SetViewReversal(fReverseViews);
-
-    //std::cout << "Reverse views? [" << fReverseViews[0] << "," << fReverseViews[1] << "," << fReverseViews[2] << "]" << std::endl;
-
-    ImageVectorF thisImage;
-    imageUtils.ConvertPixelMapToImageVectorF(pm,thisImage);
-    std::vector<ImageVectorF> vecForTF;
-/*
-    // Does this image look sensible?
-    TCanvas *can = new TCanvas("can","",0,0,800,600);
-    unsigned int fImageWires = pm.fNWire;
-    unsigned int fImageTDCs = pm.fNTdc;
-    TH2D* hView0 = new TH2D("hView0","",fImageWires,0,fImageWires,fImageTDCs,0,fImageTDCs);
-    TH2D* hView1 = new TH2D("hView1","",fImageWires,0,fImageWires,fImageTDCs,0,fImageTDCs);
-    TH2D* hView2 = new TH2D("hView2","",fImageWires,0,fImageWires,fImageTDCs,0,fImageTDCs);
-    for(unsigned int w = 0; w < fImageWires; ++w){
-      for(unsigned int t = 0; t < fImageTDCs; ++t){
-        hView0->SetBinContent(w+1,t+1,thisImage[w][t][0]);
-        hView1->SetBinContent(w+1,t+1,thisImage[w][t][1]);
-        hView2->SetBinContent(w+1,t+1,thisImage[w][t][2]);
+#ifdef DUNERECO_WITH_TRITON
+    if (!fRemote || !fRemote->Available()) return false;
+    if (image.empty() || image.front().empty() || image.front().front().empty()) return false;
+
+    // Same tensors as RegCNNGraph: one NHWC image for single input networks,
+    // else one single channel image per view followed by the centre of mass
+    const size_t rows = image.size(), cols = image.front().size(), depth = image.front().front().size();
+    const bool splitViews = fInputs != 1;
+    std::vector< std::vector<float> > buffers(splitViews ? depth : 1, std::vector<float>(rows * cols * (splitViews ? 1 : depth)));
+    for (size_t r = 0; r < rows; ++r){
+      for (size_t c = 0; c < cols; ++c){
+        for (size_t d = 0; d < depth; ++d){
+          if (splitViews) buffers[d][r * cols + c] = image[r][c][d];
+          else buffers[0][(r * cols + c) * depth + d] = image[r][c][d];
+        }
       }
     }
-    hView0->Draw("colz");
-    can->Print("view0a.png");
-    hView1->Draw("colz");
-    can->Print("view1a.png");
-    hView2->Draw("colz");
-    can->Print("view2a.png");
-*/
-    vecForTF.push_back(thisImage);
 
-    auto cnnResults = fTFGraph->run(vecForTF, fInputs);
+    std::vector<tritonrt::Input> inputs;
+    for (size_t i = 0; i < buffers.size(); ++i){
+      const std::vector<int64_t> shape = { 1, (int64_t)rows, (int64_t)cols, (int64_t)(splitViews ? 1 : depth) };
+      inputs.push_back({"", shape, buffers[i].data()});
+    }
+    if (splitViews && cm){
+      inputs.push_back({"", { 1, (int64_t)cm->size() }, cm->data()});
+    }
+    if (inputs.size() != fRemoteInputs.size()){
+      throw art::Exception(art::errors::Configuration)
+        << "TFRegNetHandler: the network takes " << inputs.size() << " inputs, TritonServer.InputNames has "
+        << fRemoteInputs.size() << " names";
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) inputs[i].name = fRemoteInputs[i];
 
-    //std::cout << "Number of CNN result vectors " << cnnResults.size() << " with " << cnnResults[0].size() << " categories" << std::endl;
+    std::vector<tritonrt::Output> outputs;
+    if (!fRemote->Infer(inputs, fRemoteOutputs, outputs)) return false;
 
-    //std::cout << "summary: ";
-    //for(auto const v : cnnResults[0]){
-    //  std::cout << v << ", ";
-    //}
-    //std::cout << std::endl;
+    // RegCNNGraph concatenates the outputs of a sample
+    std::vector< std::vector< std::vector<float> > > samples = tritonrt::SplitSamples(outputs);
+    if (samples.size() != 1){
+      mf::LogWarning("TFRegNetHandler") << "Inference server returned " << samples.size() << " results for 1 image" << std::endl;
+      return false;
+    }
+    result.clear();
+    for (auto const & output : samples.front())
+      result.insert(result.end(), output.begin(), output.end());
+    return true;
+#else
+    return false;
+#endif
+  }
+  std::vector<float> TFRegNetHandler::Predict(const RegPixelMap& pm, const std::vector<float> cm_list)
+  {
+    RegCNNSharedInput input(pm);
+    return Run(input, &cm_list);
+  }
 
+  std::vector<float> TFRegNetHandler::Predict(const RegPixelMap& pm)
+  {
+    RegCNNSharedInput input(pm);
+    return Run(input, nullptr);
+  }
+
+  std::vector<float> TFRegNetHandler::Predict(RegCNNSharedInput& input)
+  {
+    return Run(input, nullptr);
+  }
+
+  std::vector<float> TFRegNetHandler::Predict(RegCNNSharedInput& input, const std::vector<float>& cm_list)
+  {
+    return Run(input, &cm_list);
+  }
+
+  std::vector<float> TFRegNetHandler::Run(RegCNNSharedInput& input, const std::vector<float>* cm)
+  {
+    // The centre of mass is only an input of the multi-input vertex networks
+    std::vector<tensorflow::Tensor> tensors = input.Tensors(fReverseViews, fInputs);
+    if (cm && fInputs != 1) tensors.push_back(tf::RegCNNGraph::makeVectorTensor(*cm));
+    if (!fOutputCache) return RunNetwork(input, cm, tensors);
+
+    std::vector< std::pair<const void*, size_t> > buffers;
+    for (auto const & tensor : tensors){
+      const auto data = tensor.tensor_data();
+      buffers.emplace_back(data.data(), data.size());
+    }
+    const std::vector<std::string> keys = { fOutputCache->Key(buffers) };
+    return fOutputCache->GetOrCompute(keys, [&](const std::vector<size_t>&){
+      return std::vector<tf::OutputCache::Outputs>{ { RunNetwork(input, cm, tensors) } };
+    }).front().front();
+  }
+
+  std::vector<float> TFRegNetHandler::RunNetwork(RegCNNSharedInput& input, const std::vector<float>* cm,
+                                                 const std::vector<tensorflow::Tensor>& tensors)
+  {
+    std::vector<float> remoteResult;
+    if (fRemote && RunRemote(input.Image(fReverseViews), cm, remoteResult)) return remoteResult;
+    if (fRemote && !fRemoteFallback){
+      throw art::Exception(art::errors::Unknown) << "TFRegNetHandler: inference server request failed";
+    }
+
+    tf::RegCNNGraph& graph = LoadGraph();
+    std::lock_guard<std::mutex> lock(fRunMutex);
+    auto cnnResults = graph.run(tensors);
+    if (cnnResults.empty()){
+      throw art::Exception(art::errors::Unknown) << "TFRegNetHandler: graph " << fTFProtoBuf << " returned no result";
+    }
     return cnnResults[0];
   }
 
@@ -7,18 +7,52 @@
 #ifndef REGCNN_TFNETHANDLER_H
 #define REGCNN_TFNETHANDLER_H
 
+#include <map>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <utility>
 
 #include "dunereco/RegCNN/func/RegPixelMap.h"
 #include "dunereco/RegCNN/func/RegPixelMap3D.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "dunereco/RegCNN/func/RegCNN_TF_Graph.h"
+#include "dunereco/RegCNN/func/RegCNNImageUtils.h"
+#include "dunereco/TFRuntime/TFOutputCache.h"
 //#include "larreco/RecoAlg/ImagePatternAlgs/Tensorflow/TF/tf_graph.h"
 
+namespace tritonrt
+{
+  class RemoteModel;
+}
+
 namespace cnn
 {
 
+  /// Network input of one pixel map, shared by the handlers of a multi-head
+  /// evaluation. The image is converted once per view reversal and the input
+  /// tensors built once per input layout, so every graph run on the map is
+  /// fed the same tensors
+  class RegCNNSharedInput
+  {
+  public:
+    explicit RegCNNSharedInput(const RegPixelMap& pm);
+    ~RegCNNSharedInput();
+
+    const RegPixelMap& PixelMap() const { return fPixelMap; }
+
+    /// Image of the map with the given views reversed
+    const ImageVectorF& Image(const std::vector<bool>& reverseViews);
+
+    /// Input tensors of a graph with ninputs inputs, see RegCNNGraph::makeImageTensors
+    const std::vector<tensorflow::Tensor>& Tensors(const std::vector<bool>& reverseViews, unsigned int ninputs);
+
+  private:
+    const RegPixelMap& fPixelMap;
+    std::map<std::vector<bool>, ImageVectorF> fImages;
+    std::map<std::pair<std::vector<bool>, unsigned int>, std::vector<tensorflow::Tensor> > fTensors;
+  };
+
   /// Wrapper for caffe::Net which handles construction and prediction
   class TFRegNetHandler
   {
@@ -26,6 +60,7 @@ namespace cnn
 
     /// Constructor which takes a pset with DeployProto and ModelFile fields
     TFRegNetHandler(const fhicl::ParameterSet& pset);
+    ~TFRegNetHandler();
 
     /// Return prediction arrays for RegPixelMap
     std::vector<float> Predict(const RegPixelMap& pm);
@@ -33,14 +68,42 @@ namespace cnn
 
     std::vector<float> PredictNuEEnergy(const RegPixelMap& pm);
 
+    /// Return prediction arrays for a pixel map whose input is shared with other handlers
+    std::vector<float> Predict(RegCNNSharedInput& input);
+    std::vector<float> Predict(RegCNNSharedInput& input, const std::vector<float>& cm_list);
+
   private:
 
+    /// Graph, loaded on the first call. Throws if it can't be loaded
+    tf::RegCNNGraph& LoadGraph();
+
+    /// Run the graph, locally or remotely, with the centre of mass input if cm is given
+    std::vector<float> Run(RegCNNSharedInput& input, const std::vector<float>* cm);
+
+    /// Run the graph, locally or remotely, on the given input tensors
+    std::vector<float> RunNetwork(RegCNNSharedInput& input, const std::vector<float>* cm,
+                                  const std::vector<tensorflow::Tensor>& tensors);
+
+    /// Send one image, and the centre of mass inputs if cm is given, to the
+    /// inference server. Returns false, with result untouched, if the request failed
+    bool RunRemote(const std::vector< std::vector< std::vector<float> > >& image, const std::vector<float>* cm,
+                   std::vector<float>& result);
+
     std::string  fLibPath;  ///< Library path (typically dune_pardata...)
     std::string  fTFProtoBuf;  ///< location of the tf .pb file in the above path
     unsigned int fInputs;   ///< Number of tdcs for the network to classify
     std::vector<std::string> fOutputName;
     std::vector<bool> fReverseViews; ///< Do we need to reverse any views?
+    tf::ThreadConfig fThreads; ///< Tensorflow session threading
     std::unique_ptr<tf::RegCNNGraph> fTFGraph; ///< Tensorflow graph
+    bool fLazyLoad; ///< Load the graph on first use rather than in the constructor
+    std::once_flag fLoadOnce; ///< The graph is loaded by a single caller
+    std::mutex fRunMutex; ///< One graph call at a time when the handler is shared between events
+    std::unique_ptr<tritonrt::RemoteModel> fRemote; ///< Inference server client, if one is configured and reachable
+    std::vector<std::string> fRemoteInputs;  ///< Input names of the served model, one per input tensor
+    std::vector<std::string> fRemoteOutputs; ///< Output names of the served model, in the order of the graph outputs
+    bool fRemoteFallback; ///< Run the local session when a request fails, else throw
+    std::unique_ptr<tf::OutputCache> fOutputCache; ///< Outputs of inputs already seen, if a cache file is configured
 
   };
 
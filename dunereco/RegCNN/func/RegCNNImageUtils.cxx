@@ -46,12 +46,22 @@ void cnn::RegCNNImageUtils::ConvertPixelMapToImageVectorF(const cnn::RegPixelMap
 
   SetPixelMapSize(pm.fNWire,pm.fNTdc);
 
-  // Strip out the charge vectors and use these
-  std::vector<float> v0pe = pm.fPEX;
-  std::vector<float> v1pe = pm.fPEY;
-  std::vector<float> v2pe = pm.fPEZ;
-
-  ConvertChargeVectorsToImageVectorF(v0pe, v1pe, v2pe, imageVec);
+  // Read the charges straight from the map, reversing views by index, rather
+  // than copying them through the intermediate view vectors. The image has
+  // one extra row and column of zeros, as the view vector version
+  const std::vector<float>* views[3] = {&pm.fPEX, &pm.fPEY, &pm.fPEZ};
+  imageVec.assign(fPixelMapWires+1, ViewVectorF(fPixelMapTDCs+1, std::vector<float>(fNViews, 0.)));
+  for (unsigned int view = 0; view < fNViews; ++view){
+    const std::vector<float>& pe = *views[view];
+    for (unsigned int wire = 0; wire < fPixelMapWires; ++wire){
+      const unsigned int mapWire = fViewReverse[view] ? fPixelMapWires - wire - 1 : wire;
+      const float* mapCharges = pe.data() + fPixelMapTDCs * mapWire;
+      ViewVectorF& imageWire = imageVec[wire];
+      for (unsigned int time = 0; time < fPixelMapTDCs; ++time){
+        imageWire[time][view] = ConvertToScaledCharge(mapCharges[time]);
+      }
+    }
+  }
 }
 
 void cnn::RegCNNImageUtils::ConvertChargeVectorsToImageVectorF(std::vector<float> &v0pe, std::vector<float> &v1pe,
@@ -12,31 +12,22 @@
 #include "dunereco/RegCNN/func/RegCNN_TF_Graph.h"
 
 #include "tensorflow/core/public/session.h"
-#include "tensorflow/core/platform/env.h"
+
+#include "dunereco/TFRuntime/TFSessionRegistry.h"
 
 //#include "tensorflow/core/kernels/conv_3d.h"
 
 // -------------------------------------------------------------------
-tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs, bool & success)
+tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs, bool & success,
+                             const ThreadConfig & threads)
 {
     success = false; // until all is done correctly
 
-    auto status = tensorflow::NewSession(tensorflow::SessionOptions(), &fSession);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
-    tensorflow::GraphDef graph_def;
-    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    fSession = SessionRegistry::Instance().GetGraph(graph_file_name, threads);
+    if (!fSession) { return; }
 
-    size_t ng = graph_def.node().size();
+    const std::vector<std::string> & nodes = fSession->NodeNames();
+    size_t ng = nodes.size();
 
     // uncomment following to print debug info
     //std::cout<<"debug info :"<<graph_file_name<<" has "<<ng<<" nodes"<<std::endl;
@@ -53,21 +44,21 @@ tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ni
     // set input names
     std::string ss("input_");
     for (unsigned int ii = 0; ii < ninputs; ++ii){
-        fInputNames.push_back(graph_def.node()[ii].name());
+        fInputNames.push_back(nodes[ii]);
         //std::string inname(ss+std::to_string(ii+1));
         //fInputNames.push_back(inname);
-        //std::cout<< graph_def.node()[ii].name() << std::endl;
+        //std::cout<< nodes[ii] << std::endl;
     }
 
 
     // last node as output if no specific name provided
-    if (outputs.empty()) { fOutputNames.push_back(graph_def.node()[ng - 1].name()); }
+    if (outputs.empty()) { fOutputNames.push_back(nodes[ng - 1]); }
     else // or last nodes with names containing provided strings
     {
         std::string last, current, basename, name;
         for (size_t n = 0; n < ng; ++n)
         {
-            name = graph_def.node()[n].name();
+            name = nodes[n];
             auto pos = name.find("/");
             if (pos != std::string::npos) { basename = name.substr(0, pos); }
             else { continue; }
@@ -96,24 +87,12 @@ tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ni
     }
 
 
-    status = fSession->Create(graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
     success = true; // ok, graph loaded from the file
     std::cout<<"ok, graph loaded from the file"<<std::endl;
 }
 
 tf::RegCNNGraph::~RegCNNGraph()
 {
-    auto status = fSession->Close();
-    if (!status.ok()) {
-      std::cout << "RegCNNGraph::dtor: " << "Close failed." << std::endl;
-    }
-    delete fSession;
 }
 // -------------------------------------------------------------------
 
@@ -287,7 +266,7 @@ std::vector< std::vector< float > > tf::RegCNNGraph::run(
     //std::cout << "run session" << std::endl;
 
     std::vector<tensorflow::Tensor> outputs;
-    auto status = fSession->Run(inputs, fOutputNames, {}, &outputs);
+    auto status = fSession->Run(inputs, fOutputNames, &outputs);
 
     //std::cout << "out size " << outputs.size() << std::endl;
 
@@ -331,6 +310,51 @@ std::vector< std::vector< float > > tf::RegCNNGraph::run(
     }
 }
 
+std::vector< tensorflow::Tensor > tf::RegCNNGraph::makeImageTensors(
+	const std::vector< std::vector< std::vector<float> > > & image,
+        const unsigned int& ninputs)
+{
+    std::vector< tensorflow::Tensor > tensors;
+    if (image.empty() || image.front().empty() || image.front().front().empty()) { return tensors; }
+
+    long long int
+              rows = image.size(),
+              cols = image.front().size(),
+              depth = image.front().front().size();
+
+    if (ninputs == 1) {
+        tensors.emplace_back(tensorflow::DT_FLOAT, tensorflow::TensorShape({ 1, rows, cols, depth }));
+    } else {
+        for (long long int d = 0; d < depth; ++d)
+            tensors.emplace_back(tensorflow::DT_FLOAT, tensorflow::TensorShape({ 1, rows, cols, 1 }));
+    }
+
+    std::vector< tensorflow::TTypes<float, 4>::Tensor > maps;
+    for (auto & tensor : tensors) { maps.push_back(tensor.tensor<float, 4>()); }
+
+    for (long long int r = 0; r < rows; ++r) {
+        const auto & row = image[r];
+        for (long long int c = 0; c < cols; ++c) {
+            const auto & col = row[c];
+            for (long long int d = 0; d < depth; ++d) {
+                if (ninputs == 1) maps[0](0, r, c, d) = col[d];
+                else maps[d](0, r, c, 0) = col[d];
+            }
+        }
+    }
+
+    return tensors;
+}
+// -------------------------------------------------------------------
+
+tensorflow::Tensor tf::RegCNNGraph::makeVectorTensor(const std::vector<float> & v)
+{
+    tensorflow::Tensor tensor(tensorflow::DT_FLOAT, tensorflow::TensorShape({ 1, (long long int)v.size() }));
+    for (size_t i = 0; i < v.size(); ++i) { tensor.tensor<float, 2>()(0, i) = v[i]; }
+    return tensor;
+}
+// -------------------------------------------------------------------
+
 std::vector< std::vector< float > > tf::RegCNNGraph::run(
         const std::vector< tensorflow::Tensor >& x)
 {
@@ -344,7 +368,7 @@ std::vector< std::vector< float > > tf::RegCNNGraph::run(
     //std::cout << "run session" << std::endl;
 
     std::vector<tensorflow::Tensor> outputs;
-    auto status = fSession->Run(inputs, fOutputNames, {}, &outputs);
+    auto status = fSession->Run(inputs, fOutputNames, &outputs);
 
     //std::cout << "out size " << outputs.size() << std::endl;
 
@@ -16,22 +16,26 @@
 #include <vector>
 #include <string>
 
+#include "dunereco/TFRuntime/TFThreadConfig.h"
+
 namespace tensorflow
 {
-    class Session;
     class Tensor;
 }
 
 namespace tf
 {
 
+class SharedSession;
+
 class RegCNNGraph
 {
 public:
-    static std::unique_ptr<RegCNNGraph> create(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs = {})
+    static std::unique_ptr<RegCNNGraph> create(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs = {},
+                                               const ThreadConfig & threads = {0, 0, false})
     {
         bool success;
-        std::unique_ptr<RegCNNGraph> ptr(new RegCNNGraph(graph_file_name, ninputs, outputs,  success));
+        std::unique_ptr<RegCNNGraph> ptr(new RegCNNGraph(graph_file_name, ninputs, outputs,  success, threads));
         if (success) { return ptr; }
         else { return nullptr; }
     }
@@ -57,11 +61,21 @@ public:
     std::vector< std::vector< float > > run(const tensorflow::Tensor & x);
     std::vector< std::vector< float > > run(const std::vector< tensorflow::Tensor >& x);
 
+    // input tensors of one 3D image, laid out as the run methods above do: one
+    // NHWC tensor if ninputs = 1, else one single channel tensor per view; the
+    // tensors share their buffers when copied, so several graphs can be fed them
+    static std::vector< tensorflow::Tensor > makeImageTensors(
+	const std::vector< std::vector< std::vector<float> > > & image,
+        const unsigned int& ninputs);
+    // the centre of mass input of the vertex networks, for a single sample
+    static tensorflow::Tensor makeVectorTensor(const std::vector<float> & v);
+
 private:
     /// Not-throwing constructor.
-    RegCNNGraph(const char* graph_file_name, const unsigned int& ninputs, const std::vector<std::string> & outputs, bool & success);
+    RegCNNGraph(const char* graph_file_name, const unsigned int& ninputs, const std::vector<std::string> & outputs, bool & success,
+                const ThreadConfig & threads);
 
-    tensorflow::Session* fSession;
+    std::shared_ptr<SharedSession> fSession; ///< Shared with other users of the same graph file
     std::vector<std::string> fInputNames;
     std::vector< std::string > fOutputNames;
 };
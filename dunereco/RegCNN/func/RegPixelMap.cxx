@@ -16,7 +16,8 @@ namespace cnn
 {
 
   RegPixelMap::RegPixelMap(unsigned int nWire, unsigned int nWRes,
-          unsigned int nTdc, unsigned int nTRes, const RegCNNBoundary& bound, const bool& prongOnly):
+          unsigned int nTdc, unsigned int nTRes, const RegCNNBoundary& bound, const bool& prongOnly,
+          const bool& networkOnly):
   fNWire(nWire),
   fNWRes(nWRes),
   fNTdc(nTdc),
@@ -24,34 +25,40 @@ namespace cnn
   fInPM(0),
   fTPC(0),
   fdist(100000),
-  fPE(nWire*nTdc),
   fPEX(nWire*nTdc),
   fPEY(nWire*nTdc),
   fPEZ(nWire*nTdc),
-  fPur(nWire*nTdc),
-  fPurX(nWire*nTdc),
-  fPurY(nWire*nTdc),
-  fPurZ(nWire*nTdc),
-  fLab(nWire*nTdc),
-  fLabX(nWire*nTdc),
-  fLabY(nWire*nTdc),
-  fLabZ(nWire*nTdc),
   fBound(bound),
   fProngOnly(prongOnly),
-  fProngTagX(nWire*nTdc),
-  fProngTagY(nWire*nTdc),
-  fProngTagZ(nWire*nTdc)
+  fNetworkOnly(networkOnly)
   {
       std::cout<<"here :"<<fNWire<<", "<<fNTdc<<", "<<fNWRes<<", "<<fNTRes<<std::endl;
+
+      // The network only reads the per view charges, the rest of the map is
+      // only worth its memory when the map is kept for inspection. The prong
+      // tags are needed by Finish for prong only maps
+      if (!fNetworkOnly) {
+          fPE.resize(nWire*nTdc);
+          fPur.resize(nWire*nTdc);
+          fPurX.resize(nWire*nTdc);
+          fPurY.resize(nWire*nTdc);
+          fPurZ.resize(nWire*nTdc);
+          fLab.resize(nWire*nTdc);
+          fLabX.resize(nWire*nTdc);
+          fLabY.resize(nWire*nTdc);
+          fLabZ.resize(nWire*nTdc);
+      }
+      if (!fNetworkOnly || fProngOnly) {
+          fProngTagX.resize(nWire*nTdc);
+          fProngTagY.resize(nWire*nTdc);
+          fProngTagZ.resize(nWire*nTdc);
+      }
   }
 
   void RegPixelMap::FillInputVector(float* input) const
   {
-    unsigned int i = 0;
-
-    for(const auto& pe:fPE){
-      input[i] = pe;
-      ++i;
+    for(unsigned int i = 0; i < NPixel(); ++i){
+      input[i] = PE(i);
     }
 
   }
@@ -65,32 +72,24 @@ namespace cnn
     if(fBound.IsWithin(wire, tdc, view)){
       fInPM = 1; // any hit within the boundary
       GetTPC(wire, tdc, view, tpc);
-      fPE[GlobalToIndex(wire, tdc, view)] += (float)pe;
-      fLab[GlobalToIndex(wire,tdc, view)] = label;
-      fPur[GlobalToIndex(wire,tdc, view)] = purity;
-      if(view==0){
-	    fPEX[GlobalToIndexSingle(wire,tdc, view)] += (float)pe;
-        fProngTagX[GlobalToIndexSingle(wire, tdc, view)] = hit_prong_tag;
-	    fLabX[GlobalToIndexSingle(wire,tdc, view)] = label;
-	    fPurX[GlobalToIndexSingle(wire,tdc, view)] = purity;
-        // FIXIT
-        //if (pe!=0) {
-        //    std::cout<<view<<" | ";
-        //    std::cout<<wire<<", "<<tdc<<", "<<GlobalToIndexSingle(wire,tdc,view)<<", "<<pe<<std::endl;
-        //}
+      if (!fPE.empty()) {
+        const unsigned int index = GlobalToIndex(wire, tdc, view);
+        fPE[index] += (float)pe;
+        fLab[index] = label;
+        fPur[index] = purity;
       }
-      if(view==1){
-	    fPEY[GlobalToIndexSingle(wire,tdc, view)] += (float)pe;
-        fProngTagY[GlobalToIndexSingle(wire, tdc, view)] = hit_prong_tag;
-	    fLabY[GlobalToIndexSingle(wire,tdc, view)] = label;
-	    fPurY[GlobalToIndexSingle(wire,tdc, view)] = purity;
+      if (view > 2) return;
+
+      const unsigned int index = GlobalToIndexSingle(wire, tdc, view);
+      std::vector<float>& viewPE = view == 0 ? fPEX : (view == 1 ? fPEY : fPEZ);
+      viewPE[index] += (float)pe;
+      if (!fProngTagX.empty()) {
+        std::vector<int>& viewProngTag = view == 0 ? fProngTagX : (view == 1 ? fProngTagY : fProngTagZ);
+        viewProngTag[index] = hit_prong_tag;
       }
-     if(view==2){
-	    fPEZ[GlobalToIndexSingle(wire,tdc, view)] += (float)pe;
-        fProngTagZ[GlobalToIndexSingle(wire, tdc, view)] = hit_prong_tag;
-	    fLabZ[GlobalToIndexSingle(wire,tdc, view)] = label;
-	    fPurZ[GlobalToIndexSingle(wire,tdc, view)] = purity;
-        //std::cout << "Q = " << pe << " " << fPEZ[GlobalToIndexSingle(wire,tdc, view)] << std::endl;
+      if (!fLabX.empty()) {
+        (view == 0 ? fLabX : (view == 1 ? fLabY : fLabZ))[index] = label;
+        (view == 0 ? fPurX : (view == 1 ? fPurY : fPurZ))[index] = purity;
       }
    }
   }
@@ -110,7 +109,7 @@ namespace cnn
       //         (little effect on the results, ignored for now)
       if (fProngOnly) {
           std::cout<<"Do Prong Only selection ......"<<std::endl;
-          for (unsigned int i_p= 0; i_p< fPE.size(); ++i_p) {
+          for (unsigned int i_p= 0; i_p< fPEX.size(); ++i_p) {
               if (fProngTagX[i_p] != 0)
                   fPEX[i_p] = 0;
               if (fProngTagY[i_p] != 0)
@@ -141,7 +140,7 @@ namespace cnn
     //std::cout << "====> " << meanWire <<" " << meanTDC << " " << internalWire << " " << internalTdc << " " << index << std::endl;
     //std::cout << "    => " << wire << " " << tdc << " " << wire-meanWire << " " << round((float)(tdc-meanTDC)/(float)fNTRes) << std::endl;
     //}
-    assert(index < fPE.size());
+    assert(index < NPixel());
     return index;
   }
 
@@ -150,7 +149,7 @@ namespace cnn
   {
     unsigned int index = wire * fNTdc + tdc % fNTdc;
 
-    assert(index < fPE.size());
+    assert(index < NPixel());
     return index;
   }
 
@@ -207,7 +206,7 @@ namespace cnn
       for(unsigned int iWire = 0; iWire < fNWire; iWire += 2)
       {
         unsigned int index = LocalToIndex(iWire, iTdc);
-        if( fPE[index] > 0)
+        if( PE(index) > 0)
         {
           std::cout << "*";
         }
@@ -225,7 +224,7 @@ namespace cnn
       for(unsigned int iWire = 1; iWire < fNWire; iWire += 2)
       {
         unsigned int index = LocalToIndex(iWire, iTdc);
-        if( fPE[index] > 0)
+        if( PE(index) > 0)
         {
           std::cout << "*";
         }
@@ -253,7 +252,7 @@ namespace cnn
       {
         // Add 1 to in each bin to skip underflow
         hist->SetBinContent(iWire+1, iTdc + fNTdc*(iWire%3) + 1,
-                            fPE[LocalToIndex(iWire, iTdc)]);
+                            PE(LocalToIndex(iWire, iTdc)));
 
       }
     }
@@ -273,7 +272,7 @@ namespace cnn
       {
         // Add 1 to in each bin to skip underflow
         hist->SetBinContent(iWire+1, iTdc + fNTdc*(iWire%3) + 1,
-                            (double)fLab[LocalToIndex(iWire, iTdc)]);
+                            fLab.empty() ? (double)kEmptyHit : (double)fLab[LocalToIndex(iWire, iTdc)]);
 
       }
     }
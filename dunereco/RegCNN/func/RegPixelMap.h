@@ -22,7 +22,10 @@ namespace cnn
     class RegPixelMap
     {
         public:
-            RegPixelMap(unsigned int nWire, unsigned int nWRes, unsigned int nTdc, unsigned int nTRes, const RegCNNBoundary& bound, const bool& prongOnly);
+            /// With networkOnly only the per view charges the network reads are
+            /// stored, the summed charge, purities and labels are left empty
+            RegPixelMap(unsigned int nWire, unsigned int nWRes, unsigned int nTdc, unsigned int nTRes, const RegCNNBoundary& bound, const bool& prongOnly,
+                    const bool& networkOnly = false);
             RegPixelMap(){};
 
             /// Length in wires
@@ -38,7 +41,11 @@ namespace cnn
             unsigned int NTRes() const {return fNTRes;};
 
             /// Total number of pixels in map
-            unsigned int NPixel() const {return fPE.size();};
+            unsigned int NPixel() const {return fNWire*fNTdc;};
+
+            /// Charge of a pixel summed over the views
+            float PE(unsigned int index) const
+            {return fPE.empty() ? fPEX[index] + fPEY[index] + fPEZ[index] : fPE[index];};
 
             /// Map boundary
             RegCNNBoundary Bound() const {return fBound;};
@@ -103,6 +110,7 @@ namespace cnn
 
             RegCNNBoundary          fBound;    //< RegCNNBoundary of pixel map
             bool fProngOnly;                   //< whether to use prong only pixel map
+            bool fNetworkOnly;                 //< whether only the network inputs are stored
             std::vector<int> fProngTagX;
             std::vector<int> fProngTagY;
             std::vector<int> fProngTagZ;
@@ -4,8 +4,10 @@
 /// \author  Wenjie Wu - wenjieww@uci.edu
 ////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <numeric>
 #include <ostream>
 #include <iomanip>
 #include "dunereco/RegCNN/func/RegPixelMap3D.h"
@@ -13,14 +15,13 @@
 namespace cnn
 {
 
-  RegPixelMap3D::RegPixelMap3D(const RegCNNBoundary3D& bound, const bool& cropped, const bool& prongOnly):
+  RegPixelMap3D::RegPixelMap3D(const RegCNNBoundary3D& bound, const bool& cropped, const bool& prongOnly,
+          const bool& cropOnly):
       fBound(bound),
       fCropped(cropped),
       fProngOnly(prongOnly),
       fInPM(0),
-      fPE(fBound.NBins(0)*fBound.NBins(1)*fBound.NBins(2)),
-      fPECropped(32*32*32),                   // Fixed to 32x32x32
-      fProngTag(fBound.NBins(0)*fBound.NBins(1)*fBound.NBins(2))
+      fCropOnly(cropped && cropOnly)
   {
       x_axis.Set(fBound.NBins(0), fBound.StartPos(0), fBound.StopPos(0));
       y_axis.Set(fBound.NBins(1), fBound.StartPos(1), fBound.StopPos(1));
@@ -34,8 +35,16 @@ namespace cnn
           int xbin = x_axis.FindBin(rel_x);
           int ybin = y_axis.FindBin(rel_y);
           int zbin = z_axis.FindBin(rel_z);
-          fPE[LocalToIndex(xbin-1, ybin-1, zbin-1)] += charge;
-          fProngTag[LocalToIndex(xbin-1, ybin-1, zbin-1)] = hit_prong_tag;
+          const unsigned int index = LocalToIndex(xbin-1, ybin-1, zbin-1);
+          if (fCropOnly && CroppedIndex(index) < 0) return;
+          auto voxel = fVoxelLookup.emplace(index, fVoxelIndex.size());
+          if (voxel.second) {
+              fVoxelIndex.push_back(index);
+              fVoxelPE.push_back(0);
+              fVoxelProngTag.push_back(0);
+          }
+          fVoxelPE[voxel.first->second] += charge;
+          fVoxelProngTag[voxel.first->second] = hit_prong_tag;
       }
   }
 
@@ -52,39 +61,95 @@ namespace cnn
       //         That means we should create a new pixel map only with the spacepoints 
       //         associated with the primary prong, instead of using the prong tag
       //         (little effect on the results, ignored for now)
-      if (fProngOnly) {
-          std::cout<<"Do Prong Only selection ......"<<std::endl;
-          for (unsigned int i_p= 0; i_p< fPE.size(); ++i_p) {
-              if (fProngTag[i_p] != 0)
-                  fPE[i_p] = 0;
-          } // end of i_p
-      } // end of fProngOnly
-
-      if (fCropped) {
-          std::cout<<"Crop pixel size to 32x32x32 ......"<<std::endl;
-          int cropped_xbin_low = 50 - 16;    //int cropped_xbin_high = 50 + 16;
-          int cropped_ybin_low = 50 - 16;    //int cropped_ybin_high = 50 + 16;
-          int cropped_zbin_low = 0;          //int cropped_zbin_high = 32;
-          for (int i_x= 0; i_x< 32; ++i_x) {
-              for (int i_y= 0; i_y< 32; ++i_y) {
-                  for (int i_z= 0; i_z< 32; ++i_z) {
-                      int cropped_index = i_x*32*32 + i_y*32 + i_z%32;
-                      int ii_x  = i_x + cropped_xbin_low;
-                      int ii_y  = i_y + cropped_ybin_low;
-                      int ii_z  = i_z + cropped_zbin_low;
-                      int index =  LocalToIndex(ii_x, ii_y, ii_z);
-                      fPECropped[cropped_index] = fPE[index];
-                  } // end of i_z
-              } // end of i_y
-          } // end of i_x
-      } // end of fCropped
+      fVoxelLookup.clear();
+
+      // Keep the voxels ordered by index, as a dense map would be
+      std::vector<unsigned int> order(fVoxelIndex.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(),
+                [this](unsigned int a, unsigned int b) {return fVoxelIndex[a] < fVoxelIndex[b];});
+
+      if (fProngOnly) std::cout<<"Do Prong Only selection ......"<<std::endl;
+      std::vector<unsigned int> voxelIndex;
+      std::vector<float> voxelPE;
+      std::vector<int> voxelProngTag;
+      voxelIndex.reserve(order.size());
+      voxelPE.reserve(order.size());
+      voxelProngTag.reserve(order.size());
+      for (unsigned int i_v : order) {
+          if (fProngOnly && fVoxelProngTag[i_v] != 0) continue;
+          voxelIndex.push_back(fVoxelIndex[i_v]);
+          voxelPE.push_back(fVoxelPE[i_v]);
+          voxelProngTag.push_back(fVoxelProngTag[i_v]);
+      }
+      fVoxelIndex.swap(voxelIndex);
+      fVoxelPE.swap(voxelPE);
+      fVoxelProngTag.swap(voxelProngTag);
+
+      // The 32x32x32 crop is made on demand from the occupied voxels
+      if (fCropped) std::cout<<"Crop pixel size to 32x32x32 ......"<<std::endl;
+  }
+
+  void RegPixelMap3D::IndexToLocal(unsigned int index, unsigned int& bin_x,
+          unsigned int& bin_y, unsigned int& bin_z) const
+  {
+      bin_z = index % fBound.NBins(2);
+      index /= fBound.NBins(2);
+      bin_y = index % fBound.NBins(1);
+      bin_x = index / fBound.NBins(1);
+  }
+
+  int RegPixelMap3D::CroppedIndex(unsigned int index) const
+  {
+      // Crop window: x and y centred on bin 50, z from the first bin
+      const unsigned int cropped_xbin_low = 50 - 16;
+      const unsigned int cropped_ybin_low = 50 - 16;
+      const unsigned int cropped_zbin_low = 0;
+      unsigned int bin_x, bin_y, bin_z;
+      IndexToLocal(index, bin_x, bin_y, bin_z);
+      if (bin_x < cropped_xbin_low || bin_x >= cropped_xbin_low + 32 ||
+          bin_y < cropped_ybin_low || bin_y >= cropped_ybin_low + 32 ||
+          bin_z < cropped_zbin_low || bin_z >= cropped_zbin_low + 32) return -1;
+      return (bin_x - cropped_xbin_low)*32*32 + (bin_y - cropped_ybin_low)*32 + (bin_z - cropped_zbin_low);
+  }
+
+  void RegPixelMap3D::FillPM(std::vector<float>& buffer) const
+  {
+      buffer.assign(fBound.NBins(0)*fBound.NBins(1)*fBound.NBins(2), 0);
+      for (unsigned int i_v= 0; i_v< fVoxelIndex.size(); ++i_v) {
+          buffer[fVoxelIndex[i_v]] = fVoxelPE[i_v];
+      }
+  }
+
+  void RegPixelMap3D::FillCroppedPM(std::vector<float>& buffer) const
+  {
+      buffer.assign(32*32*32, 0);
+      if (!fCropped) return;
+      for (unsigned int i_v= 0; i_v< fVoxelIndex.size(); ++i_v) {
+          const int cropped_index = CroppedIndex(fVoxelIndex[i_v]);
+          if (cropped_index >= 0) buffer[cropped_index] = fVoxelPE[i_v];
+      }
+  }
+
+  std::vector<float> RegPixelMap3D::GetPM() const
+  {
+      std::vector<float> pm;
+      FillPM(pm);
+      return pm;
+  }
+
+  std::vector<float> RegPixelMap3D::GetCroppedPM() const
+  {
+      std::vector<float> pm;
+      FillCroppedPM(pm);
+      return pm;
   }
 
   unsigned int RegPixelMap3D::LocalToIndex(const unsigned int& bin_x, 
           const unsigned int& bin_y, const unsigned int& bin_z) const 
   {
       unsigned int index = bin_x*fBound.NBins(1)*fBound.NBins(2) + bin_y*fBound.NBins(2) + bin_z%fBound.NBins(2);
-      assert(index < fPE.size());
+      assert(index < (unsigned int)(fBound.NBins(0)*fBound.NBins(1)*fBound.NBins(2)));
       return index;
   }
 
@@ -93,12 +158,10 @@ namespace cnn
       TH3F* hist = new TH3F("RegPixelMap3D", "X:Y:Z", fBound.NBins(0), fBound.StartPos(0), fBound.StopPos(0),
               fBound.NBins(1), fBound.StartPos(1), fBound.StopPos(1),
               fBound.NBins(2), fBound.StartPos(2), fBound.StopPos(2));
-      for (int ix= 0; ix< fBound.NBins(0); ++ix) {
-          for (int iy= 0; iy< fBound.NBins(1); ++iy) {
-              for (int iz= 0; iz< fBound.NBins(2); ++iz) {
-                  hist->SetBinContent(ix+1, iy+1, iz+1, fPE[LocalToIndex(ix, iy, iz)]);
-              }
-          }
+      for (unsigned int i_v= 0; i_v< fVoxelIndex.size(); ++i_v) {
+          unsigned int ix, iy, iz;
+          IndexToLocal(fVoxelIndex[i_v], ix, iy, iz);
+          hist->SetBinContent(ix+1, iy+1, iz+1, fVoxelPE[i_v]);
       }
       return hist;
   }
@@ -108,13 +171,13 @@ namespace cnn
       TH3F* hist = new TH3F("RegCroppedPixelMap3D", "X:Y:Z", 32, 0, 32*x_axis.GetBinWidth(0),
               32, 0, 32*y_axis.GetBinWidth(0),
               32, 0, 32*z_axis.GetBinWidth(0));
-      for (int ix= 0; ix< 32; ++ix) {
-          for (int iy= 0; iy< 32; ++iy) {
-              for (int iz= 0; iz< 32; ++iz) {
-                  int cropped_index = ix*32*32 + iy*32 + iz%32;
-                  hist->SetBinContent(ix+1, iy+1, iz+1, fPECropped[cropped_index]);
-              }
-          }
+      for (unsigned int i_v= 0; i_v< fVoxelIndex.size(); ++i_v) {
+          const int cropped_index = CroppedIndex(fVoxelIndex[i_v]);
+          if (cropped_index < 0) continue;
+          const int ix = cropped_index/(32*32);
+          const int iy = (cropped_index/32)%32;
+          const int iz = cropped_index%32;
+          hist->SetBinContent(ix+1, iy+1, iz+1, fVoxelPE[i_v]);
       }
       return hist;
   }
@@ -8,6 +8,7 @@
 #define REGCNN_REGPIXELMAP3D_H
 
 #include <ostream>
+#include <unordered_map>
 #include <vector>
 
 #include "dunereco/RegCNN/func/RegCNNBoundary3D.h"
@@ -19,16 +20,38 @@ namespace cnn
 {
 
   /// RegPixelMap3D, input to 3D CNN neural net
+  /// Only the occupied voxels are stored, as (index, charge, prong tag) lists
+  /// sorted by index. Dense grids are only materialised on request.
   class RegPixelMap3D
   {
   public:
-    RegPixelMap3D(const RegCNNBoundary3D& bound, const bool& Cropped, const bool& prongOnly);
+    /// With cropOnly set (only meaningful for cropped maps) hits outside the
+    /// 32x32x32 crop window are dropped as they are added, so only the
+    /// cropped map is kept complete
+    RegPixelMap3D(const RegCNNBoundary3D& bound, const bool& Cropped, const bool& prongOnly,
+                  const bool& cropOnly = false);
     RegPixelMap3D() {};
     
     void AddHit(float rel_x, float rel_y, float rel_z, float charge, int hit_prong_tag);
     bool IsCroppedPM() const {return fCropped;};
-    std::vector<float> GetPM() const {return fPE;};
-    std::vector<float> GetCroppedPM() const {return fPECropped;};
+    /// Dense copies of the full and cropped (32x32x32) maps
+    std::vector<float> GetPM() const;
+    std::vector<float> GetCroppedPM() const;
+    /// Write the dense full/cropped maps into a caller owned buffer, which
+    /// is resized and zeroed as needed so it can be reused between events
+    void FillPM(std::vector<float>& buffer) const;
+    void FillCroppedPM(std::vector<float>& buffer) const;
+
+    /// Number of occupied voxels
+    unsigned int NVoxels() const {return fVoxelIndex.size();};
+    /// Flat index (see LocalToIndex) and charge of the occupied voxels
+    const std::vector<unsigned int>& VoxelIndices() const {return fVoxelIndex;};
+    const std::vector<float>& VoxelCharges() const {return fVoxelPE;};
+    /// Bin coordinates of a flat index
+    void IndexToLocal(unsigned int index, unsigned int& bin_x,
+                      unsigned int& bin_y, unsigned int& bin_z) const;
+    /// Index of a full map voxel in the cropped map, -1 if it is cropped away
+    int CroppedIndex(unsigned int index) const;
 
     // Add Finish method in order to determine whether to produce prong only/cropped
     // pixel maps or the full event/uncropped pixel maps
@@ -45,11 +68,14 @@ namespace cnn
     bool fCropped;
     bool fProngOnly;     //< whether to use prong only pixel map
     unsigned int fInPM;
-    std::vector<float> fPE; //< charges of all pixels
-    std::vector<float> fPECropped;
-    std::vector<int> fProngTag;
+    std::vector<unsigned int> fVoxelIndex; //< flat index of each occupied voxel
+    std::vector<float> fVoxelPE;           //< charge of each occupied voxel
+    std::vector<int> fVoxelProngTag;       //< prong tag of each occupied voxel
 
   private:
+    /// Voxel index -> position in the lists, only used while adding hits
+    std::unordered_map<unsigned int, unsigned int> fVoxelLookup; //! transient
+    bool fCropOnly = false; //! transient, only bin hits inside the crop window
     TAxis x_axis;
     TAxis y_axis;
     TAxis z_axis;
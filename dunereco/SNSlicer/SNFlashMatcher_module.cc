@@ -0,0 +1,150 @@
+// Matches the SNSlices to time clusters of OpHits
+
+#ifndef SNFlashMatcher_H
+#define SNFlashMatcher_H 1
+
+// Framework includes
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Persistency/Common/PtrMaker.h"
+#include "canvas/Persistency/Common/Assns.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// LArSoft includes
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "lardataobj/RecoBase/OpFlash.h"
+#include "lardataobj/RecoBase/OpHit.h"
+
+// C++ includes
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dunereco/SNSlicer/SNSlice.h"
+#include "dunereco/SNUtils/SNUtils.h"
+
+namespace
+{
+  class SNFlashMatcher: public art::EDProducer
+  {
+  public:
+    SNFlashMatcher(const fhicl::ParameterSet&);
+
+    void produce(art::Event&) override;
+
+  protected:
+    std::string fSliceLabel;
+    std::string fOpHitLabel;
+
+    /// OpHits further apart in time than this start a new cluster [us]
+    double fClusterGap;
+    /// A cluster matches a slice when it lies between a drift time plus
+    /// fWindowBefore before the slice and fWindowAfter after it [us]
+    double fWindowBefore;
+    double fWindowAfter;
+    /// Largest distance in z between the slice and the cluster, 0 for none [cm]
+    double fMaxDeltaZ;
+  };
+
+}
+
+#endif
+
+namespace {
+
+  DEFINE_ART_MODULE(SNFlashMatcher)
+
+}
+
+namespace {
+
+  //---------------------------------------------------------------------------
+  // Constructor
+  SNFlashMatcher::SNFlashMatcher(const fhicl::ParameterSet& pset)
+    : EDProducer(pset)
+  {
+    fSliceLabel = pset.get<std::string>("SliceLabel");
+    fOpHitLabel = pset.get<std::string>("OpHitLabel");
+    fClusterGap = pset.get<double>("ClusterGap");
+    fWindowBefore = pset.get<double>("WindowBefore", 0);
+    fWindowAfter = pset.get<double>("WindowAfter", 0);
+    fMaxDeltaZ = pset.get<double>("MaxDeltaZ", 0);
+
+    produces<std::vector<recob::OpFlash>>();
+    produces<art::Assns<recob::OpFlash, recob::OpHit>>();
+    produces<art::Assns<sn::SNSlice, recob::OpFlash>>();
+  }
+
+  //---------------------------------------------------------------------------
+  void SNFlashMatcher::produce(art::Event& evt)
+  {
+    const geo::GeometryCore& geom(*lar::providerFrom<geo::Geometry>());
+    const auto detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
+
+    auto flashcol = std::make_unique<std::vector<recob::OpFlash>>();
+    auto flashHits = std::make_unique<art::Assns<recob::OpFlash, recob::OpHit>>();
+    auto sliceFlashes = std::make_unique<art::Assns<sn::SNSlice, recob::OpFlash>>();
+
+    auto slices = evt.getValidHandle<std::vector<sn::SNSlice>>(fSliceLabel);
+    auto ophits = evt.getValidHandle<std::vector<recob::OpHit>>(fOpHitLabel);
+
+    const std::vector<sn::OpHitCluster> clusters = sn::ClusterOpHits(*ophits, fClusterGap);
+
+    const art::PtrMaker<recob::OpFlash> makeFlashPtr(evt);
+    std::vector<double> clusterTs;
+    clusterTs.reserve(clusters.size());
+    for(const sn::OpHitCluster& clust: clusters){
+      std::vector<double> pes(geom.NOpDets(), 0);
+      for(unsigned int i: clust.ophits){
+        const recob::OpHit& ophit = (*ophits)[i];
+        pes[geom.OpDetFromOpChannel(ophit.OpChannel())] += ophit.PE();
+      }
+
+      const recob::OpHit& first = (*ophits)[clust.ophits.front()];
+      const double absT = first.PeakTimeAbs() - first.PeakTime() + clust.time;
+      flashcol->emplace_back(clust.time, (clust.endT-clust.startT)/2, absT, first.Frame(), pes,
+                             false, 0, 1,
+                             clust.meanY, clust.widthY, clust.meanZ, clust.widthZ);
+
+      const art::Ptr<recob::OpFlash> flashPtr = makeFlashPtr(flashcol->size()-1);
+      for(unsigned int i: clust.ophits) flashHits->addSingle(flashPtr, art::Ptr<recob::OpHit>(ophits, i));
+
+      clusterTs.push_back(clust.time);
+    }
+
+    // A slice is seen by the light that arrived up to a full drift before it
+    const double driftLen = geom.Cryostat(0).TPC(0).DriftDistance();
+    const double driftT = driftLen / detProp.DriftVelocity();
+
+    std::vector<double> sliceTs;
+    sliceTs.reserve(slices->size());
+    for(const sn::SNSlice& slice: *slices) sliceTs.push_back(slice.meanT);
+
+    unsigned int nMatches = 0;
+    for(const auto& match: sn::MatchInTime(sliceTs, clusterTs, driftT + fWindowBefore, fWindowAfter)){
+      const sn::SNSlice& slice = (*slices)[match.first];
+      const sn::OpHitCluster& clust = clusters[match.second];
+      if(fMaxDeltaZ > 0 && std::abs(clust.meanZ - slice.meanZ) > fMaxDeltaZ) continue;
+
+      sliceFlashes->addSingle(art::Ptr<sn::SNSlice>(slices, match.first), makeFlashPtr(match.second));
+      ++nMatches;
+    }
+
+    mf::LogInfo("SNFlashMatcher") << slices->size() << " slices, " << clusters.size()
+                                  << " OpHit clusters, " << nMatches << " matches";
+
+    evt.put(std::move(flashcol));
+    evt.put(std::move(flashHits));
+    evt.put(std::move(sliceFlashes));
+  }
+
+} // namespace
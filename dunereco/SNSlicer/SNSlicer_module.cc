@@ -42,6 +42,13 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <unordered_map>
 
 #include "lardataobj/RecoBase/Cluster.h"
 #include "lardataobj/RecoBase/Hit.h"
@@ -50,6 +57,7 @@
 #include "lardataobj/RecoBase/Wire.h"
 
 
+#include "dunereco/DBSCAN/DBSCAN.h"
 #include "dunereco/SNSlicer/SNSlice.h"
 
 namespace
@@ -64,6 +72,46 @@ namespace
     int idx; // index into original hits array
   };
 
+  /// Points bucketed into square cells of side eps, so a neighbourhood
+  /// query only has to look at the 3x3 block of cells around a point
+  class PtGrid
+  {
+  public:
+    PtGrid(const std::vector<Pt2D>& D, double eps) : fEps(eps)
+    {
+      for(unsigned int i = 0; i < D.size(); ++i){
+        fCells[Key(Cell(D[i].x), Cell(D[i].y))].push_back(i);
+      }
+    }
+
+    /// All points closer than eps to p, including p itself, in index order
+    /// within each cell
+    void Query(const std::vector<Pt2D>& D, const Pt2D& p, std::vector<int>& ret) const
+    {
+      ret.clear();
+      const int64_t cx = Cell(p.x);
+      const int64_t cy = Cell(p.y);
+      for(int64_t ix = cx-1; ix <= cx+1; ++ix){
+        for(int64_t iy = cy-1; iy <= cy+1; ++iy){
+          auto it = fCells.find(Key(ix, iy));
+          if(it == fCells.end()) continue;
+          for(int i: it->second){
+            if((D[i].x-p.x)*(D[i].x-p.x) + (D[i].y-p.y)*(D[i].y-p.y) < fEps*fEps)
+              ret.push_back(i);
+          }
+        }
+      }
+    }
+
+  protected:
+    int64_t Cell(double v) const {return int64_t(std::floor(v/fEps));}
+    // Shifted as unsigned, left shifts of negative signed values are undefined
+    static uint64_t Key(int64_t ix, int64_t iy) {return (uint64_t(ix) << 32) ^ (uint64_t(iy) & 0xffffffff);}
+
+    double fEps;
+    std::unordered_map<uint64_t, std::vector<int>> fCells;
+  };
+
   class SNSlicer: public art::EDProducer 
   {
   public:
@@ -72,16 +120,14 @@ namespace
     void produce(art::Event&) override;
    
   protected:
-    std::vector<int> regionQuery(const std::vector<Pt2D>& D, const Pt2D& p) const;
-
-    void expandCluster(const std::vector<Pt2D>& D,
-                       int ip,
-                       std::vector<int> neiPts, int C,
-                       std::vector<bool>& visited,
-                       std::vector<int>& inClust) const;
-
+    /// DBSCAN of the whole event, on the backend of fDBSCANConfig
     std::vector<std::vector<Pt2D>> DBSCAN(const std::vector<Pt2D>& D) const;
 
+    /// DBSCAN over time ordered chunks of length fChunkLength, passing each
+    /// cluster to emit as soon as later hits can no longer change it. Sorts D
+    void StreamDBSCAN(std::vector<Pt2D>& D,
+                      const std::function<void(const std::vector<Pt2D>&)>& emit) const;
+
     //    std::string fDetSimProducerLabel;
 
 //    art::ServiceHandle<cheat::BackTrackerService> bt_serv;
@@ -94,6 +140,12 @@ namespace
     // DBScan params
     double fEps;
     int fMinPts;
+    /// Length (in the drift coordinate) of the chunks for the streaming
+    /// mode, 0 to cluster the whole event at once
+    double fChunkLength;
+    /// Device for the DBSCAN of whole events, the streaming mode always
+    /// runs on the CPU
+    dune::dbscan::Config fDBSCANConfig;
   };
 
 }
@@ -121,91 +173,159 @@ namespace {
 
     fEps = pset.get<double>("Eps");
     fMinPts = pset.get<int>("MinPts");
+    fChunkLength = pset.get<double>("ChunkLength", 0);
+    fDBSCANConfig = dune::dbscan::ConfigFromPSet(pset);
   }
 
   //---------------------------------------------------------------------------
-  std::vector<int> SNSlicer::regionQuery(const std::vector<Pt2D>& D, const Pt2D& p) const
+  std::vector<std::vector<Pt2D>> SNSlicer::DBSCAN(const std::vector<Pt2D>& D) const
   {
-    std::vector<int> ret;
-    for(unsigned int i = 0; i < D.size(); ++i){
-      if((D[i].x-p.x)*(D[i].x-p.x) + (D[i].y-p.y)*(D[i].y-p.y) < fEps*fEps)
-        ret.push_back(i);
+    std::vector<double> coords;
+    coords.reserve(2*D.size());
+    for(const Pt2D& p: D){
+      coords.push_back(p.x);
+      coords.push_back(p.y);
     }
-    return ret;
-  }
 
-  //---------------------------------------------------------------------------
-  std::vector<int> Join(const std::vector<int> a, const std::vector<int> b)
-  {
-    std::set<int> s(a.begin(), a.end());
-    s.insert(b.begin(), b.end());
+    std::vector<int> labels;
+    const size_t nClusters = dune::dbscan::Cluster(fDBSCANConfig, coords, 2, fEps, fMinPts, labels);
 
-    return std::vector<int>(s.begin(), s.end());
+    // Clusters are numbered from 1, the first slice stays empty
+    std::vector<std::vector<Pt2D>> ret(nClusters+1);
+    for(unsigned int i = 0; i < D.size(); ++i){
+      if(labels[i] >= 0) ret[labels[i]+1].push_back(D[i]);
+    }
+    return ret;
   }
 
   //---------------------------------------------------------------------------
-  void SNSlicer::expandCluster(const std::vector<Pt2D>& D,
-                               int ip,
-                               std::vector<int> neiPts, int C,
-                               std::vector<bool>& visited,
-                               std::vector<int>& inClust) const
+  void SNSlicer::StreamDBSCAN(std::vector<Pt2D>& D,
+                              const std::function<void(const std::vector<Pt2D>&)>& emit) const
   {
-    inClust[ip] = C;
-
-    bool any = true;
-    while(any){
-      any = false;
-      for(unsigned int iNP = 0; iNP < neiPts.size(); ++iNP){ // P'
-        if(inClust[neiPts[iNP]] == -1){
-          inClust[neiPts[iNP]] = C;
-        }
+    // Core points and their links are exactly those of DBSCAN, so the
+    // clusters are the same. Border points join the cluster of their first
+    // core neighbour, which can differ from the global version when a point
+    // borders two clusters. Only the window of hits within 2*eps of the
+    // unresolved ones, and the clusters still open, are kept in memory.
+    std::sort(D.begin(), D.end(), [](const Pt2D& a, const Pt2D& b){return a.y < b.y;});
+
+    struct PtState
+    {
+      bool coreKnown = false;
+      bool core = false;
+      bool assigned = false;
+      int node = -1; // cluster of a core point
+    };
+
+    struct Node
+    {
+      int parent;
+      double maxCoreY; // latest core point, a cluster can only grow near it
+      std::vector<Pt2D> members;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> openNodes;
+    auto find = [&nodes](int n){
+      while(nodes[n].parent != n){
+        nodes[n].parent = nodes[nodes[n].parent].parent;
+        n = nodes[n].parent;
+      }
+      return n;
+    };
+    auto join = [&nodes, &find](int a, int b){
+      a = find(a);
+      b = find(b);
+      if(a == b) return;
+      if(nodes[a].members.size() < nodes[b].members.size()) std::swap(a, b);
+      nodes[b].parent = a;
+      nodes[a].maxCoreY = std::max(nodes[a].maxCoreY, nodes[b].maxCoreY);
+      nodes[a].members.insert(nodes[a].members.end(), nodes[b].members.begin(), nodes[b].members.end());
+      std::vector<Pt2D>().swap(nodes[b].members);
+    };
+
+    const double inf = std::numeric_limits<double>::infinity();
+    const double chunk = std::max(fChunkLength, fEps);
+
+    std::deque<PtState> states; // states[k] is the state of D[wBegin+k]
+    unsigned int wBegin = 0, wEnd = 0;
+    std::vector<Pt2D> window;
+    std::vector<int> neiPts;
+
+    double b = D.empty() ? inf : D[0].y + chunk;
+    while(wBegin < D.size()){
+      // Take in the hits of this chunk plus the eps needed to find the core
+      // points up to its end
+      while(wEnd < D.size() && D[wEnd].y < b + fEps){
+        states.emplace_back();
+        ++wEnd;
+      }
+      if(wEnd == D.size()) b = inf; // nothing later can change anything
+
+      window.assign(D.begin() + wBegin, D.begin() + wEnd);
+      const PtGrid grid(window, fEps);
+
+      // Core status of the hits before b is now final
+      for(unsigned int k = 0; k < window.size() && window[k].y < b; ++k){
+        PtState& st = states[k];
+        if(st.coreKnown) continue;
+        st.coreKnown = true;
+        grid.Query(window, window[k], neiPts);
+        if(int(neiPts.size()) < fMinPts) continue;
+
+        st.core = true;
+        st.node = nodes.size();
+        nodes.push_back(Node{st.node, window[k].y, {window[k]}});
+        openNodes.push_back(st.node);
+        st.assigned = true;
+      }
 
-        if(!visited[neiPts[iNP]]){
-          visited[neiPts[iNP]] = true;
-          std::vector<int> neiPts2 = regionQuery(D, D[neiPts[iNP]]);
-          //        double Q = 0;
-          //        for(int i: neiPts2) Q += D[i].q;
-          const int Q = neiPts2.size();
-          if(Q >= fMinPts){
-            neiPts = Join(neiPts, neiPts2);
-            any = true;
-            break; // restart the while loop
+      // Link the new core points to their core neighbours, and attach the
+      // border points whose neighbours are all resolved
+      for(unsigned int k = 0; k < window.size() && window[k].y < b; ++k){
+        PtState& st = states[k];
+        if(st.core){
+          grid.Query(window, window[k], neiPts);
+          for(int j: neiPts){
+            if(states[j].coreKnown && states[j].core) join(st.node, states[j].node);
           }
         }
       }
-    }
-  }
+      for(unsigned int k = 0; k < window.size() && window[k].y < b - fEps; ++k){
+        PtState& st = states[k];
+        if(st.assigned) continue;
+        st.assigned = true;
+        grid.Query(window, window[k], neiPts);
+        for(int j: neiPts){
+          if(!states[j].core) continue;
+          nodes[find(states[j].node)].members.push_back(window[k]);
+          break;
+        }
+      }
 
-  //---------------------------------------------------------------------------
-  std::vector<std::vector<Pt2D>> SNSlicer::DBSCAN(const std::vector<Pt2D>& D) const
-  {
-    std::vector<bool> visited(D.size(), false);
-    //    std::vector<bool> noise(D.size(), false);
-    std::vector<int> inclust(D.size(), -1);
-
-    int C = 0; // TODO, should this be -1 since we ++ below?
-    for(unsigned int iD = 0; iD < D.size(); ++iD){
-      if(visited[iD]) continue;
-      visited[iD] = true;
-
-      std::vector<int> neiPts = regionQuery(D, D[iD]);
-      //      double Q = 0;
-      //      for(int i: neiPts) Q += /D[i].q;
-      const int Q = neiPts.size();
-      if(Q < fMinPts){
-        //        noise[iD] = true;
+      // Emit the clusters that no later core point can reach
+      unsigned int nOpen = 0;
+      for(int n: openNodes){
+        if(find(n) != n) continue;
+        if(nodes[n].maxCoreY < b - 2*fEps){
+          emit(nodes[n].members);
+          std::vector<Pt2D>().swap(nodes[n].members);
+        }
+        else{
+          openNodes[nOpen++] = n;
+        }
       }
-      else {
-        ++C;
-        expandCluster(D, iD, neiPts, C, visited, inclust);
+      openNodes.resize(nOpen);
+
+      // Forget the hits that nothing unresolved can be within eps of
+      while(wBegin < wEnd && states.front().assigned && D[wBegin].y < b - 2*fEps){
+        states.pop_front();
+        ++wBegin;
       }
-    }
 
-    std::vector<std::vector<Pt2D>> ret(C+1);
-    for(unsigned int i = 0; i < D.size(); ++i){
-      if(inclust[i] >= 0) ret[inclust[i]].push_back(D[i]);
+      if(b == inf) break;
+      b = std::max(b + chunk, wEnd < D.size() ? D[wEnd].y : b);
     }
-    return ret;
   }
 
   //---------------------------------------------------------------------------
@@ -305,10 +425,8 @@ namespace {
       if(isSig) totTrueQ += q;
     }
 
-    std::vector<std::vector<Pt2D>> slices = DBSCAN(pts);
-
-    for(const std::vector<Pt2D>& slice: slices){
-      if(slice.empty()) continue; // TODO - how does this happen?
+    auto makeSlice = [&](const std::vector<Pt2D>& slice){
+      if(slice.empty()) return; // TODO - how does this happen?
 
       sn::SNSlice prod;
 
@@ -328,6 +446,13 @@ namespace {
       prod.meanZ /= prod.totQ;
       
       slicecol->push_back(prod);
+    };
+
+    if(fChunkLength > 0){
+      StreamDBSCAN(pts, makeSlice);
+    }
+    else{
+      for(const std::vector<Pt2D>& slice: DBSCAN(pts)) makeSlice(slice);
     }
     
 
@@ -1,6 +1,8 @@
 #include "dunereco/SNSlicer/SNSlice.h"
 
+#include "canvas/Persistency/Common/Assns.h"
 #include "canvas/Persistency/Common/Wrapper.h"
+#include "lardataobj/RecoBase/OpFlash.h"
 
 #include <vector>
 
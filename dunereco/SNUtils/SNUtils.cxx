@@ -0,0 +1,222 @@
+#include "dunereco/SNUtils/SNUtils.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+
+#include "lardataalg/DetectorInfo/DetectorPropertiesData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace{
+  double mysqr(double x){return x*x;}
+
+  // Points further apart than this many sigma contribute less than 1e-10
+  // of their charge to each other's density and are skipped
+  const double kWindowSigmas = 7;
+}
+
+namespace sn
+{
+  //---------------------------------------------------------------------------
+  double TimeCluster(std::vector<std::pair<double, double>>& pts,
+                     double& clustPE)
+  {
+    // "Clustering by Fast Search and Find of Density Peaks"
+    // Rodriguez and Laio, Science, 2014
+
+    const double sigma = 5; // characteristic time
+    const double sigsq = mysqr(sigma);
+    const double window = kWindowSigmas*sigma;
+
+    //    const double norm = 1/(sqrt(2*TMath::Pi())*sigma);
+
+    std::sort(pts.begin(), pts.end()); // Sort points by time
+
+    const unsigned int N = pts.size();
+    std::vector<double> ts(N), qs(N);
+    for(unsigned int i = 0; i < N; ++i){
+      ts[i] = pts[i].first;
+      qs[i] = pts[i].second;
+    }
+
+    std::vector<double> rhos(N, 0); // densities
+    std::vector<double> args;
+
+    // Because the points are sorted the window [lo, hi) of points within
+    // range of point i only ever moves forwards
+    unsigned int lo = 0, hi = 0;
+    for(unsigned int i = 0; i < N; ++i){
+      const double ti = ts[i];
+      while(ts[lo] < ti - window) ++lo;
+      while(hi < N && ts[hi] <= ti + window) ++hi;
+
+      // Exponent arguments first, then the charge weighted sum of the
+      // exponentials, both as plain loops over contiguous arrays that the
+      // compiler can vectorise
+      const unsigned int n = hi - lo;
+      args.resize(n);
+      const double* t = &ts[lo];
+      for(unsigned int k = 0; k < n; ++k) args[k] = -mysqr(ti-t[k])/(2*sigsq);
+
+      const double* q = &qs[lo];
+      double rho = 0;
+      for(unsigned int k = 0; k < n; ++k) rho += q[k]*std::exp(args[k]);
+      rhos[i] = rho;
+    } // end for i
+
+    double bestScore = 0;
+    double bestT = 0;
+    for(unsigned int i = 0; i < N; ++i){
+      if(rhos[i] > bestScore){
+        bestScore = rhos[i];
+        bestT = ts[i];
+        clustPE = rhos[i];
+      }
+    }
+    return bestT;
+  }
+
+  //---------------------------------------------------------------------------
+  double FindSliceTZero(const detinfo::DetectorPropertiesData& detProp,
+                        const std::vector<recob::OpHit>& ophits,
+                        double sliceMeanT,
+                        double sliceMeanZ,
+                        double& flashPhots)
+  {
+    const geo::GeometryCore& geom(*lar::providerFrom<geo::Geometry>());
+
+    const double driftLen = geom.Cryostat(0).TPC(0).DriftDistance();
+    const double driftT = driftLen / detProp.DriftVelocity();
+
+    double ophitTotQ = 0;
+
+    // Times and PE weights, to calculate median
+    std::vector<std::pair<double, double>> ophitTs;
+
+    for(const recob::OpHit& ophit: ophits){
+      double xyz[3];
+      geom.OpDetGeoFromOpChannel(ophit.OpChannel()).GetCenter(xyz);
+
+      // Only use hits that are close enough to be consistent
+      if(ophit.PeakTime() < sliceMeanT &&
+         ophit.PeakTime() > sliceMeanT-driftT &&
+         fabs(xyz[2]-sliceMeanZ) < 600){ // 2sigma?*/
+
+        ophitTotQ += ophit.PE();
+        ophitTs.emplace_back(ophit.PeakTime(), ophit.PE());
+      }
+    } // end for ophit
+
+    return TimeCluster(ophitTs, flashPhots);
+  }
+
+  //---------------------------------------------------------------------------
+  double AttenFactor(double dt)
+  {
+    // From an expo fit of totQ/trueE vs dt
+    //    return exp(4.83617-0.00037413*dt);
+    return 128.734*exp(-0.000357316*dt);
+  }
+
+  //---------------------------------------------------------------------------
+  double SliceEnergy(const detinfo::DetectorPropertiesData& detProp,
+                     const sn::SNSlice& slice,
+                     const std::vector<recob::OpHit>& ophits)
+  {
+    double junk;
+    const double t0 = FindSliceTZero(detProp, ophits, slice.meanT, slice.meanZ, junk);
+    const double dt = slice.meanT - t0;
+
+    return slice.totQ / AttenFactor(dt);
+  }
+
+  //---------------------------------------------------------------------------
+  std::vector<OpHitCluster> ClusterOpHits(const std::vector<recob::OpHit>& ophits,
+                                          double maxGap)
+  {
+    const geo::GeometryCore& geom(*lar::providerFrom<geo::Geometry>());
+
+    std::vector<unsigned int> order(ophits.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&ophits](unsigned int a, unsigned int b){
+        return ophits[a].PeakTime() < ophits[b].PeakTime();
+      });
+
+    std::vector<OpHitCluster> ret;
+    std::vector<std::pair<double, double>> pts;
+    for(unsigned int first = 0; first < order.size();){
+      unsigned int last = first+1;
+      while(last < order.size() &&
+            ophits[order[last]].PeakTime() - ophits[order[last-1]].PeakTime() <= maxGap) ++last;
+
+      OpHitCluster clust;
+      clust.startT = ophits[order[first]].PeakTime();
+      clust.endT = ophits[order[last-1]].PeakTime();
+      clust.totPE = 0;
+      double sumY = 0, sumYY = 0, sumZ = 0, sumZZ = 0;
+      pts.clear();
+      for(unsigned int i = first; i < last; ++i){
+        const recob::OpHit& ophit = ophits[order[i]];
+        double xyz[3];
+        geom.OpDetGeoFromOpChannel(ophit.OpChannel()).GetCenter(xyz);
+
+        clust.totPE += ophit.PE();
+        sumY += ophit.PE()*xyz[1];
+        sumYY += ophit.PE()*mysqr(xyz[1]);
+        sumZ += ophit.PE()*xyz[2];
+        sumZZ += ophit.PE()*mysqr(xyz[2]);
+        clust.ophits.push_back(order[i]);
+        pts.emplace_back(ophit.PeakTime(), ophit.PE());
+      }
+
+      const double norm = clust.totPE > 0 ? 1/clust.totPE : 0;
+      clust.meanY = sumY*norm;
+      clust.widthY = std::sqrt(std::max(0., sumYY*norm - mysqr(clust.meanY)));
+      clust.meanZ = sumZ*norm;
+      clust.widthZ = std::sqrt(std::max(0., sumZZ*norm - mysqr(clust.meanZ)));
+
+      double peakPE;
+      clust.time = TimeCluster(pts, peakPE);
+
+      ret.push_back(std::move(clust));
+      first = last;
+    }
+    return ret;
+  }
+
+  //---------------------------------------------------------------------------
+  std::vector<std::pair<unsigned int, unsigned int>>
+  MatchInTime(const std::vector<double>& sliceTs,
+              const std::vector<double>& clusterTs,
+              double before, double after)
+  {
+    std::vector<unsigned int> slices(sliceTs.size());
+    std::iota(slices.begin(), slices.end(), 0);
+    std::sort(slices.begin(), slices.end(), [&sliceTs](unsigned int a, unsigned int b){
+        return sliceTs[a] < sliceTs[b];
+      });
+
+    std::vector<unsigned int> clusters(clusterTs.size());
+    std::iota(clusters.begin(), clusters.end(), 0);
+    std::sort(clusters.begin(), clusters.end(), [&clusterTs](unsigned int a, unsigned int b){
+        return clusterTs[a] < clusterTs[b];
+      });
+
+    std::vector<std::pair<unsigned int, unsigned int>> ret;
+
+    // The start of the window only moves forwards as the slice time grows,
+    // so lo never goes back, and the scan from lo stops at the first cluster
+    // past the end of the window
+    unsigned int lo = 0;
+    for(unsigned int s: slices){
+      const double t = sliceTs[s];
+      while(lo < clusters.size() && clusterTs[clusters[lo]] < t-before) ++lo;
+      for(unsigned int k = lo; k < clusters.size() && clusterTs[clusters[k]] <= t+after; ++k){
+        ret.emplace_back(s, clusters[k]);
+      }
+    }
+    return ret;
+  }
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       BatchTuner
+////
+//// Online choice of the batch size of a network wrapper.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TFRuntime/TFBatchTuner.h"
+
+#include <algorithm>
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+tf::BatchTuner::BatchTuner(const std::string & name, std::vector<size_t> candidates, size_t maxBatch,
+                           unsigned int tuneCalls, double maxLatency) :
+    fName(name),
+    fTuneCalls(tuneCalls),
+    fMaxLatency(maxLatency)
+{
+    if (candidates.empty())
+    {
+        for (size_t size = 1; size <= (maxBatch ? maxBatch : 64); size *= 2) { candidates.push_back(size); }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (size_t size : candidates)
+    {
+        if (size > 0 && (maxBatch == 0 || size <= maxBatch)) { fTimings.push_back({size}); }
+    }
+    if (fTimings.empty()) { fTimings.push_back({maxBatch ? maxBatch : 1}); }
+
+    // Every candidate gets a call at least
+    fTuneCalls = std::max<unsigned int>(fTuneCalls, fTimings.size());
+}
+
+size_t tf::BatchTuner::NextBatchSize()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fChosen) { return fChosen; }
+
+    if (fNCalls >= fTuneCalls)
+    {
+        Choose();
+        return fChosen;
+    }
+    return fTimings[fNCalls++ % fTimings.size()].batchSize;
+}
+
+void tf::BatchTuner::Record(size_t batchSize, size_t samples, double seconds)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fChosen) { return; }
+
+    if (!fWarm)
+    {
+        fWarm = true;
+        return;
+    }
+    // The last batch of a call is usually short, it says nothing about its batch size
+    if (samples != batchSize) { return; }
+
+    for (Timing & timing : fTimings)
+    {
+        if (timing.batchSize != batchSize) { continue; }
+        ++timing.nBatches;
+        timing.time += seconds;
+        timing.maxTime = std::max(timing.maxTime, seconds);
+    }
+}
+
+bool tf::BatchTuner::Tuning() const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fChosen == 0;
+}
+
+void tf::BatchTuner::Choose()
+{
+    // Candidates that never saw a full batch are larger than the calls, so the
+    // largest of them runs every call in one batch
+    const Timing * best = nullptr;
+    double bestRate = 0.;
+    size_t unmeasured = 0;
+    for (const Timing & timing : fTimings)
+    {
+        if (timing.nBatches == 0) { unmeasured = std::max(unmeasured, timing.batchSize); continue; }
+        if (fMaxLatency > 0. && timing.time / timing.nBatches > fMaxLatency) { continue; }
+
+        const double rate = timing.batchSize * timing.nBatches / timing.time;
+        if (!best || rate > bestRate) { best = &timing; bestRate = rate; }
+    }
+
+    if (best) { fChosen = best->batchSize; }
+    else if (unmeasured) { fChosen = unmeasured; }
+    else { fChosen = fTimings.front().batchSize; }  // nothing meets the latency cap, take the quickest batches
+
+    mf::LogInfo log("BatchTuner");
+    log << fName << ": after " << fNCalls << " calls\n";
+    for (const Timing & timing : fTimings)
+    {
+        log << "  batch size " << timing.batchSize << ": ";
+        if (timing.nBatches == 0) { log << "no full batch\n"; continue; }
+        log << timing.nBatches << " batches, " << 1000. * timing.time / timing.nBatches << " ms/batch (max "
+            << 1000. * timing.maxTime << " ms), " << timing.batchSize * timing.nBatches / timing.time << " samples/s\n";
+    }
+    log << "  chose batch size " << fChosen;
+    if (fMaxLatency > 0.) { log << " under " << 1000. * fMaxLatency << " ms/batch"; }
+    log << ", set it as the batch size to skip the tuning";
+}
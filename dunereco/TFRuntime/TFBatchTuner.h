@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       BatchTuner
+////
+//// Online choice of the batch size of a network wrapper. For the first
+//// calls (typically one per event) the wrapper is handed each candidate
+//// size in turn and reports the time of every batch. The candidate with the
+//// best throughput whose batches stay under the latency cap is then kept for
+//// the rest of the job, and the measurements are printed so production
+//// configurations can pin it.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_BATCH_TUNER_H
+#define TF_BATCH_TUNER_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tf
+{
+
+class BatchTuner
+{
+public:
+    /// candidates: batch sizes to try, an empty list means powers of two up to
+    /// maxBatch. maxBatch (0 = no cap) bounds the candidates, e.g. for memory.
+    /// tuneCalls: calls spent trying the candidates. maxLatency: maximum
+    /// seconds per batch, 0 = no cap
+    BatchTuner(const std::string & name, std::vector<size_t> candidates, size_t maxBatch,
+               unsigned int tuneCalls, double maxLatency);
+
+    /// Batch size for the next call of the wrapper
+    size_t NextBatchSize();
+
+    /// Report that a batch of samples inputs, cut for the given batch size,
+    /// took the given time. Only full batches are measured
+    void Record(size_t batchSize, size_t samples, double seconds);
+
+    bool Tuning() const;
+
+private:
+    /// Pick the batch size from the measurements and print them, fMutex being held
+    void Choose();
+
+    struct Timing
+    {
+        size_t batchSize;
+        unsigned int nBatches = 0;
+        double time = 0.;
+        double maxTime = 0.;
+    };
+
+    std::string fName;
+    std::vector<Timing> fTimings;
+    unsigned int fTuneCalls;
+    double fMaxLatency;
+
+    mutable std::mutex fMutex;
+    unsigned int fNCalls = 0;
+    bool fWarm = false;  ///< The first batch, which pays for loading the network, has been seen
+    size_t fChosen = 0;  ///< Chosen batch size, 0 while tuning
+};
+
+} // namespace tf
+
+#endif
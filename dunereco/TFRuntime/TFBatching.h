@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Function:    ForEachBatch
+////
+//// Split n samples into consecutive batches of at most maxBatch samples
+//// (0 = a single batch) and call f(first, last) for each of them. Shared by
+//// the wrappers that pack several inputs into one session call.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_BATCHING_H
+#define TF_BATCHING_H
+
+#include <algorithm>
+#include <cstddef>
+
+namespace tf
+{
+
+template <typename F>
+void ForEachBatch(size_t n, size_t maxBatch, F && f)
+{
+    const size_t batchSize = (maxBatch == 0) ? n : maxBatch;
+    for (size_t first = 0; first < n; first += batchSize)
+    {
+        f(first, std::min(n, first + batchSize));
+    }
+}
+
+} // namespace tf
+
+#endif
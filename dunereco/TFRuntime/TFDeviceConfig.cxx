@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      DeviceConfig
+////
+//// Device placement of the sessions of the dunereco Tensorflow wrappers
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TFRuntime/TFDeviceConfig.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+
+void tf::ApplyDeviceConfig(const DeviceConfig & device, tensorflow::SessionOptions & options)
+{
+    tensorflow::ConfigProto &config = options.config;
+    if (device.placement == DeviceConfig::kDefault) { return; }
+    if (device.placement == DeviceConfig::kCPU)
+    {
+        // Keep CPU jobs off any GPU of the node
+        (*config.mutable_device_count())["GPU"] = 0;
+        return;
+    }
+
+    // Ops without a GPU kernel fall back to the CPU
+    config.set_allow_soft_placement(true);
+    tensorflow::GPUOptions *gpu = config.mutable_gpu_options();
+    gpu->set_allow_growth(true);
+    if (!device.visibleGPUs.empty()) { gpu->set_visible_device_list(device.visibleGPUs); }
+    if (device.gpuMemoryFraction > 0.) { gpu->set_per_process_gpu_memory_fraction(device.gpuMemoryFraction); }
+}
+
+bool tf::ParsePlacement(const std::string & name, DeviceConfig::Placement & placement)
+{
+    if (name == "default") { placement = DeviceConfig::kDefault; }
+    else if (name == "cpu") { placement = DeviceConfig::kCPU; }
+    else if (name == "gpu") { placement = DeviceConfig::kGPU; }
+    else { return false; }
+    return true;
+}
+
+std::string tf::DeviceKey(const DeviceConfig & device)
+{
+    switch (device.placement)
+    {
+        case DeviceConfig::kCPU: return "|cpu";
+        case DeviceConfig::kGPU: return "|gpu:" + device.visibleGPUs + ":" + std::to_string(device.gpuMemoryFraction);
+        default: return "";
+    }
+}
+
+bool tf::HasGPU(tensorflow::Session & session)
+{
+    std::vector<tensorflow::DeviceAttributes> devices;
+    if (!session.ListDevices(&devices).ok()) { return false; }
+    for (auto const & device : devices)
+    {
+        if (device.device_type() == "GPU") { return true; }
+    }
+    return false;
+}
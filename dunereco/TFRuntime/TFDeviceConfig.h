@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      DeviceConfig
+////
+//// Device placement of the sessions of the dunereco Tensorflow wrappers. By
+//// default Tensorflow places the graph itself. kCPU hides the GPUs of the node
+//// from the session. kGPU places the graph on a GPU, taking its memory as it
+//// needs it, with ops without a GPU kernel on the CPU; without a usable GPU
+//// the session is made on the CPU instead.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_DEVICE_CONFIG_H
+#define TF_DEVICE_CONFIG_H
+
+#include <string>
+
+namespace tensorflow
+{
+    struct SessionOptions;
+    class Session;
+}
+
+namespace tf
+{
+
+struct DeviceConfig
+{
+    enum Placement { kDefault, kCPU, kGPU };
+
+    Placement placement = kDefault;
+    std::string visibleGPUs = "";   ///< kGPU: CUDA devices the job may use, e.g. "0" or "0,1" ("" = all)
+    double gpuMemoryFraction = 0.;  ///< kGPU: upper bound of the memory taken on each GPU (0 = only what is needed)
+};
+
+/// Placement of a FHiCL "default", "cpu" or "gpu", false for anything else
+bool ParsePlacement(const std::string & name, DeviceConfig::Placement & placement);
+
+/// Fill the device part of the session options
+void ApplyDeviceConfig(const DeviceConfig & device, tensorflow::SessionOptions & options);
+
+/// Suffix of the registry key, sessions with different placements are not shared
+std::string DeviceKey(const DeviceConfig & device);
+
+/// Whether the session has a GPU device
+bool HasGPU(tensorflow::Session & session);
+
+} // namespace tf
+
+#endif
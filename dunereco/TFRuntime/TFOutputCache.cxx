@@ -0,0 +1,319 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       OutputCache
+////
+//// Persistent cache of network outputs for the dunereco network wrappers.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TFRuntime/TFOutputCache.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    inline uint64_t Rotate(uint64_t x, unsigned n) { return (x << n) | (x >> (64 - n)); }
+
+    /// Finaliser of splitmix64
+    inline uint64_t Avalanche(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    /// Hash the bytes of a file, in blocks
+    void HashFile(tf::Hash128 & hash, const std::filesystem::path & path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) { throw std::runtime_error("Could not read " + path.string() + " to hash the model"); }
+
+        std::vector<char> block(1 << 20);
+        while (in)
+        {
+            in.read(block.data(), block.size());
+            hash.Update(block.data(), in.gcount());
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void tf::Hash128::Update(const void * data, size_t bytes)
+{
+    const unsigned char * p = static_cast<const unsigned char*>(data);
+    const unsigned char * end = p + bytes;
+    fBytes += bytes;
+
+    auto mix = [this](uint64_t word)
+    {
+        fA = Rotate(fA ^ (word * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+        fB = (Rotate(fB + word, 27) ^ fA) * 0x9e3779b97f4a7c15ULL + 0x52dce729;
+    };
+
+    // Top up a word left partly filled by the last call, then take whole words
+    while (fTailSize != 0 && p != end)
+    {
+        fTail |= uint64_t(*p++) << (8 * fTailSize);
+        if (++fTailSize == 8) { mix(fTail); fTail = 0; fTailSize = 0; }
+    }
+    for (; end - p >= 8; p += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        mix(word);
+    }
+    for (; p != end; ++p) { fTail |= uint64_t(*p) << (8 * fTailSize++); }
+}
+
+std::string tf::Hash128::Digest() const
+{
+    // The byte count keeps inputs differing only by trailing zeros apart
+    uint64_t a = Avalanche(fA ^ fTail ^ Rotate(fBytes, 17));
+    uint64_t b = Avalanche(fB + fTail * 0xff51afd7ed558ccdULL + fBytes);
+    a += b;
+    b += a;
+
+    std::string digest(16, '\0');
+    std::memcpy(&digest[0], &a, 8);
+    std::memcpy(&digest[8], &b, 8);
+    return digest;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+std::unique_ptr<tf::OutputCache> tf::OutputCache::Open(const std::string & file, const std::string & modelPath,
+                                                       const std::string & tag)
+{
+    std::string modelKey;
+    try { modelKey = ModelKey(modelPath, tag); }
+    catch (const std::exception & e)
+    {
+        mf::LogWarning("OutputCache") << e.what() << ", not caching the outputs.";
+        return nullptr;
+    }
+
+    sqlite3 * db = nullptr;
+    if (sqlite3_open_v2(file.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr) != SQLITE_OK)
+    {
+        mf::LogWarning("OutputCache") << "Could not open " << file << ": " << sqlite3_errmsg(db)
+                                      << ", not caching the outputs.";
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // Several processes may share the file: readers don't block the writer in WAL mode,
+    // and a writer waits for another rather than failing
+    sqlite3_busy_timeout(db, 10000);
+    const char * setup =
+        "PRAGMA journal_mode=WAL;"
+        "PRAGMA synchronous=NORMAL;"
+        "CREATE TABLE IF NOT EXISTS outputs (key BLOB PRIMARY KEY, value BLOB NOT NULL);";
+    char * error = nullptr;
+    if (sqlite3_exec(db, setup, nullptr, nullptr, &error) != SQLITE_OK)
+    {
+        mf::LogWarning("OutputCache") << "Could not set up " << file << ": " << (error ? error : "unknown error")
+                                      << ", not caching the outputs.";
+        sqlite3_free(error);
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    std::unique_ptr<OutputCache> cache(new OutputCache(file, db, modelKey));
+    if (sqlite3_prepare_v2(db, "SELECT value FROM outputs WHERE key = ?1", -1, &cache->fSelect, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO outputs (key, value) VALUES (?1, ?2)", -1, &cache->fInsert, nullptr) != SQLITE_OK)
+    {
+        mf::LogWarning("OutputCache") << "Could not prepare the queries of " << file << ": " << sqlite3_errmsg(db)
+                                      << ", not caching the outputs.";
+        return nullptr;
+    }
+    return cache;
+}
+
+tf::OutputCache::OutputCache(const std::string & file, sqlite3 * db, std::string modelKey) :
+    fFile(file),
+    fDB(db),
+    fModelKey(std::move(modelKey))
+{
+}
+
+tf::OutputCache::~OutputCache()
+{
+    sqlite3_finalize(fSelect);
+    sqlite3_finalize(fInsert);
+    sqlite3_close(fDB);
+
+    if (fNHits + fNMisses)
+    {
+        mf::LogInfo("OutputCache") << fFile << ": " << fNHits << " hits, " << fNMisses << " misses.";
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+std::string tf::OutputCache::ModelKey(const std::string & modelPath, const std::string & tag)
+{
+    namespace fs = std::filesystem;
+
+    Hash128 hash;
+    if (fs::is_directory(modelPath))
+    {
+        // A SavedModel is a folder: hash its files in a fixed order, with their relative paths
+        std::vector<fs::path> files;
+        for (const auto & entry : fs::recursive_directory_iterator(modelPath))
+        {
+            if (entry.is_regular_file()) { files.push_back(entry.path()); }
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto & path : files)
+        {
+            const std::string name = path.lexically_relative(modelPath).generic_string();
+            hash.Update(name.data(), name.size() + 1);
+            HashFile(hash, path);
+        }
+    }
+    else { HashFile(hash, modelPath); }
+
+    hash.Update(tag.data(), tag.size());
+    return hash.Digest();
+}
+
+std::string tf::OutputCache::Key(const std::vector< std::pair<const void*, size_t> > & buffers) const
+{
+    Hash128 hash;
+    hash.Update(fModelKey.data(), fModelKey.size());
+    for (const auto & buffer : buffers)
+    {
+        // The sizes keep the buffer boundaries part of the key
+        const uint64_t bytes = buffer.second;
+        hash.Update(&bytes, sizeof(bytes));
+        hash.Update(buffer.first, buffer.second);
+    }
+    return hash.Digest();
+}
+
+std::vector<std::string> tf::OutputCache::SampleKeys(const std::vector<tensorflow::Tensor> & inputs) const
+{
+    if (inputs.empty()) { return {}; }
+
+    const int64_t nSamples = inputs.front().dim_size(0);
+    std::vector<std::string> keys;
+    keys.reserve(nSamples);
+
+    std::vector< std::pair<const void*, size_t> > buffers(inputs.size());
+    for (int64_t s = 0; s < nSamples; ++s)
+    {
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            const auto data = inputs[i].SubSlice(s).tensor_data();
+            buffers[i] = { data.data(), data.size() };
+        }
+        keys.push_back(Key(buffers));
+    }
+    return keys;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool tf::OutputCache::Find(const std::string & key, Outputs & outputs)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    sqlite3_bind_blob(fSelect, 1, key.data(), key.size(), SQLITE_STATIC);
+    bool found = false;
+    if (sqlite3_step(fSelect) == SQLITE_ROW)
+    {
+        // Stored as the number of outputs, then the size and values of each
+        const char * p = static_cast<const char*>(sqlite3_column_blob(fSelect, 0));
+        const char * end = p + sqlite3_column_bytes(fSelect, 0);
+        uint32_t n = 0;
+        if (end - p >= 4) { std::memcpy(&n, p, 4); p += 4; found = true; }
+        outputs.assign(n, {});
+        for (uint32_t o = 0; o < n && found; ++o)
+        {
+            uint32_t size = 0;
+            if (end - p < 4) { found = false; break; }
+            std::memcpy(&size, p, 4); p += 4;
+            if (size_t(end - p) < size * sizeof(float)) { found = false; break; }
+            outputs[o].resize(size);
+            std::memcpy(outputs[o].data(), p, size * sizeof(float));
+            p += size * sizeof(float);
+        }
+    }
+    sqlite3_reset(fSelect);
+    sqlite3_clear_bindings(fSelect);
+
+    if (found) { ++fNHits; } else { ++fNMisses; outputs.clear(); }
+    return found;
+}
+
+void tf::OutputCache::Insert(const std::string & key, const Outputs & outputs)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    Store(key, outputs);
+}
+
+void tf::OutputCache::Store(const std::string & key, const Outputs & outputs)
+{
+    std::string value;
+    const uint32_t n = outputs.size();
+    value.append(reinterpret_cast<const char*>(&n), 4);
+    for (const auto & output : outputs)
+    {
+        const uint32_t size = output.size();
+        value.append(reinterpret_cast<const char*>(&size), 4);
+        value.append(reinterpret_cast<const char*>(output.data()), size * sizeof(float));
+    }
+
+    sqlite3_bind_blob(fInsert, 1, key.data(), key.size(), SQLITE_STATIC);
+    sqlite3_bind_blob(fInsert, 2, value.data(), value.size(), SQLITE_STATIC);
+    if (sqlite3_step(fInsert) != SQLITE_DONE)
+    {
+        // Not fatal: the outputs are just computed again next time
+        mf::LogWarning("OutputCache") << "Could not store in " << fFile << ": " << sqlite3_errmsg(fDB);
+    }
+    sqlite3_reset(fInsert);
+    sqlite3_clear_bindings(fInsert);
+}
+
+std::vector<tf::OutputCache::Outputs> tf::OutputCache::GetOrCompute(const std::vector<std::string> & keys,
+    const std::function<std::vector<Outputs>(const std::vector<size_t>&)> & compute,
+    const std::function<bool(const Outputs&)> & keep)
+{
+    std::vector<Outputs> result(keys.size());
+    std::vector<size_t> missed;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (!Find(keys[i], result[i])) { missed.push_back(i); }
+    }
+    if (missed.empty()) { return result; }
+
+    std::vector<Outputs> computed = compute(missed);
+    if (computed.size() != missed.size())
+    {
+        throw std::runtime_error("tf::OutputCache: computed " + std::to_string(computed.size()) +
+                                 " outputs for " + std::to_string(missed.size()) + " inputs");
+    }
+
+    {
+        // One transaction for the batch, so the file is synced once
+        std::lock_guard<std::mutex> lock(fMutex);
+        sqlite3_exec(fDB, "BEGIN", nullptr, nullptr, nullptr);
+        for (size_t m = 0; m < missed.size(); ++m)
+        {
+            if (!computed[m].empty() && (!keep || keep(computed[m]))) { Store(keys[missed[m]], computed[m]); }
+        }
+        sqlite3_exec(fDB, "COMMIT", nullptr, nullptr, nullptr);
+    }
+    for (size_t m = 0; m < missed.size(); ++m) { result[missed[m]] = std::move(computed[m]); }
+
+    return result;
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       OutputCache
+////
+//// Persistent cache of network outputs for the dunereco network wrappers,
+//// kept in an SQLite file so reprocessing the same inputs with the same
+//// model costs a hash instead of a session call. A result is stored under
+//// a 128 bit hash of the model file (or SavedModel folder), a tag for any
+//// setting that changes the outputs, and the bytes of the input. Several
+//// wrappers and art processes can share a file: SQLite does the locking.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_OUTPUT_CACHE_H
+#define TF_OUTPUT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace tensorflow
+{
+    class Tensor;
+}
+
+namespace tf
+{
+
+/// 128 bit non-cryptographic hash of a byte stream, fed 8 bytes at a time
+class Hash128
+{
+public:
+    void Update(const void * data, size_t bytes);
+    /// The 16 bytes of the hash of everything fed so far
+    std::string Digest() const;
+
+private:
+    uint64_t fA = 0x9e3779b97f4a7c15ULL;
+    uint64_t fB = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t fBytes = 0;
+    uint64_t fTail = 0;     ///< Bytes fed since the last full word
+    unsigned fTailSize = 0;
+};
+
+class OutputCache
+{
+public:
+    typedef std::vector< std::vector<float> > Outputs;
+
+    /// Open the cache in the given file, creating it if needed, for the model
+    /// at modelPath. Returns nullptr, with a warning, if the file can't be used
+    static std::unique_ptr<OutputCache> Open(const std::string & file, const std::string & modelPath,
+                                             const std::string & tag = "");
+    ~OutputCache();
+
+    OutputCache(const OutputCache&) = delete;
+    OutputCache& operator=(const OutputCache&) = delete;
+
+    /// Key of one input, given as buffers of bytes
+    std::string Key(const std::vector< std::pair<const void*, size_t> > & buffers) const;
+
+    /// Key of each sample of a batch of input tensors, the first dimension
+    /// being the sample
+    std::vector<std::string> SampleKeys(const std::vector<tensorflow::Tensor> & inputs) const;
+
+    bool Find(const std::string & key, Outputs & outputs);
+    void Insert(const std::string & key, const Outputs & outputs);
+
+    /// Outputs for the inputs with the given keys. Those not in the cache are
+    /// computed together by compute, given their indices in order, and stored
+    /// unless they are empty or keep, if given, turns them down
+    std::vector<Outputs> GetOrCompute(const std::vector<std::string> & keys,
+                                      const std::function<std::vector<Outputs>(const std::vector<size_t>&)> & compute,
+                                      const std::function<bool(const Outputs&)> & keep = nullptr);
+
+private:
+    OutputCache(const std::string & file, sqlite3 * db, std::string modelKey);
+
+    /// Write one entry, fMutex being held
+    void Store(const std::string & key, const Outputs & outputs);
+
+    /// Hash of the model file, or of the files of a model folder
+    static std::string ModelKey(const std::string & modelPath, const std::string & tag);
+
+    std::string fFile;
+    sqlite3 * fDB = nullptr;
+    sqlite3_stmt * fSelect = nullptr;
+    sqlite3_stmt * fInsert = nullptr;
+    std::string fModelKey;
+
+    std::mutex fMutex;
+    unsigned long fNHits = 0;
+    unsigned long fNMisses = 0;
+};
+
+} // namespace tf
+
+#endif
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SharedSession, SessionRegistry
+////
+//// Job-wide registry of Tensorflow sessions shared by the dunereco network wrappers.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TFRuntime/TFSessionRegistry.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/cc/saved_model/loader.h"
+#include "tensorflow/cc/saved_model/tag_constants.h"
+#include "tensorflow/core/util/memmapped_file_system.h"
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// -------------------------------------------------------------------
+tf::SharedSession::SharedSession(const std::string & path, tensorflow::Session* session,
+                                 std::vector<std::string> nodeNames,
+                                 std::vector<std::string> inputNames, std::vector<std::string> outputNames,
+                                 std::unique_ptr<tensorflow::Env> env) :
+    fPath(path),
+    fEnv(std::move(env)),
+    fSession(session),
+    fNodeNames(std::move(nodeNames)),
+    fSignatureInputs(std::move(inputNames)),
+    fSignatureOutputs(std::move(outputNames))
+{
+}
+
+tf::SharedSession::~SharedSession()
+{
+    if (fNCalls > 0)
+    {
+        mf::LogInfo("SharedSession") << fPath << ": " << fNCalls << " calls, "
+                                     << fTotalTime << " s, " << 1000. * fTotalTime / fNCalls << " ms/call";
+    }
+    if ( ! fSession->Close().ok() ) {
+      std::cout << "tf::SharedSession::dtor: " << "Close failed." << std::endl;
+    }
+}
+
+tensorflow::Status tf::SharedSession::Run(const std::vector< std::pair<std::string, tensorflow::Tensor> > & inputs,
+                                          const std::vector<std::string> & outputNames,
+                                          std::vector<tensorflow::Tensor> * outputs)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto status = fSession->Run(inputs, outputNames, {}, outputs);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    ++fNCalls;
+    fTotalTime += elapsed.count();
+
+    return status;
+}
+
+unsigned long tf::SharedSession::NCalls() const
+{
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    return fNCalls;
+}
+
+double tf::SharedSession::TotalTime() const
+{
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    return fTotalTime;
+}
+
+// -------------------------------------------------------------------
+tf::SessionRegistry & tf::SessionRegistry::Instance()
+{
+    static SessionRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<tf::SharedSession> tf::SessionRegistry::GetGraph(const std::string & path, const ThreadConfig & threads,
+                                                                  const DeviceConfig & device)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    const std::string key = path + DeviceKey(device) + ThreadKey(threads);
+    std::shared_ptr<SharedSession> shared = fSessions[key].lock();
+    if (shared) { return shared; }
+
+    // The pool threads made with the session inherit the affinity of this thread
+    const dune::numa::ScopedPin pin(threads.numaNode);
+
+    // The session reads the weights of a memmapped package through its env;
+    // graph optimisations are off so they are not folded into private copies
+    std::unique_ptr<tensorflow::Env> memmapped = OpenMemmapped(path);
+    auto makeOptions = [&](const DeviceConfig & placement)
+    {
+        tensorflow::SessionOptions options;
+        ApplyThreadConfig(threads, options);
+        ApplyDeviceConfig(placement, options);
+        if (memmapped)
+        {
+            options.env = memmapped.get();
+            options.config.mutable_graph_options()->mutable_optimizer_options()->set_opt_level(tensorflow::OptimizerOptions::L0);
+        }
+        return options;
+    };
+
+    tensorflow::Session* session = nullptr;
+    auto status = tensorflow::NewSession(makeOptions(device), &session);
+    if (!status.ok() && device.placement == DeviceConfig::kGPU)
+    {
+        mf::LogWarning("SessionRegistry") << "No GPU session for " << path << ", " << status.ToString()
+                                          << ", using the CPU";
+        delete session;
+        session = nullptr;
+        status = tensorflow::NewSession(makeOptions(DeviceConfig{DeviceConfig::kCPU}), &session);
+    }
+    if (!status.ok())
+    {
+        std::cout << status.ToString() << std::endl;
+        delete session;
+        return nullptr;
+    }
+    std::unique_ptr<tensorflow::Session> owned(session);
+
+    tensorflow::GraphDef graph_def;
+    if (memmapped)
+    {
+        status = tensorflow::ReadBinaryProto(memmapped.get(),
+            tensorflow::MemmappedFileSystem::kMemmappedPackageDefaultGraphDef, &graph_def);
+    }
+    else
+    {
+        status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), path, &graph_def);
+    }
+    if (!status.ok())
+    {
+        std::cout << status.ToString() << std::endl;
+        return nullptr;
+    }
+
+    // Keep only the node names, the graph itself lives in the session
+    std::vector<std::string> nodeNames;
+    nodeNames.reserve(graph_def.node().size());
+    for (auto const & node : graph_def.node()) { nodeNames.push_back(node.name()); }
+
+    status = owned->Create(graph_def);
+    if (!status.ok())
+    {
+        std::cout << status.ToString() << std::endl;
+        return nullptr;
+    }
+    if (device.placement == DeviceConfig::kGPU) { ReportPlacement(path, *owned); }
+
+    if (memmapped) { mf::LogInfo("SessionRegistry") << path << " weights are memory mapped"; }
+
+    shared = std::make_shared<SharedSession>(path, owned.release(), std::move(nodeNames),
+                                             std::vector<std::string>(), std::vector<std::string>(), std::move(memmapped));
+    fSessions[key] = shared;
+    return shared;
+}
+
+std::shared_ptr<tf::SharedSession> tf::SessionRegistry::GetSavedModel(const std::string & path, const ThreadConfig & threads,
+                                                                       const DeviceConfig & device)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    const std::string key = path + DeviceKey(device) + ThreadKey(threads);
+    std::shared_ptr<SharedSession> shared = fSessions[key].lock();
+    if (shared) { return shared; }
+
+    // The pool threads made with the session inherit the affinity of this thread
+    const dune::numa::ScopedPin pin(threads.numaNode);
+
+    tensorflow::SavedModelBundle bundle;
+    tensorflow::SessionOptions session_options;
+    ApplyThreadConfig(threads, session_options);
+    ApplyDeviceConfig(device, session_options);
+    tensorflow::RunOptions run_options;
+    auto status = tensorflow::LoadSavedModel(session_options, run_options, path, {tensorflow::kSavedModelTagServe}, &bundle);
+    if (!status.ok() && device.placement == DeviceConfig::kGPU)
+    {
+        mf::LogWarning("SessionRegistry") << "No GPU session for " << path << ", " << status.ToString()
+                                          << ", using the CPU";
+        session_options = tensorflow::SessionOptions();
+        ApplyThreadConfig(threads, session_options);
+        ApplyDeviceConfig(DeviceConfig{DeviceConfig::kCPU}, session_options);
+        status = tensorflow::LoadSavedModel(session_options, run_options, path, {tensorflow::kSavedModelTagServe}, &bundle);
+    }
+    if (!status.ok())
+    {
+        std::cout << "Failed to load saved model: " << status.ToString() << std::endl;
+        return nullptr;
+    }
+
+    auto sig_map = bundle.GetSignatures();
+    if (!sig_map.contains("serving_default"))
+    {
+        std::cout << "Could not find serving_default in model signatures." << std::endl;
+        return nullptr;
+    }
+
+    auto model_def = sig_map.at("serving_default");
+    std::vector<std::string> inputNames, outputNames;
+    for (auto const &p : model_def.inputs()) { inputNames.push_back(p.second.name()); }
+    for (auto const &p : model_def.outputs()) { outputNames.push_back(p.second.name()); }
+
+    if (device.placement == DeviceConfig::kGPU) { ReportPlacement(path, *bundle.session); }
+
+    shared = std::make_shared<SharedSession>(path, bundle.session.release(), std::vector<std::string>(),
+                                             std::move(inputNames), std::move(outputNames));
+    fSessions[key] = shared;
+    return shared;
+}
+
+std::unique_ptr<tensorflow::Env> tf::SessionRegistry::OpenMemmapped(const std::string & path)
+{
+    // A plain GraphDef has no package directory at its end and is rejected here
+    std::unique_ptr<tensorflow::MemmappedEnv> env(new tensorflow::MemmappedEnv(tensorflow::Env::Default()));
+    if (!env->InitializeFromFile(path).ok()) { return nullptr; }
+    if (!env->FileExists(tensorflow::MemmappedFileSystem::kMemmappedPackageDefaultGraphDef).ok()) { return nullptr; }
+    return std::unique_ptr<tensorflow::Env>(env.release());
+}
+
+void tf::SessionRegistry::ReportPlacement(const std::string & path, tensorflow::Session & session)
+{
+    if (HasGPU(session)) { mf::LogInfo("SessionRegistry") << path << " runs on the GPU"; }
+    else { mf::LogWarning("SessionRegistry") << "No GPU available, " << path << " runs on the CPU"; }
+}
+// -------------------------------------------------------------------
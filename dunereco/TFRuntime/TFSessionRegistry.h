@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SharedSession, SessionRegistry
+////
+//// Job-wide registry of Tensorflow sessions shared by the dunereco network
+//// wrappers. A model file (frozen GraphDef or SavedModel folder) is loaded
+//// once per job; every wrapper asking for the same path gets the same session.
+//// All session calls go through SharedSession::Run, which keeps the timing
+//// statistics printed when the session is released.
+////
+//// A GraphDef converted with Tensorflow's convert_graphdef_memmapped_format
+//// is recognised and run from the mapped file: its weights are read-only
+//// pages of the page cache, shared by all the art processes of a node
+//// instead of being copied into each of them.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_SESSION_REGISTRY_H
+#define TF_SESSION_REGISTRY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/platform/status.h"
+
+#include "dunereco/TFRuntime/TFDeviceConfig.h"
+#include "dunereco/TFRuntime/TFThreadConfig.h"
+
+namespace tensorflow
+{
+    class Env;
+    class Session;
+    class Tensor;
+}
+
+namespace tf
+{
+
+class SharedSession
+{
+public:
+    SharedSession(const std::string & path, tensorflow::Session* session,
+                  std::vector<std::string> nodeNames,
+                  std::vector<std::string> inputNames = {}, std::vector<std::string> outputNames = {},
+                  std::unique_ptr<tensorflow::Env> env = nullptr);
+    ~SharedSession();
+
+    SharedSession(const SharedSession&) = delete;
+    SharedSession& operator=(const SharedSession&) = delete;
+
+    /// Run the session and record the call in the timing statistics
+    tensorflow::Status Run(const std::vector< std::pair<std::string, tensorflow::Tensor> > & inputs,
+                           const std::vector<std::string> & outputNames,
+                           std::vector<tensorflow::Tensor> * outputs);
+
+    const std::string & Path() const { return fPath; }
+
+    /// Whether the weights are read from a memory mapped package
+    bool Memmapped() const { return fEnv != nullptr; }
+
+    /// Node names of a GraphDef model, in file order
+    const std::vector<std::string> & NodeNames() const { return fNodeNames; }
+
+    /// Input and output tensor names of the serving_default signature of a SavedModel
+    const std::vector<std::string> & SignatureInputs() const { return fSignatureInputs; }
+    const std::vector<std::string> & SignatureOutputs() const { return fSignatureOutputs; }
+
+    unsigned long NCalls() const;
+    double TotalTime() const; ///< seconds spent inside Session::Run
+
+private:
+    std::string fPath;
+    std::unique_ptr<tensorflow::Env> fEnv; ///< Memmapped file system of the session, outlives it
+    std::unique_ptr<tensorflow::Session> fSession;
+    std::vector<std::string> fNodeNames;
+    std::vector<std::string> fSignatureInputs;
+    std::vector<std::string> fSignatureOutputs;
+
+    mutable std::mutex fStatsMutex;
+    unsigned long fNCalls = 0;
+    double fTotalTime = 0.;
+};
+
+class SessionRegistry
+{
+public:
+    static SessionRegistry & Instance();
+
+    /// Session for a frozen GraphDef (.pb) file, loaded on first request for
+    /// each device placement. The threading of the first request is used.
+    /// A GPU session that can't be made falls back to the CPU. Returns nullptr on failure.
+    std::shared_ptr<SharedSession> GetGraph(const std::string & path, const ThreadConfig & threads = ThreadConfig(),
+                                            const DeviceConfig & device = DeviceConfig());
+
+    /// Session for a SavedModel folder (serve tag), loaded on first request.
+    std::shared_ptr<SharedSession> GetSavedModel(const std::string & path, const ThreadConfig & threads = ThreadConfig(),
+                                                 const DeviceConfig & device = DeviceConfig());
+
+private:
+    SessionRegistry() = default;
+
+    /// Memmapped environment of a package made by convert_graphdef_memmapped_format,
+    /// nullptr if the file is a plain GraphDef
+    static std::unique_ptr<tensorflow::Env> OpenMemmapped(const std::string & path);
+
+    /// Report where a session asked to use a GPU ended up
+    static void ReportPlacement(const std::string & path, tensorflow::Session & session);
+
+    std::mutex fMutex;
+    std::map< std::string, std::weak_ptr<SharedSession> > fSessions;
+};
+
+} // namespace tf
+
+#endif
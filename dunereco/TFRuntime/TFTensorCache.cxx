@@ -0,0 +1,21 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       TensorCache
+////
+//// Reusable input tensors for the dunereco Tensorflow wrappers.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TFRuntime/TFTensorCache.h"
+
+tensorflow::Tensor & tf::TensorCache::Get(size_t slot, const tensorflow::TensorShape & shape)
+{
+    if (slot >= fTensors.size()) { fTensors.resize(slot + 1); }
+
+    tensorflow::Tensor & tensor = fTensors[slot];
+    // Only reuse the buffer if nothing (e.g. an output aliasing the input) still holds it
+    if (!tensor.IsInitialized() || tensor.shape() != shape || !tensor.RefCountIsOne())
+    {
+        tensor = tensorflow::Tensor(tensorflow::DT_FLOAT, shape);
+    }
+    return tensor;
+}
@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       TensorCache
+////
+//// Reusable input tensors for the dunereco Tensorflow wrappers: a tensor is
+//// only reallocated when the requested shape changes or its buffer is still
+//// referenced elsewhere, instead of on every call.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_TENSOR_CACHE_H
+#define TF_TENSOR_CACHE_H
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+
+namespace tf
+{
+
+class TensorCache
+{
+public:
+    /// Float tensor used for input number `slot`, with the requested shape.
+    /// The content is left as it was at the previous call.
+    tensorflow::Tensor & Get(size_t slot, const tensorflow::TensorShape & shape);
+
+private:
+    std::vector<tensorflow::Tensor> fTensors;
+};
+
+} // namespace tf
+
+#endif
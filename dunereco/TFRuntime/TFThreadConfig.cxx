@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      ThreadConfig
+////
+//// Threading configuration shared by the dunereco Tensorflow wrappers
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TFRuntime/TFThreadConfig.h"
+
+#include "tensorflow/core/public/session_options.h"
+
+std::string tf::ThreadKey(const ThreadConfig & threads)
+{
+    return threads.numaNode < 0 ? "" : "@numa" + std::to_string(threads.numaNode);
+}
+
+void tf::ApplyThreadConfig(const ThreadConfig & threads, tensorflow::SessionOptions & options)
+{
+    tensorflow::ConfigProto &config = options.config;
+    config.set_intra_op_parallelism_threads(threads.intraOpThreads);
+    if (threads.useGlobalPool)
+    {
+        // The first session creates the pool, later ones with the same name reuse it
+        auto pool = config.add_session_inter_op_thread_pool();
+        pool->set_num_threads(threads.interOpThreads);
+        pool->set_global_name(kGlobalThreadPoolName + ThreadKey(threads));
+    }
+    else
+    {
+        config.set_inter_op_parallelism_threads(threads.interOpThreads);
+    }
+    config.set_use_per_session_threads(false);
+}
@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      ThreadConfig
+////
+//// Threading configuration shared by the dunereco Tensorflow wrappers
+//// (tf::Graph, Bundle, tf::CTPGraph, tf::RegCNNGraph, TFModel). The defaults
+//// keep one core per session so production jobs don't eat batch farms.
+//// A session given a NUMA node is made while its thread is pinned to that
+//// node, so the threads of its pools inherit the node's CPUs, and sessions
+//// of the same model on different nodes are kept apart.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TF_THREAD_CONFIG_H
+#define TF_THREAD_CONFIG_H
+
+#include <string>
+
+namespace tensorflow
+{
+    struct SessionOptions;
+}
+
+namespace tf
+{
+
+struct ThreadConfig
+{
+    int interOpThreads = 1;     ///< threads running independent ops in parallel (0 = let TF decide)
+    int intraOpThreads = 1;     ///< threads used inside a single op (0 = let TF decide)
+    bool useGlobalPool = false; ///< share one named inter-op pool between all sessions of the process
+    int numaNode = -1;          ///< NUMA node of the pool threads, the global pool is shared per node (-1 = no placement)
+};
+
+/// Name of the inter-op pool shared by all sessions when useGlobalPool is set
+constexpr const char* kGlobalThreadPoolName = "dunereco_tf_global_pool";
+
+/// Part of the session registry key that tells the NUMA placements apart
+std::string ThreadKey(const ThreadConfig & threads);
+
+/// Fill the threading part of the session options
+void ApplyThreadConfig(const ThreadConfig & threads, tensorflow::SessionOptions & options);
+
+} // namespace tf
+
+#endif
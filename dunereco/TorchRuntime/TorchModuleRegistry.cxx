@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SharedModule, ModuleRegistry
+////
+//// Job-wide registry of TorchScript modules shared by the dunereco libtorch wrappers.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TorchRuntime/TorchModuleRegistry.h"
+
+#include <chrono>
+#include <sstream>
+
+#include <torch/torch.h>
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// -------------------------------------------------------------------
+torchrt::SharedModule::SharedModule(const std::string & path, const ModuleOptions & options,
+                                    torch::jit::script::Module module) :
+    fPath(path),
+    fOptions(options),
+    fDevice(options.device),
+    fModule(std::move(module))
+{
+}
+
+torchrt::SharedModule::~SharedModule()
+{
+    if (fNCalls > 0)
+    {
+        mf::LogInfo("SharedModule") << fPath << ": " << fNCalls << " calls, "
+                                    << fTotalTime << " s, " << 1000. * fTotalTime / fNCalls << " ms/call";
+    }
+}
+
+torch::jit::IValue torchrt::SharedModule::Forward(std::vector<torch::jit::IValue> inputs)
+{
+    auto start = std::chrono::steady_clock::now();
+    torch::jit::IValue output = fModule.forward(std::move(inputs));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    ++fNCalls;
+    fTotalTime += elapsed.count();
+
+    return output;
+}
+
+void torchrt::SharedModule::WarmUp(const at::Tensor & input, unsigned int nPasses)
+{
+    std::lock_guard<std::mutex> lock(fWarmUpMutex);
+    if (fWarmedUp || nPasses == 0) { return; }
+
+    // Grad mode is thread local, so the guard is needed here as in the callers
+    torch::NoGradGuard noGrad;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int pass = 0; pass < nPasses; ++pass)
+    {
+        fModule.forward({input.to(fDevice, fOptions.dtype)});
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fWarmedUp = true;
+
+    mf::LogInfo("SharedModule") << fPath << ": " << nPasses << " warm-up passes on "
+                                << input.sizes() << ", " << elapsed.count() << " s";
+}
+
+unsigned long torchrt::SharedModule::NCalls() const
+{
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    return fNCalls;
+}
+
+double torchrt::SharedModule::TotalTime() const
+{
+    std::lock_guard<std::mutex> lock(fStatsMutex);
+    return fTotalTime;
+}
+
+// -------------------------------------------------------------------
+torchrt::ModuleRegistry & torchrt::ModuleRegistry::Instance()
+{
+    static ModuleRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<torchrt::SharedModule> torchrt::ModuleRegistry::Get(const std::string & path, const ModuleOptions & options,
+                                                                    const ThreadConfig & threads)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    ApplyThreadConfig(threads);
+
+    std::ostringstream key;
+    key << path << "|" << options.device << "|" << options.dtype << "|" << options.optimizeForInference;
+    std::shared_ptr<SharedModule> shared = fModules[key.str()].lock();
+    if (shared) { return shared; }
+
+    torch::jit::script::Module module;
+    try
+    {
+        module = torch::jit::load(path, torch::Device(options.device));
+        module.eval();
+        if (options.dtype != c10::kFloat) { module.to(options.dtype); }
+        if (options.optimizeForInference) { module = torch::jit::optimize_for_inference(module); }
+    }
+    catch (const c10::Error & e)
+    {
+        mf::LogError("ModuleRegistry") << "Failed to load " << path << ", " << e.what_without_backtrace();
+        return nullptr;
+    }
+
+    shared = std::make_shared<SharedModule>(path, options, std::move(module));
+    fModules[key.str()] = shared;
+    return shared;
+}
+// -------------------------------------------------------------------
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SharedModule, ModuleRegistry
+////
+//// Job-wide registry of TorchScript modules shared by the dunereco libtorch
+//// wrappers. A model file is loaded once per job for each device, precision
+//// and optimisation; every wrapper asking for the same gets the same module,
+//// which is warmed up at most once. All forward calls go through
+//// SharedModule::Forward, which keeps the timing statistics printed when the
+//// module is released.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TORCH_MODULE_REGISTRY_H
+#define TORCH_MODULE_REGISTRY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <torch/script.h>
+
+#include "dunereco/TorchRuntime/TorchThreadConfig.h"
+
+namespace torchrt
+{
+
+struct ModuleOptions
+{
+    std::string device = "cpu";             ///< "cpu", "cuda" or "cuda:<n>"
+    c10::ScalarType dtype = c10::kFloat;    ///< precision the weights are converted to
+    bool optimizeForInference = false;      ///< freeze and fuse the module with torch::jit::optimize_for_inference
+};
+
+class SharedModule
+{
+public:
+    SharedModule(const std::string & path, const ModuleOptions & options, torch::jit::script::Module module);
+    ~SharedModule();
+
+    SharedModule(const SharedModule&) = delete;
+    SharedModule& operator=(const SharedModule&) = delete;
+
+    /// Run the module and record the call in the timing statistics. Can be
+    /// called from several threads at once
+    torch::jit::IValue Forward(std::vector<torch::jit::IValue> inputs);
+
+    /// Run nPasses forward calls on the input, so the JIT profiling and
+    /// optimisation of the graph are not paid on the first events. Only the
+    /// first call does anything, the passes are not in the statistics
+    void WarmUp(const at::Tensor & input, unsigned int nPasses);
+
+    const std::string & Path() const { return fPath; }
+    const ModuleOptions & Options() const { return fOptions; }
+    const torch::Device & Device() const { return fDevice; }
+
+    unsigned long NCalls() const;
+    double TotalTime() const; ///< seconds spent inside forward
+
+private:
+    std::string fPath;
+    ModuleOptions fOptions;
+    torch::Device fDevice;
+    torch::jit::script::Module fModule;
+
+    std::mutex fWarmUpMutex;
+    bool fWarmedUp = false;
+
+    mutable std::mutex fStatsMutex;
+    unsigned long fNCalls = 0;
+    double fTotalTime = 0.;
+};
+
+class ModuleRegistry
+{
+public:
+    static ModuleRegistry & Instance();
+
+    /// Module of a TorchScript file with the options, loaded on first request.
+    /// The thread pools are configured with the threading of the first
+    /// request of the job. Returns nullptr on failure.
+    std::shared_ptr<SharedModule> Get(const std::string & path, const ModuleOptions & options = ModuleOptions(),
+                                      const ThreadConfig & threads = ThreadConfig());
+
+private:
+    ModuleRegistry() = default;
+
+    std::mutex fMutex;
+    std::map< std::string, std::weak_ptr<SharedModule> > fModules;
+};
+
+} // namespace torchrt
+
+#endif
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      ThreadConfig
+////
+//// Threading configuration shared by the dunereco libtorch wrappers
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TorchRuntime/TorchThreadConfig.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
+
+#include <mutex>
+
+#include <ATen/Parallel.h>
+#include <c10/util/Exception.h>
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+namespace
+{
+    std::mutex gThreadMutex;
+    bool gConfigured = false;
+    torchrt::ThreadConfig gThreads;
+}
+
+bool torchrt::ApplyThreadConfig(const ThreadConfig & threads)
+{
+    std::lock_guard<std::mutex> lock(gThreadMutex);
+
+    if (gConfigured)
+    {
+        if (threads.intraOpThreads == gThreads.intraOpThreads && threads.interOpThreads == gThreads.interOpThreads &&
+            threads.numaNode == gThreads.numaNode) { return true; }
+        mf::LogWarning("ApplyThreadConfig") << "The libtorch pools already have " << gThreads.intraOpThreads
+                                            << " intra-op and " << gThreads.interOpThreads << " inter-op threads on NUMA node "
+                                            << gThreads.numaNode << ", ignoring " << threads.intraOpThreads << " and "
+                                            << threads.interOpThreads << " on node " << threads.numaNode;
+        return false;
+    }
+
+    if (threads.intraOpThreads > 0) { at::set_num_threads(threads.intraOpThreads); }
+    if (threads.interOpThreads > 0)
+    {
+        // Can only be set before the inter-op pool has run anything
+        try { at::set_num_interop_threads(threads.interOpThreads); }
+        catch (const c10::Error & e)
+        {
+            mf::LogWarning("ApplyThreadConfig") << "Could not set the inter-op threads, " << e.what_without_backtrace();
+        }
+    }
+
+    if (threads.numaNode >= 0)
+    {
+        // The pools start their threads lazily, start them now from a pinned thread so they inherit its node
+        const dune::numa::ScopedPin pin(threads.numaNode);
+        at::parallel_for(0, 1 << 16, 1, [](int64_t, int64_t) {});
+        at::launch([]() {});
+    }
+
+    gConfigured = true;
+    gThreads = threads;
+    return true;
+}
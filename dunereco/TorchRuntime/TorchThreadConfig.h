@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Struct:      ThreadConfig
+////
+//// Threading configuration shared by the dunereco libtorch wrappers
+//// (RegCNNTorchHandler, InfillChannels). libtorch has a single intra-op and
+//// a single inter-op pool per process, so the first module to configure them
+//// sets the threading of the whole job and every network runs in the same
+//// pools. The defaults keep one core, as for the Tensorflow sessions.
+//// With a NUMA node the pools are started while the configuring thread is
+//// pinned to that node, so all their threads run on its CPUs.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TORCH_THREAD_CONFIG_H
+#define TORCH_THREAD_CONFIG_H
+
+namespace torchrt
+{
+
+struct ThreadConfig
+{
+    int intraOpThreads = 1;     ///< threads used inside a single op (0 = let libtorch decide)
+    int interOpThreads = 1;     ///< threads running independent ops in parallel (0 = let libtorch decide)
+    int numaNode = -1;          ///< NUMA node of the pool threads (-1 = no placement)
+};
+
+/// Size the process wide pools on the first call. Later calls asking for a
+/// different configuration are reported and ignored, returns false for them.
+bool ApplyThreadConfig(const ThreadConfig & threads);
+
+} // namespace torchrt
+
+#endif
@@ -15,6 +15,7 @@
 //
 
 #include <map>
+#include <unordered_map>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -393,8 +394,6 @@ namespace trkf {
 
   private:
 
-    template <typename T> std::vector<size_t> fsort_indexes(const std::vector<T> &v) ;
-
     // Fcl Attributes.
 
     std::string fTrackModuleLabel;
@@ -1266,7 +1265,6 @@ namespace trkf {
     art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
     art::ServiceHandle<geo::Geometry> geom;
 
-    std::map<int, std::map<int, art::PtrVector<recob::Hit>> > hitmap; // trkID, otrk, hitvec
     std::map<int, int > KEmap; // length traveled in det [cm]?, trkID want to sort by KE
     bool mc = !evt.isRealData();
 
@@ -1293,9 +1291,9 @@ namespace trkf {
     const RecoHists& rhistsStitched = fRecoHistMap[0];
     
     std::vector < std::vector <unsigned int> >  NtrkIdsAll; 
-    std::vector < double > ntvsorted;
-    hitmap.clear();
-    KEmap.clear();
+    // Collection hits of each trkID in each o trk, counted as they are seen
+    // so the histograms below only visit the trkIDs an o trk actually has
+    std::vector < std::unordered_map<int, size_t> > hitCounts(ntv);
     
 
     for (int o = 0; o < ntv; ++o) // o for outer
@@ -1348,7 +1346,8 @@ namespace trkf {
 		    //	  std::cout  << "\t\t  TrkAna: TrkId  tids.size() ******* " << tids.size()  <<std::endl;
 		    for(std::vector<sim::TrackIDE>::const_iterator itid = tids.begin();itid != tids.end(); ++itid) {
 		      int trackID = std::abs(itid->trackID);
-		      hitmap[trackID][o].push_back(hit);
+		      bool newTrkId = hitCounts[o].count(trackID) == 0;
+		      ++hitCounts[o][trackID];
 
 		      if (justOne) { vecNtrkIds.push_back(trackID); justOne=false; }
 		      // Add hit to PtrVector corresponding to this track id.
@@ -1356,6 +1355,8 @@ namespace trkf {
 		      const simb::MCParticle* part = pi_serv->TrackIdToParticle_P(trackID);
 		      rhistsStitched.fHHitPdg->Fill(part->PdgCode()); 
 		      // This really needs to be indexed as KE deposited in volTPC, not just KE. EC, 24-July-2014.
+		      // The length of a trkID is the same for all its hits, get it once per o trk.
+		      if (!newTrkId) continue;
 
 		      TVector3 mcstart;
 		      TVector3 mcend;
@@ -1366,7 +1367,7 @@ namespace trkf {
 
                       double plen = length(detProp, *part, mcdx, mcstart, mcend, mcstartmom, mcendmom);
 
-		      KEmap[(int)(1e6*plen)] = trackID; // multiple assignment but always the same, so fine.
+		      KEmap[(int)(1e6*plen)] = trackID;
 		      //		      std::cout  << "\t\t  TrkAna: TrkId  trackID, KE [MeV] ******* " << trackID << ", " << (int)(1e3*(part->E()-part->Mass()))  <<std::endl;
 		    }
 
@@ -1423,61 +1424,43 @@ namespace trkf {
 	    NtrkIdsAll.push_back(vecMode); 
 
 	    std::unique(NtrkIdsAll.back().begin(),NtrkIdsAll.back().end());
-	    double sum(0.0);
-	    for (auto const val :  NtrkIdsAll.back())
-	      {
-		//		rhistsStitched.fNTrkIdTrks3->Fill(o,val%100,hitmap[val][o].size());
-		sum += hitmap[val][o].size();
-	      }
-	    ntvsorted.push_back(sum);
-
 	  }
 
 	//	
       } // o
 
-    int vtmp(0);
-	// get KEmap indices by most energetic first, least last.
-	for (auto it = KEmap.rbegin(); it!=KEmap.rend(); ++it) 
-	  {
-	    //	    int tval = it->second; // grab trkIDs in order, since they're sorted by KE
-	    //	    int ke = it->first; // grab trkIDs in order, since they're sorted by KE
-	    //	    const simb::MCParticle* part = pi_serv->TrackIDToParticle(tval);
-	    
-	    //	    std::cout << "TrackAnaCTStitch: KEmap cntr vtmp, Length ke, tval, pdg : "  << vtmp << ", " << ke <<", " << tval <<", " << part->PdgCode() << ", " << std::endl;
+    // Rank of each trkID by trajectory length, longest first.
+    std::unordered_map<int, int> lengthRank;
+    int v(0);
+    for (auto it = KEmap.rbegin(); it!=KEmap.rend(); ++it) lengthRank[it->second] = v++;
 
-	    vtmp++;
-	  }
-
-    // get o trk indices by their hits. Most populous track first, least last.
-    for (auto const o : fsort_indexes(ntvsorted))
+    // Fill each o trk's row with the hits of the trkIDs it has. The other
+    // trkIDs would only add zero weights, and the rows do not depend on the
+    // order the o trks are visited in.
+    for (int o = 0; o < ntv; ++o)
       {
-	int v(0);
-	// get KEmap indices by longest trajectory first, least last.
-	for (auto it = KEmap.rbegin(); it!=KEmap.rend(); ++it) 
+	for (auto const& [trackID, nhits] : hitCounts[o])
 	  {
-	    int val = it->second; // grab trkIDs in order, since they're sorted by KE
-	    //	    const simb::MCParticle* part = pi_serv->TrackIDToParticle(val);
-	    //	    std::cout << "TrackAnaCTStitch: trk o, KEmap cntr v, KE val, pdg  hitmap[val][o].size(): "  << o <<", " << v << ", " << val <<", " << part->PdgCode() << ", " << hitmap[val][o].size() << std::endl;
-	    rhistsStitched.fNTrkIdTrks3->Fill(o,v,hitmap[val][o].size());
-	    v++;
+	    auto const rank = lengthRank.find(trackID);
+	    if (rank != lengthRank.end())
+	      rhistsStitched.fNTrkIdTrks3->Fill(o, rank->second, nhits);
 	  }
-	
       }
 
     // In how many o tracks did each trkId appear? Histo it. Would like it to be precisely 1.
     // Histo it vs. particle KE.
     flattener flat(NtrkIdsAll);
-    std::vector <unsigned int> &v = flat;
-    //auto const it ( std::unique(v.begin(),v.end()) ); // never use this it, perhaps.
-    for (auto const val :  v)
+    std::vector <unsigned int> &modes = flat;
+    std::unordered_map<unsigned int, int> nOTrks;
+    for (auto const val :  modes) ++nOTrks[val];
+    for (auto const val :  modes)
       {
 	if (val != (unsigned int)sim::NoParticleId)
 	  {
 	    const simb::MCParticle* part = pi_serv->TrackIdToParticle_P( val ); 
 	    double T(part->E() - 0.001*part->Mass());
-	    rhistsStitched.fNTrkIdTrks->Fill(std::count(v.begin(),v.end(),val));
-	    rhistsStitched.fNTrkIdTrks2->Fill(std::count(v.begin(),v.end(),val),T);
+	    rhistsStitched.fNTrkIdTrks->Fill(nOTrks[val]);
+	    rhistsStitched.fNTrkIdTrks2->Fill(nOTrks[val],T);
 	  }
 	else
 	  {
@@ -1518,17 +1501,5 @@ namespace trkf {
     }
   }
 
-    // Stole this from online. Returns indices sorted by corresponding vector values.
-    template <typename T>
-      std::vector<size_t> TrackAnaCT::fsort_indexes(const std::vector<T> &v) {
-  // initialize original index locations
-      std::vector<size_t> idx(v.size());
-      for (size_t i = 0; i != idx.size(); ++i) idx[i] = i;
-            // sort indexes based on comparing values in v
-      std::sort(idx.begin(), idx.end(),
-		[&v](size_t i1, size_t i2) {return v[i1] > v[i2];}); // Want most occupied trks first. was <, EC, 21-July.
-      return idx;
-    }
-
 
 }
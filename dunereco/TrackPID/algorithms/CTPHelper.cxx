@@ -4,9 +4,13 @@
 /// \author  Leigh Whitehead - leigh.howard.whitehead@cern.ch
 ////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <vector>
 #include <string>
 #include <random>
+#include <utility>
 
 #include "TVector3.h"
 
@@ -16,6 +20,7 @@
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/Track.h"
 #include "lardataobj/RecoBase/PFParticle.h"
+#include "lardataobj/RecoBase/Shower.h"
 #include "lardataobj/AnalysisBase/Calorimetry.h"
 
 #include "dunereco/TrackPID/algorithms/CTPHelper.h"
@@ -28,10 +33,14 @@
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
 
+#include "dunereco/AnaUtils/DUNEAnaAssocCache.h"
+#include "dunereco/AnaUtils/DUNEAnaHitTruthCache.h"
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
+#include "dunereco/NUMA/NUMAPlacement.h"
 
 #include "cetlib/getenv.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 namespace ctp
 {
@@ -49,6 +58,26 @@ namespace ctp
     fQMax = pset.get<float>("MaxCharge",1000);
     fQJump = pset.get<float>("MaxChargeJump",500);
     fNormalise = pset.get<bool>("NormaliseInputs",true);
+    fInterOpThreads = pset.get<int>("InterOpThreads",1);
+    fIntraOpThreads = pset.get<int>("IntraOpThreads",1);
+    fUseGlobalThreadPool = pset.get<bool>("UseGlobalThreadPool",false);
+    fNUMANode = dune::numa::ResolveNode(dune::numa::PlacementFromPSet(pset));
+    fBatchSize = pset.get<unsigned int>("BatchSize",0);
+
+    const std::string cacheFile = pset.get<std::string>("OutputCache","");
+    if(!cacheFile.empty()){
+      fOutputCache = tf::OutputCache::Open(cacheFile, cet::getenv(fNetDir) + "/" + fNetName, "CTPHelper");
+    }
+
+    // Optional tuning of the batch size, capped by BatchSize
+    if(pset.has_key("BatchTuning")){
+      const fhicl::ParameterSet tuning = pset.get<fhicl::ParameterSet>("BatchTuning");
+      fBatchTuner = std::make_unique<tf::BatchTuner>("CTPHelper " + fNetName,
+                                                     tuning.get<std::vector<size_t>>("Candidates",{}),
+                                                     fBatchSize,
+                                                     tuning.get<unsigned int>("TuneCalls",20),
+                                                     tuning.get<double>("MaxLatency",0.));
+    }
   }
 
   CTPHelper::~CTPHelper(){
@@ -58,24 +87,123 @@ namespace ctp
   const ctp::CTPResult CTPHelper::RunConvolutionalTrackPID(const art::Ptr<recob::PFParticle> part, const art::Event &evt) const{
 
     // Get the inputs to the network
-    std::vector< std::vector< std::vector<float> > > finalInputs;
-
     std::vector< std::vector<float> > twoVecs = GetNetworkInputs(part,evt);
     if(twoVecs.empty()) return ctp::CTPResult();
 
-    finalInputs.push_back(twoVecs);
+    std::vector< std::vector< std::vector<float> > > finalInputs;
+    finalInputs.push_back(std::move(twoVecs));
+
+    return EvaluateNetworkInputs(finalInputs).at(0);
+  }
+
+  // Calculate the PID for all given tracks, evaluating the network once per batch
+  const std::vector<ctp::CTPResult> CTPHelper::RunConvolutionalTrackPID(const std::vector<art::Ptr<recob::PFParticle>> &particles, const art::Event &evt) const{
+
+    std::vector<ctp::CTPResult> results(particles.size());
+
+    // Only the particles with sensible inputs go to the network
+    std::vector< std::vector< std::vector<float> > > allInputs = GetNetworkInputs(particles,evt);
+    std::vector< std::vector< std::vector<float> > > finalInputs;
+    std::vector<unsigned int> inputIndices;
+    finalInputs.reserve(particles.size());
+    inputIndices.reserve(particles.size());
+    for(unsigned int p = 0; p < particles.size(); ++p){
+      if(allInputs.at(p).empty()) continue;
+      finalInputs.push_back(std::move(allInputs.at(p)));
+      inputIndices.push_back(p);
+    }
+
+    // Scatter the results back to their particles
+    const std::vector<ctp::CTPResult> netResults = EvaluateNetworkInputs(finalInputs);
+    for(unsigned int i = 0; i < inputIndices.size(); ++i){
+      results.at(inputIndices.at(i)) = netResults.at(i);
+    }
+
+    return results;
+  }
+
+  // Run the network over precomputed inputs
+  const std::vector<ctp::CTPResult> CTPHelper::EvaluateNetworkInputs(const std::vector<std::vector<std::vector<float>>> &inputs) const{
+
+    std::vector<ctp::CTPResult> results;
+    results.reserve(inputs.size());
+    if(inputs.empty()) return results;
+
+    std::vector<std::vector<std::vector<float>>> outputs;
+    if(fOutputCache){
+      // Only the tracks not seen before go through the network
+      std::vector<std::string> keys;
+      keys.reserve(inputs.size());
+      std::vector<std::pair<const void*,size_t>> buffers;
+      for(const std::vector<std::vector<float>> &input : inputs){
+        buffers.clear();
+        for(const std::vector<float> &v : input) buffers.emplace_back(v.data(), v.size() * sizeof(float));
+        keys.push_back(fOutputCache->Key(buffers));
+      }
+      outputs = fOutputCache->GetOrCompute(keys, [&](const std::vector<size_t> &missed){
+        std::vector<std::vector<std::vector<float>>> missedInputs;
+        missedInputs.reserve(missed.size());
+        for(const size_t i : missed) missedInputs.push_back(inputs.at(i));
+        return RunNetwork(missedInputs);
+      });
+    }
+    else{
+      outputs = RunNetwork(inputs);
+    }
+
+    for(const std::vector<std::vector<float>> &output : outputs){
+      if(output.empty()) results.emplace_back();
+      else results.emplace_back(output.at(0));
+    }
 
-//    std::cout << "We have sensible inputs... building TF object" << std::endl;
-    // Load the network and run it
-    const std::string fullPath = cet::getenv(fNetDir) + "/" + fNetName;
-    std::unique_ptr<tf::CTPGraph> convNet = tf::CTPGraph::create(fullPath.c_str(),std::vector<std::string>(),2,1);
-//    std::cout << "Calling TF interface" << std::endl;
-    std::vector< std::vector< std::vector<float> > > convNetOutput = convNet->run(finalInputs);
+    return results;
+  }
 
-//    std::cout << "Got result from TF" << std::endl;
-    ctp::CTPResult result(convNetOutput.at(0).at(0));
-//    std::cout << "Returning CTPResult" << std::endl;
-    return result;
+  std::vector<std::vector<std::vector<float>>> CTPHelper::RunNetwork(const std::vector<std::vector<std::vector<float>>> &inputs) const{
+
+    std::vector<std::vector<std::vector<float>>> outputs;
+    outputs.reserve(inputs.size());
+
+    std::lock_guard<std::mutex> lock(fNetMutex);
+    tf::CTPGraph &convNet = GetNetwork();
+
+    const unsigned int configured = fBatchTuner ? fBatchTuner->NextBatchSize() : fBatchSize;
+    const unsigned int batchSize = configured > 0 ? configured : inputs.size();
+    std::vector< std::vector< std::vector<float> > > batch;
+    for(unsigned int begin = 0; begin < inputs.size(); begin += batchSize){
+      const unsigned int end = std::min<unsigned int>(begin + batchSize, inputs.size());
+      // Only copy the inputs when they have to be split
+      const bool whole = (begin == 0 && end == inputs.size());
+      if(!whole) batch.assign(inputs.begin() + begin, inputs.begin() + end);
+      const std::vector< std::vector< std::vector<float> > > &batchInputs = whole ? inputs : batch;
+
+      const auto start = std::chrono::steady_clock::now();
+      std::vector< std::vector< std::vector<float> > > convNetOutput = convNet.run(batchInputs);
+      if(fBatchTuner){
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        fBatchTuner->Record(batchSize, batchInputs.size(), elapsed.count());
+      }
+      if(convNetOutput.size() != batchInputs.size()){
+        mf::LogWarning("CTPHelper") << "Network returned " << convNetOutput.size() << " results for " << batchInputs.size()
+                                    << " tracks, marking the batch as invalid";
+        outputs.resize(end);
+        continue;
+      }
+      for(std::vector< std::vector<float> > &output : convNetOutput){
+        outputs.push_back(std::move(output));
+      }
+    }
+
+    return outputs;
+  }
+
+  tf::CTPGraph& CTPHelper::GetNetwork() const{
+    std::call_once(fConvNetLoaded, [this]{
+      const std::string fullPath = cet::getenv(fNetDir) + "/" + fNetName;
+      const tf::ThreadConfig threads{fInterOpThreads, fIntraOpThreads, fUseGlobalThreadPool, fNUMANode};
+      fConvNet = tf::CTPGraph::create(fullPath.c_str(),std::vector<std::string>(),2,1,threads);
+    });
+    return *fConvNet;
   }
 
   // Calculate the features for the track PID
@@ -97,31 +225,89 @@ namespace ctp
       return std::vector<std::vector<float>>();
     }
 
-    std::vector<float> dedxVector = thisCalo->dEdx();
-    this->SmoothDedxVector(dedxVector);
-    float dedxMean = 0.;
-    float dedxSigma = 0.;
-
-    // We want to use the middle third of the dedx vector (with max length 100)
-    std::vector<float> dedxTrunc;
-    unsigned int pointsForAverage = (fDedxLength - fMinTrackPoints) / 3;
-    unsigned int avStart = dedxVector.size() - 1 - pointsForAverage;
-    unsigned int avEnd   = dedxVector.size() - 1 - (2*pointsForAverage);
-    for(unsigned int e = avStart; e > avEnd; --e) dedxTrunc.push_back(dedxVector.at(e));
-    this->GetDedxMeanAndSigma(dedxTrunc,dedxMean,dedxSigma);
-
-    // If our dedx vector is between fMinTrackPoints and fDedxLength in size then we need to pad it
-    if(dedxVector.size() < fDedxLength){
-      this->PadDedxVector(dedxVector,dedxMean,dedxSigma);
-    }
-    
-    std::vector<float> finalInputDedx;
-    finalInputDedx.insert(finalInputDedx.begin(),dedxVector.end() - fDedxLength,dedxVector.end());
-
-    std::vector<float> finalInputVariables;
     // Get the number of child particles
     float nTrack, nShower, nGrand;
     this->GetChildParticles(part,evt,nTrack,nShower,nGrand);
+
+    FeatureScratch scratch;
+    this->FillNetworkInputs(thisTrack,*thisCalo,nTrack,nShower,nGrand,scratch,netInputs);
+
+    return netInputs;
+  }
+
+  // Calculate the features for many particles of the same event in one sweep
+  const std::vector<std::vector<std::vector<float>>> CTPHelper::GetNetworkInputs(const std::vector<art::Ptr<recob::PFParticle>> &particles, const art::Event &evt) const{
+
+    std::vector<std::vector<std::vector<float>>> allInputs(particles.size());
+    if(particles.empty()) return allInputs;
+
+    auto particleHandle = evt.getHandle<std::vector<recob::PFParticle>>(fParticleLabel);
+    if(!particleHandle.isValid()){
+      mf::LogError("CTPHelper") << "Failed to find product with label " << fParticleLabel << " ... returning empty inputs" << std::endl;
+      return allInputs;
+    }
+    auto trackHandle = evt.getHandle<std::vector<recob::Track>>(fTrackLabel);
+    if(!trackHandle.isValid()){
+      mf::LogError("CTPHelper") << "Failed to find product with label " << fTrackLabel << " ... returning empty inputs" << std::endl;
+      return allInputs;
+    }
+
+    // These are the same associations the analysis utilities use, so they are only built once per event
+    const auto pParticleTracks = dune_ana::DUNEAnaAssocCache::Get<recob::Track>(evt,particleHandle,fParticleLabel,fTrackLabel);
+    const auto pParticleShowers = dune_ana::DUNEAnaAssocCache::Get<recob::Shower>(evt,particleHandle,fParticleLabel,fShowerLabel);
+    const auto pTrackCalos = dune_ana::DUNEAnaAssocCache::Get<anab::Calorimetry>(evt,trackHandle,fTrackLabel,fCalorimetryLabel);
+    const art::FindManyP<recob::Track> &particleTracks = *pParticleTracks;
+    const art::FindManyP<recob::Shower> &particleShowers = *pParticleShowers;
+    const art::FindManyP<anab::Calorimetry> &trackCalos = *pTrackCalos;
+
+    // Count the child tracks, showers and grandchildren of every particle with a single pass
+    const unsigned int nParticles = particleHandle->size();
+    std::vector<float> nChildTracks(nParticles,0.), nChildShowers(nParticles,0.), nGrandChildren(nParticles,0.);
+    for(unsigned int c = 0; c < nParticles; ++c){
+      const size_t parent = particleHandle->at(c).Parent();
+      if(parent >= nParticles) continue;
+      nChildTracks.at(parent) += !particleTracks.at(c).empty();
+      nChildShowers.at(parent) += !particleShowers.at(c).empty();
+      nGrandChildren.at(parent) += particleHandle->at(c).NumDaughters();
+    }
+
+    FeatureScratch scratch;
+    for(unsigned int p = 0; p < particles.size(); ++p){
+      const size_t key = particles.at(p).key();
+      const std::vector<art::Ptr<recob::Track>> &tracks = particleTracks.at(key);
+      if(tracks.empty()) continue;
+
+      // Prefer the collection view calorimetry, as DUNEAnaTrackUtils::GetCalorimetry does
+      const std::vector<art::Ptr<anab::Calorimetry>> &calos = trackCalos.at(tracks.front().key());
+      if(calos.empty()) continue;
+      art::Ptr<anab::Calorimetry> thisCalo = calos.front();
+      for(const art::Ptr<anab::Calorimetry> &calo : calos){
+        if(calo->PlaneID().Plane == geo::kW){ thisCalo = calo; break; }
+      }
+
+      if(thisCalo->dEdx().size() < fMinTrackPoints) continue;
+
+      this->FillNetworkInputs(tracks.front(),*thisCalo,nChildTracks.at(key),nChildShowers.at(key),nGrandChildren.at(key),scratch,allInputs.at(p));
+    }
+
+    return allInputs;
+  }
+
+  void CTPHelper::FillNetworkInputs(const art::Ptr<recob::Track> track, const anab::Calorimetry &calo, const float nTrack, const float nShower, const float nGrand,
+                                    FeatureScratch &scratch, std::vector<std::vector<float>> &netInputs) const{
+
+    // The dE/dx input is filled in place, already normalised if requested
+    netInputs.resize(2);
+    std::vector<float> &finalInputDedx = netInputs.at(0);
+    finalInputDedx.resize(fDedxLength);
+    float dedxMean = 0.;
+    float dedxSigma = 0.;
+    this->FillDedxInput(calo.dEdx(),finalInputDedx.data(),dedxMean,dedxSigma);
+
+    std::vector<float> &finalInputVariables = netInputs.at(1);
+    finalInputVariables.clear();
+    finalInputVariables.reserve(7);
+    // The number of child particles
     finalInputVariables.push_back(nTrack);
     finalInputVariables.push_back(nShower);
     finalInputVariables.push_back(nGrand);
@@ -130,16 +316,11 @@ namespace ctp
     finalInputVariables.push_back(dedxSigma);
     // Finally, get the angular deflection mean and sigma
     float deflectionMean, deflectionSigma;
-    this->GetDeflectionMeanAndSigma(thisTrack,deflectionMean,deflectionSigma);
+    this->GetDeflectionMeanAndSigma(track,deflectionMean,deflectionSigma,scratch.angles);
     finalInputVariables.push_back(deflectionMean);
     finalInputVariables.push_back(deflectionSigma);
   
-    netInputs.push_back(finalInputDedx);
-    netInputs.push_back(finalInputVariables);
-   
-    if(fNormalise) this->NormaliseInputs(netInputs);
-
-    return netInputs;
+    if(fNormalise) this->NormaliseVariables(finalInputVariables);
   }
 
   const std::vector<float> CTPHelper::GetDeDxVector(const art::Ptr<recob::PFParticle> part, const art::Event &evt) const{
@@ -160,12 +341,13 @@ namespace ctp
     std::vector<weightedMCPair> outVecHits;
 
     // Loop over all hits in the input vector and record the contributing MCParticles.
-    art::ServiceHandle<cheat::BackTrackerService> bt_serv;
+    dune_ana::DUNEAnaHitTruthCache truth(clockData);
+    truth.Fill(collectionHits);
     art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
     std::unordered_map<const simb::MCParticle*, float> mcHitMap;
     float hitTotal = 0;
     for(const art::Ptr<recob::Hit> &hit : collectionHits) {
-      for(const sim::TrackIDE& ide : bt_serv->HitToTrackIDEs(clockData, hit)) {
+      for(const sim::TrackIDE& ide : truth.GetTrackIDEs(hit)) {
         const simb::MCParticle* curr_part = pi_serv->TrackIdToParticle_P(ide.trackID);
         mcHitMap[curr_part] += 1.;
         ++hitTotal;
@@ -187,49 +369,61 @@ namespace ctp
     return this->GetTrueParticle(part,evt).first->PdgCode();
   }
  
-  void CTPHelper::SmoothDedxVector(std::vector<float> &dedx) const{
-
-    // Firstly, get rid of all very high values > fQMax
-    for(float &val : dedx){
-//      std::cout << "Checking de/dx = " << val;
-      if(val > fQMax){
-//        std::cout << "CTPHelper: large value " << val << " set to " << fQMax << std::endl; 
-        val = fQMax;
-      }
+  void CTPHelper::FillDedxInput(const std::vector<float> &dedx, float *out, float &mean, float &sigma) const{
+
+    const unsigned int nQ = dedx.size();
+
+    // We want to use the middle third of the dedx vector (with max length 100), points
+    // nQ - 2*pointsForAverage to nQ - pointsForAverage - 1
+    const unsigned int pointsForAverage = (fDedxLength - fMinTrackPoints) / 3;
+    const unsigned int avBegin = nQ - 2*pointsForAverage;
+    const unsigned int avEnd   = nQ - pointsForAverage;
+
+    // Only the last fDedxLength points are kept, after nPad padded values
+    const unsigned int nPad = nQ < fDedxLength ? fDedxLength - nQ : 0;
+    const unsigned int firstKept = nQ > fDedxLength ? nQ - fDedxLength : 0;
+
+    // Get rid of all very high values > fQMax
+    auto clip = [this](float val){
+      if(val > fQMax) val = fQMax;
       if(val < 1e-3){
         std::cout << "CTPHelper: small value " << val << " set to 1.0e-3 " << std::endl;
         val = 1e-3;
       }
-//      std::cout << " value becomes " << val << std::endl;
-    }
-
-    // Now try to smooth over jumps
-    unsigned int nQ = dedx.size();
-    // Now do the rest of the points
-    for(unsigned int q = 1; q < nQ - 1; ++q){
-      if((dedx[q] - dedx[q-1]) > fQJump)
-      {
-//        std::cout << "Updating dedx point " << q << " from " << dedx[q] << " to " << 0.5 * (dedx[q-1]+dedx[q+1]) << std::endl;
-        dedx[q] = 0.5 * (dedx[q-1]+dedx[q+1]);
+      return val;
+    };
+
+    // Smooth over jumps, comparing each point to the already smoothed one before it and
+    // replacing it by the average of its neighbours. The first and last points are left as
+    // they are. The mean and variance are accumulated on the way (Welford)
+    double runningMean = 0.;
+    double runningM2 = 0.;
+    unsigned int nAverage = 0;
+    float prev = 0.;
+    float curr = nQ > 0 ? clip(dedx[0]) : 0.;
+    for(unsigned int q = 0; q < nQ; ++q){
+      const float next = q + 1 < nQ ? clip(dedx[q+1]) : 0.;
+      if(q > 0 && q + 1 < nQ && (curr - prev) > fQJump) curr = 0.5 * (prev + next);
+
+      if(q >= avBegin && q < avEnd){
+        ++nAverage;
+        const double delta = curr - runningMean;
+        runningMean += delta / nAverage;
+        runningM2 += delta * (curr - runningMean);
       }
-    }
-    // First and last points are special cases
-//    std::cout << "Initial first and last points: " << dedx[0] << ", " << dedx[nQ-1] << std::endl;
-//    if((dedx[0] - dedx[1]) > fQJump) dedx[0] = dedx[1] + (dedx[1] - dedx[2]);
-//    if((dedx[nQ-1] - dedx[nQ-2]) > fQJump) dedx[nQ-1] = dedx[nQ-2] + (dedx[nQ-2] - dedx[nQ-3]);
-//    std::cout << "Final first and last points: " << dedx[0] << ", " << dedx[nQ-1] << std::endl;
-//    std::cout << "Using... " << dedx[1] << ", " << dedx[nQ-3] << ", " << dedx[nQ-2] << std::endl;
-
-  }
+      if(q >= firstKept) out[nPad + q - firstKept] = fNormalise ? this->NormaliseDedx(curr) : curr;
 
-  void CTPHelper::PadDedxVector(std::vector<float> &dedx, const float mean, const float sigma) const{
+      prev = curr;
+      curr = next;
+    }
+    mean = runningMean;
+    sigma = std::sqrt(runningM2 / static_cast<double>(nAverage));
 
+    // Pad from beginning to keep the real track part at the end. Each new value goes
+    // in front of the previous one, so fill the padding from the back
     std::default_random_engine generator;
     std::normal_distribution<float> gaussDist(mean,sigma);
-
-    unsigned int originalSize = dedx.size();
-
-    for (unsigned int h = 0; h + originalSize < fDedxLength; ++h)
+    for (unsigned int h = 0; h < nPad; ++h)
     {
       // Pick a random Gaussian value but ensure we don't go negative
       float randVal = -1;
@@ -238,25 +432,13 @@ namespace ctp
         randVal = gaussDist(generator);
       }
       while (randVal < 0);
-      // Pad from beginning to keep the real track part at the end
-      dedx.insert(dedx.begin(),randVal);
+      out[nPad - 1 - h] = fNormalise ? this->NormaliseDedx(randVal) : randVal;
     }
-
-  } 
-
-  void CTPHelper::GetDedxMeanAndSigma(const std::vector<float> &dedx, float &mean, float &sigma) const{
-
-    float averageDedx = 0;
-    float sigmaDedx = 0;
-    for(const float &q : dedx) averageDedx += q;
-    mean = averageDedx / static_cast<float>(dedx.size());
-    for(const float &q : dedx) sigmaDedx += (mean -q)*(mean-q);
-    sigma = std::sqrt(sigmaDedx / static_cast<float>(dedx.size()));
   }
 
-  void CTPHelper::GetDeflectionMeanAndSigma(const art::Ptr<recob::Track> track, float &mean, float &sigma) const{
+  void CTPHelper::GetDeflectionMeanAndSigma(const art::Ptr<recob::Track> track, float &mean, float &sigma, std::vector<float> &trajAngle) const{
 
-    std::vector<float> trajAngle;
+    trajAngle.clear();
     for(unsigned int p = 1; p < track->Trajectory().NPoints(); ++p){
       TVector3 thisDir = track->Trajectory().DirectionAtPoint<TVector3>(p);
       TVector3 prevDir = track->Trajectory().DirectionAtPoint<TVector3>(p-1);
@@ -290,47 +472,44 @@ namespace ctp
 //    std::cout << "Children = " << children.size() << "( " << nTrack << ", " << nShower << ") and grand children = " << nGrand << std::endl;
   }
 
-  void CTPHelper::NormaliseInputs(std::vector<std::vector<float>> &inputs) const{
+  float CTPHelper::NormaliseDedx(float dedx) const{
 
-    // Firstly, we need to normalise the dE/dx values
-    for(float &dedx : inputs.at(0)){
-      // Protect against negative values
-      if(dedx < 1.e-3){
-//        std::cout << "Very low dedx value = " << dedx << std::endl;
-        dedx = 1.e-3;
-      }
-      float newVal = std::log(2*dedx) + 1;
-      if(newVal > 5.) newVal = 5.;
-      dedx = (newVal / 2.5) - 1;
-    }
+    // Protect against negative values
+    if(dedx < 1.e-3) dedx = 1.e-3;
+    float newVal = std::log(2*dedx) + 1;
+    if(newVal > 5.) newVal = 5.;
+    return (newVal / 2.5) - 1;
+  }
+
+  void CTPHelper::NormaliseVariables(std::vector<float> &inputs) const{
 
     // For the three child values
     for(unsigned int v = 0; v < 3; ++v){
-      float val = inputs.at(1).at(v);
+      float val = inputs.at(v);
       if(val > 5) val = 5;
-      inputs.at(1).at(v) = (val / 2.5) - 1.0;
+      inputs.at(v) = (val / 2.5) - 1.0;
     }
 
     // The charge mean
-    float val = inputs.at(1).at(3);
+    float val = inputs.at(3);
     val = std::log(2*val) + 1;
     if(val > 5.) val = 5.;
-    inputs.at(1).at(3) = (val / 2.5) - 1;
+    inputs.at(3) = (val / 2.5) - 1;
     
     // The charge sigma
-    val = inputs.at(1).at(4);
+    val = inputs.at(4);
     if(val > 3) val = 3.;
-    inputs.at(1).at(4) = (val/1.5) - 1; 
+    inputs.at(4) = (val/1.5) - 1; 
 
     // The angle mean
-    val = inputs.at(1).at(5);
+    val = inputs.at(5);
     if(val > 0.05) val = 0.05;
-    inputs.at(1).at(5) = (val / 0.025) - 1.0;
+    inputs.at(5) = (val / 0.025) - 1.0;
 
     // The angle sigma
-    val = inputs.at(1).at(6);
+    val = inputs.at(6);
     if(val > 0.3) val = 0.3;
-    inputs.at(1).at(6) = (val / 0.15) - 1.0;
+    inputs.at(6) = (val / 0.15) - 1.0;
 
   }
 
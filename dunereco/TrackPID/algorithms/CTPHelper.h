@@ -10,6 +10,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "TVector3.h"
 
@@ -18,10 +20,15 @@
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/PFParticle.h"
+#include "lardataobj/RecoBase/Track.h"
+#include "lardataobj/AnalysisBase/Calorimetry.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
 #include "larcorealg/GeoAlgo/GeoAlgo.h"
 
 #include "dunereco/TrackPID/products/CTPResult.h"
+#include "dunereco/TrackPID/tf/CTPGraph.h"
+#include "dunereco/TFRuntime/TFBatchTuner.h"
+#include "dunereco/TFRuntime/TFOutputCache.h"
 
 namespace ctp
 {
@@ -36,8 +43,20 @@ namespace ctp
     // Function to calculate the PID for a given track
     const ctp::CTPResult RunConvolutionalTrackPID(const art::Ptr<recob::PFParticle> particle, const art::Event &evt) const;
 
+    // Calculate the PID for many tracks with batched network calls. Returns one result per
+    // particle, invalid for particles that are not track-like or have too few points
+    const std::vector<ctp::CTPResult> RunConvolutionalTrackPID(const std::vector<art::Ptr<recob::PFParticle>> &particles, const art::Event &evt) const;
+
+    // Evaluate precomputed network inputs (from GetNetworkInputs), in batches of at most
+    // BatchSize tracks. Returns one result per input
+    const std::vector<ctp::CTPResult> EvaluateNetworkInputs(const std::vector<std::vector<std::vector<float>>> &inputs) const;
+
     // Calculate the features for the track PID
     const std::vector<std::vector<float>> GetNetworkInputs(const art::Ptr<recob::PFParticle>, const art::Event &evt) const;
+    // Calculate the features for many particles of one event in a single sweep. The associations
+    // are resolved once and the child particles of all particles are counted in one pass. The
+    // inputs of particles that are not track-like or have too few points are left empty
+    const std::vector<std::vector<std::vector<float>>> GetNetworkInputs(const std::vector<art::Ptr<recob::PFParticle>> &particles, const art::Event &evt) const;
     const std::vector<float> GetDeDxVector(const art::Ptr<recob::PFParticle>, const art::Event &evt) const;
     const std::vector<float> GetVariableVector(const art::Ptr<recob::PFParticle>, const art::Event &evt) const;
 
@@ -47,14 +66,32 @@ namespace ctp
 
   private:
 
-    void SmoothDedxVector(std::vector<float> &dedx) const;
-    void PadDedxVector(std::vector<float> &dedx, const float mean, const float sigma) const;
-    void GetDedxMeanAndSigma(const std::vector<float> &dedx, float &mean, float &sigma) const;
-    void GetDeflectionMeanAndSigma(const art::Ptr<recob::Track> track, float &mean, float &sigma) const;
+    // Buffers reused between the tracks of a sweep
+    struct FeatureScratch
+    {
+      std::vector<float> angles;
+    };
+
+    // Build the two input vectors from the track, its calorimetry and the child counts
+    void FillNetworkInputs(const art::Ptr<recob::Track> track, const anab::Calorimetry &calo, const float nTrack, const float nShower, const float nGrand,
+                           FeatureScratch &scratch, std::vector<std::vector<float>> &netInputs) const;
+
+    // Clip and smooth the dE/dx, take the mean and sigma of its middle third, pad it to fDedxLength
+    // and normalise it in a single pass. The fDedxLength values are written straight to out
+    void FillDedxInput(const std::vector<float> &dedx, float *out, float &mean, float &sigma) const;
+    void GetDeflectionMeanAndSigma(const art::Ptr<recob::Track> track, float &mean, float &sigma, std::vector<float> &trajAngle) const;
 
     void GetChildParticles(const art::Ptr<recob::PFParticle> part, const art::Event &evt, float &nTrack, float &nShower, float &nGrand) const;
 
-    void NormaliseInputs(std::vector<std::vector<float>> &netInputs) const;
+    float NormaliseDedx(float dedx) const;
+    void NormaliseVariables(std::vector<float> &variables) const;
+
+    // Load the network on first use, once even if called from several threads
+    tf::CTPGraph& GetNetwork() const;
+
+    // Run the network over inputs in batches. Returns the network outputs of each input,
+    // empty for the inputs of a batch that failed
+    std::vector<std::vector<std::vector<float>>> RunNetwork(const std::vector<std::vector<std::vector<float>>> &inputs) const;
 
     // Variables for accessing the network architecture
     std::string fNetDir;
@@ -73,6 +110,27 @@ namespace ctp
     float fQJump; // Maximum difference between consequetive dEdx values
 
     bool fNormalise; // Normalise the inputs for the network
+
+    // Tensorflow session threading
+    int fInterOpThreads;
+    int fIntraOpThreads;
+    bool fUseGlobalThreadPool;
+    int fNUMANode; ///< NUMA node of the session threads, -1 for none
+
+    // Maximum number of tracks per network call, 0 for no limit
+    unsigned int fBatchSize;
+
+    // Network, loaded on first use
+    mutable std::unique_ptr<tf::CTPGraph> fConvNet;
+    mutable std::once_flag fConvNetLoaded;
+    // Guards the running of the network, so the helper can be shared by concurrent events
+    mutable std::mutex fNetMutex;
+
+    // Outputs of inputs already seen, if a cache file is configured
+    std::unique_ptr<tf::OutputCache> fOutputCache;
+
+    // Picks the batch size during the first calls, if configured
+    std::unique_ptr<tf::BatchTuner> fBatchTuner;
   };
 
 }
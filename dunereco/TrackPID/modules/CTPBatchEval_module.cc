@@ -0,0 +1,219 @@
+/**
+ *  @file   dunereco/TrackPID/modules/CTPBatchEval_module.cc
+ *
+ *  @brief  This module runs the convolutional track PID network over
+ *          tracks queued from several events and writes the scores
+ *          to a TTree
+ */
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+
+#include "TTree.h"
+
+#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
+
+#include "dunereco/TrackPID/algorithms/CTPHelper.h"
+#include "dunereco/TrackPID/products/CTPResult.h"
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace ctp
+{
+
+/**
+ *  @brief  CTPBatchEval class
+ *
+ *  The network inputs of the tracks of several events are queued and evaluated together once
+ *  at least BatchSize tracks are waiting. This is meant for samples with few tracks per event,
+ *  where one network call per event is still dominated by the call overhead. The queue is also
+ *  flushed at the end of every subrun and of the job. The tree has one entry per track.
+ */
+class CTPBatchEval : public art::EDAnalyzer
+{
+public:
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  pset
+     */
+     CTPBatchEval(fhicl::ParameterSet const &pset);
+
+    /**
+     *  @brief  Destructor
+     */
+     virtual ~CTPBatchEval();
+
+     void beginJob();
+     void endSubRun(const art::SubRun &);
+     void endJob();
+     void analyze(const art::Event &evt);
+
+private:
+
+  /// Evaluate and write out all queued tracks
+  void Flush();
+
+  fhicl::ParameterSet fHelperPars;
+  CTPHelper fConvTrackPID;
+  std::string fParticleLabel;
+  unsigned int fBatchSize;
+
+  /// Queued network inputs and the details of their tracks
+  std::vector<std::vector<std::vector<float>>> fQueue;
+  std::vector<art::EventID> fQueueIDs;
+  std::vector<int> fQueueTrackIDs;
+  std::vector<int> fQueuePDGs;
+  std::vector<unsigned int> fQueueCaloPoints;
+
+  TTree *fPIDTree;
+  int fRun;
+  int fSubRun;
+  int fEvent;
+  int fTrackID;
+  float fMuonScore;
+  float fPionScore;
+  float fProtonScore;
+  int fPDG;
+  unsigned int fCaloPoints;
+};
+
+DEFINE_ART_MODULE(CTPBatchEval)
+
+} // namespace ctp
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// implementation follows
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/SubRun.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "lardataobj/RecoBase/PFParticle.h"
+#include "lardataobj/RecoBase/Track.h"
+#include "lardataobj/AnalysisBase/Calorimetry.h"
+
+#include <algorithm>
+
+namespace ctp
+{
+
+CTPBatchEval::CTPBatchEval(fhicl::ParameterSet const &pset) : art::EDAnalyzer(pset),
+fHelperPars(pset.get<fhicl::ParameterSet>("ctpHelper")),
+fConvTrackPID(fHelperPars),
+fParticleLabel(pset.get<std::string>("particleLabel")),
+fBatchSize(std::max(1u,pset.get<unsigned int>("batchSize",256))),
+fPIDTree(nullptr)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+CTPBatchEval::~CTPBatchEval()
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPBatchEval::beginJob()
+{
+    art::ServiceHandle<art::TFileService const> tfs;
+
+    fPIDTree = tfs->make<TTree>("pidTree","pidTree");
+    fPIDTree->Branch("run",&fRun);
+    fPIDTree->Branch("subrun",&fSubRun);
+    fPIDTree->Branch("event",&fEvent);
+    fPIDTree->Branch("trackID",&fTrackID);
+    fPIDTree->Branch("muonScore",&fMuonScore);
+    fPIDTree->Branch("pionScore",&fPionScore);
+    fPIDTree->Branch("protonScore",&fProtonScore);
+    fPIDTree->Branch("pdgCode",&fPDG);
+    fPIDTree->Branch("caloPoints",&fCaloPoints);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPBatchEval::endSubRun(const art::SubRun &)
+{
+    this->Flush();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPBatchEval::endJob()
+{
+    this->Flush();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPBatchEval::analyze(const art::Event &evt)
+{
+    // Get all of the PFParticles
+    const std::vector<art::Ptr<recob::PFParticle>> particles = dune_ana::DUNEAnaEventUtils::GetPFParticles(evt,fParticleLabel);
+
+    const std::string trkLabel = fHelperPars.get<std::string>("TrackLabel");
+    const std::string caloLabel = fHelperPars.get<std::string>("CalorimetryLabel");
+    // Empty for particles that are not track-like or not suitable
+    std::vector<std::vector<std::vector<float>>> allInputs = fConvTrackPID.GetNetworkInputs(particles,evt);
+    for (unsigned int p = 0; p < particles.size(); ++p)
+    {
+        if (allInputs.at(p).empty()) continue;
+        const art::Ptr<recob::PFParticle> &particle = particles.at(p);
+
+        const art::Ptr<recob::Track> trk = dune_ana::DUNEAnaPFParticleUtils::GetTrack(particle,evt,fParticleLabel,trkLabel);
+        const art::Ptr<anab::Calorimetry> calo = dune_ana::DUNEAnaTrackUtils::GetCalorimetry(trk,evt,trkLabel,caloLabel);
+
+        // The event data is gone by the time the batch is evaluated, so keep everything we need
+        fQueue.push_back(std::move(allInputs.at(p)));
+        fQueueIDs.push_back(evt.id());
+        fQueueTrackIDs.push_back(trk.key());
+        fQueuePDGs.push_back(evt.isRealData() ? 0 : fConvTrackPID.GetTruePDGCode(particle,evt));
+        fQueueCaloPoints.push_back(calo->dEdx().size());
+    }
+
+    if (fQueue.size() >= fBatchSize) this->Flush();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPBatchEval::Flush()
+{
+    if (fQueue.empty()) return;
+
+    const std::vector<CTPResult> pids = fConvTrackPID.EvaluateNetworkInputs(fQueue);
+    mf::LogDebug("CTPBatchEval::Flush") << "evaluated a batch of " << fQueue.size() << " tracks";
+
+    for (unsigned int t = 0; t < pids.size(); ++t)
+    {
+        if (!pids.at(t).IsValid()) continue;
+
+        const art::EventID &id = fQueueIDs.at(t);
+        fRun = id.run();
+        fSubRun = id.subRun();
+        fEvent = id.event();
+        fTrackID = fQueueTrackIDs.at(t);
+        fMuonScore = pids.at(t).GetMuonScore();
+        fPionScore = pids.at(t).GetPionScore();
+        fProtonScore = pids.at(t).GetProtonScore();
+        fPDG = fQueuePDGs.at(t);
+        fCaloPoints = fQueueCaloPoints.at(t);
+        fPIDTree->Fill();
+    }
+
+    fQueue.clear();
+    fQueueIDs.clear();
+    fQueueTrackIDs.clear();
+    fQueuePDGs.clear();
+    fQueueCaloPoints.clear();
+}
+
+} //namespace ctp
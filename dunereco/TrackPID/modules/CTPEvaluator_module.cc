@@ -2,17 +2,20 @@
  *  @file   dunereco/TrackPID/modules/CTPEvaluator_module.cc
  *
  *  @brief  This module performs track PID using the convolutionsl 
- *          track PID network
+ *          track PID network. It is shared between the schedules, with
+ *          the events serialized on the TFileService when the PID tree
+ *          is written
  */
 
 #include "art/Framework/Core/ModuleMacros.h"
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 
 #include "TTree.h"
 #include "TVector3.h"
 
 #include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
 #include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
 #include "dunereco/AnaUtils/DUNEAnaShowerUtils.h"
 
@@ -36,7 +39,7 @@ namespace ctp
 /**
  *  @brief  CTPEvaluator class
  */
-class CTPEvaluator : public art::EDProducer
+class CTPEvaluator : public art::SharedProducer
 {
 public:
     /**
@@ -44,16 +47,16 @@ public:
      *
      *  @param  pset
      */
-     CTPEvaluator(fhicl::ParameterSet const &pset);
+     CTPEvaluator(fhicl::ParameterSet const &pset, art::ProcessingFrame const &);
 
     /**
      *  @brief  Destructor
      */
      virtual ~CTPEvaluator();
 
-     void beginJob();
-     void endJob();
-     void produce(art::Event &evt);
+     void beginJob(art::ProcessingFrame const &) override;
+     void endJob(art::ProcessingFrame const &) override;
+     void produce(art::Event &evt, art::ProcessingFrame const &) override;
 
 private:
 
@@ -61,7 +64,13 @@ private:
   CTPHelper fConvTrackPID;
   std::string fParticleLabel;
   bool fWriteTree;
+  bool fSkipCosmics;
+  std::string fT0Label;
 
+  // Forwards the results of an earlier pass made with the same configuration
+  dune_ana::DUNEAnaProductReuse fReuse;
+
+  // Branches of the PID tree, only used with the events serialized
   std::vector<float> fMuonScoreVector;
   std::vector<float> fPionScoreVector;
   std::vector<float> fProtonScoreVector;
@@ -83,6 +92,7 @@ DEFINE_ART_MODULE(CTPEvaluator)
 #include "fhiclcpp/ParameterSet.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Utilities/SharedResource.h"
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -106,14 +116,26 @@ DEFINE_ART_MODULE(CTPEvaluator)
 namespace ctp
 {
 
-CTPEvaluator::CTPEvaluator(fhicl::ParameterSet const &pset) : art::EDProducer(pset),
+CTPEvaluator::CTPEvaluator(fhicl::ParameterSet const &pset, art::ProcessingFrame const &) : art::SharedProducer(pset),
 fHelperPars(pset.get<fhicl::ParameterSet>("ctpHelper")),
 fConvTrackPID(fHelperPars),
 fParticleLabel(pset.get<std::string>("particleLabel")),
-fWriteTree(pset.get<bool>("writeTree"))
+fWriteTree(pset.get<bool>("writeTree")),
+fSkipCosmics(pset.get<bool>("skipCosmics",false)),
+fT0Label(pset.get<std::string>("t0Label","")),
+fReuse(pset)
 {
+    fReuse.AddInput<std::vector<recob::PFParticle>>(fParticleLabel);
+    fReuse.AddInput<std::vector<recob::Track>>(fHelperPars.get<std::string>("TrackLabel"));
+
     produces<std::vector<ctp::CTPResult>>();
     produces<art::Assns<recob::Track,ctp::CTPResult>>();
+
+    // The network calls are serialized by the helper
+    if (fWriteTree)
+        serialize<art::InEvent>(art::SharedResource<art::TFileService>);
+    else
+        async<art::InEvent>();
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -124,7 +146,7 @@ CTPEvaluator::~CTPEvaluator()
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void CTPEvaluator::beginJob()
+void CTPEvaluator::beginJob(art::ProcessingFrame const &)
 {
     if (!fWriteTree) return;
   
@@ -140,14 +162,22 @@ void CTPEvaluator::beginJob()
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void CTPEvaluator::endJob()
+void CTPEvaluator::endJob(art::ProcessingFrame const &)
 {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void CTPEvaluator::produce(art::Event &evt)
+void CTPEvaluator::produce(art::Event &evt, art::ProcessingFrame const &)
 {
+    // Results of an earlier pass with the same configuration are forwarded, without entries in the PID tree
+    if (fReuse.Matches<std::vector<ctp::CTPResult>>(evt))
+    {
+        fReuse.Forward<std::vector<ctp::CTPResult>>(evt);
+        fReuse.ForwardAssns<recob::Track,ctp::CTPResult,std::vector<ctp::CTPResult>>(evt);
+        return;
+    }
+
     // Define containers for the things we're going to produce
     std::unique_ptr< std::vector<ctp::CTPResult> > resultCol(new std::vector<ctp::CTPResult>);
     std::unique_ptr< art::Assns<recob::Track,ctp::CTPResult> > trackResultAssn(new art::Assns<recob::Track,ctp::CTPResult>);
@@ -161,36 +191,42 @@ void CTPEvaluator::produce(art::Event &evt)
         fCaloPoints.clear();
     }
 
-    // Get all of the PFParticles
-    const std::vector<art::Ptr<recob::PFParticle>> particles = dune_ana::DUNEAnaEventUtils::GetPFParticles(evt,fParticleLabel);
+    // Get all of the PFParticles, or only those outside the clear cosmic slices
+    const std::vector<art::Ptr<recob::PFParticle>> particles = fSkipCosmics ?
+        dune_ana::DUNEAnaEventUtils::GetInterestingPFParticles(evt,fParticleLabel,fT0Label) :
+        dune_ana::DUNEAnaEventUtils::GetPFParticles(evt,fParticleLabel);
 
     // Get the tracks too
     const std::string trkLabel = fHelperPars.get<std::string>("TrackLabel");
     const std::vector<art::Ptr<recob::Track>> tracks = dune_ana::DUNEAnaEventUtils::GetTracks(evt,trkLabel);
 
+    // Collect the track-like particles so the network can be run once for all of them
+    const std::string caloLabel = fHelperPars.get<std::string>("CalorimetryLabel");
+    std::vector<art::Ptr<recob::PFParticle>> trackParticles;
+    std::vector<int> trackIDs;
+    std::vector<unsigned int> caloPoints;
     for (const art::Ptr<recob::PFParticle> &particle : particles)
     {
-        int thisTrackID = -999;
-      
-        // Get the track if this particle is track-like
-        unsigned int nCaloPoints = 0;
-        if (dune_ana::DUNEAnaPFParticleUtils::IsTrack(particle,evt,fParticleLabel,trkLabel))
-        {
-            const art::Ptr<recob::Track> trk = dune_ana::DUNEAnaPFParticleUtils::GetTrack(particle,evt,fParticleLabel,trkLabel);
-            const std::string caloLabel = fHelperPars.get<std::string>("CalorimetryLabel");
-            const art::Ptr<anab::Calorimetry> calo = dune_ana::DUNEAnaTrackUtils::GetCalorimetry(trk,evt,trkLabel,caloLabel);
+        if (!dune_ana::DUNEAnaPFParticleUtils::IsTrack(particle,evt,fParticleLabel,trkLabel)) continue;
 
-            thisTrackID = trk.key();
-            nCaloPoints = calo->dEdx().size();
-        }
-        else continue;
+        const art::Ptr<recob::Track> trk = dune_ana::DUNEAnaPFParticleUtils::GetTrack(particle,evt,fParticleLabel,trkLabel);
+        const art::Ptr<anab::Calorimetry> calo = dune_ana::DUNEAnaTrackUtils::GetCalorimetry(trk,evt,trkLabel,caloLabel);
+
+        trackParticles.push_back(particle);
+        trackIDs.push_back(trk.key());
+        caloPoints.push_back(calo->dEdx().size());
+    }
+
+    // Results are dummy values for tracks that are not suitable
+    const std::vector<CTPResult> pids = fConvTrackPID.RunConvolutionalTrackPID(trackParticles,evt);
 
-        // Returns a dummy value if not a track or not suitable
-        CTPResult thisPID = fConvTrackPID.RunConvolutionalTrackPID(particle,evt);
+    auto const ptrMaker = art::PtrMaker<ctp::CTPResult>(evt);
+    for (unsigned int t = 0; t < trackParticles.size(); ++t)
+    {
+        const CTPResult &thisPID = pids.at(t);
         resultCol->push_back(thisPID);
-        auto const ptrMaker = art::PtrMaker<ctp::CTPResult>(evt);
         art::Ptr<ctp::CTPResult> ptrResult = ptrMaker(resultCol->size()-1);
-        art::Ptr<recob::Track> thisTrack = tracks.at(thisTrackID);
+        art::Ptr<recob::Track> thisTrack = tracks.at(trackIDs.at(t));
 
 //        std::cout << "Making association between track " << thisTrack.key() << " and PID result " << ptrResult.key() << std::endl;
 
@@ -202,14 +238,14 @@ void CTPEvaluator::produce(art::Event &evt)
             if (!thisPID.IsValid()) continue;
             int pdg = 0;
             if(!evt.isRealData()){
-                pdg = fConvTrackPID.GetTruePDGCode(particle,evt);
+                pdg = fConvTrackPID.GetTruePDGCode(trackParticles.at(t),evt);
             }
             std::cout << "Got a track PID for particle of type " << pdg << ": " << thisPID.GetMuonScore() << ", " << thisPID.GetPionScore() << ", " << thisPID.GetProtonScore() << std::endl;       
             fMuonScoreVector.push_back(thisPID.GetMuonScore());
             fPionScoreVector.push_back(thisPID.GetPionScore());
             fProtonScoreVector.push_back(thisPID.GetProtonScore());
             fPDGVector.push_back(pdg);
-            fCaloPoints.push_back(nCaloPoints);
+            fCaloPoints.push_back(caloPoints.at(t));
         }
     }
     if (fWriteTree) fPIDTree->Fill();
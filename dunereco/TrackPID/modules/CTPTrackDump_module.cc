@@ -19,12 +19,16 @@
 
 #include "dunereco/TrackPID/algorithms/CTPHelper.h"
 
+#include "dunereco/CVN/func/FeatureEncoding.h"
+
 #include "larsim/MCCheater/BackTrackerService.h"
 #include "larsim/MCCheater/ParticleInventoryService.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/Simulation/SimChannel.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
 
+#include <cstdio>
+#include <ctime>
 #include <fstream>
 #include <string>
 
@@ -60,9 +64,34 @@ private:
   void WriteTextFile(const art::Event &evt,const std::vector<std::vector<float>> &inputs, const std::pair<const simb::MCParticle*,float> &trueParticle,
                      const unsigned int &trackNumber, const unsigned int &nHits) const;
 
+  // Append one record to the current shard, starting a new shard when it is full
+  void WriteShardRecord(const art::Event &evt,const std::vector<std::vector<float>> &inputs, const std::pair<const simb::MCParticle*,float> &trueParticle,
+                        const unsigned int &trackNumber, const unsigned int &nHits);
+  void CloseShard();
+
   fhicl::ParameterSet fHelperPars;
   CTPHelper fConvTrackPID;
   std::string fParticleLabel;
+
+  // Binary shards: each record is the dE/dx vector, the variables, then the number of
+  // calorimetry points, the true momentum and the true energy fraction, all float32. The
+  // .idx text file of the shard gives the widths and the run, subrun, event, track and
+  // true PDG code of every record. With a FeatureType of float16 or bfloat16 the dE/dx
+  // and variables are stored in 16 bits, the last three values stay float32, and the
+  // second line of the .idx file is the encoding with the scale of every input
+  unsigned int fShardSize; // records per shard, 0 for one text file per track
+  std::string fOutputDir;
+  std::string fShardPrefix;
+  std::string fShardName;
+  unsigned int fNShards;
+  unsigned int fNRecords;
+  size_t fNDedx;
+  size_t fNVars;
+  std::FILE *fShardFile;
+  std::ofstream fIndexFile;
+  std::vector<float> fRecord;
+  cvn::FeatureEncoder fEncoder;
+  std::vector<unsigned char> fRecordBytes;
 };
 
 DEFINE_ART_MODULE(CTPTrackDump)
@@ -78,6 +107,7 @@ DEFINE_ART_MODULE(CTPTrackDump)
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
+#include "canvas/Utilities/Exception.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include "lardataobj/RecoBase/PFParticle.h"
@@ -100,8 +130,20 @@ namespace ctp
 CTPTrackDump::CTPTrackDump(fhicl::ParameterSet const &pset) : art::EDAnalyzer(pset),
 fHelperPars(pset.get<fhicl::ParameterSet>("ctpHelper")),
 fConvTrackPID(fHelperPars),
-fParticleLabel(pset.get<std::string>("particleLabel"))
+fParticleLabel(pset.get<std::string>("particleLabel")),
+fShardSize(pset.get<unsigned int>("ShardSize",0)),
+fOutputDir(pset.get<std::string>("OutputDir",".")),
+fShardPrefix(pset.get<std::string>("ShardPrefix","ctp")),
+fNShards(0),
+fNRecords(0),
+fNDedx(0),
+fNVars(0),
+fShardFile(nullptr),
+fEncoder(cvn::ReadEncodingConfig(pset))
 {
+  if(fEncoder.Config().coordinates != cvn::CoordinateType::kFloat32){
+    throw art::Exception(art::errors::Configuration) << "CTP records have no coordinates to pack, CoordinateType must be float32" << std::endl;
+  }
 
 }
 
@@ -109,18 +151,25 @@ fParticleLabel(pset.get<std::string>("particleLabel"))
 
 CTPTrackDump::~CTPTrackDump()
 {
+  CloseShard();
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void CTPTrackDump::beginJob()
 {
+  fShardName = fOutputDir + "/" + fShardPrefix + "_h" + std::to_string(time(0));
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void CTPTrackDump::endJob()
 {
+  CloseShard();
+
+  if(fEncoder.Saturated() > 0){
+    mf::LogWarning("CTPTrackDump") << fEncoder.Saturated() << " inputs were clamped to the range of their storage type";
+  }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -131,9 +180,14 @@ void CTPTrackDump::analyze(const art::Event &evt)
     // Get all of the PFParticles
     const std::vector<art::Ptr<recob::PFParticle>> particles = dune_ana::DUNEAnaEventUtils::GetPFParticles(evt,fParticleLabel);
 
+    // Features of all the particles in one sweep, empty for those without usable inputs
+    const std::vector<std::vector<std::vector<float>>> allInputs = fConvTrackPID.GetNetworkInputs(particles,evt);
+
     unsigned int nTracks = 0;
-    for (const art::Ptr<recob::PFParticle> &particle : particles)
+    for (unsigned int p = 0; p < particles.size(); ++p)
     {
+        const art::Ptr<recob::PFParticle> &particle = particles.at(p);
+
         // Get the track if this particle is track-like
         unsigned int nCaloPoints = 0;
         const std::string trkLabel = fHelperPars.get<std::string>("TrackLabel");
@@ -147,14 +201,19 @@ void CTPTrackDump::analyze(const art::Event &evt)
         }
         else continue;
 
-        // Returns a dummy value if not a track or not suitable
-        std::vector<std::vector<float>> netInputs = fConvTrackPID.GetNetworkInputs(particle,evt);
+        const std::vector<std::vector<float>> &netInputs = allInputs.at(p);
 
         if(netInputs.empty()) continue;
 
         const std::pair<const simb::MCParticle*,float> trueParticle = fConvTrackPID.GetTrueParticle(particle,evt);
 
-        this->WriteTextFile(evt,netInputs,trueParticle,nTracks,nCaloPoints);
+        if(fShardSize > 0)
+        {
+            if(!trueParticle.first) continue;
+            this->WriteShardRecord(evt,netInputs,trueParticle,nTracks,nCaloPoints);
+        }
+        else
+            this->WriteTextFile(evt,netInputs,trueParticle,nTracks,nCaloPoints);
         ++nTracks;   
     }
 
@@ -187,5 +246,70 @@ void CTPTrackDump::WriteTextFile(const art::Event &evt, const std::vector<std::v
 
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPTrackDump::WriteShardRecord(const art::Event &evt, const std::vector<std::vector<float>> &inputs, const std::pair<const simb::MCParticle*,float> &trueParticle,
+                                    const unsigned int &trackNumber, const unsigned int &nHits){
+
+        const std::vector<float> &dedx = inputs.at(0);
+        const std::vector<float> &vars = inputs.at(1);
+
+        // The first record fixes the widths, so the shards can be read as one float32 array
+        if(fNDedx == 0 && fNVars == 0){
+          fNDedx = dedx.size();
+          fNVars = vars.size();
+        }
+        if(dedx.size() != fNDedx || vars.size() != fNVars){
+          throw art::Exception(art::errors::LogicError) << "CTP inputs of " << dedx.size() << " dE/dx values and " << vars.size()
+            << " variables do not match the " << fNDedx << " and " << fNVars << " of the shards" << std::endl;
+        }
+
+        if(fShardFile && fNRecords >= fShardSize) CloseShard();
+        if(!fShardFile){
+          const std::string name = fShardName + "_" + std::to_string(fNShards++);
+          const cvn::FeatureType type = fEncoder.Config().features;
+          const std::string extension = type == cvn::FeatureType::kFloat16 ? ".f16" : type == cvn::FeatureType::kBFloat16 ? ".bf16" : ".f32";
+          fShardFile = std::fopen((name + extension).c_str(), "wb");
+          fIndexFile.open(name + ".idx");
+          if(!fShardFile || !fIndexFile){
+            throw art::Exception(art::errors::FileOpenError) << "Unable to open the CTP shard " << name << std::endl;
+          }
+          fIndexFile << fNDedx << " " << fNVars << " " << 3 << "\n";
+          if(type != cvn::FeatureType::kFloat32) fIndexFile << "encoding " << fEncoder.Describe(fNDedx + fNVars) << "\n";
+        }
+
+        fRecord.assign(dedx.begin(), dedx.end());
+        fRecord.insert(fRecord.end(), vars.begin(), vars.end());
+        const size_t nInputs = fRecord.size();
+        fRecord.push_back(nHits);
+        fRecord.push_back(trueParticle.first->P());
+        fRecord.push_back(trueParticle.second);
+
+        // The inputs in their storage type, the three truth values as float32
+        fRecordBytes.clear();
+        fEncoder.EncodeFeatures(fRecord.data(), nInputs, nInputs, fRecordBytes);
+        const unsigned char *truth = reinterpret_cast<const unsigned char*>(fRecord.data() + nInputs);
+        fRecordBytes.insert(fRecordBytes.end(), truth, truth + 3*sizeof(float));
+
+        if(std::fwrite(fRecordBytes.data(), 1, fRecordBytes.size(), fShardFile) != fRecordBytes.size()){
+          throw art::Exception(art::errors::FileWriteError) << "Unable to write to the CTP shard " << fShardName << std::endl;
+        }
+        fIndexFile << evt.id().run() << " " << evt.id().subRun() << " " << evt.id().event() << " " << trackNumber << " "
+                   << trueParticle.first->PdgCode() << "\n";
+        ++fNRecords;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void CTPTrackDump::CloseShard(){
+
+        if(!fShardFile) return;
+
+        std::fclose(fShardFile);
+        fShardFile = nullptr;
+        fIndexFile.close();
+        fNRecords = 0;
+}
+
 } //namespace ctp
 
@@ -10,12 +10,13 @@
 #include "CTPGraph.h"
 
 #include "tensorflow/core/public/session.h"
-#include "tensorflow/core/platform/env.h"
 
-#include "tensorflow/core/public/session_options.h"
+#include "dunereco/TFRuntime/TFSessionRegistry.h"
+#include "dunereco/TFRuntime/TFTensorCache.h"
 
 // -------------------------------------------------------------------
-tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs)
+tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+                       const ThreadConfig & threads)
 {
 
 //    std::cout << "Starting to build the graph" << std::endl;
@@ -24,37 +25,21 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
     n_inputs = ninputs;
     n_outputs = noutputs;
 
-    // Force tf to only use a single core so it doesn't eat batch farms
-    tensorflow::SessionOptions options;
-    tensorflow::ConfigProto &config = options.config;
-    config.set_inter_op_parallelism_threads(1);
-    config.set_intra_op_parallelism_threads(1);
-    config.set_use_per_session_threads(false);
+    fInputs = std::make_unique<TensorCache>();
 
+    // By default tf only uses a single core so it doesn't eat batch farms
 //    std::cout << "Starting tf session" << std::endl;
-    auto status = tensorflow::NewSession(options, &fSession);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
-//    std::cout << "Session started... reading network architecture" << std::endl;
-    tensorflow::GraphDef graph_def;
-    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    fSession = SessionRegistry::Instance().GetGraph(graph_file_name, threads);
+    if (!fSession) { return; }
 
 //    std::cout << "Extracting input names" << std::endl;
-    size_t ng = graph_def.node().size();
+    const std::vector<std::string> & nodes = fSession->NodeNames();
+    size_t ng = nodes.size();
 
     // fill input names (TODO: generic)
     for(int i=0; i<n_inputs; ++i)
     {
-        fInputNames.push_back(graph_def.node()[i].name());
+        fInputNames.push_back(nodes[i]);
     }
 
 //    std::cout << "Extracting output names" << std::endl;
@@ -63,7 +48,7 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
     {
         for(int i=n_outputs; i>0; --i)
         {
-            fOutputNames.push_back(graph_def.node()[ng - i].name()); 
+            fOutputNames.push_back(nodes[ng - i]);
         }
 
     }
@@ -72,7 +57,7 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
         std::string last, current, basename, name;
         for (size_t n = 0; n < ng; ++n)
         {
-            name = graph_def.node()[n].name();
+            name = nodes[n];
             auto pos = name.find("/");
             if (pos != std::string::npos) { basename = name.substr(0, pos); }
             else { continue; }
@@ -100,15 +85,6 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
         return;
     }
 
-//    std::cout << "About to create graph" << std::endl;
-
-    status = fSession->Create(graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
     success = true; // ok, graph loaded from the file
 
 //    std::cout << "Graph success? " << success << std::endl;
@@ -116,11 +92,6 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
 
 tf::CTPGraph::~CTPGraph()
 {
-    auto status = fSession->Close();
-    if (!status.ok()) {
-      std::cout << "tf::CTPGraph::dtor: " << "Close failed." << std::endl;
-    }
-    delete fSession;
 }
 
 // -------------------------------------------------------------------
@@ -130,16 +101,17 @@ std::vector< std::vector< std::vector<float> > > tf::CTPGraph::run(
 {
   // Number of objects to classify
   const unsigned int nSamples = input.size();
+  if (nSamples == 0) { return std::vector< std::vector< std::vector<float> > >(); }
 
   // There are two inputs to our network...
   // 1) The 100 element dE/dx array
   const unsigned int nEls = input.front().at(0).size();
-  tensorflow::Tensor dEdxTensor(tensorflow::DT_FLOAT,tensorflow::TensorShape({nSamples,nEls,1}));
+  tensorflow::Tensor dEdxTensor = fInputs->Get(0,tensorflow::TensorShape({nSamples,nEls,1}));
 
   // 2) The 7 additional classification variables
   const unsigned int nVars = input.front().at(1).size();
   // NB: this input doesn't need a defined depth as it doesn't use convolutions
-  tensorflow::Tensor varsTensor(tensorflow::DT_FLOAT,tensorflow::TensorShape({nSamples,nVars}));
+  tensorflow::Tensor varsTensor = fInputs->Get(1,tensorflow::TensorShape({nSamples,nVars}));
 
 //  std::cout << "Input shapes: " << input.size() << ", " << input.front().size() << ", " << input.front().at(0).size() << ", " << input.front().at(1).size() << std::endl;
 
@@ -181,7 +153,7 @@ std::vector< std::vector< std::vector< float > > > tf::CTPGraph::run(const std::
 
     // The output from TF has dimensions nOutputs, nSamples, nNodes
     std::vector<tensorflow::Tensor> outputs;
-    auto status = fSession->Run(inputs, fOutputNames, {}, &outputs);
+    auto status = fSession->Run(inputs, fOutputNames, &outputs);
 
 //    std::cout << "Sorting out the outputs inside the interface" << std::endl;
 
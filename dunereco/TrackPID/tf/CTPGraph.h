@@ -14,25 +14,30 @@
 #include <vector>
 #include <string>
 
+#include "dunereco/TFRuntime/TFThreadConfig.h"
+
 namespace tensorflow
 {
-    class Session;
     class Tensor;
 }
 
 namespace tf
 {
 
+class SharedSession;
+class TensorCache;
+
 class CTPGraph
 {
 public:
    int n_inputs = 1;
    int n_outputs = 1;
 
-   static std::unique_ptr<CTPGraph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1)
+   static std::unique_ptr<CTPGraph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1,
+                                           const ThreadConfig & threads = ThreadConfig())
     {
         bool success;
-        std::unique_ptr<CTPGraph> ptr(new CTPGraph(graph_file_name, outputs, success, ninputs, noutputs));
+        std::unique_ptr<CTPGraph> ptr(new CTPGraph(graph_file_name, outputs, success, ninputs, noutputs, threads));
         if (success) { return ptr; }
         else { return nullptr; }
     }
@@ -49,9 +54,11 @@ public:
 
 private:
     /// Not-throwing constructor.
-    CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs);
+    CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+             const ThreadConfig & threads);
 
-    tensorflow::Session* fSession;
+    std::shared_ptr<SharedSession> fSession; ///< Shared with other users of the same graph file
+    std::unique_ptr<TensorCache> fInputs;   ///< Input tensors reused between calls
     //std::vector< std::string > fInputNames;
     std::vector< std::string > fInputNames;
     std::vector< std::string > fOutputNames;
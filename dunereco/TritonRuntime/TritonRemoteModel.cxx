@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       RemoteConfig, RemoteModel
+////
+//// Client of a network served by an inference server (NVIDIA Triton) over gRPC.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "dunereco/TritonRuntime/TritonRemoteModel.h"
+
+#include <chrono>
+#include <functional>
+#include <numeric>
+
+#include "fhiclcpp/ParameterSet.h"
+#include "grpc_client.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+namespace tc = triton::client;
+
+// -------------------------------------------------------------------
+tritonrt::RemoteConfig tritonrt::ReadRemoteConfig(const fhicl::ParameterSet & pset)
+{
+    RemoteConfig config;
+    config.url = pset.get<std::string>("Url");
+    config.modelName = pset.get<std::string>("ModelName");
+    config.modelVersion = pset.get<std::string>("ModelVersion", config.modelVersion);
+    config.timeoutMicroseconds = pset.get<unsigned int>("TimeoutMicroseconds", config.timeoutMicroseconds);
+    config.retries = pset.get<unsigned int>("Retries", config.retries);
+    config.maxFailedBatches = pset.get<unsigned int>("MaxFailedBatches", config.maxFailedBatches);
+    config.verbose = pset.get<bool>("Verbose", config.verbose);
+    return config;
+}
+
+std::unique_ptr<tritonrt::RemoteModel> tritonrt::RemoteModel::Create(const RemoteConfig & config)
+{
+    std::unique_ptr<tc::InferenceServerGrpcClient> client;
+    tc::Error err = tc::InferenceServerGrpcClient::Create(&client, config.url, config.verbose);
+    if (!err.IsOk())
+    {
+        mf::LogWarning("RemoteModel") << "Can't create a client for " << config.url << ", " << err.Message();
+        return nullptr;
+    }
+
+    bool ready = false;
+    err = client->IsModelReady(&ready, config.modelName, config.modelVersion);
+    if (!err.IsOk() || !ready)
+    {
+        mf::LogWarning("RemoteModel") << "Model " << config.modelName << " not ready on " << config.url
+                                      << (err.IsOk() ? std::string() : ", " + err.Message());
+        return nullptr;
+    }
+
+    mf::LogInfo("RemoteModel") << "Using " << config.modelName << " on " << config.url;
+    return std::unique_ptr<RemoteModel>(new RemoteModel(config, std::move(client)));
+}
+
+tritonrt::RemoteModel::RemoteModel(const RemoteConfig & config, std::unique_ptr<tc::InferenceServerGrpcClient> client) :
+    fConfig(config),
+    fClient(std::move(client))
+{
+}
+
+tritonrt::RemoteModel::~RemoteModel()
+{
+    if (fNCalls > 0)
+    {
+        mf::LogInfo("RemoteModel") << fConfig.modelName << " on " << fConfig.url << ": " << fNCalls << " calls, "
+                                   << fNFailedCalls << " failed, " << fNRetries << " retries, " << fTotalTime << " s, "
+                                   << 1000. * fTotalTime / fNCalls << " ms/call" << (fGivenUp ? ", server given up" : "");
+    }
+}
+
+bool tritonrt::RemoteModel::Available() const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return !fGivenUp;
+}
+
+bool tritonrt::RemoteModel::Infer(const std::vector<Input> & inputs, const std::vector<std::string> & outputNames,
+                                  std::vector<Output> & outputs)
+{
+    // The gRPC client is used by one request at a time
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fGivenUp) { return false; }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    std::string error;
+    for (unsigned int attempt = 0; attempt <= fConfig.retries && !ok; ++attempt)
+    {
+        if (attempt > 0) { ++fNRetries; }
+        ok = TryInfer(inputs, outputNames, outputs, error);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    ++fNCalls;
+    fTotalTime += elapsed.count();
+    if (ok)
+    {
+        fNConsecutiveFailures = 0;
+        return true;
+    }
+
+    ++fNFailedCalls;
+    ++fNConsecutiveFailures;
+    mf::LogWarning("RemoteModel") << fConfig.modelName << ": request failed after " << fConfig.retries + 1
+                                  << " attempts, " << error;
+    if (fConfig.maxFailedBatches > 0 && fNConsecutiveFailures >= fConfig.maxFailedBatches)
+    {
+        fGivenUp = true;
+        mf::LogWarning("RemoteModel") << fConfig.modelName << ": " << fNConsecutiveFailures
+                                      << " failed requests in a row, not using " << fConfig.url << " any more";
+    }
+    return false;
+}
+
+bool tritonrt::RemoteModel::TryInfer(const std::vector<Input> & inputs, const std::vector<std::string> & outputNames,
+                                     std::vector<Output> & outputs, std::string & error)
+{
+    std::vector< std::unique_ptr<tc::InferInput> > ownedInputs;
+    std::vector<tc::InferInput*> requestInputs;
+    for (auto const & input : inputs)
+    {
+        tc::InferInput* inferInput = nullptr;
+        tc::Error err = tc::InferInput::Create(&inferInput, input.name, input.shape, "FP32");
+        if (!err.IsOk()) { error = err.Message(); return false; }
+        ownedInputs.emplace_back(inferInput);
+
+        const size_t size = std::accumulate(input.shape.begin(), input.shape.end(), (int64_t)1, std::multiplies<int64_t>());
+        err = inferInput->AppendRaw(reinterpret_cast<const uint8_t*>(input.data), size * sizeof(float));
+        if (!err.IsOk()) { error = err.Message(); return false; }
+        requestInputs.push_back(inferInput);
+    }
+
+    std::vector< std::unique_ptr<tc::InferRequestedOutput> > ownedOutputs;
+    std::vector<const tc::InferRequestedOutput*> requestOutputs;
+    for (auto const & name : outputNames)
+    {
+        tc::InferRequestedOutput* inferOutput = nullptr;
+        tc::Error err = tc::InferRequestedOutput::Create(&inferOutput, name);
+        if (!err.IsOk()) { error = err.Message(); return false; }
+        ownedOutputs.emplace_back(inferOutput);
+        requestOutputs.push_back(inferOutput);
+    }
+
+    tc::InferOptions options(fConfig.modelName);
+    options.model_version_ = fConfig.modelVersion;
+    options.client_timeout_ = fConfig.timeoutMicroseconds;
+
+    tc::InferResult* rawResult = nullptr;
+    tc::Error err = fClient->Infer(&rawResult, options, requestInputs, requestOutputs);
+    std::unique_ptr<tc::InferResult> result(rawResult);
+    if (!err.IsOk()) { error = err.Message(); return false; }
+    err = result->RequestStatus();
+    if (!err.IsOk()) { error = err.Message(); return false; }
+
+    outputs.clear();
+    for (auto const & name : outputNames)
+    {
+        Output output;
+        output.name = name;
+        err = result->Shape(name, &output.shape);
+        if (!err.IsOk()) { error = err.Message(); return false; }
+
+        const uint8_t* buffer = nullptr;
+        size_t bytes = 0;
+        err = result->RawData(name, &buffer, &bytes);
+        if (!err.IsOk()) { error = err.Message(); return false; }
+
+        const float* values = reinterpret_cast<const float*>(buffer);
+        output.values.assign(values, values + bytes / sizeof(float));
+        outputs.push_back(std::move(output));
+    }
+    return true;
+}
+// -------------------------------------------------------------------
+
+std::vector< std::vector< std::vector<float> > > tritonrt::SplitSamples(const std::vector<Output> & outputs)
+{
+    std::vector< std::vector< std::vector<float> > > result;
+    if (outputs.empty() || outputs.front().shape.empty()) { return result; }
+
+    const size_t samples = outputs.front().shape.front();
+    for (auto const & output : outputs)
+    {
+        if (output.shape.empty() || (size_t)output.shape.front() != samples) { return result; }
+        if (samples > 0 && output.values.size() % samples != 0) { return result; }
+    }
+
+    result.resize(samples, std::vector< std::vector<float> >(outputs.size()));
+    for (size_t o = 0; o < outputs.size(); ++o)
+    {
+        const size_t n = samples > 0 ? outputs[o].values.size() / samples : 0;
+        for (size_t s = 0; s < samples; ++s)
+        {
+            auto first = outputs[o].values.begin() + s * n;
+            result[s][o].assign(first, first + n);
+        }
+    }
+    return result;
+}
+// -------------------------------------------------------------------
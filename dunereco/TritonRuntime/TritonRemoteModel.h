@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       RemoteConfig, RemoteModel
+////
+//// Client of a network served by an inference server (NVIDIA Triton) over
+//// gRPC, used by the dunereco network wrappers in place of, or in front of,
+//// their local session. Every request has a timeout and is retried; a
+//// wrapper falls back to its local session when Infer returns false. After
+//// maxFailedBatches consecutive failed requests the server is given up for
+//// the rest of the job, so an unreachable server costs a few timeouts and
+//// not one per event. Statistics are printed when the client is released.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRITON_REMOTE_MODEL_H
+#define TRITON_REMOTE_MODEL_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fhicl
+{
+    class ParameterSet;
+}
+
+namespace triton
+{
+    namespace client
+    {
+        class InferenceServerGrpcClient;
+    }
+}
+
+namespace tritonrt
+{
+
+struct RemoteConfig
+{
+    std::string url;                        ///< gRPC endpoint, host:port
+    std::string modelName;
+    std::string modelVersion = "";          ///< "" = the version the server picks
+    unsigned int timeoutMicroseconds = 0;   ///< per request, 0 = no timeout
+    unsigned int retries = 1;               ///< further attempts after a failed request
+    unsigned int maxFailedBatches = 3;      ///< consecutive failed requests before the server is given up, 0 = never
+    bool verbose = false;                   ///< log the gRPC traffic
+};
+
+/// Read Url and ModelName, and optionally ModelVersion, TimeoutMicroseconds,
+/// Retries, MaxFailedBatches and Verbose, from a handler's server table
+RemoteConfig ReadRemoteConfig(const fhicl::ParameterSet & pset);
+
+struct Input
+{
+    std::string name;
+    std::vector<int64_t> shape;
+    const float * data;                     ///< row major, the product of the shape
+};
+
+struct Output
+{
+    std::string name;
+    std::vector<int64_t> shape;
+    std::vector<float> values;
+};
+
+class RemoteModel
+{
+public:
+    /// Connect and check the model is ready on the server. Returns nullptr on failure.
+    static std::unique_ptr<RemoteModel> Create(const RemoteConfig & config);
+    ~RemoteModel();
+
+    RemoteModel(const RemoteModel&) = delete;
+    RemoteModel& operator=(const RemoteModel&) = delete;
+
+    /// Run the model on FP32 inputs and fetch the named FP32 outputs, in the
+    /// order of the names. Returns false if every attempt failed
+    bool Infer(const std::vector<Input> & inputs, const std::vector<std::string> & outputNames,
+               std::vector<Output> & outputs);
+
+    /// False once the server has been given up
+    bool Available() const;
+
+    const RemoteConfig & Config() const { return fConfig; }
+
+private:
+    RemoteModel(const RemoteConfig & config, std::unique_ptr<triton::client::InferenceServerGrpcClient> client);
+
+    /// One attempt, with the error message on failure
+    bool TryInfer(const std::vector<Input> & inputs, const std::vector<std::string> & outputNames,
+                  std::vector<Output> & outputs, std::string & error);
+
+    RemoteConfig fConfig;
+    std::unique_ptr<triton::client::InferenceServerGrpcClient> fClient;
+
+    mutable std::mutex fMutex;
+    unsigned int fNConsecutiveFailures = 0;
+    bool fGivenUp = false;
+    unsigned long fNCalls = 0;
+    unsigned long fNFailedCalls = 0;
+    unsigned long fNRetries = 0;
+    double fTotalTime = 0.;
+};
+
+/// Regroup the batched outputs of a request per sample: result[sample][output]
+/// holds the values of that output for the sample. Empty if the outputs don't
+/// share their first (batch) dimension
+std::vector< std::vector< std::vector<float> > > SplitSamples(const std::vector<Output> & outputs);
+
+} // namespace tritonrt
+
+#endif
@@ -9,6 +9,7 @@
 #include "dunereco/VLNets/art/var_extractors/EventMCVarExtractor.h"
 #include "dunereco/VLNets/art/var_extractors/FiducialCutVarExtractor.h"
 #include "dunereco/VLNets/data/exporters/CSVExporter.h"
+#include "dunereco/VLNets/data/exporters/HDF5Exporter.h"
 
 #include "utils.h"
 
@@ -40,7 +41,7 @@ private:
     FiducialCutVarExtractor  fiducialCutVarExtractor;
 
     VarDict vars;
-    std::unique_ptr<CSVExporter> exporter;
+    std::unique_ptr<Exporter> exporter;
 };
 
 VLNEnergyDataGen::VLNEnergyDataGen(const fhicl::ParameterSet &pset)
@@ -74,6 +75,9 @@ void VLNEnergyDataGen::respondToOpenInputFile(const art::FileBlock& fb)
         exporter = std::make_unique<CSVExporter>(filename);
         exporter->setPrecision(precision);
         break;
+    case Format::HDF5:
+        exporter = std::make_unique<HDF5Exporter>(filename);
+        break;
     }
 }
 
@@ -81,27 +85,27 @@ bool VLNEnergyDataGen::passesCut(const art::Event &evt, const VarDict &vars)
 {
     if (
            (flavor != Flavor::Any)
-        && (std::abs(vars.scalar.at("mc.pdg")) != static_cast<int>(flavor))
+        && (std::abs(vars.scalarAt("mc.pdg")) != static_cast<int>(flavor))
     ) {
         return false;
     }
 
-    if ((isCC >= 0) && (vars.scalar.at("mc.isCC") != isCC)) {
+    if ((isCC >= 0) && (vars.scalarAt("mc.isCC") != isCC)) {
         return false;
     }
 
-    if (applyFiducialCut && (vars.scalar.at("mc.vtxContain") != 1)) {
+    if (applyFiducialCut && (vars.scalarAt("mc.vtxContain") != 1)) {
         return false;
     }
 
-    if ((maxEnergy > 0) && (vars.scalar.at("mc.nuE") > maxEnergy)) {
+    if ((maxEnergy > 0) && (vars.scalarAt("mc.nuE") > maxEnergy)) {
         return false;
     }
 
     /* TODO: find proper way to check containment for non numu events */
     if (
            (flavor == Flavor::NuMu)
-        && (vars.scalar.at("numue.longestTrackContained") != 1)
+        && (vars.scalarAt("numue.longestTrackContained") != 1)
     ) {
         return false;
     }
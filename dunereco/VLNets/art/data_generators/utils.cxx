@@ -27,8 +27,12 @@ Format parseFormat(const std::string &formatStr)
         return Format::CSV;
     }
 
+    if (formatStr == "hdf5") {
+        return Format::HDF5;
+    }
+
     throw std::invalid_argument(
-        "Unknown format: " + formatStr + ". Supported Formats: 'csv'"
+        "Unknown format: " + formatStr + ". Supported Formats: 'csv', 'hdf5'"
     );
 }
 
@@ -46,6 +50,8 @@ std::string convertFilename(
     switch (format) {
     case Format::CSV:
         return filename + ".csv";
+    case Format::HDF5:
+        return filename + ".h5";
     default:
         throw std::invalid_argument("Unknown format");
     }
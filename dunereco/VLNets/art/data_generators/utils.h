@@ -4,7 +4,7 @@
 namespace VLN {
 
 enum class Flavor : int { Any = 0, NuMu = 14 };
-enum class Format { CSV };
+enum class Format { CSV, HDF5 };
 
 Flavor parseFlavor(const std::string &flavStr);
 Format parseFormat(const std::string &formatStr);
@@ -5,6 +5,7 @@
 #include "dunereco/VLNets/art/var_extractors/DefaultInputVarExtractor.h"
 #include "dunereco/VLNets/art/data_generators/utils.h"
 #include "dunereco/VLNets/data/exporters/CSVExporter.h"
+#include "dunereco/VLNets/data/exporters/HDF5Exporter.h"
 #include "dunereco/VLNets/models/zoo/VLNEnergyModel.h"
 
 namespace VLN {
@@ -16,23 +17,40 @@ public:
 
     void analyze(const art::Event &evt) override;
     void respondToOpenInputFile(const art::FileBlock &fb) override;
+    void respondToCloseInputFile(const art::FileBlock &fb) override;
+    void endJob() override;
+
+private:
+    void exportEnergy(VarDict &vars, const VLNEnergy &energy);
+    void flushBatch();
 
 private:
     Format format;
     int    precision;
+    size_t batchSize;
 
     DefaultInputVarExtractor inputVarExtractor;
     VLNEnergyModel model;
 
     VarDict vars;
-    std::unique_ptr<CSVExporter> exporter;
+    std::unique_ptr<Exporter> exporter;
+
+    /*
+     * With batchSize > 1 the events are extracted into their own
+     * dictionaries and predicted together once batchSize of them are
+     * buffered, or at the end of each input file
+     */
+    std::vector<std::unique_ptr<VarDict>> batch;
+    size_t nBuffered;
 };
 
 VLNEnergyAnalyzer::VLNEnergyAnalyzer(const fhicl::ParameterSet &pset)
   : EDAnalyzer(pset),
     precision(pset.get<int>("OutputPrecision")),
+    batchSize(pset.get<size_t>("BatchSize", 1)),
     inputVarExtractor("", pset.get<fhicl::ParameterSet>("ConfigInputVars")),
-    model(pset.get<std::string>("ModelPath"))
+    model(pset.get<std::string>("ModelPath")),
+    nBuffered(0)
 {
     format = parseFormat(pset.get<std::string>("OutputFormat"));
 }
@@ -46,22 +64,71 @@ void VLNEnergyAnalyzer::respondToOpenInputFile(const art::FileBlock& fb)
         exporter = std::make_unique<CSVExporter>(filename);
         exporter->setPrecision(precision);
         break;
+    case Format::HDF5:
+        exporter = std::make_unique<HDF5Exporter>(filename);
+        break;
     }
 }
 
-void VLNEnergyAnalyzer::analyze(const art::Event &evt)
+void VLNEnergyAnalyzer::respondToCloseInputFile(const art::FileBlock &)
 {
-    inputVarExtractor.extract(evt, vars);
+    flushBatch();
+}
 
-    const VLNEnergy energy = model.predict(vars);
+void VLNEnergyAnalyzer::endJob()
+{
+    flushBatch();
+}
 
-    vars.scalar["vln.energy.totalE"]     = energy.totalE;
-    vars.scalar["vln.energy.primaryE"]   = energy.primaryE;
-    vars.scalar["vln.energy.secondaryE"] = energy.totalE - energy.primaryE;
+void VLNEnergyAnalyzer::exportEnergy(VarDict &vars, const VLNEnergy &energy)
+{
+    vars.scalar(vars.scalarKey("vln.energy.totalE"))     = energy.totalE;
+    vars.scalar(vars.scalarKey("vln.energy.primaryE"))   = energy.primaryE;
+    vars.scalar(vars.scalarKey("vln.energy.secondaryE")) = energy.totalE - energy.primaryE;
 
     exporter->exportVars(vars);
 }
 
+void VLNEnergyAnalyzer::flushBatch()
+{
+    if (nBuffered == 0) {
+        return;
+    }
+
+    std::vector<const VarDict*> dicts;
+    for (size_t i = 0; i < nBuffered; i++) {
+        dicts.push_back(batch[i].get());
+    }
+
+    const std::vector<VLNEnergy> energies = model.predict(dicts);
+
+    for (size_t i = 0; i < nBuffered; i++) {
+        exportEnergy(*batch[i], energies[i]);
+    }
+
+    nBuffered = 0;
+}
+
+void VLNEnergyAnalyzer::analyze(const art::Event &evt)
+{
+    if (batchSize <= 1)
+    {
+        inputVarExtractor.extract(evt, vars);
+        exportEnergy(vars, model.predict(vars));
+        return;
+    }
+
+    if (batch.size() <= nBuffered) {
+        batch.push_back(std::make_unique<VarDict>());
+    }
+
+    inputVarExtractor.extract(evt, *batch[nBuffered]);
+
+    if (++nBuffered >= batchSize) {
+        flushBatch();
+    }
+}
+
 DEFINE_ART_MODULE(VLNEnergyAnalyzer)
 
 }
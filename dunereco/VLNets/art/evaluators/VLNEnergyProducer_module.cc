@@ -1,33 +1,59 @@
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "lardataobj/RecoBase/PFParticle.h"
 
+#include "dunereco/AnaUtils/DUNEAnaProductReuse.h"
 #include "dunereco/VLNets/art/var_extractors/DefaultInputVarExtractor.h"
 #include "dunereco/VLNets/models/zoo/VLNEnergyModel.h"
 
 namespace VLN {
 
-class VLNEnergyProducer : public art::EDProducer
+/*
+ * The extractor and the model are bound to the one `VarDict` they fill and
+ * read, so the events go through this module one at a time. Being a shared
+ * module it still runs alongside the other modules of the other schedules.
+ */
+class VLNEnergyProducer : public art::SharedProducer
 {
 public:
-    explicit VLNEnergyProducer(const fhicl::ParameterSet &pset);
-    void produce(art::Event &evt) override;
+    explicit VLNEnergyProducer(
+        const fhicl::ParameterSet &pset, const art::ProcessingFrame &
+    );
+    void produce(art::Event &evt, const art::ProcessingFrame &) override;
 
 private:
     DefaultInputVarExtractor inputVarExtractor;
     VLNEnergyModel model;
     VarDict vars;
+    /* Forwards the energies of an earlier pass made with the same model */
+    dune_ana::DUNEAnaProductReuse reuse;
 };
 
-VLNEnergyProducer::VLNEnergyProducer(const fhicl::ParameterSet &pset)
-  : EDProducer(pset),
+VLNEnergyProducer::VLNEnergyProducer(
+    const fhicl::ParameterSet &pset, const art::ProcessingFrame &
+)
+  : SharedProducer(pset),
     inputVarExtractor("", pset.get<fhicl::ParameterSet>("ConfigInputVars")),
-    model(pset.get<std::string>("ModelPath"))
+    model(pset.get<std::string>("ModelPath")),
+    reuse(pset)
 {
+    const fhicl::ParameterSet inputVars = pset.get<fhicl::ParameterSet>("ConfigInputVars");
+    reuse.AddInput<std::vector<recob::Hit>>(inputVars.get<std::string>("LabelHit"));
+    reuse.AddInput<std::vector<recob::PFParticle>>(inputVars.get<std::string>("LabelPFPModule"));
+
     produces<VLNEnergy>();
+
+    serialize<art::InEvent>();
 }
 
-void VLNEnergyProducer::produce(art::Event &evt)
+void VLNEnergyProducer::produce(art::Event &evt, const art::ProcessingFrame &)
 {
+    if (reuse.Matches<VLNEnergy>(evt)) {
+        reuse.Forward<VLNEnergy>(evt);
+        return;
+    }
+
     inputVarExtractor.extract(evt, vars);
     VLNEnergy energy = model.predict(vars);
 
@@ -37,4 +63,3 @@ void VLNEnergyProducer::produce(art::Event &evt)
 DEFINE_ART_MODULE(VLNEnergyProducer)
 
 }
-
@@ -2,6 +2,12 @@
 
 namespace VLN {
 
+namespace {
+
+enum ScalarVar { RUN, SUB_RUN, EVENT };
+
+}
+
 static const std::vector<std::string> SCALAR_VARS({
     "run", "subRun", "event"
 });
@@ -14,9 +20,9 @@ EventAddrVarExtractor::EventAddrVarExtractor(const std::string &prefix)
 
 void EventAddrVarExtractor::extractVars(const art::Event &evt, VarDict &vars)
 {
-    setScalarVar(vars, "run",    evt.id().run());
-    setScalarVar(vars, "subRun", evt.id().subRun());
-    setScalarVar(vars, "event",  evt.id().event());
+    setScalarVar(vars, RUN,     evt.id().run());
+    setScalarVar(vars, SUB_RUN, evt.id().subRun());
+    setScalarVar(vars, EVENT,   evt.id().event());
 }
 
 }
@@ -4,6 +4,12 @@
 
 namespace VLN {
 
+namespace {
+
+enum ScalarVar { IS_CC, PDG, MODE, LEP_PDG, NU_E, LEP_E, HAD_E };
+
+}
+
 static const std::vector<std::string> SCALAR_VARS({
     "isCC", "pdg", "mode", "lepPdg", "nuE", "lepE", "hadE"
 });
@@ -31,17 +37,17 @@ void EventMCVarExtractor::extractVars(const art::Event &evt, VarDict &vars)
 
     const auto &nuInt = mcTruth[0].GetNeutrino();
 
-    setScalarVar(vars, "isCC",   (nuInt.CCNC() == 0));
-    setScalarVar(vars, "pdg",    nuInt.Nu().PdgCode());
-    setScalarVar(vars, "mode",   nuInt.Mode());
-    setScalarVar(vars, "lepPdg", nuInt.Lepton().PdgCode());
+    setScalarVar(vars, IS_CC,   (nuInt.CCNC() == 0));
+    setScalarVar(vars, PDG,     nuInt.Nu().PdgCode());
+    setScalarVar(vars, MODE,    nuInt.Mode());
+    setScalarVar(vars, LEP_PDG, nuInt.Lepton().PdgCode());
 
     const double nuE  = nuInt.Nu().E();
     const double lepE = nuInt.Lepton().Momentum().T();
 
-    setScalarVar(vars, "nuE",  nuE);
-    setScalarVar(vars, "lepE", lepE);
-    setScalarVar(vars, "hadE", nuE - lepE);
+    setScalarVar(vars, NU_E,  nuE);
+    setScalarVar(vars, LEP_E, lepE);
+    setScalarVar(vars, HAD_E, nuE - lepE);
 }
 
 }
@@ -4,6 +4,12 @@
 
 namespace VLN {
 
+namespace {
+
+enum ScalarVar { NU_E, LEP_E, HAD_E, LONGEST_TRACK_CONTAINED };
+
+}
+
 static const std::vector<std::string> SCALAR_VARS({
     "nuE", "lepE", "hadE", "longestTrackContained"
 });
@@ -25,11 +31,11 @@ void EventRecoEVarExtractor::extractVars(const art::Event &evt, VarDict &vars)
         return;
     }
 
-    setScalarVar(vars, "nuE",  recoE_h->fNuLorentzVector.E());
-    setScalarVar(vars, "lepE", recoE_h->fLepLorentzVector.E());
-    setScalarVar(vars, "hadE", recoE_h->fHadLorentzVector.E());
+    setScalarVar(vars, NU_E,  recoE_h->fNuLorentzVector.E());
+    setScalarVar(vars, LEP_E, recoE_h->fLepLorentzVector.E());
+    setScalarVar(vars, HAD_E, recoE_h->fHadLorentzVector.E());
     setScalarVar(
-        vars, "longestTrackContained", recoE_h->longestTrackContained
+        vars, LONGEST_TRACK_CONTAINED, recoE_h->longestTrackContained
     );
 }
 
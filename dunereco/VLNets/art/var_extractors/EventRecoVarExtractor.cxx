@@ -8,6 +8,12 @@
 
 namespace VLN {
 
+namespace {
+
+enum ScalarVar { CAL_E, CHARGE, N_HITS };
+
+}
+
 static const std::vector<std::string> SCALAR_VARS({
     "calE", "charge", "nHits"
 });
@@ -37,9 +43,9 @@ void EventRecoVarExtractor::extractVars(const art::Event &evt, VarDict &vars)
         hits, evt, algCalorimetry, plane
     );
 
-    setScalarVar(vars, "charge", chargeCalE.first);
-    setScalarVar(vars, "calE",   chargeCalE.second);
-    setScalarVar(vars, "nHits",  hits.size());
+    setScalarVar(vars, CHARGE, chargeCalE.first);
+    setScalarVar(vars, CAL_E,  chargeCalE.second);
+    setScalarVar(vars, N_HITS, hits.size());
 }
 
 }
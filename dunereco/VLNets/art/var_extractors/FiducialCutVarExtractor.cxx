@@ -3,6 +3,12 @@
 
 namespace VLN {
 
+namespace {
+
+enum ScalarVar { VTX_CONTAIN };
+
+}
+
 static const std::vector<std::string> SCALAR_VARS({ "vtxContain" });
 static const std::vector<std::string> VECTOR_VARS({});
 
@@ -37,7 +43,7 @@ void FiducialCutVarExtractor::extractVars(const art::Event &evt, VarDict &vars)
     auto vtxY = nu.Nu().Vy();
     auto vtxZ = nu.Nu().Vz();
 
-    setScalarVar(vars, "vtxContain",
+    setScalarVar(vars, VTX_CONTAIN,
         (
                (std::abs(vtxX) < containVolMaxX)
             && (std::abs(vtxY) < containVolMaxY)
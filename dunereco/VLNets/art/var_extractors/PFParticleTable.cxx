@@ -0,0 +1,162 @@
+#include "PFParticleTable.h"
+
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "lardataobj/RecoBase/PFParticle.h"
+#include "dunereco/AnaUtils/DUNEAnaEventUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaPFParticleUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaShowerUtils.h"
+#include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
+
+#include "utils.h"
+
+namespace VLN {
+
+PFParticleTable::PFParticleTable(
+    const art::Event     &evt,
+    calo::CalorimetryAlg &algCalorimetry,
+    const std::string    &labelPFPModule,
+    const std::string    &labelPFPTrack,
+    const std::string    &labelPFPShower,
+    unsigned int         plane
+)
+{
+    using namespace dune_ana;
+
+    const auto clockData =
+        art::ServiceHandle<const detinfo::DetectorClocksService>()
+            ->DataFor(evt);
+
+    const auto detProp =
+        art::ServiceHandle<const detinfo::DetectorPropertiesService>()
+            ->DataFor(evt, clockData);
+
+    const std::vector<art::Ptr<recob::PFParticle>> particles
+        = DUNEAnaEventUtils::GetPFParticles(evt, labelPFPModule);
+
+    particleRows.reserve(particles.size());
+
+    for (const auto &particle : particles)
+    {
+        const bool isTrack = DUNEAnaPFParticleUtils::IsTrack(
+            particle, evt, labelPFPModule, labelPFPTrack
+        );
+
+        const bool isShower = DUNEAnaPFParticleUtils::IsShower(
+            particle, evt, labelPFPModule, labelPFPShower
+        );
+
+        if (isTrack == isShower) {
+            continue;
+        }
+
+        Row row;
+        std::vector<art::Ptr<recob::Hit>> hits;
+
+        if (isShower) {
+            auto shower = DUNEAnaPFParticleUtils::GetShower(
+                particle, evt, labelPFPModule, labelPFPShower
+            );
+            auto start  = shower->ShowerStart();
+            auto dir    = shower->Direction();
+            auto energy = shower->Energy();
+
+            row.isShower = true;
+            row.length   = shower->Length();
+            row.start[0] = start.x();
+            row.start[1] = start.y();
+            row.start[2] = start.z();
+            row.dir[0]   = dir.x();
+            row.dir[1]   = dir.y();
+            row.dir[2]   = dir.z();
+            row.energy   = (energy.size() < plane + 1) ? 0 : energy[plane];
+
+            hits = DUNEAnaShowerUtils::GetHits(shower, evt, labelPFPShower);
+        }
+        else {
+            auto track = DUNEAnaPFParticleUtils::GetTrack(
+                particle, evt, labelPFPModule, labelPFPTrack
+            );
+            auto start = track->Start();
+            auto dir   = track->StartDirection();
+
+            row.isShower = false;
+            row.length   = track->Length();
+            row.start[0] = start.x();
+            row.start[1] = start.y();
+            row.start[2] = start.z();
+            row.dir[0]   = dir.x();
+            row.dir[1]   = dir.y();
+            row.dir[2]   = dir.z();
+            row.energy   = track->StartMomentum();
+
+            hits = DUNEAnaTrackUtils::GetHits(track, evt, labelPFPTrack);
+        }
+
+        const auto chargeCalE = calcHitsChargeCalE(
+            hits, clockData, detProp, algCalorimetry, plane
+        );
+
+        row.nHit   = hits.size();
+        row.charge = chargeCalE.first;
+        row.calE   = chargeCalE.second;
+
+        particleRows.push_back(row);
+    }
+}
+
+const PFParticleTable &PFParticleTable::get(
+    const art::Event     &evt,
+    calo::CalorimetryAlg &algCalorimetry,
+    const std::string    &labelPFPModule,
+    const std::string    &labelPFPTrack,
+    const std::string    &labelPFPShower,
+    unsigned int         plane
+)
+{
+    using Key = std::tuple<
+        const calo::CalorimetryAlg*, std::string, std::string, std::string,
+        unsigned int
+    >;
+
+    struct Store
+    {
+        art::EventID eventID;
+        const void   *products = nullptr;
+        std::map<Key, std::unique_ptr<const PFParticleTable>> tables;
+    };
+
+    /* Each thread keeps its own tables, as the DUNEAna association cache */
+    thread_local Store store;
+
+    /* The product pointer also catches different events sharing an ID */
+    auto particles_h
+        = evt.getHandle<std::vector<recob::PFParticle>>(labelPFPModule);
+    const void *products = particles_h.isValid() ? particles_h.product()
+                                                 : nullptr;
+
+    if ((store.eventID != evt.id()) || (store.products != products)) {
+        store.tables.clear();
+        store.eventID  = evt.id();
+        store.products = products;
+    }
+
+    auto &table = store.tables[Key(
+        &algCalorimetry, labelPFPModule, labelPFPTrack, labelPFPShower, plane
+    )];
+
+    if (! table) {
+        table = std::make_unique<const PFParticleTable>(
+            evt, algCalorimetry, labelPFPModule, labelPFPTrack,
+            labelPFPShower, plane
+        );
+    }
+
+    return *table;
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "art/Framework/Principal/Event.h"
+#include "larreco/Calorimetry/CalorimetryAlg.h"
+
+namespace VLN {
+
+/*
+ * Per event table of the reconstructed PFParticles that are either a track
+ * or a shower, in collection order. Each particle's track or shower, hits and
+ * calorimetry are looked up once, and every extractor reading the same
+ * labels in the same event reuses the table through `get`.
+ */
+class PFParticleTable
+{
+public:
+    struct Row
+    {
+        bool         isShower;
+        double       length;
+        double       start[3];
+        double       dir[3];
+        double       energy;
+        unsigned int nHit;
+        double       charge;
+        double       calE;
+    };
+
+    PFParticleTable(
+        const art::Event     &evt,
+        calo::CalorimetryAlg &algCalorimetry,
+        const std::string    &labelPFPModule,
+        const std::string    &labelPFPTrack,
+        const std::string    &labelPFPShower,
+        unsigned int         plane
+    );
+
+    /*
+     * Table of the event, built on the first call for these labels and
+     * reused until the thread moves on to another event.
+     */
+    static const PFParticleTable &get(
+        const art::Event     &evt,
+        calo::CalorimetryAlg &algCalorimetry,
+        const std::string    &labelPFPModule,
+        const std::string    &labelPFPTrack,
+        const std::string    &labelPFPShower,
+        unsigned int         plane = 2
+    );
+
+    const std::vector<Row> &rows() const { return particleRows; }
+
+private:
+    std::vector<Row> particleRows;
+};
+
+}
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "lardataobj/RecoBase/PFParticle.h"
 #include "larreco/Calorimetry/CalorimetryAlg.h"
 #include "VarExtractorBase.h"
 
@@ -23,25 +22,6 @@ public:
 protected:
     void extractVars(const art::Event &evt, VarDict &vars) override;
 
-private:
-    void extractShowerVars(
-        const art::Event                  &evt,
-        const art::Ptr<recob::PFParticle> &particle,
-        VarDict                           &vars
-    );
-
-    void extractTrackVars(
-        const art::Event                  &evt,
-        const art::Ptr<recob::PFParticle> &particle,
-        VarDict                           &vars
-    );
-
-    void extractBasicVars(
-        const art::Event                        &evt,
-        const std::vector<art::Ptr<recob::Hit>> &hits,
-        VarDict                                 &vars
-    );
-
 private:
     calo::CalorimetryAlg &algCalorimetry;
     std::string          labelPFPModule;
@@ -3,6 +3,12 @@
 
 namespace VLN {
 
+namespace {
+
+enum ScalarVar { PRIMARY_E, TOTAL_E };
+
+}
+
 static const std::vector<std::string> SCALAR_VARS({ "primaryE", "totalE" });
 static const std::vector<std::string> VECTOR_VARS({});
 
@@ -21,8 +27,8 @@ void VLNEnergyVarExtractor::extractVars(const art::Event &evt, VarDict &vars)
         return;
     }
 
-    setScalarVar(vars, "primaryE", vlnEnergy_h->primaryE);
-    setScalarVar(vars, "totalE",   vlnEnergy_h->totalE);
+    setScalarVar(vars, PRIMARY_E, vlnEnergy_h->primaryE);
+    setScalarVar(vars, TOTAL_E,   vlnEnergy_h->totalE);
 }
 
 }
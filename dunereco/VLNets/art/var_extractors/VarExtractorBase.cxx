@@ -7,57 +7,50 @@ VarExtractorBase::VarExtractorBase(
     const std::string &prefix,
     const std::vector<std::string> &scalarVars,
     const std::vector<std::string> &vectorVars
-) : prefix(prefix), scalarVars(scalarVars), vectorVars(vectorVars)
+) : prefix(prefix), scalarVars(scalarVars), vectorVars(vectorVars),
+    boundDictId(0)
 { }
 
-void VarExtractorBase::setScalarVar(
-    VarDict &vars, const std::string &name, double value
-) const
+void VarExtractorBase::bindKeys(VarDict &vars)
 {
-    vars.scalar[prefix + name] = value;
-}
+    scalarKeys.clear();
+    vectorKeys.clear();
 
-void VarExtractorBase::appendToVectorVar(
-    VarDict &vars, const std::string &name, double value
-) const
-{
-    vars.vector[prefix + name].push_back(value);
+    for (auto &name : scalarVars) {
+        scalarKeys.push_back(vars.scalarKey(prefix + name));
+    }
+
+    for (auto &name : vectorVars) {
+        vectorKeys.push_back(vars.vectorKey(prefix + name));
+    }
+
+    boundDictId = vars.id();
 }
 
-void VarExtractorBase::initScalarVars(
-    VarDict &vars, const std::vector<std::string> &names
-) const
+void VarExtractorBase::initScalarVars(VarDict &vars) const
 {
-    for (auto &name : names) {
-        vars.scalar[prefix + name] = -1;
+    for (auto key : scalarKeys) {
+        vars.scalar(key) = -1;
     }
 }
 
-void VarExtractorBase::initVectorVars(
-    VarDict &vars, const std::vector<std::string> &names
-) const
+void VarExtractorBase::initVectorVars(VarDict &vars) const
 {
-    for (auto &name : names) {
-        const std::string fullname = prefix + name;
-
-        auto it = vars.vector.find(fullname);
-
-        if (it != vars.vector.end()) {
-            it->second.clear();
-        }
-        else {
-            vars.vector[fullname] = {};
-        }
+    for (auto key : vectorKeys) {
+        vars.vector(key).clear();
     }
 }
 
 void VarExtractorBase::extract(const art::Event &evt, VarDict &vars)
 {
-    initScalarVars(vars, scalarVars);
-    initVectorVars(vars, vectorVars);
+    if (vars.id() != boundDictId) {
+        bindKeys(vars);
+    }
+
+    initScalarVars(vars);
+    initVectorVars(vars);
 
     extractVars(evt, vars);
 }
 
 }
-
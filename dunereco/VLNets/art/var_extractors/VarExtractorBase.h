@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -8,6 +9,11 @@
 
 namespace VLN {
 
+/*
+ * Variables are addressed by their index in the `scalarVars`/`vectorVars`
+ * lists given to the constructor. The prefixed names are interned into the
+ * `VarDict` on the first `extract` into it, later events only use the slots.
+ */
 class VarExtractorBase
 {
 public:
@@ -22,28 +28,32 @@ public:
 protected:
     virtual void extractVars(const art::Event &evt, VarDict &vars) = 0;
 
-    void setScalarVar(
-        VarDict &vars, const std::string &name, double value
-    ) const;
+    void setScalarVar(VarDict &vars, unsigned int var, double value) const
+    {
+        vars.scalar(scalarKeys[var]) = value;
+    }
 
-    void appendToVectorVar(
-        VarDict &vars, const std::string &name, double value
-    ) const;
+    void appendToVectorVar(VarDict &vars, unsigned int var, float value) const
+    {
+        vars.vector(vectorKeys[var]).push_back(value);
+    }
 
-    void initScalarVars(
-        VarDict &vars, const std::vector<std::string> &names
-    ) const;
+    void initScalarVars(VarDict &vars) const;
+    void initVectorVars(VarDict &vars) const;
 
-    void initVectorVars(
-        VarDict &vars, const std::vector<std::string> &names
-    ) const;
+private:
+    void bindKeys(VarDict &vars);
 
 protected:
     std::string prefix;
 
     std::vector<std::string> scalarVars;
     std::vector<std::string> vectorVars;
+
+private:
+    std::uint64_t             boundDictId;
+    std::vector<VarDict::Key> scalarKeys;
+    std::vector<VarDict::Key> vectorKeys;
 };
 
 }
-
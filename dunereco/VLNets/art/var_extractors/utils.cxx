@@ -22,6 +22,17 @@ std::pair<double, double> calcHitsChargeCalE(
         art::ServiceHandle<const detinfo::DetectorPropertiesService>()
             ->DataFor(evt, clockData);
 
+    return calcHitsChargeCalE(hits, clockData, detProp, algCalorimetry, plane);
+}
+
+std::pair<double, double> calcHitsChargeCalE(
+    const std::vector<art::Ptr<recob::Hit>> &hits,
+    const detinfo::DetectorClocksData       &clockData,
+    const detinfo::DetectorPropertiesData   &detProp,
+    calo::CalorimetryAlg                    &algCalorimetry,
+    unsigned int                            plane
+)
+{
     const double charge =
         dune_ana::DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(
             clockData, detProp, hits
@@ -4,6 +4,8 @@
 #include <vector>
 
 #include "art/Framework/Principal/Event.h"
+#include "lardataalg/DetectorInfo/DetectorClocksData.h"
+#include "lardataalg/DetectorInfo/DetectorPropertiesData.h"
 #include "lardataobj/RecoBase/Hit.h"
 #include "larreco/Calorimetry/CalorimetryAlg.h"
 
@@ -16,5 +18,14 @@ std::pair<double, double> calcHitsChargeCalE(
     unsigned int plane = 2
 );
 
+/* As above, with the detector clocks and properties of the event given */
+std::pair<double, double> calcHitsChargeCalE(
+    const std::vector<art::Ptr<recob::Hit>> &hits,
+    const detinfo::DetectorClocksData       &clockData,
+    const detinfo::DetectorPropertiesData   &detProp,
+    calo::CalorimetryAlg                    &algCalorimetry,
+    unsigned int plane = 2
+);
+
 }
 
@@ -1,84 +1,73 @@
 #include "CSVExporter.h"
 
 #include <algorithm>
-#include <iostream>
-#include <iomanip>
+#include <charconv>
 #include <limits>
 #include <stdexcept>
-#include <functional>
-
-template<typename T, typename S>
-bool printSeparatedValues(
-    std::ostream         &output,
-    const std::vector<T> &values,
-    bool                 firstValuePrinted,
-    S                    separator,
-    std::function<void (std::ostream &, const T&)> printValue
-)
-{
-    if (values.empty()) {
-        return firstValuePrinted;
-    }
-
-    size_t startIdx = 0;
-
-    if (! firstValuePrinted)
-    {
-        printValue(output, values[0]);
-        startIdx = 1;
-    }
-
-    for (size_t i = startIdx; i < values.size(); i++)
-    {
-        output << separator;
-        printValue(output, values[i]);
-    }
-
-    return true;
-}
 
 CSVExporter::CSVExporter(const std::string& output)
-  : ofile(output), initialized(false)
+  : ofile(output),
+    precision(std::numeric_limits<double>::max_digits10),
+    boundDictId(0),
+    initialized(false)
 {
     if (! ofile) {
         throw std::runtime_error("Failed to open output file");
     }
 
-    ofile << std::setprecision(std::numeric_limits<double>::max_digits10);
+    buffer.reserve(2 * FLUSH_SIZE);
+}
+
+CSVExporter::~CSVExporter()
+{
+    flushBuffer();
 }
 
 void CSVExporter::setPrecision(int precision)
 {
-    ofile << std::setprecision(precision);
+    this->precision = precision;
 }
 
-void CSVExporter::printHeader()
+void CSVExporter::flushBuffer()
 {
-    bool firstValuePrinted = false;
+    ofile.write(buffer.data(), buffer.size());
+    ofile.flush();
+    buffer.clear();
+}
 
-    firstValuePrinted = printSeparatedValues<std::string, char>(
-        ofile, scalVarNames, firstValuePrinted, ',',
-        [] (auto &output, const auto &name) { output << name; }
+void CSVExporter::appendValue(double value)
+{
+    /* %g style, as the stream prints with setprecision */
+    char text[64];
+    const auto result = std::to_chars(
+        text, text + sizeof(text), value, std::chars_format::general,
+        precision
     );
+    buffer.append(text, result.ptr);
+}
 
-    printSeparatedValues<std::string, char>(
-        ofile, vectVarNames, firstValuePrinted, ',',
-        [] (auto &output, const auto &name) { output << name; }
-    );
+void CSVExporter::printHeader()
+{
+    bool first = true;
+
+    for (const auto &names : { &scalVarNames, &vectVarNames }) {
+        for (const auto &name : *names) {
+            if (! first) {
+                buffer += ',';
+            }
+            buffer += name;
+            first = false;
+        }
+    }
 
-    ofile << std::endl;
+    buffer += '\n';
 }
 
 void CSVExporter::init(const VarDict &vars)
 {
     if (scalVarNames.empty() && vectVarNames.empty()) {
-        for (const auto &kval : vars.scalar) {
-            scalVarNames.push_back(kval.first);
-        }
-
-        for (const auto &kval : vars.vector) {
-            vectVarNames.push_back(kval.first);
-        }
+        scalVarNames = vars.scalarNames();
+        vectVarNames = vars.vectorNames();
 
         std::sort(scalVarNames.begin(), scalVarNames.end());
         std::sort(vectVarNames.begin(), vectVarNames.end());
@@ -88,6 +77,29 @@ void CSVExporter::init(const VarDict &vars)
     initialized = true;
 }
 
+void CSVExporter::bindKeys(const VarDict &vars)
+{
+    if (vars.id() != boundDictId)
+    {
+        scalVarKeys.assign(scalVarNames.size(), VarDict::NO_KEY);
+        vectVarKeys.assign(vectVarNames.size(), VarDict::NO_KEY);
+        boundDictId = vars.id();
+    }
+
+    /* Names that were missing so far may have been added since */
+    for (size_t i = 0; i < scalVarNames.size(); i++) {
+        if (scalVarKeys[i] == VarDict::NO_KEY) {
+            scalVarKeys[i] = vars.findScalar(scalVarNames[i]);
+        }
+    }
+
+    for (size_t i = 0; i < vectVarNames.size(); i++) {
+        if (vectVarKeys[i] == VarDict::NO_KEY) {
+            vectVarKeys[i] = vars.findVector(vectVarNames[i]);
+        }
+    }
+}
+
 void CSVExporter::addScalarVar(const std::string &name)
 {
     if (! initialized) {
@@ -108,38 +120,50 @@ void CSVExporter::exportVars(const VarDict &vars)
         init(vars);
     }
 
-    bool firstValuePrinted = false;
+    bindKeys(vars);
 
-    firstValuePrinted = printSeparatedValues<std::string, char>(
-        ofile, scalVarNames, firstValuePrinted, ',',
-        [&vars] (auto &output, const auto &name)
-        {
-            auto it = vars.scalar.find(name);
-            if (it != vars.scalar.end()) {
-                output << it->second;
-            }
+    bool first = true;
+
+    for (const auto key : scalVarKeys)
+    {
+        if (! first) {
+            buffer += ',';
         }
-    );
+        first = false;
+
+        if (key != VarDict::NO_KEY) {
+            appendValue(vars.scalar(key));
+        }
+    }
+
+    for (const auto key : vectVarKeys)
+    {
+        if (! first) {
+            buffer += ',';
+        }
+        first = false;
 
-    firstValuePrinted = printSeparatedValues<std::string, char>(
-        ofile, vectVarNames, firstValuePrinted, ',',
-        [&vars] (auto &output, const auto &name)
+        buffer += '"';
+
+        if (key != VarDict::NO_KEY)
         {
-            output << "\"";
-            auto it = vars.vector.find(name);
-
-            if (it != vars.vector.end()) {
-                printSeparatedValues<double, char>(
-                    output, it->second, false, ',',
-                    [] (auto &output, const auto x) { output << x; }
-                );
+            const auto &values = vars.vector(key);
+
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                if (i > 0) {
+                    buffer += ',';
+                }
+                appendValue(values[i]);
             }
-
-            output << "\"";
         }
-    );
 
-    ofile << std::endl;
-}
+        buffer += '"';
+    }
 
+    buffer += '\n';
 
+    if (buffer.size() >= FLUSH_SIZE) {
+        flushBuffer();
+    }
+}
@@ -1,32 +1,53 @@
 #pragma once
 
+#include <cstdint>
 #include <fstream>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
 #include "dunereco/VLNets/data/structs/VarDict.h"
+#include "Exporter.h"
 
-class CSVExporter
+class CSVExporter : public Exporter
 {
 protected:
     std::ofstream ofile;
 
+    /*
+     * Rows are formatted into `buffer` with std::to_chars, which gives the
+     * same text as the stream at the same precision, and the buffer goes to
+     * the file in chunks of at least FLUSH_SIZE bytes.
+     */
+    static constexpr size_t FLUSH_SIZE = 1 << 20;
+
+    std::string buffer;
+    int         precision;
+
     std::vector<std::string> scalVarNames;
     std::vector<std::string> vectVarNames;
 
+    /* Slots of the names in the exported dictionary, NO_KEY until found */
+    std::uint64_t             boundDictId;
+    std::vector<VarDict::Key> scalVarKeys;
+    std::vector<VarDict::Key> vectVarKeys;
+
     void printHeader();
+    void appendValue(double value);
+    void flushBuffer();
     void init(const VarDict &vars);
+    void bindKeys(const VarDict &vars);
 
     bool initialized;
 
 public:
     explicit CSVExporter(const std::string& output);
+    ~CSVExporter() override;
 
-    void addScalarVar(const std::string &name);
-    void addVectorVar(const std::string &name);
+    void addScalarVar(const std::string &name) override;
+    void addVectorVar(const std::string &name) override;
 
-    void setPrecision(int precision);
-    void exportVars(const VarDict &vars);
+    void setPrecision(int precision) override;
+    void exportVars(const VarDict &vars) override;
 };
 
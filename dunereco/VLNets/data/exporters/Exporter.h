@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include "dunereco/VLNets/data/structs/VarDict.h"
+
+/*
+ * `Exporter` -- common interface of the data exporters.
+ *
+ * The exported variables are either those added with `addScalarVar` and
+ * `addVectorVar` before the first export, or, if none were added, all the
+ * variables of the first exported `VarDict` in name order.
+ */
+class Exporter
+{
+public:
+    virtual ~Exporter() = default;
+
+    virtual void addScalarVar(const std::string &name) = 0;
+    virtual void addVectorVar(const std::string &name) = 0;
+
+    /* Number of significant digits, only used by text formats */
+    virtual void setPrecision(int precision) = 0;
+
+    virtual void exportVars(const VarDict &vars) = 0;
+};
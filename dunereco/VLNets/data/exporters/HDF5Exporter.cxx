@@ -0,0 +1,474 @@
+#include "HDF5Exporter.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "hdf5.h"
+
+/* Row groups waiting for the writer, the event loop blocks beyond that */
+static const size_t MAX_QUEUED_GROUPS = 2;
+
+static void check(herr_t status, const std::string &what)
+{
+    if (status < 0) {
+        throw std::runtime_error("HDF5Exporter: failed to " + what);
+    }
+}
+
+static hid_t checkId(hid_t id, const std::string &what)
+{
+    if (id < 0) {
+        throw std::runtime_error("HDF5Exporter: failed to " + what);
+    }
+
+    return id;
+}
+
+/* Make an extendable 1D dataset, chunked by `chunk` entries */
+static hid_t createDataset(
+    hid_t location, const std::string &name, hid_t type,
+    hsize_t chunk, int compression
+)
+{
+    const hsize_t size    = 0;
+    const hsize_t maxSize = H5S_UNLIMITED;
+
+    hid_t space = checkId(
+        H5Screate_simple(1, &size, &maxSize), "create space of " + name
+    );
+    hid_t props = checkId(
+        H5Pcreate(H5P_DATASET_CREATE), "create properties of " + name
+    );
+
+    check(H5Pset_chunk(props, 1, &chunk), "set chunks of " + name);
+
+    if (compression > 0) {
+        check(H5Pset_shuffle(props), "set shuffle of " + name);
+        check(H5Pset_deflate(props, compression), "set deflate of " + name);
+    }
+
+    hid_t dataset = H5Dcreate2(
+        location, name.c_str(), type, space, H5P_DEFAULT, props, H5P_DEFAULT
+    );
+
+    H5Pclose(props);
+    H5Sclose(space);
+
+    return checkId(dataset, "create dataset " + name);
+}
+
+/* Append count entries of memType to the end of a dataset of size offset */
+static void appendToDataset(
+    hid_t dataset, hid_t memType, const void *data,
+    hsize_t offset, hsize_t count
+)
+{
+    if (count == 0) {
+        return;
+    }
+
+    const hsize_t newSize = offset + count;
+    check(H5Dset_extent(dataset, &newSize), "extend dataset");
+
+    hid_t fileSpace = checkId(H5Dget_space(dataset), "get dataset space");
+    hid_t memSpace  = checkId(
+        H5Screate_simple(1, &count, nullptr), "create memory space"
+    );
+
+    herr_t status = H5Sselect_hyperslab(
+        fileSpace, H5S_SELECT_SET, &offset, nullptr, &count, nullptr
+    );
+
+    if (status >= 0) {
+        status = H5Dwrite(
+            dataset, memType, memSpace, fileSpace, H5P_DEFAULT, data
+        );
+    }
+
+    H5Sclose(memSpace);
+    H5Sclose(fileSpace);
+
+    check(status, "write dataset");
+}
+
+struct HDF5Exporter::File
+{
+    hid_t fileId = -1;
+
+    std::vector<hid_t> scalarSets;
+    std::vector<hid_t> valueSets;
+    std::vector<hid_t> splitSets;
+
+    hsize_t                   nRows = 0;
+    std::vector<std::int64_t> nValues;
+
+    bool created = false;
+
+    void create(
+        const std::vector<std::string> &scalNames,
+        const std::vector<std::string> &vectNames,
+        hsize_t rowChunk, int compression
+    );
+    void write(const RowGroup &group);
+    void close();
+};
+
+void HDF5Exporter::File::create(
+    const std::vector<std::string> &scalNames,
+    const std::vector<std::string> &vectNames,
+    hsize_t rowChunk, int compression
+)
+{
+    hid_t scalars = checkId(
+        H5Gcreate2(fileId, "scalars", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+        "create group scalars"
+    );
+
+    for (const auto &name : scalNames) {
+        scalarSets.push_back(createDataset(
+            scalars, name, H5T_IEEE_F64LE, rowChunk, compression
+        ));
+    }
+
+    H5Gclose(scalars);
+
+    hid_t vectors = checkId(
+        H5Gcreate2(fileId, "vectors", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+        "create group vectors"
+    );
+
+    const std::int64_t firstSplit = 0;
+
+    for (const auto &name : vectNames)
+    {
+        hid_t group = checkId(
+            H5Gcreate2(
+                vectors, name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT
+            ),
+            "create group " + name
+        );
+
+        valueSets.push_back(createDataset(
+            group, "values", H5T_IEEE_F32LE, 16 * rowChunk, compression
+        ));
+        splitSets.push_back(createDataset(
+            group, "row_splits", H5T_STD_I64LE, rowChunk, compression
+        ));
+
+        H5Gclose(group);
+
+        appendToDataset(splitSets.back(), H5T_NATIVE_INT64, &firstSplit, 0, 1);
+    }
+
+    H5Gclose(vectors);
+
+    nValues.assign(vectNames.size(), 0);
+    created = true;
+}
+
+void HDF5Exporter::File::write(const RowGroup &group)
+{
+    for (size_t i = 0; i < scalarSets.size(); i++) {
+        appendToDataset(
+            scalarSets[i], H5T_NATIVE_DOUBLE, group.scalars[i].data(),
+            nRows, group.nRows
+        );
+    }
+
+    std::vector<std::int64_t> splits;
+
+    for (size_t i = 0; i < valueSets.size(); i++)
+    {
+        appendToDataset(
+            valueSets[i], H5T_NATIVE_FLOAT, group.values[i].data(),
+            nValues[i], group.values[i].size()
+        );
+
+        splits.clear();
+
+        for (const std::int64_t length : group.lengths[i]) {
+            nValues[i] += length;
+            splits.push_back(nValues[i]);
+        }
+
+        appendToDataset(
+            splitSets[i], H5T_NATIVE_INT64, splits.data(),
+            nRows + 1, splits.size()
+        );
+    }
+
+    nRows += group.nRows;
+}
+
+void HDF5Exporter::File::close()
+{
+    for (hid_t id : scalarSets) { H5Dclose(id); }
+    for (hid_t id : valueSets)  { H5Dclose(id); }
+    for (hid_t id : splitSets)  { H5Dclose(id); }
+
+    scalarSets.clear();
+    valueSets.clear();
+    splitSets.clear();
+
+    if (fileId >= 0) {
+        H5Fclose(fileId);
+        fileId = -1;
+    }
+}
+
+HDF5Exporter::HDF5Exporter(
+    const std::string &output, size_t rowGroupSize, int compression
+) : rowGroupSize(std::max<size_t>(rowGroupSize, 1)),
+    compression(compression),
+    boundDictId(0),
+    initialized(false),
+    file(std::make_unique<File>()),
+    stopping(false)
+{
+    file->fileId = H5Fcreate(
+        output.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT
+    );
+
+    if (file->fileId < 0) {
+        throw std::runtime_error("Failed to open output file");
+    }
+}
+
+HDF5Exporter::~HDF5Exporter()
+{
+    if (writer.joinable())
+    {
+        if (current && (current->nRows > 0)) {
+            submit(std::move(current));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        cond.notify_all();
+        writer.join();
+    }
+
+    file->close();
+
+    if (writerError)
+    {
+        try {
+            std::rethrow_exception(writerError);
+        }
+        catch (const std::exception &e) {
+            std::cerr << "HDF5Exporter: output is incomplete: " << e.what()
+                      << std::endl;
+        }
+    }
+}
+
+void HDF5Exporter::addScalarVar(const std::string &name)
+{
+    if (! initialized) {
+        scalVarNames.push_back(name);
+    }
+}
+
+void HDF5Exporter::addVectorVar(const std::string &name)
+{
+    if (! initialized) {
+        vectVarNames.push_back(name);
+    }
+}
+
+void HDF5Exporter::setPrecision(int)
+{
+    /* Values are stored in binary, nothing to do */
+}
+
+void HDF5Exporter::init(const VarDict &vars)
+{
+    if (scalVarNames.empty() && vectVarNames.empty()) {
+        scalVarNames = vars.scalarNames();
+        vectVarNames = vars.vectorNames();
+
+        std::sort(scalVarNames.begin(), scalVarNames.end());
+        std::sort(vectVarNames.begin(), vectVarNames.end());
+    }
+
+    current = newGroup();
+    writer  = std::thread(&HDF5Exporter::writerLoop, this);
+
+    initialized = true;
+}
+
+void HDF5Exporter::bindKeys(const VarDict &vars)
+{
+    if (vars.id() != boundDictId)
+    {
+        scalVarKeys.assign(scalVarNames.size(), VarDict::NO_KEY);
+        vectVarKeys.assign(vectVarNames.size(), VarDict::NO_KEY);
+        boundDictId = vars.id();
+    }
+
+    /* Names that were missing so far may have been added since */
+    for (size_t i = 0; i < scalVarNames.size(); i++) {
+        if (scalVarKeys[i] == VarDict::NO_KEY) {
+            scalVarKeys[i] = vars.findScalar(scalVarNames[i]);
+        }
+    }
+
+    for (size_t i = 0; i < vectVarNames.size(); i++) {
+        if (vectVarKeys[i] == VarDict::NO_KEY) {
+            vectVarKeys[i] = vars.findVector(vectVarNames[i]);
+        }
+    }
+}
+
+std::unique_ptr<HDF5Exporter::RowGroup> HDF5Exporter::newGroup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (! freeGroups.empty())
+        {
+            std::unique_ptr<RowGroup> group = std::move(freeGroups.back());
+            freeGroups.pop_back();
+            return group;
+        }
+    }
+
+    auto group = std::make_unique<RowGroup>();
+
+    group->scalars.resize(scalVarNames.size());
+    group->values .resize(vectVarNames.size());
+    group->lengths.resize(vectVarNames.size());
+
+    for (auto &column : group->scalars) { column.reserve(rowGroupSize); }
+    for (auto &column : group->lengths) { column.reserve(rowGroupSize); }
+
+    return group;
+}
+
+void HDF5Exporter::submit(std::unique_ptr<RowGroup> group)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    cond.wait(lock, [this] {
+        return (queue.size() < MAX_QUEUED_GROUPS) || writerError;
+    });
+
+    queue.push_back(std::move(group));
+    lock.unlock();
+
+    cond.notify_all();
+}
+
+void HDF5Exporter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        cond.wait(lock, [this] { return (! queue.empty()) || stopping; });
+
+        if (queue.empty()) {
+            break;
+        }
+
+        std::unique_ptr<RowGroup> group = std::move(queue.front());
+        queue.pop_front();
+
+        const bool failed = bool(writerError);
+        lock.unlock();
+
+        std::exception_ptr error;
+
+        /* After a failure the remaining groups are only drained */
+        if (! failed)
+        {
+            try {
+                if (! file->created) {
+                    file->create(
+                        scalVarNames, vectVarNames, rowGroupSize, compression
+                    );
+                }
+
+                file->write(*group);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        group->nRows = 0;
+        for (auto &column : group->scalars) { column.clear(); }
+        for (auto &column : group->values)  { column.clear(); }
+        for (auto &column : group->lengths) { column.clear(); }
+
+        lock.lock();
+
+        if (error) {
+            writerError = error;
+        }
+
+        freeGroups.push_back(std::move(group));
+        cond.notify_all();
+    }
+}
+
+void HDF5Exporter::rethrowWriterError()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (writerError) {
+        std::rethrow_exception(writerError);
+    }
+}
+
+void HDF5Exporter::exportVars(const VarDict &vars)
+{
+    if (! initialized) {
+        init(vars);
+    }
+
+    rethrowWriterError();
+    bindKeys(vars);
+
+    RowGroup &group = *current;
+
+    for (size_t i = 0; i < scalVarKeys.size(); i++)
+    {
+        const VarDict::Key key = scalVarKeys[i];
+
+        group.scalars[i].push_back(
+            (key == VarDict::NO_KEY)
+                ? std::numeric_limits<double>::quiet_NaN() : vars.scalar(key)
+        );
+    }
+
+    for (size_t i = 0; i < vectVarKeys.size(); i++)
+    {
+        const VarDict::Key key = vectVarKeys[i];
+
+        if (key == VarDict::NO_KEY) {
+            group.lengths[i].push_back(0);
+            continue;
+        }
+
+        const std::vector<float> &values = vars.vector(key);
+
+        group.values[i].insert(
+            group.values[i].end(), values.begin(), values.end()
+        );
+        group.lengths[i].push_back(values.size());
+    }
+
+    group.nRows++;
+
+    if (group.nRows >= rowGroupSize)
+    {
+        submit(std::move(current));
+        current = newGroup();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dunereco/VLNets/data/structs/VarDict.h"
+#include "Exporter.h"
+
+/*
+ * `HDF5Exporter` -- binary columnar exporter.
+ *
+ * File layout:
+ * ```
+ * /scalars/<name>              float64 [nEvents]
+ * /vectors/<name>/values       float32 [total length]
+ * /vectors/<name>/row_splits   int64   [nEvents + 1]
+ * ```
+ * Values of event `i` of a vector variable are
+ * `values[row_splits[i]:row_splits[i+1]]`, the layout of
+ * `tf.RaggedTensor.from_row_splits`. Missing scalars are written as NaN.
+ *
+ * Events are collected into row groups of `rowGroupSize` events in memory,
+ * full groups are appended to the file by a background thread. All HDF5
+ * calls after the file is created are made from that thread.
+ */
+class HDF5Exporter : public Exporter
+{
+public:
+    explicit HDF5Exporter(
+        const std::string &output,
+        size_t rowGroupSize = 1024,
+        int compression = 0
+    );
+
+    /* Writes the last row group and closes the file */
+    ~HDF5Exporter() override;
+
+    void addScalarVar(const std::string &name) override;
+    void addVectorVar(const std::string &name) override;
+
+    void setPrecision(int precision) override;
+    void exportVars(const VarDict &vars) override;
+
+private:
+    struct RowGroup
+    {
+        size_t nRows = 0;
+        std::vector<std::vector<double>>       scalars;
+        std::vector<std::vector<float>>        values;
+        std::vector<std::vector<std::int64_t>> lengths;
+    };
+
+    struct File;
+
+    void init(const VarDict &vars);
+    void bindKeys(const VarDict &vars);
+    std::unique_ptr<RowGroup> newGroup();
+    void submit(std::unique_ptr<RowGroup> group);
+    void writerLoop();
+    void rethrowWriterError();
+
+private:
+    size_t rowGroupSize;
+    int    compression;
+
+    std::vector<std::string> scalVarNames;
+    std::vector<std::string> vectVarNames;
+
+    std::uint64_t             boundDictId;
+    std::vector<VarDict::Key> scalVarKeys;
+    std::vector<VarDict::Key> vectVarKeys;
+
+    bool initialized;
+
+    std::unique_ptr<File>     file;
+    std::unique_ptr<RowGroup> current;
+
+    /* Shared with the writer thread */
+    std::mutex                            mutex;
+    std::condition_variable               cond;
+    std::deque<std::unique_ptr<RowGroup>> queue;
+    std::vector<std::unique_ptr<RowGroup>> freeGroups;
+    bool                                  stopping;
+    std::exception_ptr                    writerError;
+
+    std::thread writer;
+};
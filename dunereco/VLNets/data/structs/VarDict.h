@@ -1,13 +1,106 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
-// TODO: Port from double to std::variant when new c++ standard is out
-struct VarDict
+/*
+ * `VarDict` -- named scalar and vector variables of an event.
+ *
+ * Each name is interned once into a slot (`scalarKey`/`vectorKey` make it on
+ * first use, `findScalar`/`findVector` only look it up). Slots never change
+ * for the life of the dictionary, so extractors and models resolve their
+ * names once and then read and write by slot. Cleared vector variables keep
+ * their capacity, so refilling them every event does not allocate.
+ *
+ * Vector values are floats, as in the tensors they end up in. Scalars stay
+ * doubles so that run and event numbers survive the round trip.
+ */
+class VarDict
 {
-    std::unordered_map<std::string, double>               scalar;
-    std::unordered_map<std::string, std::vector<double>>  vector;
-};
+public:
+    typedef unsigned int Key;
+    static constexpr Key NO_KEY = static_cast<Key>(-1);
+
+    VarDict() : dictId(nextId()) { }
+
+    VarDict(const VarDict &) = delete;
+    VarDict &operator=(const VarDict &) = delete;
+
+    /* Unique per dictionary, so that users can tell whose keys they hold */
+    std::uint64_t id() const { return dictId; }
+
+    Key scalarKey(const std::string &name)
+    {
+        auto it = scalarIndex.emplace(name, scalarValues.size()).first;
+        if (it->second == scalarValues.size()) {
+            scalarNames_.push_back(name);
+            scalarValues.push_back(0);
+        }
+        return it->second;
+    }
+
+    Key vectorKey(const std::string &name)
+    {
+        auto it = vectorIndex.emplace(name, vectorValues.size()).first;
+        if (it->second == vectorValues.size()) {
+            vectorNames_.push_back(name);
+            vectorValues.emplace_back();
+        }
+        return it->second;
+    }
+
+    Key findScalar(const std::string &name) const
+    {
+        auto it = scalarIndex.find(name);
+        return (it == scalarIndex.end()) ? NO_KEY : it->second;
+    }
+
+    Key findVector(const std::string &name) const
+    {
+        auto it = vectorIndex.find(name);
+        return (it == vectorIndex.end()) ? NO_KEY : it->second;
+    }
+
+    double &scalar(Key key)       { return scalarValues[key]; }
+    double  scalar(Key key) const { return scalarValues[key]; }
 
+    std::vector<float>       &vector(Key key)       { return vectorValues[key]; }
+    const std::vector<float> &vector(Key key) const { return vectorValues[key]; }
+
+    /* Checked access by name, throws std::out_of_range for unknown names */
+    double scalarAt(const std::string &name) const
+    {
+        return scalarValues[scalarIndex.at(name)];
+    }
+
+    const std::vector<float> &vectorAt(const std::string &name) const
+    {
+        return vectorValues[vectorIndex.at(name)];
+    }
+
+    /* Names in slot order */
+    const std::vector<std::string> &scalarNames() const { return scalarNames_; }
+    const std::vector<std::string> &vectorNames() const { return vectorNames_; }
+
+private:
+    static std::uint64_t nextId()
+    {
+        static std::atomic<std::uint64_t> counter(0);
+        return ++counter;
+    }
+
+    std::uint64_t dictId;
+
+    std::unordered_map<std::string, Key> scalarIndex;
+    std::unordered_map<std::string, Key> vectorIndex;
+
+    std::vector<std::string> scalarNames_;
+    std::vector<std::string> vectorNames_;
+
+    std::vector<double>             scalarValues;
+    std::vector<std::vector<float>> vectorValues;
+};
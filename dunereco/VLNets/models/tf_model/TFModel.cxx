@@ -1,10 +1,15 @@
 #include "TFModel.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
 #include <utility>
 
 #include <boost/numeric/conversion/cast.hpp>
 #include "tensorflow/core/public/session.h"
-#include "tensorflow/core/platform/env.h"
+
+#include "dunereco/TFRuntime/TFSessionRegistry.h"
 
 using namespace tensorflow;
 
@@ -14,6 +19,21 @@ inline int asInt(T x)
     return boost::numeric_cast<int>(x);
 }
 
+struct TFModel::InputPlan
+{
+    struct Node
+    {
+        bool                      isVector;
+        std::vector<VarDict::Key> keys;
+    };
+
+    std::uint64_t     dictId = 0;
+    std::vector<Node> nodes;
+
+    /* In the same order as nodes */
+    std::vector<std::pair<std::string, Tensor>> inputs;
+};
+
 TFModel::TFModel(
     const std::string &savedir,
     const std::vector<InputConfigKeys> &scalarInputKeys,
@@ -24,110 +44,104 @@ TFModel::TFModel(
     initialized(false)
 { }
 
-Tensor TFModel::constructDummyVectorInput(
-    const std::vector<std::string> &vars, float fillValue
-)
-{
-    Tensor result(
-        DT_FLOAT, TensorShape( {1, 1, asInt(vars.size())} )
-    );
+TFModel::~TFModel() = default;
 
-    auto resultData = result.tensor<float, 3>();
-
-    for (int varIdx = 0; varIdx < asInt(vars.size()); varIdx++) {
-        resultData(0, 0, varIdx) = fillValue;
+/*
+ * Get the float buffer of a tensor with this shape, reusing the storage of
+ * the previous event unless the shape changed or TF still holds on to it
+ */
+static float* reuseTensor(Tensor &tensor, const TensorShape &shape)
+{
+    if ((tensor.shape() != shape) || (! tensor.RefCountIsOne())) {
+        tensor = Tensor(DT_FLOAT, shape);
     }
 
-    return result;
+    return tensor.flat<float>().data();
 }
 
-Tensor TFModel::constructScalarInput(
-    const std::unordered_map<std::string, double> &varMap,
-    const std::vector<std::string>                &vars
+static void fillScalarRow(
+    const VarDict &vars, const std::vector<VarDict::Key> &keys, float *data
 )
 {
-    Tensor result(
-        DT_FLOAT, TensorShape( {1, asInt(vars.size())} )
-    );
-    auto resultData = result.tensor<float, 2>();
-
-    for (int varIdx = 0; varIdx < asInt(vars.size()); varIdx++) {
-        resultData(0, varIdx) = varMap.at(vars[varIdx]);
+    for (size_t varIdx = 0; varIdx < keys.size(); varIdx++) {
+        data[varIdx] = vars.scalar(keys[varIdx]);
     }
-
-    return result;
 }
 
-tensorflow::Tensor TFModel::constructVectorInput(
-    const std::unordered_map<std::string, std::vector<double>> &varMap,
-    const std::vector<std::string>                             &vars
+static size_t vectorLength(
+    const VarDict &vars, const std::vector<VarDict::Key> &keys
 )
 {
-    if (vars.empty()) {
-        return constructDummyVectorInput(vars, 0.0);
-    }
+    return keys.empty() ? 0 : vars.vector(keys[0]).size();
+}
 
-    const size_t vectorSize = (varMap.empty()) ? 0 : varMap.at(vars[0]).size();
+/*
+ * Fill the (max(vectorSize, 1), nVars) block of one dictionary. Each variable
+ * is a column of the row-major block.
+ *
+ * NOTE: Fake block with vectorSize == 1 is needed for empty vectors, since
+ * otherwise tensorflow fails to infer graph dimensions.
+ */
+static void fillVectorRows(
+    const VarDict &vars, const std::vector<VarDict::Key> &keys,
+    size_t vectorSize, float *data
+)
+{
+    const size_t nVars = keys.size();
 
     if (vectorSize == 0) {
-        /*
-         * NOTE: Fake tensor with vectorSize == 1 is needed, since otherwise
-         * tensorflow fails to infer graph dimensions.
-         */
-        return constructDummyVectorInput(vars, 0.0);
+        std::fill(data, data + nVars, 0.0f);
+        return;
     }
 
-    Tensor result(
-        DT_FLOAT, TensorShape({ 1, asInt(vectorSize), asInt(vars.size()) })
-    );
-    auto resultData = result.tensor<float, 3>();
-
-    for (int varIdx = 0; varIdx < asInt(vars.size()); varIdx++)
+    for (size_t varIdx = 0; varIdx < nVars; varIdx++)
     {
-        const auto &values = varMap.at(vars[varIdx]);
+        const std::vector<float> &values = vars.vector(keys[varIdx]);
 
         if (values.size() != vectorSize) {
             throw std::runtime_error("Vectors have different lengths");
         }
 
-        for (int i = 0; i < asInt(vectorSize); i++) {
-            resultData(0, i, varIdx) = values[i];
+        float *column = data + varIdx;
+
+        for (size_t i = 0; i < vectorSize; i++) {
+            column[i * nVars] = values[i];
         }
     }
-
-    return result;
 }
 
-void TFModel::initTFSession() const
+static void fillScalarInput(
+    const VarDict &vars, const std::vector<VarDict::Key> &keys, Tensor &tensor
+)
 {
-    GraphDef graph;
-    Session *session = nullptr;
+    float *data = reuseTensor(tensor, TensorShape({ 1, asInt(keys.size()) }));
+    fillScalarRow(vars, keys, data);
+}
 
-    /* TODO: Find NewSession version with safer memory management */
-    auto status = NewSession(SessionOptions(), &session);
+static void fillVectorInput(
+    const VarDict &vars, const std::vector<VarDict::Key> &keys, Tensor &tensor
+)
+{
+    const size_t vectorSize = vectorLength(vars, keys);
 
-    if (! status.ok())
-    {
-        delete session;
-        throw std::runtime_error(
-            "Failed to initialize TF Session: " + status.ToString()
-        );
-    }
+    float *data = reuseTensor(
+        tensor,
+        TensorShape({ 1, asInt(std::max<size_t>(vectorSize, 1)), asInt(keys.size()) })
+    );
 
-    tfSession.reset(session);
-    session = nullptr;
+    fillVectorRows(vars, keys, vectorSize, data);
+}
 
-    status = ReadBinaryProto(Env::Default(), config.getModelPath(), &graph);
-    if (! status.ok()) {
-        throw std::runtime_error(
-            "Failed to load TF Graph: " + status.ToString()
-        );
-    }
+void TFModel::initTFSession() const
+{
+    /* Sessions are shared per model file across the job, TF default threading */
+    tfSession = tf::SessionRegistry::Instance().GetGraph(
+        config.getModelPath(), tf::ThreadConfig{ 0, 0, false }
+    );
 
-    status = tfSession->Create(graph);
-    if (! status.ok()) {
+    if (! tfSession) {
         throw std::runtime_error(
-            "Failed to create TF Session: " + status.ToString()
+            "Failed to load TF Graph: " + config.getModelPath()
         );
     }
 }
@@ -144,33 +158,101 @@ void TFModel::ensure_initialized() const
     initialized = true;
 }
 
-std::vector<Tensor> TFModel::predict(const VarDict &vars) const
+/*
+ * Slots of the variables of each input node in a dictionary, scalar nodes
+ * first, then vector nodes, as the nodes of an `InputPlan`
+ */
+static std::vector<std::vector<VarDict::Key>> resolveKeys(
+    const ModelConfig &config, const VarDict &vars
+)
 {
-    ensure_initialized();
+    std::vector<std::vector<VarDict::Key>> nodeKeys;
 
-    std::vector<std::pair<std::string, Tensor>> inputs;
-    std::vector<Tensor>                         outputs;
+    auto addNodes = [&nodeKeys] (
+        const std::vector<InputConfig> &inputs, auto findKey
+    )
+    {
+        for (const auto &inputConfig : inputs)
+        {
+            std::vector<VarDict::Key> keys;
+
+            for (const auto &name : inputConfig.varNames)
+            {
+                const VarDict::Key key = findKey(name);
 
-    inputs.reserve(
-        config.getScalarInputs().size() + config.getVectorInputs().size()
+                if (key == VarDict::NO_KEY) {
+                    throw std::out_of_range(
+                        "Input variable " + name + " of node "
+                        + inputConfig.nodeName + " was not extracted"
+                    );
+                }
+
+                keys.push_back(key);
+            }
+
+            nodeKeys.push_back(std::move(keys));
+        }
+    };
+
+    addNodes(
+        config.getScalarInputs(),
+        [&vars] (const std::string &name) { return vars.findScalar(name); }
     );
 
-    for (const auto &inputConfig : config.getScalarInputs()) {
-        inputs.emplace_back(
-            inputConfig.nodeName,
-            constructScalarInput(vars.scalar, inputConfig.varNames)
-        );
+    addNodes(
+        config.getVectorInputs(),
+        [&vars] (const std::string &name) { return vars.findVector(name); }
+    );
+
+    return nodeKeys;
+}
+
+void TFModel::compilePlan(const VarDict &vars) const
+{
+    plan = std::make_unique<InputPlan>();
+
+    std::vector<std::vector<VarDict::Key>> nodeKeys = resolveKeys(config, vars);
+    const size_t nScalar = config.getScalarInputs().size();
+
+    for (size_t i = 0; i < nodeKeys.size(); i++)
+    {
+        const bool isVector = (i >= nScalar);
+        const InputConfig &inputConfig = isVector
+            ? config.getVectorInputs()[i - nScalar]
+            : config.getScalarInputs()[i];
+
+        plan->nodes.push_back(InputPlan::Node { isVector, std::move(nodeKeys[i]) });
+        plan->inputs.emplace_back(inputConfig.nodeName, Tensor());
     }
 
-    for (const auto &inputConfig : config.getVectorInputs()) {
-        inputs.emplace_back(
-            inputConfig.nodeName,
-            constructVectorInput(vars.vector, inputConfig.varNames)
-        );
+    plan->dictId = vars.id();
+}
+
+std::vector<Tensor> TFModel::predict(const VarDict &vars) const
+{
+    ensure_initialized();
+
+    if ((! plan) || (plan->dictId != vars.id())) {
+        compilePlan(vars);
     }
 
+    for (size_t i = 0; i < plan->nodes.size(); i++)
+    {
+        const InputPlan::Node &node = plan->nodes[i];
+        Tensor &tensor = plan->inputs[i].second;
+
+        if (node.isVector) {
+            fillVectorInput(vars, node.keys, tensor);
+        }
+        else {
+            fillScalarInput(vars, node.keys, tensor);
+        }
+    }
+
+    std::vector<Tensor> outputs;
+
     auto status = tfSession->Run(
-        inputs, config.getOutputNodes(), {}, &outputs
+        plan->inputs, config.getOutputNodes(), &outputs
     );
 
     if (! status.ok()) {
@@ -182,3 +264,115 @@ std::vector<Tensor> TFModel::predict(const VarDict &vars) const
     return outputs;
 }
 
+std::vector<std::vector<Tensor>> TFModel::predict(
+    const std::vector<const VarDict*> &batch
+) const
+{
+    ensure_initialized();
+
+    const std::vector<InputConfig> &scalarInputs = config.getScalarInputs();
+    const std::vector<InputConfig> &vectorInputs = config.getVectorInputs();
+    const size_t nScalar = scalarInputs.size();
+
+    /* Bucket the dictionaries by the lengths of their vector inputs */
+    std::vector<std::vector<std::vector<VarDict::Key>>> batchKeys;
+    std::map<std::vector<size_t>, std::vector<size_t>> buckets;
+
+    for (size_t iDict = 0; iDict < batch.size(); iDict++)
+    {
+        batchKeys.push_back(resolveKeys(config, *batch[iDict]));
+
+        std::vector<size_t> lengths;
+        for (size_t i = nScalar; i < batchKeys.back().size(); i++) {
+            lengths.push_back(vectorLength(*batch[iDict], batchKeys.back()[i]));
+        }
+
+        buckets[lengths].push_back(iDict);
+    }
+
+    std::vector<std::vector<Tensor>> results(batch.size());
+
+    for (const auto &bucket : buckets)
+    {
+        const std::vector<size_t> &lengths = bucket.first;
+        const std::vector<size_t> &dicts   = bucket.second;
+        const int nRows = asInt(dicts.size());
+
+        std::vector<std::pair<std::string, Tensor>> inputs;
+
+        for (size_t i = 0; i < nScalar; i++)
+        {
+            const size_t nVars = scalarInputs[i].varNames.size();
+            Tensor tensor(DT_FLOAT, TensorShape({ nRows, asInt(nVars) }));
+            float *data = tensor.flat<float>().data();
+
+            for (size_t row = 0; row < dicts.size(); row++) {
+                fillScalarRow(
+                    *batch[dicts[row]], batchKeys[dicts[row]][i],
+                    data + row * nVars
+                );
+            }
+
+            inputs.emplace_back(scalarInputs[i].nodeName, std::move(tensor));
+        }
+
+        for (size_t i = 0; i < vectorInputs.size(); i++)
+        {
+            const size_t nVars   = vectorInputs[i].varNames.size();
+            const size_t nSteps  = std::max<size_t>(lengths[i], 1);
+            Tensor tensor(
+                DT_FLOAT, TensorShape({ nRows, asInt(nSteps), asInt(nVars) })
+            );
+            float *data = tensor.flat<float>().data();
+
+            for (size_t row = 0; row < dicts.size(); row++) {
+                fillVectorRows(
+                    *batch[dicts[row]], batchKeys[dicts[row]][nScalar + i],
+                    lengths[i], data + row * nSteps * nVars
+                );
+            }
+
+            inputs.emplace_back(vectorInputs[i].nodeName, std::move(tensor));
+        }
+
+        std::vector<Tensor> outputs;
+
+        auto status = tfSession->Run(
+            inputs, config.getOutputNodes(), &outputs
+        );
+
+        if (! status.ok()) {
+            throw std::runtime_error(
+                "Failed to run TF Session: " + status.ToString()
+            );
+        }
+
+        /* Scatter the rows back, each with a batch dimension of one */
+        for (const Tensor &output : outputs)
+        {
+            if ((output.dims() == 0) || (output.dim_size(0) != nRows)) {
+                throw std::runtime_error(
+                    "TF output does not have one row per batch entry"
+                );
+            }
+
+            TensorShape rowShape = output.shape();
+            rowShape.set_dim(0, 1);
+
+            const int64_t rowSize = rowShape.num_elements();
+            const float  *rows    = output.flat<float>().data();
+
+            for (size_t row = 0; row < dicts.size(); row++)
+            {
+                Tensor result(DT_FLOAT, rowShape);
+                std::copy(
+                    rows + row * rowSize, rows + (row + 1) * rowSize,
+                    result.flat<float>().data()
+                );
+                results[dicts[row]].push_back(std::move(result));
+            }
+        }
+    }
+
+    return results;
+}
@@ -8,7 +8,8 @@
 #include "dunereco/VLNets/data/structs/VarDict.h"
 #include "ModelConfig.h"
 
-namespace tensorflow { class Session; class Tensor; }
+namespace tensorflow { class Tensor; }
+namespace tf { class SharedSession; }
 
 class TFModel
 {
@@ -19,30 +20,35 @@ public:
         const std::vector<InputConfigKeys> &vectorInputKeys,
         const std::vector<std::string>     &outputKeys
     );
+    ~TFModel();
 
     void ensure_initialized() const;
     std::vector<tensorflow::Tensor> predict(const VarDict &vars) const;
 
-private:
-    static tensorflow::Tensor constructDummyVectorInput(
-        const std::vector<std::string> &vars, float fillValue = 0.0
-    );
-
-    static tensorflow::Tensor constructScalarInput(
-        const std::unordered_map<std::string, double> &varMap,
-        const std::vector<std::string>                &vars
-    );
+    /*
+     * Predict several dictionaries at once. Dictionaries whose vector inputs
+     * have the same lengths share one session run, so no sequence is padded.
+     * The outputs are returned per dictionary, in the order of the batch,
+     * shaped as by a single prediction.
+     */
+    std::vector<std::vector<tensorflow::Tensor>> predict(
+        const std::vector<const VarDict*> &batch
+    ) const;
 
-    static tensorflow::Tensor constructVectorInput(
-        const std::unordered_map<std::string, std::vector<double>> &varMap,
-        const std::vector<std::string>                             &vars
-    );
+private:
+    /*
+     * The input tensors of the session, with the VarDict slots that fill
+     * each of them. Made on the first prediction from a dictionary, the
+     * tensors are then refilled in place as long as their shape is unchanged
+     */
+    struct InputPlan;
 
     void initTFSession() const;
+    void compilePlan(const VarDict &vars) const;
 
 private:
     mutable ModelConfig config;
-    mutable std::shared_ptr<tensorflow::Session> tfSession;
+    mutable std::shared_ptr<tf::SharedSession> tfSession;
     mutable bool initialized;
+    mutable std::unique_ptr<InputPlan> plan;
 };
-
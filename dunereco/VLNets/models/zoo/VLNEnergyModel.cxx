@@ -32,4 +32,24 @@ VLNEnergy VLNEnergyModel::predict(const VarDict &vars) const
     return VLNEnergy{ primaryE, totalE };
 }
 
+std::vector<VLNEnergy> VLNEnergyModel::predict(
+    const std::vector<const VarDict*> &batch
+) const
+{
+    std::vector<std::vector<tensorflow::Tensor>> outputs = model.predict(batch);
+
+    std::vector<VLNEnergy> energies;
+    energies.reserve(outputs.size());
+
+    for (const auto &eventOutputs : outputs)
+    {
+        const float primaryE = eventOutputs[0].tensor<float,2>()(0, 0);
+        const float totalE   = eventOutputs[1].tensor<float,2>()(0, 0);
+
+        energies.push_back(VLNEnergy{ primaryE, totalE });
+    }
+
+    return energies;
+}
+
 }
@@ -23,6 +23,8 @@ public:
     explicit VLNEnergyModel(const std::string &savedir);
 
     VLNEnergy predict(const VarDict &varDict) const;
+    /* Energies of a batch of events, in order, c.f. `TFModel::predict` */
+    std::vector<VLNEnergy> predict(const std::vector<const VarDict*> &batch) const;
 };
 
 }